@@ -32,10 +32,11 @@ namespace pik {
 namespace {
 
 // Increase precision in 8x8 blocks that are complicated in DCT space.
-void DctModulation(const ImageF& xyb, ImageF *out) {
+void DctModulation(const ImageF& xyb, ThreadPool* pool, ImageF* out) {
   PIK_ASSERT((xyb.xsize() + 7) / 8 == out->xsize());
   PIK_ASSERT((xyb.ysize() + 7) / 8 == out->ysize());
-  for (int y = 0; y < xyb.ysize(); y += 8) {
+  pool->Run(0, out->ysize(), [&](const int task, const int thread) {
+    const int y = task * 8;
     float* const PIK_RESTRICT row_out = out->Row(y / 8);
     for (int x = 0; x < xyb.xsize(); x += 8) {
       alignas(32) float dct[64] = { 0 };
@@ -70,14 +71,15 @@ void DctModulation(const ImageF& xyb, ImageF *out) {
           one + mul * entropy + mul2 * entropy2 +
           mul3 * entropy3 * mul4 * entropy4;
     }
-  }
+  });
 }
 
 // Increase precision in 8x8 blocks that have high dynamic range.
-void RangeModulation(const ImageF& xyb, ImageF *out) {
+void RangeModulation(const ImageF& xyb, ThreadPool* pool, ImageF* out) {
   PIK_ASSERT((xyb.xsize() + 7) / 8 == out->xsize());
   PIK_ASSERT((xyb.ysize() + 7) / 8 == out->ysize());
-  for (int y = 0; y < xyb.ysize(); y += 8) {
+  pool->Run(0, out->ysize(), [&](const int task, const int thread) {
+    const int y = task * 8;
     float* const PIK_RESTRICT row_out = out->Row(y / 8);
     for (int x = 0; x < xyb.xsize(); x += 8) {
       float minval = 1e30;
@@ -99,14 +101,15 @@ void RangeModulation(const ImageF& xyb, ImageF *out) {
       static const double one = 0.96569671586747452;
       row_out[x / 8] *= one + mul * range;
     }
-  }
+  });
 }
 
 // Change precision in 8x8 blocks that have high frequency content.
-void HfModulation(const ImageF& xyb, ImageF *out) {
+void HfModulation(const ImageF& xyb, ThreadPool* pool, ImageF* out) {
   PIK_ASSERT((xyb.xsize() + 7) / 8 == out->xsize());
   PIK_ASSERT((xyb.ysize() + 7) / 8 == out->ysize());
-  for (int y = 0; y < xyb.ysize(); y += 8) {
+  pool->Run(0, out->ysize(), [&](const int task, const int thread) {
+    const int y = task * 8;
     float* const PIK_RESTRICT row_out = out->Row(y / 8);
     for (int x = 0; x < xyb.xsize(); x += 8) {
       float sum = 0;
@@ -135,10 +138,10 @@ void HfModulation(const ImageF& xyb, ImageF *out) {
       static double kOne = 1.0209732649446996;
       row_out[x / 8] *= kOne + kMul * sum;
     }
-  }
+  });
 }
 
-ImageF DiffPrecompute(const ImageF& xyb, float cutoff) {
+ImageF DiffPrecompute(const ImageF& xyb, float cutoff, ThreadPool* pool) {
   PROFILER_ZONE("aq DiffPrecompute");
   PIK_ASSERT(xyb.xsize() > 1);
   PIK_ASSERT(xyb.ysize() > 1);
@@ -152,7 +155,8 @@ ImageF DiffPrecompute(const ImageF& xyb, float cutoff) {
   // for quantization uses.
   static const double match_gamma_offset1 = 0.0531787811316944;
   static const double match_gamma_offset2 = -0.14085575842765535;
-  for (size_t y = 0; y + 1 < xyb.ysize(); ++y) {
+  pool->Run(0, xyb.ysize() - 1, [&](const int task, const int thread) {
+    const size_t y = task;
     const float* const PIK_RESTRICT row_in = xyb.Row(y);
     const float* const PIK_RESTRICT row_in2 = xyb.Row(y + 1);
     float* const PIK_RESTRICT row_out = result.Row(y);
@@ -172,7 +176,7 @@ ImageF DiffPrecompute(const ImageF& xyb, float cutoff) {
               match_gamma_offset2;
       row_out[x] = std::min(cutoff, diff);
     }
-  }
+  });
   // Last row.
   {
     const size_t y = xyb.ysize() - 1;
@@ -194,31 +198,35 @@ ImageF DiffPrecompute(const ImageF& xyb, float cutoff) {
   return result;
 }
 
-ImageF Expand(const ImageF& img, size_t out_xsize, size_t out_ysize) {
+ImageF Expand(const ImageF& img, size_t out_xsize, size_t out_ysize,
+              ThreadPool* pool) {
   PIK_ASSERT(img.xsize() > 0);
   PIK_ASSERT(img.ysize() > 0);
   ImageF out(out_xsize, out_ysize);
-  for (size_t y = 0; y < out_ysize; ++y) {
+  pool->Run(0, out_ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    // Rows below the image replicate its (extended) last row.
     const float* const PIK_RESTRICT row_in =
-        y < img.ysize() ? img.Row(y) : out.Row(y - 1);
+        img.Row(std::min(y, img.ysize() - 1));
     float* const PIK_RESTRICT row_out = out.Row(y);
     memcpy(row_out, row_in, img.xsize() * sizeof(row_out[0]));
     const float lastval = row_in[img.xsize() - 1];
     for (size_t x = img.xsize(); x < out_xsize; ++x) {
       row_out[x] = lastval;
     }
-  }
+  });
   return out;
 }
 
-ImageF ComputeMask(const ImageF& diffs) {
+ImageF ComputeMask(const ImageF& diffs, ThreadPool* pool) {
   static const float kBase = 0.39251950450684969;
   static const float kMul1 = 0.011097832692603558;
   static const float kOffset1 = 0.015001421280093607;
   static const float kMul2 = -0.019938660050574836;
   static const float kOffset2 = 0.12031987572197222;
   ImageF out(diffs.xsize(), diffs.ysize());
-  for (int y = 0; y < diffs.ysize(); ++y) {
+  pool->Run(0, diffs.ysize(), [&](const int task, const int thread) {
+    const int y = task;
     const float* const PIK_RESTRICT row_in = diffs.Row(y);
     float * const PIK_RESTRICT row_out = out.Row(y);
     for (int x = 0; x < diffs.xsize(); ++x) {
@@ -227,18 +235,19 @@ ImageF ComputeMask(const ImageF& diffs) {
           kMul1 / (val + kOffset1) +
           kMul2 / (val * val + kOffset2);
     }
-  }
+  });
   return out;
 }
 
-ImageF SubsampleWithMax(const ImageF& in, int factor) {
+ImageF SubsampleWithMax(const ImageF& in, int factor, ThreadPool* pool) {
   PROFILER_ZONE("aq Subsample");
   PIK_ASSERT(in.xsize() % factor == 0);
   PIK_ASSERT(in.ysize() % factor == 0);
   const size_t out_xsize = in.xsize() / factor;
   const size_t out_ysize = in.ysize() / factor;
   ImageF out(out_xsize, out_ysize);
-  for (size_t oy = 0; oy < out_ysize; ++oy) {
+  pool->Run(0, out_ysize, [&](const int task, const int thread) {
+    const size_t oy = task;
     float* PIK_RESTRICT row_out = out.Row(oy);
     for (size_t ox = 0; ox < out_xsize; ++ox) {
       float maxval = 0.0f;
@@ -251,13 +260,14 @@ ImageF SubsampleWithMax(const ImageF& in, int factor) {
       }
       row_out[ox] = maxval;
     }
-  }
+  });
   return out;
 }
 
 }  // namespace
 
-ImageF AdaptiveQuantizationMap(const ImageF& img, size_t resolution) {
+ImageF AdaptiveQuantizationMap(const ImageF& img, size_t resolution,
+                               ThreadPool* pool) {
   PROFILER_ZONE("aq AdaptiveQuantMap");
   static const int kSampleRate = 8;
   PIK_ASSERT(resolution % kSampleRate == 0);
@@ -277,16 +287,16 @@ ImageF AdaptiveQuantizationMap(const ImageF& img, size_t resolution) {
   static const int kRadius = static_cast<int>(2 * kSigma + 0.5f);
   std::vector<float> kernel = GaussianKernel(kRadius, kSigma);
   static const float kDiffCutoff = 0.14523279356051019;
-  ImageF out = DiffPrecompute(img, kDiffCutoff);
-  out = Expand(out, resolution * out_xsize, resolution * out_ysize);
-  out = ConvolveAndSample(out, kernel, kSampleRate);
-  out = ComputeMask(out);
+  ImageF out = DiffPrecompute(img, kDiffCutoff, pool);
+  out = Expand(out, resolution * out_xsize, resolution * out_ysize, pool);
+  out = ConvolveAndSample(out, kernel, kSampleRate, pool);
+  out = ComputeMask(out, pool);
   if (resolution > kSampleRate) {
-    out = SubsampleWithMax(out, resolution / kSampleRate);
+    out = SubsampleWithMax(out, resolution / kSampleRate, pool);
   }
-  DctModulation(img, &out);
-  RangeModulation(img, &out);
-  HfModulation(img, &out);
+  DctModulation(img, pool, &out);
+  RangeModulation(img, pool, &out);
+  HfModulation(img, pool, &out);
   return out;
 }
 
@@ -17,6 +17,7 @@
 
 #include <stddef.h>
 
+#include "data_parallel.h"
 #include "image.h"
 
 namespace pik {
@@ -25,8 +26,10 @@ namespace pik {
 // at pixel (x,y) in the returned image is greater than 1.0, it means that
 // more fine-grained quantization should be used in the corresponding block
 // of the input image, while a value less than 1.0 indicates that less
-// fine-grained quantization should be enough.
-ImageF AdaptiveQuantizationMap(const ImageF& img, size_t resolution);
+// fine-grained quantization should be enough. The result does not depend on
+// the number of threads in "pool".
+ImageF AdaptiveQuantizationMap(const ImageF& img, size_t resolution,
+                               ThreadPool* pool);
 
 }  // namespace pik
 
@@ -5,7 +5,10 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include <numeric>  // std::accumulate
+#include <vector>
 
 #define DUMP_SIGMA 0
 
@@ -73,7 +76,7 @@ class Distance {
         sad[(cy + 3) * 8 + cx + 3] = static_cast<int16_t>(sad_sum);
       }
     }
-#elif SIMD_TARGET_VALUE != SIMD_AVX2
+#elif SIMD_TARGET_VALUE != SIMD_AVX2 && SIMD_TARGET_VALUE != SIMD_SVE256
     const Part<uint8_t, 16> d8;
     const Part<int16_t, 8> d16;
     const Part<uint32_t, 4> d32;
@@ -350,7 +353,7 @@ class WeightFast {
     const auto unbiased_exp = ext::mul_high(prescaled, mul_);
     const auto biased_exp = unbiased_exp + bias_;
 
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     // Both blocks of biased_exp are identical, so we can MOVZX + shift into
     // the upper 16 bits using a single-cycle shuffle.
     SIMD_ALIGN constexpr int32_t kHi32From16[8] = {
@@ -375,7 +378,8 @@ class WeightFast {
   void InitMulTable() {
     const int gap = 1 << kSigmaShift;
     // TODO(janwas): not thread-safe
-    if (mul_table[0] != 0) return;
+    // (mul_table[0] is never written; kMinSigma is the first entry.)
+    if (mul_table[kMinSigma] != 0) return;
     int mul = -32768;
     for (int sigma = kMinSigma; sigma <= kMaxSigma; sigma += gap) {
       float w = 0.0f;
@@ -498,6 +502,18 @@ struct Args3 {
     }
   }
 
+  // For tiles: "in" are views whose Row(0) is the top-left output pixel;
+  // "guide" is padded like the full-image version.
+  void SetRow(const size_t y, const Image3B& guide,
+              const ConstImageViewF* SIMD_RESTRICT in,
+              const MutableImageViewF* SIMD_RESTRICT out) {
+    for (size_t c = 0; c < 3; ++c) {
+      guide_m4[c] = guide.ConstPlaneRow(c, y - 4 + kBorder) + kBorder;
+      in_m3[c] = in[c].ConstRow(static_cast<int64_t>(y) - 3);
+      this->out[c] = out[c].Row(y);
+    }
+  }
+
   size_t guide_stride;
   size_t in_stride;
 
@@ -581,7 +597,7 @@ class WeightedSum {
       weight_func(sad_v, &lo, &unused);
       store(lo, df, weights + i);
     }
-#elif SIMD_TARGET_VALUE != SIMD_AVX2
+#elif SIMD_TARGET_VALUE != SIMD_AVX2 && SIMD_TARGET_VALUE != SIMD_SVE256
     f32x4 w0L, w0H, w1L, w1H, w2L, w2H, w3L, w3H, w4L, w4H, w5L, w5H, w6L, w6H;
     weight_func(load(d16, sad + 0 * d16.N), &w0L, &w0H);
     weight_func(load(d16, sad + 1 * d16.N), &w1L, &w1H);
@@ -707,7 +723,7 @@ class WeightedSum {
 
     // Safe because weights[27] == 1.
     *out = weighted_sum / sum_weights;
-#elif SIMD_TARGET_VALUE != SIMD_AVX2
+#elif SIMD_TARGET_VALUE != SIMD_AVX2 && SIMD_TARGET_VALUE != SIMD_SVE256
     in_m3 -= 3;
 
     const auto w0L = load(df, weights + 0 * df.N);
@@ -879,10 +895,36 @@ int Sigma(const float weight_mul, const int ac_quant) {
   return std::min(sigma, epf::kMaxSigma);
 }
 
+// Filters the blocks [bx0, xsize) / 8 of the block row starting at "by" whose
+// "sigmas" entry (one per block, starting at bx0 / 8) is at least kMinSigma;
+// the others are left unchanged. Row-major, so each row's pointers are set
+// once for all of its blocks.
+template <class Guide, class In, class Out, class Args>
+void FilterBlockRow(const Guide& guide, const In& in, const size_t by,
+                    const size_t bx0, const size_t xsize,
+                    const int* PIK_RESTRICT sigmas, WeightFast* weight_func,
+                    Args* args, Out out) {
+  for (size_t iy = 0; iy < 8; ++iy) {
+    args->SetRow(by + iy, guide, in, out);
+    for (size_t bx = bx0; bx < xsize; bx += 8) {
+      const int sigma = sigmas[(bx - bx0) / 8];
+      if (sigma < kMinSigma) continue;
+      weight_func->SetSigma(sigma);
+      for (size_t ix = 0; ix < 8; ++ix) {
+        WeightedSum::Compute(bx + ix, *args, *weight_func);
+      }
+    }
+  }
+}
+
+// Bands of 8 rows (one block row) are independent because "guide" and "in"
+// are separate, fully padded copies: each band only reads their kBorder rows
+// above/below and writes its own rows of "out". Results are thus identical
+// regardless of "pool" (which may be null).
 template <class Guide, class Image>
 void FilterAdaptive(const Guide& guide, const Image& in,
                     const AdaptiveFilterParams& params, const float stretch,
-                    Image* SIMD_RESTRICT out) {
+                    ThreadPool* pool, Image* SIMD_RESTRICT out) {
   const size_t xsize = out->xsize();
   const size_t ysize = out->ysize();
   // printf("filter %zu x %zu = %zu pix\n", xsize, ysize, xsize * ysize);
@@ -894,36 +936,47 @@ void FilterAdaptive(const Guide& guide, const Image& in,
   PIK_CHECK(in.xsize() >= xsize + 2 * kBorder);
   PIK_CHECK(in.ysize() >= ysize + 2 * kBorder);
 
-  auto args = MakeArgs(guide, in);
-  const int kSkipThreshold = kMinSigma;
-  WeightFast weight_func;
+  const auto args_prototype = MakeArgs(guide, in);
+  // Initializes mul_table before any concurrent access; copies are cheap.
+  const WeightFast weight_prototype;
   const float weight_mul = stretch / params.sigma_mul;
 
 #if DUMP_SIGMA
   ImageB dump(xsize / 8, ysize / 8);
 #endif
 
-  for (size_t by = 0; by < ysize; by += 8) {
-    const int* PIK_RESTRICT ac_quant_row = params.ac_quant->Row(by / 8);
+  const auto filter_band = [&](const int task, const int thread) {
+    const size_t by = task * 8;
+    auto args = args_prototype;
+    WeightFast weight_func = weight_prototype;
+    const int* PIK_RESTRICT ac_quant_row = params.ac_quant->ConstRow(by / 8);
 #if DUMP_SIGMA
     uint8_t* dump_row = dump.Row(by / 8);
 #endif
 
+    std::vector<int> sigmas(xsize / 8);
+    bool any_active = false;
     for (size_t bx = 0; bx < xsize; bx += 8) {
       const int sigma = Sigma(weight_mul, ac_quant_row[bx / 8]);
 #if DUMP_SIGMA
       dump_row[bx / 8] = std::min(std::max(0, sigma), 255);
 #endif
-      if (sigma < kSkipThreshold) continue;
-      weight_func.SetSigma(sigma);
+      sigmas[bx / 8] = sigma;
+      any_active |= sigma >= kMinSigma;
+    }
+    if (any_active) {
+      FilterBlockRow(guide, in, by, 0, xsize, sigmas.data(), &weight_func,
+                     &args, out);
+    }
+  };
 
-      for (size_t iy = 0; iy < 8; ++iy) {
-        args.SetRow(by + iy, guide, in, out);
-        for (size_t ix = 0; ix < 8; ++ix) {
-          WeightedSum::Compute(bx + ix, args, weight_func);
-        }
-      }
+  const int num_bands = ysize / 8;
+  if (pool == nullptr) {
+    for (int task = 0; task < num_bands; ++task) {
+      filter_band(task, 0);
     }
+  } else {
+    pool->Run(0, num_bands, filter_band);
   }
 
 #if DUMP_SIGMA
@@ -1095,6 +1148,117 @@ Image3B MakeGuide(const Image3F& in, float* PIK_RESTRICT stretch,
   return out;
 }
 
+// Tile version of MakeGuide: converts the output region plus kBorder pixels on
+// each side of the views "in". Returns the same pixels as the corresponding
+// window of MakeGuide for the same "min" and "stretch". Only rows whose
+// "needed" entry is nonzero are initialized.
+Image3B MakeTileGuide(const ConstImageViewF* in, const size_t xsize,
+                      const size_t ysize, const float min, const float stretch,
+                      const std::vector<uint8_t>& needed) {
+  const size_t guide_xsize = xsize + 2 * kBorder;
+  Image3B out(guide_xsize, ysize + 2 * kBorder);
+
+  const Part<uint8_t, df.N> d8;
+  const auto vmul = set1(df, stretch);
+  const auto vmin = set1(df, min);
+
+  for (size_t c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < out.ysize(); ++y) {
+      if (needed[y] == 0) continue;
+      const float* SIMD_RESTRICT row_in =
+          in[c].ConstRow(static_cast<int64_t>(y) - kBorder) - kBorder;
+      uint8_t* SIMD_RESTRICT row_out = out.PlaneRow(c, y);
+
+      // The views are not padded beyond the border, so avoid reading past it.
+      size_t x = 0;
+      for (; x + df.N <= guide_xsize; x += df.N) {
+        const auto scaled = (load_unaligned(df, row_in + x) - vmin) * vmul;
+        const auto i32 = convert_to(Full<int32_t>(), scaled);
+        const auto bytes = u8_from_u32(cast_to(Full<uint32_t>(), i32));
+        store(bytes, d8, row_out + x);
+      }
+      for (; x < guide_xsize; ++x) {
+        // Same truncation and low byte as convert_to and u8_from_u32.
+        const float scaled = (row_in[x] - min) * stretch;
+        row_out[x] = static_cast<uint8_t>(static_cast<int32_t>(scaled));
+      }
+    }
+  }
+
+  return out;
+}
+
+// TFFunc for the adaptive filter (see EdgePreservingFilterFuncImpl).
+void FilterAdaptiveTile(const void* arg,
+                        const ConstImageViewF* SIMD_RESTRICT in,
+                        const OutputRegion& region,
+                        const MutableImageViewF* SIMD_RESTRICT out) {
+  PROFILER_FUNC;
+  const epf::AdaptiveFilterTileArgs& tile_args =
+      *static_cast<const epf::AdaptiveFilterTileArgs*>(arg);
+  const AdaptiveFilterParams& params = tile_args.params;
+  // Blocks outside the image would access nonexistent quant field entries.
+  const size_t xsize = region.partial_xsize;
+  const size_t ysize = region.partial_ysize;
+  PIK_CHECK(region.x % 8 == 0 && region.y % 8 == 0);
+  PIK_CHECK((xsize | ysize) % 8 == 0);
+
+  // Skipped blocks (and pixels outside the image) keep their input values.
+  for (size_t c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < region.ysize; ++y) {
+      memcpy(out[c].Row(y), in[c].ConstRow(y), region.xsize * sizeof(float));
+    }
+  }
+
+  // Sigma of each block (row-major). Blocks below kMinSigma are skipped, as
+  // are the guide rows that only they would read; high-quality tiles thus
+  // only cost the copy above.
+  const float weight_mul = tile_args.stretch / params.sigma_mul;
+  // Borders of subsequent nodes may extend the region beyond the top/left.
+  const size_t bx0 = std::max(0, -region.x);
+  const size_t by0 = std::max(0, -region.y);
+  const size_t xsize_blocks = xsize > bx0 ? (xsize - bx0 + 7) / 8 : 0;
+  const size_t ysize_blocks = (ysize + 7) / 8;
+  std::vector<int> sigmas(xsize_blocks * ysize_blocks);
+  std::vector<uint8_t> active_block_rows(ysize_blocks, 0);
+  // Rows [by, by + 8 + 2 * kBorder) of the guide are read for block row "by".
+  std::vector<uint8_t> needed_guide_rows(ysize + 2 * kBorder, 0);
+  bool any_active = false;
+  for (size_t by = by0; by < ysize; by += 8) {
+    const int* PIK_RESTRICT ac_quant_row =
+        params.ac_quant->ConstRow((region.y + by) / 8) + region.x / 8;
+    int* PIK_RESTRICT row_sigmas = &sigmas[by / 8 * xsize_blocks];
+    for (size_t bx = bx0; bx < xsize; bx += 8) {
+      const int sigma = Sigma(weight_mul, ac_quant_row[bx / 8]);
+      row_sigmas[(bx - bx0) / 8] = sigma;
+      if (sigma >= kMinSigma) active_block_rows[by / 8] = 1;
+    }
+    if (active_block_rows[by / 8] == 0) continue;
+    any_active = true;
+    const size_t end = std::min(by + 8 + 2 * kBorder, needed_guide_rows.size());
+    std::fill(needed_guide_rows.begin() + by, needed_guide_rows.begin() + end,
+              1);
+  }
+  if (!any_active) return;
+
+  const Image3B guide = MakeTileGuide(in, xsize, ysize, tile_args.min,
+                                      tile_args.stretch, needed_guide_rows);
+
+  Args3 args;
+  args.guide_stride = guide.Plane(0).bytes_per_row();
+  args.in_stride = in[0].bytes_per_row();
+  for (size_t c = 0; c < 3; ++c) {
+    PIK_ASSERT(args.in_stride == in[c].bytes_per_row());
+  }
+
+  WeightFast weight_func;
+  for (size_t by = by0; by < ysize; by += 8) {
+    if (active_block_rows[by / 8] == 0) continue;
+    FilterBlockRow(guide, in, by, bx0, xsize, &sigmas[by / 8 * xsize_blocks],
+                   &weight_func, &args, out);
+  }
+}
+
 // Calls filter after padding and creating a guide.
 template <class WeightFunc, class Image>
 void PadAndFilter(Image* in_out, const float min, const float max,
@@ -1135,7 +1299,25 @@ void EdgePreservingFilter::operator()<SIMD_TARGET>(
   Image3F padded = Padding::PadImage(*in_out);
   float stretch;
   auto guide = MakeGuide(padded, &stretch, min, max);
-  FilterAdaptive(guide, padded, params, stretch, in_out);
+  FilterAdaptive(guide, padded, params, stretch, nullptr, in_out);
+}
+
+template <>
+void EdgePreservingFilter::operator()<SIMD_TARGET>(
+    Image3F* in_out, const AdaptiveFilterParams& params, ThreadPool* pool,
+    float min, float max) {
+  Image3F padded = Padding::PadImage(*in_out);
+  float stretch;
+  auto guide = MakeGuide(padded, &stretch, min, max);
+  FilterAdaptive(guide, padded, params, stretch, pool, in_out);
+}
+
+template <>
+TFFunc EdgePreservingFilterFuncImpl::operator()<SIMD_TARGET>() const {
+  // Initializes mul_table before tiles run concurrently.
+  WeightFast weight_func;
+  (void)weight_func;
+  return &FilterAdaptiveTile;
 }
 
 // Separate guide image.
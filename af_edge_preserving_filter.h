@@ -1,7 +1,9 @@
 #ifndef AF_EDGE_PRESERVING_FILTER_H_
 #define AF_EDGE_PRESERVING_FILTER_H_
 
+#include "data_parallel.h"
 #include "image.h"
+#include "tile_flow.h"
 
 namespace pik {
 namespace epf {
@@ -43,6 +45,15 @@ struct AdaptiveFilterParams {
   float sigma_add;
 };
 
+// Argument of the TFGraph node whose TFFunc is EdgePreservingFilterFuncImpl.
+// "min" and "stretch" (= 255 / (max - min)) must be computed from the entire
+// image so that all tiles use the same guide mapping.
+struct AdaptiveFilterTileArgs {
+  AdaptiveFilterParams params;
+  float min;
+  float stretch;
+};
+
 // Adaptive smoothing. "sigma" must be in [kMinSigma, kMaxSigma]. Fills each
 // pixel of "out", which must be pre-allocated.
 struct EdgePreservingFilter {
@@ -59,6 +70,11 @@ struct EdgePreservingFilter {
   template <class Target>
   void operator()(Image3F* in_out, const AdaptiveFilterParams& params,
                   float min = 0.0f, float max = 0.0f);
+  // Same, but filters bands of block rows in parallel on "pool" (may be null).
+  // The result is identical to the single-threaded version.
+  template <class Target>
+  void operator()(Image3F* in_out, const AdaptiveFilterParams& params,
+                  ThreadPool* pool, float min = 0.0f, float max = 0.0f);
 
   // Low-level version with separate guide image: "in" and "guide" must have
   // kBorder extra pixels on each side.
@@ -70,6 +86,18 @@ struct EdgePreservingFilter {
                   Image3F* PIK_RESTRICT out);
 };
 
+// Returns the TFFunc of a node that applies the adaptive filter to one tile
+// at a time, without padded copies of the entire image: the guide only covers
+// the tile plus kBorder. The node has three input/output ports,
+// Borders(kBorder) and an AdaptiveFilterTileArgs argument. The output region
+// must be aligned to blocks and its inputs must be mirrored outside the image
+// (e.g. a TFWrap::kMirror source); the result then matches
+// EdgePreservingFilter.
+struct EdgePreservingFilterFuncImpl {
+  template <class Target>
+  TFFunc operator()() const;
+};
+
 // The following are experimental:
 
 // Same as above, but unoptimized version for comparison.
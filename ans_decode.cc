@@ -132,8 +132,9 @@ bool DecodeANSCodes(const size_t num_histograms, const size_t max_alphabet_size,
                     const uint8_t* symbol_lut, size_t symbol_lut_size,
                     BitReader* in, ANSCode* result) {
   PIK_ASSERT(max_alphabet_size <= ANS_TAB_SIZE);
-  result->map.resize((num_histograms << ANS_LOG_TAB_SIZE) + 1);
-  result->info.resize(num_histograms << ANS_LOG_TAB_SIZE);
+  static_assert(ANS_TAB_SIZE <= (1 << (32 - ANSCode::kSymbolShift)),
+                "Symbols do not fit in ANSCode entries");
+  result->entries.resize(num_histograms << ANS_LOG_TAB_SIZE);
   for (size_t c = 0; c < num_histograms; ++c) {
     std::vector<int> counts;
     if (!ReadHistogram(ANS_LOG_TAB_SIZE, &counts, in)) {
@@ -149,21 +150,15 @@ bool DecodeANSCodes(const size_t num_histograms, const size_t max_alphabet_size,
       if (symbol_lut != nullptr && symbol < symbol_lut_size) {
         symbol = symbol_lut[symbol];
       }
-      const size_t symbol_idx = histo_offset + symbol;
       const uint32_t freq = counts[i];
-#if PIK_BYTE_ORDER_LITTLE
-      const uint32_t s32 = offset + (freq << 16);
-      memcpy(&result->info[symbol_idx], &s32, sizeof(s32));
-#else
-      result->info[symbol_idx].offset = static_cast<uint16_t>(offset);
-      result->info[symbol_idx].freq = static_cast<uint16_t>(freq);
-#endif
       offset += counts[i];
       if (offset > ANS_TAB_SIZE) {
         return PIK_FAILURE("Invalid ANS histogram data.");
       }
-      for (size_t j = 0; j < counts[i]; ++j, ++pos) {
-        result->map[histo_offset + pos] = symbol;
+      // "rank" = res - (start of the symbol's range) in the ANS update.
+      for (uint32_t rank = 0; rank < freq; ++rank, ++pos) {
+        result->entries[histo_offset + pos] =
+            ANSCode::MakeEntry(symbol, freq, rank);
       }
     }
   }
@@ -11,7 +11,7 @@
 #include "ans_params.h"
 #include "bit_reader.h"
 #include "brunsli_v2_input.h"
-#include "byte_order.h"
+#include "status.h"
 
 namespace pik {
 
@@ -54,61 +54,93 @@ class ANSDecoder {
   uint32_t state_;
 };
 
+// Packed decoding table: one 32-bit entry per slot, indexed by
+// (entropy_code_id << ANS_LOG_TAB_SIZE) + (state & ANS_TAB_MASK). Each entry
+// holds everything needed to decode the slot, so ReadSymbol only needs a
+// single (dependent) load per symbol instead of a symbol lookup followed by
+// a frequency/offset lookup.
 struct ANSCode {
-  struct ANSSymbolInfo {
-    uint16_t offset;
-    uint16_t freq;
-  };
-  std::vector<uint16_t> map;
-  // indexed by (entropy_code_id << ANS_LOG_TAB_SIZE) + symbol.
-  std::vector<ANSSymbolInfo> info;
+  // freq can be ANS_TAB_SIZE (single-symbol histogram) and thus needs one bit
+  // more than the rank of the slot within its symbol's range.
+  static constexpr int kFreqBits = ANS_LOG_TAB_SIZE + 1;
+  static constexpr int kRankBits = ANS_LOG_TAB_SIZE;
+  static constexpr int kSymbolShift = kFreqBits + kRankBits;
+
+  static uint32_t MakeEntry(uint32_t symbol, uint32_t freq, uint32_t rank) {
+    return (symbol << kSymbolShift) | (rank << kFreqBits) | freq;
+  }
+
+  // Returns new state and sets "symbol" for "entry" and the given state.
+  static PIK_INLINE uint32_t DecodeEntry(const uint32_t entry,
+                                         const uint32_t state,
+                                         size_t* PIK_RESTRICT symbol) {
+    *symbol = entry >> kSymbolShift;
+    const uint32_t freq = entry & ((1u << kFreqBits) - 1);
+    const uint32_t rank = (entry >> kFreqBits) & ((1u << kRankBits) - 1);
+    return freq * (state >> ANS_LOG_TAB_SIZE) + rank;
+  }
+
+  std::vector<uint32_t> entries;
 };
 
 bool DecodeANSCodes(const size_t num_histograms, const size_t max_alphabet_size,
                     const uint8_t* symbol_lut, size_t symbol_lut_size,
                     BitReader* in, ANSCode* result);
 
+// Decodes symbols from (up to kMaxANSStates) interleaved ANS states; symbol i
+// of each chunk is decoded from state i % num_states. Independent states let
+// the CPU overlap the table lookups of consecutive symbols.
 class ANSSymbolReader {
  public:
-  ANSSymbolReader(const ANSCode* code) : code_(code) {}
+  explicit ANSSymbolReader(const ANSCode* code, const size_t num_states = 1)
+      : num_states_(num_states), code_(code) {
+    PIK_ASSERT(num_states_ == 1 || num_states_ == 2 || num_states_ == 4);
+    for (size_t i = 0; i < kMaxANSStates; ++i) {
+      state_[i] = ANS_SIGNATURE << 16;
+    }
+  }
 
-  PIK_INLINE int ReadSymbol(const int histo_idx, BitReader* PIK_RESTRICT br) {
+  // Reader is BitReader or PaddedBitReader.
+  template <class Reader>
+  PIK_INLINE int ReadSymbol(const int histo_idx, Reader* PIK_RESTRICT br) {
     if (PIK_UNLIKELY(symbols_left_ == 0)) {
-      state_ = br->ReadBits(16);
-      state_ = (state_ << 16) | br->ReadBits(16);
-      br->FillBitBuffer();
+      for (size_t i = 0; i < num_states_; ++i) {
+        state_[i] = br->ReadBits(16);
+        state_[i] = (state_[i] << 16) | br->ReadBits(16);
+        br->FillBitBuffer();
+      }
       symbols_left_ = kANSBufferSize;
+      lane_ = 0;
     }
-    const uint32_t res = state_ & (ANS_TAB_SIZE - 1);
-    const int histo_offset = histo_idx << ANS_LOG_TAB_SIZE;
-
-#if PIK_BYTE_ORDER_LITTLE
-    uint32_t s32;
-    memcpy(&s32, &code_->map[histo_offset + res], sizeof(s32));
-    const size_t symbol = s32 & 0xFFFF;
-
-    memcpy(&s32, &code_->info[histo_offset + symbol], sizeof(s32));
-    const uint32_t offset = s32 & 0xFFFF;
-    const uint32_t freq = s32 >> 16;
-    state_ = freq * (state_ >> ANS_LOG_TAB_SIZE) + res - offset;
-#else
-    const uint16_t symbol = code_->map[histo_offset + res];
-    const ANSCode::ANSSymbolInfo s = code_->info[histo_offset + symbol];
-    state_ = s.freq * (state_ >> ANS_LOG_TAB_SIZE) + res - s.offset;
-#endif
+    uint32_t state = state_[lane_];
+    const uint32_t res = state & ANS_TAB_MASK;
+    const uint32_t entry =
+        code_->entries[(histo_idx << ANS_LOG_TAB_SIZE) + res];
+    size_t symbol;
+    state = ANSCode::DecodeEntry(entry, state, &symbol);
     --symbols_left_;
-    if (PIK_UNLIKELY(state_ < (1u << 16))) {
-      state_ = (state_ << 16) | br->PeekFixedBits<16>();
+    if (PIK_UNLIKELY(state < (1u << 16))) {
+      state = (state << 16) | br->template PeekFixedBits<16>();
       br->Advance(16);
     }
+    state_[lane_] = state;
+    // num_states_ is a power of two.
+    lane_ = (lane_ + 1) & (num_states_ - 1);
     return symbol;
   }
 
-  bool CheckANSFinalState() { return state_ == (ANS_SIGNATURE << 16); }
+  bool CheckANSFinalState() const {
+    for (size_t i = 0; i < num_states_; ++i) {
+      if (state_[i] != (ANS_SIGNATURE << 16)) return false;
+    }
+    return true;
+  }
 
  private:
   size_t symbols_left_ = 0;
-  uint32_t state_ = ANS_SIGNATURE << 16;
+  const size_t num_states_;
+  size_t lane_ = 0;
+  uint32_t state_[kMaxANSStates];
   const ANSCode* code_;
 };
 
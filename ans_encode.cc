@@ -284,6 +284,11 @@ void EncodeFlatHistogram(const int alphabet_size,
 
 }  // namespace
 
+void ANSEncodingDataFromFrequencies(const int* freqs, int alphabet_size,
+                                    ANSEncSymbolInfo* info) {
+  ANSBuildInfoTable(freqs, alphabet_size, info);
+}
+
 void BuildAndStoreANSEncodingData(const int* histogram,
                                   int alphabet_size,
                                   ANSEncSymbolInfo* info,
@@ -51,6 +51,11 @@ void BuildAndStoreANSEncodingData(const int* histogram,
                                   ANSEncSymbolInfo* info,
                                   size_t* storage_ix, uint8_t* storage);
 
+// Sets "info" from the normalized frequencies info[s].freq_ of a table built
+// by BuildAndStoreANSEncodingData (e.g. transmitted to another encoder).
+void ANSEncodingDataFromFrequencies(const int* freqs, int alphabet_size,
+                                    ANSEncSymbolInfo* info);
+
 struct ANSEncodingData {
   void BuildAndStore(const int* histogram, size_t histo_size,
                      size_t* storage_ix, uint8_t* storage) {
@@ -68,6 +73,14 @@ struct ANSEncodingData {
     BuildAndStore(counts.data(), counts.size(), storage_ix, storage);
   }
 
+  // Rebuilds the table of a previous BuildAndStore from its frequencies
+  // (ans_table[s].freq_), without storing anything.
+  void BuildFromFrequencies(const std::vector<int>& freqs) {
+    ans_table.resize(freqs.size());
+    ANSEncodingDataFromFrequencies(freqs.data(), freqs.size(),
+                                   ans_table.data());
+  }
+
   std::vector<ANSEncSymbolInfo> ans_table;
 };
 
@@ -25,6 +25,12 @@ namespace pik {
 
 static const int kANSBufferSize = 1 << 16;
 
+// Upper bound on the number of interleaved ANS states per token stream. The
+// chunk size must be a multiple of every supported count so that each chunk
+// starts with the first state.
+static const int kMaxANSStates = 4;
+static_assert(kANSBufferSize % kMaxANSStates == 0, "Chunk/state mismatch");
+
 #define ANS_LOG_TAB_SIZE 10
 #define ANS_TAB_SIZE (1 << ANS_LOG_TAB_SIZE)
 #define ANS_TAB_MASK (ANS_TAB_SIZE - 1)
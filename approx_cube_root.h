@@ -1,9 +1,16 @@
 #ifndef APPROX_CUBE_ROOT_H_
 #define APPROX_CUBE_ROOT_H_
 
+// WARNING: this is a "restricted" header because it is included from
+// translation units compiled with different flags. This header and its
+// dependencies must not define any function unless it is static inline and/or
+// within namespace SIMD_NAMESPACE. See arch_specific.h for details.
+
+#include <stdint.h>
 #include <string.h>
 
 #include "compiler_specific.h"
+#include "simd/simd.h"
 
 namespace pik {
 
@@ -43,6 +50,52 @@ PIK_INLINE float ApproxCubeRoot(float y) {
   return x2;
 }
 
+namespace SIMD_NAMESPACE {
+
+// Returns CubeRootInitialGuess of each lane. There is no SIMD integer division,
+// so ix / 3 (truncated towards zero) is computed from the magnitude of ix in
+// two 16-bit halves, each of whose quotients is exact in single precision.
+template <class D, class V>
+SIMD_INLINE V CubeRootInitialGuess(const D d, const V y) {
+  const Desc<int32_t, D::N, typename D::Target> di;
+  const Desc<uint32_t, D::N, typename D::Target> du;
+  const auto ix = cast_to(di, y);
+  const auto negative = ix < setzero(di);
+  // Unsigned, hence also valid for ix = INT_MIN (-0.0f).
+  const auto bits = cast_to(du, y);
+  const auto magnitude =
+      select(bits, setzero(du) - bits, cast_to(du, negative));
+
+  // floor((n + 0.5) / 3) is n / 3 for n < 2^18 despite rounding errors.
+  const V half = set1(d, 0.5f);
+  const V third = set1(d, 1.0f / 3.0f);
+  const auto hi = cast_to(di, shift_right<16>(magnitude));
+  const auto lo = cast_to(di, magnitude & set1(du, 0xFFFFu));
+  const auto q_hi = convert_to(di, floor((convert_to(d, hi) + half) * third));
+  const auto r_hi = hi - q_hi * set1(di, 3);
+  const auto t = shift_left<16>(r_hi) + lo;
+  const auto q_lo = convert_to(di, floor((convert_to(d, t) + half) * third));
+  const auto q = shift_left<16>(q_hi) + q_lo;
+
+  const auto quotient = select(q, setzero(di) - q, negative);
+  return cast_to(d, set1(di, 0x2a50f200) + quotient);
+}
+
+template <class D, class V>
+SIMD_INLINE V CubeRootNewtonStep(const D d, const V y, const V xn) {
+  return set1(d, 1.0f / 3.0f) * (set1(d, 2.0f) * xn + y / (xn * xn));
+}
+
+// Vector version of ApproxCubeRoot with identical results.
+template <class D, class V>
+SIMD_INLINE V ApproxCubeRoot(const D d, const V y) {
+  const V x0 = CubeRootInitialGuess(d, y);
+  const V x1 = CubeRootNewtonStep(d, y, x0);
+  const V x2 = CubeRootNewtonStep(d, y, x1);
+  return x2;
+}
+
+}  // namespace SIMD_NAMESPACE
 }  // namespace pik
 
 #endif  // APPROX_CUBE_ROOT_H_
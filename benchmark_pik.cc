@@ -0,0 +1,614 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Encodes and decodes a corpus of PNG images with several settings and
+// thread counts, and reports speed, density and quality as CSV or JSON, e.g.
+// for comparing two versions before upgrading.
+
+#include <dirent.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#undef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#include "args.h"
+#include "butteraugli_distance.h"
+#include "cache_aligned.h"
+#include "compressed_image.h"
+#include "image.h"
+#include "image_io.h"
+#include "noise.h"
+#include "opsin_image.h"
+#include "os_specific.h"
+#include "padded_bytes.h"
+#include "pik.h"
+#include "pik_params.h"
+#include "profiler.h"
+
+namespace pik {
+namespace {
+
+// Named set of encoder parameters, parsed from e.g. "d1.5+fast".
+struct Setting {
+  std::string name;
+  CompressParams params;
+};
+
+// Parses "+"-separated tokens: d<distance>, e<effort>, fast, guetzli, brunsli,
+// lossless, static, noise<patch stride>, proxy<iterations>.
+bool ParseSetting(const std::string& name, Setting* setting) {
+  setting->name = name;
+  setting->params = CompressParams();
+  size_t begin = 0;
+  while (begin <= name.size()) {
+    size_t end = name.find('+', begin);
+    if (end == std::string::npos) end = name.size();
+    const std::string token = name.substr(begin, end - begin);
+    if (token == "fast") {
+      setting->params.fast_mode = true;
+    } else if (token == "guetzli") {
+      setting->params.guetzli_mode = true;
+    } else if (token == "brunsli") {
+      setting->params.use_brunsli_v2 = true;
+    } else if (token == "lossless") {
+      setting->params.lossless = true;
+    } else if (token == "static") {
+      setting->params.static_histograms = true;
+    } else if (token.size() > 5 && token.compare(0, 5, "noise") == 0) {
+      char* parse_end;
+      const unsigned long stride = strtoul(token.c_str() + 5, &parse_end, 10);
+      if (*parse_end != '\0' || stride == 0) {
+        fprintf(stderr, "Invalid noise stride in setting %s.\n", name.c_str());
+        return false;
+      }
+      setting->params.noise_patch_stride = stride;
+    } else if (token.size() > 5 && token.compare(0, 5, "proxy") == 0) {
+      char* parse_end;
+      const unsigned long iters = strtoul(token.c_str() + 5, &parse_end, 10);
+      if (*parse_end != '\0') {
+        fprintf(stderr, "Invalid proxy iterations in setting %s.\n",
+                name.c_str());
+        return false;
+      }
+      setting->params.butteraugli_proxy_iters = iters;
+    } else if (token.size() > 1 && token[0] == 'e') {
+      char* parse_end;
+      const unsigned long effort = strtoul(token.c_str() + 1, &parse_end, 10);
+      if (*parse_end != '\0' || effort == 0 || effort > kMaxEffort) {
+        fprintf(stderr, "Invalid effort in setting %s.\n", name.c_str());
+        return false;
+      }
+      setting->params.effort = effort;
+    } else if (token.size() > 1 && token[0] == 'd') {
+      char* parse_end;
+      setting->params.butteraugli_distance =
+          strtof(token.c_str() + 1, &parse_end);
+      if (*parse_end != '\0' || setting->params.butteraugli_distance <= 0.0f) {
+        fprintf(stderr, "Invalid distance in setting %s.\n", name.c_str());
+        return false;
+      }
+    } else {
+      fprintf(stderr, "Unknown token '%s' in setting %s.\n", token.c_str(),
+              name.c_str());
+      return false;
+    }
+    begin = end + 1;
+  }
+  return true;
+}
+
+// Splits "list" at commas.
+std::vector<std::string> SplitList(const char* list) {
+  std::vector<std::string> items;
+  const std::string str(list);
+  size_t begin = 0;
+  while (begin <= str.size()) {
+    size_t end = str.find(',', begin);
+    if (end == std::string::npos) end = str.size();
+    if (end != begin) items.push_back(str.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return items;
+}
+
+struct BenchmarkArgs {
+  bool Init(int argc, char** argv) {
+    std::string settings_list = "d1";
+    std::string threads_list = "1";
+    for (int i = 1; i < argc; i++) {
+      if (argv[i][0] == '-') {
+        const std::string arg = argv[i];
+        if (arg == "--settings" && i + 1 < argc) {
+          settings_list = argv[++i];
+        } else if (arg == "--num_threads" && i + 1 < argc) {
+          threads_list = argv[++i];
+        } else if (arg == "--num_reps") {
+          if (!ParseUnsigned(argc, argv, &i, &num_reps)) return false;
+        } else if (arg == "--json") {
+          json = true;
+        } else if (arg == "--profile") {
+          profile = true;
+        } else if (arg == "--scaling") {
+          if (!ParseUnsigned(argc, argv, &i, &scaling)) return false;
+        } else {
+          fprintf(stderr, "Unrecognized argument: %s.\n", argv[i]);
+          return false;
+        }
+      } else {
+        if (dir != nullptr) {
+          fprintf(stderr, "Extra argument after directory: %s.\n", argv[i]);
+          return false;
+        }
+        dir = argv[i];
+      }
+    }
+
+    if (dir == nullptr) {
+      fprintf(stderr, "Missing input directory.\n");
+      return false;
+    }
+    if (num_reps == 0) num_reps = 1;
+
+    for (const std::string& name : SplitList(settings_list.c_str())) {
+      Setting setting;
+      if (!ParseSetting(name, &setting)) return false;
+      settings.push_back(setting);
+    }
+    for (const std::string& item : SplitList(threads_list.c_str())) {
+      num_threads.push_back(strtoul(item.c_str(), nullptr, 10));
+    }
+    if (scaling != 0) {
+      num_threads.clear();
+      for (size_t n = 1; n < scaling; n *= 2) num_threads.push_back(n);
+      num_threads.push_back(scaling);
+    }
+    if (settings.empty() || num_threads.empty()) {
+      fprintf(stderr, "Empty --settings or --num_threads.\n");
+      return false;
+    }
+    return true;
+  }
+
+  static const char* HelpFormatString() {
+    return "Usage: %s dir [--settings S,S..] [--num_threads N,N..]\n"
+           "  [--num_reps N] [--json] [--profile]\n"
+           "  Encodes and decodes all *.png in dir with each setting S and\n"
+           "  thread count, and prints one CSV (or JSON) record per run.\n"
+           "  S: '+'-separated d<distance>, e<effort 1..9>, fast, guetzli,\n"
+           "     brunsli, lossless, static (built-in AC histograms),\n"
+           "     noise<N> (estimate noise from every N-th patch and report\n"
+           "     noise_err, the max strength error vs. all patches),\n"
+           "     proxy<N> (the first N quantization search iterations use\n"
+           "     2x downsampled butteraugli); e.g.\n"
+           "     d1,d2+fast,brunsli,d3+noise2,d1+proxy4. Compare the\n"
+           "     speed/size of effort levels with e.g. e1,e3,e5,e7,e9.\n"
+           "     Default: d1.\n"
+           "  --num_reps N: time the best of N encodes and decodes.\n"
+           "  --profile: also report profiler zones [ticks] (only measured\n"
+           "             if the library was built with PROFILER_ENABLED).\n"
+           "  --scaling N: instead, run with 1, 2, 4, .., N threads and\n"
+           "             print one record per setting and profiler zone with\n"
+           "             its wall time [ms] per thread count, the speedup\n"
+           "             and serial fraction at N threads; 'serial' marks\n"
+           "             zones that stop scaling.\n";
+  }
+
+  const char* dir = nullptr;
+  std::vector<Setting> settings;
+  std::vector<size_t> num_threads;
+  size_t num_reps = 1;
+  bool json = false;
+  bool profile = false;
+  size_t scaling = 0;  // Maximum number of threads; 0 = no scaling report.
+};
+
+// Returns sorted paths of all *.png files in "dir".
+std::vector<std::string> ListPNG(const char* dir) {
+  std::vector<std::string> paths;
+  DIR* handle = opendir(dir);
+  if (handle == nullptr) return paths;
+  while (const dirent* entry = readdir(handle)) {
+    const std::string name = entry->d_name;
+    if (name.size() > 4 && (name.compare(name.size() - 4, 4, ".png") == 0 ||
+                            name.compare(name.size() - 4, 4, ".PNG") == 0)) {
+      paths.push_back(std::string(dir) + "/" + name);
+    }
+  }
+  closedir(handle);
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// Peak resident set size of this process so far [bytes].
+size_t PeakRSS() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;  // KiB on Linux.
+}
+
+struct Result {
+  std::string file;
+  std::string setting;
+  size_t num_threads;
+  size_t xsize;
+  size_t ysize;
+  size_t compressed_size;
+  double encode_seconds;  // Minimum over all reps.
+  double decode_seconds;
+  float distance;
+  // Noise strength error of the subsampled estimate; 0 if not subsampled.
+  float noise_error;
+  size_t peak_rss;
+  // AllocationStats::PeakBytes during encode/decode (maximum over all reps),
+  // which unlike peak_rss is not dominated by earlier files.
+  size_t encode_peak_bytes = 0;
+  size_t decode_peak_bytes = 0;
+  std::vector<std::pair<std::string, uint64_t>> zones;  // name, ticks
+  // Only for --scaling: wall time [s] of each zone in the last rep, i.e. the
+  // union of its spans on all threads, plus "encode" and "decode".
+  std::map<std::string, double> wall_seconds;
+};
+
+// Returns the total length of the union of [begin, end) "intervals".
+double UnionLength(std::vector<std::pair<double, double>>* intervals) {
+  std::sort(intervals->begin(), intervals->end());
+  double length = 0.0;
+  double covered_end = -1E30;
+  for (const std::pair<double, double>& interval : *intervals) {
+    const double begin = std::max(interval.first, covered_end);
+    if (interval.second > begin) {
+      length += interval.second - begin;
+      covered_end = interval.second;
+    }
+  }
+  return length;
+}
+
+bool Run(const std::string& file, const MetaImageB& image,
+         const Setting& setting, ThreadPool* pool, const BenchmarkArgs& args,
+         Result* result) {
+  result->file = file;
+  result->setting = setting.name;
+  result->num_threads = pool->NumThreads();
+  result->xsize = image.xsize();
+  result->ysize = image.ysize();
+  result->encode_seconds = 1E30;
+  result->decode_seconds = 1E30;
+
+  // Reused like a server would, so later reps are free of allocation costs.
+  PikEncoder encoder;
+  PikDecoder decoder;
+  PaddedBytes compressed;
+  MetaImageB decoded;
+  for (size_t rep = 0; rep < args.num_reps; ++rep) {
+    const bool trace = args.scaling != 0 && rep == args.num_reps - 1;
+    if (trace) PROFILER_ENABLE_TRACE();
+    AllocationStats::SetPeakBytes(AllocationStats::LiveBytes());
+    const double t0 = Now();
+    if (!encoder.Encode(setting.params, image, pool, &compressed)) {
+      fprintf(stderr, "Failed to encode %s with %s.\n", file.c_str(),
+              setting.name.c_str());
+      return false;
+    }
+    const double t1 = Now();
+    result->encode_peak_bytes =
+        std::max(result->encode_peak_bytes, AllocationStats::PeakBytes());
+    AllocationStats::SetPeakBytes(AllocationStats::LiveBytes());
+    if (!decoder.Decode(DecompressParams(), compressed, pool, &decoded)) {
+      fprintf(stderr, "Failed to decode %s with %s.\n", file.c_str(),
+              setting.name.c_str());
+      return false;
+    }
+    const double t2 = Now();
+    result->decode_peak_bytes =
+        std::max(result->decode_peak_bytes, AllocationStats::PeakBytes());
+    result->encode_seconds = std::min(result->encode_seconds, t1 - t0);
+    result->decode_seconds = std::min(result->decode_seconds, t2 - t1);
+    if (trace) {
+      // Before ButteraugliDistance etc., which would add their own spans.
+      std::map<std::string, std::vector<std::pair<double, double>>> spans;
+      PROFILER_VISIT_TRACE([&spans](const char* name, const uint32_t thread,
+                                    const double start, const double duration) {
+        spans[name].emplace_back(start, start + duration);
+      });
+      for (auto& name_spans : spans) {
+        result->wall_seconds[name_spans.first] =
+            UnionLength(&name_spans.second);
+      }
+      result->wall_seconds["encode"] = t1 - t0;
+      result->wall_seconds["decode"] = t2 - t1;
+    }
+  }
+  result->compressed_size = compressed.size();
+  result->distance =
+      ButteraugliDistance(image.GetColor(), decoded.GetColor(),
+                          setting.params.hf_asymmetry);
+  result->noise_error = 0.0f;
+  const size_t noise_patch_stride = setting.params.noise_patch_stride;
+  if (noise_patch_stride > 1) {
+    // Same input as the encoder's noise estimation.
+    Image3F opsin = CenteredOpsin(OpsinDynamicsImage(image.GetColor(), pool),
+                                  /*gaborish_inverse=*/false, pool);
+    NoiseParams all_patches, subsampled;
+    GetNoiseParameter(opsin, &all_patches, 1.0f, pool);
+    GetNoiseParameter(opsin, &subsampled, 1.0f, pool, noise_patch_stride);
+    result->noise_error = MaxNoiseStrengthDifference(all_patches, subsampled);
+  }
+  result->peak_rss = PeakRSS();
+
+  if (args.profile) {
+    PROFILER_VISIT_RESULTS([result](const char* name, const uint64_t num_calls,
+                                    const uint64_t total_duration) {
+      result->zones.emplace_back(name, total_duration);
+    });
+    std::sort(result->zones.begin(), result->zones.end());
+  }
+  return true;
+}
+
+void PrintCSVHeader(const BenchmarkArgs& args) {
+  printf("file,setting,threads,xsize,ysize,bytes,bpp,encode_mps,decode_mps,"
+         "butteraugli,noise_err,peak_rss,encode_peak,decode_peak%s\n",
+         args.profile ? ",zones" : "");
+}
+
+void PrintCSV(const Result& r, const BenchmarkArgs& args) {
+  const double mp = r.xsize * r.ysize * 1E-6;
+  printf("%s,%s,%zu,%zu,%zu,%zu,%.4f,%.3f,%.3f,%.4f,%.4f,%zu,%zu,%zu",
+         r.file.c_str(), r.setting.c_str(), r.num_threads, r.xsize, r.ysize,
+         r.compressed_size, r.compressed_size * 8 / (mp * 1E6),
+         mp / r.encode_seconds, mp / r.decode_seconds, r.distance,
+         r.noise_error, r.peak_rss, r.encode_peak_bytes, r.decode_peak_bytes);
+  if (args.profile) {
+    // Semicolon-separated name=ticks; zone names contain no commas.
+    printf(",");
+    for (size_t i = 0; i < r.zones.size(); ++i) {
+      printf("%s%s=%llu", i == 0 ? "" : ";", r.zones[i].first.c_str(),
+             static_cast<unsigned long long>(r.zones[i].second));
+    }
+  }
+  printf("\n");
+}
+
+void PrintJSON(const Result& r, const BenchmarkArgs& args, const bool first) {
+  const double mp = r.xsize * r.ysize * 1E-6;
+  printf("%s  {\"file\": \"%s\", \"setting\": \"%s\", \"threads\": %zu, "
+         "\"xsize\": %zu, \"ysize\": %zu, \"bytes\": %zu, \"bpp\": %.4f, "
+         "\"encode_mps\": %.3f, \"decode_mps\": %.3f, \"butteraugli\": %.4f, "
+         "\"noise_err\": %.4f, \"peak_rss\": %zu, \"encode_peak\": %zu, "
+         "\"decode_peak\": %zu",
+         first ? "" : ",\n", r.file.c_str(), r.setting.c_str(), r.num_threads,
+         r.xsize, r.ysize, r.compressed_size,
+         r.compressed_size * 8 / (mp * 1E6), mp / r.encode_seconds,
+         mp / r.decode_seconds, r.distance, r.noise_error, r.peak_rss,
+         r.encode_peak_bytes, r.decode_peak_bytes);
+  if (args.profile) {
+    printf(", \"zones\": {");
+    for (size_t i = 0; i < r.zones.size(); ++i) {
+      printf("%s\"%s\": %llu", i == 0 ? "" : ", ", r.zones[i].first.c_str(),
+             static_cast<unsigned long long>(r.zones[i].second));
+    }
+    printf("}");
+  }
+  printf("}");
+}
+
+// Wall time of one zone for each of BenchmarkArgs::num_threads.
+struct ScalingZone {
+  std::string name;
+  std::vector<double> seconds;
+  double speedup;
+  double serial_fraction;
+  bool serial;
+};
+
+// Derives speedup and serial fraction (Karp-Flatt metric, i.e. Amdahl's law
+// solved for the serial fraction given the measured speedup) at the largest
+// thread count. Sorted by descending wall time at that thread count.
+std::vector<ScalingZone> AnalyzeScaling(const std::vector<Result>& results) {
+  const Result& last = results.back();
+  const double n = static_cast<double>(last.num_threads);
+  const double total = last.encode_seconds + last.decode_seconds;
+  std::vector<ScalingZone> zones;
+  for (const auto& name_seconds : results.front().wall_seconds) {
+    ScalingZone zone;
+    zone.name = name_seconds.first;
+    for (const Result& result : results) {
+      const auto it = result.wall_seconds.find(zone.name);
+      zone.seconds.push_back(it == result.wall_seconds.end() ? 0.0
+                                                             : it->second);
+    }
+    const double serial_seconds = zone.seconds.front();
+    const double parallel_seconds = zone.seconds.back();
+    zone.speedup =
+        parallel_seconds == 0.0 ? 1.0 : serial_seconds / parallel_seconds;
+    zone.serial_fraction =
+        n <= 1.0 ? 1.0 : (1.0 / zone.speedup - 1.0 / n) / (1.0 - 1.0 / n);
+    // Ignore zones too short to matter (or to measure).
+    zone.serial = zone.serial_fraction >= 0.5 && parallel_seconds >= 0.01 * total;
+    zones.push_back(zone);
+  }
+  std::sort(zones.begin(), zones.end(),
+            [](const ScalingZone& a, const ScalingZone& b) {
+              return a.seconds.back() > b.seconds.back();
+            });
+  return zones;
+}
+
+void PrintScalingCSV(const Result& r, const BenchmarkArgs& args,
+                     const std::vector<ScalingZone>& zones) {
+  for (const ScalingZone& zone : zones) {
+    // Semicolon-separated threads=ms.
+    printf("%s,%s,%s,", r.file.c_str(), r.setting.c_str(), zone.name.c_str());
+    for (size_t i = 0; i < zone.seconds.size(); ++i) {
+      printf("%s%zu=%.3f", i == 0 ? "" : ";", args.num_threads[i],
+             zone.seconds[i] * 1E3);
+    }
+    printf(",%.3f,%.3f,%d\n", zone.speedup, zone.serial_fraction,
+           zone.serial ? 1 : 0);
+  }
+}
+
+void PrintScalingJSON(const Result& r, const BenchmarkArgs& args,
+                      const std::vector<ScalingZone>& zones, bool first) {
+  for (const ScalingZone& zone : zones) {
+    printf("%s  {\"file\": \"%s\", \"setting\": \"%s\", \"zone\": \"%s\", "
+           "\"wall_ms\": {",
+           first ? "" : ",\n", r.file.c_str(), r.setting.c_str(),
+           zone.name.c_str());
+    for (size_t i = 0; i < zone.seconds.size(); ++i) {
+      printf("%s\"%zu\": %.3f", i == 0 ? "" : ", ", args.num_threads[i],
+             zone.seconds[i] * 1E3);
+    }
+    printf("}, \"speedup\": %.3f, \"serial_fraction\": %.3f, "
+           "\"serial\": %s}",
+           zone.speedup, zone.serial_fraction, zone.serial ? "true" : "false");
+    first = false;
+  }
+}
+
+// ThreadPool has cache-line aligned members, which plain new (in C++11) does
+// not guarantee for heap allocations, so pools are constructed in storage from
+// CacheAligned::Allocate.
+struct ThreadPoolDeleter {
+  void operator()(ThreadPool* pool) const {
+    pool->~ThreadPool();
+    CacheAligned::Free(pool);
+  }
+};
+
+using ThreadPoolPtr = std::unique_ptr<ThreadPool, ThreadPoolDeleter>;
+
+ThreadPoolPtr MakeThreadPool(const size_t num_threads) {
+  static_assert(alignof(ThreadPool) <= CacheAligned::kAlignment,
+                "ThreadPool alignment exceeds CacheAligned");
+  void* storage = CacheAligned::Allocate(sizeof(ThreadPool));
+  return ThreadPoolPtr(new (storage) ThreadPool(static_cast<int>(num_threads)));
+}
+
+// For --scaling: runs each file and setting with all thread counts, then
+// reports how each profiler zone scales. Zones whose work runs outside
+// ThreadPool::Run show up with a serial fraction near 1.
+int RunScaling(const BenchmarkArgs& args,
+               const std::vector<std::string>& files) {
+  if (args.json) {
+    printf("[\n");
+  } else {
+    printf("file,setting,zone,wall_ms,speedup,serial_fraction,serial\n");
+  }
+
+  std::vector<ThreadPoolPtr> pools;
+  for (const size_t num_threads : args.num_threads) {
+    pools.push_back(MakeThreadPool(num_threads));
+  }
+
+  bool first = true;
+  bool all_ok = true;
+  for (const std::string& file : files) {
+    MetaImageB image;
+    if (!ReadImage(ImageFormatPNG(), file, &image)) {
+      fprintf(stderr, "Failed to read %s.\n", file.c_str());
+      all_ok = false;
+      continue;
+    }
+    for (const Setting& setting : args.settings) {
+      std::vector<Result> results(pools.size());
+      bool ok = true;
+      for (size_t i = 0; i < pools.size(); ++i) {
+        ok &= Run(file, image, setting, pools[i].get(), args, &results[i]);
+      }
+      if (!ok) {
+        all_ok = false;
+        continue;
+      }
+      const std::vector<ScalingZone> zones = AnalyzeScaling(results);
+      if (args.json) {
+        PrintScalingJSON(results.back(), args, zones, first);
+      } else {
+        PrintScalingCSV(results.back(), args, zones);
+      }
+      first = false;
+      fflush(stdout);
+    }
+  }
+
+  if (args.json) printf("\n]\n");
+  return all_ok ? 0 : 1;
+}
+
+int RunBenchmark(int argc, char** argv) {
+  BenchmarkArgs args;
+  if (!args.Init(argc, argv)) {
+    fprintf(stderr, BenchmarkArgs::HelpFormatString(), argv[0]);
+    return 1;
+  }
+
+  const std::vector<std::string> files = ListPNG(args.dir);
+  if (files.empty()) {
+    fprintf(stderr, "No PNG files in %s.\n", args.dir);
+    return 1;
+  }
+  if (args.scaling != 0) return RunScaling(args, files);
+
+  if (args.json) {
+    printf("[\n");
+  } else {
+    PrintCSVHeader(args);
+  }
+
+  bool first = true;
+  bool all_ok = true;
+  for (const size_t num_threads : args.num_threads) {
+    ThreadPool pool(static_cast<int>(num_threads));
+    for (const std::string& file : files) {
+      MetaImageB image;
+      if (!ReadImage(ImageFormatPNG(), file, &image)) {
+        fprintf(stderr, "Failed to read %s.\n", file.c_str());
+        all_ok = false;
+        continue;
+      }
+      for (const Setting& setting : args.settings) {
+        Result result;
+        if (!Run(file, image, setting, &pool, args, &result)) {
+          all_ok = false;
+          continue;
+        }
+        if (args.json) {
+          PrintJSON(result, args, first);
+        } else {
+          PrintCSV(result, args);
+        }
+        first = false;
+        fflush(stdout);
+      }
+    }
+  }
+
+  if (args.json) printf("\n]\n");
+  return all_ok ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace pik
+
+int main(int argc, char** argv) { return pik::RunBenchmark(argc, argv); }
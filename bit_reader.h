@@ -137,6 +137,116 @@ class BitReader {
   size_t bit_pos_;
 };
 
+// Variant of BitReader for the hot entropy decoding loops. Instead of checking
+// whether the buffer needs a refill, FillBitBuffer always ORs in an unaligned
+// 64-bit load and advances by the number of whole bytes that fit, which leaves
+// at least 56 valid bits. This relies on the input being readable beyond its
+// end (e.g. PaddedBytes tail padding or subsequent data); only the last eight
+// readable bytes take a bounds-checked path. Bits beyond "len" are whatever
+// follows in memory (zero past the readable end); valid streams never
+// consume them. Copyable, so that decoding loops can work on a local copy
+// whose state the compiler keeps in registers.
+class PaddedBitReader {
+ public:
+  // data[0, readable) must be readable; readable >= len.
+  PaddedBitReader(const uint8_t* const PIK_RESTRICT data, const size_t len,
+                  const size_t readable)
+      : data_(data), len_(len), readable_(readable) {
+    PIK_ASSERT(len <= readable);
+    FillBitBuffer();
+  }
+
+  void FillBitBuffer() {
+    if (PIK_UNLIKELY(pos_ + 8 > readable_)) {
+      BoundsCheckedRefill();
+      return;
+    }
+    // Assumes little-endian byte order. Bytes already (partially) in buf_
+    // are ORed again with identical values.
+    uint64_t next;
+    memcpy(&next, data_ + pos_, sizeof(next));
+    const size_t bits_in_buf = bits_in_buf_;
+    buf_ |= next << bits_in_buf;
+    pos_ += (63 - bits_in_buf) >> 3;
+    bits_in_buf_ = bits_in_buf | 56;
+  }
+
+  void Advance(size_t num_bits) {
+    PIK_ASSERT(num_bits <= bits_in_buf_);
+    buf_ >>= num_bits;
+    bits_in_buf_ -= num_bits;
+  }
+
+  template <size_t N>
+  int PeekFixedBits() const {
+    static_assert(N <= 32, "At most 32 bits may be read.");
+    PIK_ASSERT(N <= bits_in_buf_);
+    return buf_ & ((1ULL << N) - 1);
+  }
+
+  int PeekBits(size_t nbits) const {
+    PIK_ASSERT(nbits <= 32);
+    PIK_ASSERT(nbits <= bits_in_buf_);
+    return buf_ & ((1ULL << nbits) - 1);
+  }
+
+  int ReadBits(size_t nbits) {
+    FillBitBuffer();
+    const int bits = PeekBits(nbits);
+    Advance(nbits);
+    return bits;
+  }
+
+  template <size_t N>
+  int ReadFixedBits() {
+    FillBitBuffer();
+    const int bits = PeekFixedBits<N>();
+    Advance(N);
+    return bits;
+  }
+
+  void SkipBits(size_t skip) {
+    const size_t pos = BitsRead() + skip;
+    pos_ = pos / 8;
+    buf_ = 0;
+    bits_in_buf_ = 0;
+    FillBitBuffer();
+    Advance(pos % 8);
+  }
+
+  void JumpToByteBoundary() {
+    const size_t rem = BitsRead() % 8;
+    if (rem != 0) ReadBits(8 - rem);
+  }
+
+  size_t BitsRead() const { return 8 * pos_ - bits_in_buf_; }
+
+  // Returns the (rounded up) number of bytes consumed so far.
+  size_t Position() const { return (BitsRead() + 7) / 8; }
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return len_; }
+
+ private:
+  // Loads single bytes; zero once the readable range is exhausted.
+  void BoundsCheckedRefill() {
+    for (; bits_in_buf_ < 56; bits_in_buf_ += 8, ++pos_) {
+      const uint64_t byte = pos_ < readable_ ? data_[pos_] : 0;
+      buf_ |= byte << bits_in_buf_;
+    }
+  }
+
+  const uint8_t* PIK_RESTRICT data_;
+  size_t len_;
+  size_t readable_;
+  // Next bit == buf_ & 1. Bits above bits_in_buf_ are zero or the (not yet
+  // accounted) bits of data_[pos_ ...].
+  uint64_t buf_ = 0;
+  // Index of the next byte not yet accounted for in bits_in_buf_.
+  size_t pos_ = 0;
+  size_t bits_in_buf_ = 0;
+};
+
 }  // namespace pik
 
 #endif  // BIT_READER_H_
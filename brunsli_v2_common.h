@@ -10,6 +10,9 @@ static const uint8_t kBrunsliQuantDataMarker = 0x2a;
 static const uint8_t kBrunsliHistogramDataMarker = 0x32;
 static const uint8_t kBrunsliDCDataMarker = 0x3a;
 static const uint8_t kBrunsliACDataMarker = 0x42;
+// Replaces the DC and AC data sections with independently coded groups of MCU
+// rows, which can be encoded and decoded in parallel.
+static const uint8_t kBrunsliGroupDataMarker = 0x4a;
 
 }  // namespace pik
 
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <set>
@@ -148,7 +149,9 @@ int DecodeNumNonzeros(Prob* const p, BinaryArithmeticDecoder* ac,
   return val - (1 << kMaxBits);
 }
 
-bool DecodeDC(int mcu_cols, int mcu_rows, int num_components,
+// Decodes the DC of MCU rows [mcu_y0, mcu_y1), coded independently of other
+// rows, into the DC coefficients (still prediction residuals).
+bool DecodeDC(int mcu_cols, int mcu_y0, int mcu_y1, int num_components,
               const int h_samp[guetzli::kMaxComponents],
               const int v_samp[guetzli::kMaxComponents],
               const std::vector<uint8_t>& context_map,
@@ -159,7 +162,7 @@ bool DecodeDC(int mcu_cols, int mcu_rows, int num_components,
   int total_num_blocks = 0;
   for (int i = 0; i < num_components; ++i) {
     comps[i].SetWidth(mcu_cols * h_samp[i]);
-    total_num_blocks += mcu_cols * mcu_rows * h_samp[i] * v_samp[i];
+    total_num_blocks += mcu_cols * (mcu_y1 - mcu_y0) * h_samp[i] * v_samp[i];
   }
   block_state->resize(total_num_blocks);
 
@@ -178,7 +181,7 @@ bool DecodeDC(int mcu_cols, int mcu_rows, int num_components,
   // E.g. in a YUV420 image, we decode 2 rows of DC components from Y and then
   // 1 row of DC components from U and 1 row of DC components from V.
   int block_ipos = 0;
-  for (int mcu_y = 0; mcu_y < mcu_rows; ++mcu_y) {
+  for (int mcu_y = mcu_y0; mcu_y < mcu_y1; ++mcu_y) {
     for (int i = 0; i < num_components; ++i) {
       ComponentStateDC* const c = &comps[i];
       const uint8_t* const cur_context_map = &context_map[i * kNumAvrgContexts];
@@ -243,14 +246,17 @@ bool DecodeDC(int mcu_cols, int mcu_rows, int num_components,
   return true;
 }
 
-bool DecodeAC(const int mcu_cols, const int mcu_rows, const int num_components,
+// Decodes the AC of MCU rows [mcu_y0, mcu_y1); contexts treat mcu_y0 as the
+// top of the image. "block_state" is from DecodeDC of the same rows.
+bool DecodeAC(const int mcu_cols, const int mcu_y0, const int mcu_y1,
+              const int num_components,
               const int h_samp[guetzli::kMaxComponents],
               const int v_samp[guetzli::kMaxComponents],
               const int all_quant[guetzli::kMaxComponents][kDCTBlockSize],
-              const std::vector<int> context_bits,
+              const std::vector<int>& context_bits,
               const std::vector<uint8_t>& context_map,
               const std::vector<ANSDecodingData>& entropy_codes,
-              const std::vector<bool> block_state,
+              const std::vector<bool>& block_state,
               coeff_t* all_coeffs[guetzli::kMaxComponents],
               BrunsliV2Input* in) {
   int num_contexts = num_components;
@@ -276,14 +282,15 @@ bool DecodeAC(const int mcu_cols, const int mcu_rows, const int num_components,
   }
 
   int block_ipos = 0;
-  for (int mcu_y = 0; mcu_y < mcu_rows; ++mcu_y) {
+  for (int mcu_y = mcu_y0; mcu_y < mcu_y1; ++mcu_y) {
     for (int i = 0; i < num_components; ++i) {
       ComponentState* const c = &comps[i];
       const uint8_t* const cur_context_map = &context_map[c->context_offset];
       const int cur_ctx_bits = context_bits[i];
       const int width = c->width;
-      int y = mcu_y * v_samp[i];
-      int block_ix = y * width;
+      int block_ix = mcu_y * v_samp[i] * width;
+      // Relative to the group, for contexts.
+      int y = (mcu_y - mcu_y0) * v_samp[i];
       coeff_t* coeffs = &all_coeffs[i][block_ix * kDCTBlockSize];
       const coeff_t* prev_row_coeffs =
           &all_coeffs[i][(block_ix - width) * kDCTBlockSize];
@@ -592,6 +599,25 @@ void UnpredictDCWithY(const coeff_t* const PIK_RESTRICT coeffs_y,
   }
 }
 
+// Adds the DC predictions to the decoded residuals of all components.
+void UnpredictAllDC(guetzli::JPEGData* jpg) {
+  const bool use_uv_prediction = jpg->components.size() == 3 &&
+                                 jpg->max_h_samp_factor == 1 &&
+                                 jpg->max_v_samp_factor == 1;
+  guetzli::JPEGComponent* c0 = &jpg->components[0];
+  UnpredictDC(&c0->coeffs[0], c0->width_in_blocks, c0->height_in_blocks);
+  if (use_uv_prediction) {
+    UnpredictDCWithY(&c0->coeffs[0], &jpg->components[1].coeffs[0],
+                     &jpg->components[2].coeffs[0], c0->width_in_blocks,
+                     c0->height_in_blocks);
+  } else {
+    for (int i = 1; i < jpg->components.size(); ++i) {
+      guetzli::JPEGComponent* c = &jpg->components[i];
+      UnpredictDC(&c->coeffs[0], c->width_in_blocks, c->height_in_blocks);
+    }
+  }
+}
+
 bool DecodeDCDataSection(const uint8_t* data, const size_t len,
                          JPEGDecodingState* s, guetzli::JPEGData* jpg) {
   if (jpg->width == 0 || jpg->height == 0 || jpg->MCU_rows == 0 ||
@@ -613,30 +639,17 @@ bool DecodeDCDataSection(const uint8_t* data, const size_t len,
     v_samp[i] = c->v_samp_factor;
   }
   BrunsliV2Input in(data, len);
-  if (!DecodeDC(jpg->MCU_cols, jpg->MCU_rows, jpg->components.size(), h_samp,
-                v_samp, s->context_map, s->entropy_codes, coeffs,
+  if (!DecodeDC(jpg->MCU_cols, 0, jpg->MCU_rows, jpg->components.size(),
+                h_samp, v_samp, s->context_map, s->entropy_codes, coeffs,
                 &s->block_state, &in)) {
     return false;
   }
-  // Unpredict
-  const bool use_uv_prediction = jpg->components.size() == 3 &&
-                                 jpg->max_h_samp_factor == 1 &&
-                                 jpg->max_v_samp_factor == 1;
-  guetzli::JPEGComponent* c0 = &jpg->components[0];
-  UnpredictDC(&c0->coeffs[0], c0->width_in_blocks, c0->height_in_blocks);
-  if (use_uv_prediction) {
-    UnpredictDCWithY(&c0->coeffs[0], &jpg->components[1].coeffs[0],
-                     &jpg->components[2].coeffs[0], c0->width_in_blocks,
-                     c0->height_in_blocks);
-  } else {
-    for (int i = 1; i < jpg->components.size(); ++i) {
-      guetzli::JPEGComponent* c = &jpg->components[i];
-      UnpredictDC(&c->coeffs[0], c->width_in_blocks, c->height_in_blocks);
-    }
-  }
+  UnpredictAllDC(jpg);
   return true;
 }
 
+
+
 bool DecodeACDataSection(const uint8_t* data, const size_t len,
                          JPEGDecodingState* s, guetzli::JPEGData* jpg) {
   if (jpg->width == 0 || jpg->height == 0 || jpg->MCU_rows == 0 ||
@@ -669,16 +682,103 @@ bool DecodeACDataSection(const uint8_t* data, const size_t len,
     v_samp[i] = c->v_samp_factor;
   }
   BrunsliV2Input in(data, len);
-  if (!DecodeAC(jpg->MCU_cols, jpg->MCU_rows, jpg->components.size(), h_samp,
-                v_samp, quant, s->context_bits, s->context_map,
+  if (!DecodeAC(jpg->MCU_cols, 0, jpg->MCU_rows, jpg->components.size(),
+                h_samp, v_samp, quant, s->context_bits, s->context_map,
                 s->entropy_codes, s->block_state, coeffs, &in)) {
     return false;
   }
   return true;
 }
 
+bool DecodeGroupDataSection(const uint8_t* data, const size_t len,
+                            ThreadPool* pool, JPEGDecodingState* s,
+                            guetzli::JPEGData* jpg) {
+  if (jpg->width == 0 || jpg->height == 0 || jpg->MCU_rows == 0 ||
+      jpg->MCU_cols == 0 || jpg->components.empty() || jpg->quant.empty() ||
+      s->context_map.empty()) {
+    // See DecodeDCDataSection.
+    return false;
+  }
+  coeff_t* coeffs[guetzli::kMaxComponents] = {nullptr};
+  int quant[guetzli::kMaxComponents][kDCTBlockSize];
+  int h_samp[guetzli::kMaxComponents] = {0};
+  int v_samp[guetzli::kMaxComponents] = {0};
+  for (int i = 0; i < jpg->components.size(); ++i) {
+    guetzli::JPEGComponent* c = &jpg->components[i];
+    if (c->quant_idx >= jpg->quant.size()) {
+      return false;
+    }
+    const guetzli::JPEGQuantTable& q = jpg->quant[c->quant_idx];
+    coeffs[i] = &c->coeffs[0];
+    memcpy(&quant[i][0], &q.values[0], kDCTBlockSize * sizeof(quant[0][0]));
+    for (int k = 0; k < kDCTBlockSize; ++k) {
+      if (quant[i][k] == 0) {
+        return false;
+      }
+    }
+    h_samp[i] = c->h_samp_factor;
+    v_samp[i] = c->v_samp_factor;
+  }
+
+  size_t pos = 0;
+  size_t mcu_rows_per_group;
+  if (!DecodeBase128(data, len, &pos, &mcu_rows_per_group) ||
+      mcu_rows_per_group == 0) {
+    return false;
+  }
+  const int num_groups = DivCeil<size_t>(jpg->MCU_rows, mcu_rows_per_group);
+  std::vector<size_t> dc_sizes(num_groups);
+  std::vector<size_t> ac_sizes(num_groups);
+  for (int i = 0; i < num_groups; ++i) {
+    if (!DecodeBase128(data, len, &pos, &dc_sizes[i]) ||
+        !DecodeBase128(data, len, &pos, &ac_sizes[i])) {
+      return false;
+    }
+  }
+  // Start of each group's DC stream; its AC stream follows.
+  std::vector<size_t> offsets(num_groups);
+  for (int i = 0; i < num_groups; ++i) {
+    if (dc_sizes[i] > len - pos || ac_sizes[i] > len - pos - dc_sizes[i]) {
+      return false;
+    }
+    offsets[i] = pos;
+    pos += dc_sizes[i] + ac_sizes[i];
+  }
+
+  std::atomic<bool> ok{true};
+  pool->Run(0, num_groups, [&](const int task, const int thread) {
+    const int mcu_y0 = task * mcu_rows_per_group;
+    const int mcu_y1 = std::min<int>(jpg->MCU_rows, mcu_y0 + mcu_rows_per_group);
+    std::vector<bool> block_state;
+    BrunsliV2Input in_dc(data + offsets[task], dc_sizes[task]);
+    if (!DecodeDC(jpg->MCU_cols, mcu_y0, mcu_y1, jpg->components.size(),
+                  h_samp, v_samp, s->context_map, s->entropy_codes, coeffs,
+                  &block_state, &in_dc)) {
+      ok.store(false);
+      return;
+    }
+    BrunsliV2Input in_ac(data + offsets[task] + dc_sizes[task],
+                         ac_sizes[task]);
+    if (!DecodeAC(jpg->MCU_cols, mcu_y0, mcu_y1, jpg->components.size(),
+                  h_samp, v_samp, quant, s->context_bits, s->context_map,
+                  s->entropy_codes, block_state, coeffs, &in_ac)) {
+      ok.store(false);
+    }
+  });
+  if (!ok.load()) return false;
+
+  UnpredictAllDC(jpg);
+  return true;
+}
+
+bool BrunsliV2DecodeHeader(const uint8_t* data, const size_t len,
+                           guetzli::JPEGData* jpg) {
+  size_t pos = 0;
+  return DecodeHeader(data, len, &pos, jpg);
+}
+
 bool BrunsliV2DecodeJpegData(const uint8_t* data, const size_t len,
-                             guetzli::JPEGData* jpg) {
+                             ThreadPool* pool, guetzli::JPEGData* jpg) {
   size_t pos = 0;
 
   if (!DecodeHeader(data, len, &pos, jpg)) return false;
@@ -691,6 +791,7 @@ bool BrunsliV2DecodeJpegData(const uint8_t* data, const size_t len,
   JPEGDecodingState s;
   bool have_quant_section = false;
   bool have_dc_section = false;
+  bool have_group_section = false;
   while (pos < len) {
     uint8_t marker = data[pos++];
     // There are 15 valid marker bytes for compatibility with the protocol
@@ -720,7 +821,7 @@ bool BrunsliV2DecodeJpegData(const uint8_t* data, const size_t len,
         ok = DecodeHistogramDataSection(&data[pos], marker_len, &s, jpg);
         break;
       case kBrunsliDCDataMarker:
-        ok = have_quant_section &&
+        ok = have_quant_section && !have_group_section &&
              DecodeDCDataSection(&data[pos], marker_len, &s, jpg);
         have_dc_section = ok;
         break;
@@ -728,6 +829,11 @@ bool BrunsliV2DecodeJpegData(const uint8_t* data, const size_t len,
         ok = have_dc_section &&
              DecodeACDataSection(&data[pos], marker_len, &s, jpg);
         break;
+      case kBrunsliGroupDataMarker:
+        ok = have_quant_section && !have_dc_section &&
+             DecodeGroupDataSection(&data[pos], marker_len, pool, &s, jpg);
+        have_group_section = ok;
+        break;
       default:
         // We skip unrecognized marker segments.
         ok = true;
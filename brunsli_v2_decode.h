@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <cstddef>
 
+#include "data_parallel.h"
 #include "guetzli/jpeg_data.h"
 #include "status.h"
 
@@ -13,9 +14,15 @@ namespace pik {
 // *jpg with the parsed information.
 // The *jpg object is valid only as long as the input data is valid.
 // Returns true, unless the data is not valid brunsli v2 byte stream, or is
-// truncated.
+// truncated. Independently coded groups of MCU rows are decoded on "pool".
 bool BrunsliV2DecodeJpegData(const uint8_t* data, const size_t len,
-                             guetzli::JPEGData* jpg);
+                             ThreadPool* pool, guetzli::JPEGData* jpg);
+
+// Parses only the brunsli v2 header at the start of data[0 ... len) and sets
+// jpg->width, height, version and (unless version 1) the number of components.
+// Returns false if the header is invalid or truncated.
+bool BrunsliV2DecodeHeader(const uint8_t* data, const size_t len,
+                           guetzli::JPEGData* jpg);
 
 }  // namespace pik
 
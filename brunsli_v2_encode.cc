@@ -15,6 +15,7 @@
 #include "ans_params.h"
 #include "brunsli_v2_common.h"
 #include "cluster.h"
+#include "common.h"
 #include "context.h"
 #include "context_map_encode.h"
 #include "data_stream.h"
@@ -23,6 +24,7 @@
 #include "entropy_source.h"
 #include "fast_log.h"
 #include "guetzli/jpeg_data.h"
+#include "guetzli/jpeg_data_reader.h"
 #include "guetzli/jpeg_error.h"
 #include "jpeg_quant_tables.h"
 #include "lehmer_code.h"
@@ -144,22 +146,33 @@ int SelectContextBits(size_t num_symbols) {
   return kContextBits[log2_size];
 }
 
-void ComputeCoeffOrder(const coeff_t* coeffs, const int num_blocks, int* order,
-                       size_t* approx_total_nonzeros) {
-  // For faster compression we only go over a sample of the blocks here. We skip
-  // this many blocks after each sampled one.
-  static const int kSkipBlocks = 4;
-  static const int kSkipCoeffs = kSkipBlocks * kDCTBlockSize;
-  int num_zeros[kDCTBlockSize] = { 0 };
-  if (num_blocks >= 1024) {
-    for (int i = 0; i < num_blocks; ++i) {
-      for (int k = 0; k < kDCTBlockSize; ++k) {
-        if (*coeffs++ == 0) ++num_zeros[k];
-      }
-      i += kSkipBlocks;
-      coeffs += kSkipCoeffs;
+// For faster compression we only go over a sample of the blocks when computing
+// the coefficient order. We skip this many blocks after each sampled one.
+static const int kSkipBlocks = 4;
+// Components with fewer blocks use the natural order.
+static const int kMinBlocksForCoeffOrder = 1024;
+
+// Adds the number of zeros at each position of the sampled blocks among blocks
+// [block_begin, block_begin + num_blocks) of a component to num_zeros, where
+// "coeffs" points to block block_begin. Visiting a component in consecutive
+// ranges gives the same counts as visiting it at once.
+void CountSampledZeros(const coeff_t* coeffs, const int block_begin,
+                       const int num_blocks, int num_zeros[kDCTBlockSize]) {
+  static const int kStep = kSkipBlocks + 1;
+  for (int i = (kStep - block_begin % kStep) % kStep; i < num_blocks;
+       i += kStep) {
+    const coeff_t* block = coeffs + i * kDCTBlockSize;
+    for (int k = 0; k < kDCTBlockSize; ++k) {
+      if (block[k] == 0) ++num_zeros[k];
     }
   }
+}
+
+void ComputeCoeffOrder(const int sampled_zeros[kDCTBlockSize],
+                       const int num_blocks, int* order,
+                       size_t* approx_total_nonzeros) {
+  int num_zeros[kDCTBlockSize];
+  memcpy(num_zeros, sampled_zeros, sizeof(num_zeros));
   size_t total_zeros = num_zeros[0];
   num_zeros[0] = 0;  // DC coefficient is always the first one.
   std::vector<std::pair<int, int> > pos_and_val(kDCTBlockSize);
@@ -179,15 +192,28 @@ void ComputeCoeffOrder(const coeff_t* coeffs, const int num_blocks, int* order,
                              ((kSkipBlocks + 1) * total_zeros));
 }
 
-struct JPEGCodingState {
-  JPEGCodingState() : entropy_source(kNumAvrgContexts),
-                      data_stream_dc(kNumAvrgContexts),
-                      data_stream_ac(kNumAvrgContexts) {}
-  EntropySource entropy_source;
+// Symbols of one group of MCU rows. Each group has its own DC and AC streams
+// (with separate arithmetic coder and ANS states), but all groups share the
+// entropy codes built from the sum of their histograms.
+struct GroupCodingState {
+  GroupCodingState() : entropy_source(kNumAvrgContexts),
+                       data_stream_dc(kNumAvrgContexts),
+                       data_stream_ac(kNumAvrgContexts) {}
+  EntropySource entropy_source;  // Histograms of this group only.
   DataStream data_stream_dc;
   DataStream data_stream_ac;
-  std::vector<bool> block_state;
+  std::vector<uint8_t> dc_code;
+  std::vector<uint8_t> ac_code;
+};
+
+struct JPEGCodingState {
+  JPEGCodingState() : entropy_source(kNumAvrgContexts) {}
+  EntropySource entropy_source;
   std::vector<int> context_bits;
+  // The DC and AC sections are used if there is only one group.
+  int mcu_rows_per_group = 0;
+  std::vector<GroupCodingState> groups;
+  ThreadPool* pool = nullptr;
 };
 
 void EncodeNumNonzeros(int val, Prob* p, DataStream* data_stream) {
@@ -209,8 +235,10 @@ coeff_t CollectAllCoeffs(const coeff_t coeffs[kDCTBlockSize]) {
   return all_coeffs;
 }
 
+// Encodes the DC of num_mcu_rows MCU rows independently of other rows. The
+// pointers are to the first block row of each component.
 void EncodeDC(const int mcu_cols,
-              const int mcu_rows,
+              const int num_mcu_rows,
               const int num_components,
               const int h_samp[guetzli::kMaxComponents],
               const int v_samp[guetzli::kMaxComponents],
@@ -223,9 +251,8 @@ void EncodeDC(const int mcu_cols,
   int total_num_blocks = 0;
   for (int i = 0; i < num_components; ++i) {
     comps[i].SetWidth(mcu_cols * h_samp[i]);
-    total_num_blocks += mcu_cols * mcu_rows * h_samp[i] * v_samp[i];
+    total_num_blocks += mcu_cols * num_mcu_rows * h_samp[i] * v_samp[i];
   }
-  entropy_source->Resize(num_components);
   data_stream->Resize(3 * total_num_blocks + 128);
   block_state->resize(total_num_blocks);
 
@@ -241,7 +268,7 @@ void EncodeDC(const int mcu_cols,
   // In the terminology of the JPEG standard, we encode one row of MCUs at a
   // time, but within this MCU row, we encode the components non-interleaved.
   int block_ipos = 0;
-  for (int mcu_y = 0; mcu_y < mcu_rows; ++mcu_y) {
+  for (int mcu_y = 0; mcu_y < num_mcu_rows; ++mcu_y) {
     for (int i = 0; i < num_components; ++i) {
       ComponentStateDC* c = &comps[i];
       const int width = c->width;
@@ -342,45 +369,66 @@ void EncodeCoeffOrder(const int* order, DataStream* data_stream) {
   }
 }
 
-void EncodeAC(const int mcu_cols,
+// Computes the coefficient orders, context bits and AC prediction multipliers,
+// which are shared by all groups. Returns the number of histogram contexts.
+int PrepareAC(const int mcu_cols,
               const int mcu_rows,
               const int num_components,
               const int h_samp[guetzli::kMaxComponents],
               const int v_samp[guetzli::kMaxComponents],
-              const coeff_t* all_coeffs_in[guetzli::kMaxComponents],
+              const int num_zeros[guetzli::kMaxComponents][kDCTBlockSize],
               const int all_quant[guetzli::kMaxComponents][kDCTBlockSize],
-              const std::vector<bool>& block_state,
               std::vector<int>* context_bits,
-              EntropySource* entropy_source,
-              DataStream* data_stream) {
-  int num_code_words = 0;
+              std::vector<int>* context_offsets,
+              std::vector<ComponentState>* comps,
+              size_t* approx_total_nonzeros) {
   int num_contexts = num_components;
-  int total_num_blocks = 0;
-  std::vector<ComponentState> comps(num_components);
-  std::vector<int> context_offsets(1 + num_components);
+  comps->resize(num_components);
+  context_offsets->resize(1 + num_components);
   context_bits->resize(num_components);
+  *approx_total_nonzeros = 0;
   for (int i = 0; i < num_components; ++i) {
     const int num_blocks = mcu_cols * mcu_rows * h_samp[i] * v_samp[i];
-    size_t approx_total_nonzeros = 0;
-    ComputeCoeffOrder(all_coeffs_in[i], num_blocks, &comps[i].order[0],
-                      &approx_total_nonzeros);
+    size_t approx_nonzeros = 0;
+    ComputeCoeffOrder(num_zeros[i], num_blocks, &(*comps)[i].order[0],
+                      &approx_nonzeros);
 
-    (*context_bits)[i] = SelectContextBits(approx_total_nonzeros + 1);
-    comps[i].context_offset = num_contexts;
-    context_offsets[i + 1] = num_contexts;
+    (*context_bits)[i] = SelectContextBits(approx_nonzeros + 1);
+    (*comps)[i].context_offset = num_contexts;
+    (*context_offsets)[i + 1] = num_contexts;
     num_contexts += kNumNonzeroContextSkip[(*context_bits)[i]];
 
     ComputeACPredictMultipliers(&all_quant[i][0],
-                                &comps[i].mult_row[0],
-                                &comps[i].mult_col[0]);
+                                &(*comps)[i].mult_row[0],
+                                &(*comps)[i].mult_col[0]);
 
-    comps[i].SetWidth(mcu_cols * h_samp[i]);
-    num_code_words += 2 * approx_total_nonzeros + 1024 + 3 * num_blocks;
-    total_num_blocks += num_blocks;
+    (*comps)[i].SetWidth(mcu_cols * h_samp[i]);
+    *approx_total_nonzeros += approx_nonzeros;
   }
+  return num_contexts;
+}
 
-  entropy_source->Resize(num_contexts);
-  data_stream->Resize(num_code_words);
+// Encodes the AC of num_mcu_rows MCU rows independently of other rows: contexts
+// treat the first of them as the top of the image. The pointers are to the
+// first block row of each component, and "comps" are from PrepareAC.
+void EncodeAC(const int mcu_cols,
+              const int num_mcu_rows,
+              const int num_components,
+              const int h_samp[guetzli::kMaxComponents],
+              const int v_samp[guetzli::kMaxComponents],
+              const coeff_t* all_coeffs_in[guetzli::kMaxComponents],
+              const std::vector<int>& context_bits,
+              std::vector<ComponentState> comps,
+              const size_t approx_nonzeros,
+              const std::vector<bool>& block_state,
+              EntropySource* entropy_source,
+              DataStream* data_stream) {
+  int num_blocks = 0;
+  for (int i = 0; i < num_components; ++i) {
+    num_blocks += mcu_cols * num_mcu_rows * h_samp[i] * v_samp[i];
+  }
+  data_stream->Resize(2 * approx_nonzeros + 1024 * num_components +
+                      3 * num_blocks);
 
   for (int i = 0; i < num_components; ++i) {
     EncodeCoeffOrder(&comps[i].order[0], data_stream);
@@ -398,10 +446,10 @@ void EncodeAC(const int mcu_cols,
   // In the terminology of the JPEG standard, we encode one row of MCUs at a
   // time, but within this MCU row, we encode the components non-interleaved.
   int block_ipos = 0;
-  for (int mcu_y = 0; mcu_y < mcu_rows; ++mcu_y) {
+  for (int mcu_y = 0; mcu_y < num_mcu_rows; ++mcu_y) {
     for (int i = 0; i < num_components; ++i) {
       ComponentState* const c = &comps[i];
-      const int cur_ctx_bits = (*context_bits)[i];
+      const int cur_ctx_bits = context_bits[i];
       const int* cur_order = c->order;
       const int width = c->width;
       int y = mcu_y * v_samp[i];
@@ -520,7 +568,97 @@ void EncodeAC(const int mcu_cols,
       }
     }
   }
-  entropy_source->ClusterHistograms(context_offsets);
+}
+
+// The maximum absolute value brunsli can encode is 2054 (8 values for direct
+// codes and num bits from 1 to 10, so a total of 8 + 2 + 4 + ... + 1024).
+static const int kBrunsliMaxDCAbsVal = 2054;
+
+bool UseUVPrediction(const guetzli::JPEGData& jpg) {
+  return jpg.components.size() == 3 && jpg.max_h_samp_factor == 1 &&
+         jpg.max_v_samp_factor == 1;
+}
+
+// Computes the DC prediction errors of block rows [y0, y1) of a component that
+// is "width" blocks wide. "dc" points to the DC of block (0, y0); the DCs of
+// horizontally adjacent blocks are col_stride apart, and the two block rows
+// above y0 must be accessible. "dc_y" is the same for the first component and
+// is only used for UV prediction.
+// Returns false if an error is too large for brunsli.
+bool ComputeDCPredictionErrors(const coeff_t* dc, const coeff_t* dc_y,
+                               const intptr_t col_stride, const int width,
+                               const int y0, const int y1,
+                               const bool use_uv_predictor,
+                               coeff_t* pred_errors) {
+  const intptr_t row_stride = width * col_stride;
+  for (int y = y0; y < y1; ++y) {
+    const intptr_t row_offset = (y - y0) * row_stride;
+    for (int x = 0; x < width; ++x) {
+      const intptr_t offset = row_offset + x * col_stride;
+      int predictor = 0;
+      if (use_uv_predictor) {
+        predictor = GetUVPredictor(dc_y + offset, x, y, width, -col_stride,
+                                   -row_stride);
+      }
+      const coeff_t prediction =
+          MinCostPredict(dc + offset, x, y, width, -col_stride, -row_stride,
+                         use_uv_predictor, predictor);
+      int err = dc[offset] - prediction;
+      if (std::abs(err) > kBrunsliMaxDCAbsVal) {
+        return false;
+      }
+      *pred_errors++ = err;
+    }
+  }
+  return true;
+}
+
+bool GetComponentParams(const guetzli::JPEGData& jpg,
+                        int h_samp[guetzli::kMaxComponents],
+                        int v_samp[guetzli::kMaxComponents],
+                        int quant[guetzli::kMaxComponents][kDCTBlockSize]) {
+  for (int i = 0; i < jpg.components.size(); ++i) {
+    const guetzli::JPEGComponent& c = jpg.components[i];
+    if (c.quant_idx >= jpg.quant.size()) {
+      return false;
+    }
+    const guetzli::JPEGQuantTable& q = jpg.quant[c.quant_idx];
+    memcpy(&quant[i][0], &q.values[0], kDCTBlockSize * sizeof(quant[0][0]));
+    h_samp[i] = c.h_samp_factor;
+    v_samp[i] = c.v_samp_factor;
+  }
+  return true;
+}
+
+int McuRowsPerGroup(const guetzli::JPEGData& jpg) {
+  // Groups of MCU rows roughly as tall as a group of the default bitstream.
+  const int mcu_rows_per_group =
+      DivCeil<int>(kGroupHeightInBlocks, jpg.max_v_samp_factor);
+  return std::max(1, std::min(jpg.MCU_rows, mcu_rows_per_group));
+}
+
+// Encodes MCU rows [mcu_y0, mcu_y1) into "group". The pointers are to the
+// first block row of each component.
+void EncodeGroup(const int mcu_cols, const int mcu_rows, const int mcu_y0,
+                 const int mcu_y1, const int num_components,
+                 const int h_samp[guetzli::kMaxComponents],
+                 const int v_samp[guetzli::kMaxComponents],
+                 const coeff_t* dc_pred_errors[guetzli::kMaxComponents],
+                 const coeff_t* ac_coeffs[guetzli::kMaxComponents],
+                 const std::vector<int>& context_bits,
+                 const std::vector<ComponentState>& ac_comps,
+                 const size_t approx_total_nonzeros,
+                 EntropySource* entropy_source, DataStream* data_stream_dc,
+                 DataStream* data_stream_ac) {
+  std::vector<bool> block_state;
+  EncodeDC(mcu_cols, mcu_y1 - mcu_y0, num_components, h_samp, v_samp,
+           dc_pred_errors, ac_coeffs, &block_state, entropy_source,
+           data_stream_dc);
+  const size_t approx_nonzeros =
+      approx_total_nonzeros * (mcu_y1 - mcu_y0) / std::max(1, mcu_rows);
+  EncodeAC(mcu_cols, mcu_y1 - mcu_y0, num_components, h_samp, v_samp,
+           ac_coeffs, context_bits, ac_comps, approx_nonzeros, block_state,
+           entropy_source, data_stream_ac);
 }
 
 bool ProcessCoefficients(const guetzli::JPEGData& jpg,
@@ -530,68 +668,173 @@ bool ProcessCoefficients(const guetzli::JPEGData& jpg,
   int quant[guetzli::kMaxComponents][kDCTBlockSize];
   int h_samp[guetzli::kMaxComponents] = { 0 };
   int v_samp[guetzli::kMaxComponents] = { 0 };
+  int num_zeros[guetzli::kMaxComponents][kDCTBlockSize] = { { 0 } };
   std::vector<std::vector<coeff_t> > dc_errors(jpg.components.size());
+  if (!GetComponentParams(jpg, h_samp, v_samp, quant)) {
+    return false;
+  }
 
-  // The maximum absolute value brunsli can encode is 2054 (8 values for direct
-  // codes and num bits from 1 to 10, so a total of 8 + 2 + 4 + ... + 1024).
-  static const int kBrunsliMaxDCAbsVal = 2054;
-
-  const bool use_uv_prediction =
-      jpg.components.size() == 3 && jpg.max_h_samp_factor == 1 &&
-      jpg.max_v_samp_factor == 1;
+  const bool use_uv_prediction = UseUVPrediction(jpg);
 
   for (int i = 0; i < jpg.components.size(); ++i) {
     const guetzli::JPEGComponent& c = jpg.components[i];
     const guetzli::JPEGComponent& c0 = jpg.components[0];
-    if (c.quant_idx >= jpg.quant.size()) {
-      return false;
-    }
-    const guetzli::JPEGQuantTable& q = jpg.quant[c.quant_idx];
     const int width = c.width_in_blocks;
     const int height = c.height_in_blocks;
-    const bool use_uv_predictor = i > 0 && use_uv_prediction;
-    const coeff_t* coeffs = &c.coeffs[0];
-    const coeff_t* coeffs_y = &c0.coeffs[0];
     dc_errors[i].resize(width * height);
-    coeff_t* pred_errors = &dc_errors[i][0];
-    for (int y = 0; y < height; ++y) {
-      for (int x = 0; x < width; ++x) {
-        int predictor = 0;
-        if (use_uv_predictor) {
-          predictor = GetUVPredictor(coeffs_y, x, y, width, -kDCTBlockSize,
-                                     -width * kDCTBlockSize);
-        }
-        const coeff_t prediction =
-            MinCostPredict(coeffs, x, y, width, -kDCTBlockSize,
-                           -width * kDCTBlockSize, use_uv_predictor, predictor);
-        int err = coeffs[0] - prediction;
-        if (std::abs(err) > kBrunsliMaxDCAbsVal) {
-          return false;
-        }
-        coeffs += kDCTBlockSize;
-        coeffs_y += kDCTBlockSize;
-        *pred_errors++ = err;
-      }
+    if (!ComputeDCPredictionErrors(&c.coeffs[0], &c0.coeffs[0], kDCTBlockSize,
+                                   width, 0, height,
+                                   i > 0 && use_uv_prediction,
+                                   &dc_errors[i][0])) {
+      return false;
+    }
+    if (width * height >= kMinBlocksForCoeffOrder) {
+      CountSampledZeros(&c.coeffs[0], 0, width * height, num_zeros[i]);
     }
 
     dc_pred_errors[i] = &dc_errors[i][0];
     ac_coeffs[i] = &c.coeffs[0];
-    memcpy(&quant[i][0], &q.values[0], kDCTBlockSize * sizeof(quant[0][0]));
-    h_samp[i] = c.h_samp_factor;
-    v_samp[i] = c.v_samp_factor;
   }
 
-  EncodeDC(jpg.MCU_cols, jpg.MCU_rows, jpg.components.size(), h_samp, v_samp,
-           dc_pred_errors, ac_coeffs, &s->block_state, &s->entropy_source,
-           &s->data_stream_dc);
+  const int num_components = jpg.components.size();
+  std::vector<int> context_offsets;
+  std::vector<ComponentState> ac_comps;
+  size_t approx_total_nonzeros;
+  const int num_contexts =
+      PrepareAC(jpg.MCU_cols, jpg.MCU_rows, num_components, h_samp, v_samp,
+                num_zeros, quant, &s->context_bits, &context_offsets,
+                &ac_comps, &approx_total_nonzeros);
+
+  s->mcu_rows_per_group = McuRowsPerGroup(jpg);
+  const int num_groups =
+      std::max(1, DivCeil(jpg.MCU_rows, s->mcu_rows_per_group));
+  s->groups.resize(num_groups);
+  s->pool->Run(0, num_groups, [&](const int task, const int thread) {
+    GroupCodingState* group = &s->groups[task];
+    const int mcu_y0 = task * s->mcu_rows_per_group;
+    const int mcu_y1 = std::min(jpg.MCU_rows, mcu_y0 + s->mcu_rows_per_group);
+    const coeff_t* group_dc_pred_errors[guetzli::kMaxComponents];
+    const coeff_t* group_ac_coeffs[guetzli::kMaxComponents];
+    for (int i = 0; i < num_components; ++i) {
+      const size_t block_ix =
+          static_cast<size_t>(mcu_y0) * v_samp[i] * jpg.MCU_cols * h_samp[i];
+      group_dc_pred_errors[i] = dc_pred_errors[i] + block_ix;
+      group_ac_coeffs[i] = ac_coeffs[i] + block_ix * kDCTBlockSize;
+    }
+    group->entropy_source.Resize(num_contexts);
+    EncodeGroup(jpg.MCU_cols, jpg.MCU_rows, mcu_y0, mcu_y1, num_components,
+                h_samp, v_samp, group_dc_pred_errors, group_ac_coeffs,
+                s->context_bits, ac_comps, approx_total_nonzeros,
+                &group->entropy_source, &group->data_stream_dc,
+                &group->data_stream_ac);
+  });
+
+  s->entropy_source.Resize(num_contexts);
+  for (const GroupCodingState& group : s->groups) {
+    s->entropy_source.AddHistograms(group.entropy_source);
+  }
+  s->entropy_source.ClusterHistograms(context_offsets);
+  return true;
+}
+
+// State of BrunsliV2EncodeJpegBands, which reads the JPEG twice in bands of
+// one group: first to compute the coefficient orders and context bits from
+// the zero counts, then to encode each group.
+struct BandCodingState {
+  explicit BandCodingState(JPEGCodingState* s) : s(s) {}
+
+  JPEGCodingState* s;
+  bool counting_zeros = true;
+  int num_zeros[guetzli::kMaxComponents][kDCTBlockSize] = { { 0 } };
 
-  EncodeAC(jpg.MCU_cols, jpg.MCU_rows, jpg.components.size(), h_samp, v_samp,
-           ac_coeffs, quant, s->block_state, &s->context_bits,
-           &s->entropy_source, &s->data_stream_ac);
+  // Set before encoding the groups.
+  int quant[guetzli::kMaxComponents][kDCTBlockSize];
+  int h_samp[guetzli::kMaxComponents] = { 0 };
+  int v_samp[guetzli::kMaxComponents] = { 0 };
+  std::vector<int> context_offsets;
+  std::vector<ComponentState> ac_comps;
+  size_t approx_total_nonzeros = 0;
+  int num_groups_done = 0;
+  // Per component: the DC of the two block rows above the band, then those
+  // of the band, for DC prediction.
+  std::vector<std::vector<coeff_t> > dc;
+  std::vector<std::vector<coeff_t> > dc_errors;
+  int prev_band_mcu_rows = 0;
+};
 
+bool CountBandZeros(BandCodingState* b, const guetzli::JPEGData& jpg,
+                    const int mcu_y0, const int mcu_y1) {
+  for (int i = 0; i < jpg.components.size(); ++i) {
+    const guetzli::JPEGComponent& c = jpg.components[i];
+    if (c.num_blocks < kMinBlocksForCoeffOrder) continue;
+    const int width = c.width_in_blocks;
+    CountSampledZeros(&c.coeffs[0], mcu_y0 * c.v_samp_factor * width,
+                      (mcu_y1 - mcu_y0) * c.v_samp_factor * width,
+                      b->num_zeros[i]);
+  }
+  return true;
+}
+
+bool EncodeBand(BandCodingState* b, const guetzli::JPEGData& jpg,
+                const int mcu_y0, const int mcu_y1) {
+  JPEGCodingState* s = b->s;
+  const int num_components = jpg.components.size();
+  const int group_index = mcu_y0 / s->mcu_rows_per_group;
+  if (group_index != b->num_groups_done || group_index >= s->groups.size()) {
+    return false;
+  }
+  const bool use_uv_prediction = UseUVPrediction(jpg);
+  b->dc.resize(num_components);
+  b->dc_errors.resize(num_components);
+  const coeff_t* dc_pred_errors[guetzli::kMaxComponents] = { nullptr };
+  const coeff_t* ac_coeffs[guetzli::kMaxComponents] = { nullptr };
+  for (int i = 0; i < num_components; ++i) {
+    const guetzli::JPEGComponent& c = jpg.components[i];
+    const int width = c.width_in_blocks;
+    const int rows = (mcu_y1 - mcu_y0) * c.v_samp_factor;
+    std::vector<coeff_t>& dc = b->dc[i];
+    dc.resize((2 + s->mcu_rows_per_group * c.v_samp_factor) * width);
+    if (mcu_y0 > 0) {
+      memmove(&dc[0], &dc[b->prev_band_mcu_rows * c.v_samp_factor * width],
+              2 * width * sizeof(dc[0]));
+    }
+    for (int k = 0; k < rows * width; ++k) {
+      dc[2 * width + k] = c.coeffs[k * kDCTBlockSize];
+    }
+  }
+  for (int i = 0; i < num_components; ++i) {
+    const guetzli::JPEGComponent& c = jpg.components[i];
+    const int width = c.width_in_blocks;
+    const int rows = (mcu_y1 - mcu_y0) * c.v_samp_factor;
+    b->dc_errors[i].resize(rows * width);
+    if (!ComputeDCPredictionErrors(
+            &b->dc[i][2 * width],
+            use_uv_prediction ? &b->dc[0][2 * width] : nullptr, 1, width,
+            mcu_y0 * c.v_samp_factor, mcu_y0 * c.v_samp_factor + rows,
+            i > 0 && use_uv_prediction, &b->dc_errors[i][0])) {
+      return false;
+    }
+    dc_pred_errors[i] = &b->dc_errors[i][0];
+    ac_coeffs[i] = &c.coeffs[0];
+  }
+  GroupCodingState* group = &s->groups[group_index];
+  EncodeGroup(jpg.MCU_cols, jpg.MCU_rows, mcu_y0, mcu_y1, num_components,
+              b->h_samp, b->v_samp, dc_pred_errors, ac_coeffs,
+              s->context_bits, b->ac_comps, b->approx_total_nonzeros,
+              &s->entropy_source, &group->data_stream_dc,
+              &group->data_stream_ac);
+  b->prev_band_mcu_rows = mcu_y1 - mcu_y0;
+  ++b->num_groups_done;
   return true;
 }
 
+bool ProcessBand(void* data, const guetzli::JPEGData& jpg, int mcu_y0,
+                 int mcu_y1) {
+  BandCodingState* b = static_cast<BandCodingState*>(data);
+  return b->counting_zeros ? CountBandZeros(b, jpg, mcu_y0, mcu_y1)
+                           : EncodeBand(b, jpg, mcu_y0, mcu_y1);
+}
+
 uint32_t FrameTypeCode(const guetzli::JPEGData& jpg) {
   uint32_t code = 0;
   int shift = 0;
@@ -679,7 +922,8 @@ bool EncodeDCData(const guetzli::JPEGData& jpg,
   // Initialize storage.
   size_t storage_ix = 0;
   data[0] = 0;
-  s->data_stream_dc.EncodeCodeWords(&s->entropy_source, &storage_ix, data);
+  s->groups[0].data_stream_dc.EncodeCodeWords(&s->entropy_source, &storage_ix,
+                                              data);
   *len = (storage_ix + 7) >> 3;
   return true;
 }
@@ -691,11 +935,54 @@ bool EncodeACData(const guetzli::JPEGData& jpg,
   // Initialize storage.
   size_t storage_ix = 0;
   data[0] = 0;
-  s->data_stream_ac.EncodeCodeWords(&s->entropy_source, &storage_ix, data);
+  s->groups[0].data_stream_ac.EncodeCodeWords(&s->entropy_source, &storage_ix,
+                                              data);
   *len = (storage_ix + 7) >> 3;
   return true;
 }
 
+// MCU rows per group, then the DC and AC stream sizes of each group, then the
+// streams themselves (DC of group 0, AC of group 0, DC of group 1, ...).
+bool EncodeGroupData(const guetzli::JPEGData& jpg,
+                     JPEGCodingState* s,
+                     uint8_t* data,
+                     size_t* len) {
+  s->pool->Run(0, s->groups.size(), [s](const int task, const int thread) {
+    GroupCodingState* group = &s->groups[task];
+    size_t storage_ix = 0;
+    group->dc_code.resize(group->data_stream_dc.MaxEncodedSize());
+    group->data_stream_dc.EncodeCodeWords(&s->entropy_source, &storage_ix,
+                                          group->dc_code.data());
+    group->dc_code.resize(storage_ix >> 3);
+    storage_ix = 0;
+    group->ac_code.resize(group->data_stream_ac.MaxEncodedSize());
+    group->data_stream_ac.EncodeCodeWords(&s->entropy_source, &storage_ix,
+                                          group->ac_code.data());
+    group->ac_code.resize(storage_ix >> 3);
+  });
+
+  size_t pos = 0;
+  EncodeBase128(s->mcu_rows_per_group, data, &pos);
+  size_t total_size = pos;
+  for (const GroupCodingState& group : s->groups) {
+    total_size += Base128Size(group.dc_code.size()) + group.dc_code.size();
+    total_size += Base128Size(group.ac_code.size()) + group.ac_code.size();
+  }
+  if (total_size > *len) return false;
+  for (const GroupCodingState& group : s->groups) {
+    EncodeBase128(group.dc_code.size(), data, &pos);
+    EncodeBase128(group.ac_code.size(), data, &pos);
+  }
+  for (const GroupCodingState& group : s->groups) {
+    memcpy(data + pos, group.dc_code.data(), group.dc_code.size());
+    pos += group.dc_code.size();
+    memcpy(data + pos, group.ac_code.data(), group.ac_code.size());
+    pos += group.ac_code.size();
+  }
+  *len = pos;
+  return true;
+}
+
 typedef bool (*EncodeSectionDataFn)(const guetzli::JPEGData& jpg,
                                     JPEGCodingState* s,
                                     uint8_t* data,
@@ -747,8 +1034,35 @@ size_t BrunsliV2MaximumEncodedSize(const guetzli::JPEGData& jpg) {
   return 1.2 * jpg.width * jpg.height * jpg.components.size() + hdr_size;
 }
 
+// Writes the sections that follow ProcessCoefficients.
+bool EncodeCoefficientSections(const guetzli::JPEGData& jpg,
+                               JPEGCodingState* s, const size_t len,
+                               uint8_t* data, size_t* pos) {
+  if (!EncodeSection(jpg, s, kBrunsliHistogramDataMarker, EncodeHistogramData,
+                     Base128Size(len - *pos), len, data, pos)) {
+    return PIK_FAILURE("Histogram");
+  }
+  if (s->groups.size() > 1) {
+    if (!EncodeSection(jpg, s, kBrunsliGroupDataMarker, EncodeGroupData,
+                       Base128Size(len - *pos), len, data, pos)) {
+      return PIK_FAILURE("Groups");
+    }
+    return true;
+  }
+  if (!EncodeSection(jpg, s, kBrunsliDCDataMarker, EncodeDCData,
+                     Base128Size(len - *pos), len, data, pos)) {
+    return PIK_FAILURE("DC");
+  }
+  if (!EncodeSection(jpg, s, kBrunsliACDataMarker, EncodeACData,
+                     Base128Size(len - *pos), len, data, pos)) {
+    return PIK_FAILURE("AC");
+  }
+  return true;
+}
+
 bool BrunsliV2EncodeJpegData(const guetzli::JPEGData& jpg,
-                             const size_t header_size, PaddedBytes* out) {
+                             const size_t header_size, ThreadPool* pool,
+                             PaddedBytes* out) {
   size_t pos = header_size;
   const size_t len = BrunsliV2MaximumEncodedSize(jpg);
   uint8_t* data = out->data();
@@ -761,20 +1075,83 @@ bool BrunsliV2EncodeJpegData(const guetzli::JPEGData& jpg,
     return PIK_FAILURE("Encode quant");
   }
   JPEGCodingState s;
+  s.pool = pool;
   if (!ProcessCoefficients(jpg, &s)) {
     return PIK_FAILURE("ProcessCoefficients");
   }
-  if (!EncodeSection(jpg, &s, kBrunsliHistogramDataMarker, EncodeHistogramData,
-                     Base128Size(len - pos), len, data, &pos)) {
-    return PIK_FAILURE("Histogram");
+  if (!EncodeCoefficientSections(jpg, &s, len, data, &pos)) {
+    return false;
   }
-  if (!EncodeSection(jpg, &s, kBrunsliDCDataMarker, EncodeDCData,
-                     Base128Size(len - pos), len, data, &pos)) {
-    return PIK_FAILURE("DC");
+  out->resize(pos);
+  return true;
+}
+
+bool BrunsliV2EncodeJpegBands(const uint8_t* jpeg, const size_t jpeg_size,
+                              const size_t header_size, ThreadPool* pool,
+                              PaddedBytes* out,
+                              guetzli::JPEGReadError* error) {
+  *error = guetzli::JPEG_OK;
+  guetzli::JPEGData header;
+  if (!guetzli::ReadJpeg(jpeg, jpeg_size, guetzli::JPEG_READ_HEADER,
+                         &header)) {
+    *error = header.error;
+    return PIK_FAILURE("Invalid jpeg header");
   }
-  if (!EncodeSection(jpg, &s, kBrunsliACDataMarker, EncodeACData,
-                     Base128Size(len - pos), len, data, &pos)) {
-    return PIK_FAILURE("AC");
+  const int mcu_rows_per_band = McuRowsPerGroup(header);
+
+  JPEGCodingState s;
+  s.pool = pool;
+  BandCodingState b(&s);
+  guetzli::JPEGData jpg;
+  if (!guetzli::ReadJpegBands(jpeg, jpeg_size, mcu_rows_per_band,
+                              guetzli::JPEGBandOutput(ProcessBand, &b),
+                              &jpg)) {
+    *error = jpg.error;
+    return PIK_FAILURE("Reading jpeg bands");
+  }
+
+  const size_t len = BrunsliV2MaximumEncodedSize(jpg);
+  out->resize(header_size + len);
+  uint8_t* data = out->data();
+  size_t pos = header_size;
+  if (!EncodeSection(jpg, nullptr, kBrunsliHeaderMarker, EncodeHeader,
+                     1, len, data, &pos)) {
+    return PIK_FAILURE("Encode header");
+  }
+  if (!EncodeSection(jpg, nullptr, kBrunsliQuantDataMarker, EncodeQuantData,
+                     2, len, data, &pos)) {
+    return PIK_FAILURE("Encode quant");
+  }
+  if (!GetComponentParams(jpg, b.h_samp, b.v_samp, b.quant)) {
+    return PIK_FAILURE("Invalid quant table index");
+  }
+  const int num_components = jpg.components.size();
+  const int num_contexts =
+      PrepareAC(jpg.MCU_cols, jpg.MCU_rows, num_components, b.h_samp,
+                b.v_samp, b.num_zeros, b.quant, &s.context_bits,
+                &b.context_offsets, &b.ac_comps, &b.approx_total_nonzeros);
+  s.mcu_rows_per_group = McuRowsPerGroup(jpg);
+  s.groups.resize(std::max(1, DivCeil(jpg.MCU_rows, s.mcu_rows_per_group)));
+  s.entropy_source.Resize(num_contexts);
+
+  // Second pass: the histograms of all groups go directly to s.entropy_source.
+  b.counting_zeros = false;
+  guetzli::JPEGData jpg_again;
+  if (!guetzli::ReadJpegBands(jpeg, jpeg_size, s.mcu_rows_per_group,
+                              guetzli::JPEGBandOutput(ProcessBand, &b),
+                              &jpg_again)) {
+    *error = jpg_again.error;
+    return PIK_FAILURE("Encoding jpeg bands");
+  }
+  if (b.num_groups_done != s.groups.size()) {
+    // No scan, so ReadJpeg would leave all coefficients zero.
+    *error = guetzli::JPEG_BANDS_UNSUPPORTED;
+    return PIK_FAILURE("Incomplete jpeg scan");
+  }
+  s.entropy_source.ClusterHistograms(b.context_offsets);
+
+  if (!EncodeCoefficientSections(jpg, &s, len, data, &pos)) {
+    return false;
   }
   out->resize(pos);
   return true;
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <vector>
 
+#include "data_parallel.h"
 #include "guetzli/jpeg_data.h"
 #include "padded_bytes.h"
 
@@ -16,8 +17,21 @@ size_t BrunsliV2MaximumEncodedSize(const guetzli::JPEGData& jpg);
 // Encodes the given jpg to *out in brunsli v2 format starting at byte
 // offset "header_size". Returns false on invalid jpg data.
 // "out" must be pre-allocated to MaxHeaderSize + BrunsliV2MaximumEncodedSize.
+// Images with several groups of MCU rows are encoded in parallel on "pool".
 bool BrunsliV2EncodeJpegData(const guetzli::JPEGData& jpg,
-                             const size_t header_size, PaddedBytes* out);
+                             const size_t header_size, ThreadPool* pool,
+                             PaddedBytes* out);
+
+// Same as BrunsliV2EncodeJpegData for the JPEG file jpeg[0, jpeg_size), which
+// is decoded twice in bands of MCU rows so that the coefficients of the whole
+// image are never in memory at once. Resizes "out" as needed and keeps its
+// first header_size bytes. On failure, *error is the JPEG reader's error;
+// JPEG_BANDS_UNSUPPORTED (e.g. progressive files) means that the file must be
+// read with ReadJpeg and encoded with BrunsliV2EncodeJpegData instead.
+bool BrunsliV2EncodeJpegBands(const uint8_t* jpeg, const size_t jpeg_size,
+                              const size_t header_size, ThreadPool* pool,
+                              PaddedBytes* out,
+                              guetzli::JPEGReadError* error);
 
 }  // namespace pik
 
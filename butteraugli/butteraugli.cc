@@ -42,6 +42,10 @@
 
 #include <atomic>
 
+#include "cache_aligned.h"
+#include "data_parallel.h"
+#include "simd/simd.h"
+
 // Restricted pointers speed up Convolution(); MSVC uses a different keyword.
 #ifdef _MSC_VER
 #define __restrict__ __restrict
@@ -61,34 +65,16 @@
 namespace pik {
 namespace butteraugli {
 
+// Forwards to pik::CacheAligned (kAlignment >= kCacheLineSize), so that
+// butteraugli temporaries are also recycled by pik::AllocationPool.
 void* CacheAligned::Allocate(const size_t bytes) {
   PROFILER_FUNC;
-  char* const allocated = static_cast<char*>(malloc(bytes + kCacheLineSize));
-  if (allocated == nullptr) {
-    return nullptr;
-  }
-  const uintptr_t misalignment =
-      reinterpret_cast<uintptr_t>(allocated) & (kCacheLineSize - 1);
-  // malloc is at least kPointerSize aligned, so we can store the "allocated"
-  // pointer immediately before the aligned memory.
-  assert(misalignment % kPointerSize == 0);
-  char* const aligned = allocated + kCacheLineSize - misalignment;
-  memcpy(aligned - kPointerSize, &allocated, kPointerSize);
-  return BUTTERAUGLI_ASSUME_ALIGNED(aligned, 64);
+  return BUTTERAUGLI_ASSUME_ALIGNED(pik::CacheAligned::Allocate(bytes), 64);
 }
 
 void CacheAligned::Free(void* aligned_pointer) {
   PROFILER_FUNC;
-  if (aligned_pointer == nullptr) {
-    return;
-  }
-  char* const aligned = static_cast<char*>(aligned_pointer);
-  assert(reinterpret_cast<uintptr_t>(aligned) % kCacheLineSize == 0);
-  char* allocated;
-  memcpy(&allocated, aligned - kPointerSize, kPointerSize);
-  assert(allocated <= aligned - kPointerSize);
-  assert(allocated >= aligned - kCacheLineSize);
-  free(allocated);
+  pik::CacheAligned::Free(aligned_pointer);
 }
 
 static inline bool IsNan(const float x) {
@@ -139,6 +125,17 @@ static inline void CheckImage(const ImageF& image, const char* name) {
 #endif
 
 
+// Sigmas of the blurs, at namespace scope so that kDiffmapSupport can be
+// derived from them.
+static constexpr double kSigmaOpsin = 1.2;  // OpsinDynamicsImage
+static constexpr double kSigmaLf = 7.46953768697;  // SeparateFrequencies
+static constexpr double kSigmaHf = 3.734768843485;
+static constexpr double kSigmaUhf = 1.8673844217425;
+static constexpr double kSigmaHfX = 10.6666499623;  // SameNoiseLevels
+static constexpr double kSigmaMask0 = 2.3770330432;  // Mask
+static constexpr double kSigmaMask1 = 9.04353323561;
+static constexpr double kSigmaMask2 = 9.24456601467;
+
 // Purpose of kInternalGoodQualityThreshold:
 // Normalize 'ok' image degradation to 1.0 across different versions of
 // butteraugli.
@@ -149,8 +146,18 @@ inline float DotProduct(const float u[3], const float v[3]) {
   return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
 }
 
+// Kernel radius in units of sigma. Accuracy increases when it is increased.
+static constexpr float kKernelRadiusPerSigma = 2.25f;
+
+// Returns ComputeKernel(sigma).size() / 2 for sigma > 0.
+static constexpr size_t KernelRadius(float sigma) {
+  return kKernelRadiusPerSigma * sigma < 1.0f
+             ? 1
+             : static_cast<size_t>(kKernelRadiusPerSigma * sigma);
+}
+
 std::vector<float> ComputeKernel(float sigma) {
-  const float m = 2.25;  // Accuracy increases when m is increased.
+  const float m = kKernelRadiusPerSigma;
   const float scaler = -1.0 / (2 * sigma * sigma);
   const int diff = std::max<int>(1, m * fabs(sigma));
   std::vector<float> kernel(2 * diff + 1);
@@ -160,9 +167,24 @@ std::vector<float> ComputeKernel(float sigma) {
   return kernel;
 }
 
+// Calls func(task, thread) for all tasks in [0, num_tasks), in parallel if
+// "pool" is non-null.
+template <class Func>
+static void RunOnPool(ThreadPool* pool, const size_t num_tasks,
+                      const Func& func) {
+  if (pool == nullptr) {
+    for (size_t task = 0; task < num_tasks; ++task) {
+      func(static_cast<int>(task), 0);
+    }
+  } else {
+    pool->Run(0, static_cast<int>(num_tasks), func);
+  }
+}
+
 void ConvolveBorderColumn(const ImageF& in, const std::vector<float>& kernel,
                           const float weight_no_border,
                           const float border_ratio, const size_t x,
+                          const size_t y_begin, const size_t y_end,
                           float* const BUTTERAUGLI_RESTRICT row_out) {
   const int offset = kernel.size() / 2;
   int minx = x < offset ? 0 : x - offset;
@@ -174,7 +196,7 @@ void ConvolveBorderColumn(const ImageF& in, const std::vector<float>& kernel,
   // Interpolate linearly between the no-border scaling and border scaling.
   weight = (1.0f - border_ratio) * weight + border_ratio * weight_no_border;
   float scale = 1.0f / weight;
-  for (size_t y = 0; y < in.ysize(); ++y) {
+  for (size_t y = y_begin; y < y_end; ++y) {
     const float* const BUTTERAUGLI_RESTRICT row_in = in.Row(y);
     float sum = 0.0f;
     for (int j = minx; j <= maxx; ++j) {
@@ -184,9 +206,44 @@ void ConvolveBorderColumn(const ImageF& in, const std::vector<float>& kernel,
   }
 }
 
+// Writes out[x][y] = convolution of row_in (input row y) at x for x in
+// [x_begin, x_end). Vectorized across x; the sum for each x accumulates in the
+// same order as the scalar loop, so the results are identical.
+static void ConvolveRowMiddle(const float* const BUTTERAUGLI_RESTRICT row_in,
+                              const std::vector<float>& scaled_kernel,
+                              const int x_begin, const int x_end,
+                              const size_t y,
+                              ImageF* BUTTERAUGLI_RESTRICT out) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  const int len = scaled_kernel.size();
+  const int offset = len / 2;
+  int x = x_begin;
+  for (; x + static_cast<int>(d.N) <= x_end; x += d.N) {
+    const float* const BUTTERAUGLI_RESTRICT row_d = row_in + x - offset;
+    auto sum = setzero(d);
+    for (int j = 0; j < len; ++j) {
+      sum = sum + load_unaligned(d, row_d + j) * set1(d, scaled_kernel[j]);
+    }
+    SIMD_ALIGN float lanes[d.N];
+    store(sum, d, lanes);
+    for (size_t i = 0; i < d.N; ++i) {
+      out->Row(x + i)[y] = lanes[i];
+    }
+  }
+  for (; x < x_end; ++x) {
+    const int x0 = x - offset;
+    float sum = 0.0f;
+    for (int j = 0; j < len; ++j) {
+      sum += row_in[x0 + j] * scaled_kernel[j];
+    }
+    out->Row(x)[y] = sum;
+  }
+}
+
 // Computes a horizontal convolution and transposes the result.
 ImageF Convolution(const ImageF& in, const std::vector<float>& kernel,
-                   const float border_ratio) {
+                   const float border_ratio, ThreadPool* pool) {
   PROFILER_FUNC;
   ImageF out(in.ysize(), in.xsize());
   const int len = kernel.size();
@@ -202,38 +259,39 @@ ImageF Convolution(const ImageF& in, const std::vector<float>& kernel,
   for (int i = 0; i < scaled_kernel.size(); ++i) {
     scaled_kernel[i] *= scale_no_border;
   }
-  // left border
-  for (int x = 0; x < border1; ++x) {
-    ConvolveBorderColumn(in, kernel, weight_no_border, border_ratio, x,
-                         out.Row(x));
-  }
-  // middle
-  for (size_t y = 0; y < in.ysize(); ++y) {
-    const float* const BUTTERAUGLI_RESTRICT row_in = in.Row(y);
-    for (int x = border1; x < border2; ++x) {
-      const int d = x - offset;
-      float* const BUTTERAUGLI_RESTRICT row_out = out.Row(x);
-      float sum = 0.0f;
-      for (int j = 0; j < len; ++j) {
-        sum += row_in[d + j] * scaled_kernel[j];
-      }
-      row_out[y] = sum;
+
+  // Each task handles a range of input rows, i.e. columns of "out". Multiples
+  // of a cache line avoid false sharing between tasks.
+  const size_t kRowsPerTask = CacheAligned::kCacheLineSize / sizeof(float);
+  const size_t num_tasks = (in.ysize() + kRowsPerTask - 1) / kRowsPerTask;
+  RunOnPool(pool, num_tasks, [&](const int task, const int thread) {
+    const size_t y_begin = task * kRowsPerTask;
+    const size_t y_end = std::min(y_begin + kRowsPerTask, in.ysize());
+    // left border
+    for (int x = 0; x < border1; ++x) {
+      ConvolveBorderColumn(in, kernel, weight_no_border, border_ratio, x,
+                           y_begin, y_end, out.Row(x));
     }
-  }
-  // right border
-  for (int x = border2; x < in.xsize(); ++x) {
-    ConvolveBorderColumn(in, kernel, weight_no_border, border_ratio, x,
-                         out.Row(x));
-  }
+    // middle
+    for (size_t y = y_begin; y < y_end; ++y) {
+      ConvolveRowMiddle(in.Row(y), scaled_kernel, border1, border2, y, &out);
+    }
+    // right border
+    for (int x = border2; x < in.xsize(); ++x) {
+      ConvolveBorderColumn(in, kernel, weight_no_border, border_ratio, x,
+                           y_begin, y_end, out.Row(x));
+    }
+  });
   return out;
 }
 
 // A blur somewhat similar to a 2D Gaussian blur.
 // See: https://en.wikipedia.org/wiki/Gaussian_blur
-ImageF Blur(const ImageF& in, float sigma, float border_ratio) {
+ImageF Blur(const ImageF& in, float sigma, float border_ratio,
+            ThreadPool* pool) {
   std::vector<float> kernel = ComputeKernel(sigma);
-  return Convolution(Convolution(in, kernel, border_ratio), kernel,
-                     border_ratio);
+  return Convolution(Convolution(in, kernel, border_ratio, pool), kernel,
+                     border_ratio, pool);
 }
 
 // Clamping linear interpolator.
@@ -325,16 +383,17 @@ static inline double Gamma(double v) {
   return GammaPolynomial(v);
 }
 
-std::vector<ImageF> OpsinDynamicsImage(const std::vector<ImageF>& rgb) {
+std::vector<ImageF> OpsinDynamicsImage(const std::vector<ImageF>& rgb,
+                                       ThreadPool* pool) {
   PROFILER_FUNC;
   std::vector<ImageF> xyb(3);
   std::vector<ImageF> blurred(3);
-  const double kSigma = 1.2;
   for (int i = 0; i < 3; ++i) {
     xyb[i] = ImageF(rgb[i].xsize(), rgb[i].ysize());
-    blurred[i] = Blur(rgb[i], kSigma, 0.0);
+    blurred[i] = Blur(rgb[i], kSigmaOpsin, 0.0, pool);
   }
-  for (size_t y = 0; y < rgb[0].ysize(); ++y) {
+  RunOnPool(pool, rgb[0].ysize(), [&](const int task, const int thread) {
+    const size_t y = task;
     const float* const BUTTERAUGLI_RESTRICT row_r = rgb[0].Row(y);
     const float* const BUTTERAUGLI_RESTRICT row_g = rgb[1].Row(y);
     const float* const BUTTERAUGLI_RESTRICT row_b = rgb[2].Row(y);
@@ -365,7 +424,7 @@ std::vector<ImageF> OpsinDynamicsImage(const std::vector<ImageF>& rgb) {
       RgbToXyb(cur_mixed0, cur_mixed1, cur_mixed2, &row_out_x[x], &row_out_y[x],
                &row_out_b[x]);
     }
-  }
+  });
   return xyb;
 }
 
@@ -471,10 +530,12 @@ static ImageF MaximumClamping(size_t xsize, size_t ysize, const ImageF& ix,
 }
 
 static ImageF SuppressXByY(size_t xsize, size_t ysize, const ImageF& ix,
-                           const ImageF& iy, const double yw) {
+                           const ImageF& iy, const double yw,
+                           ThreadPool* pool) {
   static const double s = 0.745954517135;
   ImageF inew(xsize, ysize);
-  for (size_t y = 0; y < ysize; ++y) {
+  RunOnPool(pool, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
     const float* const rowx = ix.Row(y);
     const float* const rowy = iy.Row(y);
     float* const rownew = inew.Row(y);
@@ -484,22 +545,19 @@ static ImageF SuppressXByY(size_t xsize, size_t ysize, const ImageF& ix,
       const double scaler = s + (yw * (1.0 - s)) / (yw + yval * yval);
       rownew[x] = scaler * xval;
     }
-  }
+  });
   return inew;
 }
 
 static void SeparateFrequencies(size_t xsize, size_t ysize,
                                 const std::vector<ImageF>& xyb,
-                                PsychoImage& ps) {
+                                ThreadPool* pool, PsychoImage& ps) {
   PROFILER_FUNC;
   ps.lf.resize(3);   // XYB
   ps.mf.resize(3);   // XYB
   ps.hf.resize(2);   // XY
   ps.uhf.resize(2);  // XY
   // Extract lf ...
-  static const double kSigmaLf = 7.46953768697;
-  static const double kSigmaHf = 3.734768843485;
-  static const double kSigmaUhf = 1.8673844217425;
   // At borders we move some more of the energy to the high frequency
   // parts, because there can be unfortunate continuations in tiling
   // background color etc. So we want to represent the borders with
@@ -508,65 +566,70 @@ static void SeparateFrequencies(size_t xsize, size_t ysize,
   static double border_mf = -0.271277366628;
   static double border_hf = 0.147068973249;
   for (int i = 0; i < 3; ++i) {
-    ps.lf[i] = Blur(xyb[i], kSigmaLf, border_lf);
+    ps.lf[i] = Blur(xyb[i], kSigmaLf, border_lf, pool);
     // ... and keep everything else in mf.
     ps.mf[i] = ImageF(xsize, ysize);
-    for (size_t y = 0; y < ysize; ++y) {
+    RunOnPool(pool, ysize, [&](const int task, const int thread) {
+      const size_t y = task;
       for (size_t x = 0; x < xsize; ++x) {
         ps.mf[i].Row(y)[x] = xyb[i].Row(y)[x] - ps.lf[i].Row(y)[x];
       }
-    }
+    });
     if (i == 2) {
-      ps.mf[i] = Blur(ps.mf[i], kSigmaHf, border_mf);
+      ps.mf[i] = Blur(ps.mf[i], kSigmaHf, border_mf, pool);
       break;
     }
     // Divide mf into mf and hf.
     ps.hf[i] = ImageF(xsize, ysize);
-    for (size_t y = 0; y < ysize; ++y) {
+    RunOnPool(pool, ysize, [&](const int task, const int thread) {
+      const size_t y = task;
       float* BUTTERAUGLI_RESTRICT const row_mf = ps.mf[i].Row(y);
       float* BUTTERAUGLI_RESTRICT const row_hf = ps.hf[i].Row(y);
       for (size_t x = 0; x < xsize; ++x) {
         row_hf[x] = row_mf[x];
       }
-    }
-    ps.mf[i] = Blur(ps.mf[i], kSigmaHf, border_mf);
+    });
+    ps.mf[i] = Blur(ps.mf[i], kSigmaHf, border_mf, pool);
     static const double w0 = 0.120079806822;
     static const double w1 = 0.03430529365;
     if (i == 0) {
-      for (size_t y = 0; y < ysize; ++y) {
+      RunOnPool(pool, ysize, [&](const int task, const int thread) {
+        const size_t y = task;
         float* BUTTERAUGLI_RESTRICT const row_mf = ps.mf[0].Row(y);
         float* BUTTERAUGLI_RESTRICT const row_hf = ps.hf[0].Row(y);
         for (size_t x = 0; x < xsize; ++x) {
           row_hf[x] -= row_mf[x];
           row_mf[x] = RemoveRangeAroundZero(w0, row_mf[x]);
         }
-      }
+      });
     } else {
-      for (size_t y = 0; y < ysize; ++y) {
+      RunOnPool(pool, ysize, [&](const int task, const int thread) {
+        const size_t y = task;
         float* BUTTERAUGLI_RESTRICT const row_mf = ps.mf[1].Row(y);
         float* BUTTERAUGLI_RESTRICT const row_hf = ps.hf[1].Row(y);
         for (size_t x = 0; x < xsize; ++x) {
           row_hf[x] -= row_mf[x];
           row_mf[x] = AmplifyRangeAroundZero(w1, row_mf[x]);
         }
-      }
+      });
     }
   }
   // Suppress red-green by intensity change in the high freq channels.
   static const double suppress = 2.96534974403;
-  ps.hf[0] = SuppressXByY(xsize, ysize, ps.hf[0], ps.hf[1], suppress);
+  ps.hf[0] = SuppressXByY(xsize, ysize, ps.hf[0], ps.hf[1], suppress, pool);
 
   for (int i = 0; i < 2; ++i) {
     // Divide hf into hf and uhf.
     ps.uhf[i] = ImageF(xsize, ysize);
-    for (size_t y = 0; y < ysize; ++y) {
+    RunOnPool(pool, ysize, [&](const int task, const int thread) {
+      const size_t y = task;
       float* BUTTERAUGLI_RESTRICT const row_uhf = ps.uhf[i].Row(y);
       float* BUTTERAUGLI_RESTRICT const row_hf = ps.hf[i].Row(y);
       for (size_t x = 0; x < xsize; ++x) {
         row_uhf[x] = row_hf[x];
       }
-    }
-    ps.hf[i] = Blur(ps.hf[i], kSigmaUhf, border_hf);
+    });
+    ps.hf[i] = Blur(ps.hf[i], kSigmaUhf, border_hf, pool);
     static const double kRemoveHfRange = 0.0287615200377;
     static const double kMaxclampHf = 78.8223237675;
     static const double kMaxclampUhf = 5.8907152736;
@@ -578,16 +641,18 @@ static void SeparateFrequencies(size_t xsize, size_t ysize,
     static const float kRegUhf = 2000 * kMulRegUhf;
 
     if (i == 0) {
-      for (size_t y = 0; y < ysize; ++y) {
+      RunOnPool(pool, ysize, [&](const int task, const int thread) {
+        const size_t y = task;
         float* BUTTERAUGLI_RESTRICT const row_uhf = ps.uhf[0].Row(y);
         float* BUTTERAUGLI_RESTRICT const row_hf = ps.hf[0].Row(y);
         for (size_t x = 0; x < xsize; ++x) {
           row_uhf[x] -= row_hf[x];
           row_hf[x] = RemoveRangeAroundZero(kRemoveHfRange, row_hf[x]);
         }
-      }
+      });
     } else {
-      for (size_t y = 0; y < ysize; ++y) {
+      RunOnPool(pool, ysize, [&](const int task, const int thread) {
+        const size_t y = task;
         float* BUTTERAUGLI_RESTRICT const row_uhf = ps.uhf[1].Row(y);
         float* BUTTERAUGLI_RESTRICT const row_hf = ps.hf[1].Row(y);
         float* BUTTERAUGLI_RESTRICT const row_lf = ps.lf[1].Row(y);
@@ -600,14 +665,15 @@ static void SeparateFrequencies(size_t xsize, size_t ysize,
           row_hf[x] = SuppressHfInBrightAreas(row_hf[x], row_lf[x],
                                               kMulSuppressHf, kRegHf);
         }
-      }
+      });
     }
   }
   // Modify range around zero code only concerns the high frequency
   // planes and only the X and Y channels.
   // Convert low freq xyb to vals space so that we can do a simple squared sum
   // diff on the low frequencies later.
-  for (size_t y = 0; y < ysize; ++y) {
+  RunOnPool(pool, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
     float* BUTTERAUGLI_RESTRICT const row_x = ps.lf[0].Row(y);
     float* BUTTERAUGLI_RESTRICT const row_y = ps.lf[1].Row(y);
     float* BUTTERAUGLI_RESTRICT const row_b = ps.lf[2].Row(y);
@@ -618,15 +684,16 @@ static void SeparateFrequencies(size_t xsize, size_t ysize,
       row_y[x] = valy;
       row_b[x] = valb;
     }
-  }
+  });
 }
 
 static void SameNoiseLevels(const ImageF& i0, const ImageF& i1,
                             const double kSigma, const double w,
-                            const double maxclamp,
+                            const double maxclamp, ThreadPool* pool,
                             ImageF* BUTTERAUGLI_RESTRICT diffmap) {
   ImageF blurred(i0.xsize(), i0.ysize());
-  for (size_t y = 0; y < i0.ysize(); ++y) {
+  RunOnPool(pool, i0.ysize(), [&](const int task, const int thread) {
+    const size_t y = task;
     const float* BUTTERAUGLI_RESTRICT const row0 = i0.Row(y);
     const float* BUTTERAUGLI_RESTRICT const row1 = i1.Row(y);
     float* BUTTERAUGLI_RESTRICT const to = blurred.Row(y);
@@ -637,16 +704,17 @@ static void SameNoiseLevels(const ImageF& i0, const ImageF& i1,
       if (v1 > maxclamp) v1 = maxclamp;
       to[x] = v0 - v1;
     }
-  }
-  blurred = Blur(blurred, kSigma, 0.0);
-  for (size_t y = 0; y < i0.ysize(); ++y) {
+  });
+  blurred = Blur(blurred, kSigma, 0.0, pool);
+  RunOnPool(pool, i0.ysize(), [&](const int task, const int thread) {
+    const size_t y = task;
     const float* BUTTERAUGLI_RESTRICT const row = blurred.Row(y);
     float* BUTTERAUGLI_RESTRICT const row_diff = diffmap->Row(y);
     for (size_t x = 0; x < i0.xsize(); ++x) {
       double diff = row[x];
       row_diff[x] += w * diff * diff;
     }
-  }
+  });
 }
 
 static void L2Diff(const ImageF& i0, const ImageF& i1, const double w,
@@ -735,7 +803,8 @@ ImageF CalculateDiffmap(const ImageF& diffmap_in) {
 void MaskPsychoImage(const PsychoImage& pi0, const PsychoImage& pi1,
                      const size_t xsize, const size_t ysize,
                      std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask,
-                     std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask_dc) {
+                     std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask_dc,
+                     ThreadPool* pool) {
   std::vector<ImageF> mask_xyb0 = CreatePlanes<float>(xsize, ysize, 3);
   std::vector<ImageF> mask_xyb1 = CreatePlanes<float>(xsize, ysize, 3);
   static const double muls[4] = {
@@ -747,7 +816,8 @@ void MaskPsychoImage(const PsychoImage& pi0, const PsychoImage& pi1,
   for (int i = 0; i < 2; ++i) {
     double a = muls[2 * i];
     double b = muls[2 * i + 1];
-    for (size_t y = 0; y < ysize; ++y) {
+    RunOnPool(pool, ysize, [&](const int task, const int thread) {
+      const size_t y = task;
       const float* const BUTTERAUGLI_RESTRICT row_hf0 = pi0.hf[i].Row(y);
       const float* const BUTTERAUGLI_RESTRICT row_hf1 = pi1.hf[i].Row(y);
       const float* const BUTTERAUGLI_RESTRICT row_uhf0 = pi0.uhf[i].Row(y);
@@ -758,32 +828,229 @@ void MaskPsychoImage(const PsychoImage& pi0, const PsychoImage& pi1,
         row0[x] = a * row_uhf0[x] + b * row_hf0[x];
         row1[x] = a * row_uhf1[x] + b * row_hf1[x];
       }
+    });
+  }
+  Mask(mask_xyb0, mask_xyb1, mask, mask_dc, pool);
+}
+
+ButteraugliReferencePtr ComputeButteraugliReference(
+    const std::vector<ImageF>& rgb0, ThreadPool* pool) {
+  PROFILER_FUNC;
+  std::shared_ptr<ButteraugliReference> reference =
+      std::make_shared<ButteraugliReference>();
+  reference->xsize = rgb0[0].xsize();
+  reference->ysize = rgb0[0].ysize();
+  if (reference->xsize < 8 || reference->ysize < 8) return reference;
+  std::vector<ImageF> xyb0 = OpsinDynamicsImage(rgb0, pool);
+  SeparateFrequencies(reference->xsize, reference->ysize, xyb0, pool,
+                      reference->pi0);
+  return reference;
+}
+
+namespace {
+
+// Identifies serialized references; the low byte is the format version.
+constexpr uint32_t kReferenceMagic = 0x42524601;
+
+template <typename T>
+void AppendPOD(const T value, std::vector<uint8_t>* bytes) {
+  const size_t pos = bytes->size();
+  bytes->resize(pos + sizeof(T));
+  memcpy(bytes->data() + pos, &value, sizeof(T));
+}
+
+// Bounds-checked reader of SerializeButteraugliReference output.
+class ReferenceReader {
+ public:
+  ReferenceReader(const uint8_t* bytes, const size_t size)
+      : pos_(bytes), end_(bytes + size) {}
+
+  template <typename T>
+  bool ReadPOD(T* value) {
+    return Read(value, sizeof(T));
+  }
+
+  bool Read(void* to, const size_t num_bytes) {
+    if (static_cast<size_t>(end_ - pos_) < num_bytes) return false;
+    memcpy(to, pos_, num_bytes);
+    pos_ += num_bytes;
+    return true;
+  }
+
+  bool AtEnd() const { return pos_ == end_; }
+
+ private:
+  const uint8_t* pos_;
+  const uint8_t* end_;
+};
+
+void SerializePlanes(const std::vector<ImageF>& planes,
+                     std::vector<uint8_t>* bytes) {
+  AppendPOD(static_cast<uint32_t>(planes.size()), bytes);
+  for (const ImageF& plane : planes) {
+    AppendPOD(static_cast<uint64_t>(plane.xsize()), bytes);
+    AppendPOD(static_cast<uint64_t>(plane.ysize()), bytes);
+    const size_t row_size = plane.xsize() * sizeof(float);
+    for (size_t y = 0; y < plane.ysize(); ++y) {
+      const size_t pos = bytes->size();
+      bytes->resize(pos + row_size);
+      memcpy(bytes->data() + pos, plane.Row(y), row_size);
+    }
+  }
+}
+
+bool DeserializePlanes(const size_t xsize, const size_t ysize,
+                       ReferenceReader* reader,
+                       std::vector<ImageF>* planes) {
+  uint32_t num_planes;
+  if (!reader->ReadPOD(&num_planes) || num_planes > 3) return false;
+  planes->clear();
+  for (uint32_t c = 0; c < num_planes; ++c) {
+    uint64_t plane_xsize, plane_ysize;
+    if (!reader->ReadPOD(&plane_xsize) || !reader->ReadPOD(&plane_ysize)) {
+      return false;
+    }
+    // All planes are either empty or the size of the image.
+    const bool is_empty = plane_xsize == 0 && plane_ysize == 0;
+    if (!is_empty && (plane_xsize != xsize || plane_ysize != ysize)) {
+      return false;
+    }
+    planes->emplace_back(plane_xsize, plane_ysize);
+    for (size_t y = 0; y < plane_ysize; ++y) {
+      if (!reader->Read(planes->back().Row(y), xsize * sizeof(float))) {
+        return false;
+      }
     }
   }
-  Mask(mask_xyb0, mask_xyb1, mask, mask_dc);
+  return true;
+}
+
+}  // namespace
+
+void SerializeButteraugliReference(const ButteraugliReference& reference,
+                                   std::vector<uint8_t>* bytes) {
+  AppendPOD(kReferenceMagic, bytes);
+  AppendPOD(static_cast<uint64_t>(reference.xsize), bytes);
+  AppendPOD(static_cast<uint64_t>(reference.ysize), bytes);
+  SerializePlanes(reference.pi0.uhf, bytes);
+  SerializePlanes(reference.pi0.hf, bytes);
+  SerializePlanes(reference.pi0.mf, bytes);
+  SerializePlanes(reference.pi0.lf, bytes);
+}
+
+ButteraugliReferencePtr DeserializeButteraugliReference(const uint8_t* bytes,
+                                                        const size_t size) {
+  ReferenceReader reader(bytes, size);
+  uint32_t magic;
+  uint64_t xsize, ysize;
+  if (!reader.ReadPOD(&magic) || magic != kReferenceMagic ||
+      !reader.ReadPOD(&xsize) || !reader.ReadPOD(&ysize)) {
+    return nullptr;
+  }
+  // Rejects sizes whose planes could not possibly fit into "bytes".
+  if (xsize > size || ysize > size) return nullptr;
+
+  std::shared_ptr<ButteraugliReference> reference =
+      std::make_shared<ButteraugliReference>();
+  reference->xsize = xsize;
+  reference->ysize = ysize;
+  PsychoImage& pi0 = reference->pi0;
+  if (!DeserializePlanes(xsize, ysize, &reader, &pi0.uhf) ||
+      !DeserializePlanes(xsize, ysize, &reader, &pi0.hf) ||
+      !DeserializePlanes(xsize, ysize, &reader, &pi0.mf) ||
+      !DeserializePlanes(xsize, ysize, &reader, &pi0.lf) || !reader.AtEnd()) {
+    return nullptr;
+  }
+  return reference;
 }
 
 ButteraugliComparator::ButteraugliComparator(const std::vector<ImageF>& rgb0,
-                                             double hf_asymmetry)
-    : xsize_(rgb0[0].xsize()),
-      ysize_(rgb0[0].ysize()),
-      hf_asymmetry_(hf_asymmetry) {
+                                             double hf_asymmetry,
+                                             ThreadPool* pool)
+    : ButteraugliComparator(ComputeButteraugliReference(rgb0, pool),
+                            hf_asymmetry, pool) {}
+
+ButteraugliComparator::ButteraugliComparator(ButteraugliReferencePtr reference,
+                                             const double hf_asymmetry,
+                                             ThreadPool* pool)
+    : xsize_(reference->xsize),
+      ysize_(reference->ysize),
+      hf_asymmetry_(hf_asymmetry),
+      pool_(pool),
+      reference_(std::move(reference)),
+      pi0_(reference_->pi0) {}
+
+constexpr size_t ButteraugliComparator::kDiffmapSupport;
+
+static constexpr size_t Max(size_t a, size_t b) { return a > b ? a : b; }
+
+// Distance from a changed pixel of the distorted image (or a region border)
+// beyond which each image of the computation is unaffected.
+// OpsinDynamicsImage:
+static constexpr size_t kSupportXyb = KernelRadius(kSigmaOpsin);
+// SeparateFrequencies: lf and mf are blurred from the previous band, hf and
+// uhf are differences of blurred images; all other operations are per pixel.
+static constexpr size_t kSupportLf = kSupportXyb + KernelRadius(kSigmaLf);
+static constexpr size_t kSupportMf = kSupportLf + KernelRadius(kSigmaHf);
+static constexpr size_t kSupportHf = kSupportMf + KernelRadius(kSigmaUhf);
+// DiffmapPsychoImage: MaltaUnit reads a 9x9 window; SameNoiseLevels blurs hf.
+static constexpr size_t kSupportMalta = kSupportHf + 4;
+static constexpr size_t kSupportNoise = kSupportHf + KernelRadius(kSigmaHfX);
+// MaskPsychoImage: DiffPrecompute reads the next pixel, then Mask blurs.
+static constexpr size_t kSupportMask =
+    kSupportHf + 1 +
+    Max(KernelRadius(kSigmaMask0),
+        Max(KernelRadius(kSigmaMask1), KernelRadius(kSigmaMask2)));
+static_assert(ButteraugliComparator::kDiffmapSupport ==
+                  Max(kSupportMalta, Max(kSupportNoise, kSupportMask)),
+              "Update kDiffmapSupport after changing the blurs");
+
+static std::vector<ImageF> CropPlanes(const std::vector<ImageF>& planes,
+                                      const size_t x0, const size_t y0,
+                                      const size_t xsize, const size_t ysize) {
+  std::vector<ImageF> out;
+  out.reserve(planes.size());
+  for (const ImageF& plane : planes) {
+    out.emplace_back(xsize, ysize);
+    for (size_t y = 0; y < ysize; ++y) {
+      memcpy(out.back().Row(y), plane.Row(y0 + y) + x0, xsize * sizeof(float));
+    }
+  }
+  return out;
+}
+
+void ButteraugliComparator::DiffmapRegion(const size_t x0, const size_t y0,
+                                          const std::vector<ImageF>& rgb1,
+                                          ImageF& result) const {
+  PROFILER_FUNC;
+  const size_t xsize = rgb1[0].xsize();
+  const size_t ysize = rgb1[0].ysize();
   if (xsize_ < 8 || ysize_ < 8) return;
-  std::vector<ImageF> xyb0 = OpsinDynamicsImage(rgb0);
-  SeparateFrequencies(xsize_, ysize_, xyb0, pi0_);
+  assert(x0 + xsize <= xsize_ && y0 + ysize <= ysize_);
+
+  std::shared_ptr<ButteraugliReference> cropped =
+      std::make_shared<ButteraugliReference>();
+  cropped->xsize = xsize;
+  cropped->ysize = ysize;
+  cropped->pi0.uhf = CropPlanes(pi0_.uhf, x0, y0, xsize, ysize);
+  cropped->pi0.hf = CropPlanes(pi0_.hf, x0, y0, xsize, ysize);
+  cropped->pi0.mf = CropPlanes(pi0_.mf, x0, y0, xsize, ysize);
+  cropped->pi0.lf = CropPlanes(pi0_.lf, x0, y0, xsize, ysize);
+  const ButteraugliComparator region(std::move(cropped), hf_asymmetry_, pool_);
+  region.Diffmap(rgb1, result);
 }
 
 void ButteraugliComparator::Mask(std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask,
                                  std::vector<ImageF>* BUTTERAUGLI_RESTRICT
                                      mask_dc) const {
-  MaskPsychoImage(pi0_, pi0_, xsize_, ysize_, mask, mask_dc);
+  MaskPsychoImage(pi0_, pi0_, xsize_, ysize_, mask, mask_dc, pool_);
 }
 
 void ButteraugliComparator::Diffmap(const std::vector<ImageF>& rgb1,
                                     ImageF& result) const {
   PROFILER_FUNC;
   if (xsize_ < 8 || ysize_ < 8) return;
-  DiffmapOpsinDynamicsImage(OpsinDynamicsImage(rgb1), result);
+  DiffmapOpsinDynamicsImage(OpsinDynamicsImage(rgb1, pool_), result);
 }
 
 void ButteraugliComparator::DiffmapOpsinDynamicsImage(
@@ -791,7 +1058,7 @@ void ButteraugliComparator::DiffmapOpsinDynamicsImage(
   PROFILER_FUNC;
   if (xsize_ < 8 || ysize_ < 8) return;
   PsychoImage pi1;
-  SeparateFrequencies(xsize_, ysize_, xyb1, pi1);
+  SeparateFrequencies(xsize_, ysize_, xyb1, pool_, pi1);
   result = ImageF(xsize_, ysize_);
   DiffmapPsychoImage(pi1, result);
 }
@@ -844,9 +1111,8 @@ void ButteraugliComparator::DiffmapPsychoImage(const PsychoImage& pi1,
   };
 
   static const double maxclamp = 85.7047444518;
-  static const double kSigmaHfX = 10.6666499623;
   static const double w = 884.809801415;
-  SameNoiseLevels(pi0_.hf[1], pi1.hf[1], kSigmaHfX, w, maxclamp,
+  SameNoiseLevels(pi0_.hf[1], pi1.hf[1], kSigmaHfX, w, maxclamp, pool_,
                   &block_diff_ac[1]);
 
   for (int c = 0; c < 3; ++c) {
@@ -860,7 +1126,7 @@ void ButteraugliComparator::DiffmapPsychoImage(const PsychoImage& pi1,
 
   std::vector<ImageF> mask_xyb;
   std::vector<ImageF> mask_xyb_dc;
-  MaskPsychoImage(pi0_, pi1, xsize_, ysize_, &mask_xyb, &mask_xyb_dc);
+  MaskPsychoImage(pi0_, pi1, xsize_, ysize_, &mask_xyb, &mask_xyb_dc, pool_);
 
   result = CalculateDiffmap(
       CombineChannels(mask_xyb, mask_xyb_dc, block_diff_dc, block_diff_ac));
@@ -1241,7 +1507,8 @@ static void MaltaDiffMapImpl(const ImageF& lum0, const ImageF& lum1,
                              const size_t xsize_, const size_t ysize_,
                              const double w_0gt1, const double w_0lt1,
                              const double norm1, const double len,
-                             const double mulli, ImageF* block_diff_ac) {
+                             const double mulli, ThreadPool* pool,
+                             ImageF* block_diff_ac) {
   const float kWeight0 = 0.5;
   const float kWeight1 = 0.33;
 
@@ -1251,10 +1518,11 @@ static void MaltaDiffMapImpl(const ImageF& lum0, const ImageF& lum1,
   const float norm2_0lt1 = w_pre0lt1 * norm1;
 
   std::vector<float> diffs(ysize_ * xsize_);
-  for (size_t y = 0, ix = 0; y < ysize_; ++y) {
+  RunOnPool(pool, ysize_, [&](const int task, const int thread) {
+    const size_t y = task;
     const float* BUTTERAUGLI_RESTRICT const row0 = lum0.Row(y);
     const float* BUTTERAUGLI_RESTRICT const row1 = lum1.Row(y);
-    for (size_t x = 0; x < xsize_; ++x, ++ix) {
+    for (size_t x = 0, ix = y * xsize_; x < xsize_; ++x, ++ix) {
       const float absval = 0.5f * std::abs(row0[x]) + 0.5f * std::abs(row1[x]);
       const float diff = row0[x] - row1[x];
       const float scaler = norm2_0gt1 / (static_cast<float>(norm1) + absval);
@@ -1303,7 +1571,7 @@ static void MaltaDiffMapImpl(const ImageF& lum0, const ImageF& lum1,
         }
       }
     }
-  }
+  });
 
   size_t y0 = 0;
   // Top
@@ -1316,7 +1584,8 @@ static void MaltaDiffMapImpl(const ImageF& lum0, const ImageF& lum1,
   }
 
   // Middle
-  for (; y0 < ysize_ - 4; ++y0) {
+  RunOnPool(pool, ysize_ - 8, [&](const int task, const int thread) {
+    const size_t y0 = 4 + task;
     float* const BUTTERAUGLI_RESTRICT row_diff = block_diff_ac->Row(y0);
     size_t x0 = 0;
     for (; x0 < 4; ++x0) {
@@ -1332,10 +1601,10 @@ static void MaltaDiffMapImpl(const ImageF& lum0, const ImageF& lum1,
       row_diff[x0] +=
           PaddedMaltaUnit<false, Tag>(&diffs[0], x0, y0, xsize_, ysize_);
     }
-  }
+  });
 
   // Bottom
-  for (; y0 < ysize_; ++y0) {
+  for (y0 = ysize_ - 4; y0 < ysize_; ++y0) {
     float* const BUTTERAUGLI_RESTRICT row_diff = block_diff_ac->Row(y0);
     for (size_t x0 = 0; x0 < xsize_; ++x0) {
       row_diff[x0] +=
@@ -1352,7 +1621,7 @@ void ButteraugliComparator::MaltaDiffMap(
   const double len = 3.75;
   static const double mulli = 0.354191303559;
   MaltaDiffMapImpl<MaltaTag>(lum0, lum1, xsize_, ysize_, w_0gt1, w_0lt1, norm1,
-                             len, mulli, block_diff_ac);
+                             len, mulli, pool_, block_diff_ac);
 }
 
 void ButteraugliComparator::MaltaDiffMapLF(
@@ -1363,7 +1632,7 @@ void ButteraugliComparator::MaltaDiffMapLF(
   const double len = 3.75;
   static const double mulli = 0.405371989604;
   MaltaDiffMapImpl<MaltaTagLF>(lum0, lum1, xsize_, ysize_, w_0gt1, w_0lt1,
-                               norm1, len, mulli, block_diff_ac);
+                               norm1, len, mulli, pool_, block_diff_ac);
 }
 
 ImageF ButteraugliComparator::CombineChannels(
@@ -1372,7 +1641,8 @@ ImageF ButteraugliComparator::CombineChannels(
     const std::vector<ImageF>& block_diff_ac) const {
   PROFILER_FUNC;
   ImageF result(xsize_, ysize_);
-  for (size_t y = 0; y < ysize_; ++y) {
+  RunOnPool(pool_, ysize_, [&](const int task, const int thread) {
+    const size_t y = task;
     float* const BUTTERAUGLI_RESTRICT row_out = result.Row(y);
     for (size_t x = 0; x < xsize_; ++x) {
       float mask[3];
@@ -1387,7 +1657,7 @@ ImageF ButteraugliComparator::CombineChannels(
       }
       row_out[x] = (DotProduct(diff_dc, dc_mask) + DotProduct(diff_ac, mask));
     }
-  }
+  });
   return result;
 }
 
@@ -1466,13 +1736,15 @@ double MaskDcY(double delta) {
   return InterpolateClampNegative(lut.data(), lut.size(), delta);
 }
 
-ImageF DiffPrecompute(const ImageF& xyb0, const ImageF& xyb1) {
+ImageF DiffPrecompute(const ImageF& xyb0, const ImageF& xyb1,
+                      ThreadPool* pool) {
   PROFILER_FUNC;
   const size_t xsize = xyb0.xsize();
   const size_t ysize = xyb0.ysize();
   ImageF result(xsize, ysize);
-  size_t x2, y2;
-  for (size_t y = 0; y < ysize; ++y) {
+  RunOnPool(pool, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    size_t x2, y2;
     if (y + 1 < ysize) {
       y2 = y + 1;
     } else if (y > 0) {
@@ -1504,13 +1776,13 @@ ImageF DiffPrecompute(const ImageF& xyb0, const ImageF& xyb1) {
         row_out[x] = cutoff;
       }
     }
-  }
+  });
   return result;
 }
 
 void Mask(const std::vector<ImageF>& xyb0, const std::vector<ImageF>& xyb1,
           std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask,
-          std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask_dc) {
+          std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask_dc, ThreadPool* pool) {
   PROFILER_FUNC;
   const size_t xsize = xyb0[0].xsize();
   const size_t ysize = xyb0[0].ysize();
@@ -1523,35 +1795,34 @@ void Mask(const std::vector<ImageF>& xyb0, const std::vector<ImageF>& xyb1,
   double normalizer = {
       1.0 / (muls[0] + muls[1]),
   };
-  static const double r0 = 2.3770330432;
-  static const double r1 = 9.04353323561;
-  static const double r2 = 9.24456601467;
   static const double border_ratio = -0.0724948220913;
 
   {
     // X component
-    ImageF diff = DiffPrecompute(xyb0[0], xyb1[0]);
-    ImageF blurred = Blur(diff, r2, border_ratio);
+    ImageF diff = DiffPrecompute(xyb0[0], xyb1[0], pool);
+    ImageF blurred = Blur(diff, kSigmaMask2, border_ratio, pool);
     (*mask)[0] = ImageF(xsize, ysize);
-    for (size_t y = 0; y < ysize; ++y) {
+    RunOnPool(pool, ysize, [&](const int task, const int thread) {
+      const size_t y = task;
       for (size_t x = 0; x < xsize; ++x) {
         (*mask)[0].Row(y)[x] = blurred.Row(y)[x];
       }
-    }
+    });
   }
   {
     // Y component
     (*mask)[1] = ImageF(xsize, ysize);
-    ImageF diff = DiffPrecompute(xyb0[1], xyb1[1]);
-    ImageF blurred1 = Blur(diff, r0, border_ratio);
-    ImageF blurred2 = Blur(diff, r1, border_ratio);
-    for (size_t y = 0; y < ysize; ++y) {
+    ImageF diff = DiffPrecompute(xyb0[1], xyb1[1], pool);
+    ImageF blurred1 = Blur(diff, kSigmaMask0, border_ratio, pool);
+    ImageF blurred2 = Blur(diff, kSigmaMask1, border_ratio, pool);
+    RunOnPool(pool, ysize, [&](const int task, const int thread) {
+      const size_t y = task;
       for (size_t x = 0; x < xsize; ++x) {
         const double val = normalizer * (muls[0] * blurred1.Row(y)[x] +
                                          muls[1] * blurred2.Row(y)[x]);
         (*mask)[1].Row(y)[x] = val;
       }
-    }
+    });
   }
   // B component
   (*mask)[2] = ImageF(xsize, ysize);
@@ -1565,7 +1836,8 @@ void Mask(const std::vector<ImageF>& xyb0, const std::vector<ImageF>& xyb1,
   static const double w_ytob_lf = 21.6804277046;
   static const double p1_to_p0 = 0.0513061271723;
 
-  for (size_t y = 0; y < ysize; ++y) {
+  RunOnPool(pool, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
     for (size_t x = 0; x < xsize; ++x) {
       const double s0 = (*mask)[0].Row(y)[x];
       const double s1 = (*mask)[1].Row(y)[x];
@@ -1579,12 +1851,13 @@ void Mask(const std::vector<ImageF>& xyb0, const std::vector<ImageF>& xyb1,
       (*mask_dc)[1].Row(y)[x] = MaskDcY(p1);
       (*mask_dc)[2].Row(y)[x] = w_ytob_lf * MaskDcY(p1);
     }
-  }
+  });
 }
 
 void ButteraugliDiffmap(const std::vector<ImageF>& rgb0_image,
                         const std::vector<ImageF>& rgb1_image,
-                        double hf_asymmetry, ImageF& result_image) {
+                        double hf_asymmetry, ImageF& result_image,
+                        ThreadPool* pool) {
   PROFILER_FUNC;
   const size_t xsize = rgb0_image[0].xsize();
   const size_t ysize = rgb0_image[0].ysize();
@@ -1611,7 +1884,7 @@ void ButteraugliDiffmap(const std::vector<ImageF>& rgb0_image,
       }
     }
     ImageF diffmap_scaled;
-    ButteraugliDiffmap(scaled0, scaled1, hf_asymmetry, diffmap_scaled);
+    ButteraugliDiffmap(scaled0, scaled1, hf_asymmetry, diffmap_scaled, pool);
     result_image = ImageF(xsize, ysize);
     for (int y = 0; y < ysize; ++y) {
       for (int x = 0; x < xsize; ++x) {
@@ -1620,10 +1893,54 @@ void ButteraugliDiffmap(const std::vector<ImageF>& rgb0_image,
     }
     return;
   }
-  ButteraugliComparator butteraugli(rgb0_image, hf_asymmetry);
+  ButteraugliComparator butteraugli(rgb0_image, hf_asymmetry, pool);
   butteraugli.Diffmap(rgb1_image, result_image);
 }
 
+void ButteraugliDiffmapTiled(const std::vector<ImageF>& rgb0,
+                             const std::vector<ImageF>& rgb1,
+                             double hf_asymmetry, const size_t tile_size,
+                             ImageF& diffmap, ThreadPool* pool) {
+  PROFILER_FUNC;
+  const size_t xsize = rgb0[0].xsize();
+  const size_t ysize = rgb0[0].ysize();
+  if ((xsize <= tile_size && ysize <= tile_size) || xsize < 8 || ysize < 8) {
+    return ButteraugliDiffmap(rgb0, rgb1, hf_asymmetry, diffmap, pool);
+  }
+  const size_t kSupport = ButteraugliComparator::kDiffmapSupport;
+  const size_t tiles_x = (xsize + tile_size - 1) / tile_size;
+  const size_t tiles_y = (ysize + tile_size - 1) / tile_size;
+  diffmap = ImageF(xsize, ysize);
+  // Each tile is computed from a region extending kSupport beyond it, so its
+  // diffmap equals the corresponding part of the full one. The region is at
+  // least 8x8 because it is either the whole image or wider than kSupport.
+  RunOnPool(pool, tiles_x * tiles_y, [&](const int task, const int thread) {
+    const size_t x0 = (task % tiles_x) * tile_size;
+    const size_t y0 = (task / tiles_x) * tile_size;
+    const size_t x1 = std::min(xsize, x0 + tile_size);
+    const size_t y1 = std::min(ysize, y0 + tile_size);
+    const size_t region_x0 = x0 < kSupport ? 0 : x0 - kSupport;
+    const size_t region_y0 = y0 < kSupport ? 0 : y0 - kSupport;
+    const size_t region_xsize = std::min(xsize, x1 + kSupport) - region_x0;
+    const size_t region_ysize = std::min(ysize, y1 + kSupport) - region_y0;
+
+    ImageF region_diffmap;
+    {
+      const ButteraugliComparator region(
+          CropPlanes(rgb0, region_x0, region_y0, region_xsize, region_ysize),
+          hf_asymmetry);
+      region.Diffmap(
+          CropPlanes(rgb1, region_x0, region_y0, region_xsize, region_ysize),
+          region_diffmap);
+    }
+    for (size_t y = y0; y < y1; ++y) {
+      memcpy(diffmap.Row(y) + x0,
+             region_diffmap.Row(y - region_y0) + (x0 - region_x0),
+             (x1 - x0) * sizeof(float));
+    }
+  });
+}
+
 bool ButteraugliInterface(const std::vector<ImageF>& rgb0,
                           const std::vector<ImageF>& rgb1, float hf_asymmetry,
                           ImageF& diffmap, double& diffvalue) {
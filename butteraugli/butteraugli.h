@@ -34,6 +34,9 @@
 // analysis function.
 
 namespace pik {
+
+class ThreadPool;
+
 namespace butteraugli {
 
 template<typename T>
@@ -427,9 +430,41 @@ struct PsychoImage {
   std::vector<ImageF> lf;
 };
 
+// Reference-side state of ButteraugliComparator: the frequency decomposition
+// of the original image. It does not depend on hf_asymmetry, so one instance
+// can be shared (read-only) by comparators on several threads, or serialized
+// to skip its computation when comparing against the same original later.
+struct ButteraugliReference {
+  size_t xsize = 0;
+  size_t ysize = 0;
+  PsychoImage pi0;  // empty if xsize or ysize is less than 8.
+};
+using ButteraugliReferencePtr = std::shared_ptr<const ButteraugliReference>;
+
+// "pool" (if non-null) parallelizes the computation.
+ButteraugliReferencePtr ComputeButteraugliReference(
+    const std::vector<ImageF>& rgb0, ThreadPool* pool = nullptr);
+
+// Appends a host-endian representation of "reference" to "bytes".
+void SerializeButteraugliReference(const ButteraugliReference& reference,
+                                   std::vector<uint8_t>* bytes);
+
+// Returns null if bytes[0, size) is not a SerializeButteraugliReference result.
+ButteraugliReferencePtr DeserializeButteraugliReference(const uint8_t* bytes,
+                                                        size_t size);
+
 class ButteraugliComparator {
  public:
-  ButteraugliComparator(const std::vector<ImageF>& rgb0, double hf_asymmetry);
+  // If "pool" is non-null, it is used to parallelize the constructor and all
+  // Diffmap* and Mask calls. Must outlive this object.
+  ButteraugliComparator(const std::vector<ImageF>& rgb0, double hf_asymmetry,
+                        ThreadPool* pool = nullptr);
+
+  // Same as above, but reuses the precomputed state of the original image.
+  ButteraugliComparator(ButteraugliReferencePtr reference,
+                        double hf_asymmetry, ThreadPool* pool = nullptr);
+
+  const ButteraugliReferencePtr& reference() const { return reference_; }
 
   // Computes the butteraugli map between the original image given in the
   // constructor and the distorted image give here.
@@ -442,6 +477,19 @@ class ButteraugliComparator {
   // Same as above, but the frequency decomposition was already applied.
   void DiffmapPsychoImage(const PsychoImage& ps1, ImageF &result) const;
 
+  // Distance from a changed pixel (or a region border) beyond which the
+  // diffmap is unaffected, i.e. the total radius of the longest chain of
+  // blurs and filters. butteraugli.cc derives it from their radii.
+  static constexpr size_t kDiffmapSupport = 53;
+
+  // Computes the diffmap between the region of the original image whose
+  // top-left corner is (x0, y0) and rgb1, which has the size of the region.
+  // Except within kDiffmapSupport of region borders that are not also image
+  // borders, the result is identical to the corresponding part of Diffmap's
+  // result for a distorted image containing rgb1 in the region.
+  void DiffmapRegion(size_t x0, size_t y0, const std::vector<ImageF>& rgb1,
+                     ImageF& result) const;
+
   void Mask(std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask,
             std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask_dc) const;
 
@@ -468,13 +516,26 @@ class ButteraugliComparator {
   const size_t xsize_;
   const size_t ysize_;
   float hf_asymmetry_;
-  PsychoImage pi0_;
+  ThreadPool* pool_;  // not owned; may be null.
+  ButteraugliReferencePtr reference_;
+  const PsychoImage& pi0_;  // = reference_->pi0
 };
 
+// "pool" (if non-null) parallelizes the computation.
 void ButteraugliDiffmap(const std::vector<ImageF> &rgb0,
                         const std::vector<ImageF> &rgb1,
                         double hf_asymmetry,
-                        ImageF &diffmap);
+                        ImageF &diffmap, ThreadPool* pool = nullptr);
+
+// Same result as ButteraugliDiffmap, but computed independently for tiles of
+// at most tile_size x tile_size pixels (each from a region extending
+// ButteraugliComparator::kDiffmapSupport beyond it), so that the memory used
+// besides the inputs and "diffmap" is proportional to the tile size times the
+// number of threads. "pool" (if non-null) processes tiles in parallel.
+void ButteraugliDiffmapTiled(const std::vector<ImageF> &rgb0,
+                             const std::vector<ImageF> &rgb1,
+                             double hf_asymmetry, size_t tile_size,
+                             ImageF &diffmap, ThreadPool* pool = nullptr);
 
 double ButteraugliScoreFromDiffmap(const ImageF& distmap);
 
@@ -489,7 +550,8 @@ void CreateHeatMapImage(const std::vector<float> &distmap,
 void Mask(const std::vector<ImageF>& xyb0,
           const std::vector<ImageF>& xyb1,
           std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask,
-          std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask_dc);
+          std::vector<ImageF>* BUTTERAUGLI_RESTRICT mask_dc,
+          ThreadPool* pool = nullptr);
 
 template <class V>
 BUTTERAUGLI_INLINE void RgbToXyb(const V &r, const V &g, const V &b,
@@ -539,9 +601,12 @@ BUTTERAUGLI_INLINE void OpsinAbsorbance(const V &in0, const V &in1,
   *out2 = mix8 * in0 + mix9 * in1 + mix10 * in2 + mix11;
 }
 
-std::vector<ImageF> OpsinDynamicsImage(const std::vector<ImageF>& rgb);
+// "pool" (if non-null) parallelizes the computation.
+std::vector<ImageF> OpsinDynamicsImage(const std::vector<ImageF>& rgb,
+                                       ThreadPool* pool = nullptr);
 
-ImageF Blur(const ImageF& in, float sigma, float border_ratio);
+ImageF Blur(const ImageF& in, float sigma, float border_ratio,
+            ThreadPool* pool = nullptr);
 
 double SimpleGamma(double v);
 
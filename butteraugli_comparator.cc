@@ -15,13 +15,18 @@
 #include "butteraugli_comparator.h"
 
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
 #include <array>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "compiler_specific.h"
 #include "gamma_correct.h"
+#include "image_ops.h"
 #include "opsin_inverse.h"
+#include "profiler.h"
 #include "simd/simd.h"
 #include "status.h"
 
@@ -29,20 +34,19 @@ namespace pik {
 namespace SIMD_NAMESPACE {
 namespace {
 
-// REQUIRES: xsize <= srgb.xsize(), ysize <= srgb.ysize()
-std::vector<butteraugli::ImageF> SrgbToLinearRgb(
-    const int xsize, const int ysize,
-    const Image3B& srgb) {
-  PIK_ASSERT(xsize <= srgb.xsize());
-  PIK_ASSERT(ysize <= srgb.ysize());
+// REQUIRES: "rect" lies within srgb.
+std::vector<butteraugli::ImageF> SrgbToLinearRgb(const Rect& rect,
+                                                 const Image3B& srgb) {
+  PIK_ASSERT(rect.x0() + rect.xsize() <= srgb.xsize());
+  PIK_ASSERT(rect.y0() + rect.ysize() <= srgb.ysize());
   const float* lut = Srgb8ToLinearTable();
   std::vector<butteraugli::ImageF> planes =
-      butteraugli::CreatePlanes<float>(xsize, ysize, 3);
+      butteraugli::CreatePlanes<float>(rect.xsize(), rect.ysize(), 3);
   for (int c = 0; c < 3; ++c) {
-    for (size_t y = 0; y < ysize; ++y) {
-      const uint8_t* PIK_RESTRICT row_in = srgb.PlaneRow(c, y);
+    for (size_t y = 0; y < rect.ysize(); ++y) {
+      const uint8_t* PIK_RESTRICT row_in = rect.ConstRow(srgb.Plane(c), y);
       float* PIK_RESTRICT row_out = planes[c].Row(y);
-      for (size_t x = 0; x < xsize; ++x) {
+      for (size_t x = 0; x < rect.xsize(); ++x) {
         row_out[x] = lut[row_in[x]];
       }
     }
@@ -104,28 +108,213 @@ Image3F Image3FromButteraugliPlanes(
 }  // namespace
 }  // namespace
 
+namespace {
+
+// FNV-1a of the size and pixels; identifies the image for which a cached
+// reference was computed.
+uint64_t HashImage(const Image3F& image) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  const auto add = [&hash](const uint8_t* bytes, const size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+  };
+  const uint64_t sizes[2] = {image.xsize(), image.ysize()};
+  add(reinterpret_cast<const uint8_t*>(sizes), sizeof(sizes));
+  for (int c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < image.ysize(); ++y) {
+      add(reinterpret_cast<const uint8_t*>(image.ConstPlaneRow(c, y)),
+          image.xsize() * sizeof(float));
+    }
+  }
+  return hash;
+}
+
+// Returns null if the file is missing, stale or invalid.
+butteraugli::ButteraugliReferencePtr LoadReference(const std::string& path,
+                                                   const uint64_t hash) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return nullptr;
+  std::vector<uint8_t> bytes;
+  uint8_t buf[1 << 16];
+  size_t bytes_read;
+  while ((bytes_read = fread(buf, 1, sizeof(buf), f)) != 0) {
+    bytes.insert(bytes.end(), buf, buf + bytes_read);
+  }
+  fclose(f);
+
+  uint64_t stored_hash;
+  if (bytes.size() < sizeof(stored_hash)) return nullptr;
+  memcpy(&stored_hash, bytes.data(), sizeof(stored_hash));
+  if (stored_hash != hash) return nullptr;
+  return butteraugli::DeserializeButteraugliReference(
+      bytes.data() + sizeof(stored_hash), bytes.size() - sizeof(stored_hash));
+}
+
+void StoreReference(const butteraugli::ButteraugliReference& reference,
+                    const uint64_t hash, const std::string& path) {
+  std::vector<uint8_t> bytes(sizeof(hash));
+  memcpy(bytes.data(), &hash, sizeof(hash));
+  butteraugli::SerializeButteraugliReference(reference, &bytes);
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f == nullptr) return;
+  const size_t written = fwrite(bytes.data(), 1, bytes.size(), f);
+  // Do not leave a truncated file behind (it would be rejected anyway).
+  if (fclose(f) != 0 || written != bytes.size()) remove(path.c_str());
+}
+
+}  // namespace
+
+butteraugli::ButteraugliReferencePtr ComputeButteraugliReference(
+    const Image3F& opsin, ThreadPool* pool, const std::string& cache_path) {
+  PROFILER_FUNC;
+  const uint64_t hash = cache_path.empty() ? 0 : HashImage(opsin);
+  if (!cache_path.empty()) {
+    butteraugli::ButteraugliReferencePtr cached =
+        LoadReference(cache_path, hash);
+    if (cached != nullptr) return cached;
+  }
+
+  butteraugli::ButteraugliReferencePtr reference =
+      butteraugli::ComputeButteraugliReference(
+          SIMD_NAMESPACE::OpsinToLinearRgb(opsin.xsize(), opsin.ysize(),
+                                           opsin),
+          pool);
+  if (!cache_path.empty()) StoreReference(*reference, hash, cache_path);
+  return reference;
+}
+
 ButteraugliComparator::ButteraugliComparator(const Image3B& srgb,
-                                             float hf_asymmetry)
+                                             float hf_asymmetry,
+                                             ThreadPool* pool)
     : xsize_(srgb.xsize()),
       ysize_(srgb.ysize()),
-      comparator_(SIMD_NAMESPACE::SrgbToLinearRgb(xsize_, ysize_, srgb),
-                  hf_asymmetry),
+      comparator_(SIMD_NAMESPACE::SrgbToLinearRgb(Rect(0, 0, xsize_, ysize_), srgb),
+                  hf_asymmetry, pool),
       distance_(0.0),
-      distmap_(xsize_, ysize_, 0) {}
+      distmap_(xsize_, ysize_, 0),
+      pool_(pool) {}
 
 ButteraugliComparator::ButteraugliComparator(const Image3F& opsin,
-                                             float hf_asymmetry)
+                                             float hf_asymmetry,
+                                             ThreadPool* pool)
     : xsize_(opsin.xsize()),
       ysize_(opsin.ysize()),
       comparator_(SIMD_NAMESPACE::OpsinToLinearRgb(xsize_, ysize_, opsin),
-                  hf_asymmetry),
+                  hf_asymmetry, pool),
+      distance_(0.0),
+      distmap_(xsize_, ysize_, 0),
+      pool_(pool) {}
+
+ButteraugliComparator::ButteraugliComparator(
+    butteraugli::ButteraugliReferencePtr reference, float hf_asymmetry,
+    ThreadPool* pool)
+    : xsize_(reference->xsize),
+      ysize_(reference->ysize),
+      comparator_(std::move(reference), hf_asymmetry, pool),
       distance_(0.0),
-      distmap_(xsize_, ysize_, 0) {}
+      distmap_(xsize_, ysize_, 0),
+      pool_(pool) {}
 
 void ButteraugliComparator::Compare(const Image3B& srgb) {
-  comparator_.Diffmap(SIMD_NAMESPACE::SrgbToLinearRgb(xsize_, ysize_, srgb),
-                      distmap_);
-  distance_ = butteraugli::ButteraugliScoreFromDiffmap(distmap_);
+  comparator_.Diffmap(
+      SIMD_NAMESPACE::SrgbToLinearRgb(Rect(0, 0, xsize_, ysize_), srgb),
+      distmap_);
+  distance_ = ImageMax(distmap_, pool_);
+  prev_srgb_ = CopyImage(srgb);
+}
+
+void ButteraugliComparator::CompareIncremental(const Image3B& srgb) {
+  PROFILER_FUNC;
+  if (prev_srgb_.xsize() == 0 || xsize_ < 8 || ysize_ < 8) {
+    return Compare(srgb);
+  }
+  const int64_t kSupport =
+      butteraugli::ButteraugliComparator::kDiffmapSupport;
+
+  // [begin, end) of the pixels that changed in each row; begin = xsize_ if
+  // none did.
+  std::vector<int64_t> changed_begin(ysize_, xsize_);
+  std::vector<int64_t> changed_end(ysize_, 0);
+  for (int c = 0; c < 3; ++c) {
+    for (int64_t y = 0; y < ysize_; ++y) {
+      const uint8_t* PIK_RESTRICT row = srgb.PlaneRow(c, y);
+      const uint8_t* PIK_RESTRICT row_prev = prev_srgb_.PlaneRow(c, y);
+      if (memcmp(row, row_prev, xsize_) == 0) continue;
+      int64_t begin = 0;
+      while (row[begin] == row_prev[begin]) ++begin;
+      int64_t end = xsize_;
+      while (row[end - 1] == row_prev[end - 1]) --end;
+      changed_begin[y] = std::min(changed_begin[y], begin);
+      changed_end[y] = std::max(changed_end[y], end);
+    }
+  }
+
+  // Rows within kSupport of a change must be recomputed. Groups them into
+  // bands separated by unchanged rows; each band's diffmap is computed from
+  // a region extending kSupport beyond it (and its changed columns), so that
+  // the result within the band equals that of a full Compare.
+  std::vector<Rect> bands;
+  std::vector<Rect> regions;  // input for computing the bands
+  size_t region_pixels = 0;
+  int64_t y = 0;
+  while (y < ysize_) {
+    if (changed_begin[y] >= changed_end[y]) {
+      ++y;
+      continue;
+    }
+    // The band ends kSupport after the last change that is not followed by
+    // another within 2 * kSupport rows.
+    int64_t last = y;
+    int64_t x_begin = changed_begin[y];
+    int64_t x_end = changed_end[y];
+    for (int64_t next = y + 1;
+         next < ysize_ && next <= last + 2 * kSupport; ++next) {
+      if (changed_begin[next] < changed_end[next]) {
+        last = next;
+        x_begin = std::min(x_begin, changed_begin[next]);
+        x_end = std::max(x_end, changed_end[next]);
+      }
+    }
+    const int64_t band_y0 = std::max<int64_t>(0, y - kSupport);
+    const int64_t band_y1 = std::min<int64_t>(ysize_, last + 1 + kSupport);
+    const int64_t band_x0 = std::max<int64_t>(0, x_begin - kSupport);
+    const int64_t band_x1 = std::min<int64_t>(xsize_, x_end + kSupport);
+    bands.emplace_back(band_x0, band_y0, band_x1 - band_x0, band_y1 - band_y0);
+
+    const int64_t region_x0 = std::max<int64_t>(0, band_x0 - kSupport);
+    const int64_t region_y0 = std::max<int64_t>(0, band_y0 - kSupport);
+    const int64_t region_x1 = std::min<int64_t>(xsize_, band_x1 + kSupport);
+    const int64_t region_y1 = std::min<int64_t>(ysize_, band_y1 + kSupport);
+    regions.emplace_back(region_x0, region_y0, region_x1 - region_x0,
+                         region_y1 - region_y0);
+    region_pixels += regions.back().xsize() * regions.back().ysize();
+    y = last + 1;
+  }
+
+  // Not worthwhile if the regions (which may overlap) cover most pixels.
+  if (region_pixels >= size_t(xsize_) * ysize_ / 2) {
+    return Compare(srgb);
+  }
+
+  for (size_t i = 0; i < bands.size(); ++i) {
+    const Rect& band = bands[i];
+    const Rect& region = regions[i];
+    butteraugli::ImageF region_distmap;
+    comparator_.DiffmapRegion(region.x0(), region.y0(),
+                              SIMD_NAMESPACE::SrgbToLinearRgb(region, srgb),
+                              region_distmap);
+    for (size_t by = 0; by < band.ysize(); ++by) {
+      const float* PIK_RESTRICT row_in =
+          region_distmap.Row(band.y0() - region.y0() + by) +
+          (band.x0() - region.x0());
+      float* PIK_RESTRICT row_out = distmap_.Row(band.y0() + by) + band.x0();
+      memcpy(row_out, row_in, band.xsize() * sizeof(float));
+    }
+  }
+
+  distance_ = ImageMax(distmap_, pool_);
+  prev_srgb_ = CopyImage(srgb);
 }
 
 void ButteraugliComparator::Mask(Image3F* mask, Image3F* mask_dc) {
@@ -15,31 +15,61 @@
 #ifndef BUTTERAUGLI_COMPARATOR_H_
 #define BUTTERAUGLI_COMPARATOR_H_
 
+#include <string>
 #include <vector>
 
 #include "butteraugli/butteraugli.h"
+#include "data_parallel.h"
 #include "image.h"
 
 namespace pik {
 
+// Returns the reference-side state for comparisons against "opsin" (see
+// butteraugli::ButteraugliReference), e.g. for sharing between comparators of
+// several candidates. If "cache_path" is non-empty, the state stored there by
+// a previous call for the same image is reused; otherwise the computed state
+// is stored there (best-effort).
+butteraugli::ButteraugliReferencePtr ComputeButteraugliReference(
+    const Image3F& opsin, ThreadPool* pool,
+    const std::string& cache_path = std::string());
+
 class ButteraugliComparator {
  public:
-  ButteraugliComparator(const Image3B& srgb, float hf_asymmetry);
-  ButteraugliComparator(const Image3F& opsin, float hf_asymmetry);
+  // "pool" (if non-null) parallelizes the constructor and Compare*; it must
+  // outlive this object.
+  ButteraugliComparator(const Image3B& srgb, float hf_asymmetry,
+                        ThreadPool* pool);
+  ButteraugliComparator(const Image3F& opsin, float hf_asymmetry,
+                        ThreadPool* pool);
+  // Reuses state from ComputeButteraugliReference.
+  ButteraugliComparator(butteraugli::ButteraugliReferencePtr reference,
+                        float hf_asymmetry, ThreadPool* pool);
 
   void Compare(const Image3B& srgb);
 
+  // Same result as Compare, but only recomputes distmap() near pixels that
+  // differ from the image passed to the previous Compare*. Much faster if the
+  // changes are confined to a small part of the image, e.g. in later
+  // iterations of the quantization search.
+  void CompareIncremental(const Image3B& srgb);
+
   const butteraugli::ImageF& distmap() const { return distmap_; }
   float distance() const { return distance_; }
 
   void Mask(Image3F* mask, Image3F* mask_dc);
 
+  const butteraugli::ButteraugliReferencePtr& reference() const {
+    return comparator_.reference();
+  }
+
  private:
   const int xsize_;
   const int ysize_;
   butteraugli::ButteraugliComparator comparator_;
   float distance_;
   butteraugli::ImageF distmap_;
+  Image3B prev_srgb_;  // from the previous Compare*
+  ThreadPool* pool_;   // not owned; may be null.
 };
 
 }  // namespace pik
@@ -0,0 +1,118 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks that ButteraugliComparator::CompareIncremental gives exactly the
+// distmap of a full Compare after changing random rectangles of the image,
+// i.e. that butteraugli's kDiffmapSupport is large enough.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+
+#include "butteraugli_comparator.h"
+#include "data_parallel.h"
+#include "image.h"
+
+namespace pik {
+namespace {
+
+constexpr size_t kXsize = 640;
+constexpr size_t kYsize = 480;
+constexpr size_t kNumTrials = 12;
+// Small enough for CompareIncremental not to fall back to Compare.
+constexpr size_t kMaxRectSize = 64;
+
+// Smooth gradients, edges and noise, as in pik_kernels_benchmark.
+Image3B SyntheticImage(std::mt19937* rng) {
+  Image3B srgb(kXsize, kYsize);
+  for (int c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < kYsize; ++y) {
+      uint8_t* PIK_RESTRICT row = srgb.PlaneRow(c, y);
+      for (size_t x = 0; x < kXsize; ++x) {
+        const int gradient =
+            (x * (c + 1) * 255 / kXsize + y * 128 / kYsize) / 2;
+        const int edge = ((x / 37 + y / 53) % 3 == 0) ? 64 : 0;
+        const int noise = static_cast<int>((*rng)() % 17) - 8;
+        row[x] = static_cast<uint8_t>(
+            std::min(std::max(gradient + edge + noise, 0), 255));
+      }
+    }
+  }
+  return srgb;
+}
+
+// Changes the pixels of a random rectangle by up to +/- 16.
+Rect ChangeRandomRect(std::mt19937* rng, Image3B* srgb) {
+  const size_t xsize = 1 + (*rng)() % kMaxRectSize;
+  const size_t ysize = 1 + (*rng)() % kMaxRectSize;
+  const size_t x0 = (*rng)() % (kXsize - xsize + 1);
+  const size_t y0 = (*rng)() % (kYsize - ysize + 1);
+  const Rect rect(x0, y0, xsize, ysize);
+  for (int c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < ysize; ++y) {
+      uint8_t* PIK_RESTRICT row = rect.Row(srgb->MutablePlane(c), y);
+      for (size_t x = 0; x < xsize; ++x) {
+        const int delta = static_cast<int>((*rng)() % 33) - 16;
+        row[x] =
+            static_cast<uint8_t>(std::min(std::max(row[x] + delta, 0), 255));
+      }
+    }
+  }
+  return rect;
+}
+
+int RunTests() {
+  std::mt19937 rng(12345);
+  const Image3B original = SyntheticImage(&rng);
+  Image3B distorted = CopyImage(original);
+
+  ThreadPool pool;
+  ButteraugliComparator incremental(original, 1.0f, &pool);
+  ButteraugliComparator full(original, 1.0f, &pool);
+  incremental.Compare(distorted);
+
+  for (size_t trial = 0; trial < kNumTrials; ++trial) {
+    const Rect rect = ChangeRandomRect(&rng, &distorted);
+    incremental.CompareIncremental(distorted);
+    full.Compare(distorted);
+
+    for (size_t y = 0; y < kYsize; ++y) {
+      const float* PIK_RESTRICT row_expected = full.distmap().Row(y);
+      const float* PIK_RESTRICT row_actual = incremental.distmap().Row(y);
+      for (size_t x = 0; x < kXsize; ++x) {
+        if (row_expected[x] != row_actual[x]) {
+          printf("Trial %zu, changed %zu x %zu at %zu, %zu: distmap at "
+                 "%zu, %zu is %.9g instead of %.9g.\n",
+                 trial, rect.xsize(), rect.ysize(), rect.x0(), rect.y0(), x, y,
+                 row_actual[x], row_expected[x]);
+          return 1;
+        }
+      }
+    }
+    if (incremental.distance() != full.distance()) {
+      printf("Trial %zu: distance %.9g instead of %.9g.\n", trial,
+             incremental.distance(), full.distance());
+      return 1;
+    }
+  }
+  printf("CompareIncremental matched Compare in %zu trials.\n", kNumTrials);
+  return 0;
+}
+
+}  // namespace
+}  // namespace pik
+
+int main() { return pik::RunTests(); }
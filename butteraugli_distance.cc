@@ -25,12 +25,13 @@
 #include "compiler_specific.h"
 #include "gamma_correct.h"
 #include "image.h"
+#include "image_ops.h"
 
 namespace pik {
 
 float ButteraugliDistance(const Image3F& rgb0, const Image3F& rgb1,
                           float hf_asymmetry,
-                          ImageF* distmap_out) {
+                          ImageF* distmap_out, ThreadPool* pool) {
   const size_t xsize = rgb0.xsize();
   const size_t ysize = rgb0.ysize();
   const size_t row_size = xsize * sizeof(*rgb0.PlaneRow(0, 0));
@@ -48,8 +49,13 @@ float ButteraugliDistance(const Image3F& rgb0, const Image3F& rgb1,
     rgb0b.emplace_back(std::move(plane0));
     rgb1b.emplace_back(std::move(plane1));
   }
+  // Tiles bound the memory of butteraugli's intermediate images (per thread)
+  // without changing the result; they are also slightly faster due to better
+  // cache locality.
+  const size_t kTileSize = 512;
   butteraugli::ImageF distmap;
-  butteraugli::ButteraugliDiffmap(rgb0b, rgb1b, hf_asymmetry, distmap);
+  butteraugli::ButteraugliDiffmapTiled(rgb0b, rgb1b, hf_asymmetry, kTileSize,
+                                       distmap, pool);
   if (distmap_out != nullptr) {
     *distmap_out = ImageF(rgb0.xsize(), rgb0.ysize());
     for (int y = 0; y < rgb0.ysize(); ++y) {
@@ -58,34 +64,34 @@ float ButteraugliDistance(const Image3F& rgb0, const Image3F& rgb1,
       memcpy(row_out, row, rgb0.xsize() * sizeof(row[0]));
     }
   }
-  return butteraugli::ButteraugliScoreFromDiffmap(distmap);
+  return ImageMax(distmap, pool);
 }
 
 float ButteraugliDistance(const Image3B& rgb0, const Image3B& rgb1,
                           float hf_asymmetry,
-                          ImageF* distmap_out) {
+                          ImageF* distmap_out, ThreadPool* pool) {
   return ButteraugliDistance(LinearFromSrgb(rgb0),
                              LinearFromSrgb(rgb1),
                              hf_asymmetry,
-                             distmap_out);
+                             distmap_out, pool);
 }
 
 float ButteraugliDistance(const MetaImageF& rgb0, const MetaImageF& rgb1,
                           float hf_asymmetry,
-                          ImageF* distmap_out) {
+                          ImageF* distmap_out, ThreadPool* pool) {
   if (!rgb0.HasAlpha() && !rgb1.HasAlpha()) {
     return ButteraugliDistance(rgb0.GetColor(), rgb1.GetColor(),
-                               hf_asymmetry, distmap_out);
+                               hf_asymmetry, distmap_out, pool);
   }
   ImageF distmap_black, distmap_white;
   float dist_black = ButteraugliDistance(AlphaBlend(rgb0, 0),
                                          AlphaBlend(rgb1, 0),
                                          hf_asymmetry,
-                                         &distmap_black);
+                                         &distmap_black, pool);
   float dist_white = ButteraugliDistance(AlphaBlend(rgb0, 255),
                                          AlphaBlend(rgb1, 255),
                                          hf_asymmetry,
-                                         &distmap_white);
+                                         &distmap_white, pool);
   if (distmap_out != nullptr) {
     const size_t xsize = rgb0.xsize();
     const size_t ysize = rgb0.ysize();
@@ -17,6 +17,7 @@
 
 #include <vector>
 
+#include "data_parallel.h"
 #include "image.h"
 
 namespace pik {
@@ -24,16 +25,20 @@ namespace pik {
 // Returns the butteraugli distance between rgb0 and rgb1.
 // Both rgb0 and rgb1 are assumed to be in sRGB color space.
 // If distmap is not null, it must be the same size as rgb0 and rgb1.
+// If "pool" is not null, it parallelizes the comparison.
 float ButteraugliDistance(const Image3B& rgb0, const Image3B& rgb1,
-                          float hf_asymmetry, ImageF* distmap = nullptr);
+                          float hf_asymmetry, ImageF* distmap = nullptr,
+                          ThreadPool* pool = nullptr);
 
 // Same as above, but rgb0 and rgb1 are linear RGB images.
 float ButteraugliDistance(const Image3F& rgb0, const Image3F& rgb1,
-                          float hf_asymmetry, ImageF* distmap = nullptr);
+                          float hf_asymmetry, ImageF* distmap = nullptr,
+                          ThreadPool* pool = nullptr);
 
 // rgb0 and rgb1 are linear RGB images with optional alpha channel.
 float ButteraugliDistance(const MetaImageF& rgb0, const MetaImageF& rgb1,
-                          float hf_asymmetry, ImageF* distmap_out = nullptr);
+                          float hf_asymmetry, ImageF* distmap_out = nullptr,
+                          ThreadPool* pool = nullptr);
 
 }  // namespace pik
 
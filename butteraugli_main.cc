@@ -1,43 +1,160 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "image.h"
 #include "image_io.h"
 #include "butteraugli_distance.h"
+#include "data_parallel.h"
 
 static const float kHfAsymmetry = 3.14;
 
 int PrintArgHelp(int argc, char** argv) {
-  fprintf(stderr, "Usage: %s <image a> <image b>\n", argv[0]);
+  fprintf(stderr,
+          "Usage: %s [--num_threads N] <image a> <image b>\n"
+          "       %s [--num_threads N] --batch <pairs file, or - for stdin>\n"
+          "In batch mode, each line of the pairs file names two images "
+          "(separated by whitespace); the distances are written to stdout "
+          "as CSV.\n",
+          argv[0], argv[0]);
   return 1;
 }
 
-int main(int argc, char** argv) {
-  if (argc != 3) {
-    return PrintArgHelp(argc, argv);
+// Two images to compare.
+struct ImagePair {
+  std::string path_a;
+  std::string path_b;
+  pik::MetaImageF a;
+  pik::MetaImageF b;
+};
+
+// Returns false (after printing the reason) if either image cannot be read or
+// their sizes differ.
+bool LoadPair(ImagePair* pair) {
+  pair->a = pik::ReadMetaImageLinear(pair->path_a);
+  if (pair->a.xsize() == 0) {
+    fprintf(stderr, "Failed to read image from %s\n", pair->path_a.c_str());
+    return false;
   }
 
-  pik::MetaImageF a = pik::ReadMetaImageLinear(argv[1]);
-  if (a.xsize() == 0) {
-    fprintf(stderr, "Failed to read image from %s\n", argv[1]);
-    return 1;
+  pair->b = pik::ReadMetaImageLinear(pair->path_b);
+  if (pair->b.xsize() == 0) {
+    fprintf(stderr, "Failed to read image from %s\n", pair->path_b.c_str());
+    return false;
   }
 
-  pik::MetaImageF b = pik::ReadMetaImageLinear(argv[2]);
-  if (b.xsize() == 0) {
-    fprintf(stderr, "Failed to read image from %s\n", argv[2]);
-    return 1;
+  if (pair->a.xsize() != pair->b.xsize()) {
+    fprintf(stderr, "%s and %s have different widths\n", pair->path_a.c_str(),
+            pair->path_b.c_str());
+    return false;
   }
+  if (pair->a.ysize() != pair->b.ysize()) {
+    fprintf(stderr, "%s and %s have different heights\n",
+            pair->path_a.c_str(), pair->path_b.c_str());
+    return false;
+  }
+  return true;
+}
 
-  if (a.xsize() != b.xsize()) {
-    fprintf(stderr, "%s and %s have different widths\n", argv[1], argv[2]);
-    return 1;
+// Returns the pairs (without images) listed in "filename" ("-" = stdin).
+bool ReadPairList(const char* filename, std::vector<ImagePair>* pairs) {
+  FILE* f = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+  if (f == nullptr) {
+    fprintf(stderr, "Failed to open %s\n", filename);
+    return false;
   }
-  if (a.ysize() != b.ysize()) {
-    fprintf(stderr, "%s and %s have different heights\n", argv[1], argv[2]);
-    return 1;
+  char line[4096];
+  char path_a[4096];
+  char path_b[4096];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    const int num_fields = sscanf(line, "%4095s %4095s", path_a, path_b);
+    if (num_fields <= 0) continue;  // blank line
+    if (num_fields != 2) {
+      fprintf(stderr, "Expected two images per line: %s", line);
+      if (f != stdin) fclose(f);
+      return false;
+    }
+    ImagePair pair;
+    pair.path_a = path_a;
+    pair.path_b = path_b;
+    pairs->push_back(std::move(pair));
   }
+  if (f != stdin) fclose(f);
+  return true;
+}
+
+// Compares all listed pairs. The next pair is loaded while the pool computes
+// the current distance. Returns 1 if any pair could not be compared.
+int CompareBatch(const char* filename, pik::ThreadPool* pool) {
+  std::vector<ImagePair> pairs;
+  if (!ReadPairList(filename, &pairs)) return 1;
+
+  printf("image_a,image_b,distance\n");
+  if (pairs.empty()) return 0;
+
+  bool all_ok = true;
+  bool loaded = LoadPair(&pairs[0]);
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    bool next_loaded = false;
+    std::thread loader;
+    if (i + 1 < pairs.size()) {
+      loader = std::thread([&pairs, i, &next_loaded]() {
+        next_loaded = LoadPair(&pairs[i + 1]);
+      });
+    }
+
+    if (loaded) {
+      const float distance = pik::ButteraugliDistance(
+          pairs[i].a, pairs[i].b, kHfAsymmetry, nullptr, pool);
+      printf("%s,%s,%.10f\n", pairs[i].path_a.c_str(),
+             pairs[i].path_b.c_str(), distance);
+      fflush(stdout);
+    } else {
+      all_ok = false;
+    }
+    // Release memory before loading the pair after next.
+    pairs[i].a = pik::MetaImageF();
+    pairs[i].b = pik::MetaImageF();
+
+    if (loader.joinable()) loader.join();
+    loaded = next_loaded;
+  }
+  return all_ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  int num_threads = std::thread::hardware_concurrency();
+  const char* batch = nullptr;
+  std::vector<const char*> positional;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--num_threads") == 0 && i + 1 < argc) {
+      num_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+      batch = argv[++i];
+    } else {
+      positional.push_back(argv[i]);
+    }
+  }
+  if (num_threads < 0 || positional.size() != (batch == nullptr ? 2 : 0)) {
+    return PrintArgHelp(argc, argv);
+  }
+
+  pik::ThreadPool pool(num_threads);
+  if (batch != nullptr) {
+    return CompareBatch(batch, &pool);
+  }
+
+  ImagePair pair;
+  pair.path_a = positional[0];
+  pair.path_b = positional[1];
+  if (!LoadPair(&pair)) return 1;
 
-  float distance = pik::ButteraugliDistance(a, b, kHfAsymmetry, nullptr);
+  float distance =
+      pik::ButteraugliDistance(pair.a, pair.b, kHfAsymmetry, nullptr, &pool);
   printf("%.10f\n", distance);
 
   return 0;
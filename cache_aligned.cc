@@ -0,0 +1,219 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cache_aligned.h"
+
+#include <atomic>
+#include <mutex>  //NOLINT
+#include <vector>
+
+#include "os_specific.h"
+
+namespace pik {
+namespace {
+
+AllocationOptions& GetOptions() {
+  static AllocationOptions* options = new AllocationOptions;
+  return *options;
+}
+
+// For AllocationStats.
+std::atomic<size_t>& GlobalLiveBytes() {
+  static std::atomic<size_t>* live = new std::atomic<size_t>(0);
+  return *live;
+}
+std::atomic<size_t>& GlobalPeakBytes() {
+  static std::atomic<size_t>* peak = new std::atomic<size_t>(0);
+  return *peak;
+}
+
+void* AllocateRaw(const size_t size) {
+  const AllocationOptions& options = GetOptions();
+  void* allocated = options.allocate != nullptr
+                        ? options.allocate(size, options.opaque)
+                        : malloc(size);
+  if (allocated == nullptr) return nullptr;
+
+  const size_t live = GlobalLiveBytes().fetch_add(size) + size;
+  std::atomic<size_t>& peak = GlobalPeakBytes();
+  size_t prev_peak = peak.load(std::memory_order_relaxed);
+  while (live > prev_peak && !peak.compare_exchange_weak(prev_peak, live)) {
+  }
+  return allocated;
+}
+
+// "size" must match the AllocateRaw argument.
+void FreeRaw(void* allocated, const size_t size) {
+  GlobalLiveBytes().fetch_sub(size);
+  const AllocationOptions& options = GetOptions();
+  if (options.free != nullptr) {
+    return options.free(allocated, options.opaque);
+  }
+  free(allocated);
+}
+
+struct Block {
+  void* allocated;
+  size_t size;
+};
+
+// Function-local statics are safe to use during static initialization
+// (e.g. the profiler allocates its thread-specific storage).
+struct PoolState {
+  std::mutex mutex;
+  size_t num_scopes = 0;
+  size_t cached_bytes = 0;
+  std::vector<Block> blocks;
+};
+
+PoolState& GetPool() {
+  static PoolState* pool = new PoolState;
+  return *pool;
+}
+
+// Requires the mutex to be held.
+void ReleaseAllBlocks(PoolState* pool) {
+  for (const Block& block : pool->blocks) {
+    FreeRaw(block.allocated, block.size);
+  }
+  pool->blocks.clear();
+  pool->cached_bytes = 0;
+}
+
+}  // namespace
+
+AllocationPool::Scope::Scope() {
+  PoolState& pool = GetPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  if (pool.num_scopes++ == 0) {
+    pool.blocks.reserve(kMaxBlocks);
+  }
+}
+
+AllocationPool::Scope::~Scope() {
+  PoolState& pool = GetPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  PIK_ASSERT(pool.num_scopes != 0);
+  if (--pool.num_scopes == 0) {
+    ReleaseAllBlocks(&pool);
+  }
+}
+
+void* AllocationPool::Take(const size_t size,
+                           size_t* PIK_RESTRICT block_size) {
+  if (size < kMinBlockSize) return nullptr;
+  PoolState& pool = GetPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+
+  // Best fit, but reject blocks much larger than requested so that a large
+  // block remains available for the next large request.
+  const size_t max_size = size + size / 4;
+  size_t best = pool.blocks.size();
+  for (size_t i = 0; i < pool.blocks.size(); ++i) {
+    const size_t candidate = pool.blocks[i].size;
+    if (candidate < size || candidate > max_size) continue;
+    if (best == pool.blocks.size() || candidate < pool.blocks[best].size) {
+      best = i;
+    }
+  }
+  if (best == pool.blocks.size()) return nullptr;
+
+  const Block block = pool.blocks[best];
+  pool.blocks.erase(pool.blocks.begin() + best);
+  pool.cached_bytes -= block.size;
+  *block_size = block.size;
+  return block.allocated;
+}
+
+bool AllocationPool::Put(void* block, const size_t block_size) {
+  if (block_size < kMinBlockSize) return false;
+  PoolState& pool = GetPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  if (pool.num_scopes == 0) return false;
+  // Evict the oldest block: recently freed sizes are more likely to recur.
+  if (pool.blocks.size() == kMaxBlocks) {
+    FreeRaw(pool.blocks.front().allocated, pool.blocks.front().size);
+    pool.cached_bytes -= pool.blocks.front().size;
+    pool.blocks.erase(pool.blocks.begin());
+  }
+  pool.blocks.push_back(Block{block, block_size});
+  pool.cached_bytes += block_size;
+  return true;
+}
+
+size_t AllocationPool::CachedBytes() {
+  PoolState& pool = GetPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  return pool.cached_bytes;
+}
+
+size_t AllocationStats::LiveBytes() { return GlobalLiveBytes().load(); }
+
+size_t AllocationStats::PeakBytes() { return GlobalPeakBytes().load(); }
+
+void AllocationStats::SetPeakBytes(const size_t peak) {
+  GlobalPeakBytes().store(peak);
+}
+
+static_assert(sizeof(size_t) == CacheAligned::kPointerSize, "Stash size");
+
+void CacheAligned::SetOptions(const AllocationOptions& options) {
+  PIK_CHECK((options.allocate == nullptr) == (options.free == nullptr));
+  GetOptions() = options;
+}
+
+void* CacheAligned::Allocate(const size_t payload_size, const size_t offset) {
+  PIK_ASSERT(payload_size < (1ULL << 63));
+  // Layout: |<alignment> Avoid2K|<allocated>  left_padding  | <payload>
+  // Sizes : |kAlignment   offset|2*kPointerSize kMaxVectorSize| payload_size
+  //         ^allocated..........^size,stash.............payload^
+  const size_t header_size =
+      kAlignment + offset + 2 * kPointerSize + kMaxVectorSize;
+  size_t size = header_size + payload_size;
+  void* allocated = AllocationPool::Take(size, &size);
+  if (allocated == nullptr) {
+    allocated = AllocateRaw(size);
+    if (allocated == nullptr) return nullptr;
+    // Recycled blocks were already advised.
+    const size_t threshold = GetOptions().huge_page_threshold;
+    if (threshold != 0 && size >= threshold) {
+      AdviseHugePages(allocated, size);
+    }
+  }
+  uintptr_t payload = reinterpret_cast<uintptr_t>(allocated) + header_size;
+  payload &= ~(kAlignment - 1);  // round down
+  const uintptr_t stash = payload - kMaxVectorSize - kPointerSize;
+  memcpy(reinterpret_cast<void*>(stash), &allocated, kPointerSize);
+  memcpy(reinterpret_cast<void*>(stash - kPointerSize), &size, kPointerSize);
+  return reinterpret_cast<void*>(payload);
+}
+
+void CacheAligned::FreeUntyped(const void* aligned_pointer) {
+  if (aligned_pointer == nullptr) {
+    return;
+  }
+  const uintptr_t payload = reinterpret_cast<uintptr_t>(aligned_pointer);
+  PIK_ASSERT(payload % kAlignment == 0);
+  const uintptr_t stash = payload - kMaxVectorSize - kPointerSize;
+  void* allocated;
+  size_t size;
+  memcpy(&allocated, reinterpret_cast<const void*>(stash), kPointerSize);
+  memcpy(&size, reinterpret_cast<const void*>(stash - kPointerSize),
+         kPointerSize);
+  if (!AllocationPool::Put(allocated, size)) {
+    FreeRaw(allocated, size);
+  }
+}
+
+}  // namespace pik
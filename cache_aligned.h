@@ -30,6 +30,20 @@
 
 namespace pik {
 
+// Process-wide settings for CacheAligned::Allocate, which backs Image and
+// PaddedBytes.
+struct AllocationOptions {
+  // Allocations of at least this many bytes are advised to use transparent
+  // huge pages (see AdviseHugePages). 0 disables.
+  size_t huge_page_threshold = 0;
+
+  // Optional replacement for malloc/free, e.g. to use jemalloc arenas. Both
+  // or neither must be set. Must be thread-safe; "opaque" is passed through.
+  void* (*allocate)(size_t size, void* opaque) = nullptr;
+  void (*free)(void* allocated, void* opaque) = nullptr;
+  void* opaque = nullptr;
+};
+
 // Functions that depend on the cache line size.
 class CacheAligned {
  public:
@@ -40,34 +54,18 @@ class CacheAligned {
 
   // "offset" is added to the allocation size and allocated pointer in an
   // attempt to avoid 2K aliasing of consecutive allocations (e.g. Image).
-  static void* Allocate(const size_t payload_size, const size_t offset = 0) {
-    PIK_ASSERT(payload_size < (1ULL << 63));
-    // Layout: |<alignment> Avoid2K|<allocated>  left_padding  | <payload>
-    // Sizes : |kAlignment   offset|kPointerSize kMaxVectorSize| payload_size
-    //         ^allocated..........^stash...............payload^
-    const size_t header_size =
-        kAlignment + offset + kPointerSize + kMaxVectorSize;
-    void* allocated = malloc(header_size + payload_size);
-    if (allocated == nullptr) return nullptr;
-    uintptr_t payload = reinterpret_cast<uintptr_t>(allocated) + header_size;
-    payload &= ~(kAlignment - 1);  // round down
-    const uintptr_t stash = payload - kMaxVectorSize - kPointerSize;
-    memcpy(reinterpret_cast<void*>(stash), &allocated, kPointerSize);
-    return reinterpret_cast<void*>(payload);
-  }
+  // Large blocks are recycled while an AllocationPool::Scope exists.
+  static void* Allocate(const size_t payload_size, const size_t offset = 0);
+
+  // Must be called before the first allocation (e.g. at the start of main),
+  // or at least while no blocks allocated with the previous allocate/free
+  // exist, including those cached by AllocationPool.
+  static void SetOptions(const AllocationOptions& options);
 
   // Template allows freeing pointer-to-const.
   template <typename T>
   static void Free(T* aligned_pointer) {
-    if (aligned_pointer == nullptr) {
-      return;
-    }
-    const uintptr_t payload = reinterpret_cast<uintptr_t>(aligned_pointer);
-    PIK_ASSERT(payload % kAlignment == 0);
-    const uintptr_t stash = payload - kMaxVectorSize - kPointerSize;
-    void* allocated;
-    memcpy(&allocated, reinterpret_cast<const void*>(stash), kPointerSize);
-    free(allocated);
+    FreeUntyped(static_cast<const void*>(aligned_pointer));
   }
 
   // Overwrites "to_items" without loading it into cache (read-for-ownership).
@@ -96,6 +94,63 @@ class CacheAligned {
     memcpy(to, from, kCacheLineSize);
 #endif
   }
+
+ private:
+  static void FreeUntyped(const void* aligned_pointer);
+};
+
+// Caches large blocks released by CacheAligned::Free and hands them out to
+// subsequent allocations of (nearly) the same size. Encoders and decoders
+// create and destroy many same-sized Image temporaries; recycling them avoids
+// repeated malloc/munmap and the page faults of touching fresh memory.
+//
+// Only active while at least one Scope exists (e.g. for the duration of a
+// PixelsToPik or PikToPixels call); all cached blocks are freed when the last
+// Scope ends. Recycled memory is NOT zero-initialized (neither is malloc).
+// Thread-safe: blocks may be freed on different threads than they were
+// allocated on.
+class AllocationPool {
+ public:
+  // Blocks smaller than this are left to malloc, which handles them well.
+  static constexpr size_t kMinBlockSize = 64 * 1024;
+  // Upper bound on the number of cached blocks; the oldest is evicted first.
+  static constexpr size_t kMaxBlocks = 16;
+
+  class Scope {
+   public:
+    Scope();
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+
+  // Returns a cached block of at least "size" bytes and stores its actual size
+  // in "block_size", or returns nullptr if there is none.
+  static void* Take(size_t size, size_t* PIK_RESTRICT block_size);
+
+  // Returns false (and the caller must free the block) if the pool is inactive
+  // or "block_size" is too small to be worth caching.
+  static bool Put(void* block, size_t block_size);
+
+  // Total size of all cached blocks, for diagnostics.
+  static size_t CachedBytes();
+};
+
+// Accounts for all memory obtained by CacheAligned::Allocate (and thus Image
+// and PaddedBytes), including headers and blocks cached by AllocationPool, so
+// that the peak tracks RSS. Counters are thread-safe and cheap (atomics).
+class AllocationStats {
+ public:
+  // Bytes currently allocated.
+  static size_t LiveBytes();
+
+  // Largest LiveBytes since the start or the last SetPeakBytes.
+  static size_t PeakBytes();
+
+  // Restarts peak tracking from "peak" (typically LiveBytes). To measure a
+  // nested section, save PeakBytes beforehand and afterwards restore the
+  // maximum of it and the section's peak. Must not race with allocations.
+  static void SetPeakBytes(size_t peak);
 };
 
 // Avoids the need for a function pointer (deleter) in CacheAlignedUniquePtr.
@@ -29,6 +29,7 @@
 #include <utility>
 #include <vector>
 
+#include "data_parallel.h"
 #include "fast_log.h"
 
 namespace pik {
@@ -54,13 +55,44 @@ inline float ClusterCostDiff(int size_a, int size_b) {
       size_c * FastLog2(size_c);
 }
 
+// Returns the bit cost of the union of out[idx1] and out[idx2].
+template<typename HistogramType>
+float CombinedPopulationCost(const HistogramType* out, int idx1, int idx2) {
+  HistogramType combo = out[idx1];
+  combo.AddHistogram(out[idx2]);
+  return combo.PopulationCost();
+}
+
+// Sets costs[i] = CombinedPopulationCost of out[idx1] and out[idx2[i]] for
+// all i in [0, num), in parallel if "pool" is non-null. Pairs involving an
+// empty histogram do not need the cost and are skipped. This is the expensive
+// part of clustering: each call is O(alphabet size).
+template<typename HistogramType>
+void CombinedPopulationCosts(const HistogramType* out, int idx1,
+                             const int* idx2, int num, ThreadPool* pool,
+                             float* costs) {
+  const auto compute = [&](const int i, const int thread) {
+    if (idx1 != idx2[i] && out[idx1].total_count_ != 0 &&
+        out[idx2[i]].total_count_ != 0) {
+      costs[i] = CombinedPopulationCost(out, idx1, idx2[i]);
+    }
+  };
+  if (pool == nullptr) {
+    for (int i = 0; i < num; ++i) compute(i, 0);
+  } else {
+    pool->Run(0, num, compute);
+  }
+}
+
 // Computes the bit cost reduction by combining out[idx1] and out[idx2] and if
 // it is below a threshold, stores the pair (idx1, idx2) in the *pairs queue.
+// "cost_combo" is their CombinedPopulationCost, precomputed (possibly in
+// parallel) by the caller.
 template<typename HistogramType>
 void CompareAndPushToQueue(const HistogramType* out,
                            const int* cluster_size,
                            const float* bit_cost,
-                           int idx1, int idx2,
+                           int idx1, int idx2, float cost_combo,
                            std::vector<HistogramPair>* pairs) {
   if (idx1 == idx2) {
     return;
@@ -87,9 +119,6 @@ void CompareAndPushToQueue(const HistogramType* out,
   } else {
     const float threshold = pairs->empty() ? std::numeric_limits<float>::max() :
         std::max(0.0f, (*pairs)[0].cost_diff);
-    HistogramType combo = out[idx1];
-    combo.AddHistogram(out[idx2]);
-    float cost_combo = combo.PopulationCost();
     if (cost_combo + p.cost_diff < threshold) {
       p.cost_combo = cost_combo;
       store_pair = true;
@@ -113,7 +142,8 @@ int HistogramCombine(HistogramType* out,
                      float* bit_cost,
                      uint32_t* symbols,
                      int symbols_size,
-                     int max_clusters) {
+                     int max_clusters,
+                     ThreadPool* pool = nullptr) {
   float cost_diff_threshold = 0.0f;
   int min_cluster_size = 1;
 
@@ -161,11 +191,20 @@ int HistogramCombine(HistogramType* out,
   // We maintain a priority queue of histogram pairs, ordered by the bit cost
   // reduction. For efficiency, only the front of the queue matters, the rest of
   // it is unordered.
+  //
+  // The costs of all candidate pairs are computed up front (in parallel); the
+  // queue is then updated serially in the same order as before, so the result
+  // does not depend on the number of threads.
   std::vector<HistogramPair> pairs;
+  std::vector<float> costs(clusters.size());
   for (int idx1 = 0; idx1 < clusters.size(); ++idx1) {
+    const int num = clusters.size() - (idx1 + 1);
+    CombinedPopulationCosts(out, clusters[idx1], &clusters[idx1 + 1], num,
+                            pool, costs.data());
     for (int idx2 = idx1 + 1; idx2 < clusters.size(); ++idx2) {
       CompareAndPushToQueue(out, cluster_size, bit_cost,
-                            clusters[idx1], clusters[idx2], &pairs);
+                            clusters[idx1], clusters[idx2],
+                            costs[idx2 - (idx1 + 1)], &pairs);
     }
   }
 
@@ -217,9 +256,11 @@ int HistogramCombine(HistogramType* out,
     pairs.resize(copy_to - pairs.begin());
 
     // Push new pairs formed with the combined histogram to the queue.
+    CombinedPopulationCosts(out, best_idx1, clusters.data(), clusters.size(),
+                            pool, costs.data());
     for (int i = 0; i < clusters.size(); ++i) {
       CompareAndPushToQueue(out, cluster_size, bit_cost,
-                            best_idx1, clusters[i], &pairs);
+                            best_idx1, clusters[i], costs[i], &pairs);
     }
   }
   return clusters.size();
@@ -245,23 +286,41 @@ float HistogramBitCostDistance(const HistogramType& histogram,
 // Note: we assume that out[]->bit_cost_ is already up-to-date.
 template<typename HistogramType>
 void HistogramRemap(const HistogramType* in, int in_size,
-                    HistogramType* out, float* bit_cost, uint32_t* symbols) {
+                    HistogramType* out, float* bit_cost, uint32_t* symbols,
+                    ThreadPool* pool = nullptr) {
   // Uniquify the list of symbols.
   std::vector<int> all_symbols(symbols, symbols + in_size);
   std::sort(all_symbols.begin(), all_symbols.end());
   all_symbols.resize(std::unique(all_symbols.begin(), all_symbols.end()) -
                      all_symbols.begin());
 
+  // The distances do not depend on the choices for other histograms, so they
+  // are computed in parallel; only the tie-breaking below is sequential.
+  const size_t num_symbols = all_symbols.size();
+  std::vector<float> distances(in_size * num_symbols);
+  const auto compute = [&](const int i, const int thread) {
+    for (size_t k = 0; k < num_symbols; ++k) {
+      distances[i * num_symbols + k] = HistogramBitCostDistance(
+          in[i], out[all_symbols[k]], bit_cost[all_symbols[k]]);
+    }
+  };
+  if (pool == nullptr) {
+    for (int i = 0; i < in_size; ++i) compute(i, 0);
+  } else {
+    pool->Run(0, in_size, compute);
+  }
+
   for (int i = 0; i < in_size; ++i) {
+    const float* row = &distances[i * num_symbols];
     int best_out = i == 0 ? symbols[0] : symbols[i - 1];
-    float best_bits = HistogramBitCostDistance(in[i], out[best_out],
-                                               bit_cost[best_out]);
-    for (auto k : all_symbols) {
-      const float cur_bits = HistogramBitCostDistance(in[i], out[k],
-                                                      bit_cost[k]);
-      if (cur_bits < best_bits) {
-        best_bits = cur_bits;
-        best_out = k;
+    const size_t best_k =
+        std::lower_bound(all_symbols.begin(), all_symbols.end(), best_out) -
+        all_symbols.begin();
+    float best_bits = row[best_k];
+    for (size_t k = 0; k < num_symbols; ++k) {
+      if (row[k] < best_bits) {
+        best_bits = row[k];
+        best_out = all_symbols[k];
       }
     }
     symbols[i] = best_out;
@@ -301,14 +360,16 @@ void HistogramReindex(std::vector<HistogramType>* out,
 // placed in 'out', and for each index in 'in', *histogram_symbols will
 // indicate which of the 'out' histograms is the best approximation.
 // The template parameter HistogramType needs to have Clear(), AddHistogram(),
-// and PopulationCost() methods.
+// and PopulationCost() methods. If "pool" is non-null, the histogram costs
+// are computed in parallel; the result is the same as without it.
 template<typename HistogramType>
 void ClusterHistograms(const std::vector<HistogramType>& in,
                        int num_contexts, int num_blocks,
                        const std::vector<int> block_group_offsets,
                        int max_histograms,
                        std::vector<HistogramType>* out,
-                       std::vector<uint32_t>* histogram_symbols) {
+                       std::vector<uint32_t>* histogram_symbols,
+                       ThreadPool* pool = nullptr) {
   const int in_size = num_contexts * num_blocks;
   std::vector<int> cluster_size(in_size, 1);
   std::vector<float> bit_cost(in_size);
@@ -325,7 +386,7 @@ void ClusterHistograms(const std::vector<HistogramType>& in,
     for (int i = 0; i < num_blocks; ++i) {
       HistogramCombine(&(*out)[0], &cluster_size[0], &bit_cost[0],
                        &(*histogram_symbols)[i * num_contexts], num_contexts,
-                       max_histograms);
+                       max_histograms, pool);
     }
   }
 
@@ -342,11 +403,11 @@ void ClusterHistograms(const std::vector<HistogramType>& in,
       int nclusters =
           HistogramCombine(&(*out)[0], &cluster_size[0], &bit_cost[0],
                            &(*histogram_symbols)[offset], length,
-                           max_histograms);
+                           max_histograms, pool);
       // Find the optimal map from original histograms to the final ones.
       if (nclusters >= 2 && nclusters < kMinClustersForHistogramRemap) {
         HistogramRemap(&in[offset], length, &(*out)[0], &bit_cost[0],
-                       &(*histogram_symbols)[offset]);
+                       &(*histogram_symbols)[offset], pool);
       }
       num_clusters += nclusters;
     }
@@ -358,11 +419,11 @@ void ClusterHistograms(const std::vector<HistogramType>& in,
     num_clusters =
         HistogramCombine(&(*out)[0], &cluster_size[0], &bit_cost[0],
                          &(*histogram_symbols)[0], in_size,
-                         max_histograms);
+                         max_histograms, pool);
     // Find the optimal map from original histograms to the final ones.
     if (num_clusters >= 2 && num_clusters < kMinClustersForHistogramRemap) {
       HistogramRemap(&in[0], in_size, &(*out)[0], &bit_cost[0],
-                     &(*histogram_symbols)[0]);
+                     &(*histogram_symbols)[0], pool);
     }
   }
 
@@ -44,7 +44,8 @@ constexpr size_t kTileHeightInBlocks = 8;
 constexpr size_t kTileWidth = kTileWidthInBlocks * kBlockWidth;
 constexpr size_t kTileHeight = kTileHeightInBlocks * kBlockHeight;
 
-// Group is the rectangular grid of tiles that can be decoded in parallel.
+// Group is the rectangular grid of tiles that can be decoded in parallel. This
+// is the default size; see Header::kCustomGroupSize.
 constexpr size_t kGroupWidthInTiles = 8;
 constexpr size_t kGroupHeightInTiles = 8;
 constexpr size_t kGroupWidthInBlocks = kGroupWidthInTiles * kTileWidthInBlocks;
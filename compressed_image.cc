@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <cmath>
 #include <string>
 
 #define PROFILER_ENABLED 1
@@ -34,10 +35,12 @@
 #include "gauss_blur.h"
 #include "huffman_decode.h"
 #include "huffman_encode.h"
+#include "opsin_image.h"
 #include "opsin_inverse.h"
 #include "opsin_params.h"
 #include "profiler.h"
 #include "resample.h"
+#include "simd/dispatch.h"
 #include "simd/simd.h"
 #include "status.h"
 #include "upscaler.h"
@@ -56,59 +59,61 @@ struct GradientMap {
     xsizec_ = xsizeb_ + 1;
     ysizec_ = ysizeb_ + 1;
 
-    gradient_ = Image3F(xsize_, ysize_);
+    weights_x_ = SmoothWeights(xsize_);
+    weights_y_ = SmoothWeights(ysize_);
   }
 
-  static double SmoothInterpolate(double v00, double v01,
-      double v10, double v11, double x, double y) {
-    // smoothstep: prevents visible transitions and improves butteraugli score
-    x = x * x * (3 - 2 * x);
-    y = y * y * (3 - 2 * y);
-    return v00 * (1 - x) * (1 - y) + v10 * x * (1 - y) +
-           v01 * (1 - x) * y + v11 * x * y;
+  // Returns the interpolation weight of the right/lower corners for each
+  // coordinate in [0, size). smoothstep prevents visible transitions and
+  // improves the butteraugli score.
+  static std::vector<float> SmoothWeights(const size_t size) {
+    std::vector<float> weights(size);
+    for (size_t begin = 0; begin < size; begin += kNumBlocks_) {
+      const size_t end = std::min(begin + kNumBlocks_, size);
+      for (size_t i = begin; i < end; ++i) {
+        const float t = (i - begin) / static_cast<float>(end - begin);
+        weights[i] = t * t * (3.0f - 2.0f * t);
+      }
+    }
+    return weights;
   }
 
   // opsin is centered
-  void ComputeFromSource(const Image3F& opsin) {
-
+  void ComputeFromSource(const Image3F& opsin, ThreadPool* pool) {
+    PROFILER_FUNC;
     for (int c = 0; c < 3; c++) {
       corners_[c].resize(xsizec_ * ysizec_);
-      for (size_t y2 = 0; y2 < ysizec_; y2++) {
-        size_t y = std::min<size_t>(ysize_ - 1, y2 * kNumBlocks_);
+    }
+    // Quantized as in Serialize, so the acceptance test below sees the
+    // values the decoder will.
+    pool->Run(0, ysizec_, [this, &opsin](const int task, const int thread) {
+      const size_t y2 = task;
+      const size_t y = std::min<size_t>(ysize_ - 1, y2 * kNumBlocks_);
+      for (int c = 0; c < 3; c++) {
+        const float* PIK_RESTRICT row = opsin.ConstPlaneRow(c, y);
         for (size_t x2 = 0; x2 < xsizec_; x2++) {
-          size_t x = std::min<size_t>(xsize_ - 1, x2 * kNumBlocks_);
-          corners_[c][y2 * xsizec_ + x2] = opsin.PlaneRow(c, y)[x];
+          const size_t x = std::min<size_t>(xsize_ - 1, x2 * kNumBlocks_);
+          corners_[c][y2 * xsizec_ + x2] =
+              DecodeCorner(c, EncodeCorner(c, row[x]));
         }
       }
-    }
-
-    AccountForSerialization();
+    });
 
-    std::vector<uint8_t> ok[3];
-    for (int c = 0; c < 3; c++) {
-      ok[c].resize(xsizeb_ * ysizeb_);
-      for (size_t y2 = 0; y2 < ysizeb_; y2++) {
-        for (size_t x2 = 0; x2 < xsizeb_; x2++) {
-          ok[c][y2 * xsizeb_ + x2] = AcceptBlock(x2, y2, c, opsin);
-        }
-      }
-    }
-    // make all channels not-ok if any is not-ok
-    for (size_t y2 = 0; y2 < ysizeb_; y2++) {
+    // A superblock is ok only if all channels are acceptable.
+    std::vector<uint8_t> ok(xsizeb_ * ysizeb_);
+    pool->Run(0, ysizeb_, [this, &opsin, &ok](const int task,
+                                              const int thread) {
+      const size_t y2 = task;
       for (size_t x2 = 0; x2 < xsizeb_; x2++) {
-        bool all_ok = ok[0][y2 * xsizeb_ + x2] &&
-            ok[1][y2 * xsizeb_ + x2] && ok[2][y2 * xsizeb_ + x2];
-        ok[0][y2 * xsizeb_ + x2] &= all_ok;
-        ok[1][y2 * xsizeb_ + x2] &= all_ok;
-        ok[2][y2 * xsizeb_ + x2] &= all_ok;
+        ok[y2 * xsizeb_ + x2] = AcceptBlock(x2, y2, opsin);
       }
-    }
+    });
 
     // set not-ok tiles to zero in all corners so they have no effect
     for (int c = 0; c < 3; c++) {
       for (size_t y2 = 0; y2 < ysizeb_; y2++) {
         for (size_t x2 = 0; x2 < xsizeb_; x2++) {
-          if (!ok[c][y2 * xsizeb_ + x2]) {
+          if (!ok[y2 * xsizeb_ + x2]) {
             corners_[c][y2 * xsizec_ + x2] = 0;
             corners_[c][(y2 + 1) * xsizec_ + x2] = 0;
             corners_[c][y2 * xsizec_ + x2 + 1] = 0;
@@ -121,43 +126,60 @@ struct GradientMap {
     AccountForSerialization();
   }
 
-  bool AcceptBlock(size_t x2, size_t y2, int c, const Image3F& opsin) const {
+  bool AcceptBlock(size_t x2, size_t y2, const Image3F& opsin) const {
     if (x2 == 0 || y2 == 0 || x2 + 1 == xsizeb_ || y2 + 1 == ysizeb_) {
       return false;
     }
-    if (!AcceptRoughness(x2, y2, c, opsin)) return false;
-    if (!XybInRange(x2, y2, c, opsin)) return false;
+    for (int c = 0; c < 3; c++) {
+      if (!AcceptChannel(x2, y2, c, opsin)) return false;
+    }
     return true;
   }
 
-  // a metric of largest difference between two neighboring pixels
+  // Checks in a single pass over the superblock that the largest difference
+  // between two neighboring pixels is mostly small (roughness) and that the
+  // residual after subtracting the gradient stays in range.
   // TODO(user): tweak this, allow a few outliers
-  bool AcceptRoughness(size_t x2, size_t y2, int c,
-      const Image3F& opsin) const {
+  bool AcceptChannel(size_t x2, size_t y2, int c,
+                     const Image3F& opsin) const {
     size_t bx0 = x2 * kNumBlocks_;
     size_t by0 = y2 * kNumBlocks_;
     size_t bx1 = std::min<size_t>(bx0 + kNumBlocks_, xsize_);
     size_t by1 = std::min<size_t>(by0 + kNumBlocks_, ysize_);
+    const size_t width = bx1 - bx0;
 
-    static const float accept[3] = {
+    static const float accept_roughness[3] = {
       kXybRange[0] * 0.1f,
       kXybRange[1] * 0.1f,
       kXybRange[2] * 0.1f,
     };
+    static const float accept_range[3] = {
+      kXybRange[0] * 0.8f,
+      kXybRange[1] * 0.8f,
+      kXybRange[2] * 0.8f,
+    };
 
     size_t numhigh = 0;
     size_t num = 0;
-    for (size_t y = by0 + 1; y < by1; y++) {
-      for (size_t x = bx0 + 1; x < bx1; x++) {
-        float up = opsin.PlaneRow(c, y - 1)[x];
-        float left = opsin.PlaneRow(c, y)[x - 1];
-        float mid = opsin.PlaneRow(c, y)[x];
-        float d = std::max(std::abs(mid - up), std::abs(mid - left));
-        if (d > accept[c]) {
-          numhigh++;
-        }
-        num++;
+    float residuals[kNumBlocks_];
+    for (size_t y = by0; y < by1; y++) {
+      const float* PIK_RESTRICT row = opsin.ConstPlaneRow(c, y) + bx0;
+
+      memcpy(residuals, row, width * sizeof(float));
+      ApplyRow<-1>(c, y, bx0, width, residuals);
+      for (size_t x = 0; x < width; x++) {
+        if (residuals[x] < -accept_range[c]) return false;
+        if (residuals[x] > accept_range[c]) return false;
+      }
+
+      if (y == by0) continue;
+      const float* PIK_RESTRICT row_up = opsin.ConstPlaneRow(c, y - 1) + bx0;
+      for (size_t x = 1; x < width; x++) {
+        float d = std::max(std::abs(row[x] - row_up[x]),
+                           std::abs(row[x] - row[x - 1]));
+        numhigh += d > accept_roughness[c];
       }
+      num += width - 1;
     }
 
     static const float numallow[3] = { 0.05f, 0.05f, 0.05f };
@@ -165,79 +187,68 @@ struct GradientMap {
     return numhigh  < numallow[c] * num;
   }
 
-  bool XybInRange(size_t x2, size_t y2, int c, const Image3F& opsin) const {
-    size_t bx0 = x2 * kNumBlocks_;
-    size_t by0 = y2 * kNumBlocks_;
-    size_t bx1 = std::min<size_t>(bx0 + kNumBlocks_, xsize_);
-    size_t by1 = std::min<size_t>(by0 + kNumBlocks_, ysize_);
-
-    static const float accept[3] = {
-      kXybRange[0] * 0.8f,
-      kXybRange[1] * 0.8f,
-      kXybRange[2] * 0.8f,
-    };
-
-    for (size_t y = by0; y < by1; y++) {
-      for (size_t x = bx0; x < bx1; x++) {
-        float value =  opsin.PlaneRow(c, y)[x] - gradient_.PlaneRow(c, y)[x];
-        if (value < -accept[c]) return false;
-        if (value > accept[c]) return false;
+  // Adds (kSign = 1) or subtracts (kSign = -1) the gradient of image row "y"
+  // to/from "row", which holds columns [x0, x0 + xsize) of channel "c".
+  // Within each superblock, the gradient is linear in the smoothstep weights.
+  template <int kSign>
+  void ApplyRow(const int c, const size_t y, const size_t x0,
+                const size_t xsize, float* PIK_RESTRICT row) const {
+    using namespace SIMD_NAMESPACE;
+    // Vectors never straddle superblocks.
+    const Part<float, SIMD_MIN(Full<float>::N, kNumBlocks_)> d;
+    const float wy = weights_y_[y];
+    const float* PIK_RESTRICT top = &corners_[c][(y / kNumBlocks_) * xsizec_];
+    const float* PIK_RESTRICT bottom = top + xsizec_;
+    const float* PIK_RESTRICT weights_x = weights_x_.data();
+    const size_t x_end = x0 + xsize;
+    for (size_t x2 = x0 / kNumBlocks_; x2 * kNumBlocks_ < x_end; ++x2) {
+      // Vertically interpolated values at the left/right corners.
+      const float left = top[x2] + wy * (bottom[x2] - top[x2]);
+      const float right = top[x2 + 1] + wy * (bottom[x2 + 1] - top[x2 + 1]);
+      const float slope = right - left;
+      const size_t x1 = std::min(x_end, (x2 + 1) * kNumBlocks_);
+      size_t x = std::max(x0, x2 * kNumBlocks_);
+
+      const auto v_left = set1(d, left);
+      const auto v_slope = set1(d, slope);
+      for (; x + d.N <= x1; x += d.N) {
+        const auto gradient =
+            mul_add(load_unaligned(d, weights_x + x), v_slope, v_left);
+        const auto v = load_unaligned(d, row + x - x0);
+        store_unaligned(kSign > 0 ? v + gradient : v - gradient, d,
+                        row + x - x0);
       }
-    }
-    return true;
-  }
-
-  void ComputeGradientImage() {
-    for (int c = 0; c < 3; c++) {
-      for (size_t by = 0; by < ysize_; by += kNumBlocks_) {
-        size_t by0 = by;
-        size_t by1 = std::min<size_t>(by + kNumBlocks_, ysize_);
-        for (size_t bx = 0; bx < xsize_; bx += kNumBlocks_) {
-          size_t bx0 = bx;
-          size_t bx1 = std::min<size_t>(bx + kNumBlocks_, xsize_);
-          size_t x2 = bx / kNumBlocks_;
-          size_t y2 = by / kNumBlocks_;
-          float v00 = corners_[c][y2 * xsizec_ + x2];
-          float v01 = corners_[c][(y2 + 1) * xsizec_ + x2];
-          float v10 = corners_[c][(by / kNumBlocks_) * xsizec_ + x2 + 1];
-          float v11 = corners_[c][(y2 + 1) * xsizec_ + x2 + 1];
-          for (size_t y = by0; y < by1; y++) {
-            auto* row_out = gradient_.PlaneRow(c, y);
-            for (size_t x = bx0; x < bx1; x++) {
-              row_out[x] = SmoothInterpolate(v00, v01, v10, v11,
-                  (x - bx0) / (float)(bx1 - bx0),
-                  (y - by0) / (float)(by1 - by0));
-            }
-          }
-        }
+      for (; x < x1; ++x) {
+        row[x - x0] += kSign * (left + weights_x[x] * slope);
       }
     }
   }
 
   // For encoder
-  void Apply(Image3F* opsin) const {
-    for (int c = 0; c < 3; c++) {
-      for (size_t y = 0; y < ysize_; y++) {
-        float* PIK_RESTRICT row_out = opsin->PlaneRow(c, y);
-        const float* PIK_RESTRICT row_in = gradient_.ConstPlaneRow(c, y);
-        for (size_t x = 0; x < xsize_; x++) {
-          row_out[x] -= row_in[x];
-        }
+  void Apply(ThreadPool* pool, Image3F* opsin) const {
+    PROFILER_ZONE("|| gradient apply");
+    pool->Run(0, ysize_, [this, opsin](const int task, const int thread) {
+      for (int c = 0; c < 3; c++) {
+        ApplyRow<-1>(c, task, 0, xsize_, opsin->PlaneRow(c, task));
       }
-    }
+    });
   }
 
   // For decoder
-  void Unapply(Image3F* opsin) const {
-    for (int c = 0; c < 3; c++) {
-      for (size_t y = 0; y < ysize_; y++) {
-        float* PIK_RESTRICT row_out = opsin->PlaneRow(c, y);
-        const float* PIK_RESTRICT row_in = gradient_.ConstPlaneRow(c, y);
-        for (size_t x = 0; x < xsize_; x++) {
-          row_out[x] += row_in[x];
-        }
+  void Unapply(ThreadPool* pool, Image3F* opsin) const {
+    Unapply(Rect(0, 0, xsize_, ysize_), pool, opsin);
+  }
+
+  // As above, but "opsin" only covers "rect" of the image.
+  void Unapply(const Rect& rect, ThreadPool* pool, Image3F* opsin) const {
+    PROFILER_ZONE("|| gradient unapply");
+    pool->Run(0, rect.ysize(), [&rect, this, opsin](const int task,
+                                                    const int thread) {
+      for (int c = 0; c < 3; c++) {
+        ApplyRow<1>(c, rect.y0() + task, rect.x0(), rect.xsize(),
+                    opsin->PlaneRow(c, task));
       }
-    }
+    });
   }
 
   static std::vector<uint8_t> RleEncode(const std::vector<uint8_t>& v) {
@@ -294,17 +305,29 @@ struct GradientMap {
   }
 
 
+  static uint8_t EncodeCorner(const int c, const float corner) {
+    double center = kXybRange[c];
+    double range = kXybRange[c] * 2;
+    double mul = 255 / range;
+    int value = std::round((corner + center) * mul);
+    return std::min<int>(std::max<int>(0, value), 255);
+  }
+
+  static float DecodeCorner(const int c, const int value) {
+    float center = kXybRange[c];
+    float range = kXybRange[c] * 2;
+    float mul = range / 255;
+    int zerolevel = std::round((0 + center) / mul);
+    if (value == zerolevel) return 0;
+    return value * mul - center;
+  }
+
   void Serialize(PaddedBytes* compressed) const {
     std::vector<uint8_t> encoded(corners_[0].size() * 3);
     size_t pos = 0;
     for (int c = 0; c < 3; c++) {
-      double center = kXybRange[c];
-      double range = kXybRange[c] * 2;
-      double mul = 255 / range;
       for (size_t i = 0; i < corners_[c].size(); i++) {
-        int value = std::round((corners_[c][i] + center) * mul);
-        value = std::min<int>(std::max<int>(0, value), 255);
-        encoded[pos++] = value;
+        encoded[pos++] = EncodeCorner(c, corners_[c][i]);
       }
     }
     encoded = RleEncode(encoded);
@@ -324,23 +347,47 @@ struct GradientMap {
     }
     size_t pos = 0;
     for (int c = 0; c < 3; c++) {
-      float center = kXybRange[c];
-      float range = kXybRange[c] * 2;
-      float mul = range / 255;
-      int zerolevel = std::round((0 + center) / mul);
-
       corners_[c].resize(xsizec_ * ysizec_);
       for (size_t i = 0; i < corners_[c].size(); i++) {
-        int value = encoded[pos++];
-        float v = value * mul - center;
-        if (value == zerolevel) v = 0;
-        corners_[c][i] = v;
+        corners_[c][i] = DecodeCorner(c, encoded[pos++]);
       }
     }
 
     return true;  // success
   }
 
+  // Appends the serialized corners of the superblock-aligned "rect" (in
+  // blocks) of the map at "byte_pos" to "out" without dequantizing them, so
+  // the result deserializes to exactly the same corners.
+  bool CropSerialized(const PaddedBytes& compressed, size_t* byte_pos,
+                      const Rect& rect, PaddedBytes* out) const {
+    PIK_CHECK(rect.x0() % kNumBlocks_ == 0 && rect.y0() % kNumBlocks_ == 0);
+    const size_t encoded_size = xsizec_ * ysizec_ * 3;
+    const std::vector<uint8_t> encoded =
+        RleDecode(compressed.data(), compressed.size(), byte_pos, encoded_size);
+    if (encoded.size() != encoded_size) {
+      return PIK_FAILURE("failed to decode gradient map");
+    }
+    const size_t x0 = rect.x0() / kNumBlocks_;
+    const size_t y0 = rect.y0() / kNumBlocks_;
+    const size_t xsizec = DivCeil(rect.xsize(), kNumBlocks_) + 1;
+    const size_t ysizec = DivCeil(rect.ysize(), kNumBlocks_) + 1;
+    PIK_CHECK(x0 + xsizec <= xsizec_ && y0 + ysizec <= ysizec_);
+    std::vector<uint8_t> cropped;
+    cropped.reserve(xsizec * ysizec * 3);
+    for (int c = 0; c < 3; c++) {
+      for (size_t y = 0; y < ysizec; y++) {
+        const auto row = encoded.begin() + (c * ysizec_ + y0 + y) * xsizec_;
+        cropped.insert(cropped.end(), row + x0, row + x0 + xsizec);
+      }
+    }
+    cropped = RleEncode(cropped);
+    const size_t pos = out->size();
+    out->resize(pos + cropped.size());
+    memcpy(out->data() + pos, cropped.data(), cropped.size());
+    return true;
+  }
+
   // Serializes and deserializes the gradient image so it has the values the
   // decoder will see.
   void AccountForSerialization() {
@@ -348,10 +395,8 @@ struct GradientMap {
     Serialize(&compressed);
     size_t pos = 0;
     Deserialize(compressed, &pos);
-    ComputeGradientImage();
   }
 
-  Image3F gradient_;
   std::vector<float> corners_[3];  // in centered opsin
   // Size of the superblock, in amount of DCT blocks. So we operate on
   // blocks of kNumBlocks_ * kNumBlocks_ DC components, or 8x8 times as much
@@ -363,37 +408,66 @@ struct GradientMap {
   size_t ysizec_;
   size_t xsizeb_;  // num large blocks
   size_t ysizeb_;
+  // Smoothstep interpolation weights, see SmoothWeights.
+  std::vector<float> weights_x_;
+  std::vector<float> weights_y_;
 };
 
-Image3F AlignImage(const Image3F& in, const size_t N) {
-  PROFILER_FUNC;
-  const size_t xsize_blocks = DivCeil(in.xsize(), N);
-  const size_t ysize_blocks = DivCeil(in.ysize(), N);
-  const size_t xsize = N * xsize_blocks;
-  const size_t ysize = N * ysize_blocks;
-  Image3F out(xsize, ysize);
+namespace {
+
+// Replicates the last column and row of the top-left in_xsize x in_ysize
+// pixels of "out" to the rest of "out". If "in" is non-null, first copies
+// its pixels to "out".
+void CopyAndReplicateBorders(const Image3F* in, const size_t in_xsize,
+                             const size_t in_ysize, Image3F* out) {
+  const size_t xsize = out->xsize();
+  const size_t ysize = out->ysize();
   for (int c = 0; c < 3; ++c) {
-    int y = 0;
-    for (; y < in.ysize(); ++y) {
-      const float* PIK_RESTRICT row_in = in.ConstPlaneRow(c, y);
-      float* PIK_RESTRICT row_out = out.PlaneRow(c, y);
-      memcpy(row_out, row_in, in.xsize() * sizeof(row_in[0]));
-      const int lastcol = in.xsize() - 1;
-      const float lastval = row_out[lastcol];
-      for (int x = in.xsize(); x < xsize; ++x) {
+    size_t y = 0;
+    for (; y < in_ysize; ++y) {
+      float* PIK_RESTRICT row_out = out->PlaneRow(c, y);
+      if (in != nullptr) {
+        const float* PIK_RESTRICT row_in = in->ConstPlaneRow(c, y);
+        memcpy(row_out, row_in, in_xsize * sizeof(row_in[0]));
+      }
+      const float lastval = row_out[in_xsize - 1];
+      for (size_t x = in_xsize; x < xsize; ++x) {
         row_out[x] = lastval;
       }
     }
 
-    // TODO(janwas): no need to copy if we can 'extend' image: if rows are
-    // pointers to any memory? Or allocate larger image before IO?
-    const int lastrow = in.ysize() - 1;
+    const size_t lastrow = in_ysize - 1;
     for (; y < ysize; ++y) {
-      const float* PIK_RESTRICT row_in = out.ConstPlaneRow(c, lastrow);
-      float* PIK_RESTRICT row_out = out.PlaneRow(c, y);
+      const float* PIK_RESTRICT row_in = out->ConstPlaneRow(c, lastrow);
+      float* PIK_RESTRICT row_out = out->PlaneRow(c, y);
       memcpy(row_out, row_in, xsize * sizeof(row_out[0]));
     }
   }
+}
+
+}  // namespace
+
+Image3F AlignImage(const Image3F& in, const size_t N) {
+  PROFILER_FUNC;
+  const size_t xsize = N * DivCeil(in.xsize(), N);
+  const size_t ysize = N * DivCeil(in.ysize(), N);
+  Image3F out(xsize, ysize);
+  CopyAndReplicateBorders(&in, in.xsize(), in.ysize(), &out);
+  return out;
+}
+
+Image3F AlignImage(Image3F&& in, const size_t N) {
+  const size_t xsize = N * DivCeil(in.xsize(), N);
+  const size_t ysize = N * DivCeil(in.ysize(), N);
+  if (!in.CanGrowTo(xsize, ysize)) {
+    return AlignImage(static_cast<const Image3F&>(in), N);
+  }
+  PROFILER_FUNC;
+  const size_t in_xsize = in.xsize();
+  const size_t in_ysize = in.ysize();
+  Image3F out(std::move(in));
+  out.GrowTo(xsize, ysize);
+  CopyAndReplicateBorders(nullptr, in_xsize, in_ysize, &out);
   return out;
 }
 
@@ -471,8 +545,11 @@ struct Gaborish3 {
 
 }  // namespace kernel
 
-void GaborishInverse(Image3F &opsin) {
-  PROFILER_FUNC;
+namespace {
+
+// Returns the lower-right quadrant of the (unnormalized) 5x5 kernel of
+// GaborishInverse.
+void GaborishInverseWeights(float weights[9]) {
   static const double kGaborish[5] = {
     -0.095346974121859995,
     -0.049147719433952346,
@@ -493,6 +570,47 @@ void GaborishInverse(Image3F &opsin) {
     static_cast<float>(kGaborish[3]),
     static_cast<float>(kGaborish[4]),
   };
+  memcpy(weights, smooth_weights5, sizeof(smooth_weights5));
+}
+
+// Same as above, but normalized as in slow::SymmetricConvolution.
+void NormalizedGaborishInverseWeights(float weights[9]) {
+  GaborishInverseWeights(weights);
+  double sum = 0.0;
+  for (int ky = -2; ky <= 2; ++ky) {
+    for (int kx = -2; kx <= 2; ++kx) {
+      sum += weights[std::abs(ky) * 3 + std::abs(kx)];
+    }
+  }
+  const float mul = sum == 0.0 ? 1.0f : 1.0 / sum;
+  for (size_t i = 0; i < 9; ++i) {
+    weights[i] *= mul;
+  }
+}
+
+// Returns the GaborishInverse of pixel x given the five rows around it and the
+// normalized weights. Sums in the same order as slow::SymmetricConvolution.
+template <class WrapX>
+float GaborishInversePixel(const float* PIK_RESTRICT const* rows,
+                           const int64_t x, const size_t xsize,
+                           const float* PIK_RESTRICT weights) {
+  float sum = 0.0f;
+  for (int64_t ky = -2; ky <= 2; ++ky) {
+    const float* PIK_RESTRICT row = rows[ky + 2];
+    for (int64_t kx = -2; kx <= 2; ++kx) {
+      sum += row[WrapX()(x + kx, xsize)] *
+             weights[std::abs(ky) * 3 + std::abs(kx)];
+    }
+  }
+  return sum;
+}
+
+}  // namespace
+
+void GaborishInverse(Image3F &opsin) {
+  PROFILER_FUNC;
+  float smooth_weights5[9];
+  GaborishInverseWeights(smooth_weights5);
   ImageF res[3] = {ImageF(opsin.xsize(), opsin.ysize()),
                    ImageF(opsin.xsize(), opsin.ysize()),
                    ImageF(opsin.xsize(), opsin.ysize())};
@@ -505,144 +623,728 @@ void GaborishInverse(Image3F &opsin) {
   smooth.Swap(opsin);
 }
 
-Image3F ConvolveGaborish(const Image3F& in, ThreadPool* pool) {
-  PROFILER_ZONE("|| gaborish");
-  Image3F out(in.xsize(), in.ysize());
-  for (int c = 0; c < 3; ++c) {
-    using namespace SIMD_NAMESPACE;
-    ConvolveT<strategy::Symmetric3>::Run(BorderNeverUsed(), ExecutorPool(pool),
-                                         in.Plane(c), kernel::Gaborish3(),
-                                         out.MutablePlane(c));
-    out.CheckSizesSame();
-  }
+Image3F CenteredOpsin(const Image3F& opsin, const bool gaborish_inverse,
+                      ThreadPool* pool) {
+  PROFILER_ZONE("|| centered opsin");
+  const size_t in_xsize = opsin.xsize();
+  const size_t in_ysize = opsin.ysize();
+  const size_t xsize = kBlockWidth * DivCeil(in_xsize, kBlockWidth);
+  const size_t ysize = kBlockHeight * DivCeil(in_ysize, kBlockHeight);
+  Image3F out(xsize, ysize);
+
+  float weights[9];
+  NormalizedGaborishInverseWeights(weights);
+
+  // Writes row "y" of the aligned and centered plane "c" to row_out.
+  const auto centered_row = [&](const int c, const size_t y,
+                                float* PIK_RESTRICT row_out) {
+    const float* PIK_RESTRICT row_in =
+        opsin.ConstPlaneRow(c, std::min(y, in_ysize - 1));
+    const float center = kXybCenter[c];
+    for (size_t x = 0; x < in_xsize; ++x) {
+      row_out[x] = row_in[x] - center;
+    }
+    const float lastval = row_out[in_xsize - 1];
+    for (size_t x = in_xsize; x < xsize; ++x) {
+      row_out[x] = lastval;
+    }
+  };
+
+  constexpr size_t kBandHeight = 64;
+  const size_t num_bands = DivCeil(ysize, kBandHeight);
+  pool->Run(0, 3 * num_bands, [&](const int task, const int thread) {
+    const int c = task / num_bands;
+    const size_t y0 = (task % num_bands) * kBandHeight;
+    const size_t y1 = std::min(y0 + kBandHeight, ysize);
+    if (!gaborish_inverse) {
+      for (size_t y = y0; y < y1; ++y) {
+        centered_row(c, y, out.PlaneRow(c, y));
+      }
+      return;
+    }
+
+    // Centered rows y0 - 2 .. y1 + 1, clamped to the image as in
+    // GaborishInverse.
+    ImageF rows(xsize, y1 - y0 + 4);
+    for (size_t i = 0; i < rows.ysize(); ++i) {
+      const int64_t y = static_cast<int64_t>(y0 + i) - 2;
+      centered_row(c, WrapClamp()(y, ysize), rows.Row(i));
+    }
+    for (size_t y = y0; y < y1; ++y) {
+      const float* PIK_RESTRICT row_in[5];
+      for (int ky = 0; ky < 5; ++ky) {
+        row_in[ky] = rows.ConstRow(y - y0 + ky);
+      }
+      // Mirrored at the left and right border, as in GaborishInverse.
+      float* PIK_RESTRICT row_out = out.PlaneRow(c, y);
+      for (size_t x = 0; x < 2; ++x) {
+        row_out[x] =
+            GaborishInversePixel<WrapMirror>(row_in, x, xsize, weights);
+      }
+      for (size_t x = 2; x < xsize - 2; ++x) {
+        row_out[x] =
+            GaborishInversePixel<WrapUnchanged>(row_in, x, xsize, weights);
+      }
+      for (size_t x = xsize - 2; x < xsize; ++x) {
+        row_out[x] =
+            GaborishInversePixel<WrapMirror>(row_in, x, xsize, weights);
+      }
+    }
+  });
   return out;
 }
 
-// Avoid including <functional> for such tiny functions.
-struct Plus {
-  constexpr float operator()(const float first, const float second) const {
-    return first + second;
-  }
-};
-struct Minus {
-  constexpr float operator()(const float first, const float second) const {
-    return first - second;
+namespace {
+
+// TFGraph node: the block-aligned and centered opsin (see CenteredOpsin) of
+// its output region. Pixels within two of the aligned image, i.e. the borders
+// read by GaborishInverseNode, are mirrored (x) or clamped (y) as in
+// GaborishInverse; pixels further outside are never used. The source covers
+// the same region.
+struct CenterOpsinNode {
+  void operator()(const ConstImageViewF* PIK_RESTRICT in,
+                  const OutputRegion& region,
+                  const MutableImageViewF* PIK_RESTRICT out) const {
+    const int64_t x0 = region.x;
+    const int64_t y0 = region.y;
+    const int64_t out_xsize = region.xsize;
+    const int64_t out_ysize = region.ysize;
+    // Buffer coordinates of the opsin pixel read for output pixel "x" or "y".
+    const auto source_x = [&](const int64_t x) {
+      const int64_t mirrored = Mirror(
+          std::min(std::max<int64_t>(x0 + x, -2), xsize + 1), xsize);
+      const int64_t in_x = std::min(mirrored, in_xsize - 1) - x0;
+      return std::min(std::max<int64_t>(in_x, 0), out_xsize - 1);
+    };
+    const auto source_y = [&](const int64_t y) {
+      const int64_t clamped = WrapClamp()(y0 + y, ysize);
+      const int64_t in_y = std::min(clamped, in_ysize - 1) - y0;
+      return std::min(std::max<int64_t>(in_y, 0), out_ysize - 1);
+    };
+    // Output pixels that are opsin pixels.
+    const int64_t begin = std::min(std::max<int64_t>(-x0, 0), out_xsize);
+    const int64_t end = std::max(begin, std::min(in_xsize - x0, out_xsize));
+
+    for (int c = 0; c < 3; ++c) {
+      const float center = kXybCenter[c];
+      for (int64_t y = 0; y < out_ysize; ++y) {
+        const float* PIK_RESTRICT row_in = in[c].ConstRow(source_y(y));
+        float* PIK_RESTRICT row_out = out[c].Row(y);
+        for (int64_t x = 0; x < begin; ++x) {
+          row_out[x] = row_in[source_x(x)] - center;
+        }
+        for (int64_t x = begin; x < end; ++x) {
+          row_out[x] = row_in[x] - center;
+        }
+        for (int64_t x = end; x < out_xsize; ++x) {
+          row_out[x] = row_in[source_x(x)] - center;
+        }
+      }
+    }
   }
-};
 
-// Adds/subtracts all AC coefficients to "out"; leaves DC unchanged.
-template <class Operator>  // Plus/Minus
-void InjectExceptDC(const Image3F& what, Image3F* out) {
-  const size_t xsize = what.xsize();
-  const size_t ysize = what.ysize();
-  PIK_CHECK(xsize % kBlockSize == 0);
-  const Operator op;
+  int64_t in_xsize;  // of the opsin image
+  int64_t in_ysize;
+  int64_t xsize;  // of the aligned image
+  int64_t ysize;
+};
 
-  for (int c = 0; c < 3; ++c) {
-    for (size_t y = 0; y < ysize; ++y) {
-      const float* PIK_RESTRICT row_what = what.ConstPlaneRow(c, y);
-      float* PIK_RESTRICT row_out = out->PlaneRow(c, y);
-      for (size_t bx = 0; bx < xsize; bx += kBlockSize) {
-        for (size_t x = 1; x < kBlockSize; ++x) {
-          row_out[bx + x] = op(row_out[bx + x], row_what[bx + x]);
+// TFGraph node: GaborishInverse of its input, which has two pixels of border.
+struct GaborishInverseNode {
+  void operator()(const ConstImageViewF* PIK_RESTRICT in,
+                  const OutputRegion& region,
+                  const MutableImageViewF* PIK_RESTRICT out) const {
+    for (int c = 0; c < 3; ++c) {
+      for (int64_t y = 0; y < region.ysize; ++y) {
+        const float* PIK_RESTRICT rows[5];
+        for (int64_t ky = 0; ky < 5; ++ky) {
+          rows[ky] = in[c].ConstRow(y + ky - 2);
+        }
+        float* PIK_RESTRICT row_out = out[c].Row(y);
+        for (int64_t x = 0; x < region.xsize; ++x) {
+          row_out[x] =
+              GaborishInversePixel<WrapUnchanged>(rows, x, 0, weights);
         }
       }
     }
   }
+
+  float weights[9];  // normalized
+};
+
+}  // namespace
+
+Image3F CenteredOpsinDCT(const Image3F& opsin, const bool gaborish_inverse,
+                         ThreadPool* pool) {
+  PROFILER_ZONE("centered opsin DCT");
+  const size_t xsize = kBlockWidth * DivCeil(opsin.xsize(), kBlockWidth);
+  const size_t ysize = kBlockHeight * DivCeil(opsin.ysize(), kBlockHeight);
+  Image3F coeffs(xsize * kBlockWidth, ysize / kBlockHeight);
+
+  TFBuilder builder;
+  TFNode* src_opsin = builder.AddSource("src_opsin", 3, TFType::kF32);
+  builder.SetSource(src_opsin, &opsin);
+  // Each 64x1 row of coefficients reads one 8x8 block of pixels.
+  const Scale block_to_pixels(-3, 3);
+  const CenterOpsinNode center = {
+      static_cast<int64_t>(opsin.xsize()), static_cast<int64_t>(opsin.ysize()),
+      static_cast<int64_t>(xsize), static_cast<int64_t>(ysize)};
+  TFNode* node = builder.AddClosure(
+      "center", Borders(), gaborish_inverse ? Scale() : block_to_pixels,
+      {src_opsin}, 3, TFType::kF32, center);
+  if (gaborish_inverse) {
+    GaborishInverseNode inverse;
+    NormalizedGaborishInverseWeights(inverse.weights);
+    node = builder.AddClosure("gaborish_inv", Borders(2), block_to_pixels,
+                              {node}, 3, TFType::kF32, inverse);
+  }
+  node = AddTransposedScaledDCT(node, &builder);
+  builder.SetSink(node, &coeffs);
+  builder
+      .Finalize(ImageSize::Make(coeffs.xsize(), coeffs.ysize()),
+                ImageSize{kTileWidth * kBlockWidth, kTileHeight / kBlockHeight},
+                pool)
+      ->Run();
+  return coeffs;
 }
 
-std::vector<float> DCfiedGaussianKernel(float sigma) {
-  std::vector<float> result(3, 0.0);
-  std::vector<float> hires = GaussianKernel<float>(8, sigma);
-  for (int i = 0; i < 8; i++) {
-    for (int j = 0; j < hires.size(); j++) {
-      result[(i + j) / 8] += hires[j] / 8.0;
-    }
+namespace {
+
+// Convolves one row with the symmetric 3x3 Gaborish3 kernel. "row_t/m/b" are
+// the (unmodified) rows above, at and below; row_out may alias none of them.
+// The image is mirrored at the left/right, as in ConvolveT.
+void GaborishRow(const float* PIK_RESTRICT row_t,
+                 const float* PIK_RESTRICT row_m,
+                 const float* PIK_RESTRICT row_b, const size_t xsize,
+                 float* PIK_RESTRICT row_out) {
+  const Weights3x3& weights = kernel::Gaborish3().Weights();
+  const float w0 = weights.mc[0];
+  const float w1 = weights.tc[0];
+  const float w2 = weights.tl[0];
+  const auto convolve = [&](const size_t xl, const size_t x, const size_t xr) {
+    const float sides = row_m[xl] + row_m[xr] + row_t[x] + row_b[x];
+    const float corners = row_t[xl] + row_t[xr] + row_b[xl] + row_b[xr];
+    return w0 * row_m[x] + w1 * sides + w2 * corners;
+  };
+  if (xsize == 1) {
+    row_out[0] = convolve(0, 0, 0);
+    return;
   }
-  return result;
+  row_out[0] = convolve(0, 0, 1);
+  for (size_t x = 1; x < xsize - 1; ++x) {
+    row_out[x] = convolve(x - 1, x, x + 1);
+  }
+  row_out[xsize - 1] = convolve(xsize - 2, xsize - 1, xsize - 1);
 }
 
-// Called from local static ctor.
-kernel::Custom<3> MakeUpsampleKernel() {
-  Image3F impulse_dc(20, 20);
-  FillImage(0.0f, &impulse_dc);
-  impulse_dc.PlaneRow(0, 10)[10] = 1.0;
-  Image3F probe_expected = UpscalerReconstruct(impulse_dc);
-  // We are trying to extract a kernel with a smaller radius. This kernel will
-  // be unnormalized. However, we don't mind that: the encoder will compensate
-  // when encoding.
-  auto kernel6 = kernel::Custom<3>::FromResult(probe_expected.Plane(0));
+}  // namespace
 
-  ImageF probe_test(probe_expected.xsize(), probe_expected.ysize());
-  Upsample<GeneralUpsampler8_6x6>(ExecutorLoop(), impulse_dc.Plane(0), kernel6,
-                                  &probe_test);
-  VerifyRelativeError(probe_expected.Plane(0), probe_test, 5e-2, 5e-2);
+void ConvolveGaborish(ThreadPool* pool, Image3F* PIK_RESTRICT opsin) {
+  PROFILER_ZONE("|| gaborish");
+  const size_t xsize = opsin->xsize();
+  const size_t ysize = opsin->ysize();
+  if (xsize == 0 || ysize == 0) return;
+  constexpr size_t kBandHeight = 64;
+  const size_t num_bands = DivCeil(ysize, kBandHeight);
+
+  // Each band overwrites its rows, so first save the (mirrored) rows just
+  // above and below each band, which are owned by the neighboring bands.
+  Image3F boundary(xsize, 2 * num_bands);
+  for (int c = 0; c < 3; ++c) {
+    for (size_t band = 0; band < num_bands; ++band) {
+      const size_t y0 = band * kBandHeight;
+      const size_t y1 = std::min(y0 + kBandHeight, ysize);
+      const size_t y_above = (y0 == 0) ? 0 : y0 - 1;
+      const size_t y_below = (y1 == ysize) ? ysize - 1 : y1;
+      memcpy(boundary.PlaneRow(c, 2 * band + 0),
+             opsin->ConstPlaneRow(c, y_above), xsize * sizeof(float));
+      memcpy(boundary.PlaneRow(c, 2 * band + 1),
+             opsin->ConstPlaneRow(c, y_below), xsize * sizeof(float));
+    }
+  }
 
-  return kernel6;
+  pool->Run(0, 3 * num_bands, [&](const int task, const int thread) {
+    const int c = task / num_bands;
+    const size_t band = task % num_bands;
+    const size_t y0 = band * kBandHeight;
+    const size_t y1 = std::min(y0 + kBandHeight, ysize);
+    // Rolling copies of the unmodified previous and current row.
+    ImageF saved(xsize, 2);
+    float* PIK_RESTRICT row_prev = saved.Row(0);
+    float* PIK_RESTRICT row_cur = saved.Row(1);
+    memcpy(row_prev, boundary.ConstPlaneRow(c, 2 * band + 0),
+           xsize * sizeof(float));
+    for (size_t y = y0; y < y1; ++y) {
+      float* PIK_RESTRICT row = opsin->PlaneRow(c, y);
+      memcpy(row_cur, row, xsize * sizeof(float));
+      const float* row_next;
+      if (y + 1 < y1) {
+        row_next = opsin->ConstPlaneRow(c, y + 1);
+      } else {
+        row_next = (y1 == ysize) ? row_cur
+                                 : boundary.ConstPlaneRow(c, 2 * band + 1);
+      }
+      GaborishRow(row_prev, row_cur, row_next, xsize, row);
+      std::swap(row_prev, row_cur);
+    }
+  });
 }
 
-template <class Image>  // ImageF or Image3F
-Image BlurUpsampleDC(const Image& original_dc, ThreadPool* pool) {
-  const ExecutorPool executor(pool);
-  Image out(original_dc.xsize() * kBlockWidth,
-            original_dc.ysize() * kBlockHeight);
-  // TODO(user): In the encoder we want only the DC of the result. That could
-  // be done more quickly.
-  static auto kernel6 = MakeUpsampleKernel();
-  Upsample<GeneralUpsampler8_6x6>(executor, original_dc, kernel6, &out);
-  return out;
-}
+namespace {
 
-// Returns DCT(blur) - original_dc
-Image3F BlurUpsampleDCAndDCT(const Image3F& original_dc, ThreadPool* pool) {
-  Image3F blurred = BlurUpsampleDC(original_dc, pool);
-  Image3F dct = TransposedScaledDCT(blurred, pool);
-  for (int c = 0; c < 3; c++) {
-    for (size_t y = 0; y < dct.ysize(); y++) {
-      float* PIK_RESTRICT dct_row = dct.PlaneRow(c, y);
-      const float* PIK_RESTRICT original_dc_row =
-          original_dc.ConstPlaneRow(c, y);
-      for (size_t dct_x = 0, x = 0; dct_x < dct.xsize(); dct_x += kBlockSize) {
-        dct_row[dct_x] -= original_dc_row[x++];
+// TFGraph node: copies its input and replaces the pixels just outside the
+// image with mirrored pixels, which is what ConvolveT reads there when
+// convolving an entire image.
+struct MirrorOutsideImage {
+  void operator()(const ConstImageViewF* PIK_RESTRICT in,
+                  const OutputRegion& region,
+                  const MutableImageViewF* PIK_RESTRICT out) const {
+    // Buffer coordinates of the column/row just outside each side.
+    const int64_t left = -1 - region.x;
+    const int64_t right = static_cast<int64_t>(xsize) - region.x;
+    const int64_t top = -1 - region.y;
+    const int64_t bottom = static_cast<int64_t>(ysize) - region.y;
+    const int64_t out_xsize = region.xsize;
+    const int64_t out_ysize = region.ysize;
+    for (int c = 0; c < 3; ++c) {
+      for (int64_t y = 0; y < out_ysize; ++y) {
+        const float* PIK_RESTRICT row_in = in[c].ConstRow(y);
+        float* PIK_RESTRICT row_out = out[c].Row(y);
+        if (row_in != row_out) {
+          memcpy(row_out, row_in, out_xsize * sizeof(float));
+        }
+        if (left >= 0 && left + 1 < out_xsize) {
+          row_out[left] = row_out[left + 1];
+        }
+        if (right >= 1 && right < out_xsize) {
+          row_out[right] = row_out[right - 1];
+        }
+      }
+      if (top >= 0 && top + 1 < out_ysize) {
+        memcpy(out[c].Row(top), out[c].Row(top + 1),
+               out_xsize * sizeof(float));
+      }
+      if (bottom >= 1 && bottom < out_ysize) {
+        memcpy(out[c].Row(bottom), out[c].Row(bottom - 1),
+               out_xsize * sizeof(float));
       }
     }
   }
-  return dct;
-}
 
-// Called by local static ctor.
-std::vector<float> MakeSharpenKernel() {
-  // TODO(user): With the new blur, this makes no sense.
-  std::vector<float> blur_kernel = DCfiedGaussianKernel(5.5);
-  constexpr int kSharpenKernelSize = 3;
-  std::vector<float> sharpen_kernel(kSharpenKernelSize);
-  InvertConvolution(&blur_kernel[0], blur_kernel.size(), &sharpen_kernel[0],
-                    sharpen_kernel.size());
-  return sharpen_kernel;
-}
+  size_t xsize;  // of the entire image
+  size_t ysize;
+};
 
-// Returns true if L1(residual) < max_error.
-bool AddResidualAndCompare(const ImageF& dc, const ImageF& blurred_dc,
-                           const float max_error,
-                           ImageF* PIK_RESTRICT dc_to_encode) {
-  PIK_CHECK(SameSize(dc, blurred_dc) && SameSize(dc, *dc_to_encode));
-  const size_t xsize = dc.xsize();
-  const size_t ysize = dc.ysize();
-  bool all_less = true;
-  for (size_t y = 0; y < ysize; ++y) {
-    const float* PIK_RESTRICT row_dc = dc.ConstRow(y);
-    const float* PIK_RESTRICT row_blurred = blurred_dc.ConstRow(y);
-    float* PIK_RESTRICT row_out = dc_to_encode->Row(y);
-    for (size_t x = 0; x < xsize; ++x) {
-      const float diff = row_dc[x] - row_blurred[x];
-      all_less &= fabsf(diff) < max_error;
-      row_out[x] += diff;
+// TFGraph node: adds the second three inputs to the first three.
+void AddSpatialFunc(const void*, const ConstImageViewF* PIK_RESTRICT in,
+                    const OutputRegion& region,
+                    const MutableImageViewF* PIK_RESTRICT out) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  for (int c = 0; c < 3; ++c) {
+    for (uint32_t y = 0; y < region.ysize; ++y) {
+      const float* PIK_RESTRICT row_pixels = in[c].ConstRow(y);
+      const float* PIK_RESTRICT row_add = in[3 + c].ConstRow(y);
+      float* PIK_RESTRICT row_out = out[c].Row(y);
+      for (uint32_t x = 0; x < region.xsize; x += d.N) {
+        const auto pixels = load(d, row_pixels + x);
+        const auto add = load(d, row_add + x);
+        store(pixels + add, d, row_out + x);
+      }
     }
   }
-  return all_less;
 }
 
-Image3F SharpenDC(const Image3F& original_dc, ThreadPool* pool) {
+// Grayscale images only code Y; replaces X and B (which the decoder set to
+// zero) with those of the gray with the same Y.
+void GrayFromYFunc(const void*, const ConstImageViewF* PIK_RESTRICT in,
+                   const OutputRegion& region,
+                   const MutableImageViewF* PIK_RESTRICT out) {
+  for (uint32_t y = 0; y < region.ysize; ++y) {
+    const float* PIK_RESTRICT row_y = in[1].ConstRow(y);
+    float* PIK_RESTRICT row_out_y = out[1].Row(y);
+    if (row_out_y != row_y) {
+      memcpy(row_out_y, row_y, region.xsize * sizeof(float));
+    }
+    GrayXybFromY(row_out_y, region.xsize, out[0].Row(y), out[2].Row(y));
+  }
+}
+
+// TFGraph node: used if no other node would process the (already IDCT-ed)
+// source, which TFBuilder cannot also bind as the sink.
+void CopyFunc(const void*, const ConstImageViewF* PIK_RESTRICT in,
+              const OutputRegion& region,
+              const MutableImageViewF* PIK_RESTRICT out) {
+  for (int c = 0; c < 3; ++c) {
+    for (uint32_t y = 0; y < region.ysize; ++y) {
+      memcpy(out[c].Row(y), in[c].ConstRow(y), region.xsize * sizeof(float));
+    }
+  }
+}
+
+// Returns the ReconTiles graph (see below) with "coeffs", "add_spatial",
+// composite->alpha and "out" bound; the graph otherwise only depends on the
+// arguments of ReconGraphKey and the image size.
+template <typename T>
+TFGraphPtr BuildReconGraph(const Header& header, const Image3F& coeffs,
+                           const Image3F* add_spatial, const bool to_srgb,
+                           const bool dither, const SampleEncoding encoding,
+                           const ColorPrimaries primaries,
+                           const bool idct_done,
+                           const AlphaComposite* composite, ThreadPool* pool,
+                           Image3<T>* out) {
+  const size_t xsize = out->xsize();
+  const size_t ysize = out->ysize();
+  TFBuilder builder;
+  // Each 8x8 output block reads one 64x1 row of coefficients.
+  TFNode* src_coeffs =
+      builder.AddSource("src_coeffs", 3, TFType::kF32, TFWrap::kZero,
+                        idct_done ? Scale() : Scale(3, -3));
+  builder.SetSource(src_coeffs, &coeffs);
+  TFNode* src_add = nullptr;
+  if (add_spatial != nullptr) {
+    src_add = builder.AddSource("src_add", 3, TFType::kF32);
+    builder.SetSource(src_add, add_spatial);
+  }
+  TFNode* src_alpha = nullptr;
+  if (composite != nullptr) {
+    src_alpha = builder.AddSource("src_alpha", 1, TFType::kU16);
+    builder.SetSource(src_alpha, composite->alpha);
+  }
+
+  TFNode* node = src_coeffs;
+  if (!idct_done) {
+    node = AddTransposedScaledIDCT(src_coeffs, add_spatial != nullptr,
+                                   &builder);
+  }
+  if (src_add != nullptr) {
+    node = builder.Add("add", Borders(), Scale(), {node, src_add}, 3,
+                       TFType::kF32, &AddSpatialFunc);
+  }
+
+  if (header.flags & Header::kGaborishTransform) {
+    node = builder.AddClosure("mirror", Borders(), Scale(), {node}, 3,
+                              TFType::kF32, MirrorOutsideImage{xsize, ysize});
+    // A whole block of border keeps the IDCT input aligned to blocks.
+    node = builder.AddClosure(
+        "gaborish", Borders(kBlockWidth), Scale(), {node}, 3, TFType::kF32,
+        [](const ConstImageViewF* in, const OutputRegion& region,
+           const MutableImageViewF* out) {
+          using namespace SIMD_NAMESPACE;
+          for (int c = 0; c < 3; ++c) {
+            ConvolveT<strategy::Symmetric3>::RunView(
+                in + c, kernel::Gaborish3(), BorderAlreadyValid(), region,
+                out + c);
+          }
+        });
+  }
+
+  if (header.flags & Header::kGrayscale) {
+    node = builder.Add("gray", Borders(), Scale(), {node}, 3, TFType::kF32,
+                       &GrayFromYFunc);
+  }
+
+  if (src_alpha != nullptr) {
+    node = AddCenteredOpsinToCompositedSrgb(node, src_alpha, dither,
+                                            *composite, &builder, primaries);
+  } else if (to_srgb) {
+    node = AddCenteredOpsinToSrgb(node, dither, TFTypeUtils::FromT(T()),
+                                  &builder, encoding, primaries);
+  }
+  if (node == src_coeffs) {
+    node = builder.Add("copy", Borders(), Scale(), {node}, 3, TFType::kF32,
+                       &CopyFunc);
+  }
+  builder.SetSink(node, out);
+
+  return builder.Finalize(ImageSize::Make(xsize, ysize),
+                          ImageSize{kTileWidth, kTileHeight}, pool);
+}
+
+// Identifies a ReconTiles graph for TFGraphCache (which also compares sizes).
+uint64_t ReconGraphKey(const Header& header, const bool has_add_spatial,
+                       const bool to_srgb, const bool dither,
+                       const SampleEncoding encoding,
+                       const ColorPrimaries primaries, const TFType out_type,
+                       const bool idct_done, const AlphaComposite* composite) {
+  uint64_t key = 0;
+  if (composite != nullptr) {
+    // The node copies these (as its argument).
+    key = (1 << 13) | (composite->alpha_bits << 8) | composite->background;
+  }
+  key = (key << 8) | static_cast<uint64_t>(out_type);
+  key = (key << 8) | static_cast<uint64_t>(encoding);
+  key = (key << 2) | static_cast<uint64_t>(primaries);
+  key = (key << 1) | has_add_spatial;
+  key = (key << 1) | to_srgb;
+  key = (key << 1) | dither;
+  key = (key << 1) | idct_done;
+  key = (key << 1) | ((header.flags & Header::kGaborishTransform) != 0);
+  key = (key << 1) | ((header.flags & Header::kGrayscale) != 0);
+  return key;
+}
+
+// Reconstructs the image from "coeffs" (with predictions already applied),
+// plus "add_spatial" if non-null, in which case the DC is ignored (as
+// required for kSmoothDCPred). Runs the IDCT, optional Gaborish and, if
+// "to_srgb", the color conversion (to "encoding" and "primaries") as a single
+// TFGraph, so that
+// intermediate images only exist as cache-sized tiles. T must be float unless
+// "to_srgb". The graph is taken from (or added to) "graphs", so successive
+// same-sized images only rebind it.
+// If "sink" is non-null, the graph runs one group row at a time and passes
+// each (clamped to the header size) to the sink. If "idct_done", "coeffs" is
+// instead the (predicted) IDCT output and "add_spatial" must be null. If
+// "composite" is non-null, the (U8) color conversion also composites with
+// its alpha, which must have the size of "out".
+template <typename T>
+void ReconTiles(const Header& header, const Image3F& coeffs,
+                const Image3F* add_spatial, const bool to_srgb,
+                const bool dither, const SampleEncoding encoding,
+                const ColorPrimaries primaries, ThreadPool* pool,
+                TFGraphCache* graphs, Image3<T>* out,
+                const ImageRowsSink<T>* sink = nullptr,
+                const bool idct_done = false,
+                const AlphaComposite* composite = nullptr) {
+  PROFILER_ZONE("recon tiles");
+  const size_t xsize = idct_done ? coeffs.xsize() : coeffs.xsize() / kBlockWidth;
+  const size_t ysize =
+      idct_done ? coeffs.ysize() : coeffs.ysize() * kBlockHeight;
+  PIK_CHECK(idct_done ? add_spatial == nullptr
+                      : coeffs.xsize() % kBlockSize == 0);
+  if (add_spatial != nullptr) {
+    PIK_CHECK(add_spatial->xsize() == xsize && add_spatial->ysize() == ysize);
+  }
+  *out = Image3<T>(xsize, ysize);
+  if (composite != nullptr) {
+    PIK_CHECK(to_srgb && TFTypeUtils::FromT(T()) == TFType::kU8);
+    PIK_CHECK(SameSize(*out, *composite->alpha));
+  }
+
+  const uint64_t key =
+      ReconGraphKey(header, add_spatial != nullptr, to_srgb, dither, encoding,
+                    primaries, TFTypeUtils::FromT(T()), idct_done, composite);
+  const ImageSize sink_size = ImageSize::Make(xsize, ysize);
+  const ImageSize tile_size{kTileWidth, kTileHeight};
+  TFGraph* graph = graphs->Find(key, sink_size, tile_size, pool);
+  if (graph == nullptr) {
+    graph = graphs->Add(key, sink_size, tile_size, pool,
+                        BuildReconGraph(header, coeffs, add_spatial, to_srgb,
+                                        dither, encoding, primaries, idct_done,
+                                        composite, pool, out));
+  } else {
+    TFBindings bindings;
+    bindings.AddSource(&coeffs);
+    if (add_spatial != nullptr) bindings.AddSource(add_spatial);
+    if (composite != nullptr) bindings.AddSource(composite->alpha);
+    bindings.AddSink(out);
+    graph->Rebind(bindings);
+  }
+
+  if (sink == nullptr) {
+    graph->Run();
+    return;
+  }
+  const uint32_t num_tile_rows = graph->NumTileRows();
+  for (uint32_t iy = 0; iy < num_tile_rows; iy += kGroupHeightInTiles) {
+    const uint32_t iy_end =
+        std::min<uint32_t>(iy + kGroupHeightInTiles, num_tile_rows);
+    graph->RunTileRows(iy, iy_end);
+    const size_t y0 = iy * kTileHeight;
+    const size_t y1 = std::min<size_t>(iy_end * kTileHeight, header.ysize);
+    if (y0 < y1) sink->Emit(*out, y0, header.xsize, y1 - y0);
+  }
+}
+
+}  // namespace
+
+// Avoid including <functional> for such tiny functions.
+struct Plus {
+  constexpr float operator()(const float first, const float second) const {
+    return first + second;
+  }
+};
+struct Minus {
+  constexpr float operator()(const float first, const float second) const {
+    return first - second;
+  }
+};
+
+std::vector<float> DCfiedGaussianKernel(float sigma) {
+  std::vector<float> result(3, 0.0);
+  std::vector<float> hires = GaussianKernel<float>(8, sigma);
+  for (int i = 0; i < 8; i++) {
+    for (int j = 0; j < hires.size(); j++) {
+      result[(i + j) / 8] += hires[j] / 8.0;
+    }
+  }
+  return result;
+}
+
+// Called from local static ctor.
+kernel::Custom<3> MakeUpsampleKernel() {
+  Image3F impulse_dc(20, 20);
+  FillImage(0.0f, &impulse_dc);
+  impulse_dc.PlaneRow(0, 10)[10] = 1.0;
+  ThreadPool pool(0);
+  Image3F probe_expected = UpscalerReconstruct(impulse_dc, &pool);
+  // We are trying to extract a kernel with a smaller radius. This kernel will
+  // be unnormalized. However, we don't mind that: the encoder will compensate
+  // when encoding.
+  auto kernel6 = kernel::Custom<3>::FromResult(probe_expected.Plane(0));
+
+  ImageF probe_test(probe_expected.xsize(), probe_expected.ysize());
+  dispatch::Dispatched<Upsample8_6x6Impl,
+                       void(const ImageF&, const kernel::Custom<3>&,
+                            ThreadPool*, ImageF*)>::Get()(
+      impulse_dc.Plane(0), kernel6, &pool, &probe_test);
+  VerifyRelativeError(probe_expected.Plane(0), probe_test, 5e-2, 5e-2);
+
+  return kernel6;
+}
+
+template <class Image>  // ImageF or Image3F
+Image BlurUpsampleDC(const Image& original_dc, ThreadPool* pool) {
+  Image out(original_dc.xsize() * kBlockWidth,
+            original_dc.ysize() * kBlockHeight);
+  // TODO(user): In the encoder we want only the DC of the result. That could
+  // be done more quickly.
+  static auto kernel6 = MakeUpsampleKernel();
+  dispatch::Dispatched<Upsample8_6x6Impl,
+                       void(const Image&, const kernel::Custom<3>&, ThreadPool*,
+                            Image*)>::Get()(original_dc, kernel6, pool, &out);
+  return out;
+}
+
+// Radius [blocks] of the DC neighborhood that influences the block averages
+// of BlurUpsampleDC.
+constexpr int kBlockAverageRadius = 3;
+
+// Called from local static ctor. Returns the (2R+1)^2 weights of "dc" whose
+// sum is the average of the corresponding block of BlurUpsampleDC(dc).
+std::vector<float> MakeBlockAverageKernel() {
+  constexpr int kWidth = 2 * kBlockAverageRadius + 1;
+  constexpr int kCenter = 2 * kBlockAverageRadius;
+  ImageF impulse_dc(2 * kCenter + 1, 2 * kCenter + 1);
+  FillImage(0.0f, &impulse_dc);
+  impulse_dc.Row(kCenter)[kCenter] = 1.0f;
+  ThreadPool pool(0);
+  const ImageF averages = Subsample(BlurUpsampleDC(impulse_dc, &pool), 8);
+  std::vector<float> kernel(kWidth * kWidth);
+  for (int dy = -kBlockAverageRadius; dy <= kBlockAverageRadius; ++dy) {
+    for (int dx = -kBlockAverageRadius; dx <= kBlockAverageRadius; ++dx) {
+      kernel[(dy + kBlockAverageRadius) * kWidth + dx + kBlockAverageRadius] =
+          averages.ConstRow(kCenter + dy)[kCenter + dx];
+    }
+  }
+  return kernel;
+}
+
+// Returns the block averages of BlurUpsampleDC(dc) (which differ from "dc"
+// because the encoder compensates for the upsampling) without computing the
+// full-resolution upsampled image. Mirrors at the borders, so slightly
+// differs from the upsampling there.
+Image3F BlockAveragesOfUpsampledDC(const Image3F& dc, ThreadPool* pool) {
+  static const std::vector<float> kernel = MakeBlockAverageKernel();
+  constexpr int kWidth = 2 * kBlockAverageRadius + 1;
+  const int64_t xsize = dc.xsize();
+  const int64_t ysize = dc.ysize();
+  Image3F out(xsize, ysize);
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const int64_t y = task;
+    for (int c = 0; c < 3; ++c) {
+      float* PIK_RESTRICT row_out = out.PlaneRow(c, y);
+      for (int64_t x = 0; x < xsize; ++x) {
+        float sum = 0.0f;
+        for (int dy = -kBlockAverageRadius; dy <= kBlockAverageRadius; ++dy) {
+          const float* PIK_RESTRICT row_dc =
+              dc.ConstPlaneRow(c, Mirror(y - dy, ysize));
+          const float* PIK_RESTRICT row_kernel =
+              &kernel[(dy + kBlockAverageRadius) * kWidth + kBlockAverageRadius];
+          for (int dx = -kBlockAverageRadius; dx <= kBlockAverageRadius; ++dx) {
+            sum += row_kernel[dx] * row_dc[Mirror(x - dx, xsize)];
+          }
+        }
+        row_out[x] = sum;
+      }
+    }
+  });
+  return out;
+}
+
+// Returns DCT(blur) - original_dc
+Image3F BlurUpsampleDCAndDCT(const Image3F& original_dc, ThreadPool* pool) {
+  Image3F blurred = BlurUpsampleDC(original_dc, pool);
+  Image3F dct = TransposedScaledDCT(blurred, pool);
+  pool->Run(0, dct.ysize(), [&original_dc, &dct](const int task, int thread) {
+    const size_t y = task;
+    for (int c = 0; c < 3; c++) {
+      float* PIK_RESTRICT dct_row = dct.PlaneRow(c, y);
+      const float* PIK_RESTRICT original_dc_row =
+          original_dc.ConstPlaneRow(c, y);
+      for (size_t dct_x = 0, x = 0; dct_x < dct.xsize(); dct_x += kBlockSize) {
+        dct_row[dct_x] -= original_dc_row[x++];
+      }
+    }
+  });
+  return dct;
+}
+
+// Called by local static ctor.
+std::vector<float> MakeSharpenKernel() {
+  // TODO(user): With the new blur, this makes no sense.
+  std::vector<float> blur_kernel = DCfiedGaussianKernel(5.5);
+  constexpr int kSharpenKernelSize = 3;
+  std::vector<float> sharpen_kernel(kSharpenKernelSize);
+  InvertConvolution(&blur_kernel[0], blur_kernel.size(), &sharpen_kernel[0],
+                    sharpen_kernel.size());
+  return sharpen_kernel;
+}
+
+// Adds the residual between "dc" and the 8x8 block averages of "up" (the
+// blurred upsampling of "dc_to_encode") to "dc_to_encode". Fusing Subsample8
+// into this pass avoids allocating and re-reading the DC-sized average.
+// Returns true if L1(residual) < max_error.
+bool AddResidualAndCompare(const ImageF& dc, const ImageF& up,
+                           const float max_error, ThreadPool* pool,
+                           ImageF* PIK_RESTRICT dc_to_encode) {
+  PIK_CHECK(SameSize(dc, *dc_to_encode));
+  PIK_CHECK(up.xsize() == dc.xsize() * kBlockWidth);
+  PIK_CHECK(up.ysize() == dc.ysize() * kBlockHeight);
+  const size_t xsize = dc.xsize();
+  const size_t ysize = dc.ysize();
+  std::atomic<bool> all_less{true};
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    using namespace SIMD_NAMESPACE;
+    using D = Part<float, SIMD_MIN(Full<float>::N, kBlockWidth)>;
+    const D d;
+    const auto mul = set1(d, 1.0f / kBlockSize);
+
+    const float* PIK_RESTRICT row_dc = dc.ConstRow(y);
+    float* PIK_RESTRICT row_out = dc_to_encode->Row(y);
+    bool row_less = true;
+    for (size_t x = 0; x < xsize; ++x) {
+      // Same summation order as Subsample8.
+      auto sum = setzero(d);
+      for (size_t iy = 0; iy < kBlockHeight; ++iy) {
+        const float* PIK_RESTRICT row_up = up.ConstRow(y * kBlockHeight + iy);
+        for (size_t ix = 0; ix < kBlockWidth; ix += d.N) {
+          sum += load(d, row_up + x * kBlockWidth + ix);
+        }
+      }
+      sum = ext::sum_of_lanes(sum);
+      const float blurred = get_part(Part<float, 1>(), sum * mul);
+      const float diff = row_dc[x] - blurred;
+      row_less &= fabsf(diff) < max_error;
+      row_out[x] += diff;
+    }
+    if (!row_less) all_less.store(false, std::memory_order_relaxed);
+  });
+  return all_less.load();
+}
+
+Image3F SharpenDC(const Image3F& original_dc, ThreadPool* pool) {
   PROFILER_FUNC;
   constexpr int kMaxIters = 200;
   constexpr float kAcceptableError[3] = {1e-4, 1e-4, 1e-4};
@@ -654,11 +1356,9 @@ Image3F SharpenDC(const Image3F& original_dc, ThreadPool* pool) {
   for (int c = 0; c < 3; ++c) {
     for (int iter = 0; iter < kMaxIters; iter++) {
       const ImageF up = BlurUpsampleDC(dc_to_encode.Plane(c), pool);
-      const ImageF blurred = Subsample8(up);
       // Change pixels of dc_to_encode but not its size.
-      if (AddResidualAndCompare(original_dc.Plane(c), blurred,
-                                kAcceptableError[c],
-                                dc_to_encode.MutablePlane(c))) {
+      if (AddResidualAndCompare(original_dc.Plane(c), up, kAcceptableError[c],
+                                pool, dc_to_encode.MutablePlane(c))) {
         break;  // next channel
       }
     }
@@ -677,18 +1377,58 @@ void ComputePredictionResiduals_Smooth(const Quantizer& quantizer,
     cache->dc_sharp = SharpenDC(dc_orig, pool);
     Image3F dc_dec = QuantizeRoundtripDC(quantizer, cache->dc_sharp);
     if (gradient_map) {
-      gradient_map->Unapply(&dc_dec);
+      gradient_map->Unapply(pool, &dc_dec);
     }
     cache->pred_smooth = BlurUpsampleDCAndDCT(dc_dec, pool);
     cache->have_pred = true;
   }
+}
 
-  cache->coeffs = CopyImage(cache->coeffs_init);
-  FillDC(cache->dc_sharp, &cache->coeffs);
+// Writes the residuals for the prediction cached by
+// ComputePredictionResiduals_Smooth to "coeffs". Copies the coefficients
+// (unless "in_place", i.e. coeffs already holds them instead of
+// cache.coeffs_init), replaces their DC and subtracts the AC prediction in a
+// single pass per row.
+void SmoothResidualsFromCache(const EncCache& cache, const bool in_place,
+                              ThreadPool* pool, Image3F* PIK_RESTRICT coeffs) {
+  const Image3F& coeffs_init = in_place ? *coeffs : cache.coeffs_init;
+  const Image3F& pred = cache.pred_smooth;
+  const Image3F& dc = cache.dc_sharp;
+  const size_t xsize = coeffs_init.xsize();
+  const size_t ysize = coeffs_init.ysize();
+  PIK_CHECK(xsize % kBlockSize == 0);
+  PIK_CHECK(SameSize(coeffs_init, pred));
+  PIK_CHECK(dc.xsize() * kBlockSize == xsize && dc.ysize() == ysize);
+  if (coeffs->xsize() != xsize || coeffs->ysize() != ysize) {
+    *coeffs = Image3F(xsize, ysize);
+  }
 
-  // We have already tried to take into account the effect on DC. We will
-  // assume here that we've done that correctly.
-  InjectExceptDC<Minus>(cache->pred_smooth, &cache->coeffs);
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    for (int c = 0; c < 3; ++c) {
+      const float* PIK_RESTRICT row_pred = pred.ConstPlaneRow(c, y);
+      const float* PIK_RESTRICT row_dc = dc.ConstPlaneRow(c, y);
+      float* PIK_RESTRICT row_out = coeffs->PlaneRow(c, y);
+      if (in_place) {
+        for (size_t bx = 0; bx < xsize; bx += kBlockSize) {
+          row_out[bx] = row_dc[bx / kBlockSize];
+          for (size_t x = 1; x < kBlockSize; ++x) {
+            row_out[bx + x] -= row_pred[bx + x];
+          }
+        }
+        continue;
+      }
+      const float* PIK_RESTRICT row_init = coeffs_init.ConstPlaneRow(c, y);
+      for (size_t bx = 0; bx < xsize; bx += kBlockSize) {
+        // We have already tried to take into account the effect on DC. We
+        // will assume here that we've done that correctly.
+        row_out[bx] = row_dc[bx / kBlockSize];
+        for (size_t x = 1; x < kBlockSize; ++x) {
+          row_out[bx + x] = row_init[bx + x] - row_pred[bx + x];
+        }
+      }
+    }
+  });
 }
 
 namespace kernel {
@@ -729,27 +1469,34 @@ struct AC10 {
 
 }  // namespace kernel
 
-template <class Operator>  // Plus/Minus
-void Adjust189_64FromDC(const Image3F& dc, Image3F* PIK_RESTRICT coeffs) {
+// Computes the DC-only terms of the 1, 8 and 9 coefficient predictions.
+// "ac01", "ac10" and "ac11" are preallocated to the size of "dc".
+void PredictACFromDC(const Image3F& dc, Image3F* PIK_RESTRICT ac01,
+                     Image3F* PIK_RESTRICT ac10, Image3F* PIK_RESTRICT ac11) {
   const size_t xsize = dc.xsize();
   const size_t ysize = dc.ysize();
-
-  const Operator op;
-
-  Image3F ac01(xsize, ysize);
-  Image3F ac10(xsize, ysize);
-  Image3F ac11(xsize, ysize);
   // Must avoid ConvolveT for tiny images (PIK_CHECK fails)
   if (xsize < kConvolveMinWidth) {
     using Convolution = slow::General3x3Convolution<1, WrapMirror>;
-    Convolution::Run(dc, xsize, ysize, kernel::AC01(), &ac01);
-    Convolution::Run(dc, xsize, ysize, kernel::AC10(), &ac10);
-    Convolution::Run(dc, xsize, ysize, kernel::AC11(), &ac11);
+    Convolution::Run(dc, xsize, ysize, kernel::AC01(), ac01);
+    Convolution::Run(dc, xsize, ysize, kernel::AC10(), ac10);
+    Convolution::Run(dc, xsize, ysize, kernel::AC11(), ac11);
   } else {
-    ConvolveT<strategy::GradY3>::Run(dc, kernel::AC01(), &ac01);
-    ConvolveT<strategy::GradX3>::Run(dc, kernel::AC10(), &ac10);
-    ConvolveT<strategy::Corner3>::Run(dc, kernel::AC11(), &ac11);
+    ConvolveT<strategy::GradY3>::Run(dc, kernel::AC01(), ac01);
+    ConvolveT<strategy::GradX3>::Run(dc, kernel::AC10(), ac10);
+    ConvolveT<strategy::Corner3>::Run(dc, kernel::AC11(), ac11);
   }
+}
+
+// "ac01", "ac10" and "ac11" are from PredictACFromDC.
+template <class Operator>  // Plus/Minus
+void Adjust189_64FromDC(const Image3F& ac01, const Image3F& ac10,
+                        const Image3F& ac11, Image3F* PIK_RESTRICT coeffs) {
+  const size_t xsize = ac01.xsize();
+  const size_t ysize = ac01.ysize();
+
+  const Operator op;
+
   for (int c = 0; c < 3; ++c) {
     for (size_t by = 0; by < ysize; ++by) {
       const float* PIK_RESTRICT row01 = ac01.ConstPlaneRow(c, by);
@@ -768,27 +1515,15 @@ void Adjust189_64FromDC(const Image3F& dc, Image3F* PIK_RESTRICT coeffs) {
 }
 
 // Returns pixel-space prediction using same adjustment as above followed by
-// GetPixelSpaceImageFrom0189. "ac4" is [--, 1, 8, 9].
+// GetPixelSpaceImageFrom0189. "ac4" is [--, 1, 8, 9]; "ac01", "ac10" and
+// "ac11" are from PredictACFromDC(dc).
 // Parallelizing doesn't help, even for XX MP images (DC is still small).
-Image3F PredictSpatial2x2_AC4(const Image3F& dc, const Image3F& ac4) {
+Image3F PredictSpatial2x2_AC4(const Image3F& dc, const Image3F& ac01,
+                              const Image3F& ac10, const Image3F& ac11,
+                              const Image3F& ac4) {
   const size_t xsize = dc.xsize();
   const size_t ysize = dc.ysize();
 
-  Image3F ac01(xsize, ysize);
-  Image3F ac10(xsize, ysize);
-  Image3F ac11(xsize, ysize);
-  // Must avoid ConvolveT for tiny images (PIK_CHECK fails)
-  if (xsize < kConvolveMinWidth) {
-    using Convolution = slow::General3x3Convolution<1, WrapMirror>;
-    Convolution::Run(dc, xsize, ysize, kernel::AC01(), &ac01);
-    Convolution::Run(dc, xsize, ysize, kernel::AC10(), &ac10);
-    Convolution::Run(dc, xsize, ysize, kernel::AC11(), &ac11);
-  } else {
-    ConvolveT<strategy::GradY3>::Run(dc, kernel::AC01(), &ac01);
-    ConvolveT<strategy::GradX3>::Run(dc, kernel::AC10(), &ac10);
-    ConvolveT<strategy::Corner3>::Run(dc, kernel::AC11(), &ac11);
-  }
-
   const float kScale01 = 0.113265930794111f / (kIDCTScales[0] * kIDCTScales[1]);
   const float kScale11 = 0.102633368629251f / (kIDCTScales[1] * kIDCTScales[1]);
   Image3F out2x2(xsize * 2, ysize * 2);
@@ -827,17 +1562,7 @@ Image3F PredictSpatial2x2_AC64(const Image3F& dc, Image3F* ac64) {
   Image3F ac01(xsize, ysize);
   Image3F ac10(xsize, ysize);
   Image3F ac11(xsize, ysize);
-  // Must avoid ConvolveT for tiny images (PIK_CHECK fails)
-  if (xsize < kConvolveMinWidth) {
-    using Convolution = slow::General3x3Convolution<1, WrapMirror>;
-    Convolution::Run(dc, xsize, ysize, kernel::AC01(), &ac01);
-    Convolution::Run(dc, xsize, ysize, kernel::AC10(), &ac10);
-    Convolution::Run(dc, xsize, ysize, kernel::AC11(), &ac11);
-  } else {
-    ConvolveT<strategy::GradY3>::Run(dc, kernel::AC01(), &ac01);
-    ConvolveT<strategy::GradX3>::Run(dc, kernel::AC10(), &ac10);
-    ConvolveT<strategy::Corner3>::Run(dc, kernel::AC11(), &ac11);
-  }
+  PredictACFromDC(dc, &ac01, &ac10, &ac11);
 
   const float kScale01 = 0.113265930794111f / (kIDCTScales[0] * kIDCTScales[1]);
   const float kScale11 = 0.102633368629251f / (kIDCTScales[1] * kIDCTScales[1]);
@@ -874,18 +1599,134 @@ Image3F PredictSpatial2x2_AC64(const Image3F& dc, Image3F* ac64) {
   return out2x2;
 }
 
+// Equivalent to ApplyColorTransform(ctan, -1.0f, QuantizeRoundtrip(quantizer,
+// 1, coeffs.Plane(1)), &coeffs) followed by QuantizeCoeffs/QuantizeCoeffsDC,
+// but visits each block only once (in parallel) and also counts the nonzero AC
+// coefficients, which spares TokenizeCoefficients another pass.
+QuantizedCoeffs QuantizeWithColorTransform(const ColorTransform& ctan,
+                                           const Quantizer& quantizer,
+                                           const Image3F& coeffs,
+                                           ThreadPool* pool) {
+  PROFILER_ZONE("enc ctan+quant");
+  const float kYToBScale = 1.0f / 128.0f;
+  const float kYToXScale = 1.0f / 256.0f;
+  const float factor_b = -1.0f * kYToBScale;
+  const float factor_x = -1.0f * kYToXScale;
+  const float ytob_dc = factor_b * ctan.ytob_dc;
+  const float ytox_dc = factor_x * (ctan.ytox_dc - 128);
+  const float inv_quant_dc = quantizer.inv_quant_dc();
+  const float* PIK_RESTRICT dequant_y = &quantizer.DequantMatrix()[kBlockSize];
+
+  const size_t xsize_blocks = coeffs.xsize() / kBlockSize;
+  const size_t ysize_blocks = coeffs.ysize();
+  QuantizedCoeffs qcoeffs;
+  qcoeffs.dc = Image3S(xsize_blocks, ysize_blocks);
+  qcoeffs.ac = Image3S(coeffs.xsize(), ysize_blocks);
+  qcoeffs.num_nzeros = Image3I(xsize_blocks, ysize_blocks);
+
+  pool->Run(0, ysize_blocks, [&](const int task, const int thread) {
+    const size_t by = task;
+    const int* PIK_RESTRICT row_ytob =
+        ctan.ytob_map.Row(by / kTileHeightInBlocks);
+    const int* PIK_RESTRICT row_ytox =
+        ctan.ytox_map.Row(by / kTileHeightInBlocks);
+    SIMD_ALIGN float y_rounded[kBlockSize];
+    SIMD_ALIGN float xb[kBlockSize];
+
+    for (size_t bx = 0; bx < xsize_blocks; ++bx) {
+      const size_t xoff = bx * kBlockSize;
+      const float* PIK_RESTRICT block_y = coeffs.PlaneRow(1, by) + xoff;
+      int16_t* PIK_RESTRICT out_y = qcoeffs.ac.PlaneRow(1, by) + xoff;
+      qcoeffs.num_nzeros.PlaneRow(1, by)[bx] =
+          quantizer.QuantizeBlockCountNZ(bx, by, 1, block_y, out_y);
+      qcoeffs.dc.PlaneRow(1, by)[bx] = out_y[0];
+
+      const float inv_quant_ac = quantizer.inv_quant_ac(bx, by);
+      y_rounded[0] = out_y[0] * (dequant_y[0] * inv_quant_dc);
+      for (size_t k = 1; k < kBlockSize; ++k) {
+        y_rounded[k] = out_y[k] * (dequant_y[k] * inv_quant_ac);
+      }
+
+      const float ytob_ac = factor_b * row_ytob[bx / kTileWidthInBlocks];
+      const float ytox_ac =
+          factor_x * (row_ytox[bx / kTileWidthInBlocks] - 128);
+      for (int c = 0; c < 3; c += 2) {  // === for c in {0, 2}
+        const float* PIK_RESTRICT block = coeffs.PlaneRow(c, by) + xoff;
+        const float mul_dc = (c == 0) ? ytox_dc : ytob_dc;
+        const float mul_ac = (c == 0) ? ytox_ac : ytob_ac;
+        xb[0] = block[0] + mul_dc * y_rounded[0];
+        for (size_t k = 1; k < kBlockSize; ++k) {
+          xb[k] = block[k] + mul_ac * y_rounded[k];
+        }
+        int16_t* PIK_RESTRICT out = qcoeffs.ac.PlaneRow(c, by) + xoff;
+        qcoeffs.num_nzeros.PlaneRow(c, by)[bx] =
+            quantizer.QuantizeBlockCountNZ(bx, by, c, xb, out);
+        qcoeffs.dc.PlaneRow(c, by)[bx] = out[0];
+      }
+    }
+  });
+  return qcoeffs;
+}
+
 void ComputePredictionResiduals(const Quantizer& quantizer, ThreadPool* pool,
                                 EncCache* cache) {
   if (!cache->have_pred) {
     cache->dc_dec = QuantizeRoundtripExtractDC(quantizer, cache->coeffs_init);
-    Adjust189_64FromDC<Minus>(cache->dc_dec, &cache->coeffs_init);
+    const size_t xsize = cache->dc_dec.xsize();
+    const size_t ysize = cache->dc_dec.ysize();
+    cache->pred_ac01 = Image3F(xsize, ysize);
+    cache->pred_ac10 = Image3F(xsize, ysize);
+    cache->pred_ac11 = Image3F(xsize, ysize);
+    PredictACFromDC(cache->dc_dec, &cache->pred_ac01, &cache->pred_ac10,
+                    &cache->pred_ac11);
+    Adjust189_64FromDC<Minus>(cache->pred_ac01, cache->pred_ac10,
+                              cache->pred_ac11, &cache->coeffs_init);
     cache->have_pred = true;
   }
-  cache->coeffs = CopyImage(cache->coeffs_init);
-  const Image3F ac189_rounded =
-      QuantizeRoundtripExtract189(quantizer, cache->coeffs);
-  Image3F pred2x2 = PredictSpatial2x2_AC4(cache->dc_dec, ac189_rounded);
-  UpSample4x4BlurDCT(pred2x2, 1.5f, -0.0f, pool, &cache->coeffs);
+}
+
+// Writes the residuals for the prediction cached by ComputePredictionResiduals
+// to "coeffs", which already holds the coefficients if "in_place" (otherwise
+// copied from cache.coeffs_init). The AC prediction depends on "quantizer".
+void ResidualsFromCache(const Quantizer& quantizer, const EncCache& cache,
+                        const bool in_place, ThreadPool* pool,
+                        Image3F* PIK_RESTRICT coeffs) {
+  if (!in_place) CopyImageTo(cache.coeffs_init, coeffs);
+  const Image3F ac189_rounded = QuantizeRoundtripExtract189(quantizer, *coeffs);
+  Image3F pred2x2 =
+      PredictSpatial2x2_AC4(cache.dc_dec, cache.pred_ac01, cache.pred_ac10,
+                            cache.pred_ac11, ac189_rounded);
+  UpSample4x4BlurDCT(pred2x2, 1.5f, -0.0f, pool, coeffs);
+}
+
+// Writes the residuals for the prediction in "cache" to "coeffs" (see
+// [Smooth]ResidualsFromCache) and quantizes them.
+QuantizedCoeffs QuantizeResiduals(const Header& header,
+                                  const Quantizer& quantizer,
+                                  const ColorTransform& ctan,
+                                  const EncCache& cache, const bool in_place,
+                                  ThreadPool* pool,
+                                  Image3F* PIK_RESTRICT coeffs) {
+  PIK_CHECK(cache.have_coeffs_init && cache.have_pred);
+  if (header.flags & Header::kSmoothDCPred) {
+    SmoothResidualsFromCache(cache, in_place, pool, coeffs);
+  } else {
+    ResidualsFromCache(quantizer, cache, in_place, pool, coeffs);
+  }
+
+  QuantizedCoeffs qcoeffs =
+      QuantizeWithColorTransform(ctan, quantizer, *coeffs, pool);
+  if (header.flags & Header::kGrayscale) {
+    // Only Y is coded; match what the decoder sees.
+    for (int c = 0; c < 3; c += 2) {
+      FillImage(int16_t(0), qcoeffs.dc.MutablePlane(c));
+      FillImage(int16_t(0), qcoeffs.ac.MutablePlane(c));
+      if (qcoeffs.num_nzeros.xsize() != 0) {
+        FillImage(0, qcoeffs.num_nzeros.MutablePlane(c));
+      }
+    }
+  }
+  return qcoeffs;
 }
 
 QuantizedCoeffs ComputeCoefficients(const CompressParams& params,
@@ -894,24 +1735,52 @@ QuantizedCoeffs ComputeCoefficients(const CompressParams& params,
                                     const ColorTransform& ctan,
                                     ThreadPool* pool, EncCache* cache,
                                     const PikInfo* aux_out) {
-  if (!cache->have_coeffs_init) {
-    cache->coeffs_init = TransposedScaledDCT(opsin, pool);
-    cache->have_coeffs_init = true;
+  // The prediction only depends on the quantized DC, whose step size is the
+  // same for all blocks, so it remains valid while the AC quantization field
+  // changes. The non-smooth prediction has already been subtracted from
+  // coeffs_init, hence both are recomputed if the DC step changes.
+  if (cache->have_pred &&
+      cache->pred_inv_quant_dc != quantizer.inv_quant_dc()) {
+    cache->have_coeffs_init = false;
+    cache->have_pred = false;
+  }
+  if (cache->have_pred) {
+    ++cache->num_pred_hits;
+  } else {
+    ++cache->num_pred_misses;
   }
 
-  QuantizedCoeffs qcoeffs;
-
+  // Only computed along with coeffs_init, from which it was subtracted.
   std::unique_ptr<GradientMap> gradient_map;
-  if (header.flags & Header::kGradientMap) {
-    auto dc = DCImage(cache->coeffs_init);
-    gradient_map.reset(new GradientMap(dc.xsize(), dc.ysize()));
-    gradient_map->ComputeFromSource(dc);
-    gradient_map->Apply(&dc);
-    gradient_map->Serialize(&cache->gradient_map);
-    cache->gradient[0] = gradient_map->corners_[0];
-    cache->gradient[1] = gradient_map->corners_[1];
-    cache->gradient[2] = gradient_map->corners_[2];
-    FillDC(dc, &cache->coeffs_init);
+  if (!cache->have_coeffs_init) {
+    // The previous residuals are no longer needed; frees them before
+    // allocating coeffs_init (which they replaced, see low_memory).
+    if (cache->low_memory) cache->coeffs = Image3F();
+    if (cache->pending_dct.xsize() != 0) {
+      cache->coeffs_init = std::move(cache->pending_dct);
+      cache->pending_dct = Image3F();
+    } else if (cache->precomputed_dct != nullptr) {
+      cache->coeffs_init = CopyImage(*cache->precomputed_dct);
+    } else if (cache->uncentered_opsin != nullptr) {
+      cache->coeffs_init = CenteredOpsinDCT(
+          *cache->uncentered_opsin, cache->uncentered_gaborish_inverse, pool);
+    } else {
+      cache->coeffs_init = TransposedScaledDCT(opsin, pool);
+    }
+
+    if (header.flags & Header::kGradientMap) {
+      auto dc = DCImage(cache->coeffs_init);
+      gradient_map.reset(new GradientMap(dc.xsize(), dc.ysize()));
+      gradient_map->ComputeFromSource(dc, pool);
+      gradient_map->Apply(pool, &dc);
+      cache->gradient_map.resize(0);
+      gradient_map->Serialize(&cache->gradient_map);
+      cache->gradient[0] = gradient_map->corners_[0];
+      cache->gradient[1] = gradient_map->corners_[1];
+      cache->gradient[2] = gradient_map->corners_[2];
+      FillDC(dc, &cache->coeffs_init);
+    }
+    cache->have_coeffs_init = true;
   }
 
   if (header.flags & Header::kSmoothDCPred) {
@@ -920,19 +1789,38 @@ QuantizedCoeffs ComputeCoefficients(const CompressParams& params,
   } else {
     ComputePredictionResiduals(quantizer, pool, cache);
   }
+  cache->pred_inv_quant_dc = quantizer.inv_quant_dc();
 
-  PROFILER_ZONE("enc ctan+quant");
-  ApplyColorTransform(ctan, -1.0f,
-                      QuantizeRoundtrip(quantizer, 1, cache->coeffs.Plane(1)),
-                      &cache->coeffs);
-
-  qcoeffs.dc = QuantizeCoeffsDC(cache->coeffs, quantizer);
-  qcoeffs.ac = QuantizeCoeffs(cache->coeffs, quantizer);
+  if (!cache->low_memory) {
+    return ComputeCoefficientsFromCache(header, quantizer, ctan, *cache, pool,
+                                        &cache->coeffs);
+  }
+  // The residuals replace coeffs_init, so the next call recomputes it and the
+  // prediction (which may have been subtracted from it).
+  cache->coeffs = std::move(cache->coeffs_init);
+  cache->coeffs_init = Image3F();
+  QuantizedCoeffs qcoeffs =
+      QuantizeResiduals(header, quantizer, ctan, *cache, /*in_place=*/true,
+                        pool, &cache->coeffs);
+  cache->have_coeffs_init = false;
+  cache->have_pred = false;
   return qcoeffs;
 }
 
+QuantizedCoeffs ComputeCoefficientsFromCache(const Header& header,
+                                             const Quantizer& quantizer,
+                                             const ColorTransform& ctan,
+                                             const EncCache& cache,
+                                             ThreadPool* pool,
+                                             Image3F* PIK_RESTRICT coeffs) {
+  return QuantizeResiduals(header, quantizer, ctan, cache, /*in_place=*/false,
+                           pool, coeffs);
+}
+
 // Computes contexts in [0, kOrderContexts) from "rect_dc" within "dc" and
-// writes to "rect_ctx" within "ctx".
+// writes to "rect_ctx" within "ctx". Each row of blocks is processed a vector
+// at a time, falling back to scalar code (which is exact for all int16 DC) for
+// the rest of the row once a gradient is too large for the vector path.
 void ComputeBlockContextFromDC(const Rect& rect_dc, const Image3S& dc,
                                const Quantizer& quantizer, const Rect& rect_ctx,
                                Image3B* PIK_RESTRICT ctx) {
@@ -941,6 +1829,17 @@ void ComputeBlockContextFromDC(const Rect& rect_dc, const Image3S& dc,
   const size_t xsize = rect_dc.xsize();
   const size_t ysize = rect_dc.ysize();
 
+  using namespace SIMD_NAMESPACE;
+  using D = Full<int32_t>;
+  constexpr D d;
+  constexpr Part<int16_t, D::N> d16;
+  constexpr Part<uint8_t, D::N> d8;
+  // Up to this |dx| and |dy|, all products below fit in int32, so the vector
+  // path computes the same contexts as the int64 scalar code.
+  const auto max_gradient = set1(d, 16383);
+  const auto k3 = set1(d, 3);
+  const auto k10 = set1(d, 10);
+
   const float iquant_base = quantizer.inv_quant_dc();
   const float* PIK_RESTRICT dequant_matrix = quantizer.DequantMatrix();
   for (int c = 0; c < 3; ++c) {
@@ -952,6 +1851,10 @@ void ComputeBlockContextFromDC(const Rect& rect_dc, const Image3S& dc,
     const float iquant = iquant_base * dequant_matrix[c * kBlockSize];
     const float range = kXybRange[c] / iquant;
     const int64_t kR2Thresh = std::min(10.24f * range * range + 1.0f, 1E18f);
+    // r2 < 2^30 in the vector path, so larger thresholds are equivalent.
+    const auto r2_thresh =
+        set1(d, static_cast<int32_t>(std::min<int64_t>(kR2Thresh, 1 << 30)));
+    const auto flat_ctx = set1(d, c);
 
     for (size_t y = 1; y + 1 < ysize; ++y) {
       const int16_t* PIK_RESTRICT row_t = rect_dc.ConstRow(plane_dc, y - 1);
@@ -959,7 +1862,33 @@ void ComputeBlockContextFromDC(const Rect& rect_dc, const Image3S& dc,
       const int16_t* PIK_RESTRICT row_b = rect_dc.ConstRow(plane_dc, y + 1);
       uint8_t* PIK_RESTRICT row_out = rect_ctx.Row(plane_ctx, y);
       row_out[0] = row_out[xsize - 1] = c;
-      for (size_t bx = 1; bx + 1 < xsize; ++bx) {
+      size_t bx = 1;
+      for (; bx + d.N < xsize; bx += d.N) {
+        const auto tl = convert_to(d, load(d16, row_t + bx - 1));
+        const auto tm = convert_to(d, load(d16, row_t + bx));
+        const auto tr = convert_to(d, load(d16, row_t + bx + 1));
+        const auto ml = convert_to(d, load(d16, row_m + bx - 1));
+        const auto mr = convert_to(d, load(d16, row_m + bx + 1));
+        const auto bl = convert_to(d, load(d16, row_b + bx - 1));
+        const auto bm = convert_to(d, load(d16, row_b + bx));
+        const auto br = convert_to(d, load(d16, row_b + bx + 1));
+        const auto dx = abs(k3 * (tr - tl + br - bl) + k10 * (mr - ml));
+        const auto dy = abs(k3 * (bl - tl + br - tr) + k10 * (bm - tm));
+        const auto too_large = max(dx, dy) > max_gradient;
+        if (ext::movemask(cast_to(Full<uint8_t>(), too_large)) != 0) break;
+
+        const auto dx2 = dx * dx;
+        const auto dy2 = dy * dy;
+        const auto dxdy = shift_left<1>(dx * dy);
+        const auto r2 = dx2 + dy2;
+        const auto d2 = dy2 - dx2;
+        auto ctx = set1(d, 4);
+        ctx = select(ctx, set1(d, 3), d2 < setzero(d) - dxdy);
+        ctx = select(ctx, set1(d, 5), d2 > dxdy);
+        ctx = select(ctx, flat_ctx, r2 < r2_thresh);
+        store(u8_from_u32(cast_to(Full<uint32_t>(), ctx)), d8, row_out + bx);
+      }
+      for (; bx + 1 < xsize; ++bx) {
         const int16_t val_tl = row_t[bx - 1];
         const int16_t val_tm = row_t[bx];
         const int16_t val_tr = row_t[bx + 1];
@@ -1011,13 +1940,15 @@ std::string EncodeColorMap(const Image<int>& ac_map, const int dc_val,
                            bit_depths.data(), bit_codes.data(), &storage_ix,
                            storage);
   const size_t histo_bits = storage_ix;
-  WriteBits(bit_depths[dc_val], bit_codes[dc_val], &storage_ix, storage);
+  BufferedBitWriter writer(&storage_ix, storage);
+  writer.Write(bit_depths[dc_val], bit_codes[dc_val]);
   for (int y = 0; y < ac_map.ysize(); ++y) {
     const int* PIK_RESTRICT row = ac_map.Row(y);
     for (int x = 0; x < ac_map.xsize(); ++x) {
-      WriteBits(bit_depths[row[x]], bit_codes[row[x]], &storage_ix, storage);
+      writer.Write(bit_depths[row[x]], bit_codes[row[x]]);
     }
   }
+  writer.Flush();
   WriteZeroesToByteBoundary(&storage_ix, storage);
   PIK_ASSERT((storage_ix >> 3) <= output.size());
   output.resize(storage_ix >> 3);
@@ -1061,146 +1992,865 @@ static inline void Append(const std::string& s, PaddedBytes* out,
   PIK_CHECK(*byte_pos <= out->size());
 }
 
-}  // namespace
+static inline void Append(const PaddedBytes& bytes, PaddedBytes* out,
+                          size_t* PIK_RESTRICT byte_pos) {
+  memcpy(out->data() + *byte_pos, bytes.data(), bytes.size());
+  *byte_pos += bytes.size();
+  PIK_CHECK(*byte_pos <= out->size());
+}
 
-PaddedBytes EncodeToBitstream(const QuantizedCoeffs& qcoeffs,
-                              const Quantizer& quantizer,
-                              const NoiseParams& noise_params,
-                              const ColorTransform& ctan, bool fast_mode,
-                              PikInfo* info) {
-  PROFILER_FUNC;
-  const size_t xsize_blocks = qcoeffs.dc.xsize();
-  const size_t ysize_blocks = qcoeffs.dc.ysize();
-  const size_t xsize_groups = DivCeil(xsize_blocks, kGroupWidthInBlocks);
-  const size_t ysize_groups = DivCeil(ysize_blocks, kGroupHeightInBlocks);
-  const size_t num_groups = xsize_groups * ysize_groups;
-  PikImageSizeInfo* ctan_info = info ? &info->layers[kLayerCtan] : nullptr;
-  std::string ctan_code =
-      EncodeColorMap(ctan.ytob_map, ctan.ytob_dc, ctan_info) +
-      EncodeColorMap(ctan.ytox_map, ctan.ytox_dc, ctan_info);
-  PikImageSizeInfo* quant_info = info ? &info->layers[kLayerQuant] : nullptr;
-  PikImageSizeInfo* dc_info = info ? &info->layers[kLayerDC] : nullptr;
-  PikImageSizeInfo* ac_info = info ? &info->layers[kLayerAC] : nullptr;
-  std::string noise_code = EncodeNoise(noise_params);
-  std::string quant_code = quantizer.Encode(quant_info);
+// Returns the encoded color correlation maps; grayscale images have none.
+std::string EncodeColorMaps(const Header& header, const ColorTransform& ctan,
+                            PikImageSizeInfo* ctan_info) {
+  if (header.flags & Header::kGrayscale) return std::string();
+  return EncodeColorMap(ctan.ytob_map, ctan.ytob_dc, ctan_info) +
+         EncodeColorMap(ctan.ytox_map, ctan.ytox_dc, ctan_info);
+}
 
-  std::string dc_code = "";
-  std::string dc_toc(DcGroupSizeCoder::MaxSize(num_groups), '\0');
-  size_t dc_toc_pos = 0;
-  uint8_t* dc_toc_storage =
-      reinterpret_cast<uint8_t*>(const_cast<char*>(dc_toc.data()));
+// Encodes the DC residuals of groups [first_group, first_group +
+// dc_group_codes->size()) into "dc_group_codes". Statistics are added to the
+// shard of the thread that encoded the group.
+void EncodeDCGroups(const Image3S& dc, const bool grayscale,
+                    const size_t group_size, const size_t first_group,
+                    ThreadPool* pool, PikImageSizeInfoShards* info_shards,
+                    std::vector<PaddedBytes>* dc_group_codes) {
+  const size_t xsize_blocks = dc.xsize();
+  const size_t ysize_blocks = dc.ysize();
+  const size_t xsize_groups = DivCeil(xsize_blocks, group_size);
+
+  // Per-thread temporary; allocated on first use by the thread.
+  std::vector<Image3S> tmp_dc_residuals(
+      std::max<size_t>(1, pool->NumThreads()));
 
-  // TODO(janwas): per-thread; also pass other tmp args to ShrinkDC
-  Image3S tmp_dc_residuals(kGroupWidthInBlocks, kGroupHeightInBlocks);
+  pool->Run(0, dc_group_codes->size(), [&](const int task, const int thread) {
+    const size_t x = (first_group + task) % xsize_groups;
+    const size_t y = (first_group + task) / xsize_groups;
+    const Rect rect(x * group_size, y * group_size, group_size, group_size,
+                    xsize_blocks, ysize_blocks);
+    const Rect tmp_rect(0, 0, rect.xsize(), rect.ysize());
+    Image3S& tmp = tmp_dc_residuals[thread];
+    if (tmp.xsize() == 0) {
+      tmp = Image3S(group_size, group_size);
+    }
 
-  // TODO(janwas): per-group once ComputeCoeffOrder is incremental
-  Image3B block_ctx(xsize_blocks, ysize_blocks);
-  for (size_t y = 0; y < ysize_groups; y++) {
-    for (size_t x = 0; x < xsize_groups; x++) {
-      const Rect rect(x * kGroupWidthInBlocks, y * kGroupHeightInBlocks,
-                      kGroupWidthInBlocks, kGroupHeightInBlocks, xsize_blocks,
-                      ysize_blocks);
-      const Rect tmp_rect(0, 0, rect.xsize(), rect.ysize());
-
-      ShrinkDC(rect, qcoeffs.dc, &tmp_dc_residuals);
-      ComputeBlockContextFromDC(rect, qcoeffs.dc, quantizer, rect, &block_ctx);
-
-      // (Need rect to indicate size because border groups may be smaller)
-      const std::string& dc_group_code =
-          EncodeImage(tmp_rect, tmp_dc_residuals, dc_info);
-      DcGroupSizeCoder::Encode(
-          dc_group_code.size(), &dc_toc_pos, dc_toc_storage);
-      dc_code += dc_group_code;
-    }
-  }
-  WriteZeroesToByteBoundary(&dc_toc_pos, dc_toc_storage);
-  dc_toc.resize(dc_toc_pos / kBitsPerByte);
-
-  std::string ac_code = "";
-  std::string order_code = "";
-  std::string histo_code = "";
-  int32_t order[kOrderContexts * kBlockSize];
-  std::vector<ANSEncodingData> codes;
-  std::vector<uint8_t> context_map;
-  std::vector<std::vector<Token> > all_tokens;
-  if (fast_mode) {
-    for (size_t i = 0; i < kOrderContexts; ++i) {
-      memcpy(&order[i * kBlockSize], kNaturalCoeffOrder,
-          kBlockSize * sizeof(order[0]));
+    ShrinkDC(rect, dc, &tmp);
+
+    // (Need rect to indicate size because border groups may be smaller)
+    EncodeImage(tmp_rect, tmp, info_shards->Get(thread),
+                &(*dc_group_codes)[task], grayscale);
+  });
+}
+
+// Writes the group sizes in group order.
+template <class GroupSizeCoder>
+std::string EncodeGroupSizes(const std::vector<PaddedBytes>& group_codes,
+                             size_t* PIK_RESTRICT code_size) {
+  const size_t num_groups = group_codes.size();
+  std::string toc(GroupSizeCoder::MaxSize(num_groups), '\0');
+  size_t toc_pos = 0;
+  uint8_t* toc_storage =
+      reinterpret_cast<uint8_t*>(const_cast<char*>(toc.data()));
+  *code_size = 0;
+  for (size_t i = 0; i < num_groups; ++i) {
+    GroupSizeCoder::Encode(group_codes[i].size(), &toc_pos, toc_storage);
+    *code_size += group_codes[i].size();
+  }
+  WriteZeroesToByteBoundary(&toc_pos, toc_storage);
+  toc.resize(toc_pos / kBitsPerByte);
+  return toc;
+}
+
+// Returns the precomputed nonzero counts for TokenizeCoefficients, if any.
+const Image3I* NumNZeroes(const QuantizedCoeffs& qcoeffs) {
+  return qcoeffs.num_nzeros.xsize() == 0 ? nullptr : &qcoeffs.num_nzeros;
+}
+
+// Block contexts of one group at a time, one image per thread (allocated on
+// first use), instead of a full-image Image3B.
+class GroupBlockContexts {
+ public:
+  GroupBlockContexts(const Image3S& dc, const Quantizer& quantizer,
+                     const size_t group_size, ThreadPool* pool)
+      : dc_(dc),
+        quantizer_(quantizer),
+        group_size_(group_size),
+        ctx_(std::max<size_t>(1, pool->NumThreads())) {}
+
+  // Width and height of the groups [blocks].
+  size_t GroupSize() const { return group_size_; }
+
+  // Computes the contexts of the group "rect" (in units of blocks) and returns
+  // an image with these contexts at 0,0. They are valid until the next call
+  // with the same "thread".
+  const Image3B& Compute(const Rect& rect, const int thread) {
+    Image3B& ctx = ctx_[thread];
+    if (ctx.xsize() == 0) {
+      ctx = Image3B(group_size_, group_size_);
     }
-  } else {
-    ComputeCoeffOrder(qcoeffs.ac, block_ctx, order);
+    const Rect rect_ctx(0, 0, rect.xsize(), rect.ysize());
+    ComputeBlockContextFromDC(rect, dc_, quantizer_, rect_ctx, &ctx);
+    return ctx;
   }
 
-  order_code = EncodeCoeffOrders(order, info);
-  const ImageI& quant_field = quantizer.RawQuantField();
-  for (size_t y = 0; y < ysize_groups; y++) {
-    for (size_t x = 0; x < xsize_groups; x++) {
-      const Rect rect(x * kGroupWidthInBlocks, y * kGroupHeightInBlocks,
-                      kGroupWidthInBlocks, kGroupHeightInBlocks, xsize_blocks,
-                      ysize_blocks);
-      // WARNING: TokenizeCoefficients also uses the DC values in qcoeffs.ac!
-      all_tokens.emplace_back(TokenizeCoefficients(order, rect, quant_field,
-                                                   qcoeffs.ac, block_ctx));
+ private:
+  const Image3S& dc_;
+  const Quantizer& quantizer_;
+  const size_t group_size_;
+  std::vector<Image3B> ctx_;
+};
+
+// Returns the rect of "group" (in units of blocks).
+Rect GroupRect(const size_t group, const size_t group_size,
+               const size_t xsize_blocks, const size_t ysize_blocks) {
+  const size_t xsize_groups = DivCeil(xsize_blocks, group_size);
+  const size_t x = group % xsize_groups;
+  const size_t y = group / xsize_groups;
+  return Rect(x * group_size, y * group_size, group_size, group_size,
+              xsize_blocks, ysize_blocks);
+}
+
+// Same as ComputeCoeffOrder, but with per-group block contexts: only the zero
+// counts (per thread, then merged) span all groups.
+void ComputeCoeffOrderPerGroup(const QuantizedCoeffs& qcoeffs,
+                               const bool grayscale,
+                               GroupBlockContexts* contexts, ThreadPool* pool,
+                               int32_t* PIK_RESTRICT order) {
+  PROFILER_FUNC;
+  const size_t xsize_blocks = qcoeffs.dc.xsize();
+  const size_t ysize_blocks = qcoeffs.dc.ysize();
+  const size_t group_size = contexts->GroupSize();
+  const size_t num_groups = DivCeil(xsize_blocks, group_size) *
+                            DivCeil(ysize_blocks, group_size);
+  using ZeroCounts = std::array<uint32_t, kOrderContexts * kBlockSize>;
+  std::vector<ZeroCounts> thread_zeros(std::max<size_t>(1, pool->NumThreads()),
+                                       ZeroCounts());
+  pool->Run(0, num_groups, [&](const int task, const int thread) {
+    const Rect rect =
+        GroupRect(task, group_size, xsize_blocks, ysize_blocks);
+    const Rect rect_ctx(0, 0, rect.xsize(), rect.ysize());
+    const Image3B& ctx = contexts->Compute(rect, thread);
+    CountCoeffZeros(rect, qcoeffs.ac, rect_ctx, ctx,
+                    thread_zeros[thread].data(), grayscale);
+  });
+
+  ZeroCounts& num_zeros = thread_zeros[0];
+  for (size_t i = 1; i < thread_zeros.size(); ++i) {
+    for (size_t j = 0; j < num_zeros.size(); ++j) {
+      num_zeros[j] += thread_zeros[i][j];
     }
   }
-  if (fast_mode) {
-    histo_code = BuildAndEncodeHistogramsFast(all_tokens,
-                                              &codes, &context_map,
-                                              ac_info);
-  } else {
-    histo_code = BuildAndEncodeHistograms(kNumContexts, all_tokens,
-                                          &codes, &context_map,
+  CoeffOrderFromZeros(num_zeros.data(), order);
+}
+
+// Tokenizes groups [first_group, first_group + num_groups) in parallel,
+// computing their block contexts on the fly.
+std::vector<std::vector<Token> > TokenizeGroups(
+    const QuantizedCoeffs& qcoeffs, const bool grayscale,
+    const Quantizer& quantizer, const int32_t* PIK_RESTRICT order,
+    GroupBlockContexts* contexts, const size_t first_group,
+    const size_t num_groups, ThreadPool* pool) {
+  const size_t xsize_blocks = qcoeffs.dc.xsize();
+  const size_t ysize_blocks = qcoeffs.dc.ysize();
+  std::vector<std::vector<Token> > all_tokens(num_groups);
+  const ImageI& quant_field = quantizer.RawQuantField();
+  pool->Run(0, num_groups, [&](const int task, const int thread) {
+    const Rect rect = GroupRect(first_group + task, contexts->GroupSize(),
+                                xsize_blocks, ysize_blocks);
+    const Rect rect_ctx(0, 0, rect.xsize(), rect.ysize());
+    const Image3B& ctx = contexts->Compute(rect, thread);
+    // WARNING: TokenizeCoefficients also uses the DC values in qcoeffs.ac!
+    all_tokens[task] =
+        TokenizeCoefficients(order, rect, quant_field, qcoeffs.ac, rect_ctx,
+                             ctx, NumNZeroes(qcoeffs), grayscale);
+  });
+  return all_tokens;
+}
+
+// Clusters the histograms of all AC tokens (or uses the static context map
+// if "fast_mode") and returns their encoding. Header::kStaticHistograms in
+// "flags" overrides both.
+std::string EncodeACHistograms(
+    const std::vector<std::vector<Token> >& all_tokens, const uint32_t flags,
+    const bool fast_mode, std::vector<ANSEncodingData>* codes,
+    std::vector<uint8_t>* context_map, PikImageSizeInfo* ac_info,
+    ThreadPool* pool) {
+  if (flags & Header::kStaticHistograms) {
+    return BuildAndEncodeHistogramsStatic(all_tokens, codes, context_map,
                                           ac_info);
   }
+  if (fast_mode) {
+    return BuildAndEncodeHistogramsFast(all_tokens, codes, context_map,
+                                        ac_info);
+  }
+  return BuildAndEncodeHistograms(kNumContexts, all_tokens, codes, context_map,
+                                  ac_info, pool);
+}
+
+// Entropy-codes each group's AC tokens into "ac_group_codes" (in parallel).
+void WriteGroupTokens(const std::vector<std::vector<Token> >& all_tokens,
+                      const std::vector<ANSEncodingData>& codes,
+                      const std::vector<uint8_t>& context_map,
+                      const size_t num_ans_states,
+                      PikImageSizeInfoShards* info_shards, ThreadPool* pool,
+                      std::vector<PaddedBytes>* ac_group_codes) {
+  // Encoders append directly into these; each reserves its upper bound once.
+  ac_group_codes->resize(all_tokens.size());
+  pool->Run(0, all_tokens.size(), [&](const int task, const int thread) {
+    WriteTokens(all_tokens[task], codes, context_map, info_shards->Get(thread),
+                &(*ac_group_codes)[task], num_ans_states);
+  });
+}
+
+// Writes all parts of the bitstream in group order to "sink", starting at
+// "offset". "global_code" holds the ctan, noise and quantizer sections. Each
+// group code is written by a "pool" thread (if non-null) at its final offset.
+// Sets *size to the number of bytes written.
+bool WriteBitstream(const std::string& global_code, const std::string& dc_toc,
+                    const std::vector<PaddedBytes>& dc_group_codes,
+                    const std::string& order_code,
+                    const std::string& histo_code, const std::string& ac_toc,
+                    const std::vector<PaddedBytes>& ac_group_codes,
+                    const uint64_t offset, ThreadPool* pool,
+                    PositionedByteSink* sink, uint64_t* PIK_RESTRICT size) {
+  PROFILER_FUNC;
+  ThreadPool serial(0);
+  if (pool == nullptr) pool = &serial;
+  uint64_t pos = offset;
+  std::atomic<int> num_errors{0};
+
+  // The (small) fields before each kind of group are written in one call.
+  const auto write_fields = [&pos, sink](const std::string& fields) {
+    const bool ok = sink->WriteAt(
+        pos, reinterpret_cast<const uint8_t*>(fields.data()), fields.size());
+    pos += fields.size();
+    return ok;
+  };
+  const auto write_groups = [&](const std::vector<PaddedBytes>& codes) {
+    std::vector<uint64_t> begin(codes.size());
+    for (size_t i = 0; i < codes.size(); ++i) {
+      begin[i] = pos;
+      pos += codes[i].size();
+    }
+    pool->Run(0, codes.size(), [&](const int task, const int thread) {
+      const PaddedBytes& code = codes[task];
+      if (!sink->WriteAt(begin[task], code.data(), code.size())) {
+        num_errors.fetch_add(1);
+      }
+    });
+  };
+
+  if (!write_fields(global_code + dc_toc)) return false;
+  write_groups(dc_group_codes);
+  if (!write_fields(order_code + histo_code + ac_toc)) return false;
+  write_groups(ac_group_codes);
+  *size = pos - offset;
+  return num_errors.load(std::memory_order_relaxed) == 0;
+}
+
+// Returns the number of bytes written by WriteBitstream.
+uint64_t BitstreamSize(const std::string& global_code,
+                       const std::string& dc_toc,
+                       const std::vector<PaddedBytes>& dc_group_codes,
+                       const std::string& order_code,
+                       const std::string& histo_code,
+                       const std::string& ac_toc,
+                       const std::vector<PaddedBytes>& ac_group_codes) {
+  uint64_t size = global_code.size() + dc_toc.size() + order_code.size() +
+                  histo_code.size() + ac_toc.size();
+  for (const PaddedBytes& dc_group_code : dc_group_codes) {
+    size += dc_group_code.size();
+  }
+  for (const PaddedBytes& ac_group_code : ac_group_codes) {
+    size += ac_group_code.size();
+  }
+  return size;
+}
+
+// Returns the concatenation of all parts of the bitstream (see WriteBitstream).
+PaddedBytes ConcatenateBitstream(
+    const std::string& global_code, const std::string& dc_toc,
+    const std::vector<PaddedBytes>& dc_group_codes,
+    const std::string& order_code, const std::string& histo_code,
+    const std::string& ac_toc, const std::vector<PaddedBytes>& ac_group_codes,
+    ThreadPool* pool) {
+  const uint64_t size =
+      BitstreamSize(global_code, dc_toc, dc_group_codes, order_code,
+                    histo_code, ac_toc, ac_group_codes);
+  PaddedBytes out(size);
+  PaddedBytesSink sink(&out);
+  uint64_t written;
+  PIK_CHECK(WriteBitstream(global_code, dc_toc, dc_group_codes, order_code,
+                           histo_code, ac_toc, ac_group_codes, 0, pool, &sink,
+                           &written));
+  PIK_CHECK(written == size);
+  return out;
+}
 
-  std::string ac_toc(AcGroupSizeCoder::MaxSize(all_tokens.size()), '\0');
-  size_t ac_toc_pos = 0;
-  uint8_t* ac_toc_storage =
-      reinterpret_cast<uint8_t*>(const_cast<char*>(ac_toc.data()));
+// Output of AssembleBitstream: concatenated into "*bytes" if non-null,
+// otherwise written to "sink" at "offset".
+struct BitstreamOutput {
+  PaddedBytes* bytes;
+  uint64_t offset;
+  PositionedByteSink* sink;
+  uint64_t* size;
+};
+
+// Shared by both EncodeToBitstream: entropy-codes the AC tokens of all groups
+// and concatenates all parts of the bitstream in group order, so the output
+// does not depend on the number of threads. "info_shards" holds the statistics
+// of EncodeDCGroups; they are merged into "info" together with those of AC.
+bool AssembleBitstream(
+    const Header& header, const std::string& ctan_code,
+    const std::string& noise_code, const std::string& quant_code,
+    const std::vector<PaddedBytes>& dc_group_codes,
+    const std::string& order_code,
+    const std::vector<std::vector<Token> >& all_tokens, bool fast_mode,
+    PikImageSizeInfoShards* info_shards, ThreadPool* pool, PikInfo* info,
+    const BitstreamOutput& output) {
+  const size_t num_groups = dc_group_codes.size();
+  PikImageSizeInfo* dc_info = info ? &info->layers[kLayerDC] : nullptr;
+  PikImageSizeInfo* ac_info = info ? &info->layers[kLayerAC] : nullptr;
+  const bool small_image = (header.flags & Header::kSmallImage) != 0;
+  PIK_CHECK(!small_image || (num_groups == 1 && fast_mode));
 
-  for (int i = 0; i < all_tokens.size(); ++i) {
-    std::string ac_group_code =
-        WriteTokens(all_tokens[i], codes, context_map, ac_info);
-    AcGroupSizeCoder::Encode(ac_group_code.size(), &ac_toc_pos, ac_toc_storage);
-    ac_code += ac_group_code;
+  info_shards->MergeInto(dc_info);
+  size_t dc_code_size;
+  const std::string dc_toc =
+      EncodeGroupSizes<DcGroupSizeCoder>(dc_group_codes, &dc_code_size);
+
+  std::vector<ANSEncodingData> codes;
+  std::vector<uint8_t> context_map;
+  const std::string histo_code =
+      EncodeACHistograms(all_tokens, header.flags, fast_mode, &codes,
+                         &context_map, ac_info, pool);
+  if (info != nullptr && info->static_context_counts != nullptr) {
+    AddStaticContextCounts(all_tokens, info->static_context_counts);
+  }
+  if (info != nullptr && info->ac_tokens != nullptr) {
+    *info->ac_tokens = all_tokens;
   }
-  WriteZeroesToByteBoundary(&ac_toc_pos, ac_toc_storage);
-  ac_toc.resize(ac_toc_pos / kBitsPerByte);
+
+  std::vector<PaddedBytes> ac_group_codes;
+  WriteGroupTokens(all_tokens, codes, context_map, header.num_ans_states,
+                   info_shards, pool, &ac_group_codes);
+  info_shards->MergeInto(ac_info);
+
+  size_t ac_code_size;
+  std::string ac_toc =
+      EncodeGroupSizes<AcGroupSizeCoder>(ac_group_codes, &ac_code_size);
+  if (small_image) ac_toc.clear();  // The only group ends with the stream.
 
   if (info) {
     info->layers[kLayerHeader].total_size +=
         noise_code.size() + dc_toc.size() + ac_toc.size();
   }
 
-  PaddedBytes out(ctan_code.size() + noise_code.size() + quant_code.size() +
-                  dc_toc.size() + dc_code.size() + order_code.size() +
-                  histo_code.size() + ac_toc.size() + ac_code.size());
+  PIK_CHECK(!small_image || order_code.empty());
+  const std::string global_code = ctan_code + noise_code + quant_code;
+  if (output.bytes != nullptr) {
+    *output.bytes =
+        ConcatenateBitstream(global_code, dc_toc, dc_group_codes, order_code,
+                             histo_code, ac_toc, ac_group_codes, pool);
+    return true;
+  }
+  return WriteBitstream(global_code, dc_toc, dc_group_codes, order_code,
+                        histo_code, ac_toc, ac_group_codes, output.offset, pool,
+                        output.sink, output.size);
+}
+
+bool EncodeCoefficients(const QuantizedCoeffs& qcoeffs, const Header& header,
+                        const Quantizer& quantizer,
+                        const NoiseParams& noise_params,
+                        const ColorTransform& ctan, bool fast_mode,
+                        ThreadPool* pool, PikInfo* info,
+                        const BitstreamOutput& output) {
+  PROFILER_FUNC;
+  const size_t xsize_blocks = qcoeffs.dc.xsize();
+  const size_t ysize_blocks = qcoeffs.dc.ysize();
+  const size_t group_size = GroupSizeInBlocks(header);
+  const size_t xsize_groups = DivCeil(xsize_blocks, group_size);
+  const size_t ysize_groups = DivCeil(ysize_blocks, group_size);
+  const size_t num_groups = xsize_groups * ysize_groups;
+  PikImageSizeInfo* ctan_info = info ? &info->layers[kLayerCtan] : nullptr;
+  std::string ctan_code = EncodeColorMaps(header, ctan, ctan_info);
+  PikImageSizeInfo* quant_info = info ? &info->layers[kLayerQuant] : nullptr;
+  std::string noise_code = EncodeNoise(noise_params);
+  std::string quant_code = quantizer.Encode(quant_info);
+
+  // Groups are encoded independently into their own buffers (in parallel).
+  std::vector<PaddedBytes> dc_group_codes(num_groups);
+  // Per-thread statistics, merged after each parallel stage.
+  PikImageSizeInfoShards info_shards(
+      info ? std::max<size_t>(1, pool->NumThreads()) : 0);
+
+  const bool grayscale = (header.flags & Header::kGrayscale) != 0;
+  EncodeDCGroups(qcoeffs.dc, grayscale, group_size, 0, pool, &info_shards,
+                 &dc_group_codes);
+
+  // Block contexts are computed per group where needed (twice if not
+  // fast_mode, which is cheaper than storing them for the whole image).
+  GroupBlockContexts contexts(qcoeffs.dc, quantizer, group_size, pool);
+  const bool small_image = (header.flags & Header::kSmallImage) != 0;
+  int32_t order[kOrderContexts * kBlockSize];
+  if (fast_mode || small_image) {
+    NaturalCoeffOrders(order);
+  } else {
+    ComputeCoeffOrderPerGroup(qcoeffs, grayscale, &contexts, pool, order);
+  }
+
+  const std::string order_code =
+      small_image ? std::string() : EncodeCoeffOrders(order, info);
+  const std::vector<std::vector<Token> > all_tokens =
+      TokenizeGroups(qcoeffs, grayscale, quantizer, order, &contexts, 0,
+                     num_groups, pool);
+
+  return AssembleBitstream(header, ctan_code, noise_code, quant_code,
+                           dc_group_codes, order_code, all_tokens,
+                           fast_mode || small_image, &info_shards, pool, info,
+                           output);
+}
+
+}  // namespace
+
+PaddedBytes EncodeToBitstream(const QuantizedCoeffs& qcoeffs,
+                              const Header& header,
+                              const Quantizer& quantizer,
+                              const NoiseParams& noise_params,
+                              const ColorTransform& ctan, bool fast_mode,
+                              ThreadPool* pool, PikInfo* info) {
+  PaddedBytes compressed;
+  PIK_CHECK(EncodeCoefficients(qcoeffs, header, quantizer, noise_params, ctan,
+                               fast_mode, pool, info,
+                               {&compressed, 0, nullptr, nullptr}));
+  return compressed;
+}
+
+bool EncodeToBitstream(const QuantizedCoeffs& qcoeffs, const Header& header,
+                       const Quantizer& quantizer,
+                       const NoiseParams& noise_params,
+                       const ColorTransform& ctan, bool fast_mode,
+                       ThreadPool* pool, const uint64_t offset,
+                       PositionedByteSink* sink, uint64_t* size,
+                       PikInfo* info) {
+  return EncodeCoefficients(qcoeffs, header, quantizer, noise_params, ctan,
+                            fast_mode, pool, info,
+                            {nullptr, offset, sink, size});
+}
+
+EncodingPlan PlanEncoding(const QuantizedCoeffs& qcoeffs, const Header& header,
+                          const Quantizer& quantizer,
+                          const NoiseParams& noise_params,
+                          const ColorTransform& ctan, bool fast_mode,
+                          ThreadPool* pool) {
+  PROFILER_FUNC;
+  const size_t xsize_blocks = qcoeffs.dc.xsize();
+  const size_t ysize_blocks = qcoeffs.dc.ysize();
+  const size_t group_size = GroupSizeInBlocks(header);
+  const size_t num_groups = DivCeil(xsize_blocks, group_size) *
+                            DivCeil(ysize_blocks, group_size);
+  EncodingPlan plan;
+  plan.num_groups = num_groups;
+  plan.flags = header.flags;
+  plan.num_ans_states = header.num_ans_states;
+  plan.group_size_in_blocks = group_size;
+  plan.global_code = EncodeColorMaps(header, ctan, nullptr) +
+                     EncodeNoise(noise_params) + quantizer.Encode(nullptr);
+
+  const bool grayscale = (header.flags & Header::kGrayscale) != 0;
+  const bool small_image = (header.flags & Header::kSmallImage) != 0;
+  PIK_CHECK(!small_image || (num_groups == 1 && fast_mode));
+  GroupBlockContexts contexts(qcoeffs.dc, quantizer, group_size, pool);
+  if (fast_mode || small_image) {
+    NaturalCoeffOrders(plan.order);
+  } else {
+    ComputeCoeffOrderPerGroup(qcoeffs, grayscale, &contexts, pool, plan.order);
+  }
+  if (!small_image) plan.order_code = EncodeCoeffOrders(plan.order, nullptr);
+
+  const std::vector<std::vector<Token> > all_tokens =
+      TokenizeGroups(qcoeffs, grayscale, quantizer, plan.order, &contexts, 0,
+                     num_groups, pool);
+  plan.histo_code = EncodeACHistograms(all_tokens, header.flags,
+                                       fast_mode || small_image, &plan.codes,
+                                       &plan.context_map, nullptr, pool);
+  return plan;
+}
+
+namespace {
+
+void AppendU32(const uint32_t value, std::string* out) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out->push_back(static_cast<char>((value >> shift) & 0xFF));
+  }
+}
+
+void AppendBytes(const uint8_t* bytes, const size_t size, std::string* out) {
+  AppendU32(size, out);
+  out->append(reinterpret_cast<const char*>(bytes), size);
+}
+
+void AppendString(const std::string& str, std::string* out) {
+  AppendBytes(reinterpret_cast<const uint8_t*>(str.data()), str.size(), out);
+}
+
+// Bounds-checked reader for DeserializePlan.
+class PlanReader {
+ public:
+  explicit PlanReader(const PaddedBytes& bytes)
+      : pos_(bytes.data()), end_(bytes.data() + bytes.size()) {}
+
+  bool ReadU32(uint32_t* PIK_RESTRICT value) {
+    if (end_ - pos_ < 4) return false;
+    *value = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      *value |= static_cast<uint32_t>(*pos_++) << shift;
+    }
+    return true;
+  }
+
+  bool ReadU16(int* PIK_RESTRICT value) {
+    if (end_ - pos_ < 2) return false;
+    *value = pos_[0] | (pos_[1] << 8);
+    pos_ += 2;
+    return true;
+  }
+
+  bool ReadString(std::string* PIK_RESTRICT str) {
+    uint32_t size;
+    if (!ReadU32(&size) || end_ - pos_ < size) return false;
+    str->assign(reinterpret_cast<const char*>(pos_), size);
+    pos_ += size;
+    return true;
+  }
+
+  bool AtEnd() const { return pos_ == end_; }
+
+ private:
+  const uint8_t* pos_;
+  const uint8_t* const end_;
+};
+
+}  // namespace
+
+PaddedBytes SerializePlan(const EncodingPlan& plan) {
+  std::string bytes;
+  AppendU32(plan.num_groups, &bytes);
+  AppendU32(plan.flags, &bytes);
+  AppendU32(plan.num_ans_states, &bytes);
+  AppendU32(plan.group_size_in_blocks, &bytes);
+  AppendString(plan.global_code, &bytes);
+  AppendString(plan.order_code, &bytes);
+  AppendString(plan.histo_code, &bytes);
+  // Orders are permutations of [0, kBlockSize), so one byte per entry.
+  static_assert(kBlockSize <= 256, "Order entries must fit in a byte");
+  std::vector<uint8_t> order(kOrderContexts * kBlockSize);
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = plan.order[i];
+  }
+  AppendBytes(order.data(), order.size(), &bytes);
+  AppendBytes(plan.context_map.data(), plan.context_map.size(), &bytes);
+  // The normalized frequencies suffice to rebuild the encoding tables.
+  AppendU32(plan.codes.size(), &bytes);
+  for (const ANSEncodingData& code : plan.codes) {
+    AppendU32(code.ans_table.size(), &bytes);
+    for (const ANSEncSymbolInfo& info : code.ans_table) {
+      bytes.push_back(static_cast<char>(info.freq_ & 0xFF));
+      bytes.push_back(static_cast<char>(info.freq_ >> 8));
+    }
+  }
+
+  PaddedBytes out(bytes.size());
   size_t byte_pos = 0;
-  Append(ctan_code, &out, &byte_pos);
-  Append(noise_code, &out, &byte_pos);
-  Append(quant_code, &out, &byte_pos);
-  Append(dc_toc, &out, &byte_pos);
-  Append(dc_code, &out, &byte_pos);
-  Append(order_code, &out, &byte_pos);
-  Append(histo_code, &out, &byte_pos);
-  Append(ac_toc, &out, &byte_pos);
-  Append(ac_code, &out, &byte_pos);
+  Append(bytes, &out, &byte_pos);
   return out;
 }
 
+bool DeserializePlan(const PaddedBytes& bytes, EncodingPlan* plan) {
+  PlanReader reader(bytes);
+  if (!reader.ReadU32(&plan->num_groups) || !reader.ReadU32(&plan->flags) ||
+      !reader.ReadU32(&plan->num_ans_states) ||
+      !reader.ReadU32(&plan->group_size_in_blocks) ||
+      !reader.ReadString(&plan->global_code) ||
+      !reader.ReadString(&plan->order_code) ||
+      !reader.ReadString(&plan->histo_code)) {
+    return PIK_FAILURE("Truncated plan");
+  }
+  if (plan->group_size_in_blocks == 0) return PIK_FAILURE("Invalid group size");
+
+  std::string order;
+  if (!reader.ReadString(&order) ||
+      order.size() != kOrderContexts * kBlockSize) {
+    return PIK_FAILURE("Invalid order");
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    plan->order[i] = static_cast<uint8_t>(order[i]);
+  }
+
+  std::string context_map;
+  if (!reader.ReadString(&context_map)) return PIK_FAILURE("Truncated map");
+  plan->context_map.assign(context_map.begin(), context_map.end());
+
+  uint32_t num_codes;
+  if (!reader.ReadU32(&num_codes)) return PIK_FAILURE("Truncated codes");
+  for (const uint8_t ctx : plan->context_map) {
+    if (ctx >= num_codes) return PIK_FAILURE("Invalid context map");
+  }
+  plan->codes.clear();
+  plan->codes.reserve(num_codes);
+  for (uint32_t i = 0; i < num_codes; ++i) {
+    uint32_t alphabet_size;
+    if (!reader.ReadU32(&alphabet_size)) return PIK_FAILURE("Truncated code");
+    std::vector<int> freqs(alphabet_size);
+    for (uint32_t s = 0; s < alphabet_size; ++s) {
+      if (!reader.ReadU16(&freqs[s])) return PIK_FAILURE("Truncated freqs");
+    }
+    plan->codes.emplace_back();
+    plan->codes.back().BuildFromFrequencies(freqs);
+  }
+  if (!reader.AtEnd()) return PIK_FAILURE("Trailing plan bytes");
+  return true;
+}
+
+void EncodeGroupShard(const EncodingPlan& plan, const QuantizedCoeffs& qcoeffs,
+                      const Quantizer& quantizer, size_t first_group,
+                      size_t num_groups, ThreadPool* pool,
+                      std::vector<PaddedBytes>* dc_group_codes,
+                      std::vector<PaddedBytes>* ac_group_codes) {
+  PROFILER_FUNC;
+  PIK_CHECK(first_group + num_groups <= plan.num_groups);
+  const bool grayscale = (plan.flags & Header::kGrayscale) != 0;
+  PikImageSizeInfoShards info_shards(0);  // no statistics
+  dc_group_codes->resize(num_groups);
+  EncodeDCGroups(qcoeffs.dc, grayscale, plan.group_size_in_blocks, first_group,
+                 pool, &info_shards, dc_group_codes);
+
+  GroupBlockContexts contexts(qcoeffs.dc, quantizer, plan.group_size_in_blocks,
+                              pool);
+  const std::vector<std::vector<Token> > tokens =
+      TokenizeGroups(qcoeffs, grayscale, quantizer, plan.order, &contexts,
+                     first_group, num_groups, pool);
+  WriteGroupTokens(tokens, plan.codes, plan.context_map, plan.num_ans_states,
+                   &info_shards, pool, ac_group_codes);
+}
+
+PaddedBytes StitchBitstream(const EncodingPlan& plan,
+                            const std::vector<PaddedBytes>& dc_group_codes,
+                            const std::vector<PaddedBytes>& ac_group_codes) {
+  PIK_CHECK(dc_group_codes.size() == plan.num_groups);
+  PIK_CHECK(ac_group_codes.size() == plan.num_groups);
+  size_t dc_code_size, ac_code_size;
+  const std::string dc_toc =
+      EncodeGroupSizes<DcGroupSizeCoder>(dc_group_codes, &dc_code_size);
+  std::string ac_toc =
+      EncodeGroupSizes<AcGroupSizeCoder>(ac_group_codes, &ac_code_size);
+  if (plan.flags & Header::kSmallImage) ac_toc.clear();
+  return ConcatenateBitstream(plan.global_code, dc_toc, dc_group_codes,
+                              plan.order_code, plan.histo_code, ac_toc,
+                              ac_group_codes, /*pool=*/nullptr);
+}
+
+size_t EstimateBitstreamSize(const QuantizedCoeffs& qcoeffs,
+                             const Header& header, const Quantizer& quantizer,
+                             const NoiseParams& noise_params,
+                             const ColorTransform& ctan, ThreadPool* pool) {
+  PROFILER_FUNC;
+  const size_t xsize_blocks = qcoeffs.dc.xsize();
+  const size_t ysize_blocks = qcoeffs.dc.ysize();
+  const size_t group_size = GroupSizeInBlocks(header);
+  const size_t xsize_groups = DivCeil(xsize_blocks, group_size);
+  const size_t ysize_groups = DivCeil(ysize_blocks, group_size);
+  const size_t num_groups = xsize_groups * ysize_groups;
+  const size_t ctan_size = EncodeColorMaps(header, ctan, nullptr).size();
+  const size_t noise_size = EncodeNoise(noise_params).size();
+  const size_t quant_size = quantizer.Encode(nullptr).size();
+
+  // DC is a small fraction of the total, so it is actually encoded; this also
+  // computes the block contexts required for tokenizing AC.
+  std::vector<PaddedBytes> dc_group_codes(num_groups);
+  PikImageSizeInfoShards info_shards(0);  // no statistics
+  const bool grayscale = (header.flags & Header::kGrayscale) != 0;
+  EncodeDCGroups(qcoeffs.dc, grayscale, group_size, 0, pool, &info_shards,
+                 &dc_group_codes);
+  size_t dc_code_size;
+  const std::string dc_toc =
+      EncodeGroupSizes<DcGroupSizeCoder>(dc_group_codes, &dc_code_size);
+
+  GroupBlockContexts contexts(qcoeffs.dc, quantizer, group_size, pool);
+  const bool small_image = (header.flags & Header::kSmallImage) != 0;
+  int32_t order[kOrderContexts * kBlockSize];
+  size_t order_size = 0;
+  if (small_image) {
+    NaturalCoeffOrders(order);
+  } else {
+    ComputeCoeffOrderPerGroup(qcoeffs, grayscale, &contexts, pool, order);
+    order_size = EncodeCoeffOrders(order, nullptr).size();
+  }
+
+  // Only the symbol counts are needed, so the tokens are not materialized.
+  std::vector<TokenCounts> thread_counts(
+      std::max<size_t>(1, pool->NumThreads()));
+  const ImageI& quant_field = quantizer.RawQuantField();
+  pool->Run(0, num_groups, [&](const int task, const int thread) {
+    const Rect rect = GroupRect(task, group_size, xsize_blocks, ysize_blocks);
+    const Rect rect_ctx(0, 0, rect.xsize(), rect.ysize());
+    const Image3B& ctx = contexts.Compute(rect, thread);
+    CountCoefficientSymbols(order, rect, quant_field, qcoeffs.ac, rect_ctx, ctx,
+                            NumNZeroes(qcoeffs), &thread_counts[thread],
+                            grayscale);
+  });
+  for (size_t i = 1; i < thread_counts.size(); ++i) {
+    thread_counts[0].Assimilate(thread_counts[i]);
+  }
+  const float ac_bits = EstimateTokenBits(kNumContexts, thread_counts[0]);
+
+  // The AC TOC is not known without per-group sizes; use its upper bound.
+  const size_t ac_toc_size =
+      small_image ? 0 : AcGroupSizeCoder::MaxSize(num_groups);
+  return ctan_size + noise_size + quant_size + dc_toc.size() + dc_code_size +
+         order_size + DivCeil(static_cast<size_t>(ac_bits), kBitsPerByte) +
+         ac_toc_size;
+}
+
+ImageF EstimateGroupBits(const QuantizedCoeffs& qcoeffs,
+                         const Quantizer& quantizer, ThreadPool* pool,
+                         TokenCostModel* model) {
+  PROFILER_FUNC;
+  const size_t xsize_blocks = qcoeffs.dc.xsize();
+  const size_t ysize_blocks = qcoeffs.dc.ysize();
+  const size_t xsize_groups = DivCeil(xsize_blocks, kGroupWidthInBlocks);
+  const size_t ysize_groups = DivCeil(ysize_blocks, kGroupHeightInBlocks);
+  const size_t xsize_tiles = DivCeil(xsize_blocks, kTileWidthInBlocks);
+  const size_t ysize_tiles = DivCeil(ysize_blocks, kTileHeightInBlocks);
+  const size_t num_tiles = xsize_tiles * ysize_tiles;
+
+  Image3B block_ctx(xsize_blocks, ysize_blocks);
+  pool->Run(0, xsize_groups * ysize_groups,
+            [&](const int task, const int thread) {
+              const size_t x = task % xsize_groups;
+              const size_t y = task / xsize_groups;
+              const Rect rect(x * kGroupWidthInBlocks, y * kGroupHeightInBlocks,
+                              kGroupWidthInBlocks, kGroupHeightInBlocks,
+                              xsize_blocks, ysize_blocks);
+              ComputeBlockContextFromDC(rect, qcoeffs.dc, quantizer, rect,
+                                        &block_ctx);
+            });
+
+  int32_t order[kOrderContexts * kBlockSize];
+  ComputeCoeffOrder(qcoeffs.ac, block_ctx, pool, order);
+
+  std::vector<std::vector<Token> > all_tokens(num_tiles);
+  const ImageI& quant_field = quantizer.RawQuantField();
+  pool->Run(0, num_tiles, [&](const int task, const int thread) {
+    const size_t x = task % xsize_tiles;
+    const size_t y = task / xsize_tiles;
+    const Rect rect(x * kTileWidthInBlocks, y * kTileHeightInBlocks,
+                    kTileWidthInBlocks, kTileHeightInBlocks, xsize_blocks,
+                    ysize_blocks);
+    all_tokens[task] = TokenizeCoefficients(order, rect, quant_field,
+                                            qcoeffs.ac, rect, block_ctx,
+                                            NumNZeroes(qcoeffs));
+  });
+  if (!model->IsInitialized()) {
+    model->Init(all_tokens);
+  }
+
+  ImageF bits(xsize_tiles, ysize_tiles);
+  pool->Run(0, num_tiles, [&](const int task, const int thread) {
+    bits.Row(task / xsize_tiles)[task % xsize_tiles] =
+        model->Bits(all_tokens[task]);
+  });
+  return bits;
+}
+
+void NaturalCoeffOrders(int32_t* PIK_RESTRICT order) {
+  for (size_t i = 0; i < kOrderContexts; ++i) {
+    memcpy(&order[i * kBlockSize], kNaturalCoeffOrder,
+           kBlockSize * sizeof(order[0]));
+  }
+}
+
+namespace {
+
+bool EncodeTokens(const Image3S& dc,
+                  const std::vector<std::vector<Token> >& tokens,
+                  const Header& header, const Quantizer& quantizer,
+                  const NoiseParams& noise_params, const ColorTransform& ctan,
+                  ThreadPool* pool, PikInfo* info,
+                  const BitstreamOutput& output) {
+  PROFILER_FUNC;
+  const size_t num_groups = tokens.size();
+  const size_t group_size = GroupSizeInBlocks(header);
+  PIK_CHECK(num_groups ==
+            DivCeil(dc.xsize(), group_size) * DivCeil(dc.ysize(), group_size));
+  PikImageSizeInfo* ctan_info = info ? &info->layers[kLayerCtan] : nullptr;
+  std::string ctan_code = EncodeColorMaps(header, ctan, ctan_info);
+  PikImageSizeInfo* quant_info = info ? &info->layers[kLayerQuant] : nullptr;
+  std::string noise_code = EncodeNoise(noise_params);
+  std::string quant_code = quantizer.Encode(quant_info);
+
+  std::vector<PaddedBytes> dc_group_codes(num_groups);
+  PikImageSizeInfoShards info_shards(
+      info ? std::max<size_t>(1, pool->NumThreads()) : 0);
+  EncodeDCGroups(dc, (header.flags & Header::kGrayscale) != 0, group_size, 0,
+                 pool, &info_shards, &dc_group_codes);
+
+  int32_t order[kOrderContexts * kBlockSize];
+  NaturalCoeffOrders(order);
+  const std::string order_code = (header.flags & Header::kSmallImage)
+                                     ? std::string()
+                                     : EncodeCoeffOrders(order, info);
+
+  return AssembleBitstream(header, ctan_code, noise_code, quant_code,
+                           dc_group_codes, order_code, tokens,
+                           /*fast_mode=*/true, &info_shards, pool, info,
+                           output);
+}
+
+}  // namespace
+
+PaddedBytes EncodeToBitstream(const Image3S& dc,
+                              const std::vector<std::vector<Token> >& tokens,
+                              const Header& header, const Quantizer& quantizer,
+                              const NoiseParams& noise_params,
+                              const ColorTransform& ctan, ThreadPool* pool,
+                              PikInfo* info) {
+  PaddedBytes compressed;
+  PIK_CHECK(EncodeTokens(dc, tokens, header, quantizer, noise_params, ctan,
+                         pool, info, {&compressed, 0, nullptr, nullptr}));
+  return compressed;
+}
+
+bool EncodeToBitstream(const Image3S& dc,
+                       const std::vector<std::vector<Token> >& tokens,
+                       const Header& header, const Quantizer& quantizer,
+                       const NoiseParams& noise_params,
+                       const ColorTransform& ctan, ThreadPool* pool,
+                       const uint64_t offset, PositionedByteSink* sink,
+                       uint64_t* size, PikInfo* info) {
+  return EncodeTokens(dc, tokens, header, quantizer, noise_params, ctan, pool,
+                      info, {nullptr, offset, sink, size});
+}
+
 bool DecodeColorMap(BitReader* PIK_RESTRICT br, ImageI* PIK_RESTRICT ac_map,
                     int* PIK_RESTRICT dc_val) {
   HuffmanDecodingData entropy;
   if (!entropy.ReadFromBitStream(br)) {
     return PIK_FAILURE("Invalid histogram data.");
   }
+  const bool multi_symbol = entropy.BuildMultiSymbolTable();
   HuffmanDecoder decoder;
   br->FillBitBuffer();
   *dc_val = decoder.ReadSymbol(entropy, br);
+  const size_t xsize = ac_map->xsize();
   for (size_t y = 0; y < ac_map->ysize(); ++y) {
     int* PIK_RESTRICT row = ac_map->Row(y);
-    for (size_t x = 0; x < ac_map->xsize(); ++x) {
+    size_t x = 0;
+    if (multi_symbol) {
+      while (x + kHuffmanMaxMultiSymbols <= xsize) {
+        x += decoder.ReadSymbols(entropy, br, row + x);
+      }
+    }
+    for (; x < xsize; ++x) {
       br->FillBitBuffer();
       row[x] = decoder.ReadSymbol(entropy, br);
     }
@@ -1224,15 +2874,22 @@ std::vector<uint64_t> OffsetsFromSizes(const size_t num_groups,
   return offsets;
 }
 
-// Returns whether the entire group is accessible - we need bounds checking
-// because offsets are derived from untrusted sizes.
-bool IsSizeWithinBounds(const uint8_t* groups_begin, const uint8_t* data_end,
-                        const uint64_t offset_begin, const uint64_t offset_end,
-                        size_t* PIK_RESTRICT size) {
-  if (groups_begin + offset_end > data_end) {
+// Returns a reader for the group at [offset_begin, offset_end) relative to
+// "groups_begin" if it lies within "stream" - we need bounds checking because
+// offsets are derived from untrusted sizes. Groups that straddle segments are
+// copied to "storage", which must outlive the reader.
+bool GroupReader(const SegmentedBytes& stream, const uint64_t groups_begin,
+                 const uint64_t offset_begin, const uint64_t offset_end,
+                 PaddedBytes* storage, PaddedBitReader* PIK_RESTRICT reader) {
+  if (groups_begin + offset_end > stream.size()) {
     return PIK_FAILURE("Group size exceeds [truncated?] stream length");
   }
-  *size = offset_end - offset_begin;
+  const size_t size = offset_end - offset_begin;
+  size_t readable;
+  const uint8_t* data =
+      stream.Range(groups_begin + offset_begin, size, storage, &readable);
+  // The group readers may load (but not consume) bytes up to "readable".
+  *reader = PaddedBitReader(data, size, readable);
   return true;
 }
 
@@ -1305,17 +2962,28 @@ class Dequant {
   }
 
   // Dequantizes and inverse color-transforms one group, i.e. the window "rect"
-  // (in block units) within the entire output image "cache->ac".
+  // (in block units) of the quant field/color maps, and writes it to the
+  // window "rect_out" of "out" (e.g. cache->ac). If non-null, "num_nzeroes"
+  // holds the DecodeAC nonzero counts (relative to rect); blocks known to be
+  // empty skip loading and dequantizing their coefficients. "rect" must start
+  // at a tile boundary because the color maps are indexed per tile. All three
+  // planes of a block are processed together, so Y is still in registers when
+  // X and B add their correlation with it.
   void DoAC(const Rect& rect_ac16, const Image3S& img_ac16, const Rect& rect,
             const ImageI& img_quant_field, const ImageI& img_ytox,
-            const ImageI& img_ytob, DecCache* PIK_RESTRICT cache) const {
+            const ImageI& img_ytob, const Rect& rect_out,
+            Image3F* PIK_RESTRICT out,
+            const Image3I* num_nzeroes = nullptr) const {
     const size_t xsize = rect_ac16.xsize();  // [blocks]
     const size_t ysize = rect_ac16.ysize();
     PIK_ASSERT(img_ac16.xsize() % kBlockSize == 0);
     PIK_ASSERT(xsize <= img_ac16.xsize() / kBlockSize);
     PIK_ASSERT(ysize <= img_ac16.ysize());
     PIK_ASSERT(SameSize(rect_ac16, rect));
+    PIK_ASSERT(SameSize(rect, rect_out));
     PIK_ASSERT(SameSize(img_ytox, img_ytob));
+    PIK_ASSERT(rect.x0() % kTileWidthInBlocks == 0);
+    PIK_ASSERT(rect.y0() % kTileHeightInBlocks == 0);
 
     using namespace SIMD_NAMESPACE;
     using D = Full<float>;
@@ -1325,66 +2993,89 @@ class Dequant {
 
     const size_t x0_ctan = rect.x0() / kTileWidthInBlocks;
     const size_t y0_ctan = rect.y0() / kTileHeightInBlocks;
-    const size_t x0_dct = rect.x0() * kBlockSize;
+    const size_t x0_dct = rect_out.x0() * kBlockSize;
     const size_t x0_dct16 = rect_ac16.x0() * kBlockSize;
+    const auto zero = setzero(d);
+    if (num_nzeroes != nullptr) {
+      PIK_ASSERT(xsize <= num_nzeroes->xsize());
+      PIK_ASSERT(ysize <= num_nzeroes->ysize());
+    }
+    const float* PIK_RESTRICT dequant_x = dequant_matrix_;
+    const float* PIK_RESTRICT dequant_y = dequant_matrix_ + kBlockSize;
+    const float* PIK_RESTRICT dequant_b = dequant_matrix_ + 2 * kBlockSize;
 
     for (size_t by = 0; by < ysize; ++by) {
+      const size_t y16 = rect_ac16.y0() + by;
+      const int16_t* PIK_RESTRICT row_x16 =
+          img_ac16.ConstPlaneRow(0, y16) + x0_dct16;
       const int16_t* PIK_RESTRICT row_y16 =
-          img_ac16.PlaneRow(1, rect_ac16.y0() + by) + x0_dct16;
+          img_ac16.ConstPlaneRow(1, y16) + x0_dct16;
+      const int16_t* PIK_RESTRICT row_b16 =
+          img_ac16.ConstPlaneRow(2, y16) + x0_dct16;
       const int* PIK_RESTRICT row_quant_field =
           rect.ConstRow(img_quant_field, by);
-      float* PIK_RESTRICT row_y =
-          cache->ac.PlaneRow(1, rect.y0() + by) + x0_dct;
-
-      for (size_t bx = 0; bx < xsize; ++bx) {
-        for (size_t k = 0; k < kBlockSize; k += d.N) {
-          const size_t x = bx * kBlockSize + k;
-
-          const auto dequant = load(d, dequant_matrix_ + kBlockSize + k);
-          const auto y_mul = dequant * set1(d, SafeDiv(inv_global_scale_,
-                                                       row_quant_field[bx]));
-
-          const auto quantized_y16 = load(d16, row_y16 + x);
-          const auto quantized_y =
-              convert_to(d, convert_to(d32, quantized_y16));
-          store(quantized_y * y_mul, d, row_y + x);
+      const size_t y_ctan = y0_ctan + by / kTileHeightInBlocks;
+      const int* PIK_RESTRICT row_ytox = img_ytox.ConstRow(y_ctan) + x0_ctan;
+      const int* PIK_RESTRICT row_ytob = img_ytob.ConstRow(y_ctan) + x0_ctan;
+      const int32_t* PIK_RESTRICT row_nzeros[3] = {nullptr, nullptr, nullptr};
+      if (num_nzeroes != nullptr) {
+        for (int c = 0; c < 3; ++c) {
+          row_nzeros[c] = num_nzeroes->ConstPlaneRow(c, by);
         }
       }
-    }
-
-    for (int c = 0; c < 3; c += 2) {  // === for c in {0, 2}
-      const ImageI& img_ctan = (c == 0) ? img_ytox : img_ytob;
-      for (size_t by = 0; by < ysize; ++by) {
-        const int16_t* PIK_RESTRICT row_xb16 =
-            img_ac16.PlaneRow(c, rect_ac16.y0() + by) + x0_dct16;
-        const int* PIK_RESTRICT row_quant_field =
-            rect.ConstRow(img_quant_field, by);
-        const int* PIK_RESTRICT row_ctan =
-            img_ctan.ConstRow(y0_ctan + by / kTileHeightInBlocks) + x0_ctan;
-        const float* PIK_RESTRICT row_y =
-            cache->ac.ConstPlaneRow(1, rect.y0() + by) + x0_dct;
-        float* PIK_RESTRICT row_xb =
-            cache->ac.PlaneRow(c, rect.y0() + by) + x0_dct;
-
-        for (size_t bx = 0; bx < xsize; ++bx) {
-          const int32_t ctan = row_ctan[bx / kTileWidthInBlocks];
-          const auto y_mul = (c == 0) ? set1(d, kColorFactorX * (ctan - 128))
-                                      : set1(d, kColorFactorB * ctan);
-
-          for (size_t k = 0; k < kBlockSize; k += d.N) {
-            const size_t x = bx * kBlockSize + k;
-
-            const auto dequant = load(d, dequant_matrix_ + c * kBlockSize + k);
-            const auto xb_mul = dequant * set1(d, SafeDiv(inv_global_scale_,
-                                                          row_quant_field[bx]));
-
-            const auto quantized_xb16 = load(d16, row_xb16 + x);
-            const auto quantized_xb =
-                convert_to(d, convert_to(d32, quantized_xb16));
-
-            const auto out_y = load(d, row_y + x);
-
-            store(mul_add(y_mul, out_y, quantized_xb * xb_mul), d, row_xb + x);
+      const size_t y_out = rect_out.y0() + by;
+      float* PIK_RESTRICT row_x = out->PlaneRow(0, y_out) + x0_dct;
+      float* PIK_RESTRICT row_y = out->PlaneRow(1, y_out) + x0_dct;
+      float* PIK_RESTRICT row_b = out->PlaneRow(2, y_out) + x0_dct;
+
+      for (size_t tx = 0; tx * kTileWidthInBlocks < xsize; ++tx) {
+        // The color correlation is constant within a tile.
+        const auto ytox = set1(d, kColorFactorX * (row_ytox[tx] - 128));
+        const auto ytob = set1(d, kColorFactorB * row_ytob[tx]);
+        const size_t bx_end = std::min(xsize, (tx + 1) * kTileWidthInBlocks);
+
+        for (size_t bx = tx * kTileWidthInBlocks; bx < bx_end; ++bx) {
+          bool empty[3];
+          for (int c = 0; c < 3; ++c) {
+            empty[c] = row_nzeros[c] != nullptr && row_nzeros[c][bx] == 0;
+          }
+          const auto quant_mul =
+              set1(d, SafeDiv(inv_global_scale_, row_quant_field[bx]));
+
+          for (size_t x = bx * kBlockSize; x < (bx + 1) * kBlockSize;
+               x += d.N) {
+            const size_t k = x - bx * kBlockSize;
+            auto out_y = zero;
+            if (!empty[1]) {
+              const auto quantized_y =
+                  convert_to(d, convert_to(d32, load(d16, row_y16 + x)));
+              out_y = quantized_y * (load(d, dequant_y + k) * quant_mul);
+            }
+            store(out_y, d, row_y + x);
+
+            // Without coefficients, only the correlation with Y remains (or
+            // nothing at all).
+            auto out_x = zero;
+            if (!empty[0]) {
+              const auto quantized_x =
+                  convert_to(d, convert_to(d32, load(d16, row_x16 + x)));
+              const auto x_mul = load(d, dequant_x + k) * quant_mul;
+              out_x = mul_add(ytox, out_y, quantized_x * x_mul);
+            } else if (!empty[1]) {
+              out_x = mul_add(ytox, out_y, zero);
+            }
+            store(out_x, d, row_x + x);
+
+            auto out_b = zero;
+            if (!empty[2]) {
+              const auto quantized_b =
+                  convert_to(d, convert_to(d32, load(d16, row_b16 + x)));
+              const auto b_mul = load(d, dequant_b + k) * quant_mul;
+              out_b = mul_add(ytob, out_y, quantized_b * b_mul);
+            } else if (!empty[1]) {
+              out_b = mul_add(ytob, out_y, zero);
+            }
+            store(out_b, d, row_b + x);
           }
         }
       }
@@ -1406,23 +3097,71 @@ class Dequant {
   float inv_global_scale_;
 };
 
-// Temporary storage; one per thread, for one group.
-struct DecoderBuffers {
-  void InitOnce(const bool eager_dequant) {
-    // This thread already allocated its buffers.
-    if (num_nzeroes.xsize() != 0) return;
-
-    // Allocate enough for a whole group - partial groups on the right/bottom
-    // border just use a subset. The valid size is passed via Rect.
-    const size_t xsize_blocks = kGroupWidthInBlocks;
-    const size_t ysize_blocks = kGroupHeightInBlocks;
-
-    block_ctx = Image3B(xsize_blocks, ysize_blocks);
+void DequantizeAC(const Quantizer& quantizer, const ColorTransform& ctan,
+                  const Image3S& quantized_ac, Image3F* PIK_RESTRICT ac) {
+  PIK_ASSERT(quantized_ac.xsize() % kBlockSize == 0);
+  Dequant dequant;
+  dequant.Init(ctan, quantizer);
+  const Rect rect(0, 0, quantized_ac.xsize() / kBlockSize,
+                  quantized_ac.ysize());
+  ac->Resize(quantized_ac.xsize(), quantized_ac.ysize());
+  dequant.DoAC(rect, quantized_ac, rect, quantizer.RawQuantField(),
+               ctan.ytox_map, ctan.ytob_map, rect, ac);
+}
 
-    if (eager_dequant) {
-      quantized_dc = Image3S(xsize_blocks, ysize_blocks);
-      quantized_ac = Image3S(xsize_blocks * kBlockSize, ysize_blocks);
-    }  // else: Decode uses DecCache->quantized_dc/ac.
+// Converts the window "rect" (in blocks) of "ac" to halves in the window
+// "rect_out" of "ac16" (DecCache::compact_ac).
+void StoreCompactAC(const Rect& rect, const Image3F& ac, const Rect& rect_out,
+                    Image3U* PIK_RESTRICT ac16) {
+  PIK_ASSERT(SameSize(rect, rect_out));
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  const size_t num_coeffs = rect.xsize() * kBlockSize;
+  for (int c = 0; c < 3; ++c) {
+    for (size_t by = 0; by < rect.ysize(); ++by) {
+      const float* PIK_RESTRICT row_in =
+          ac.ConstPlaneRow(c, rect.y0() + by) + rect.x0() * kBlockSize;
+      uint16_t* PIK_RESTRICT row_out =
+          ac16->PlaneRow(c, rect_out.y0() + by) + rect_out.x0() * kBlockSize;
+      for (size_t x = 0; x < num_coeffs; x += d.N) {
+        StoreF16(load(d, row_in + x), d, row_out + x);
+      }
+    }
+  }
+}
+
+// Inverse of StoreCompactAC: expands the window "rect" of "ac16" into the
+// window "rect_out" of "ac".
+void LoadCompactAC(const Rect& rect, const Image3U& ac16, const Rect& rect_out,
+                   Image3F* PIK_RESTRICT ac) {
+  PIK_ASSERT(SameSize(rect, rect_out));
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  const size_t num_coeffs = rect.xsize() * kBlockSize;
+  for (int c = 0; c < 3; ++c) {
+    for (size_t by = 0; by < rect.ysize(); ++by) {
+      const uint16_t* PIK_RESTRICT row_in =
+          ac16.ConstPlaneRow(c, rect.y0() + by) + rect.x0() * kBlockSize;
+      float* PIK_RESTRICT row_out =
+          ac->PlaneRow(c, rect_out.y0() + by) + rect_out.x0() * kBlockSize;
+      for (size_t x = 0; x < num_coeffs; x += d.N) {
+        store(LoadF16(d, row_in + x), d, row_out + x);
+      }
+    }
+  }
+}
+
+void DecoderBuffers::InitOnce(const bool eager_dequant,
+                              const size_t group_size_in_blocks) {
+  // Allocate enough for a whole group - partial groups on the right/bottom
+  // border just use a subset. The valid size is passed via Rect.
+  const size_t xsize_blocks = group_size_in_blocks;
+  const size_t ysize_blocks = group_size_in_blocks;
+
+  // This thread (or a previous decode with groups at least as large) already
+  // allocated its buffers.
+  if (num_nzeroes.xsize() < xsize_blocks) {
+    block_ctx = Image3B(xsize_blocks, ysize_blocks);
 
     dc_y = ImageS(xsize_blocks, ysize_blocks);
     dc_xz_residuals = ImageS(xsize_blocks * 2, ysize_blocks);
@@ -1431,139 +3170,312 @@ struct DecoderBuffers {
     num_nzeroes = Image3I(xsize_blocks, ysize_blocks);
   }
 
-  Image3B block_ctx;
-
-  // Decode (only if eager_dequant)
-  Image3S quantized_dc;
-  Image3S quantized_ac;
+  if (eager_dequant && quantized_ac.xsize() < xsize_blocks * kBlockSize) {
+    quantized_ac = Image3S(xsize_blocks * kBlockSize, ysize_blocks);
+  }  // else: Decode uses DecCache->quantized_ac.
+}
 
-  // ExpandDC
-  ImageS dc_y;
-  ImageS dc_xz_residuals;
-  ImageS dc_xz_expanded;
+size_t DecCache::BytesAllocated() const {
+  size_t bytes = quantized_dc.bytes_allocated() +
+                 quantized_ac.bytes_allocated() + dc.bytes_allocated() +
+                 ac.bytes_allocated() + ac16.bytes_allocated() +
+                 (ac_histograms ? ac_histograms->BytesAllocated() : 0);
+  for (const DecoderBuffers& buffers : decoder_buffers) {
+    bytes += buffers.block_ctx.bytes_allocated() +
+             buffers.quantized_ac.bytes_allocated() +
+             buffers.dc_y.bytes_allocated() +
+             buffers.dc_xz_residuals.bytes_allocated() +
+             buffers.dc_xz_expanded.bytes_allocated() +
+             buffers.num_nzeroes.bytes_allocated() +
+             buffers.ac.bytes_allocated();
+  }
+  return bytes;
+}
 
-  // DequantAC
-  Image3I num_nzeroes;
-};
+bool GroupDecoder::ReadDCInfo(const Header& header,
+                              const PaddedBytes& compressed, BitReader* reader,
+                              const size_t xsize_blocks,
+                              const size_t ysize_blocks, ThreadPool* pool,
+                              ColorTransform* ctan, NoiseParams* noise_params,
+                              Quantizer* quantizer, DecCache* cache,
+                              const Rect* region) {
+  if (header.flags & Header::kGradientMap) {
+    GradientMap gradient_map(xsize_blocks, ysize_blocks);
+    size_t byte_pos = reader->Position();
+    gradient_map.Deserialize(compressed, &byte_pos);
+    reader->SkipBits((byte_pos - reader->Position()) * 8);
+    cache->gradient[0] = gradient_map.corners_[0];
+    cache->gradient[1] = gradient_map.corners_[1];
+    cache->gradient[2] = gradient_map.corners_[2];
+  }
 
-bool DecodeCoefficientsAndDequantize(
-    const size_t xsize_blocks, const size_t ysize_blocks,
-    const PaddedBytes& compressed, BitReader* reader, ColorTransform* ctan,
-    ThreadPool* pool, DecCache* cache, Quantizer* quantizer) {
-  PROFILER_FUNC;
+  // Grayscale images have no color correlation maps (X/B are derived from Y).
+  grayscale_ = (header.flags & Header::kGrayscale) != 0;
+  if (!grayscale_) {
+    DecodeColorMap(reader, &ctan->ytob_map, &ctan->ytob_dc);
+    DecodeColorMap(reader, &ctan->ytox_map, &ctan->ytox_dc);
+  }
 
-  const size_t xsize_groups = DivCeil(xsize_blocks, kGroupWidthInBlocks);
-  const size_t ysize_groups = DivCeil(ysize_blocks, kGroupHeightInBlocks);
-  const size_t num_groups = xsize_groups * ysize_groups;
+  const Rect image(0, 0, xsize_blocks, ysize_blocks);
+  if (region == nullptr) region = &image;
+  if (region->xsize() != xsize_blocks || region->ysize() != ysize_blocks) {
+    // Groups are tile-aligned, so the maps can simply be cropped.
+    const Rect tiles(region->x0() / kTileWidthInBlocks,
+                     region->y0() / kTileHeightInBlocks,
+                     DivCeil(region->xsize(), kTileWidthInBlocks),
+                     DivCeil(region->ysize(), kTileHeightInBlocks));
+    ctan->ytox_map = CopyImage(tiles, ctan->ytox_map);
+    ctan->ytob_map = CopyImage(tiles, ctan->ytob_map);
+  }
 
-  const uint8_t* const data_end = compressed.data() + compressed.size();
+  if (!DecodeNoise(reader, noise_params)) return false;
+  if (!quantizer->Decode(reader)) return false;
 
-  const std::vector<uint64_t>& dc_group_offsets =
-      OffsetsFromSizes<DcGroupSizeCoder>(num_groups, reader);
-  const uint8_t* dc_groups_begin = compressed.data() + reader->Position();
+  small_image_ = (header.flags & Header::kSmallImage) != 0;
+  static_histograms_ = (header.flags & Header::kStaticHistograms) != 0;
+  num_ans_states_ = header.num_ans_states;
+  ctan_ = ctan;
+  quantizer_ = quantizer;
+  cache_ = cache;
+
+  group_size_ = GroupSizeInBlocks(header);
+  xsize_groups_ = DivCeil(xsize_blocks, group_size_);
+  num_groups_ = xsize_groups_ * DivCeil(ysize_blocks, group_size_);
+
+  // Only the groups within "region" are decoded; all outputs are relative to
+  // its (group-aligned) origin.
+  PIK_CHECK(region->x0() % group_size_ == 0);
+  PIK_CHECK(region->y0() % group_size_ == 0);
+  PIK_CHECK(region->x0() + region->xsize() <= xsize_blocks);
+  PIK_CHECK(region->y0() + region->ysize() <= ysize_blocks);
+  region_x0_ = region->x0();
+  region_y0_ = region->y0();
+  region_xsize_ = region->xsize();
+  region_ysize_ = region->ysize();
+  region_xsize_groups_ = DivCeil(region_xsize_, group_size_);
+  num_tasks_ = region_xsize_groups_ * DivCeil(region_ysize_, group_size_);
+  cache->x0_blocks = region_x0_;
+  cache->y0_blocks = region_y0_;
+  cache->image_xsize_blocks = xsize_blocks;
+  cache->image_ysize_blocks = ysize_blocks;
+
+  dc_group_offsets_ = OffsetsFromSizes<DcGroupSizeCoder>(num_groups_, reader);
+  dc_groups_begin_ = reader->Position();
+  if (dc_groups_begin_ > compressed.size()) {
+    return PIK_FAILURE("Truncated DC group sizes.");
+  }
   // Skip past what the independent BitReaders will consume.
-  reader->SkipBits(dc_group_offsets[num_groups] * kBitsPerByte);
+  reader->SkipBits(dc_group_offsets_[num_groups_] * kBitsPerByte);
+  ac_groups_begin_ = 0;
 
-  int coeff_order[kOrderContexts * kBlockSize];
-  for (size_t c = 0; c < kOrderContexts; ++c) {
-    DecodeCoeffOrder(&coeff_order[c * kBlockSize], reader);
+  // Will be moved into quantizer.
+  ac_quant_field_ = ImageI(region_xsize_, region_ysize_);
+
+  // Also required by the AC phase (block contexts), hence for the entire
+  // region even if eager_dequant.
+  cache->quantized_dc.Resize(region_xsize_, region_ysize_);
+  if (cache->eager_dequant) {
+    cache->dc.Resize(region_xsize_, region_ysize_);
+    if (cache->dc_only) {
+      // AC is not decoded.
+    } else if (cache->compact_ac) {
+      cache->ac16.Resize(region_xsize_ * kBlockSize, region_ysize_);
+    } else {
+      cache->ac.Resize(region_xsize_ * kBlockSize, region_ysize_);
+    }
+  } else {
+    cache->quantized_ac.Resize(region_xsize_ * kBlockSize, region_ysize_);
   }
-  reader->JumpToByteBoundary();
 
-  ANSCode code;
-  std::vector<uint8_t> context_map;
-  // Histogram data size is small and does not require parallelization.
-  if (!DecodeHistograms(reader, kNumContexts, 256, kSymbolLut,
-                        sizeof(kSymbolLut), &code, &context_map)) {
-    return false;
+  std::vector<DecoderBuffers>& decoder_buf = cache->decoder_buffers;
+  if (decoder_buf.size() < std::max<size_t>(1, pool->NumThreads())) {
+    decoder_buf.resize(std::max<size_t>(1, pool->NumThreads()));
   }
-  reader->JumpToByteBoundary();
+  return true;
+}
 
-  const std::vector<uint64_t>& ac_group_offsets =
-      OffsetsFromSizes<AcGroupSizeCoder>(num_groups, reader);
+Rect GroupDecoder::GroupRect(const size_t task,
+                             size_t* PIK_RESTRICT group) const {
+  // Border groups are clipped by the region just as they would be by the
+  // image.
+  const size_t group_x = region_x0_ / group_size_ + task % region_xsize_groups_;
+  const size_t group_y = region_y0_ / group_size_ + task / region_xsize_groups_;
+  *group = group_y * xsize_groups_ + group_x;
+  return Rect(group_x * group_size_ - region_x0_,
+              group_y * group_size_ - region_y0_, group_size_, group_size_,
+              region_xsize_, region_ysize_);
+}
 
-  const uint8_t* ac_groups_begin = compressed.data() + reader->Position();
-  // Skip past what the independent BitReaders will consume.
-  reader->SkipBits(ac_group_offsets[num_groups] * kBitsPerByte);
+uint64_t GroupDecoder::DCGroupEnd(const size_t task) const {
+  size_t group;
+  (void)GroupRect(task, &group);
+  return dc_groups_begin_ + dc_group_offsets_[group + 1];
+}
 
-  // Will be moved into quantizer.
-  ImageI ac_quant_field(xsize_blocks, ysize_blocks);
+uint64_t GroupDecoder::ACInfoBegin() const {
+  return dc_groups_begin_ + dc_group_offsets_[num_groups_];
+}
 
-  Dequant dequant;
-  if (cache->eager_dequant) {
-    dequant.Init(*ctan, *quantizer);
-    cache->dc = Image3F(xsize_blocks, ysize_blocks);
-    cache->ac = Image3F(xsize_blocks * kBlockSize, ysize_blocks);
-  } else {
-    cache->quantized_dc = Image3S(xsize_blocks, ysize_blocks);
-    cache->quantized_ac = Image3S(xsize_blocks * kBlockSize, ysize_blocks);
+uint64_t GroupDecoder::ACGroupEnd(const size_t task) const {
+  PIK_CHECK(ac_groups_begin_ != 0);
+  size_t group;
+  (void)GroupRect(task, &group);
+  return ac_groups_begin_ + ac_group_offsets_[group + 1];
+}
+
+bool GroupDecoder::DecodeDCGroup(const SegmentedBytes& stream,
+                                 const size_t task, const int thread) {
+  size_t group;
+  const Rect rect = GroupRect(task, &group);
+  DecoderBuffers& tmp = cache_->decoder_buffers[thread];
+  tmp.InitOnce(cache_->eager_dequant, group_size_);
+
+  PaddedBitReader dc_reader(nullptr, 0, 0);
+  if (!GroupReader(stream, dc_groups_begin_, dc_group_offsets_[group],
+                   dc_group_offsets_[group + 1], &tmp.straddling_group,
+                   &dc_reader)) {
+    return false;
   }
 
-  std::vector<DecoderBuffers> decoder_buf(
-      std::max<size_t>(1, pool->NumThreads()));
+  if (!DecodeImage(&dc_reader, rect, &cache_->quantized_dc, grayscale_)) {
+    return false;
+  }
 
-  // For each group: independent/parallel decode
-  std::atomic<int> num_errors{0};
-  pool->Run(0, num_groups, [&](const int task, const int thread) {
-    const size_t group_x = task % xsize_groups;
-    const size_t group_y = task / xsize_groups;
-    const Rect rect(group_x * kGroupWidthInBlocks,
-                    group_y * kGroupHeightInBlocks, kGroupWidthInBlocks,
-                    kGroupHeightInBlocks, xsize_blocks, ysize_blocks);
-    const Rect tmp_rect(0, 0, rect.xsize(), rect.ysize());
-    DecoderBuffers& tmp = decoder_buf[thread];
-    tmp.InitOnce(cache->eager_dequant);
+  ExpandDC(rect, &cache_->quantized_dc, &tmp.dc_y, &tmp.dc_xz_residuals,
+           &tmp.dc_xz_expanded);
 
-    size_t dc_size;
-    if (!IsSizeWithinBounds(dc_groups_begin, data_end, dc_group_offsets[task],
-                            dc_group_offsets[task + 1], &dc_size)) {
-      num_errors.fetch_add(1);
-      return;
-    }
-    BitReader dc_reader(dc_groups_begin + dc_group_offsets[task], dc_size);
+  if (cache_->eager_dequant) {
+    Dequant dequant;
+    dequant.Init(*ctan_, *quantizer_);
+    dequant.DoDC(rect, cache_->quantized_dc, rect, cache_);
+  }
+  return true;
+}
 
-    Image3S* quantized_dc =
-        cache->eager_dequant ? &tmp.quantized_dc : &cache->quantized_dc;
-    const Rect& rect16 = cache->eager_dequant ? tmp_rect : rect;
+void GroupDecoder::FinishDC() {
+  if (cache_->dc_hook != nullptr) {
+    cache_->dc_hook->func(cache_->dc_hook->opaque, *cache_);
+  }
+}
 
-    if (!DecodeImage(&dc_reader, rect16, quantized_dc)) {
-      num_errors.fetch_add(1);
-      return;
+bool GroupDecoder::ReadACInfo(const PaddedBytes& bytes,
+                              const uint64_t bytes_begin,
+                              const uint64_t stream_size, BitReader* reader) {
+  // All AC data follows the DC groups, so previews stop before this.
+  PIK_CHECK(!cache_->dc_only);
+  if (small_image_) {
+    if (num_groups_ != 1) return PIK_FAILURE("Small image has >1 group.");
+    NaturalCoeffOrders(coeff_order_);
+  } else {
+    for (size_t c = 0; c < kOrderContexts; ++c) {
+      DecodeCoeffOrder(&coeff_order_[c * kBlockSize], reader);
     }
+    reader->JumpToByteBoundary();
+  }
 
-    ExpandDC(rect16, quantized_dc, &tmp.dc_y, &tmp.dc_xz_residuals,
-             &tmp.dc_xz_expanded);
+  // Histogram data size is small and does not require parallelization.
+  // Images with the same histograms (even if decoded by other threads)
+  // share the decoded tables, as do all users of a built-in set.
+  if (static_histograms_) {
+    cache_->ac_histograms =
+        DecodeHistogramsStatic(bytes.data(), bytes.size(), reader);
+  } else {
+    cache_->ac_histograms = HistogramCache::Global().Decode(
+        bytes.data(), bytes.size(), kNumContexts, 256, kSymbolLut,
+        sizeof(kSymbolLut), reader);
+  }
+  if (cache_->ac_histograms == nullptr) {
+    return PIK_FAILURE("Invalid AC histograms.");
+  }
 
-    if (cache->eager_dequant) {
-      dequant.DoDC(rect16, *quantized_dc, rect, cache);
-    }
+  if (small_image_) {
+    // The only AC group extends to the end of the stream.
+    const uint64_t pos = bytes_begin + reader->Position();
+    if (pos > stream_size) return PIK_FAILURE("Truncated AC.");
+    ac_group_offsets_ = {0, stream_size - pos};
+  } else {
+    ac_group_offsets_ = OffsetsFromSizes<AcGroupSizeCoder>(num_groups_, reader);
+  }
 
-    ComputeBlockContextFromDC(rect16, *quantized_dc, *quantizer, tmp_rect,
-                              &tmp.block_ctx);
+  if (reader->Position() > bytes.size()) {
+    return PIK_FAILURE("Truncated AC group sizes.");
+  }
+  ac_groups_begin_ = bytes_begin + reader->Position();
+  // Skip past what the independent BitReaders will consume.
+  reader->SkipBits(ac_group_offsets_[num_groups_] * kBitsPerByte);
+  return true;
+}
 
-    size_t ac_size;
-    if (!IsSizeWithinBounds(ac_groups_begin, data_end, ac_group_offsets[task],
-                            ac_group_offsets[task + 1], &ac_size)) {
-      num_errors.fetch_add(1);
-      return;
-    }
-    BitReader ac_reader(ac_groups_begin + ac_group_offsets[task], ac_size);
-    Image3S* quantized_ac =
-        cache->eager_dequant ? &tmp.quantized_ac : &cache->quantized_ac;
-    if (!DecodeAC(tmp.block_ctx, code, context_map, coeff_order, &ac_reader,
-                  rect16, quantized_ac, rect, &ac_quant_field,
-                  &tmp.num_nzeroes)) {
-      num_errors.fetch_add(1);
+bool GroupDecoder::DecodeACGroup(const SegmentedBytes& stream,
+                                 const size_t task, const int thread) {
+  size_t group;
+  const Rect rect = GroupRect(task, &group);
+  const Rect tmp_rect(0, 0, rect.xsize(), rect.ysize());
+  DecoderBuffers& tmp = cache_->decoder_buffers[thread];
+  tmp.InitOnce(cache_->eager_dequant, group_size_);
+
+  ComputeBlockContextFromDC(rect, cache_->quantized_dc, *quantizer_, tmp_rect,
+                            &tmp.block_ctx);
+
+  PaddedBitReader ac_reader(nullptr, 0, 0);
+  if (!GroupReader(stream, ac_groups_begin_, ac_group_offsets_[group],
+                   ac_group_offsets_[group + 1], &tmp.straddling_group,
+                   &ac_reader)) {
+    return false;
+  }
+  Image3S* quantized_ac =
+      cache_->eager_dequant ? &tmp.quantized_ac : &cache_->quantized_ac;
+  const Rect& rect16 = cache_->eager_dequant ? tmp_rect : rect;
+  const DecodedHistograms& histograms = *cache_->ac_histograms;
+  const bool ok = DecodeAC(tmp.block_ctx, histograms.code,
+                           histograms.context_map, coeff_order_, &ac_reader,
+                           rect16, quantized_ac, rect, &ac_quant_field_,
+                           &tmp.num_nzeroes, num_ans_states_, grayscale_);
+
+  if (cache_->eager_dequant) {
+    Dequant dequant;
+    dequant.Init(*ctan_, *quantizer_);
+    if (cache_->compact_ac) {
+      tmp.ac.Resize(rect.xsize() * kBlockSize, rect.ysize());
+      dequant.DoAC(rect16, *quantized_ac, rect, ac_quant_field_,
+                   ctan_->ytox_map, ctan_->ytob_map, tmp_rect, &tmp.ac,
+                   &tmp.num_nzeroes);
+      StoreCompactAC(tmp_rect, tmp.ac, rect, &cache_->ac16);
+    } else {
+      dequant.DoAC(rect16, *quantized_ac, rect, ac_quant_field_,
+                   ctan_->ytox_map, ctan_->ytob_map, rect, &cache_->ac,
+                   &tmp.num_nzeroes);
     }
+  }
+  return ok;
+}
 
-    if (cache->eager_dequant) {
-      dequant.DoAC(rect16, *quantized_ac, rect, ac_quant_field, ctan->ytox_map,
-                   ctan->ytob_map, cache);
-    }
-  });
+void GroupDecoder::FinishAC() {
+  quantizer_->SetRawQuantField(std::move(ac_quant_field_));
+}
 
-  quantizer->SetRawQuantField(std::move(ac_quant_field));
-  return num_errors.load(std::memory_order_relaxed) == 0;
+Rect RegionForRect(const Header& header, const Rect& rect,
+                   const size_t xsize_blocks, const size_t ysize_blocks) {
+  // Covers the support of all reconstruction filters downstream of the
+  // coefficients: 6x6 DC upsampling kernel (3 blocks) or 2x2 prediction plus
+  // 4x4 blur, then Gaborish (1 pixel) and the edge-preserving filter (6).
+  constexpr size_t kBorderBlocks = 5;
+  size_t bx0 = rect.x0() / kBlockWidth;
+  size_t by0 = rect.y0() / kBlockHeight;
+  size_t bx1 = DivCeil(rect.x0() + rect.xsize(), kBlockWidth);
+  size_t by1 = DivCeil(rect.y0() + rect.ysize(), kBlockHeight);
+  bx0 = bx0 > kBorderBlocks ? bx0 - kBorderBlocks : 0;
+  by0 = by0 > kBorderBlocks ? by0 - kBorderBlocks : 0;
+  bx1 = std::min(bx1 + kBorderBlocks, xsize_blocks);
+  by1 = std::min(by1 + kBorderBlocks, ysize_blocks);
+
+  // Expand to whole groups.
+  const size_t group_size = GroupSizeInBlocks(header);
+  bx0 = bx0 / group_size * group_size;
+  by0 = by0 / group_size * group_size;
+  bx1 = std::min(DivCeil(bx1, group_size) * group_size, xsize_blocks);
+  by1 = std::min(DivCeil(by1, group_size) * group_size, ysize_blocks);
+  return Rect(bx0, by0, bx1 - bx0, by1 - by0);
 }
 
 bool DecodeFromBitstream(const Header& header, const PaddedBytes& compressed,
@@ -1571,113 +3483,796 @@ bool DecodeFromBitstream(const Header& header, const PaddedBytes& compressed,
                          const size_t xsize_blocks, const size_t ysize_blocks,
                          ThreadPool* pool, ColorTransform* ctan,
                          NoiseParams* noise_params, Quantizer* quantizer,
-                         DecCache* cache) {
+                         DecCache* cache, const Rect* region) {
+  PROFILER_FUNC;
+  const SegmentedBytes stream(compressed);
+  GroupDecoder groups;
+  if (!groups.ReadDCInfo(header, compressed, reader, xsize_blocks,
+                         ysize_blocks, pool, ctan, noise_params, quantizer,
+                         cache, region)) {
+    return false;
+  }
+
+  // Two independent/parallel phases: all DC groups, then all AC groups. This
+  // makes the DC available early (dc_hook) and balances the load better than
+  // one task per DC+AC group pair when the AC group sizes vary.
+  std::atomic<int> num_errors{0};
+  // Once a group failed (e.g. truncated or corrupt input) or the decode was
+  // cancelled, the remaining groups are skipped.
+  const auto failed = [&num_errors, cache]() {
+    return num_errors.load(std::memory_order_relaxed) != 0 ||
+           IsCancelled(cache->cancel);
+  };
+  pool->Run(0, groups.NumTasks(), [&](const int task, const int thread) {
+    if (failed()) return;
+    if (!groups.DecodeDCGroup(stream, task, thread)) num_errors.fetch_add(1);
+  });
+  if (failed()) return false;
+  groups.FinishDC();
+  if (cache->dc_only) return true;
+
+  if (!groups.ReadACInfo(compressed, 0, compressed.size(), reader)) {
+    return false;
+  }
+  pool->Run(0, groups.NumTasks(), [&](const int task, const int thread) {
+    if (failed()) return;
+    if (!groups.DecodeACGroup(stream, task, thread)) num_errors.fetch_add(1);
+  });
+  groups.FinishAC();
+  return !failed();
+}
+
+bool CropBitstream(const Header& header, const PaddedBytes& compressed,
+                   BitReader* reader, const size_t xsize_blocks,
+                   const size_t ysize_blocks, const Rect& region,
+                   ThreadPool* pool, PaddedBytes* cropped) {
+  PROFILER_FUNC;
+  if (header.flags & Header::kSmallImage) {
+    return PIK_FAILURE("Small images have only one group.");
+  }
+  const size_t group_size = GroupSizeInBlocks(header);
+  PIK_CHECK(region.x0() % group_size == 0);
+  PIK_CHECK(region.y0() % group_size == 0);
+  PIK_CHECK(region.x0() + region.xsize() <= xsize_blocks);
+  PIK_CHECK(region.y0() + region.ysize() <= ysize_blocks);
+
   if (header.flags & Header::kGradientMap) {
-    GradientMap gradient_map(xsize_blocks, ysize_blocks);
+    const GradientMap gradient_map(xsize_blocks, ysize_blocks);
     size_t byte_pos = reader->Position();
-    gradient_map.Deserialize(compressed, &byte_pos);
+    if (!gradient_map.CropSerialized(compressed, &byte_pos, region, cropped)) {
+      return false;
+    }
     reader->SkipBits((byte_pos - reader->Position()) * 8);
-    cache->gradient[0] = gradient_map.corners_[0];
-    cache->gradient[1] = gradient_map.corners_[1];
-    cache->gradient[2] = gradient_map.corners_[2];
   }
 
-  DecodeColorMap(reader, &ctan->ytob_map, &ctan->ytob_dc);
-  DecodeColorMap(reader, &ctan->ytox_map, &ctan->ytox_dc);
+  // Groups are tile-aligned, so the color correlation maps are simply cropped
+  // and re-encoded; noise and quantizer fields are copied.
+  std::string global_code;
+  if ((header.flags & Header::kGrayscale) == 0) {
+    ColorTransform ctan(header.xsize, header.ysize);
+    if (!DecodeColorMap(reader, &ctan.ytob_map, &ctan.ytob_dc) ||
+        !DecodeColorMap(reader, &ctan.ytox_map, &ctan.ytox_dc)) {
+      return false;
+    }
+    const Rect tiles(region.x0() / kTileWidthInBlocks,
+                     region.y0() / kTileHeightInBlocks,
+                     DivCeil(region.xsize(), kTileWidthInBlocks),
+                     DivCeil(region.ysize(), kTileHeightInBlocks));
+    global_code = EncodeColorMap(CopyImage(tiles, ctan.ytob_map),
+                                 ctan.ytob_dc, nullptr) +
+                  EncodeColorMap(CopyImage(tiles, ctan.ytox_map),
+                                 ctan.ytox_dc, nullptr);
+  }
+  const size_t fields_begin = reader->Position();
+  NoiseParams noise_params;
+  if (!DecodeNoise(reader, &noise_params)) return false;
+  Quantizer quantizer(header.quant_template, 0, 0);
+  if (!quantizer.Decode(reader)) return false;
+  const size_t fields_end = reader->Position();
+  if (fields_end > compressed.size()) {
+    return PIK_FAILURE("Truncated quantizer.");
+  }
+  global_code.append(
+      reinterpret_cast<const char*>(compressed.data()) + fields_begin,
+      fields_end - fields_begin);
 
-  if (!DecodeNoise(reader, noise_params)) return false;
-  if (!quantizer->Decode(reader)) return false;
+  const size_t xsize_groups = DivCeil(xsize_blocks, group_size);
+  const size_t num_groups = xsize_groups * DivCeil(ysize_blocks, group_size);
+  const std::vector<uint64_t> dc_group_offsets =
+      OffsetsFromSizes<DcGroupSizeCoder>(num_groups, reader);
+  const uint64_t dc_groups_begin = reader->Position();
+  if (dc_groups_begin + dc_group_offsets[num_groups] > compressed.size()) {
+    return PIK_FAILURE("Truncated DC groups.");
+  }
+  reader->SkipBits(dc_group_offsets[num_groups] * kBitsPerByte);
 
-  return DecodeCoefficientsAndDequantize(xsize_blocks, ysize_blocks, compressed,
-                                         reader, ctan, pool, cache, quantizer);
+  // Coefficient orders and histograms are shared by all groups, hence copied
+  // verbatim. Crops of the same image find them in the HistogramCache.
+  const size_t ac_fields_begin = reader->Position();
+  int32_t order[kOrderContexts * kBlockSize];
+  for (size_t c = 0; c < kOrderContexts; ++c) {
+    DecodeCoeffOrder(&order[c * kBlockSize], reader);
+  }
+  reader->JumpToByteBoundary();
+  const std::shared_ptr<const DecodedHistograms> histograms =
+      (header.flags & Header::kStaticHistograms)
+          ? DecodeHistogramsStatic(compressed.data(), compressed.size(),
+                                   reader)
+          : HistogramCache::Global().Decode(
+                compressed.data(), compressed.size(), kNumContexts, 256,
+                kSymbolLut, sizeof(kSymbolLut), reader);
+  if (histograms == nullptr) return PIK_FAILURE("Invalid AC histograms.");
+  const size_t ac_fields_end = reader->Position();
+  const std::vector<uint64_t> ac_group_offsets =
+      OffsetsFromSizes<AcGroupSizeCoder>(num_groups, reader);
+  const uint64_t ac_groups_begin = reader->Position();
+  if (ac_groups_begin + ac_group_offsets[num_groups] > compressed.size()) {
+    return PIK_FAILURE("Truncated AC groups.");
+  }
+  const std::string ac_fields(
+      reinterpret_cast<const char*>(compressed.data()) + ac_fields_begin,
+      ac_fields_end - ac_fields_begin);
+
+  // The group codes are views into "compressed"; they are only copied once,
+  // to their final position in "cropped".
+  const size_t region_xsize_groups = DivCeil(region.xsize(), group_size);
+  const size_t num_tasks =
+      region_xsize_groups * DivCeil(region.ysize(), group_size);
+  std::vector<PaddedBytes> dc_group_codes;
+  std::vector<PaddedBytes> ac_group_codes;
+  dc_group_codes.reserve(num_tasks);
+  ac_group_codes.reserve(num_tasks);
+  for (size_t task = 0; task < num_tasks; ++task) {
+    const size_t gx = region.x0() / group_size + task % region_xsize_groups;
+    const size_t gy = region.y0() / group_size + task / region_xsize_groups;
+    const size_t group = gy * xsize_groups + gx;
+    dc_group_codes.push_back(PaddedBytes::View(
+        compressed.data() + dc_groups_begin + dc_group_offsets[group],
+        dc_group_offsets[group + 1] - dc_group_offsets[group]));
+    ac_group_codes.push_back(PaddedBytes::View(
+        compressed.data() + ac_groups_begin + ac_group_offsets[group],
+        ac_group_offsets[group + 1] - ac_group_offsets[group]));
+  }
+  size_t code_size;
+  const std::string dc_toc =
+      EncodeGroupSizes<DcGroupSizeCoder>(dc_group_codes, &code_size);
+  const std::string ac_toc =
+      EncodeGroupSizes<AcGroupSizeCoder>(ac_group_codes, &code_size);
+
+  const size_t begin = cropped->size();
+  const uint64_t size =
+      BitstreamSize(global_code, dc_toc, dc_group_codes, ac_fields,
+                    std::string(), ac_toc, ac_group_codes);
+  cropped->resize(begin + size);
+  PaddedBytesSink sink(cropped);
+  uint64_t written;
+  if (!WriteBitstream(global_code, dc_toc, dc_group_codes, ac_fields,
+                      std::string(), ac_toc, ac_group_codes, begin, pool,
+                      &sink, &written)) {
+    return false;
+  }
+  PIK_CHECK(written == size);
+  return true;
 }
 
-void AddPredictions_Smooth(const Image3F& dc, ThreadPool* pool,
-                           const Image3F* PIK_RESTRICT dcoeffs,
-                           Image3F* PIK_RESTRICT idct) {
+void OrientCoefficients(const Orientation orientation, const bool grayscale,
+                        ThreadPool* pool, QuantizedCoeffs* qcoeffs,
+                        Quantizer* quantizer, ColorTransform* ctan) {
   PROFILER_FUNC;
+  const OrientationSteps steps(orientation);
+  const size_t xsize_blocks = steps.transpose ? qcoeffs->dc.ysize()
+                                              : qcoeffs->dc.xsize();
+  const size_t ysize_blocks = steps.transpose ? qcoeffs->dc.xsize()
+                                              : qcoeffs->dc.ysize();
+
+  // Coefficient k of a block holds horizontal frequency k / 8 and vertical
+  // frequency k % 8. Mirroring negates the odd frequencies along that axis.
+  static_assert(kBlockWidth == 8 && kBlockHeight == 8, "Update index math");
+  int source_k[kBlockSize];
+  bool negate[kBlockSize];
+  for (size_t k = 0; k < kBlockSize; ++k) {
+    const size_t fx = k / 8;
+    const size_t fy = k % 8;
+    source_k[k] = steps.transpose ? fy * 8 + fx : k;
+    negate[k] = ((steps.flip_x && (fx & 1)) != (steps.flip_y && (fy & 1)));
+  }
+
+  // Each tile adopts the correlation factors of the source tile of its first
+  // block; they only differ if the image size is not a multiple of the tile.
+  ColorTransform oriented_ctan(xsize_blocks * kBlockWidth,
+                               ysize_blocks * kBlockHeight);
+  oriented_ctan.ytox_dc = ctan->ytox_dc;
+  oriented_ctan.ytob_dc = ctan->ytob_dc;
+  if (!grayscale) {
+    for (size_t ty = 0; ty < oriented_ctan.ytox_map.ysize(); ++ty) {
+      for (size_t tx = 0; tx < oriented_ctan.ytox_map.xsize(); ++tx) {
+        size_t bx, by;
+        steps.Source(tx * kTileWidthInBlocks, ty * kTileHeightInBlocks,
+                     xsize_blocks, ysize_blocks, &bx, &by);
+        const size_t source_tx = bx / kTileWidthInBlocks;
+        const size_t source_ty = by / kTileHeightInBlocks;
+        oriented_ctan.ytox_map.Row(ty)[tx] =
+            ctan->ytox_map.ConstRow(source_ty)[source_tx];
+        oriented_ctan.ytob_map.Row(ty)[tx] =
+            ctan->ytob_map.ConstRow(source_ty)[source_tx];
+      }
+    }
+  }
 
-  const Image3F upsampled_dc = BlurUpsampleDC(dc, pool);
+  // Same as the dequantization in the decoder, but without the common
+  // inv_quant_ac factor, which is unchanged because the quant field is only
+  // rearranged. Requantizes coefficients whose weight changes (transposing
+  // an asymmetric matrix) or whose correlation factor changes; everything
+  // else is copied (with sign change) and therefore lossless.
+  const float kYToBScale = 1.0f / 128.0f;
+  const float kYToXScale = 1.0f / 256.0f;
+  const float* PIK_RESTRICT dequant = quantizer->DequantMatrix();
+  const float* PIK_RESTRICT dequant_y = dequant + kBlockSize;
+  const auto round_to_int16 = [](const float val) {
+    const float clamped = std::min(std::max(val, -32768.0f), 32767.0f);
+    return static_cast<int16_t>(std::round(clamped));
+  };
+
+  Image3S ac(xsize_blocks * kBlockSize, ysize_blocks);
+  pool->Run(0, ysize_blocks, [&](const int task, const int thread) {
+    const size_t by = task;
+    const size_t ty = by / kTileHeightInBlocks;
+    for (size_t bx = 0; bx < xsize_blocks; ++bx) {
+      size_t source_bx, source_by;
+      steps.Source(bx, by, xsize_blocks, ysize_blocks, &source_bx,
+                   &source_by);
+      const size_t tx = bx / kTileWidthInBlocks;
+      const size_t source_tx = source_bx / kTileWidthInBlocks;
+      const size_t source_ty = source_by / kTileHeightInBlocks;
+      const size_t xoff = bx * kBlockSize;
+      const size_t source_xoff = source_bx * kBlockSize;
+
+      const int16_t* PIK_RESTRICT in_y =
+          qcoeffs->ac.ConstPlaneRow(1, source_by) + source_xoff;
+      int16_t* PIK_RESTRICT out_y = ac.PlaneRow(1, by) + xoff;
+      for (size_t k = 0; k < kBlockSize; ++k) {
+        const int sk = source_k[k];
+        const int16_t q = negate[k] ? -in_y[sk] : in_y[sk];
+        out_y[k] = (dequant_y[k] == dequant_y[sk])
+                       ? q
+                       : round_to_int16(q * dequant_y[sk] / dequant_y[k]);
+      }
+
+      for (int c = 0; c < 3; c += 2) {  // === for c in {0, 2}
+        const float* PIK_RESTRICT dequant_c = dequant + c * kBlockSize;
+        float mul_old = 0.0f;
+        float mul_new = 0.0f;
+        if (!grayscale && c == 0) {
+          mul_old = kYToXScale *
+                    (ctan->ytox_map.ConstRow(source_ty)[source_tx] - 128);
+          mul_new = kYToXScale * (oriented_ctan.ytox_map.Row(ty)[tx] - 128);
+        } else if (!grayscale) {
+          mul_old = kYToBScale * ctan->ytob_map.ConstRow(source_ty)[source_tx];
+          mul_new = kYToBScale * oriented_ctan.ytob_map.Row(ty)[tx];
+        }
+        const int16_t* PIK_RESTRICT in =
+            qcoeffs->ac.ConstPlaneRow(c, source_by) + source_xoff;
+        int16_t* PIK_RESTRICT out = ac.PlaneRow(c, by) + xoff;
+        for (size_t k = 0; k < kBlockSize; ++k) {
+          const int sk = source_k[k];
+          const int16_t q = negate[k] ? -in[sk] : in[sk];
+          if (dequant_c[k] == dequant_c[sk] && mul_old == mul_new &&
+              (mul_old == 0.0f || dequant_y[k] == dequant_y[sk])) {
+            out[k] = q;
+            continue;
+          }
+          // Undo the prediction from Y, then predict from the new Y.
+          const float sign = negate[k] ? -1.0f : 1.0f;
+          const float full =
+              q * dequant_c[sk] + mul_old * sign * in_y[sk] * dequant_y[sk];
+          const float residual = full - mul_new * out_y[k] * dequant_y[k];
+          out[k] = round_to_int16(residual / dequant_c[k]);
+        }
+      }
+    }
+  });
+
+  qcoeffs->dc = OrientedImage(orientation, qcoeffs->dc);
+  qcoeffs->ac = std::move(ac);
+  qcoeffs->num_nzeros = Image3I();
+  quantizer->SetRawQuantField(
+      OrientedImage(orientation, quantizer->RawQuantField()));
+  *ctan = std::move(oriented_ctan);
+}
+
+namespace {
+
+// Sets the DC coefficient of each block in "coeffs" (64 per block, as in
+// DecCache::ac) to the corresponding pixel of "dc".
+void SetDCFromImage(const Image3F& dc, ThreadPool* pool,
+                    Image3F* PIK_RESTRICT coeffs) {
+  // A few ticks per strided store: too cheap to wake all threads for.
+  const uint64_t cost_per_row = 3 * 4 * dc.xsize();
+  pool->Run(0, dc.ysize(), [&](const int task, const int thread) {
+    const size_t by = task;
+    for (int c = 0; c < 3; ++c) {
+      const float* PIK_RESTRICT row_dc = dc.ConstPlaneRow(c, by);
+      float* PIK_RESTRICT row_coeffs = coeffs->PlaneRow(c, by);
+      for (size_t bx = 0; bx < dc.xsize(); ++bx) {
+        row_coeffs[bx * kBlockSize] = row_dc[bx];
+      }
+    }
+  }, cost_per_row);
+}
 
-  // Treats dcoeffs.DC as 0, then adds upsampled_dc after IDCT.
-  *idct = TransposedScaledIDCTAndAdd<DC_Zero>(*dcoeffs, upsampled_dc, pool);
+// Sets the DC coefficient of each block in "coeffs" to "value".
+void FillDC(const float value, ThreadPool* pool, Image3F* PIK_RESTRICT coeffs) {
+  const uint64_t cost_per_row = 3 * 4 * (coeffs->xsize() / kBlockSize);
+  pool->Run(0, coeffs->ysize(), [&](const int task, const int thread) {
+    const size_t by = task;
+    for (int c = 0; c < 3; ++c) {
+      float* PIK_RESTRICT row_coeffs = coeffs->PlaneRow(c, by);
+      for (size_t x = 0; x < coeffs->xsize(); x += kBlockSize) {
+        row_coeffs[x] = value;
+      }
+    }
+  }, cost_per_row);
 }
 
+}  // namespace
+
+// Applies the (non-smooth) DC predictions to dcoeffs in-place; the IDCT
+// happens afterwards in ReconTiles.
 void AddPredictions(const Image3F& dc, ThreadPool* pool,
-                    Image3F* PIK_RESTRICT dcoeffs, Image3F* PIK_RESTRICT idct) {
+                    Image3F* PIK_RESTRICT dcoeffs) {
   PROFILER_FUNC;
 
   // Sets dcoeffs.0 from DC and updates 189.
   const Image3F pred2x2 = PredictSpatial2x2_AC64(dc, dcoeffs);
   // Updates dcoeffs _except_ 0189.
   UpSample4x4BlurDCT(pred2x2, 1.5f, 0.0f, pool, dcoeffs);
+}
+
+// Support [blocks] of the DC/AC prediction: BlurUpsampleDC's 6x6 kernel
+// reaches 3 blocks; the 3x3 DC convolution of PredictACFromDC and the 3-tap
+// blur of the 2x2 prediction in UpSample4x4BlurDCT reach 1 block each.
+constexpr size_t kPredictionBorderBlocks = 3;
+
+// Dequantizes (or expands DecCache::ac16), predicts and inverse-transforms
+// one group at a time, so that float AC coefficients only exist in per-thread
+// buffers instead of a full-size cache->ac. Requires the final (i.e. after
+// GradientMap::Unapply) cache->dc and either cache->quantized_ac or (if
+// eager_dequant) cache->ac16. Returns the IDCT output (before Gaborish).
+Image3F ReconGroupPixels(const Header& header, const Quantizer& quantizer,
+                         const ColorTransform& ctan, const Dequant& dequant,
+                         ThreadPool* pool, DecCache* cache) {
+  PROFILER_FUNC;
+  const size_t xsize_blocks = cache->dc.xsize();
+  const size_t ysize_blocks = cache->dc.ysize();
+  const size_t group_size = GroupSizeInBlocks(header);
+  const size_t xsize_groups = DivCeil(xsize_blocks, group_size);
+  const size_t ysize_groups = DivCeil(ysize_blocks, group_size);
+  const bool smooth = (header.flags & Header::kSmoothDCPred) != 0;
+  const bool compact = cache->eager_dequant && cache->compact_ac;
+  // Like flat_dc, compact_ac requires eager_dequant.
+  const bool flat = smooth && compact && cache->flat_dc;
+  constexpr size_t kBorder = kPredictionBorderBlocks;
+
+  Image3F pixels(xsize_blocks * kBlockWidth, ysize_blocks * kBlockHeight);
+  std::vector<DecoderBuffers>& decoder_buf = cache->decoder_buffers;
+  pool->Run(0, xsize_groups * ysize_groups, [&](const int task,
+                                                const int thread) {
+    const size_t group_x = task % xsize_groups;
+    const size_t group_y = task / xsize_groups;
+    const Rect rect(group_x * group_size, group_y * group_size, group_size,
+                    group_size, xsize_blocks, ysize_blocks);
+    // Predictions are computed for "rect" plus a border, clamped to the image
+    // so that the mirroring at its edges matches a whole-image prediction.
+    // The border starts at a tile boundary as required by Dequant::DoAC.
+    const size_t x0 = (rect.x0() - std::min(rect.x0(), kBorder)) /
+                      kTileWidthInBlocks * kTileWidthInBlocks;
+    const size_t y0 = (rect.y0() - std::min(rect.y0(), kBorder)) /
+                      kTileHeightInBlocks * kTileHeightInBlocks;
+    const Rect crop(
+        x0, y0,
+        std::min(rect.x0() + rect.xsize() + kBorder, xsize_blocks) - x0,
+        std::min(rect.y0() + rect.ysize() + kBorder, ysize_blocks) - y0);
+    // Position of rect within crop.
+    const size_t bx0 = rect.x0() - crop.x0();
+    const size_t by0 = rect.y0() - crop.y0();
+
+    // The smooth prediction only depends on DC, so only the AC of rect is
+    // needed (and compact AC is inverse-transformed directly); otherwise, that
+    // of the border blocks is also predicted from.
+    const Rect& ac_rect = smooth ? rect : crop;
+    const Rect ac_rect_out(0, 0, ac_rect.xsize(), ac_rect.ysize());
+    Image3F& ac = decoder_buf[thread].ac;
+    if (!compact) {
+      ac.Resize(ac_rect.xsize() * kBlockSize, ac_rect.ysize());
+      dequant.DoAC(ac_rect, cache->quantized_ac, ac_rect,
+                   quantizer.RawQuantField(), ctan.ytox_map, ctan.ytob_map,
+                   ac_rect_out, &ac);
+    } else if (!smooth) {
+      ac.Resize(ac_rect.xsize() * kBlockSize, ac_rect.ysize());
+      LoadCompactAC(ac_rect, cache->ac16, ac_rect_out, &ac);
+    }
+
+    // Already inside a pool task.
+    ThreadPool serial(0);
+    const Image3F dc = CopyImage(crop, cache->dc);
+    Image3F upsampled_dc;
+    Image3F block_averages;
+    if (flat) {
+      block_averages = BlockAveragesOfUpsampledDC(dc, &serial);
+    } else if (smooth) {
+      upsampled_dc = BlurUpsampleDC(dc, &serial);
+    } else {
+      AddPredictions(dc, &serial, &ac);
+    }
+    const size_t ac_x0 = smooth ? 0 : bx0;
+    const size_t ac_y0 = smooth ? 0 : by0;
 
-  *idct = TransposedScaledIDCT(*dcoeffs, pool);
+    using namespace SIMD_NAMESPACE;
+    const Full<float> d;
+    for (int c = 0; c < 3; ++c) {
+      const size_t stride = pixels.PlaneRow(c, 1) - pixels.PlaneRow(c, 0);
+      for (size_t by = 0; by < rect.ysize(); ++by) {
+        const float* PIK_RESTRICT row_ac =
+            (compact && smooth)
+                ? nullptr
+                : ac.ConstPlaneRow(c, ac_y0 + by) + ac_x0 * kBlockSize;
+        const uint16_t* PIK_RESTRICT row_ac16 =
+            (compact && smooth) ? cache->ac16.ConstPlaneRow(c, rect.y0() + by) +
+                                      rect.x0() * kBlockSize
+                                : nullptr;
+        float* PIK_RESTRICT row_out =
+            pixels.PlaneRow(c, (rect.y0() + by) * kBlockHeight) +
+            rect.x0() * kBlockWidth;
+        for (size_t bx = 0; bx < rect.xsize(); ++bx) {
+          float* PIK_RESTRICT block_out = row_out + bx * kBlockWidth;
+          if (!smooth) {
+            ComputeTransposedScaledBlockIDCTFloat(
+                FromBlock(row_ac + bx * kBlockSize), ToLines(block_out, stride),
+                DC_Unchanged());
+            continue;
+          }
+          // Treats DC as 0, then adds upsampled_dc (see ReconTiles) or the
+          // block average.
+          if (row_ac16 != nullptr) {
+            ComputeTransposedScaledBlockIDCTFloat(
+                FromBlockF16(row_ac16 + bx * kBlockSize),
+                ToLines(block_out, stride), DC_Zero());
+          } else {
+            ComputeTransposedScaledBlockIDCTFloat(
+                FromBlock(row_ac + bx * kBlockSize), ToLines(block_out, stride),
+                DC_Zero());
+          }
+          if (flat) {
+            const auto average = set1(
+                d, block_averages.ConstPlaneRow(c, by0 + by)[bx0 + bx]);
+            for (size_t iy = 0; iy < kBlockHeight; ++iy) {
+              float* PIK_RESTRICT pos_out = block_out + iy * stride;
+              for (size_t ix = 0; ix < kBlockWidth; ix += d.N) {
+                store(load(d, pos_out + ix) + average, d, pos_out + ix);
+              }
+            }
+            continue;
+          }
+          for (size_t iy = 0; iy < kBlockHeight; ++iy) {
+            const float* PIK_RESTRICT row_add =
+                upsampled_dc.ConstPlaneRow(c, (by0 + by) * kBlockHeight + iy) +
+                (bx0 + bx) * kBlockWidth;
+            float* PIK_RESTRICT pos_out = block_out + iy * stride;
+            for (size_t ix = 0; ix < kBlockWidth; ix += d.N) {
+              store(load(d, pos_out + ix) + load(d, row_add + ix), d,
+                    pos_out + ix);
+            }
+          }
+        }
+      }
+    }
+  });
+  return pixels;
 }
 
-Image3F ReconOpsinImage(const Header& header, const Quantizer& quantizer,
-                        const ColorTransform& ctan, ThreadPool* pool,
-                        DecCache* cache, PikInfo* pik_info) {
-  PROFILER_ZONE("recon");
+template <typename T>
+void ReconT(const Header& header, const Quantizer& quantizer,
+            const ColorTransform& ctan, const bool to_srgb, const bool dither,
+            const SampleEncoding encoding, const ColorPrimaries primaries,
+            ThreadPool* pool, DecCache* cache, Image3<T>* out,
+            const ImageRowsSink<T>* sink = nullptr,
+            const AlphaComposite* composite = nullptr) {
   const size_t xsize_blocks = quantizer.RawQuantField().xsize();
   const size_t ysize_blocks = quantizer.RawQuantField().ysize();
-  const size_t xsize_groups = DivCeil(xsize_blocks, kGroupWidthInBlocks);
-  const size_t ysize_groups = DivCeil(ysize_blocks, kGroupHeightInBlocks);
+  const size_t group_size = GroupSizeInBlocks(header);
+  const size_t xsize_groups = DivCeil(xsize_blocks, group_size);
+  const size_t ysize_groups = DivCeil(ysize_blocks, group_size);
 
-  // If not already done (when called after DecodeFromBitstream)
+  // If not already done (when called after DecodeFromBitstream), the AC is
+  // dequantized per group in ReconGroupPixels.
+  Dequant dequant;
   if (!cache->eager_dequant) {
     // Caller must have allocated/filled quantized_dc/ac.
     PIK_CHECK(SameSize(cache->quantized_dc, quantizer.RawQuantField()));
 
-    Dequant dequant;
     dequant.Init(ctan, quantizer);
-    cache->dc = Image3F(xsize_blocks, ysize_blocks);
-    cache->ac = Image3F(xsize_blocks * kBlockSize, ysize_blocks);
+    cache->dc.Resize(xsize_blocks, ysize_blocks);
 
-    std::vector<DecoderBuffers> decoder_buf(
-        std::max<size_t>(1, pool->NumThreads()));
+    std::vector<DecoderBuffers>& decoder_buf = cache->decoder_buffers;
+    if (decoder_buf.size() < std::max<size_t>(1, pool->NumThreads())) {
+      decoder_buf.resize(std::max<size_t>(1, pool->NumThreads()));
+    }
 
     const size_t num_groups = xsize_groups * ysize_groups;
     pool->Run(0, num_groups, [&](const int task, const int thread) {
-      DecoderBuffers& tmp = decoder_buf[thread];
-      tmp.InitOnce(cache->eager_dequant);
-
       const size_t group_x = task % xsize_groups;
       const size_t group_y = task / xsize_groups;
-      const Rect rect(group_x * kGroupWidthInBlocks,
-                      group_y * kGroupHeightInBlocks, kGroupWidthInBlocks,
-                      kGroupHeightInBlocks, xsize_blocks, ysize_blocks);
-
+      const Rect rect(group_x * group_size, group_y * group_size, group_size,
+                      group_size, xsize_blocks, ysize_blocks);
       dequant.DoDC(rect, cache->quantized_dc, rect, cache);
-      dequant.DoAC(rect, cache->quantized_ac, rect, quantizer.RawQuantField(),
-                   ctan.ytox_map, ctan.ytob_map, cache);
     });
   }
 
   if (header.flags & Header::kGradientMap) {
-    GradientMap map(xsize_blocks, ysize_blocks);
+    // The map is defined over the entire image, even if dc only covers a
+    // region of it (see DecodeFromBitstream).
+    const bool decoded = cache->image_xsize_blocks != 0;
+    GradientMap map(decoded ? cache->image_xsize_blocks : xsize_blocks,
+                    decoded ? cache->image_ysize_blocks : ysize_blocks);
     map.corners_[0] = cache->gradient[0];
     map.corners_[1] = cache->gradient[1];
     map.corners_[2] = cache->gradient[2];
-    map.ComputeGradientImage();
-    map.Unapply(&cache->dc);
+    map.Unapply(Rect(cache->x0_blocks, cache->y0_blocks, xsize_blocks,
+                     ysize_blocks),
+                pool, &cache->dc);
   }
 
-  Image3F idct(xsize_blocks * kBlockWidth, ysize_blocks * kBlockHeight);
+  if (!cache->eager_dequant || cache->compact_ac) {
+    const Image3F pixels =
+        ReconGroupPixels(header, quantizer, ctan, dequant, pool, cache);
+    ReconTiles(header, pixels, nullptr, to_srgb, dither, encoding, primaries,
+               pool, &cache->graphs, out, sink, /*idct_done=*/true, composite);
+    return;
+  }
 
   // AddPredictions* do not use the (invalid) DC component of cache->ac.
-  // Does IDCT already internally to save work.
-  if (header.flags & Header::kSmoothDCPred) {
-    AddPredictions_Smooth(cache->dc, pool, &cache->ac, &idct);
+  if ((header.flags & Header::kSmoothDCPred) && cache->flat_dc) {
+    SetDCFromImage(BlockAveragesOfUpsampledDC(cache->dc, pool), pool,
+                   &cache->ac);
+    ReconTiles(header, cache->ac, nullptr, to_srgb, dither, encoding,
+               primaries, pool, &cache->graphs, out, sink,
+               /*idct_done=*/false, composite);
+  } else if (header.flags & Header::kSmoothDCPred) {
+    const Image3F upsampled_dc = BlurUpsampleDC(cache->dc, pool);
+    // Treats DC as 0, then adds upsampled_dc after IDCT.
+    ReconTiles(header, cache->ac, &upsampled_dc, to_srgb, dither, encoding,
+               primaries, pool, &cache->graphs, out, sink,
+               /*idct_done=*/false, composite);
   } else {
-    AddPredictions(cache->dc, pool, &cache->ac, &idct);
+    AddPredictions(cache->dc, pool, &cache->ac);
+    ReconTiles(header, cache->ac, nullptr, to_srgb, dither, encoding,
+               primaries, pool, &cache->graphs, out, sink,
+               /*idct_done=*/false, composite);
   }
+}
 
-  if (header.flags & Header::kGaborishTransform) {
-    idct = ConvolveGaborish(idct, pool);
+Image3F ReconOpsinImage(const Header& header, const Quantizer& quantizer,
+                        const ColorTransform& ctan, ThreadPool* pool,
+                        DecCache* cache, PikInfo* pik_info) {
+  PROFILER_ZONE("recon");
+  Image3F opsin;
+  ReconT(header, quantizer, ctan, /*to_srgb=*/false, /*dither=*/false,
+         SampleEncoding::kSRGB, ColorPrimaries::kSRGB, pool, cache, &opsin);
+  return opsin;
+}
+
+void ReconSrgbImage(const Header& header, const Quantizer& quantizer,
+                    const ColorTransform& ctan, const bool dither,
+                    ThreadPool* pool, DecCache* cache, Image3B* srgb,
+                    const ImageRowsSink<uint8_t>* sink,
+                    const SampleEncoding encoding,
+                    const ColorPrimaries primaries,
+                    const AlphaComposite* composite) {
+  PROFILER_ZONE("recon srgb");
+  ReconT(header, quantizer, ctan, /*to_srgb=*/true, dither, encoding,
+         primaries, pool, cache, srgb, sink, composite);
+}
+void ReconSrgbImage(const Header& header, const Quantizer& quantizer,
+                    const ColorTransform& ctan, const bool dither,
+                    ThreadPool* pool, DecCache* cache, Image3U* srgb,
+                    const ImageRowsSink<uint16_t>* sink,
+                    const SampleEncoding encoding,
+                    const ColorPrimaries primaries,
+                    const AlphaComposite* composite) {
+  PROFILER_ZONE("recon srgb");
+  ReconT(header, quantizer, ctan, /*to_srgb=*/true, dither, encoding,
+         primaries, pool, cache, srgb, sink, composite);
+}
+void ReconSrgbImage(const Header& header, const Quantizer& quantizer,
+                    const ColorTransform& ctan, const bool dither,
+                    ThreadPool* pool, DecCache* cache, Image3F* srgb,
+                    const ImageRowsSink<float>* sink,
+                    const SampleEncoding encoding,
+                    const ColorPrimaries primaries,
+                    const AlphaComposite* composite) {
+  PROFILER_ZONE("recon srgb");
+  ReconT(header, quantizer, ctan, /*to_srgb=*/true, dither, encoding,
+         primaries, pool, cache, srgb, sink, composite);
+}
+
+namespace {
+
+// For the whole-image DC decoded by DecodeFromBitstream.
+void UnapplyGradientMap(const Header& header, ThreadPool* pool,
+                        DecCache* cache) {
+  if ((header.flags & Header::kGradientMap) == 0) return;
+  GradientMap map(cache->image_xsize_blocks, cache->image_ysize_blocks);
+  map.corners_[0] = cache->gradient[0];
+  map.corners_[1] = cache->gradient[1];
+  map.corners_[2] = cache->gradient[2];
+  map.Unapply(Rect(cache->x0_blocks, cache->y0_blocks, cache->dc.xsize(),
+                   cache->dc.ysize()),
+              pool, &cache->dc);
+}
+
+// Maps the lowest "dim" x "dim" coefficients of a block to the "dim" x "dim"
+// averages of its 8/dim x 8/dim pixel cells, optionally including the effect
+// of Gaborish (approximated by its frequency response, i.e. ignoring block
+// boundaries).
+class PartialIDCT {
+ public:
+  PartialIDCT(const size_t dim, const bool gaborish) : dim_(dim) {
+    const Weights3x3& weights = kernel::Gaborish3().Weights();
+    const size_t cell = kBlockWidth / dim_;
+    const float mul = 1.0f / (cell * cell);
+    for (size_t r = 0; r < dim_; ++r) {
+      for (size_t c = 0; c < dim_; ++c) {
+        // Exact (up to rounding) pixels of this basis function.
+        SIMD_ALIGN float coeffs[kBlockSize] = {0.0f};
+        SIMD_ALIGN float pixels[kBlockSize];
+        coeffs[r * kBlockWidth + c] = 1.0f;
+        ComputeTransposedScaledBlockIDCTFloat(FromBlock(coeffs),
+                                              ToBlock(pixels), DC_Unchanged());
+        constexpr double kPi = 3.1415926535897932;
+        const float cos_r = std::cos(r * kPi / kBlockWidth);
+        const float cos_c = std::cos(c * kPi / kBlockWidth);
+        const float response =
+            gaborish ? weights.mc[0] + 2.0f * weights.tc[0] * (cos_r + cos_c) +
+                           4.0f * weights.tl[0] * cos_r * cos_c
+                     : 1.0f;
+        for (size_t iy = 0; iy < dim_; ++iy) {
+          for (size_t ix = 0; ix < dim_; ++ix) {
+            float sum = 0.0f;
+            for (size_t y = iy * cell; y < (iy + 1) * cell; ++y) {
+              for (size_t x = ix * cell; x < (ix + 1) * cell; ++x) {
+                sum += pixels[y * kBlockWidth + x];
+              }
+            }
+            matrix_[(iy * dim_ + ix) * kMaxCoeffs + r * dim_ + c] =
+                sum * mul * response;
+          }
+        }
+      }
+    }
+  }
+
+  // Writes "dim" pixels to each of row_out[0, dim).
+  void Run(const float* PIK_RESTRICT block, float* PIK_RESTRICT* row_out,
+           const size_t x) const {
+    float low[kMaxCoeffs];
+    for (size_t r = 0; r < dim_; ++r) {
+      for (size_t c = 0; c < dim_; ++c) {
+        low[r * dim_ + c] = block[r * kBlockWidth + c];
+      }
+    }
+    for (size_t i = 0; i < dim_ * dim_; ++i) {
+      const float* PIK_RESTRICT row_matrix = matrix_ + i * kMaxCoeffs;
+      float sum = 0.0f;
+      for (size_t j = 0; j < dim_ * dim_; ++j) {
+        sum += row_matrix[j] * low[j];
+      }
+      row_out[i / dim_][x + i % dim_] = sum;
+    }
   }
 
-  return idct;
+ private:
+  static constexpr size_t kMaxCoeffs = 16;  // For dim = 4.
+
+  const size_t dim_;
+  float matrix_[kMaxCoeffs * kMaxCoeffs];
+};
+
+}  // namespace
+
+Image3F ReconOpsinDownscaled(const Header& header, const size_t downscale,
+                             ThreadPool* pool, DecCache* cache) {
+  PROFILER_ZONE("recon downscaled");
+  PIK_CHECK(downscale == 2 || downscale == 4);
+  PIK_CHECK(cache->eager_dequant && !cache->dc_only);
+  const size_t xsize_blocks = cache->dc.xsize();
+  const size_t ysize_blocks = cache->dc.ysize();
+  const size_t dim = kBlockWidth / downscale;
+
+  UnapplyGradientMap(header, pool, cache);
+
+  if (cache->compact_ac) {
+    // The predictions and partial IDCT below update/read float coefficients.
+    cache->ac.Resize(xsize_blocks * kBlockSize, ysize_blocks);
+    // About one tick per converted coefficient.
+    const uint64_t cost_per_row = 3 * kBlockSize * xsize_blocks;
+    pool->Run(0, ysize_blocks, [&](const int task, const int thread) {
+      const Rect rect(0, task, xsize_blocks, 1);
+      LoadCompactAC(rect, cache->ac16, rect, &cache->ac);
+    }, cost_per_row);
+  }
+
+  // Same predictions as ReconT, except that the 4x4 upsampling is only needed
+  // if its coefficients are used.
+  Image3F smooth_dc;
+  if ((header.flags & Header::kSmoothDCPred) && cache->flat_dc) {
+    SetDCFromImage(BlockAveragesOfUpsampledDC(cache->dc, pool), pool,
+                   &cache->ac);
+  } else if (header.flags & Header::kSmoothDCPred) {
+    smooth_dc = Subsample(BlurUpsampleDC(cache->dc, pool), downscale);
+    FillDC(0.0f, pool, &cache->ac);
+  } else if (dim == 2) {
+    (void)PredictSpatial2x2_AC64(cache->dc, &cache->ac);
+  } else {
+    AddPredictions(cache->dc, pool, &cache->ac);
+  }
+
+  const PartialIDCT idct(dim, (header.flags & Header::kGaborishTransform) != 0);
+  Image3F opsin(xsize_blocks * dim, ysize_blocks * dim);
+  pool->Run(0, ysize_blocks, [&](const int task, const int thread) {
+    const size_t by = task;
+    for (int c = 0; c < 3; ++c) {
+      const float* PIK_RESTRICT row_ac = cache->ac.ConstPlaneRow(c, by);
+      float* PIK_RESTRICT rows_out[kBlockHeight / 2];
+      for (size_t iy = 0; iy < dim; ++iy) {
+        rows_out[iy] = opsin.PlaneRow(c, by * dim + iy);
+      }
+      for (size_t bx = 0; bx < xsize_blocks; ++bx) {
+        idct.Run(row_ac + bx * kBlockSize, rows_out, bx * dim);
+      }
+      if (smooth_dc.xsize() != 0) {
+        for (size_t iy = 0; iy < dim; ++iy) {
+          const float* PIK_RESTRICT row_dc =
+              smooth_dc.ConstPlaneRow(c, by * dim + iy);
+          for (size_t x = 0; x < opsin.xsize(); ++x) {
+            rows_out[iy][x] += row_dc[x];
+          }
+        }
+      }
+    }
+    if (header.flags & Header::kGrayscale) {
+      for (size_t iy = 0; iy < dim; ++iy) {
+        const size_t y = by * dim + iy;
+        GrayXybFromY(opsin.ConstPlaneRow(1, y), opsin.xsize(),
+                     opsin.PlaneRow(0, y), opsin.PlaneRow(2, y));
+      }
+    }
+  });
+  return opsin;
+}
+
+Image3F ReconOpsinPreview(const Header& header, const size_t downsampling,
+                          ThreadPool* pool, DecCache* cache) {
+  PROFILER_ZONE("recon preview");
+  PIK_CHECK(downsampling == 2 || downsampling == 4 || downsampling == 8);
+  const size_t xsize_blocks = cache->dc.xsize();
+  const size_t ysize_blocks = cache->dc.ysize();
+
+  UnapplyGradientMap(header, pool, cache);
+
+  if (header.flags & Header::kGrayscale) {
+    for (size_t by = 0; by < ysize_blocks; ++by) {
+      GrayXybFromY(cache->dc.ConstPlaneRow(1, by), xsize_blocks,
+                   cache->dc.PlaneRow(0, by), cache->dc.PlaneRow(2, by));
+    }
+  }
+
+  // DC is the mean of each 8x8 block, i.e. already a 1:8 image.
+  if (downsampling == kBlockWidth) return std::move(cache->dc);
+
+  // Smoother than replicating DC; the upsampling cost is negligible compared
+  // to decoding AC.
+  const Image3F upsampled = BlurUpsampleDC(cache->dc, pool);
+  return Subsample(upsampled, downsampling);
 }
 
 }  // namespace pik
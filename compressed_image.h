@@ -17,23 +17,47 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
+#include "ans_decode.h"
 #include "bit_reader.h"
 #include "common.h"
+#include "entropy_coder.h"
 #include "header.h"
 #include "image.h"
 #include "noise.h"
+#include "opsin_inverse.h"
+#include "orientation.h"
 #include "padded_bytes.h"
 #include "pik_info.h"
 #include "pik_params.h"
 #include "quantizer.h"
+#include "tile_flow.h"
 
 namespace pik {
 
+// Returns a copy of "in" enlarged to a multiple of N by replicating the last
+// column and row.
 Image3F AlignImage(const Image3F& in, const size_t N);
+// Same, but without copying if "in" can GrowTo the aligned size (e.g. from
+// ImageWithCapacityForMultipleOf).
+Image3F AlignImage(Image3F&& in, const size_t N);
 
 void CenterOpsinValues(Image3F* img);
 
+// Returns "opsin" enlarged to whole blocks and centered, optionally followed
+// by GaborishInverse. Same result as AlignImage(opsin, kBlockWidth),
+// CenterOpsinValues and GaborishInverse, but in a single parallel pass.
+Image3F CenteredOpsin(const Image3F& opsin, bool gaborish_inverse,
+                      ThreadPool* pool);
+
+// Returns TransposedScaledDCT(CenteredOpsin(opsin, gaborish_inverse, pool)),
+// computed by a TFGraph so that the centered (and inverted) opsin image only
+// exists as per-tile buffers.
+Image3F CenteredOpsinDCT(const Image3F& opsin, bool gaborish_inverse,
+                         ThreadPool* pool);
+
 struct ColorTransform {
   ColorTransform(size_t xsize, size_t ysize)  // pixels
       : ytox_dc(128),
@@ -53,6 +77,8 @@ struct ColorTransform {
 struct QuantizedCoeffs {
   Image3S dc;
   Image3S ac;  // 64 coefs per block, first (DC) is ignored.
+  // Number of nonzero AC coefficients per block, or empty if not computed.
+  Image3I num_nzeros;
 };
 
 void ComputePredictionResiduals(const Quantizer& quantizer, int flags,
@@ -63,18 +89,82 @@ void ApplyColorTransform(const ColorTransform& ctan, const float factor,
 
 // Working area for ComputeCoefficients; avoids duplicated work when called
 // multiple times.
+// Encoder state for one image. Reset allows reusing the buffers for another
+// image (or quantization search) without reallocating them.
 struct EncCache {
+  // Invalidates the cached state, as if newly constructed, but retains the
+  // allocations of the coefficient images and the counters.
+  void Reset() {
+    have_coeffs_init = false;
+    have_pred = false;
+    gradient_map.resize(0);
+    for (std::vector<float>& g : gradient) g.clear();
+  }
+
+  // As Reset, but also frees the images (except pending_dct), e.g. if the
+  // cache will not be reused soon.
+  void Release() {
+    Reset();
+    coeffs_init = Image3F();
+    coeffs = Image3F();
+    dc_dec = Image3F();
+    pred_ac01 = Image3F();
+    pred_ac10 = Image3F();
+    pred_ac11 = Image3F();
+    dc_sharp = Image3F();
+    pred_smooth = Image3F();
+  }
+
+  // Returns the total capacity [bytes] of the retained buffers.
+  size_t BytesAllocated() const {
+    return coeffs_init.bytes_allocated() + pending_dct.bytes_allocated() +
+           coeffs.bytes_allocated() +
+           dc_dec.bytes_allocated() + pred_ac01.bytes_allocated() +
+           pred_ac10.bytes_allocated() + pred_ac11.bytes_allocated() +
+           dc_sharp.bytes_allocated() + pred_smooth.bytes_allocated() +
+           gradient_map.padded_size();
+  }
+
   bool have_coeffs_init = false;
   // DCT [with optional preprocessing that depends only on DC]
   Image3F coeffs_init;
+  // If non-null, TransposedScaledDCT of the opsin image passed to
+  // ComputeCoefficients, which copies it instead of recomputing it (e.g. when
+  // encoding the same image at several distances). Not affected by Reset.
+  const Image3F* precomputed_dct = nullptr;
+  // If not empty, used (and emptied) by the next ComputeCoefficients call
+  // that computes coeffs_init instead of TransposedScaledDCT of its opsin
+  // argument, e.g. from CenteredOpsinDCT. Not affected by Reset.
+  Image3F pending_dct;
+  // If non-null (and neither of the above is set), ComputeCoefficients
+  // computes coeffs_init as CenteredOpsinDCT of this uncentered opsin image
+  // (with uncentered_gaborish_inverse), so its opsin argument may be empty.
+  // Not affected by Reset.
+  const Image3F* uncentered_opsin = nullptr;
+  bool uncentered_gaborish_inverse = false;
+
+  // If true (CompressParams::low_memory), ComputeCoefficients writes the
+  // residuals in place of coeffs_init instead of a copy of it, which saves one
+  // coefficient image but recomputes the DCT and prediction on every call.
+  // ComputeCoefficientsFromCache then cannot be used. Not affected by Reset.
+  bool low_memory = false;
 
-  // Working value, copied from coeffs_init.
+  // Working value, copied from coeffs_init (or moved if low_memory).
   Image3F coeffs;
 
   bool have_pred = false;
+  // Quantizer::inv_quant_dc for which the prediction was computed.
+  float pred_inv_quant_dc = 0.0f;
+  // Number of ComputeCoefficients calls that reused/recomputed the prediction.
+  size_t num_pred_hits = 0;
+  size_t num_pred_misses = 0;
 
   // ComputePredictionResiduals
   Image3F dc_dec;
+  // DC-only terms of the AC prediction (see PredictACFromDC).
+  Image3F pred_ac01;
+  Image3F pred_ac10;
+  Image3F pred_ac11;
 
   // ComputePredictionResiduals_Smooth
   Image3F dc_sharp;
@@ -92,45 +182,430 @@ QuantizedCoeffs ComputeCoefficients(const CompressParams& params,
                                     EncCache* cache,
                                     const PikInfo* aux_out = nullptr);
 
+// Quantizes the residuals for "quantizer" into "coeffs", reusing the DCT and
+// DC prediction stored in "cache" by a prior ComputeCoefficients with the same
+// header. Does not modify "cache", so several quantizers can be evaluated
+// concurrently, each with its own "coeffs".
+QuantizedCoeffs ComputeCoefficientsFromCache(const Header& header,
+                                             const Quantizer& quantizer,
+                                             const ColorTransform& ctan,
+                                             const EncCache& cache,
+                                             ThreadPool* pool,
+                                             Image3F* PIK_RESTRICT coeffs);
+
+// "header" selects bitstream options such as the number of ANS states.
 PaddedBytes EncodeToBitstream(const QuantizedCoeffs& qcoeffs,
+                              const Header& header,
                               const Quantizer& quantizer,
                               const NoiseParams& noise_params,
                               const ColorTransform& ctan, bool fast_mode,
+                              ThreadPool* pool, PikInfo* info = nullptr);
+
+// As above, but writes the bitstream to "sink" starting at "offset" instead
+// of concatenating it in memory: the group codes are written by the "pool"
+// threads at their final offsets once the group sizes are known. Sets *size
+// to the number of bytes written. Returns false if the sink fails.
+bool EncodeToBitstream(const QuantizedCoeffs& qcoeffs, const Header& header,
+                       const Quantizer& quantizer,
+                       const NoiseParams& noise_params,
+                       const ColorTransform& ctan, bool fast_mode,
+                       ThreadPool* pool, uint64_t offset,
+                       PositionedByteSink* sink, uint64_t* size,
+                       PikInfo* info = nullptr);
+
+// Group-sharded encoding: PlanEncoding performs the global (whole-image)
+// pass once; the resulting plan can be serialized and sent to several
+// encoders, each of which calls EncodeGroupShard for a disjoint range of
+// groups. StitchBitstream then concatenates the shards (in group order) into
+// the same bitstream as EncodeToBitstream. All shards must use the same
+// "qcoeffs" and "quantizer" as PlanEncoding.
+struct EncodingPlan {
+  // ctan, noise and quantizer sections.
+  std::string global_code;
+  // Empty for small images.
+  std::string order_code;
+  std::string histo_code;
+  int32_t order[kOrderContexts * kBlockSize];
+  std::vector<uint8_t> context_map;
+  std::vector<ANSEncodingData> codes;
+  uint32_t num_groups = 0;
+  uint32_t flags = 0;  // Header::flags
+  uint32_t num_ans_states = 0;
+  uint32_t group_size_in_blocks = kGroupWidthInBlocks;
+};
+
+// Note: tokenizes all groups to gather the AC histograms, so this is about
+// as costly as EncodeToBitstream minus the entropy coding.
+EncodingPlan PlanEncoding(const QuantizedCoeffs& qcoeffs, const Header& header,
+                          const Quantizer& quantizer,
+                          const NoiseParams& noise_params,
+                          const ColorTransform& ctan, bool fast_mode,
+                          ThreadPool* pool);
+
+PaddedBytes SerializePlan(const EncodingPlan& plan);
+// Returns false if "bytes" is truncated or inconsistent.
+bool DeserializePlan(const PaddedBytes& bytes, EncodingPlan* plan);
+
+// Encodes groups [first_group, first_group + num_groups) into one DC and one
+// AC code per group.
+void EncodeGroupShard(const EncodingPlan& plan, const QuantizedCoeffs& qcoeffs,
+                      const Quantizer& quantizer, size_t first_group,
+                      size_t num_groups, ThreadPool* pool,
+                      std::vector<PaddedBytes>* dc_group_codes,
+                      std::vector<PaddedBytes>* ac_group_codes);
+
+// "dc_group_codes" and "ac_group_codes" are the concatenation (in group order)
+// of all shards and must cover all plan.num_groups groups.
+PaddedBytes StitchBitstream(const EncodingPlan& plan,
+                            const std::vector<PaddedBytes>& dc_group_codes,
+                            const std::vector<PaddedBytes>& ac_group_codes);
+
+// Returns the approximate size [bytes] of EncodeToBitstream(fast_mode=false)
+// without entropy-coding the AC tokens; their cost is estimated from their
+// histograms via EstimateTokenBits. For rate control.
+size_t EstimateBitstreamSize(const QuantizedCoeffs& qcoeffs,
+                             const Header& header, const Quantizer& quantizer,
+                             const NoiseParams& noise_params,
+                             const ColorTransform& ctan, ThreadPool* pool);
+
+// Returns the estimated size [bits] of the quant field and AC tokens of each
+// tile of "qcoeffs" without producing a bitstream. Tiles are tokenized
+// independently, so contexts at their borders differ slightly from
+// EncodeToBitstream. Initializes "model" from these tokens unless it already
+// is; retaining it across calls (e.g. FindBestQuantization iterations) avoids
+// that step and keeps estimates comparable.
+ImageF EstimateGroupBits(const QuantizedCoeffs& qcoeffs,
+                         const Quantizer& quantizer, ThreadPool* pool,
+                         TokenCostModel* model);
+
+// Coefficient orders used in fast mode: the natural order for all contexts.
+void NaturalCoeffOrders(int32_t* PIK_RESTRICT order);
+
+// Computes contexts in [0, kOrderContexts) from "rect_dc" within "dc" and
+// writes to "rect_ctx" within "ctx".
+void ComputeBlockContextFromDC(const Rect& rect_dc, const Image3S& dc,
+                               const Quantizer& quantizer, const Rect& rect_ctx,
+                               Image3B* PIK_RESTRICT ctx);
+
+// Same as EncodeToBitstream in fast mode, but the AC coefficients have already
+// been tokenized ("tokens" holds one vector per group, in group order, from
+// TokenizeCoefficients with NaturalCoeffOrders). Allows encoding images one
+// group row at a time.
+PaddedBytes EncodeToBitstream(const Image3S& dc,
+                              const std::vector<std::vector<Token> >& tokens,
+                              const Header& header, const Quantizer& quantizer,
+                              const NoiseParams& noise_params,
+                              const ColorTransform& ctan, ThreadPool* pool,
                               PikInfo* info = nullptr);
+bool EncodeToBitstream(const Image3S& dc,
+                       const std::vector<std::vector<Token> >& tokens,
+                       const Header& header, const Quantizer& quantizer,
+                       const NoiseParams& noise_params,
+                       const ColorTransform& ctan, ThreadPool* pool,
+                       uint64_t offset, PositionedByteSink* sink,
+                       uint64_t* size, PikInfo* info = nullptr);
+
+// Temporary storage; one per thread, for one group.
+struct DecoderBuffers {
+  // Allocates (only) the buffers that are not yet allocated or smaller than
+  // a group of group_size_in_blocks^2 blocks.
+  void InitOnce(bool eager_dequant, size_t group_size_in_blocks);
+
+  Image3B block_ctx;
+
+  // Decode (only if eager_dequant)
+  Image3S quantized_ac;
+
+  // ExpandDC
+  ImageS dc_y;
+  ImageS dc_xz_residuals;
+  ImageS dc_xz_expanded;
+
+  // DequantAC
+  Image3I num_nzeroes;
+
+  // Copy of the current group if it straddles SegmentedBytes segments.
+  PaddedBytes straddling_group;
+
+  // ReconOpsinImage (only if !eager_dequant or compact_ac): one group's
+  // dequantized AC, plus a border for the prediction. Also the staging buffer
+  // for DecCache::ac16. Resized as needed.
+  Image3F ac;
+};
+
+struct DecCache;
 
+// Called by DecodeFromBitstream once the DC of all groups is decoded, before
+// any AC group. "cache.quantized_dc" (and "cache.dc" if eager_dequant) are then
+// final; they must not be modified, e.g. copy dc before ReconOpsinPreview.
+struct DecodedDCHook {
+  using Func = void (*)(void* opaque, const DecCache& cache);
+
+  Func func;
+  void* opaque;
+};
+
+// Replaces the CPU reconstruction (IDCT, Gaborish) and color conversion of
+// PikToPixels, e.g. with an accelerator that uploads "cache.dc" and
+// "cache.ac" (or ac16 if compact_ac; both dequantized, see eager_dequant) and
+// produces the pixels in its own memory. "header" has the stage overrides of
+// "params" applied, including kDither. Only called for entire images at full
+// resolution without alpha, when neither denoising nor noise are enabled.
+// Returns false to let the CPU reconstruct the image instead (e.g. if the
+// header requests a stage that the backend lacks), otherwise the decoder
+// leaves its output image empty. "cache" may be reused as soon as this
+// returns, so work that is still in flight must first copy what it needs;
+// the entropy decoding of the next image can then overlap it.
+struct ReconHook {
+  using Func = bool (*)(void* opaque, const Header& header,
+                        const DecompressParams& params, const DecCache& cache);
+
+  Func func;
+  void* opaque;
+};
+
+// Decoder state. Reusing one instance for multiple images avoids most of the
+// per-image allocations: images only grow if a larger image arrives.
 struct DecCache {
   // If true, ReconOpsinImage skips the DC/AC dequant, which assumes someone
   // else (i.e. DecodeFromBitstream) did it already.
   bool eager_dequant = false;
 
-  // Only used if !eager_dequant
+  // If true, DecodeFromBitstream stops after the DC groups, so only dc is
+  // valid. Requires eager_dequant.
+  bool dc_only = false;
+
+  // If true and Header::kSmoothDCPred, the reconstruction (only if
+  // eager_dequant) replaces the upsampled DC with its block averages, which
+  // are computed at DC resolution; faster but blockier.
+  bool flat_dc = false;
+
+  // If true (requires eager_dequant), the dequantized AC is stored as halves in
+  // ac16 instead of ac, which halves the largest allocation and the bandwidth
+  // of the IDCT. The slight loss of precision (11-bit mantissa) is far below
+  // the quantization error.
+  bool compact_ac = false;
+
+  // If non-null, receives the DC before the AC is decoded (e.g. for showing a
+  // preview while the rest of the image decodes).
+  const DecodedDCHook* dc_hook = nullptr;
+
+  // If non-null and cancelled, DecodeFromBitstream skips the remaining groups
+  // and returns false (as it does once any group fails to decode).
+  const CancellationToken* cancel = nullptr;
+
+  // Written by DecodeFromBitstream (the region's DC is also needed to decode
+  // its AC) and, if !eager_dequant, ReconOpsinImage.
   Image3S quantized_dc;
+  // Only used if !eager_dequant
   Image3S quantized_ac;
 
   // Dequantized output produced by DecodeFromBitstream (if eager_dequant) or
-  // ReconOpsinImage.
+  // (only dc) ReconOpsinImage, which dequantizes the AC one group at a time.
   Image3F dc;
   Image3F ac;
+  // Only used if compact_ac; same layout as ac (see LoadF16).
+  Image3U ac16;
 
   std::vector<float> gradient[3];
+
+  // Origin [blocks] of the region covered by dc/ac and the size of the entire
+  // image; set by DecodeFromBitstream. A zero image size (e.g. in the encoder)
+  // means dc/ac cover the entire image.
+  size_t x0_blocks = 0;
+  size_t y0_blocks = 0;
+  size_t image_xsize_blocks = 0;
+  size_t image_ysize_blocks = 0;
+
+  // Retained across images to avoid reallocation; the contents are only valid
+  // during DecodeFromBitstream/ReconOpsinImage.
+  std::vector<DecoderBuffers> decoder_buffers;  // one per thread
+  // Shared with HistogramCache::Global (and thus other decoders).
+  std::shared_ptr<const DecodedHistograms> ac_histograms;
+  // Reconstruction graphs, rebound to the next image of the same size.
+  TFGraphCache graphs;
+
+  // Returns the total capacity [bytes] of the retained buffers.
+  size_t BytesAllocated() const;
 };
 
+// Decodes the coefficients one group at a time, in bitstream order: the
+// image-level fields and DC group sizes, each DC group, the AC coefficient
+// orders, histograms and group sizes, then each AC group. DecodeFromBitstream
+// runs all steps on a complete stream; incremental decoders run each step as
+// soon as its bytes have arrived. Offsets [bytes] are relative to the start of
+// "compressed", which may be a prefix of the stream that grows (and moves)
+// between calls.
+class GroupDecoder {
+ public:
+  // Reads the fields that precede the DC groups, then skips "reader" past the
+  // DC groups (possibly beyond the end of "compressed"). Outputs and "region"
+  // are as for DecodeFromBitstream; they must outlive this object.
+  bool ReadDCInfo(const Header& header, const PaddedBytes& compressed,
+                  BitReader* reader, size_t xsize_blocks, size_t ysize_blocks,
+                  ThreadPool* pool, ColorTransform* ctan,
+                  NoiseParams* noise_params, Quantizer* quantizer,
+                  DecCache* cache, const Rect* region = nullptr);
+
+  // Number of groups to decode, i.e. within the region.
+  size_t NumTasks() const { return num_tasks_; }
+
+  // Returns the end offset of the DC group of "task" (< NumTasks()).
+  uint64_t DCGroupEnd(size_t task) const;
+  // Returns the offset of the AC info (i.e. after all DC groups).
+  uint64_t ACInfoBegin() const;
+  // Returns the end offset of the AC group of "task"; requires ReadACInfo.
+  uint64_t ACGroupEnd(size_t task) const;
+
+  // May be called concurrently for different "task"; "thread" selects one of
+  // the cache->decoder_buffers (one per thread of the "pool" above). "stream"
+  // is the entire stream, of which only the group's bytes are accessed.
+  bool DecodeDCGroup(const SegmentedBytes& stream, size_t task, int thread);
+  // Passes the DC to cache->dc_hook; requires all DC groups.
+  void FinishDC();
+
+  // "bytes" are the stream bytes starting at offset "bytes_begin" and
+  // "reader" reads from them, positioned at ACInfoBegin(); afterwards, it is
+  // skipped past the AC groups. Not for dc_only. For small images (one
+  // group), the AC group extends to the end of the stream (of "stream_size").
+  bool ReadACInfo(const PaddedBytes& bytes, uint64_t bytes_begin,
+                  uint64_t stream_size, BitReader* reader);
+  bool DecodeACGroup(const SegmentedBytes& stream, size_t task, int thread);
+  // Moves the quant field into the quantizer; requires all AC groups.
+  void FinishAC();
+
+ private:
+  // Returns the rect [blocks] of "task" relative to the region, and its
+  // group index within the entire image.
+  Rect GroupRect(size_t task, size_t* PIK_RESTRICT group) const;
+
+  ColorTransform* ctan_ = nullptr;
+  Quantizer* quantizer_ = nullptr;
+  DecCache* cache_ = nullptr;
+  bool grayscale_ = false;
+  bool small_image_ = false;
+  bool static_histograms_ = false;
+  size_t num_ans_states_ = 1;
+
+  size_t group_size_ = kGroupWidthInBlocks;  // [blocks]
+  size_t xsize_groups_ = 0;
+  size_t num_groups_ = 0;  // Within the entire image.
+  // Region [blocks]; Rect is not assignable.
+  size_t region_x0_ = 0;
+  size_t region_y0_ = 0;
+  size_t region_xsize_ = 0;
+  size_t region_ysize_ = 0;
+  size_t region_xsize_groups_ = 0;
+  size_t num_tasks_ = 0;
+
+  std::vector<uint64_t> dc_group_offsets_;
+  uint64_t dc_groups_begin_ = 0;
+  int32_t coeff_order_[kOrderContexts * kBlockSize];
+  std::vector<uint64_t> ac_group_offsets_;
+  uint64_t ac_groups_begin_ = 0;  // 0 until ReadACInfo.
+  ImageI ac_quant_field_;  // Of the region.
+};
+
+// Returns the region [blocks] to decode such that the pixels within "rect"
+// [pixels] are the same as after decoding the entire image. The region is
+// aligned to groups and includes the borders needed by the DC prediction,
+// Gaborish and edge-preserving filter.
+Rect RegionForRect(const Header& header, const Rect& rect, size_t xsize_blocks,
+                   size_t ysize_blocks);
+
 // "compressed" is the same range from which reader was constructed, and allows
 // seeking to tiles and constructing per-thread BitReader.
 // Writes to (cache->eager_dequant ? cache->dc/ac : cache->quantized_dc/ac).
+// If "region" (from RegionForRect) is non-null, only its groups are decoded;
+// cache, ctan maps and the quant field then cover only the region.
 bool DecodeFromBitstream(const Header& header, const PaddedBytes& compressed,
                          BitReader* reader, const size_t xsize_blocks,
                          const size_t ysize_blocks, ThreadPool* pool,
                          ColorTransform* ctan, NoiseParams* noise_params,
-                         Quantizer* quantizer, DecCache* cache);
+                         Quantizer* quantizer, DecCache* cache,
+                         const Rect* region = nullptr);
+
+// Appends to "cropped" the bitstream (as read by DecodeFromBitstream) of an
+// image consisting of the groups within the group-aligned "region" [blocks]
+// of the bitstream at "reader" within "compressed". The group codes, noise,
+// quantizer, coefficient orders and histograms are copied verbatim; only the
+// gradient and color correlation maps (which cover the entire image) and the
+// group sizes are re-encoded. Fails for Header::kSmallImage.
+bool CropBitstream(const Header& header, const PaddedBytes& compressed,
+                   BitReader* reader, size_t xsize_blocks,
+                   size_t ysize_blocks, const Rect& region, ThreadPool* pool,
+                   PaddedBytes* cropped);
+
+// Rearranges "qcoeffs" (as returned by DecodeFromBitstream in
+// cache->quantized_dc/ac), the quant field of "quantizer" and "ctan" such that
+// EncodeToBitstream produces the image transformed by "orientation". Flips
+// only change signs and are lossless. Transposes must also requantize the
+// coefficients whose quantization weight differs from that of their transposed
+// position, and (only if the image size is not a multiple of tiles) blocks
+// whose color correlation tile changes. The caller ensures mirrored axes are
+// a multiple of kBlockWidth pixels; the gradient map is not supported.
+void OrientCoefficients(Orientation orientation, bool grayscale,
+                        ThreadPool* pool, QuantizedCoeffs* qcoeffs,
+                        Quantizer* quantizer, ColorTransform* ctan);
+
+// Dequantizes and inverse color-transforms all blocks of "quantized_ac" (64
+// coefficients per block, as decoded) into "ac", which is resized. Same as the
+// per-group dequantization of the decoder; e.g. for benchmarks.
+void DequantizeAC(const Quantizer& quantizer, const ColorTransform& ctan,
+                  const Image3S& quantized_ac, Image3F* PIK_RESTRICT ac);
 
 // Uses (cache->eager_dequant ? cache->dc/ac : cache->quantized_dc/ac).
 Image3F ReconOpsinImage(const Header& header, const Quantizer& quantizer,
                         const ColorTransform& ctan, ThreadPool* pool,
                         DecCache* cache, PikInfo* pik_info = nullptr);
 
+// Same as CenteredOpsinToSrgb(ReconOpsinImage(..)), but also fuses the color
+// conversion into the tiled reconstruction, so no full-size opsin image is
+// needed. Only possible if nothing (denoising, noise) operates on the opsin
+// image before the conversion. If "sink" is non-null, each group row of srgb
+// (clamped to the header size) is passed to it as soon as it is reconstructed.
+// "encoding", "primaries" and "composite" are as for CenteredOpsinToSrgb;
+// composite->alpha
+// must have the size of "srgb", i.e. whole blocks.
+void ReconSrgbImage(const Header& header, const Quantizer& quantizer,
+                    const ColorTransform& ctan, bool dither, ThreadPool* pool,
+                    DecCache* cache, Image3B* srgb,
+                    const ImageRowsSink<uint8_t>* sink = nullptr,
+                    SampleEncoding encoding = SampleEncoding::kSRGB,
+                    ColorPrimaries primaries = ColorPrimaries::kSRGB,
+                    const AlphaComposite* composite = nullptr);
+void ReconSrgbImage(const Header& header, const Quantizer& quantizer,
+                    const ColorTransform& ctan, bool dither, ThreadPool* pool,
+                    DecCache* cache, Image3U* srgb,
+                    const ImageRowsSink<uint16_t>* sink = nullptr,
+                    SampleEncoding encoding = SampleEncoding::kSRGB,
+                    ColorPrimaries primaries = ColorPrimaries::kSRGB,
+                    const AlphaComposite* composite = nullptr);
+void ReconSrgbImage(const Header& header, const Quantizer& quantizer,
+                    const ColorTransform& ctan, bool dither, ThreadPool* pool,
+                    DecCache* cache, Image3F* srgb,
+                    const ImageRowsSink<float>* sink = nullptr,
+                    SampleEncoding encoding = SampleEncoding::kSRGB,
+                    ColorPrimaries primaries = ColorPrimaries::kSRGB,
+                    const AlphaComposite* composite = nullptr);
+
+// Returns a 1:"downsampling" (2, 4 or 8) preview of the image, rounded up to
+// whole blocks, from cache->dc as decoded by DecodeFromBitstream (dc_only).
+Image3F ReconOpsinPreview(const Header& header, size_t downsampling,
+                          ThreadPool* pool, DecCache* cache);
+
+// Returns the image downscaled by "downscale" (2 or 4), rounded up to whole
+// blocks, from cache->dc/ac as decoded by DecodeFromBitstream (eager_dequant).
+// Only the lowest 8/downscale x 8/downscale coefficients of each block are
+// inverse-transformed, directly to the cell averages. Gaborish is approximated
+// and the edge-preserving filter (denoising) and noise are skipped.
+Image3F ReconOpsinDownscaled(const Header& header, size_t downscale,
+                             ThreadPool* pool, DecCache* cache);
+
 void GaborishInverse(Image3F& opsin);
-Image3F ConvolveGaborish(const Image3F& in, ThreadPool* pool);
+// Applies the Gaborish3 blur to "opsin" in-place; only needs a few rows of
+// temporary storage per band of rows.
+void ConvolveGaborish(ThreadPool* pool, Image3F* PIK_RESTRICT opsin);
 
 }  // namespace pik
 
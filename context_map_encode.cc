@@ -31,6 +31,13 @@ namespace pik {
 
 namespace {
 
+// Alphabet size is 256 + 16 = 272. (We can have 256 clusters and 16 run
+// length codes).
+constexpr size_t kContextMapAlphabetSize = 272;
+
+// Upper bound for RunLengthCodeZeros; longer runs are split.
+constexpr uint32_t kMaxRunLengthPrefix = 6;
+
 void StoreVarLenUint8(size_t n, size_t* storage_ix, uint8_t* storage) {
   if (n == 0) {
     WriteBits(1, 0, storage_ix, storage);
@@ -122,27 +129,50 @@ void RunLengthCodeZeros(const std::vector<uint8_t>& v_in,
   }
 }
 
-}  // namespace
-
-void EncodeContextMap(const std::vector<uint8_t>& context_map,
-                      size_t num_histograms,
-                      size_t* storage_ix, uint8_t* storage) {
-  StoreVarLenUint8(num_histograms - 1, storage_ix, storage);
+// Run-length coded symbols of one candidate configuration.
+struct ContextMapSymbols {
+  bool use_mtf;
+  uint32_t max_run_length_prefix;
+  std::vector<uint32_t> rle_symbols;
+  std::vector<uint32_t> extra_bits;
+};
+
+void RunLengthCode(const std::vector<uint8_t>& symbols, bool use_mtf,
+                   uint32_t max_run_length_prefix, ContextMapSymbols* out) {
+  out->use_mtf = use_mtf;
+  out->max_run_length_prefix = max_run_length_prefix;
+  out->rle_symbols.clear();
+  out->extra_bits.clear();
+  RunLengthCodeZeros(symbols, &out->max_run_length_prefix, &out->rle_symbols,
+                     &out->extra_bits);
+}
 
-  if (num_histograms == 1) {
-    return;
+// Returns the size [bits] of StoreSymbols except for the constant-size
+// fields.
+size_t ComputeCost(const ContextMapSymbols& candidate,
+                   const size_t num_histograms) {
+  uint32_t histogram[kContextMapAlphabetSize] = {0};
+  size_t cost = 0;
+  for (size_t i = 0; i < candidate.rle_symbols.size(); ++i) {
+    const uint32_t symbol = candidate.rle_symbols[i];
+    ++histogram[symbol];
+    if (symbol > 0 && symbol <= candidate.max_run_length_prefix) {
+      cost += symbol;
+    }
   }
-  // Alphabet size is 256 + 16 = 272. (We can have 256 clusters and 16 run
-  // length codes).
-  static const int kAlphabetSize = 272;
+  size_t histogram_bits, data_bits;
+  BuildHuffmanTreeAndCountBits(
+      histogram, num_histograms + candidate.max_run_length_prefix,
+      &histogram_bits, &data_bits);
+  return cost + histogram_bits + data_bits;
+}
 
-  std::vector<uint8_t> transformed_symbols = MoveToFrontTransform(context_map);
-  std::vector<uint32_t> rle_symbols;
-  std::vector<uint32_t> extra_bits;
-  uint32_t max_run_length_prefix = 6;
-  RunLengthCodeZeros(transformed_symbols, &max_run_length_prefix,
-                     &rle_symbols, &extra_bits);
-  uint32_t symbol_histogram[kAlphabetSize];
+void StoreSymbols(const ContextMapSymbols& candidate, size_t num_histograms,
+                  size_t* storage_ix, uint8_t* storage) {
+  const uint32_t max_run_length_prefix = candidate.max_run_length_prefix;
+  const std::vector<uint32_t>& rle_symbols = candidate.rle_symbols;
+  const std::vector<uint32_t>& extra_bits = candidate.extra_bits;
+  uint32_t symbol_histogram[kContextMapAlphabetSize];
   memset(symbol_histogram, 0, sizeof(symbol_histogram));
   for (size_t i = 0; i < rle_symbols.size(); ++i) {
     ++symbol_histogram[rle_symbols[i]];
@@ -152,8 +182,8 @@ void EncodeContextMap(const std::vector<uint8_t>& context_map,
   if (use_rle) {
     WriteBits(4, max_run_length_prefix - 1, storage_ix, storage);
   }
-  uint8_t bit_depths[kAlphabetSize];
-  uint16_t bit_codes[kAlphabetSize];
+  uint8_t bit_depths[kContextMapAlphabetSize];
+  uint16_t bit_codes[kContextMapAlphabetSize];
   memset(bit_depths, 0, sizeof(bit_depths));
   memset(bit_codes, 0, sizeof(bit_codes));
   BuildAndStoreHuffmanTree(symbol_histogram,
@@ -168,7 +198,46 @@ void EncodeContextMap(const std::vector<uint8_t>& context_map,
       WriteBits(rle_symbols[i], extra_bits[i], storage_ix, storage);
     }
   }
-  WriteBits(1, 1, storage_ix, storage);  // use move-to-front
+  WriteBits(1, candidate.use_mtf, storage_ix, storage);
+}
+
+}  // namespace
+
+void EncodeContextMap(const std::vector<uint8_t>& context_map,
+                      size_t num_histograms,
+                      size_t* storage_ix, uint8_t* storage, bool fast) {
+  StoreVarLenUint8(num_histograms - 1, storage_ix, storage);
+
+  if (num_histograms == 1) {
+    return;
+  }
+
+  // Fixed choice: move-to-front and the longest useful zero runs.
+  ContextMapSymbols best;
+  const std::vector<uint8_t> transformed = MoveToFrontTransform(context_map);
+  RunLengthCode(transformed, /*use_mtf=*/true, kMaxRunLengthPrefix, &best);
+
+  if (!fast) {
+    // Context maps are tiny and building Huffman codes does not allocate, so
+    // all candidates are cheap to evaluate exactly.
+    size_t best_cost = ComputeCost(best, num_histograms);
+    ContextMapSymbols candidate;
+    for (int use_mtf = 0; use_mtf <= 1; ++use_mtf) {
+      const std::vector<uint8_t>& symbols = use_mtf ? transformed : context_map;
+      for (uint32_t prefix = 0; prefix <= kMaxRunLengthPrefix; ++prefix) {
+        RunLengthCode(symbols, use_mtf, prefix, &candidate);
+        // Longer prefixes were capped to the longest run; skip duplicates.
+        if (candidate.max_run_length_prefix != prefix) break;
+        const size_t cost = ComputeCost(candidate, num_histograms);
+        if (cost < best_cost) {
+          best_cost = cost;
+          std::swap(best, candidate);
+        }
+      }
+    }
+  }
+
+  StoreSymbols(best, num_histograms, storage_ix, storage);
 }
 
 }  // namespace pik
@@ -22,10 +22,11 @@
 namespace pik {
 
 // Encodes the given context map to the bit stream. The number of different
-// histogram ids is given by num_histograms.
+// histogram ids is given by num_histograms. Unless "fast", chooses whether to
+// use move-to-front and the run length coding of zeros via a cost estimate.
 void EncodeContextMap(const std::vector<uint8_t>& context_map,
                       size_t num_histograms,
-                      size_t* storage_ix, uint8_t* storage);
+                      size_t* storage_ix, uint8_t* storage, bool fast = false);
 
 }  // namespace pik
 
@@ -374,7 +374,7 @@ class Neighbors {
   static PIK_INLINE V L1(const V c, const V p) {
     // For AVX-512: try permutex2var_ps.
     using namespace SIMD_NAMESPACE;
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     // c = PONM'LKJI, p = Hxxx'xxxx
     const V L_H = concat_lo_hi(c, p);
     return combine_shift_right_bytes<12>(c, L_H);  // ONML'KJIH
@@ -389,13 +389,16 @@ class Neighbors {
   // Returns l[i] == c[Mirror(i - 1)].
   static PIK_INLINE V FirstL1(const V c) {
     using namespace SIMD_NAMESPACE;
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     SIMD_ALIGN constexpr int lanes[8] = {0, 0, 1, 2, 3, 4, 5, 6};
     const auto indices = set_table_indices(d, lanes);
     // c = PONM'LKJI
     return table_lookup_lanes(c, indices);  // ONML'KJII
 #elif SIMD_TARGET_VALUE == SIMD_NONE
     return c;
+#elif SIMD_TARGET_VALUE == SIMD_WASM
+    // c = LKJI
+    return V(wasm_i32x4_shuffle(c.raw, c.raw, 0, 0, 1, 2));  // KJII
 #else
     // c = LKJI
     return V(_mm_shuffle_ps(c.raw, c.raw, _MM_SHUFFLE(2, 1, 0, 0)));  // KJII
@@ -405,13 +408,16 @@ class Neighbors {
   // Returns l[i] == c[Mirror(i - 2)].
   static PIK_INLINE V FirstL2(const V c) {
     using namespace SIMD_NAMESPACE;
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     SIMD_ALIGN constexpr int lanes[8] = {1, 0, 0, 1, 2, 3, 4, 5};
     const auto indices = set_table_indices(d, lanes);
     // c = PONM'LKJI
     return table_lookup_lanes(c, indices);  // NMLK'JIIJ
 #elif SIMD_TARGET_VALUE == SIMD_NONE
     return setzero(d);  // unsupported, avoid calling this.
+#elif SIMD_TARGET_VALUE == SIMD_WASM
+    // c = LKJI
+    return V(wasm_i32x4_shuffle(c.raw, c.raw, 1, 0, 0, 1));  // JIIJ
 #else
     // c = LKJI
     return V(_mm_shuffle_ps(c.raw, c.raw, _MM_SHUFFLE(1, 0, 0, 1)));  // JIIJ
@@ -421,7 +427,7 @@ class Neighbors {
   // Returns r[i] == c[i + 1].
   static PIK_INLINE V R1(const V c, const V n) {
     using namespace SIMD_NAMESPACE;
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     // c = PONM'LKJI, n = xxxx'xxxQ
     const V Q_M = concat_lo_hi(n, c);             // Right-aligned (lower lane)
     return combine_shift_right_bytes<4>(Q_M, c);  // QPON'MLKJ
@@ -436,11 +442,11 @@ class Neighbors {
   // Returns r[i] == c[i + 1].
   static PIK_INLINE V LastR1(const V c) {
     using namespace SIMD_NAMESPACE;
-#if SIMD_TARGET_VALUE == SIMD_AVX2
-    SIMD_ALIGN constexpr uint32_t lanes[8] = {1, 2, 3, 4, 5, 6, 7, 7};
-    const auto indices = load(Full<uint32_t>(), lanes);
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
+    SIMD_ALIGN constexpr int lanes[8] = {1, 2, 3, 4, 5, 6, 7, 7};
+    const auto indices = set_table_indices(d, lanes);
     // c = PONM'LKJI
-    return V(_mm256_permutevar8x32_ps(c.raw, indices.raw));  // PPON'MLKJ
+    return table_lookup_lanes(c, indices);  // PPON'MLKJ
 #elif SIMD_TARGET_VALUE == SIMD_NONE
     return c;
 #else
@@ -468,7 +474,7 @@ static constexpr size_t kConvolveMaxRadius = 3;
 // For use by set_table_indices.
 static inline const int32_t* MirrorLanes(const size_t mod) {
   SIMD_NAMESPACE::Full<float> d;
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
   // last  part  mirrored
   // 01234567| 76543210   loadedReg 76543210 mirroredReg 01234567
   // 01234567|8 8765432   loadedReg 87654321 mirroredReg 23456788
@@ -1619,6 +1625,125 @@ class ConvolveT {
   }
 };
 
+// Row-streaming variant of ConvolveT for chaining filters without a full-image
+// pass per filter. Input rows are written to NextInputRow() in top to bottom
+// order and passed on via CommitRow(); each output row is computed as soon as
+// its kRadius lower neighbors have arrived, directly into the next input row of
+// "Sink". Only a ring buffer of 2 * kRadius + 2 input rows is retained, so
+// chains such as ConvolveStream<A, KA, ConvolveStream<B, KB, ImageRowSink>>
+// keep the working set of all stages in cache. The result is the same as
+// ConvolveT with BorderNeverUsed (mirrored borders). Not thread-safe; callers
+// can instead run independent chains per plane.
+template <class Strategy, class Kernel, class Sink>
+class ConvolveStream {
+  static constexpr int64_t kRadius = Strategy::kRadius;
+  // One more than the kernel height because NextInputRow is called before
+  // CommitRow produces the output row that still needs the oldest row.
+  static constexpr size_t kRingRows = 2 * kRadius + 2;
+
+ public:
+  // "sink" must accept ysize rows of xsize pixels and outlive this object.
+  ConvolveStream(const size_t xsize, const size_t ysize, const Kernel& kernel,
+                 Sink* sink)
+      : xsize_(xsize),
+        ysize_(ysize),
+        kernel_(kernel),
+        sink_(sink),
+        ring_(xsize, kRingRows),
+        stride_(ring_.bytes_per_row() / sizeof(float)) {
+    PIK_CHECK(xsize >= kConvolveMinWidth);  // For LeftRightInvalid.
+    PIK_CHECK(ysize > kRadius);             // Single mirroring.
+  }
+
+  // Returns where to store the next input row (xsize pixels).
+  float* PIK_RESTRICT NextInputRow() {
+    PIK_ASSERT(num_in_ < ysize_);
+    return ring_.Row(num_in_ % kRingRows);
+  }
+
+  // Produces all output rows that do not depend on later input rows.
+  void CommitRow() {
+    ++num_in_;
+    // Output row y requires input rows up to y + kRadius (or the last).
+    size_t num_ready = ysize_;
+    if (num_in_ != ysize_) {
+      num_ready = (num_in_ > kRadius) ? num_in_ - kRadius : 0;
+    }
+    for (; num_out_ < num_ready; ++num_out_) {
+      ProduceRow(num_out_);
+    }
+  }
+
+ private:
+  // Maps neighbor rows of ring row "y" to the ring rows holding their
+  // (mirrored) image rows.
+  class WrapRowRing {
+   public:
+    WrapRowRing(const ImageF& ring, const float* row_m, const int64_t y,
+                const int64_t ysize)
+        : ring_(ring), row_m_(row_m), y_(y), ysize_(ysize) {}
+
+    const float* const PIK_RESTRICT
+    operator()(const float* const PIK_RESTRICT row,
+               const int64_t stride) const {
+      const int64_t offset = (row - row_m_) / stride;
+      return ring_.ConstRow(Mirror(y_ + offset, ysize_) % kRingRows);
+    }
+
+   private:
+    const ImageF& ring_;
+    const float* const row_m_;
+    const int64_t y_;
+    const int64_t ysize_;
+  };
+
+  void ProduceRow(const size_t y) {
+    const float* row_m = ring_.ConstRow(y % kRingRows);
+    const WrapRowRing wrap_row(ring_, row_m, y, ysize_);
+    float* PIK_RESTRICT row_out = sink_->NextInputRow();
+    switch (xsize_ % SIMD_NAMESPACE::Full<float>::N) {
+      case 0:
+        Strategy::template ConvolveRow<0>(LeftRightInvalid(), row_m, xsize_,
+                                          stride_, wrap_row, kernel_.Weights(),
+                                          row_out);
+        break;
+      case 1:
+        Strategy::template ConvolveRow<1>(LeftRightInvalid(), row_m, xsize_,
+                                          stride_, wrap_row, kernel_.Weights(),
+                                          row_out);
+        break;
+      default:  // Only need <= kRadius
+        Strategy::template ConvolveRow<2>(LeftRightInvalid(), row_m, xsize_,
+                                          stride_, wrap_row, kernel_.Weights(),
+                                          row_out);
+        break;
+    }
+    sink_->CommitRow();
+  }
+
+  const size_t xsize_;
+  const size_t ysize_;
+  const Kernel kernel_;
+  Sink* sink_;  // not owned
+  ImageF ring_;
+  const int64_t stride_;
+  size_t num_in_ = 0;
+  size_t num_out_ = 0;
+};
+
+// Last stage of a ConvolveStream chain: stores the rows in an image.
+class ImageRowSink {
+ public:
+  explicit ImageRowSink(ImageF* image) : image_(image) {}
+
+  float* PIK_RESTRICT NextInputRow() { return image_->Row(y_); }
+  void CommitRow() { ++y_; }
+
+ private:
+  ImageF* image_;  // not owned
+  size_t y_ = 0;
+};
+
 }  // namespace pik
 
 #endif  // CONVOLVE_H_
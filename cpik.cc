@@ -15,11 +15,21 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <future>  //NOLINT
+#include <memory>
+#include <string>
+#include <vector>
 
 #undef PROFILER_ENABLED
 #define PROFILER_ENABLED 1
 #include "arch_specific.h"
 #include "args.h"
+#include "cache_aligned.h"
+#include "common.h"
+#include "data_parallel.h"
+#include "encode_cache.h"
 #include "image.h"
 #include "image_io.h"
 #include "os_specific.h"
@@ -29,6 +39,7 @@
 #include "profiler.h"
 #include "simd/dispatch.h"
 #include "tsc_timer.h"
+#include "yuv_convert.h"
 
 namespace pik {
 namespace {
@@ -56,16 +67,62 @@ struct CompressArgs {
         const std::string arg = argv[i];
         if (arg == "--fast") {
           params.fast_mode = true;
+        } else if (arg == "--lossless") {
+          params.lossless = true;
         } else if (arg == "--denoise") {
           if (!ParseOverride(argc, argv, &i, &params.denoise)) return false;
         } else if (arg == "--noise") {
           if (!ParseOverride(argc, argv, &i, &params.apply_noise)) return false;
+        } else if (arg == "--grayscale") {
+          if (!ParseOverride(argc, argv, &i, &params.grayscale)) return false;
+        } else if (arg == "--palette") {
+          if (!ParseOverride(argc, argv, &i, &params.palette)) return false;
+        } else if (arg == "--pyramid") {
+          if (!ParseUnsigned(argc, argv, &i, &params.pyramid_levels)) {
+            return false;
+          }
+        } else if (arg == "--batch") {
+          if (i + 1 >= argc) {
+            fprintf(stderr, "Missing list filename after --batch.\n");
+            return false;
+          }
+          batch_list = argv[++i];
+        } else if (arg == "--encode_cache") {
+          if (i + 1 >= argc) {
+            fprintf(stderr, "Missing directory after --encode_cache.\n");
+            return false;
+          }
+          encode_cache = argv[++i];
+        } else if (arg == "--encode_cache_mb") {
+          if (!ParseUnsigned(argc, argv, &i, &encode_cache_mb)) return false;
+        } else if (arg == "--frames") {
+          frames = true;
+        } else if (arg == "--streaming") {
+          streaming = true;
         } else if (arg == "--num_threads") {
           if (!ParseUnsigned(argc, argv, &i, &num_threads)) return false;
+        } else if (arg == "--pin_threads") {
+          pin_threads = true;
+        } else if (arg == "--huge_pages") {
+          huge_pages = true;
         } else if (arg == "-v") {
           params.verbose = true;
         } else if (arg == "--print_profile") {
           if (!ParseOverride(argc, argv, &i, &print_profile)) return false;
+        } else if (arg == "--profile_samples") {
+          if (!ParseUnsigned(argc, argv, &i, &profile_samples)) return false;
+        } else if (arg == "--trace") {
+          if (i + 1 >= argc) {
+            fprintf(stderr, "Missing filename after --trace.\n");
+            return false;
+          }
+          trace = argv[++i];
+        } else if (arg == "--butteraugli_cache") {
+          if (i + 1 >= argc) {
+            fprintf(stderr, "Missing filename after --butteraugli_cache.\n");
+            return false;
+          }
+          params.butteraugli_reference_cache = argv[++i];
         } else if (arg == "--distance") {
           if (!ParseFloat(argc, argv, &i, &params.butteraugli_distance)) {
             return false;
@@ -79,6 +136,58 @@ struct CompressArgs {
           }
         } else if (arg == "--target_size") {
           if (!ParseUnsigned(argc, argv, &i, &params.target_size)) return false;
+        } else if (arg == "--effort") {
+          if (!ParseUnsigned(argc, argv, &i, &params.effort)) return false;
+          if (params.effort == 0 || params.effort > kMaxEffort) {
+            fprintf(stderr, "Invalid --effort, expected 1..%zu.\n",
+                    kMaxEffort);
+            return false;
+          }
+        } else if (arg == "--low_memory") {
+          params.low_memory = true;
+        } else if (arg == "--time_budget_ms") {
+          if (!ParseUnsigned(argc, argv, &i, &params.time_budget_ms)) {
+            return false;
+          }
+        } else if (arg == "--hq_candidates") {
+          if (!ParseUnsigned(argc, argv, &i, &params.hq_search_candidates)) {
+            return false;
+          }
+          if (params.hq_search_candidates == 0) {
+            fprintf(stderr, "Invalid --hq_candidates, expected >= 1.\n");
+            return false;
+          }
+        } else if (arg == "--ans_states") {
+          if (!ParseUnsigned(argc, argv, &i, &params.num_ans_states)) {
+            return false;
+          }
+          if (params.num_ans_states != 1 && params.num_ans_states != 2 &&
+              params.num_ans_states != 4) {
+            fprintf(stderr, "Invalid ANS state count '%s', try 1, 2 or 4.\n",
+                    argv[i]);
+            return false;
+          }
+        } else if (arg == "--static_histograms") {
+          params.static_histograms = true;
+        } else if (arg == "--jpeg_downscale") {
+          if (!ParseUnsigned(argc, argv, &i, &jpeg_downscale)) return false;
+          if (jpeg_downscale != 1 && jpeg_downscale != 2 &&
+              jpeg_downscale != 4 && jpeg_downscale != 8) {
+            fprintf(stderr, "Invalid JPEG downscale '%s', try 1, 2, 4 or 8.\n",
+                    argv[i]);
+            return false;
+          }
+        } else if (arg == "--group_size") {
+          size_t group_size;
+          if (!ParseUnsigned(argc, argv, &i, &group_size)) return false;
+          if (group_size != 128 && group_size != 256 && group_size != 512 &&
+              group_size != 1024) {
+            fprintf(stderr,
+                    "Invalid group size '%s', try 128, 256, 512 or 1024.\n",
+                    argv[i]);
+            return false;
+          }
+          params.group_size_in_tiles = group_size / kTileWidth;
         } else {
           // Unknown arg or --help: caller will print help string
           return false;
@@ -95,83 +204,568 @@ struct CompressArgs {
       }
     }
 
+    if (encode_cache != nullptr && (streaming || frames)) {
+      fprintf(stderr,
+              "--encode_cache does not support --streaming/--frames.\n");
+      return false;
+    }
+
+    if (jpeg_downscale != 1 && (streaming || frames)) {
+      fprintf(stderr,
+              "--jpeg_downscale does not support --streaming/--frames.\n");
+      return false;
+    }
+
+    if (batch_list != nullptr) {
+      if (streaming || frames) {
+        fprintf(stderr, "--batch does not support --streaming/--frames.\n");
+        return false;
+      }
+      if (file_in != nullptr) {
+        fprintf(stderr, "--batch does not accept in/out names.\n");
+        return false;
+      }
+      return true;
+    }
+
     if (file_in == nullptr) {
       fprintf(stderr, "Missing input filename.\n");
       return false;
     }
+    if (frames && (streaming || file_out == nullptr)) {
+      fprintf(stderr, "--frames requires an output name, not --streaming.\n");
+      return false;
+    }
 
     return true;
   }
 
   static const char* HelpFormatString() {
     return "Usage: %s in.png out.pik [--distance <maxError>] [--fast] "
-           "[--denoise <0,1>] [--noise <0,1>] [--num_threads <0..N>\n"
-           "[--print_profile <0,1>]\n"
+           "[--lossless] [--denoise <0,1>] [--noise <0,1>] "
+           "[--grayscale <0,1>] [--palette <0,1>] [--pyramid <0..4>]\n"
+           "[--num_threads <0..N>] "
+           "[--pin_threads] [--huge_pages] [--effort <1..9>] "
+           "[--time_budget_ms <ms>] [--low_memory] [--hq_candidates <N>] "
+           "[--print_profile <0,1>] [--profile_samples <N>] "
+           "[--trace <out.json>] "
+           "[--ans_states <1,2,4>] [--static_histograms] "
+           "[--group_size <128..1024>] [--jpeg_downscale <1,2,4,8>] "
+           "[--streaming] [--frames]\n"
+           "[--butteraugli_cache <file>] [--encode_cache <dir>] "
+           "[--encode_cache_mb <MB>]\n"
+           "   or: %s --batch <list.txt|-> [options]\n"
            " --distance: Max. butteraugli distance, lower = higher quality.\n"
            "             Good default: 1.0. Supported range: 0.5 .. 3.0.\n"
            " --fast: Use fast encoding, ignores distance.\n"
+           " --lossless: store 8-bit inputs exactly (e.g. screenshots);\n"
+           "             ignores distance.\n"
+           " --effort: 1 (fastest) .. 9 (smallest); selects a preset of\n"
+           "           encoder stages and overrides --fast. See\n"
+           "           ParamsForEffort in pik.h.\n"
+           " --time_budget_ms: stop the quantization search after this\n"
+           "                   many milliseconds (0 = no limit).\n"
+           " --low_memory: lower the peak memory use at the cost of speed.\n"
+           " --hq_candidates: quantization fields evaluated concurrently per\n"
+           "                  search iteration at distances <= 1.4 (default 1).\n"
            " --denoise: force enable/disable edge-preserving smoothing.\n"
            " --noise: force enable/disable noise generation.\n"
+           " --grayscale: force coding only luminance (1) or all planes (0);\n"
+           "              by default, gray inputs code only luminance\n"
+           "              (with --streaming, only if 1).\n"
+           " --palette: force coding 8-bit inputs with up to 256 colors as\n"
+           "            lossless palette indices (1) or never (0); by default,\n"
+           "            only inputs with up to 64 colors.\n"
+           " --pyramid: also store this many successively 4x smaller\n"
+           "            copies of the image for viewers (dpik --downscale).\n"
            " --num_threads: number of worker threads (zero = none).\n"
+           " --pin_threads: pin each worker thread to one CPU, filling NUMA\n"
+           "                nodes in order.\n"
+           " --huge_pages: back large images with transparent huge pages\n"
+           "               (Linux), which reduces page faults/TLB misses.\n"
            " --print_profile 1: print timing information before exiting.\n"
+           " --profile_samples: only record every N-th profiler zone and\n"
+           "                    print their sampled durations before\n"
+           "                    exiting (lower overhead than\n"
+           "                    --print_profile).\n"
+           " --trace: write a per-thread timeline of profiler zones in\n"
+           "          Chrome Trace Event format (chrome://tracing).\n"
+           " --butteraugli_cache: reuse the butteraugli analysis of the\n"
+           "                      input stored in this file by a previous\n"
+           "                      run (e.g. at another distance), or store\n"
+           "                      it there.\n"
+           " --encode_cache: reuse the output of previous encodes of the\n"
+           "                 same pixels with the same options, stored in\n"
+           "                 this (existing) directory. Not for --streaming\n"
+           "                 or --frames.\n"
+           " --encode_cache_mb: evict the least recently used entries of\n"
+           "                    --encode_cache beyond this size. Default: "
+           "1024.\n"
+           " --ans_states: interleaved ANS states per AC group (faster\n"
+           "               decoding, slightly larger files). Default: 1.\n"
+           " --static_histograms: code AC with built-in histograms where\n"
+           "                      possible (faster, slightly larger files);\n"
+           "                      intended for --fast.\n"
+           " --group_size: width and height of the independently coded\n"
+           "               groups (128, 256, 512 or 1024 pixels). By default,\n"
+           "               smaller if there would be fewer groups than\n"
+           "               threads, and larger for huge images.\n"
+           " --jpeg_downscale: encode JPEG inputs at 1/N of their size\n"
+           "                   (rounded up). They are decoded directly at\n"
+           "                   that size, which is much faster than\n"
+           "                   decoding all pixels. Other inputs fail.\n"
+           " --streaming: read and encode the image in bands of rows to\n"
+           "              bound memory; requires --fast and 8-bit PNM/PNG\n"
+           "              without alpha.\n"
+           " --frames: encode each frame of a Y4M input to out-00000.pik,\n"
+           "           out-00001.pik etc.; small frames are encoded in\n"
+           "           parallel, each by a single thread. With --lossless,\n"
+           "           writes a single multi-frame out.pik in which groups\n"
+           "           that equal the previous frame are skipped.\n"
+           " --batch: encode each 'in.png out.pik' line of the file (or of\n"
+           "          stdin if '-', e.g. from a long-running client) with one\n"
+           "          thread pool; prints 'ok|error out.pik' per line.\n"
            " --help: Show this help.\n";
   }
 
   const char* file_in = nullptr;
   const char* file_out = nullptr;
+  const char* batch_list = nullptr;
+  const char* trace = nullptr;
+  const char* encode_cache = nullptr;
+  size_t encode_cache_mb = 1024;
   CompressParams params;
   size_t num_threads = 4;
+  size_t jpeg_downscale = 1;
+  bool pin_threads = false;
+  bool huge_pages = false;
+  bool streaming = false;
+  bool frames = false;
   Override print_profile = Override::kDefault;
+  size_t profile_samples = 0;  // Sampling interval; 0 = disabled.
 };
 
-bool Compress(const CompressArgs& args, ThreadPool* pool,
-              PaddedBytes* compressed) {
-  MetaImageF in = ReadMetaImageLinear(args.file_in);
-  if (in.xsize() == 0 || in.ysize() == 0) {
-    fprintf(stderr, "Failed to open image %s.\n", args.file_in);
+// Loads "file_in" into "srgb" (8-bit inputs, skipping the linear image) or
+// "image", and returns whether it was the former. JPEGs are decoded at
+// 1/jpeg_downscale size; for other inputs, "jpeg_downscale" must be 1.
+// Failure leaves both images empty.
+bool LoadInput(const char* file_in, const size_t jpeg_downscale,
+               MetaImageB* srgb, MetaImageF* image) {
+  if (jpeg_downscale != 1 && !ImageFormatJPG::IsExtension(file_in)) {
+    fprintf(stderr, "--jpeg_downscale requires a JPEG input: %s.\n", file_in);
     return false;
   }
+  if (ReadMetaImageSrgb8(file_in, srgb, jpeg_downscale)) return true;
+  if (jpeg_downscale == 1) *image = ReadMetaImageLinear(file_in);
+  return false;
+}
 
-  if (args.params.target_size != 0 &&
-      args.params.butteraugli_distance != -1.0f) {
+bool ValidateParams(const CompressParams& params) {
+  if (params.target_size != 0 && params.butteraugli_distance != -1.0f) {
     fprintf(stderr,
             "Only one of --distance or --target_size can be specified.\n");
     return false;
   }
+  return true;
+}
 
+// Returns the cache for args.encode_cache, or null if none.
+std::unique_ptr<EncodeCache> MakeEncodeCache(const CompressArgs& args) {
+  if (args.encode_cache == nullptr) return nullptr;
+  return std::unique_ptr<EncodeCache>(new DiskLRUEncodeCache(
+      args.encode_cache, args.encode_cache_mb << 20));
+}
+
+// Returns the encoding time [seconds], or a negative value on failure.
+// "in" is MetaImageB (8-bit sRGB) or MetaImageF (linear). If "cache" is
+// non-null, a previous result is returned without encoding, or the result is
+// stored there. If "file" is non-null (only without cache), the result is
+// written there instead of "compressed".
+template <class MetaImage>
+double CompressImage(const CompressParams& params, const MetaImage& in,
+                     ThreadPool* pool, PikEncoder* encoder, EncodeCache* cache,
+                     PaddedBytes* compressed, PositionedFile* file = nullptr) {
   const size_t xsize = in.xsize();
   const size_t ysize = in.ysize();
+  EncodeCacheKey key;
+  if (cache != nullptr) {
+    const double t0 = Now();
+    // The default group size depends on the number of threads.
+    CompressParams key_params = params;
+    key_params.group_size_in_tiles =
+        GroupSizeForParams(params, xsize, ysize, pool);
+    key = ComputeEncodeCacheKey(key_params, in);
+    if (cache->Lookup(key, compressed)) {
+      fprintf(stderr, "Reused %zu bytes for %zu x %zu pixels from cache.\n",
+              compressed->size(), xsize, ysize);
+      return Now() - t0;
+    }
+  }
+
   fprintf(stderr, "Compressing %zu x %zu pixels ", xsize, ysize);
-  if (args.params.fast_mode) {
+  if (params.lossless) {
+    fprintf(stderr, "losslessly");
+  } else if (params.fast_mode) {
     fprintf(stderr, "with fast mode");
-  } else if (args.params.target_size != 0) {
-    fprintf(stderr, "to target size %zd", args.params.target_size);
+  } else if (params.target_size != 0) {
+    fprintf(stderr, "to target size %zd", params.target_size);
   } else {
     fprintf(stderr, "with maximum Butteraugli distance %f",
-            args.params.butteraugli_distance);
+            params.butteraugli_distance);
   }
-  printf(", %zu threads.\n", pool->NumThreads());
+  fprintf(stderr, ", %zu threads.\n", pool->NumThreads());
 
   PikInfo aux_out;
   const uint64_t t0 = Start<uint64_t>();
-  if (!PixelsToPik(args.params, in, pool, compressed, &aux_out)) {
+  uint64_t size;
+  const bool ok =
+      file != nullptr
+          ? PixelsToPik(params, in, pool, file, &size, &aux_out)
+          : encoder->Encode(params, in, pool, compressed, &aux_out);
+  if (!ok) {
     fprintf(stderr, "Failed to compress.\n");
-    return false;
+    return -1.0;
   }
+  if (file == nullptr) size = compressed->size();
   const uint64_t t1 = Stop<uint64_t>();
   const double elapsed = (t1 - t0) / InvariantTicksPerSecond();
   // TODO(janwas): account for 8 vs 16-bit input
   const size_t bytes = xsize * ysize * (in.HasAlpha() ? 4 : 3);
-  fprintf(stderr, "Compressed to %zu bytes (%.2f MB/s).\n", compressed->size(),
-          bytes * 1E-6 / elapsed);
+  fprintf(stderr, "Compressed to %zu bytes (%.2f MB/s).\n",
+          static_cast<size_t>(size), bytes * 1E-6 / elapsed);
 
-  if (args.params.verbose) {
+  if (params.verbose) {
     aux_out.Print(1);
+    printf("Peak allocated: %.2f MiB\n",
+           AllocationStats::PeakBytes() / (1024.0 * 1024));
   }
 
+  if (cache != nullptr) cache->Insert(key, *compressed);
+  return elapsed;
+}
+
+// Encodes bands of rows as they are read, so the input image is never held
+// in memory. Returns false if the input or params are unsupported. Writes to
+// "file" instead of "compressed" if non-null.
+bool CompressStreaming(const CompressArgs& args, ThreadPool* pool,
+                       PaddedBytes* compressed, PositionedFile* file) {
+  Srgb8RowReader reader;
+  if (!reader.Open(args.file_in)) {
+    fprintf(stderr, "Failed to open %s for streaming (8-bit PNM/PNG).\n",
+            args.file_in);
+    return false;
+  }
+  const size_t xsize = reader.xsize();
+  const size_t ysize = reader.ysize();
+  fprintf(stderr, "Streaming %zu x %zu pixels, %zu threads.\n", xsize, ysize,
+          pool->NumThreads());
+
+  PikStreamingEncoder encoder;
+  if (!encoder.Init(args.params, xsize, ysize, pool)) {
+    fprintf(stderr, "Parameters not supported by the streaming encoder.\n");
+    return false;
+  }
+
+  const size_t kRowsPerBand = 512;
+  PikInfo aux_out;
+  const uint64_t t0 = Start<uint64_t>();
+  Image3B rows;
+  while (reader.RemainingRows() != 0) {
+    if (!reader.ReadRows(kRowsPerBand, &rows) || !encoder.AddRows(rows)) {
+      fprintf(stderr, "Failed to compress.\n");
+      return false;
+    }
+  }
+  uint64_t size;
+  const bool ok = file != nullptr ? encoder.Finish(file, &size, &aux_out)
+                                  : encoder.Finish(compressed, &aux_out);
+  if (!ok) {
+    fprintf(stderr, "Failed to compress.\n");
+    return false;
+  }
+  if (file == nullptr) size = compressed->size();
+  const uint64_t t1 = Stop<uint64_t>();
+  const double elapsed = (t1 - t0) / InvariantTicksPerSecond();
+  fprintf(stderr, "Compressed to %zu bytes (%.2f MB/s).\n",
+          static_cast<size_t>(size), xsize * ysize * 3 * 1E-6 / elapsed);
+
+  if (args.params.verbose) {
+    aux_out.Print(1);
+    printf("Peak allocated: %.2f MiB\n",
+           AllocationStats::PeakBytes() / (1024.0 * 1024));
+  }
   return true;
 }
 
+// Writes to "file" instead of "compressed" if non-null (not with
+// --encode_cache).
+bool Compress(const CompressArgs& args, ThreadPool* pool,
+              PaddedBytes* compressed, PositionedFile* file = nullptr) {
+  if (args.streaming) {
+    if (!ValidateParams(args.params)) return false;
+    return CompressStreaming(args, pool, compressed, file);
+  }
+
+  // 8-bit inputs are converted to opsin directly, skipping the linear image.
+  MetaImageB srgb;
+  MetaImageF in;
+  const bool is_srgb8 =
+      LoadInput(args.file_in, args.jpeg_downscale, &srgb, &in);
+  const size_t xsize = is_srgb8 ? srgb.xsize() : in.xsize();
+  const size_t ysize = is_srgb8 ? srgb.ysize() : in.ysize();
+  if (xsize == 0 || ysize == 0) {
+    fprintf(stderr, "Failed to open image %s.\n", args.file_in);
+    return false;
+  }
+
+  if (!ValidateParams(args.params)) return false;
+
+  PikEncoder encoder;
+  const std::unique_ptr<EncodeCache> cache = MakeEncodeCache(args);
+  const double elapsed =
+      is_srgb8 ? CompressImage(args.params, srgb, pool, &encoder, cache.get(),
+                               compressed, file)
+               : CompressImage(args.params, in, pool, &encoder, cache.get(),
+                               compressed, file);
+  return elapsed >= 0.0;
+}
+
+// Returns "pathname" with "-<frame>" inserted before the extension (if any).
+std::string FrameFilename(const std::string& pathname, const size_t frame) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "-%05zu", frame);
+  const size_t slash = pathname.find_last_of('/');
+  const size_t dot = pathname.find_last_of('.');
+  const size_t pos = (dot == std::string::npos ||
+                      (slash != std::string::npos && dot < slash))
+                         ? pathname.size()
+                         : dot;
+  return pathname.substr(0, pos) + suffix + pathname.substr(pos);
+}
+
+// Encodes all frames of a Y4M stream losslessly into a single multi-frame
+// file (see PixelsToPikFrame). Frames depend on their predecessor, so they
+// are encoded in order, each by all threads.
+bool CompressFramesLossless(const CompressArgs& args, ThreadPool* pool) {
+  Y4MFrameReader reader;
+  if (!reader.Open(args.file_in)) {
+    fprintf(stderr, "Failed to open Y4M %s.\n", args.file_in);
+    return false;
+  }
+  fprintf(stderr, "Encoding %zu x %zu frames losslessly.\n", reader.xsize(),
+          reader.ysize());
+
+  PaddedBytes compressed;
+  Image3U yuv;
+  MetaImageB frames[2];  // Current and previous.
+  size_t num_frames = 0;
+  const double t0 = Now();
+  while (!reader.AtEnd()) {
+    if (!reader.ReadFrame(pool, &yuv)) {
+      fprintf(stderr, "Failed to read frame %zu.\n", num_frames);
+      return false;
+    }
+    MetaImageB& frame = frames[num_frames & 1];
+    frame.SetColor(RGB8ImageFromYUVRec709(yuv, reader.bit_depth(), pool));
+    const MetaImageB* previous =
+        num_frames == 0 ? nullptr : &frames[(num_frames - 1) & 1];
+    if (!PixelsToPikFrame(args.params, frame, previous, pool, &compressed)) {
+      fprintf(stderr, "Failed to compress frame %zu.\n", num_frames);
+      return false;
+    }
+    ++num_frames;
+  }
+  const double elapsed = Now() - t0;
+  fprintf(stderr, "Encoded %zu frames to %zu bytes in %.2f s: %.2f fps.\n",
+          num_frames, compressed.size(), elapsed,
+          num_frames / std::max(elapsed, 1E-9));
+  return num_frames != 0 && WriteFile(compressed, args.file_out);
+}
+
+// Encodes all frames of a Y4M stream to separate files. Unless frames have
+// enough groups to occupy all threads, each worker encodes one frame at a time
+// without further parallelism, which scales better than splitting a (small)
+// frame across all threads. Up to one frame per worker is held in memory;
+// frames are read (and chroma-upsampled) in between.
+bool CompressFrames(const CompressArgs& args, ThreadPool* pool) {
+  if (!ValidateParams(args.params)) return false;
+  if (args.params.lossless) return CompressFramesLossless(args, pool);
+
+  Y4MFrameReader reader;
+  if (!reader.Open(args.file_in)) {
+    fprintf(stderr, "Failed to open Y4M %s.\n", args.file_in);
+    return false;
+  }
+  const size_t group_width = kGroupWidthInBlocks * kBlockWidth;
+  const size_t group_height = kGroupHeightInBlocks * kBlockHeight;
+  const size_t groups_per_frame =
+      DivCeil(reader.xsize(), group_width) *
+      DivCeil(reader.ysize(), group_height);
+  const bool across_frames = ParallelizeAcrossImages(*pool, groups_per_frame);
+  const size_t num_workers =
+      across_frames ? std::max<size_t>(1, pool->NumThreads()) : 1;
+  fprintf(stderr, "Encoding %zu x %zu frames, %zu in parallel.\n",
+          reader.xsize(), reader.ysize(), num_workers);
+
+  // Per worker; reused across frames.
+  std::vector<PikEncoder> encoders(num_workers);
+  std::vector<PaddedBytes> compressed(num_workers);
+
+  std::vector<Image3U> yuv(num_workers);
+  std::vector<int> ok(num_workers);
+  size_t num_frames = 0;
+  size_t num_failed = 0;
+  const double t0 = Now();
+  while (!reader.AtEnd()) {
+    size_t num_read = 0;
+    while (num_read < num_workers && !reader.AtEnd()) {
+      if (!reader.ReadFrame(pool, &yuv[num_read])) {
+        fprintf(stderr, "Failed to read frame %zu.\n", num_frames + num_read);
+        return false;
+      }
+      ++num_read;
+    }
+
+    RunImages(pool, num_read, across_frames,
+              [&](const size_t task, const int thread, ThreadPool* frame_pool) {
+                const Image3F linear = RGBLinearImageFromYUVRec709(
+                    yuv[task], reader.bit_depth(), frame_pool);
+                yuv[task] = Image3U();
+                const std::string filename =
+                    FrameFilename(args.file_out, num_frames + task);
+                ok[task] = encoders[thread].Encode(args.params, linear,
+                                                   frame_pool,
+                                                   &compressed[thread]) &&
+                           WriteFile(compressed[thread], filename.c_str());
+              });
+
+    for (size_t i = 0; i < num_read; ++i) {
+      if (!ok[i]) {
+        fprintf(stderr, "Failed to compress frame %zu.\n", num_frames + i);
+        ++num_failed;
+      }
+    }
+    num_frames += num_read;
+  }
+  const double elapsed = Now() - t0;
+  fprintf(stderr, "Encoded %zu frames (%zu failed) in %.2f s: %.2f fps.\n",
+          num_frames, num_failed, elapsed,
+          num_frames / std::max(elapsed, 1E-9));
+  return num_frames != 0 && num_failed == 0;
+}
+
+// One line of the --batch list, and its image once loaded.
+struct BatchJob {
+  bool valid = false;  // False at the end of the list.
+  std::string file_in;
+  std::string file_out;
+  // 8-bit inputs are loaded into srgb (skipping the linear image), others
+  // into image.
+  bool is_srgb8 = false;
+  MetaImageB srgb;
+  MetaImageF image;
+
+  size_t xsize() const { return is_srgb8 ? srgb.xsize() : image.xsize(); }
+  size_t ysize() const { return is_srgb8 ? srgb.ysize() : image.ysize(); }
+};
+
+// Reads the next non-empty line from "list" and loads its input image (which
+// may fail, see image.xsize). Blocks until a line is available, so a client
+// can keep "list" (e.g. stdin) open and submit jobs over time.
+BatchJob LoadNextJob(FILE* list, const size_t jpeg_downscale) {
+  BatchJob job;
+  char line[4096];
+  while (fgets(line, sizeof(line), list) != nullptr) {
+    const char* in = strtok(line, " \t\r\n");
+    if (in == nullptr) continue;  // Empty line.
+    const char* out = strtok(nullptr, " \t\r\n");
+    job.valid = true;
+    job.file_in = in;
+    job.file_out = out == nullptr ? "" : out;
+    if (out != nullptr) {
+      job.is_srgb8 = LoadInput(job.file_in.c_str(), jpeg_downscale, &job.srgb,
+                               &job.image);
+    }
+    break;
+  }
+  return job;
+}
+
+// Encodes all jobs with a single ThreadPool and PikEncoder. Loading the next
+// image (including decoding its PNG) happens on another thread while the
+// current one is encoded, and writing is cheap by comparison.
+bool CompressBatch(const CompressArgs& args, ThreadPool* pool) {
+  if (!ValidateParams(args.params)) return false;
+
+  const bool from_stdin = strcmp(args.batch_list, "-") == 0;
+  FILE* list = from_stdin ? stdin : fopen(args.batch_list, "r");
+  if (list == nullptr) {
+    fprintf(stderr, "Failed to open %s.\n", args.batch_list);
+    return false;
+  }
+
+  PikEncoder encoder;
+  const std::unique_ptr<EncodeCache> cache = MakeEncodeCache(args);
+  PaddedBytes compressed;
+  size_t num_ok = 0;
+  size_t num_failed = 0;
+  size_t total_pixels = 0;
+  double total_encode = 0.0;
+  const double t0 = Now();
+
+  std::future<BatchJob> next = std::async(std::launch::async, LoadNextJob,
+                                          list, args.jpeg_downscale);
+  for (;;) {
+    BatchJob job = next.get();
+    if (!job.valid) break;
+    next = std::async(std::launch::async, LoadNextJob, list,
+                      args.jpeg_downscale);
+
+    bool ok = false;
+    if (job.file_out.empty()) {
+      fprintf(stderr, "Missing output filename for %s.\n",
+              job.file_in.c_str());
+    } else if (job.xsize() == 0 || job.ysize() == 0) {
+      fprintf(stderr, "Failed to open image %s.\n", job.file_in.c_str());
+    } else {
+      const double elapsed =
+          job.is_srgb8
+              ? CompressImage(args.params, job.srgb, pool, &encoder,
+                              cache.get(), &compressed)
+              : CompressImage(args.params, job.image, pool, &encoder,
+                              cache.get(), &compressed);
+      if (elapsed >= 0.0 && WriteFile(compressed, job.file_out.c_str())) {
+        ok = true;
+        total_pixels += job.xsize() * job.ysize();
+        total_encode += elapsed;
+      }
+    }
+    // Allows clients to wait for each result.
+    printf("%s %s\n", ok ? "ok" : "error",
+           job.file_out.empty() ? job.file_in.c_str() : job.file_out.c_str());
+    fflush(stdout);
+    (ok ? num_ok : num_failed) += 1;
+  }
+
+  if (!from_stdin) fclose(list);
+  const double elapsed = Now() - t0;
+  fprintf(stderr,
+          "Batch: %zu images (%zu failed), %.2f MP in %.2f s: "
+          "%.2f MP/s encode, %.2f MP/s including I/O.\n",
+          num_ok + num_failed, num_failed, total_pixels * 1E-6, elapsed,
+          total_pixels * 1E-6 / std::max(total_encode, 1E-9),
+          total_pixels * 1E-6 / std::max(elapsed, 1E-9));
+  if (cache != nullptr) cache->Stats().Print();
+  return num_failed == 0;
+}
+
+// Before any (large) allocation.
+void SetHugePageOptions() {
+  AllocationOptions options;
+  options.huge_page_threshold = 2 * kHugePageSize;
+  CacheAligned::SetOptions(options);
+}
+
 void InitThreads(ThreadPool* pool) {
   // Warm up profiler on main AND worker threads so its expensive initialization
   // doesn't count towards the timer measurements below for encode throughput.
@@ -191,25 +785,67 @@ int CompressAndWrite(int argc, char** argv) {
     fprintf(stderr, "Cannot continue because CPU lacks SSE4 support.\n");
     return 1;
   }
+#elif SIMD_ENABLE_SVE256
+  if ((dispatch::SupportedTargets() & SIMD_SVE256) == 0) {
+    fprintf(stderr,
+            "Cannot continue because CPU lacks 256-bit SVE support.\n");
+    return 1;
+  }
 #endif
 
   CompressArgs args;
   if (!args.Init(argc, argv)) {
-    fprintf(stderr, CompressArgs::HelpFormatString(), argv[0]);
+    fprintf(stderr, CompressArgs::HelpFormatString(), argv[0], argv[0]);
     return 1;
   }
+  if (args.huge_pages) SetHugePageOptions();
 
-  ThreadPool pool(static_cast<int>(args.num_threads));
+  ThreadPool pool(static_cast<int>(args.num_threads),
+                  args.pin_threads ? CPUsForThreads(args.num_threads)
+                                   : std::vector<int>());
   InitThreads(&pool);
+  if (args.trace != nullptr) PROFILER_ENABLE_TRACE();
+  if (args.profile_samples != 0) {
+    PROFILER_SET_SAMPLING(static_cast<uint32_t>(args.profile_samples),
+                          /*top_level_only=*/false);
+  }
 
-  PaddedBytes compressed;
-  if (!Compress(args, &pool, &compressed)) return 1;
+  if (args.batch_list != nullptr) {
+    if (!CompressBatch(args, &pool)) return 1;
+  } else if (args.frames) {
+    if (!CompressFrames(args, &pool)) return 1;
+  } else if (args.encode_cache == nullptr && args.file_out != nullptr) {
+    // The encoder writes the groups at their offsets, so the file is never
+    // concatenated in memory.
+    PositionedFile file;
+    if (!file.Open(args.file_out)) {
+      fprintf(stderr, "Failed to open %s.\n", args.file_out);
+      return 1;
+    }
+    if (!Compress(args, &pool, nullptr, &file)) {
+      (void)file.Close();
+      remove(args.file_out);
+      return 1;
+    }
+    if (!file.Close()) {
+      fprintf(stderr, "I/O error while writing %s.\n", args.file_out);
+      return 1;
+    }
+  } else {
+    PaddedBytes compressed;
+    if (!Compress(args, &pool, &compressed)) return 1;
 
-  if (!WriteFile(compressed, args.file_out)) return 1;
+    if (!WriteFile(compressed, args.file_out)) return 1;
+  }
 
+  if (args.trace != nullptr && !PROFILER_WRITE_TRACE(args.trace)) {
+    fprintf(stderr, "Failed to write %s.\n", args.trace);
+    return 1;
+  }
   if (args.print_profile == Override::kOn) {
     PROFILER_PRINT_RESULTS();
   }
+  if (args.profile_samples != 0) PROFILER_PRINT_SAMPLES();
   return 0;
 }
 
@@ -0,0 +1,154 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cuts a group-aligned rectangle out of a .pik file without re-encoding.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "args.h"
+#include "data_parallel.h"
+#include "header.h"
+#include "image.h"
+#include "os_specific.h"
+#include "padded_bytes.h"
+#include "pik.h"
+#include "tsc_timer.h"
+
+namespace pik {
+namespace {
+
+struct CropArgs {
+  bool Init(int argc, char** argv) {
+    bool have_rect = false;
+    for (int i = 1; i < argc; i++) {
+      if (argv[i][0] == '-') {
+        if (strcmp(argv[i], "--rect") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &x0) ||
+              !ParseUnsigned(argc, argv, &i, &y0) ||
+              !ParseUnsigned(argc, argv, &i, &xsize) ||
+              !ParseUnsigned(argc, argv, &i, &ysize)) {
+            return false;
+          }
+          have_rect = true;
+        } else if (strcmp(argv[i], "--num_threads") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &num_threads)) return false;
+        } else {
+          fprintf(stderr, "Unrecognized argument: %s.\n", argv[i]);
+          return false;
+        }
+      } else if (file_in == nullptr) {
+        file_in = argv[i];
+      } else if (file_out == nullptr) {
+        file_out = argv[i];
+      } else {
+        fprintf(stderr, "Extra argument: %s.\n", argv[i]);
+        return false;
+      }
+    }
+
+    if (file_in == nullptr || file_out == nullptr) {
+      fprintf(stderr, "Missing input or output filename.\n");
+      return false;
+    }
+    if (!have_rect) {
+      fprintf(stderr, "Missing --rect.\n");
+      return false;
+    }
+    return true;
+  }
+
+  static const char* HelpFormatString() {
+    return "Usage: %s --rect X0 Y0 XSIZE YSIZE [--num_threads N]\n"
+           "  in.pik out.pik\n"
+           "  Copies the pixels within the rectangle (clamped to the image)\n"
+           "  to out.pik without decoding. X0 and Y0 must be multiples of\n"
+           "  the group size stored in in.pik (128 to 1024, printed on\n"
+           "  failure), and so must XSIZE and YSIZE unless the rectangle\n"
+           "  extends to the right or bottom border.\n";
+  }
+
+  const char* file_in = nullptr;
+  const char* file_out = nullptr;
+  size_t x0 = 0;
+  size_t y0 = 0;
+  size_t xsize = 0;
+  size_t ysize = 0;
+  size_t num_threads = 4;
+};
+
+bool WriteFile(const PaddedBytes& bytes, const char* pathname) {
+  FILE* f = fopen(pathname, "wb");
+  if (f == nullptr) {
+    fprintf(stderr, "Failed to open %s.\n", pathname);
+    return false;
+  }
+  const size_t bytes_written = fwrite(bytes.data(), 1, bytes.size(), f);
+  if (fclose(f) != 0 || bytes_written != bytes.size()) {
+    fprintf(stderr, "Failed to write %s.\n", pathname);
+    return false;
+  }
+  return true;
+}
+
+int Run(int argc, char* argv[]) {
+  CropArgs args;
+  if (!args.Init(argc, argv)) {
+    fprintf(stderr, CropArgs::HelpFormatString(), argv[0]);
+    return 1;
+  }
+
+  MappedFile file;
+  if (!file.Open(args.file_in)) {
+    fprintf(stderr, "Failed to open %s.\n", args.file_in);
+    return 1;
+  }
+  const PaddedBytes compressed = PaddedBytes::View(file.data(), file.size());
+  PikBasicInfo info;
+  if (!PikProbe(compressed.data(), compressed.size(), &info)) {
+    fprintf(stderr, "Failed to read the header of %s.\n", args.file_in);
+    return 1;
+  }
+  if (info.bitstream != Header::kBitstreamDefault) {
+    fprintf(stderr, "%s is not a default bitstream and cannot be cropped.\n",
+            args.file_in);
+    return 1;
+  }
+
+  ThreadPool pool(static_cast<int>(args.num_threads));
+  PaddedBytes cropped;
+  const uint64_t t0 = Start<uint64_t>();
+  if (!PikCrop(compressed, Rect(args.x0, args.y0, args.xsize, args.ysize),
+               &pool, &cropped)) {
+    fprintf(stderr,
+            "Failed to crop %s (%u x %u pixels, groups of %u x %u). X0 and "
+            "Y0 must be multiples of %u, and so must XSIZE and YSIZE unless "
+            "the rectangle extends to the right or bottom border.\n",
+            args.file_in, info.xsize, info.ysize, info.group_size,
+            info.group_size, info.group_size);
+    return 1;
+  }
+  const uint64_t t1 = Stop<uint64_t>();
+  const double elapsed = (t1 - t0) / InvariantTicksPerSecond();
+  fprintf(stderr, "Cropped %zu to %zu bytes (%.2f MB/s).\n", compressed.size(),
+          cropped.size(), cropped.size() * 1E-6 / elapsed);
+
+  return WriteFile(cropped, args.file_out) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace pik
+
+int main(int argc, char* argv[]) { return pik::Run(argc, argv); }
@@ -0,0 +1,304 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "data_parallel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>  // _mm_pause
+#endif
+
+namespace pik {
+
+ThreadPool::ThreadPool(const int num_threads, const std::vector<int>& cpus)
+    : num_threads_(num_threads) {
+  DATA_PARALLEL_CHECK(num_threads >= 0);
+  DATA_PARALLEL_CHECK(num_threads <= kMaxThreads);
+  threads_.reserve(num_threads);
+
+  for (int i = 0; i < num_threads; ++i) {
+    const int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+    threads_.emplace_back(ThreadFunc, this, i, cpu);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  exit_.store(true);
+  WakeWorkers();
+
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Pause(const int iteration) {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+  _mm_pause();
+#endif
+  if ((iteration & 7) == 7) std::this_thread::yield();
+}
+
+int ThreadPool::AddJob(Job* job) {
+  // Before the job becomes visible, see FindAndRunTasks.
+  num_active_[job->priority].fetch_add(1);
+  for (int i = 0; i < kMaxJobs; ++i) {
+    Job* expected = nullptr;
+    if (slots_[i].job.load(std::memory_order_relaxed) == nullptr &&
+        slots_[i].job.compare_exchange_strong(expected, job)) {
+      WakeWorkers();
+      return i;
+    }
+  }
+  num_active_[job->priority].fetch_sub(1);
+  return -1;
+}
+
+void ThreadPool::RemoveJob(const int slot) {
+  Job* job = slots_[slot].job.load(std::memory_order_relaxed);
+  // seq_cst: see FindAndRunTasks.
+  slots_[slot].job.store(nullptr);
+  for (int i = 0; slots_[slot].num_users.load() != 0; ++i) {
+    Pause(i);
+  }
+  num_active_[job->priority].fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::WakeWorkers() {
+  // seq_cst: must not be reordered with the subsequent load of
+  // num_sleeping_, see WaitForEpoch.
+  epoch_.fetch_add(1);
+  if (num_sleeping_.load() != 0) {
+    // Workers could be between checking epoch_ and waiting; acquiring the
+    // mutex ensures they are now waiting and will receive the notification.
+    mutex_.lock();
+    mutex_.unlock();
+    worker_start_cv_.notify_all();
+  }
+}
+
+uint32_t ThreadPool::WaitForEpoch(const uint32_t prev_epoch) {
+  for (int i = 0; i < kSpinIterations; ++i) {
+    const uint32_t epoch = epoch_.load(std::memory_order_acquire);
+    if (epoch != prev_epoch) return epoch;
+    Pause(i);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  num_sleeping_.fetch_add(1);
+  uint32_t epoch;
+  while ((epoch = epoch_.load()) == prev_epoch) {
+    worker_start_cv_.wait(lock);
+  }
+  num_sleeping_.fetch_sub(1, std::memory_order_relaxed);
+  return epoch;
+}
+
+void ThreadPool::WaitForJob(Job* job) {
+  for (int i = 0; i < kSpinIterations; ++i) {
+    if (job->num_finished.load(std::memory_order_acquire) == job->num_tasks) {
+      return;
+    }
+    Pause(i);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  job->caller_sleeping.store(true);
+  while (job->num_finished.load() != job->num_tasks) {
+    job_done_cv_.wait(lock);
+  }
+}
+
+void ThreadPool::ReportFinished(Job* job, const uint32_t num_tasks) {
+  if (job->num_finished.fetch_add(num_tasks) + num_tasks == job->num_tasks &&
+      job->caller_sleeping.load()) {
+    mutex_.lock();
+    mutex_.unlock();
+    job_done_cv_.notify_all();
+  }
+}
+
+bool ThreadPool::ReserveOwn(Job* job, const int thread,
+                            uint32_t* PIK_RESTRICT my_begin,
+                            uint32_t* PIK_RESTRICT my_end) const {
+  std::atomic<uint64_t>& packed = job->ranges[thread].packed;
+  uint64_t range = packed.load(std::memory_order_relaxed);
+  for (;;) {
+    const uint32_t next = Next(range);
+    const uint32_t end = End(range);
+    if (next >= end) return false;
+    const uint32_t remaining = end - next;
+    const uint32_t guided = std::max(remaining / 4, 1u);
+    const uint32_t chunk = chunk_size_ == 0 ? guided : chunk_size_;
+    const uint32_t size = std::min(chunk, remaining);
+    if (packed.compare_exchange_weak(range, Pack(next + size, end))) {
+      *my_begin = next;
+      *my_end = next + size;
+      return true;
+    }
+  }
+}
+
+bool ThreadPool::Steal(Job* job, const int thread) const {
+  const int num_threads = static_cast<int>(num_threads_);
+  for (int i = 1; i < num_threads; ++i) {
+    int victim = thread + i;
+    if (victim >= num_threads) victim -= num_threads;
+    std::atomic<uint64_t>& packed = job->ranges[victim].packed;
+    uint64_t range = packed.load(std::memory_order_relaxed);
+    for (;;) {
+      const uint32_t next = Next(range);
+      const uint32_t end = End(range);
+      if (next >= end) break;  // try the next victim
+      const uint32_t mid = end - (end - next + 1) / 2;
+      if (packed.compare_exchange_weak(range, Pack(next, mid))) {
+        job->ranges[thread].packed.store(Pack(mid, end),
+                                         std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Unreserve(Job* job, const int thread, const uint32_t begin) {
+  std::atomic<uint64_t>& packed = job->ranges[thread].packed;
+  uint64_t range = packed.load(std::memory_order_relaxed);
+  while (!packed.compare_exchange_weak(range, Pack(begin, End(range)))) {
+  }
+}
+
+bool ThreadPool::ShouldYield(const Job& job, const uint32_t epoch) const {
+  if (epoch_.load(std::memory_order_relaxed) == epoch) return false;
+  for (int priority = job.priority + 1; priority < RunPolicy::kNumPriorities;
+       ++priority) {
+    if (num_active_[priority].load(std::memory_order_relaxed) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::RunTasks(Job* job, const int thread, const bool preemptible,
+                          const uint32_t epoch) {
+  // Nested Runs called by the tasks inherit the job's policy.
+  RunPolicy*& current_policy = CurrentPolicy();
+  RunPolicy* const prev_policy = current_policy;
+  current_policy = job->policy;
+
+  bool any = false;
+  bool yield = false;
+  uint32_t my_begin, my_end;
+  while (!yield) {
+    while (!yield && ReserveOwn(job, thread, &my_begin, &my_end)) {
+      uint32_t task = my_begin;
+      while (task < my_end) {
+        if (job->once) {
+          job->func(job->arg, thread, thread);
+        } else {
+          job->func(job->arg, static_cast<int>(task), thread);
+        }
+        ++task;
+        if (preemptible && ShouldYield(*job, epoch)) {
+          yield = true;
+          break;
+        }
+      }
+      if (task != my_end) Unreserve(job, thread, task);
+      ReportFinished(job, task - my_begin);
+      any = true;
+    }
+    if (yield || job->once || !Steal(job, thread)) break;
+  }
+
+  current_policy = prev_policy;
+  return any;
+}
+
+bool ThreadPool::Join(Job* job, const int thread) {
+  if (job->once) return true;
+  std::atomic<uint64_t>& joined = job->joined[thread / 64];
+  const uint64_t bit = 1ULL << (thread % 64);
+  if (joined.load(std::memory_order_relaxed) & bit) return true;
+  if (job->num_joined.load(std::memory_order_relaxed) >=
+      job->max_participants) {
+    return false;
+  }
+  if (job->num_joined.fetch_add(1, std::memory_order_relaxed) >=
+      job->max_participants) {
+    return false;
+  }
+  joined.fetch_or(bit, std::memory_order_relaxed);
+  return true;
+}
+
+bool ThreadPool::AcquireThread(RunPolicy* policy) {
+  if (policy == nullptr || policy->max_threads == 0) return true;
+  uint32_t busy = policy->num_busy.load(std::memory_order_relaxed);
+  do {
+    if (busy >= policy->max_threads) return false;
+  } while (!policy->num_busy.compare_exchange_weak(busy, busy + 1));
+  return true;
+}
+
+void ThreadPool::ReleaseThread(RunPolicy* policy) {
+  if (policy == nullptr || policy->max_threads == 0) return;
+  policy->num_busy.fetch_sub(1, std::memory_order_release);
+}
+
+bool ThreadPool::FindAndRunTasks(const int thread, const uint32_t epoch) {
+  // Jobs of equal priority (e.g. from concurrent requests) are searched
+  // starting at a slot that differs per worker and epoch, so that workers
+  // spread across them.
+  const uint32_t first = (static_cast<uint32_t>(thread) + epoch) % kMaxJobs;
+  for (int priority = RunPolicy::kNumPriorities - 1; priority >= 0;
+       --priority) {
+    if (num_active_[priority].load(std::memory_order_relaxed) == 0) continue;
+    for (uint32_t i = 0; i < kMaxJobs; ++i) {
+      JobSlot& slot = slots_[(first + i) % kMaxJobs];
+      if (slot.job.load(std::memory_order_relaxed) == nullptr) continue;
+      // seq_cst: either RemoveJob sees our increment and waits, or we do not
+      // see the removed job.
+      slot.num_users.fetch_add(1);
+      Job* job = slot.job.load();
+      bool any = false;
+      if (job != nullptr && job->priority == priority &&
+          AcquireThread(job->policy)) {
+        if (Join(job, thread)) {
+          any = RunTasks(job, thread, /*preemptible=*/!job->once, epoch);
+        }
+        ReleaseThread(job->policy);
+      }
+      slot.num_users.fetch_sub(1, std::memory_order_release);
+      if (any) return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::ThreadFunc(ThreadPool* self, const int thread,
+                            const int cpu) {
+  if (cpu >= 0) PinThreadToCPU(cpu);
+  ThisWorkerId() = {self, thread};
+  uint32_t epoch = self->epoch_.load();
+  while (!self->exit_.load(std::memory_order_acquire)) {
+    // Re-check after any work in case new jobs were added meanwhile. A job
+    // added after loading "epoch" also increments it, so we do not sleep.
+    if (self->FindAndRunTasks(thread, epoch)) {
+      epoch = self->epoch_.load();
+      continue;
+    }
+    epoch = self->WaitForEpoch(epoch);
+  }
+}
+
+}  // namespace pik
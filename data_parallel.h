@@ -30,6 +30,8 @@
 #include <vector>
 
 #include "bits.h"
+#include "compiler_specific.h"
+#include "os_specific.h"
 
 #define DATA_PARALLEL_CHECK(condition)                           \
   while (!(condition)) {                                         \
@@ -39,6 +41,31 @@
 
 namespace pik {
 
+// Scheduling policy for all Run calls made on behalf of one request, e.g. an
+// encode or decode in a server that shares one ThreadPool among clients.
+// Applies to the Runs of the thread that created a ThreadPool::PolicyScope
+// and to nested Runs called from their tasks. Must outlive those Runs.
+struct RunPolicy {
+  // Workers prefer tasks of higher priority classes and, whenever another
+  // Run starts, move on from lower-priority ones at the next task boundary
+  // (e.g. after encoding a group).
+  enum Priority { kBackground = 0, kNormal = 1, kInteractive = 2 };
+  static constexpr int kNumPriorities = 3;
+
+  // "max_threads" bounds the number of threads running tasks of this request
+  // at any time (across all its Runs), or 0 for no limit.
+  explicit RunPolicy(const Priority priority = kNormal,
+                     const size_t max_threads = 0)
+      : priority(priority), max_threads(static_cast<uint32_t>(max_threads)) {}
+
+  RunPolicy(const RunPolicy&) = delete;
+  RunPolicy& operator=(const RunPolicy&) = delete;
+
+  const Priority priority;
+  const uint32_t max_threads;
+  std::atomic<uint32_t> num_busy{0};  // Workers running its tasks.
+};
+
 // Scalable, lower-overhead thread pool, especially suitable for data-parallel
 // computations in the fork-join model, where clients need to know when all
 // tasks have completed.
@@ -49,10 +76,32 @@ namespace pik {
 // for each value. Conventional vector-of-tasks can be run in parallel using a
 // lambda function adapter that simply calls task_funcs[task].
 //
-// This thread pool can efficiently load-balance millions of tasks using an
-// atomic counter, thus avoiding per-task virtual or system calls. With 48
-// hyperthreads and 1M tasks that add to an atomic counter, overall runtime is
-// 10-20x higher when using std::async, and ~200x for a queue-based ThreadPool.
+// Each Run splits the range of tasks into one contiguous subrange per
+// participant. Workers reserve chunks from the front of their own subrange
+// and, when it is exhausted, steal the back half of another worker's subrange.
+// Each subrange is a single atomic word, so reserving or stealing is one
+// compare-exchange and there are no per-task virtual or system calls.
+//
+// Small Runs do not involve all workers: the number of participants is
+// limited by the number of tasks and, if the caller estimates it, their cost
+// (see NumParticipants). If a single participant suffices, the caller runs
+// all tasks itself without waking any worker. Workers that are not needed
+// remain free for other concurrent Runs.
+//
+// For multi-tenant use, RunPolicy assigns priority classes and thread quotas
+// to requests. Among Runs of equal priority, each worker starts its search at
+// a different job, so that the tasks of concurrent requests interleave.
+//
+// Workers spin briefly before sleeping, and the main thread only notifies
+// condition variables if some thread is actually sleeping. Back-to-back Run
+// calls (e.g. per-row loops in the encoder) thus avoid mutex/condition variable
+// round trips.
+//
+// Run is thread-safe: several threads may call it concurrently (e.g. one per
+// image), and tasks may themselves call Run (e.g. a per-image task calling a
+// parallel ButteraugliComparator). Idle workers help with all active Runs.
+// A nested Run called from a worker also runs tasks on the calling worker, so
+// the pool never has more busy threads than workers.
 //
 // Usage:
 //   ThreadPool pool;
@@ -67,86 +116,163 @@ class ThreadPool {
   // For per-thread arrays. Can increase if needed.
   static constexpr int kMaxThreads = 256;
 
-  // Starts the given number of worker threads and blocks until they are ready.
-  // "num_threads" defaults to one per hyperthread. If zero, all tasks run on
-  // the main thread.
-  explicit ThreadPool(
-      const int num_threads = std::thread::hardware_concurrency())
-      : num_threads_(num_threads) {
-    DATA_PARALLEL_CHECK(num_threads >= 0);
-    DATA_PARALLEL_CHECK(num_threads <= kMaxThreads);
-    threads_.reserve(num_threads);
-
-    // Suppress "unused-private-field" warning.
-    (void)padding;
+  // Maximum number of concurrently active Run calls. Additional concurrent
+  // Run calls are still correct, but run their tasks on the calling thread.
+  static constexpr int kMaxJobs = 32;
 
-    // Safely handle spurious worker wakeups.
-    worker_start_command_ = kWorkerWait;
-
-    for (int i = 0; i < num_threads; ++i) {
-      threads_.emplace_back(ThreadFunc, this, i);
-    }
-
-    if (num_threads_ != 0) {
-      WorkersReadyBarrier();
-    }
-  }
+  // Starts the given number of worker threads. "num_threads" defaults to one
+  // per hyperthread. If zero, all tasks run on the main thread.
+  //
+  // If "cpus" is non-empty, worker i is pinned to cpus[i % cpus.size()], e.g.
+  // from CPUsForThreads. This avoids migrations and, on NUMA systems, remote
+  // memory accesses: per-thread buffers are usually first written, and thus
+  // placed, by their worker. For one pool per node, pass the CPUs of each
+  // group returned by AvailableCPUsPerNode.
+  explicit ThreadPool(
+      const int num_threads = std::thread::hardware_concurrency(),
+      const std::vector<int>& cpus = std::vector<int>());
 
   ThreadPool(const ThreadPool&) = delete;
   ThreadPool& operator&(const ThreadPool&) = delete;
 
-  // Waits for all threads to exit.
-  ~ThreadPool() {
-    if (num_threads_ != 0) {
-      StartWorkers(kWorkerExit);
-    }
-
-    for (std::thread& thread : threads_) {
-      thread.join();
-    }
-  }
+  // Waits for all threads to exit. Precondition: no Run is active.
+  ~ThreadPool();
 
   // Returns number of worker threads created (some may be sleeping and never
   // wake up in time to participate in Run).
   size_t NumThreads() const { return num_threads_; }
 
+  // Applies "policy" (if non-null) to the Run calls of the current thread
+  // until the end of the scope, e.g. for the duration of one request.
+  class PolicyScope {
+   public:
+    explicit PolicyScope(RunPolicy* policy) : prev_(CurrentPolicy()) {
+      CurrentPolicy() = policy;
+    }
+    ~PolicyScope() { CurrentPolicy() = prev_; }
+
+    PolicyScope(const PolicyScope&) = delete;
+    PolicyScope& operator=(const PolicyScope&) = delete;
+
+   private:
+    RunPolicy* const prev_;
+  };
+
+  // A participant must receive tasks worth at least this many timestamp ticks
+  // to outweigh the cost of waking it and distributing/stealing tasks (a few
+  // microseconds).
+  static constexpr uint64_t kMinCostPerParticipant = 20000;
+
+  // Returns how many threads (at least 1) should run a Run of "num_tasks"
+  // tasks that each take about "cost_per_task" ticks (0 if unknown, which
+  // assumes the tasks are expensive): no more than the tasks or NumThreads(),
+  // each receiving at least kMinCostPerParticipant.
+  size_t NumParticipants(const size_t num_tasks,
+                         const uint64_t cost_per_task = 0) const {
+    size_t participants = std::min(num_tasks, num_threads_);
+    if (cost_per_task != 0) {
+      const uint64_t cost = num_tasks * cost_per_task;
+      participants = std::min<uint64_t>(participants,
+                                        cost / kMinCostPerParticipant);
+    }
+    return std::max<size_t>(participants, 1);
+  }
+
+  // Sets how many tasks a worker reserves at a time from its own subrange.
+  // Larger chunks amortize the atomic updates for very cheap tasks; stealing
+  // still balances the load. The default (0) reserves a quarter of the
+  // remaining subrange ("guided"), which is usually competitive. Not
+  // thread-safe; must not be called during Run.
+  void SetChunkSize(const int chunk_size) {
+    DATA_PARALLEL_CHECK(chunk_size >= 0);
+    chunk_size_ = static_cast<uint32_t>(chunk_size);
+  }
+
   // Runs func(task, thread) on worker thread(s) for every task in [begin, end).
-  // "thread" is 0 if NumThreads() == 0, otherwise [0, NumThreads()).
-  // Not thread-safe - no two calls to Run may overlap.
-  // Subsequent calls will reuse the same threads.
+  // "thread" is 0 if NumThreads() == 0, otherwise [0, NumThreads()). Thread-
+  // safe; may also be called from within a task of another Run. In that case,
+  // "thread" may be the same for a task and the tasks of its nested Run, so
+  // they must not share per-thread data. The same applies to Runs that the
+  // caller executes itself, which pass thread = 0 (unless called by a worker).
+  //
+  // "cost_per_task" is an optional estimate of the timestamp ticks per task,
+  // see NumParticipants. Cheap per-row loops should pass it so that small
+  // images do not wake all workers.
   //
   // Precondition: 0 <= begin <= end.
   template <class Func>
-  void Run(const int begin, const int end, const Func& func) {
+  void Run(const int begin, const int end, const Func& func,
+           const uint64_t cost_per_task = 0) {
     DATA_PARALLEL_CHECK(0 <= begin && begin <= end);
     if (begin == end) {
       return;
     }
-    if (num_threads_ == 0) {
-      const int thread = 0;
+    const int self = ThisWorker();
+    RunPolicy* policy = CurrentPolicy();
+    size_t num_participants = NumParticipants(end - begin, cost_per_task);
+    if (policy != nullptr && policy->max_threads != 0) {
+      num_participants = std::min<size_t>(num_participants, policy->max_threads);
+    }
+    // Also if NumThreads() == 0.
+    if (num_participants == 1) {
+      const int thread = self < 0 ? 0 : self;
       for (int task = begin; task < end; ++task) {
         func(task, thread);
       }
       return;
     }
 
-    const WorkerCommand worker_command = (WorkerCommand(end) << 32) + begin;
-    // Ensure the inputs do not result in a reserved command.
-    DATA_PARALLEL_CHECK(worker_command != kWorkerWait);
-    DATA_PARALLEL_CHECK(worker_command != kWorkerOnce);
-    DATA_PARALLEL_CHECK(worker_command != kWorkerExit);
+    Job job(&CallClosure<Func>, &func, end - begin, /*once=*/false);
+    job.max_participants = static_cast<uint32_t>(num_participants);
+    job.policy = policy;
+    if (policy != nullptr) job.priority = policy->priority;
+    // The calling worker always participates, see below.
+    if (self >= 0) {
+      job.num_joined.store(1, std::memory_order_relaxed);
+      job.joined[self / 64].store(1ULL << (self % 64),
+                                  std::memory_order_relaxed);
+    }
 
-    func_ = &CallClosure<Func>;
-    arg_ = &func;
-    num_reserved_.store(0, std::memory_order_relaxed);
+    // Evenly distribute the tasks among the first subranges; the first of
+    // those receive the remainder. The others start empty and steal.
+    const uint32_t per_thread = job.num_tasks / job.max_participants;
+    const uint32_t remainder = job.num_tasks % job.max_participants;
+    uint32_t next = static_cast<uint32_t>(begin);
+    for (uint32_t i = 0; i < num_threads_; ++i) {
+      const uint32_t size =
+          i < job.max_participants ? per_thread + (i < remainder) : 0;
+      job.ranges[i].packed.store(Pack(next, next + size),
+                                 std::memory_order_relaxed);
+      next += size;
+    }
 
-    StartWorkers(worker_command);
-    WorkersReadyBarrier();
+    const int slot = AddJob(&job);
+    if (slot < 0) {
+      // Too many concurrent jobs - run serially. Any thread index is safe
+      // because no other thread sees this job.
+      const int thread = self < 0 ? 0 : self;
+      for (int task = begin; task < end; ++task) {
+        func(task, thread);
+      }
+      return;
+    }
+
+    // Other tasks reserved by the calling worker already block it anyway,
+    // so there is no need to wake up yet another thread and oversubscribe.
+    // It already counts towards the policy's max_threads and is not
+    // preempted: that would only delay the task it is part of.
+    if (self >= 0) {
+      RunTasks(&job, self, /*preemptible=*/false, 0);
+    }
+    WaitForJob(&job);
+    RemoveJob(slot);
   }
 
   // Runs func(thread, thread) on all thread(s) that may participate in Run.
   // If NumThreads() == 0, runs on the main thread with thread == 0, otherwise
-  // concurrently called by each worker thread in [0, NumThreads()).
+  // concurrently called by each worker thread in [0, NumThreads()). Thread-
+  // safe, but must not be called from within a task (whose worker would never
+  // be available for its own call).
   template <class Func>
   void RunOnEachThread(const Func& func) {
     if (num_threads_ == 0) {
@@ -154,25 +280,31 @@ class ThreadPool {
       func(thread, thread);
       return;
     }
+    DATA_PARALLEL_CHECK(ThisWorker() < 0);
 
-    func_ = reinterpret_cast<TypeErasedFunc>(&CallClosure<Func>);
-    arg_ = &func;
-    StartWorkers(kWorkerOnce);
-    WorkersReadyBarrier();
+    // One task per worker; each worker only runs its own.
+    Job job(&CallClosure<Func>, &func, num_threads_, /*once=*/true);
+    for (size_t i = 0; i < num_threads_; ++i) {
+      job.ranges[i].packed.store(Pack(i, i + 1), std::memory_order_relaxed);
+    }
+
+    int slot;
+    while ((slot = AddJob(&job)) < 0) {
+      std::this_thread::yield();
+    }
+    WaitForJob(&job);
+    RemoveJob(slot);
   }
 
  private:
-  // After construction and between calls to Run, workers are "ready", i.e.
-  // waiting on worker_start_cv_. They are "started" by sending a "command"
-  // and notifying all worker_start_cv_ waiters. (That is why all workers
-  // must be ready/waiting - otherwise, the notification will not reach all of
-  // them and the main thread waits in vain for them to report readiness.)
-  using WorkerCommand = uint64_t;
-
-  // Special values; all others encode the begin/end parameters.
-  static constexpr WorkerCommand kWorkerWait = ~0ULL;
-  static constexpr WorkerCommand kWorkerOnce = ~1ULL;
-  static constexpr WorkerCommand kWorkerExit = ~2ULL;
+  // How often to poll for new jobs/completion before sleeping. This covers the
+  // gap between back-to-back Run calls (tens of microseconds) without burning
+  // CPU time for longer.
+  static constexpr int kSpinIterations = 512;
+
+  // What task to run on a worker thread. Points to code generated via
+  // CallClosure. Arguments are arg (points to the lambda), task, thread.
+  using TypeErasedFunc = void (*)(const void*, int, int);
 
   // Calls f(task, thread). Used for type erasure of Func arguments. The
   // signature must match TypeErasedFunc, hence a const void* argument.
@@ -181,115 +313,165 @@ class ThreadPool {
     (*reinterpret_cast<const Closure*>(f))(task, thread);
   }
 
-  void WorkersReadyBarrier() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    while (workers_ready_ != threads_.size()) {
-      workers_ready_cv_.wait(lock);
-    }
-    workers_ready_ = 0;
-
-    // Safely handle spurious worker wakeups.
-    worker_start_command_ = kWorkerWait;
+  // Called during spin loops. Occasionally yields so that spinning does not
+  // delay the thread we are waiting for if there are more threads than cores.
+  static void Pause(const int iteration);
+
+  // Subrange [next, end) of tasks owned by one worker, packed into a single
+  // word so that both bounds can be updated by one compare-exchange. The owner
+  // advances "next"; thieves decrease "end". Once empty, only the owner
+  // refills it (with stolen tasks), so there is no ABA problem. Not
+  // initialized because Run only uses (and stores) the first NumThreads().
+  struct alignas(64) TaskRange {
+    std::atomic<uint64_t> packed;
+  };
+
+  static uint64_t Pack(const uint32_t next, const uint32_t end) {
+    return (static_cast<uint64_t>(end) << 32) + next;
+  }
+  static uint32_t Next(const uint64_t packed) { return packed & 0xFFFFFFFFu; }
+  static uint32_t End(const uint64_t packed) { return packed >> 32; }
+
+  // State of one Run/RunOnEachThread call, allocated on the caller's stack.
+  struct Job {
+    Job(const TypeErasedFunc func, const void* arg, const size_t num_tasks,
+        const bool once)
+        : func(func),
+          arg(arg),
+          num_tasks(static_cast<uint32_t>(num_tasks)),
+          once(once) {}
+
+    const TypeErasedFunc func;
+    const void* const arg;
+    const uint32_t num_tasks;
+    // Whether each worker runs exactly the task with its index (for
+    // RunOnEachThread) instead of stealing.
+    const bool once;
+    // Ignored if "once". Workers beyond the first max_participants to join
+    // do not run any tasks.
+    uint32_t max_participants = kMaxThreads;
+    RunPolicy* policy = nullptr;
+    RunPolicy::Priority priority = RunPolicy::kNormal;
+
+    alignas(64) std::atomic<uint32_t> num_finished{0};
+    std::atomic<uint32_t> num_joined{0};
+    // Bit i is set if worker i joined, so that it may resume after preemption.
+    std::atomic<uint64_t> joined[kMaxThreads / 64] = {};
+    std::atomic<bool> caller_sleeping{false};
+
+    TaskRange ranges[kMaxThreads];
+  };
+
+  // Where workers find active jobs. "num_users" counts workers that may be
+  // accessing "job"; the caller waits until it is zero before returning,
+  // i.e. destroying the job.
+  struct alignas(64) JobSlot {
+    std::atomic<Job*> job{nullptr};
+    std::atomic<uint32_t> num_users{0};
+  };
+
+  // Returns the index of the calling thread if it is a worker of this pool,
+  // otherwise -1.
+  int ThisWorker() const {
+    const WorkerId& id = ThisWorkerId();
+    return id.pool == this ? id.thread : -1;
   }
 
-  // Precondition: all workers are ready.
-  void StartWorkers(const WorkerCommand worker_command) {
-    mutex_.lock();
-    worker_start_command_ = worker_command;
-    // Workers will need this lock, so release it before they wake up.
-    mutex_.unlock();
-    worker_start_cv_.notify_all();
+  struct WorkerId {
+    const ThreadPool* pool;
+    int thread;
+  };
+  static WorkerId& ThisWorkerId() {
+    static thread_local WorkerId id = {nullptr, -1};
+    return id;
   }
 
-  // Attempts to reserve and perform some work from the global range of tasks,
-  // which is encoded within "command". Returns after all tasks are reserved.
-  static void RunRange(ThreadPool* self, const WorkerCommand command,
-                       const int thread) {
-    const int begin = command & 0xFFFFFFFF;
-    const int end = command >> 32;
-    const int num_tasks = end - begin;
-    const int num_threads = static_cast<int>(self->num_threads_);
-
-    // OpenMP introduced several "schedule" strategies:
-    // "single" (static assignment of exactly one chunk per thread): slower.
-    // "dynamic" (allocates k tasks at a time): competitive for well-chosen k.
-    // "guided" (allocates k tasks, decreases k): computing k = remaining/n
-    //   is faster than halving k each iteration. We prefer this strategy
-    //   because it avoids user-specified parameters.
-
-    for (;;) {
-#if 0
-      // dynamic
-      const int my_size = std::max(num_tasks / (num_threads * 4), 1);
-#else
-      // guided
-      const int num_reserved = self->num_reserved_.load();
-      const int num_remaining = num_tasks - num_reserved;
-      const int my_size = std::max(num_remaining / (num_threads * 4), 1);
-#endif
-      const int my_begin = begin + self->num_reserved_.fetch_add(my_size);
-      const int my_end = std::min(my_begin + my_size, begin + num_tasks);
-      // Another thread already reserved the last task.
-      if (my_begin >= my_end) {
-        break;
-      }
-      for (int task = my_begin; task < my_end; ++task) {
-        self->func_(self->arg_, task, thread);
-      }
-    }
+  // Policy of the Runs called by this thread, see PolicyScope. Workers set it
+  // to that of the job whose tasks they run.
+  static RunPolicy*& CurrentPolicy() {
+    static thread_local RunPolicy* policy = nullptr;
+    return policy;
   }
 
-  // What task to run on a worker thread. Points to code generated via
-  // CallClosure. Arguments are arg_ (points to the lambda), task, thread.
-  using TypeErasedFunc = void (*)(const void*, int, int);
+  // Returns the slot index, or -1 if all are in use.
+  int AddJob(Job* job);
 
-  static void ThreadFunc(ThreadPool* self, const int thread) {
-    // Until kWorkerExit command received:
-    for (;;) {
-      std::unique_lock<std::mutex> lock(self->mutex_);
-      // Notify main thread that this thread is ready.
-      if (++self->workers_ready_ == self->NumThreads()) {
-        self->workers_ready_cv_.notify_one();
-      }
-    RESUME_WAIT:
-      // Wait for a command.
-      self->worker_start_cv_.wait(lock);
-      const WorkerCommand command = self->worker_start_command_;
-      switch (command) {
-        case kWorkerWait:    // spurious wakeup:
-          goto RESUME_WAIT;  // lock still held, avoid incrementing ready.
-        case kWorkerOnce:
-          lock.unlock();
-          self->func_(self->arg_, thread, thread);
-          break;
-        case kWorkerExit:
-          return;  // exits thread
-        default:
-          lock.unlock();
-          RunRange(self, command, thread);
-          break;
-      }
-    }
-  }
+  void RemoveJob(const int slot);
+
+  void WakeWorkers();
+
+  // Returns the first epoch_ value different from "prev_epoch".
+  uint32_t WaitForEpoch(const uint32_t prev_epoch);
+
+  void WaitForJob(Job* job);
+
+  // Called after running "num_tasks" tasks of "job".
+  void ReportFinished(Job* job, const uint32_t num_tasks);
+
+  // Reserves a chunk from the front of job->ranges[thread]. Returns false if
+  // empty.
+  bool ReserveOwn(Job* job, const int thread, uint32_t* PIK_RESTRICT my_begin,
+                  uint32_t* PIK_RESTRICT my_end) const;
+
+  // Moves the back half of another worker's subrange into the (empty)
+  // job->ranges[thread]. Returns false if all other subranges are empty.
+  bool Steal(Job* job, const int thread) const;
+
+  // Stores unstarted tasks [begin, end) of a chunk reserved by ReserveOwn back
+  // into the front of job->ranges[thread], where others can steal them.
+  // Thieves only decrease its end, so its next is still the chunk's end.
+  static void Unreserve(Job* job, const int thread, const uint32_t begin);
+
+  // Whether a worker should stop running tasks of "job" because a Run of
+  // higher priority was added after epoch_ was "epoch".
+  bool ShouldYield(const Job& job, const uint32_t epoch) const;
+
+  // Runs tasks of "job" until all subranges are empty or, if "preemptible",
+  // ShouldYield(epoch). Tasks stolen by other workers are run by them, hence
+  // this may return before they are finished. Returns whether any tasks were
+  // run.
+  bool RunTasks(Job* job, const int thread, const bool preemptible,
+                const uint32_t epoch);
+
+  // Returns whether worker "thread" may run tasks of "job": if it joined
+  // before (and was preempted) or fewer than max_participants have joined.
+  static bool Join(Job* job, const int thread);
+
+  // Reserves one of the policy's max_threads for the calling worker. Returns
+  // false if all are in use.
+  static bool AcquireThread(RunPolicy* policy);
+
+  static void ReleaseThread(RunPolicy* policy);
+
+  // Runs tasks of the highest-priority job that the calling worker may join.
+  // Returns whether any tasks were run; the caller then searches again in
+  // case jobs were added meanwhile. "epoch" is the value of epoch_ before the
+  // previous search, see ShouldYield.
+  bool FindAndRunTasks(const int thread, const uint32_t epoch);
+
+  // "cpu" is the CPU to pin this worker to, or -1.
+  static void ThreadFunc(ThreadPool* self, const int thread, const int cpu);
 
   // Unmodified after ctor, but cannot be const because we call thread::join().
   std::vector<std::thread> threads_;
 
   const size_t num_threads_;
 
-  std::mutex mutex_;  // guards both cv and their variables.
-  std::condition_variable workers_ready_cv_;
-  size_t workers_ready_ = 0;
+  std::mutex mutex_;  // only for the condition variables.
   std::condition_variable worker_start_cv_;
-  WorkerCommand worker_start_command_;
+  std::condition_variable job_done_cv_;
+
+  uint32_t chunk_size_ = 0;
 
-  // Written by main thread, read by workers (after mutex lock/unlock).
-  TypeErasedFunc func_;
-  const void* arg_;
+  // Incremented whenever a job is added (or upon exit).
+  alignas(64) std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> num_sleeping_{0};
+  std::atomic<bool> exit_{false};
 
-  // Updated by workers; alignment/padding avoids false sharing.
-  alignas(64) std::atomic<int> num_reserved_{0};
-  int padding[15];
+  // Number of jobs in slots_ per RunPolicy::Priority.
+  std::atomic<uint32_t> num_active_[RunPolicy::kNumPriorities] = {};
+
+  JobSlot slots_[kMaxJobs];
 };
 
 // Adapters for zero-cost switching between ThreadPool and non-threaded loop.
@@ -316,6 +498,37 @@ struct ExecutorPool {
   ThreadPool* pool;  // not owned
 };
 
+// Batches of independent images (e.g. video frames) can be parallelized
+// either across images, each processed by one worker without further
+// parallelism, or within each image (one at a time, using all workers for its
+// groups/rows). The latter has lower latency and holds only one image in
+// memory, and suffices if each image has enough parallel tasks to keep all
+// workers busy. Returns whether to parallelize across images instead.
+static inline bool ParallelizeAcrossImages(const ThreadPool& pool,
+                                           const size_t tasks_per_image) {
+  return pool.NumThreads() >= 2 && tasks_per_image < pool.NumThreads();
+}
+
+// Calls func(image, thread, image_pool) for each image in [0, num_images),
+// concurrently if "across_images" (see ParallelizeAcrossImages), in which case
+// "image_pool" has no workers, otherwise sequentially with image_pool = pool
+// and thread = 0.
+template <class Func>
+void RunImages(ThreadPool* pool, const size_t num_images,
+               const bool across_images, const Func& func) {
+  if (!across_images) {
+    for (size_t image = 0; image < num_images; ++image) {
+      func(image, 0, pool);
+    }
+    return;
+  }
+  pool->Run(0, static_cast<int>(num_images),
+            [&func](const int task, const int thread) {
+              ThreadPool serial(0);
+              func(static_cast<size_t>(task), thread, &serial);
+            });
+}
+
 // Accelerates multiple unsigned 32-bit divisions with the same divisor by
 // precomputing a multiplier. This is useful for splitting a contiguous range of
 // indices (the task index) into 2D indices. Exhaustively tested on dividends
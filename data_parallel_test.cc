@@ -0,0 +1,159 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Stress test of ThreadPool: several threads concurrently call Run with random
+// ranges, RunPolicy (priority and max_threads) and nested Runs, and check that
+// every task runs exactly once on a valid thread. Mixing priorities makes
+// workers yield lower-priority jobs (ShouldYield) while they still have tasks.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>  //NOLINT
+#include <vector>
+
+#include "data_parallel.h"
+
+namespace pik {
+namespace {
+
+constexpr int kNumCallers = 6;
+constexpr int kRunsPerCaller = 100;
+constexpr int kMaxTasks = 300;
+constexpr int kMaxNestedTasks = 40;
+
+std::atomic<bool> g_failed{false};
+
+void Fail(const char* what, const int value) {
+  if (!g_failed.exchange(true)) {
+    fprintf(stderr, "%s: %d\n", what, value);
+  }
+}
+
+// Counts the executions of each task of one Run of [begin, end).
+class TaskCounts {
+ public:
+  TaskCounts(const int begin, const int end)
+      : begin_(begin), end_(end), counts_(new std::atomic<int>[end - begin]) {
+    for (int i = 0; i < end - begin; ++i) counts_[i].store(0);
+  }
+
+  void Add(const int task) {
+    if (task < begin_ || task >= end_) return Fail("Task out of range", task);
+    counts_[task - begin_].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Call after Run returned.
+  void Verify() const {
+    for (int i = 0; i < end_ - begin_; ++i) {
+      const int count = counts_[i].load(std::memory_order_relaxed);
+      if (count != 1) Fail("Task did not run exactly once", count);
+    }
+  }
+
+ private:
+  const int begin_;
+  const int end_;
+  std::unique_ptr<std::atomic<int>[]> counts_;
+};
+
+void VerifyThread(const ThreadPool& pool, const int thread) {
+  const int max_thread = std::max<int>(pool.NumThreads(), 1);
+  if (thread < 0 || thread >= max_thread) Fail("Invalid thread", thread);
+}
+
+// Spins for a random duration so that Runs overlap.
+void Work(std::mt19937* rng) {
+  const uint32_t iterations = (*rng)() % 2000;
+  std::atomic<uint32_t> sink{0};
+  for (uint32_t i = 0; i < iterations; ++i) {
+    sink.fetch_add(i, std::memory_order_relaxed);
+  }
+}
+
+void Caller(ThreadPool* pool, const int caller) {
+  std::mt19937 rng(caller);
+  for (int run = 0; run < kRunsPerCaller && !g_failed; ++run) {
+    const RunPolicy::Priority priority =
+        static_cast<RunPolicy::Priority>(rng() % RunPolicy::kNumPriorities);
+    const size_t max_threads = rng() % 4;  // 0 = unlimited
+    RunPolicy policy(priority, max_threads);
+    // Some Runs use no policy.
+    ThreadPool::PolicyScope scope(rng() % 4 == 0 ? nullptr : &policy);
+
+    if (rng() % 16 == 0) {
+      std::vector<std::atomic<int>> counts(pool->NumThreads() + 1);
+      pool->RunOnEachThread([&](const int task, const int thread) {
+        VerifyThread(*pool, thread);
+        counts[thread].fetch_add(1, std::memory_order_relaxed);
+      });
+      for (size_t i = 0; i < std::max<size_t>(pool->NumThreads(), 1); ++i) {
+        if (counts[i] != 1) Fail("RunOnEachThread count", counts[i]);
+      }
+      continue;
+    }
+
+    const int begin = rng() % 100;
+    const int end = begin + rng() % kMaxTasks;
+    const uint64_t cost_per_task = (rng() % 2) ? 0 : rng() % 10000;
+    const uint32_t seed = rng();
+    TaskCounts counts(begin, end);
+    pool->Run(begin, end, [&](const int task, const int thread) {
+      VerifyThread(*pool, thread);
+      counts.Add(task);
+      std::mt19937 task_rng(seed + task);
+      Work(&task_rng);
+      if (task_rng() % 8 != 0) return;
+
+      const int nested_end = task_rng() % kMaxNestedTasks;
+      TaskCounts nested_counts(0, nested_end);
+      pool->Run(0, nested_end, [&](const int nested, const int thread) {
+        VerifyThread(*pool, thread);
+        nested_counts.Add(nested);
+      });
+      nested_counts.Verify();
+    }, cost_per_task);
+    counts.Verify();
+  }
+}
+
+int RunTests() {
+  for (const int num_threads : {0, 1, 3, 8}) {
+    for (const int chunk_size : {0, 1, 7}) {
+      ThreadPool pool(num_threads);
+      pool.SetChunkSize(chunk_size);
+      std::vector<std::thread> callers;
+      for (int caller = 0; caller < kNumCallers; ++caller) {
+        callers.emplace_back(Caller, &pool, caller);
+      }
+      for (std::thread& caller : callers) caller.join();
+      if (g_failed) {
+        fprintf(stderr, "Failed with %d threads, chunk size %d.\n",
+                num_threads, chunk_size);
+        return 1;
+      }
+    }
+  }
+  printf("All ThreadPool tasks ran exactly once.\n");
+  return 0;
+}
+
+}  // namespace
+}  // namespace pik
+
+int main() { return pik::RunTests(); }
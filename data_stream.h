@@ -107,6 +107,9 @@ class DataStream {
     }
   }
 
+  // Upper bound on the number of bytes written by EncodeCodeWords.
+  size_t MaxEncodedSize() const { return 2 * (pos_ + 2); }
+
   void EncodeCodeWords(EntropySource* s, size_t* storage_ix, uint8_t* storage) {
     FlushBitWriter();
     FlushArithmeticCoder();
@@ -65,6 +65,34 @@ void ExpandXB(const size_t xsize, const size_t ysize, const ImageS& tmp_y,
               const ImageS& tmp_xb_residuals,
               ImageS* PIK_RESTRICT tmp_xb_expanded);
 
+// Per-target implementations of the above, defined in dc_predictor_target.cc.
+// The functions above call these via dispatch::Run.
+
+struct ShrinkYImpl {
+  template <class Target>
+  void operator()(const Rect& rect_in, const ImageS& in_y,
+                  const Rect& rect_res, ImageS* PIK_RESTRICT residuals) const;
+};
+
+struct ExpandYImpl {
+  template <class Target>
+  void operator()(const Rect& rect, const ImageS& residuals,
+                  ImageS* PIK_RESTRICT tmp_expanded) const;
+};
+
+struct ShrinkXBImpl {
+  template <class Target>
+  void operator()(const Rect& rect, const ImageS& in_y, const ImageS& tmp_xb,
+                  ImageS* PIK_RESTRICT tmp_xb_residuals) const;
+};
+
+struct ExpandXBImpl {
+  template <class Target>
+  void operator()(const size_t xsize, const size_t ysize, const ImageS& tmp_y,
+                  const ImageS& tmp_xb_residuals,
+                  ImageS* PIK_RESTRICT tmp_xb_expanded) const;
+};
+
 }  // namespace pik
 
 #endif  // DC_PREDICTOR_H_
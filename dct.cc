@@ -15,48 +15,34 @@
 #include "dct.h"
 #include <cmath>
 
-#define PROFILER_ENABLED 1
 #include "arch_specific.h"
 #include "compiler_specific.h"
-#include "profiler.h"
+#include "simd/dispatch.h"
 
 namespace pik {
-namespace {
-
-template <class DC_Op>
-void TransposedScaledIDCT_Func(const void*, const ConstImageViewF* in,
-                               const OutputRegion& output_region,
-                               const MutableImageViewF* PIK_RESTRICT out) {
-  PROFILER_ZONE("|| IDCT");
-  const size_t xsize = output_region.xsize;
-  const size_t ysize = output_region.ysize;
-
-  const size_t stride = out->bytes_per_row() / sizeof(float);
-
-  for (int c = 0; c < 3; ++c) {
-    // x,y = top-left corner of 8x8 output block; 0,0 is the top-left of
-    // the current output tile.
-    for (size_t y = 0; y < ysize; y += kBlockHeight) {
-      const float* PIK_RESTRICT row_in = in[c].ConstRow(y / kBlockHeight);
-      float* PIK_RESTRICT row_out = out[c].Row(y);
-
-      for (size_t x = 0; x < xsize; x += kBlockWidth) {
-        ComputeTransposedScaledBlockIDCTFloat(
-            FromBlock(row_in + x * kBlockWidth), ToLines(row_out + x, stride),
-            DC_Op());
-      }
-    }
-  }
-}
-
-}  // namespace
 
 TFNode* AddTransposedScaledIDCT(const TFPorts in_xyb, bool zero_dc,
                                 TFBuilder* builder) {
   PIK_CHECK(OutType(in_xyb.node) == TFType::kF32);
+  const TFFunc func =
+      dispatch::Dispatched<TransposedScaledIDCTFuncImpl, TFFunc(bool)>::Get()(
+          zero_dc);
   return builder->Add("idct", Borders(), Scale(), {in_xyb}, 3, TFType::kF32,
-                      zero_dc ? &TransposedScaledIDCT_Func<DC_Zero>
-                              : &TransposedScaledIDCT_Func<DC_Unchanged>);
+                      func);
+}
+
+TFNode* AddTransposedScaledDCT(const TFPorts in_xyb, TFBuilder* builder) {
+  PIK_CHECK(OutType(in_xyb.node) == TFType::kF32);
+  const TFFunc func =
+      dispatch::Dispatched<TransposedScaledDCTFuncImpl, TFFunc()>::Get()();
+  return builder->Add("dct", Borders(), Scale(), {in_xyb}, 3, TFType::kF32,
+                      func);
+}
+
+Image3F TransposedScaledDCT(const Image3F& img, ThreadPool* pool) {
+  return dispatch::Dispatched<TransposedScaledDCTImpl,
+                              Image3F(const Image3F&, ThreadPool*)>::Get()(img,
+                                                                           pool);
 }
 
 void ComputeBlockDCTFloat(float block[kBlockSize]) {
@@ -18,6 +18,7 @@
 #include "common.h"
 #include "image.h"
 #include "simd/simd.h"
+#include "simd_helpers.h"
 #include "tile_flow.h"
 
 namespace pik {
@@ -43,6 +44,12 @@ void ComputeBlockIDCTFloat(float block[kBlockSize]);
 TFNode* AddTransposedScaledIDCT(const TFPorts in_xyb, bool zero_dc,
                                 TFBuilder* builder);
 
+// Adds a TFGraph node that computes the same coefficients as
+// TransposedScaledDCT. Its inputs are pixels and its output has the layout of
+// TransposedScaledDCT, so the input node must have Scale(-3, 3) and no
+// Borders (each 64x1 output row reads one aligned 8x8 block).
+TFNode* AddTransposedScaledDCT(const TFPorts in_xyb, TFBuilder* builder);
+
 // Final scaling factors of outputs/inputs in the Arai, Agui, and Nakajima
 // algorithm computing the DCT/IDCT.
 // The algorithm is described in the book JPEG: Still Image Data Compression
@@ -64,7 +71,7 @@ using DCTDesc =
     SIMD_NAMESPACE::Part<float,
                          SIMD_MIN(kBlockWidth, SIMD_NAMESPACE::Full<float>::N)>;
 
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
 
 // Each vector holds one row of the input/output block.
 template <class V>
@@ -100,10 +107,43 @@ PIK_INLINE void TransposeBlock_AVX2(V& i0, V& i1, V& i2, V& i3, V& i4, V& i5,
   i7 = concat_hi_hi(r7, r3);
 }
 
-#endif  // SIMD_TARGET_VALUE == SIMD_AVX2
+#elif SIMD_TARGET_VALUE == SIMD_ARM8 || SIMD_TARGET_VALUE == SIMD_WASM
+
+// Each vector holds one row of a 4x4 quadrant. interleave_lo/hi are single
+// zip1/zip2 instructions (or shuffles on WebAssembly).
+template <class V>
+PIK_INLINE void TransposeQuadrant_NEON(V& i0, V& i1, V& i2, V& i3) {
+  const auto q0 = interleave_lo(i0, i2);
+  const auto q1 = interleave_lo(i1, i3);
+  const auto q2 = interleave_hi(i0, i2);
+  const auto q3 = interleave_hi(i1, i3);
+  i0 = interleave_lo(q0, q1);
+  i1 = interleave_hi(q0, q1);
+  i2 = interleave_lo(q2, q3);
+  i3 = interleave_hi(q2, q3);
+}
+
+// l[r] and h[r] hold the left and right half of row r. Transposes all four
+// quadrants in registers (NEON has 32; WebAssembly locals are allocated by the
+// engine) and swaps the off-diagonal ones.
+template <class V>
+PIK_INLINE void TransposeBlock_NEON(V (&l)[kBlockHeight],
+                                    V (&h)[kBlockHeight]) {
+  TransposeQuadrant_NEON(l[0], l[1], l[2], l[3]);
+  TransposeQuadrant_NEON(l[4], l[5], l[6], l[7]);
+  TransposeQuadrant_NEON(h[0], h[1], h[2], h[3]);
+  TransposeQuadrant_NEON(h[4], h[5], h[6], h[7]);
+  for (size_t r = 0; r < 4; ++r) {
+    const V top_right = h[r];
+    h[r] = l[r + 4];
+    l[r + 4] = top_right;
+  }
+}
+
+#endif  // SIMD_TARGET_VALUE
 
 PIK_INLINE void TransposeBlock(float* PIK_RESTRICT block) {
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
   const DCTDesc d;
   static_assert(d.N == kBlockWidth,
                 "Wrong vector size, must match block width");
@@ -220,6 +260,18 @@ class FromBlock {
  private:
   const float* block_;
 };
+// Block: contiguous halves (see LoadF16), e.g. DecCache::ac16.
+class FromBlockF16 {
+ public:
+  explicit FromBlockF16(const uint16_t* block) : block_(block) {}
+
+  PIK_INLINE DCTDesc::V Load(const size_t row, size_t i) const {
+    return LoadF16(DCTDesc(), block_ + row * kBlockWidth + i);
+  }
+
+ private:
+  const uint16_t* block_;
+};
 class ToBlock {
  public:
   explicit ToBlock(float* block) : block_(block) {}
@@ -276,11 +328,13 @@ class ToLines {
   size_t stride_;  // move to next line by adding this to pointer
 };
 
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256 || \
+    SIMD_TARGET_VALUE == SIMD_ARM8 || SIMD_TARGET_VALUE == SIMD_WASM
 
-// Each vector holds one row of the input/output block.
+// Each vector holds one row (AVX2) or the left/right half of a row (NEON) of
+// the input/output block.
 template <class V>
-PIK_INLINE void ColumnDCT_AVX2(V& i0, V& i1, V& i2, V& i3, V& i4, V& i5, V& i6,
+PIK_INLINE void ColumnDCT_Rows(V& i0, V& i1, V& i2, V& i3, V& i4, V& i5, V& i6,
                                V& i7) {
   const DCTDesc d;
 
@@ -323,9 +377,10 @@ PIK_INLINE void ColumnDCT_AVX2(V& i0, V& i1, V& i2, V& i3, V& i4, V& i5, V& i6,
   i7 = t20 - t22;
 }
 
-// Each vector holds one row of the input/output block.
+// Each vector holds one row (AVX2) or the left/right half of a row (NEON) of
+// the input/output block.
 template <class V>
-PIK_INLINE void ColumnIDCT_AVX2(V& i0, V& i1, V& i2, V& i3, V& i4, V& i5, V& i6,
+PIK_INLINE void ColumnIDCT_Rows(V& i0, V& i1, V& i2, V& i3, V& i4, V& i5, V& i6,
                                 V& i7) {
   const DCTDesc d;
 
@@ -475,7 +530,7 @@ PIK_INLINE void ColumnIDCT(const From& from, const To& to, const DC_Op dc_op) {
   }
 }
 
-#endif  // SIMD_TARGET_VALUE == SIMD_AVX2
+#endif  // SIMD_TARGET_VALUE
 
 // Same as ComputeBlockDCTFloat(), but the output is further transformed with
 // the following:
@@ -484,7 +539,7 @@ PIK_INLINE void ColumnIDCT(const From& from, const To& to, const DC_Op dc_op) {
 template <class From, class To>
 static PIK_INLINE void ComputeTransposedScaledBlockDCTFloat(const From& from,
                                                             const To& to) {
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
   auto i0 = from.Load(0, 0);
   auto i1 = from.Load(1, 0);
   auto i2 = from.Load(2, 0);
@@ -494,9 +549,9 @@ static PIK_INLINE void ComputeTransposedScaledBlockDCTFloat(const From& from,
   auto i6 = from.Load(6, 0);
   auto i7 = from.Load(7, 0);
 
-  ColumnDCT_AVX2(i0, i1, i2, i3, i4, i5, i6, i7);
+  ColumnDCT_Rows(i0, i1, i2, i3, i4, i5, i6, i7);
   TransposeBlock_AVX2(i0, i1, i2, i3, i4, i5, i6, i7);
-  ColumnDCT_AVX2(i0, i1, i2, i3, i4, i5, i6, i7);
+  ColumnDCT_Rows(i0, i1, i2, i3, i4, i5, i6, i7);
 
   to.Store(i0, 0, 0);
   to.Store(i1, 1, 0);
@@ -506,6 +561,24 @@ static PIK_INLINE void ComputeTransposedScaledBlockDCTFloat(const From& from,
   to.Store(i5, 5, 0);
   to.Store(i6, 6, 0);
   to.Store(i7, 7, 0);
+#elif SIMD_TARGET_VALUE == SIMD_ARM8 || SIMD_TARGET_VALUE == SIMD_WASM
+  DCTDesc::V l[kBlockHeight];
+  DCTDesc::V h[kBlockHeight];
+  for (size_t r = 0; r < kBlockHeight; ++r) {
+    l[r] = from.Load(r, 0);
+    h[r] = from.Load(r, 4);
+  }
+
+  ColumnDCT_Rows(l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7]);
+  ColumnDCT_Rows(h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+  TransposeBlock_NEON(l, h);
+  ColumnDCT_Rows(l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7]);
+  ColumnDCT_Rows(h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+
+  for (size_t r = 0; r < kBlockHeight; ++r) {
+    to.Store(l[r], r, 0);
+    to.Store(h[r], r, 4);
+  }
 #else
   SIMD_ALIGN float block[kBlockSize];
   ColumnDCT(from, ToBlock(block));
@@ -542,7 +615,7 @@ struct DC_Unchanged {
 template <class From, class To, class DC_Op>
 static PIK_INLINE void ComputeTransposedScaledBlockIDCTFloat(
     const From& from, const To& to, const DC_Op dc_op) {
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
   auto i0 = dc_op(from.Load(0, 0));
   auto i1 = from.Load(1, 0);
   auto i2 = from.Load(2, 0);
@@ -552,9 +625,9 @@ static PIK_INLINE void ComputeTransposedScaledBlockIDCTFloat(
   auto i6 = from.Load(6, 0);
   auto i7 = from.Load(7, 0);
 
-  ColumnIDCT_AVX2(i0, i1, i2, i3, i4, i5, i6, i7);
+  ColumnIDCT_Rows(i0, i1, i2, i3, i4, i5, i6, i7);
   TransposeBlock_AVX2(i0, i1, i2, i3, i4, i5, i6, i7);
-  ColumnIDCT_AVX2(i0, i1, i2, i3, i4, i5, i6, i7);
+  ColumnIDCT_Rows(i0, i1, i2, i3, i4, i5, i6, i7);
 
   to.Store(i0, 0, 0);
   to.Store(i1, 1, 0);
@@ -564,6 +637,26 @@ static PIK_INLINE void ComputeTransposedScaledBlockIDCTFloat(
   to.Store(i5, 5, 0);
   to.Store(i6, 6, 0);
   to.Store(i7, 7, 0);
+#elif SIMD_TARGET_VALUE == SIMD_ARM8 || SIMD_TARGET_VALUE == SIMD_WASM
+  DCTDesc::V l[kBlockHeight];
+  DCTDesc::V h[kBlockHeight];
+  for (size_t r = 0; r < kBlockHeight; ++r) {
+    l[r] = from.Load(r, 0);
+    h[r] = from.Load(r, 4);
+  }
+  // The DC is lane 0 of the left half.
+  l[0] = dc_op(l[0]);
+
+  ColumnIDCT_Rows(l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7]);
+  ColumnIDCT_Rows(h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+  TransposeBlock_NEON(l, h);
+  ColumnIDCT_Rows(l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7]);
+  ColumnIDCT_Rows(h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+
+  for (size_t r = 0; r < kBlockHeight; ++r) {
+    to.Store(l[r], r, 0);
+    to.Store(h[r], r, 4);
+  }
 #else
   SIMD_ALIGN float block[kBlockSize];
   ColumnIDCT(from, ToBlock(block), dc_op);
@@ -664,29 +757,27 @@ Image3F TransposedScaledIDCTAndAdd(const Image3F& coeffs,
 // the image. Note that the whole coefficient image is scaled by 1/64
 // afterwards, so that this is exactly the inverse of TransposedScaledIDCT().
 // REQUIRES: coeffs.xsize() == 8*N, coeffs.ysize() == 8*M
-static inline Image3F TransposedScaledDCT(const Image3F& img,
-                                          ThreadPool* pool) {
-  PIK_ASSERT(img.ysize() % kBlockHeight == 0);
-  const size_t xsize = img.xsize() * kBlockWidth;
-  const size_t ysize = img.ysize() / kBlockWidth;
-  Image3F coeffs(xsize, ysize);
-
-  pool->Run(0, ysize, [&img, &coeffs](const int task, const int thread) {
-    const size_t y = task;
-    for (int c = 0; c < 3; ++c) {
-      const size_t stride = img.PlaneRow(c, 1) - img.PlaneRow(c, 0);
-      const float* PIK_RESTRICT row_in = img.PlaneRow(c, y * kBlockHeight);
-      float* PIK_RESTRICT row_out = coeffs.PlaneRow(c, y);
+Image3F TransposedScaledDCT(const Image3F& img, ThreadPool* pool);
 
-      for (size_t x = 0; x < coeffs.xsize(); x += kBlockSize) {
-        ComputeTransposedScaledBlockDCTFloat(
-            FromLines(row_in + x / kBlockWidth, stride),
-            ScaleToBlock(row_out + x));
-      }
-    }
-  });
-  return coeffs;
-}
+// Per-target implementations, defined in dct_target.cc. TransposedScaledDCT
+// and AddTransposedScaledIDCT call these via dispatch::Run.
+
+struct TransposedScaledDCTImpl {
+  template <class Target>
+  Image3F operator()(const Image3F& img, ThreadPool* pool) const;
+};
+
+// Returns the TFFunc of the node added by AddTransposedScaledIDCT.
+struct TransposedScaledIDCTFuncImpl {
+  template <class Target>
+  TFFunc operator()(bool zero_dc) const;
+};
+
+// Returns the TFFunc of the node added by AddTransposedScaledDCT.
+struct TransposedScaledDCTFuncImpl {
+  template <class Target>
+  TFFunc operator()() const;
+};
 
 }  // namespace pik
 
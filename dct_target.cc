@@ -0,0 +1,117 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compiled once per SIMD target (see CMakeLists.txt); dct.cc selects the best
+// one via dispatch::Run.
+
+#include "dct.h"
+
+#define PROFILER_ENABLED 1
+#include "data_parallel.h"
+#include "profiler.h"
+
+namespace pik {
+namespace SIMD_NAMESPACE {
+namespace {
+
+template <class DC_Op>
+void TransposedScaledIDCT_Func(const void*, const ConstImageViewF* in,
+                               const OutputRegion& output_region,
+                               const MutableImageViewF* PIK_RESTRICT out) {
+  PROFILER_ZONE("|| IDCT");
+  const size_t xsize = output_region.xsize;
+  const size_t ysize = output_region.ysize;
+
+  const size_t stride = out->bytes_per_row() / sizeof(float);
+
+  for (int c = 0; c < 3; ++c) {
+    // x,y = top-left corner of 8x8 output block; 0,0 is the top-left of
+    // the current output tile.
+    for (size_t y = 0; y < ysize; y += kBlockHeight) {
+      const float* PIK_RESTRICT row_in = in[c].ConstRow(y / kBlockHeight);
+      float* PIK_RESTRICT row_out = out[c].Row(y);
+
+      for (size_t x = 0; x < xsize; x += kBlockWidth) {
+        ComputeTransposedScaledBlockIDCTFloat(
+            FromBlock(row_in + x * kBlockWidth), ToLines(row_out + x, stride),
+            DC_Op());
+      }
+    }
+  }
+}
+
+void TransposedScaledDCT_Func(const void*, const ConstImageViewF* in,
+                              const OutputRegion& output_region,
+                              const MutableImageViewF* PIK_RESTRICT out) {
+  PROFILER_ZONE("|| DCT");
+  // In units of coefficients; each row holds the blocks of 8 input rows.
+  const size_t xsize = output_region.xsize;
+  const size_t ysize = output_region.ysize;
+
+  for (int c = 0; c < 3; ++c) {
+    const size_t stride = in[c].bytes_per_row() / sizeof(float);
+    for (size_t y = 0; y < ysize; ++y) {
+      const float* PIK_RESTRICT row_in = in[c].ConstRow(y * kBlockHeight);
+      float* PIK_RESTRICT row_out = out[c].Row(y);
+
+      for (size_t x = 0; x < xsize; x += kBlockSize) {
+        ComputeTransposedScaledBlockDCTFloat(
+            FromLines(row_in + x / kBlockWidth, stride),
+            ScaleToBlock(row_out + x));
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace SIMD_NAMESPACE
+
+template <>
+Image3F TransposedScaledDCTImpl::operator()<SIMD_TARGET>(
+    const Image3F& img, ThreadPool* pool) const {
+  PIK_ASSERT(img.ysize() % kBlockHeight == 0);
+  const size_t xsize = img.xsize() * kBlockWidth;
+  const size_t ysize = img.ysize() / kBlockWidth;
+  Image3F coeffs(xsize, ysize);
+
+  pool->Run(0, ysize, [&img, &coeffs](const int task, const int thread) {
+    const size_t y = task;
+    for (int c = 0; c < 3; ++c) {
+      const size_t stride = img.PlaneRow(c, 1) - img.PlaneRow(c, 0);
+      const float* PIK_RESTRICT row_in = img.PlaneRow(c, y * kBlockHeight);
+      float* PIK_RESTRICT row_out = coeffs.PlaneRow(c, y);
+
+      for (size_t x = 0; x < coeffs.xsize(); x += kBlockSize) {
+        ComputeTransposedScaledBlockDCTFloat(
+            FromLines(row_in + x / kBlockWidth, stride),
+            ScaleToBlock(row_out + x));
+      }
+    }
+  });
+  return coeffs;
+}
+
+template <>
+TFFunc TransposedScaledIDCTFuncImpl::operator()<SIMD_TARGET>(
+    const bool zero_dc) const {
+  return zero_dc ? &SIMD_NAMESPACE::TransposedScaledIDCT_Func<DC_Zero>
+                 : &SIMD_NAMESPACE::TransposedScaledIDCT_Func<DC_Unchanged>;
+}
+
+template <>
+TFFunc TransposedScaledDCTFuncImpl::operator()<SIMD_TARGET>() const {
+  return &SIMD_NAMESPACE::TransposedScaledDCT_Func;
+}
+
+}  // namespace pik
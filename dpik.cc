@@ -15,10 +15,14 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 
 #define PROFILER_ENABLED 1
 #include "arch_specific.h"
 #include "args.h"
+#include "cache_aligned.h"
 #include "gamma_correct.h"
 #include "image.h"
 #include "image_io.h"
@@ -39,14 +43,59 @@ struct DecompressArgs {
       if (argv[i][0] == '-') {
         if (strcmp(argv[i], "--16bit") == 0) {
           sixteen_bit = true;
+        } else if (strcmp(argv[i], "--linear") == 0) {
+          params.encoding = SampleEncoding::kLinear;
+        } else if (strcmp(argv[i], "--display_p3") == 0) {
+          params.primaries = ColorPrimaries::kDisplayP3;
+        } else if (strcmp(argv[i], "--rec2020") == 0) {
+          params.primaries = ColorPrimaries::kRec2020;
+        } else if (strcmp(argv[i], "--info") == 0) {
+          info = true;
+        } else if (strcmp(argv[i], "--jpeg") == 0) {
+          jpeg = true;
+        } else if (strcmp(argv[i], "--frames") == 0) {
+          frames = true;
+        } else if (strcmp(argv[i], "--jpeg_restart") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &params.jpeg_restart_interval)) {
+            return false;
+          }
+        } else if (strcmp(argv[i], "-v") == 0) {
+          verbose = true;
         } else if (strcmp(argv[i], "--denoise") == 0) {
           if (!ParseOverride(argc, argv, &i, &params.denoise)) return false;
+        } else if (strcmp(argv[i], "--fast_preview") == 0) {
+          params.fast_preview = true;
+        } else if (strcmp(argv[i], "--dc_preview") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &params.dc_preview)) return false;
+        } else if (strcmp(argv[i], "--downscale") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &params.downscale)) return false;
+        } else if (strcmp(argv[i], "--premultiply") == 0) {
+          params.alpha_output = AlphaOutput::kPremultiplied;
+        } else if (strcmp(argv[i], "--background") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &background)) return false;
+          params.alpha_output = AlphaOutput::kBlend;
+        } else if (strcmp(argv[i], "--compact_ac") == 0) {
+          params.compact_coefficients = true;
         } else if (strcmp(argv[i], "--num_threads") == 0) {
           if (!ParseUnsigned(argc, argv, &i, &num_threads)) return false;
+        } else if (strcmp(argv[i], "--pin_threads") == 0) {
+          pin_threads = true;
+        } else if (strcmp(argv[i], "--huge_pages") == 0) {
+          huge_pages = true;
+        } else if (strcmp(argv[i], "--png_level") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &png_level)) return false;
         } else if (strcmp(argv[i], "--num_reps") == 0) {
           if (!ParseUnsigned(argc, argv, &i, &num_reps)) return false;
         } else if (strcmp(argv[i], "--print_profile") == 0) {
           if (!ParseOverride(argc, argv, &i, &print_profile)) return false;
+        } else if (strcmp(argv[i], "--profile_samples") == 0) {
+          if (!ParseUnsigned(argc, argv, &i, &profile_samples)) return false;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+          if (i + 1 >= argc) {
+            fprintf(stderr, "Missing filename after --trace.\n");
+            return false;
+          }
+          trace = argv[++i];
         } else {
           fprintf(stderr, "Unrecognized argument: %s.\n", argv[i]);
           return false;
@@ -67,55 +116,130 @@ struct DecompressArgs {
       fprintf(stderr, "Missing input filename.\n");
       return false;
     }
+    if (png_level > 9) {
+      fprintf(stderr, "--png_level must be at most 9.\n");
+      return false;
+    }
+    if (params.jpeg_restart_interval > 0xFFFF) {
+      fprintf(stderr, "--jpeg_restart must be at most 65535.\n");
+      return false;
+    }
+    if (params.encoding != SampleEncoding::kSRGB && !sixteen_bit) {
+      fprintf(stderr, "--linear requires --16bit.\n");
+      return false;
+    }
+    if (params.primaries != ColorPrimaries::kSRGB && frames) {
+      fprintf(stderr, "--display_p3/--rec2020 do not support --frames.\n");
+      return false;
+    }
+    if (frames && (sixteen_bit || jpeg)) {
+      fprintf(stderr, "--frames does not support --16bit or --jpeg.\n");
+      return false;
+    }
+    if (background > 255) {
+      fprintf(stderr, "--background must be at most 255.\n");
+      return false;
+    }
+    params.background = static_cast<uint8_t>(background);
+    if (params.alpha_output != AlphaOutput::kSeparate &&
+        (sixteen_bit || frames)) {
+      fprintf(stderr,
+              "--premultiply/--background do not support --16bit or "
+              "--frames.\n");
+      return false;
+    }
 
     return true;
   }
 
   static const char* HelpFormatString() {
-    return "Usage: %s [--16bit] [--denoise B] [--num_threads N]\n"
-           "  [--num_reps N] [--print_profile B] in.pik [out.png]\n"
+    return "Usage: %s [--16bit] [--linear] [--display_p3] [--rec2020]\n"
+           "  [--info] [--jpeg] [--frames] [-v]\n"
+           "  [--jpeg_restart N] [--denoise B] [--fast_preview] [--dc_preview N] [--downscale N]\n"
+           "  [--premultiply] [--background N] [--compact_ac]\n"
+           "  [--num_threads N] [--pin_threads] [--huge_pages] [--num_reps N]\n"
+           "  [--png_level N] [--print_profile B] [--profile_samples N]\n"
+           "  [--trace out.json]\n"
+           "  in.pik [out.png]\n"
            "  The output is 16 bit if --16bit is set, otherwise 8-bit sRGB.\n"
+           "  --linear: with --16bit, skip the sRGB transfer function, i.e.\n"
+           "    write linear light (e.g. for compositing).\n"
+           "  --display_p3, --rec2020: convert to these primaries in the\n"
+           "    decoder's color conversion (same cost as sRGB). The PNG is\n"
+           "    not tagged with their color space.\n"
            "  B is a boolean (0/1), N an unsigned integer.\n"
+           "  --info: only print the image size and properties; no decoding.\n"
+           "  --jpeg: write the JPEG stored in a Brunsli bitstream to out.jpg\n"
+           "    without decoding pixels.\n"
+           "  --jpeg_restart N: with --jpeg, insert a restart marker every N\n"
+           "    MCUs and encode the intervals in parallel.\n"
+           "  --frames: decode each frame of a multi-frame stream (cpik\n"
+           "    --frames --lossless) to out-00000.png, out-00001.png etc.\n"
+           "  -v: print the time spent in each decoder stage.\n"
            "  --denoise 1: enable deringing/deblocking postprocessor.\n"
-           "  --print_profile 1: print timing information before exiting.\n";
+           "  --fast_preview: skip denoising, noise, dithering and Gaborish\n"
+           "    and use the blockier DC prediction; about 2x faster.\n"
+           "  --dc_preview N: only decode DC; 1:N preview (N = 2, 4 or 8).\n"
+           "  --downscale N: decode at 1:N resolution (N = 2 or 4); faster\n"
+           "    than a full decode, but Gaborish is approximated.\n"
+           "    With a pyramid (cpik --pyramid), also larger powers of two,\n"
+           "    which only decode the nearest smaller copy.\n"
+           "  --premultiply: premultiply color by alpha during the decoder's\n"
+           "    color conversion.\n"
+           "  --background N: instead blend over gray level N (0-255) and\n"
+           "    drop the alpha channel.\n"
+           "  --compact_ac: store the AC coefficients as half-floats; halves\n"
+           "    the decoder's largest allocation.\n"
+           "  --pin_threads: pin each worker thread to one CPU, filling\n"
+           "    NUMA nodes in order.\n"
+           "  --huge_pages: back large images with transparent huge pages\n"
+           "    (Linux), which reduces page faults/TLB misses.\n"
+           "  --png_level N: zlib level (0-9) of out.png; default 6.\n"
+           "  --print_profile 1: print timing information before exiting.\n"
+           "  --profile_samples N: only record every N-th profiler zone and\n"
+           "    print their sampled durations before exiting.\n"
+           "  --trace: write a per-thread timeline of profiler zones in\n"
+           "    Chrome Trace Event format (chrome://tracing).\n";
   }
 
   const char* file_in = nullptr;
   const char* file_out = nullptr;
   bool sixteen_bit = false;
+  bool info = false;
+  bool jpeg = false;
+  bool frames = false;
+  bool verbose = false;
+  size_t background = 255;
   DecompressParams params;
   size_t num_threads = 8;
+  bool pin_threads = false;
+  bool huge_pages = false;
   size_t num_reps = 1;
+  size_t png_level = 6;
   Override print_profile = Override::kDefault;
+  size_t profile_samples = 0;  // Sampling interval; 0 = disabled.
+  const char* trace = nullptr;
 };
 
-bool LoadFile(const char* pathname, PaddedBytes* compressed) {
-  FILE* f = fopen(pathname, "rb");
-  if (f == nullptr) {
+// Maps the file rather than copying it to the heap; "compressed" is a view
+// into "file" and must not outlive it.
+bool LoadFile(const char* pathname, MappedFile* file, PaddedBytes* compressed) {
+  if (!file->Open(pathname)) {
     fprintf(stderr, "Failed to open %s.\n", pathname);
     return false;
   }
-
-  if (fseek(f, 0, SEEK_END) != 0) {
-    fprintf(stderr, "Seek error at end.\n");
-    return false;
-  }
-  compressed->resize(ftell(f));
-  if (fseek(f, 0, SEEK_SET) != 0) {
-    fprintf(stderr, "Seek error at beginning.\n");
-    return false;
-  }
-
-  const size_t bytes_read = fread(compressed->data(), 1, compressed->size(), f);
-  if (bytes_read != compressed->size()) {
-    fprintf(stderr, "I/O error, only read %zu bytes.\n", bytes_read);
-    return false;
-  }
+  *compressed = PaddedBytes::View(file->data(), file->size());
   fprintf(stderr, "Read %zu compressed bytes\n", compressed->size());
-  fclose(f);
   return true;
 }
 
+// Before any (large) allocation.
+void SetHugePageOptions() {
+  AllocationOptions options;
+  options.huge_page_threshold = 2 * kHugePageSize;
+  CacheAligned::SetOptions(options);
+}
+
 void InitThreads(ThreadPool* pool) {
   // Warm up profiler on main AND worker threads so its expensive initialization
   // doesn't count towards the timer measurements below for decode throughput.
@@ -130,12 +254,26 @@ void InitThreads(ThreadPool* pool) {
   });
 }
 
+bool PrintInfo(const PaddedBytes& compressed) {
+  PikBasicInfo info;
+  if (!PikProbe(compressed.data(), compressed.size(), &info)) {
+    fprintf(stderr, "Failed to parse header.\n");
+    return false;
+  }
+  static const char* kBitstreams[] = {"default", "lossless", "brunsli"};
+  const char* bitstream =
+      info.bitstream < 3 ? kBitstreams[info.bitstream] : "unknown";
+  printf("%u x %u, %u components%s, %s bitstream\n", info.xsize, info.ysize,
+         info.num_components, info.has_alpha ? " + alpha" : "", bitstream);
+  return true;
+}
+
 template <typename ComponentType>
 bool Decompress(const PaddedBytes& compressed, const DecompressParams& params,
-                ThreadPool* pool, MetaImage<ComponentType>* image) {
-  PikInfo info;
+                ThreadPool* pool, PikDecoder* decoder,
+                MetaImage<ComponentType>* image, PikInfo* info) {
   const uint64_t t0 = Start<uint64_t>();
-  if (!PikToPixels(params, compressed, pool, image, &info)) {
+  if (!decoder->Decode(params, compressed, pool, image, info)) {
     fprintf(stderr, "Failed to decompress.\n");
     return false;
   }
@@ -155,13 +293,26 @@ template <typename ComponentType>
 bool DecompressAndWrite(const PaddedBytes& compressed,
                         const DecompressArgs& args, ThreadPool* pool) {
   MetaImage<ComponentType> image;
+  // Reused across repetitions, as recommended for decoding many images.
+  PikDecoder decoder;
+  PikInfo total_info;
   for (size_t i = 0; i < args.num_reps; ++i) {
-    if (!Decompress(compressed, args.params, pool, &image)) return false;
+    PikInfo info;
+    if (!Decompress(compressed, args.params, pool, &decoder, &image, &info)) {
+      return false;
+    }
+    total_info.Assimilate(info);
+  }
+  if (args.verbose) {
+    total_info.PrintStages(args.num_reps);
+    printf("Peak allocated: %.2f MiB\n",
+           AllocationStats::PeakBytes() / (1024.0 * 1024));
   }
 
   // Writing large PNGs is slow, so allow skipping it for benchmarks.
   if (args.file_out != nullptr) {
-    if (!WriteImage(ImageFormatPNG(), image, args.file_out)) {
+    const ImageFormatPNG format(static_cast<int>(args.png_level), pool);
+    if (!WriteImage(format, image, args.file_out)) {
       fprintf(stderr, "Failed to write %s.\n", args.file_out);
       return false;
     }
@@ -170,12 +321,105 @@ bool DecompressAndWrite(const PaddedBytes& compressed,
   return true;
 }
 
+// Returns "pathname" with "-<frame>" inserted before the extension (if any).
+std::string FrameFilename(const std::string& pathname, const size_t frame) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "-%05zu", frame);
+  const size_t slash = pathname.find_last_of('/');
+  const size_t dot = pathname.find_last_of('.');
+  const size_t pos = (dot == std::string::npos ||
+                      (slash != std::string::npos && dot < slash))
+                         ? pathname.size()
+                         : dot;
+  return pathname.substr(0, pos) + suffix + pathname.substr(pos);
+}
+
+// Decodes all frames of a multi-frame stream (see PikFrameToPixels), which
+// only touches the groups that changed, and writes each to a numbered PNG.
+bool DecompressFrames(const PaddedBytes& compressed, const DecompressArgs& args,
+                      ThreadPool* pool) {
+  const ImageFormatPNG format(static_cast<int>(args.png_level), pool);
+  MetaImageB frame;
+  size_t pos = 0;
+  size_t num_frames = 0;
+  double elapsed = 0.0;
+  while (pos != compressed.size()) {
+    const uint64_t t0 = Start<uint64_t>();
+    if (!PikFrameToPixels(args.params, compressed, &pos, pool, &frame)) {
+      fprintf(stderr, "Failed to decompress frame %zu.\n", num_frames);
+      return false;
+    }
+    const uint64_t t1 = Stop<uint64_t>();
+    elapsed += (t1 - t0) / InvariantTicksPerSecond();
+    if (args.file_out != nullptr) {
+      const std::string filename = FrameFilename(args.file_out, num_frames);
+      if (!WriteImage(format, frame, filename.c_str())) {
+        fprintf(stderr, "Failed to write %s.\n", filename.c_str());
+        return false;
+      }
+    }
+    ++num_frames;
+  }
+  fprintf(stderr, "Decompressed %zu frames of %zu x %zu pixels (%.2f fps).\n",
+          num_frames, frame.xsize(), frame.ysize(),
+          num_frames / std::max(elapsed, 1E-9));
+  return true;
+}
+
+// Receives the output of PikToJpeg. Only counts the bytes if "file" is null.
+struct JpegSink {
+  FILE* file = nullptr;
+  size_t bytes = 0;
+};
+
+int WriteJpegBytes(void* opaque, const uint8_t* buf, size_t len) {
+  JpegSink* sink = static_cast<JpegSink*>(opaque);
+  if (sink->file != nullptr && fwrite(buf, 1, len, sink->file) != len) {
+    return -1;
+  }
+  sink->bytes += len;
+  return static_cast<int>(len);
+}
+
+bool DecompressToJpeg(const PaddedBytes& compressed,
+                      const DecompressArgs& args, ThreadPool* pool) {
+  for (size_t i = 0; i < args.num_reps; ++i) {
+    JpegSink sink;
+    // Only the last repetition is written.
+    const bool write = args.file_out != nullptr && i + 1 == args.num_reps;
+    if (write) {
+      sink.file = fopen(args.file_out, "wb");
+      if (sink.file == nullptr) {
+        fprintf(stderr, "Failed to open %s.\n", args.file_out);
+        return false;
+      }
+    }
+    const uint64_t t0 = Start<uint64_t>();
+    const bool ok = PikToJpeg(args.params, compressed, pool,
+                              guetzli::JPEGOutput(WriteJpegBytes, &sink));
+    const uint64_t t1 = Stop<uint64_t>();
+    if (write && fclose(sink.file) != 0) {
+      fprintf(stderr, "Failed to write %s.\n", args.file_out);
+      return false;
+    }
+    if (!ok) {
+      fprintf(stderr, "Failed to reconstruct JPEG.\n");
+      return false;
+    }
+    const double elapsed = (t1 - t0) / InvariantTicksPerSecond();
+    fprintf(stderr, "Reconstructed %zu JPEG bytes (%.2f MB/s, %zu threads).\n",
+            sink.bytes, sink.bytes * 1E-6 / elapsed, pool->NumThreads());
+  }
+  return true;
+}
+
 int Run(int argc, char* argv[]) {
   DecompressArgs args;
   if (!args.Init(argc, argv)) {
     fprintf(stderr, DecompressArgs::HelpFormatString(), argv[0]);
     return 1;
   }
+  if (args.huge_pages) SetHugePageOptions();
 
 #if SIMD_ENABLE_AVX2
   if ((dispatch::SupportedTargets() & SIMD_AVX2) == 0) {
@@ -187,23 +431,46 @@ int Run(int argc, char* argv[]) {
     fprintf(stderr, "Cannot continue because CPU lacks SSE4 support.\n");
     return 1;
   }
+#elif SIMD_ENABLE_SVE256
+  if ((dispatch::SupportedTargets() & SIMD_SVE256) == 0) {
+    fprintf(stderr,
+            "Cannot continue because CPU lacks 256-bit SVE support.\n");
+    return 1;
+  }
 #endif
 
+  MappedFile file;
   PaddedBytes compressed;
-  if (!LoadFile(args.file_in, &compressed)) {
+  if (!LoadFile(args.file_in, &file, &compressed)) {
     return 1;
   }
 
-  ThreadPool pool(static_cast<int>(args.num_threads));
+  if (args.info) return PrintInfo(compressed) ? 0 : 1;
+
+  ThreadPool pool(static_cast<int>(args.num_threads),
+                  args.pin_threads ? CPUsForThreads(args.num_threads)
+                                   : std::vector<int>());
   InitThreads(&pool);
+  if (args.trace != nullptr) PROFILER_ENABLE_TRACE();
+  if (args.profile_samples != 0) {
+    PROFILER_SET_SAMPLING(static_cast<uint32_t>(args.profile_samples),
+                          /*top_level_only=*/false);
+  }
 
-  const auto decompressor = args.sixteen_bit ? &DecompressAndWrite<uint16_t>
-                                             : &DecompressAndWrite<uint8_t>;
+  auto decompressor = args.sixteen_bit ? &DecompressAndWrite<uint16_t>
+                                       : &DecompressAndWrite<uint8_t>;
+  if (args.jpeg) decompressor = &DecompressToJpeg;
+  if (args.frames) decompressor = &DecompressFrames;
   if (!decompressor(compressed, args, &pool)) return 1;
 
+  if (args.trace != nullptr && !PROFILER_WRITE_TRACE(args.trace)) {
+    fprintf(stderr, "Failed to write %s.\n", args.trace);
+    return 1;
+  }
   if (args.print_profile == Override::kOn) {
     PROFILER_PRINT_RESULTS();
   }
+  if (args.profile_samples != 0) PROFILER_PRINT_SAMPLES();
 
   return 0;
 }
@@ -0,0 +1,299 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "encode_cache.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "os_specific.h"
+#include "profiler.h"
+
+namespace pik {
+namespace {
+
+// Increment whenever the encoder output changes for the same input, so that
+// stale entries are no longer found.
+constexpr uint64_t kEncoderVersion = 3;
+
+constexpr char kSuffix[] = ".pik";
+constexpr size_t kSuffixLength = sizeof(kSuffix) - 1;
+constexpr size_t kKeyLength = 32;  // Hex digits.
+
+// Two multiply-xorshift lanes over 8-byte words; about an order of magnitude
+// faster than FNV-1a's byte at a time, which matters for large images.
+class KeyHasher {
+ public:
+  void Update(const void* data, const size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      uint64_t word;
+      memcpy(&word, bytes + i, 8);
+      Mix(word);
+    }
+    // Remaining bytes and their number, so that inputs of different lengths
+    // differ even if zero-padded.
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + i, size - i);
+    Mix(tail ^ (static_cast<uint64_t>(size - i) << 56));
+  }
+
+  template <typename T>
+  void UpdateValue(const T value) {
+    Update(&value, sizeof(value));
+  }
+
+  EncodeCacheKey Finish() const {
+    EncodeCacheKey key;
+    key.hash[0] = Finalize(h0_ ^ h1_);
+    key.hash[1] = Finalize(h1_ + h0_ * 3);
+    return key;
+  }
+
+ private:
+  void Mix(const uint64_t word) {
+    h0_ = (h0_ ^ word) * 0x9E3779B97F4A7C15ull;
+    h0_ ^= h0_ >> 29;
+    h1_ = (h1_ + word) * 0xC2B2AE3D27D4EB4Full;
+    h1_ = (h1_ << 31) | (h1_ >> 33);
+  }
+
+  // Avalanche (MurmurHash3 fmix64).
+  static uint64_t Finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  uint64_t h0_ = 0xCBF29CE484222325ull;
+  uint64_t h1_ = 0x84222325CBF29CE4ull;
+};
+
+// All fields that affect the bitstream, in declaration order.
+void HashParams(const CompressParams& params, KeyHasher* hasher) {
+  hasher->UpdateValue(kEncoderVersion);
+  hasher->UpdateValue(params.jpeg_quality);
+  hasher->UpdateValue(params.jpeg_chroma_subsampling);
+  hasher->UpdateValue(params.clear_metadata);
+  hasher->UpdateValue(params.effort);
+  hasher->UpdateValue(params.butteraugli_distance);
+  hasher->UpdateValue(params.target_size);
+  hasher->UpdateValue(params.target_bitrate);
+  hasher->UpdateValue(params.target_size_search_fast_mode);
+  hasher->UpdateValue(params.uniform_quant);
+  hasher->UpdateValue(params.quant_border_bias);
+  hasher->UpdateValue(params.fast_mode);
+  hasher->UpdateValue(params.max_butteraugli_iters);
+  hasher->UpdateValue(params.time_budget_ms);
+  hasher->UpdateValue(params.butteraugli_proxy_iters);
+  hasher->UpdateValue(params.guetzli_mode);
+  hasher->UpdateValue(params.max_butteraugli_iters_guetzli_mode);
+  hasher->UpdateValue(params.hq_search_candidates);
+  hasher->UpdateValue(params.denoise);
+  hasher->UpdateValue(params.apply_noise);
+  hasher->UpdateValue(params.grayscale);
+  hasher->UpdateValue(params.noise_patch_stride);
+  hasher->UpdateValue(params.use_brunsli_v2);
+  hasher->UpdateValue(params.lossless);
+  hasher->UpdateValue(params.palette);
+  hasher->UpdateValue(params.pyramid_levels);
+  hasher->UpdateValue(params.num_ans_states);
+  hasher->UpdateValue(params.static_histograms);
+  hasher->UpdateValue(params.group_size_in_tiles);
+  hasher->UpdateValue(params.hf_asymmetry);
+}
+
+template <typename T>
+EncodeCacheKey ComputeKey(const CompressParams& params,
+                          const MetaImage<T>& image) {
+  PROFILER_FUNC;
+  KeyHasher hasher;
+  HashParams(params, &hasher);
+  hasher.UpdateValue(sizeof(T));  // MetaImageB and MetaImageF differ.
+  hasher.UpdateValue(image.xsize());
+  hasher.UpdateValue(image.ysize());
+  const Image3<T>& color = image.GetColor();
+  for (int c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < image.ysize(); ++y) {
+      hasher.Update(color.ConstPlaneRow(c, y), image.xsize() * sizeof(T));
+    }
+  }
+  hasher.UpdateValue(image.AlphaBitDepth());
+  if (image.HasAlpha()) {
+    const ImageU& alpha = image.GetAlpha();
+    for (size_t y = 0; y < image.ysize(); ++y) {
+      hasher.Update(alpha.ConstRow(y), image.xsize() * sizeof(uint16_t));
+    }
+  }
+  return hasher.Finish();
+}
+
+// Returns whether "name" is "<key>.pik".
+bool IsEntryName(const std::string& name) {
+  if (name.size() != kKeyLength + kSuffixLength) return false;
+  if (name.compare(kKeyLength, kSuffixLength, kSuffix) != 0) return false;
+  for (size_t i = 0; i < kKeyLength; ++i) {
+    if (!isxdigit(static_cast<unsigned char>(name[i]))) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::string EncodeCacheKey::ToString() const {
+  char hex[kKeyLength + 1];
+  snprintf(hex, sizeof(hex), "%016llx%016llx",
+           static_cast<unsigned long long>(hash[0]),
+           static_cast<unsigned long long>(hash[1]));
+  return hex;
+}
+
+EncodeCacheKey ComputeEncodeCacheKey(const CompressParams& params,
+                                     const MetaImageB& image) {
+  return ComputeKey(params, image);
+}
+
+EncodeCacheKey ComputeEncodeCacheKey(const CompressParams& params,
+                                     const MetaImageF& image) {
+  return ComputeKey(params, image);
+}
+
+void EncodeCacheStats::Print() const {
+  const size_t lookups = hits + misses;
+  fprintf(stderr,
+          "Encode cache: %zu hits, %zu misses (%.1f%% hit rate), %zu "
+          "inserts, %zu evictions; %zu entries, %.2f MB\n",
+          hits, misses, lookups == 0 ? 0.0 : 100.0 * hits / lookups, inserts,
+          evictions, num_entries, total_bytes * 1E-6);
+}
+
+DiskLRUEncodeCache::DiskLRUEncodeCache(const std::string& directory,
+                                       const size_t max_bytes)
+    : directory_(directory), max_bytes_(max_bytes) {
+  std::vector<DirectoryEntry> files;
+  if (!ListDirectory(directory_, &files)) {
+    fprintf(stderr, "Cannot list encode cache %s, starting empty.\n",
+            directory_.c_str());
+  }
+  // Most recently modified first.
+  std::sort(files.begin(), files.end(),
+            [](const DirectoryEntry& a, const DirectoryEntry& b) {
+              return a.mtime > b.mtime;
+            });
+  for (const DirectoryEntry& file : files) {
+    if (!IsEntryName(file.name)) continue;
+    const std::string name = file.name.substr(0, kKeyLength);
+    lru_.push_back(Entry{name, file.size});
+    index_[name] = std::prev(lru_.end());
+    stats_.total_bytes += file.size;
+  }
+  stats_.num_entries = lru_.size();
+  EvictToCapacity();
+}
+
+std::string DiskLRUEncodeCache::Path(const std::string& name) const {
+  return directory_ + "/" + name + kSuffix;
+}
+
+void DiskLRUEncodeCache::MarkUsed(const EntryList::iterator entry) {
+  lru_.splice(lru_.begin(), lru_, entry);
+  (void)TouchFile(Path(entry->name));
+}
+
+void DiskLRUEncodeCache::EvictToCapacity() {
+  while (stats_.total_bytes > max_bytes_ && !lru_.empty()) {
+    const Entry& oldest = lru_.back();
+    remove(Path(oldest.name).c_str());
+    stats_.total_bytes -= oldest.size;
+    index_.erase(oldest.name);
+    lru_.pop_back();
+    stats_.evictions += 1;
+  }
+  stats_.num_entries = lru_.size();
+}
+
+bool DiskLRUEncodeCache::Lookup(const EncodeCacheKey& key,
+                                PaddedBytes* compressed) {
+  PROFILER_FUNC;
+  const std::string name = key.ToString();
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = index_.find(name);
+  if (it == index_.end()) {
+    stats_.misses += 1;
+    return false;
+  }
+
+  MappedFile file;
+  if (!file.Open(Path(name)) || file.size() != it->second->size) {
+    // Removed or replaced by another process: forget it.
+    stats_.total_bytes -= it->second->size;
+    lru_.erase(it->second);
+    index_.erase(it);
+    stats_.num_entries = lru_.size();
+    stats_.misses += 1;
+    return false;
+  }
+  compressed->resize(file.size());
+  memcpy(compressed->data(), file.data(), file.size());
+  MarkUsed(it->second);
+  stats_.hits += 1;
+  return true;
+}
+
+void DiskLRUEncodeCache::Insert(const EncodeCacheKey& key,
+                                const PaddedBytes& compressed) {
+  PROFILER_FUNC;
+  if (compressed.size() > max_bytes_) return;
+  const std::string name = key.ToString();
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = index_.find(name);
+  if (it != index_.end()) {
+    MarkUsed(it->second);
+    return;
+  }
+
+  // Write to a temporary file and rename, so that concurrent readers (also in
+  // other processes) never see a partial entry.
+  const std::string path = Path(name);
+  const std::string temp_path = path + ".tmp";
+  FILE* f = fopen(temp_path.c_str(), "wb");
+  if (f == nullptr) return;
+  const size_t written = fwrite(compressed.data(), 1, compressed.size(), f);
+  if (fclose(f) != 0 || written != compressed.size() ||
+      rename(temp_path.c_str(), path.c_str()) != 0) {
+    remove(temp_path.c_str());
+    return;
+  }
+
+  lru_.push_front(Entry{name, compressed.size()});
+  index_[name] = lru_.begin();
+  stats_.total_bytes += compressed.size();
+  stats_.inserts += 1;
+  EvictToCapacity();
+}
+
+EncodeCacheStats DiskLRUEncodeCache::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace pik
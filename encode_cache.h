@@ -0,0 +1,121 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ENCODE_CACHE_H_
+#define ENCODE_CACHE_H_
+
+// Cache of encoder results keyed by a hash of the input pixels and params,
+// so that front-ends (e.g. cpik --batch) can skip re-encoding duplicates.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "image.h"
+#include "padded_bytes.h"
+#include "pik_params.h"
+
+namespace pik {
+
+// 128-bit hash of an encoder input. Not cryptographic: accidental collisions
+// are negligible, but callers must not share a cache with untrusted parties
+// able to craft colliding inputs.
+struct EncodeCacheKey {
+  bool operator==(const EncodeCacheKey& other) const {
+    return hash[0] == other.hash[0] && hash[1] == other.hash[1];
+  }
+
+  // 32 lowercase hex digits.
+  std::string ToString() const;
+
+  uint64_t hash[2];
+};
+
+// Returns the key for encoding "image" (including alpha) with "params". Only
+// params that affect the bitstream are included (e.g. not "verbose").
+EncodeCacheKey ComputeEncodeCacheKey(const CompressParams& params,
+                                     const MetaImageB& image);
+EncodeCacheKey ComputeEncodeCacheKey(const CompressParams& params,
+                                     const MetaImageF& image);
+
+struct EncodeCacheStats {
+  void Print() const;
+
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t inserts = 0;
+  size_t evictions = 0;
+  // Currently cached.
+  size_t num_entries = 0;
+  size_t total_bytes = 0;
+};
+
+// Interface for pluggable storage. Implementations must be thread-safe.
+class EncodeCache {
+ public:
+  virtual ~EncodeCache() {}
+
+  // Returns true and copies the stored bitstream into "compressed" if "key"
+  // is cached, otherwise returns false (a miss).
+  virtual bool Lookup(const EncodeCacheKey& key, PaddedBytes* compressed) = 0;
+
+  // Stores "compressed" for "key" (best-effort; may be evicted at any time).
+  virtual void Insert(const EncodeCacheKey& key,
+                      const PaddedBytes& compressed) = 0;
+
+  virtual EncodeCacheStats Stats() const = 0;
+};
+
+// Stores each bitstream as <directory>/<key>.pik and evicts the least
+// recently used entries once their total size exceeds "max_bytes". Recency
+// is persisted as the file modification time, so entries written by previous
+// runs (or other processes) are reused.
+class DiskLRUEncodeCache : public EncodeCache {
+ public:
+  // "directory" must exist; its existing entries are indexed.
+  DiskLRUEncodeCache(const std::string& directory, size_t max_bytes);
+
+  bool Lookup(const EncodeCacheKey& key, PaddedBytes* compressed) override;
+  void Insert(const EncodeCacheKey& key,
+              const PaddedBytes& compressed) override;
+  EncodeCacheStats Stats() const override;
+
+ private:
+  struct Entry {
+    std::string name;  // Key as string.
+    size_t size;
+  };
+  using EntryList = std::list<Entry>;
+
+  std::string Path(const std::string& name) const;
+  // Moves "entry" to the front of lru_ and touches its file.
+  void MarkUsed(EntryList::iterator entry);
+  // Removes the least recently used entries until total_bytes <= max_bytes_.
+  void EvictToCapacity();
+
+  const std::string directory_;
+  const size_t max_bytes_;
+
+  mutable std::mutex mutex_;
+  EntryList lru_;  // Most recently used first.
+  std::unordered_map<std::string, EntryList::iterator> index_;
+  EncodeCacheStats stats_;
+};
+
+}  // namespace pik
+
+#endif  // ENCODE_CACHE_H_
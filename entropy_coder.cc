@@ -19,18 +19,23 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <limits>
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include "ans_params.h"
 #include "bit_reader.h"
+#include "bits.h"
 #include "common.h"
 #include "compiler_specific.h"
 #include "context_map_decode.h"
 #include "dc_predictor.h"
 #include "dc_predictor_slow.h"
 #include "fast_log.h"
+#include "profiler.h"
+#include "simd/simd.h"
+#include "static_histograms.h"
 #include "status.h"
 #include "write_bits.h"
 
@@ -124,22 +129,31 @@ void ExpandDC(const Rect& rect_dc, Image3S* PIK_RESTRICT dc,
   }
 }
 
-void ComputeCoeffOrder(const Image3S& ac, const Image3B& block_ctx,
-                       int32_t* PIK_RESTRICT order) {
-  for (uint8_t ctx = 0; ctx < kOrderContexts; ++ctx) {
-    int32_t num_zeros[kBlockSize] = {0};
-    for (int c = 0; c < 3; ++c) {
-      for (size_t y = 0; y < ac.ysize(); ++y) {
-        const int16_t* PIK_RESTRICT row = ac.PlaneRow(c, y);
-        const uint8_t* PIK_RESTRICT row_ctx = block_ctx.PlaneRow(c, y);
-        for (size_t x = 0; x < ac.xsize(); x += kDCTBlockSize) {
-          if (row_ctx[x >> 6] != ctx) continue;
-          for (size_t k = 1; k < kDCTBlockSize; ++k) {
-            if (row[x + k] == 0) ++num_zeros[k];
-          }
+void CountCoeffZeros(const Rect& rect, const Image3S& ac, const Rect& rect_ctx,
+                     const Image3B& block_ctx,
+                     uint32_t* PIK_RESTRICT num_zeros, bool grayscale) {
+  PIK_ASSERT(SameSize(rect, rect_ctx));
+  for (int c = FirstCodedPlane(grayscale); c < EndCodedPlane(grayscale); ++c) {
+    for (size_t by = 0; by < rect.ysize(); ++by) {
+      const int16_t* PIK_RESTRICT row =
+          ac.ConstPlaneRow(c, rect.y0() + by) + rect.x0() * kDCTBlockSize;
+      const uint8_t* PIK_RESTRICT row_ctx =
+          rect_ctx.ConstRow(block_ctx.Plane(c), by);
+      for (size_t bx = 0; bx < rect.xsize(); ++bx) {
+        const int16_t* PIK_RESTRICT block = row + bx * kDCTBlockSize;
+        uint32_t* PIK_RESTRICT zeros = num_zeros + row_ctx[bx] * kBlockSize;
+        for (size_t k = 1; k < kDCTBlockSize; ++k) {
+          zeros[k] += block[k] == 0;
         }
       }
     }
+  }
+}
+
+void CoeffOrderFromZeros(const uint32_t* PIK_RESTRICT num_zeros_all,
+                         int32_t* PIK_RESTRICT order) {
+  for (uint8_t ctx = 0; ctx < kOrderContexts; ++ctx) {
+    const uint32_t* PIK_RESTRICT num_zeros = num_zeros_all + ctx * kBlockSize;
     struct PosAndCount {
       uint32_t pos;
       uint32_t count;
@@ -159,6 +173,39 @@ void ComputeCoeffOrder(const Image3S& ac, const Image3B& block_ctx,
   }
 }
 
+void ComputeCoeffOrder(const Image3S& ac, const Image3B& block_ctx,
+                       ThreadPool* pool, int32_t* PIK_RESTRICT order,
+                       bool grayscale) {
+  PROFILER_FUNC;
+  const size_t xsize_blocks = block_ctx.xsize();
+  const size_t ysize_blocks = block_ctx.ysize();
+  const size_t xsize_groups = DivCeil(xsize_blocks, kGroupWidthInBlocks);
+  const size_t ysize_groups = DivCeil(ysize_blocks, kGroupHeightInBlocks);
+
+  using ZeroCounts = std::array<uint32_t, kOrderContexts * kBlockSize>;
+  std::vector<ZeroCounts> thread_zeros(std::max<size_t>(1, pool->NumThreads()),
+                                       ZeroCounts());
+  pool->Run(0, xsize_groups * ysize_groups,
+            [&](const int task, const int thread) {
+              const size_t x = task % xsize_groups;
+              const size_t y = task / xsize_groups;
+              const Rect rect(x * kGroupWidthInBlocks, y * kGroupHeightInBlocks,
+                              kGroupWidthInBlocks, kGroupHeightInBlocks,
+                              xsize_blocks, ysize_blocks);
+              CountCoeffZeros(rect, ac, rect, block_ctx,
+                              thread_zeros[thread].data(), grayscale);
+            });
+
+  // Integer sums, hence independent of the task/thread assignment.
+  ZeroCounts& num_zeros = thread_zeros[0];
+  for (size_t i = 1; i < thread_zeros.size(); ++i) {
+    for (size_t j = 0; j < num_zeros.size(); ++j) {
+      num_zeros[j] += thread_zeros[i][j];
+    }
+  }
+  CoeffOrderFromZeros(num_zeros.data(), order);
+}
+
 void EncodeCoeffOrder(const int32_t* PIK_RESTRICT order,
                       size_t* PIK_RESTRICT storage_ix, uint8_t* storage) {
   const int32_t kJPEGZigZagOrder[kBlockSize] = {
@@ -313,16 +360,55 @@ PIK_INLINE void EncodeCoeff(int32_t coeff, int* nbits, int* bits) {
   *bits = coeff_bits & ((1 << *nbits) - 1);
 }
 
-std::vector<Token> TokenizeCoefficients(const int32_t* orders, const Rect& rect,
-                                        const ImageI& quant_field,
-                                        const Image3S& coeffs,
-                                        const Image3B& block_ctx) {
+// Returns bits 0, 2, .., 62 of "x" in the lower half.
+PIK_INLINE uint64_t CompactEvenBits(uint64_t x) {
+  x &= 0x5555555555555555ull;
+  x = (x | (x >> 1)) & 0x3333333333333333ull;
+  x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+  return (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+}
+
+// Returns a mask with bit k set iff block[k] (natural order) is nonzero.
+// "block" must be vector-aligned.
+PIK_INLINE uint64_t NonzeroMask(const int16_t* PIK_RESTRICT block) {
+#if SIMD_TARGET_VALUE == SIMD_NONE
+  uint64_t mask = 0;
+  for (size_t k = 0; k < kBlockSize; ++k) {
+    mask |= static_cast<uint64_t>(block[k] != 0) << k;
+  }
+  return mask;
+#else
+  using namespace SIMD_NAMESPACE;
+  constexpr Full<int16_t> d16;
+  constexpr Full<uint8_t> d8;
+  const auto zero = setzero(d16);
+  // movemask returns two (identical) bits per 16-bit lane.
+  uint64_t zero_pairs[2] = {0, 0};
+  for (size_t k = 0; k < kBlockSize; k += d16.N) {
+    const uint64_t bits =
+        ext::movemask(cast_to(d8, load(d16, block + k) == zero));
+    zero_pairs[k / 32] |= bits << (2 * (k % 32));
+  }
+  return ~(CompactEvenBits(zero_pairs[0]) |
+           (CompactEvenBits(zero_pairs[1]) << 32));
+#endif
+}
+
+namespace {
+
+// Calls visitor->VisitToken(context, symbol, nbits, bits) for each token of
+// the "rect" subset, in bitstream order. See TokenizeCoefficients.
+template <class Visitor>
+void VisitCoefficientTokens(const int32_t* orders, const Rect& rect,
+                            const ImageI& quant_field, const Image3S& coeffs,
+                            const Rect& rect_ctx, const Image3B& block_ctx,
+                            const Image3I* num_nzeros, const bool grayscale,
+                            Visitor* PIK_RESTRICT visitor) {
   const size_t xsize = rect.xsize();
   const size_t ysize = rect.ysize();
-  PIK_ASSERT(SameSize(quant_field, block_ctx));
-
-  std::vector<Token> tokens;
-  tokens.reserve(3 * coeffs.xsize() * coeffs.ysize());
+  PIK_ASSERT(SameSize(rect, rect_ctx));
 
   // Compute actual quant values from prediction residuals.
   for (size_t y = 0; y < ysize; ++y) {
@@ -333,21 +419,42 @@ std::vector<Token> TokenizeCoefficients(const int32_t* orders, const Rect& rect,
       int32_t quant_pred =
           PredictFromTopAndLeft(row_quant_top, row_quant, bx, 32);
       int32_t quant_ctx = (quant_pred - 1) >> 1;
-      tokens.emplace_back(Token(quant_ctx, row_quant[bx] - 1, 0, 0));
+      visitor->VisitToken(quant_ctx, row_quant[bx] - 1, 0, 0);
     }
   }
 
-  ImageI tmp_num_nzeros(rect.xsize(), rect.ysize());
-  for (int c = 0; c < 3; ++c) {
-    ExtractNumNZeroes(rect, coeffs.Plane(c), &tmp_num_nzeros);
+  // Scan position of each coefficient, for permuting the nonzero masks.
+  uint8_t inv_orders[kOrderContexts * kBlockSize];
+  for (size_t ctx = 0; ctx < kOrderContexts; ++ctx) {
+    for (size_t k = 0; k < kBlockSize; ++k) {
+      inv_orders[ctx * kBlockSize + orders[ctx * kBlockSize + k]] = k;
+    }
+  }
+
+  ImageI tmp_num_nzeros;
+  if (num_nzeros == nullptr) {
+    tmp_num_nzeros = ImageI(rect.xsize(), rect.ysize());
+  }
+  const Rect tmp_rect(0, 0, rect.xsize(), rect.ysize());
+  for (int c = FirstCodedPlane(grayscale); c < EndCodedPlane(grayscale); ++c) {
+    const ImageI* nzeros = &tmp_num_nzeros;
+    const Rect* nzeros_rect = &tmp_rect;
+    if (num_nzeros == nullptr) {
+      ExtractNumNZeroes(rect, coeffs.Plane(c), &tmp_num_nzeros);
+    } else {
+      nzeros = &num_nzeros->Plane(c);
+      nzeros_rect = &rect;
+    }
     for (size_t y = 0; y < ysize; ++y) {
       const int16_t* PIK_RESTRICT row =
           coeffs.ConstPlaneRow(c, rect.y0() + y) + rect.x0() * kBlockSize;
       const uint8_t* PIK_RESTRICT ctx_row =
-          rect.ConstRow(block_ctx.Plane(c), y);
-      const int32_t* PIK_RESTRICT row_nzeros = tmp_num_nzeros.ConstRow(y);
+          rect_ctx.ConstRow(block_ctx.Plane(c), y);
+      const int32_t* PIK_RESTRICT row_nzeros =
+          nzeros_rect->ConstRow(*nzeros, y);
       const int32_t* PIK_RESTRICT row_nzeros_top =
-          y % kTileHeight == 0 ? nullptr : tmp_num_nzeros.ConstRow(y - 1);
+          y % kTileHeight == 0 ? nullptr
+                               : nzeros_rect->ConstRow(*nzeros, y - 1);
       for (size_t bx = 0; bx < xsize; ++bx) {
         const int bctx = ctx_row[bx];
         const int32_t* order = &orders[bctx * kBlockSize];
@@ -355,36 +462,121 @@ std::vector<Token> TokenizeCoefficients(const int32_t* orders, const Rect& rect,
         size_t num_nzeros = row_nzeros[bx];
         int32_t nzero_ctx =
             128 + ContextFromTopAndLeft(row_nzeros_top, row_nzeros, bctx, bx);
-        tokens.emplace_back(Token(nzero_ctx, num_nzeros, 0, 0));
+        visitor->VisitToken(nzero_ctx, num_nzeros, 0, 0);
         if (num_nzeros == 0) continue;
-        int r = 0;
+
+        // Visit only the nonzero coefficients, in scan order: permute the
+        // (typically few) set bits of the mask, then iterate over them.
+        const uint8_t* PIK_RESTRICT inv_order = &inv_orders[bctx * kBlockSize];
+        uint64_t natural = NonzeroMask(block);
+        uint64_t scan = 0;
+        while (natural != 0) {
+          scan |= 1ull << inv_order[NumZeroBitsBelowLSBNonzero(natural)];
+          natural &= natural - 1;
+        }
+        scan &= ~1ull;  // DC
+        PIK_ASSERT(PopCount(scan & 0xFFFFFFFFu) + PopCount(scan >> 32) ==
+                   num_nzeros);
+
         const int histo_offset = 128 + kOrderContexts * 32 + bctx * 120;
         int histo_idx = histo_offset + ZeroDensityContext(num_nzeros - 1, 0, 4);
-        for (size_t k = 1; k < kBlockSize; ++k) {
-          int16_t coeff = block[order[k]];
-          if (coeff == 0) {
-            r++;
-            continue;
-          }
+        size_t prev_k = 0;
+        while (scan != 0) {
+          const size_t k = NumZeroBitsBelowLSBNonzero(scan);
+          scan &= scan - 1;
+          const int16_t coeff = block[order[k]];
+          int r = k - prev_k - 1;
+          prev_k = k;
           while (r > 15) {
-            tokens.emplace_back(Token(histo_idx, kIndexLut[0xf0], 0, 0));
+            visitor->VisitToken(histo_idx, kIndexLut[0xf0], 0, 0);
             r -= 16;
           }
           int nbits, bits;
           EncodeCoeff(coeff, &nbits, &bits);
           PIK_ASSERT(nbits <= 14);
           int symbol = kIndexLut[(r << 4) + nbits];
-          tokens.emplace_back(Token(histo_idx, symbol, nbits, bits));
-          r = 0;
+          visitor->VisitToken(histo_idx, symbol, nbits, bits);
           histo_idx = histo_offset + ZeroDensityContext(num_nzeros - 1, k, 4);
           --num_nzeros;
         }
       }
     }
   }
+}
+
+// Visitor for VisitCoefficientTokens that materializes the tokens.
+class TokenCollector {
+ public:
+  explicit TokenCollector(std::vector<Token>* tokens) : tokens_(tokens) {}
+
+  void VisitToken(uint32_t context, uint32_t symbol, uint32_t nbits,
+                  uint32_t bits) {
+    tokens_->emplace_back(Token(context, symbol, nbits, bits));
+  }
+
+ private:
+  std::vector<Token>* tokens_;
+};
+
+// Visitor for VisitCoefficientTokens that only updates TokenCounts.
+class SymbolCounter {
+ public:
+  explicit SymbolCounter(TokenCounts* counts)
+      : histograms_(counts->histograms.data()), counts_(counts) {}
+
+  void VisitToken(uint32_t context, uint32_t symbol, uint32_t nbits,
+                  uint32_t bits) {
+    ++histograms_[(context << 8) + symbol];
+    counts_->extra_bits += nbits;
+  }
+
+ private:
+  uint32_t* PIK_RESTRICT histograms_;
+  TokenCounts* counts_;
+};
+
+}  // namespace
+
+std::vector<Token> TokenizeCoefficients(const int32_t* orders, const Rect& rect,
+                                        const ImageI& quant_field,
+                                        const Image3S& coeffs,
+                                        const Rect& rect_ctx,
+                                        const Image3B& block_ctx,
+                                        const Image3I* num_nzeros,
+                                        bool grayscale) {
+  std::vector<Token> tokens;
+  tokens.reserve(3 * coeffs.xsize() * coeffs.ysize());
+  TokenCollector collector(&tokens);
+  VisitCoefficientTokens(orders, rect, quant_field, coeffs, rect_ctx,
+                         block_ctx, num_nzeros, grayscale, &collector);
   return tokens;
 }
 
+void TokenCounts::Assimilate(const TokenCounts& other) {
+  PIK_CHECK(histograms.size() == other.histograms.size());
+  using namespace SIMD_NAMESPACE;
+  const Full<uint32_t> d;
+  // The size is a multiple of 256 and thus of d.N.
+  uint32_t* PIK_RESTRICT to = histograms.data();
+  const uint32_t* PIK_RESTRICT from = other.histograms.data();
+  for (size_t i = 0; i < histograms.size(); i += d.N) {
+    store_unaligned(load_unaligned(d, to + i) + load_unaligned(d, from + i), d,
+                    to + i);
+  }
+  extra_bits += other.extra_bits;
+}
+
+void CountCoefficientSymbols(const int32_t* orders, const Rect& rect,
+                             const ImageI& quant_field, const Image3S& coeffs,
+                             const Rect& rect_ctx, const Image3B& block_ctx,
+                             const Image3I* num_nzeros,
+                             TokenCounts* PIK_RESTRICT counts,
+                             bool grayscale) {
+  SymbolCounter counter(counts);
+  VisitCoefficientTokens(orders, rect, quant_field, coeffs, rect_ctx,
+                         block_ctx, num_nzeros, grayscale, &counter);
+}
+
 namespace {
 
 inline double CrossEntropy(const uint32_t* counts, const size_t counts_len,
@@ -416,22 +608,27 @@ class HistogramBuilder {
   explicit HistogramBuilder(const size_t num_contexts)
       : histograms_(num_contexts) {}
 
-  void VisitSymbol(int symbol, int histo_idx) {
-    PIK_ASSERT(histo_idx < histograms_.size());
-    histograms_[histo_idx].Add(symbol);
+  // Same as visiting all symbols counted in "counts".
+  void AddCounts(const TokenCounts& counts) {
+    PIK_ASSERT(counts.histograms.size() >= (histograms_.size() << 8));
+    for (size_t c = 0; c < histograms_.size(); ++c) {
+      histograms_[c].AddCounts(&counts.histograms[c << 8]);
+    }
   }
 
   template <class EntropyEncodingData>
   void BuildAndStoreEntropyCodes(std::vector<EntropyEncodingData>* codes,
                                  std::vector<uint8_t>* context_map,
                                  size_t* storage_ix, uint8_t* storage,
-                                 PikImageSizeInfo* info) const {
+                                 PikImageSizeInfo* info,
+                                 ThreadPool* pool = nullptr) const {
     std::vector<Histogram> clustered_histograms(histograms_);
     context_map->resize(histograms_.size());
     if (histograms_.size() > 1) {
       std::vector<uint32_t> histogram_symbols;
       ClusterHistograms(histograms_, histograms_.size(), 1, std::vector<int>(),
-                        kBlockSize, &clustered_histograms, &histogram_symbols);
+                        kBlockSize, &clustered_histograms, &histogram_symbols,
+                        pool);
       for (size_t c = 0; c < histograms_.size(); ++c) {
         (*context_map)[c] = static_cast<uint8_t>(histogram_symbols[c]);
       }
@@ -464,12 +661,18 @@ class HistogramBuilder {
       memset(data_.data(), 0, data_.size() * sizeof(data_[0]));
       total_count_ = 0;
     }
-    void Add(int symbol) {
-      if (symbol >= data_.size()) {
-        data_.resize(symbol + 1);
+    // Adds 256 counts, but only grows data_ up to the last nonzero one, as
+    // the clustering and encoding expect.
+    void AddCounts(const uint32_t* PIK_RESTRICT counts) {
+      size_t size = 256;
+      while (size != 0 && counts[size - 1] == 0) --size;
+      if (size > data_.size()) {
+        data_.resize(size);
+      }
+      for (size_t i = 0; i < size; ++i) {
+        data_[i] += counts[i];
+        total_count_ += counts[i];
       }
-      ++data_[symbol];
-      ++total_count_;
     }
     void AddHistogram(const Histogram& other) {
       if (other.data_.size() > data_.size()) {
@@ -481,11 +684,11 @@ class HistogramBuilder {
       total_count_ += other.total_count_;
     }
     float PopulationCost() const {
-      std::vector<int> counts(data_.size());
-      for (size_t i = 0; i < data_.size(); ++i) {
-        counts[i] = data_[i];
-      }
-      return ANSPopulationCost(counts.data(), counts.size(), total_count_);
+      // Counts are far below 2^31, so they can be reinterpreted as int without
+      // copying; this is called for every candidate pair during clustering.
+      static_assert(sizeof(int) == sizeof(uint32_t), "Size mismatch");
+      return ANSPopulationCost(reinterpret_cast<const int*>(data_.data()),
+                               data_.size(), total_count_);
     }
     double ShannonEntropy() const {
       return pik::ShannonEntropy(data_.data(), data_.size());
@@ -502,15 +705,33 @@ class HistogramBuilder {
 std::string BuildAndEncodeHistograms(
     size_t num_contexts, const std::vector<std::vector<Token> >& tokens,
     std::vector<ANSEncodingData>* codes, std::vector<uint8_t>* context_map,
-    PikImageSizeInfo* info) {
-  // Build histograms.
-  HistogramBuilder builder(num_contexts);
-  for (size_t i = 0; i < tokens.size(); ++i) {
-    for (size_t j = 0; j < tokens[i].size(); ++j) {
-      const Token token = tokens[i][j];
-      builder.VisitSymbol(token.symbol, token.context);
+    PikImageSizeInfo* info, ThreadPool* pool) {
+  // Build histograms: each thread counts whole groups into its own flat
+  // array; these are then summed.
+  std::vector<TokenCounts> thread_counts;
+  const auto count_group = [&tokens, &thread_counts](const int task,
+                                                     const int thread) {
+    uint32_t* PIK_RESTRICT histograms =
+        thread_counts[thread].histograms.data();
+    for (const Token& token : tokens[task]) {
+      ++histograms[(token.context << 8) + token.symbol];
+    }
+  };
+  if (pool != nullptr && tokens.size() > 1) {
+    thread_counts.resize(std::max<size_t>(pool->NumThreads(), 1),
+                         TokenCounts(num_contexts));
+    pool->Run(0, tokens.size(), count_group);
+  } else {
+    thread_counts.resize(1, TokenCounts(num_contexts));
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      count_group(i, 0);
     }
   }
+  for (size_t i = 1; i < thread_counts.size(); ++i) {
+    thread_counts[0].Assimilate(thread_counts[i]);
+  }
+  HistogramBuilder builder(num_contexts);
+  builder.AddCounts(thread_counts[0]);
   // Encode histograms.
   const size_t max_out_size = 1024 * (num_contexts + 4);
   std::string output(max_out_size, 0);
@@ -518,7 +739,7 @@ std::string BuildAndEncodeHistograms(
   uint8_t* storage = reinterpret_cast<uint8_t*>(&output[0]);
   storage[0] = 0;
   builder.BuildAndStoreEntropyCodes(codes, context_map, &storage_ix, storage,
-                                    info);
+                                    info, pool);
   // Close the histogram bit stream.
   size_t jump_bits = ((storage_ix + 7) & ~7) - storage_ix;
   WriteBits(jump_bits, 0, &storage_ix, storage);
@@ -534,18 +755,18 @@ std::string BuildAndEncodeHistograms(
   return output;
 }
 
-std::string BuildAndEncodeHistogramsFast(
+namespace {
+
+// Returns the histograms [(histogram << 8) + symbol] of "tokens" for the
+// StaticContextMap "context_map".
+std::vector<uint32_t> CountStaticContextSymbols(
     const std::vector<std::vector<Token> >& tokens,
-    std::vector<ANSEncodingData>* codes,
-    std::vector<uint8_t>* context_map,
-    PikImageSizeInfo* info) {
-  *context_map = StaticContextMap();
-  // Build histograms from tokens.
+    const std::vector<uint8_t>& context_map, PikImageSizeInfo* info) {
   std::vector<uint32_t> histograms(kNumStaticContexts << 8);
   for (size_t i = 0; i < tokens.size(); ++i) {
     for (size_t j = 0; j < tokens[i].size(); ++j) {
       const Token token = tokens[i][j];
-      const uint32_t histo_idx = (*context_map)[token.context];
+      const uint32_t histo_idx = context_map[token.context];
       ++histograms[(histo_idx << 8) + token.symbol];
     }
   }
@@ -554,13 +775,23 @@ std::string BuildAndEncodeHistogramsFast(
       info->clustered_entropy += ShannonEntropy(&histograms[c << 8], 256);
     }
   }
+  return histograms;
+}
+
+// Appends the codes of "histograms" (from CountStaticContextSymbols) to
+// "codes" and returns the encoding of them and the static "context_map".
+std::string EncodeStaticContextHistograms(
+    const std::vector<uint32_t>& histograms,
+    const std::vector<uint8_t>& context_map,
+    std::vector<ANSEncodingData>* codes) {
   const size_t max_out_size = kNumStaticContexts * 1024;
   std::string output(max_out_size, 0);
   size_t storage_ix = 0;
   uint8_t* storage = reinterpret_cast<uint8_t*>(&output[0]);
   storage[0] = 0;
   // Encode the histograms.
-  EncodeContextMap(*context_map, kNumStaticContexts, &storage_ix, storage);
+  EncodeContextMap(context_map, kNumStaticContexts, &storage_ix, storage,
+                   /*fast=*/true);
   for (size_t c = 0; c < kNumStaticContexts; ++c) {
     ANSEncodingData code;
     code.BuildAndStore(&histograms[c << 8], 256, &storage_ix, storage);
@@ -571,74 +802,369 @@ std::string BuildAndEncodeHistogramsFast(
   const size_t histo_bytes = (storage_ix >> 3);
   PIK_CHECK(histo_bytes <= max_out_size);
   output.resize(histo_bytes);
+  return output;
+}
+
+// Built-in histograms, decoded once for both the encoder and decoder.
+struct StaticHistograms {
+  std::shared_ptr<const DecodedHistograms> decoded;
+  std::vector<ANSEncodingData> codes;
+  // Cost [bits] of each symbol [(histogram << 8) + symbol], or infinity if
+  // its frequency is zero.
+  std::vector<float> bits;
+};
+
+std::vector<StaticHistograms>* DecodeAllStaticHistograms() {
+  std::vector<StaticHistograms>* sets =
+      new std::vector<StaticHistograms>(kNumStaticHistograms);
+  for (size_t i = 0; i < kNumStaticHistograms; ++i) {
+    const uint8_t* data = kStaticHistograms[i];
+    const size_t size = kStaticHistogramsSize[i];
+    StaticHistograms& set = (*sets)[i];
+    std::shared_ptr<DecodedHistograms> decoded(new DecodedHistograms);
+    BitReader reader(data, size);
+    PIK_CHECK(DecodeHistograms(&reader, kNumContexts, 256, kSymbolLut,
+                               sizeof(kSymbolLut), &decoded->code,
+                               &decoded->context_map));
+    decoded->encoded.assign(data, data + size);
+    set.decoded = decoded;
+
+    // The encoder's symbols are not mapped through kSymbolLut.
+    BitReader raw_reader(data, size);
+    ANSCode raw_code;
+    std::vector<uint8_t> context_map;
+    PIK_CHECK(DecodeHistograms(&raw_reader, kNumContexts, 256, nullptr, 0,
+                               &raw_code, &context_map));
+    const size_t num_histograms = raw_code.entries.size() >> ANS_LOG_TAB_SIZE;
+    PIK_CHECK(num_histograms == kNumStaticContexts);
+    set.bits.resize(num_histograms << 8);
+    for (size_t h = 0; h < num_histograms; ++h) {
+      std::vector<int> freqs(256);
+      for (size_t i = 0; i < ANS_TAB_SIZE; ++i) {
+        const uint32_t entry = raw_code.entries[(h << ANS_LOG_TAB_SIZE) + i];
+        freqs[entry >> ANSCode::kSymbolShift] =
+            entry & ((1u << ANSCode::kFreqBits) - 1);
+      }
+      set.codes.emplace_back();
+      set.codes.back().BuildFromFrequencies(freqs);
+      for (size_t s = 0; s < 256; ++s) {
+        set.bits[(h << 8) + s] =
+            freqs[s] == 0 ? std::numeric_limits<float>::infinity()
+                          : ANS_LOG_TAB_SIZE - std::log2(freqs[s]);
+      }
+    }
+  }
+  return sets;
+}
+
+// "id" is 1-based. Thread-safe.
+const StaticHistograms& GetStaticHistograms(const size_t id) {
+  static const std::vector<StaticHistograms>* sets =
+      DecodeAllStaticHistograms();
+  PIK_ASSERT(1 <= id && id <= kNumStaticHistograms);
+  return (*sets)[id - 1];
+}
+
+}  // namespace
+
+std::string BuildAndEncodeHistogramsFast(
+    const std::vector<std::vector<Token> >& tokens,
+    std::vector<ANSEncodingData>* codes,
+    std::vector<uint8_t>* context_map,
+    PikImageSizeInfo* info) {
+  *context_map = StaticContextMap();
+  const std::vector<uint32_t> histograms =
+      CountStaticContextSymbols(tokens, *context_map, info);
+  const std::string output =
+      EncodeStaticContextHistograms(histograms, *context_map, codes);
   if (info) {
     info->num_clustered_histograms += codes->size();
-    info->histogram_size += histo_bytes;
+    info->histogram_size += output.size();
   }
   return output;
 }
 
-std::string WriteTokens(const std::vector<Token>& tokens,
-                        const std::vector<ANSEncodingData>& codes,
-                        const std::vector<uint8_t>& context_map,
-                        PikImageSizeInfo* pik_info) {
-  const size_t max_out_size = 4 * tokens.size() + 4096;
-  std::string output(max_out_size, 0);
-  size_t storage_ix = 0;
-  uint8_t* storage = reinterpret_cast<uint8_t*>(&output[0]);
-  storage[0] = 0;
+std::string BuildAndEncodeHistogramsStatic(
+    const std::vector<std::vector<Token> >& tokens,
+    std::vector<ANSEncodingData>* codes,
+    std::vector<uint8_t>* context_map,
+    PikImageSizeInfo* info) {
+  *context_map = StaticContextMap();
+  const std::vector<uint32_t> histograms =
+      CountStaticContextSymbols(tokens, *context_map, info);
+  size_t best_id = 0;
+  float best_bits = std::numeric_limits<float>::infinity();
+  for (size_t id = 1; id <= kNumStaticHistograms; ++id) {
+    const std::vector<float>& bits = GetStaticHistograms(id).bits;
+    float total_bits = 0.0f;
+    for (size_t i = 0; i < histograms.size(); ++i) {
+      if (histograms[i] != 0) total_bits += histograms[i] * bits[i];
+    }
+    if (total_bits < best_bits) {
+      best_bits = total_bits;
+      best_id = id;
+    }
+  }
+
+  // Images unlike the photos the sets were trained on (e.g. screenshots) can
+  // cost much more than with image-specific histograms; those are used instead
+  // if their estimated size including storage is smaller.
+  float image_bits = 0.0f;
+  std::vector<int> counts(256);
+  for (size_t c = 0; c < kNumStaticContexts; ++c) {
+    int total_count = 0;
+    for (size_t s = 0; s < 256; ++s) {
+      counts[s] = histograms[(c << 8) + s];
+      total_count += counts[s];
+    }
+    image_bits += ANSPopulationCost(counts.data(), 256, total_count);
+  }
+  if (best_bits > image_bits) {
+    best_id = 0;
+  }
+
+  std::string output(1, static_cast<char>(best_id));
+  if (best_id == 0) {
+    output += EncodeStaticContextHistograms(histograms, *context_map, codes);
+  } else {
+    const StaticHistograms& set = GetStaticHistograms(best_id);
+    codes->insert(codes->end(), set.codes.begin(), set.codes.end());
+    *context_map = set.decoded->context_map;
+  }
+  if (info) {
+    info->num_clustered_histograms += codes->size();
+    info->histogram_size += output.size();
+  }
+  return output;
+}
+
+void AddStaticContextCounts(const std::vector<std::vector<Token> >& tokens,
+                            std::vector<uint64_t>* counts) {
+  if (counts->empty()) counts->resize(kNumStaticContexts << 8);
+  PIK_CHECK(counts->size() == (kNumStaticContexts << 8));
+  const std::vector<uint8_t> context_map = StaticContextMap();
+  const std::vector<uint32_t> histograms =
+      CountStaticContextSymbols(tokens, context_map, nullptr);
+  for (size_t i = 0; i < histograms.size(); ++i) {
+    (*counts)[i] += histograms[i];
+  }
+}
+
+std::vector<std::string> TrainStaticHistograms(
+    const std::vector<std::vector<uint64_t> >& counts,
+    const double prior_count) {
+  // Kinds of histograms with a shared prior, see StaticContextMap.
+  const size_t kNumQuantHistograms = 8;
+  const size_t kNumKinds = 2 + kNumStaticZdensContexts;
+  const auto kind = [](const size_t histogram) -> size_t {
+    if (histogram < kNumQuantHistograms) return 0;
+    if (histogram < 12) return 1;
+    return 2 + (histogram - 12) % kNumStaticZdensContexts;
+  };
+  const auto normalize = [](std::vector<double> v) {
+    double sum = 0.0;
+    for (const double x : v) sum += x;
+    if (sum > 0.0) {
+      for (double& x : v) x /= sum;
+    }
+    return v;
+  };
+
+  std::vector<std::vector<double> > kind_sums(kNumKinds,
+                                              std::vector<double>(256));
+  std::vector<double> ac_sum(256);  // All AC kinds.
+  for (const std::vector<uint64_t>& set : counts) {
+    PIK_CHECK(set.size() == (kNumStaticContexts << 8));
+    for (size_t h = 0; h < kNumStaticContexts; ++h) {
+      for (size_t s = 0; s < 256; ++s) {
+        const double count = set[(h << 8) + s];
+        kind_sums[kind(h)][s] += count;
+        if (kind(h) >= 2) ac_sum[s] += count;
+      }
+    }
+  }
+  std::vector<std::vector<double> > priors(kNumKinds);
+  const std::vector<double> ac_prior = normalize(ac_sum);
+  for (size_t k = 0; k < kNumKinds; ++k) {
+    priors[k] = normalize(kind_sums[k]);
+    // Zero density contexts are similar, so they also share symbols.
+    if (k < 2) continue;
+    for (size_t s = 0; s < 256; ++s) {
+      priors[k][s] = 0.9 * priors[k][s] + 0.1 * ac_prior[s];
+    }
+  }
+
+  const std::vector<uint8_t> context_map = StaticContextMap();
+  std::vector<std::string> sets;
+  for (const std::vector<uint64_t>& set : counts) {
+    // Scaled to about 2^16 per histogram, then normalized by BuildAndStore.
+    std::vector<uint32_t> histograms(kNumStaticContexts << 8);
+    for (size_t h = 0; h < kNumStaticContexts; ++h) {
+      std::vector<double> histogram(set.begin() + (h << 8),
+                                    set.begin() + ((h + 1) << 8));
+      double total = 0.0;
+      for (const double x : histogram) total += x;
+      histogram = normalize(histogram);
+      const double weight = total / (total + prior_count);
+      const std::vector<double>& prior = priors[kind(h)];
+      for (size_t s = 0; s < 256; ++s) {
+        const double p = weight * histogram[s] + (1.0 - weight) * prior[s];
+        if (p <= 0.0) continue;
+        histograms[(h << 8) + s] = std::max<long>(1, std::lround(p * 65536));
+      }
+    }
+    std::vector<ANSEncodingData> codes;
+    sets.push_back(
+        EncodeStaticContextHistograms(histograms, context_map, &codes));
+  }
+  return sets;
+}
+
+float EstimateTokenBits(const size_t num_contexts,
+                        const std::vector<std::vector<Token> >& tokens) {
+  TokenCounts counts(num_contexts);
+  for (const std::vector<Token>& group_tokens : tokens) {
+    for (const Token& token : group_tokens) {
+      ++counts.histograms[(token.context << 8) + token.symbol];
+      counts.extra_bits += token.nbits;
+    }
+  }
+  return EstimateTokenBits(num_contexts, counts);
+}
+
+float EstimateTokenBits(const size_t num_contexts, const TokenCounts& counts) {
+  const std::vector<uint8_t> static_map = StaticContextMap();
+  PIK_CHECK(num_contexts <= static_map.size());
+  PIK_CHECK(counts.histograms.size() >= (num_contexts << 8));
+  // Counts are far below 2^31, so they can be reinterpreted as int.
+  static_assert(sizeof(int) == sizeof(uint32_t), "Size mismatch");
+  const int* histograms =
+      reinterpret_cast<const int*>(counts.histograms.data());
+  std::vector<int> static_histograms(kNumStaticContexts << 8);
+  std::vector<int> totals(num_contexts);
+  std::vector<int> static_totals(kNumStaticContexts);
+  for (size_t c = 0; c < num_contexts; ++c) {
+    const uint32_t histo_idx = static_map[c];
+    for (size_t i = 0; i < 256; ++i) {
+      const int count = histograms[(c << 8) + i];
+      static_histograms[(histo_idx << 8) + i] += count;
+      totals[c] += count;
+    }
+    static_totals[histo_idx] += totals[c];
+  }
+
+  // Clustering only merges histograms if that reduces the total cost, so the
+  // actual cost is usually below both of these.
+  float context_bits = 0.0f;
+  for (size_t c = 0; c < num_contexts; ++c) {
+    if (totals[c] == 0) continue;
+    context_bits += ANSPopulationCost(&histograms[c << 8], 256, totals[c]);
+  }
+  float static_bits = 0.0f;
+  for (size_t c = 0; c < kNumStaticContexts; ++c) {
+    static_bits +=
+        ANSPopulationCost(&static_histograms[c << 8], 256, static_totals[c]);
+  }
+  return std::min(context_bits, static_bits) + counts.extra_bits;
+}
+
+void TokenCostModel::Init(const std::vector<std::vector<Token> >& tokens) {
+  context_map_ = StaticContextMap();
+  std::vector<uint32_t> histograms(kNumStaticContexts << 8);
+  for (const std::vector<Token>& group_tokens : tokens) {
+    for (const Token& token : group_tokens) {
+      ++histograms[(context_map_[token.context] << 8) + token.symbol];
+    }
+  }
+  // Half a count per symbol avoids infinite costs for unseen symbols.
+  costs_.resize(kNumStaticContexts << 8);
+  for (size_t c = 0; c < kNumStaticContexts; ++c) {
+    const uint32_t* PIK_RESTRICT histogram = &histograms[c << 8];
+    uint32_t total = 0;
+    for (size_t i = 0; i < 256; ++i) total += histogram[i];
+    const float log_total = std::log2(total + 0.5f * 256);
+    for (size_t i = 0; i < 256; ++i) {
+      costs_[(c << 8) + i] = log_total - std::log2(histogram[i] + 0.5f);
+    }
+  }
+}
+
+void WriteTokens(const std::vector<Token>& tokens,
+                 const std::vector<ANSEncodingData>& codes,
+                 const std::vector<uint8_t>& context_map,
+                 PikImageSizeInfo* pik_info, PaddedBytes* PIK_RESTRICT output,
+                 size_t num_states) {
+  PIK_CHECK(num_states == 1 || num_states == 2 || num_states == 4);
+  const size_t begin = output->size();
+  const size_t max_out_size = MaxWriteTokensSize(tokens.size());
+  // Shrinking afterwards is free, so this only allocates if the caller did
+  // not already reserve the upper bound.
+  output->resize(begin + max_out_size);
+  size_t storage_ix = begin * kBitsPerByte;
+  uint8_t* storage = output->data();
+  WriteBitsPrepareStorage(storage_ix, storage);
+  BufferedBitWriter writer(&storage_ix, storage);
   size_t num_extra_bits = 0;
   PIK_ASSERT(kANSBufferSize <= (1 << 16));
+  // Renormalization words of the current chunk; allocated once per call.
+  std::vector<uint32_t> out;
+  out.reserve(std::min<size_t>(kANSBufferSize, tokens.size()));
   for (int start = 0; start < tokens.size(); start += kANSBufferSize) {
-    std::vector<uint32_t> out;
-    out.reserve(kANSBufferSize);
+    out.clear();
     const int end = std::min<int>(start + kANSBufferSize, tokens.size());
-    ANSCoder ans;
+    // Token i uses state (i - start) % num_states. Renormalization words are
+    // still tagged with their (unique) token index, so the interleaving below
+    // is unchanged.
+    ANSCoder ans[kMaxANSStates];
     for (int i = end - 1; i >= start; --i) {
       const Token token = tokens[i];
       const uint8_t histo_idx = context_map[token.context];
       const ANSEncSymbolInfo info = codes[histo_idx].ans_table[token.symbol];
       uint8_t nbits = 0;
-      uint32_t bits = ans.PutSymbol(info, &nbits);
+      ANSCoder& coder = ans[(i - start) & (num_states - 1)];
+      const uint32_t bits = coder.PutSymbol(info, &nbits);
       if (nbits == 16) {
         out.push_back(((i - start) << 16) | bits);
       }
     }
-    const uint32_t state = ans.GetState();
-    WriteBits(16, (state >> 16) & 0xffff, &storage_ix, storage);
-    WriteBits(16, state & 0xffff, &storage_ix, storage);
+    for (size_t s = 0; s < num_states; ++s) {
+      const uint32_t state = ans[s].GetState();
+      writer.Write(16, (state >> 16) & 0xffff);
+      writer.Write(16, state & 0xffff);
+    }
     int tokenidx = start;
     for (int i = out.size(); i >= 0; --i) {
       int nextidx = i > 0 ? start + (out[i - 1] >> 16) : end;
       for (; tokenidx < nextidx; ++tokenidx) {
         const Token token = tokens[tokenidx];
-        WriteBits(token.nbits, token.bits, &storage_ix, storage);
+        writer.Write(token.nbits, token.bits);
         num_extra_bits += token.nbits;
       }
       if (i > 0) {
-        WriteBits(16, out[i - 1] & 0xffff, &storage_ix, storage);
+        writer.Write(16, out[i - 1] & 0xffff);
       }
     }
   }
-  const size_t out_size = (storage_ix + 7) >> 3;
+  writer.Flush();
+  const size_t written_bits = storage_ix - begin * kBitsPerByte;
+  const size_t out_size = (written_bits + 7) >> 3;
   PIK_CHECK(out_size <= max_out_size);
-  output.resize(out_size);
+  output->resize(begin + out_size);
   if (pik_info) {
-    pik_info->entropy_coded_bits += storage_ix - num_extra_bits;
+    pik_info->entropy_coded_bits += written_bits - num_extra_bits;
     pik_info->extra_bits += num_extra_bits;
     pik_info->total_size += out_size;
   }
-  return output;
 }
 
-std::string EncodeImage(const Rect& rect, const Image3S& img,
-                        PikImageSizeInfo* info) {
+void EncodeImage(const Rect& rect, const Image3S& img, PikImageSizeInfo* info,
+                 PaddedBytes* PIK_RESTRICT out, bool grayscale) {
   const size_t xsize = rect.xsize();
   const size_t ysize = rect.ysize();
 
   std::vector<std::vector<Token> > tokens(1);
   tokens[0].reserve(3 * ysize * xsize);
-  for (int c = 0; c < 3; ++c) {
+  for (int c = FirstCodedPlane(grayscale); c < EndCodedPlane(grayscale); ++c) {
     for (size_t y = 0; y < ysize; ++y) {
       const int16_t* const PIK_RESTRICT row = rect.ConstRow(img.Plane(c), y);
       for (size_t x = 0; x < xsize; ++x) {
@@ -652,8 +1178,69 @@ std::string EncodeImage(const Rect& rect, const Image3S& img,
   std::vector<uint8_t> context_map;
   const std::string enc_hist =
       BuildAndEncodeHistograms(3, tokens, &codes, &context_map, info);
-  const std::string enc_img = WriteTokens(tokens[0], codes, context_map, info);
-  return enc_hist + enc_img;
+
+  // Reserve the upper bound once; WriteTokens then appends in place.
+  const size_t begin = out->size();
+  out->resize(begin + enc_hist.size() + MaxWriteTokensSize(tokens[0].size()));
+  memcpy(out->data() + begin, enc_hist.data(), enc_hist.size());
+  out->resize(begin + enc_hist.size());
+  WriteTokens(tokens[0], codes, context_map, info, out);
+}
+
+namespace {
+
+// Context of a residual: its plane and the magnitudes of its left and top
+// neighbors (or the other one, or zero, on the borders of "rect").
+constexpr size_t kNeighborContexts = 8;
+
+PIK_INLINE size_t NeighborContext(const int16_t* PIK_RESTRICT row_top,
+                                  const int16_t* PIK_RESTRICT row,
+                                  const size_t x) {
+  int left = 0;
+  int top = 0;
+  if (x != 0) left = row[x - 1];
+  if (row_top != nullptr) top = row_top[x];
+  if (x == 0) left = top;
+  if (row_top == nullptr) top = left;
+  const uint32_t sum = std::abs(left) + std::abs(top);
+  if (sum == 0) return 0;
+  return std::min<size_t>(kNeighborContexts - 1, 1 + FloorLog2Nonzero(sum));
+}
+
+}  // namespace
+
+void EncodeImageWithNeighbors(const Rect& rect, const Image3S& img,
+                              PikImageSizeInfo* info,
+                              PaddedBytes* PIK_RESTRICT out, bool grayscale) {
+  const size_t xsize = rect.xsize();
+  const size_t ysize = rect.ysize();
+
+  std::vector<std::vector<Token> > tokens(1);
+  tokens[0].reserve(3 * ysize * xsize);
+  for (int c = FirstCodedPlane(grayscale); c < EndCodedPlane(grayscale); ++c) {
+    for (size_t y = 0; y < ysize; ++y) {
+      const int16_t* const PIK_RESTRICT row_top =
+          y == 0 ? nullptr : rect.ConstRow(img.Plane(c), y - 1);
+      const int16_t* const PIK_RESTRICT row = rect.ConstRow(img.Plane(c), y);
+      for (size_t x = 0; x < xsize; ++x) {
+        const size_t ctx =
+            c * kNeighborContexts + NeighborContext(row_top, row, x);
+        int nbits, bits;
+        EncodeCoeff(row[x], &nbits, &bits);
+        tokens[0].emplace_back(Token(ctx, nbits, nbits, bits));
+      }
+    }
+  }
+  std::vector<ANSEncodingData> codes;
+  std::vector<uint8_t> context_map;
+  const std::string enc_hist = BuildAndEncodeHistograms(
+      3 * kNeighborContexts, tokens, &codes, &context_map, info);
+
+  const size_t begin = out->size();
+  out->resize(begin + enc_hist.size() + MaxWriteTokensSize(tokens[0].size()));
+  memcpy(out->data() + begin, enc_hist.data(), enc_hist.size());
+  out->resize(begin + enc_hist.size());
+  WriteTokens(tokens[0], codes, context_map, info, out);
 }
 
 bool DecodeHistograms(BitReader* br, const size_t num_contexts,
@@ -661,7 +1248,8 @@ bool DecodeHistograms(BitReader* br, const size_t num_contexts,
                       size_t symbol_lut_size, ANSCode* code,
                       std::vector<uint8_t>* context_map) {
   size_t num_histograms = 1;
-  context_map->resize(num_contexts);
+  // (assign: the vector may be reused from a previous image.)
+  context_map->assign(num_contexts, 0);
   if (num_contexts > 1) {
     if (!DecodeContextMap(context_map, &num_histograms, br)) return false;
   }
@@ -673,14 +1261,85 @@ bool DecodeHistograms(BitReader* br, const size_t num_contexts,
   return true;
 }
 
-bool DecodeImageData(BitReader* PIK_RESTRICT br,
+HistogramCache& HistogramCache::Global() {
+  static HistogramCache* cache = new HistogramCache;
+  return *cache;
+}
+
+std::shared_ptr<const DecodedHistograms> HistogramCache::Decode(
+    const uint8_t* data, const size_t size, const size_t num_contexts,
+    const size_t max_alphabet_size, const uint8_t* symbol_lut,
+    const size_t symbol_lut_size, BitReader* br) {
+  PIK_ASSERT(br->BitsRead() % kBitsPerByte == 0);
+  const size_t pos = br->Position();
+  if (pos > size) return nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      const Entry& entry = entries_[i];
+      const std::vector<uint8_t>& encoded = entry.histograms->encoded;
+      if (entry.num_contexts != num_contexts ||
+          entry.max_alphabet_size != max_alphabet_size ||
+          entry.symbol_lut != symbol_lut || encoded.size() > size - pos ||
+          memcmp(data + pos, encoded.data(), encoded.size()) != 0) {
+        continue;
+      }
+      br->SkipBits(encoded.size() * kBitsPerByte);
+      // Move to the back (most recently used).
+      std::rotate(entries_.begin() + i, entries_.begin() + i + 1,
+                  entries_.end());
+      return entries_.back().histograms;
+    }
+  }
+
+  // Decode without holding the lock.
+  std::shared_ptr<DecodedHistograms> histograms(new DecodedHistograms);
+  if (!DecodeHistograms(br, num_contexts, max_alphabet_size, symbol_lut,
+                        symbol_lut_size, &histograms->code,
+                        &histograms->context_map)) {
+    return nullptr;
+  }
+  br->JumpToByteBoundary();
+  const size_t end = br->Position();
+  if (end > size) return nullptr;
+  histograms->encoded.assign(data + pos, data + end);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.size() == kMaxEntries) entries_.erase(entries_.begin());
+  entries_.push_back(
+      Entry{num_contexts, max_alphabet_size, symbol_lut, histograms});
+  return histograms;
+}
+
+std::shared_ptr<const DecodedHistograms> DecodeHistogramsStatic(
+    const uint8_t* data, const size_t size, BitReader* br) {
+  PIK_ASSERT(br->BitsRead() % kBitsPerByte == 0);
+  if (br->Position() >= size) return nullptr;
+  const size_t id = br->ReadBits(8);
+  if (id > kNumStaticHistograms) return nullptr;
+  if (id != 0) return GetStaticHistograms(id).decoded;
+  return HistogramCache::Global().Decode(data, size, kNumContexts, 256,
+                                         kSymbolLut, sizeof(kSymbolLut), br);
+}
+
+bool DecodeImageData(PaddedBitReader* PIK_RESTRICT br_out,
                      const std::vector<uint8_t>& context_map,
                      ANSSymbolReader* PIK_RESTRICT decoder, const Rect& rect,
-                     Image3S* PIK_RESTRICT img) {
+                     const bool grayscale, Image3S* PIK_RESTRICT img) {
   const size_t xsize = rect.xsize();
   const size_t ysize = rect.ysize();
   PIK_ASSERT(xsize <= img->xsize() && ysize <= img->ysize());
+  // Local copy allows keeping the reader state in registers.
+  PaddedBitReader reader = *br_out;
+  PaddedBitReader* PIK_RESTRICT br = &reader;
   for (int c = 0; c < 3; ++c) {
+    if (c < FirstCodedPlane(grayscale) || c >= EndCodedPlane(grayscale)) {
+      // Not coded; img may be reused, so clear it.
+      for (size_t y = 0; y < ysize; ++y) {
+        memset(rect.Row(img->MutablePlane(c), y), 0, xsize * sizeof(int16_t));
+      }
+      continue;
+    }
     const int histo_idx = context_map[c];
 
     for (size_t y = 0; y < ysize; ++y) {
@@ -699,6 +1358,63 @@ bool DecodeImageData(BitReader* PIK_RESTRICT br,
     }
   }
   br->JumpToByteBoundary();
+  *br_out = reader;
+  return true;
+}
+
+bool DecodeImageWithNeighbors(PaddedBitReader* PIK_RESTRICT br,
+                              const Rect& rect, Image3S* PIK_RESTRICT img,
+                              bool grayscale) {
+  PIK_ASSERT(br->BitsRead() % kBitsPerByte == 0);
+  const size_t pos = std::min(br->Position(), br->size());
+  BitReader histo_reader(br->data() + pos, br->size() - pos);
+  std::vector<uint8_t> context_map;
+  ANSCode code;
+  if (!DecodeHistograms(&histo_reader, 3 * kNeighborContexts, 16, nullptr, 0,
+                        &code, &context_map)) {
+    return false;
+  }
+  br->SkipBits(histo_reader.Position() * kBitsPerByte);
+  ANSSymbolReader decoder(&code);
+
+  const size_t xsize = rect.xsize();
+  const size_t ysize = rect.ysize();
+  PIK_ASSERT(xsize <= img->xsize() && ysize <= img->ysize());
+  // Local copy allows keeping the reader state in registers.
+  PaddedBitReader reader = *br;
+  for (int c = 0; c < 3; ++c) {
+    if (c < FirstCodedPlane(grayscale) || c >= EndCodedPlane(grayscale)) {
+      for (size_t y = 0; y < ysize; ++y) {
+        memset(rect.Row(img->MutablePlane(c), y), 0, xsize * sizeof(int16_t));
+      }
+      continue;
+    }
+    const uint8_t* PIK_RESTRICT histo_idx =
+        context_map.data() + c * kNeighborContexts;
+
+    for (size_t y = 0; y < ysize; ++y) {
+      const int16_t* PIK_RESTRICT row_top =
+          y == 0 ? nullptr : rect.ConstRow(img->Plane(c), y - 1);
+      int16_t* PIK_RESTRICT row = rect.Row(img->MutablePlane(c), y);
+
+      for (size_t x = 0; x < xsize; ++x) {
+        reader.FillBitBuffer();
+        const size_t ctx = NeighborContext(row_top, row, x);
+        int s = decoder.ReadSymbol(histo_idx[ctx], &reader);
+        if (s > 0) {
+          int bits = reader.PeekBits(s);
+          reader.Advance(s);
+          s = bits < (1U << (s - 1)) ? bits + ((~0U) << s) + 1 : bits;
+        }
+        row[x] = s;
+      }
+    }
+  }
+  reader.JumpToByteBoundary();
+  *br = reader;
+  if (!decoder.CheckANSFinalState()) {
+    return PIK_FAILURE("ANS checksum failure.");
+  }
   return true;
 }
 
@@ -737,15 +1453,22 @@ bool DecodeCoeffOrder(int32_t* order, BitReader* br) {
   return true;
 }
 
-bool DecodeImage(BitReader* PIK_RESTRICT br, const Rect& rect,
-                 Image3S* PIK_RESTRICT img) {
+bool DecodeImage(PaddedBitReader* PIK_RESTRICT br, const Rect& rect,
+                 Image3S* PIK_RESTRICT img, bool grayscale) {
+  // The histograms are small; parse them with a (bounds-checked) BitReader
+  // starting at the same byte and then skip past them.
+  PIK_ASSERT(br->BitsRead() % kBitsPerByte == 0);
+  const size_t pos = std::min(br->Position(), br->size());
+  BitReader histo_reader(br->data() + pos, br->size() - pos);
   std::vector<uint8_t> context_map;
   ANSCode code;
-  if (!DecodeHistograms(br, 3, 16, nullptr, 0, &code, &context_map)) {
+  if (!DecodeHistograms(&histo_reader, 3, 16, nullptr, 0, &code,
+                        &context_map)) {
     return false;
   }
+  br->SkipBits(histo_reader.Position() * kBitsPerByte);
   ANSSymbolReader decoder(&code);
-  if (!DecodeImageData(br, context_map, &decoder, rect, img)) {
+  if (!DecodeImageData(br, context_map, &decoder, rect, grayscale, img)) {
     return false;
   }
   if (!decoder.CheckANSFinalState()) {
@@ -757,10 +1480,11 @@ bool DecodeImage(BitReader* PIK_RESTRICT br, const Rect& rect,
 bool DecodeAC(const Image3B& tmp_block_ctx, const ANSCode& code,
               const std::vector<uint8_t>& context_map,
               const int32_t* PIK_RESTRICT coeff_order,
-              BitReader* PIK_RESTRICT br, const Rect& rect_ac,
+              PaddedBitReader* PIK_RESTRICT br_out, const Rect& rect_ac,
               Image3S* PIK_RESTRICT ac, const Rect& rect_qf,
               ImageI* PIK_RESTRICT quant_field,
-              Image3I* PIK_RESTRICT tmp_num_nzeroes) {
+              Image3I* PIK_RESTRICT tmp_num_nzeroes, size_t num_ans_states,
+              bool grayscale) {
   const size_t xsize = rect_ac.xsize();
   const size_t ysize = rect_ac.ysize();
   PIK_ASSERT(SameSize(rect_ac, rect_qf));
@@ -768,8 +1492,15 @@ bool DecodeAC(const Image3B& tmp_block_ctx, const ANSCode& code,
   PIK_ASSERT(xsize <= ac->xsize() / kBlockSize && ysize <= ac->ysize());
   PIK_ASSERT(xsize <= quant_field->xsize() && ysize <= quant_field->ysize());
   PIK_ASSERT(SameSize(tmp_block_ctx, *tmp_num_nzeroes));
+  // Local copy allows keeping the reader state in registers.
+  PaddedBitReader reader = *br_out;
+  PaddedBitReader* PIK_RESTRICT br = &reader;
 
-  ANSSymbolReader decoder(&code);
+  using namespace SIMD_NAMESPACE;
+  constexpr Full<int16_t> d16;
+  const auto zero = setzero(d16);
+
+  ANSSymbolReader decoder(&code, num_ans_states);
   for (size_t y = 0; y < ysize; ++y) {
     int32_t* PIK_RESTRICT row_quant = rect_qf.Row(quant_field, y);
     const int32_t* PIK_RESTRICT row_quant_top =
@@ -786,6 +1517,15 @@ bool DecodeAC(const Image3B& tmp_block_ctx, const ANSCode& code,
   }
 
   for (int c = 0; c < 3; ++c) {
+    if (c < FirstCodedPlane(grayscale) || c >= EndCodedPlane(grayscale)) {
+      // Not coded; ac and tmp_num_nzeroes may be reused, so clear them.
+      for (size_t y = 0; y < ysize; ++y) {
+        memset(ac->PlaneRow(c, rect_ac.y0() + y) + rect_ac.x0() * kBlockSize,
+               0, xsize * kBlockSize * sizeof(int16_t));
+        memset(tmp_num_nzeroes->PlaneRow(c, y), 0, xsize * sizeof(int32_t));
+      }
+      continue;
+    }
     for (size_t y = 0; y < ysize; ++y) {
       const uint8_t* PIK_RESTRICT row_bctx = tmp_block_ctx.ConstPlaneRow(c, y);
       int16_t* PIK_RESTRICT row_ac =
@@ -797,7 +1537,10 @@ bool DecodeAC(const Image3B& tmp_block_ctx, const ANSCode& code,
 
       for (size_t bx = 0; bx < xsize; ++bx) {
         int16_t* PIK_RESTRICT block_ac = row_ac + bx * kBlockSize;
-        memset(block_ac, 0, kBlockSize * sizeof(row_ac[0]));
+        // Most blocks are sparse: clear them and only scatter the nonzeros.
+        for (size_t k = 0; k < kBlockSize; k += d16.N) {
+          store(zero, d16, block_ac + k);
+        }
         const size_t block_ctx = row_bctx[bx];
         PIK_ASSERT(block_ctx < kOrderContexts);
         const size_t nzero_ctx =
@@ -831,9 +1574,9 @@ bool DecodeAC(const Image3B& tmp_block_ctx, const ANSCode& code,
             const int context = ZeroDensityContext(num_nzeros - 1, k, 4);
             histo_idx = context_map[histo_offset + context];
             --num_nzeros;
+            // block_order[k] != 0, only writes to AC coefficients.
+            block_ac[block_order[k]] = s;
           }
-          // block_order[k] != 0, only writes to AC coefficients.
-          block_ac[block_order[k]] = s;
         }
         if (num_nzeros != 0) {
           return PIK_FAILURE("Invalid AC: nzeros not 0.");
@@ -842,6 +1585,7 @@ bool DecodeAC(const Image3B& tmp_block_ctx, const ANSCode& code,
     }
   }
   br->JumpToByteBoundary();
+  *br_out = reader;
   if (!decoder.CheckANSFinalState()) {
     return PIK_FAILURE("ANS checksum failure.");
   }
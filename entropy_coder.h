@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -34,9 +35,11 @@
 #include "compiler_specific.h"
 #include "context.h"
 #include "context_map_encode.h"
+#include "data_parallel.h"
 #include "fast_log.h"
 #include "image.h"
 #include "lehmer_code.h"
+#include "padded_bytes.h"
 #include "pik_info.h"
 #include "status.h"
 
@@ -116,46 +119,196 @@ void ExpandDC(const Rect& rect_dc, Image3S* PIK_RESTRICT dc,
               ImageS* PIK_RESTRICT tmp_y, ImageS* PIK_RESTRICT tmp_xz_residuals,
               ImageS* PIK_RESTRICT tmp_xz_expanded);
 
+// Grayscale images (Header::kGrayscale) only code the Y plane; the functions
+// below with a "grayscale" argument visit planes [FirstCodedPlane,
+// EndCodedPlane). Decoders zero the other planes.
+static inline int FirstCodedPlane(const bool grayscale) {
+  return grayscale ? 1 : 0;
+}
+static inline int EndCodedPlane(const bool grayscale) {
+  return grayscale ? 2 : 3;
+}
+
+// Adds the number of zero-valued coefficients of each block within "rect"
+// (in units of blocks) to num_zeros[ctx * kBlockSize + k], where ctx is the
+// block's context from "rect_ctx" within "block_ctx". Allows computing the
+// order incrementally, e.g. per group.
+void CountCoeffZeros(const Rect& rect, const Image3S& ac, const Rect& rect_ctx,
+                     const Image3B& block_ctx,
+                     uint32_t* PIK_RESTRICT num_zeros, bool grayscale = false);
+
+// Orders the coefficients of each context by increasing number of zeros, given
+// the kOrderContexts * kBlockSize counts from CountCoeffZeros.
+void CoeffOrderFromZeros(const uint32_t* PIK_RESTRICT num_zeros,
+                         int32_t* PIK_RESTRICT order);
+
+// Counts zeros for all contexts in a single pass over "ac" (one task per
+// group, merging per-thread counts) and returns the resulting order.
 void ComputeCoeffOrder(const Image3S& ac, const Image3B& block_ctx,
-                       int32_t* PIK_RESTRICT order);
+                       ThreadPool* pool, int32_t* PIK_RESTRICT order,
+                       bool grayscale = false);
 
 std::string EncodeCoeffOrders(const int32_t* PIK_RESTRICT order,
                               PikInfo* PIK_RESTRICT pik_info);
 
-// Encodes the "rect" subset of "img".
-std::string EncodeImage(const Rect& rect, const Image3S& img,
-                        PikImageSizeInfo* info);
+// Encodes the "rect" subset of "img" and appends it to "out".
+void EncodeImage(const Rect& rect, const Image3S& img, PikImageSizeInfo* info,
+                 PaddedBytes* PIK_RESTRICT out, bool grayscale = false);
 
+// Same as EncodeImage, but each value's context also depends on the
+// magnitudes of its (already coded) left and top neighbors, which is more
+// effective for residuals of full-resolution pixels with flat areas.
+void EncodeImageWithNeighbors(const Rect& rect, const Image3S& img,
+                              PikImageSizeInfo* info,
+                              PaddedBytes* PIK_RESTRICT out,
+                              bool grayscale = false);
+
+// All tokens of an image are kept until the histograms are built, so this is
+// packed into 6 bytes (context fits in 16 bits, see static_assert below).
 struct Token {
   Token(uint32_t c, uint32_t s, uint32_t nb, uint32_t b)
       : context(c), bits(b), nbits(nb), symbol(s) {}
-  uint32_t context;
+  uint16_t context;
   uint16_t bits;
   uint8_t nbits;
   uint8_t symbol;
 };
+static_assert(sizeof(Token) == 6, "Token should be packed");
+static_assert(kNumContexts <= (1 << 16), "Token::context too small");
 
-// Only the subset "rect" [in units of blocks] within all images.
+// Only the subset "rect" [in units of blocks] within all images except
+// "block_ctx", whose contexts are read from "rect_ctx" (e.g. a per-group
+// image starting at 0,0).
 // Warning: uses the DC coefficients in "coeffs"!
+// "num_nzeros" (per block, as from QuantizeWithColorTransform) avoids counting
+// the nonzero coefficients again; if null, they are counted here.
 std::vector<Token> TokenizeCoefficients(const int32_t* orders, const Rect& rect,
                                         const ImageI& quant_field,
                                         const Image3S& coeffs,
-                                        const Image3B& block_ctx);
+                                        const Rect& rect_ctx,
+                                        const Image3B& block_ctx,
+                                        const Image3I* num_nzeros = nullptr,
+                                        bool grayscale = false);
+
+// Per-context symbol counts and total extra bits, i.e. all that
+// EstimateTokenBits requires. Cheaper to obtain than the tokens themselves.
+struct TokenCounts {
+  explicit TokenCounts(size_t num_contexts = kNumContexts)
+      : histograms(num_contexts << 8) {}
+
+  void Assimilate(const TokenCounts& other);
+
+  std::vector<uint32_t> histograms;  // [(context << 8) + symbol]
+  uint64_t extra_bits = 0;
+};
+
+// Same as TokenizeCoefficients, but only adds the symbols to "counts" instead
+// of materializing the tokens.
+void CountCoefficientSymbols(const int32_t* orders, const Rect& rect,
+                             const ImageI& quant_field, const Image3S& coeffs,
+                             const Rect& rect_ctx, const Image3B& block_ctx,
+                             const Image3I* num_nzeros,
+                             TokenCounts* PIK_RESTRICT counts,
+                             bool grayscale = false);
 
+// Clusters the per-context histograms of "tokens" and encodes them. If "pool"
+// is non-null, the groups (tokens[i]) are counted and the histograms clustered
+// in parallel; the output is the same.
 std::string BuildAndEncodeHistograms(
     size_t num_contexts, const std::vector<std::vector<Token> >& tokens,
     std::vector<ANSEncodingData>* codes, std::vector<uint8_t>* context_map,
-    PikImageSizeInfo* info);
+    PikImageSizeInfo* info, ThreadPool* pool = nullptr);
 
 std::string BuildAndEncodeHistogramsFast(
     const std::vector<std::vector<Token> >& tokens,
     std::vector<ANSEncodingData>* codes, std::vector<uint8_t>* context_map,
     PikImageSizeInfo* info);
 
-std::string WriteTokens(const std::vector<Token>& tokens,
-                        const std::vector<ANSEncodingData>& codes,
-                        const std::vector<uint8_t>& context_map,
-                        PikImageSizeInfo* pik_info);
+// Number of built-in histogram sets for Header::kStaticHistograms (see
+// static_histograms.h), trained at increasing distances. Their IDs start at 1;
+// ID 0 means the histograms are stored in the bitstream.
+static const size_t kNumStaticHistograms = 3;
+
+// Same as BuildAndEncodeHistogramsFast, but the output starts with a byte
+// holding the ID of the built-in set that codes "tokens" with the fewest bits.
+// If none of them can code all symbols, or they are estimated to cost more
+// than storing image-specific histograms, the ID is 0 and the histograms of
+// BuildAndEncodeHistogramsFast follow.
+std::string BuildAndEncodeHistogramsStatic(
+    const std::vector<std::vector<Token> >& tokens,
+    std::vector<ANSEncodingData>* codes, std::vector<uint8_t>* context_map,
+    PikImageSizeInfo* info);
+
+// For training the built-in sets: adds the number of occurrences of each
+// symbol of "tokens" in each histogram of StaticContextMap to "counts"
+// [(histogram << 8) + symbol], which is first resized if empty.
+void AddStaticContextCounts(const std::vector<std::vector<Token> >& tokens,
+                            std::vector<uint64_t>* counts);
+
+// Returns the built-in sets (as stored in static_histograms.h) for "counts"
+// from AddStaticContextCounts, one per distance. To code symbols not seen at
+// one distance, each histogram is blended with a prior: the normalized sum of
+// all histograms of the same kind (quantization, number of nonzeros, or AC
+// with the same zero density context) at all distances, which has weight
+// "prior_count" / ("prior_count" + number of tokens in the histogram).
+std::vector<std::string> TrainStaticHistograms(
+    const std::vector<std::vector<uint64_t> >& counts, double prior_count);
+
+// Returns the approximate size [bits] of BuildAndEncodeHistograms plus
+// WriteTokens for "tokens" without building codes or writing any bits: the
+// ANSPopulationCost of the cheaper of the per-context and static-context-map
+// histograms, plus the raw extra bits. Cheap enough for rate control.
+float EstimateTokenBits(size_t num_contexts,
+                        const std::vector<std::vector<Token> >& tokens);
+float EstimateTokenBits(size_t num_contexts, const TokenCounts& counts);
+
+// Per-symbol costs [bits] for cheaply estimating the coded size of tokens,
+// e.g. of individual tiles in rate control loops. The costs are derived from
+// reference tokens (typically an earlier encode of the same image) whose
+// contexts are merged via StaticContextMap, so that contexts rarely seen there
+// still have reasonable costs.
+class TokenCostModel {
+ public:
+  // Empty: must call Init before Bits.
+  TokenCostModel() = default;
+  explicit TokenCostModel(const std::vector<std::vector<Token> >& tokens) {
+    Init(tokens);
+  }
+
+  void Init(const std::vector<std::vector<Token> >& tokens);
+  bool IsInitialized() const { return !costs_.empty(); }
+
+  // Returns the estimated size of "tokens" including their extra bits, but
+  // excluding the histograms, which are shared by all groups.
+  float Bits(const std::vector<Token>& tokens) const {
+    PIK_ASSERT(IsInitialized());
+    float bits = 0.0f;
+    for (const Token& token : tokens) {
+      bits += costs_[(context_map_[token.context] << 8) + token.symbol] +
+              token.nbits;
+    }
+    return bits;
+  }
+
+ private:
+  std::vector<uint8_t> context_map_;  // StaticContextMap
+  std::vector<float> costs_;          // [histogram << 8 | symbol]
+};
+
+// Upper bound on the number of bytes WriteTokens appends for "num_tokens".
+static inline size_t MaxWriteTokensSize(const size_t num_tokens) {
+  return 4 * num_tokens + 4096;
+}
+
+// Appends the (byte-aligned) encoding of "tokens" to "output". Reserves
+// MaxWriteTokensSize, so callers that already did so avoid reallocations.
+// Tokens are interleaved among "num_states" (1, 2 or 4) ANS states; the
+// decoder's ANSSymbolReader must be constructed with the same value.
+void WriteTokens(const std::vector<Token>& tokens,
+                 const std::vector<ANSEncodingData>& codes,
+                 const std::vector<uint8_t>& context_map,
+                 PikImageSizeInfo* pik_info, PaddedBytes* PIK_RESTRICT output,
+                 size_t num_states = 1);
 
 bool DecodeCoeffOrder(int32_t* order, BitReader* br);
 
@@ -164,19 +317,83 @@ bool DecodeHistograms(BitReader* br, const size_t num_contexts,
                       size_t symbol_lut_size, ANSCode* code,
                       std::vector<uint8_t>* context_map);
 
-// Decodes into "rect" within "img".
-bool DecodeImage(BitReader* PIK_RESTRICT br, const Rect& rect,
-                 Image3S* PIK_RESTRICT img);
+// Result of DecodeHistograms and the bytes it was decoded from.
+struct DecodedHistograms {
+  std::vector<uint8_t> encoded;
+  ANSCode code;
+  std::vector<uint8_t> context_map;
+
+  size_t BytesAllocated() const {
+    return encoded.capacity() +
+           code.entries.capacity() * sizeof(code.entries[0]) +
+           context_map.capacity();
+  }
+};
+
+// Recently decoded histograms, shared by all decoders (e.g. threads decoding
+// images from the same encoder pipeline, which often carry identical
+// histograms), so that their ANS tables are only built once. Entries are
+// immutable and may be used concurrently. Thread-safe.
+class HistogramCache {
+ public:
+  static HistogramCache& Global();
+
+  // Equivalent to DecodeHistograms at the byte-aligned position of "br"
+  // within "data", but returns a previously decoded instance if the stream
+  // continues with the same bytes (decoding is deterministic and
+  // self-delimiting, so the result would be identical). Returns null if the
+  // histograms are invalid. Afterwards, "br" is positioned after them.
+  std::shared_ptr<const DecodedHistograms> Decode(
+      const uint8_t* data, size_t size, size_t num_contexts,
+      size_t max_alphabet_size, const uint8_t* symbol_lut,
+      size_t symbol_lut_size, BitReader* br);
+
+ private:
+  struct Entry {
+    // Parameters of DecodeHistograms; the same bytes may decode differently.
+    size_t num_contexts;
+    size_t max_alphabet_size;
+    const uint8_t* symbol_lut;
+    std::shared_ptr<const DecodedHistograms> histograms;
+  };
+
+  // Enough for a few concurrent pipelines; each entry holds ANS_TAB_SIZE
+  // entries per histogram.
+  static constexpr size_t kMaxEntries = 8;
+
+  std::mutex mutex_;
+  std::vector<Entry> entries_;  // least recently used first
+};
+
+// Reads the output of BuildAndEncodeHistogramsStatic at the byte-aligned
+// position of "br" within "data": returns the (shared) built-in set or else
+// the result of HistogramCache::Global for kNumContexts AC contexts, or null
+// if the ID or histograms are invalid.
+std::shared_ptr<const DecodedHistograms> DecodeHistogramsStatic(
+    const uint8_t* data, size_t size, BitReader* br);
+
+// Decodes into "rect" within "img". "br" must be at a byte boundary.
+bool DecodeImage(PaddedBitReader* PIK_RESTRICT br, const Rect& rect,
+                 Image3S* PIK_RESTRICT img, bool grayscale = false);
+
+// Decodes the output of EncodeImageWithNeighbors into "rect" within "img".
+// "br" must be at a byte boundary.
+bool DecodeImageWithNeighbors(PaddedBitReader* PIK_RESTRICT br,
+                              const Rect& rect, Image3S* PIK_RESTRICT img,
+                              bool grayscale = false);
 
 // "rect_ac/qf" are in blocks.
 // DC component in ac's DCT blocks is invalid.
+// "tmp_num_nzeroes" receives the number of nonzero AC coefficients of each
+// block (relative to rect_ac); zero means the whole block is zero.
 bool DecodeAC(const Image3B& tmp_block_ctx, const ANSCode& code,
               const std::vector<uint8_t>& context_map,
               const int32_t* PIK_RESTRICT coeff_order,
-              BitReader* PIK_RESTRICT br, const Rect& rect_ac,
+              PaddedBitReader* PIK_RESTRICT br, const Rect& rect_ac,
               Image3S* PIK_RESTRICT ac, const Rect& rect_qf,
               ImageI* PIK_RESTRICT quant_field,
-              Image3I* PIK_RESTRICT tmp_num_nzeroes);
+              Image3I* PIK_RESTRICT tmp_num_nzeroes, size_t num_ans_states = 1,
+              bool grayscale = false);
 
 }  // namespace pik
 
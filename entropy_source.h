@@ -30,6 +30,14 @@ class EntropySource {
     histograms_[histo_ix].Add(code);
   }
 
+  // Accumulates the histograms of "other", which must have the same size.
+  void AddHistograms(const EntropySource& other) {
+    PIK_ASSERT(other.histograms_.size() == histograms_.size());
+    for (size_t i = 0; i < histograms_.size(); ++i) {
+      histograms_[i].AddHistogram(other.histograms_[i]);
+    }
+  }
+
   void ClusterHistograms(const std::vector<int>& offsets) {
     std::vector<uint32_t> context_map32;
     pik::ClusterHistograms(histograms_, num_contexts_, num_bands_, offsets,
@@ -65,12 +65,25 @@ class U32Coder {
     return ok;
   }
 
+  // Visitors pass "distribution" as a constant, so after inlining the selector
+  // lookup reduces to a table of four immediates. One buffer refill suffices
+  // unless the extra bits straddle the refill boundary.
   static uint32_t Load(const uint32_t distribution,
                        BitReader* PIK_RESTRICT reader) {
     ValidateDistribution(distribution);
-    const int selector = reader->ReadFixedBits<2>();
+    reader->FillBitBuffer();
+    const uint32_t selector_and_bits = reader->PeekFixedBits<32>();
+    const int selector = selector_and_bits & 3;
     const size_t b = Lookup(distribution, selector);
-    if (b & 0x80) return b & 0x7F;
+    if (b & 0x80) {
+      reader->Advance(2);
+      return b & 0x7F;
+    }
+    if (b <= 30) {
+      reader->Advance(2 + b);
+      return (selector_and_bits >> 2) & ((1U << b) - 1);
+    }
+    reader->Advance(2);
     return reader->ReadBits(b);
   }
 
@@ -189,6 +202,16 @@ class BytesCoder {
     }
   }
 
+  // Skips past the encoded bytes without copying them. "*payload_bit_pos" is
+  // the position of the first byte (in bits from the start of the stream).
+  static void Skip(BitReader* PIK_RESTRICT reader,
+                   size_t* PIK_RESTRICT payload_bit_pos,
+                   uint32_t* PIK_RESTRICT num_bytes) {
+    *num_bytes = U32Coder::Load(kDistribution, reader);
+    *payload_bit_pos = reader->BitsRead();
+    reader->SkipBits(static_cast<size_t>(*num_bytes) * 8);
+  }
+
   static bool Store(const std::vector<uint8_t>& value, size_t* PIK_RESTRICT pos,
                     uint8_t* storage) {
     if (!U32Coder::Store(kDistribution, value.size(), pos, storage))
@@ -234,6 +257,29 @@ class ReadFieldsVisitor {
   BitReader* const reader_;
 };
 
+// Reads integer fields but skips over byte arrays, remembering the location of
+// the last one (see BytesCoder::Skip).
+class SkipFieldsVisitor {
+ public:
+  SkipFieldsVisitor(BitReader* reader) : reader_(reader) {}
+
+  void operator()(const uint32_t distribution, uint32_t* PIK_RESTRICT value) {
+    *value = U32Coder::Load(distribution, reader_);
+  }
+
+  void operator()(std::vector<uint8_t>* PIK_RESTRICT value) {
+    BytesCoder::Skip(reader_, &payload_bit_pos_, &num_bytes_);
+  }
+
+  size_t PayloadBitPos() const { return payload_bit_pos_; }
+  uint32_t NumBytes() const { return num_bytes_; }
+
+ private:
+  BitReader* const reader_;
+  size_t payload_bit_pos_ = 0;
+  uint32_t num_bytes_ = 0;
+};
+
 class CanEncodeFieldsVisitor {
  public:
   void operator()(const uint32_t distribution,
@@ -19,6 +19,7 @@
 
 #include "compiler_specific.h"
 #include "profiler.h"
+#include "status.h"
 
 namespace pik {
 
@@ -35,6 +36,42 @@ const float* Srgb8ToLinearTable() {
   return kSrgb8ToLinearTable;
 }
 
+namespace {
+
+const float* NewSrgbToLinearTable(const int bit_depth) {
+  const size_t max_value = (1u << bit_depth) - 1;
+  // 1/257 for 16 bits, as in LinearFromSrgb.
+  const float norm = 1.0f / (max_value / 255.0f);
+  float* table = new float[max_value + 1];
+  for (size_t i = 0; i <= max_value; ++i) {
+    table[i] = Srgb8ToLinearDirect(i * norm);
+  }
+  return table;
+}
+
+}  // namespace
+
+const float* SrgbToLinearTable(const int bit_depth) {
+  switch (bit_depth) {
+    case 8:
+      return Srgb8ToLinearTable();
+    case 10: {
+      static const float* const kTable = NewSrgbToLinearTable(10);
+      return kTable;
+    }
+    case 12: {
+      static const float* const kTable = NewSrgbToLinearTable(12);
+      return kTable;
+    }
+    case 16: {
+      static const float* const kTable = NewSrgbToLinearTable(16);
+      return kTable;
+    }
+  }
+  PIK_CHECK(false);
+  return nullptr;
+}
+
 ImageF LinearFromSrgb(const ImageB& srgb) {
   PROFILER_FUNC;
   const float* lut = Srgb8ToLinearTable();
@@ -61,12 +98,12 @@ ImageF LinearFromSrgb(const ImageU& srgb) {
   const size_t xsize = srgb.xsize();
   const size_t ysize = srgb.ysize();
   ImageF linear(xsize, ysize);
-  const float norm = 1.0f / 257.0f;
+  const float* lut = SrgbToLinearTable(16);
   for (size_t y = 0; y < ysize; ++y) {
     const uint16_t* const PIK_RESTRICT row = srgb.Row(y);
     float* const PIK_RESTRICT row_linear = linear.Row(y);
     for (size_t x = 0; x < xsize; ++x) {
-      row_linear[x] = Srgb8ToLinearDirect(row[x] * norm);
+      row_linear[x] = lut[row[x]];
     }
   }
   return linear;
@@ -29,6 +29,11 @@ namespace pik {
 
 const float* Srgb8ToLinearTable();
 
+// Returns a table of the linear values [0, 255] of all 2^bit_depth sRGB
+// samples (bit_depth = 8, 10, 12 or 16), i.e. Srgb8ToLinearDirect of their
+// values scaled to [0, 255]. Computed once; the 16-bit table is 256 KiB.
+const float* SrgbToLinearTable(int bit_depth);
+
 PIK_INLINE uint8_t LinearToSrgb8(const uint8_t* lut, float val) {
   val = std::min(255.0f, std::max(0.0f, val));
   return lut[static_cast<int>(val * 16.0f + 0.5f)];
@@ -15,13 +15,20 @@
 #include "gauss_blur.h"
 
 #include <math.h>
+#include <string.h>
 #include <algorithm>
+#include <cmath>
+#include <complex>
 
 #undef PROFILER_ENABLED
 #define PROFILER_ENABLED 1
+#include "cache_aligned.h"
+#include "common.h"
 #include "compiler_specific.h"
 #include "gamma_correct.h"
 #include "profiler.h"
+#include "simd/simd.h"
+#include "status.h"
 
 namespace pik {
 
@@ -39,6 +46,36 @@ inline void ExtrapolateBorders(const float* const PIK_RESTRICT row_in,
   }
 }
 
+namespace {
+
+// Input rows per ThreadPool task; their outputs are consecutive within each
+// transposed row, which avoids false sharing.
+constexpr size_t kTransposeRowsPerTask = 16;
+
+// Computes output columns [y_begin, y_end) of ConvolveXSampleAndTranspose.
+void ConvolveXSampleAndTransposeRows(const ImageF& in,
+                                     const std::vector<float>& kernel,
+                                     const size_t res, const int y_begin,
+                                     const int y_end, ImageF* out) {
+  const int offset = res / 2;
+  const int r = kernel.size() / 2;
+  std::vector<float> row_tmp(in.xsize() + 2 * r);
+  float* const PIK_RESTRICT rowp = &row_tmp[r];
+  const float* const kernelp = &kernel[r];
+  for (int y = y_begin; y < y_end; ++y) {
+    ExtrapolateBorders(in.Row(y), rowp, in.xsize(), r);
+    for (int x = offset, ox = 0; x < in.xsize(); x += res, ++ox) {
+      float sum = 0.0f;
+      for (int i = -r; i <= r; ++i) {
+        sum += rowp[x + i] * kernelp[i];
+      }
+      out->Row(ox)[y] = sum;
+    }
+  }
+}
+
+}  // namespace
+
 ImageF ConvolveXSampleAndTranspose(const ImageF& in,
                                    const std::vector<float>& kernel,
                                    const size_t res) {
@@ -51,23 +88,26 @@ ImageF ConvolveXSampleAndTranspose(const ImageF& in,
   }
   PIK_ASSERT(kernel.size() % 2 == 1);
   PIK_ASSERT(in.xsize() % res == 0);
-  const int offset = res / 2;
   const int out_xsize = in.xsize() / res;
   ImageF out(in.ysize(), out_xsize);
-  const int r = kernel.size() / 2;
-  std::vector<float> row_tmp(in.xsize() + 2 * r);
-  float* const PIK_RESTRICT rowp = &row_tmp[r];
-  const float* const kernelp = &kernel[r];
-  for (int y = 0; y < in.ysize(); ++y) {
-    ExtrapolateBorders(in.Row(y), rowp, in.xsize(), r);
-    for (int x = offset, ox = 0; x < in.xsize(); x += res, ++ox) {
-      float sum = 0.0f;
-      for (int i = -r; i <= r; ++i) {
-        sum += rowp[x + i] * kernelp[i];
-      }
-      out.Row(ox)[y] = sum;
-    }
-  }
+  ConvolveXSampleAndTransposeRows(in, kernel, res, 0, in.ysize(), &out);
+  return out;
+}
+
+ImageF ConvolveXSampleAndTranspose(const ImageF& in,
+                                   const std::vector<float>& kernel,
+                                   const size_t res, ThreadPool* pool) {
+  PIK_ASSERT(kernel.size() % 2 == 1);
+  PIK_ASSERT(in.xsize() % res == 0);
+  const int out_xsize = in.xsize() / res;
+  ImageF out(in.ysize(), out_xsize);
+  const size_t num_tasks = DivCeil(in.ysize(), kTransposeRowsPerTask);
+  pool->Run(0, num_tasks, [&](const int task, const int thread) {
+    const size_t y_begin = task * kTransposeRowsPerTask;
+    const size_t y_end =
+        std::min(y_begin + kTransposeRowsPerTask, in.ysize());
+    ConvolveXSampleAndTransposeRows(in, kernel, res, y_begin, y_end, &out);
+  });
   return out;
 }
 
@@ -87,6 +127,14 @@ ImageF ConvolveAndSample(const ImageF& in,
   return ConvolveXSampleAndTranspose(tmp, kernel_y, res);
 }
 
+ImageF ConvolveAndSample(const ImageF& in,
+                         const std::vector<float>& kernel_x,
+                         const std::vector<float>& kernel_y,
+                         const size_t res, ThreadPool* pool) {
+  ImageF tmp = ConvolveXSampleAndTranspose(in, kernel_x, res, pool);
+  return ConvolveXSampleAndTranspose(tmp, kernel_y, res, pool);
+}
+
 ImageF Convolve(const ImageF& in,
                 const std::vector<float>& kernel_x,
                 const std::vector<float>& kernel_y) {
@@ -107,6 +155,208 @@ ImageF ConvolveAndSample(const ImageF& in,
   return ConvolveAndSample(in, kernel, kernel, res);
 }
 
+ImageF ConvolveAndSample(const ImageF& in, const std::vector<float>& kernel,
+                         const size_t res, ThreadPool* pool) {
+  return ConvolveAndSample(in, kernel, kernel, res, pool);
+}
+
+namespace {
+
+// Feedback and gain of each (causal or anti-causal) pass of the recursive
+// Gaussian: out[n] = gain * in[n] + sum_k feedback[k] * out[n -/+ (k + 1)].
+// The poles are those of Young, van Vliet and van Ginkel, "Recursive Gabor
+// filtering" (IEEE TSP 2002), scaled to match the variance of the Gaussian.
+// Constant input is preserved.
+struct RecursiveGaussian {
+  explicit RecursiveGaussian(const float sigma)
+      : radius(static_cast<int>(std::ceil(3.0f * sigma))) {
+    PIK_CHECK(sigma >= 0.5f);
+    // Poles for sigma = 2 (q = 1); raising them to the power 1/q scales the
+    // impulse response. The variance increases monotonically with q.
+    const std::complex<double> kPole1(1.41650, 1.00829);
+    const double kPole3 = 1.86543;
+    const auto variance = [&](const double q) {
+      const std::complex<double> d1 = std::pow(kPole1, 1.0 / q);
+      const double d3 = std::pow(kPole3, 1.0 / q);
+      // Causal and anti-causal passes; the conjugate pole adds the same.
+      return 2.0 * (2.0 * (d1 / ((d1 - 1.0) * (d1 - 1.0))).real() +
+                    d3 / ((d3 - 1.0) * (d3 - 1.0)));
+    };
+    double q_min = 0.05;
+    double q_max = 10.0 * sigma;
+    for (int i = 0; i < 64; ++i) {
+      const double q = 0.5 * (q_min + q_max);
+      (variance(q) < sigma * sigma ? q_min : q_max) = q;
+    }
+    const double q = 0.5 * (q_min + q_max);
+
+    // Expands (1 - c z^-1)(1 - conj(c) z^-1)(1 - u z^-1).
+    const std::complex<double> c = 1.0 / std::pow(kPole1, 1.0 / q);
+    const double u = 1.0 / std::pow(kPole3, 1.0 / q);
+    const double c_norm = std::norm(c);
+    feedback[0] = 2.0 * c.real() + u;
+    feedback[1] = -(c_norm + 2.0 * c.real() * u);
+    feedback[2] = c_norm * u;
+    gain = 1.0 - (feedback[0] + feedback[1] + feedback[2]);
+  }
+
+  // Both passes start in the steady state for the border value after this
+  // many mirrored (see ExtrapolateBorders) values.
+  const int radius;
+  float gain;
+  float feedback[3];
+};
+
+// Returns the mirrored coordinate for -radius <= i < size + radius, as in
+// ExtrapolateBorders.
+PIK_INLINE int MirrorForBlur(const int i, const int size) {
+  if (i < 0) return std::min(-i, size - 1);
+  if (i >= size) return std::max(0, 2 * (size - 1) - i);
+  return i;
+}
+
+// Padding on either side of the filtered values: the previous outputs
+// required by the first step of each pass.
+constexpr int kRecursivePadding = 3;
+
+// Filters "row" in place; its kRecursivePadding entries before/after the
+// "size" valid entries are overwritten.
+void RecursiveGaussianRow(const RecursiveGaussian& rg, const int size,
+                          float* PIK_RESTRICT row) {
+  const float g = rg.gain;
+  const float a0 = rg.feedback[0];
+  const float a1 = rg.feedback[1];
+  const float a2 = rg.feedback[2];
+  for (int i = 1; i <= kRecursivePadding; ++i) {
+    row[-i] = row[0];
+  }
+  for (int i = 0; i < size; ++i) {
+    row[i] = g * row[i] + a0 * row[i - 1] + a1 * row[i - 2] + a2 * row[i - 3];
+  }
+  for (int i = 0; i < kRecursivePadding; ++i) {
+    row[size + i] = row[size - 1];
+  }
+  for (int i = size - 1; i >= 0; --i) {
+    row[i] = g * row[i] + a0 * row[i + 1] + a1 * row[i + 2] + a2 * row[i + 3];
+  }
+}
+
+ImageF RecursiveGaussianHorizontal(const ImageF& in,
+                                   const RecursiveGaussian& rg,
+                                   ThreadPool* pool) {
+  const int xsize = in.xsize();
+  const int r = rg.radius;
+  const int padded_xsize = xsize + 2 * r;
+  ImageF out(in.xsize(), in.ysize());
+  pool->Run(0, in.ysize(), [&](const int task, const int thread) {
+    const int y = task;
+    std::vector<float> row_tmp(padded_xsize + 2 * kRecursivePadding);
+    float* const PIK_RESTRICT rowp = &row_tmp[kRecursivePadding + r];
+    ExtrapolateBorders(in.Row(y), rowp, xsize, r);
+    RecursiveGaussianRow(rg, padded_xsize, rowp - r);
+    memcpy(out.Row(y), rowp, xsize * sizeof(rowp[0]));
+  });
+  return out;
+}
+
+// Columns per ThreadPool task; their vectors are filtered in an interleaved
+// fashion to hide the latency of the recursion.
+constexpr size_t kRecursiveColumnsPerTask = 64;
+
+// Same as RecursiveGaussianRow, but for kRecursiveColumnsPerTask columns.
+// "rows" is a pointer to the first valid row of the column-interleaved buffer.
+void RecursiveGaussianColumns(const RecursiveGaussian& rg, const int size,
+                              float* PIK_RESTRICT rows) {
+  using namespace SIMD_NAMESPACE;
+  using D = Full<float>;
+  using V = D::V;
+  const D d;
+  constexpr int kStride = kRecursiveColumnsPerTask;
+  const V g = set1(d, rg.gain);
+  const V a0 = set1(d, rg.feedback[0]);
+  const V a1 = set1(d, rg.feedback[1]);
+  const V a2 = set1(d, rg.feedback[2]);
+
+  for (int i = 1; i <= kRecursivePadding; ++i) {
+    memcpy(rows - i * kStride, rows, kStride * sizeof(float));
+  }
+  for (int i = 0; i < size; ++i) {
+    float* PIK_RESTRICT row = rows + i * kStride;
+    for (size_t x = 0; x < kStride; x += d.N) {
+      const V sum = g * load(d, row + x) + a0 * load(d, row - kStride + x) +
+                    a1 * load(d, row - 2 * kStride + x) +
+                    a2 * load(d, row - 3 * kStride + x);
+      store(sum, d, row + x);
+    }
+  }
+  for (int i = 0; i < kRecursivePadding; ++i) {
+    memcpy(rows + (size + i) * kStride, rows + (size - 1) * kStride,
+           kStride * sizeof(float));
+  }
+  for (int i = size - 1; i >= 0; --i) {
+    float* PIK_RESTRICT row = rows + i * kStride;
+    for (size_t x = 0; x < kStride; x += d.N) {
+      const V sum = g * load(d, row + x) + a0 * load(d, row + kStride + x) +
+                    a1 * load(d, row + 2 * kStride + x) +
+                    a2 * load(d, row + 3 * kStride + x);
+      store(sum, d, row + x);
+    }
+  }
+}
+
+ImageF RecursiveGaussianVertical(const ImageF& in, const RecursiveGaussian& rg,
+                                 ThreadPool* pool) {
+  const int xsize = in.xsize();
+  const int ysize = in.ysize();
+  const int r = rg.radius;
+  const int padded_ysize = ysize + 2 * r;
+  constexpr size_t kStride = kRecursiveColumnsPerTask;
+  ImageF out(xsize, ysize);
+  const size_t num_tasks = DivCeil(in.xsize(), kStride);
+  pool->Run(0, num_tasks, [&](const int task, const int thread) {
+    const size_t x0 = task * kStride;
+    const size_t num_columns = std::min(kStride, in.xsize() - x0);
+    CacheAlignedUniquePtr buffer = AllocateArray(
+        (padded_ysize + 2 * kRecursivePadding) * kStride * sizeof(float));
+    float* const PIK_RESTRICT rows =
+        reinterpret_cast<float*>(buffer.get()) + kRecursivePadding * kStride;
+    for (int i = 0; i < padded_ysize; ++i) {
+      const float* PIK_RESTRICT row_in = in.Row(MirrorForBlur(i - r, ysize));
+      memcpy(rows + i * kStride, row_in + x0, num_columns * sizeof(float));
+      // Avoids filtering uninitialized values.
+      std::fill(rows + i * kStride + num_columns, rows + (i + 1) * kStride,
+                0.0f);
+    }
+    RecursiveGaussianColumns(rg, padded_ysize, rows);
+    for (int y = 0; y < ysize; ++y) {
+      memcpy(out.Row(y) + x0, rows + (y + r) * kStride,
+             num_columns * sizeof(float));
+    }
+  });
+  return out;
+}
+
+}  // namespace
+
+ImageF GaussianBlur(const ImageF& in, const float sigma,
+                    const GaussianBlurMethod method, ThreadPool* pool) {
+  PROFILER_FUNC;
+  if (method == GaussianBlurMethod::kKernel) {
+    const int radius = static_cast<int>(std::ceil(3.0f * sigma));
+    return ConvolveAndSample(in, GaussianKernel(radius, sigma), 1, pool);
+  }
+  const RecursiveGaussian rg(sigma);
+  return RecursiveGaussianVertical(RecursiveGaussianHorizontal(in, rg, pool),
+                                   rg, pool);
+}
+
+Image3F GaussianBlur(const Image3F& in, const float sigma,
+                     const GaussianBlurMethod method, ThreadPool* pool) {
+  return Image3F(GaussianBlur(in.Plane(0), sigma, method, pool),
+                 GaussianBlur(in.Plane(1), sigma, method, pool),
+                 GaussianBlur(in.Plane(2), sigma, method, pool));
+}
+
 ImageF Convolve(const ImageF& in, const std::vector<float>& kernel) {
   return ConvolveAndSample(in, kernel, 1);
 }
@@ -18,6 +18,7 @@
 #include <stddef.h>
 #include <vector>
 
+#include "data_parallel.h"
 #include "image.h"
 
 namespace pik {
@@ -68,6 +69,14 @@ ImageF ConvolveAndSample(const ImageF& in,
                          const std::vector<float>& kernel_y,
                          const size_t res);
 
+// Same as above, but rows are processed in parallel. The result is identical.
+ImageF ConvolveAndSample(const ImageF& in, const std::vector<float>& kernel,
+                         const size_t res, ThreadPool* pool);
+ImageF ConvolveAndSample(const ImageF& in,
+                         const std::vector<float>& kernel_x,
+                         const std::vector<float>& kernel_y,
+                         const size_t res, ThreadPool* pool);
+
 // TODO(janwas): Use ConvolveT instead (if |kernel| <= 5 and res == 1).
 ImageF ConvolveXSampleAndTranspose(const ImageF& in,
                                    const std::vector<float>& kernel,
@@ -75,6 +84,27 @@ ImageF ConvolveXSampleAndTranspose(const ImageF& in,
 Image3F ConvolveXSampleAndTranspose(const Image3F& in,
                                     const std::vector<float>& kernel,
                                     const size_t res);
+ImageF ConvolveXSampleAndTranspose(const ImageF& in,
+                                   const std::vector<float>& kernel,
+                                   const size_t res, ThreadPool* pool);
+
+// Implementations of GaussianBlur.
+enum class GaussianBlurMethod {
+  // Separable FIR kernel (GaussianKernel) truncated at 3 sigma: accurate, but
+  // the cost per pixel grows linearly with sigma.
+  kKernel,
+  // Young-van Vliet recursive (IIR) filter: constant cost per pixel for any
+  // sigma >= 0.5, vectorized across columns. Approximate: for sigma >= 1, the
+  // step response deviates by less than 1% of the step height.
+  kRecursive
+};
+
+// Blurs with a Gaussian of standard deviation "sigma" in both directions,
+// mirroring borders as above. Rows/columns are processed in parallel.
+ImageF GaussianBlur(const ImageF& in, float sigma, GaussianBlurMethod method,
+                    ThreadPool* pool);
+Image3F GaussianBlur(const Image3F& in, float sigma, GaussianBlurMethod method,
+                     ThreadPool* pool);
 
 }  // namespace pik
 
@@ -97,6 +97,54 @@ void ButteraugliComparator::Compare(const OutputImage& img) {
   distance_ = butteraugli::ButteraugliScoreFromDiffmap(distmap);
 }
 
+void ButteraugliComparator::CompareRegion(const OutputImage& img,
+                                          const int xmin, const int ymin,
+                                          const int xsize, const int ysize) {
+  if (xsize <= 0 || ysize <= 0) return;
+  const int support = butteraugli::ButteraugliComparator::kDiffmapSupport;
+  // Part of the distance map that may change.
+  const int x0 = std::max(0, xmin - support);
+  const int y0 = std::max(0, ymin - support);
+  const int x1 = std::min(width_, xmin + xsize + support);
+  const int y1 = std::min(height_, ymin + ysize + support);
+  // Its diffmap is exact if computed from this region.
+  const int region_x0 = std::max(0, x0 - support);
+  const int region_y0 = std::max(0, y0 - support);
+  const int region_xsize = std::min(width_, x1 + support) - region_x0;
+  const int region_ysize = std::min(height_, y1 + support) - region_y0;
+  if (region_xsize < 8 || region_ysize < 8 ||
+      2 * region_xsize * region_ysize > width_ * height_) {
+    Compare(img);
+    return;
+  }
+
+  std::vector<std::vector<float> > rgb(
+      3, std::vector<float>(region_xsize * region_ysize));
+  img.ToLinearRGB(region_x0, region_y0, region_xsize, region_ysize, &rgb);
+  ImageF distmap;
+  comparator_.DiffmapRegion(region_x0, region_y0,
+                            PlanesFromPacked(region_xsize, region_ysize, rgb),
+                            distmap);
+  float old_max = 0.0f;
+  float new_max = 0.0f;
+  for (int y = y0; y < y1; ++y) {
+    const float* const BUTTERAUGLI_RESTRICT row_in = distmap.Row(y - region_y0);
+    float* const BUTTERAUGLI_RESTRICT row_out = &distmap_[y * width_];
+    for (int x = x0; x < x1; ++x) {
+      const float value = row_in[x - region_x0];
+      old_max = std::max(old_max, row_out[x]);
+      new_max = std::max(new_max, value);
+      row_out[x] = value;
+    }
+  }
+  if (new_max >= distance_) {
+    distance_ = new_max;
+  } else if (old_max >= distance_) {
+    // The maximum was in the window and decreased.
+    distance_ = *std::max_element(distmap_.begin(), distmap_.end());
+  }
+}
+
 namespace {
 
 // To change this to n, add the relevant FFTn function and kFFTnMapIndexTable.
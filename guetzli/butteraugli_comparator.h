@@ -36,6 +36,12 @@ class ButteraugliComparator : public Comparator {
 
   void Compare(const OutputImage& img) override;
 
+  // Recomputes the distance map only within the diffmap support of the
+  // window, from a region twice that far around it. Falls back to Compare if
+  // that region is not much smaller than the image.
+  void CompareRegion(const OutputImage& img, int xmin, int ymin, int xsize,
+                     int ysize) override;
+
   double CompareBlock(const OutputImage& img, int block_x,
                       int block_y) const override;
 
@@ -37,6 +37,15 @@ class Comparator {
   // baseline image.
   virtual void Compare(const OutputImage& img) = 0;
 
+  // Same as Compare, but only the pixels of img within the window with
+  // upper-left corner (xmin, ymin) and size xsize x ysize may differ from the
+  // image of the last Compare or CompareRegion call. Comparators that can
+  // update only the affected part of the distance map override this.
+  virtual void CompareRegion(const OutputImage& img, int xmin, int ymin,
+                             int xsize, int ysize) {
+    Compare(img);
+  }
+
   // Compares an 8x8 block of the baseline image with the same block of img and
   // returns the resulting per-block distance. The interpretation of the
   // returned distance depends on the comparator used.
@@ -20,6 +20,9 @@
 
 #include "guetzli/fdct.h"
 
+#include "dct.h"
+#include "simd/simd.h"
+
 namespace pik {
 namespace guetzli {
 
@@ -36,6 +39,16 @@ const coeff_t kTable26[7] = { 29692, 27969, 25172, 21407, 16819, 11585, 5906 };
 // rows #3 and #5 are pre-multiplied by 2.C(3):
 const coeff_t kTable35[7] = { 26722, 25172, 22654, 19266, 15137, 10426, 5315 };
 
+// The above tables in the order of the rows that use them, transposed such
+// that kRowTables[k] holds the k-th constant of rows 0..7.
+#define ROW_TABLE(k)                                                     \
+  { kTable04[k], kTable17[k], kTable26[k], kTable35[k], kTable04[k],     \
+    kTable35[k], kTable26[k], kTable17[k] }
+SIMD_ALIGN const int32_t kRowTables[7][8] = {
+    ROW_TABLE(0), ROW_TABLE(1), ROW_TABLE(2), ROW_TABLE(3),
+    ROW_TABLE(4), ROW_TABLE(5), ROW_TABLE(6)};
+#undef ROW_TABLE
+
 ///////////////////////////////////////////////////////////////////////////////
 // Constants (15bit precision) and C macros for IDCT vertical pass
 
@@ -146,67 +159,79 @@ const coeff_t kTable35[7] = { 26722, 25172, 22654, 19266, 15137, 10426, 5315 };
 } while (0)
 
 
-// these are the macro required by COLUMN_*
-#define LOAD_CST(dst, src) (dst) = (src)
-#define LOAD(dst, src) (dst) = (src)
-#define MULT(a, b)  (a) = (((a) * (b)) >> 16)
+// these are the macro required by COLUMN_*, operating on vectors "d" of
+// int32 lanes. Integer arithmetic (wrapping like the scalar code) is exact,
+// so the result does not depend on the vector width.
+#define LOAD_CST(dst, src) (dst) = set1(d, (src))
+#define LOAD(dst, src) (dst) = load(d, &(src))
+#define MULT(a, b)  (a) = shift_right<16>((a) * (b))
 #define ADD(a, b)   (a) = (a) + (b)
 #define SUB(a, b)   (a) = (a) - (b)
-// Shift as unsigned to avoid ubsan failure. Assumes 2's complement.
-#define LSHIFT(a, n) (a) = (int(unsigned(a) << (n)))
-#define STORE16(a, b) (a) = (b)
-#define CORRECT_LSB(a) (a) += 1
+#define LSHIFT(a, n) (a) = shift_left<n>(a)
+// Wraps around like a store to coeff_t.
+#define STORE16(a, b) store(shift_right<16>(shift_left<16>(b)), d, &(a))
+#define CORRECT_LSB(a) (a) += set1(d, 1)
+
+using DctDesc =
+    SIMD_NAMESPACE::Part<int32_t, SIMD_MIN(8, SIMD_NAMESPACE::Full<int32_t>::N)>;
 
-// DCT vertical pass
+// DCT vertical pass; each lane holds one column.
 
-inline void ColumnDct(coeff_t* in) {
-  for (int i = 0; i < 8; ++i) {
-    int m0, m1, m2, m3, m4, m5, m6, m7;
+inline void ColumnDct(int32_t* in) {
+  using namespace SIMD_NAMESPACE;
+  const DctDesc d;
+  for (int i = 0; i < 8; i += d.N) {
+    DctDesc::V m0, m1, m2, m3, m4, m5, m6, m7;
     COLUMN_DCT8(in + i);
   }
 }
 
-// DCT horizontal pass
+// DCT horizontal pass; "in" is transposed such that each lane holds one row.
 
 // We don't really need to round before descaling, since we
 // still have 4 bits of precision left as final scaled output.
-#define DESCALE(a)  static_cast<coeff_t>((a) >> 16)
-
-void RowDct(coeff_t* in, const coeff_t* table) {
-  // The Fourier transform is an unitary operator, so we're basically
-  // doing the transpose of RowIdct()
-  const int a0 = in[0] + in[7];
-  const int b0 = in[0] - in[7];
-  const int a1 = in[1] + in[6];
-  const int b1 = in[1] - in[6];
-  const int a2 = in[2] + in[5];
-  const int b2 = in[2] - in[5];
-  const int a3 = in[3] + in[4];
-  const int b3 = in[3] - in[4];
-
-  // even part
-  const int C2 = table[1];
-  const int C4 = table[3];
-  const int C6 = table[5];
-  const int c0 = a0 + a3;
-  const int c1 = a0 - a3;
-  const int c2 = a1 + a2;
-  const int c3 = a1 - a2;
-
-  in[0] = DESCALE(C4 * (c0 + c2));
-  in[4] = DESCALE(C4 * (c0 - c2));
-  in[2] = DESCALE(C2 * c1 + C6 * c3);
-  in[6] = DESCALE(C6 * c1 - C2 * c3);
-
-  // odd part
-  const int C1 = table[0];
-  const int C3 = table[2];
-  const int C5 = table[4];
-  const int C7 = table[6];
-  in[1] = DESCALE(C1 * b0 + C3 * b1 + C5 * b2 + C7 * b3);
-  in[3] = DESCALE(C3 * b0 - C7 * b1 - C1 * b2 - C5 * b3);
-  in[5] = DESCALE(C5 * b0 - C1 * b1 + C7 * b2 + C3 * b3);
-  in[7] = DESCALE(C7 * b0 - C5 * b1 + C3 * b2 - C1 * b3);
+#define DESCALE(a)  shift_right<16>(a)
+
+void RowDct(int32_t* in) {
+  using namespace SIMD_NAMESPACE;
+  const DctDesc d;
+  for (int i = 0; i < 8; i += d.N) {
+    int32_t* row = in + i;
+    // The Fourier transform is an unitary operator, so we're basically
+    // doing the transpose of RowIdct()
+    const auto a0 = load(d, row + 0 * 8) + load(d, row + 7 * 8);
+    const auto b0 = load(d, row + 0 * 8) - load(d, row + 7 * 8);
+    const auto a1 = load(d, row + 1 * 8) + load(d, row + 6 * 8);
+    const auto b1 = load(d, row + 1 * 8) - load(d, row + 6 * 8);
+    const auto a2 = load(d, row + 2 * 8) + load(d, row + 5 * 8);
+    const auto b2 = load(d, row + 2 * 8) - load(d, row + 5 * 8);
+    const auto a3 = load(d, row + 3 * 8) + load(d, row + 4 * 8);
+    const auto b3 = load(d, row + 3 * 8) - load(d, row + 4 * 8);
+
+    // even part
+    const auto C2 = load(d, kRowTables[1] + i);
+    const auto C4 = load(d, kRowTables[3] + i);
+    const auto C6 = load(d, kRowTables[5] + i);
+    const auto c0 = a0 + a3;
+    const auto c1 = a0 - a3;
+    const auto c2 = a1 + a2;
+    const auto c3 = a1 - a2;
+
+    STORE16(row[0 * 8], DESCALE(C4 * (c0 + c2)));
+    STORE16(row[4 * 8], DESCALE(C4 * (c0 - c2)));
+    STORE16(row[2 * 8], DESCALE(C2 * c1 + C6 * c3));
+    STORE16(row[6 * 8], DESCALE(C6 * c1 - C2 * c3));
+
+    // odd part
+    const auto C1 = load(d, kRowTables[0] + i);
+    const auto C3 = load(d, kRowTables[2] + i);
+    const auto C5 = load(d, kRowTables[4] + i);
+    const auto C7 = load(d, kRowTables[6] + i);
+    STORE16(row[1 * 8], DESCALE(C1 * b0 + C3 * b1 + C5 * b2 + C7 * b3));
+    STORE16(row[3 * 8], DESCALE(C3 * b0 - C7 * b1 - C1 * b2 - C5 * b3));
+    STORE16(row[5 * 8], DESCALE(C5 * b0 - C1 * b1 + C7 * b2 + C3 * b3));
+    STORE16(row[7 * 8], DESCALE(C7 * b0 - C5 * b1 + C3 * b2 - C1 * b3));
+  }
 }
 #undef DESCALE
 #undef LOAD_CST
@@ -230,15 +255,19 @@ void RowDct(coeff_t* in, const coeff_t* table) {
 // visible FDCT callable functions
 
 void ComputeBlockDCT(coeff_t* coeffs) {
-  ColumnDct(coeffs);
-  RowDct(coeffs + 0 * 8, kTable04);
-  RowDct(coeffs + 1 * 8, kTable17);
-  RowDct(coeffs + 2 * 8, kTable26);
-  RowDct(coeffs + 3 * 8, kTable35);
-  RowDct(coeffs + 4 * 8, kTable04);
-  RowDct(coeffs + 5 * 8, kTable35);
-  RowDct(coeffs + 6 * 8, kTable26);
-  RowDct(coeffs + 7 * 8, kTable17);
+  SIMD_ALIGN int32_t buf[kDCTBlockSize];
+  for (int k = 0; k < kDCTBlockSize; ++k) {
+    buf[k] = coeffs[k];
+  }
+  ColumnDct(buf);
+  // (TransposeBlock operates on floats; it only moves the 32-bit lanes.)
+  TransposeBlock(reinterpret_cast<float*>(buf));
+  RowDct(buf);
+  TransposeBlock(reinterpret_cast<float*>(buf));
+  // (STORE16 already wrapped the values to 16 bits.)
+  for (int k = 0; k < kDCTBlockSize; ++k) {
+    coeffs[k] = buf[k];
+  }
 }
 
 }  // namespace guetzli
@@ -21,6 +21,10 @@
 #include <math.h>
 #include <algorithm>
 
+#include "compiler_specific.h"
+#include "dct.h"
+#include "simd/simd.h"
+
 namespace pik {
 namespace guetzli {
 
@@ -37,18 +41,22 @@ static const int kIDCTMatrix[kDCTBlockSize] = {
     8192,  -6437,  4433,  -2260,
 };
 
-// Computes out[x] = sum{kIDCTMatrix[8*x+u]*in[u*stride]; for u in [0..7]}
-inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
-  int tmp0, tmp1, tmp2, tmp3, tmp4;
+// Computes out[x] = sum{kIDCTMatrix[8*x+u]*in[u]; for u in [0..7]} for each
+// lane independently. Integer arithmetic is exact, so the result matches a
+// scalar evaluation regardless of the vector width.
+template <class D, class V>
+PIK_INLINE void Compute1dIDCT(const D d, const V in[8], V out[8]) {
+  using namespace SIMD_NAMESPACE;
+  V tmp0, tmp1, tmp2, tmp3, tmp4;
 
-  tmp1 = kIDCTMatrix[0] * in[0];
+  tmp1 = set1(d, kIDCTMatrix[0]) * in[0];
   out[0] = out[1] = out[2] = out[3] = out[4] = out[5] = out[6] = out[7] = tmp1;
 
-  tmp0 = in[stride];
-  tmp1 = kIDCTMatrix[1] * tmp0;
-  tmp2 = kIDCTMatrix[9] * tmp0;
-  tmp3 = kIDCTMatrix[17] * tmp0;
-  tmp4 = kIDCTMatrix[25] * tmp0;
+  tmp0 = in[1];
+  tmp1 = set1(d, kIDCTMatrix[1]) * tmp0;
+  tmp2 = set1(d, kIDCTMatrix[9]) * tmp0;
+  tmp3 = set1(d, kIDCTMatrix[17]) * tmp0;
+  tmp4 = set1(d, kIDCTMatrix[25]) * tmp0;
   out[0] += tmp1;
   out[1] += tmp2;
   out[2] += tmp3;
@@ -58,9 +66,9 @@ inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
   out[6] -= tmp2;
   out[7] -= tmp1;
 
-  tmp0 = in[2 * stride];
-  tmp1 = kIDCTMatrix[2] * tmp0;
-  tmp2 = kIDCTMatrix[10] * tmp0;
+  tmp0 = in[2];
+  tmp1 = set1(d, kIDCTMatrix[2]) * tmp0;
+  tmp2 = set1(d, kIDCTMatrix[10]) * tmp0;
   out[0] += tmp1;
   out[1] += tmp2;
   out[2] -= tmp2;
@@ -70,11 +78,11 @@ inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
   out[6] += tmp2;
   out[7] += tmp1;
 
-  tmp0 = in[3 * stride];
-  tmp1 = kIDCTMatrix[3] * tmp0;
-  tmp2 = kIDCTMatrix[11] * tmp0;
-  tmp3 = kIDCTMatrix[19] * tmp0;
-  tmp4 = kIDCTMatrix[27] * tmp0;
+  tmp0 = in[3];
+  tmp1 = set1(d, kIDCTMatrix[3]) * tmp0;
+  tmp2 = set1(d, kIDCTMatrix[11]) * tmp0;
+  tmp3 = set1(d, kIDCTMatrix[19]) * tmp0;
+  tmp4 = set1(d, kIDCTMatrix[27]) * tmp0;
   out[0] += tmp1;
   out[1] += tmp2;
   out[2] += tmp3;
@@ -84,8 +92,8 @@ inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
   out[6] -= tmp2;
   out[7] -= tmp1;
 
-  tmp0 = in[4 * stride];
-  tmp1 = kIDCTMatrix[4] * tmp0;
+  tmp0 = in[4];
+  tmp1 = set1(d, kIDCTMatrix[4]) * tmp0;
   out[0] += tmp1;
   out[1] -= tmp1;
   out[2] -= tmp1;
@@ -95,11 +103,11 @@ inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
   out[6] -= tmp1;
   out[7] += tmp1;
 
-  tmp0 = in[5 * stride];
-  tmp1 = kIDCTMatrix[5] * tmp0;
-  tmp2 = kIDCTMatrix[13] * tmp0;
-  tmp3 = kIDCTMatrix[21] * tmp0;
-  tmp4 = kIDCTMatrix[29] * tmp0;
+  tmp0 = in[5];
+  tmp1 = set1(d, kIDCTMatrix[5]) * tmp0;
+  tmp2 = set1(d, kIDCTMatrix[13]) * tmp0;
+  tmp3 = set1(d, kIDCTMatrix[21]) * tmp0;
+  tmp4 = set1(d, kIDCTMatrix[29]) * tmp0;
   out[0] += tmp1;
   out[1] += tmp2;
   out[2] += tmp3;
@@ -109,9 +117,9 @@ inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
   out[6] -= tmp2;
   out[7] -= tmp1;
 
-  tmp0 = in[6 * stride];
-  tmp1 = kIDCTMatrix[6] * tmp0;
-  tmp2 = kIDCTMatrix[14] * tmp0;
+  tmp0 = in[6];
+  tmp1 = set1(d, kIDCTMatrix[6]) * tmp0;
+  tmp2 = set1(d, kIDCTMatrix[14]) * tmp0;
   out[0] += tmp1;
   out[1] += tmp2;
   out[2] -= tmp2;
@@ -121,11 +129,11 @@ inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
   out[6] += tmp2;
   out[7] += tmp1;
 
-  tmp0 = in[7 * stride];
-  tmp1 = kIDCTMatrix[7] * tmp0;
-  tmp2 = kIDCTMatrix[15] * tmp0;
-  tmp3 = kIDCTMatrix[23] * tmp0;
-  tmp4 = kIDCTMatrix[31] * tmp0;
+  tmp0 = in[7];
+  tmp1 = set1(d, kIDCTMatrix[7]) * tmp0;
+  tmp2 = set1(d, kIDCTMatrix[15]) * tmp0;
+  tmp3 = set1(d, kIDCTMatrix[23]) * tmp0;
+  tmp4 = set1(d, kIDCTMatrix[31]) * tmp0;
   out[0] += tmp1;
   out[1] += tmp2;
   out[2] += tmp3;
@@ -136,28 +144,54 @@ inline void Compute1dIDCT(const coeff_t* in, const int stride, int out[8]) {
   out[7] -= tmp1;
 }
 
+// Each lane of the vectors holds one column; transposing in between lets the
+// row pass also operate on columns.
 void ComputeBlockIDCT(const coeff_t* block, uint8_t* out) {
-  coeff_t colidcts[kDCTBlockSize];
+  using namespace SIMD_NAMESPACE;
+  using D = Part<int32_t, SIMD_MIN(8, Full<int32_t>::N)>;
+  const D d;
+  const Part<uint8_t, D::N> d8;
+  // (TransposeBlock operates on floats; it only moves the 32-bit lanes.)
+  SIMD_ALIGN int32_t buf[kDCTBlockSize];
+  for (int k = 0; k < kDCTBlockSize; ++k) {
+    buf[k] = block[k];
+  }
+
   const int kColScale = 11;
-  const int kColRound = 1 << (kColScale - 1);
-  for (int x = 0; x < 8; ++x) {
-    int colbuf[8] = {0};
-    Compute1dIDCT(&block[x], 8, colbuf);
+  const auto col_round = set1(d, 1 << (kColScale - 1));
+  for (int x = 0; x < 8; x += d.N) {
+    D::V in[8], colbuf[8];
+    for (int u = 0; u < 8; ++u) {
+      in[u] = load(d, buf + 8 * u + x);
+    }
+    Compute1dIDCT(d, in, colbuf);
     for (int y = 0; y < 8; ++y) {
-      colidcts[8 * y + x] = (colbuf[y] + kColRound) >> kColScale;
+      // Wraps around like the scalar coeff_t intermediate.
+      const auto col = shift_right<kColScale>(colbuf[y] + col_round);
+      store(shift_right<16>(shift_left<16>(col)), d, buf + 8 * y + x);
     }
   }
+  TransposeBlock(reinterpret_cast<float*>(buf));
+
   const int kRowScale = 18;
   const int kRowRound = 257 << (kRowScale - 1);  // includes offset by 128
-  for (int y = 0; y < 8; ++y) {
-    const int rowidx = 8 * y;
-    int rowbuf[8] = {0};
-    Compute1dIDCT(&colidcts[rowidx], 1, rowbuf);
+  const auto row_round = set1(d, kRowRound);
+  for (int y = 0; y < 8; y += d.N) {
+    D::V in[8], rowbuf[8];
+    for (int u = 0; u < 8; ++u) {
+      in[u] = load(d, buf + 8 * u + y);
+    }
+    Compute1dIDCT(d, in, rowbuf);
     for (int x = 0; x < 8; ++x) {
-      out[rowidx + x] =
-          std::max(0, std::min(255, (rowbuf[x] + kRowRound) >> kRowScale));
+      store(shift_right<kRowScale>(rowbuf[x] + row_round), d, buf + 8 * x + y);
     }
   }
+  TransposeBlock(reinterpret_cast<float*>(buf));
+
+  for (int k = 0; k < kDCTBlockSize; k += d.N) {
+    // Saturating conversion clamps to [0, 255].
+    store(convert_to(d8, load(d, buf + k)), d8, out + k);
+  }
 }
 
 }  // namespace guetzli
@@ -54,5 +54,16 @@ std::vector<uint8_t> DecodeJpegToRGB(const JPEGData& jpg) {
   return std::vector<uint8_t>();
 }
 
+std::vector<uint8_t> DecodeJpegToRGB(const JPEGData& jpg, ThreadPool* pool) {
+  if (jpg.components.size() == 1 ||
+      (jpg.components.size() == 3 &&
+       HasYCbCrColorSpace(jpg) && (jpg.Is420() || jpg.Is444()))) {
+    OutputImage img(jpg.width, jpg.height);
+    img.CopyFromJpegData(jpg, pool);
+    return img.ToSRGB(pool);
+  }
+  return std::vector<uint8_t>();
+}
+
 }  // namespace guetzli
 }  // namespace pik
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 
+#include "data_parallel.h"
 #include "guetzli/jpeg_data.h"
 
 namespace pik {
@@ -33,6 +34,9 @@ namespace guetzli {
 // Vector will be empty if a decoding error occurred.
 std::vector<uint8_t> DecodeJpegToRGB(const JPEGData& jpg);
 
+// Same result as above, but uses "pool" to reconstruct and convert the pixels.
+std::vector<uint8_t> DecodeJpegToRGB(const JPEGData& jpg, ThreadPool* pool);
+
 // Mimic libjpeg's heuristics to guess jpeg color space.
 // Requires that the jpg has 3 components.
 bool HasYCbCrColorSpace(const JPEGData& jpg);
@@ -67,6 +67,13 @@ namespace {
 // Returns ceil(a/b).
 inline int DivCeil(int a, int b) { return (a + b - 1) / b; }
 
+// Set by ReadJpegBands; ReadJpeg keeps all coefficients instead.
+struct BandReader {
+  BandReader(int mcu_rows, JPEGBandOutput out) : mcu_rows(mcu_rows), out(out) {}
+  const int mcu_rows;
+  const JPEGBandOutput out;
+};
+
 inline int ReadUint8(const uint8_t* data, size_t* pos) {
   return data[(*pos)++];
 }
@@ -80,7 +87,7 @@ inline int ReadUint16(const uint8_t* data, size_t* pos) {
 // Reads the Start of Frame (SOF) marker segment and fills in *jpg with the
 // parsed data.
 bool ProcessSOF(const uint8_t* data, const size_t len, JpegReadMode mode,
-                size_t* pos, JPEGData* jpg) {
+                const BandReader* bands, size_t* pos, JPEGData* jpg) {
   if (jpg->width != 0) {
     fprintf(stderr, "Duplicate SOF marker.\n");
     jpg->error = JPEG_DUPLICATE_SOF;
@@ -143,7 +150,7 @@ bool ProcessSOF(const uint8_t* data, const size_t len, JpegReadMode mode,
       c->height_in_blocks = jpg->MCU_rows * c->v_samp_factor;
       const uint64_t num_blocks =
           static_cast<uint64_t>(c->width_in_blocks) * c->height_in_blocks;
-      if (num_blocks > (1ull << 21)) {
+      if (bands == nullptr && num_blocks > (1ull << 21)) {
         // Refuse to allocate more than 1 GB of memory for the coefficients,
         // that is 2M blocks x 64 coeffs x 2 bytes per coeff x max 4 components.
         // TODO(user) Add this limit to a GuetzliParams struct.
@@ -152,7 +159,13 @@ bool ProcessSOF(const uint8_t* data, const size_t len, JpegReadMode mode,
         return false;
       }
       c->num_blocks = static_cast<int>(num_blocks);
-      c->coeffs.resize(c->num_blocks * kDCTBlockSize);
+      const int rows_in_memory =
+          bands == nullptr
+              ? c->height_in_blocks
+              : std::min(c->height_in_blocks,
+                         bands->mcu_rows * c->v_samp_factor);
+      c->coeffs.resize(static_cast<size_t>(c->width_in_blocks) *
+                       rows_in_memory * kDCTBlockSize);
     }
   }
   VERIFY_MARKER_END();
@@ -744,12 +757,24 @@ bool ProcessScan(const uint8_t* data, const size_t len,
                  const std::vector<HuffmanTableEntry>& dc_huff_lut,
                  const std::vector<HuffmanTableEntry>& ac_huff_lut,
                  uint16_t scan_progression[kMaxComponents][kDCTBlockSize],
-                 bool is_progressive, size_t* pos, JPEGData* jpg) {
+                 bool is_progressive, const BandReader* bands, size_t* pos,
+                 JPEGData* jpg) {
   if (!ProcessSOS(data, len, pos, jpg)) {
     return false;
   }
   JPEGScanInfo* scan_info = &jpg->scan_info.back();
   bool is_interleaved = (scan_info->components.size() > 1);
+  if (bands != nullptr) {
+    // Each band must be complete after its last MCU row.
+    const JPEGComponent& c = jpg->components[0];
+    if (jpg->scan_info.size() != 1 ||
+        scan_info->components.size() != jpg->components.size() ||
+        (!is_interleaved && (c.h_samp_factor != 1 || c.v_samp_factor != 1))) {
+      fprintf(stderr, "JPEG cannot be read in bands.\n");
+      jpg->error = JPEG_BANDS_UNSUPPORTED;
+      return false;
+    }
+  }
   int MCUs_per_row;
   int MCU_rows;
   if (is_interleaved) {
@@ -801,6 +826,7 @@ bool ProcessScan(const uint8_t* data, const size_t len,
     jpg->error = JPEG_NON_REPRESENTABLE_AC_COEFF;
     return false;
   }
+  int band_y0 = 0;  // First MCU row in memory.
   for (int mcu_y = 0; mcu_y < MCU_rows; ++mcu_y) {
     for (int mcu_x = 0; mcu_x < MCUs_per_row; ++mcu_x) {
       // Handle the restart intervals.
@@ -833,7 +859,7 @@ bool ProcessScan(const uint8_t* data, const size_t len,
         int nblocks_x = is_interleaved ? c->h_samp_factor : 1;
         for (int iy = 0; iy < nblocks_y; ++iy) {
           for (int ix = 0; ix < nblocks_x; ++ix) {
-            int block_y = mcu_y * nblocks_y + iy;
+            int block_y = (mcu_y - band_y0) * nblocks_y + iy;
             int block_x = mcu_x * nblocks_x + ix;
             int block_idx = block_y * c->width_in_blocks + block_x;
             coeff_t* coeffs = &c->coeffs[block_idx * kDCTBlockSize];
@@ -853,6 +879,18 @@ bool ProcessScan(const uint8_t* data, const size_t len,
         }
       }
     }
+    if (bands != nullptr &&
+        (mcu_y + 1 - band_y0 == bands->mcu_rows || mcu_y + 1 == MCU_rows)) {
+      if (!bands->out.Band(*jpg, band_y0, mcu_y + 1)) {
+        jpg->error = JPEG_BAND_OUTPUT_FAILED;
+        return false;
+      }
+      // DecodeDCTBlock only stores the nonzero coefficients.
+      for (JPEGComponent& c : jpg->components) {
+        std::fill(c.coeffs.begin(), c.coeffs.end(), 0);
+      }
+      band_y0 = mcu_y + 1;
+    }
   }
   if (eobrun > 0) {
     fprintf(stderr, "End-of-block run too long.\n");
@@ -911,10 +949,8 @@ size_t FindNextMarker(const uint8_t* data, const size_t len, size_t pos) {
   return num_skipped;
 }
 
-}  // namespace
-
 bool ReadJpeg(const uint8_t* data, const size_t len, JpegReadMode mode,
-              JPEGData* jpg) {
+              const BandReader* bands, JPEGData* jpg) {
   size_t pos = 0;
   // Check SOI marker.
   EXPECT_MARKER();
@@ -952,7 +988,12 @@ bool ReadJpeg(const uint8_t* data, const size_t len, JpegReadMode mode,
       case 0xc1:
       case 0xc2:
         is_progressive = (marker == 0xc2);
-        ok = ProcessSOF(data, len, mode, &pos, jpg);
+        if (is_progressive && bands != nullptr) {
+          fprintf(stderr, "Progressive JPEG cannot be read in bands.\n");
+          jpg->error = JPEG_BANDS_UNSUPPORTED;
+          return false;
+        }
+        ok = ProcessSOF(data, len, mode, bands, &pos, jpg);
         found_sof = true;
         break;
       case 0xc4:
@@ -974,8 +1015,13 @@ bool ReadJpeg(const uint8_t* data, const size_t len, JpegReadMode mode,
         break;
       case 0xda:
         if (mode == JPEG_READ_ALL) {
+          // The band output needs the final quant table indexes.
+          if (bands != nullptr && jpg->scan_info.empty() &&
+              !FixupIndexes(jpg)) {
+            return false;
+          }
           ok = ProcessScan(data, len, dc_huff_lut, ac_huff_lut,
-                           scan_progression, is_progressive, &pos, jpg);
+                           scan_progression, is_progressive, bands, &pos, jpg);
         }
         break;
       case 0xdb:
@@ -1037,7 +1083,7 @@ bool ReadJpeg(const uint8_t* data, const size_t len, JpegReadMode mode,
       jpg->tail_data.assign(reinterpret_cast<const char*>(&data[pos]),
                             len - pos);
     }
-    if (!FixupIndexes(jpg)) {
+    if (bands == nullptr && !FixupIndexes(jpg)) {
       return false;
     }
     if (jpg->huffman_code.size() == 0) {
@@ -1057,10 +1103,23 @@ bool ReadJpeg(const uint8_t* data, const size_t len, JpegReadMode mode,
   return true;
 }
 
+}  // namespace
+
+bool ReadJpeg(const uint8_t* data, const size_t len, JpegReadMode mode,
+              JPEGData* jpg) {
+  return ReadJpeg(data, len, mode, nullptr, jpg);
+}
+
 bool ReadJpeg(const std::string& data, JpegReadMode mode, JPEGData* jpg) {
   return ReadJpeg(reinterpret_cast<const uint8_t*>(data.data()),
                   static_cast<const size_t>(data.size()), mode, jpg);
 }
 
+bool ReadJpegBands(const uint8_t* data, const size_t len,
+                   int mcu_rows_per_band, JPEGBandOutput out, JPEGData* jpg) {
+  const BandReader bands(std::max(1, mcu_rows_per_band), out);
+  return ReadJpeg(data, len, JPEG_READ_ALL, &bands, jpg);
+}
+
 }  // namespace guetzli
 }  // namespace pik
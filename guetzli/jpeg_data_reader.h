@@ -45,6 +45,32 @@ bool ReadJpeg(const uint8_t* data, const size_t len, JpegReadMode mode,
 // string variant
 bool ReadJpeg(const std::string& data, JpegReadMode mode, JPEGData* jpg);
 
+// Function pointer type called after MCU rows [mcu_y0, mcu_y1) were decoded
+// into jpg. Returns false to stop reading.
+typedef bool (*JPEGBandHook)(void* data, const JPEGData& jpg, int mcu_y0,
+                             int mcu_y1);
+
+// Band callback function with associated data.
+struct JPEGBandOutput {
+  JPEGBandOutput(JPEGBandHook cb, void* data) : cb(cb), data(data) {}
+  bool Band(const JPEGData& jpg, int mcu_y0, int mcu_y1) const {
+    return cb(data, jpg, mcu_y0, mcu_y1);
+  }
+ private:
+  JPEGBandHook cb;
+  void* data;
+};
+
+// Same as ReadJpeg with JPEG_READ_ALL, but only the coefficients of at most
+// mcu_rows_per_band MCU rows are in memory at a time: the coeffs of each
+// component hold the current band, starting at its first block row, when
+// "out" is called. The quant_idx fields are already fixed up at that point.
+// Only sequential JPEGs with one scan of all components (or a single
+// component without subsampling) can be read this way; for others,
+// jpg->error is JPEG_BANDS_UNSUPPORTED and ReadJpeg must be used instead.
+bool ReadJpegBands(const uint8_t* data, const size_t len,
+                   int mcu_rows_per_band, JPEGBandOutput out, JPEGData* jpg);
+
 }  // namespace guetzli
 }  // namespace pik
 
@@ -19,6 +19,7 @@
 #include <assert.h>
 #include <algorithm>
 #include <cstdlib>
+#include <memory>
 
 #include "guetzli/entropy_encode.h"
 #include "guetzli/fast_log.h"
@@ -535,6 +536,34 @@ void EncodeDCTBlockSequential(const coeff_t* coeffs,
   }
 }
 
+// Encodes all blocks of one MCU.
+void EncodeMCU(const JPEGData& jpg, int mcu_y, int mcu_x,
+               const std::vector<HuffmanCodeTable>& dc_huff_table,
+               const std::vector<HuffmanCodeTable>& ac_huff_table,
+               coeff_t* last_dc_coeff, BitWriter* bw) {
+  for (int i = 0; i < jpg.components.size(); ++i) {
+    const JPEGComponent& c = jpg.components[i];
+    int nblocks_y = c.v_samp_factor;
+    int nblocks_x = c.h_samp_factor;
+    for (int iy = 0; iy < nblocks_y; ++iy) {
+      for (int ix = 0; ix < nblocks_x; ++ix) {
+        int block_y = mcu_y * nblocks_y + iy;
+        int block_x = mcu_x * nblocks_x + ix;
+        int block_idx = block_y * c.width_in_blocks + block_x;
+        const coeff_t* coeffs = &c.coeffs[block_idx << 6];
+        EncodeDCTBlockSequential(coeffs, dc_huff_table[i], ac_huff_table[i],
+                                 &last_dc_coeff[i], bw);
+      }
+    }
+  }
+}
+
+// Appends the first bw->pos bytes of bw to out and empties bw.
+void FlushBitWriter(BitWriter* bw, std::vector<uint8_t>* out) {
+  out->insert(out->end(), bw->data.get(), bw->data.get() + bw->pos);
+  bw->pos = 0;
+}
+
 }  // namespace
 
 bool EncodeScan(const JPEGData& jpg,
@@ -545,22 +574,8 @@ bool EncodeScan(const JPEGData& jpg,
   BitWriter bw(1 << 17);
   for (int mcu_y = 0; mcu_y < jpg.MCU_rows; ++mcu_y) {
     for (int mcu_x = 0; mcu_x < jpg.MCU_cols; ++mcu_x) {
-      // Encode one MCU
-      for (int i = 0; i < jpg.components.size(); ++i) {
-        const JPEGComponent& c = jpg.components[i];
-        int nblocks_y = c.v_samp_factor;
-        int nblocks_x = c.h_samp_factor;
-        for (int iy = 0; iy < nblocks_y; ++iy) {
-          for (int ix = 0; ix < nblocks_x; ++ix) {
-            int block_y = mcu_y * nblocks_y + iy;
-            int block_x = mcu_x * nblocks_x + ix;
-            int block_idx = block_y * c.width_in_blocks + block_x;
-            const coeff_t* coeffs = &c.coeffs[block_idx << 6];
-            EncodeDCTBlockSequential(coeffs, dc_huff_table[i], ac_huff_table[i],
-                                     &last_dc_coeff[i], &bw);
-          }
-        }
-      }
+      EncodeMCU(jpg, mcu_y, mcu_x, dc_huff_table, ac_huff_table,
+                last_dc_coeff, &bw);
       if (bw.pos > (1 << 16)) {
         if (!JPEGWrite(out, bw.data.get(), bw.pos)) {
           return false;
@@ -573,6 +588,63 @@ bool EncodeScan(const JPEGData& jpg,
   return !bw.overflow && JPEGWrite(out, bw.data.get(), bw.pos);
 }
 
+bool EncodeDRI(const JPEGData& jpg, JPEGOutput out) {
+  if (jpg.restart_interval == 0) return true;
+  if (jpg.restart_interval < 0 || jpg.restart_interval > 0xffff) {
+    return false;
+  }
+  const uint8_t data[6] = {0xff, 0xdd, 0x00, 0x04,
+                           static_cast<uint8_t>(jpg.restart_interval >> 8),
+                           static_cast<uint8_t>(jpg.restart_interval & 0xff)};
+  return JPEGWrite(out, data, sizeof(data));
+}
+
+bool EncodeScanWithRestarts(const JPEGData& jpg,
+                            const std::vector<HuffmanCodeTable>& dc_huff_table,
+                            const std::vector<HuffmanCodeTable>& ac_huff_table,
+                            ThreadPool* pool, JPEGOutput out) {
+  const int num_mcus = jpg.MCU_rows * jpg.MCU_cols;
+  const int interval = jpg.restart_interval;
+  if (interval <= 0) return false;
+  const int num_intervals = (num_mcus + interval - 1) / interval;
+
+  // Each interval starts at a byte boundary with zero DC predictions, so it
+  // does not depend on any other. Its bytes (including the RSTn marker that
+  // ends all but the last interval) are collected in intervals[k]. The bit
+  // writers are reused across the intervals of a thread.
+  std::vector<std::vector<uint8_t>> intervals(num_intervals);
+  std::vector<std::unique_ptr<BitWriter>> writers(
+      std::max<size_t>(1, pool->NumThreads()));
+  for (auto& bw : writers) bw.reset(new BitWriter(1 << 17));
+  pool->Run(0, num_intervals, [&](const int k, const int thread) {
+    BitWriter* bw = writers[thread].get();
+    std::vector<uint8_t>* bytes = &intervals[k];
+    coeff_t last_dc_coeff[kMaxComponents] = {0};
+    const int mcu_end = std::min(num_mcus, (k + 1) * interval);
+    for (int mcu = k * interval; mcu < mcu_end; ++mcu) {
+      EncodeMCU(jpg, mcu / jpg.MCU_cols, mcu % jpg.MCU_cols, dc_huff_table,
+                ac_huff_table, last_dc_coeff, bw);
+      if (bw->pos > (1 << 16)) FlushBitWriter(bw, bytes);
+    }
+    bw->JumpToByteBoundary();
+    FlushBitWriter(bw, bytes);
+    if (k + 1 < num_intervals) {
+      bytes->push_back(0xff);
+      bytes->push_back(0xd0 + (k & 7));
+    }
+  });
+
+  for (const auto& bw : writers) {
+    if (bw->overflow) return false;
+  }
+  for (const std::vector<uint8_t>& bytes : intervals) {
+    if (!bytes.empty() && !JPEGWrite(out, bytes.data(), bytes.size())) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool WriteJpeg(const JPEGData& jpg, bool strip_metadata, JPEGOutput out) {
   static const uint8_t kSOIMarker[2] = {0xff, 0xd8};
   static const uint8_t kEOIMarker[2] = {0xff, 0xd9};
@@ -587,6 +659,23 @@ bool WriteJpeg(const JPEGData& jpg, bool strip_metadata, JPEGOutput out) {
           (strip_metadata || JPEGWrite(out, jpg.tail_data)));
 }
 
+bool WriteJpeg(const JPEGData& jpg, bool strip_metadata, ThreadPool* pool,
+               JPEGOutput out) {
+  if (jpg.restart_interval == 0) return WriteJpeg(jpg, strip_metadata, out);
+  static const uint8_t kSOIMarker[2] = {0xff, 0xd8};
+  static const uint8_t kEOIMarker[2] = {0xff, 0xd9};
+  std::vector<HuffmanCodeTable> dc_codes;
+  std::vector<HuffmanCodeTable> ac_codes;
+  return (JPEGWrite(out, kSOIMarker, sizeof(kSOIMarker)) &&
+          EncodeMetadata(jpg, strip_metadata, out) &&
+          EncodeDQT(jpg.quant, out) && EncodeSOF(jpg, out) &&
+          EncodeDRI(jpg, out) &&
+          BuildAndEncodeHuffmanCodes(jpg, out, &dc_codes, &ac_codes) &&
+          EncodeScanWithRestarts(jpg, dc_codes, ac_codes, pool, out) &&
+          JPEGWrite(out, kEOIMarker, sizeof(kEOIMarker)) &&
+          (strip_metadata || JPEGWrite(out, jpg.tail_data)));
+}
+
 int NullOut(void* data, const uint8_t* buf, size_t count) { return count; }
 
 void BuildSequentialHuffmanCodes(
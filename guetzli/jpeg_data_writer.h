@@ -23,6 +23,7 @@
 #include <string.h>
 #include <vector>
 
+#include "data_parallel.h"
 #include "guetzli/jpeg_data.h"
 
 namespace pik {
@@ -45,6 +46,13 @@ struct JPEGOutput {
 
 bool WriteJpeg(const JPEGData& jpg, bool strip_metadata, JPEGOutput out);
 
+// Same as above, but if jpg.restart_interval is nonzero, also writes a DRI
+// marker and a restart marker after every jpg.restart_interval MCUs. The
+// restart intervals are then independent, so they are Huffman-coded in
+// parallel on "pool" and only handed to "out" once the whole scan is encoded.
+bool WriteJpeg(const JPEGData& jpg, bool strip_metadata, ThreadPool* pool,
+               JPEGOutput out);
+
 struct HuffmanCodeTable {
   uint8_t depth[256];
   int code[256];
@@ -104,6 +112,16 @@ bool EncodeScan(const JPEGData& jpg,
                 const std::vector<HuffmanCodeTable>& ac_huff_table,
                 JPEGOutput out);
 
+// Writes the DRI marker for jpg.restart_interval, if any.
+bool EncodeDRI(const JPEGData& jpg, JPEGOutput out);
+
+// Equivalent to EncodeScan, but with restart markers every
+// jpg.restart_interval (> 0) MCUs; see WriteJpeg.
+bool EncodeScanWithRestarts(const JPEGData& jpg,
+                            const std::vector<HuffmanCodeTable>& dc_huff_table,
+                            const std::vector<HuffmanCodeTable>& ac_huff_table,
+                            ThreadPool* pool, JPEGOutput out);
+
 void BuildDCHistograms(const JPEGData& jpg, JpegHistogram* histo);
 void BuildACHistograms(const JPEGData& jpg, JpegHistogram* histo);
 size_t JpegHeaderSize(const JPEGData& jpg, bool strip_metadata);
@@ -65,6 +65,8 @@ enum JPEGReadError {
   JPEG_OUT_OF_BAND_COEFF,
   JPEG_EOB_RUN_TOO_LONG,
   JPEG_IMAGE_TOO_LARGE,
+  JPEG_BANDS_UNSUPPORTED,
+  JPEG_BAND_OUTPUT_FAILED,
 };
 
 }  // namespace guetzli
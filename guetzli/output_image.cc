@@ -133,14 +133,20 @@ void OutputImageComponent::SetCoeffBlock(int block_x, int block_y,
 
 void OutputImageComponent::UpdatePixelsForBlock(
     int block_x, int block_y, const uint8_t idct[kDCTBlockSize]) {
+  UpdatePixelsForBlock(block_x, block_y, idct, 0, &pixels_[0]);
+}
+
+void OutputImageComponent::UpdatePixelsForBlock(
+    int block_x, int block_y, const uint8_t idct[kDCTBlockSize], int ybegin,
+    uint16_t* pixels) const {
   if (factor_x_ == 1 && factor_y_ == 1) {
     for (int iy = 0; iy < 8; ++iy) {
       for (int ix = 0; ix < 8; ++ix) {
         int x = 8 * block_x + ix;
         int y = 8 * block_y + iy;
         if (x >= width_ || y >= height_) continue;
-        int p = y * width_ + x;
-        pixels_[p] = idct[8 * iy + ix] << 4;
+        int p = (y - ybegin) * width_ + x;
+        pixels[p] = idct[8 * iy + ix] << 4;
       }
     }
   } else if (factor_x_ == 2 && factor_y_ == 2) {
@@ -175,9 +181,10 @@ void OutputImageComponent::UpdatePixelsForBlock(
           const int y1 = std::max(y0 - 1, 0);
           const int x1 = std::max(x0 - 1, 0);
           subsampled[ix] =
-              (pixels_[y0 * width_ + x0] * 9 + pixels_[y1 * width_ + x1] +
-               pixels_[y0 * width_ + x1] * -3 +
-               pixels_[y1 * width_ + x0] * -3) >>
+              (pixels[(y0 - ybegin) * width_ + x0] * 9 +
+               pixels[(y1 - ybegin) * width_ + x1] +
+               pixels[(y0 - ybegin) * width_ + x1] * -3 +
+               pixels[(y1 - ybegin) * width_ + x0] * -3) >>
               2;
         }
       }
@@ -193,7 +200,7 @@ void OutputImageComponent::UpdatePixelsForBlock(
     for (int y = ymin; y <= ymax; ++y) {
       const int y0 = ((y & ~1) / 2 - block_y * 8 + 1) * kSubsampledEdgeSize;
       const int dy = ((y & 1) * 2 - 1) * kSubsampledEdgeSize;
-      uint16_t* rowptr = &pixels_[y * width_];
+      uint16_t* rowptr = &pixels[(y - ybegin) * width_];
       for (int x = xmin; x <= xmax; ++x) {
         const int x0 = (x & ~1) / 2 - block_x * 8 + 1;
         const int dx = (x & 1) * 2 - 1;
@@ -231,6 +238,77 @@ void OutputImageComponent::CopyFromJpegComponent(const JPEGComponent& comp,
   memcpy(quant_, quant, sizeof(quant_));
 }
 
+void OutputImageComponent::CopyFromJpegComponent(const JPEGComponent& comp,
+                                                 int factor_x, int factor_y,
+                                                 const int* quant,
+                                                 ThreadPool* pool) {
+  const bool upsample = factor_x != 1 || factor_y != 1;
+  if (upsample && (factor_x != 2 || factor_y != 2)) {
+    CopyFromJpegComponent(comp, factor_x, factor_y, quant);
+    return;
+  }
+  Reset(factor_x, factor_y);
+  assert(width_in_blocks_ <= comp.width_in_blocks);
+  assert(height_in_blocks_ <= comp.height_in_blocks);
+  const size_t src_row_size = comp.width_in_blocks * kDCTBlockSize;
+  const size_t row_size = width_in_blocks_ * kDCTBlockSize;
+  // Blocks only update their own pixels unless upsampling.
+  pool->Run(0, height_in_blocks_, [&](const int block_y, const int thread) {
+    const coeff_t* src_coeffs = &comp.coeffs[block_y * src_row_size];
+    coeff_t* coeffs = &coeffs_[block_y * row_size];
+    for (int block_x = 0; block_x < width_in_blocks_; ++block_x) {
+      for (int i = 0; i < kDCTBlockSize; ++i) {
+        coeffs[i] = src_coeffs[i] * quant[i];
+      }
+      if (!upsample) {
+        uint8_t idct[kDCTBlockSize];
+        ComputeBlockIDCT(coeffs, idct);
+        UpdatePixelsForBlock(block_x, block_y, idct, 0, &pixels_[0]);
+      }
+      src_coeffs += kDCTBlockSize;
+      coeffs += kDCTBlockSize;
+    }
+  });
+  memcpy(quant_, quant, sizeof(quant_));
+  if (!upsample) return;
+
+  // The upsampler reads pixels written by previous blocks, so bands of block
+  // rows are reconstructed into their own buffers. The rows that a block row
+  // leaves for the next one only depend on its own coefficients, hence each
+  // band starts by replaying the last block row of the band above it.
+  const int kBlockHeight = 16;
+  const int kMinRowsPerBand = 4;
+  const int num_threads = std::max<int>(pool->NumThreads(), 1);
+  const int rows_per_band = std::max(
+      kMinRowsPerBand, (height_in_blocks_ + num_threads - 1) / num_threads);
+  const int num_bands = (height_in_blocks_ + rows_per_band - 1) / rows_per_band;
+  pool->Run(0, num_bands, [&](const int band, const int thread) {
+    const int band_begin = band * rows_per_band;
+    const int band_end = std::min(band_begin + rows_per_band, height_in_blocks_);
+    const int replay_begin = std::max(band_begin - 1, 0);
+    // All rows that block rows [replay_begin, band_end) read or write.
+    const int ybegin = std::max(kBlockHeight * replay_begin - 3, 0);
+    const int yend = std::min(kBlockHeight * band_end + 1, height_);
+    std::vector<uint16_t> pixels((yend - ybegin) * width_, 128 << 4);
+    for (int block_y = replay_begin; block_y < band_end; ++block_y) {
+      for (int block_x = 0; block_x < width_in_blocks_; ++block_x) {
+        uint8_t idct[kDCTBlockSize];
+        ComputeBlockIDCT(&coeffs_[block_y * row_size + block_x * kDCTBlockSize],
+                         idct);
+        UpdatePixelsForBlock(block_x, block_y, idct, ybegin, &pixels[0]);
+      }
+    }
+    // Block rows update one row above and two below their own pixels; the
+    // last update wins.
+    const int yfirst = band == 0 ? 0 : kBlockHeight * band_begin - 1;
+    const int ylast = band_end == height_in_blocks_
+                          ? height_
+                          : kBlockHeight * band_end - 1;
+    memcpy(&pixels_[yfirst * width_], &pixels[(yfirst - ybegin) * width_],
+           (ylast - yfirst) * width_ * sizeof(pixels_[0]));
+  });
+}
+
 void OutputImageComponent::ApplyGlobalQuantization(const int q[kDCTBlockSize]) {
   for (int block_y = 0; block_y < height_in_blocks_; ++block_y) {
     for (int block_x = 0; block_x < width_in_blocks_; ++block_x) {
@@ -260,6 +338,19 @@ void OutputImage::CopyFromJpegData(const JPEGData& jpg) {
   }
 }
 
+void OutputImage::CopyFromJpegData(const JPEGData& jpg, ThreadPool* pool) {
+  for (int i = 0; i < jpg.components.size(); ++i) {
+    const JPEGComponent& comp = jpg.components[i];
+    assert(jpg.max_h_samp_factor % comp.h_samp_factor == 0);
+    assert(jpg.max_v_samp_factor % comp.v_samp_factor == 0);
+    int factor_x = jpg.max_h_samp_factor / comp.h_samp_factor;
+    int factor_y = jpg.max_v_samp_factor / comp.v_samp_factor;
+    assert(comp.quant_idx < jpg.quant.size());
+    components_[i].CopyFromJpegComponent(
+        comp, factor_x, factor_y, &jpg.quant[comp.quant_idx].values[0], pool);
+  }
+}
+
 namespace {
 
 void SetDownsampledCoefficients(const std::vector<float>& pixels, int factor_x,
@@ -422,6 +513,20 @@ std::vector<uint8_t> OutputImage::ToSRGB() const {
   return ToSRGB(0, 0, width_, height_);
 }
 
+std::vector<uint8_t> OutputImage::ToSRGB(ThreadPool* pool) const {
+  std::vector<uint8_t> rgb(width_ * height_ * 3);
+  pool->Run(0, height_, [&](const int y, const int thread) {
+    uint8_t* row = &rgb[y * width_ * 3];
+    for (int c = 0; c < 3; ++c) {
+      components_[c].ToPixels(0, y, width_, 1, row + c, 3);
+    }
+    for (int x = 0; x < width_; ++x) {
+      ColorTransformYCbCrToRGB(row + 3 * x);
+    }
+  });
+  return rgb;
+}
+
 void OutputImage::ToLinearRGB(int xmin, int ymin, int xsize, int ysize,
                               std::vector<std::vector<float> >* rgb) const {
   const float* lut = Srgb8ToLinearTable();
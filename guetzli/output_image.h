@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <vector>
 
+#include "data_parallel.h"
 #include "guetzli/jpeg_data.h"
 
 namespace pik {
@@ -73,12 +74,23 @@ class OutputImageComponent {
                              int factor_x, int factor_y,
                              const int* quant);
 
+  // Same result as above, but reconstructs bands of block rows in parallel.
+  void CopyFromJpegComponent(const JPEGComponent& comp,
+                             int factor_x, int factor_y,
+                             const int* quant, ThreadPool* pool);
+
   void ApplyGlobalQuantization(const int q[kDCTBlockSize]);
 
  private:
   void UpdatePixelsForBlock(int block_x, int block_y,
                             const uint8_t idct[kDCTBlockSize]);
 
+  // As above, but updates "pixels", which holds rows [ybegin, height_) of the
+  // component instead of all of them.
+  void UpdatePixelsForBlock(int block_x, int block_y,
+                            const uint8_t idct[kDCTBlockSize], int ybegin,
+                            uint16_t* pixels) const;
+
   const int width_;
   const int height_;
   int factor_x_;
@@ -105,6 +117,9 @@ class OutputImage {
   // Requires that jpg is in YUV444 format.
   void CopyFromJpegData(const JPEGData& jpg);
 
+  // Same result as above, using "pool" to reconstruct each component.
+  void CopyFromJpegData(const JPEGData& jpg, ThreadPool* pool);
+
   void ApplyGlobalQuantization(const int q[3][kDCTBlockSize]);
 
   // If sharpen or blur are enabled, preprocesses image before downsampling U or
@@ -140,6 +155,9 @@ class OutputImage {
 
   std::vector<uint8_t> ToSRGB(int xmin, int ymin, int xsize, int ysize) const;
 
+  // Same result as ToSRGB(), converting rows in parallel.
+  std::vector<uint8_t> ToSRGB(ThreadPool* pool) const;
+
   void ToLinearRGB(std::vector<std::vector<float> >* rgb) const;
 
   void ToLinearRGB(int xmin, int ymin, int xsize, int ysize,
@@ -531,26 +531,38 @@ void Processor::SelectFrequencyMasking(const JPEGData& jpg, OutputImage* img,
   const int num_blocks = block_width * block_height;
 
   std::vector<std::vector<CoeffData> > orders(num_blocks);
-  for (int block_y = 0, block_ix = 0; block_y < block_height; ++block_y) {
-    for (int block_x = 0; block_x < block_width; ++block_x, ++block_ix) {
-      coeff_t block[kBlockSize] = {0};
-      coeff_t orig_block[kBlockSize] = {0};
-      for (int c = 0; c < 3; ++c) {
-        if (comp_mask & (1 << c)) {
-          assert(img->component(c).factor_x() == factor_x);
-          assert(img->component(c).factor_y() == factor_y);
-          img->component(c).GetCoeffBlock(block_x, block_y,
-                                          &block[c * kDCTBlockSize]);
-          const JPEGComponent& comp = jpg.components[c];
-          int jpg_block_ix = block_y * comp.width_in_blocks + block_x;
-          memcpy(&orig_block[c * kDCTBlockSize],
-                 &comp.coeffs[jpg_block_ix * kDCTBlockSize],
-                 kDCTBlockSize * sizeof(orig_block[0]));
+  // ComputeBlockZeroingOrder changes and reads *img only within one pixel of
+  // its (upsampled) block and restores it afterwards, so block rows two apart
+  // are independent. Each row is processed in order by one task and the row
+  // parities one after the other, which keeps the result independent of the
+  // number of threads.
+  ThreadPool serial_pool(0);
+  ThreadPool* pool = params_.pool != nullptr ? params_.pool : &serial_pool;
+  for (int parity = 0; parity < 2; ++parity) {
+    const int num_rows = (block_height + 1 - parity) / 2;
+    pool->Run(0, num_rows, [&](const int task, const int thread) {
+      const int block_y = 2 * task + parity;
+      for (int block_x = 0; block_x < block_width; ++block_x) {
+        const int block_ix = block_y * block_width + block_x;
+        coeff_t block[kBlockSize] = {0};
+        coeff_t orig_block[kBlockSize] = {0};
+        for (int c = 0; c < 3; ++c) {
+          if (comp_mask & (1 << c)) {
+            assert(img->component(c).factor_x() == factor_x);
+            assert(img->component(c).factor_y() == factor_y);
+            img->component(c).GetCoeffBlock(block_x, block_y,
+                                            &block[c * kDCTBlockSize]);
+            const JPEGComponent& comp = jpg.components[c];
+            int jpg_block_ix = block_y * comp.width_in_blocks + block_x;
+            memcpy(&orig_block[c * kDCTBlockSize],
+                   &comp.coeffs[jpg_block_ix * kDCTBlockSize],
+                   kDCTBlockSize * sizeof(orig_block[0]));
+          }
         }
+        ComputeBlockZeroingOrder(block, orig_block, block_x, block_y, factor_x,
+                                 factor_y, comp_mask, img, &orders[block_ix]);
       }
-      ComputeBlockZeroingOrder(block, orig_block, block_x, block_y, factor_x,
-                               factor_y, comp_mask, img, &orders[block_ix]);
-    }
+    });
   }
 
   JPEGData jpg_out = jpg;
@@ -570,6 +582,7 @@ void Processor::SelectFrequencyMasking(const JPEGData& jpg, OutputImage* img,
   std::vector<float> distmap(width * height);
 
   bool first_up_iter = true;
+  bool img_compared = false;
   for (int direction : {1, -1}) {
     for (;;) {
       if (stop_early && direction == -1) {
@@ -714,7 +727,29 @@ void Processor::SelectFrequencyMasking(const JPEGData& jpg, OutputImage* img,
                   global_order.size(), changed_blocks.size(), blocks_to_change,
                   num_blocks, val_threshold, encoded_jpg.size(),
                   100.0 - (100.0 * est_jpg_size) / encoded_jpg.size());
-      comparator_->Compare(*img);
+      // After the first iteration, only the pixels of the changed blocks (and,
+      // if upsampled, one pixel around them) differ from the image of the
+      // previous comparison.
+      int xmin = width, ymin = height, xmax = 0, ymax = 0;
+      for (int block_ix : changed_blocks) {
+        const int block_x = block_ix % block_width;
+        const int block_y = block_ix / block_width;
+        xmin = std::min(xmin, block_x * 8 * factor_x - 1);
+        ymin = std::min(ymin, block_y * 8 * factor_y - 1);
+        xmax = std::max(xmax, (block_x + 1) * 8 * factor_x + 1);
+        ymax = std::max(ymax, (block_y + 1) * 8 * factor_y + 1);
+      }
+      xmin = std::max(xmin, 0);
+      ymin = std::max(ymin, 0);
+      xmax = std::min(xmax, width);
+      ymax = std::min(ymax, height);
+      if (img_compared) {
+        comparator_->CompareRegion(*img, xmin, ymin, xmax - xmin,
+                                   ymax - ymin);
+      } else {
+        comparator_->Compare(*img);
+        img_compared = true;
+      }
       MaybeOutput(jpg_out, encoded_jpg);
       distmap = comparator_->distmap();
       prev_size = est_jpg_size;
@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 
+#include "data_parallel.h"
 #include "guetzli/jpeg_data.h"
 #include "guetzli/stats.h"
 
@@ -34,6 +35,9 @@ struct Params {
   bool use_silver_screen = false;
   int zeroing_greedy_lookahead = 3;
   bool new_zeroing_model = true;
+  // If not null, the per-block searches run on this pool. The output does not
+  // depend on its number of threads.
+  ThreadPool* pool = nullptr;
 };
 
 struct GuetzliOutput {
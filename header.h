@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "bit_reader.h"
+#include "common.h"
 #include "compiler_specific.h"
 
 namespace pik {
@@ -57,6 +58,37 @@ struct Header {
 
     // Gradient map used to predict smooth areas.
     kGradientMap = 16,
+
+    // AC groups are entropy-coded with num_ans_states interleaved ANS states
+    // (token i uses state i % num_ans_states) to shorten decoder dependency
+    // chains.
+    kInterleavedANS = 32,
+
+    // Single-group image whose fixed overhead would otherwise dominate: AC
+    // uses the natural coefficient orders (not stored), histograms with the
+    // static context map, and the AC group extends to the end of the stream
+    // (no AC group size).
+    kSmallImage = 64,
+
+    // Neutral gray image (num_components = 1): only the Y plane is coded and
+    // there is no color correlation map; the decoder derives X and B from Y.
+    kGrayscale = 128,
+
+    // Lossless frame of a multi-frame stream (see PixelsToPikFrame): groups
+    // whose size is zero retain the pixels of the previous frame.
+    kKeepUnchangedGroups = 256,
+
+    // Groups of the default bitstream are group_size_in_tiles (instead of
+    // kGroupWidthInTiles) tiles wide and high: smaller groups allow more
+    // parallelism for small images, larger ones reduce the per-group overhead
+    // of huge images.
+    kCustomGroupSize = 512,
+
+    // The AC histogram section starts with a byte that selects one of the
+    // kNumStaticHistograms built-in sets (see BuildAndEncodeHistogramsStatic)
+    // instead of storing histograms, or 0 if they follow as usual. The sets
+    // are generated by train_static_histograms and must not change.
+    kStaticHistograms = 1024,
   };
 
   uint32_t xsize = 0;
@@ -65,6 +97,9 @@ struct Header {
   uint32_t bitstream = kBitstreamDefault;
   uint32_t flags = 0;
   uint32_t quant_template = 0;
+  uint32_t num_ans_states = 1;  // Only if kInterleavedANS; 1, 2 or 4.
+  // Only if kCustomGroupSize; 2, 4, 8 or 16.
+  uint32_t group_size_in_tiles = kGroupWidthInTiles;
 };
 
 // For loading/storing fields from/to the compressed stream. Accepts Bytes or
@@ -83,12 +118,27 @@ void VisitFields(Visitor* PIK_RESTRICT visitor, Header* PIK_RESTRICT header) {
   // Direct 2-bit encoding for quant template ids 0, 1, 2, 3.
   (*visitor)(0x83828180, &header->quant_template);
 
+  if (header->flags & Header::kInterleavedANS) {
+    // Direct 2-bit encoding for 1, 2, 4 (and the reserved 8) states.
+    (*visitor)(0x88848281, &header->num_ans_states);
+  }
+
+  if (header->flags & Header::kCustomGroupSize) {
+    // Direct 2-bit encoding for 2, 4, 8, 16 tiles (128 to 1024 pixels).
+    (*visitor)(0x90888482, &header->group_size_in_tiles);
+  }
+
   // To extend: add a section, or add fields conditional on a NEW flag:
   // if (flag) (*visitor)(..).
 }
 
 #pragma pack(pop)
 
+// Returns the width and height of the groups of the default bitstream.
+static inline size_t GroupSizeInBlocks(const Header& header) {
+  return header.group_size_in_tiles * kTileWidthInBlocks;
+}
+
 // Returns whether "header" can be encoded (i.e. all fields have a valid
 // representation). If so, "*encoded_bits" is the exact number of bits required.
 bool CanEncode(const Header& header, size_t* PIK_RESTRICT encoded_bits);
@@ -351,4 +351,30 @@ bool HuffmanDecodingData::ReadFromBitStream(BitReader* input) {
   return true;
 }
 
+bool HuffmanDecodingData::BuildMultiSymbolTable() {
+  multi_table_.resize(1 << kHuffmanTableBits);
+  // Each key is as likely as the codes it starts with, if code lengths match
+  // the symbol probabilities.
+  int total_symbols = 0;
+  for (int key = 0; key < (1 << kHuffmanTableBits); ++key) {
+    HuffmanMultiCode& multi = multi_table_[key];
+    memset(&multi, 0, sizeof(multi));
+    int used_bits = 0;
+    int n = 0;
+    for (; n < kHuffmanMaxMultiSymbols; ++n) {
+      // Root entries are replicated for all values of the bits above their
+      // code length, so the unknown upper bits (zero here) do not matter.
+      const HuffmanCode& entry = table_[key >> used_bits];
+      // Also excludes pointers to 2nd level tables (bits > root bits).
+      if (entry.bits > kHuffmanTableBits - used_bits) break;
+      used_bits += entry.bits;
+      multi.bits[n] = static_cast<uint8_t>(used_bits);
+      multi.values[n] = entry.value;
+    }
+    multi.num_symbols = static_cast<uint8_t>(n);
+    total_symbols += n;
+  }
+  return total_symbols >= 2 << kHuffmanTableBits;
+}
+
 }  // namespace pik
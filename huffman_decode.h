@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "bit_reader.h"
+#include "compiler_specific.h"
 
 namespace pik {
 
@@ -36,6 +37,17 @@ typedef struct {
   uint16_t value;   /* symbol value or table offset */
 } HuffmanCode;
 
+// Upper bound on the number of symbols resolved by one multi-symbol lookup.
+static const int kHuffmanMaxMultiSymbols = 4;
+
+// Entry of the multi-symbol table: the consecutive codes (up to
+// kHuffmanMaxMultiSymbols) that fit entirely within the root table bits.
+struct HuffmanMultiCode {
+  uint8_t num_symbols;  // 0 if the first code is longer than the root bits.
+  uint8_t bits[kHuffmanMaxMultiSymbols];  // Total bits of symbols [0, i].
+  uint16_t values[kHuffmanMaxMultiSymbols];
+};
+
 struct HuffmanDecodingData {
   HuffmanDecodingData() {
     table_.reserve(2048);
@@ -46,7 +58,13 @@ struct HuffmanDecodingData {
   // Returns false if the Huffman code lengths can not de decoded.
   bool ReadFromBitStream(BitReader* input);
 
+  // Derives multi_table_ from the root table; required by ReadSymbols. Returns
+  // whether a lookup resolves at least two symbols on average (assuming the
+  // code matches the symbol statistics), otherwise ReadSymbol is faster.
+  bool BuildMultiSymbolTable();
+
   std::vector<HuffmanCode> table_;
+  std::vector<HuffmanMultiCode> multi_table_;
 };
 
 struct HuffmanDecoder {
@@ -65,6 +83,34 @@ struct HuffmanDecoder {
     input->Advance(table->bits);
     return table->value;
   }
+
+  // Decodes up to kHuffmanMaxMultiSymbols symbols with a single lookup if
+  // their codes fit within the root table bits. Returns the number of symbols
+  // decoded (at least one). Always writes kHuffmanMaxMultiSymbols values to
+  // "symbols", so the caller must not need fewer than that.
+  size_t ReadSymbols(const HuffmanDecodingData& code, BitReader* input,
+                     int* PIK_RESTRICT symbols) {
+    input->FillBitBuffer();
+    const int index = input->PeekFixedBits<kHuffmanTableBits>();
+    const HuffmanMultiCode& multi = code.multi_table_[index];
+    const size_t num = multi.num_symbols;
+    if (PIK_UNLIKELY(num == 0)) {
+      // The first code continues in a 2nd level table.
+      const HuffmanCode* table = &code.table_[index];
+      const int nbits = table->bits - kHuffmanTableBits;
+      input->Advance(kHuffmanTableBits);
+      table += table->value;
+      table += input->PeekBits(nbits);
+      input->Advance(table->bits);
+      symbols[0] = table->value;
+      return 1;
+    }
+    for (size_t i = 0; i < kHuffmanMaxMultiSymbols; ++i) {
+      symbols[i] = multi.values[i];
+    }
+    input->Advance(multi.bits[num - 1]);
+    return num;
+  }
 };
 
 }  // namespace pik
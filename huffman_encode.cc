@@ -18,8 +18,8 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
-#include <vector>
 
+#include "compiler_specific.h"
 #include "fast_log.h"
 #include "status.h"
 #include "write_bits.h"
@@ -32,6 +32,7 @@ static const int kCodeLengthCodes = 18;
 
 // A node of a Huffman tree.
 struct HuffmanTree {
+  HuffmanTree() {}
   HuffmanTree(uint32_t count, int16_t left, int16_t right)
       : total_count(count), index_left(left), index_right_or_value(right) {}
   uint32_t total_count;
@@ -39,9 +40,33 @@ struct HuffmanTree {
   int16_t index_right_or_value;
 };
 
-// Sort the root nodes, least popular first.
-inline bool SortHuffmanTree(const HuffmanTree& v0, const HuffmanTree& v1) {
-  return v0.total_count < v1.total_count;
+// Stable sort of the root nodes, least popular first. LSD radix sort with
+// 8-bit digits; passes in which all nodes have the same digit are skipped.
+// "tmp" must have room for n nodes.
+void SortHuffmanTree(HuffmanTree* PIK_RESTRICT nodes, const size_t n,
+                     HuffmanTree* PIK_RESTRICT tmp) {
+  HuffmanTree* from = nodes;
+  HuffmanTree* to = tmp;
+  for (int shift = 0; shift < 32; shift += 8) {
+    size_t offsets[256] = {0};
+    for (size_t i = 0; i < n; ++i) {
+      ++offsets[(from[i].total_count >> shift) & 0xFF];
+    }
+    if (offsets[(from[0].total_count >> shift) & 0xFF] == n) continue;
+    size_t sum = 0;
+    for (size_t digit = 0; digit < 256; ++digit) {
+      const size_t count = offsets[digit];
+      offsets[digit] = sum;
+      sum += count;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      to[offsets[(from[i].total_count >> shift) & 0xFF]++] = from[i];
+    }
+    std::swap(from, to);
+  }
+  if (from != nodes) {
+    std::copy(from, from + n, nodes);
+  }
 }
 
 void SetDepth(const HuffmanTree& p, HuffmanTree* pool, uint8_t* depth,
@@ -78,29 +103,30 @@ void SetDepth(const HuffmanTree& p, HuffmanTree* pool, uint8_t* depth,
 // See http://en.wikipedia.org/wiki/Huffman_coding
 void CreateHuffmanTree(const uint32_t* data, const size_t length,
                        const int tree_limit, uint8_t* depth) {
+  PIK_ASSERT(length <= kMaxHuffmanAlphabetSize);
+  // Leaves, a sentinel, parents and another sentinel (see below).
+  HuffmanTree tree[2 * kMaxHuffmanAlphabetSize + 1];
+  HuffmanTree sorted_tmp[kMaxHuffmanAlphabetSize];
   // For block sizes below 64 kB, we never need to do a second iteration
   // of this loop. Probably all of our block sizes will be smaller than
   // that, so this loop is mostly of academic interest. If we actually
   // would need this, we would be better off with the Katajainen algorithm.
   for (uint32_t count_limit = 1;; count_limit = 2 * count_limit + 1) {
-    std::vector<HuffmanTree> tree;
-    tree.reserve(2 * length + 1);
-
+    size_t n = 0;
     for (size_t i = length; i != 0;) {
       --i;
       if (data[i]) {
         const uint32_t count = std::max(data[i], count_limit);
-        tree.push_back(HuffmanTree(count, -1, static_cast<int16_t>(i)));
+        tree[n++] = HuffmanTree(count, -1, static_cast<int16_t>(i));
       }
     }
 
-    const size_t n = tree.size();
     if (n == 1) {
       depth[tree[0].index_right_or_value] = 1;  // Only one element.
       break;
     }
 
-    std::stable_sort(tree.begin(), tree.end(), SortHuffmanTree);
+    SortHuffmanTree(tree, n, sorted_tmp);
 
     // The nodes are:
     // [0, n): the sorted leaf nodes that we start with.
@@ -110,8 +136,9 @@ void CreateHuffmanTree(const uint32_t* data, const size_t length,
     // [2n]: we add a sentinel at the end as well.
     // There will be (2n+1) elements at the end.
     const HuffmanTree sentinel(std::numeric_limits<uint32_t>::max(), -1, -1);
-    tree.push_back(sentinel);
-    tree.push_back(sentinel);
+    size_t tree_size = n;
+    tree[tree_size++] = sentinel;
+    tree[tree_size++] = sentinel;
 
     size_t i = 0;      // Points to the next leaf node.
     size_t j = n + 1;  // Points to the next non-leaf node.
@@ -133,16 +160,16 @@ void CreateHuffmanTree(const uint32_t* data, const size_t length,
       }
 
       // The sentinel node becomes the parent node.
-      size_t j_end = tree.size() - 1;
+      size_t j_end = tree_size - 1;
       tree[j_end].total_count =
           tree[left].total_count + tree[right].total_count;
       tree[j_end].index_left = static_cast<int16_t>(left);
       tree[j_end].index_right_or_value = static_cast<int16_t>(right);
 
       // Add back the last sentinel node.
-      tree.push_back(sentinel);
+      tree[tree_size++] = sentinel;
     }
-    PIK_ASSERT(tree.size() == 2 * n + 1);
+    PIK_ASSERT(tree_size == 2 * n + 1);
     SetDepth(tree[2 * n - 1], &tree[0], depth, 0);
 
     // We need to pack the Huffman tree in tree_limit bits.
@@ -468,8 +495,9 @@ template <class BitVisitor>
 void StoreHuffmanTree(const uint8_t* depths, size_t num,
                       BitVisitor* bit_visitor) {
   // Write the Huffman tree into the compact representation.
-  std::vector<uint8_t> huffman_tree(num);
-  std::vector<uint8_t> huffman_tree_extra_bits(num);
+  PIK_ASSERT(num <= kMaxHuffmanAlphabetSize);
+  uint8_t huffman_tree[kMaxHuffmanAlphabetSize];
+  uint8_t huffman_tree_extra_bits[kMaxHuffmanAlphabetSize];
   size_t huffman_tree_size = 0;
   WriteHuffmanTree(depths, num, &huffman_tree_size, &huffman_tree[0],
                    &huffman_tree_extra_bits[0]);
@@ -565,9 +593,9 @@ void BuildHuffmanTreeAndCountBits(const uint32_t* histogram,
                                   const size_t length, size_t* histogram_bits,
                                   size_t* data_bits) {
   BitCounter bit_counter;
-  std::vector<uint8_t> depths(length);
-  BuildAndVisitHuffmanTree(histogram, length, depths.data(), nullptr,
-                           &bit_counter);
+  PIK_ASSERT(length <= kMaxHuffmanAlphabetSize);
+  uint8_t depths[kMaxHuffmanAlphabetSize] = {0};
+  BuildAndVisitHuffmanTree(histogram, length, depths, nullptr, &bit_counter);
   *histogram_bits = bit_counter.num_bits;
   *data_bits = 0;
   for (int i = 0; i < length; ++i) {
@@ -20,6 +20,10 @@
 
 namespace pik {
 
+// Upper bound on "length" (alphabet size). The encoder uses fixed-size stack
+// arrays rather than allocating.
+static constexpr size_t kMaxHuffmanAlphabetSize = 1024;
+
 void BuildAndStoreHuffmanTree(const uint32_t *histogram,
                               const size_t length,
                               uint8_t* depth,
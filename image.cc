@@ -20,6 +20,20 @@
 
 namespace pik {
 
+template class Image<uint8_t>;
+template class Image<int16_t>;
+template class Image<uint16_t>;
+template class Image<int32_t>;
+template class Image<float>;
+template class Image<double>;
+
+template class Image3<uint8_t>;
+template class Image3<int16_t>;
+template class Image3<uint16_t>;
+template class Image3<int32_t>;
+template class Image3<float>;
+template class Image3<double>;
+
 ImageB Float255ToByteImage(const ImageF& from) {
   ImageB to(from.xsize(), from.ysize());
   PROFILER_FUNC;
@@ -64,6 +78,59 @@ Image3B Float255ToByteImage3(const Image3F& from) {
   return to;
 }
 
+namespace {
+
+// Returns the 8-bit alpha of pixel x.
+PIK_INLINE uint8_t Alpha8(const uint16_t* PIK_RESTRICT row_alpha,
+                          const bool is_16bit, const size_t x) {
+  if (row_alpha == nullptr) return 255;
+  return is_16bit ? (row_alpha[x] + 128) / 257 : row_alpha[x];
+}
+
+// "kR" and "kB" are the byte offsets of red and blue within a pixel.
+template <size_t kBytesPerPixel, size_t kR, size_t kB>
+void InterleaveRowT(const uint8_t* PIK_RESTRICT row_r,
+                    const uint8_t* PIK_RESTRICT row_g,
+                    const uint8_t* PIK_RESTRICT row_b,
+                    const uint16_t* PIK_RESTRICT row_alpha, const bool is_16bit,
+                    const size_t xsize, uint8_t* PIK_RESTRICT row_out) {
+  for (size_t x = 0; x < xsize; ++x) {
+    uint8_t* PIK_RESTRICT pixel = row_out + x * kBytesPerPixel;
+    pixel[kR] = row_r[x];
+    pixel[1] = row_g[x];
+    pixel[kB] = row_b[x];
+    if (kBytesPerPixel == 4) pixel[3] = Alpha8(row_alpha, is_16bit, x);
+  }
+}
+
+}  // namespace
+
+void InterleaveRow(const uint8_t* PIK_RESTRICT row_r,
+                   const uint8_t* PIK_RESTRICT row_g,
+                   const uint8_t* PIK_RESTRICT row_b,
+                   const uint16_t* PIK_RESTRICT row_alpha, const int alpha_bits,
+                   const size_t xsize, const size_t y,
+                   const InterleavedImageView& out) {
+  PIK_ASSERT(xsize <= out.xsize && y < out.ysize);
+  PIK_ASSERT(out.bytes_per_row >= out.xsize * BytesPerPixel(out.layout));
+  const bool is_16bit = alpha_bits > 8;
+  uint8_t* PIK_RESTRICT row_out = out.bytes + y * out.bytes_per_row;
+  switch (out.layout) {
+    case PixelLayout::kRGB:
+      InterleaveRowT<3, 0, 2>(row_r, row_g, row_b, nullptr, false, xsize,
+                              row_out);
+      break;
+    case PixelLayout::kRGBA:
+      InterleaveRowT<4, 0, 2>(row_r, row_g, row_b, row_alpha, is_16bit, xsize,
+                              row_out);
+      break;
+    case PixelLayout::kBGRA:
+      InterleaveRowT<4, 2, 0>(row_r, row_g, row_b, row_alpha, is_16bit, xsize,
+                              row_out);
+      break;
+  }
+}
+
 float Average(const ImageF& img) {
   // TODO(user): Make sure this is numerically stable.
   const size_t xsize = img.xsize();
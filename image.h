@@ -102,21 +102,22 @@ class Image {
   using T = ComponentType;
   static constexpr size_t kNumPlanes = 1;
 
-  Image() : xsize_(0), ysize_(0), bytes_per_row_(0), bytes_() {}
+  Image()
+      : xsize_(0),
+        ysize_(0),
+        bytes_per_row_(0),
+        bytes_allocated_(0),
+        bytes_(),
+        owns_bytes_(true) {}
 
   Image(const size_t xsize, const size_t ysize)
       : xsize_(xsize),
         ysize_(ysize),
         bytes_per_row_(BytesPerRow<kImageAlign>(xsize * sizeof(T))),
-        bytes_(AllocateArray(bytes_per_row_ * ysize, Avoid2K())) {
-#ifdef MEMORY_SANITIZER
-    // Only in MSAN builds: ensure full vectors are initialized.
-    const size_t partial = (xsize_ * sizeof(T)) % kMaxVectorSize;
-    const size_t remainder = (partial == 0) ? 0 : (kMaxVectorSize - partial);
-    for (size_t y = 0; y < ysize_; ++y) {
-      memset(Row(y) + xsize_, 0, remainder);
-    }
-#endif
+        bytes_allocated_(bytes_per_row_ * ysize),
+        bytes_(AllocateArray(bytes_allocated_, Avoid2K())),
+        owns_bytes_(true) {
+    InitializePadding();
   }
 
   // Takes ownership.
@@ -125,11 +126,34 @@ class Image {
       : xsize_(xsize),
         ysize_(ysize),
         bytes_per_row_(bytes_per_row),
-        bytes_(std::move(bytes)) {
+        bytes_allocated_(bytes_per_row * ysize),
+        bytes_(std::move(bytes)),
+        owns_bytes_(true) {
     PIK_ASSERT(bytes_per_row >= xsize * sizeof(T));
     PIK_CHECK(reinterpret_cast<uintptr_t>(bytes_.get()) % kImageAlign == 0);
   }
 
+  // Does NOT take ownership: "bytes" (e.g. the single allocation of an Image3,
+  // see Image3Layout) must outlive this image. Rows may be interleaved with
+  // those of other images, so there is no capacity for GrowTo; Resize
+  // reallocates (and then owns the new memory).
+  Image(const size_t xsize, const size_t ysize, uint8_t* bytes,
+        const size_t bytes_per_row)
+      : xsize_(xsize),
+        ysize_(ysize),
+        bytes_per_row_(bytes_per_row),
+        bytes_allocated_(0),
+        bytes_(bytes),
+        owns_bytes_(false) {
+    PIK_ASSERT(bytes_per_row >= xsize * sizeof(T));
+    PIK_CHECK(reinterpret_cast<uintptr_t>(bytes) % kImageAlign == 0);
+    InitializePadding();
+  }
+
+  ~Image() {
+    if (!owns_bytes_) (void)bytes_.release();
+  }
+
   // Copy construction/assignment is forbidden to avoid inadvertent copies,
   // which can be very expensive. Use copy = CopyImage(image) instead.
   Image(const Image& other) = delete;
@@ -140,14 +164,24 @@ class Image {
       : xsize_(other.xsize_),
         ysize_(other.ysize_),
         bytes_per_row_(other.bytes_per_row_),
-        bytes_(std::move(other.bytes_)) {}
+        bytes_allocated_(other.bytes_allocated_),
+        bytes_(std::move(other.bytes_)),
+        owns_bytes_(other.owns_bytes_) {
+    other.bytes_allocated_ = 0;  // For Resize.
+    other.owns_bytes_ = true;
+  }
 
   // Move assignment (required for std::vector)
   Image& operator=(Image&& other) {
     xsize_ = other.xsize_;
     ysize_ = other.ysize_;
     bytes_per_row_ = other.bytes_per_row_;
+    bytes_allocated_ = other.bytes_allocated_;
+    other.bytes_allocated_ = 0;  // For Resize.
+    if (!owns_bytes_) (void)bytes_.release();
     bytes_ = std::move(other.bytes_);
+    owns_bytes_ = other.owns_bytes_;
+    other.owns_bytes_ = true;
     return *this;
   }
 
@@ -155,7 +189,9 @@ class Image {
     std::swap(xsize_, other.xsize_);
     std::swap(ysize_, other.ysize_);
     std::swap(bytes_per_row_, other.bytes_per_row_);
+    std::swap(bytes_allocated_, other.bytes_allocated_);
     std::swap(bytes_, other.bytes_);
+    std::swap(owns_bytes_, other.owns_bytes_);
   }
 
   // Useful for pre-allocating image with some padding for alignment purposes
@@ -167,6 +203,37 @@ class Image {
     ysize_ = ysize;
   }
 
+  // Whether GrowTo(xsize, ysize) is possible without reallocating, e.g. after
+  // ShrinkTo or for images from ImageWithCapacityForMultipleOf.
+  bool CanGrowTo(const size_t xsize, const size_t ysize) const {
+    return BytesPerRow<kImageAlign>(xsize * sizeof(T)) <= bytes_per_row_ &&
+           bytes_per_row_ * ysize <= bytes_allocated_;
+  }
+
+  // Inverse of ShrinkTo: enlarges the valid dimensions within the existing
+  // allocation. Pixels in the new area are uninitialized.
+  void GrowTo(const size_t xsize, const size_t ysize) {
+    PIK_CHECK(CanGrowTo(xsize, ysize));
+    xsize_ = xsize;
+    ysize_ = ysize;
+    InitializePadding();
+  }
+
+  // Changes the dimensions to xsize x ysize, as if newly constructed. Reuses
+  // the existing allocation if it is large enough, which avoids allocating
+  // for every image when decoding many images. Pixels are uninitialized.
+  void Resize(const size_t xsize, const size_t ysize) {
+    const size_t bytes_per_row = BytesPerRow<kImageAlign>(xsize * sizeof(T));
+    if (bytes_per_row * ysize > bytes_allocated_) {
+      *this = Image(xsize, ysize);
+      return;
+    }
+    xsize_ = xsize;
+    ysize_ = ysize;
+    bytes_per_row_ = bytes_per_row;
+    InitializePadding();
+  }
+
   // How many pixels.
   PIK_INLINE size_t xsize() const { return xsize_; }
   PIK_INLINE size_t ysize() const { return ysize_; }
@@ -214,6 +281,9 @@ class Image {
 
   PIK_INLINE size_t bytes_per_row() const { return bytes_per_row_; }
 
+  // Capacity [bytes] of the allocation, which may exceed the current size.
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
   // Returns number of pixels (some of which are padding) per row. Useful for
   // computing other rows via pointer arithmetic.
   PIK_INLINE intptr_t PixelsPerRow() const {
@@ -223,6 +293,17 @@ class Image {
   }
 
  private:
+  void InitializePadding() {
+#ifdef MEMORY_SANITIZER
+    // Only in MSAN builds: ensure full vectors are initialized.
+    const size_t partial = (xsize_ * sizeof(T)) % kMaxVectorSize;
+    const size_t remainder = (partial == 0) ? 0 : (kMaxVectorSize - partial);
+    for (size_t y = 0; y < ysize_; ++y) {
+      memset(Row(y) + xsize_, 0, remainder);
+    }
+#endif
+  }
+
   // Offset for the allocated pointer to avoid 2K aliasing (see BytesPerRow)
   // between the planes of an Image3. Necessary because consecutive large
   // allocations on Linux often return pointers with the same alignment.
@@ -237,7 +318,9 @@ class Image {
   size_t xsize_;  // original intended pixels, not including any padding.
   size_t ysize_;
   size_t bytes_per_row_;  // [bytes] including padding.
+  size_t bytes_allocated_;  // [bytes] capacity of bytes_, for Resize.
   CacheAlignedUniquePtr bytes_;
+  bool owns_bytes_;  // false: bytes_ is released instead of freed.
 };
 
 using ImageB = Image<uint8_t>;
@@ -247,6 +330,15 @@ using ImageI = Image<int32_t>;
 using ImageF = Image<float>;
 using ImageD = Image<double>;
 
+// Instantiated in image.cc so that translation units compiled for other
+// targets (e.g. *_target.cc with -mavx2) do not emit copies of the members.
+extern template class Image<uint8_t>;
+extern template class Image<int16_t>;
+extern template class Image<uint16_t>;
+extern template class Image<int32_t>;
+extern template class Image<float>;
+extern template class Image<double>;
+
 // ImageSize and *ImageView are Plain Old Data to allow copying them into
 // untyped TileFlow bytestreams. We omit unnecessary fields and choose smaller
 // representations to reduce L1 cache pollution.
@@ -345,6 +437,30 @@ class ConstImageView {
 using MutableImageViewF = MutableImageView<float>;
 using ConstImageViewF = ConstImageView<float>;
 
+// Receives rows of an image as soon as their final values are known, e.g. from
+// a decoder that is still working on later rows.
+template <typename T>
+struct ImageRowsSink {
+  // "planes[c].ConstRow(y)" is row y0 + y of channel c, for y < ysize; each
+  // row has xsize valid pixels. The views are only valid during the call.
+  using Func = void (*)(void* opaque, size_t y0, size_t xsize, size_t ysize,
+                        const ConstImageView<T>* planes);
+
+  // Passes rows [y0, y0 + ysize) of "image" to func.
+  template <class Image>
+  void Emit(const Image& image, const size_t y0, const size_t xsize,
+            const size_t ysize) const {
+    ConstImageView<T> planes[3];
+    for (int c = 0; c < 3; ++c) {
+      planes[c].Init(image.Plane(c), 0, y0);
+    }
+    func(opaque, y0, xsize, ysize, planes);
+  }
+
+  Func func;
+  void* opaque;
+};
+
 template <typename T>
 Image<T> CopyImage(const Image<T>& image) {
   const size_t xsize = image.xsize();
@@ -358,6 +474,17 @@ Image<T> CopyImage(const Image<T>& image) {
   return copy;
 }
 
+// Same as *to = CopyImage(from), but reuses the allocation of "to" if possible.
+template <typename T>
+void CopyImageTo(const Image<T>& from, Image<T>* PIK_RESTRICT to) {
+  const size_t xsize = from.xsize();
+  const size_t ysize = from.ysize();
+  to->Resize(xsize, ysize);
+  for (size_t y = 0; y < ysize; ++y) {
+    memcpy(to->Row(y), from.Row(y), xsize * sizeof(T));
+  }
+}
+
 // Also works for Image3 and mixed argument types.
 template <class Image1, class Image2>
 bool SameSize(const Image1& image1, const Image2& image2) {
@@ -498,62 +625,101 @@ void AddTo(const Image<Tin>& what, Image<Tout>* to) {
   }
 }
 
-// Returns linear combination of two grayscale images.
+// The output-parameter variants below resize "out" (reusing its allocation if
+// possible) and allow it to alias an input unless noted otherwise. See
+// image_ops.h for parallel SIMD versions.
+
+// Linear combination of two grayscale images.
 template <typename T>
-Image<T> LinComb(const T lambda1, const Image<T>& image1,
-                 const T lambda2, const Image<T>& image2) {
+void LinComb(const T lambda1, const Image<T>& image1, const T lambda2,
+             const Image<T>& image2, Image<T>* out) {
   const size_t xsize = image1.xsize();
   const size_t ysize = image1.ysize();
   PIK_CHECK(xsize == image2.xsize());
   PIK_CHECK(ysize == image2.ysize());
-  Image<T> out(xsize, ysize);
+  if (!SameSize(image1, *out)) out->Resize(xsize, ysize);
   for (size_t y = 0; y < ysize; ++y) {
-    const T* const PIK_RESTRICT row1 = image1.Row(y);
-    const T* const PIK_RESTRICT row2 = image2.Row(y);
-    T* const PIK_RESTRICT row_out = out.Row(y);
+    const T* const row1 = image1.Row(y);
+    const T* const row2 = image2.Row(y);
+    T* const row_out = out->Row(y);
     for (size_t x = 0; x < xsize; ++x) {
       row_out[x] = lambda1 * row1[x] + lambda2 * row2[x];
     }
   }
+}
+
+template <typename T>
+Image<T> LinComb(const T lambda1, const Image<T>& image1,
+                 const T lambda2, const Image<T>& image2) {
+  Image<T> out;
+  LinComb(lambda1, image1, lambda2, image2, &out);
   return out;
 }
 
-// Returns a pixel-by-pixel multiplication of image by lambda.
+// Pixel-by-pixel multiplication of image by lambda.
 template <typename T>
-Image<T> ScaleImage(const T lambda, const Image<T>& image) {
-  Image<T> out(image.xsize(), image.ysize());
+void ScaleImage(const T lambda, const Image<T>& image, Image<T>* out) {
+  if (!SameSize(image, *out)) out->Resize(image.xsize(), image.ysize());
   for (size_t y = 0; y < image.ysize(); ++y) {
-    const T* const PIK_RESTRICT row = image.Row(y);
-    T* const PIK_RESTRICT row_out = out.Row(y);
+    const T* const row = image.Row(y);
+    T* const row_out = out->Row(y);
     for (size_t x = 0; x < image.xsize(); ++x) {
       row_out[x] = lambda * row[x];
     }
   }
+}
+
+// In-place.
+template <typename T>
+void ScaleImage(const T lambda, Image<T>* image) {
+  ScaleImage(lambda, *image, image);
+}
+
+template <typename T>
+Image<T> ScaleImage(const T lambda, const Image<T>& image) {
+  Image<T> out;
+  ScaleImage(lambda, image, &out);
   return out;
 }
 
+// "out" must not alias "in".
 template <typename T>
-Image<T> ZeroPadImage(const Image<T>& in, int padx0, int pady0, int padx1,
-                      int pady1) {
-  Image<T> out(in.xsize() + padx0 + padx1, in.ysize() + pady0 + pady1, T());
+void ZeroPadImage(const Image<T>& in, int padx0, int pady0, int padx1,
+                  int pady1, Image<T>* PIK_RESTRICT out) {
+  out->Resize(in.xsize() + padx0 + padx1, in.ysize() + pady0 + pady1);
+  FillImage(T(), out);
   for (int y = 0; y < in.ysize(); ++y) {
-    memcpy(out.Row(y + pady0) + padx0, in.Row(y), in.xsize() * sizeof(T));
+    memcpy(out->Row(y + pady0) + padx0, in.Row(y), in.xsize() * sizeof(T));
   }
+}
+
+template <typename T>
+Image<T> ZeroPadImage(const Image<T>& in, int padx0, int pady0, int padx1,
+                      int pady1) {
+  Image<T> out;
+  ZeroPadImage(in, padx0, pady0, padx1, pady1, &out);
   return out;
 }
 
 template <typename T>
-Image<T> Product(const Image<T>& a, const Image<T>& b) {
-  Image<T> c(a.xsize(), a.ysize());
+void Product(const Image<T>& a, const Image<T>& b, Image<T>* out) {
+  PIK_CHECK(SameSize(a, b));
+  if (!SameSize(a, *out)) out->Resize(a.xsize(), a.ysize());
   for (size_t y = 0; y < a.ysize(); ++y) {
-    const T* const PIK_RESTRICT row_a = a.Row(y);
-    const T* const PIK_RESTRICT row_b = b.Row(y);
-    T* const PIK_RESTRICT row_c = c.Row(y);
+    const T* const row_a = a.Row(y);
+    const T* const row_b = b.Row(y);
+    T* const row_out = out->Row(y);
     for (size_t x = 0; x < a.xsize(); ++x) {
-      row_c[x] = row_a[x] * row_b[x];
+      row_out[x] = row_a[x] * row_b[x];
     }
   }
-  return c;
+}
+
+template <typename T>
+Image<T> Product(const Image<T>& a, const Image<T>& b) {
+  Image<T> out;
+  Product(a, b, &out);
+  return out;
 }
 
 float DotProduct(const ImageF& a, const ImageF& b);
@@ -698,6 +864,18 @@ void CropToMultipleOf(const size_t x_multiple, const size_t y_multiple,
   }
 }
 
+// Returns an xsize x ysize image (Image or Image3) that can GrowTo the next
+// multiples of "multiple" without reallocating, e.g. to replicate the borders
+// of partial blocks in place.
+template <class ImageT>
+ImageT ImageWithCapacityForMultipleOf(const size_t xsize, const size_t ysize,
+                                      const size_t multiple) {
+  ImageT image((xsize + multiple - 1) / multiple * multiple,
+               (ysize + multiple - 1) / multiple * multiple);
+  image.ShrinkTo(xsize, ysize);
+  return image;
+}
+
 // Computes the minimum and maximum pixel value.
 template <typename T>
 void ImageMinMax(const Image<T>& image, T* const PIK_RESTRICT min,
@@ -857,6 +1035,20 @@ Image<T> CopyImage(const Rect& rect, const Image<T>& image) {
 // and provide a MutablePlane accessor. The producer could theoretically change
 // the size of individual planes and thus break the Image3 invariant. To guard
 // against this, ensure any call to MutablePlane is followed by CheckSizesSame.
+
+// How an Image3 allocates its planes. The row accessors are the same for all.
+enum class Image3Layout {
+  // One allocation per plane (the default).
+  kSeparate,
+  // One allocation; each plane is contiguous, and plane starts are offset
+  // such that they do not alias modulo 2 KiB (see BytesPerRow).
+  kContiguous,
+  // One allocation; the rows of all planes for a given y are adjacent. Best
+  // for kernels that read or write all three planes of each row, e.g.
+  // CenteredOpsinToSrgb. Worse for kernels processing one plane at a time.
+  kRowInterleaved
+};
+
 template <typename ComponentType>
 class Image3 {
  public:
@@ -870,10 +1062,32 @@ class Image3 {
       : planes_{PlaneT(xsize, ysize), PlaneT(xsize, ysize),
                 PlaneT(xsize, ysize)} {}
 
+  // The planes of kContiguous/kRowInterleaved images are views into a single
+  // allocation owned by the Image3 and must not outlive it (e.g. via
+  // MutablePlane()->Swap). Replacing a plane is allowed but gives it its own
+  // allocation.
+  Image3(const size_t xsize, const size_t ysize, const Image3Layout layout)
+      : layout_(layout) {
+    if (layout == Image3Layout::kSeparate) {
+      for (PlaneT& plane : planes_) {
+        plane = PlaneT(xsize, ysize);
+      }
+      return;
+    }
+    storage_bytes_ = StorageBytes(layout, xsize, ysize);
+    storage_ = AllocateArray(storage_bytes_);
+    InitViews(xsize, ysize);
+  }
+
   Image3(Image3&& other) {
     for (int i = 0; i < kNumPlanes; i++) {
       planes_[i] = std::move(other.planes_[i]);
     }
+    layout_ = other.layout_;
+    storage_bytes_ = other.storage_bytes_;
+    storage_ = std::move(other.storage_);
+    other.layout_ = Image3Layout::kSeparate;
+    other.storage_bytes_ = 0;
   }
 
   Image3(PlaneT&& plane0, PlaneT&& plane1, PlaneT&& plane2) {
@@ -889,6 +1103,9 @@ class Image3 {
       : Image3(std::move(planes[0]), std::move(planes[1]),
                std::move(planes[2])) {}
 
+  // User-provided so that the extern template below also covers it.
+  ~Image3() {}
+
   // Copy construction/assignment is forbidden to avoid inadvertent copies,
   // which can be very expensive. Use copy = CopyImage(image) instead.
   Image3(const Image3& other) = delete;
@@ -898,6 +1115,11 @@ class Image3 {
     for (int i = 0; i < kNumPlanes; i++) {
       planes_[i] = std::move(other.planes_[i]);
     }
+    layout_ = other.layout_;
+    storage_bytes_ = other.storage_bytes_;
+    storage_ = std::move(other.storage_);
+    other.layout_ = Image3Layout::kSeparate;
+    other.storage_bytes_ = 0;
     return *this;
   }
 
@@ -936,6 +1158,9 @@ class Image3 {
     for (int c = 0; c < 3; ++c) {
       other.planes_[c].Swap(planes_[c]);
     }
+    std::swap(layout_, other.layout_);
+    std::swap(storage_bytes_, other.storage_bytes_);
+    std::swap(storage_, other.storage_);
   }
 
   void ShrinkTo(const size_t xsize, const size_t ysize) {
@@ -944,12 +1169,92 @@ class Image3 {
     }
   }
 
+  // See Image::CanGrowTo/GrowTo. Always false for single-allocation layouts.
+  bool CanGrowTo(const size_t xsize, const size_t ysize) const {
+    return planes_[0].CanGrowTo(xsize, ysize) &&
+           planes_[1].CanGrowTo(xsize, ysize) &&
+           planes_[2].CanGrowTo(xsize, ysize);
+  }
+  void GrowTo(const size_t xsize, const size_t ysize) {
+    for (PlaneT& plane : planes_) {
+      plane.GrowTo(xsize, ysize);
+    }
+  }
+
+  // See Image::Resize. Preserves the layout.
+  void Resize(const size_t xsize, const size_t ysize) {
+    if (layout_ == Image3Layout::kSeparate) {
+      for (PlaneT& plane : planes_) {
+        plane.Resize(xsize, ysize);
+      }
+      return;
+    }
+    if (StorageBytes(layout_, xsize, ysize) > storage_bytes_) {
+      *this = Image3(xsize, ysize, layout_);
+      return;
+    }
+    InitViews(xsize, ysize);
+  }
+
+  Image3Layout layout() const { return layout_; }
+
+  size_t bytes_allocated() const {
+    return storage_bytes_ + planes_[0].bytes_allocated() +
+           planes_[1].bytes_allocated() + planes_[2].bytes_allocated();
+  }
+
   // Sizes of all three images are guaranteed to be equal.
   PIK_INLINE size_t xsize() const { return planes_[0].xsize(); }
   PIK_INLINE size_t ysize() const { return planes_[0].ysize(); }
 
  private:
+  // Offset between planes of kContiguous images, modulo 2 KiB.
+  static constexpr size_t kPlaneOffset = 2 * kImageAlign;
+
+  // Distance [bytes] between rows of the same plane (kContiguous) or between
+  // the rows of consecutive planes (kRowInterleaved).
+  static size_t RowBytes(const Image3Layout layout, const size_t xsize) {
+    size_t bytes_per_row = BytesPerRow<kImageAlign>(xsize * sizeof(T));
+    // Rows of planes 0 and 2 would otherwise alias modulo 2 KiB.
+    if (layout == Image3Layout::kRowInterleaved && bytes_per_row % 1024 == 0) {
+      bytes_per_row += kImageAlign;
+    }
+    return bytes_per_row;
+  }
+
+  // Distance [bytes] between the starts of consecutive kContiguous planes.
+  static size_t PlaneBytes(const size_t bytes_per_row, const size_t ysize) {
+    return (bytes_per_row * ysize + 2047) / 2048 * 2048 + kPlaneOffset;
+  }
+
+  static size_t StorageBytes(const Image3Layout layout, const size_t xsize,
+                             const size_t ysize) {
+    const size_t bytes_per_row = RowBytes(layout, xsize);
+    if (layout == Image3Layout::kRowInterleaved) {
+      return kNumPlanes * bytes_per_row * ysize;
+    }
+    return kNumPlanes * PlaneBytes(bytes_per_row, ysize);
+  }
+
+  // Points the planes into storage_, which must be large enough.
+  void InitViews(const size_t xsize, const size_t ysize) {
+    const size_t bytes_per_row = RowBytes(layout_, xsize);
+    const bool interleaved = layout_ == Image3Layout::kRowInterleaved;
+    const size_t plane_offset =
+        interleaved ? bytes_per_row : PlaneBytes(bytes_per_row, ysize);
+    const size_t stride = interleaved ? kNumPlanes * bytes_per_row
+                                      : bytes_per_row;
+    for (size_t c = 0; c < kNumPlanes; ++c) {
+      planes_[c] =
+          PlaneT(xsize, ysize, storage_.get() + c * plane_offset, stride);
+    }
+  }
+
   PlaneT planes_[kNumPlanes];
+  Image3Layout layout_ = Image3Layout::kSeparate;
+  // Single allocation for all planes unless layout_ is kSeparate.
+  size_t storage_bytes_ = 0;
+  CacheAlignedUniquePtr storage_;
 };
 
 using Image3B = Image3<uint8_t>;
@@ -959,6 +1264,14 @@ using Image3I = Image3<int32_t>;
 using Image3F = Image3<float>;
 using Image3D = Image3<double>;
 
+// Instantiated in image.cc (see Image above).
+extern template class Image3<uint8_t>;
+extern template class Image3<int16_t>;
+extern template class Image3<uint16_t>;
+extern template class Image3<int32_t>;
+extern template class Image3<float>;
+extern template class Image3<double>;
+
 // Image data for formats: Image3 for color, optional Image for alpha channel.
 template <typename ComponentType>
 class MetaImage {
@@ -1052,6 +1365,14 @@ Image3<T> CopyImage(const Image3<T>& image3) {
                    CopyImage(image3.Plane(2)));
 }
 
+template <typename T>
+void CopyImageTo(const Image3<T>& from, Image3<T>* PIK_RESTRICT to) {
+  for (int c = 0; c < 3; ++c) {
+    CopyImageTo(from.Plane(c), to->MutablePlane(c));
+  }
+  to->CheckSizesSame();
+}
+
 template <typename T>
 Image3<T> CopyImage(const Rect& rect, const Image3<T>& image3) {
   return Image3<T>(CopyImage(rect, image3.Plane(0)),
@@ -1237,6 +1558,16 @@ Image3<T> LinComb(const T lambda1, const Image3<T>& image1,
   return Image3<T>(std::move(plane0), std::move(plane1), std::move(plane2));
 }
 
+template <typename T>
+void LinComb(const T lambda1, const Image3<T>& image1, const T lambda2,
+             const Image3<T>& image2, Image3<T>* out) {
+  for (int c = 0; c < 3; ++c) {
+    LinComb(lambda1, image1.Plane(c), lambda2, image2.Plane(c),
+            out->MutablePlane(c));
+  }
+  out->CheckSizesSame();
+}
+
 template <typename T>
 Image3<T> ScaleImage(const T lambda, const Image3<T>& image) {
   return Image3<T>(ScaleImage(lambda, image.Plane(0)),
@@ -1244,6 +1575,14 @@ Image3<T> ScaleImage(const T lambda, const Image3<T>& image) {
                    ScaleImage(lambda, image.Plane(2)));
 }
 
+// In-place.
+template <typename T>
+void ScaleImage(const T lambda, Image3<T>* image) {
+  for (int c = 0; c < 3; ++c) {
+    ScaleImage(lambda, image->MutablePlane(c));
+  }
+}
+
 // Initializes all planes to the same "value".
 template <typename T>
 void FillImage(const T value, Image3<T>* image) {
@@ -1309,6 +1648,42 @@ Image3<T> Image3FromInterleaved(const T* const interleaved, const size_t xsize,
   return image3;
 }
 
+// Channel order of 8-bit interleaved pixels.
+enum class PixelLayout { kRGB, kRGBA, kBGRA };
+
+static inline size_t BytesPerPixel(const PixelLayout layout) {
+  return layout == PixelLayout::kRGB ? 3 : 4;
+}
+
+// Caller-owned 8-bit interleaved pixels, e.g. a texture or window surface.
+// Row y starts at bytes + y * bytes_per_row, which must be at least
+// xsize * BytesPerPixel(layout).
+struct InterleavedImageView {
+  uint8_t* bytes;
+  size_t xsize;
+  size_t ysize;
+  size_t bytes_per_row;
+  PixelLayout layout;
+};
+
+// Read-only counterpart of InterleavedImageView, e.g. for encoder input.
+struct ConstInterleavedImageView {
+  const uint8_t* bytes;
+  size_t xsize;
+  size_t ysize;
+  size_t bytes_per_row;
+  PixelLayout layout;
+};
+
+// Writes xsize pixels of the planar rows r/g/b (and alpha, unless the layout
+// has none) to row y of "out". "row_alpha" has "alpha_bits" (8 or 16) per
+// sample; if null, the pixels are opaque.
+void InterleaveRow(const uint8_t* PIK_RESTRICT row_r,
+                   const uint8_t* PIK_RESTRICT row_g,
+                   const uint8_t* PIK_RESTRICT row_b,
+                   const uint16_t* PIK_RESTRICT row_alpha, int alpha_bits,
+                   size_t xsize, size_t y, const InterleavedImageView& out);
+
 template <typename T>
 std::vector<std::vector<T>> Packed3FromImage3(const Image3<T>& planes) {
   std::vector<std::vector<T>> result(
@@ -19,20 +19,28 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <utility>
 #include <vector>
 
+#include <zlib.h>
+
 #include "third_party/lodepng/lodepng.h"
 #include "cache_aligned.h"
 #include "common.h"
 #include "compiler_specific.h"
 #include "gamma_correct.h"
+#include "os_specific.h"
 #include "yuv_convert.h"
 
 #define ENABLE_JPEG 0
 
+#if ENABLE_JPEG
+#include <setjmp.h>
+#endif
+
 extern "C" {
 #if ENABLE_JPEG
 #include "jpeglib.h"
@@ -73,57 +81,72 @@ class FileWrapper {
   FILE* const file_;
 };
 
+// Parses the header of a binary PGM/PPM with maxval 255. Returns the mode (5 or
+// 6) and the offset of the first pixel byte in "pos".
+bool ParsePNMHeader(const MappedFile& file, int* mode, size_t* xsize,
+                    size_t* ysize, size_t* pos) {
+  // sscanf may scan until the terminator, so only pass the header to it.
+  char header[128] = {0};
+  memcpy(header, file.data(), std::min(file.size(), sizeof(header) - 1));
+  int end = 0;
+  if (sscanf(header, "P%d %zu %zu 255%n", mode, xsize, ysize, &end) != 3 ||
+      end == 0) {
+    return false;
+  }
+  // Exactly one whitespace character precedes the pixels.
+  *pos = static_cast<size_t>(end) + 1;
+  return *pos <= file.size();
+}
+
 }  // namespace
 
 bool ReadImage(ImageFormatPNM, const std::string& pathname, ImageB* image) {
-  FileWrapper f(pathname, "rb");
-  if (f == nullptr) {
+  MappedFile file;
+  if (!file.Open(pathname)) {
     return PIK_FAILURE("File open");
   }
 
   int mode;
-  size_t xsize, ysize;
-  const int num_fields =
-      fscanf(f, "P%d\n%zu %zu\n255\n", &mode, &xsize, &ysize);
-  if (num_fields != 3) {
+  size_t xsize, ysize, pos;
+  if (!ParsePNMHeader(file, &mode, &xsize, &ysize, &pos)) {
     return PIK_FAILURE("Read header");
   }
   if (mode != 5) {
     return PIK_FAILURE("Not grayscale");
   }
+  if (file.size() - pos < xsize * ysize) {
+    return PIK_FAILURE("Truncated");
+  }
 
   *image = ImageB(xsize, ysize);
-  size_t bytes_read = 0;
   for (size_t y = 0; y < ysize; ++y) {
-    bytes_read += fread(image->Row(y), 1, xsize, f);
+    memcpy(image->Row(y), file.data() + pos + y * xsize, xsize);
   }
-  PIK_CHECK(bytes_read == xsize * ysize);
   return true;
 }
 
 bool ReadImage(ImageFormatPNM, const std::string& pathname, Image3B* image) {
-  FileWrapper f(pathname, "rb");
-  if (f == nullptr) {
+  MappedFile file;
+  if (!file.Open(pathname)) {
     return PIK_FAILURE("File open");
   }
 
   int mode;
-  size_t xsize, ysize;
-  const int num_fields =
-      fscanf(f, "P%d\n%zu %zu\n255\n", &mode, &xsize, &ysize);
-  if (num_fields != 3) {
+  size_t xsize, ysize, pos;
+  if (!ParsePNMHeader(file, &mode, &xsize, &ysize, &pos)) {
     return PIK_FAILURE("Read header");
   }
   if (mode != 6) {
     return PIK_FAILURE("Not RGB");
   }
 
+  // Deinterleaves directly from the mapping; no intermediate copy.
   const size_t bytes_per_row = xsize * 3;
-  std::vector<uint8_t> interleaved(ysize * bytes_per_row);
-  const size_t bytes_read = fread(interleaved.data(), 1, interleaved.size(), f);
-  PIK_CHECK(bytes_read == interleaved.size());
-  *image =
-      Image3FromInterleaved(interleaved.data(), xsize, ysize, bytes_per_row);
+  if (file.size() - pos < ysize * bytes_per_row) {
+    return PIK_FAILURE("Truncated");
+  }
+  *image = Image3FromInterleaved(file.data() + pos, xsize, ysize,
+                                 bytes_per_row);
   return true;
 }
 
@@ -169,6 +192,8 @@ class Y4MReader {
  public:
   explicit Y4MReader(FILE* f) : f_(f), xsize_(0), ysize_(0) {}
 
+  size_t xsize() const { return xsize_; }
+  size_t ysize() const { return ysize_; }
   int bit_depth() const { return bit_depth_; }
 
   bool ReadHeader() {
@@ -264,45 +289,65 @@ class Y4MReader {
     return true;
   }
 
-  bool ReadFrame(Image3U* yuv) {
+  // Reads the Y, U and V planes of the next frame; U and V are half the size
+  // (rounded up) if chroma_subsample().
+  bool ReadPlanes(std::array<ImageU, 3>* planes) {
     if (!ReadLine()) return false;
     if (memcmp(line_, "FRAME", 5)) {
       return PIK_FAILURE("Invalid frame header");
     }
-    std::array<ImageU, 3> planes;
-    int byte_depth = (bit_depth_ + 7) / 8;
-    int limit = (1 << bit_depth_) - 1;
+    const size_t byte_depth = (bit_depth_ + 7) / 8;
+    const uint16_t limit = (1 << bit_depth_) - 1;
     PIK_ASSERT(byte_depth == 1 || byte_depth == 2);
+    std::vector<uint8_t> bytes(xsize_ * byte_depth);
     for (int c = 0; c < 3; ++c) {
-      int pxsize = (c == 0 || !chroma_subsample_) ? xsize_ : (xsize_ + 1) / 2;
-      int pysize = (c == 0 || !chroma_subsample_) ? ysize_ : (ysize_ + 1) / 2;
-      planes[c] = ImageU(pxsize, pysize);
-      for (int y = 0; y < pysize; ++y) {
-        uint16_t* const PIK_RESTRICT row = planes[c].Row(y);
-        for (int x = 0; x < pxsize; ++x) {
-          if (byte_depth == 1) {
-            uint8_t val;
-            if (fread(&val, sizeof(val), 1, f_) != 1) return false;
-            row[x] = val;
-          } else {
-            uint16_t val;
-            if (fread(&val, sizeof(val), 1, f_) != 1) return false;
-            if (val > limit) {
+      const size_t pxsize =
+          (c == 0 || !chroma_subsample_) ? xsize_ : (xsize_ + 1) / 2;
+      const size_t pysize =
+          (c == 0 || !chroma_subsample_) ? ysize_ : (ysize_ + 1) / 2;
+      (*planes)[c] = ImageU(pxsize, pysize);
+      for (size_t y = 0; y < pysize; ++y) {
+        if (fread(bytes.data(), byte_depth, pxsize, f_) != pxsize) {
+          return PIK_FAILURE("Unexpected end of file");
+        }
+        uint16_t* const PIK_RESTRICT row = (*planes)[c].Row(y);
+        if (byte_depth == 1) {
+          for (size_t x = 0; x < pxsize; ++x) {
+            row[x] = bytes[x];
+          }
+        } else {
+          memcpy(row, bytes.data(), pxsize * sizeof(uint16_t));
+          for (size_t x = 0; x < pxsize; ++x) {
+            if (row[x] > limit) {
               return PIK_FAILURE("Value greater than indicated by bit-depth");
             }
-            row[x] = val;
           }
         }
       }
     }
+    return true;
+  }
+
+  bool ReadFrame(ThreadPool* pool, Image3U* yuv) {
+    std::array<ImageU, 3> planes;
+    if (!ReadPlanes(&planes)) return false;
     if (chroma_subsample_) {
-      *yuv = SuperSampleChroma(planes[0], planes[1], planes[2], bit_depth_);
+      *yuv = SuperSampleChroma(planes[0], planes[1], planes[2], bit_depth_,
+                               pool);
     } else {
       *yuv = Image3U(planes);
     }
     return true;
   }
 
+  bool ReadOpsinFrame(ThreadPool* pool, Image3F* opsin) {
+    std::array<ImageU, 3> planes;
+    if (!ReadPlanes(&planes)) return false;
+    *opsin = OpsinDynamicsImageFromYUVRec709(planes[0], planes[1], planes[2],
+                                             bit_depth_, pool);
+    return true;
+  }
+
  private:
   bool ReadLine() {
     int pos = 0;
@@ -325,6 +370,46 @@ class Y4MReader {
   char line_[80];
 };
 
+struct Y4MFrameReader::State {
+  explicit State(const std::string& pathname)
+      : file(pathname, "rb"), reader(file) {}
+
+  FileWrapper file;
+  Y4MReader reader;
+};
+
+Y4MFrameReader::Y4MFrameReader() {}
+Y4MFrameReader::~Y4MFrameReader() {}
+
+bool Y4MFrameReader::Open(const std::string& pathname) {
+  state_.reset(new State(pathname));
+  if (state_->file == nullptr) {
+    state_.reset();
+    return PIK_FAILURE("File open");
+  }
+  if (!state_->reader.ReadHeader()) {
+    state_.reset();
+    return false;
+  }
+  return true;
+}
+
+size_t Y4MFrameReader::xsize() const { return state_->reader.xsize(); }
+size_t Y4MFrameReader::ysize() const { return state_->reader.ysize(); }
+int Y4MFrameReader::bit_depth() const { return state_->reader.bit_depth(); }
+
+bool Y4MFrameReader::AtEnd() const {
+  FILE* f = state_->file;
+  const int c = fgetc(f);
+  if (c == EOF) return true;
+  ungetc(c, f);
+  return false;
+}
+
+bool Y4MFrameReader::ReadFrame(ThreadPool* pool, Image3U* yuv) {
+  return state_->reader.ReadFrame(pool, yuv);
+}
+
 bool ReadImage(ImageFormatY4M, const std::string& pathname, Image3B* image) {
   FileWrapper f(pathname, "rb");
   if (f == nullptr) {
@@ -337,8 +422,8 @@ bool ReadImage(ImageFormatY4M, const std::string& pathname, Image3B* image) {
   return reader.ReadFrame(image);
 }
 
-bool ReadImage(ImageFormatY4M, const std::string& pathname, Image3U* image,
-               int* bit_depth) {
+bool ReadImage(ImageFormatY4M, const std::string& pathname, ThreadPool* pool,
+               Image3U* image, int* bit_depth) {
   FileWrapper f(pathname, "rb");
   if (f == nullptr) {
     return PIK_FAILURE("File open");
@@ -348,7 +433,20 @@ bool ReadImage(ImageFormatY4M, const std::string& pathname, Image3U* image,
     return false;
   }
   *bit_depth = reader.bit_depth();
-  return reader.ReadFrame(image);
+  return reader.ReadFrame(pool, image);
+}
+
+bool ReadOpsinImage(ImageFormatY4M, const std::string& pathname,
+                    ThreadPool* pool, Image3F* opsin) {
+  FileWrapper f(pathname, "rb");
+  if (f == nullptr) {
+    return PIK_FAILURE("File open");
+  }
+  Y4MReader reader(f);
+  if (!reader.ReadHeader()) {
+    return false;
+  }
+  return reader.ReadOpsinFrame(pool, opsin);
 }
 
 bool WriteImage(ImageFormatY4M format, const ImageB& image,
@@ -395,7 +493,8 @@ bool WriteImage(ImageFormatY4M format, const Image3U& image3,
 
   std::array<ImageU, 3> subplanes;
   if (format.chroma_subsample) {
-    SubSampleChroma(image3, bit_depth, &subplanes[0], &subplanes[1],
+    ThreadPool pool(0);
+    SubSampleChroma(image3, bit_depth, &pool, &subplanes[0], &subplanes[1],
                     &subplanes[2]);
   }
 
@@ -563,14 +662,17 @@ bool ReadPNGImage(const std::string& pathname, const int bias,
 }  // namespace
 
 // Adds alpha channel to the output image only if a non-opaque pixel is present.
+// Returns false without reporting an error if the PNG has more than
+// "max_bit_depth" bits per sample.
 template <typename T>
 bool ReadPNGMetaImage(const std::string& pathname, const int bias,
-                      MetaImage<T>* image) {
+                      MetaImage<T>* image, const size_t max_bit_depth = 16) {
   PngReader reader(pathname);
   size_t xsize, ysize, num_planes, bit_depth;
   if (!reader.ReadHeader(&xsize, &ysize, &num_planes, &bit_depth)) {
     return false;
   }
+  if (bit_depth > max_bit_depth) return false;
   if (num_planes < 1 || num_planes > 4) {
     return PIK_FAILURE("Wrong #planes");
   }
@@ -749,9 +851,8 @@ bool ReadImage(ImageFormatPNG, const std::string& pathname, MetaImageU* image) {
 
 namespace {
 
-// Allocates an internal buffer for 16-bit pixels in WriteHeader => not
-// thread-safe, and cannot reuse for multiple images with different sizes.
-class PngWriter {
+// Interleaves rows of planar images into PNG samples (big-endian if 16-bit).
+class PngRowWriter {
   template <typename T>
   static size_t NumPlanes(const MetaImage<T>& image) {
     return image.HasAlpha() ? 4 : 3;
@@ -769,215 +870,427 @@ class PngWriter {
 
  public:
   template <class Image>
-  explicit PngWriter(const Image& image) {
+  explicit PngRowWriter(const Image& image) {
     using T = typename Image::T;
 
     xsize_ = image.xsize();
-    ysize_ = image.ysize();
     num_planes_ = NumPlanes(image);
     bit_depth_ = sizeof(T) * kBitsPerByte;
-    bytes_per_row_ = xsize_ * num_planes_ * sizeof(T);
-    raw_.resize(ysize_ * bytes_per_row_);
-    pos_ = raw_.data();
+    bytes_per_pixel_ = num_planes_ * sizeof(T);
+    bytes_per_row_ = xsize_ * bytes_per_pixel_;
   }
 
-  PIK_INLINE void WriteRow(const ImageB& image, const size_t y) {
-    memcpy(pos_, image.Row(y), bytes_per_row_);
+  size_t NumPlanes() const { return num_planes_; }
+  size_t BitDepth() const { return bit_depth_; }
+  size_t BytesPerPixel() const { return bytes_per_pixel_; }
+  size_t BytesPerRow() const { return bytes_per_row_; }
+
+  PIK_INLINE void WriteRow(const ImageB& image, const size_t y,
+                           uint8_t* PIK_RESTRICT pos) const {
+    memcpy(pos, image.Row(y), bytes_per_row_);
   }
 
-  PIK_INLINE void WriteRow(const Image3B& image, const size_t y) {
+  PIK_INLINE void WriteRow(const Image3B& image, const size_t y,
+                           uint8_t* PIK_RESTRICT pos) const {
     const uint8_t* PIK_RESTRICT row0 = image.ConstPlaneRow(0, y);
     const uint8_t* PIK_RESTRICT row1 = image.ConstPlaneRow(1, y);
     const uint8_t* PIK_RESTRICT row2 = image.ConstPlaneRow(2, y);
     for (size_t x = 0; x < xsize_; ++x) {
-      pos_[3 * x + 0] = row0[x];
-      pos_[3 * x + 1] = row1[x];
-      pos_[3 * x + 2] = row2[x];
+      pos[3 * x + 0] = row0[x];
+      pos[3 * x + 1] = row1[x];
+      pos[3 * x + 2] = row2[x];
     }
   }
 
-  PIK_INLINE void WriteRow(const MetaImageB& image, const size_t y) {
+  PIK_INLINE void WriteRow(const MetaImageB& image, const size_t y,
+                           uint8_t* PIK_RESTRICT pos) const {
     const uint8_t* PIK_RESTRICT row0 = image.GetColor().ConstPlaneRow(0, y);
     const uint8_t* PIK_RESTRICT row1 = image.GetColor().ConstPlaneRow(1, y);
     const uint8_t* PIK_RESTRICT row2 = image.GetColor().ConstPlaneRow(2, y);
     if (num_planes_ == 4) {
       const uint16_t* PIK_RESTRICT row_alpha = image.GetAlpha().Row(y);
       for (size_t x = 0; x < xsize_; ++x) {
-        pos_[4 * x + 0] = row0[x];
-        pos_[4 * x + 1] = row1[x];
-        pos_[4 * x + 2] = row2[x];
-        pos_[4 * x + 3] = row_alpha[x] & 255;
+        pos[4 * x + 0] = row0[x];
+        pos[4 * x + 1] = row1[x];
+        pos[4 * x + 2] = row2[x];
+        pos[4 * x + 3] = row_alpha[x] & 255;
       }
     } else {
       for (size_t x = 0; x < xsize_; ++x) {
-        pos_[3 * x + 0] = row0[x];
-        pos_[3 * x + 1] = row1[x];
-        pos_[3 * x + 2] = row2[x];
+        pos[3 * x + 0] = row0[x];
+        pos[3 * x + 1] = row1[x];
+        pos[3 * x + 2] = row2[x];
       }
     }
   }
 
-  void WriteRow(const ImageS& image, const size_t y) {
+  void WriteRow(const ImageS& image, const size_t y,
+                uint8_t* PIK_RESTRICT pos) const {
     const int16_t* PIK_RESTRICT row = image.ConstRow(y);
     for (size_t x = 0; x < xsize_; ++x) {
-      StoreUnsignedBigEndian(row[x], pos_ + 2 * x);
+      StoreUnsignedBigEndian(row[x], pos + 2 * x);
     }
   }
 
-  void WriteRow(const Image3S& image, const size_t y) {
+  void WriteRow(const Image3S& image, const size_t y,
+                uint8_t* PIK_RESTRICT pos) const {
     const int16_t* PIK_RESTRICT row0 = image.ConstPlaneRow(0, y);
     const int16_t* PIK_RESTRICT row1 = image.ConstPlaneRow(1, y);
     const int16_t* PIK_RESTRICT row2 = image.ConstPlaneRow(2, y);
     for (size_t x = 0; x < xsize_; ++x) {
-      StoreUnsignedBigEndian(row0[x], pos_ + 6 * x + 0);
-      StoreUnsignedBigEndian(row1[x], pos_ + 6 * x + 2);
-      StoreUnsignedBigEndian(row2[x], pos_ + 6 * x + 4);
+      StoreUnsignedBigEndian(row0[x], pos + 6 * x + 0);
+      StoreUnsignedBigEndian(row1[x], pos + 6 * x + 2);
+      StoreUnsignedBigEndian(row2[x], pos + 6 * x + 4);
     }
   }
 
-  void WriteRow(const MetaImageS& image, const size_t y) {
+  void WriteRow(const MetaImageS& image, const size_t y,
+                uint8_t* PIK_RESTRICT pos) const {
     const int16_t* PIK_RESTRICT row0 = image.GetColor().ConstPlaneRow(0, y);
     const int16_t* PIK_RESTRICT row1 = image.GetColor().ConstPlaneRow(1, y);
     const int16_t* PIK_RESTRICT row2 = image.GetColor().ConstPlaneRow(2, y);
     if (num_planes_ == 4) {
       const uint16_t* PIK_RESTRICT row_alpha = image.GetAlpha().Row(y);
       for (size_t x = 0; x < xsize_; ++x) {
-        StoreUnsignedBigEndian(row0[x], pos_ + 8 * x + 0);
-        StoreUnsignedBigEndian(row1[x], pos_ + 8 * x + 2);
-        StoreUnsignedBigEndian(row2[x], pos_ + 8 * x + 4);
-        StoreUnsignedBigEndian(row_alpha[x], pos_ + 8 * x + 6);
+        StoreUnsignedBigEndian(row0[x], pos + 8 * x + 0);
+        StoreUnsignedBigEndian(row1[x], pos + 8 * x + 2);
+        StoreUnsignedBigEndian(row2[x], pos + 8 * x + 4);
+        StoreUnsignedBigEndian(row_alpha[x], pos + 8 * x + 6);
       }
     } else {
       for (size_t x = 0; x < xsize_; ++x) {
-        StoreUnsignedBigEndian(row0[x], pos_ + 6 * x + 0);
-        StoreUnsignedBigEndian(row1[x], pos_ + 6 * x + 2);
-        StoreUnsignedBigEndian(row2[x], pos_ + 6 * x + 4);
+        StoreUnsignedBigEndian(row0[x], pos + 6 * x + 0);
+        StoreUnsignedBigEndian(row1[x], pos + 6 * x + 2);
+        StoreUnsignedBigEndian(row2[x], pos + 6 * x + 4);
       }
     }
   }
 
-  void WriteRow(const ImageU& image, const size_t y) {
+  void WriteRow(const ImageU& image, const size_t y,
+                uint8_t* PIK_RESTRICT pos) const {
     const uint16_t* PIK_RESTRICT row = image.ConstRow(y);
     for (size_t x = 0; x < xsize_; ++x) {
-      StoreUnsignedBigEndian(row[x], pos_ + 2 * x);
+      StoreUnsignedBigEndian(row[x], pos + 2 * x);
     }
   }
 
-  void WriteRow(const Image3U& image, const size_t y) {
+  void WriteRow(const Image3U& image, const size_t y,
+                uint8_t* PIK_RESTRICT pos) const {
     const uint16_t* PIK_RESTRICT row0 = image.ConstPlaneRow(0, y);
     const uint16_t* PIK_RESTRICT row1 = image.ConstPlaneRow(1, y);
     const uint16_t* PIK_RESTRICT row2 = image.ConstPlaneRow(2, y);
     for (size_t x = 0; x < xsize_; ++x) {
-      StoreUnsignedBigEndian(row0[x], pos_ + 6 * x + 0);
-      StoreUnsignedBigEndian(row1[x], pos_ + 6 * x + 2);
-      StoreUnsignedBigEndian(row2[x], pos_ + 6 * x + 4);
+      StoreUnsignedBigEndian(row0[x], pos + 6 * x + 0);
+      StoreUnsignedBigEndian(row1[x], pos + 6 * x + 2);
+      StoreUnsignedBigEndian(row2[x], pos + 6 * x + 4);
     }
   }
 
-  void WriteRow(const MetaImageU& image, const size_t y) {
+  void WriteRow(const MetaImageU& image, const size_t y,
+                uint8_t* PIK_RESTRICT pos) const {
     const uint16_t* PIK_RESTRICT row0 = image.GetColor().ConstPlaneRow(0, y);
     const uint16_t* PIK_RESTRICT row1 = image.GetColor().ConstPlaneRow(1, y);
     const uint16_t* PIK_RESTRICT row2 = image.GetColor().ConstPlaneRow(2, y);
     if (num_planes_ == 4) {
       const uint16_t* PIK_RESTRICT row_alpha = image.GetAlpha().Row(y);
       for (size_t x = 0; x < xsize_; ++x) {
-        StoreUnsignedBigEndian(row0[x], pos_ + 8 * x + 0);
-        StoreUnsignedBigEndian(row1[x], pos_ + 8 * x + 2);
-        StoreUnsignedBigEndian(row2[x], pos_ + 8 * x + 4);
-        StoreUnsignedBigEndian(row_alpha[x], pos_ + 8 * x + 6);
+        StoreUnsignedBigEndian(row0[x], pos + 8 * x + 0);
+        StoreUnsignedBigEndian(row1[x], pos + 8 * x + 2);
+        StoreUnsignedBigEndian(row2[x], pos + 8 * x + 4);
+        StoreUnsignedBigEndian(row_alpha[x], pos + 8 * x + 6);
       }
     } else {
       for (size_t x = 0; x < xsize_; ++x) {
-        StoreUnsignedBigEndian(row0[x], pos_ + 6 * x + 0);
-        StoreUnsignedBigEndian(row1[x], pos_ + 6 * x + 2);
-        StoreUnsignedBigEndian(row2[x], pos_ + 6 * x + 4);
+        StoreUnsignedBigEndian(row0[x], pos + 6 * x + 0);
+        StoreUnsignedBigEndian(row1[x], pos + 6 * x + 2);
+        StoreUnsignedBigEndian(row2[x], pos + 6 * x + 4);
       }
     }
   }
 
-  void NextRow() { pos_ += bytes_per_row_; }
-
-  bool WriteEnd(const std::string& pathname) {
-    PIK_CHECK(pos_ == raw_.data() + raw_.size());
-    if (lodepng::encode(pathname, raw_.data(), xsize_, ysize_,
-                        PNGTypeFromNumPlanes(num_planes_), bit_depth_) != 0) {
-      return PIK_FAILURE("Failed to encode/write PNG");
-    }
-    return true;
-  }
-
  private:
-  void StoreUnsignedBigEndian(const int16_t value, uint8_t* bytes) {
+  static void StoreUnsignedBigEndian(const int16_t value, uint8_t* bytes) {
     const unsigned unsigned_value = value + 0x8000;  // [0, 0x10000)
     bytes[0] = unsigned_value >> 8;
     bytes[1] = unsigned_value & 0xFF;
   }
 
-  void StoreUnsignedBigEndian(const uint16_t unsigned_value, uint8_t* bytes) {
+  static void StoreUnsignedBigEndian(const uint16_t unsigned_value,
+                                     uint8_t* bytes) {
     bytes[0] = unsigned_value >> 8;
     bytes[1] = unsigned_value & 0xFF;
   }
 
   size_t xsize_;
-  size_t ysize_;
   size_t num_planes_;
   size_t bit_depth_;
+  size_t bytes_per_pixel_;
   size_t bytes_per_row_;
+};
+
 
-  std::vector<uint8_t> raw_;
-  uint8_t* pos_;
+PIK_INLINE uint8_t PaethPredictor(const uint8_t a, const uint8_t b,
+                                  const uint8_t c) {
+  const int p = a + b - c;
+  const int pa = std::abs(p - a);
+  const int pb = std::abs(p - b);
+  const int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return a;
+  return (pb <= pc) ? b : c;
+}
+
+// Writes the filter type byte and the filtered row "cur" to "out" (size
+// 1 + num_bytes). Chooses the filter with the minimum sum of absolute
+// residuals (interpreted as signed), as recommended by the PNG specification.
+// "prev" is the unfiltered previous row, or all-zero for the first row.
+// "candidates" is scratch space for 5 filtered rows.
+void FilterRow(const uint8_t* PIK_RESTRICT prev,
+               const uint8_t* PIK_RESTRICT cur, const size_t num_bytes,
+               const size_t bpp, uint8_t* PIK_RESTRICT candidates,
+               uint8_t* PIK_RESTRICT out) {
+  uint8_t* PIK_RESTRICT none = candidates + 0 * num_bytes;
+  uint8_t* PIK_RESTRICT sub = candidates + 1 * num_bytes;
+  uint8_t* PIK_RESTRICT up = candidates + 2 * num_bytes;
+  uint8_t* PIK_RESTRICT average = candidates + 3 * num_bytes;
+  uint8_t* PIK_RESTRICT paeth = candidates + 4 * num_bytes;
+  // The first pixel has no left neighbor (treated as zero).
+  for (size_t i = 0; i < bpp; ++i) {
+    none[i] = cur[i];
+    sub[i] = cur[i];
+    up[i] = cur[i] - prev[i];
+    average[i] = cur[i] - (prev[i] >> 1);
+    paeth[i] = cur[i] - prev[i];
+  }
+  // Separate loops are easier to vectorize.
+  memcpy(none + bpp, cur + bpp, num_bytes - bpp);
+  for (size_t i = bpp; i < num_bytes; ++i) {
+    sub[i] = cur[i] - cur[i - bpp];
+  }
+  for (size_t i = bpp; i < num_bytes; ++i) {
+    up[i] = cur[i] - prev[i];
+  }
+  for (size_t i = bpp; i < num_bytes; ++i) {
+    average[i] = cur[i] - ((cur[i - bpp] + prev[i]) >> 1);
+  }
+  for (size_t i = bpp; i < num_bytes; ++i) {
+    paeth[i] = cur[i] - PaethPredictor(cur[i - bpp], prev[i], prev[i - bpp]);
+  }
+
+  size_t best_sum = ~size_t(0);
+  size_t best_type = 0;
+  for (size_t type = 0; type < 5; ++type) {
+    const uint8_t* PIK_RESTRICT filtered = candidates + type * num_bytes;
+    size_t sum = 0;
+    for (size_t i = 0; i < num_bytes; ++i) {
+      sum += std::abs(static_cast<int8_t>(filtered[i]));
+    }
+    if (sum < best_sum) {
+      best_sum = sum;
+      best_type = type;
+    }
+  }
+  out[0] = best_type;
+  memcpy(out + 1, candidates + best_type * num_bytes, num_bytes);
+}
+
+// Filtered and compressed rows [y0, y1) of a PNG image.
+struct PngBand {
+  std::vector<uint8_t> deflated;  // Raw deflate blocks.
+  uLong adler;                    // Of the filtered rows.
+  size_t filtered_size;
 };
 
+// Bands are compressed independently (without a shared dictionary) so that
+// they can run in parallel; all but the last end with a sync flush, so their
+// concatenation is a single valid deflate stream.
+template <class Image>
+bool CompressPngBand(const Image& image, const PngRowWriter& writer,
+                     const size_t y0, const size_t y1, const int level,
+                     PngBand* band) {
+  const size_t num_bytes = writer.BytesPerRow();
+  const size_t bpp = writer.BytesPerPixel();
+  // Unfiltered previous/current row, 5 filter candidates, filtered output.
+  std::vector<uint8_t> buffer(8 * num_bytes + 1);
+  uint8_t* prev = buffer.data();
+  uint8_t* cur = prev + num_bytes;
+  uint8_t* candidates = cur + num_bytes;
+  uint8_t* filtered = candidates + 5 * num_bytes;
+  if (y0 != 0) writer.WriteRow(image, y0 - 1, prev);
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return PIK_FAILURE("deflateInit2 failed");
+  }
+  band->filtered_size = (y1 - y0) * (num_bytes + 1);
+  // Plus space for the sync flush.
+  band->deflated.resize(deflateBound(&stream, band->filtered_size) + 64);
+  stream.next_out = band->deflated.data();
+  stream.avail_out = band->deflated.size();
+  band->adler = adler32(0, nullptr, 0);
+
+  bool ok = true;
+  for (size_t y = y0; y < y1 && ok; ++y) {
+    writer.WriteRow(image, y, cur);
+    FilterRow(prev, cur, num_bytes, bpp, candidates, filtered);
+    band->adler = adler32(band->adler, filtered, num_bytes + 1);
+    stream.next_in = filtered;
+    stream.avail_in = num_bytes + 1;
+    ok = deflate(&stream, Z_NO_FLUSH) == Z_OK && stream.avail_in == 0;
+    std::swap(prev, cur);
+  }
+  const bool is_last = y1 == image.ysize();
+  if (ok) {
+    const int ret = deflate(&stream, is_last ? Z_FINISH : Z_SYNC_FLUSH);
+    ok = ret == (is_last ? Z_STREAM_END : Z_OK);
+  }
+  band->deflated.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (!ok) return PIK_FAILURE("deflate failed");
+  return true;
+}
+
+void StoreBigEndian32(const uint32_t value, uint8_t* bytes) {
+  bytes[0] = value >> 24;
+  bytes[1] = (value >> 16) & 0xFF;
+  bytes[2] = (value >> 8) & 0xFF;
+  bytes[3] = value & 0xFF;
+}
+
+bool WritePngChunk(FILE* f, const char* type, const uint8_t* data,
+                   const size_t size) {
+  uint8_t header[8];
+  StoreBigEndian32(size, header);
+  memcpy(header + 4, type, 4);
+  uLong crc = crc32(0, header + 4, 4);
+  // crc32 would return its initial value if data is null.
+  if (size != 0) crc = crc32(crc, data, size);
+  uint8_t footer[4];
+  StoreBigEndian32(crc, footer);
+  return fwrite(header, 1, 8, f) == 8 && fwrite(data, 1, size, f) == size &&
+         fwrite(footer, 1, 4, f) == 4;
+}
+
+// Filters and deflates bands of rows in parallel, directly from the planar
+// "image" (only two rows per band are ever interleaved at a time).
 template <class Image>
-bool WritePNGImage(const Image& image, const std::string& pathname) {
-  PngWriter png(image);
-  for (size_t y = 0; y < image.ysize(); ++y) {
-    png.WriteRow(image, y);
-    png.NextRow();
+bool WritePNGImage(const ImageFormatPNG& format, const Image& image,
+                   const std::string& pathname) {
+  PIK_CHECK(0 <= format.compression_level && format.compression_level <= 9);
+  const PngRowWriter writer(image);
+  const size_t xsize = image.xsize();
+  const size_t ysize = image.ysize();
+  if (xsize == 0 || ysize == 0) return PIK_FAILURE("Empty PNG");
+
+  // Large enough that independent bands hardly affect the compression ratio.
+  const size_t rows_per_band =
+      std::max<size_t>(16, (size_t(1) << 20) / writer.BytesPerRow());
+  const size_t num_bands = DivCeil(ysize, rows_per_band);
+  std::vector<PngBand> bands(num_bands);
+  std::atomic<int> num_errors{0};
+  ThreadPool serial(0);
+  ThreadPool* pool = format.pool != nullptr ? format.pool : &serial;
+  pool->Run(0, num_bands, [&](const int task, const int thread) {
+    const size_t y0 = task * rows_per_band;
+    const size_t y1 = std::min(y0 + rows_per_band, ysize);
+    if (!CompressPngBand(image, writer, y0, y1, format.compression_level,
+                         &bands[task])) {
+      num_errors.fetch_add(1);
+    }
+  });
+  if (num_errors.load() != 0) return false;
+
+  FileWrapper f(pathname, "wb");
+  if (f == nullptr) return PIK_FAILURE("Failed to open PNG for writing");
+  static const uint8_t kSignature[8] = {0x89, 'P',  'N',  'G',
+                                        '\r', '\n', 0x1A, '\n'};
+  if (fwrite(kSignature, 1, 8, f) != 8) return PIK_FAILURE("Write PNG");
+
+  uint8_t ihdr[13];
+  StoreBigEndian32(xsize, ihdr + 0);
+  StoreBigEndian32(ysize, ihdr + 4);
+  ihdr[8] = writer.BitDepth();
+  static const uint8_t kColorTypes[5] = {0, 0, 4, 2, 6};  // by NumPlanes
+  ihdr[9] = kColorTypes[writer.NumPlanes()];
+  ihdr[10] = 0;  // Deflate
+  ihdr[11] = 0;  // Adaptive filtering
+  ihdr[12] = 0;  // No interlacing
+  if (!WritePngChunk(f, "IHDR", ihdr, sizeof(ihdr))) {
+    return PIK_FAILURE("Write PNG");
+  }
+
+  // zlib header with FLEVEL derived from the compression level.
+  const int level = format.compression_level;
+  const uint8_t flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+  uint8_t zlib_header[2] = {0x78, static_cast<uint8_t>(flevel << 6)};
+  zlib_header[1] += 31 - (zlib_header[0] * 256 + zlib_header[1]) % 31;
+  if (!WritePngChunk(f, "IDAT", zlib_header, sizeof(zlib_header))) {
+    return PIK_FAILURE("Write PNG");
+  }
+  uLong adler = bands[0].adler;
+  for (size_t i = 0; i < num_bands; ++i) {
+    if (i != 0) {
+      adler = adler32_combine(adler, bands[i].adler, bands[i].filtered_size);
+    }
+    // Chunk lengths must be less than 2^31.
+    const std::vector<uint8_t>& deflated = bands[i].deflated;
+    for (size_t pos = 0; pos < deflated.size(); pos += 1u << 30) {
+      const size_t size = std::min<size_t>(deflated.size() - pos, 1u << 30);
+      if (!WritePngChunk(f, "IDAT", deflated.data() + pos, size)) {
+        return PIK_FAILURE("Write PNG");
+      }
+    }
+  }
+  uint8_t adler_bytes[4];
+  StoreBigEndian32(adler, adler_bytes);
+  if (!WritePngChunk(f, "IDAT", adler_bytes, sizeof(adler_bytes)) ||
+      !WritePngChunk(f, "IEND", nullptr, 0)) {
+    return PIK_FAILURE("Write PNG");
   }
-  return png.WriteEnd(pathname);
+  return true;
 }
 
 }  // namespace
 
-bool WriteImage(ImageFormatPNG, const ImageB& image,
+bool WriteImage(ImageFormatPNG format, const ImageB& image,
                 const std::string& pathname) {
-  return WritePNGImage(image, pathname);
+  return WritePNGImage(format, image, pathname);
 }
 
-bool WriteImage(ImageFormatPNG, const ImageS& image,
+bool WriteImage(ImageFormatPNG format, const ImageS& image,
                 const std::string& pathname) {
-  return WritePNGImage(image, pathname);
+  return WritePNGImage(format, image, pathname);
 }
 
-bool WriteImage(ImageFormatPNG, const ImageU& image,
+bool WriteImage(ImageFormatPNG format, const ImageU& image,
                 const std::string& pathname) {
-  return WritePNGImage(image, pathname);
+  return WritePNGImage(format, image, pathname);
 }
 
-bool WriteImage(ImageFormatPNG, const Image3B& image3,
+bool WriteImage(ImageFormatPNG format, const Image3B& image3,
                 const std::string& pathname) {
-  return WritePNGImage(image3, pathname);
+  return WritePNGImage(format, image3, pathname);
 }
 
-bool WriteImage(ImageFormatPNG, const Image3S& image3,
+bool WriteImage(ImageFormatPNG format, const Image3S& image3,
                 const std::string& pathname) {
-  return WritePNGImage(image3, pathname);
+  return WritePNGImage(format, image3, pathname);
 }
 
-bool WriteImage(ImageFormatPNG, const Image3U& image3,
+bool WriteImage(ImageFormatPNG format, const Image3U& image3,
                 const std::string& pathname) {
-  return WritePNGImage(image3, pathname);
+  return WritePNGImage(format, image3, pathname);
 }
 
-bool WriteImage(ImageFormatPNG, const MetaImageB& image,
+bool WriteImage(ImageFormatPNG format, const MetaImageB& image,
                 const std::string& pathname) {
-  return WritePNGImage(image, pathname);
+  return WritePNGImage(format, image, pathname);
 }
 
-bool WriteImage(ImageFormatPNG, const MetaImageU& image,
+bool WriteImage(ImageFormatPNG format, const MetaImageU& image,
                 const std::string& pathname) {
-  return WritePNGImage(image, pathname);
+  return WritePNGImage(format, image, pathname);
 }
 
 #if ENABLE_JPEG
@@ -998,7 +1311,12 @@ struct JpegInput {
   size_t insize = 0;
 };
 
-bool ReadJpegImage(const JpegInput& input, Image3B* rgb) {
+bool ReadJpegImage(const JpegInput& input, const size_t scale_denom,
+                   Image3B* rgb) {
+  if (scale_denom != 1 && scale_denom != 2 && scale_denom != 4 &&
+      scale_denom != 8) {
+    return PIK_FAILURE("Unsupported JPEG scale");
+  }
   std::unique_ptr<FileWrapper> input_file;
   if (!input.filename.empty()) {
     input_file.reset(new FileWrapper(input.filename, "rb"));
@@ -1032,6 +1350,9 @@ bool ReadJpegImage(const JpegInput& input, Image3B* rgb) {
   }
 
   jpeg_read_header(&cinfo, TRUE);
+  // Reduced-size IDCT, see ImageFormatJPG.
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = scale_denom;
   jpeg_start_decompress(&cinfo);
 
   const size_t xsize = cinfo.output_width;
@@ -1094,19 +1415,21 @@ bool ReadJpegImage(const JpegInput& input, Image3B* rgb) {
 
 #endif  // #if ENABLE_JPEG
 
-bool ReadImage(ImageFormatJPG, const std::string& pathname, Image3B* rgb) {
+bool ReadImage(ImageFormatJPG format, const std::string& pathname,
+               Image3B* rgb) {
 #if ENABLE_JPEG
   JpegInput input(pathname);
-  return ReadJpegImage(input, rgb);
+  return ReadJpegImage(input, format.scale_denom, rgb);
 #else
   return PIK_FAILURE("Support for reading JPEG is disabled");
 #endif
 }
 
-bool ReadImage(ImageFormatJPG, const uint8_t* buf, size_t size, Image3B* rgb) {
+bool ReadImage(ImageFormatJPG format, const uint8_t* buf, size_t size,
+               Image3B* rgb) {
 #if ENABLE_JPEG
   JpegInput input(buf, size);
-  return ReadJpegImage(input, rgb);
+  return ReadJpegImage(input, format.scale_denom, rgb);
 #else
   return PIK_FAILURE("Support for reading JPEG is disabled");
 #endif
@@ -1180,8 +1503,9 @@ class LinearLoader {
 
   // From YUV bytes
   void ConvertToLinearRGB(ImageFormatY4M, const Image3B& bytes) {
+    ThreadPool pool(0);
     linear_rgb_->SetColor(RGBLinearImageFromYUVRec709(
-        StaticCastImage3<uint8_t, uint16_t>(bytes), 8));
+        StaticCastImage3<uint8_t, uint16_t>(bytes), 8, &pool));
   }
 
   // From 16-bit sRGB
@@ -1268,6 +1592,280 @@ MetaImageF ReadMetaImageLinear(const std::string& pathname) {
   return linear_rgb;
 }
 
+// Returns true if the given file was loaded as 8-bit sRGB. Called via
+// VisitFormats, see LinearLoader.
+class Srgb8Loader {
+ public:
+  Srgb8Loader(const std::string& pathname, const size_t jpeg_scale_denom,
+              MetaImageB* srgb)
+      : pathname_(pathname), jpeg_scale_denom_(jpeg_scale_denom), srgb_(srgb) {}
+
+  template <class Format>
+  bool operator()(const Format format) {
+    if (!Format::IsExtension(pathname_.c_str())) {
+      return false;
+    }
+    return Load(format);
+  }
+
+ private:
+  template <class Format>
+  bool Load(Format format) {
+    Image3B bytes;
+    if (!ReadImage(format, pathname_, &bytes)) {
+      return false;
+    }
+    srgb_->SetColor(std::move(bytes));
+    return true;
+  }
+
+  // 16-bit PNGs would lose precision.
+  bool Load(ImageFormatPNG) {
+    return ReadPNGMetaImage(pathname_, 0, srgb_, /*max_bit_depth=*/8);
+  }
+
+  // YUV requires a color transform.
+  bool Load(ImageFormatY4M) { return false; }
+
+  bool Load(ImageFormatJPG) {
+    Image3B bytes;
+    if (!ReadImage(ImageFormatJPG(jpeg_scale_denom_), pathname_, &bytes)) {
+      return false;
+    }
+    srgb_->SetColor(std::move(bytes));
+    return true;
+  }
+
+  const std::string pathname_;
+  const size_t jpeg_scale_denom_;
+  MetaImageB* srgb_;
+};
+
+bool ReadMetaImageSrgb8(const std::string& pathname, MetaImageB* srgb,
+                        const size_t jpeg_scale_denom) {
+  // Only formats matching the extension; the caller falls back to
+  // ReadMetaImageLinear, which also tries the others.
+  Srgb8Loader loader(pathname, jpeg_scale_denom, srgb);
+  return VisitFormats(&loader);
+}
+
+namespace {
+
+constexpr uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                      '\n'};
+
+uint32_t LoadBigEndian32(const uint8_t* bytes) {
+  return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) |
+         (uint32_t(bytes[2]) << 8) | bytes[3];
+}
+
+// Reverses the PNG filter of one row in-place; "prev" is the previous
+// unfiltered row (all-zero for the first).
+bool UnfilterRow(const uint8_t type, const uint8_t* PIK_RESTRICT prev,
+                 const size_t num_bytes, const size_t bpp,
+                 uint8_t* PIK_RESTRICT row) {
+  switch (type) {
+    case 0:
+      return true;
+    case 1:
+      for (size_t i = bpp; i < num_bytes; ++i) row[i] += row[i - bpp];
+      return true;
+    case 2:
+      for (size_t i = 0; i < num_bytes; ++i) row[i] += prev[i];
+      return true;
+    case 3:
+      for (size_t i = 0; i < bpp; ++i) row[i] += prev[i] >> 1;
+      for (size_t i = bpp; i < num_bytes; ++i) {
+        row[i] += (row[i - bpp] + prev[i]) >> 1;
+      }
+      return true;
+    case 4:
+      for (size_t i = 0; i < bpp; ++i) row[i] += prev[i];
+      for (size_t i = bpp; i < num_bytes; ++i) {
+        row[i] += PaethPredictor(row[i - bpp], prev[i], prev[i - bpp]);
+      }
+      return true;
+  }
+  return PIK_FAILURE("Invalid PNG filter type");
+}
+
+}  // namespace
+
+struct Srgb8RowReader::State {
+  ~State() {
+    if (is_png) inflateEnd(&stream);
+  }
+
+  // Advances to the next IDAT chunk and passes it to the inflater.
+  bool NextIDAT() {
+    while (pos + 12 <= file.size()) {
+      const uint32_t size = LoadBigEndian32(file.data() + pos);
+      const uint8_t* type = file.data() + pos + 4;
+      if (size > file.size() - pos - 12) break;
+      pos += 12 + size;
+      if (memcmp(type, "IDAT", 4) == 0) {
+        stream.next_in = const_cast<uint8_t*>(type + 4);
+        stream.avail_in = size;
+        return true;
+      }
+      if (memcmp(type, "IEND", 4) == 0) break;
+    }
+    return PIK_FAILURE("Truncated PNG");
+  }
+
+  // Inflates the next filter byte and row into "cur" and unfilters it.
+  bool InflateRow() {
+    stream.next_out = cur.data();
+    stream.avail_out = cur.size();
+    while (stream.avail_out != 0) {
+      if (stream.avail_in == 0 && !NextIDAT()) return false;
+      const int ret = inflate(&stream, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END && stream.avail_out != 0) {
+        return PIK_FAILURE("PNG data ends early");
+      }
+      if (ret != Z_OK && ret != Z_STREAM_END) {
+        return PIK_FAILURE("Corrupt PNG data");
+      }
+    }
+    const size_t num_bytes = cur.size() - 1;
+    if (!UnfilterRow(cur[0], prev.data() + 1, num_bytes, bytes_per_pixel,
+                     cur.data() + 1)) {
+      return false;
+    }
+    prev.swap(cur);
+    return true;
+  }
+
+  bool OpenPNM() {
+    int mode;
+    if (!ParsePNMHeader(file, &mode, &xsize, &ysize, &pos)) return false;
+    if (mode != 5 && mode != 6) return false;
+    bytes_per_pixel = mode == 6 ? 3 : 1;
+    return file.size() - pos >= xsize * ysize * bytes_per_pixel;
+  }
+
+  bool OpenPNG() {
+    if (file.size() < 33 || memcmp(file.data(), kPngSignature, 8) != 0 ||
+        memcmp(file.data() + 12, "IHDR", 4) != 0) {
+      return false;
+    }
+    const uint8_t* ihdr = file.data() + 16;
+    xsize = LoadBigEndian32(ihdr);
+    ysize = LoadBigEndian32(ihdr + 4);
+    const uint8_t bit_depth = ihdr[8];
+    const uint8_t color_type = ihdr[9];
+    const uint8_t interlace = ihdr[12];
+    // Gray, RGB or palette; no alpha, 16-bit or interlacing.
+    if (bit_depth != 8 || interlace != 0 ||
+        (color_type != 0 && color_type != 2 && color_type != 3)) {
+      return false;
+    }
+    bytes_per_pixel = color_type == 2 ? 3 : 1;
+
+    // Find the palette (if any) and reject transparency; stop at IDAT.
+    pos = 33;
+    while (pos + 12 <= file.size()) {
+      const uint32_t size = LoadBigEndian32(file.data() + pos);
+      const uint8_t* type = file.data() + pos + 4;
+      if (size > file.size() - pos - 12) return false;
+      if (memcmp(type, "IDAT", 4) == 0) break;
+      if (memcmp(type, "tRNS", 4) == 0) return false;
+      if (memcmp(type, "PLTE", 4) == 0) {
+        if (size % 3 != 0 || size > 3 * 256) return false;
+        palette.assign(3 * 256, 0);
+        memcpy(palette.data(), type + 4, size);
+      }
+      pos += 12 + size;
+    }
+    if (color_type == 3 && palette.empty()) return false;
+
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK) return false;
+    is_png = true;
+    prev.assign(1 + xsize * bytes_per_pixel, 0);
+    cur.resize(prev.size());
+    return true;
+  }
+
+  MappedFile file;
+  size_t xsize = 0;
+  size_t ysize = 0;
+  size_t next_row = 0;
+  size_t bytes_per_pixel = 0;  // In the file: 1 (gray/palette) or 3.
+  size_t pos = 0;  // PNM: next pixel. PNG: next chunk.
+
+  // PNG only
+  bool is_png = false;
+  z_stream stream;
+  std::vector<uint8_t> palette;  // 256 RGB entries, or empty.
+  // Filter type followed by the previous/current row.
+  std::vector<uint8_t> prev;
+  std::vector<uint8_t> cur;
+};
+
+Srgb8RowReader::Srgb8RowReader() {}
+Srgb8RowReader::~Srgb8RowReader() {}
+
+bool Srgb8RowReader::Open(const std::string& pathname) {
+  state_.reset(new State);
+  if (!state_->file.Open(pathname) ||
+      !(state_->OpenPNG() || state_->OpenPNM()) || state_->xsize == 0 ||
+      state_->ysize == 0) {
+    state_.reset();
+    return false;
+  }
+  return true;
+}
+
+size_t Srgb8RowReader::xsize() const { return state_->xsize; }
+size_t Srgb8RowReader::ysize() const { return state_->ysize; }
+size_t Srgb8RowReader::RemainingRows() const {
+  return state_->ysize - state_->next_row;
+}
+
+bool Srgb8RowReader::ReadRows(const size_t max_rows, Image3B* rows) {
+  State& state = *state_;
+  const size_t xsize = state.xsize;
+  const size_t num_rows = std::min(max_rows, RemainingRows());
+  if (rows->xsize() != xsize || rows->ysize() != num_rows) {
+    *rows = Image3B(xsize, num_rows);
+  }
+  const size_t bpp = state.bytes_per_pixel;
+  for (size_t y = 0; y < num_rows; ++y) {
+    const uint8_t* PIK_RESTRICT in;
+    if (state.is_png) {
+      if (!state.InflateRow()) return false;
+      in = state.prev.data() + 1;  // The row just unfiltered.
+    } else {
+      in = state.file.data() + state.pos;
+      state.pos += xsize * bpp;
+    }
+    uint8_t* PIK_RESTRICT row_r = rows->PlaneRow(0, y);
+    uint8_t* PIK_RESTRICT row_g = rows->PlaneRow(1, y);
+    uint8_t* PIK_RESTRICT row_b = rows->PlaneRow(2, y);
+    if (!state.palette.empty()) {
+      for (size_t x = 0; x < xsize; ++x) {
+        const uint8_t* PIK_RESTRICT rgb = &state.palette[3 * in[x]];
+        row_r[x] = rgb[0];
+        row_g[x] = rgb[1];
+        row_b[x] = rgb[2];
+      }
+    } else if (bpp == 3) {
+      for (size_t x = 0; x < xsize; ++x) {
+        row_r[x] = in[3 * x + 0];
+        row_g[x] = in[3 * x + 1];
+        row_b[x] = in[3 * x + 2];
+      }
+    } else {
+      memcpy(row_r, in, xsize);
+      memcpy(row_g, in, xsize);
+      memcpy(row_b, in, xsize);
+    }
+  }
+  state.next_row += num_rows;
+  return true;
+}
+
 Image3F ReadImage3Linear(const std::string& pathname) {
   MetaImageF meta = ReadMetaImageLinear(pathname);
   if (meta.HasAlpha()) {
@@ -19,11 +19,13 @@
 
 // Read/write Image or Image3.
 
+#include <memory>
 #include <string>
 #include <utility>  // std::move
 #include <vector>
 
 #include "arch_specific.h"
+#include "data_parallel.h"
 #include "image.h"
 #include "status.h"
 
@@ -42,9 +44,16 @@ struct ImageFormatPNM {
 
 // Gray, RGB, RGBA.
 struct ImageFormatPNG {
+  ImageFormatPNG() {}
+  // "level" is the zlib compression level (0-9) for writing. If "pool" is
+  // non-null, bands of rows are filtered and compressed in parallel.
+  ImageFormatPNG(int level, ThreadPool* pool)
+      : compression_level(level), pool(pool) {}
   static const char* Name() { return "PNG"; }
   static bool IsExtension(const char* filename);
   using NativeImage3 = MetaImageU;
+  const int compression_level = 6;
+  ThreadPool* const pool = nullptr;
 };
 
 struct ImageFormatY4M {
@@ -60,9 +69,15 @@ struct ImageFormatY4M {
 
 // Loads RGB (possibly expanded from gray).
 struct ImageFormatJPG {
+  ImageFormatJPG() {}
+  // Decodes at 1/scale_denom (1, 2, 4 or 8) of the original size, rounded up.
+  // libjpeg then applies a reduced IDCT, which is much cheaper than decoding
+  // at full size and resampling.
+  explicit ImageFormatJPG(size_t denom) : scale_denom(denom) {}
   static const char* Name() { return "JPG"; }
   static bool IsExtension(const char* filename);
   using NativeImage3 = Image3B;
+  const size_t scale_denom = 1;
 };
 
 // Wrappers
@@ -72,6 +87,42 @@ struct ImageFormatJPG {
 MetaImageF ReadMetaImageLinear(const std::string& pathname);
 Image3F ReadImage3Linear(const std::string& pathname);
 
+// Loads 8-bit sRGB images (PNM, JPG, PNG with at most 8 bits per sample)
+// without converting them to linear RGB; the encoder accepts them directly.
+// The format is detected via file extension. Returns false for any other
+// image, which requires ReadMetaImageLinear. JPEGs are downscaled during
+// decoding by "jpeg_scale_denom", see ImageFormatJPG; other formats ignore it.
+bool ReadMetaImageSrgb8(const std::string& pathname, MetaImageB* srgb,
+                        size_t jpeg_scale_denom = 1);
+
+// Reads 8-bit sRGB pixels in bands of rows, e.g. for PikStreamingEncoder, so
+// that memory use is proportional to the band rather than the image. Supports
+// binary PGM/PPM and non-interlaced 8-bit gray, RGB or palette PNG without
+// alpha; PNG data is inflated and unfiltered incrementally.
+class Srgb8RowReader {
+ public:
+  Srgb8RowReader();
+  ~Srgb8RowReader();
+
+  // Returns false if the file cannot be opened or is not supported (e.g.
+  // alpha or 16-bit), in which case callers can fall back to
+  // ReadMetaImageSrgb8/ReadMetaImageLinear. Must be called before the others.
+  bool Open(const std::string& pathname);
+
+  size_t xsize() const;
+  size_t ysize() const;
+  // Number of rows not yet returned by ReadRows.
+  size_t RemainingRows() const;
+
+  // Replaces "rows" with the next min(max_rows, RemainingRows()) rows. Returns
+  // false if the file is truncated or corrupt.
+  bool ReadRows(size_t max_rows, Image3B* rows);
+
+ private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
 // Converts to sRGB and writes to format auto-detected from "pathname".
 void WriteImageLinear(const ImageF& linear, const std::string& pathname);
 void WriteImageLinear(const Image3F& linear, const std::string& pathname);
@@ -115,6 +166,8 @@ bool ReadImage(ImageFormatPNG, const std::string&, Image3U*);
 bool ReadImage(ImageFormatPNG, const std::string&, MetaImageB*);
 bool ReadImage(ImageFormatPNG, const std::string&, MetaImageU*);
 
+// Writes independently compressed bands of rows (see ImageFormatPNG) with
+// adaptive filtering, directly from the planar image.
 bool WriteImage(ImageFormatPNG, const ImageB&, const std::string&);
 bool WriteImage(ImageFormatPNG, const ImageS&, const std::string&);
 bool WriteImage(ImageFormatPNG, const ImageU&, const std::string&);
@@ -127,8 +180,40 @@ bool WriteImage(ImageFormatPNG, const MetaImageU&, const std::string&);
 // Y4M
 
 bool ReadImage(ImageFormatY4M, const std::string&, Image3B*);
-bool ReadImage(ImageFormatY4M, const std::string& pathname, Image3U* image,
-               int* bit_depth);
+bool ReadImage(ImageFormatY4M, const std::string& pathname, ThreadPool* pool,
+               Image3U* image, int* bit_depth);
+
+// Reads the first frame (4:2:0 or 4:4:4) and converts it to the opsin dynamics
+// image, without intermediate upsampled YUV or RGB images.
+bool ReadOpsinImage(ImageFormatY4M, const std::string& pathname,
+                    ThreadPool* pool, Image3F* opsin);
+
+// Reads consecutive frames of a (multi-frame) Y4M stream without reopening
+// the file. Frames are returned as in ReadImage(ImageFormatY4M, pool, Image3U).
+class Y4MFrameReader {
+ public:
+  Y4MFrameReader();
+  ~Y4MFrameReader();
+
+  // Returns false if the file cannot be opened or its header is invalid. Must
+  // be called before the others.
+  bool Open(const std::string& pathname);
+
+  size_t xsize() const;
+  size_t ysize() const;
+  int bit_depth() const;
+
+  // Returns whether all frames have been read.
+  bool AtEnd() const;
+
+  // Replaces "yuv" with the next frame. Returns false if the frame is
+  // truncated or invalid (or AtEnd()).
+  bool ReadFrame(ThreadPool* pool, Image3U* yuv);
+
+ private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
 
 // Unsupported (will return false) but required by WriteLinear.
 bool WriteImage(ImageFormatY4M, const ImageB&, const std::string&);
@@ -138,6 +223,7 @@ bool WriteImage(ImageFormatY4M, const Image3U&, const std::string&);
 
 // JPEG
 
+// Returns false if the scale_denom of the format is not 1, 2, 4 or 8.
 bool ReadImage(ImageFormatJPG, const std::string&, Image3B*);
 
 bool ReadImage(ImageFormatJPG, const uint8_t* buf, size_t size, Image3B*);
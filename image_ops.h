@@ -0,0 +1,353 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMAGE_OPS_H_
+#define IMAGE_OPS_H_
+
+// Parallel SIMD pixel-wise arithmetic and reductions on float images, and
+// prefaulting. Unlike the image.h helpers, these split rows across a
+// ThreadPool, and the arithmetic writes to an output argument. Chains of
+// operations (e.g. Scale(LinComb(..))) should be fused into a single Transform
+// with a custom function, which requires neither temporary images nor
+// multiple passes over memory.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "data_parallel.h"
+#include "image.h"
+#include "simd/simd.h"
+
+namespace pik {
+namespace image_ops {
+
+using D = SIMD_NAMESPACE::Full<float>;
+using V = D::V;
+
+constexpr size_t kRowsPerTask = 8;
+
+// Calls row_func(y) for all y in [0, ysize) using "pool". Each task processes
+// several rows to reduce overhead for small images.
+template <class RowFunc>
+void ForEachRow(const size_t ysize, ThreadPool* pool, const RowFunc& row_func) {
+  const size_t num_tasks = DivCeil(ysize, kRowsPerTask);
+  pool->Run(0, num_tasks, [&](const int task, const int thread) {
+    const size_t y_begin = task * kRowsPerTask;
+    const size_t y_end = std::min(y_begin + kRowsPerTask, ysize);
+    for (size_t y = y_begin; y < y_end; ++y) {
+      row_func(y);
+    }
+  });
+}
+
+// Returns reduce(reduce(..reduce(init, row_func(0)).., row_func(1)), ..) for
+// all y in [0, ysize), where row_func returns a T. Rows are reduced in tasks
+// of kRowsPerTask whose results are then combined in row order, so the result
+// is independent of the number of threads and the order in which they run.
+// "pool" may be null, in which case this runs on the current thread.
+template <typename T, class RowFunc, class Reduce>
+T ReduceRows(const size_t ysize, ThreadPool* pool, const T init,
+             const RowFunc& row_func, const Reduce& reduce) {
+  const size_t num_tasks = DivCeil(ysize, kRowsPerTask);
+  std::vector<T> partial(num_tasks, init);
+  const auto reduce_task = [&](const int task, const int thread) {
+    const size_t y_begin = task * kRowsPerTask;
+    const size_t y_end = std::min(y_begin + kRowsPerTask, ysize);
+    T result = init;
+    for (size_t y = y_begin; y < y_end; ++y) {
+      result = reduce(result, row_func(y));
+    }
+    partial[task] = result;
+  };
+  if (pool == nullptr) {
+    for (size_t task = 0; task < num_tasks; ++task) reduce_task(task, 0);
+  } else {
+    pool->Run(0, num_tasks, reduce_task);
+  }
+
+  T result = init;
+  for (const T& value : partial) {
+    result = reduce(result, value);
+  }
+  return result;
+}
+
+// Returns the minimum and maximum of row[0, xsize).
+static inline std::pair<float, float> RowMinMax(const float* PIK_RESTRICT row,
+                                                const size_t xsize) {
+  using namespace SIMD_NAMESPACE;
+  const D d;
+  float min = std::numeric_limits<float>::max();
+  float max = std::numeric_limits<float>::lowest();
+  size_t x = 0;
+  if (xsize >= d.N) {
+    V vmin = load(d, row);
+    V vmax = vmin;
+    for (x = d.N; x + d.N <= xsize; x += d.N) {
+      const V v = load(d, row + x);
+      vmin = SIMD_NAMESPACE::min(vmin, v);
+      vmax = SIMD_NAMESPACE::max(vmax, v);
+    }
+    SIMD_ALIGN float lanes_min[d.N];
+    SIMD_ALIGN float lanes_max[d.N];
+    store(vmin, d, lanes_min);
+    store(vmax, d, lanes_max);
+    for (size_t i = 0; i < d.N; ++i) {
+      min = std::min(min, lanes_min[i]);
+      max = std::max(max, lanes_max[i]);
+    }
+  }
+  for (; x < xsize; ++x) {
+    min = std::min(min, row[x]);
+    max = std::max(max, row[x]);
+  }
+  return std::make_pair(min, max);
+}
+
+// Returns the sum of func(x) for x in [0, xsize), where func returns a V for
+// the pixels starting at x. Lanes are accumulated in float for at most
+// kVectorsPerSum vectors before adding them to a double, which bounds the
+// rounding error. "func_scalar" is called for the remaining pixels.
+template <class Func, class FuncScalar>
+double RowSum(const size_t xsize, const Func& func,
+              const FuncScalar& func_scalar) {
+  using namespace SIMD_NAMESPACE;
+  constexpr size_t kVectorsPerSum = 64;
+  const D d;
+  double sum = 0.0;
+  size_t x = 0;
+  while (x + d.N <= xsize) {
+    V vsum = setzero(d);
+    const size_t x_end = std::min(xsize - d.N + 1, x + kVectorsPerSum * d.N);
+    for (; x < x_end; x += d.N) {
+      vsum += func(x);
+    }
+    sum += get_part(Part<float, 1>(), ext::sum_of_lanes(vsum));
+  }
+  for (; x < xsize; ++x) {
+    sum += func_scalar(x);
+  }
+  return sum;
+}
+
+}  // namespace image_ops
+
+// Sets out[x, y] = func(a[x, y]), where func accepts and returns image_ops::V.
+// Resizes "out" if needed; it may alias "a". func may also be called for
+// pixels in the row padding, whose results are ignored.
+template <class Func>
+void Transform(const ImageF& a, const Func& func, ThreadPool* pool,
+               ImageF* out) {
+  using namespace SIMD_NAMESPACE;
+  if (!SameSize(a, *out)) out->Resize(a.xsize(), a.ysize());
+  const image_ops::D d;
+  image_ops::ForEachRow(a.ysize(), pool, [&](const size_t y) {
+    const float* row_a = a.ConstRow(y);
+    float* row_out = out->Row(y);
+    for (size_t x = 0; x < a.xsize(); x += d.N) {
+      store(func(load(d, row_a + x)), d, row_out + x);
+    }
+  });
+}
+
+// Sets out[x, y] = func(a[x, y], b[x, y]); otherwise as above. "out" may
+// alias "a" or "b".
+template <class Func>
+void Transform(const ImageF& a, const ImageF& b, const Func& func,
+               ThreadPool* pool, ImageF* out) {
+  using namespace SIMD_NAMESPACE;
+  PIK_CHECK(SameSize(a, b));
+  if (!SameSize(a, *out)) out->Resize(a.xsize(), a.ysize());
+  const image_ops::D d;
+  image_ops::ForEachRow(a.ysize(), pool, [&](const size_t y) {
+    const float* row_a = a.ConstRow(y);
+    const float* row_b = b.ConstRow(y);
+    float* row_out = out->Row(y);
+    for (size_t x = 0; x < a.xsize(); x += d.N) {
+      store(func(load(d, row_a + x), load(d, row_b + x)), d, row_out + x);
+    }
+  });
+}
+
+// Image3F versions apply the same func to each plane.
+template <class Func>
+void Transform(const Image3F& a, const Func& func, ThreadPool* pool,
+               Image3F* out) {
+  for (int c = 0; c < 3; ++c) {
+    Transform(a.Plane(c), func, pool, out->MutablePlane(c));
+  }
+  out->CheckSizesSame();
+}
+
+template <class Func>
+void Transform(const Image3F& a, const Image3F& b, const Func& func,
+               ThreadPool* pool, Image3F* out) {
+  for (int c = 0; c < 3; ++c) {
+    Transform(a.Plane(c), b.Plane(c), func, pool, out->MutablePlane(c));
+  }
+  out->CheckSizesSame();
+}
+
+// Touches every page of a newly allocated "image" from the threads of "pool"
+// instead of faulting them in one at a time when a serial loop first writes
+// to it. On NUMA systems, this also spreads the pages across the nodes of the
+// worker threads. Pixel values are unspecified afterwards (as before).
+template <typename T>
+void PrefaultImage(ThreadPool* pool, Image<T>* image) {
+  constexpr size_t kPageSize = 4096;
+  // Not bytes_per_row, which may include rows of other planes (Image3Layout).
+  const size_t row_bytes = image->xsize() * sizeof(T);
+  if (row_bytes == 0) return;
+  image_ops::ForEachRow(image->ysize(), pool, [&](const size_t y) {
+    volatile uint8_t* row = reinterpret_cast<uint8_t*>(image->Row(y));
+    for (size_t i = 0; i < row_bytes; i += kPageSize) {
+      row[i] = 0;
+    }
+    row[row_bytes - 1] = 0;
+  });
+}
+
+template <typename T>
+void PrefaultImage(ThreadPool* pool, Image3<T>* image) {
+  for (int c = 0; c < 3; ++c) {
+    PrefaultImage(pool, image->MutablePlane(c));
+  }
+}
+
+// Parallel equivalents of the image.h helpers of the same name.
+
+// Unlike the image.h version, "pool" may be null, and results are
+// deterministic (see image_ops::ReduceRows). "ImageT" is ImageF or
+// butteraugli::ImageF.
+template <class ImageT>
+void ImageMinMax(const ImageT& image, ThreadPool* pool,
+                 float* PIK_RESTRICT min, float* PIK_RESTRICT max) {
+  using MinMax = std::pair<float, float>;
+  const MinMax result = image_ops::ReduceRows(
+      image.ysize(), pool,
+      MinMax(std::numeric_limits<float>::max(),
+             std::numeric_limits<float>::lowest()),
+      [&image](const size_t y) {
+        return image_ops::RowMinMax(image.Row(y), image.xsize());
+      },
+      [](const MinMax& a, const MinMax& b) {
+        return MinMax(std::min(a.first, b.first), std::max(a.second, b.second));
+      });
+  *min = result.first;
+  *max = result.second;
+}
+
+static inline void Image3MinMax(const Image3F& image, ThreadPool* pool,
+                                std::array<float, 3>* PIK_RESTRICT min,
+                                std::array<float, 3>* PIK_RESTRICT max) {
+  for (int c = 0; c < 3; ++c) {
+    ImageMinMax(image.Plane(c), pool, &(*min)[c], &(*max)[c]);
+  }
+}
+
+// Returns the largest pixel value, e.g. the butteraugli score of a diffmap
+// (equivalent to butteraugli::ButteraugliScoreFromDiffmap).
+template <class ImageT>
+float ImageMax(const ImageT& image, ThreadPool* pool) {
+  float min, max;
+  ImageMinMax(image, pool, &min, &max);
+  return max;
+}
+
+// Returns the sum of all pixels divided by their number (0 if none).
+static inline double Average(const ImageF& image, ThreadPool* pool) {
+  using namespace SIMD_NAMESPACE;
+  const image_ops::D d;
+  const size_t xsize = image.xsize();
+  const double sum = image_ops::ReduceRows(
+      image.ysize(), pool, 0.0,
+      [&](const size_t y) {
+        const float* PIK_RESTRICT row = image.ConstRow(y);
+        return image_ops::RowSum(
+            xsize, [&](const size_t x) { return load(d, row + x); },
+            [&](const size_t x) { return row[x]; });
+      },
+      [](const double a, const double b) { return a + b; });
+  const size_t num_pixels = xsize * image.ysize();
+  return num_pixels == 0 ? 0.0 : sum / num_pixels;
+}
+
+// Returns the sum of the products of corresponding pixels.
+static inline double DotProduct(const ImageF& a, const ImageF& b,
+                                ThreadPool* pool) {
+  using namespace SIMD_NAMESPACE;
+  PIK_CHECK(SameSize(a, b));
+  const image_ops::D d;
+  const size_t xsize = a.xsize();
+  return image_ops::ReduceRows(
+      a.ysize(), pool, 0.0,
+      [&](const size_t y) {
+        const float* PIK_RESTRICT row_a = a.ConstRow(y);
+        const float* PIK_RESTRICT row_b = b.ConstRow(y);
+        return image_ops::RowSum(
+            xsize,
+            [&](const size_t x) {
+              return load(d, row_a + x) * load(d, row_b + x);
+            },
+            [&](const size_t x) { return row_a[x] * row_b[x]; });
+      },
+      [](const double a, const double b) { return a + b; });
+}
+
+template <class ImageT>
+void LinComb(const float lambda1, const ImageT& image1, const float lambda2,
+             const ImageT& image2, ThreadPool* pool, ImageT* out) {
+  using namespace SIMD_NAMESPACE;
+  const image_ops::D d;
+  const image_ops::V v1 = set1(d, lambda1);
+  const image_ops::V v2 = set1(d, lambda2);
+  Transform(image1, image2,
+            [v1, v2](const image_ops::V a, const image_ops::V b) {
+              return mul_add(v1, a, v2 * b);
+            },
+            pool, out);
+}
+
+template <class ImageT>
+void ScaleImage(const float lambda, const ImageT& image, ThreadPool* pool,
+                ImageT* out) {
+  using namespace SIMD_NAMESPACE;
+  const image_ops::V v = set1(image_ops::D(), lambda);
+  Transform(image, [v](const image_ops::V a) { return v * a; }, pool, out);
+}
+
+template <class ImageT>
+void Product(const ImageT& a, const ImageT& b, ThreadPool* pool, ImageT* out) {
+  Transform(a, b,
+            [](const image_ops::V a, const image_ops::V b) { return a * b; },
+            pool, out);
+}
+
+template <class ImageT>
+void Subtract(const ImageT& a, const ImageT& b, ThreadPool* pool,
+              ImageT* out) {
+  Transform(a, b,
+            [](const image_ops::V a, const image_ops::V b) { return a - b; },
+            pool, out);
+}
+
+}  // namespace pik
+
+#endif  // IMAGE_OPS_H_
@@ -18,51 +18,71 @@
 
 namespace pik {
 
-int FindIndexAndRemove(int val, int* s, int len) {
-  int idx = 0;
-  for (int i = 0; i < len; ++i) {
-    if (s[i] == val) {
-      s[i] = -1;
-      break;
-    } else if (s[i] != -1) {
-      ++idx;
-    }
+namespace {
+
+// Fenwick tree (binary indexed tree) of flags indicating which of the values
+// [0, len) have not yet been removed. Both directions of the Lehmer code only
+// require counting/selecting among the remaining values, which takes
+// O(log len) instead of the O(len) of a linear scan.
+class RemainingValues {
+ public:
+  explicit RemainingValues(const int len) : len_(len), tree_(len + 1) {
+    // Equivalent to adding 1 for every value: node i covers lowbit(i) values.
+    for (int i = 1; i <= len; ++i) tree_[i] = i & -i;
+    top_bit_ = 1;
+    while (top_bit_ * 2 <= len) top_bit_ *= 2;
   }
-  return idx;
-}
 
-void ComputeLehmerCode(const int* sigma, const int len, int* code) {
-  std::vector<int> stdorder(len);
-  for (int i = 0; i < len; ++i) {
-    stdorder[i] = i;
+  // Returns the number of remaining values less than "value".
+  int CountLess(int value) const {
+    int count = 0;
+    for (int i = value; i > 0; i &= i - 1) count += tree_[i];
+    return count;
   }
-  for (int i = 0; i < len; ++i) {
-    code[i] = FindIndexAndRemove(sigma[i], &stdorder[0], len);
+
+  // Returns the remaining value with the given rank, or len if there is none.
+  int Select(int rank) const {
+    int pos = 0;
+    for (int step = top_bit_; step != 0; step >>= 1) {
+      if (pos + step <= len_ && tree_[pos + step] <= rank) {
+        pos += step;
+        rank -= tree_[pos];
+      }
+    }
+    return pos;
   }
-}
 
-int FindValueAndRemove(int idx, int* s, int len) {
-  int pos = 0;
-  int val = 0;
+  void Remove(int value) {
+    for (int i = value + 1; i <= len_; i += i & -i) --tree_[i];
+  }
+
+ private:
+  const int len_;
+  int top_bit_;
+  std::vector<int> tree_;  // 1-based
+};
+
+}  // namespace
+
+void ComputeLehmerCode(const int* sigma, const int len, int* code) {
+  RemainingValues remaining(len);
   for (int i = 0; i < len; ++i) {
-    if (s[i] == -1) continue;
-    if (pos == idx) {
-      val = s[i];
-      s[i] = -1;
-      break;
-    }
-    ++pos;
+    code[i] = remaining.CountLess(sigma[i]);
+    remaining.Remove(sigma[i]);
   }
-  return val;
 }
 
 void DecodeLehmerCode(const int* code, int len, int* sigma) {
-  std::vector<int> stdorder(len);
-  for (int i = 0; i < len; ++i) {
-    stdorder[i] = i;
-  }
+  RemainingValues remaining(len);
   for (int i = 0; i < len; ++i) {
-    sigma[i] = FindValueAndRemove(code[i], &stdorder[0], len);
+    const int value = remaining.Select(code[i]);
+    // Invalid (too large) codes decode to 0 without removing anything.
+    if (code[i] < 0 || value >= len) {
+      sigma[i] = 0;
+      continue;
+    }
+    sigma[i] = value;
+    remaining.Remove(value);
   }
 }
 
@@ -0,0 +1,623 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lossless.h"
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "bit_reader.h"
+#include "common.h"
+#include "compiler_specific.h"
+#include "dc_predictor.h"
+#include "entropy_coder.h"
+#include "fields.h"
+#include "profiler.h"
+#include "status.h"
+#include "write_bits.h"
+
+namespace pik {
+namespace {
+
+// Same extent as the groups of the default bitstream.
+constexpr size_t kGroupWidth = kGroupWidthInBlocks * kBlockWidth;
+constexpr size_t kGroupHeight = kGroupHeightInBlocks * kBlockHeight;
+
+// Group sizes [bytes]: typically tens of KiB for screenshots, up to about
+// 1 MiB for noise.
+constexpr uint32_t kGroupSizeDistribution = 0x20181410;
+
+size_t NumGroups(const size_t xsize, const size_t ysize) {
+  return DivCeil(xsize, kGroupWidth) * DivCeil(ysize, kGroupHeight);
+}
+
+Rect GroupRect(const size_t group, const size_t xsize, const size_t ysize) {
+  const size_t xsize_groups = DivCeil(xsize, kGroupWidth);
+  const size_t gx = group % xsize_groups;
+  const size_t gy = group / xsize_groups;
+  return Rect(gx * kGroupWidth, gy * kGroupHeight, kGroupWidth, kGroupHeight,
+              xsize, ysize);
+}
+
+// Packs one pixel as the key of ColorMap; opaque if "row_a" is null.
+static inline uint32_t PackColor(const uint8_t* PIK_RESTRICT row_r,
+                                 const uint8_t* PIK_RESTRICT row_g,
+                                 const uint8_t* PIK_RESTRICT row_b,
+                                 const uint16_t* PIK_RESTRICT row_a,
+                                 const size_t x) {
+  const uint32_t a = row_a == nullptr ? 255 : row_a[x];
+  return row_r[x] | (row_g[x] << 8) | (row_b[x] << 16) | (a << 24);
+}
+
+// Open-addressing hash map from packed colors to palette indices. The table
+// is four times larger than the largest palette, so probe sequences are short
+// and it never fills up.
+class ColorMap {
+ public:
+  static constexpr int kEmpty = -1;
+
+  ColorMap() : keys_(kNumSlots), indices_(kNumSlots, kEmpty) {}
+
+  // Returns the index of "key", or kEmpty if absent.
+  int Find(const uint32_t key) const { return indices_[Slot(key)]; }
+
+  // Requires Find(key) == kEmpty and fewer than 4 * kMaxPaletteColors calls.
+  void Insert(const uint32_t key, const int index) {
+    const size_t slot = Slot(key);
+    keys_[slot] = key;
+    indices_[slot] = index;
+  }
+
+ private:
+  static constexpr size_t kNumSlots = 4 * kMaxPaletteColors;
+
+  // Returns the slot holding "key", or the empty slot where it belongs.
+  size_t Slot(const uint32_t key) const {
+    static_assert((kNumSlots & (kNumSlots - 1)) == 0, "Must be power of two");
+    size_t slot = (key * 0x9E3779B1u) % kNumSlots;
+    while (indices_[slot] != kEmpty && keys_[slot] != key) {
+      slot = (slot + 1) % kNumSlots;
+    }
+    return slot;
+  }
+
+  std::vector<uint32_t> keys_;
+  std::vector<int> indices_;
+};
+
+// Thread-specific group-sized temporaries, allocated on first use.
+struct GroupBuffers {
+  void InitOnce(const bool encoder) {
+    if (residuals.xsize() != 0) return;
+    residuals = Image3S(kGroupWidth, kGroupHeight);
+    if (encoder) {
+      pixels = Image3S(kGroupWidth, kGroupHeight);
+    } else {
+      y = ImageS(kGroupWidth, kGroupHeight);
+      xz_residuals = ImageS(kGroupWidth * 2, kGroupHeight);
+      xz_expanded = ImageS(kGroupWidth * 2, kGroupHeight);
+    }
+  }
+
+  Image3S residuals;
+  Image3S pixels;  // Encoder only.
+  ImageS y;        // Decoder only, as are xz_*.
+  ImageS xz_residuals;
+  ImageS xz_expanded;
+};
+
+// Subtracting G from R and B ("X" and "B" planes, with G as "Y") removes
+// most of the inter-channel correlation; the XB predictor additionally
+// selects its predictor according to the Y residuals.
+void EncodeGroup(const MetaImageB& image, const bool grayscale,
+                 const Rect& rect, GroupBuffers* PIK_RESTRICT tmp,
+                 PaddedBytes* PIK_RESTRICT out) {
+  const size_t xsize = rect.xsize();
+  const size_t ysize = rect.ysize();
+  const Rect tmp_rect(0, 0, xsize, ysize);
+  const Image3B& color = image.GetColor();
+
+  for (size_t y = 0; y < ysize; ++y) {
+    const uint8_t* PIK_RESTRICT row_r = rect.ConstRow(color.Plane(0), y);
+    const uint8_t* PIK_RESTRICT row_g = rect.ConstRow(color.Plane(1), y);
+    const uint8_t* PIK_RESTRICT row_b = rect.ConstRow(color.Plane(2), y);
+    int16_t* PIK_RESTRICT row_x = tmp->pixels.PlaneRow(0, y);
+    int16_t* PIK_RESTRICT row_y = tmp->pixels.PlaneRow(1, y);
+    int16_t* PIK_RESTRICT row_z = tmp->pixels.PlaneRow(2, y);
+    for (size_t x = 0; x < xsize; ++x) {
+      row_x[x] = row_r[x] - row_g[x];
+      row_y[x] = row_g[x];
+      row_z[x] = row_b[x] - row_g[x];
+    }
+  }
+
+  if (grayscale) {
+    ShrinkY(tmp_rect, tmp->pixels.Plane(1), tmp_rect,
+            tmp->residuals.MutablePlane(1));
+  } else {
+    ShrinkDC(tmp_rect, tmp->pixels, &tmp->residuals);
+  }
+  EncodeImageWithNeighbors(tmp_rect, tmp->residuals, nullptr, out,
+                           grayscale);
+
+  if (image.HasAlpha()) {
+    for (size_t y = 0; y < ysize; ++y) {
+      const uint16_t* PIK_RESTRICT row_a = rect.ConstRow(image.GetAlpha(), y);
+      int16_t* PIK_RESTRICT row_y = tmp->pixels.PlaneRow(1, y);
+      for (size_t x = 0; x < xsize; ++x) {
+        row_y[x] = row_a[x];
+      }
+    }
+    ShrinkY(tmp_rect, tmp->pixels.Plane(1), tmp_rect,
+            tmp->residuals.MutablePlane(1));
+    EncodeImageWithNeighbors(tmp_rect, tmp->residuals, nullptr, out,
+                             /*grayscale=*/true);
+  }
+}
+
+// Codes the palette index of each pixel as a single "Y" plane. Runs of the
+// same color skip the hash lookup.
+void EncodePaletteGroup(const MetaImageB& image, const ColorMap& color_map,
+                        const Rect& rect, GroupBuffers* PIK_RESTRICT tmp,
+                        PaddedBytes* PIK_RESTRICT out) {
+  const size_t xsize = rect.xsize();
+  const size_t ysize = rect.ysize();
+  const Rect tmp_rect(0, 0, xsize, ysize);
+  const Image3B& color = image.GetColor();
+
+  uint32_t prev_key = 0;
+  int prev_index = color_map.Find(prev_key);
+  for (size_t y = 0; y < ysize; ++y) {
+    const uint8_t* PIK_RESTRICT row_r = rect.ConstRow(color.Plane(0), y);
+    const uint8_t* PIK_RESTRICT row_g = rect.ConstRow(color.Plane(1), y);
+    const uint8_t* PIK_RESTRICT row_b = rect.ConstRow(color.Plane(2), y);
+    const uint16_t* PIK_RESTRICT row_a =
+        image.HasAlpha() ? rect.ConstRow(image.GetAlpha(), y) : nullptr;
+    int16_t* PIK_RESTRICT row_index = tmp->pixels.PlaneRow(1, y);
+    for (size_t x = 0; x < xsize; ++x) {
+      const uint32_t key = PackColor(row_r, row_g, row_b, row_a, x);
+      if (key != prev_key) {
+        prev_key = key;
+        prev_index = color_map.Find(key);
+      }
+      PIK_ASSERT(prev_index != ColorMap::kEmpty);
+      row_index[x] = prev_index;
+    }
+  }
+
+  ShrinkY(tmp_rect, tmp->pixels.Plane(1), tmp_rect,
+          tmp->residuals.MutablePlane(1));
+  EncodeImageWithNeighbors(tmp_rect, tmp->residuals, nullptr, out,
+                           /*grayscale=*/true);
+}
+
+static inline uint8_t Clamp255(const int v) {
+  return static_cast<uint8_t>(std::min(std::max(v, 0), 255));
+}
+
+// Palette entries by channel, indexed by the decoded indices.
+struct PaletteLUT {
+  std::vector<uint8_t> r;
+  std::vector<uint8_t> g;
+  std::vector<uint8_t> b;
+  std::vector<uint8_t> a;
+};
+
+// Expands the decoded indices straight into the output rows.
+bool DecodePaletteGroup(const PaletteLUT& lut, const Rect& rect,
+                        PaddedBitReader* PIK_RESTRICT reader,
+                        GroupBuffers* PIK_RESTRICT tmp,
+                        Image3B* PIK_RESTRICT color,
+                        ImageU* PIK_RESTRICT alpha) {
+  const size_t xsize = rect.xsize();
+  const size_t ysize = rect.ysize();
+  const Rect tmp_rect(0, 0, xsize, ysize);
+
+  if (!DecodeImageWithNeighbors(reader, tmp_rect, &tmp->residuals,
+                                /*grayscale=*/true)) {
+    return false;
+  }
+  ExpandY(tmp_rect, tmp->residuals.Plane(1), &tmp->y);
+
+  // Invalid (corrupt) indices are clamped rather than checked.
+  const size_t max_index = lut.r.size() - 1;
+  for (size_t y = 0; y < ysize; ++y) {
+    const int16_t* PIK_RESTRICT row_index = tmp->y.ConstRow(y);
+    uint8_t* PIK_RESTRICT row_r = rect.Row(color->MutablePlane(0), y);
+    uint8_t* PIK_RESTRICT row_g = rect.Row(color->MutablePlane(1), y);
+    uint8_t* PIK_RESTRICT row_b = rect.Row(color->MutablePlane(2), y);
+    for (size_t x = 0; x < xsize; ++x) {
+      const size_t index =
+          std::min<size_t>(static_cast<uint16_t>(row_index[x]), max_index);
+      row_r[x] = lut.r[index];
+      row_g[x] = lut.g[index];
+      row_b[x] = lut.b[index];
+    }
+    if (alpha != nullptr) {
+      uint16_t* PIK_RESTRICT row_a = rect.Row(alpha, y);
+      for (size_t x = 0; x < xsize; ++x) {
+        const size_t index =
+            std::min<size_t>(static_cast<uint16_t>(row_index[x]), max_index);
+        row_a[x] = lut.a[index];
+      }
+    }
+  }
+  return true;
+}
+
+// "reader" is positioned at the start of the group's code.
+bool DecodeGroup(const bool grayscale, const Rect& rect,
+                 PaddedBitReader* PIK_RESTRICT reader,
+                 GroupBuffers* PIK_RESTRICT tmp, Image3B* PIK_RESTRICT color,
+                 ImageU* PIK_RESTRICT alpha) {
+  const size_t xsize = rect.xsize();
+  const size_t ysize = rect.ysize();
+  const Rect tmp_rect(0, 0, xsize, ysize);
+
+  if (!DecodeImageWithNeighbors(reader, tmp_rect, &tmp->residuals,
+                                grayscale)) {
+    return false;
+  }
+
+  if (grayscale) {
+    ExpandY(tmp_rect, tmp->residuals.Plane(1), &tmp->y);
+    for (size_t y = 0; y < ysize; ++y) {
+      const int16_t* PIK_RESTRICT row_y = tmp->y.ConstRow(y);
+      uint8_t* PIK_RESTRICT row_out = rect.Row(color->MutablePlane(1), y);
+      for (size_t x = 0; x < xsize; ++x) {
+        row_out[x] = Clamp255(row_y[x]);
+      }
+      memcpy(rect.Row(color->MutablePlane(0), y), row_out, xsize);
+      memcpy(rect.Row(color->MutablePlane(2), y), row_out, xsize);
+    }
+  } else {
+    // Expands in place (tmp->y may be swapped with the Y plane).
+    ExpandDC(tmp_rect, &tmp->residuals, &tmp->y, &tmp->xz_residuals,
+             &tmp->xz_expanded);
+    for (size_t y = 0; y < ysize; ++y) {
+      const int16_t* PIK_RESTRICT row_x = tmp->residuals.ConstPlaneRow(0, y);
+      const int16_t* PIK_RESTRICT row_y = tmp->residuals.ConstPlaneRow(1, y);
+      const int16_t* PIK_RESTRICT row_z = tmp->residuals.ConstPlaneRow(2, y);
+      uint8_t* PIK_RESTRICT row_r = rect.Row(color->MutablePlane(0), y);
+      uint8_t* PIK_RESTRICT row_g = rect.Row(color->MutablePlane(1), y);
+      uint8_t* PIK_RESTRICT row_b = rect.Row(color->MutablePlane(2), y);
+      for (size_t x = 0; x < xsize; ++x) {
+        const int g = row_y[x];
+        row_r[x] = Clamp255(row_x[x] + g);
+        row_g[x] = Clamp255(g);
+        row_b[x] = Clamp255(row_z[x] + g);
+      }
+    }
+  }
+
+  if (alpha != nullptr) {
+    if (!DecodeImageWithNeighbors(reader, tmp_rect, &tmp->residuals,
+                                  /*grayscale=*/true)) {
+      return false;
+    }
+    ExpandY(tmp_rect, tmp->residuals.Plane(1), &tmp->y);
+    for (size_t y = 0; y < ysize; ++y) {
+      const int16_t* PIK_RESTRICT row_y = tmp->y.ConstRow(y);
+      uint16_t* PIK_RESTRICT row_out = rect.Row(alpha, y);
+      for (size_t x = 0; x < xsize; ++x) {
+        row_out[x] = Clamp255(row_y[x]);
+      }
+    }
+  }
+  return true;
+}
+
+// Returns whether the pixels within "rect" of "image" and "previous" are
+// equal. An exact comparison is as fast as hashing or summing differences and
+// cannot cause the decoder to retain pixels that actually changed.
+bool SameGroup(const MetaImageB& image, const MetaImageB& previous,
+               const Rect& rect) {
+  for (int c = 0; c < 3; ++c) {
+    const ImageB& plane = image.GetColor().Plane(c);
+    const ImageB& previous_plane = previous.GetColor().Plane(c);
+    for (size_t y = 0; y < rect.ysize(); ++y) {
+      if (memcmp(rect.ConstRow(plane, y), rect.ConstRow(previous_plane, y),
+                 rect.xsize()) != 0) {
+        return false;
+      }
+    }
+  }
+  if (image.HasAlpha()) {
+    for (size_t y = 0; y < rect.ysize(); ++y) {
+      if (memcmp(rect.ConstRow(image.GetAlpha(), y),
+                 rect.ConstRow(previous.GetAlpha(), y),
+                 rect.xsize() * sizeof(uint16_t)) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Returns the lookup table for decoding, or false if "palette" is invalid.
+bool MakePaletteLUT(const Palette& palette, const bool has_alpha,
+                    PaletteLUT* PIK_RESTRICT lut) {
+  const size_t num_colors = palette.num_colors_minus_one + 1;
+  if (palette.encoding != Palette::kEncodingRaw ||
+      palette.bytes_per_color != 1) {
+    return PIK_FAILURE("Unsupported palette encoding");
+  }
+  if (palette.colors.size() != 3 * num_colors ||
+      palette.num_alpha > num_colors ||
+      palette.alpha.size() != palette.num_alpha) {
+    return PIK_FAILURE("Palette size mismatch");
+  }
+  if (palette.num_alpha != 0 && !has_alpha) {
+    return PIK_FAILURE("Palette has alpha but the image does not");
+  }
+
+  lut->r.resize(num_colors);
+  lut->g.resize(num_colors);
+  lut->b.resize(num_colors);
+  // Entries without alpha are opaque (as in PNG tRNS).
+  lut->a.assign(num_colors, 255);
+  for (size_t i = 0; i < num_colors; ++i) {
+    lut->r[i] = palette.colors[3 * i + 0];
+    lut->g[i] = palette.colors[3 * i + 1];
+    lut->b[i] = palette.colors[3 * i + 2];
+  }
+  for (size_t i = 0; i < palette.num_alpha; ++i) {
+    lut->a[i] = palette.alpha[i];
+  }
+  return true;
+}
+
+}  // namespace
+
+bool FindPalette(const Image3B& color, const ImageU* alpha,
+                 const size_t max_colors, Palette* palette) {
+  PROFILER_FUNC;
+  PIK_CHECK(max_colors <= kMaxPaletteColors);
+  ColorMap color_map;
+  std::vector<uint32_t> keys;
+  keys.reserve(max_colors + 1);
+
+  // Photos exceed max_colors within the first few rows.
+  uint32_t prev_key = 0;  // only valid if !keys.empty()
+  for (size_t y = 0; y < color.ysize(); ++y) {
+    const uint8_t* PIK_RESTRICT row_r = color.ConstPlaneRow(0, y);
+    const uint8_t* PIK_RESTRICT row_g = color.ConstPlaneRow(1, y);
+    const uint8_t* PIK_RESTRICT row_b = color.ConstPlaneRow(2, y);
+    const uint16_t* PIK_RESTRICT row_a =
+        alpha == nullptr ? nullptr : alpha->ConstRow(y);
+    for (size_t x = 0; x < color.xsize(); ++x) {
+      const uint32_t key = PackColor(row_r, row_g, row_b, row_a, x);
+      if (!keys.empty() && key == prev_key) continue;
+      prev_key = key;
+      if (color_map.Find(key) != ColorMap::kEmpty) continue;
+      if (keys.size() == max_colors) return false;
+      color_map.Insert(key, keys.size());
+      keys.push_back(key);
+    }
+  }
+  if (keys.empty()) return false;
+
+  // Translucent entries first because only a prefix has alpha, then in order
+  // of luminance (and the key, for determinism).
+  const auto order = [](const uint32_t key) {
+    const uint32_t opaque = (key >> 24) == 255;
+    const uint32_t r = key & 0xFF;
+    const uint32_t g = (key >> 8) & 0xFF;
+    const uint32_t b = (key >> 16) & 0xFF;
+    const uint64_t luma = 77 * r + 150 * g + 29 * b;
+    return (static_cast<uint64_t>(opaque) << 48) | (luma << 32) | key;
+  };
+  std::sort(keys.begin(), keys.end(),
+            [&order](const uint32_t a, const uint32_t b) {
+              return order(a) < order(b);
+            });
+
+  *palette = Palette();
+  palette->num_colors_minus_one = keys.size() - 1;
+  palette->colors.reserve(3 * keys.size());
+  for (const uint32_t key : keys) {
+    palette->colors.push_back(key & 0xFF);
+    palette->colors.push_back((key >> 8) & 0xFF);
+    palette->colors.push_back((key >> 16) & 0xFF);
+    if ((key >> 24) != 255) {
+      palette->alpha.push_back(key >> 24);
+    }
+  }
+  palette->num_alpha = palette->alpha.size();
+  return true;
+}
+
+bool PixelsToPikLossless(const MetaImageB& image, const bool grayscale,
+                         const Palette* palette, const MetaImageB* previous,
+                         ThreadPool* pool, PaddedBytes* compressed,
+                         PikInfo* aux_out) {
+  PROFILER_FUNC;
+  const size_t xsize = image.xsize();
+  const size_t ysize = image.ysize();
+  if (image.HasAlpha() && image.AlphaBitDepth() != 8) {
+    return PIK_FAILURE("Lossless only supports 8-bit alpha");
+  }
+
+  Header header;
+  header.xsize = xsize;
+  header.ysize = ysize;
+  header.num_components = (grayscale ? 1 : 3) + (image.HasAlpha() ? 1 : 0);
+  header.bitstream = Header::kBitstreamLossless;
+  if (previous != nullptr) {
+    if (previous->xsize() != xsize || previous->ysize() != ysize ||
+        previous->HasAlpha() != image.HasAlpha()) {
+      return PIK_FAILURE("Frame does not match the previous frame");
+    }
+    header.flags |= Header::kKeepUnchangedGroups;
+  }
+  size_t encoded_bits;
+  if (!CanEncode(header, &encoded_bits)) {
+    return PIK_FAILURE("Failed to encode header");
+  }
+  Sections sections;
+  ColorMap color_map;
+  if (palette != nullptr) {
+    sections.palette.reset(new Palette(*palette));
+    const size_t num_colors = palette->num_colors_minus_one + 1;
+    for (size_t i = 0; i < num_colors; ++i) {
+      const uint32_t a = i < palette->num_alpha ? palette->alpha[i] : 255;
+      color_map.Insert(palette->colors[3 * i + 0] |
+                           (palette->colors[3 * i + 1] << 8) |
+                           (palette->colors[3 * i + 2] << 16) | (a << 24),
+                       i);
+    }
+  }
+  size_t sections_bits;
+  if (!CanEncode(sections, &sections_bits)) {
+    return PIK_FAILURE("Failed to encode sections");
+  }
+
+  const size_t num_groups = NumGroups(xsize, ysize);
+  std::vector<PaddedBytes> group_codes(num_groups);
+  {
+    PikStageTimer timer(aux_out, kStageEncode);
+    std::vector<GroupBuffers> tmp(std::max<size_t>(1, pool->NumThreads()));
+    pool->Run(0, num_groups, [&](const int task, const int thread) {
+      const Rect rect = GroupRect(task, xsize, ysize);
+      // Empty code = unchanged.
+      if (previous != nullptr && SameGroup(image, *previous, rect)) return;
+      GroupBuffers& buffers = tmp[thread];
+      buffers.InitOnce(/*encoder=*/true);
+      if (palette != nullptr) {
+        EncodePaletteGroup(image, color_map, rect, &buffers,
+                           &group_codes[task]);
+      } else {
+        EncodeGroup(image, grayscale, rect, &buffers, &group_codes[task]);
+      }
+    });
+  }
+
+  const size_t max_toc_bits =
+      U32Coder::MaxEncodedBits(kGroupSizeDistribution) * num_groups;
+  size_t total_code_size = 0;
+  for (const PaddedBytes& code : group_codes) {
+    total_code_size += code.size();
+  }
+  compressed->resize(DivCeil(encoded_bits + sections_bits, kBitsPerByte) +
+                     DivCeil(max_toc_bits, kBitsPerByte) + total_code_size);
+  size_t pos = 0;
+  PIK_CHECK(StoreHeader(header, &pos, compressed->data()));
+  PIK_CHECK(StoreSections(sections, &pos, compressed->data()));
+  WriteZeroesToByteBoundary(&pos, compressed->data());
+  for (const PaddedBytes& code : group_codes) {
+    if (!U32Coder::Store(kGroupSizeDistribution, code.size(), &pos,
+                         compressed->data())) {
+      return PIK_FAILURE("Lossless group too large");
+    }
+  }
+  WriteZeroesToByteBoundary(&pos, compressed->data());
+  size_t byte_pos = pos / kBitsPerByte;
+  for (const PaddedBytes& code : group_codes) {
+    memcpy(compressed->data() + byte_pos, code.data(), code.size());
+    byte_pos += code.size();
+  }
+  compressed->resize(byte_pos);
+  return true;
+}
+
+bool LosslessToPixels(const Header& header, const Sections& sections,
+                      const PaddedBytes& compressed, const size_t pos,
+                      ThreadPool* pool, MetaImageB* out, size_t* end) {
+  PROFILER_FUNC;
+  const size_t xsize = header.xsize;
+  const size_t ysize = header.ysize;
+  if (header.num_components == 0 || header.num_components > 4) {
+    return PIK_FAILURE("Invalid number of lossless components");
+  }
+  const bool grayscale = header.num_components <= 2;
+  const bool has_alpha = (header.num_components & 1) == 0;
+  const bool keep_unchanged =
+      (header.flags & Header::kKeepUnchangedGroups) != 0;
+  if (keep_unchanged &&
+      (out->xsize() != xsize || out->ysize() != ysize ||
+       out->HasAlpha() != has_alpha ||
+       (has_alpha && out->AlphaBitDepth() != 8))) {
+    return PIK_FAILURE("Frame does not match the previous frame");
+  }
+  if (pos > compressed.size()) return PIK_FAILURE("Truncated header");
+  PaletteLUT lut;
+  const Palette* palette = sections.palette.get();
+  if (palette != nullptr && !MakePaletteLUT(*palette, has_alpha, &lut)) {
+    return false;
+  }
+
+  // Group offsets relative to the first group (= prefix sum of sizes).
+  const size_t num_groups = NumGroups(xsize, ysize);
+  BitReader reader(compressed.data() + pos, compressed.size() - pos);
+  std::vector<uint64_t> offsets;
+  offsets.reserve(num_groups + 1);
+  offsets.push_back(0);
+  for (size_t i = 0; i < num_groups; ++i) {
+    offsets.push_back(offsets.back() +
+                      U32Coder::Load(kGroupSizeDistribution, &reader));
+  }
+  reader.JumpToByteBoundary();
+  const uint64_t groups_begin = pos + reader.Position();
+  if (groups_begin + offsets.back() > compressed.size()) {
+    return PIK_FAILURE("Group size exceeds [truncated?] stream length");
+  }
+
+  if (end != nullptr) *end = groups_begin + offsets.back();
+
+  // Skipped groups are left as they are, hence decode in place.
+  MetaImageB image;
+  if (keep_unchanged) {
+    image = std::move(*out);
+  } else {
+    image.SetColor(Image3B(xsize, ysize));
+    if (has_alpha) image.AddAlpha(8);
+  }
+  Image3B* color = &image.GetColor();
+  ImageU* alpha_or_null = has_alpha ? &image.GetAlpha() : nullptr;
+
+  std::vector<GroupBuffers> tmp(std::max<size_t>(1, pool->NumThreads()));
+  std::atomic<int> num_errors{0};
+  pool->Run(0, num_groups, [&](const int task, const int thread) {
+    // Once any group failed, the result is discarded anyway.
+    if (num_errors.load(std::memory_order_relaxed) != 0) return;
+    if (keep_unchanged && offsets[task + 1] == offsets[task]) return;
+    GroupBuffers& buffers = tmp[thread];
+    buffers.InitOnce(/*encoder=*/false);
+    const uint64_t begin = groups_begin + offsets[task];
+    // The group readers may load (but not consume) subsequent bytes.
+    PaddedBitReader group_reader(compressed.data() + begin,
+                                 offsets[task + 1] - offsets[task],
+                                 compressed.size() - begin);
+    const Rect rect = GroupRect(task, xsize, ysize);
+    const bool ok =
+        palette != nullptr
+            ? DecodePaletteGroup(lut, rect, &group_reader, &buffers, color,
+                                 alpha_or_null)
+            : DecodeGroup(grayscale, rect, &group_reader, &buffers, color,
+                          alpha_or_null);
+    if (!ok) {
+      num_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  if (num_errors.load(std::memory_order_relaxed) != 0) {
+    return PIK_FAILURE("Failed to decode lossless groups");
+  }
+
+  *out = std::move(image);
+  return true;
+}
+
+}  // namespace pik
@@ -0,0 +1,80 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LOSSLESS_H_
+#define LOSSLESS_H_
+
+// Fast lossless bitstream (Header::kBitstreamLossless) for 8-bit images such
+// as screenshots and synthetic graphics. The image is split into groups of
+// the same extent (in pixels) as those of the default bitstream; each group
+// is predicted by the DC predictors (see dc_predictor.h) and its residuals are
+// ANS-coded independently, so groups are encoded and decoded in parallel.
+//
+// Header::num_components is 1 (gray), 2 (gray + alpha), 3 (RGB) or 4 (RGBA).
+// The header and sections are followed by the sizes of all groups (raster
+// order) and then their codes, each byte-aligned. If the Palette section is
+// present, each group instead codes a single plane of palette indices, which
+// suits logos and charts with few colors.
+//
+// Frames of multi-frame streams (Header::kKeepUnchangedGroups) store a size of
+// zero for groups that equal those of the previous frame, so the cost of
+// encoding and decoding them is proportional to the changed area.
+
+#include <stddef.h>
+
+#include "data_parallel.h"
+#include "header.h"
+#include "image.h"
+#include "padded_bytes.h"
+#include "pik_info.h"
+#include "sections.h"
+
+namespace pik {
+
+// Largest palette the encoder produces (indices are still predicted and
+// entropy-coded, so fewer colors are cheaper).
+constexpr size_t kMaxPaletteColors = 256;
+
+// Returns whether "color" and "alpha" (8-bit, or null if opaque) have at most
+// "max_colors" <= kMaxPaletteColors distinct RGBA values. If so, "palette"
+// receives them, ordered by increasing opacity and then luminance so that
+// neighboring indices tend to be similar colors.
+bool FindPalette(const Image3B& color, const ImageU* alpha, size_t max_colors,
+                 Palette* palette);
+
+// Stores "image" losslessly. Its alpha (if any) must be 8-bit. If "palette"
+// is non-null, it must contain all colors of "image" (see FindPalette) and
+// only their indices are coded. Otherwise, if "grayscale", only one plane is
+// coded, which requires R = G = B. If "previous" is non-null, it must have the
+// same size and alpha presence as "image"; groups whose pixels equal those of
+// "previous" are skipped (see kKeepUnchangedGroups).
+bool PixelsToPikLossless(const MetaImageB& image, bool grayscale,
+                         const Palette* palette, const MetaImageB* previous,
+                         ThreadPool* pool, PaddedBytes* compressed,
+                         PikInfo* aux_out);
+
+// Decodes the lossless bitstream that begins at byte "pos" of "compressed",
+// after "header" (whose fields the caller has validated) and "sections". If
+// header.flags includes kKeepUnchangedGroups, "out" must hold the previous
+// frame, whose pixels are retained in groups that were skipped. If "end" is
+// non-null, it receives the position after the last group, i.e. of the next
+// frame (if any).
+bool LosslessToPixels(const Header& header, const Sections& sections,
+                      const PaddedBytes& compressed, size_t pos,
+                      ThreadPool* pool, MetaImageB* out,
+                      size_t* end = nullptr);
+
+}  // namespace pik
+
+#endif  // LOSSLESS_H_
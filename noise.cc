@@ -1,42 +1,19 @@
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <limits>
 #include <numeric>
 
 #include "af_stats.h"
-#include "convolve.h"
+#include "common.h"
 #include "noise.h"
 #include "opsin_params.h"
 #include "optimize.h"
-#include "rational_polynomial.h"
-#include "simd_helpers.h"
+#include "simd/dispatch.h"
 #include "write_bits.h"
-#include "xorshift128plus.h"
 
 namespace pik {
 namespace {
-using namespace SIMD_NAMESPACE;
-
-ImageF RandomImage(ImageF* PIK_RESTRICT temp, Xorshift128Plus* rng) {
-  const size_t xsize = temp->xsize();
-  const size_t ysize = temp->ysize();
-  for (size_t y = 0; y < ysize; ++y) {
-    float* PIK_RESTRICT row = temp->Row(y);
-    const Full<float> df;
-    const Full<uint32_t> du;
-    for (size_t x = 0; x < xsize; x += df.N) {
-      const auto bits = cast_to(du, (*rng)());
-      // 1.0 + 23 random mantissa bits = [1, 2)
-      const auto rand12 =
-          cast_to(df, shift_right<9>(bits) | set1(du, 0x3F800000));
-      const auto rand01 = rand12 - set1(df, 1.0f);
-      store(rand01, df, row + x);
-    }
-  }
-
-  ImageF out(xsize, ysize);
-  ConvolveT<strategy::Laplacian3>::Run(*temp, kernel::Laplacian3(), &out);
-  return out;
-}
 
 float GetScoreSumsOfAbsoluteDifferences(const Image3F& opsin, const int x,
                                         const int y, const int block_size) {
@@ -77,20 +54,34 @@ float GetScoreSumsOfAbsoluteDifferences(const Image3F& opsin, const int x,
   return total_sad_sum / kSamples;
 }
 
+// Patches that are not scored (see patch_stride) receive an infinite score so
+// that GetNoiseLevel never considers them flat.
 std::vector<float> GetSADScoresForPatches(const Image3F& opsin,
                                           const int block_s, const int num_bin,
+                                          const size_t patch_stride,
+                                          ThreadPool* pool,
                                           Histogram* sad_histogram) {
-  std::vector<float> sad_scores(
-      (opsin.ysize() / block_s) * (opsin.xsize() / block_s), 0.0f);
-
-  int block_index = 0;
-
-  for (int y = 0; y + block_s <= opsin.ysize(); y += block_s) {
-    for (int x = 0; x + block_s <= opsin.xsize(); x += block_s) {
+  const size_t patches_x = opsin.xsize() / block_s;
+  const size_t patches_y = opsin.ysize() / block_s;
+  std::vector<float> sad_scores(patches_y * patches_x,
+                                std::numeric_limits<float>::infinity());
+
+  // Rows of patches are independent; the histogram is built afterwards in
+  // patch order, so the result does not depend on the number of threads.
+  const size_t sampled_rows = DivCeil(patches_y, patch_stride);
+  pool->Run(0, sampled_rows, [&](const int task, const int thread) {
+    const size_t py = task * patch_stride;
+    const int y = py * block_s;
+    for (size_t px = 0; px < patches_x; px += patch_stride) {
       // We assume that we work with Y opsin channel [-0.5, 0.5]
-      float sad_sc = GetScoreSumsOfAbsoluteDifferences(opsin, x, y, block_s);
-      sad_scores[block_index++] = sad_sc;
-      sad_histogram->Increment(sad_sc * num_bin);
+      sad_scores[py * patches_x + px] =
+          GetScoreSumsOfAbsoluteDifferences(opsin, px * block_s, y, block_s);
+    }
+  });
+
+  for (size_t py = 0; py < patches_y; py += patch_stride) {
+    for (size_t px = 0; px < patches_x; px += patch_stride) {
+      sad_histogram->Increment(sad_scores[py * patches_x + px] * num_bin);
     }
   }
   return sad_scores;
@@ -105,227 +96,24 @@ float GetSADThreshold(const Histogram& histogram, const int num_bin) {
   return static_cast<float>(mode) / Histogram::kBins;
 }
 
-// x is in [0+delta, 1+delta], delta ~= 0.06
-template <class StrengthEval>
-typename StrengthEval::V NoiseStrength(const StrengthEval& eval,
-                                       const typename StrengthEval::V x) {
-  const typename StrengthEval::D d;
-  return Clamp0ToMax(d, eval(x), set1(d, 1.0f));
-}
-
-// General case: slow but precise.
-class StrengthEvalPow {
- public:
-  using D = Scalar<float>;
-  using V = D::V;
-
-  StrengthEvalPow(const NoiseParams& noise_params)
-      : noise_params_(noise_params) {}
-
-  V operator()(const V vx) const {
-    float x;
-    store(vx, D(), &x);
-    return set1(D(), noise_params_.alpha * std::pow(x, noise_params_.gamma) +
-                         noise_params_.beta);
-  }
-
- private:
-  const NoiseParams noise_params_;
-};
-
-// For noise_params.alpha == 0: cheaper to evaluate than a polynomial and
-// avoids BLAS errors in RationalPolynomial.
-template <class D_Arg>
-class StrengthEvalLinear {
- public:
-  using D = D_Arg;
-  using V = typename D::V;
-
-  StrengthEvalLinear(const NoiseParams& noise_params)
-      : strength_(set1(D(), noise_params.beta)) {}
-
-  V operator()(const V x) const { return strength_; }
-
- private:
-  V strength_;
-};
-
-// Uses rational polynomial - faster than Pow.
-template <class D_Arg>
-class StrengthEvalPoly {
-  // Max err < 1E-6.
-  static constexpr size_t kDegreeP = 3;
-  static constexpr size_t kDegreeQ = 2;
-  using Polynomial =
-      SIMD_NAMESPACE::RationalPolynomial<D_Arg, kDegreeP, kDegreeQ>;
-
- public:
-  using D = D_Arg;
-  using V = typename D::V;
-
-  static Polynomial InitPoly() {
-    const float p[kDegreeP + 1] = {
-        2.8334176974065262E-05, -4.0383997904166469E-03, 1.3657279781005727E-01,
-        1.0765042185381457E+00};
-    const float q[kDegreeQ + 1] = {7.6921408240996481E-01,
-                                   5.2686210349332230E-01,
-                                   -8.7053691084335916E-02};
-    return Polynomial(p, q);
-  }
-
-  StrengthEvalPoly(const NoiseParams& noise_params)
-      : poly_(InitPoly()),
-        mul_(set1(D(), noise_params.alpha)),
-        add_(set1(D(), noise_params.beta)) {}
-
-  PIK_INLINE V operator()(const V x) const {
-    return mul_add(mul_, poly_(x), add_);
-  }
-
- private:
-  Polynomial poly_;
-  const V mul_;
-  const V add_;
-};
-
-template <class D>
-void AddNoiseToRGB(const typename D::V rnd_noise_r,
-                   const typename D::V rnd_noise_g,
-                   const typename D::V rnd_noise_cor,
-                   const typename D::V noise_strength_g,
-                   const typename D::V noise_strength_r,
-                   float* PIK_RESTRICT out_x, float* PIK_RESTRICT out_y,
-                   float* PIK_RESTRICT out_b) {
-  const D d;
-  const auto kRGCorr = set1(d, 0.9f);
-  const auto kRGNCorr = set1(d, 0.1f);
-
-  const auto red_noise = kRGNCorr * rnd_noise_r * noise_strength_r +
-                         kRGCorr * rnd_noise_cor * noise_strength_r;
-  const auto green_noise = kRGNCorr * rnd_noise_g * noise_strength_g +
-                           kRGCorr * rnd_noise_cor * noise_strength_g;
-
-  auto vx = load(d, out_x);
-  auto vy = load(d, out_y);
-  auto vb = load(d, out_b);
-
-  vx += red_noise - green_noise;
-  vy += red_noise + green_noise;
-  vb += set1(d, 0.9375f) * (red_noise + green_noise);
-
-  vx = clamp(vx, set1(d, -kXybRange[0]), set1(d, kXybRange[0]));
-  vy = clamp(vy, set1(d, -kXybRange[1]), set1(d, kXybRange[1]));
-  vb = clamp(vb, set1(d, -kXybRange[2]), set1(d, kXybRange[2]));
-
-  store(vx, d, out_x);
-  store(vy, d, out_y);
-  store(vb, d, out_b);
-}
+}  // namespace
 
-template <class StrengthEval>
-void AddNoiseT(const StrengthEval& noise_model, Image3F* opsin) {
-  using D = typename StrengthEval::D;
-  const D d;
-  const auto half = set1(d, 0.5f);
-
-  const size_t xsize = opsin->xsize();
-  const size_t ysize = opsin->ysize();
-
-  Xorshift128Plus rng(65537, 123456789);
-  ImageF temp(xsize, ysize);
-  const ImageF& rnd_noise_red = RandomImage(&temp, &rng);
-  const ImageF& rnd_noise_green = RandomImage(&temp, &rng);
-  const ImageF& rnd_noise_correlated = RandomImage(&temp, &rng);
-
-  // With the prior subtract-random Laplacian approximation, rnd_* ranges were
-  // about [-1.5, 1.6]; Laplacian3 about doubles this to [-3.6, 3.6], so the
-  // normalizer is half of what it was before (0.5).
-  const auto norm_const = set1(d, 0.22f);
-
-  for (size_t y = 0; y < ysize; ++y) {
-    float* PIK_RESTRICT row_x = opsin->PlaneRow(0, y);
-    float* PIK_RESTRICT row_y = opsin->PlaneRow(1, y);
-    float* PIK_RESTRICT row_b = opsin->PlaneRow(2, y);
-    const float* PIK_RESTRICT row_rnd_r = rnd_noise_red.Row(y);
-    const float* PIK_RESTRICT row_rnd_g = rnd_noise_green.Row(y);
-    const float* PIK_RESTRICT row_rnd_c = rnd_noise_correlated.Row(y);
-    for (size_t x = 0; x < xsize; x += d.N) {
-      const auto vx = load(d, row_x + x);
-      const auto vy = load(d, row_y + x);
-      const auto in_g = half * (vy - vx);
-      const auto in_r = half * (vy + vx);
-      const auto clamped_g =
-          clamp(in_g, set1(d, -kXybRange[1]), set1(d, kXybRange[1]));
-      const auto clamped_r =
-          clamp(in_r, set1(d, -kXybRange[1]), set1(d, kXybRange[1]));
-      const auto noise_strength_g =
-          NoiseStrength(noise_model, clamped_g + set1(d, kXybCenter[1]));
-      const auto noise_strength_r =
-          NoiseStrength(noise_model, clamped_r + set1(d, kXybCenter[1]));
-      const auto addit_rnd_noise_red = load(d, row_rnd_r + x) * norm_const;
-      const auto addit_rnd_noise_green = load(d, row_rnd_g + x) * norm_const;
-      const auto addit_rnd_noise_correlated =
-          load(d, row_rnd_c + x) * norm_const;
-      AddNoiseToRGB<D>(addit_rnd_noise_red, addit_rnd_noise_green,
-                       addit_rnd_noise_correlated, noise_strength_g,
-                       noise_strength_r, row_x + x, row_y + x, row_b + x);
-    }
-  }
+void AddNoise(const NoiseParams& noise_params, ThreadPool* pool,
+              Image3F* opsin) {
+  dispatch::Dispatched<AddNoiseImpl, void(const NoiseParams&, ThreadPool*,
+                                          Image3F*)>::Get()(noise_params, pool,
+                                                            opsin);
 }
 
-// Returns max absolute error at uniformly spaced x.
-template <class EvalApprox>
-float MaxAbsError(const NoiseParams& noise_params,
-                  const EvalApprox& eval_approx) {
-  const StrengthEvalPow eval_pow(noise_params);
+namespace {
 
-  float max_abs_err = 0.0f;
-  const float x0 = -kXybRange[1] + kXybCenter[1];
-  const float x1 = kXybRange[1] + kXybCenter[1];
-  for (float x = x0; x < x1; x += 1E-1f) {
-    const Scalar<float> d1;
-    const Full<float> d;
-    const auto expected_v = NoiseStrength(eval_pow, set1(d1, x));
-    const auto actual_v = NoiseStrength(eval_approx, set1(d, x));
-    float expected;
-    SIMD_ALIGN float actual[d.N];
-    store(expected_v, d1, &expected);
-    store(actual_v, d, actual);
-    const float abs_err = std::abs(expected - actual[0]);
-    if (abs_err > max_abs_err) {
-      // printf("  x=%f %E %E = %E\n", x, expected, actual[0], abs_err);
-      max_abs_err = abs_err;
-    }
-  }
-  // printf("max abs %.2E\n", max_abs_err);
-  return max_abs_err;
-}
+// Points with a smaller (shifted) intensity are ignored by the fit.
+const double kMinFitIntensity = 1e-2;
+// Weight of the regularization term (see LossFunction).
+const double kRegul = 0.00005;
 
 }  // namespace
 
-void AddNoise(const NoiseParams& noise_params, Image3F* opsin) {
-  // SIMD descriptor.
-  using D = Full<float>;
-
-  if (noise_params.alpha == 0.0f) {
-    // No noise at all
-    if (noise_params.beta == 0.0f && noise_params.gamma == 0.0f) return;
-
-    // Constant noise strength independent of pixel intensity
-    AddNoiseT(StrengthEvalLinear<D>(noise_params), opsin);
-    return;
-  }
-
-  const StrengthEvalPoly<D> poly(noise_params);
-  if (MaxAbsError(noise_params, poly) < 1E-3f) {
-    AddNoiseT(poly, opsin);
-  } else {
-    printf("Reverting to pow: %.3f %.3f ^%.3f\n", noise_params.alpha,
-           noise_params.beta, noise_params.gamma);
-    AddNoiseT(StrengthEvalPow(noise_params), opsin);
-  }
-}
-
 // F(alpha, beta, gamma| x,y) = (1-n) * sum_i(y_i - (alpha x_i ^ gamma +
 // beta))^2 + n * alpha * gamma.
 struct LossFunction {
@@ -333,8 +121,7 @@ struct LossFunction {
 
   double Compute(const std::vector<double>& w, std::vector<double>* df) const {
     double loss_function = 0;
-    const double kEpsilon = 1e-2;
-    const double kRegul = 0.00005;
+    const double kEpsilon = kMinFitIntensity;
     (*df)[0] = 0;
     (*df)[1] = 0;
     (*df)[2] = 0;
@@ -380,7 +167,9 @@ void AddPointsForExtrapolation(std::vector<NoiseLevel>* noise_level) {
 }
 
 void GetNoiseParameter(const Image3F& opsin, NoiseParams* noise_params,
-                       float quality_coef) {
+                       float quality_coef, ThreadPool* pool,
+                       size_t patch_stride) {
+  PIK_CHECK(patch_stride != 0);
   // The size of a patch in decoder might be different from encoder's patch
   // size.
   // For encoder: the patch size should be big enough to estimate
@@ -389,8 +178,8 @@ void GetNoiseParameter(const Image3F& opsin, NoiseParams* noise_params,
   const int block_s = 8;
   const int kNumBin = 256;
   Histogram sad_histogram;
-  std::vector<float> sad_scores =
-      GetSADScoresForPatches(opsin, block_s, kNumBin, &sad_histogram);
+  std::vector<float> sad_scores = GetSADScoresForPatches(
+      opsin, block_s, kNumBin, patch_stride, pool, &sad_histogram);
   float sad_threshold = GetSADThreshold(sad_histogram, kNumBin);
   // If threshold is too large, the image has a strong pattern. This pattern
   // fools our model and it will add too much noise. Therefore, we do not add
@@ -402,7 +191,7 @@ void GetNoiseParameter(const Image3F& opsin, NoiseParams* noise_params,
     return;
   }
   std::vector<NoiseLevel> nl =
-      GetNoiseLevel(opsin, sad_scores, sad_threshold, block_s);
+      GetNoiseLevel(opsin, sad_scores, sad_threshold, block_s, pool);
 
   AddPointsForExtrapolation(&nl);
   OptimizeNoiseParameters(nl, noise_params);
@@ -462,32 +251,153 @@ bool DecodeNoise(BitReader* br, NoiseParams* noise_params) {
   return true;
 }
 
+namespace {
+
+// Samples of the noise model in the domain of LossFunction.
+struct NoiseFitPoints {
+  explicit NoiseFitPoints(const std::vector<NoiseLevel>& noise_level) {
+    for (const NoiseLevel& nl : noise_level) {
+      const double shifted_intensity = nl.intensity + kXybCenter[1];
+      if (shifted_intensity > kMinFitIntensity) {
+        log_x.push_back(std::log(shifted_intensity));
+        y.push_back(nl.noise_level);
+      }
+    }
+  }
+
+  std::vector<double> log_x;  // log of the shifted intensity.
+  std::vector<double> y;      // noise level.
+};
+
+// For a fixed "gamma", LossFunction is quadratic in alpha and beta, so its
+// minimum is the solution of the 2x2 normal equations of a linear least-
+// squares fit (plus the linear regularization term). Returns the loss and
+// stores the minimizing alpha and beta.
+double FitNoiseParametersForGamma(const NoiseFitPoints& points,
+                                  const double gamma, double* alpha,
+                                  double* beta) {
+  const size_t n = points.y.size();
+  double sum_p = 0.0, sum_pp = 0.0, sum_y = 0.0, sum_py = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    const double p = std::exp(gamma * points.log_x[i]);
+    sum_p += p;
+    sum_pp += p * p;
+    sum_y += points.y[i];
+    sum_py += p * points.y[i];
+  }
+
+  // Minimizes (1-r) * sum_i (y_i - a p_i - b)^2 + r * n * a * gamma:
+  //   [sum_pp sum_p] [a]   [sum_py - r * n * gamma / (2 * (1-r))]
+  //   [sum_p  n    ] [b] = [sum_y                               ]
+  const double rhs_a = sum_py - kRegul * n * gamma / (2.0 * (1.0 - kRegul));
+  const double det = sum_pp * n - sum_p * sum_p;
+  if (std::abs(det) <= 1E-12 * sum_pp * n) {
+    // All p_i are equal (e.g. a single point): only the offset is determined.
+    *alpha = 0.0;
+    *beta = sum_y / n;
+  } else {
+    *alpha = (rhs_a * n - sum_p * sum_y) / det;
+    *beta = (sum_pp * sum_y - sum_p * rhs_a) / det;
+  }
+
+  double loss = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    const double p = std::exp(gamma * points.log_x[i]);
+    const double residual = points.y[i] - (*alpha * p + *beta);
+    loss += (1.0 - kRegul) * residual * residual + kRegul * *alpha * gamma;
+  }
+  return loss;
+}
+
+}  // namespace
+
 void OptimizeNoiseParameters(const std::vector<NoiseLevel>& noise_level,
-                             NoiseParams* noise_params) {
-  static const double kPrecision = 1e-8;
-  static const int kMaxIter = 1000;
+                             NoiseParams* noise_params, const bool refine) {
+  const NoiseFitPoints points(noise_level);
+  if (points.y.empty()) {
+    noise_params->alpha = noise_params->gamma = noise_params->beta = 0.0f;
+    return;
+  }
 
-  LossFunction loss_function(noise_level);
-  std::vector<double> parameter_vector(3);
-  parameter_vector[0] = -0.05;
-  parameter_vector[1] = 2.6;
-  parameter_vector[2] = 0.025;
+  // The loss is a smooth function of gamma alone once alpha and beta are
+  // chosen optimally. Scan a grid to avoid local minima, then refine the best
+  // interval by golden-section search.
+  const double kMinGamma = 0.1;
+  const double kMaxGamma = 8.0;
+  const double kGammaStep = 0.1;
+  double best_gamma = kMinGamma;
+  double best_loss = std::numeric_limits<double>::max();
+  // EncodeFloatParam stores 16 bits at kNoisePrecision; steep fits to
+  // clustered intensities may otherwise need larger coefficients.
+  const double kMaxAbsParam = 65.0;
+  double alpha, beta;
+  for (double gamma = kMinGamma; gamma <= kMaxGamma; gamma += kGammaStep) {
+    const double loss =
+        FitNoiseParametersForGamma(points, gamma, &alpha, &beta);
+    if (loss < best_loss && std::abs(alpha) < kMaxAbsParam &&
+        std::abs(beta) < kMaxAbsParam) {
+      best_loss = loss;
+      best_gamma = gamma;
+    }
+  }
+  if (best_loss == std::numeric_limits<double>::max()) {
+    noise_params->alpha = noise_params->gamma = noise_params->beta = 0.0f;
+    return;
+  }
 
-  parameter_vector = optimize::OptimizeWithScaledConjugateGradientMethod(
-      loss_function, parameter_vector, kPrecision, kMaxIter);
+  const double kInvPhi = 0.6180339887498949;
+  double lo = std::max(best_gamma - kGammaStep, kMinGamma);
+  double hi = std::min(best_gamma + kGammaStep, kMaxGamma);
+  double g1 = hi - kInvPhi * (hi - lo);
+  double g2 = lo + kInvPhi * (hi - lo);
+  double loss1 = FitNoiseParametersForGamma(points, g1, &alpha, &beta);
+  double loss2 = FitNoiseParametersForGamma(points, g2, &alpha, &beta);
+  while (hi - lo > 1E-6) {
+    if (loss1 < loss2) {
+      hi = g2;
+      g2 = g1;
+      loss2 = loss1;
+      g1 = hi - kInvPhi * (hi - lo);
+      loss1 = FitNoiseParametersForGamma(points, g1, &alpha, &beta);
+    } else {
+      lo = g1;
+      g1 = g2;
+      loss1 = loss2;
+      g2 = lo + kInvPhi * (hi - lo);
+      loss2 = FitNoiseParametersForGamma(points, g2, &alpha, &beta);
+    }
+  }
+  double gamma = 0.5 * (lo + hi);
+  FitNoiseParametersForGamma(points, gamma, &alpha, &beta);
+  if (std::abs(alpha) >= kMaxAbsParam || std::abs(beta) >= kMaxAbsParam) {
+    gamma = best_gamma;
+    FitNoiseParametersForGamma(points, gamma, &alpha, &beta);
+  }
+
+  std::vector<double> parameter_vector = {alpha, gamma, beta};
+  if (refine) {
+    static const double kPrecision = 1e-8;
+    static const int kMaxIter = 1000;
+    LossFunction loss_function(noise_level);
+    parameter_vector = optimize::OptimizeWithScaledConjugateGradientMethod(
+        loss_function, parameter_vector, kPrecision, kMaxIter);
+  }
 
   noise_params->alpha = parameter_vector[0];
   noise_params->gamma = parameter_vector[1];
   noise_params->beta = parameter_vector[2];
 }
 
-std::vector<float> GetTextureStrength(const Image3F& opsin, const int block_s) {
-  std::vector<float> texture_strength_index((opsin.ysize() / block_s) *
-                                            (opsin.xsize() / block_s));
-  int block_index = 0;
+std::vector<float> GetTextureStrength(const Image3F& opsin, const int block_s,
+                                      ThreadPool* pool) {
+  const int patches_x = opsin.xsize() / block_s;
+  const int patches_y = opsin.ysize() / block_s;
+  std::vector<float> texture_strength_index(patches_y * patches_x);
 
-  for (int y = 0; y + block_s <= opsin.ysize(); y += block_s) {
-    for (int x = 0; x + block_s <= opsin.xsize(); x += block_s) {
+  pool->Run(0, patches_y, [&](const int py, const int thread) {
+    const int y = py * block_s;
+    for (int px = 0; px < patches_x; ++px) {
+      const int x = px * block_s;
       float texture_strength = 0;
       for (int y_bl = 0; y_bl < block_s; ++y_bl) {
         for (int x_bl = 0; x_bl + 1 < block_s; ++x_bl) {
@@ -503,10 +413,9 @@ std::vector<float> GetTextureStrength(const Image3F& opsin, const int block_s) {
           texture_strength += diff * diff;
         }
       }
-      texture_strength_index[block_index] = texture_strength;
-      ++block_index;
+      texture_strength_index[py * patches_x + px] = texture_strength;
     }
-  }
+  });
   return texture_strength_index;
 }
 
@@ -519,8 +428,7 @@ float GetThresholdFlatIndices(const std::vector<float>& texture_strength,
 
 std::vector<NoiseLevel> GetNoiseLevel(
     const Image3F& opsin, const std::vector<float>& texture_strength,
-    const float threshold, const int block_s) {
-  std::vector<NoiseLevel> noise_level_per_intensity;
+    const float threshold, const int block_s, ThreadPool* pool) {
 
   const int filt_size = 1;
   static const float kLaplFilter[filt_size * 2 + 1][filt_size * 2 + 1] = {
@@ -531,11 +439,17 @@ std::vector<NoiseLevel> GetNoiseLevel(
 
   // The noise model is build based on channel 0.5 * (X+Y) as we notices that it
   // is similar to the model 0.5 * (Y-X)
-  int patch_index = 0;
-
-  for (int y = 0; y + block_s <= opsin.ysize(); y += block_s) {
-    for (int x = 0; x + block_s <= opsin.xsize(); x += block_s) {
-      if (texture_strength[patch_index] <= threshold) {
+  const int patches_x = opsin.xsize() / block_s;
+  const int patches_y = opsin.ysize() / block_s;
+
+  // Each row of patches appends to its own vector; concatenating them in order
+  // yields the same result as a serial scan.
+  std::vector<std::vector<NoiseLevel>> levels_per_row(patches_y);
+  pool->Run(0, patches_y, [&](const int py, const int thread) {
+    const int y = py * block_s;
+    for (int px = 0; px < patches_x; ++px) {
+      const int x = px * block_s;
+      if (texture_strength[py * patches_x + px] <= threshold) {
         // Calculate mean value
         float mean_int = 0;
         for (int y_bl = 0; y_bl < block_s; ++y_bl) {
@@ -595,12 +509,34 @@ std::vector<NoiseLevel> GetNoiseLevel(
         NoiseLevel nl;
         nl.intensity = mean_int;
         nl.noise_level = noise_level;
-        noise_level_per_intensity.push_back(nl);
+        levels_per_row[py].push_back(nl);
       }
-      ++patch_index;
     }
+  });
+
+  std::vector<NoiseLevel> noise_level_per_intensity;
+  for (const std::vector<NoiseLevel>& levels : levels_per_row) {
+    noise_level_per_intensity.insert(noise_level_per_intensity.end(),
+                                     levels.begin(), levels.end());
   }
   return noise_level_per_intensity;
 }
 
+float MaxNoiseStrengthDifference(const NoiseParams& params1,
+                                 const NoiseParams& params2) {
+  // Same domain and clamping as NoiseStrength in noise_target.cc.
+  const auto strength = [](const NoiseParams& params, const float x) {
+    const float s = params.alpha * std::pow(x, params.gamma) + params.beta;
+    return std::min(std::max(s, 0.0f), 1.0f);
+  };
+  float max_diff = 0.0f;
+  const float x0 = -kXybRange[1] + kXybCenter[1];
+  const float x1 = kXybRange[1] + kXybCenter[1];
+  for (float x = x0; x < x1; x += 1E-2f) {
+    const float diff = std::abs(strength(params1, x) - strength(params2, x));
+    max_diff = std::max(max_diff, diff);
+  }
+  return max_diff;
+}
+
 }  // namespace pik
@@ -2,6 +2,7 @@
 #define NOISE_H_
 
 #include "bit_reader.h"
+#include "data_parallel.h"
 #include "image.h"
 
 namespace pik {
@@ -20,29 +21,54 @@ struct NoiseLevel {
   float intensity;
 };
 
-// Add a noise to Opsin image
-void AddNoise(const NoiseParams& noise_params, Image3F* opsin);
+// Add a noise to Opsin image. Bands of rows are processed in parallel; the
+// noise only depends on the pixel position, not on the number of threads.
+void AddNoise(const NoiseParams& noise_params, ThreadPool* pool,
+              Image3F* opsin);
 
-// Get parameters of the noise for NoiseParams model
+// Per-target implementation of AddNoise (noise_target.cc), called via
+// dispatch::Run.
+struct AddNoiseImpl {
+  template <class Target>
+  void operator()(const NoiseParams& noise_params, ThreadPool* pool,
+                  Image3F* opsin) const;
+};
+
+// Get parameters of the noise for NoiseParams model. Patches are scored in
+// parallel on "pool". If "patch_stride" > 1, only every patch_stride-th patch
+// in each direction (a fixed sparse grid) is scored, which is faster but less
+// precise (see MaxNoiseStrengthDifference).
 void GetNoiseParameter(const Image3F& opsin, NoiseParams* noise_params,
-                       float quality_coef);
+                       float quality_coef, ThreadPool* pool,
+                       size_t patch_stride = 1);
+
+// Returns the maximum absolute difference between the noise strengths of two
+// models over the range of opsin intensities, e.g. to bound the error of a
+// subsampled estimate versus the full scan.
+float MaxNoiseStrengthDifference(const NoiseParams& params1,
+                                 const NoiseParams& params2);
 
 std::string EncodeNoise(const NoiseParams& noise_params);
 
 bool DecodeNoise(BitReader* br, NoiseParams* noise_params);
 
 // Texture Strength is defined as tr(A), A = [Gh, Gv]^T[[Gh, Gv]]
-std::vector<float> GetTextureStrength(const Image3F& opsin, const int block_s);
+std::vector<float> GetTextureStrength(const Image3F& opsin, const int block_s,
+                                      ThreadPool* pool);
 
 float GetThresholdFlatIndices(const std::vector<float>& texture_strength,
                               const int n_patches);
 
 std::vector<NoiseLevel> GetNoiseLevel(
     const Image3F& opsin, const std::vector<float>& texture_strength,
-    const float threshold, const int block_s);
+    const float threshold, const int block_s, ThreadPool* pool);
 
+// Fits the NoiseParams model to "noise_level" by least squares. For each
+// gamma, alpha and beta have a closed-form solution, so only gamma is searched
+// (a grid and then golden-section search). If "refine", the result is then
+// refined by the iterative optimizer (optimize.h), which is rarely worthwhile.
 void OptimizeNoiseParameters(const std::vector<NoiseLevel>& noise_level,
-                             NoiseParams* noise_params);
+                             NoiseParams* noise_params, bool refine = false);
 }  // namespace pik
 
 #endif  // NOISE_H_
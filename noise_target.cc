@@ -0,0 +1,334 @@
+// Compiled once per SIMD target (see CMakeLists.txt); AddNoise selects the
+// best one via dispatch::Run.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "common.h"
+#include "noise.h"
+#include "opsin_params.h"
+#include "rational_polynomial.h"
+#include "simd_helpers.h"
+#include "xorshift128plus.h"
+
+namespace pik {
+namespace SIMD_NAMESPACE {
+namespace {
+
+// Rows per AddNoise task. Each band also generates the random rows just above
+// and below it, so larger bands amortize that overhead.
+constexpr size_t kNoiseBandRows = 64;
+
+// Ring buffer of three consecutive rows of uniform random values for each of
+// the three noise channels, plus their Laplacian. Each row is generated by its
+// own generator seeded from its channel and row index, so the noise does not
+// depend on the band (and thus thread) that generates it.
+class NoiseRows {
+  using D = Full<float>;
+
+ public:
+  // "xsize" and "ysize" are the image dimensions.
+  NoiseRows(const size_t xsize, const size_t ysize)
+      : xsize_(xsize),
+        ysize_(ysize),
+        rows_(kPad + xsize + kPad, 3 * kRingSize) {}
+
+  // Generates rows y - 1 and y, i.e. prepares Laplacian(y).
+  void Init(const int64_t y) {
+    for (int c = 0; c < 3; ++c) {
+      Generate(c, y - 1);
+      Generate(c, y);
+    }
+  }
+
+  // Stores the Laplacian of the random row y of each channel into "out" and
+  // generates row y + 1. Requires a prior call with y - 1 (or Init(y)).
+  void Laplacian(const int64_t y, float* PIK_RESTRICT out[3]) {
+    const D d;
+    const auto four = set1(d, 4.0f);
+    for (int c = 0; c < 3; ++c) {
+      Generate(c, y + 1);
+      const float* PIK_RESTRICT row_t = Row(c, y - 1);
+      const float* PIK_RESTRICT row_m = Row(c, y);
+      const float* PIK_RESTRICT row_b = Row(c, y + 1);
+      for (size_t x = 0; x < xsize_; x += d.N) {
+        const auto sum_tb = load(d, row_t + x) + load(d, row_b + x);
+        const auto sum_lr =
+            load_unaligned(d, row_m + x - 1) + load_unaligned(d, row_m + x + 1);
+        const auto center = load(d, row_m + x);
+        store(sum_tb + sum_lr - center * four, d, out[c] + x);
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kRingSize = 3;
+  static constexpr size_t kPad = D::N;  // keeps the pixels aligned
+
+  float* Row(const int c, const int64_t y) {
+    const size_t slot = static_cast<size_t>(y + kRingSize) % kRingSize;
+    return rows_.Row(c * kRingSize + slot) + kPad;
+  }
+
+  // Random values in [0, 1) for row y of channel c, mirrored at the borders.
+  void Generate(const int c, const int64_t y) {
+    const D d;
+    const Full<uint32_t> du;
+    const uint64_t row_index = Mirror(y, ysize_);
+    Xorshift128Plus rng((row_index << 2) | c);
+
+    float* PIK_RESTRICT row = Row(c, y);
+    for (size_t x = 0; x < xsize_; x += d.N) {
+      const auto bits = cast_to(du, rng());
+      // 1.0 + 23 random mantissa bits = [1, 2)
+      const auto rand12 =
+          cast_to(d, shift_right<9>(bits) | set1(du, 0x3F800000));
+      store(rand12 - set1(d, 1.0f), d, row + x);
+    }
+    row[-1] = row[0];
+    row[xsize_] = row[xsize_ - 1];
+  }
+
+  const size_t xsize_;
+  const size_t ysize_;
+  ImageF rows_;
+};
+
+// x is in [0+delta, 1+delta], delta ~= 0.06
+template <class StrengthEval>
+typename StrengthEval::V NoiseStrength(const StrengthEval& eval,
+                                       const typename StrengthEval::V x) {
+  const typename StrengthEval::D d;
+  return Clamp0ToMax(d, eval(x), set1(d, 1.0f));
+}
+
+// General case: slow but precise.
+class StrengthEvalPow {
+ public:
+  using D = Scalar<float>;
+  using V = D::V;
+
+  StrengthEvalPow(const NoiseParams& noise_params)
+      : noise_params_(noise_params) {}
+
+  V operator()(const V vx) const {
+    float x;
+    store(vx, D(), &x);
+    return set1(D(), noise_params_.alpha * std::pow(x, noise_params_.gamma) +
+                         noise_params_.beta);
+  }
+
+ private:
+  const NoiseParams noise_params_;
+};
+
+// For noise_params.alpha == 0: cheaper to evaluate than a polynomial and
+// avoids BLAS errors in RationalPolynomial.
+template <class D_Arg>
+class StrengthEvalLinear {
+ public:
+  using D = D_Arg;
+  using V = typename D::V;
+
+  StrengthEvalLinear(const NoiseParams& noise_params)
+      : strength_(set1(D(), noise_params.beta)) {}
+
+  V operator()(const V x) const { return strength_; }
+
+ private:
+  V strength_;
+};
+
+// Uses rational polynomial - faster than Pow.
+template <class D_Arg>
+class StrengthEvalPoly {
+  // Max err < 1E-6.
+  static constexpr size_t kDegreeP = 3;
+  static constexpr size_t kDegreeQ = 2;
+  using Polynomial =
+      SIMD_NAMESPACE::RationalPolynomial<D_Arg, kDegreeP, kDegreeQ>;
+
+ public:
+  using D = D_Arg;
+  using V = typename D::V;
+
+  static Polynomial InitPoly() {
+    const float p[kDegreeP + 1] = {
+        2.8334176974065262E-05, -4.0383997904166469E-03, 1.3657279781005727E-01,
+        1.0765042185381457E+00};
+    const float q[kDegreeQ + 1] = {7.6921408240996481E-01,
+                                   5.2686210349332230E-01,
+                                   -8.7053691084335916E-02};
+    return Polynomial(p, q);
+  }
+
+  StrengthEvalPoly(const NoiseParams& noise_params)
+      : poly_(InitPoly()),
+        mul_(set1(D(), noise_params.alpha)),
+        add_(set1(D(), noise_params.beta)) {}
+
+  PIK_INLINE V operator()(const V x) const {
+    return mul_add(mul_, poly_(x), add_);
+  }
+
+ private:
+  Polynomial poly_;
+  const V mul_;
+  const V add_;
+};
+
+template <class D>
+void AddNoiseToRGB(const typename D::V rnd_noise_r,
+                   const typename D::V rnd_noise_g,
+                   const typename D::V rnd_noise_cor,
+                   const typename D::V noise_strength_g,
+                   const typename D::V noise_strength_r,
+                   float* PIK_RESTRICT out_x, float* PIK_RESTRICT out_y,
+                   float* PIK_RESTRICT out_b) {
+  const D d;
+  const auto kRGCorr = set1(d, 0.9f);
+  const auto kRGNCorr = set1(d, 0.1f);
+
+  const auto red_noise = kRGNCorr * rnd_noise_r * noise_strength_r +
+                         kRGCorr * rnd_noise_cor * noise_strength_r;
+  const auto green_noise = kRGNCorr * rnd_noise_g * noise_strength_g +
+                           kRGCorr * rnd_noise_cor * noise_strength_g;
+
+  auto vx = load(d, out_x);
+  auto vy = load(d, out_y);
+  auto vb = load(d, out_b);
+
+  vx += red_noise - green_noise;
+  vy += red_noise + green_noise;
+  vb += set1(d, 0.9375f) * (red_noise + green_noise);
+
+  vx = clamp(vx, set1(d, -kXybRange[0]), set1(d, kXybRange[0]));
+  vy = clamp(vy, set1(d, -kXybRange[1]), set1(d, kXybRange[1]));
+  vb = clamp(vb, set1(d, -kXybRange[2]), set1(d, kXybRange[2]));
+
+  store(vx, d, out_x);
+  store(vy, d, out_y);
+  store(vb, d, out_b);
+}
+
+template <class StrengthEval>
+void AddNoiseT(const StrengthEval& noise_model, ThreadPool* pool,
+               Image3F* opsin) {
+  using D = typename StrengthEval::D;
+  const D d;
+  const auto half = set1(d, 0.5f);
+
+  const size_t xsize = opsin->xsize();
+  const size_t ysize = opsin->ysize();
+
+  // With the prior subtract-random Laplacian approximation, rnd_* ranges were
+  // about [-1.5, 1.6]; Laplacian3 about doubles this to [-3.6, 3.6], so the
+  // normalizer is half of what it was before (0.5).
+  const auto norm_const = set1(d, 0.22f);
+
+  // The random rows are generated and convolved within each band, so no
+  // image-sized random planes are needed.
+  const size_t num_bands = DivCeil(ysize, kNoiseBandRows);
+  pool->Run(0, num_bands, [&](const int task, const int thread) {
+    const size_t y0 = task * kNoiseBandRows;
+    const size_t y1 = std::min(y0 + kNoiseBandRows, ysize);
+    NoiseRows noise_rows(xsize, ysize);
+    noise_rows.Init(y0);
+    ImageF rnd_noise(xsize, 3);
+    float* PIK_RESTRICT rows_rnd[3] = {rnd_noise.Row(0), rnd_noise.Row(1),
+                                       rnd_noise.Row(2)};
+
+    for (size_t y = y0; y < y1; ++y) {
+      noise_rows.Laplacian(y, rows_rnd);
+
+      float* PIK_RESTRICT row_x = opsin->PlaneRow(0, y);
+      float* PIK_RESTRICT row_y = opsin->PlaneRow(1, y);
+      float* PIK_RESTRICT row_b = opsin->PlaneRow(2, y);
+      const float* PIK_RESTRICT row_rnd_r = rows_rnd[0];
+      const float* PIK_RESTRICT row_rnd_g = rows_rnd[1];
+      const float* PIK_RESTRICT row_rnd_c = rows_rnd[2];
+      for (size_t x = 0; x < xsize; x += d.N) {
+        const auto vx = load(d, row_x + x);
+        const auto vy = load(d, row_y + x);
+        const auto in_g = half * (vy - vx);
+        const auto in_r = half * (vy + vx);
+        const auto clamped_g =
+            clamp(in_g, set1(d, -kXybRange[1]), set1(d, kXybRange[1]));
+        const auto clamped_r =
+            clamp(in_r, set1(d, -kXybRange[1]), set1(d, kXybRange[1]));
+        const auto noise_strength_g =
+            NoiseStrength(noise_model, clamped_g + set1(d, kXybCenter[1]));
+        const auto noise_strength_r =
+            NoiseStrength(noise_model, clamped_r + set1(d, kXybCenter[1]));
+        const auto addit_rnd_noise_red = load(d, row_rnd_r + x) * norm_const;
+        const auto addit_rnd_noise_green = load(d, row_rnd_g + x) * norm_const;
+        const auto addit_rnd_noise_correlated =
+            load(d, row_rnd_c + x) * norm_const;
+        AddNoiseToRGB<D>(addit_rnd_noise_red, addit_rnd_noise_green,
+                         addit_rnd_noise_correlated, noise_strength_g,
+                         noise_strength_r, row_x + x, row_y + x, row_b + x);
+      }
+    }
+  });
+}
+
+// Returns max absolute error at uniformly spaced x.
+template <class EvalApprox>
+float MaxAbsError(const NoiseParams& noise_params,
+                  const EvalApprox& eval_approx) {
+  const StrengthEvalPow eval_pow(noise_params);
+
+  float max_abs_err = 0.0f;
+  const float x0 = -kXybRange[1] + kXybCenter[1];
+  const float x1 = kXybRange[1] + kXybCenter[1];
+  for (float x = x0; x < x1; x += 1E-1f) {
+    const Scalar<float> d1;
+    const Full<float> d;
+    const auto expected_v = NoiseStrength(eval_pow, set1(d1, x));
+    const auto actual_v = NoiseStrength(eval_approx, set1(d, x));
+    float expected;
+    SIMD_ALIGN float actual[d.N];
+    store(expected_v, d1, &expected);
+    store(actual_v, d, actual);
+    const float abs_err = std::abs(expected - actual[0]);
+    if (abs_err > max_abs_err) {
+      // printf("  x=%f %E %E = %E\n", x, expected, actual[0], abs_err);
+      max_abs_err = abs_err;
+    }
+  }
+  // printf("max abs %.2E\n", max_abs_err);
+  return max_abs_err;
+}
+
+}  // namespace
+}  // namespace SIMD_NAMESPACE
+
+template <>
+void AddNoiseImpl::operator()<SIMD_TARGET>(const NoiseParams& noise_params,
+                                           ThreadPool* pool,
+                                           Image3F* opsin) const {
+  using namespace SIMD_NAMESPACE;
+  // SIMD descriptor.
+  using D = Full<float>;
+
+  if (noise_params.alpha == 0.0f) {
+    // No noise at all
+    if (noise_params.beta == 0.0f && noise_params.gamma == 0.0f) return;
+
+    // Constant noise strength independent of pixel intensity
+    AddNoiseT(StrengthEvalLinear<D>(noise_params), pool, opsin);
+    return;
+  }
+
+  const StrengthEvalPoly<D> poly(noise_params);
+  if (MaxAbsError(noise_params, poly) < 1E-3f) {
+    AddNoiseT(poly, pool, opsin);
+  } else {
+    printf("Reverting to pow: %.3f %.3f ^%.3f\n", noise_params.alpha,
+           noise_params.beta, noise_params.gamma);
+    AddNoiseT(StrengthEvalPow(noise_params), pool, opsin);
+  }
+}
+
+}  // namespace pik
@@ -15,14 +15,18 @@
 #include "opsin_image.h"
 
 #include <stddef.h>
+#include <algorithm>
 #include <array>
+#include <vector>
 
 #undef PROFILER_ENABLED
 #define PROFILER_ENABLED 1
 #include "approx_cube_root.h"
+#include "common.h"
 #include "compiler_specific.h"
 #include "gamma_correct.h"
 #include "profiler.h"
+#include "simd/simd.h"
 
 namespace pik {
 
@@ -59,47 +63,242 @@ void RgbToXyb(uint8_t r, uint8_t g, uint8_t b, float* PIK_RESTRICT valx,
   LinearToXyb(rgb, valx, valy, valz);
 }
 
-Image3F OpsinDynamicsImage(const Image3B& srgb) {
-  PROFILER_FUNC;
+namespace {
+
+// Centered X and B of neutral grays, sampled uniformly in centered Y.
+class GrayXybTable {
+ public:
+  static constexpr size_t kSize = 4096;
+
+  GrayXybTable() {
+    // Y of gray is monotonic in the linear intensity. Sample intensities more
+    // densely near black, where the cube root is steep, then resample the
+    // (Y, X, B) curve at uniformly spaced Y.
+    constexpr size_t kNumSamples = 4 * kSize;
+    std::vector<float> ys(kNumSamples), xs(kNumSamples), bs(kNumSamples);
+    for (size_t i = 0; i < kNumSamples; ++i) {
+      const float t = i / float(kNumSamples - 1);
+      const float v = 255.0f * t * t * t;
+      const float rgb[3] = {v, v, v};
+      LinearToXyb(rgb, &xs[i], &ys[i], &bs[i]);
+      xs[i] -= kXybCenter[0];
+      ys[i] -= kXybCenter[1];
+      bs[i] -= kXybCenter[2];
+    }
+
+    y0_ = ys.front();
+    const float step = (ys.back() - y0_) / (kSize - 1);
+    inv_step_ = 1.0f / step;
+    size_t i = 0;
+    for (size_t k = 0; k < kSize; ++k) {
+      const float y = y0_ + k * step;
+      while (i + 2 < kNumSamples && ys[i + 1] < y) ++i;
+      const float dy = ys[i + 1] - ys[i];
+      const float f =
+          dy > 0.0f ? std::min(std::max((y - ys[i]) / dy, 0.0f), 1.0f) : 0.0f;
+      x_[k] = xs[i] + f * (xs[i + 1] - xs[i]);
+      b_[k] = bs[i] + f * (bs[i + 1] - bs[i]);
+    }
+  }
+
+  void Lookup(const float y, float* PIK_RESTRICT x,
+              float* PIK_RESTRICT b) const {
+    const float pos = std::min(std::max((y - y0_) * inv_step_, 0.0f),
+                               static_cast<float>(kSize - 1));
+    const size_t k = std::min(static_cast<size_t>(pos), kSize - 2);
+    const float f = pos - k;
+    *x = x_[k] + f * (x_[k + 1] - x_[k]);
+    *b = b_[k] + f * (b_[k + 1] - b_[k]);
+  }
+
+ private:
+  float y0_;
+  float inv_step_;
+  float x_[kSize];
+  float b_[kSize];
+};
+
+}  // namespace
+
+void GrayXybFromY(const float* PIK_RESTRICT row_y, const size_t xsize,
+                  float* PIK_RESTRICT row_x, float* PIK_RESTRICT row_b) {
+  static const GrayXybTable* table = new GrayXybTable;
+  for (size_t x = 0; x < xsize; ++x) {
+    table->Lookup(row_y[x], &row_x[x], &row_b[x]);
+  }
+}
+
+void LinearRowToXyb(const float* PIK_RESTRICT row_in0,
+                    const float* PIK_RESTRICT row_in1,
+                    const float* PIK_RESTRICT row_in2, const size_t xsize,
+                    float* PIK_RESTRICT row_xyb0, float* PIK_RESTRICT row_xyb1,
+                    float* PIK_RESTRICT row_xyb2) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  using V = Full<float>::V;
+  const float* mix = &kOpsinAbsorbanceMatrix[0];
+  const float* bias = &kOpsinAbsorbanceBias[0];
+
+  for (size_t x = 0; x < xsize; x += d.N) {
+    const V r = load(d, row_in0 + x);
+    const V g = load(d, row_in1 + x);
+    const V b = load(d, row_in2 + x);
+    const V mixed0 = set1(d, mix[0]) * r + set1(d, mix[1]) * g +
+                     set1(d, mix[2]) * b + set1(d, bias[0]);
+    const V mixed1 = set1(d, mix[3]) * r + set1(d, mix[4]) * g +
+                     set1(d, mix[5]) * b + set1(d, bias[1]);
+    const V mixed2 = set1(d, mix[6]) * r + set1(d, mix[7]) * g +
+                     set1(d, mix[8]) * b + set1(d, bias[2]);
+    const V gamma0 = ApproxCubeRoot(d, mixed0);
+    const V gamma1 = ApproxCubeRoot(d, mixed1);
+    const V gamma2 = ApproxCubeRoot(d, mixed2);
+    const V half = set1(d, 0.5f);
+    store((set1(d, kScaleR) * gamma0 - set1(d, kScaleG) * gamma1) * half, d,
+          row_xyb0 + x);
+    store((set1(d, kScaleR) * gamma0 + set1(d, kScaleG) * gamma1) * half, d,
+          row_xyb1 + x);
+    store(gamma2, d, row_xyb2 + x);
+  }
+}
+
+namespace {
+
+// Pixels per stack buffer of linearized 8/16-bit input.
+constexpr size_t kChunkSize = 256;
+
+// Linearizes chunks of each row into a stack buffer, from which they are
+// converted to XYB. "load_chunk(y, x0, num, linear)" stores the linear float
+// RGB of pixels [x0, x0 + num) of row y into linear[c][0, num).
+template <class LoadChunk>
+Image3F OpsinDynamicsImageFromChunks(const size_t xsize, const size_t ysize,
+                                     const LoadChunk& load_chunk,
+                                     ThreadPool* pool) {
   // This is different from butteraugli::OpsinDynamicsImage() in the sense that
   // it does not contain a sensitivity multiplier based on the blurred image.
-  const size_t xsize = srgb.xsize();
-  const size_t ysize = srgb.ysize();
-  Image3F opsin(xsize, ysize);
-  for (size_t iy = 0; iy < ysize; iy++) {
-    const uint8_t* PIK_RESTRICT row_srgb0 = srgb.ConstPlaneRow(0, iy);
-    const uint8_t* PIK_RESTRICT row_srgb1 = srgb.ConstPlaneRow(1, iy);
-    const uint8_t* PIK_RESTRICT row_srgb2 = srgb.ConstPlaneRow(2, iy);
-    float* PIK_RESTRICT row_xyb0 = opsin.PlaneRow(0, iy);
-    float* PIK_RESTRICT row_xyb1 = opsin.PlaneRow(1, iy);
-    float* PIK_RESTRICT row_xyb2 = opsin.PlaneRow(2, iy);
-    for (size_t ix = 0; ix < xsize; ix++) {
-      RgbToXyb(row_srgb0[ix], row_srgb1[ix], row_srgb2[ix], &row_xyb0[ix],
-               &row_xyb1[ix], &row_xyb2[ix]);
+  // The encoder aligns the image to whole blocks, which is then possible
+  // without copying (see AlignImage).
+  Image3F opsin =
+      ImageWithCapacityForMultipleOf<Image3F>(xsize, ysize, kBlockWidth);
+  constexpr size_t N = SIMD_NAMESPACE::Full<float>::N;
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    SIMD_ALIGN float linear[3][kChunkSize];
+    for (size_t x0 = 0; x0 < xsize; x0 += kChunkSize) {
+      const size_t num = std::min(kChunkSize, xsize - x0);
+      load_chunk(y, x0, num, linear);
+      for (int c = 0; c < 3; ++c) {
+        // Avoids reading uninitialized lanes.
+        std::fill(linear[c] + num, linear[c] + DivCeil(num, N) * N, 0.0f);
+      }
+      LinearRowToXyb(linear[0], linear[1], linear[2], num,
+                     opsin.PlaneRow(0, y) + x0, opsin.PlaneRow(1, y) + x0,
+                     opsin.PlaneRow(2, y) + x0);
     }
-  }
+  });
   return opsin;
 }
 
-Image3F OpsinDynamicsImage(const Image3F& linear) {
+// Linearizes planar 8/16-bit input via "to_linear" (uint -> linear float).
+template <typename T, class ToLinear>
+Image3F OpsinDynamicsImageFromSrgb(const Image3<T>& srgb,
+                                   const ToLinear& to_linear,
+                                   ThreadPool* pool) {
+  return OpsinDynamicsImageFromChunks(
+      srgb.xsize(), srgb.ysize(),
+      [&srgb, &to_linear](const size_t y, const size_t x0, const size_t num,
+                          float linear[3][kChunkSize]) {
+        for (int c = 0; c < 3; ++c) {
+          const T* PIK_RESTRICT row_srgb = srgb.ConstPlaneRow(c, y) + x0;
+          for (size_t x = 0; x < num; ++x) {
+            linear[c][x] = to_linear(row_srgb[x]);
+          }
+        }
+      },
+      pool);
+}
+
+// Deinterleaves and linearizes in the same pass. "kR" and "kB" are the byte
+// offsets of red and blue within a pixel; alpha (if any) is at offset 3.
+template <size_t kBytesPerPixel, size_t kR, size_t kB>
+Image3F OpsinDynamicsImageFromInterleaved(const ConstInterleavedImageView& srgb,
+                                          ImageU* alpha, ThreadPool* pool) {
+  const float* lut = Srgb8ToLinearTable();
+  if (alpha != nullptr) *alpha = ImageU(srgb.xsize, srgb.ysize);
+  return OpsinDynamicsImageFromChunks(
+      srgb.xsize, srgb.ysize,
+      [&srgb, lut, alpha](const size_t y, const size_t x0, const size_t num,
+                          float linear[3][kChunkSize]) {
+        const uint8_t* PIK_RESTRICT row_in =
+            srgb.bytes + y * srgb.bytes_per_row + x0 * kBytesPerPixel;
+        for (size_t x = 0; x < num; ++x) {
+          const uint8_t* PIK_RESTRICT pixel = row_in + x * kBytesPerPixel;
+          linear[0][x] = lut[pixel[kR]];
+          linear[1][x] = lut[pixel[1]];
+          linear[2][x] = lut[pixel[kB]];
+        }
+        if (kBytesPerPixel == 4 && alpha != nullptr) {
+          uint16_t* PIK_RESTRICT row_alpha = alpha->Row(y) + x0;
+          for (size_t x = 0; x < num; ++x) {
+            row_alpha[x] = row_in[x * kBytesPerPixel + 3];
+          }
+        }
+      },
+      pool);
+}
+
+}  // namespace
+
+Image3F OpsinDynamicsImage(const Image3B& srgb, ThreadPool* pool) {
+  PROFILER_FUNC;
+  const float* lut = Srgb8ToLinearTable();
+  return OpsinDynamicsImageFromSrgb(
+      srgb, [lut](const uint8_t v) { return lut[v]; }, pool);
+}
+
+Image3F OpsinDynamicsImage(const Image3U& srgb, ThreadPool* pool,
+                           const int bit_depth) {
+  PROFILER_FUNC;
+  PIK_CHECK(bit_depth == 10 || bit_depth == 12 || bit_depth == 16);
+  // Same as LinearFromSrgb, but without evaluating pow per sample.
+  const float* lut = SrgbToLinearTable(bit_depth);
+  const uint16_t max_value = (1u << bit_depth) - 1;
+  return OpsinDynamicsImageFromSrgb(
+      srgb,
+      [lut, max_value](const uint16_t v) {
+        return lut[std::min(v, max_value)];
+      },
+      pool);
+}
+
+Image3F OpsinDynamicsImage(const ConstInterleavedImageView& srgb,
+                           ThreadPool* pool, ImageU* alpha) {
+  PROFILER_FUNC;
+  PIK_ASSERT(srgb.bytes_per_row >= srgb.xsize * BytesPerPixel(srgb.layout));
+  switch (srgb.layout) {
+    case PixelLayout::kRGB:
+      return OpsinDynamicsImageFromInterleaved<3, 0, 2>(srgb, nullptr, pool);
+    case PixelLayout::kRGBA:
+      return OpsinDynamicsImageFromInterleaved<4, 0, 2>(srgb, alpha, pool);
+    case PixelLayout::kBGRA:
+      return OpsinDynamicsImageFromInterleaved<4, 2, 0>(srgb, alpha, pool);
+  }
+  PIK_CHECK(false);
+  return Image3F();
+}
+
+Image3F OpsinDynamicsImage(const Image3F& linear, ThreadPool* pool) {
   PROFILER_FUNC;
   // This is different from butteraugli::OpsinDynamicsImage() in the sense that
   // it does not contain a sensitivity multiplier based on the blurred image.
   const size_t xsize = linear.xsize();
   const size_t ysize = linear.ysize();
   Image3F opsin(xsize, ysize);
-  for (size_t iy = 0; iy < ysize; iy++) {
-    const float* PIK_RESTRICT row_in0 = linear.ConstPlaneRow(0, iy);
-    const float* PIK_RESTRICT row_in1 = linear.ConstPlaneRow(1, iy);
-    const float* PIK_RESTRICT row_in2 = linear.ConstPlaneRow(2, iy);
-    float* PIK_RESTRICT row_xyb0 = opsin.PlaneRow(0, iy);
-    float* PIK_RESTRICT row_xyb1 = opsin.PlaneRow(1, iy);
-    float* PIK_RESTRICT row_xyb2 = opsin.PlaneRow(2, iy);
-    for (size_t ix = 0; ix < xsize; ix++) {
-      const float rgb[3] = {row_in0[ix], row_in1[ix], row_in2[ix]};
-      LinearToXyb(rgb, &row_xyb0[ix], &row_xyb1[ix], &row_xyb2[ix]);
-    }
-  }
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    LinearRowToXyb(linear.ConstPlaneRow(0, y), linear.ConstPlaneRow(1, y),
+                   linear.ConstPlaneRow(2, y), xsize, opsin.PlaneRow(0, y),
+                   opsin.PlaneRow(1, y), opsin.PlaneRow(2, y));
+  });
   return opsin;
 }
 
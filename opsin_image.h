@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "compiler_specific.h"
+#include "data_parallel.h"
 #include "image.h"
 #include "opsin_params.h"
 
@@ -34,13 +35,41 @@ PIK_INLINE void OpsinAbsorbance(const float in[3], float out[3]) {
 }
 
 // Returns the opsin dynamics image corresponding to the given SRGB input image.
-Image3F OpsinDynamicsImage(const Image3B& srgb);
+// Rows are converted in parallel; the 8 and 16-bit inputs are linearized per
+// row via SrgbToLinearTable, without allocating a linear float image. The
+// samples of "srgb" have "bit_depth" (10, 12 or 16) bits, e.g. from raw
+// high-bit-depth ingest; larger values are clamped.
+Image3F OpsinDynamicsImage(const Image3B& srgb, ThreadPool* pool);
+Image3F OpsinDynamicsImage(const Image3U& srgb, ThreadPool* pool,
+                           int bit_depth = 16);
 
-Image3F OpsinDynamicsImage(const Image3F& linear);
+// As above, but for 8-bit interleaved input, which is deinterleaved during the
+// conversion. If the layout has alpha and "alpha" is non-null, also stores the
+// alpha channel there (8 bits per sample).
+Image3F OpsinDynamicsImage(const ConstInterleavedImageView& srgb,
+                           ThreadPool* pool, ImageU* alpha = nullptr);
+
+Image3F OpsinDynamicsImage(const Image3F& linear, ThreadPool* pool);
+
+// Converts xsize linear RGB pixels to opsin dynamics (XYB). Rows must be
+// vector-aligned; reads/writes whole vectors, i.e. past xsize up to the end of
+// the (padded) rows.
+void LinearRowToXyb(const float* PIK_RESTRICT row_in0,
+                    const float* PIK_RESTRICT row_in1,
+                    const float* PIK_RESTRICT row_in2, const size_t xsize,
+                    float* PIK_RESTRICT row_xyb0, float* PIK_RESTRICT row_xyb1,
+                    float* PIK_RESTRICT row_xyb2);
 
 void RgbToXyb(uint8_t r, uint8_t g, uint8_t b, float *valx, float *valy,
               float *valz);
 
+// For neutral gray (R = G = B), opsin X and B are functions of Y. Sets
+// row_x/row_b to the X/B of the gray whose Y is row_y[x]. All values are
+// centered (kXybCenter subtracted); Y outside the range of gray inputs [0, 255]
+// is clamped. Used to reconstruct grayscale images, which only code Y.
+void GrayXybFromY(const float* PIK_RESTRICT row_y, const size_t xsize,
+                  float* PIK_RESTRICT row_x, float* PIK_RESTRICT row_b);
+
 }  // namespace pik
 
 #endif  // OPSIN_IMAGE_H_
@@ -24,7 +24,9 @@
 #include "data_parallel.h"
 #include "image.h"
 #include "opsin_params.h"
+#include "pik_params.h"
 #include "simd_helpers.h"
+#include "tile_flow.h"
 
 namespace pik {
 
@@ -32,7 +34,8 @@ namespace pik {
 // the gamma mixing and simple gamma), without clamping. "inverse_matrix" points
 // to 9 broadcasted vectors, which are the 3x3 entries of the (row-major)
 // opsin absorbance matrix inverse. Pre-multiplying its entries by c is
-// equivalent to multiplying linear_* by c afterwards.
+// equivalent to multiplying linear_* by c afterwards; likewise, a matrix that
+// also converts to other primaries is GetOpsinToLinearMatrix.
 template <class D, class V>
 PIK_INLINE void XybToRgbWithoutClamp(D d, const V opsin_x, const V opsin_y,
                                      const V opsin_b,
@@ -101,18 +104,116 @@ PIK_INLINE void XybToRgb(D d, const V opsin_x, const V opsin_y, const V opsin_b,
   *linear_b = Clamp0To255(d, *linear_b);
 }
 
+// Returns the 3x3 row-major matrix to use instead of the opsin absorbance
+// matrix inverse such that XybToRgb yields linear light with the given
+// primaries: their conversion from sRGB primaries times that inverse.
+const float* GetOpsinToLinearMatrix(ColorPrimaries primaries);
+
+// Optional alpha compositing for 8-bit sRGB outputs (see AlphaOutput): the
+// rounded result is srgb * a + background * (1 - a), a = alpha / max_alpha.
+// A zero background premultiplies.
+struct AlphaComposite {
+  // Same size as the color image ("alpha_bits" per sample).
+  const ImageU* alpha;
+  int alpha_bits;
+  uint8_t background;
+};
+
 // "dither" enables 2x2 dithering, but only if SIMD_TARGET_VALUE != SIMD_NONE
-// and the output is U8 (first overload).
+// and the output is U8 (first overload). "encoding" must be kSRGB for U8 and
+// must not be kLinearHalf for F32. "primaries" only changes the matrix, so
+// all of them are equally fast. "composite" must be null unless U8.
 void CenteredOpsinToSrgb(const Image3F& opsin, const bool dither,
-                         ThreadPool* pool, Image3B* srgb);
+                         ThreadPool* pool, Image3B* srgb,
+                         SampleEncoding encoding = SampleEncoding::kSRGB,
+                         ColorPrimaries primaries = ColorPrimaries::kSRGB,
+                         const AlphaComposite* composite = nullptr);
 void CenteredOpsinToSrgb(const Image3F& opsin, const bool dither,
-                         ThreadPool* pool, Image3U* srgb);
+                         ThreadPool* pool, Image3U* srgb,
+                         SampleEncoding encoding = SampleEncoding::kSRGB,
+                         ColorPrimaries primaries = ColorPrimaries::kSRGB,
+                         const AlphaComposite* composite = nullptr);
 void CenteredOpsinToSrgb(const Image3F& opsin, const bool dither,
-                         ThreadPool* pool, Image3F* srgb);
+                         ThreadPool* pool, Image3F* srgb,
+                         SampleEncoding encoding = SampleEncoding::kSRGB,
+                         ColorPrimaries primaries = ColorPrimaries::kSRGB,
+                         const AlphaComposite* composite = nullptr);
+
+// As above, but writes the first out.xsize x out.ysize pixels directly to the
+// caller's interleaved buffer, merging in "alpha" ("alpha_bits" per sample, or
+// opaque if null) in the same pass. Avoids a planar sRGB image and the
+// separate interleaving pass over it. If non-null, "composite" is applied to
+// the color before interleaving.
+void CenteredOpsinToInterleavedSrgb(
+    const Image3F& opsin, const bool dither, const ImageU* alpha,
+    int alpha_bits, ThreadPool* pool, const InterleavedImageView& out,
+    const AlphaComposite* composite = nullptr,
+    ColorPrimaries primaries = ColorPrimaries::kSRGB);
+
+// Adds a TFGraph node that converts its three centered opsin inputs to sRGB
+// of the given type (kU8, kU16 or kF32), e.g. as the sink of a decoder graph.
+// "dither", "encoding" and "primaries" have the same effect as for
+// CenteredOpsinToSrgb.
+TFNode* AddCenteredOpsinToSrgb(
+    const TFPorts in_opsin, bool dither, TFType out_type, TFBuilder* builder,
+    SampleEncoding encoding = SampleEncoding::kSRGB,
+    ColorPrimaries primaries = ColorPrimaries::kSRGB);
+
+// As above, but the kU8 output is composited with "in_alpha", a kU16 source
+// bound to composite.alpha.
+TFNode* AddCenteredOpsinToCompositedSrgb(
+    const TFPorts in_opsin, const TFPorts in_alpha, bool dither,
+    const AlphaComposite& composite, TFBuilder* builder,
+    ColorPrimaries primaries = ColorPrimaries::kSRGB);
 
 Image3B OpsinDynamicsInverse(const Image3F& opsin);
 Image3F LinearFromOpsin(const Image3F& opsin);
 
+// Per-target implementations, defined in opsin_inverse_target.cc.
+// CenteredOpsinToSrgb and AddCenteredOpsinToSrgb call these via dispatch::Run.
+
+struct CenteredOpsinToSrgbImpl {
+  template <class Target>
+  void operator()(const Image3F& opsin, bool dither, ThreadPool* pool,
+                  Image3B* srgb, ColorPrimaries primaries) const;
+  template <class Target>
+  void operator()(const Image3F& opsin, bool dither, ThreadPool* pool,
+                  Image3U* srgb, SampleEncoding encoding,
+                  ColorPrimaries primaries) const;
+  template <class Target>
+  void operator()(const Image3F& opsin, bool dither, ThreadPool* pool,
+                  Image3F* srgb, SampleEncoding encoding,
+                  ColorPrimaries primaries) const;
+  template <class Target>
+  void operator()(const Image3F& opsin, bool dither,
+                  const AlphaComposite& composite, ThreadPool* pool,
+                  Image3B* srgb, ColorPrimaries primaries) const;
+  template <class Target>
+  void operator()(const Image3F& opsin, bool dither, const ImageU* alpha,
+                  int alpha_bits, ThreadPool* pool,
+                  const InterleavedImageView& out,
+                  const AlphaComposite* composite,
+                  ColorPrimaries primaries) const;
+};
+
+// Argument (copied into the TFGraph) of the TFFuncs below.
+struct OpsinToSrgbArg {
+  ColorPrimaries primaries;
+  // Only for AddCenteredOpsinToCompositedSrgb, which uses its alpha_bits and
+  // background.
+  AlphaComposite composite;
+};
+
+// Returns the TFFunc of the node added by AddCenteredOpsinToSrgb.
+struct CenteredOpsinToSrgbFuncImpl {
+  template <class Target>
+  TFFunc operator()(bool dither, TFType out_type,
+                    SampleEncoding encoding) const;
+  // For AddCenteredOpsinToCompositedSrgb.
+  template <class Target>
+  TFFunc operator()(bool dither) const;
+};
+
 }  // namespace pik
 
 #endif  // OPSIN_INVERSE_H_
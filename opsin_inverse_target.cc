@@ -0,0 +1,716 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compiled once per SIMD target (see CMakeLists.txt); opsin_inverse.cc selects
+// the best one via dispatch::Run.
+
+#include "opsin_inverse.h"
+
+#include <string.h>
+
+#define PROFILER_ENABLED 1
+#include "gamma_correct.h"
+#include "profiler.h"
+#include "tile_flow.h"
+
+namespace pik {
+namespace SIMD_NAMESPACE {
+namespace {
+
+// The 3x3 entries of the opsin absorbance matrix inverse (combined with the
+// conversion to "primaries"), broadcasted. Not a static initializer because
+// that would run this target's instructions before dispatch::Run has checked
+// whether the CPU supports them.
+struct InverseMatrix {
+  explicit InverseMatrix(const ColorPrimaries primaries) {
+    const Full<float> d;
+    const float* PIK_RESTRICT inverse = GetOpsinToLinearMatrix(primaries);
+    for (size_t i = 0; i < 9; ++i) {
+      v[i] = set1(d, inverse[i]);
+    }
+  }
+
+  Full<float>::V v[9];
+};
+
+// For U16/F32, or when dithering is disabled (cparam or lack of SIMD).
+struct Dither_None {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V Init(size_t) { return undefined(D()); }
+  static V Eval(const V srgb, const V dither) { return srgb; }
+  static V Toggle(const V dither) { return dither; }
+};
+
+// Dithering (2x2) helps for larger distances but not at 1 or below.
+// Only possible with actual SIMD (requires combine_shift_right_bytes).
+#if SIMD_TARGET_VALUE != SIMD_NONE
+struct Dither_2x2 {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V Init(size_t y) {
+    // First row of a 2x2 dither matrix:  -+ -+ .. -+
+    SIMD_ALIGN constexpr float lanes[4] = {-0.25f, +0.25f, -0.25f, +0.25f};
+    auto dither = load_dup128(D(), lanes);
+    if (y & 1) {
+      dither = Toggle(dither);
+    }
+    return dither;
+  }
+
+  static V Eval(const V srgb, const V dither) { return srgb + dither; }
+
+  static V Toggle(const V dither) {
+    // Flips lane signs by rotating the vector blocks by one lane.
+    return SIMD_NAMESPACE::combine_shift_right_bytes<4>(dither, dither);
+  }
+};
+#else
+using Dither_2x2 = Dither_None;
+#endif
+
+template <class Dither>
+struct LinearToSRGB_U8 {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V ExtraArg(size_t y) { return Dither::Init(y); }
+  static V UpdateExtraArg(const V v) { return Dither::Toggle(v); }
+
+  PIK_INLINE void operator()(const V linear_r, const V linear_g,
+                             const V linear_b, const V dither,
+                             uint8_t* PIK_RESTRICT out_srgb_r,
+                             uint8_t* PIK_RESTRICT out_srgb_g,
+                             uint8_t* PIK_RESTRICT out_srgb_b) const {
+    using namespace SIMD_NAMESPACE;
+
+    // The convert_to below take care of clamping.
+    V srgb_r, srgb_g, srgb_b;
+    LinearToSrgb8PolyWithoutClamp(linear_r, linear_g, linear_b, &srgb_r,
+                                  &srgb_g, &srgb_b);
+
+    // Quarter-vectors.
+    constexpr Part<uint8_t, D::N> d8;
+    const auto srgb_r8 =
+        convert_to(d8, nearest_int(Dither::Eval(srgb_r, dither)));
+    const auto srgb_g8 =
+        convert_to(d8, nearest_int(Dither::Eval(srgb_g, dither)));
+    const auto srgb_b8 =
+        convert_to(d8, nearest_int(Dither::Eval(srgb_b, dither)));
+
+    store(srgb_r8, d8, out_srgb_r);
+    store(srgb_g8, d8, out_srgb_g);
+    store(srgb_b8, d8, out_srgb_b);
+  }
+
+  // Same, but first composites the (unrounded) sRGB with alpha.
+  template <class Compositor>
+  PIK_INLINE void operator()(const V linear_r, const V linear_g,
+                             const V linear_b, const V dither,
+                             const Compositor& compositor,
+                             const uint16_t* PIK_RESTRICT row_alpha,
+                             uint8_t* PIK_RESTRICT out_srgb_r,
+                             uint8_t* PIK_RESTRICT out_srgb_g,
+                             uint8_t* PIK_RESTRICT out_srgb_b) const {
+    using namespace SIMD_NAMESPACE;
+
+    V srgb_r, srgb_g, srgb_b;
+    LinearToSrgb8PolyWithoutClamp(linear_r, linear_g, linear_b, &srgb_r,
+                                  &srgb_g, &srgb_b);
+    compositor(row_alpha, &srgb_r, &srgb_g, &srgb_b);
+
+    constexpr Part<uint8_t, D::N> d8;
+    store(convert_to(d8, nearest_int(Dither::Eval(srgb_r, dither))), d8,
+          out_srgb_r);
+    store(convert_to(d8, nearest_int(Dither::Eval(srgb_g, dither))), d8,
+          out_srgb_g);
+    store(convert_to(d8, nearest_int(Dither::Eval(srgb_b, dither))), d8,
+          out_srgb_b);
+  }
+};
+
+// Blends sRGB in [0, 255] over a constant background (see AlphaComposite).
+class AlphaCompositor {
+ public:
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  explicit AlphaCompositor(const AlphaComposite& composite)
+      : mul_alpha_(set1(D(), 1.0f / ((1u << composite.alpha_bits) - 1))),
+        background_(set1(D(), composite.background)) {}
+
+  // Reads D::N alpha samples from "row_alpha".
+  PIK_INLINE void operator()(const uint16_t* PIK_RESTRICT row_alpha,
+                             V* PIK_RESTRICT srgb_r, V* PIK_RESTRICT srgb_g,
+                             V* PIK_RESTRICT srgb_b) const {
+    using namespace SIMD_NAMESPACE;
+    constexpr Part<uint16_t, D::N> d16;
+    const Full<int32_t> di;
+    const V alpha =
+        convert_to(D(), convert_to(di, load(d16, row_alpha))) * mul_alpha_;
+    // background + (srgb - background) * alpha, i.e. at most one rounding.
+    *srgb_r = mul_add(*srgb_r - background_, alpha, background_);
+    *srgb_g = mul_add(*srgb_g - background_, alpha, background_);
+    *srgb_b = mul_add(*srgb_b - background_, alpha, background_);
+  }
+
+ private:
+  V mul_alpha_;
+  V background_;
+};
+
+// Same as U8, but multiplies result by 257 to expand to 16-bit.
+struct LinearToSRGB_U16 {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V ExtraArg(size_t) { return set1(D(), kXybCenter[3]); }
+  static V UpdateExtraArg(const V v) { return v; }
+
+  // "mul_srgb" is 257.
+  PIK_INLINE void operator()(const V linear_r, const V linear_g,
+                             const V linear_b, const V mul_srgb,
+                             uint16_t* PIK_RESTRICT out_srgb_r,
+                             uint16_t* PIK_RESTRICT out_srgb_g,
+                             uint16_t* PIK_RESTRICT out_srgb_b) const {
+    using namespace SIMD_NAMESPACE;
+
+    // The convert_to below take care of clamping.
+    V srgb_r, srgb_g, srgb_b;
+    LinearToSrgb8PolyWithoutClamp(linear_r, linear_g, linear_b, &srgb_r,
+                                  &srgb_g, &srgb_b);
+
+    // Half-vectors.
+    constexpr Part<uint16_t, D::N> d16;
+    const auto srgb_r16 = convert_to(d16, nearest_int(srgb_r * mul_srgb));
+    const auto srgb_g16 = convert_to(d16, nearest_int(srgb_g * mul_srgb));
+    const auto srgb_b16 = convert_to(d16, nearest_int(srgb_b * mul_srgb));
+
+    store(srgb_r16, d16, out_srgb_r);
+    store(srgb_g16, d16, out_srgb_g);
+    store(srgb_b16, d16, out_srgb_b);
+  }
+};
+
+struct LinearToSRGB_F32 {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V ExtraArg(size_t) { return undefined(D()); }
+  static V UpdateExtraArg(const V v) { return v; }
+
+  PIK_INLINE void operator()(const V linear_r, const V linear_g,
+                             const V linear_b, const V unused,
+                             float* PIK_RESTRICT out_srgb_r,
+                             float* PIK_RESTRICT out_srgb_g,
+                             float* PIK_RESTRICT out_srgb_b) const {
+    using namespace SIMD_NAMESPACE;
+    D d;
+
+    V srgb_r, srgb_g, srgb_b;
+    LinearToSrgb8Poly(d, linear_r, linear_g, linear_b, &srgb_r, &srgb_g,
+                      &srgb_b);
+
+    store(srgb_r, d, out_srgb_r);
+    store(srgb_g, d, out_srgb_g);
+    store(srgb_b, d, out_srgb_b);
+  }
+};
+
+// Skips the sRGB transfer function: linear light in [0, 255] * 257.
+struct LinearToLinear_U16 {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V ExtraArg(size_t) { return set1(D(), 257.0f); }
+  static V UpdateExtraArg(const V v) { return v; }
+
+  PIK_INLINE void operator()(const V linear_r, const V linear_g,
+                             const V linear_b, const V mul,
+                             uint16_t* PIK_RESTRICT out_r,
+                             uint16_t* PIK_RESTRICT out_g,
+                             uint16_t* PIK_RESTRICT out_b) const {
+    using namespace SIMD_NAMESPACE;
+    // Half-vectors. XybToRgb already clamped to [0, 255].
+    constexpr Part<uint16_t, D::N> d16;
+    store(convert_to(d16, nearest_int(linear_r * mul)), d16, out_r);
+    store(convert_to(d16, nearest_int(linear_g * mul)), d16, out_g);
+    store(convert_to(d16, nearest_int(linear_b * mul)), d16, out_b);
+  }
+};
+
+// Linear light in [0, 255].
+struct LinearToLinear_F32 {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V ExtraArg(size_t) { return undefined(D()); }
+  static V UpdateExtraArg(const V v) { return v; }
+
+  PIK_INLINE void operator()(const V linear_r, const V linear_g,
+                             const V linear_b, const V unused,
+                             float* PIK_RESTRICT out_r,
+                             float* PIK_RESTRICT out_g,
+                             float* PIK_RESTRICT out_b) const {
+    using namespace SIMD_NAMESPACE;
+    const D d;
+    store(linear_r, d, out_r);
+    store(linear_g, d, out_g);
+    store(linear_b, d, out_b);
+  }
+};
+
+// IEEE binary16 bit patterns of linear light in [0, 1].
+struct LinearToHalf {
+  using D = SIMD_NAMESPACE::Full<float>;
+  using V = D::V;
+
+  static V ExtraArg(size_t) { return set1(D(), 1.0f / 255); }
+  static V UpdateExtraArg(const V v) { return v; }
+
+  // Rounds to nearest even; "v" is in [0, 1], so there is no overflow, NaN or
+  // sign to handle. Returns the bit patterns in int32 lanes.
+  static PIK_INLINE SIMD_NAMESPACE::Full<int32_t>::V ToHalf(const V v) {
+    using namespace SIMD_NAMESPACE;
+    const D df;
+    const Full<int32_t> di;
+    const auto bits = cast_to(di, v);
+    // Normal: rebias the exponent and round the mantissa to 10 bits.
+    const auto odd = shift_right<13>(bits) & set1(di, 1);
+    const auto rebias = set1(di, 0xFFF - (112 << 23));
+    const auto normal = shift_right<13>(bits + rebias + odd);
+    // Subnormal (below 2^-14): adding 0.5 aligns the mantissa such that the
+    // hardware rounds it to the half-float subnormal.
+    const auto magic = set1(df, 0.5f);
+    const auto subnormal = cast_to(di, v + magic) - cast_to(di, magic);
+    const auto is_subnormal = v < set1(df, 1.0f / 16384);
+    return cast_to(di, select(cast_to(df, normal), cast_to(df, subnormal),
+                              is_subnormal));
+  }
+
+  PIK_INLINE void operator()(const V linear_r, const V linear_g,
+                             const V linear_b, const V mul,
+                             uint16_t* PIK_RESTRICT out_r,
+                             uint16_t* PIK_RESTRICT out_g,
+                             uint16_t* PIK_RESTRICT out_b) const {
+    using namespace SIMD_NAMESPACE;
+    constexpr Part<uint16_t, D::N> d16;
+    store(convert_to(d16, ToHalf(linear_r * mul)), d16, out_r);
+    store(convert_to(d16, ToHalf(linear_g * mul)), d16, out_g);
+    store(convert_to(d16, ToHalf(linear_b * mul)), d16, out_b);
+  }
+};
+
+// Called via TileFlow (matches TFFunc signature); "arg" is an OpsinToSrgbArg.
+template <class LinearToSRGB, typename T>
+PIK_INLINE void CenteredOpsinToSrgbFunc(
+    const void* arg, const ConstImageViewF* PIK_RESTRICT linear,
+    const OutputRegion& output_region,
+    const MutableImageViewF* PIK_RESTRICT srgb) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+
+  OpsinToSrgbArg args;
+  memcpy(&args, arg, sizeof(args));
+  const auto center_x = set1(d, kXybCenter[0]);
+  const auto center_y = set1(d, kXybCenter[1]);
+  const auto center_b = set1(d, kXybCenter[2]);
+  const InverseMatrix inverse_matrix(args.primaries);
+  // dither for U8; 257 for U16; unused for F32.
+  auto extra_arg = LinearToSRGB::ExtraArg(output_region.y);
+
+  for (uint32_t y = 0; y < output_region.ysize; ++y) {
+    // Faster than adding via ByteOffset at end of loop.
+    const float* PIK_RESTRICT row_linear_x = linear[0].ConstRow(y);
+    const float* PIK_RESTRICT row_linear_y = linear[1].ConstRow(y);
+    const float* PIK_RESTRICT row_linear_b = linear[2].ConstRow(y);
+
+    T* PIK_RESTRICT row_srgb_r = reinterpret_cast<T*>(srgb[0].Row(y));
+    T* PIK_RESTRICT row_srgb_g = reinterpret_cast<T*>(srgb[1].Row(y));
+    T* PIK_RESTRICT row_srgb_b = reinterpret_cast<T*>(srgb[2].Row(y));
+
+    for (uint32_t x = 0; x < output_region.xsize; x += d.N) {
+      const auto in_linear_x = load(d, row_linear_x + x) + center_x;
+      const auto in_linear_y = load(d, row_linear_y + x) + center_y;
+      const auto in_linear_b = load(d, row_linear_b + x) + center_b;
+      decltype(d)::V linear_r, linear_g, linear_b;
+      XybToRgb(d, in_linear_x, in_linear_y, in_linear_b, inverse_matrix.v,
+               &linear_r, &linear_g, &linear_b);
+
+      LinearToSRGB()(linear_r, linear_g, linear_b, extra_arg, row_srgb_r + x,
+                     row_srgb_g + x, row_srgb_b + x);
+    }
+
+    extra_arg = LinearToSRGB::UpdateExtraArg(extra_arg);
+  }
+}
+
+// Called via TileFlow; inputs[3] is U16 alpha and "arg" an OpsinToSrgbArg.
+template <class Dither>
+PIK_INLINE void CenteredOpsinToCompositedSrgbFunc(
+    const void* arg, const ConstImageViewF* PIK_RESTRICT inputs,
+    const OutputRegion& output_region,
+    const MutableImageViewF* PIK_RESTRICT srgb) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+
+  OpsinToSrgbArg args;
+  memcpy(&args, arg, sizeof(args));
+  const AlphaCompositor compositor(args.composite);
+  const auto center_x = set1(d, kXybCenter[0]);
+  const auto center_y = set1(d, kXybCenter[1]);
+  const auto center_b = set1(d, kXybCenter[2]);
+  const InverseMatrix inverse_matrix(args.primaries);
+  auto dither = Dither::Init(output_region.y);
+
+  for (uint32_t y = 0; y < output_region.ysize; ++y) {
+    const float* PIK_RESTRICT row_linear_x = inputs[0].ConstRow(y);
+    const float* PIK_RESTRICT row_linear_y = inputs[1].ConstRow(y);
+    const float* PIK_RESTRICT row_linear_b = inputs[2].ConstRow(y);
+    const uint16_t* PIK_RESTRICT row_alpha =
+        reinterpret_cast<const uint16_t*>(inputs[3].ConstRow(y));
+
+    uint8_t* PIK_RESTRICT row_srgb_r =
+        reinterpret_cast<uint8_t*>(srgb[0].Row(y));
+    uint8_t* PIK_RESTRICT row_srgb_g =
+        reinterpret_cast<uint8_t*>(srgb[1].Row(y));
+    uint8_t* PIK_RESTRICT row_srgb_b =
+        reinterpret_cast<uint8_t*>(srgb[2].Row(y));
+
+    for (uint32_t x = 0; x < output_region.xsize; x += d.N) {
+      const auto in_linear_x = load(d, row_linear_x + x) + center_x;
+      const auto in_linear_y = load(d, row_linear_y + x) + center_y;
+      const auto in_linear_b = load(d, row_linear_b + x) + center_b;
+      decltype(d)::V linear_r, linear_g, linear_b;
+      XybToRgb(d, in_linear_x, in_linear_y, in_linear_b, inverse_matrix.v,
+               &linear_r, &linear_g, &linear_b);
+
+      LinearToSRGB_U8<Dither>()(linear_r, linear_g, linear_b, dither,
+                                compositor, row_alpha + x, row_srgb_r + x,
+                                row_srgb_g + x, row_srgb_b + x);
+    }
+
+    dither = Dither::Toggle(dither);
+  }
+}
+
+// TODO(janwas): available for merging into another TF graph if possible.
+template <class LinearToSRGB, typename T>
+void CenteredOpsinToSrgbT_TF(const Image3F& opsin,
+                             const ColorPrimaries primaries, ThreadPool* pool,
+                             Image3<T>* srgb) {
+  PROFILER_FUNC;
+  const size_t xsize = opsin.xsize();
+  const size_t ysize = opsin.ysize();
+  *srgb = Image3<T>(xsize, ysize);
+
+  TFBuilder builder;
+  TFNode* src_opsin = builder.AddSource("src_opsin", 3, TFType::kF32);
+  builder.SetSource(src_opsin, &opsin);
+
+  const TFType type = TFTypeUtils::FromT(T());
+  const TFFunc func = &CenteredOpsinToSrgbFunc<LinearToSRGB, T>;
+  OpsinToSrgbArg arg = {};
+  arg.primaries = primaries;
+  TFNode* sink = builder.Add("opsin->srgb", Borders(), Scale(), {src_opsin}, 3,
+                             type, func, reinterpret_cast<const uint8_t*>(&arg),
+                             sizeof(arg));
+  builder.SetSink(sink, srgb);
+
+  const auto graph = builder.Finalize(ImageSize::Make(xsize, ysize), pool);
+  graph->Run();
+}
+
+template <class LinearToSRGB, typename T>
+void CenteredOpsinToSrgbT(const Image3F& opsin, const ColorPrimaries primaries,
+                          ThreadPool* pool, Image3<T>* srgb) {
+  PROFILER_FUNC;
+  const size_t xsize = opsin.xsize();
+  const size_t ysize = opsin.ysize();
+  *srgb = Image3<T>(xsize, ysize);
+
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+
+  const auto center_x = set1(d, kXybCenter[0]);
+  const auto center_y = set1(d, kXybCenter[1]);
+  const auto center_b = set1(d, kXybCenter[2]);
+  const InverseMatrix inverse_matrix(primaries);
+
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    // dither for U8; 257 for U16; unused for F32.
+    auto extra_arg = LinearToSRGB::ExtraArg(y);
+
+    // Faster than adding via ByteOffset at end of loop.
+    const float* PIK_RESTRICT row_linear_x = opsin.ConstPlaneRow(0, y);
+    const float* PIK_RESTRICT row_linear_y = opsin.ConstPlaneRow(1, y);
+    const float* PIK_RESTRICT row_linear_b = opsin.ConstPlaneRow(2, y);
+
+    T* PIK_RESTRICT row_srgb_r = reinterpret_cast<T*>(srgb->PlaneRow(0, y));
+    T* PIK_RESTRICT row_srgb_g = reinterpret_cast<T*>(srgb->PlaneRow(1, y));
+    T* PIK_RESTRICT row_srgb_b = reinterpret_cast<T*>(srgb->PlaneRow(2, y));
+
+    for (size_t x = 0; x < xsize; x += d.N) {
+      const auto in_linear_x = load(d, row_linear_x + x) + center_x;
+      const auto in_linear_y = load(d, row_linear_y + x) + center_y;
+      const auto in_linear_b = load(d, row_linear_b + x) + center_b;
+      Full<float>::V linear_r, linear_g, linear_b;
+      XybToRgb(d, in_linear_x, in_linear_y, in_linear_b, inverse_matrix.v,
+               &linear_r, &linear_g, &linear_b);
+
+      LinearToSRGB()(linear_r, linear_g, linear_b, extra_arg, row_srgb_r + x,
+                     row_srgb_g + x, row_srgb_b + x);
+    }
+  });
+}
+
+// As above, but composites with alpha (see AlphaComposite).
+template <class Dither>
+void CenteredOpsinToCompositedSrgbT(const Image3F& opsin,
+                                    const AlphaComposite& composite,
+                                    const ColorPrimaries primaries,
+                                    ThreadPool* pool, Image3B* srgb) {
+  PROFILER_FUNC;
+  const size_t xsize = opsin.xsize();
+  const size_t ysize = opsin.ysize();
+  PIK_CHECK(SameSize(opsin, *composite.alpha));
+  *srgb = Image3B(xsize, ysize);
+
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+
+  const auto center_x = set1(d, kXybCenter[0]);
+  const auto center_y = set1(d, kXybCenter[1]);
+  const auto center_b = set1(d, kXybCenter[2]);
+  const InverseMatrix inverse_matrix(primaries);
+  const AlphaCompositor compositor(composite);
+
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    const auto dither = Dither::Init(y);
+
+    const float* PIK_RESTRICT row_linear_x = opsin.ConstPlaneRow(0, y);
+    const float* PIK_RESTRICT row_linear_y = opsin.ConstPlaneRow(1, y);
+    const float* PIK_RESTRICT row_linear_b = opsin.ConstPlaneRow(2, y);
+    const uint16_t* PIK_RESTRICT row_alpha = composite.alpha->ConstRow(y);
+
+    uint8_t* PIK_RESTRICT row_srgb_r = srgb->PlaneRow(0, y);
+    uint8_t* PIK_RESTRICT row_srgb_g = srgb->PlaneRow(1, y);
+    uint8_t* PIK_RESTRICT row_srgb_b = srgb->PlaneRow(2, y);
+
+    for (size_t x = 0; x < xsize; x += d.N) {
+      const auto in_linear_x = load(d, row_linear_x + x) + center_x;
+      const auto in_linear_y = load(d, row_linear_y + x) + center_y;
+      const auto in_linear_b = load(d, row_linear_b + x) + center_b;
+      Full<float>::V linear_r, linear_g, linear_b;
+      XybToRgb(d, in_linear_x, in_linear_y, in_linear_b, inverse_matrix.v,
+               &linear_r, &linear_g, &linear_b);
+
+      LinearToSRGB_U8<Dither>()(linear_r, linear_g, linear_b, dither,
+                                compositor, row_alpha + x, row_srgb_r + x,
+                                row_srgb_g + x, row_srgb_b + x);
+    }
+  });
+}
+
+// Converts one row at a time into small per-thread planar buffers (which stay
+// in L1) and interleaves them into "out" together with alpha. The color is
+// first composited if "composite" is non-null.
+template <class Dither>
+void CenteredOpsinToInterleavedSrgbT(const Image3F& opsin,
+                                     const ImageU* alpha, const int alpha_bits,
+                                     const AlphaComposite* composite,
+                                     const ColorPrimaries primaries,
+                                     ThreadPool* pool,
+                                     const InterleavedImageView& out) {
+  PROFILER_FUNC;
+  PIK_CHECK(out.xsize <= opsin.xsize() && out.ysize <= opsin.ysize());
+  PIK_CHECK(alpha == nullptr ||
+            (out.xsize <= alpha->xsize() && out.ysize <= alpha->ysize()));
+  PIK_CHECK(composite == nullptr || SameSize(opsin, *composite->alpha));
+  const size_t xsize = out.xsize;
+  Image3B rows(xsize, std::max<size_t>(pool->NumThreads(), 1));
+
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+
+  const auto center_x = set1(d, kXybCenter[0]);
+  const auto center_y = set1(d, kXybCenter[1]);
+  const auto center_b = set1(d, kXybCenter[2]);
+  const InverseMatrix inverse_matrix(primaries);
+  // Unused if composite is null.
+  const AlphaComposite no_composite = {nullptr, 8, 0};
+  const AlphaCompositor compositor(composite != nullptr ? *composite
+                                                        : no_composite);
+
+  pool->Run(0, out.ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    const auto dither = Dither::Init(y);
+    const uint16_t* PIK_RESTRICT row_composite_alpha =
+        composite == nullptr ? nullptr : composite->alpha->ConstRow(y);
+
+    const float* PIK_RESTRICT row_linear_x = opsin.ConstPlaneRow(0, y);
+    const float* PIK_RESTRICT row_linear_y = opsin.ConstPlaneRow(1, y);
+    const float* PIK_RESTRICT row_linear_b = opsin.ConstPlaneRow(2, y);
+
+    uint8_t* PIK_RESTRICT row_srgb_r = rows.PlaneRow(0, thread);
+    uint8_t* PIK_RESTRICT row_srgb_g = rows.PlaneRow(1, thread);
+    uint8_t* PIK_RESTRICT row_srgb_b = rows.PlaneRow(2, thread);
+
+    for (size_t x = 0; x < xsize; x += d.N) {
+      const auto in_linear_x = load(d, row_linear_x + x) + center_x;
+      const auto in_linear_y = load(d, row_linear_y + x) + center_y;
+      const auto in_linear_b = load(d, row_linear_b + x) + center_b;
+      Full<float>::V linear_r, linear_g, linear_b;
+      XybToRgb(d, in_linear_x, in_linear_y, in_linear_b, inverse_matrix.v,
+               &linear_r, &linear_g, &linear_b);
+
+      if (row_composite_alpha != nullptr) {
+        LinearToSRGB_U8<Dither>()(linear_r, linear_g, linear_b, dither,
+                                  compositor, row_composite_alpha + x,
+                                  row_srgb_r + x, row_srgb_g + x,
+                                  row_srgb_b + x);
+      } else {
+        LinearToSRGB_U8<Dither>()(linear_r, linear_g, linear_b, dither,
+                                  row_srgb_r + x, row_srgb_g + x,
+                                  row_srgb_b + x);
+      }
+    }
+
+    const uint16_t* row_alpha = alpha == nullptr ? nullptr : alpha->ConstRow(y);
+    InterleaveRow(row_srgb_r, row_srgb_g, row_srgb_b, row_alpha, alpha_bits,
+                  xsize, y, out);
+  });
+}
+
+}  // namespace
+}  // namespace SIMD_NAMESPACE
+
+template <>
+void CenteredOpsinToSrgbImpl::operator()<SIMD_TARGET>(
+    const Image3F& opsin, const bool dither, ThreadPool* pool, Image3B* srgb,
+    const ColorPrimaries primaries) const {
+  using namespace SIMD_NAMESPACE;
+  if (dither) {
+    CenteredOpsinToSrgbT<LinearToSRGB_U8<Dither_2x2>>(opsin, primaries, pool,
+                                                      srgb);
+  } else {
+    CenteredOpsinToSrgbT<LinearToSRGB_U8<Dither_None>>(opsin, primaries, pool,
+                                                       srgb);
+  }
+}
+
+template <>
+void CenteredOpsinToSrgbImpl::operator()<SIMD_TARGET>(
+    const Image3F& opsin, const bool dither, ThreadPool* pool, Image3U* srgb,
+    const SampleEncoding encoding, const ColorPrimaries primaries) const {
+  using namespace SIMD_NAMESPACE;
+  switch (encoding) {
+    case SampleEncoding::kSRGB:
+      CenteredOpsinToSrgbT<LinearToSRGB_U16>(opsin, primaries, pool, srgb);
+      break;
+    case SampleEncoding::kLinear:
+      CenteredOpsinToSrgbT<LinearToLinear_U16>(opsin, primaries, pool, srgb);
+      break;
+    case SampleEncoding::kLinearHalf:
+      CenteredOpsinToSrgbT<LinearToHalf>(opsin, primaries, pool, srgb);
+      break;
+  }
+}
+
+template <>
+void CenteredOpsinToSrgbImpl::operator()<SIMD_TARGET>(
+    const Image3F& opsin, const bool dither, ThreadPool* pool, Image3F* srgb,
+    const SampleEncoding encoding, const ColorPrimaries primaries) const {
+  using namespace SIMD_NAMESPACE;
+  if (encoding == SampleEncoding::kLinear) {
+    CenteredOpsinToSrgbT<LinearToLinear_F32>(opsin, primaries, pool, srgb);
+  } else {
+    CenteredOpsinToSrgbT<LinearToSRGB_F32>(opsin, primaries, pool, srgb);
+  }
+}
+
+template <>
+void CenteredOpsinToSrgbImpl::operator()<SIMD_TARGET>(
+    const Image3F& opsin, const bool dither, const AlphaComposite& composite,
+    ThreadPool* pool, Image3B* srgb, const ColorPrimaries primaries) const {
+  using namespace SIMD_NAMESPACE;
+  if (dither) {
+    CenteredOpsinToCompositedSrgbT<Dither_2x2>(opsin, composite, primaries,
+                                               pool, srgb);
+  } else {
+    CenteredOpsinToCompositedSrgbT<Dither_None>(opsin, composite, primaries,
+                                                pool, srgb);
+  }
+}
+
+template <>
+void CenteredOpsinToSrgbImpl::operator()<SIMD_TARGET>(
+    const Image3F& opsin, const bool dither, const ImageU* alpha,
+    const int alpha_bits, ThreadPool* pool, const InterleavedImageView& out,
+    const AlphaComposite* composite, const ColorPrimaries primaries) const {
+  using namespace SIMD_NAMESPACE;
+  if (dither) {
+    CenteredOpsinToInterleavedSrgbT<Dither_2x2>(
+        opsin, alpha, alpha_bits, composite, primaries, pool, out);
+  } else {
+    CenteredOpsinToInterleavedSrgbT<Dither_None>(
+        opsin, alpha, alpha_bits, composite, primaries, pool, out);
+  }
+}
+
+template <>
+TFFunc CenteredOpsinToSrgbFuncImpl::operator()<SIMD_TARGET>(
+    const bool dither, const TFType out_type,
+    const SampleEncoding encoding) const {
+  using namespace SIMD_NAMESPACE;
+  if (encoding == SampleEncoding::kLinearHalf) {
+    PIK_CHECK(out_type == TFType::kU16);
+    return &CenteredOpsinToSrgbFunc<LinearToHalf, uint16_t>;
+  }
+  if (encoding == SampleEncoding::kLinear) {
+    PIK_CHECK(out_type != TFType::kU8);
+    return out_type == TFType::kU16
+               ? &CenteredOpsinToSrgbFunc<LinearToLinear_U16, uint16_t>
+               : &CenteredOpsinToSrgbFunc<LinearToLinear_F32, float>;
+  }
+  switch (out_type) {
+    case TFType::kU8:
+      return dither
+                 ? &CenteredOpsinToSrgbFunc<LinearToSRGB_U8<Dither_2x2>,
+                                            uint8_t>
+                 : &CenteredOpsinToSrgbFunc<LinearToSRGB_U8<Dither_None>,
+                                            uint8_t>;
+    case TFType::kU16:
+      return &CenteredOpsinToSrgbFunc<LinearToSRGB_U16, uint16_t>;
+    case TFType::kF32:
+      return &CenteredOpsinToSrgbFunc<LinearToSRGB_F32, float>;
+    default:
+      PIK_CHECK(false);
+      return nullptr;
+  }
+}
+
+template <>
+TFFunc CenteredOpsinToSrgbFuncImpl::operator()<SIMD_TARGET>(
+    const bool dither) const {
+  using namespace SIMD_NAMESPACE;
+  return dither ? &CenteredOpsinToCompositedSrgbFunc<Dither_2x2>
+                : &CenteredOpsinToCompositedSrgbFunc<Dither_None>;
+}
+
+}  // namespace pik
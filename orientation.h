@@ -0,0 +1,118 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ORIENTATION_H_
+#define ORIENTATION_H_
+
+// Rotations and flips by multiples of 90 degrees.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+namespace pik {
+
+// Transforms that make an image upright, numbered like the EXIF orientation
+// tag (274) whose value calls for them.
+enum class Orientation : uint32_t {
+  kIdentity = 1,
+  kFlipHorizontal = 2,
+  kRotate180 = 3,
+  kFlipVertical = 4,
+  kTranspose = 5,  // Swaps x and y.
+  kRotate90 = 6,   // Clockwise.
+  kTransverse = 7,
+  kRotate270 = 8,
+};
+
+// Equivalent formulation: transpose (if "transpose"), then mirror the
+// resulting columns and/or rows.
+struct OrientationSteps {
+  explicit OrientationSteps(const Orientation orientation) {
+    switch (orientation) {
+      case Orientation::kIdentity:
+        break;
+      case Orientation::kFlipHorizontal:
+        flip_x = true;
+        break;
+      case Orientation::kRotate180:
+        flip_x = flip_y = true;
+        break;
+      case Orientation::kFlipVertical:
+        flip_y = true;
+        break;
+      case Orientation::kTranspose:
+        transpose = true;
+        break;
+      case Orientation::kRotate90:
+        transpose = flip_x = true;
+        break;
+      case Orientation::kTransverse:
+        transpose = flip_x = flip_y = true;
+        break;
+      case Orientation::kRotate270:
+        transpose = flip_y = true;
+        break;
+    }
+  }
+
+  // Returns the source coordinates of (x, y) in the oriented image of size
+  // xsize * ysize.
+  void Source(const size_t x, const size_t y, const size_t xsize,
+              const size_t ysize, size_t* PIK_RESTRICT source_x,
+              size_t* PIK_RESTRICT source_y) const {
+    const size_t tx = flip_x ? xsize - 1 - x : x;
+    const size_t ty = flip_y ? ysize - 1 - y : y;
+    *source_x = transpose ? ty : tx;
+    *source_y = transpose ? tx : ty;
+  }
+
+  bool transpose = false;
+  bool flip_x = false;
+  bool flip_y = false;
+};
+
+static inline bool IsValidOrientation(const uint32_t value) {
+  return value >= static_cast<uint32_t>(Orientation::kIdentity) &&
+         value <= static_cast<uint32_t>(Orientation::kRotate270);
+}
+
+template <typename T>
+Image<T> OrientedImage(const Orientation orientation, const Image<T>& in) {
+  const OrientationSteps steps(orientation);
+  const size_t xsize = steps.transpose ? in.ysize() : in.xsize();
+  const size_t ysize = steps.transpose ? in.xsize() : in.ysize();
+  Image<T> out(xsize, ysize);
+  for (size_t y = 0; y < ysize; ++y) {
+    T* PIK_RESTRICT row_out = out.Row(y);
+    for (size_t x = 0; x < xsize; ++x) {
+      size_t source_x, source_y;
+      steps.Source(x, y, xsize, ysize, &source_x, &source_y);
+      row_out[x] = in.ConstRow(source_y)[source_x];
+    }
+  }
+  return out;
+}
+
+template <typename T>
+Image3<T> OrientedImage(const Orientation orientation, const Image3<T>& in) {
+  return Image3<T>(OrientedImage(orientation, in.Plane(0)),
+                   OrientedImage(orientation, in.Plane(1)),
+                   OrientedImage(orientation, in.Plane(2)));
+}
+
+}  // namespace pik
+
+#endif  // ORIENTATION_H_
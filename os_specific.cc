@@ -33,6 +33,16 @@
 #define OS_WIN 0
 #endif
 
+#if !OS_WIN
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
 #ifdef __linux__
 #define OS_LINUX 1
 #include <sched.h>
@@ -190,6 +200,81 @@ std::vector<int> AvailableCPUs() {
   return cpus;
 }
 
+namespace {
+
+// Parses a sysfs CPU list such as "0-7,16-23\n". Returns false on error.
+bool ParseCPUList(const char* list, std::vector<int>* cpus) {
+  const char* pos = list;
+  for (;;) {
+    int first, last, chars;
+    if (sscanf(pos, "%d%n", &first, &chars) != 1) return false;
+    pos += chars;
+    last = first;
+    if (*pos == '-') {
+      if (sscanf(pos + 1, "%d%n", &last, &chars) != 1) return false;
+      pos += 1 + chars;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) cpus->push_back(cpu);
+    if (*pos != ',') return true;
+    ++pos;
+  }
+}
+
+}  // namespace
+
+std::vector<std::vector<int>> AvailableCPUsPerNode() {
+  const std::vector<int> available = AvailableCPUs();
+  std::vector<std::vector<int>> nodes;
+#if OS_LINUX
+  // Node numbers may have gaps, so try all up to the usual kernel limit.
+  for (int node = 0; node < 1024; ++node) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) continue;
+    char list[4096];
+    std::vector<int> cpus;
+    const bool ok = fgets(list, sizeof(list), f) != nullptr &&
+                    ParseCPUList(list, &cpus);
+    fclose(f);
+    if (!ok) continue;
+
+    std::vector<int> node_cpus;
+    for (const int cpu : cpus) {
+      if (std::binary_search(available.begin(), available.end(), cpu)) {
+        node_cpus.push_back(cpu);
+      }
+    }
+    if (!node_cpus.empty()) nodes.push_back(node_cpus);
+  }
+#endif
+  if (nodes.empty()) nodes.push_back(available);
+  return nodes;
+}
+
+std::vector<int> CPUsForThreads(const size_t num_threads) {
+  std::vector<int> all;
+  for (const std::vector<int>& node : AvailableCPUsPerNode()) {
+    all.insert(all.end(), node.begin(), node.end());
+  }
+  std::vector<int> cpus;
+  cpus.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    cpus.push_back(all[i % all.size()]);
+  }
+  return cpus;
+}
+
+size_t L2CacheBytes() {
+  size_t bytes = 0;
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+  const long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  if (size > 0) bytes = static_cast<size_t>(size);
+#endif
+  return bytes == 0 ? 256 * 1024 : bytes;
+}
+
 void PinThreadToCPU(const int cpu) {
   ThreadAffinity affinity;
 #if OS_WIN
@@ -227,4 +312,198 @@ void PinThreadToRandomCPU() {
 #endif
 }
 
+bool ListDirectory(const std::string& directory,
+                   std::vector<DirectoryEntry>* entries) {
+#if OS_WIN
+  WIN32_FIND_DATAA data;
+  const HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &data);
+  if (find == INVALID_HANDLE_VALUE) return PIK_FAILURE("FindFirstFile");
+  do {
+    if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+    ULARGE_INTEGER size, time;
+    size.LowPart = data.nFileSizeLow;
+    size.HighPart = data.nFileSizeHigh;
+    time.LowPart = data.ftLastWriteTime.dwLowDateTime;
+    time.HighPart = data.ftLastWriteTime.dwHighDateTime;
+    // FILETIME counts 100 ns intervals since 1601.
+    const int64_t kEpochDelta = 11644473600LL;
+    entries->push_back({data.cFileName, static_cast<size_t>(size.QuadPart),
+                        static_cast<int64_t>(time.QuadPart / 10000000) -
+                            kEpochDelta});
+  } while (FindNextFileA(find, &data));
+  FindClose(find);
+  return true;
+#else
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr) return PIK_FAILURE("opendir");
+  while (const struct dirent* entry = readdir(dir)) {
+    struct stat st;
+    const std::string pathname = directory + "/" + entry->d_name;
+    if (stat(pathname.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+    entries->push_back({entry->d_name, static_cast<size_t>(st.st_size),
+                        static_cast<int64_t>(st.st_mtime)});
+  }
+  closedir(dir);
+  return true;
+#endif
+}
+
+bool TouchFile(const std::string& pathname) {
+#if OS_WIN
+  const HANDLE file =
+      CreateFileA(pathname.c_str(), FILE_WRITE_ATTRIBUTES, 0, nullptr,
+                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return PIK_FAILURE("CreateFile");
+  FILETIME now;
+  GetSystemTimeAsFileTime(&now);
+  const bool ok = SetFileTime(file, nullptr, nullptr, &now) != 0;
+  CloseHandle(file);
+  return ok;
+#else
+  return utime(pathname.c_str(), nullptr) == 0;
+#endif
+}
+
+void AdviseHugePages(void* begin, const size_t size) {
+#if OS_LINUX && defined(MADV_HUGEPAGE)
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(begin);
+  const uintptr_t first = (addr + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  const uintptr_t end = (addr + size) & ~(kHugePageSize - 1);
+  if (first >= end) return;
+  // Failure (e.g. THP not compiled in) only means there is no speedup.
+  (void)madvise(reinterpret_cast<void*>(first), end - first, MADV_HUGEPAGE);
+#endif
+}
+
+MappedFile::~MappedFile() { Close(); }
+
+void MappedFile::Close() {
+#if !OS_WIN
+  if (mapped_size_ != 0) {
+    PIK_CHECK(munmap(data_, mapped_size_) == 0);
+  } else {
+    free(data_);
+  }
+#else
+  free(data_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  mapped_size_ = 0;
+}
+
+bool MappedFile::Open(const std::string& pathname) {
+  Close();
+#if OS_WIN
+  FILE* f = fopen(pathname.c_str(), "rb");
+  if (f == nullptr) return PIK_FAILURE("File open");
+  if (fseek(f, 0, SEEK_END) != 0) {
+    fclose(f);
+    return PIK_FAILURE("Seek");
+  }
+  const long size = ftell(f);
+  if (size < 0 || fseek(f, 0, SEEK_SET) != 0) {
+    fclose(f);
+    return PIK_FAILURE("Seek");
+  }
+  data_ = static_cast<uint8_t*>(calloc(size + kPadding, 1));
+  const size_t bytes_read =
+      data_ == nullptr ? 0 : fread(data_, 1, static_cast<size_t>(size), f);
+  fclose(f);
+  if (bytes_read != static_cast<size_t>(size)) {
+    Close();
+    return PIK_FAILURE("File read");
+  }
+  size_ = size;
+  return true;
+#else
+  const int fd = open(pathname.c_str(), O_RDONLY);
+  if (fd < 0) return PIK_FAILURE("File open");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return PIK_FAILURE("File stat");
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+
+  // Reserve zero-initialized anonymous memory including the padding, then
+  // map the file over its beginning. Bytes after the end of the file within
+  // its last page are also zero, so no access faults beyond the mapping.
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t mapped_size =
+      (size + kPadding + page_size - 1) & ~(page_size - 1);
+  void* reserved = mmap(nullptr, mapped_size, PROT_READ,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (reserved == MAP_FAILED) {
+    close(fd);
+    return PIK_FAILURE("mmap reserve");
+  }
+  if (size != 0) {
+    void* mapped = mmap(reserved, size, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                        fd, 0);
+    if (mapped == MAP_FAILED) {
+      munmap(reserved, mapped_size);
+      close(fd);
+      return PIK_FAILURE("mmap file");
+    }
+    // Decoders and parsers read front to back.
+    (void)madvise(mapped, size, MADV_SEQUENTIAL);
+  }
+  close(fd);  // The mapping remains valid.
+
+  data_ = static_cast<uint8_t*>(reserved);
+  size_ = size;
+  mapped_size_ = mapped_size;
+  return true;
+#endif
+}
+
+PositionedFile::~PositionedFile() { (void)Close(); }
+
+bool PositionedFile::Open(const std::string& pathname) {
+  if (!Close()) return false;
+#if OS_WIN
+  file_ = fopen(pathname.c_str(), "wb");
+  if (file_ == nullptr) return PIK_FAILURE("File open");
+#else
+  fd_ = open(pathname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) return PIK_FAILURE("File open");
+#endif
+  return true;
+}
+
+bool PositionedFile::WriteAt(const uint64_t offset, const uint8_t* data,
+                             size_t size) {
+#if OS_WIN
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (_fseeki64(file_, static_cast<int64_t>(offset), SEEK_SET) != 0) {
+    return PIK_FAILURE("Seek");
+  }
+  if (fwrite(data, 1, size, file_) != size) return PIK_FAILURE("File write");
+#else
+  uint64_t pos = offset;
+  while (size != 0) {
+    // May write fewer bytes (e.g. if interrupted by a signal).
+    const ssize_t written = pwrite(fd_, data, size, static_cast<off_t>(pos));
+    if (written < 0) return PIK_FAILURE("File write");
+    data += written;
+    pos += written;
+    size -= written;
+  }
+#endif
+  return true;
+}
+
+bool PositionedFile::Close() {
+  bool ok = true;
+#if OS_WIN
+  if (file_ != nullptr) ok = fclose(file_) == 0;
+  file_ = nullptr;
+#else
+  if (fd_ >= 0) ok = close(fd_) == 0;
+  fd_ = -1;
+#endif
+  return ok;
+}
+
 }  // namespace pik
@@ -15,8 +15,15 @@
 #ifndef OS_SPECIFIC_H_
 #define OS_SPECIFIC_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include "padded_bytes.h"
+
 namespace pik {
 
 // Returns current wall-clock time [seconds].
@@ -31,6 +38,18 @@ void RaiseThreadPriority();
 // thread's initial affinity (unaffected by any SetThreadAffinity).
 std::vector<int> AvailableCPUs();
 
+// Returns AvailableCPUs grouped by NUMA node (in ascending order of node and
+// CPU number). Returns a single group if the topology is unknown.
+std::vector<std::vector<int>> AvailableCPUsPerNode();
+
+// Returns "num_threads" CPUs for pinning worker threads: all CPUs of the first
+// node before any of the next, so that smaller pools stay on one node (and
+// its memory). Wraps around if there are fewer CPUs than threads.
+std::vector<int> CPUsForThreads(size_t num_threads);
+
+// Returns the size [bytes] of the (per-core) L2 cache, or 256 KiB if unknown.
+size_t L2CacheBytes();
+
 // Opaque.
 struct ThreadAffinity;
 
@@ -49,6 +68,84 @@ void PinThreadToCPU(const int cpu);
 // Uses SetThreadAffinity.
 void PinThreadToRandomCPU();
 
+// A regular file within a directory.
+struct DirectoryEntry {
+  std::string name;  // Without the directory.
+  size_t size;       // [bytes]
+  int64_t mtime;     // Last modification [seconds since the epoch].
+};
+
+// Appends all regular files of "directory" to "entries" (in unspecified
+// order). Returns false if the directory cannot be read.
+bool ListDirectory(const std::string& directory,
+                   std::vector<DirectoryEntry>* entries);
+
+// Sets the modification time of an existing file to the current time.
+// Returns false on failure.
+bool TouchFile(const std::string& pathname);
+
+// Size [bytes] of a transparent huge page on x86 Linux.
+static constexpr size_t kHugePageSize = 2 << 20;
+
+// Asks the OS to back the huge page-aligned part of [begin, begin + size) with
+// transparent huge pages, which reduces TLB misses and the number of page
+// faults for large buffers. Best-effort: no effect on other OSes, or if THP
+// are disabled.
+void AdviseHugePages(void* begin, size_t size);
+
+// Read-only contents of an entire file. Memory-mapped where supported, so that
+// large inputs are paged in on demand instead of being copied to the heap;
+// otherwise read into memory. The contents are followed by at least kPadding
+// zero bytes, which meets the padding requirement of PaddedBytes.
+class MappedFile {
+ public:
+  static constexpr size_t kPadding = 64;
+
+  MappedFile() {}
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Returns false if the file cannot be opened or read.
+  bool Open(const std::string& pathname);
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  void Close();
+
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t mapped_size_ = 0;  // 0 if data_ was allocated via malloc.
+};
+
+// Output file whose parts are written at their offsets via pwrite, so that
+// several threads can write concurrently without seeking (see
+// PositionedByteSink). Elsewhere, writes are serialized with a mutex.
+class PositionedFile : public PositionedByteSink {
+ public:
+  PositionedFile() {}
+  ~PositionedFile();
+
+  PositionedFile(const PositionedFile&) = delete;
+  PositionedFile& operator=(const PositionedFile&) = delete;
+
+  // Creates or truncates the file. Returns false if it cannot be opened.
+  bool Open(const std::string& pathname);
+
+  bool WriteAt(uint64_t offset, const uint8_t* data, size_t size) override;
+
+  // Returns false if closing fails, e.g. because a delayed write failed.
+  bool Close();
+
+ private:
+  int fd_ = -1;
+  FILE* file_ = nullptr;  // Only if pwrite is unavailable.
+  std::mutex mutex_;      // Guards file_.
+};
+
 }  // namespace pik
 
 #endif  // OS_SPECIFIC_H_
@@ -11,6 +11,15 @@ size_t PaddedBytes::PaddedSize(const size_t size) {
   return (size + 7) & ~7;
 }
 
+PaddedBytes PaddedBytes::View(const uint8_t* data, const size_t size) {
+  PaddedBytes view;
+  view.size_ = size;
+  view.padded_size_ = PaddedSize(size);
+  view.data_ = std::unique_ptr<uint8_t[], Deleter>(const_cast<uint8_t*>(data),
+                                                   Deleter{false});
+  return view;
+}
+
 void PaddedBytes::resize(const size_t size) {
   const size_t new_padded_size = PaddedSize(size);
 
@@ -20,7 +29,9 @@ void PaddedBytes::resize(const size_t size) {
     return;
   }
 
-  CacheAlignedUniquePtr new_data = AllocateArray(new_padded_size);
+  PIK_CHECK(data_.get_deleter().owned);  // Views are not resizable.
+  std::unique_ptr<uint8_t[], Deleter> new_data(
+      AllocateArray(new_padded_size).release(), Deleter{true});
   memcpy(new_data.get(), data_.get(), size_);  // old size
   memset(new_data.get() + size_, 0, new_padded_size - size_);
 
@@ -29,4 +40,81 @@ void PaddedBytes::resize(const size_t size) {
   std::swap(new_data, data_);
 }
 
+bool PaddedBytesSink::WriteAt(const uint64_t offset, const uint8_t* data,
+                              const size_t size) {
+  if (offset + size > bytes_->size()) {
+    return PIK_FAILURE("Write exceeds the preallocated size");
+  }
+  memcpy(bytes_->data() + offset, data, size);
+  return true;
+}
+
+SegmentedBytes::SegmentedBytes(const PaddedBytes& bytes) {
+  if (bytes.size() != 0) {
+    segments_.push_back(
+        Segment{bytes.data(), 0, bytes.size(), bytes.padded_size()});
+  }
+  size_ = bytes.size();
+}
+
+SegmentedBytes::SegmentedBytes(const std::vector<ByteSegment>& segments) {
+  segments_.reserve(segments.size());
+  for (const ByteSegment& segment : segments) {
+    if (segment.size == 0) continue;
+    segments_.push_back(
+        Segment{segment.data, size_, segment.size, segment.size});
+    size_ += segment.size;
+  }
+}
+
+size_t SegmentedBytes::Find(const uint64_t pos) const {
+  PIK_ASSERT(pos < size_);
+  // First segment that begins after pos, minus one.
+  const auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), pos,
+      [](const uint64_t pos, const Segment& s) { return pos < s.begin; });
+  return it - segments_.begin() - 1;
+}
+
+size_t SegmentedBytes::ContiguousSize(const uint64_t begin) const {
+  const Segment& segment = segments_[Find(begin)];
+  return segment.begin + segment.size - begin;
+}
+
+const uint8_t* SegmentedBytes::Range(const uint64_t begin, const size_t size,
+                                     PaddedBytes* storage,
+                                     size_t* PIK_RESTRICT readable) const {
+  PIK_CHECK(begin + size <= size_);
+  if (size == 0) {
+    *readable = 0;
+    return nullptr;
+  }
+  const Segment& segment = segments_[Find(begin)];
+  const size_t offset = begin - segment.begin;
+  if (offset + size <= segment.size) {
+    *readable = segment.readable - offset;
+    return segment.data + offset;
+  }
+  Copy(begin, size, storage);
+  *readable = storage->padded_size();
+  return storage->data();
+}
+
+void SegmentedBytes::Copy(const uint64_t begin, size_t size,
+                          PaddedBytes* out) const {
+  size = begin >= size_ ? 0 : std::min<uint64_t>(size, size_ - begin);
+  out->resize(size);
+  if (size == 0) return;
+  uint64_t pos = begin;
+  size_t copied = 0;
+  for (size_t i = Find(begin); copied != size; ++i) {
+    const Segment& segment = segments_[i];
+    const size_t offset = pos - segment.begin;
+    const size_t bytes = std::min(segment.size - offset, size - copied);
+    memcpy(out->data() + copied, segment.data + offset, bytes);
+    copied += bytes;
+    pos += bytes;
+  }
+}
+
 }  // namespace pik
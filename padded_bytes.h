@@ -18,6 +18,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <vector>
 
 #include "cache_aligned.h"
 
@@ -28,15 +29,21 @@ namespace pik {
 class PaddedBytes {
  public:
   // Required for output params.
-  PaddedBytes() : size_(0), padded_size_(0), data_() {}
+  PaddedBytes() : size_(0), padded_size_(0), data_(nullptr, Deleter{true}) {}
 
   PaddedBytes(size_t size)
       : size_(size),
         padded_size_(PaddedSize(size)),
-        data_(AllocateArray(padded_size_)) {
+        data_(AllocateArray(padded_size_).release(), Deleter{true}) {
     memset(data_.get() + size_, 0, padded_size_ - size_);
   }
 
+  // Returns a non-owning, read-only view of "size" bytes starting at "data",
+  // e.g. a MappedFile, which avoids copying large inputs. "data" must outlive
+  // the view and be readable for PaddedSize(size) bytes. The view must not be
+  // written to nor resized.
+  static PaddedBytes View(const uint8_t* data, size_t size);
+
   // Reallocates and copies if PaddedSize(size) > padded_size_. The common case
   // of resizing to the final size after preallocating the upper bound is cheap.
   void resize(size_t size);
@@ -48,11 +55,93 @@ class PaddedBytes {
   size_t padded_size() const { return padded_size_; }
 
  private:
+  // Views (see View) do not own their storage.
+  struct Deleter {
+    void operator()(uint8_t* aligned_pointer) const {
+      if (owned) CacheAligned::Free(aligned_pointer);
+    }
+    bool owned;
+  };
+
   static size_t PaddedSize(size_t size);
 
   size_t size_;
   size_t padded_size_;
-  CacheAlignedUniquePtr data_;
+  std::unique_ptr<uint8_t[], Deleter> data_;
+};
+
+// Destination of an encoded stream whose parts are written at their final
+// offsets, possibly out of order and concurrently, e.g. via pwrite to a file.
+// This avoids holding the entire stream in memory.
+class PositionedByteSink {
+ public:
+  virtual ~PositionedByteSink() {}
+
+  // Writes "size" bytes to [offset, offset + size). Called concurrently for
+  // non-overlapping ranges. Returns false on failure.
+  virtual bool WriteAt(uint64_t offset, const uint8_t* data, size_t size) = 0;
+};
+
+// Writes to preallocated memory; fails if a range exceeds bytes->size().
+class PaddedBytesSink : public PositionedByteSink {
+ public:
+  explicit PaddedBytesSink(PaddedBytes* bytes) : bytes_(bytes) {}
+
+  bool WriteAt(uint64_t offset, const uint8_t* data, size_t size) override;
+
+ private:
+  PaddedBytes* bytes_;  // Not owned.
+};
+
+// Non-owning read-only range of bytes, e.g. one of several network buffers
+// that together hold a compressed image.
+struct ByteSegment {
+  const uint8_t* data;
+  size_t size;
+};
+
+// Read-only view of a stream stored as consecutive, not necessarily adjacent
+// segments (scatter-gather input), which must outlive the view. Ranges within
+// one segment are accessed in place; only ranges that straddle segment
+// boundaries are copied.
+class SegmentedBytes {
+ public:
+  // Single segment that is readable up to its padded_size.
+  explicit SegmentedBytes(const PaddedBytes& bytes);
+  explicit SegmentedBytes(const std::vector<ByteSegment>& segments);
+
+  uint64_t size() const { return size_; }
+
+  // Returns the number of bytes from "begin" (< size()) to the end of its
+  // segment, i.e. the size of the largest range starting there that Range
+  // returns without copying.
+  size_t ContiguousSize(uint64_t begin) const;
+
+  // Returns a pointer to the bytes [begin, begin + size) of the stream, which
+  // must lie within it. Points into the segment if possible, otherwise copies
+  // the bytes into "storage" (which is resized as needed). Sets *readable to
+  // the number of bytes (>= size) that may be loaded from the pointer, e.g.
+  // by PaddedBitReader.
+  const uint8_t* Range(uint64_t begin, size_t size, PaddedBytes* storage,
+                       size_t* PIK_RESTRICT readable) const;
+
+  // Copies the bytes [begin, begin + size) to "out", or fewer if the stream
+  // ends before.
+  void Copy(uint64_t begin, size_t size, PaddedBytes* out) const;
+
+ private:
+  struct Segment {
+    const uint8_t* data;
+    uint64_t begin;   // Within the stream.
+    size_t size;
+    size_t readable;  // >= size.
+  };
+
+  // Returns the index of the segment that contains "pos" (< size_).
+  size_t Find(uint64_t pos) const;
+
+  std::vector<Segment> segments_;  // Non-empty, in stream order.
+  uint64_t size_ = 0;
 };
 
 }  // namespace pik
@@ -21,8 +21,13 @@
 #include <string.h>
 #include <algorithm>
 #include <array>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #define PROFILER_ENABLED 1
@@ -50,10 +55,14 @@
 #include "guetzli/processor.h"
 #include "header.h"
 #include "image_io.h"
+#include "image_ops.h"
 #include "jpeg_quant_tables.h"
+#include "lossless.h"
 #include "noise.h"
 #include "opsin_image.h"
 #include "opsin_inverse.h"
+#include "orientation.h"
+#include "os_specific.h"
 #include "pik_alpha.h"
 #include "profiler.h"
 #include "quantizer.h"
@@ -68,6 +77,59 @@ const float kEpfMulScale = 10000.0f;
 const int32_t FLAGS_epf_mul = 256;
 
 namespace pik {
+
+// Encoder state retained by PikEncoder across images (the PixelsToPik
+// functions use a temporary instance).
+struct EncoderBuffers {
+  size_t BytesAllocated() const {
+    return search.BytesAllocated() + coefficients.BytesAllocated() +
+           recon.BytesAllocated();
+  }
+
+  EncCache search;        // FindBestQuantization*
+  EncCache coefficients;  // Final coefficients and the target size search.
+  DecCache recon;         // Reconstruction within FindBestQuantization*.
+
+  // Butteraugli state of the current image's original; shared by all
+  // comparators of FindBestQuantization* (e.g. in CompressToTargetSize).
+  butteraugli::ButteraugliReferencePtr butteraugli_reference;
+  // AdaptiveQuantizationMap of the current image's original, from which all
+  // FindBestQuantization* calls start; computed on first use and retained
+  // like butteraugli_reference.
+  ImageF adaptive_quant_field;
+
+  // Now() after which FindBestQuantization* stop iterating; 0 = no deadline.
+  double deadline = 0.0;
+  // CompressParams::cancel of the current image; also stops the searches.
+  const CancellationToken* cancel = nullptr;
+
+  // Set by PixelsToPikLadder while it encodes one image at several distances.
+  // The butteraugli reference and the following are then retained across
+  // OpsinToPikT calls; otherwise they remain empty.
+  bool same_image = false;
+  // Centered opsin after GaborishInverse (only computed if any header uses
+  // kGaborishTransform).
+  Image3F gaborish_opsin;
+  // TransposedScaledDCT of the centered opsin, without/with GaborishInverse.
+  Image3F opsin_dct[2];
+  // If set (also by PixelsToPikLadder), the final AC quant field of each
+  // search and its butteraugli target are retained in prior_*, and the next
+  // FindBestQuantization starts from them.
+  bool warm_start = false;
+  ImageF prior_quant_field;
+  float prior_distance = 0.0f;  // 0 = no prior field yet.
+
+  // Butteraugli distance of the original to its source (e.g. the JPEG that
+  // was decoded to obtain it), or 0 if unknown. Set by JpegToPik.
+  float source_distance = 0.0f;
+
+  // If non-null, OpsinToPikT writes the entire output (including the header
+  // and sections already in "compressed") to the sink instead of appending to
+  // "compressed", and sets sink_size. Brunsli encodes do not use the sink.
+  PositionedByteSink* sink = nullptr;
+  uint64_t sink_size = 0;  // 0 = sink not used.
+};
+
 namespace {
 
 template <class Image>
@@ -197,7 +259,8 @@ void DumpHeatmaps(const PikInfo* info,
               ba_target, 1.5f * ba_target);
 }
 
-void DoDenoise(const Quantizer& quantizer, Image3F* PIK_RESTRICT opsin) {
+void DoDenoise(const Quantizer& quantizer, ThreadPool* pool,
+               Image3F* PIK_RESTRICT opsin) {
   const float scale = quantizer.Scale() * kEpfMulScale;
   epf::AdaptiveFilterParams epf_params;
   epf_params.dc_quant = quantizer.RawDC();  // unused
@@ -205,27 +268,188 @@ void DoDenoise(const Quantizer& quantizer, Image3F* PIK_RESTRICT opsin) {
   epf_params.ac_quant = &quantizer.RawQuantField();
   epf_params.sigma_add = 0;
   epf_params.sigma_mul = scale / (FLAGS_epf_mul << epf::kSigmaShift);
-  dispatch::Run(dispatch::SupportedTargets(), epf::EdgePreservingFilter(),
-                opsin, epf_params);
+
+  // The guide mapping depends on the range of the entire image.
+  std::array<float, 3> min3, max3;
+  Image3MinMax(*opsin, pool, &min3, &max3);
+  const float min = *std::min_element(min3.begin(), min3.end());
+  const float max = *std::max_element(max3.begin(), max3.end());
+  if (!(max > min)) return;  // Constant image: nothing to smooth.
+
+  epf::AdaptiveFilterTileArgs tile_args;
+  tile_args.params = epf_params;
+  tile_args.min = min;
+  tile_args.stretch = 255.0f / (max - min);
+
+  // Filters tiles of a mirrored source instead of a padded copy of the image.
+  // Neighboring tiles still read the unfiltered pixels, so the output cannot
+  // overwrite "opsin" until the graph is done.
+  TFBuilder builder;
+  TFNode* src_opsin =
+      builder.AddSource("src_opsin", 3, TFType::kF32, TFWrap::kMirror);
+  builder.SetSource(src_opsin, opsin);
+  const TFFunc func =
+      dispatch::Dispatched<epf::EdgePreservingFilterFuncImpl,
+                           TFFunc()>::Get()();
+  TFNode* epf = builder.Add(
+      "epf", Borders(epf::kBorder), Scale(), {src_opsin}, 3, TFType::kF32,
+      func, reinterpret_cast<const uint8_t*>(&tile_args), sizeof(tile_args));
+  Image3F filtered(opsin->xsize(), opsin->ysize());
+  builder.SetSink(epf, &filtered);
+  builder.Finalize(ImageSize::Make(opsin->xsize(), opsin->ysize()), pool)
+      ->Run();
+  *opsin = std::move(filtered);
+}
+
+// Returns buffers->butteraugli_reference, computing it (or loading it from
+// the cache file) on first use for the current image.
+const butteraugli::ButteraugliReferencePtr& ButteraugliReferenceFor(
+    const Image3F& opsin_orig, const CompressParams& cparams, ThreadPool* pool,
+    EncoderBuffers* buffers) {
+  if (buffers->butteraugli_reference == nullptr) {
+    buffers->butteraugli_reference = ComputeButteraugliReference(
+        opsin_orig, pool, cparams.butteraugli_reference_cache);
+  }
+  return buffers->butteraugli_reference;
+}
+
+// Returns buffers->adaptive_quant_field, computing it on first use for the
+// current image.
+const ImageF& AdaptiveQuantizationFor(const Image3F& opsin_orig,
+                                      ThreadPool* pool,
+                                      EncoderBuffers* buffers) {
+  if (buffers->adaptive_quant_field.xsize() == 0) {
+    buffers->adaptive_quant_field =
+        AdaptiveQuantizationMap(opsin_orig.Plane(1), 8, pool);
+  }
+  return buffers->adaptive_quant_field;
+}
+
+// Maximum number of FindBestQuantization* iterations if the source distance is
+// known: the search then starts close enough that only the first (coarse)
+// iterations are worthwhile.
+static const int kSourceSearchIters = 3;
+
+// Returns whether the search should stop (CompressParams::time_budget_ms) and
+// if so, records that in "aux_out" along with the "distance" reached. Also
+// stops cancelled searches, whose result OpsinToPikT then discards.
+bool SearchOutOfTime(const EncoderBuffers& buffers, const float distance,
+                     PikInfo* aux_out) {
+  if (IsCancelled(buffers.cancel)) return true;
+  if (buffers.deadline == 0.0 || Now() < buffers.deadline) return false;
+  if (aux_out != nullptr) {
+    ++aux_out->num_search_timeouts;
+    aux_out->max_timeout_distance =
+        std::max(aux_out->max_timeout_distance, distance);
+  }
+  return true;
+}
+
+// Tiles whose distance is at most this fraction below the target are close
+// enough; coarser quantization would barely save bits but could overshoot.
+static const float kConvergedTolerance = 0.05f;
+
+// Marks tiles of "tile_distmap" as converged once their distance is within
+// kConvergedTolerance below "target", and unmarks them if it exceeds the
+// target (e.g. due to changes of their neighbors). The searches do not change
+// the quantization of marked tiles, so CompareIncremental only recomputes the
+// surroundings of the others. Returns the number of unmarked (active) tiles
+// and records it for iteration "iter" in "aux_out".
+size_t UpdateConvergedTiles(const ImageF& tile_distmap, const float target,
+                            const size_t iter, ImageB* converged,
+                            PikInfo* aux_out) {
+  PIK_ASSERT(SameSize(tile_distmap, *converged));
+  const float min_converged = (1.0f - kConvergedTolerance) * target;
+  size_t num_active = 0;
+  for (size_t y = 0; y < tile_distmap.ysize(); ++y) {
+    const float* PIK_RESTRICT row_dist = tile_distmap.ConstRow(y);
+    uint8_t* PIK_RESTRICT row_converged = converged->Row(y);
+    for (size_t x = 0; x < tile_distmap.xsize(); ++x) {
+      if (row_dist[x] > target) {
+        row_converged[x] = 0;
+      } else if (row_dist[x] >= min_converged) {
+        row_converged[x] = 1;
+      }
+      num_active += 1 - row_converged[x];
+    }
+  }
+  if (aux_out != nullptr) {
+    aux_out->AddSearchIteration(iter, num_active,
+                                tile_distmap.xsize() * tile_distmap.ysize());
+  }
+  return num_active;
 }
 
 void FindBestQuantization(const Image3F& opsin_orig, const Image3F& opsin_arg,
                           const CompressParams& cparams, const Header& header,
                           float butteraugli_target, const ColorTransform& ctan,
                           ThreadPool* pool, Quantizer* quantizer,
-                          PikInfo* aux_out) {
-  ButteraugliComparator comparator(opsin_orig, cparams.hf_asymmetry);
+                          EncoderBuffers* buffers, PikInfo* aux_out) {
+  ButteraugliComparator comparator(
+      ButteraugliReferenceFor(opsin_orig, cparams, pool, buffers),
+      cparams.hf_asymmetry, pool);
+  // The first iterations may compare at half resolution (Subsample requires
+  // even sizes); their distmap pixels then cover 2x2 pixels.
+  size_t num_proxy_iters = 0;
+  std::unique_ptr<ButteraugliComparator> proxy_comparator;
+  if (opsin_orig.xsize() % 2 == 0 && opsin_orig.ysize() % 2 == 0 &&
+      opsin_orig.xsize() >= 16 && opsin_orig.ysize() >= 16 &&
+      cparams.max_butteraugli_iters > 1) {
+    num_proxy_iters = std::min<size_t>(cparams.butteraugli_proxy_iters,
+                                       cparams.max_butteraugli_iters - 1);
+  }
+  if (num_proxy_iters != 0) {
+    proxy_comparator.reset(new ButteraugliComparator(
+        Subsample(opsin_orig, 2), cparams.hf_asymmetry, pool));
+  }
   const float butteraugli_target_dc =
       std::min<float>(butteraugli_target,
                       pow(butteraugli_target, 0.75868992821757641));
   const float kInitialQuantDC = (0.72356878844141492  ) / butteraugli_target_dc;
   const float kQuantAC = (1.2543199079397958  ) / butteraugli_target;
-  ImageF quant_field =
-      ScaleImage(kQuantAC, AdaptiveQuantizationMap(opsin_orig.Plane(1), 8));
+  ImageF quant_field;
+  // A field found for another distance (quantization is roughly inversely
+  // proportional to the distance) replaces the coarse initial iterations.
+  static const int kWarmStartSkippedIters = 2;
+  int first_iter = 0;
+  int end_iter = cparams.max_butteraugli_iters;
+  if (buffers->prior_distance > 0.0f &&
+      cparams.max_butteraugli_iters > kWarmStartSkippedIters) {
+    ScaleImage(buffers->prior_distance / butteraugli_target,
+               buffers->prior_quant_field, &quant_field);
+    first_iter = kWarmStartSkippedIters;
+  } else {
+    CopyImageTo(AdaptiveQuantizationFor(opsin_orig, pool, buffers),
+                &quant_field);
+    if (buffers->source_distance > 0.0f) {
+      // The source has no detail beyond its own distance, so quantizing more
+      // finely than for that distance would mostly preserve its artifacts.
+      ScaleImage(kQuantAC * butteraugli_target /
+                     std::max(butteraugli_target, buffers->source_distance),
+                 &quant_field);
+      end_iter = std::min(end_iter, kSourceSearchIters);
+    } else {
+      ScaleImage(kQuantAC, &quant_field);
+    }
+  }
   ImageF tile_distmap;
+  // Shared by all iterations so their size estimates are comparable.
+  TokenCostModel cost_model;
 
-  EncCache cache;
-  for (int i = 0; i < cparams.max_butteraugli_iters; ++i) {
+  EncCache& cache = buffers->search;
+  cache.Reset();
+  // Reused across iterations.
+  Image3B srgb;
+  ImageB converged(quant_field.xsize(), quant_field.ysize());
+  FillImage(uint8_t(0), &converged);
+  float distance = 0.0f;
+  for (int i = first_iter; i < end_iter; ++i) {
+    // Each iteration refines the field of the previous one, which thus is the
+    // best so far.
+    if (i != first_iter && SearchOutOfTime(*buffers, distance, aux_out)) {
+      break;
+    }
+    PikStageTimer timer(aux_out, kStageQuantSearch);
     if (FLAGS_dump_quant_state) {
       printf("\nQuantization field:\n");
       for (int y = 0; y < quant_field.ysize(); ++y) {
@@ -240,28 +464,58 @@ void FindBestQuantization(const Image3F& opsin_orig, const Image3F& opsin_arg,
                                  cparams)) {
       QuantizedCoeffs qcoeffs = ComputeCoefficients(
           cparams, header, opsin_arg, *quantizer, ctan, pool, &cache);
-      DecCache dec_cache;
+      float estimated_bits = 0.0f;
+      if (FLAGS_log_search_state) {
+        const ImageF tile_bits =
+            EstimateGroupBits(qcoeffs, *quantizer, pool, &cost_model);
+        for (size_t y = 0; y < tile_bits.ysize(); ++y) {
+          for (size_t x = 0; x < tile_bits.xsize(); ++x) {
+            estimated_bits += tile_bits.Row(y)[x];
+          }
+        }
+      }
+      DecCache& dec_cache = buffers->recon;
       dec_cache.quantized_dc = std::move(qcoeffs.dc);
       dec_cache.quantized_ac = std::move(qcoeffs.ac);
       dec_cache.gradient[0] = std::move(cache.gradient[0]);
       dec_cache.gradient[1] = std::move(cache.gradient[1]);
       dec_cache.gradient[2] = std::move(cache.gradient[2]);
-      Image3F recon =
-          ReconOpsinImage(header, *quantizer, ctan, pool, &dec_cache);
-
+      const bool dither = (header.flags & Header::kDither) != 0;
+      const bool proxy = static_cast<size_t>(i) < num_proxy_iters;
       // (no need for any additional override: in the encoder, kDenoise is only
       // set if the override allowed it)
-      if (header.flags & Header::kDenoise) {
-        DoDenoise(*quantizer, &recon);
+      const bool denoise = (header.flags & Header::kDenoise) != 0;
+      // If nothing operates on the opsin reconstruction, low_memory fuses the
+      // sRGB conversion into it instead of materializing it.
+      const bool direct_srgb = cparams.low_memory && !proxy && !denoise;
+      Image3F recon;
+      if (direct_srgb) {
+        ReconSrgbImage(header, *quantizer, ctan, dither, pool, &dec_cache,
+                       &srgb);
+      } else {
+        recon = ReconOpsinImage(header, *quantizer, ctan, pool, &dec_cache);
+        if (denoise) {
+          DoDenoise(*quantizer, pool, &recon);
+        }
       }
 
       PROFILER_ZONE("enc Butteraugli");
-      Image3B srgb;
-      const bool dither = (header.flags & Header::kDither) != 0;
-      CenteredOpsinToSrgb(recon, dither, pool, &srgb);
-      comparator.Compare(srgb);
+      ButteraugliComparator& cur_comparator =
+          proxy ? *proxy_comparator : comparator;
+      if (proxy) {
+        CenteredOpsinToSrgb(Subsample(recon, 2), dither, pool, &srgb);
+      } else if (!direct_srgb) {
+        CenteredOpsinToSrgb(recon, dither, pool, &srgb);
+      }
+      cur_comparator.CompareIncremental(srgb);
+      distance = cur_comparator.distance();
       static const int kMargins[100] = { 0, 0, 1, 2, 1, 0, 0 };
-      tile_distmap = TileDistMap(comparator.distmap(), 8, kMargins[i]);
+      if (proxy) {
+        tile_distmap = TileDistMap(cur_comparator.distmap(), 4,
+                                   (kMargins[i] + 1) / 2);
+      } else {
+        tile_distmap = TileDistMap(comparator.distmap(), 8, kMargins[i]);
+      }
       if (WantDebugOutput(aux_out)) {
         DumpHeatmaps(aux_out, opsin_orig.xsize(), opsin_orig.ysize(),
                      8, butteraugli_target, quant_field, tile_distmap);
@@ -273,12 +527,14 @@ void FindBestQuantization(const Image3F& opsin_orig, const Image3F& opsin_arg,
       }
       if (FLAGS_log_search_state) {
         float minval, maxval;
-        ImageMinMax(quant_field, &minval, &maxval);
+        ImageMinMax(quant_field, pool, &minval, &maxval);
         printf("\nButteraugli iter: %d/%d\n", i,
                cparams.max_butteraugli_iters);
-        printf("Butteraugli distance: %f\n", comparator.distance());
+        printf("Butteraugli distance: %f%s\n", cur_comparator.distance(),
+               proxy ? " (2x downsampled)" : "");
         printf("quant range: %f ... %f  DC quant: %f\n", minval, maxval,
                kInitialQuantDC);
+        printf("Estimated AC size: %.0f bytes\n", estimated_bits / 8);
         if (FLAGS_dump_quant_state) {
           quantizer->DumpQuantizationMap();
         }
@@ -294,12 +550,16 @@ void FindBestQuantization(const Image3F& opsin_orig, const Image3F& opsin_arg,
       0.0,
     };
     const double cur_pow = kPow[i];
+    UpdateConvergedTiles(tile_distmap, butteraugli_target, i, &converged,
+                         aux_out);
     // pow(x, 0) == x, so skip pow.
     if (cur_pow == 0.0) {
       for (int y = 0; y < quant_field.ysize(); ++y) {
         const float* const PIK_RESTRICT row_dist = tile_distmap.Row(y);
+        const uint8_t* const PIK_RESTRICT row_converged = converged.Row(y);
         float* const PIK_RESTRICT row_q = quant_field.Row(y);
         for (int x = 0; x < quant_field.xsize(); ++x) {
+          if (row_converged[x]) continue;
           const float diff = row_dist[x] / butteraugli_target;
           if (diff >= 1.0f) {
             row_q[x] *= diff;
@@ -309,8 +569,10 @@ void FindBestQuantization(const Image3F& opsin_orig, const Image3F& opsin_arg,
     } else {
       for (int y = 0; y < quant_field.ysize(); ++y) {
         const float* const PIK_RESTRICT row_dist = tile_distmap.Row(y);
+        const uint8_t* const PIK_RESTRICT row_converged = converged.Row(y);
         float* const PIK_RESTRICT row_q = quant_field.Row(y);
         for (int x = 0; x < quant_field.xsize(); ++x) {
+          if (row_converged[x]) continue;
           const float diff = row_dist[x] / butteraugli_target;
           if (diff < 1.0f) {
             row_q[x] *= pow(diff, cur_pow);
@@ -325,15 +587,43 @@ void FindBestQuantization(const Image3F& opsin_orig, const Image3F& opsin_arg,
                            cparams);
 }
 
+// Alternative quantization field that FindBestQuantizationHQ evaluates
+// alongside the main one (see CompressParams::hq_search_candidates).
+struct HQSearchCandidate {
+  HQSearchCandidate(const butteraugli::ButteraugliReferencePtr& reference,
+                    const CompressParams& cparams, const Header& header,
+                    const size_t xsize_blocks, const size_t ysize_blocks,
+                    ThreadPool* pool)
+      : quant_field(xsize_blocks, ysize_blocks),
+        quantizer(header.quant_template, xsize_blocks, ysize_blocks),
+        comparator(new ButteraugliComparator(reference, cparams.hf_asymmetry,
+                                             pool)) {}
+
+  ImageF quant_field;
+  // Whether quant_field was adjusted for (and is evaluated in) the next
+  // iteration.
+  bool active = false;
+  Quantizer quantizer;
+  Image3F coeffs;
+  DecCache dec_cache;
+  Image3B srgb;
+  std::unique_ptr<ButteraugliComparator> comparator;
+  size_t estimated_size = 0;
+};
+
 void FindBestQuantizationHQ(const Image3F& opsin_orig, const Image3F& opsin,
                             const CompressParams& cparams, const Header& header,
                             float butteraugli_target,
                             const ColorTransform& ctan, ThreadPool* pool,
-                            Quantizer* quantizer, PikInfo* aux_out) {
+                            Quantizer* quantizer, EncoderBuffers* buffers,
+                            PikInfo* aux_out) {
   const bool slow = cparams.guetzli_mode;
-  ButteraugliComparator comparator(opsin_orig, cparams.hf_asymmetry);
-  ImageF quant_field = ScaleImage(
-      slow ? 1.2f : 1.5f, AdaptiveQuantizationMap(opsin_orig.Plane(1), 8));
+  std::unique_ptr<ButteraugliComparator> comparator(new ButteraugliComparator(
+      ButteraugliReferenceFor(opsin_orig, cparams, pool, buffers),
+      cparams.hf_asymmetry, pool));
+  ImageF quant_field =
+      CopyImage(AdaptiveQuantizationFor(opsin_orig, pool, buffers));
+  ScaleImage(slow ? 1.2f : 1.5f, &quant_field);
   ImageF best_quant_field = CopyImage(quant_field);
   float best_butteraugli = 1000.0f;
   ImageF tile_distmap;
@@ -346,8 +636,61 @@ void FindBestQuantizationHQ(const Image3F& opsin_orig, const Image3F& opsin,
   int num_stalling_iters = 0;
   int max_iters = slow ? cparams.max_butteraugli_iters_guetzli_mode :
                   cparams.max_butteraugli_iters;
-  EncCache cache;
+  if (buffers->source_distance > 0.0f) {
+    max_iters = std::min(max_iters, kSourceSearchIters);
+  }
+  EncCache& cache = buffers->search;
+  cache.Reset();
+  // Reused across iterations.
+  Image3B srgb;
+  ImageB converged(quant_field.xsize(), quant_field.ysize());
+  FillImage(uint8_t(0), &converged);
+
+  // Candidates reuse the DCT and prediction of "cache", which low_memory
+  // does not retain.
+  std::vector<HQSearchCandidate> candidates;
+  if (!cparams.low_memory) {
+    candidates.reserve(cparams.hq_search_candidates);
+    for (size_t k = 1; k < cparams.hq_search_candidates; ++k) {
+      candidates.emplace_back(comparator->reference(), cparams, header,
+                              quant_field.xsize(), quant_field.ysize(), pool);
+    }
+  }
+  ImageF unadjusted_field;
+  // Of the field that the current candidates were adjusted from.
+  float prev_distance = 0.0f;
+  size_t prev_size = 0;
+
+  // Adjusts the tiles of "field" within "radius" of a distance peak by "step"
+  // times the default amount. Returns whether any of them changed.
+  const auto adjust = [&](const int radius, const float step, ImageF* field) {
+    bool changed = false;
+    const ImageF dist_to_peak_map =
+        DistToPeakMap(tile_distmap, butteraugli_target, radius, 0.0);
+    for (int y = 0; y < field->ysize(); ++y) {
+      float* const PIK_RESTRICT row_q = field->Row(y);
+      const float* const PIK_RESTRICT row_dist = dist_to_peak_map.Row(y);
+      const uint8_t* const PIK_RESTRICT row_converged = converged.Row(y);
+      for (int x = 0; x < field->xsize(); ++x) {
+        if (row_dist[x] >= 0.0f && !row_converged[x]) {
+          static const float kAdjSpeed[kMaxOuterIters] = {0.1f, 0.04f};
+          const float factor = step * (slow ? kAdjSpeed[outer_iter] : 0.2f) *
+                               tile_distmap.Row(y)[x];
+          if (AdjustQuantVal(&row_q[x], row_dist[x], factor, quant_ceil)) {
+            changed = true;
+          }
+        }
+      }
+    }
+    return changed;
+  };
+
   for (;;) {
+    if (butteraugli_iter != 0 &&
+        SearchOutOfTime(*buffers, best_butteraugli, aux_out)) {
+      break;
+    }
+    PikStageTimer timer(aux_out, kStageQuantSearch);
     if (FLAGS_dump_quant_state) {
       printf("\nQuantization field:\n");
       for (int y = 0; y < quant_field.ysize(); ++y) {
@@ -358,35 +701,119 @@ void FindBestQuantizationHQ(const Image3F& opsin_orig, const Image3F& opsin,
       }
     }
     float qmin, qmax;
-    ImageMinMax(quant_field, &qmin, &qmax);
+    ImageMinMax(quant_field, pool, &qmin, &qmax);
     if (quantizer->SetQuantField(quant_dc, QuantField(quant_field), cparams)) {
       QuantizedCoeffs qcoeffs = ComputeCoefficients(
           cparams, header, opsin, *quantizer, ctan, pool, &cache);
-      DecCache dec_cache;
+      bool any_candidate = false;
+      for (const HQSearchCandidate& candidate : candidates) {
+        any_candidate |= candidate.active;
+      }
+      size_t estimated_size = 0;
+      if (!candidates.empty()) {
+        estimated_size = EstimateBitstreamSize(qcoeffs, header, *quantizer,
+                                               NoiseParams(), ctan, pool);
+      }
+      DecCache& dec_cache = buffers->recon;
       dec_cache.quantized_dc = std::move(qcoeffs.dc);
       dec_cache.quantized_ac = std::move(qcoeffs.ac);
       dec_cache.gradient[0] = std::move(cache.gradient[0]);
       dec_cache.gradient[1] = std::move(cache.gradient[1]);
       dec_cache.gradient[2] = std::move(cache.gradient[2]);
-      Image3F recon =
-          ReconOpsinImage(header, *quantizer, ctan, pool, &dec_cache);
+      const bool dither = (header.flags & Header::kDither) != 0;
+      if (cparams.low_memory) {
+        // Without a full-size opsin reconstruction.
+        ReconSrgbImage(header, *quantizer, ctan, dither, pool, &dec_cache,
+                       &srgb);
+      } else {
+        const Image3F recon =
+            ReconOpsinImage(header, *quantizer, ctan, pool, &dec_cache);
+        CenteredOpsinToSrgb(recon, dither, pool, &srgb);
+      }
 
       PROFILER_ZONE("enc Butteraugli");
-      Image3B srgb;
-      const bool dither = (header.flags & Header::kDither) != 0;
-      CenteredOpsinToSrgb(recon, dither, pool, &srgb);
-      comparator.Compare(srgb);
+      comparator->CompareIncremental(srgb);
+
+      if (any_candidate) {
+        // Each candidate has its own state, so they run concurrently; the
+        // result does not depend on the number of threads.
+        pool->Run(0, candidates.size(), [&](const int task, const int thread) {
+          HQSearchCandidate& candidate = candidates[task];
+          if (!candidate.active) return;
+          candidate.quantizer.SetQuantField(
+              quant_dc, QuantField(candidate.quant_field), cparams);
+          QuantizedCoeffs qcoeffs = ComputeCoefficientsFromCache(
+              header, candidate.quantizer, ctan, cache, pool,
+              &candidate.coeffs);
+          candidate.estimated_size = EstimateBitstreamSize(
+              qcoeffs, header, candidate.quantizer, NoiseParams(), ctan, pool);
+          DecCache& dec_cache = candidate.dec_cache;
+          dec_cache.quantized_dc = std::move(qcoeffs.dc);
+          dec_cache.quantized_ac = std::move(qcoeffs.ac);
+          for (int c = 0; c < 3; ++c) {
+            dec_cache.gradient[c] = buffers->recon.gradient[c];
+          }
+          const Image3F recon = ReconOpsinImage(header, candidate.quantizer,
+                                                ctan, pool, &dec_cache);
+          CenteredOpsinToSrgb(recon, dither, pool, &candidate.srgb);
+          candidate.comparator->CompareIncremental(candidate.srgb);
+        });
+
+        // Continues with the smallest field that reaches the target, or else
+        // the one that lowers the distance the most per added byte (the
+        // first if tied). Always choosing the lowest distance would overshoot
+        // the target by far.
+        const auto gain = [prev_distance, prev_size](const float distance,
+                                                     const size_t size) {
+          const float added = static_cast<float>(size) - prev_size;
+          return (prev_distance - distance) / std::max(1.0f, added);
+        };
+        const auto better = [&](const float distance, const size_t size,
+                                const float best_distance,
+                                const size_t best_size) {
+          const bool good = distance <= butteraugli_target;
+          const bool best_good = best_distance <= butteraugli_target;
+          if (good != best_good) return good;
+          if (good) return size < best_size;
+          return gain(distance, size) > gain(best_distance, best_size);
+        };
+        HQSearchCandidate* best = nullptr;
+        float best_distance = comparator->distance();
+        size_t best_size = estimated_size;
+        for (HQSearchCandidate& candidate : candidates) {
+          if (!candidate.active) continue;
+          candidate.active = false;
+          const float distance = candidate.comparator->distance();
+          if (better(distance, candidate.estimated_size, best_distance,
+                     best_size)) {
+            best = &candidate;
+            best_distance = distance;
+            best_size = candidate.estimated_size;
+          }
+        }
+        estimated_size = best_size;
+        if (best != nullptr) {
+          quant_field.Swap(best->quant_field);
+          comparator.swap(best->comparator);
+          srgb.Swap(best->srgb);
+        }
+      }
+      prev_distance = comparator->distance();
+      prev_size = estimated_size;
+
       ++butteraugli_iter;
       bool best_quant_updated = false;
-      if (comparator.distance() <= best_butteraugli) {
-        best_quant_field = CopyImage(quant_field);
-        best_butteraugli = std::max(comparator.distance(), butteraugli_target);
+      if (comparator->distance() <= best_butteraugli) {
+        CopyImageTo(quant_field, &best_quant_field);
+        best_butteraugli = std::max(comparator->distance(), butteraugli_target);
         best_quant_updated = true;
         num_stalling_iters = 0;
       } else if (outer_iter == 0) {
         ++num_stalling_iters;
       }
-      tile_distmap = TileDistMap(comparator.distmap(), 8, 0);
+      tile_distmap = TileDistMap(comparator->distmap(), 8, 0);
+      UpdateConvergedTiles(tile_distmap, butteraugli_target,
+                           butteraugli_iter - 1, &converged, aux_out);
       if (WantDebugOutput(aux_out)) {
         DumpHeatmaps(aux_out, opsin_orig.xsize(), opsin_orig.ysize(),
                      8, butteraugli_target, quant_field, tile_distmap);
@@ -400,10 +827,10 @@ void FindBestQuantizationHQ(const Image3F& opsin_orig, const Image3F& opsin,
       }
       if (FLAGS_log_search_state) {
         float minval, maxval;
-        ImageMinMax(quant_field, &minval, &maxval);
+        ImageMinMax(quant_field, pool, &minval, &maxval);
         printf("\nButteraugli iter: %d/%d%s\n", butteraugli_iter, max_iters,
                best_quant_updated ? " (*)" : "");
-        printf("Butteraugli distance: %f\n", comparator.distance());
+        printf("Butteraugli distance: %f\n", comparator->distance());
         printf("quant range: %f ... %f  DC quant: %f\n", minval, maxval,
                quant_dc);
         printf("search radius: %d\n", search_radius);
@@ -415,25 +842,14 @@ void FindBestQuantizationHQ(const Image3F& opsin_orig, const Image3F& opsin,
         break;
       }
     }
+    if (!candidates.empty()) CopyImageTo(quant_field, &unadjusted_field);
+    int adjusted_radius = -1;
     bool changed = false;
-    while (!changed && comparator.distance() > butteraugli_target) {
+    while (!changed && comparator->distance() > butteraugli_target) {
       for (int radius = 0; radius <= search_radius && !changed; ++radius) {
-        ImageF dist_to_peak_map = DistToPeakMap(
-            tile_distmap, butteraugli_target, radius, 0.0);
-        for (int y = 0; y < quant_field.ysize(); ++y) {
-          float* const PIK_RESTRICT row_q = quant_field.Row(y);
-          const float* const PIK_RESTRICT row_dist = dist_to_peak_map.Row(y);
-          for (int x = 0; x < quant_field.xsize(); ++x) {
-            if (row_dist[x] >= 0.0f) {
-              static const float kAdjSpeed[kMaxOuterIters] = {0.1f, 0.04f};
-              const float factor =
-                  (slow ? kAdjSpeed[outer_iter] : 0.2f) *
-                  tile_distmap.Row(y)[x];
-              if (AdjustQuantVal(&row_q[x], row_dist[x], factor, quant_ceil)) {
-                changed = true;
-              }
-            }
-          }
+        if (adjust(radius, 1.0f, &quant_field)) {
+          changed = true;
+          adjusted_radius = radius;
         }
       }
       if (!changed || num_stalling_iters >= (slow ? 3 : 1)) {
@@ -456,14 +872,19 @@ void FindBestQuantizationHQ(const Image3F& opsin_orig, const Image3F& opsin,
         break;
       }
     }
+    // The candidates take larger steps from the same field.
+    if (adjusted_radius >= 0) {
+      for (size_t k = 0; k < candidates.size(); ++k) {
+        HQSearchCandidate& candidate = candidates[k];
+        CopyImageTo(unadjusted_field, &candidate.quant_field);
+        candidate.active = adjust(adjusted_radius, 2.0f + k,
+                                  &candidate.quant_field);
+      }
+    }
     if (!changed) {
       if (!slow || ++outer_iter == kMaxOuterIters) break;
       static const float kQuantScale = 0.75f;
-      for (int y = 0; y < quant_field.ysize(); ++y) {
-        for (int x = 0; x < quant_field.xsize(); ++x) {
-          quant_field.Row(y)[x] *= kQuantScale;
-        }
-      }
+      ScaleImage(kQuantScale, &quant_field);
       num_stalling_iters = 0;
     }
   }
@@ -484,7 +905,106 @@ inline size_t IndexOfMaximum(const T* array, const size_t len) {
   return maxidx;
 }
 
-void FindBestYToBCorrelation(const Image3F& dct, ImageI* PIK_RESTRICT ytob_map,
+// Returns the first candidate in [0, 256) for which "pred" holds, or 256.
+// Requires "pred" to be monotonic, i.e. false for all candidates below some
+// index and true for all candidates from there on.
+template <class Predicate>
+inline int FirstCandidate(const Predicate& pred) {
+  int lo = 0;
+  int hi = 256;
+  while (lo < hi) {
+    const int mid = (lo + hi) / 2;
+    if (pred(mid)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+// Sets num_zeros[t] to the number of AC coefficients in tile (tile_x, tile_y)
+// for which std::abs(scale * c * qm - (t - offset) * y * qm) < zero_thresh,
+// where c and y are the coefficients of "plane" and Y.
+//
+// The residual is monotonic in t, also after float rounding, so the
+// candidates that quantize a coefficient to zero form an interval whose ends
+// are found by binary search; this is identical to testing all 256
+// candidates, but takes 16 instead of 256 evaluations per coefficient.
+void CountZerosPerCandidate(const Image3F& dct, const size_t plane,
+                            const float scale, const int offset,
+                            const float zero_thresh, const float* qm,
+                            const size_t tile_x, const size_t tile_y,
+                            uint32_t* PIK_RESTRICT num_zeros) {
+  const size_t y0 = tile_y * kTileHeightInBlocks;
+  const size_t x0 = tile_x * kTileWidthInBlocks * kBlockSize;
+  const size_t y1 = std::min(y0 + kTileHeightInBlocks, dct.ysize());
+  const size_t x1 =
+      std::min(x0 + kTileWidthInBlocks * kBlockSize, dct.xsize());
+  // Differences between the counts of adjacent candidates.
+  int32_t delta[257] = {0};
+  for (size_t y = y0; y < y1; ++y) {
+    const float* const PIK_RESTRICT row_y = dct.ConstPlaneRow(1, y);
+    const float* const PIK_RESTRICT row_c = dct.ConstPlaneRow(plane, y);
+    for (size_t x = x0; x < x1; ++x) {
+      if (x % 64 == 0) continue;
+      const float scaled_c = scale * row_c[x] * qm[x % 64];
+      const float scaled_y = row_y[x] * qm[x % 64];
+      const auto residual = [scaled_c, scaled_y, offset](const int t) {
+        return scaled_c - (t - offset) * scaled_y;
+      };
+      const auto below = [&](int t) { return residual(t) < zero_thresh; };
+      const auto above = [&](int t) { return residual(t) > -zero_thresh; };
+      int begin, end;
+      if (scaled_y > 0.0f) {
+        begin = FirstCandidate(below);
+        end = FirstCandidate([&](int t) { return !above(t); });
+      } else if (scaled_y < 0.0f) {
+        begin = FirstCandidate(above);
+        end = FirstCandidate([&](int t) { return !below(t); });
+      } else {
+        const bool zero = std::abs(residual(0)) < zero_thresh;
+        begin = 0;
+        end = zero ? 256 : 0;
+      }
+      if (begin < end) {
+        ++delta[begin];
+        --delta[end];
+      }
+    }
+  }
+  int32_t sum = 0;
+  for (int t = 0; t < 256; ++t) {
+    sum += delta[t];
+    num_zeros[t] = sum;
+  }
+}
+
+// Computes the zero counts of all tiles in parallel. Returns the per-tile
+// counts (256 per tile, in raster order) and the total counts in num_zeros.
+std::vector<uint32_t> CountZerosPerTile(const Image3F& dct, const size_t plane,
+                                        const float scale, const int offset,
+                                        const float zero_thresh,
+                                        const float* qm, const ImageI& map,
+                                        ThreadPool* pool,
+                                        uint32_t* PIK_RESTRICT num_zeros) {
+  const size_t xsize_tiles = map.xsize();
+  const size_t num_tiles = xsize_tiles * map.ysize();
+  std::vector<uint32_t> tile_zeros(num_tiles * 256);
+  pool->Run(0, num_tiles, [&](const int task, const int thread) {
+    CountZerosPerCandidate(dct, plane, scale, offset, zero_thresh, qm,
+                           task % xsize_tiles, task / xsize_tiles,
+                           &tile_zeros[task * 256]);
+  });
+  std::fill(num_zeros, num_zeros + 256, 0);
+  for (size_t i = 0; i < tile_zeros.size(); ++i) {
+    num_zeros[i % 256] += tile_zeros[i];
+  }
+  return tile_zeros;
+}
+
+void FindBestYToBCorrelation(const Image3F& dct, ThreadPool* pool,
+                             ImageI* PIK_RESTRICT ytob_map,
                              int* PIK_RESTRICT ytob_dc) {
   const float kYToBScale = 128.0f;
   const float kZeroThresh = kYToBScale * kZeroBiasHQ[2];
@@ -493,45 +1013,16 @@ void FindBestYToBCorrelation(const Image3F& dct, ImageI* PIK_RESTRICT ytob_map,
   for (int k = 0; k < 64; ++k) {
     qm[k] = 1.0f / kDequantMatrix[k];
   }
-  uint32_t num_zeros[256] = {0};
-  for (size_t y = 0; y < dct.ysize(); ++y) {
-    const float* const PIK_RESTRICT row_y = dct.ConstPlaneRow(1, y);
-    const float* const PIK_RESTRICT row_b = dct.ConstPlaneRow(2, y);
-    for (size_t x = 0; x < dct.xsize(); ++x) {
-      if (x % 64 == 0) continue;
-      const float scaled_b = kYToBScale * row_b[x] * qm[x % 64];
-      const float scaled_y = row_y[x] * qm[x % 64];
-      for (int ytob = 0; ytob < 256; ++ytob) {
-        if (std::abs(scaled_b - ytob * scaled_y) < kZeroThresh) {
-          ++num_zeros[ytob];
-        }
-      }
-    }
-  }
+  uint32_t num_zeros[256];
+  const std::vector<uint32_t> tile_zeros =
+      CountZerosPerTile(dct, 2, kYToBScale, 0, kZeroThresh, qm, *ytob_map,
+                        pool, num_zeros);
   *ytob_dc = IndexOfMaximum(num_zeros, 256);
   for (int tile_y = 0; tile_y < ytob_map->ysize(); ++tile_y) {
     int* PIK_RESTRICT row_ytob = ytob_map->Row(tile_y);
     for (int tile_x = 0; tile_x < ytob_map->xsize(); ++tile_x) {
-      const int y0 = tile_y * kTileHeightInBlocks;
-      const int x0 = tile_x * kTileWidthInBlocks * kBlockSize;
-      const int y1 = std::min<int>(y0 + kTileHeightInBlocks, dct.ysize());
-      const int x1 =
-          std::min<int>(x0 + kTileWidthInBlocks * kBlockSize, dct.xsize());
-      uint32_t num_zeros[256] = {0};
-      for (size_t y = y0; y < y1; ++y) {
-        const float* const PIK_RESTRICT row_y = dct.ConstPlaneRow(1, y);
-        const float* const PIK_RESTRICT row_b = dct.ConstPlaneRow(2, y);
-        for (size_t x = x0; x < x1; ++x) {
-          if (x % 64 == 0) continue;
-          const float scaled_b = kYToBScale * row_b[x] * qm[x % 64];
-          const float scaled_y = row_y[x] * qm[x % 64];
-          for (int ytob = 0; ytob < 256; ++ytob) {
-            if (std::abs(scaled_b - ytob * scaled_y) < kZeroThresh) {
-              ++num_zeros[ytob];
-            }
-          }
-        }
-      }
+      const uint32_t* PIK_RESTRICT num_zeros =
+          &tile_zeros[(tile_y * ytob_map->xsize() + tile_x) * 256];
       int best_ytob = IndexOfMaximum(num_zeros, 256);
       // Revert to the global factor used for dc if the number of zeros is
       // not much different.
@@ -543,7 +1034,8 @@ void FindBestYToBCorrelation(const Image3F& dct, ImageI* PIK_RESTRICT ytob_map,
   }
 }
 
-void FindBestYToXCorrelation(const Image3F& dct, ImageI* PIK_RESTRICT ytox_map,
+void FindBestYToXCorrelation(const Image3F& dct, ThreadPool* pool,
+                             ImageI* PIK_RESTRICT ytox_map,
                              int* PIK_RESTRICT ytox_dc) {
   const float kYToXScale = 256.0f;
   const float kZeroThresh = kYToXScale * kZeroBiasHQ[0];
@@ -552,45 +1044,16 @@ void FindBestYToXCorrelation(const Image3F& dct, ImageI* PIK_RESTRICT ytox_map,
   for (int k = 0; k < 64; ++k) {
     qm[k] = 1.0f / kDequantMatrix[k];
   }
-  uint32_t num_zeros[256] = {0};
-  for (size_t y = 0; y < dct.ysize(); ++y) {
-    const float* const PIK_RESTRICT row_y = dct.ConstPlaneRow(1, y);
-    const float* const PIK_RESTRICT row_x = dct.ConstPlaneRow(0, y);
-    for (size_t x = 0; x < dct.xsize(); ++x) {
-      if (x % 64 == 0) continue;
-      const float scaled_x = kYToXScale * row_x[x] * qm[x % 64];
-      const float scaled_y = row_y[x] * qm[x % 64];
-      for (int ytox = 0; ytox < 256; ++ytox) {
-        if (std::abs(scaled_x - (ytox - 128) * scaled_y) < kZeroThresh) {
-          ++num_zeros[ytox];
-        }
-      }
-    }
-  }
+  uint32_t num_zeros[256];
+  const std::vector<uint32_t> tile_zeros =
+      CountZerosPerTile(dct, 0, kYToXScale, 128, kZeroThresh, qm, *ytox_map,
+                        pool, num_zeros);
   *ytox_dc = IndexOfMaximum(num_zeros, 256);
   for (int tile_y = 0; tile_y < ytox_map->ysize(); ++tile_y) {
     int* PIK_RESTRICT row_ytox = ytox_map->Row(tile_y);
     for (int tile_x = 0; tile_x < ytox_map->xsize(); ++tile_x) {
-      const int y0 = tile_y * kTileHeightInBlocks;
-      const int x0 = tile_x * kTileWidthInBlocks * kBlockSize;
-      const int y1 = std::min<int>(y0 + kTileHeightInBlocks, dct.ysize());
-      const int x1 =
-          std::min<int>(x0 + kTileWidthInBlocks * kBlockSize, dct.xsize());
-      size_t num_zeros[256] = { 0 };
-      for (size_t y = y0; y < y1; ++y) {
-        const float* const PIK_RESTRICT row_y = dct.ConstPlaneRow(1, y);
-        const float* const PIK_RESTRICT row_x = dct.ConstPlaneRow(0, y);
-        for (size_t x = x0; x < x1; ++x) {
-          if (x % 64 == 0) continue;
-          const float scaled_x = kYToXScale * row_x[x] * qm[x % 64];
-          const float scaled_y = row_y[x] * qm[x % 64];
-          for (int ytox = 0; ytox < 256; ++ytox) {
-            if (std::abs(scaled_x - (ytox - 128) * scaled_y) < kZeroThresh) {
-              ++num_zeros[ytox];
-            }
-          }
-        }
-      }
+      const uint32_t* PIK_RESTRICT num_zeros =
+          &tile_zeros[(tile_y * ytox_map->xsize() + tile_x) * 256];
       int best_ytox = IndexOfMaximum(num_zeros, 256);
       // Revert to the global factor used for dc if the number of zeros is
       // the same.
@@ -618,56 +1081,121 @@ bool ScaleQuantizationMap(const float quant_dc,
   return changed;
 }
 
+// Number of candidate scales evaluated concurrently per round of the search.
+constexpr size_t kNumScaleProbes = 4;
+
+// Returns the EstimateBitstreamSize for each of "scales" of the quantization
+// field. Candidates are evaluated in parallel, each with its own quantizer,
+// and reuse the DCT and prediction stored in "cache".
+std::vector<size_t> EstimateScaledSizes(
+    const std::vector<float>& scales, const float quant_dc,
+    const ImageF& quant_ac, const CompressParams& cparams,
+    const NoiseParams& noise_params, const Header& header,
+    const ColorTransform& ctan, const EncCache& cache, ThreadPool* pool) {
+  PROFILER_FUNC;
+  std::vector<size_t> sizes(scales.size());
+  pool->Run(0, scales.size(), [&](const int task, const int thread) {
+    Quantizer quantizer(header.quant_template, quant_ac.xsize(),
+                        quant_ac.ysize());
+    ScaleQuantizationMap(quant_dc, quant_ac, cparams, scales[task],
+                         &quantizer);
+    Image3F coeffs;
+    const QuantizedCoeffs qcoeffs = ComputeCoefficientsFromCache(
+        header, quantizer, ctan, cache, pool, &coeffs);
+    sizes[task] = EstimateBitstreamSize(qcoeffs, header, quantizer,
+                                        noise_params, ctan, pool);
+  });
+  return sizes;
+}
+
+// Returns the index of the first (i.e. largest) of the descending "scales"
+// whose estimated size times "calibration" is within "target_size", or
+// scales.size() if none.
+size_t FirstScaleWithinTarget(const std::vector<size_t>& sizes,
+                              const float calibration,
+                              const size_t target_size) {
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    if (sizes[i] * calibration <= target_size) return i;
+  }
+  return sizes.size();
+}
+
+// Searches for the largest scale of the quantization field whose bitstream
+// does not exceed "target_size". Candidates are ranked by EstimateBitstreamSize
+// (calibrated against one actual encode) and evaluated kNumScaleProbes at a
+// time; only the initial and final candidates are actually encoded.
 void ScaleToTargetSize(const Image3F& opsin, const CompressParams& cparams,
                        const NoiseParams& noise_params, const Header& header,
                        size_t target_size, const ColorTransform& ctan,
                        ThreadPool* pool, Quantizer* quantizer,
-                       PikInfo* aux_out) {
+                       EncoderBuffers* buffers, PikInfo* aux_out) {
   float quant_dc;
   ImageF quant_ac;
   quantizer->GetQuantField(&quant_dc, &quant_ac);
-  float scale_bad = 1.0;
-  float scale_good = 1.0;
-  bool found_candidate = false;
-  PaddedBytes candidate;
-  EncCache cache;
-  for (int i = 0; i < 10; ++i) {
-    ScaleQuantizationMap(quant_dc, quant_ac, cparams, scale_good, quantizer);
-    QuantizedCoeffs qcoeffs = ComputeCoefficients(
-        cparams, header, opsin, *quantizer, ctan, pool, &cache);
-    candidate = EncodeToBitstream(qcoeffs, *quantizer, noise_params, ctan,
-                                  false, nullptr);
-    if (candidate.size() <= target_size) {
-      found_candidate = true;
-      break;
-    }
-    scale_bad = scale_good;
-    scale_good *= 0.5;
-  }
-  if (!found_candidate) {
-    // We could not make the compressed size small enough
+  EncCache& cache = buffers->coefficients;
+  cache.Reset();
+
+  ScaleQuantizationMap(quant_dc, quant_ac, cparams, 1.0f, quantizer);
+  QuantizedCoeffs qcoeffs = ComputeCoefficients(cparams, header, opsin,
+                                                *quantizer, ctan, pool, &cache);
+  PaddedBytes candidate = EncodeToBitstream(qcoeffs, header, *quantizer,
+                                            noise_params, ctan, false, pool,
+                                            nullptr);
+  if (candidate.size() <= target_size) {
+    // We dont want to go below butteraugli distance 1.0
     return;
   }
-  if (scale_good == 1.0) {
-    // We dont want to go below butteraugli distance 1.0
+  // Corrects for the systematic error of the estimate.
+  float calibration =
+      static_cast<float>(candidate.size()) /
+      EstimateBitstreamSize(qcoeffs, header, *quantizer, noise_params, ctan,
+                            pool);
+
+  // Successively halve the scale until the size is small enough.
+  std::vector<float> scales;
+  for (float scale = 0.5f; scales.size() < 9; scale *= 0.5f) {
+    scales.push_back(scale);
+  }
+  std::vector<size_t> sizes = EstimateScaledSizes(
+      scales, quant_dc, quant_ac, cparams, noise_params, header, ctan, cache,
+      pool);
+  size_t idx = FirstScaleWithinTarget(sizes, calibration, target_size);
+  if (idx == scales.size()) {
+    // We could not make the compressed size small enough
+    ScaleQuantizationMap(quant_dc, quant_ac, cparams, scales.back(),
+                         quantizer);
     return;
   }
-  for (int i = 0; i < 16; ++i) {
-    float scale = 0.5 * (scale_bad + scale_good);
-    if (!ScaleQuantizationMap(quant_dc, quant_ac, cparams, scale, quantizer)) {
-      break;
-    }
-    QuantizedCoeffs qcoeffs = ComputeCoefficients(
-        cparams, header, opsin, *quantizer, ctan, pool, &cache);
-    candidate = EncodeToBitstream(qcoeffs, *quantizer, noise_params, ctan,
-                                  false, nullptr);
-    if (candidate.size() <= target_size) {
-      scale_good = scale;
-    } else {
-      scale_bad = scale;
+  float scale_good = scales[idx];
+  float scale_bad = 2.0f * scale_good;
+
+  // Each round narrows [scale_good, scale_bad) to one of kNumScaleProbes + 1
+  // subintervals, until the quantizer can no longer tell the scales apart.
+  const float kMinRelativeInterval = 1.0f / 4096;
+  for (int round = 0; round < 8; ++round) {
+    if (scale_bad - scale_good < kMinRelativeInterval * scale_good) break;
+    const float step = (scale_bad - scale_good) / (kNumScaleProbes + 1);
+    scales.clear();
+    for (size_t i = kNumScaleProbes; i != 0; --i) {
+      scales.push_back(scale_good + i * step);
     }
+    sizes = EstimateScaledSizes(scales, quant_dc, quant_ac, cparams,
+                                noise_params, header, ctan, cache, pool);
+    idx = FirstScaleWithinTarget(sizes, calibration, target_size);
+    if (idx != 0) scale_bad = scales[idx - 1];
+    if (idx != scales.size()) scale_good = scales[idx];
+  }
+
+  // Verify the result; the estimate may still be slightly too optimistic.
+  for (int i = 0; i < 4; ++i) {
+    ScaleQuantizationMap(quant_dc, quant_ac, cparams, scale_good, quantizer);
+    qcoeffs = ComputeCoefficients(cparams, header, opsin, *quantizer, ctan,
+                                  pool, &cache);
+    candidate = EncodeToBitstream(qcoeffs, header, *quantizer, noise_params,
+                                  ctan, false, pool, nullptr);
+    if (candidate.size() <= target_size) break;
+    scale_good *= 0.98f * target_size / candidate.size();
   }
-  ScaleQuantizationMap(quant_dc, quant_ac, cparams, scale_good, quantizer);
 }
 
 void CompressToTargetSize(const Image3F& opsin_orig, const Image3F& opsin,
@@ -675,13 +1203,14 @@ void CompressToTargetSize(const Image3F& opsin_orig, const Image3F& opsin,
                           const NoiseParams& noise_params, const Header& header,
                           size_t target_size, const ColorTransform& ctan,
                           ThreadPool* pool, Quantizer* quantizer,
-                          PikInfo* aux_out) {
+                          EncoderBuffers* buffers, PikInfo* aux_out) {
   float quant_dc_good = 1.0;
   ImageF quant_ac_good;
   const float kIntervalLenThresh = 0.05f;
   float dist_bad = -1.0f;
   float dist_good = -1.0f;
-  EncCache cache;
+  EncCache& cache = buffers->coefficients;
+  cache.Reset();
   for (;;) {
     float dist = 1.0f;
     if (dist_good >= 0.0f && dist_bad >= 0.0f) {
@@ -701,11 +1230,11 @@ void CompressToTargetSize(const Image3F& opsin_orig, const Image3F& opsin,
       }
     }
     FindBestQuantization(opsin_orig, opsin, cparams, header, dist, ctan, pool,
-                         quantizer, aux_out);
+                         quantizer, buffers, aux_out);
     QuantizedCoeffs qcoeffs = ComputeCoefficients(
         cparams, header, opsin, *quantizer, ctan, pool, &cache);
-    PaddedBytes candidate = EncodeToBitstream(qcoeffs, *quantizer, noise_params,
-                                              ctan, false, nullptr);
+    PaddedBytes candidate = EncodeToBitstream(
+        qcoeffs, header, *quantizer, noise_params, ctan, false, pool, nullptr);
     if (candidate.size() <= target_size) {
       dist_good = dist;
       quantizer->GetQuantField(&quant_dc_good, &quant_ac_good);
@@ -716,8 +1245,8 @@ void CompressToTargetSize(const Image3F& opsin_orig, const Image3F& opsin,
   quantizer->SetQuantField(quant_dc_good, QuantField(quant_ac_good), cparams);
 }
 
-bool JpegToPikLossless(const guetzli::JPEGData& jpg, PaddedBytes* compressed,
-                       PikInfo* aux_out) {
+bool JpegToPikLossless(const guetzli::JPEGData& jpg, ThreadPool* pool,
+                       PaddedBytes* compressed, PikInfo* aux_out) {
   Header header;
   header.bitstream = Header::kBitstreamBrunsli;
   size_t encoded_bits;
@@ -726,20 +1255,40 @@ bool JpegToPikLossless(const guetzli::JPEGData& jpg, PaddedBytes* compressed,
   size_t pos = 0;
   PIK_CHECK(StoreHeader(header, &pos, compressed->data()));
   WriteZeroesToByteBoundary(&pos, compressed->data());
-  if (!BrunsliV2EncodeJpegData(jpg, pos / 8, compressed)) {
+  if (!BrunsliV2EncodeJpegData(jpg, pos / 8, pool, compressed)) {
+    return PIK_FAILURE("Invalid jpeg input.");
+  }
+  return true;
+}
+
+// Returns false and sets *error to JPEG_BANDS_UNSUPPORTED if the JPEG must be
+// read with ReadJpeg instead.
+bool JpegBytesToPikLossless(const uint8_t* jpeg, size_t jpeg_size,
+                            ThreadPool* pool, PaddedBytes* compressed,
+                            guetzli::JPEGReadError* error) {
+  Header header;
+  header.bitstream = Header::kBitstreamBrunsli;
+  size_t encoded_bits;
+  PIK_CHECK(CanEncode(header, &encoded_bits));
+  compressed->resize((encoded_bits + 7) / 8);
+  size_t pos = 0;
+  PIK_CHECK(StoreHeader(header, &pos, compressed->data()));
+  WriteZeroesToByteBoundary(&pos, compressed->data());
+  if (!BrunsliV2EncodeJpegBands(jpeg, jpeg_size, pos / 8, pool, compressed,
+                                error)) {
     return PIK_FAILURE("Invalid jpeg input.");
   }
   return true;
 }
 
 bool BrunsliToPixels(const PaddedBytes& compressed, size_t pos,
-                     MetaImageB* out) {
+                     ThreadPool* pool, MetaImageB* out) {
   guetzli::JPEGData jpg;
   if (!BrunsliV2DecodeJpegData(compressed.data() + pos,
-      compressed.size() - pos, &jpg)) {
+      compressed.size() - pos, pool, &jpg)) {
     return PIK_FAILURE("Brunsli v2 decoding error");
   }
-  std::vector<uint8_t> rgb = DecodeJpegToRGB(jpg);
+  std::vector<uint8_t> rgb = DecodeJpegToRGB(jpg, pool);
   if (rgb.empty()) {
     return PIK_FAILURE("JPEG decoding error.");
   }
@@ -750,24 +1299,56 @@ bool BrunsliToPixels(const PaddedBytes& compressed, size_t pos,
 }
 
 bool BrunsliToPixels(const PaddedBytes& compressed, size_t pos,
-                     MetaImageU* out) {
+                     ThreadPool* pool, MetaImageU* out) {
   return PIK_FAILURE("Brunsli not supported for Image3U");
 }
 
 bool BrunsliToPixels(const PaddedBytes& compressed, size_t pos,
-                     MetaImageF* out) {
+                     ThreadPool* pool, MetaImageF* out) {
   return PIK_FAILURE("Brunsli not supported for Image3F");
 }
 
+bool LosslessToMetaImage(const Header& header, const Sections& sections,
+                         const PaddedBytes& compressed, size_t pos,
+                         ThreadPool* pool, MetaImageB* out) {
+  return LosslessToPixels(header, sections, compressed, pos, pool, out);
+}
+
+bool LosslessToMetaImage(const Header& header, const Sections& sections,
+                         const PaddedBytes& compressed, size_t pos,
+                         ThreadPool* pool, MetaImageU* out) {
+  return PIK_FAILURE("Lossless only supports 8-bit output");
+}
+
+bool LosslessToMetaImage(const Header& header, const Sections& sections,
+                         const PaddedBytes& compressed, size_t pos,
+                         ThreadPool* pool, MetaImageF* out) {
+  return PIK_FAILURE("Lossless only supports 8-bit output");
+}
+
+// Returns whether all "alpha" values are the maximum for "bit_depth".
+bool IsOpaque(const ImageU& alpha, const int bit_depth) {
+  const uint16_t opaque = 0xFFFFu >> (16 - bit_depth);
+  for (size_t y = 0; y < alpha.ysize(); ++y) {
+    const uint16_t* PIK_RESTRICT row = alpha.ConstRow(y);
+    for (size_t x = 0; x < alpha.xsize(); ++x) {
+      if (row[x] != opaque) return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 bool PixelsToBrunsli(const CompressParams& params, const Image3B& srgb,
-                     PaddedBytes* compressed, PikInfo* aux_out) {
+                     ThreadPool* pool, PaddedBytes* compressed,
+                     PikInfo* aux_out) {
   const std::vector<uint8_t>& rgb = InterleavedFromImage3(srgb);
   guetzli::JPEGData jpeg;
   if (params.butteraugli_distance >= 0.0) {
     guetzli::Params guetzli_params;
     guetzli_params.butteraugli_target = params.butteraugli_distance;
+    guetzli_params.pool = pool;
     if (!guetzli::Process(guetzli_params, rgb, srgb.xsize(), srgb.ysize(),
                           &jpeg)) {
       return PIK_FAILURE("Guetzli processing failed.");
@@ -781,59 +1362,172 @@ bool PixelsToBrunsli(const CompressParams& params, const Image3B& srgb,
       return PIK_FAILURE("JPEG encoding failed.");
     }
   }
-  return JpegToPikLossless(jpeg, compressed, aux_out);
+  return JpegToPikLossless(jpeg, pool, compressed, aux_out);
 }
 
 bool PixelsToBrunsli(const CompressParams& params, const Image3F& srgb,
-                     PaddedBytes* compressed, PikInfo* aux_out) {
+                     ThreadPool* pool, PaddedBytes* compressed,
+                     PikInfo* aux_out) {
   return PIK_FAILURE("Brunsli not supported for Image3F");
 }
 
 template<typename T>
 bool PixelsToBrunsli(const CompressParams& params, const MetaImage<T>& image,
-                     PaddedBytes* compressed, PikInfo* aux_out) {
-  return PixelsToBrunsli(params, image.GetColor(), compressed, aux_out);
+                     ThreadPool* pool, PaddedBytes* compressed,
+                     PikInfo* aux_out) {
+  return PixelsToBrunsli(params, image.GetColor(), pool, compressed, aux_out);
 }
 
 template<typename T>
-MetaImageF OpsinDynamicsMetaImage(const Image3<T>& image) {
-  Image3F opsin = OpsinDynamicsImage(image);
+MetaImageF OpsinDynamicsMetaImage(const Image3<T>& image, ThreadPool* pool) {
+  Image3F opsin = OpsinDynamicsImage(image, pool);
   MetaImageF out;
   out.SetColor(std::move(opsin));
   return out;
 }
 
 template<typename T>
-MetaImageF OpsinDynamicsMetaImage(const MetaImage<T>& image) {
-  MetaImageF out = OpsinDynamicsMetaImage(image.GetColor());
+MetaImageF OpsinDynamicsMetaImage(const MetaImage<T>& image,
+                                  ThreadPool* pool) {
+  MetaImageF out = OpsinDynamicsMetaImage(image.GetColor(), pool);
   out.CopyAlpha(image);
   return out;
 }
 
-template <typename Image>
-bool PixelsToPikT(const CompressParams& params_in, const Image& image,
-                  ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out) {
-  if (image.xsize() == 0 || image.ysize() == 0) {
-    return PIK_FAILURE("Empty image");
+namespace {
+
+// Returns whether all pixels are neutral gray (R = G = B).
+template <typename T>
+bool IsGray(const Image3<T>& image) {
+  for (size_t y = 0; y < image.ysize(); ++y) {
+    const T* PIK_RESTRICT row_g = image.ConstPlaneRow(1, y);
+    if (memcmp(image.ConstPlaneRow(0, y), row_g, image.xsize() * sizeof(T)) ||
+        memcmp(image.ConstPlaneRow(2, y), row_g, image.xsize() * sizeof(T))) {
+      return false;
+    }
   }
-  if (params_in.use_brunsli_v2) {
-    return PixelsToBrunsli(params_in, image, compressed, aux_out);
+  return true;
+}
+
+template <typename T>
+bool IsGray(const MetaImage<T>& image) {
+  return IsGray(image.GetColor());
+}
+
+bool IsGray(const ConstInterleavedImageView& image) {
+  const size_t bytes_per_pixel = BytesPerPixel(image.layout);
+  for (size_t y = 0; y < image.ysize; ++y) {
+    const uint8_t* PIK_RESTRICT row = image.bytes + y * image.bytes_per_row;
+    for (size_t x = 0; x < image.xsize; ++x) {
+      const uint8_t* PIK_RESTRICT pixel = row + x * bytes_per_pixel;
+      if (pixel[0] != pixel[1] || pixel[1] != pixel[2]) return false;
+    }
+  }
+  return true;
+}
+
+// Replaces X and B of the (uncentered) "opsin" with those of the gray with
+// the same Y, i.e. discards the color.
+void DiscardColor(Image3F* PIK_RESTRICT opsin) {
+  const size_t xsize = opsin->xsize();
+  std::vector<float> centered_y(xsize);
+  for (size_t y = 0; y < opsin->ysize(); ++y) {
+    const float* PIK_RESTRICT row_y = opsin->ConstPlaneRow(1, y);
+    float* PIK_RESTRICT row_x = opsin->PlaneRow(0, y);
+    float* PIK_RESTRICT row_b = opsin->PlaneRow(2, y);
+    for (size_t x = 0; x < xsize; ++x) {
+      centered_y[x] = row_y[x] - kXybCenter[1];
+    }
+    GrayXybFromY(centered_y.data(), xsize, row_x, row_b);
+    for (size_t x = 0; x < xsize; ++x) {
+      row_x[x] += kXybCenter[0];
+      row_b[x] += kXybCenter[2];
+    }
+  }
+}
+
+}  // namespace
+
+bool OpsinToPikT(const CompressParams& params, const Header& header,
+                 const MetaImageF& opsin_orig, ThreadPool* pool,
+                 EncoderBuffers* buffers, PaddedBytes* compressed,
+                 PikInfo* aux_out);
+
+uint32_t GroupSizeForParams(const CompressParams& params, const size_t xsize,
+                          const size_t ysize, ThreadPool* pool) {
+  if (params.group_size_in_tiles != 0) return params.group_size_in_tiles;
+  const auto num_groups = [xsize, ysize](const size_t size_in_tiles) {
+    const size_t size = size_in_tiles * kTileWidth;
+    return DivCeil(xsize, size) * DivCeil(ysize, size);
+  };
+  constexpr size_t kMinGroupsForLarge = 64;
+  if (num_groups(2 * kGroupWidthInTiles) >= kMinGroupsForLarge) {
+    return 2 * kGroupWidthInTiles;
+  }
+  const size_t num_threads = pool == nullptr ? 0 : pool->NumThreads();
+  uint32_t size_in_tiles = kGroupWidthInTiles;
+  while (size_in_tiles > 2 && num_groups(size_in_tiles) < num_threads) {
+    size_in_tiles /= 2;
+  }
+  return size_in_tiles;
+}
+
+namespace {
+
+// We don't add noise at low butteraugli distances, since the
+// original noise is stored within the compressed image. Adding the
+// noise there only makes things worse. We start adding noise at
+// the kNoiseModelingRampUpDistanceMin distance, but we don't start
+// at zero amplitude since adding noise is expensive -- it significantly
+// slows down decoding, and this is unlikely to completely go away even
+// with advanced optimizations. After the kNoiseModelingRampUpDistanceRange
+// we have reached the full level, i.e., noise is no longer represented by
+// the compressed image, so we can add full noise by the noise modeling
+// itself.
+static const double kNoiseModelingRampUpDistanceMin = 1.4;
+static const double kNoiseModelingRampUpDistanceRange = 0.6;
+static const double kNoiseLevelAtStartOfRampUp = 0.25;
+
+bool NoiseEnabled(const CompressParams& params) {
+  if (params.apply_noise != Override::kDefault) {
+    return params.apply_noise == Override::kOn;
   }
-  MetaImageF opsin = OpsinDynamicsMetaImage(image);
+  return params.butteraugli_distance > kNoiseModelingRampUpDistanceMin;
+}
+
+// Returns the per-block AC quant field for fast mode and its DC quant. Each
+// value only depends on a neighborhood of its block in the (uncentered)
+// "opsin_y", so it can also be computed band by band.
+ImageF FastQuantField(const CompressParams& params, const ImageF& opsin_y,
+                      ThreadPool* pool, float* PIK_RESTRICT quant_dc) {
+  PROFILER_ZONE("enc fast quant");
+  const float butteraugli_target = params.butteraugli_distance;
+  const float butteraugli_target_dc =
+      std::min<float>(butteraugli_target,
+                      pow(butteraugli_target, 0.65564410590742384 ));
+  *quant_dc = 0.57 / butteraugli_target_dc;
+  const float kQuantAC = ( 2.4528887094120813 ) / butteraugli_target;
+  ImageF quant_field = AdaptiveQuantizationMap(opsin_y, 8, pool);
+  ScaleImage(kQuantAC, &quant_field);
+  return quant_field;
+}
 
+// Chooses the header flags for encoding an xsize * ysize image with "params".
+Header HeaderForParams(const CompressParams& params, const size_t xsize,
+                       const size_t ysize, ThreadPool* pool) {
   Header header;
-  header.xsize = image.xsize();
-  header.ysize = image.ysize();
+  header.xsize = xsize;
+  header.ysize = ysize;
   // default decision (later: depending on quality)
   bool enable_denoise = false;
-  if (params_in.denoise != Override::kDefault) {
-    enable_denoise = params_in.denoise == Override::kOn;
+  if (params.denoise != Override::kDefault) {
+    enable_denoise = params.denoise == Override::kOn;
   }
   if (enable_denoise) {
     header.flags |= Header::kDenoise;
   }
 
-  if (params_in.butteraugli_distance < kMaxButteraugliForHQ) {
+  if (params.butteraugli_distance < kMaxButteraugliForHQ) {
     header.quant_template = kQuantHQ;
   } else {
     header.quant_template = kQuantDefault;
@@ -841,76 +1535,905 @@ bool PixelsToPikT(const CompressParams& params_in, const Image& image,
     header.flags |= Header::kGaborishTransform;
   }
 
-  if ((header.flags & Header::kSmoothDCPred) && params_in.fast_mode) {
+  if ((header.flags & Header::kSmoothDCPred) && params.fast_mode) {
     header.flags |= Header::kGradientMap;
   }
 
   // Dithering is important at higher distances but leads to visible
   // checkboarding at very high qualities.
-  if (params_in.butteraugli_distance > kMinButteraugliForDither) {
+  if (params.butteraugli_distance > kMinButteraugliForDither) {
     header.flags |= Header::kDither;
   }
-  size_t header_bits;
-  if (!CanEncode(header, &header_bits)) return false;
 
-  Sections sections;
-  if (opsin.HasAlpha()) {
-    PROFILER_ZONE("enc alpha");
-    if (!AlphaToPik(params_in, opsin.GetAlpha(), opsin.AlphaBitDepth(),
-                    &sections.alpha)) {
-      return false;
-    }
+  if (xsize <= kMaxSmallImageSize && ysize <= kMaxSmallImageSize) {
+    header.flags |= Header::kSmallImage;
   }
-  size_t sections_bits;
-  if (!CanEncode(sections, &sections_bits)) return false;
 
-  size_t pos = 0;
-  compressed->resize((header_bits + sections_bits + 7) / 8);
-  if (!StoreHeader(header, &pos, compressed->data())) return false;
-  if (!StoreSections(sections, &pos, compressed->data())) return false;
+  if (params.num_ans_states != 1) {
+    header.flags |= Header::kInterleavedANS;
+    header.num_ans_states = params.num_ans_states;
+  }
+
+  if (params.static_histograms) {
+    header.flags |= Header::kStaticHistograms;
+  }
+
+  // Small images have only one group anyway.
+  if ((header.flags & Header::kSmallImage) == 0) {
+    const uint32_t group_size = GroupSizeForParams(params, xsize, ysize, pool);
+    if (group_size != kGroupWidthInTiles) {
+      header.flags |= Header::kCustomGroupSize;
+      header.group_size_in_tiles = group_size;
+    }
+  }
+  return header;
+}
+
+// Replaces "compressed" with the byte-aligned header and sections.
+bool StoreHeaderAndSections(const Header& header, const Sections& sections,
+                            PaddedBytes* compressed, PikInfo* aux_out) {
+  size_t header_bits;
+  if (!CanEncode(header, &header_bits)) return false;
+  size_t sections_bits;
+  if (!CanEncode(sections, &sections_bits)) return false;
+
+  size_t pos = 0;
+  compressed->resize((header_bits + sections_bits + 7) / 8);
+  if (!StoreHeader(header, &pos, compressed->data())) return false;
+  if (!StoreSections(sections, &pos, compressed->data())) return false;
   WriteZeroesToByteBoundary(&pos, compressed->data());
 
   if (aux_out != nullptr) {
     aux_out->layers[kLayerHeader].total_size += (header_bits + 7) / 8;
     aux_out->layers[kLayerSections].total_size += (sections_bits + 7) / 8;
   }
+  return true;
+}
+
+void AppendBytes(const PaddedBytes& bytes, PaddedBytes* PIK_RESTRICT out) {
+  const size_t old_size = out->size();
+  out->resize(old_size + bytes.size());
+  memcpy(out->data() + old_size, bytes.data(), bytes.size());
+}
+
+}  // namespace
+
+namespace {
+
+bool OpsinMetaImageToPik(const CompressParams& params_in,
+                         const MetaImageF& opsin_in, const bool is_gray,
+                         ThreadPool* pool, EncoderBuffers* buffers,
+                         PaddedBytes* compressed, PikInfo* aux_out);
+
+// Returns "image" downscaled by 4 (rounding up) by averaging. For opsin, this
+// is close to averaging gamma-encoded pixels, as most downscalers do.
+MetaImageF DownscaleBy4(const MetaImageF& image) {
+  PROFILER_FUNC;
+  constexpr size_t kFactor = 4;
+  const size_t xsize = image.xsize();
+  const size_t ysize = image.ysize();
+  const size_t out_xsize = DivCeil(xsize, kFactor);
+  const size_t out_ysize = DivCeil(ysize, kFactor);
+  Image3F color(out_xsize, out_ysize);
+  ImageU alpha;
+  if (image.HasAlpha()) alpha = ImageU(out_xsize, out_ysize);
+  std::vector<float> sums(out_xsize);
+  std::vector<uint32_t> alpha_sums(out_xsize);
+  for (size_t out_y = 0; out_y < out_ysize; ++out_y) {
+    const size_t y0 = out_y * kFactor;
+    const size_t y1 = std::min(y0 + kFactor, ysize);
+    for (int c = 0; c < 3; ++c) {
+      std::fill(sums.begin(), sums.end(), 0.0f);
+      for (size_t y = y0; y < y1; ++y) {
+        const float* PIK_RESTRICT row = image.GetColor().ConstPlaneRow(c, y);
+        for (size_t x = 0; x < xsize; ++x) {
+          sums[x / kFactor] += row[x];
+        }
+      }
+      float* PIK_RESTRICT row_out = color.PlaneRow(c, out_y);
+      for (size_t out_x = 0; out_x < out_xsize; ++out_x) {
+        const size_t x0 = out_x * kFactor;
+        const size_t x1 = std::min(x0 + kFactor, xsize);
+        row_out[out_x] = sums[out_x] / ((x1 - x0) * (y1 - y0));
+      }
+    }
+    if (!image.HasAlpha()) continue;
+    std::fill(alpha_sums.begin(), alpha_sums.end(), 0);
+    for (size_t y = y0; y < y1; ++y) {
+      const uint16_t* PIK_RESTRICT row = image.GetAlpha().ConstRow(y);
+      for (size_t x = 0; x < xsize; ++x) {
+        alpha_sums[x / kFactor] += row[x];
+      }
+    }
+    uint16_t* PIK_RESTRICT row_out = alpha.Row(out_y);
+    for (size_t out_x = 0; out_x < out_xsize; ++out_x) {
+      const size_t x0 = out_x * kFactor;
+      const uint32_t num = (std::min(x0 + kFactor, xsize) - x0) * (y1 - y0);
+      row_out[out_x] = (alpha_sums[out_x] + num / 2) / num;
+    }
+  }
+  MetaImageF out;
+  out.SetColor(std::move(color));
+  // Must happen after SetColor.
+  if (image.HasAlpha()) out.SetAlpha(std::move(alpha), image.AlphaBitDepth());
+  return out;
+}
+
+// Encodes up to params.pyramid_levels successively downscaled copies of
+// "opsin" as complete streams (see Pyramid). Levels smaller than a block are
+// not worth their header and are omitted; "pyramid" remains null if none are
+// left.
+bool EncodePyramid(const CompressParams& params, const MetaImageF& opsin,
+                   const bool is_gray, ThreadPool* pool,
+                   std::unique_ptr<Pyramid>* pyramid) {
+  PROFILER_FUNC;
+  CompressParams level_params = params;
+  level_params.pyramid_levels = 0;
+  // Size targets only apply to the full-resolution image.
+  level_params.target_size = 0;
+  level_params.target_bitrate = 0.0;
+  const size_t num_levels =
+      std::min(params.pyramid_levels, Pyramid::kMaxLevels);
+  std::unique_ptr<Pyramid> result(new Pyramid);
+  MetaImageF level;
+  const MetaImageF* prev = &opsin;
+  for (size_t i = 0; i < num_levels; ++i) {
+    if (DivCeil(prev->xsize(), size_t(4)) < kBlockWidth ||
+        DivCeil(prev->ysize(), size_t(4)) < kBlockHeight) {
+      break;
+    }
+    level = DownscaleBy4(*prev);
+    prev = &level;
+    EncoderBuffers buffers;
+    PaddedBytes compressed;
+    if (!OpsinMetaImageToPik(level_params, level, is_gray, pool, &buffers,
+                             &compressed, nullptr)) {
+      return false;
+    }
+    result->levels.emplace_back(compressed.data(),
+                                compressed.data() + compressed.size());
+  }
+  result->num_levels = result->levels.size();
+  if (result->num_levels != 0) *pyramid = std::move(result);
+  return true;
+}
+
+// Encodes the header, alpha and "opsin" (converted from the caller's pixels,
+// which were neutral gray if "is_gray").
+bool OpsinMetaImageToPik(const CompressParams& params_in,
+                         const MetaImageF& opsin_in, const bool is_gray,
+                         ThreadPool* pool, EncoderBuffers* buffers,
+                         PaddedBytes* compressed, PikInfo* aux_out) {
+  CompressParams params = ParamsForEffort(params_in);
+  Header header =
+      HeaderForParams(params, opsin_in.xsize(), opsin_in.ysize(), pool);
+
+  const MetaImageF* opsin = &opsin_in;
+  MetaImageF gray_opsin;
+  const bool grayscale = params.grayscale == Override::kDefault
+                             ? is_gray
+                             : params.grayscale == Override::kOn;
+  if (grayscale) {
+    header.flags |= Header::kGrayscale;
+    // Independent per-channel dither would reintroduce color.
+    header.flags &= ~Header::kDither;
+    header.num_components = 1;
+    if (!is_gray) {
+      gray_opsin.SetColor(CopyImage(opsin_in.GetColor()));
+      DiscardColor(&gray_opsin.GetColor());
+      opsin = &gray_opsin;
+    }
+  }
+
+  Sections sections;
+  if (opsin_in.HasAlpha()) {
+    PROFILER_ZONE("enc alpha");
+    if (!AlphaToPik(params, opsin_in.GetAlpha(), opsin_in.AlphaBitDepth(),
+                    pool, &sections.alpha)) {
+      return false;
+    }
+  }
+  if (params.pyramid_levels != 0 &&
+      !EncodePyramid(params, opsin_in, is_gray, pool, &sections.pyramid)) {
+    return false;
+  }
+  if (!StoreHeaderAndSections(header, sections, compressed, aux_out)) {
+    return false;
+  }
 
-  CompressParams params = params_in;
-  size_t target_size = TargetSize(params, image);
+  size_t target_size = TargetSize(params, opsin_in);
   size_t opsin_target_size =
       (compressed->size() < target_size ? target_size - compressed->size() : 1);
   if (params.target_size > 0 || params.target_bitrate > 0.0) {
     params.target_size = opsin_target_size;
   }
-  if (!OpsinToPik(params, header, opsin, pool, compressed, aux_out)) {
+  if (!OpsinToPikT(params, header, *opsin, pool, buffers, compressed,
+                   aux_out)) {
     return false;
   }
   return true;
 }
 
+}  // namespace
+
+CompressParams ParamsForEffort(const CompressParams& params) {
+  if (params.effort == 0) return params;
+  const size_t effort = std::min(params.effort, kMaxEffort);
+  CompressParams result = params;
+  result.fast_mode = effort <= 3;
+  result.guetzli_mode = effort == 9;
+  result.apply_noise = effort == 1 ? Override::kOff : params.apply_noise;
+  static const size_t kNoisePatchStride[kMaxEffort] = {1, 4, 2, 4, 2,
+                                                       1, 1, 1, 1};
+  static const int kButteraugliIters[kMaxEffort] = {0, 0, 0, 2, 3,
+                                                    5, 7, 12, 12};
+  static const size_t kProxyIters[kMaxEffort] = {0, 0, 0, 1, 2, 2, 0, 0, 0};
+  result.noise_patch_stride = kNoisePatchStride[effort - 1];
+  if (!result.fast_mode) {
+    result.max_butteraugli_iters = kButteraugliIters[effort - 1];
+    result.butteraugli_proxy_iters = kProxyIters[effort - 1];
+  }
+  return result;
+}
+
+namespace {
+
+// Images with at most this many colors (e.g. logos and charts) are coded as
+// palette indices in the lossless bitstream even if lossy compression was
+// requested, which is faster and usually also smaller.
+constexpr size_t kMaxAutoPaletteColors = 64;
+
+// Returns the palette for "color" and "alpha" (null if none), or null if they
+// should not be coded as palette indices.
+std::unique_ptr<Palette> ChoosePalette(const CompressParams& params,
+                                       const Image3B& color,
+                                       const ImageU* alpha) {
+  if (params.palette == Override::kOff) return nullptr;
+  const size_t max_colors = params.lossless || params.palette == Override::kOn
+                                ? kMaxPaletteColors
+                                : kMaxAutoPaletteColors;
+  std::unique_ptr<Palette> palette(new Palette);
+  if (!FindPalette(color, alpha, max_colors, palette.get())) return nullptr;
+  return palette;
+}
+
+// Only neutral gray images are coded as a single plane; unlike the default
+// bitstream, Override::kOn does not discard color.
+bool PixelsToLossless(const CompressParams& params, const MetaImageB& image,
+                      const Palette* palette, ThreadPool* pool,
+                      PaddedBytes* compressed, PikInfo* aux_out) {
+  const bool grayscale = params.grayscale != Override::kOff && IsGray(image);
+  return PixelsToPikLossless(image, grayscale, palette, /*previous=*/nullptr,
+                             pool, compressed, aux_out);
+}
+
+// Returns whether "image" is coded losslessly, either because params.lossless
+// or because it has few enough colors for a palette, in which case "ok" is the
+// result of doing so. Otherwise, the caller proceeds with lossy compression.
+bool MaybePixelsToLossless(const CompressParams& params,
+                           const MetaImageB& image, ThreadPool* pool,
+                           PaddedBytes* compressed, PikInfo* aux_out,
+                           bool* ok) {
+  std::unique_ptr<Palette> palette;
+  if (!image.HasAlpha() || image.AlphaBitDepth() == 8) {
+    palette = ChoosePalette(
+        params, image.GetColor(),
+        image.HasAlpha() ? &image.GetAlpha() : nullptr);
+  }
+  if (!params.lossless && palette == nullptr) return false;
+  *ok = PixelsToLossless(params, image, palette.get(), pool, compressed,
+                         aux_out);
+  return true;
+}
+
+bool MaybePixelsToLossless(const CompressParams& params, const Image3B& image,
+                           ThreadPool* pool, PaddedBytes* compressed,
+                           PikInfo* aux_out, bool* ok) {
+  std::unique_ptr<Palette> palette = ChoosePalette(params, image, nullptr);
+  if (!params.lossless && palette == nullptr) return false;
+  MetaImageB meta;
+  meta.SetColor(CopyImage(image));
+  *ok = PixelsToLossless(params, meta, palette.get(), pool, compressed,
+                         aux_out);
+  return true;
+}
+
+template <class Image>
+bool MaybePixelsToLossless(const CompressParams& params, const Image& image,
+                           ThreadPool* pool, PaddedBytes* compressed,
+                           PikInfo* aux_out, bool* ok) {
+  if (!params.lossless) return false;
+  *ok = PIK_FAILURE("Lossless requires 8-bit input");
+  return true;
+}
+
+}  // namespace
+
+template <typename Image>
+bool PixelsToPikT(const CompressParams& params_in, const Image& image,
+                  ThreadPool* pool, EncoderBuffers* buffers,
+                  PaddedBytes* compressed, PikInfo* aux_out) {
+  // Recycles the many same-sized temporaries (see cache_aligned.h).
+  AllocationPool::Scope pool_scope;
+  if (image.xsize() == 0 || image.ysize() == 0) {
+    return PIK_FAILURE("Empty image");
+  }
+  if (params_in.use_brunsli_v2) {
+    return PixelsToBrunsli(params_in, image, pool, compressed, aux_out);
+  }
+  bool lossless_ok;
+  if (MaybePixelsToLossless(params_in, image, pool, compressed, aux_out,
+                            &lossless_ok)) {
+    return lossless_ok;
+  }
+  MetaImageF opsin;
+  {
+    PikStageTimer timer(aux_out, kStageOpsin);
+    opsin = OpsinDynamicsMetaImage(image, pool);
+  }
+  return OpsinMetaImageToPik(params_in, opsin, IsGray(image), pool, buffers,
+                             compressed, aux_out);
+}
+
 bool PixelsToPik(const CompressParams& params, const Image3B& image,
                  ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out) {
-  return PixelsToPikT(params, image, pool, compressed, aux_out);
+  EncoderBuffers buffers;
+  return PixelsToPikT(params, image, pool, &buffers, compressed, aux_out);
 }
 
 bool PixelsToPik(const CompressParams& params, const Image3F& image,
                  ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out) {
-  return PixelsToPikT(params, image, pool, compressed, aux_out);
+  EncoderBuffers buffers;
+  return PixelsToPikT(params, image, pool, &buffers, compressed, aux_out);
 }
 
 bool PixelsToPik(const CompressParams& params, const MetaImageB& image,
                  ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out) {
-  return PixelsToPikT(params, image, pool, compressed, aux_out);
+  EncoderBuffers buffers;
+  return PixelsToPikT(params, image, pool, &buffers, compressed, aux_out);
 }
 
 bool PixelsToPik(const CompressParams& params, const MetaImageF& image,
                  ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out) {
-  return PixelsToPikT(params, image, pool, compressed, aux_out);
+  EncoderBuffers buffers;
+  return PixelsToPikT(params, image, pool, &buffers, compressed, aux_out);
+}
+
+namespace {
+
+template <typename Image>
+bool PixelsToSinkT(const CompressParams& params, const Image& image,
+                   ThreadPool* pool, PositionedByteSink* sink, uint64_t* size,
+                   PikInfo* aux_out) {
+  EncoderBuffers buffers;
+  buffers.sink = sink;
+  PaddedBytes compressed;
+  if (!PixelsToPikT(params, image, pool, &buffers, &compressed, aux_out)) {
+    return false;
+  }
+  if (buffers.sink_size == 0) {
+    // Not written to the sink (Brunsli/lossless), but the output is complete.
+    if (!sink->WriteAt(0, compressed.data(), compressed.size())) {
+      return PIK_FAILURE("Failed to write output");
+    }
+    buffers.sink_size = compressed.size();
+  }
+  *size = buffers.sink_size;
+  return true;
+}
+
+}  // namespace
+
+bool PixelsToPik(const CompressParams& params, const MetaImageB& image,
+                 ThreadPool* pool, PositionedByteSink* sink, uint64_t* size,
+                 PikInfo* aux_out) {
+  return PixelsToSinkT(params, image, pool, sink, size, aux_out);
+}
+
+bool PixelsToPik(const CompressParams& params, const MetaImageF& image,
+                 ThreadPool* pool, PositionedByteSink* sink, uint64_t* size,
+                 PikInfo* aux_out) {
+  return PixelsToSinkT(params, image, pool, sink, size, aux_out);
+}
+
+bool PixelsToPik(const CompressParams& params,
+                 const ConstInterleavedImageView& image, ThreadPool* pool,
+                 PaddedBytes* compressed, PikInfo* aux_out) {
+  AllocationPool::Scope pool_scope;
+  if (image.xsize == 0 || image.ysize == 0) {
+    return PIK_FAILURE("Empty image");
+  }
+  const size_t bytes_per_pixel = BytesPerPixel(image.layout);
+  if (image.bytes_per_row < image.xsize * bytes_per_pixel) {
+    return PIK_FAILURE("Interleaved rows too short");
+  }
+  if (params.use_brunsli_v2) {
+    // Brunsli encodes planar YUV; deinterleaving up front is not the
+    // bottleneck there.
+    const size_t offset_r = image.layout == PixelLayout::kBGRA ? 2 : 0;
+    const size_t offsets[3] = {offset_r, 1, 2 - offset_r};
+    Image3B srgb(image.xsize, image.ysize);
+    for (int c = 0; c < 3; ++c) {
+      for (size_t y = 0; y < image.ysize; ++y) {
+        const uint8_t* PIK_RESTRICT row_in =
+            image.bytes + y * image.bytes_per_row + offsets[c];
+        uint8_t* PIK_RESTRICT row_out = srgb.PlaneRow(c, y);
+        for (size_t x = 0; x < image.xsize; ++x) {
+          row_out[x] = row_in[x * bytes_per_pixel];
+        }
+      }
+    }
+    return PixelsToBrunsli(params, srgb, pool, compressed, aux_out);
+  }
+  // Also checks whether a palette suffices (see kMaxAutoPaletteColors).
+  if (params.lossless || params.palette != Override::kOff) {
+    const size_t offset_r = image.layout == PixelLayout::kBGRA ? 2 : 0;
+    const size_t offsets[4] = {offset_r, 1, 2 - offset_r, 3};
+    const bool has_alpha = image.layout != PixelLayout::kRGB;
+    Image3B srgb(image.xsize, image.ysize);
+    ImageU alpha;
+    if (has_alpha) alpha = ImageU(image.xsize, image.ysize);
+    for (size_t y = 0; y < image.ysize; ++y) {
+      const uint8_t* PIK_RESTRICT row_in =
+          image.bytes + y * image.bytes_per_row;
+      for (int c = 0; c < 3; ++c) {
+        uint8_t* PIK_RESTRICT row_out = srgb.PlaneRow(c, y);
+        for (size_t x = 0; x < image.xsize; ++x) {
+          row_out[x] = row_in[x * bytes_per_pixel + offsets[c]];
+        }
+      }
+      if (has_alpha) {
+        uint16_t* PIK_RESTRICT row_alpha = alpha.Row(y);
+        for (size_t x = 0; x < image.xsize; ++x) {
+          row_alpha[x] = row_in[x * bytes_per_pixel + offsets[3]];
+        }
+      }
+    }
+    MetaImageB meta;
+    meta.SetColor(std::move(srgb));
+    if (has_alpha) meta.SetAlpha(std::move(alpha), 8);
+    bool lossless_ok;
+    if (MaybePixelsToLossless(params, meta, pool, compressed, aux_out,
+                              &lossless_ok)) {
+      return lossless_ok;
+    }
+  }
+  MetaImageF opsin;
+  {
+    PikStageTimer timer(aux_out, kStageOpsin);
+    ImageU alpha;
+    opsin.SetColor(OpsinDynamicsImage(image, pool, &alpha));
+    // Must happen after SetColor.
+    if (image.layout != PixelLayout::kRGB) opsin.SetAlpha(std::move(alpha), 8);
+  }
+  EncoderBuffers buffers;
+  return OpsinMetaImageToPik(params, opsin, IsGray(image), pool, &buffers,
+                             compressed, aux_out);
+}
+
+template <typename T>
+bool PixelsToPikLadderT(const CompressParams& params,
+                        const std::vector<float>& distances,
+                        const bool warm_start, const MetaImage<T>& image,
+                        ThreadPool* pool,
+                        std::vector<PaddedBytes>* compressed,
+                        std::vector<PikInfo>* aux_out) {
+  AllocationPool::Scope pool_scope;
+  if (image.xsize() == 0 || image.ysize() == 0) {
+    return PIK_FAILURE("Empty image");
+  }
+  if (params.use_brunsli_v2 || params.lossless) {
+    return PIK_FAILURE("Ladder does not support Brunsli or lossless");
+  }
+  if (params.target_size != 0 || params.target_bitrate > 0.0f) {
+    return PIK_FAILURE("Ladder requires distance targets");
+  }
+  compressed->resize(distances.size());
+  if (aux_out != nullptr) aux_out->resize(distances.size());
+  if (distances.empty()) return true;
+
+  MetaImageF opsin;
+  {
+    PikStageTimer timer(aux_out == nullptr ? nullptr : &(*aux_out)[0],
+                        kStageOpsin);
+    opsin = OpsinDynamicsMetaImage(image, pool);
+  }
+  const bool is_gray = IsGray(image);
+  EncoderBuffers buffers;
+  buffers.same_image = true;
+  buffers.warm_start = warm_start;
+  for (size_t i = 0; i < distances.size(); ++i) {
+    CompressParams params_i = params;
+    params_i.butteraugli_distance = distances[i];
+    (*compressed)[i].resize(0);
+    if (!OpsinMetaImageToPik(params_i, opsin, is_gray, pool, &buffers,
+                             &(*compressed)[i],
+                             aux_out == nullptr ? nullptr : &(*aux_out)[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PixelsToPikLadder(const CompressParams& params,
+                       const std::vector<float>& distances,
+                       const bool warm_start, const MetaImageB& image,
+                       ThreadPool* pool, std::vector<PaddedBytes>* compressed,
+                       std::vector<PikInfo>* aux_out) {
+  return PixelsToPikLadderT(params, distances, warm_start, image, pool,
+                            compressed, aux_out);
+}
+
+bool PixelsToPikLadder(const CompressParams& params,
+                       const std::vector<float>& distances,
+                       const bool warm_start, const MetaImageF& linear,
+                       ThreadPool* pool, std::vector<PaddedBytes>* compressed,
+                       std::vector<PikInfo>* aux_out) {
+  return PixelsToPikLadderT(params, distances, warm_start, linear, pool,
+                            compressed, aux_out);
+}
+
+bool PixelsToPikFrame(const CompressParams& params, const MetaImageB& frame,
+                      const MetaImageB* previous, ThreadPool* pool,
+                      PaddedBytes* compressed, PikInfo* aux_out) {
+  PROFILER_FUNC;
+  if (frame.xsize() == 0 || frame.ysize() == 0) {
+    return PIK_FAILURE("Empty image");
+  }
+  if (frame.HasAlpha() && frame.AlphaBitDepth() != 8) {
+    return PIK_FAILURE("Frames require 8-bit alpha");
+  }
+  // Such frames (e.g. after a resize) are coded entirely.
+  if (previous != nullptr &&
+      (previous->xsize() != frame.xsize() ||
+       previous->ysize() != frame.ysize() ||
+       previous->HasAlpha() != frame.HasAlpha())) {
+    previous = nullptr;
+  }
+
+  // Frames are always lossless, so a palette may have up to 256 colors.
+  CompressParams lossless_params = params;
+  lossless_params.lossless = true;
+  const std::unique_ptr<Palette> palette = ChoosePalette(
+      lossless_params, frame.GetColor(),
+      frame.HasAlpha() ? &frame.GetAlpha() : nullptr);
+  const bool grayscale = params.grayscale != Override::kOff && IsGray(frame);
+  PaddedBytes code;
+  if (!PixelsToPikLossless(frame, grayscale, palette.get(), previous, pool,
+                           &code, aux_out)) {
+    return false;
+  }
+
+  const size_t pos = compressed->size();
+  compressed->resize(pos + code.size());
+  memcpy(compressed->data() + pos, code.data(), code.size());
+  return true;
+}
+
+PikEncoder::PikEncoder() : buffers_(new EncoderBuffers) {}
+PikEncoder::~PikEncoder() {}
+
+template <class Image>
+bool PikEncoder::EncodeT(const CompressParams& params, const Image& image,
+                         ThreadPool* pool, PaddedBytes* compressed,
+                         PikInfo* aux_out) {
+  const bool ok =
+      PixelsToPikT(params, image, pool, buffers_.get(), compressed, aux_out);
+  const size_t retained = RetainedBytes();
+  peak_retained_bytes_ = std::max(peak_retained_bytes_, retained);
+  if (retained > max_retained_bytes_) ReleaseMemory();
+  return ok;
+}
+
+bool PikEncoder::Encode(const CompressParams& params, const MetaImageB& image,
+                        ThreadPool* pool, PaddedBytes* compressed,
+                        PikInfo* aux_out) {
+  return EncodeT(params, image, pool, compressed, aux_out);
+}
+bool PikEncoder::Encode(const CompressParams& params, const Image3B& image,
+                        ThreadPool* pool, PaddedBytes* compressed,
+                        PikInfo* aux_out) {
+  return EncodeT(params, image, pool, compressed, aux_out);
+}
+bool PikEncoder::Encode(const CompressParams& params, const MetaImageF& linear,
+                        ThreadPool* pool, PaddedBytes* compressed,
+                        PikInfo* aux_out) {
+  return EncodeT(params, linear, pool, compressed, aux_out);
+}
+bool PikEncoder::Encode(const CompressParams& params, const Image3F& linear,
+                        ThreadPool* pool, PaddedBytes* compressed,
+                        PikInfo* aux_out) {
+  return EncodeT(params, linear, pool, compressed, aux_out);
+}
+
+size_t PikEncoder::RetainedBytes() const { return buffers_->BytesAllocated(); }
+
+void PikEncoder::ReleaseMemory() { buffers_.reset(new EncoderBuffers); }
+
+// Rows [y0, y0 + num_rows) of the opsin image are buffered in "opsin".
+struct StreamingEncoderState {
+  // Blocks of context above and below each group row; enough for the
+  // adaptive quantization kernels and the HQ DC/AC prediction.
+  static constexpr size_t kContextBlocks = 8;
+
+  CompressParams params;
+  Header header;
+  ThreadPool* pool;
+  size_t xsize_blocks;
+  size_t ysize_blocks;
+  size_t xsize_groups;
+  size_t ysize_groups;
+
+  Image3F opsin;
+  size_t y0 = 0;
+  size_t num_rows = 0;
+  size_t next_group_row = 0;
+
+  // Whole-image results of the encoded group rows.
+  float quant_dc = 0.0f;
+  ImageF quant_field;
+  Image3S dc;
+  std::vector<std::vector<Token> > tokens;  // per group
+
+  EncCache cache;
+};
+
+namespace {
+
+// Pixel rows [*begin, *end) that determine the coefficients of group row gy.
+void StreamingRowsForGroupRow(const StreamingEncoderState& state,
+                              const size_t gy, size_t* PIK_RESTRICT begin,
+                              size_t* PIK_RESTRICT end) {
+  const size_t kContext = StreamingEncoderState::kContextBlocks;
+  const size_t group_size = GroupSizeInBlocks(state.header);
+  const size_t by0 = gy * group_size;
+  const size_t by1 = std::min(by0 + group_size + kContext, state.ysize_blocks);
+  *begin = (by0 - std::min(by0, kContext)) * kBlockHeight;
+  *end = std::min<size_t>(by1 * kBlockHeight, state.header.ysize);
+}
+
+void CopyRows(const Image3F& from, const size_t from_y, const size_t num_rows,
+              const size_t to_y, Image3F* PIK_RESTRICT to) {
+  for (int c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < num_rows; ++y) {
+      memcpy(to->PlaneRow(c, to_y + y), from.ConstPlaneRow(c, from_y + y),
+             from.xsize() * sizeof(float));
+    }
+  }
+}
+
+}  // namespace
+
+PikStreamingEncoder::PikStreamingEncoder() {}
+PikStreamingEncoder::~PikStreamingEncoder() {}
+
+bool PikStreamingEncoder::Init(const CompressParams& params_in,
+                               const size_t xsize, const size_t ysize,
+                               ThreadPool* pool) {
+  state_.reset();
+  const CompressParams params = ParamsForEffort(params_in);
+  if (xsize == 0 || ysize == 0) {
+    return PIK_FAILURE("Empty image");
+  }
+  // These would require the whole image (or a second pass): global noise
+  // estimation, the coefficient search/target size loops, smooth DC
+  // prediction with its gradient map and Gaborish.
+  if (!params.fast_mode || params.use_brunsli_v2 || params.lossless ||
+      params.butteraugli_distance <= 0.0 ||
+      params.butteraugli_distance >= kMaxButteraugliForHQ ||
+      NoiseEnabled(params) || params.target_size > 0 ||
+      params.target_bitrate > 0.0) {
+    return PIK_FAILURE("Parameters not supported for streaming");
+  }
+
+  std::unique_ptr<StreamingEncoderState> state(new StreamingEncoderState);
+  state->params = params;
+  state->header = HeaderForParams(params, xsize, ysize, pool);
+  // Unlike PixelsToPik, Override::kDefault does not detect neutral gray
+  // inputs because the first group rows are encoded before all pixels were
+  // seen; such images are coded in color.
+  if (params.grayscale == Override::kOn) {
+    state->header.flags |= Header::kGrayscale;
+    state->header.flags &= ~Header::kDither;
+    state->header.num_components = 1;
+  }
+  PIK_CHECK((state->header.flags &
+             (Header::kSmoothDCPred | Header::kGaborishTransform |
+              Header::kGradientMap)) == 0);
+  state->pool = pool;
+  state->xsize_blocks = DivCeil(xsize, kBlockWidth);
+  state->ysize_blocks = DivCeil(ysize, kBlockHeight);
+  const size_t group_size = GroupSizeInBlocks(state->header);
+  state->xsize_groups = DivCeil(state->xsize_blocks, group_size);
+  state->ysize_groups = DivCeil(state->ysize_blocks, group_size);
+  const size_t max_rows = std::min<size_t>(
+      ysize,
+      (group_size + 2 * StreamingEncoderState::kContextBlocks) * kBlockHeight);
+  state->opsin = Image3F(xsize, max_rows);
+  state->quant_field = ImageF(state->xsize_blocks, state->ysize_blocks);
+  state->dc = Image3S(state->xsize_blocks, state->ysize_blocks);
+  state->tokens.resize(state->xsize_groups * state->ysize_groups);
+  state_ = std::move(state);
+  return true;
+}
+
+bool PikStreamingEncoder::AddRows(const Image3B& rows) {
+  if (!state_) return PIK_FAILURE("Not initialized");
+  StreamingEncoderState& state = *state_;
+  if (rows.xsize() != state.header.xsize) {
+    return PIK_FAILURE("Row width mismatch");
+  }
+  if (state.y0 + state.num_rows + rows.ysize() > state.header.ysize) {
+    return PIK_FAILURE("Too many rows");
+  }
+  AllocationPool::Scope pool_scope;
+  Image3F opsin = OpsinDynamicsImage(rows, state.pool);
+  if (state.header.flags & Header::kGrayscale) {
+    DiscardColor(&opsin);
+  }
+
+  size_t pos = 0;
+  while (pos < opsin.ysize()) {
+    // Always > 0: the buffer is large enough for any group row, and full
+    // group rows are encoded (and their rows dropped) below.
+    const size_t n = std::min(opsin.ysize() - pos,
+                              state.opsin.ysize() - state.num_rows);
+    PIK_CHECK(n != 0);
+    CopyRows(opsin, pos, n, state.num_rows, &state.opsin);
+    state.num_rows += n;
+    pos += n;
+
+    size_t begin, end;
+    while (state.next_group_row < state.ysize_groups) {
+      StreamingRowsForGroupRow(state, state.next_group_row, &begin, &end);
+      if (state.y0 + state.num_rows < end) break;
+      EncodeGroupRow();
+    }
+  }
+  return true;
+}
+
+void PikStreamingEncoder::EncodeGroupRow() {
+  StreamingEncoderState& state = *state_;
+  const size_t gy = state.next_group_row++;
+  size_t begin, end;
+  StreamingRowsForGroupRow(state, gy, &begin, &end);
+  PIK_ASSERT(state.y0 <= begin && end <= state.y0 + state.num_rows);
+
+  const size_t band_ysize = end - begin;
+  Image3F band(state.header.xsize, band_ysize);
+  CopyRows(state.opsin, begin - state.y0, band_ysize, 0, &band);
+
+  // Same steps as OpsinToPikT, restricted to the band. The outputs for the
+  // group row (excluding the context blocks) match those of the whole image.
+  const ImageF qf =
+      FastQuantField(state.params, band.Plane(1), state.pool,
+                     &state.quant_dc);
+  const size_t band_ysize_blocks = qf.ysize();
+  Quantizer quantizer(state.header.quant_template, state.xsize_blocks,
+                      band_ysize_blocks);
+  quantizer.SetQuant(1.0f);
+  quantizer.SetQuantField(state.quant_dc, QuantField(qf), state.params);
+
+  // The centered opsin is only needed for the coefficients.
+  state.cache.Reset();
+  state.cache.pending_dct =
+      CenteredOpsinDCT(band, /*gaborish_inverse=*/false, state.pool);
+  const QuantizedCoeffs qcoeffs = ComputeCoefficients(
+      state.params, state.header, Image3F(),
+      quantizer, ColorTransform(state.header.xsize, band_ysize), state.pool,
+      &state.cache, nullptr);
+
+  const size_t group_size = GroupSizeInBlocks(state.header);
+  const size_t by0 = gy * group_size;
+  const size_t band_by0 = by0 - begin / kBlockHeight;
+  const size_t group_ysize_blocks =
+      std::min(group_size, state.ysize_blocks - by0);
+  for (size_t y = 0; y < group_ysize_blocks; ++y) {
+    memcpy(state.quant_field.Row(by0 + y), qf.ConstRow(band_by0 + y),
+           state.xsize_blocks * sizeof(float));
+    for (int c = 0; c < 3; ++c) {
+      memcpy(state.dc.PlaneRow(c, by0 + y),
+             qcoeffs.dc.ConstPlaneRow(c, band_by0 + y),
+             state.xsize_blocks * sizeof(int16_t));
+    }
+  }
+
+  int32_t order[kOrderContexts * kBlockSize];
+  NaturalCoeffOrders(order);
+  Image3B block_ctx(state.xsize_blocks, band_ysize_blocks);
+  const ImageI& quant_field = quantizer.RawQuantField();
+  state.pool->Run(
+      0, state.xsize_groups, [&](const int task, const int thread) {
+        const Rect rect(task * group_size, band_by0, group_size,
+                        group_ysize_blocks, state.xsize_blocks,
+                        band_ysize_blocks);
+        ComputeBlockContextFromDC(rect, qcoeffs.dc, quantizer, rect,
+                                  &block_ctx);
+        state.tokens[gy * state.xsize_groups + task] = TokenizeCoefficients(
+            order, rect, quant_field, qcoeffs.ac, rect, block_ctx,
+            /*num_nzeros=*/nullptr,
+            (state.header.flags & Header::kGrayscale) != 0);
+      });
+
+  // Drop the rows that no later group row needs.
+  if (state.next_group_row < state.ysize_groups) {
+    StreamingRowsForGroupRow(state, state.next_group_row, &begin, &end);
+    const size_t num_dropped = begin - state.y0;
+    for (int c = 0; c < 3; ++c) {
+      for (size_t y = num_dropped; y < state.num_rows; ++y) {
+        memcpy(state.opsin.PlaneRow(c, y - num_dropped),
+               state.opsin.ConstPlaneRow(c, y),
+               state.opsin.xsize() * sizeof(float));
+      }
+    }
+    state.y0 = begin;
+    state.num_rows -= num_dropped;
+  }
+}
+
+bool PikStreamingEncoder::Finish(PaddedBytes* compressed, PikInfo* aux_out) {
+  return FinishImpl(compressed, nullptr, nullptr, aux_out);
+}
+
+bool PikStreamingEncoder::Finish(PositionedByteSink* sink, uint64_t* size,
+                                 PikInfo* aux_out) {
+  PaddedBytes header;
+  return FinishImpl(&header, sink, size, aux_out);
+}
+
+bool PikStreamingEncoder::FinishImpl(PaddedBytes* compressed,
+                                     PositionedByteSink* sink, uint64_t* size,
+                                     PikInfo* aux_out) {
+  if (!state_) return PIK_FAILURE("Not initialized");
+  StreamingEncoderState& state = *state_;
+  if (state.next_group_row != state.ysize_groups) {
+    return PIK_FAILURE("Not all rows were added");
+  }
+  AllocationPool::Scope pool_scope;
+  if (!StoreHeaderAndSections(state.header, Sections(), compressed,
+                              aux_out)) {
+    return false;
+  }
+
+  Quantizer quantizer(state.header.quant_template, state.xsize_blocks,
+                      state.ysize_blocks);
+  quantizer.SetQuant(1.0f);
+  quantizer.SetQuantField(state.quant_dc, QuantField(state.quant_field),
+                          state.params);
+  const ColorTransform ctan(state.header.xsize, state.header.ysize);
+  if (sink != nullptr) {
+    uint64_t bitstream_size;
+    if (!sink->WriteAt(0, compressed->data(), compressed->size()) ||
+        !EncodeToBitstream(state.dc, state.tokens, state.header, quantizer,
+                           NoiseParams(), ctan, state.pool, compressed->size(),
+                           sink, &bitstream_size, aux_out)) {
+      return PIK_FAILURE("Failed to write output");
+    }
+    *size = compressed->size() + bitstream_size;
+  } else {
+    const PaddedBytes compressed_data =
+        EncodeToBitstream(state.dc, state.tokens, state.header, quantizer,
+                          NoiseParams(), ctan, state.pool, aux_out);
+    AppendBytes(compressed_data, compressed);
+  }
+  state_.reset();
+  return true;
 }
 
 bool OpsinToPik(const CompressParams& params, const Header& header,
                 const MetaImageF& opsin_orig,
                 ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out) {
+  AllocationPool::Scope pool_scope;
+  EncoderBuffers buffers;
+  return OpsinToPikT(ParamsForEffort(params), header, opsin_orig, pool,
+                     &buffers, compressed, aux_out);
+}
+
+bool OpsinToPikT(const CompressParams& params, const Header& header,
+                 const MetaImageF& opsin_orig, ThreadPool* pool,
+                 EncoderBuffers* buffers, PaddedBytes* compressed,
+                 PikInfo* aux_out) {
   PROFILER_ZONE("enc OpsinToPik uninstrumented");
   if (opsin_orig.xsize() == 0 || opsin_orig.ysize() == 0) {
     return PIK_FAILURE("Empty image");
@@ -919,26 +2442,45 @@ bool OpsinToPik(const CompressParams& params, const Header& header,
   const size_t ysize = opsin_orig.ysize();
   const size_t xsize_blocks = DivCeil(xsize, kBlockWidth);
   const size_t ysize_blocks = DivCeil(ysize, kBlockHeight);
-  Image3F opsin = AlignImage(opsin_orig.GetColor(), 8);
-  CenterOpsinValues(&opsin);
+  if (!buffers->same_image) {
+    // From the previous image.
+    buffers->butteraugli_reference.reset();
+    buffers->adaptive_quant_field = ImageF();
+  }
+  buffers->deadline =
+      params.time_budget_ms != 0 ? Now() + params.time_budget_ms * 1E-3 : 0.0;
+  buffers->cancel = params.cancel;
+  for (EncCache* cache : {&buffers->search, &buffers->coefficients}) {
+    cache->num_pred_hits = 0;
+    cache->num_pred_misses = 0;
+  }
   NoiseParams noise_params;
-  // We don't add noise at low butteraugli distances, since the
-  // original noise is stored within the compressed image. Adding the
-  // noise there only makes things worse. We start adding noise at
-  // the kNoiseModelingRampUpDistanceMin distance, but we don't start
-  // at zero amplitude since adding noise is expensive -- it significantly
-  // slows down decoding, and this is unlikely to completely go away even
-  // with advanced optimizations. After the kNoiseModelingRampUpDistanceRange
-  // we have reached the full level, i.e., noise is no longer represented by
-  // the compressed image, so we can add full noise by the noise modeling
-  // itself.
-  static const double kNoiseModelingRampUpDistanceMin = 1.4;
-  static const double kNoiseModelingRampUpDistanceRange = 0.6;
-  static const double kNoiseLevelAtStartOfRampUp = 0.25;
-  bool enable_noise =
-      params.butteraugli_distance > kNoiseModelingRampUpDistanceMin;
-  if (params.apply_noise != Override::kDefault) {
-    enable_noise = params.apply_noise == Override::kOn;
+  // Grayscale images have no noise: it would be added to X and B as well.
+  const bool enable_noise =
+      NoiseEnabled(params) && !(header.flags & Header::kGrayscale);
+  const bool gaborish = (header.flags & Header::kGaborishTransform) != 0;
+  const bool cached_gaborish =
+      buffers->same_image && buffers->gaborish_opsin.xsize() != 0;
+  // The noise estimate requires the opsin before GaborishInverse, otherwise
+  // it is applied in the same pass as the alignment and centering.
+  const bool fuse_gaborish = gaborish && !enable_noise && !cached_gaborish;
+  // Otherwise, the fast mode only needs the centered opsin for computing the
+  // coefficients, so they are computed from tiles without materializing it.
+  // low_memory also recomputes them like this for each search iteration.
+  const bool tiled_dct = (params.fast_mode || params.low_memory) &&
+                         !enable_noise && !buffers->same_image;
+  for (EncCache* cache : {&buffers->search, &buffers->coefficients}) {
+    cache->uncentered_opsin = tiled_dct ? &opsin_orig.GetColor() : nullptr;
+    cache->uncentered_gaborish_inverse = gaborish;
+    cache->low_memory = params.low_memory;
+  }
+  // ScaleToTargetSize evaluates several quantizers from one cache.
+  if (params.target_size_search_fast_mode) {
+    buffers->coefficients.low_memory = false;
+  }
+  Image3F opsin;
+  if (!tiled_dct) {
+    opsin = CenteredOpsin(opsin_orig.GetColor(), fuse_gaborish, pool);
   }
   if (enable_noise) {
     PROFILER_ZONE("enc GetNoiseParam");
@@ -951,46 +2493,65 @@ bool OpsinToPik(const CompressParams& params, const Header& header,
       quality_coef = kNoiseLevelAtStartOfRampUp +
                      (1.0 - kNoiseLevelAtStartOfRampUp) * rampup;
     }
-    GetNoiseParameter(opsin, &noise_params, quality_coef);
+    GetNoiseParameter(opsin, &noise_params, quality_coef, pool,
+                      params.noise_patch_stride);
+  }
+  if (gaborish && !tiled_dct) {
+    if (cached_gaborish) {
+      opsin = CopyImage(buffers->gaborish_opsin);
+    } else {
+      if (!fuse_gaborish) GaborishInverse(opsin);
+      if (buffers->same_image) buffers->gaborish_opsin = CopyImage(opsin);
+    }
   }
-  if (header.flags & Header::kGaborishTransform) {
-    GaborishInverse(opsin);
+  // Only shared if same_image, otherwise computed where needed.
+  const Image3F* shared_dct = nullptr;
+  if (buffers->same_image) {
+    Image3F& dct = buffers->opsin_dct[gaborish];
+    if (dct.xsize() == 0) dct = TransposedScaledDCT(opsin, pool);
+    shared_dct = &dct;
   }
+  buffers->search.precomputed_dct = shared_dct;
+  buffers->coefficients.precomputed_dct = shared_dct;
   ColorTransform ctan(xsize, ysize);
-  if (!params.fast_mode &&
+  // Grayscale images do not store ctan.
+  if (!params.fast_mode && !(header.flags & Header::kGrayscale) &&
       (params.butteraugli_distance >= 0.0 || params.target_bitrate > 0.0 ||
        params.target_size > 0)) {
     PROFILER_ZONE("enc YTo* correlation");
-    const Image3F dct = TransposedScaledDCT(opsin, pool);
-    FindBestYToBCorrelation(dct, &ctan.ytob_map, &ctan.ytob_dc);
-    FindBestYToXCorrelation(dct, &ctan.ytox_map, &ctan.ytox_dc);
+    Image3F dct;
+    if (tiled_dct) {
+      dct = CenteredOpsinDCT(opsin_orig.GetColor(), gaborish, pool);
+    } else if (shared_dct == nullptr) {
+      dct = TransposedScaledDCT(opsin, pool);
+    }
+    const Image3F& ctan_dct = shared_dct != nullptr ? *shared_dct : dct;
+    FindBestYToBCorrelation(ctan_dct, pool, &ctan.ytob_map, &ctan.ytob_dc);
+    FindBestYToXCorrelation(ctan_dct, pool, &ctan.ytox_map, &ctan.ytox_dc);
   }
+  if (IsCancelled(params.cancel)) return PIK_FAILURE("Encoding cancelled");
   Quantizer quantizer(header.quant_template, xsize_blocks, ysize_blocks);
   quantizer.SetQuant(1.0f);
   if (params.fast_mode) {
-    PROFILER_ZONE("enc fast quant");
-    const float butteraugli_target = params.butteraugli_distance;
-    const float butteraugli_target_dc =
-        std::min<float>(butteraugli_target,
-                        pow(butteraugli_target, 0.65564410590742384 ));
-    const float kQuantDC = 0.57 / butteraugli_target_dc;
-    const float kQuantAC = ( 2.4528887094120813 ) / butteraugli_target;
-    ImageF qf = AdaptiveQuantizationMap(opsin_orig.GetColor().Plane(1), 8);
-    quantizer.SetQuantField(kQuantDC, QuantField(ScaleImage(kQuantAC, qf)),
-                            params);
+    PikStageTimer timer(aux_out, kStageQuantSearch);
+    float quant_dc;
+    const ImageF qf =
+        FastQuantField(params, opsin_orig.GetColor().Plane(1), pool,
+                       &quant_dc);
+    quantizer.SetQuantField(quant_dc, QuantField(qf), params);
   } else if (params.target_size > 0 || params.target_bitrate > 0.0) {
-    size_t target_size = TargetSize(params, opsin);
+    size_t target_size = TargetSize(params, opsin_orig.GetColor());
     if (params.target_size_search_fast_mode) {
       PROFILER_ZONE("enc find best + scaleToTarget");
       FindBestQuantization(opsin_orig.GetColor(), opsin, params, header, 1.0,
-                           ctan, pool, &quantizer, aux_out);
+                           ctan, pool, &quantizer, buffers, aux_out);
       ScaleToTargetSize(opsin, params, noise_params, header, target_size, ctan,
-                        pool, &quantizer, aux_out);
+                        pool, &quantizer, buffers, aux_out);
     } else {
       PROFILER_ZONE("enc compressToTarget");
       CompressToTargetSize(opsin_orig.GetColor(), opsin, params, noise_params,
                            header, target_size, ctan, pool, &quantizer,
-                           aux_out);
+                           buffers, aux_out);
     }
   } else if (params.uniform_quant > 0.0) {
     PROFILER_ZONE("enc SetQuant");
@@ -1004,50 +2565,139 @@ bool OpsinToPik(const CompressParams& params, const Header& header,
     if (params.butteraugli_distance <= kNoiseModelingRampUpDistanceMin) {
       FindBestQuantizationHQ(opsin_orig.GetColor(), opsin, params, header,
                              params.butteraugli_distance, ctan, pool,
-                             &quantizer, aux_out);
+                             &quantizer, buffers, aux_out);
     } else {
       FindBestQuantization(opsin_orig.GetColor(), opsin, params, header,
                            params.butteraugli_distance, ctan, pool, &quantizer,
-                           aux_out);
+                           buffers, aux_out);
+    }
+    if (buffers->warm_start) {
+      float quant_dc;
+      quantizer.GetQuantField(&quant_dc, &buffers->prior_quant_field);
+      buffers->prior_distance = params.butteraugli_distance;
     }
   }
-  EncCache cache;
-  QuantizedCoeffs qcoeffs = ComputeCoefficients(
-      params, header, opsin, quantizer, ctan, pool, &cache, aux_out);
-  PaddedBytes compressed_data = EncodeToBitstream(
-      qcoeffs, quantizer, noise_params, ctan, params.fast_mode, aux_out);
-
-  {
-    size_t old_size = compressed->size();
-    compressed->resize(compressed->size() + cache.gradient_map.size());
-    memcpy(compressed->data() + old_size, cache.gradient_map.data(),
-           cache.gradient_map.size());
+  if (IsCancelled(params.cancel)) return PIK_FAILURE("Encoding cancelled");
+  if (params.low_memory) {
+    // The search state, which EncoderBuffers otherwise retains for the next
+    // image, is freed before allocating the final coefficients.
+    buffers->search.Release();
+    buffers->recon = DecCache();
+    if (!buffers->same_image) {
+      buffers->butteraugli_reference.reset();
+      buffers->adaptive_quant_field = ImageF();
+    }
   }
-
+  EncCache& cache = buffers->coefficients;
+  cache.Reset();
+  QuantizedCoeffs qcoeffs;
   {
-    size_t old_size = compressed->size();
-    compressed->resize(compressed->size() + compressed_data.size());
-    memcpy(compressed->data() + old_size, compressed_data.data(),
-           compressed_data.size());
+    PikStageTimer timer(aux_out, kStageCoefficients);
+    qcoeffs = ComputeCoefficients(params, header, opsin, quantizer, ctan, pool,
+                                  &cache, aux_out);
+  }
+  AppendBytes(cache.gradient_map, compressed);
+  if (buffers->sink != nullptr) {
+    PikStageTimer timer(aux_out, kStageEncode);
+    PositionedByteSink* sink = buffers->sink;
+    uint64_t bitstream_size;
+    if (!sink->WriteAt(0, compressed->data(), compressed->size()) ||
+        !EncodeToBitstream(qcoeffs, header, quantizer, noise_params, ctan,
+                           params.fast_mode, pool, compressed->size(), sink,
+                           &bitstream_size, aux_out)) {
+      return PIK_FAILURE("Failed to write output");
+    }
+    buffers->sink_size = compressed->size() + bitstream_size;
+  } else {
+    PaddedBytes compressed_data;
+    {
+      PikStageTimer timer(aux_out, kStageEncode);
+      compressed_data =
+          EncodeToBitstream(qcoeffs, header, quantizer, noise_params, ctan,
+                            params.fast_mode, pool, aux_out);
+    }
+    AppendBytes(compressed_data, compressed);
   }
 
+  if (aux_out != nullptr) {
+    for (const EncCache* c : {&buffers->search, &buffers->coefficients}) {
+      aux_out->num_pred_cache_hits += c->num_pred_hits;
+      aux_out->num_pred_cache_misses += c->num_pred_misses;
+    }
+  }
   return true;
 }
 
+namespace {
+
+// Returns the approximate butteraugli distance of a JPEG to its original,
+// judging by how much coarser its luma quantization table is than the
+// Annex K table (libjpeg quality 50). The constant is fitted to the distances
+// of images encoded with scaled Annex K tables.
+float JpegSourceDistance(const guetzli::JPEGData& jpeg) {
+  if (jpeg.components.empty()) return 0.0f;
+  const size_t quant_idx = jpeg.components[0].quant_idx;
+  if (quant_idx >= jpeg.quant.size()) return 0.0f;
+  const std::vector<int>& values = jpeg.quant[quant_idx].values;
+  float sum_ratios = 0.0f;
+  for (size_t k = 0; k < 64; ++k) {
+    sum_ratios += static_cast<float>(values[k]) / kDefaultQuantMatrix[0][k];
+  }
+  const float kScaleToDistance = 5.7f;
+  return kScaleToDistance * std::sqrt(sum_ratios / 64);
+}
+
+bool JpegToPikTranscode(const CompressParams& params,
+                        const guetzli::JPEGData& jpeg, ThreadPool* pool,
+                        PaddedBytes* compressed, PikInfo* aux_out) {
+  std::vector<uint8_t> rgb = DecodeJpegToRGB(jpeg, pool);
+  if (rgb.empty()) {
+    return PIK_FAILURE("JPEG decoding error.");
+  }
+  const Image3B srgb =
+      Image3FromInterleaved(&rgb[0], jpeg.width, jpeg.height, 3 * jpeg.width);
+  EncoderBuffers buffers;
+  buffers.source_distance = JpegSourceDistance(jpeg);
+  return PixelsToPikT(params, srgb, pool, &buffers, compressed, aux_out);
+}
+
+}  // namespace
+
 bool JpegToPik(const CompressParams& params, const guetzli::JPEGData& jpeg,
                ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out) {
   if (params.butteraugli_distance <= 0.0) {
-    return JpegToPikLossless(jpeg, compressed, aux_out);
+    return JpegToPikLossless(jpeg, pool, compressed, aux_out);
+  }
+  if (params.jpeg_transcode) {
+    return JpegToPikTranscode(params, jpeg, pool, compressed, aux_out);
   }
 
   guetzli::Params guetzli_params;
   guetzli_params.butteraugli_target = params.butteraugli_distance;
   guetzli_params.clear_metadata = params.clear_metadata;
+  guetzli_params.pool = pool;
   guetzli::JPEGData jpeg_out;
   if (!guetzli::Process(guetzli_params, jpeg, &jpeg_out)) {
     return PIK_FAILURE("Guetzli processing failed.");
   }
-  return JpegToPikLossless(jpeg_out, compressed, aux_out);
+  return JpegToPikLossless(jpeg_out, pool, compressed, aux_out);
+}
+
+bool JpegToPik(const CompressParams& params, const uint8_t* jpeg,
+               size_t jpeg_size, ThreadPool* pool, PaddedBytes* compressed,
+               PikInfo* aux_out) {
+  if (params.butteraugli_distance <= 0.0) {
+    guetzli::JPEGReadError error;
+    if (JpegBytesToPikLossless(jpeg, jpeg_size, pool, compressed, &error)) {
+      return true;
+    }
+    if (error != guetzli::JPEG_BANDS_UNSUPPORTED) return false;
+  }
+  guetzli::JPEGData jpg;
+  if (!guetzli::ReadJpeg(jpeg, jpeg_size, guetzli::JPEG_READ_ALL, &jpg)) {
+    return PIK_FAILURE("Invalid jpeg input.");
+  }
+  return JpegToPik(params, jpg, pool, compressed, aux_out);
 }
 
 bool ValidateHeaderFields(const Header& header,
@@ -1070,6 +2720,16 @@ bool ValidateHeaderFields(const Header& header,
     return PIK_FAILURE("Invalid quant table.");
   }
 
+  if (header.num_ans_states != 1 && header.num_ans_states != 2 &&
+      header.num_ans_states != 4) {
+    return PIK_FAILURE("Invalid number of ANS states.");
+  }
+
+  if (header.group_size_in_tiles != 2 && header.group_size_in_tiles != 4 &&
+      header.group_size_in_tiles != 8 && header.group_size_in_tiles != 16) {
+    return PIK_FAILURE("Invalid group size.");
+  }
+
   return true;
 }
 
@@ -1079,7 +2739,9 @@ class Decoder {
   // To avoid the complexity of file I/O and buffering, we assume the bitstream
   // is loaded (or for large images/sequences: mapped into) memory.
   Decoder(const uint8_t* compressed, const size_t compressed_size)
-      : reader_(compressed, compressed_size) {}
+      : compressed_(compressed),
+        compressed_size_(compressed_size),
+        reader_(compressed, compressed_size) {}
 
   bool ReadHeader() {
     PIK_CHECK(valid_ == 0);
@@ -1088,10 +2750,16 @@ class Decoder {
     return true;
   }
 
-  bool ReadSections() {
+  // Only materializes the sections in "which" (Sections::kIndex* bits); the
+  // others (e.g. metadata) remain accessible via GetLazySections.
+  bool ReadSections(const uint32_t which) {
     PIK_CHECK(valid_ == kHeader);
-    if (header_.bitstream == Header::kBitstreamDefault) {
-      if (!LoadSections(&reader_, &sections_)) return false;
+    if (header_.bitstream == Header::kBitstreamDefault ||
+        header_.bitstream == Header::kBitstreamLossless) {
+      if (!lazy_sections_.Load(compressed_, compressed_size_, &reader_)) {
+        return false;
+      }
+      if (!lazy_sections_.Materialize(which, &sections_)) return false;
       reader_.JumpToByteBoundary();
     } else {
       // sections_ is default-initialized and thus already "valid".
@@ -1111,6 +2779,11 @@ class Decoder {
     return sections_;
   }
 
+  const LazySections& GetLazySections() const {
+    PIK_CHECK(valid_ & kSections);
+    return lazy_sections_;
+  }
+
   // TODO(janwas): remove once Brunsli is integrated.
   BitReader& GetReader() { return reader_; }
 
@@ -1120,24 +2793,646 @@ class Decoder {
     kSections = 1,
   };
 
+  const uint8_t* compressed_;
+  const size_t compressed_size_;
   BitReader reader_;
   uint64_t valid_ = 0;
   Header header_;
+  LazySections lazy_sections_;
   Sections sections_;
 };
 
+bool PikProbe(const uint8_t* compressed, const size_t compressed_size,
+              PikBasicInfo* info) {
+  // Also avoids reading the magic bytes past the end.
+  if (compressed_size < 4) return PIK_FAILURE("Too small for a PIK header.");
+  BitReader reader(compressed, compressed_size);
+  Header header;
+  if (!LoadHeader(&reader, &header)) return false;
+  *info = PikBasicInfo();
+  info->bitstream = header.bitstream;
+
+  if (header.bitstream == Header::kBitstreamBrunsli) {
+    reader.JumpToByteBoundary();
+    const size_t pos = reader.Position();
+    if (pos > compressed_size) return PIK_FAILURE("Truncated header.");
+    guetzli::JPEGData jpg;
+    if (!BrunsliV2DecodeHeader(compressed + pos, compressed_size - pos, &jpg)) {
+      return false;
+    }
+    info->xsize = jpg.width;
+    info->ysize = jpg.height;
+    info->num_components = jpg.components.size();
+    return true;
+  }
+
+  if (header.bitstream == Header::kBitstreamLossless) {
+    info->xsize = header.xsize;
+    info->ysize = header.ysize;
+    // Gray or color, followed by alpha (if any).
+    info->num_components = header.num_components <= 2 ? 1 : 3;
+    info->has_alpha = (header.num_components & 1) == 0;
+    return true;
+  }
+
+  // Only the presence bits; the (possibly large) alpha payload is skipped.
+  const uint32_t section_bits = LoadSectionBits(&reader);
+  if (reader.Position() > compressed_size) {
+    return PIK_FAILURE("Truncated header.");
+  }
+  info->xsize = header.xsize;
+  info->ysize = header.ysize;
+  info->group_size = GroupSizeInBlocks(header) * kBlockWidth;
+  // The default bitstream is always color; num_components is not yet used.
+  info->num_components = header.num_components != 0 ? header.num_components : 3;
+  info->has_alpha = (section_bits & (1U << Sections::kIndexAlpha)) != 0;
+  return true;
+}
+
+bool PikRewriteMetadata(const CompressParams& params,
+                        const PaddedBytes& compressed,
+                        const std::vector<uint8_t>* icc, PaddedBytes* out) {
+  PROFILER_FUNC;
+  if (compressed.size() < 4) return PIK_FAILURE("Too small for a PIK header.");
+  BitReader reader(compressed.data(), compressed.size());
+  Header header;
+  if (!LoadHeader(&reader, &header)) return false;
+  if (header.bitstream != Header::kBitstreamDefault) {
+    return PIK_FAILURE("Metadata rewrite requires the default bitstream");
+  }
+
+  LazySections lazy;
+  if (!lazy.Load(compressed.data(), compressed.size(), &reader)) return false;
+  reader.JumpToByteBoundary();
+  const size_t bitstream_pos = reader.Position();
+  if (bitstream_pos > compressed.size()) {
+    return PIK_FAILURE("Truncated sections.");
+  }
+
+  // Sections that are about to be dropped or replaced are not even copied.
+  uint32_t keep = ~0u;
+  if (params.clear_metadata) {
+    keep &= ~((1U << Sections::kIndexEXIF) | (1U << Sections::kIndexXMP));
+  }
+  if (icc != nullptr) keep &= ~(1U << Sections::kIndexICC);
+  Sections sections;
+  if (!lazy.Materialize(keep, &sections)) return false;
+  if (icc != nullptr && !icc->empty()) {
+    sections.icc.reset(new ICC);
+    sections.icc->profile = *icc;
+  }
+
+  if (!StoreHeaderAndSections(header, sections, out, nullptr)) return false;
+  const size_t sections_size = out->size();
+  out->resize(sections_size + compressed.size() - bitstream_pos);
+  memcpy(out->data() + sections_size, compressed.data() + bitstream_pos,
+         compressed.size() - bitstream_pos);
+  return true;
+}
+
+bool PikCrop(const PaddedBytes& compressed, const Rect& rect,
+             ThreadPool* pool, PaddedBytes* cropped) {
+  PROFILER_FUNC;
+  if (compressed.size() < 4) return PIK_FAILURE("Too small for a PIK header.");
+  BitReader reader(compressed.data(), compressed.size());
+  Header header;
+  if (!LoadHeader(&reader, &header)) return false;
+  if (header.bitstream != Header::kBitstreamDefault) {
+    return PIK_FAILURE("Cropping requires the default bitstream");
+  }
+  if (!ValidateHeaderFields(header, DecompressParams())) return false;
+
+  const size_t xsize = header.xsize;
+  const size_t ysize = header.ysize;
+  const size_t group_size = GroupSizeInBlocks(header) * kBlockWidth;
+  if (rect.x0() >= xsize || rect.y0() >= ysize || rect.xsize() == 0 ||
+      rect.ysize() == 0) {
+    return PIK_FAILURE("Empty crop rect.");
+  }
+  // Clamped to the image.
+  const Rect pixel_rect(rect.x0(), rect.y0(), rect.xsize(), rect.ysize(),
+                        xsize, ysize);
+  if (pixel_rect.x0() % group_size != 0 ||
+      pixel_rect.y0() % group_size != 0 ||
+      (pixel_rect.x0() + pixel_rect.xsize() != xsize &&
+       pixel_rect.xsize() % group_size != 0) ||
+      (pixel_rect.y0() + pixel_rect.ysize() != ysize &&
+       pixel_rect.ysize() % group_size != 0)) {
+    return PIK_FAILURE("Crop rect is not aligned to groups.");
+  }
+  if (pixel_rect.xsize() == xsize && pixel_rect.ysize() == ysize) {
+    cropped->resize(compressed.size());
+    memcpy(cropped->data(), compressed.data(), compressed.size());
+    return true;
+  }
+
+  LazySections lazy;
+  if (!lazy.Load(compressed.data(), compressed.size(), &reader)) return false;
+  reader.JumpToByteBoundary();
+  if (reader.Position() > compressed.size()) {
+    return PIK_FAILURE("Truncated sections.");
+  }
+  Sections sections;
+  if (!lazy.Materialize(~0u, &sections)) return false;
+  // Alpha covers the entire image (and is lossless), so it is decoded,
+  // cropped and re-encoded. Constant alpha does not depend on the size.
+  if (sections.alpha != nullptr &&
+      sections.alpha->mode != Alpha::kModeConstant) {
+    ImageU alpha(xsize, ysize);
+    if (!PikToAlpha(DecompressParams(), *sections.alpha, pool, &alpha)) {
+      return false;
+    }
+    const int bit_depth = sections.alpha->bytes_per_alpha * 8;
+    if (!AlphaToPik(CompressParams(), CopyImage(pixel_rect, alpha), bit_depth,
+                    pool, &sections.alpha)) {
+      return false;
+    }
+  }
+
+  Header cropped_header = header;
+  cropped_header.xsize = pixel_rect.xsize();
+  cropped_header.ysize = pixel_rect.ysize();
+  if (!StoreHeaderAndSections(cropped_header, sections, cropped, nullptr)) {
+    return false;
+  }
+  const Rect region(pixel_rect.x0() / kBlockWidth,
+                    pixel_rect.y0() / kBlockHeight,
+                    DivCeil(pixel_rect.xsize(), kBlockWidth),
+                    DivCeil(pixel_rect.ysize(), kBlockHeight));
+  return CropBitstream(header, compressed, &reader,
+                       DivCeil(xsize, kBlockWidth),
+                       DivCeil(ysize, kBlockHeight), region, pool, cropped);
+}
+
+bool PikOrient(const CompressParams& params, const PaddedBytes& compressed,
+               const Orientation orientation, ThreadPool* pool,
+               PaddedBytes* out) {
+  PROFILER_FUNC;
+  if (compressed.size() < 4) return PIK_FAILURE("Too small for a PIK header.");
+  BitReader reader(compressed.data(), compressed.size());
+  Header header;
+  if (!LoadHeader(&reader, &header)) return false;
+  if (header.bitstream != Header::kBitstreamDefault) {
+    return PIK_FAILURE("Orienting requires the default bitstream");
+  }
+  if (!ValidateHeaderFields(header, DecompressParams())) return false;
+  if (header.flags & Header::kGradientMap) {
+    return PIK_FAILURE("Orienting does not support the gradient map");
+  }
+  if (!IsValidOrientation(static_cast<uint32_t>(orientation))) {
+    return PIK_FAILURE("Invalid orientation.");
+  }
+  if (orientation == Orientation::kIdentity) {
+    out->resize(compressed.size());
+    memcpy(out->data(), compressed.data(), compressed.size());
+    return true;
+  }
+
+  const size_t xsize = header.xsize;
+  const size_t ysize = header.ysize;
+  const OrientationSteps steps(orientation);
+  // Mirroring a partial block would move its padding into the image.
+  const size_t oriented_xsize = steps.transpose ? ysize : xsize;
+  const size_t oriented_ysize = steps.transpose ? xsize : ysize;
+  if ((steps.flip_x && oriented_xsize % kBlockWidth != 0) ||
+      (steps.flip_y && oriented_ysize % kBlockHeight != 0)) {
+    return PIK_FAILURE("Mirrored dimension is not a multiple of 8.");
+  }
+
+  LazySections lazy;
+  if (!lazy.Load(compressed.data(), compressed.size(), &reader)) return false;
+  reader.JumpToByteBoundary();
+  if (reader.Position() > compressed.size()) {
+    return PIK_FAILURE("Truncated sections.");
+  }
+  Sections sections;
+  if (!lazy.Materialize(~0u, &sections)) return false;
+  if (sections.alpha != nullptr &&
+      sections.alpha->mode != Alpha::kModeConstant) {
+    ImageU alpha(xsize, ysize);
+    if (!PikToAlpha(DecompressParams(), *sections.alpha, pool, &alpha)) {
+      return false;
+    }
+    const int bit_depth = sections.alpha->bytes_per_alpha * 8;
+    if (!AlphaToPik(params, OrientedImage(orientation, alpha), bit_depth,
+                    pool, &sections.alpha)) {
+      return false;
+    }
+  }
+
+  const size_t xsize_blocks = DivCeil(xsize, kBlockWidth);
+  const size_t ysize_blocks = DivCeil(ysize, kBlockHeight);
+  // Dimensions are only used by Quantizer::SetQuantField, hence oriented.
+  Quantizer quantizer(header.quant_template,
+                      steps.transpose ? ysize_blocks : xsize_blocks,
+                      steps.transpose ? xsize_blocks : ysize_blocks);
+  NoiseParams noise_params;
+  ColorTransform ctan(xsize, ysize);
+  DecCache cache;
+  cache.eager_dequant = false;
+  if (!DecodeFromBitstream(header, compressed, &reader, xsize_blocks,
+                           ysize_blocks, pool, &ctan, &noise_params,
+                           &quantizer, &cache)) {
+    return PIK_FAILURE("Pik decoding failed.");
+  }
+  QuantizedCoeffs qcoeffs;
+  qcoeffs.dc = std::move(cache.quantized_dc);
+  qcoeffs.ac = std::move(cache.quantized_ac);
+  OrientCoefficients(orientation, (header.flags & Header::kGrayscale) != 0,
+                     pool, &qcoeffs, &quantizer, &ctan);
+
+  Header oriented_header = header;
+  oriented_header.xsize = oriented_xsize;
+  oriented_header.ysize = oriented_ysize;
+  if (!StoreHeaderAndSections(oriented_header, sections, out, nullptr)) {
+    return false;
+  }
+  AppendBytes(EncodeToBitstream(qcoeffs, oriented_header, quantizer,
+                                noise_params, ctan, params.fast_mode, pool),
+              out);
+  return true;
+}
+
+bool PikToJpeg(const DecompressParams& params, const PaddedBytes& compressed,
+               ThreadPool* pool, const guetzli::JPEGOutput& out) {
+  PROFILER_ZONE("PikToJpeg uninstrumented");
+  if (compressed.size() < 4) return PIK_FAILURE("Too small for a PIK header.");
+  BitReader reader(compressed.data(), compressed.size());
+  Header header;
+  if (!LoadHeader(&reader, &header)) return false;
+  if (header.bitstream != Header::kBitstreamBrunsli) {
+    return PIK_FAILURE("Only Brunsli bitstreams contain a JPEG");
+  }
+  reader.JumpToByteBoundary();
+  const size_t pos = reader.Position();
+  if (pos > compressed.size()) return PIK_FAILURE("Truncated header.");
+  const uint8_t* data = compressed.data() + pos;
+  const size_t size = compressed.size() - pos;
+
+  guetzli::JPEGData jpg;
+  if (!BrunsliV2DecodeHeader(data, size, &jpg)) return false;
+  if (static_cast<uint64_t>(jpg.width) * jpg.height > params.max_num_pixels) {
+    return PIK_FAILURE("Image too big.");
+  }
+  jpg = guetzli::JPEGData();
+  if (!BrunsliV2DecodeJpegData(data, size, pool, &jpg)) {
+    return PIK_FAILURE("Brunsli v2 decoding error");
+  }
+
+  // Brunsli v2 does not store table indices nor component ids; use the
+  // JFIF conventions.
+  for (size_t i = 0; i < jpg.quant.size(); ++i) {
+    guetzli::JPEGQuantTable* q = &jpg.quant[i];
+    q->index = i;
+    q->precision = *std::max_element(q->values.begin(), q->values.end()) > 255;
+  }
+  for (size_t i = 0; i < jpg.components.size(); ++i) {
+    jpg.components[i].id = i + 1;
+  }
+  if (params.jpeg_restart_interval > 0xFFFF) {
+    return PIK_FAILURE("Restart interval too large.");
+  }
+  jpg.restart_interval = params.jpeg_restart_interval;
+  // Nor metadata, hence only the JFIF APP0 marker is written.
+  if (!guetzli::WriteJpeg(jpg, /*strip_metadata=*/true, pool, out)) {
+    return PIK_FAILURE("Failed to write JPEG");
+  }
+  return true;
+}
+
+// Returns the setting of an optional decoder stage: "stage" unless it is
+// kDefault and params.fast_preview requests skipping all optional stages.
+Override StageOverride(const DecompressParams& params, const Override stage) {
+  if (stage == Override::kDefault && params.fast_preview) return Override::kOff;
+  return stage;
+}
+
+// Finishes a 1:"scale" decode after DecodeFromBitstream: a preview from DC
+// only (dc_only), or a downscaled image from all coefficients. Skips denoising,
+// noise and dithering because they only matter at full resolution.
+template <typename T>
+void DownscaledToPixels(const Header& header, const size_t scale,
+                        const SampleEncoding encoding,
+                        const ColorPrimaries primaries, ThreadPool* pool,
+                        DecCache* dec_cache, const ImageU& alpha,
+                        const int alpha_bit_depth, MetaImage<T>* image,
+                        PikInfo* aux_out) {
+  const size_t xsize = DivCeil<size_t>(header.xsize, scale);
+  const size_t ysize = DivCeil<size_t>(header.ysize, scale);
+  Image3F opsin;
+  {
+    PikStageTimer timer(aux_out, kStageRecon);
+    opsin = dec_cache->dc_only
+                ? ReconOpsinPreview(header, scale, pool, dec_cache)
+                : ReconOpsinDownscaled(header, scale, pool, dec_cache);
+  }
+  Image3<T> srgb;
+  {
+    PikStageTimer timer(aux_out, kStageColor);
+    CenteredOpsinToSrgb(opsin, /*dither=*/false, pool, &srgb, encoding,
+                        primaries);
+  }
+  srgb.ShrinkTo(xsize, ysize);
+  image->SetColor(std::move(srgb));
+  // Must happen after SetColor.
+  if (alpha_bit_depth != 0) {
+    // Point-sampled; (partially) transparent previews are rare.
+    ImageU alpha_preview(xsize, ysize);
+    for (size_t y = 0; y < ysize; ++y) {
+      const uint16_t* PIK_RESTRICT row_in = alpha.ConstRow(y * scale);
+      uint16_t* PIK_RESTRICT row_out = alpha_preview.Row(y);
+      for (size_t x = 0; x < xsize; ++x) {
+        row_out[x] = row_in[x * scale];
+      }
+    }
+    image->SetAlpha(std::move(alpha_preview), alpha_bit_depth);
+  }
+}
+
+// Passes "srgb" to "sink" one group row at a time. Used for the paths that
+// cannot stream because a later stage sees the whole image.
+template <typename T>
+void EmitGroupRows(const ImageRowsSink<T>& sink, const Image3<T>& srgb) {
+  constexpr size_t kGroupHeight = kGroupHeightInBlocks * kBlockHeight;
+  for (size_t y0 = 0; y0 < srgb.ysize(); y0 += kGroupHeight) {
+    sink.Emit(srgb, y0, srgb.xsize(),
+              std::min(kGroupHeight, srgb.ysize() - y0));
+  }
+}
+
+// State of the sink that interleaves group rows into the caller's buffer.
+struct InterleavingSinkState {
+  const InterleavedImageView* out;
+  const ImageU* alpha;  // Null if opaque.
+  int alpha_bits;
+};
+
+void InterleaveGroupRows(void* opaque, const size_t y0, const size_t xsize,
+                         const size_t ysize,
+                         const ConstImageView<uint8_t>* planes) {
+  const InterleavingSinkState* state =
+      static_cast<const InterleavingSinkState*>(opaque);
+  for (size_t y = 0; y < ysize; ++y) {
+    const uint16_t* row_alpha =
+        state->alpha == nullptr ? nullptr : state->alpha->ConstRow(y0 + y);
+    InterleaveRow(planes[0].ConstRow(y), planes[1].ConstRow(y),
+                  planes[2].ConstRow(y), row_alpha, state->alpha_bits, xsize,
+                  y0 + y, *state->out);
+  }
+}
+
+// Only 8-bit pixels can be interleaved; PikToPixelsT is nevertheless compiled
+// for all T, hence the unused generic version.
+template <typename T>
+ImageRowsSink<T> InterleavingSink(InterleavingSinkState* state) {
+  return ImageRowsSink<T>{nullptr, nullptr};
+}
+template <>
+ImageRowsSink<uint8_t> InterleavingSink(InterleavingSinkState* state) {
+  return ImageRowsSink<uint8_t>{&InterleaveGroupRows, state};
+}
+
+// Returns "header" without the flags of stages that "params" skip, so that
+// only the reconstruction sees the per-stage overrides.
+Header ReconHeader(const DecompressParams& params, const Header& header) {
+  Header recon_header = header;
+  if (StageOverride(params, params.gaborish) == Override::kOff) {
+    recon_header.flags &= ~Header::kGaborishTransform;
+  }
+  return recon_header;
+}
+
+// Returns whether the decoder applies the optional stages, i.e. those enabled
+// by the encoder (via "header" or "noise_params") unless "params" overrides.
+bool EnableDenoise(const DecompressParams& params, const Header& header) {
+  const Override denoise = StageOverride(params, params.denoise);
+  if (denoise != Override::kDefault) return denoise == Override::kOn;
+  return (header.flags & Header::kDenoise) != 0;
+}
+
+bool EnableNoise(const DecompressParams& params,
+                 const NoiseParams& noise_params) {
+  return (noise_params.alpha != 0.0f || noise_params.beta != 0.0f ||
+          noise_params.gamma != 0.0f) &&
+         StageOverride(params, params.noise) != Override::kOff;
+}
+
+bool EnableDither(const DecompressParams& params, const Header& header) {
+  const Override dither = StageOverride(params, params.dither);
+  if (dither != Override::kDefault) return dither == Override::kOn;
+  return (header.flags & Header::kDither) != 0;
+}
+
+// Reconstructs the pixels from the coefficients in "dec_cache" (as decoded by
+// DecodeFromBitstream or GroupDecoder) into "srgb", the "sink" or, if
+// non-null, "interleaved" (which then also receives the alpha), applying the
+// optional stages as requested by "params". If non-null, "composite" is
+// applied during the color conversion. If "yuv" is non-null, it instead
+// receives the pixels.
+template <typename T>
+void CoefficientsToPixels(const DecompressParams& params, const Header& header,
+                          const Quantizer& quantizer,
+                          const ColorTransform& ctan,
+                          const NoiseParams& noise_params, ThreadPool* pool,
+                          DecCache* dec_cache, const ImageU* alpha_or_null,
+                          const int alpha_bits, const ImageRowsSink<T>* sink,
+                          const InterleavedImageView* interleaved,
+                          const AlphaComposite* composite,
+                          const YUV420ImageView* yuv, Image3<T>* srgb,
+                          PikInfo* aux_out) {
+  const bool enable_denoise = EnableDenoise(params, header);
+  const bool add_noise = EnableNoise(params, noise_params);
+  const bool dither = EnableDither(params, header);
+  InterleavingSinkState interleaving_state = {interleaved, alpha_or_null,
+                                              alpha_bits};
+  const ImageRowsSink<T> interleaving_sink =
+      InterleavingSink<T>(&interleaving_state);
+  if (interleaved != nullptr) sink = &interleaving_sink;
+  const Header recon_header = ReconHeader(params, header);
+  // YUV is converted from opsin (in row pairs) rather than in tiles.
+  if (!enable_denoise && !add_noise && yuv == nullptr) {
+    // Nothing operates on opsin, so reconstruct directly into srgb tiles.
+    // The sink receives each group row as soon as its tiles are done.
+    PikStageTimer timer(aux_out, kStageRecon);
+    ReconSrgbImage(recon_header, quantizer, ctan, dither, pool, dec_cache,
+                   srgb, sink, params.encoding, params.primaries, composite);
+  } else {
+    Image3F opsin;
+    {
+      PikStageTimer timer(aux_out, kStageRecon);
+      opsin = ReconOpsinImage(recon_header, quantizer, ctan, pool, dec_cache,
+                              aux_out);
+    }
+    if (enable_denoise) {
+      PROFILER_ZONE("denoise");
+      PikStageTimer timer(aux_out, kStageDenoise);
+      DoDenoise(quantizer, pool, &opsin);
+      if (header.flags & Header::kGrayscale) {
+        // The filter is per plane; restore neutral gray.
+        for (size_t y = 0; y < opsin.ysize(); ++y) {
+          GrayXybFromY(opsin.ConstPlaneRow(1, y), opsin.xsize(),
+                       opsin.PlaneRow(0, y), opsin.PlaneRow(2, y));
+        }
+      }
+    }
+    if (add_noise) {
+      PROFILER_ZONE("add_noise");
+      PikStageTimer timer(aux_out, kStageNoise);
+      AddNoise(noise_params, pool, &opsin);
+    }
+    if (yuv != nullptr) {
+      PikStageTimer timer(aux_out, kStageColor);
+      YUV420FromCenteredOpsin(opsin, pool, *yuv);
+    } else if (interleaved != nullptr) {
+      PikStageTimer timer(aux_out, kStageColor);
+      CenteredOpsinToInterleavedSrgb(opsin, dither, alpha_or_null, alpha_bits,
+                                     pool, *interleaved, composite,
+                                     params.primaries);
+    } else {
+      {
+        PikStageTimer timer(aux_out, kStageColor);
+        CenteredOpsinToSrgb(opsin, dither, pool, srgb, params.encoding,
+                            params.primaries, composite);
+      }
+      if (sink != nullptr) {
+        srgb->ShrinkTo(header.xsize, header.ysize);
+        EmitGroupRows(*sink, *srgb);
+      }
+    }
+  }
+}
+
+// Returns whether MetaImage<T> can represent samples with params.encoding and
+// params.alpha_output.
+template <typename T>
+bool IsSupportedOutput(const DecompressParams& params) {
+  if (params.alpha_output != AlphaOutput::kSeparate && sizeof(T) != 1) {
+    return PIK_FAILURE("Alpha compositing requires 8-bit output");
+  }
+  const SampleEncoding encoding = params.encoding;
+  if (encoding != SampleEncoding::kSRGB) {
+    if (sizeof(T) == 1) {
+      return PIK_FAILURE("8-bit output must be sRGB");
+    }
+    if (encoding == SampleEncoding::kLinearHalf && sizeof(T) != 2) {
+      return PIK_FAILURE("Half-float output requires 16-bit samples");
+    }
+  }
+  return true;
+}
+
+// Returns the background for AlphaComposite (0 = premultiplied).
+uint8_t CompositeBackground(const DecompressParams& params) {
+  return params.alpha_output == AlphaOutput::kBlend ? params.background : 0;
+}
+
+// Applies params.alpha_output to an already converted 8-bit "image", for the
+// outputs whose color conversion is not fused with the compositing
+// (previews, downscaling, lossless and incremental decoding).
+template <typename T>
+void CompositeAlpha(const DecompressParams& params, ThreadPool* pool,
+                    MetaImage<T>* image) {
+  if (params.alpha_output == AlphaOutput::kSeparate || !image->HasAlpha()) {
+    return;
+  }
+  PIK_CHECK(sizeof(T) == 1);
+  PROFILER_FUNC;
+  const float background = CompositeBackground(params);
+  const float mul_alpha = 1.0f / ((1u << image->AlphaBitDepth()) - 1);
+  const ImageU& alpha = image->GetAlpha();
+  Image3<T>& color = image->GetColor();
+  pool->Run(0, color.ysize(), [&](const int task, const int thread) {
+    const size_t y = task;
+    const uint16_t* PIK_RESTRICT row_alpha = alpha.ConstRow(y);
+    for (int c = 0; c < 3; ++c) {
+      T* PIK_RESTRICT row = color.PlaneRow(c, y);
+      for (size_t x = 0; x < color.xsize(); ++x) {
+        const float a = row_alpha[x] * mul_alpha;
+        row[x] = static_cast<T>(background + (row[x] - background) * a + 0.5f);
+      }
+    }
+  });
+  if (params.alpha_output == AlphaOutput::kBlend) {
+    MetaImage<T> color_only;
+    color_only.SetColor(std::move(color));
+    *image = std::move(color_only);
+  }
+}
+
+// Decodes the entire image if "rect" [pixels] is null, otherwise only the
+// groups required to reconstruct the pixels within it. "dec_cache" is either
+// null or reused across calls to avoid reallocating its buffers. If "sink" is
+// non-null, it receives the color rows of "image" in top to bottom order.
+// If "interleaved" is non-null (only for T = uint8_t and without rect), the
+// pixels and alpha are written there instead of "image", except for the
+// Brunsli, lossless, preview and downscaled paths, which leave that to the
+// caller. The same applies to "yuv" (without alpha).
 template <typename T>
 bool PikToPixelsT(const DecompressParams& params, const PaddedBytes& compressed,
-                  ThreadPool* pool, MetaImage<T>* image, PikInfo* aux_out) {
+                  const Rect* rect, ThreadPool* pool, DecCache* dec_cache,
+                  MetaImage<T>* image, PikInfo* aux_out,
+                  const ImageRowsSink<T>* sink = nullptr,
+                  const InterleavedImageView* interleaved = nullptr,
+                  const YUV420ImageView* yuv = nullptr) {
   PROFILER_ZONE("PikToPixels uninstrumented");
+  AllocationPool::Scope pool_scope;
 
   Decoder decoder(compressed.data(), compressed.size());
   if (!decoder.ReadHeader()) return false;
   const Header& header = decoder.GetHeader();
+  if (!IsSupportedOutput<T>(params)) return false;
   if (header.bitstream == Header::kBitstreamBrunsli) {
     // TODO(janwas): prepend sections, ValidateHeader, avoid padding
     decoder.GetReader().JumpToByteBoundary();
-    return BrunsliToPixels(compressed, decoder.GetReader().Position(), image);
+    if (rect != nullptr) {
+      return PIK_FAILURE("Brunsli does not support region decoding");
+    }
+    if (params.downscale != 1) {
+      return PIK_FAILURE("Brunsli does not support downscaling");
+    }
+    if (params.encoding != SampleEncoding::kSRGB ||
+        params.primaries != ColorPrimaries::kSRGB) {
+      return PIK_FAILURE("Brunsli only supports sRGB output");
+    }
+    if (!BrunsliToPixels(compressed, decoder.GetReader().Position(), pool,
+                         image)) {
+      return false;
+    }
+    if (sink != nullptr) EmitGroupRows(*sink, image->GetColor());
+    return true;
+  }
+  if (header.bitstream == Header::kBitstreamLossless) {
+    if (!ValidateHeaderFields(header, params)) return false;
+    if (header.flags & Header::kKeepUnchangedGroups) {
+      return PIK_FAILURE("Frame requires PikFrameToPixels");
+    }
+    if (!decoder.ReadSections(1U << Sections::kIndexPalette)) return false;
+    if (rect != nullptr) {
+      return PIK_FAILURE("Lossless does not support region decoding");
+    }
+    if (params.downscale != 1 || params.dc_preview != 0) {
+      return PIK_FAILURE("Lossless does not support downscaling");
+    }
+    if (params.encoding != SampleEncoding::kSRGB ||
+        params.primaries != ColorPrimaries::kSRGB) {
+      return PIK_FAILURE("Lossless only supports sRGB output");
+    }
+    {
+      PikStageTimer timer(aux_out, kStageDecode);
+      if (!LosslessToMetaImage(header, decoder.GetSections(), compressed,
+                               decoder.GetReader().Position(), pool, image)) {
+        return false;
+      }
+    }
+    if (params.drop_opaque_alpha && image->HasAlpha() &&
+        IsOpaque(image->GetAlpha(), image->AlphaBitDepth())) {
+      MetaImage<T> color_only;
+      color_only.SetColor(std::move(image->GetColor()));
+      *image = std::move(color_only);
+    }
+    CompositeAlpha(params, pool, image);
+    if (sink != nullptr) EmitGroupRows(*sink, image->GetColor());
+    return true;
   }
   if (header.bitstream != Header::kBitstreamDefault) {
     return PIK_FAILURE("Unsupported bitstream");
@@ -1146,7 +3441,8 @@ bool PikToPixelsT(const DecompressParams& params, const PaddedBytes& compressed,
   // (Only valid for kBitstreamDefault!)
   if (!ValidateHeaderFields(header, params)) return false;
 
-  if (!decoder.ReadSections()) return false;
+  // Pixels only depend on alpha; skip over (and do not copy) the metadata.
+  if (!decoder.ReadSections(1U << Sections::kIndexAlpha)) return false;
   const Sections& sections = decoder.GetSections();
 
   const size_t xsize = header.xsize;
@@ -1154,48 +3450,216 @@ bool PikToPixelsT(const DecompressParams& params, const PaddedBytes& compressed,
   const size_t xsize_blocks = DivCeil(xsize, kBlockWidth);
   const size_t ysize_blocks = DivCeil(ysize, kBlockHeight);
 
-  ImageU alpha;
-  if (sections.alpha != nullptr) {
-    alpha = ImageU(xsize, ysize);
-    if (!PikToAlpha(params, *sections.alpha.get(), &alpha)) return false;
+  if (rect != nullptr &&
+      (rect->x0() >= xsize || rect->y0() >= ysize || rect->xsize() == 0 ||
+       rect->ysize() == 0)) {
+    return PIK_FAILURE("Empty decode rect.");
+  }
+  const size_t preview = params.dc_preview;
+  if (preview != 0 && preview != 2 && preview != 4 && preview != 8) {
+    return PIK_FAILURE("Invalid preview downsampling.");
+  }
+  if (preview != 0 && rect != nullptr) {
+    return PIK_FAILURE("Previews do not support region decoding.");
+  }
+  const size_t downscale = params.downscale;
+  if (downscale >= 4 && preview == 0 &&
+      decoder.GetLazySections().Has(Sections::kIndexPyramid)) {
+    // Only decodes the largest level whose factor does not exceed downscale,
+    // downscaling it further if needed.
+    Sections pyramid_sections;
+    if (!decoder.GetLazySections().Materialize(1U << Sections::kIndexPyramid,
+                                               &pyramid_sections)) {
+      return false;
+    }
+    const Pyramid& pyramid = *pyramid_sections.pyramid;
+    size_t level = 0;
+    size_t factor = 4;
+    while (level + 1 < pyramid.num_levels && factor * 4 <= downscale) {
+      ++level;
+      factor *= 4;
+    }
+    if (downscale % factor != 0) {
+      return PIK_FAILURE("Invalid downscale factor.");
+    }
+    const std::vector<uint8_t>& level_bytes = pyramid.levels[level];
+    if (level_bytes.empty()) return PIK_FAILURE("Empty pyramid level.");
+    PaddedBytes level_compressed(level_bytes.size());
+    memcpy(level_compressed.data(), level_bytes.data(), level_bytes.size());
+    DecompressParams level_params = params;
+    level_params.downscale = downscale / factor;
+    return PikToPixelsT(level_params, level_compressed, rect, pool, dec_cache,
+                        image, aux_out, sink, interleaved, yuv);
   }
+  if (downscale != 1 && downscale != 2 && downscale != 4) {
+    return PIK_FAILURE("Invalid downscale factor.");
+  }
+  if (downscale != 1 && (preview != 0 || rect != nullptr)) {
+    return PIK_FAILURE("Downscaling does not support previews or regions.");
+  }
+  const size_t scale = preview != 0 ? preview : downscale;
+  if (sink != nullptr && rect != nullptr) {
+    return PIK_FAILURE("Region decoding does not support row sinks.");
+  }
+  const Rect image_rect(0, 0, xsize, ysize);
+  // Clamped to the image.
+  const Rect pixel_rect =
+      rect == nullptr ? image_rect
+                      : Rect(rect->x0(), rect->y0(), rect->xsize(),
+                             rect->ysize(), xsize, ysize);
+  const Rect region =
+      RegionForRect(header, pixel_rect, xsize_blocks, ysize_blocks);
 
+  const Alpha* alpha_section = sections.alpha.get();
+  if (alpha_section != nullptr && params.drop_opaque_alpha &&
+      IsOpaqueAlpha(*alpha_section)) {
+    alpha_section = nullptr;
+  }
+  if (yuv != nullptr && scale == 1) {
+    if (yuv->xsize != xsize || yuv->ysize != ysize) {
+      return PIK_FAILURE("YUV output size mismatch.");
+    }
+    alpha_section = nullptr;  // YUV has no alpha channel.
+  }
+  if (interleaved != nullptr && scale == 1) {
+    if (interleaved->xsize != xsize || interleaved->ysize != ysize) {
+      return PIK_FAILURE("Interleaved output size mismatch.");
+    }
+    if (alpha_section != nullptr &&
+        params.alpha_output != AlphaOutput::kBlend &&
+        interleaved->layout == PixelLayout::kRGB) {
+      return PIK_FAILURE("Unable to output alpha channel");
+    }
+  }
   Quantizer quantizer(header.quant_template, xsize_blocks, ysize_blocks);
   NoiseParams noise_params;
   ColorTransform ctan(header.xsize, header.ysize);
-  DecCache dec_cache;
-  dec_cache.eager_dequant = true;
-  {
-    PROFILER_ZONE("dec_bitstr");
-    if (!DecodeFromBitstream(header, compressed, &decoder.GetReader(),
-                             xsize_blocks, ysize_blocks, pool, &ctan,
-                             &noise_params, &quantizer, &dec_cache)) {
-      return PIK_FAILURE("Pik decoding failed.");
+  DecCache local_cache;
+  if (dec_cache == nullptr) dec_cache = &local_cache;
+  dec_cache->eager_dequant = true;
+  dec_cache->dc_only = preview != 0;
+  dec_cache->flat_dc =
+      StageOverride(params, params.smooth_dc) == Override::kOff;
+  dec_cache->compact_ac = params.compact_coefficients;
+  dec_cache->cancel = params.cancel;
+
+  // Alpha only depends on its section, so it is decoded concurrently with the
+  // color groups instead of adding its (mostly serial Brotli) latency. Each
+  // task parallelizes its own work via nested Run.
+  ImageU alpha;
+  if (alpha_section != nullptr) alpha = ImageU(xsize, ysize);
+  bool color_ok = true;
+  bool alpha_ok = true;
+  pool->Run(0, alpha_section != nullptr ? 2 : 1,
+            [&](const int task, const int thread) {
+              if (task == 1) {
+                PROFILER_ZONE("dec_alpha");
+                alpha_ok = PikToAlpha(params, *alpha_section, pool, &alpha);
+                return;
+              }
+              PROFILER_ZONE("dec_bitstr");
+              PikStageTimer timer(aux_out, kStageDecode);
+              color_ok = DecodeFromBitstream(
+                  header, compressed, &decoder.GetReader(), xsize_blocks,
+                  ysize_blocks, pool, &ctan, &noise_params, &quantizer,
+                  dec_cache, rect == nullptr ? nullptr : &region);
+            });
+  if (!alpha_ok) return false;
+  if (!color_ok) return PIK_FAILURE("Pik decoding failed.");
+  if (scale != 1) {
+    const int alpha_bit_depth =
+        alpha_section != nullptr ? alpha_section->bytes_per_alpha * 8 : 0;
+    DownscaledToPixels(ReconHeader(params, header), scale, params.encoding,
+                       params.primaries, pool, dec_cache, alpha,
+                       alpha_bit_depth, image, aux_out);
+    CompositeAlpha(params, pool, image);
+    if (sink != nullptr) EmitGroupRows(*sink, image->GetColor());
+    // Previews skip the AC groups, hence no check_decompressed_size.
+    if (preview == 0 && params.check_decompressed_size &&
+        decoder.GetReader().Position() != compressed.size()) {
+      return PIK_FAILURE("Pik compressed data size mismatch.");
+    }
+    if (aux_out != nullptr) {
+      aux_out->decoded_size = decoder.GetReader().Position();
     }
+    return true;
   }
-  Image3F opsin =
-      ReconOpsinImage(header, quantizer, ctan, pool, &dec_cache, aux_out);
-
-  bool enable_denoise = (header.flags & Header::kDenoise) != 0;
-  if (params.denoise != Override::kDefault) {
-    enable_denoise = params.denoise == Override::kOn;
+  const int alpha_bits =
+      alpha_section != nullptr ? alpha_section->bytes_per_alpha * 8 : 0;
+  // The color conversion composites whole blocks of the decoded region, so
+  // it receives a (zero-padded) copy of alpha starting at the region origin.
+  const bool composite_alpha = alpha_section != nullptr &&
+                               params.alpha_output != AlphaOutput::kSeparate;
+  ImageU region_alpha;
+  AlphaComposite composite = {&region_alpha, alpha_bits,
+                              CompositeBackground(params)};
+  if (composite_alpha) {
+    region_alpha = ImageU(region.xsize() * kBlockWidth,
+                          region.ysize() * kBlockHeight);
+    FillImage(static_cast<uint16_t>(0), &region_alpha);
+    const Rect alpha_rect(region.x0() * kBlockWidth,
+                          region.y0() * kBlockHeight, region_alpha.xsize(),
+                          region_alpha.ysize(), xsize, ysize);
+    for (size_t y = 0; y < alpha_rect.ysize(); ++y) {
+      memcpy(region_alpha.Row(y), alpha_rect.ConstRow(alpha, y),
+             alpha_rect.xsize() * sizeof(uint16_t));
+    }
   }
-  if (enable_denoise) {
-    PROFILER_ZONE("denoise");
-    DoDenoise(quantizer, &opsin);
+  // Blending removes the alpha channel from the output.
+  const bool output_alpha =
+      alpha_section != nullptr && params.alpha_output != AlphaOutput::kBlend;
+  if (alpha_section != nullptr && rect != nullptr) {
+    alpha = CopyImage(pixel_rect, alpha);
   }
-  {
-    PROFILER_ZONE("add_noise");
-    AddNoise(noise_params, &opsin);
+  const ImageU* alpha_or_null = output_alpha ? &alpha : nullptr;
+  if (params.recon_hook != nullptr && rect == nullptr && sink == nullptr &&
+      interleaved == nullptr && yuv == nullptr && alpha_section == nullptr &&
+      !EnableDenoise(params, header) && !EnableNoise(params, noise_params)) {
+    Header recon_header = ReconHeader(params, header);
+    if (EnableDither(params, header)) {
+      recon_header.flags |= Header::kDither;
+    } else {
+      recon_header.flags &= ~Header::kDither;
+    }
+    bool reconstructed;
+    {
+      PikStageTimer timer(aux_out, kStageRecon);
+      reconstructed = params.recon_hook->func(params.recon_hook->opaque,
+                                              recon_header, params,
+                                              *dec_cache);
+    }
+    if (reconstructed) {
+      if (params.check_decompressed_size &&
+          decoder.GetReader().Position() != compressed.size()) {
+        return PIK_FAILURE("Pik compressed data size mismatch.");
+      }
+      if (aux_out != nullptr) {
+        aux_out->decoded_size = decoder.GetReader().Position();
+      }
+      return true;
+    }
   }
-  const bool dither = (header.flags & Header::kDither) != 0;
   Image3<T> srgb;
-  CenteredOpsinToSrgb(opsin, dither, pool, &srgb);
-  srgb.ShrinkTo(header.xsize, header.ysize);
-  image->SetColor(std::move(srgb));
-  // Must happen after SetColor.
-  if (sections.alpha != nullptr) {
-    image->SetAlpha(std::move(alpha), sections.alpha->bytes_per_alpha * 8);
+  CoefficientsToPixels(params, header, quantizer, ctan, noise_params, pool,
+                       dec_cache, alpha_or_null, alpha_bits, sink, interleaved,
+                       composite_alpha ? &composite : nullptr, yuv, &srgb,
+                       aux_out);
+  // Otherwise, the pixels were already written and "image" remains empty.
+  if (interleaved == nullptr && yuv == nullptr) {
+    if (rect == nullptr) {
+      srgb.ShrinkTo(header.xsize, header.ysize);
+    } else {
+      // srgb starts at the region origin.
+      srgb = CopyImage(Rect(pixel_rect.x0() - region.x0() * kBlockWidth,
+                            pixel_rect.y0() - region.y0() * kBlockHeight,
+                            pixel_rect.xsize(), pixel_rect.ysize()),
+                       srgb);
+    }
+    image->SetColor(std::move(srgb));
+    // Must happen after SetColor.
+    if (output_alpha) {
+      image->SetAlpha(std::move(alpha), alpha_bits);
+    }
   }
 
   if (params.check_decompressed_size &&
@@ -1210,25 +3674,33 @@ bool PikToPixelsT(const DecompressParams& params, const PaddedBytes& compressed,
 
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, MetaImageB* image, PikInfo* aux_out) {
-  return PikToPixelsT(params, compressed, pool, image, aux_out);
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out);
 }
 
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, MetaImageU* image, PikInfo* aux_out) {
-  return PikToPixelsT(params, compressed, pool, image, aux_out);
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out);
 }
 
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, MetaImageF* image, PikInfo* aux_out) {
-  return PikToPixelsT(params, compressed, pool, image, aux_out);
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out);
 }
 
 template <typename T>
 bool PikToPixelsT(const DecompressParams& params, const PaddedBytes& compressed,
-                  ThreadPool* pool, Image3<T>* image, PikInfo* aux_out) {
+                  const Rect* rect, ThreadPool* pool, DecCache* dec_cache,
+                  Image3<T>* image, PikInfo* aux_out) {
   PROFILER_ZONE("PikToPixels alpha uninstrumented");
+  // Image3 cannot represent alpha, but opaque alpha carries no information.
+  DecompressParams color_params = params;
+  color_params.drop_opaque_alpha = true;
   MetaImage<T> temp;
-  if (!PikToPixelsT(params, compressed, pool, &temp, aux_out)) {
+  if (!PikToPixelsT(color_params, compressed, rect, pool, dec_cache, &temp,
+                    aux_out)) {
     return false;
   }
   if (temp.HasAlpha()) {
@@ -1240,15 +3712,654 @@ bool PikToPixelsT(const DecompressParams& params, const PaddedBytes& compressed,
 
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, Image3B* image, PikInfo* aux_out) {
-  return PikToPixelsT(params, compressed, pool, image, aux_out);
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out);
 }
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, Image3U* image, PikInfo* aux_out) {
-  return PikToPixelsT(params, compressed, pool, image, aux_out);
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out);
 }
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, Image3F* image, PikInfo* aux_out) {
-  return PikToPixelsT(params, compressed, pool, image, aux_out);
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out);
+}
+
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const ImageRowsSink<uint8_t>& sink, ThreadPool* pool,
+                 MetaImageB* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out, &sink);
+}
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const ImageRowsSink<uint16_t>& sink, ThreadPool* pool,
+                 MetaImageU* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out, &sink);
+}
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const ImageRowsSink<float>& sink, ThreadPool* pool,
+                 MetaImageF* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, nullptr, image,
+                      aux_out, &sink);
+}
+
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 ThreadPool* pool, const InterleavedImageView& out,
+                 PikInfo* aux_out) {
+  // Opaque alpha need not be decoded; InterleaveRow fills in 255.
+  DecompressParams color_params = params;
+  color_params.drop_opaque_alpha = true;
+  MetaImageB temp;
+  if (!PikToPixelsT<uint8_t>(color_params, compressed, nullptr, pool, nullptr,
+                             &temp, aux_out, nullptr, &out)) {
+    return false;
+  }
+  // Brunsli, previews and downscaling do not write directly; interleave.
+  if (temp.xsize() == 0) return true;
+  if (temp.xsize() != out.xsize || temp.ysize() != out.ysize) {
+    return PIK_FAILURE("Interleaved output size mismatch.");
+  }
+  if (temp.HasAlpha() && out.layout == PixelLayout::kRGB) {
+    return PIK_FAILURE("Unable to output alpha channel");
+  }
+  const Image3B& color = temp.GetColor();
+  for (size_t y = 0; y < out.ysize; ++y) {
+    const uint16_t* row_alpha =
+        temp.HasAlpha() ? temp.GetAlpha().ConstRow(y) : nullptr;
+    InterleaveRow(color.ConstPlaneRow(0, y), color.ConstPlaneRow(1, y),
+                  color.ConstPlaneRow(2, y), row_alpha, temp.AlphaBitDepth(),
+                  out.xsize, y, out);
+  }
+  return true;
+}
+
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 ThreadPool* pool, const YUV420ImageView& out,
+                 PikInfo* aux_out) {
+  if (params.alpha_output != AlphaOutput::kSeparate) {
+    return PIK_FAILURE("YUV output has no alpha channel");
+  }
+  if (params.primaries != ColorPrimaries::kSRGB) {
+    return PIK_FAILURE("YUV output requires sRGB (Rec.709) primaries");
+  }
+  MetaImageB temp;
+  if (!PikToPixelsT<uint8_t>(params, compressed, nullptr, pool, nullptr, &temp,
+                             aux_out, nullptr, nullptr, &out)) {
+    return false;
+  }
+  // Brunsli, lossless, previews and downscaling do not write directly.
+  if (temp.xsize() == 0) return true;
+  if (temp.xsize() != out.xsize || temp.ysize() != out.ysize) {
+    return PIK_FAILURE("YUV output size mismatch.");
+  }
+  YUV420FromRGB8(temp.GetColor(), pool, out);
+  return true;
+}
+
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, MetaImageB* image,
+                 PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, &rect, pool, nullptr, image, aux_out);
+}
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, MetaImageU* image,
+                 PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, &rect, pool, nullptr, image, aux_out);
+}
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, MetaImageF* image,
+                 PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, &rect, pool, nullptr, image, aux_out);
+}
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, Image3B* image,
+                 PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, &rect, pool, nullptr, image, aux_out);
+}
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, Image3U* image,
+                 PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, &rect, pool, nullptr, image, aux_out);
+}
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, Image3F* image,
+                 PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, &rect, pool, nullptr, image, aux_out);
+}
+
+bool PikFrameToPixels(const DecompressParams& params,
+                      const PaddedBytes& compressed, size_t* pos,
+                      ThreadPool* pool, MetaImageB* frame, PikInfo* aux_out) {
+  PROFILER_FUNC;
+  // Also avoids reading the magic bytes past the end.
+  if (*pos > compressed.size() || compressed.size() - *pos < 4) {
+    return PIK_FAILURE("Too small for a PIK header.");
+  }
+  Decoder decoder(compressed.data() + *pos, compressed.size() - *pos);
+  if (!decoder.ReadHeader()) return false;
+  const Header& header = decoder.GetHeader();
+  if (header.bitstream != Header::kBitstreamLossless) {
+    return PIK_FAILURE("Frames require the lossless bitstream");
+  }
+  if (!ValidateHeaderFields(header, params)) return false;
+  // "frame" is also the reference for the next frame.
+  if (params.alpha_output != AlphaOutput::kSeparate) {
+    return PIK_FAILURE("Frames do not support alpha compositing");
+  }
+  if (params.primaries != ColorPrimaries::kSRGB) {
+    return PIK_FAILURE("Frames only support sRGB output");
+  }
+  if (!decoder.ReadSections(1U << Sections::kIndexPalette)) return false;
+
+  PikStageTimer timer(aux_out, kStageDecode);
+  size_t end;
+  if (!LosslessToPixels(header, decoder.GetSections(), compressed,
+                        *pos + decoder.GetReader().Position(), pool, frame,
+                        &end)) {
+    return false;
+  }
+  if (aux_out != nullptr) {
+    aux_out->decoded_size = end - *pos;
+  }
+  *pos = end;
+  return true;
+}
+
+PikDecoder::PikDecoder() : cache_(new DecCache) {}
+PikDecoder::~PikDecoder() {}
+
+bool PikDecoder::Decode(const DecompressParams& params,
+                        const PaddedBytes& compressed, ThreadPool* pool,
+                        MetaImageB* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, cache_.get(), image,
+                      aux_out);
+}
+bool PikDecoder::Decode(const DecompressParams& params,
+                        const PaddedBytes& compressed, ThreadPool* pool,
+                        MetaImageU* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, cache_.get(), image,
+                      aux_out);
+}
+bool PikDecoder::Decode(const DecompressParams& params,
+                        const PaddedBytes& compressed, ThreadPool* pool,
+                        MetaImageF* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, cache_.get(), image,
+                      aux_out);
+}
+bool PikDecoder::Decode(const DecompressParams& params,
+                        const PaddedBytes& compressed, ThreadPool* pool,
+                        Image3B* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, cache_.get(), image,
+                      aux_out);
+}
+bool PikDecoder::Decode(const DecompressParams& params,
+                        const PaddedBytes& compressed, ThreadPool* pool,
+                        Image3U* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, cache_.get(), image,
+                      aux_out);
+}
+bool PikDecoder::Decode(const DecompressParams& params,
+                        const PaddedBytes& compressed, ThreadPool* pool,
+                        Image3F* image, PikInfo* aux_out) {
+  return PikToPixelsT(params, compressed, nullptr, pool, cache_.get(), image,
+                      aux_out);
+}
+
+struct IncrementalDecoderState {
+  // Result of trying to parse fields from the bytes received so far.
+  enum class Parse { kIncomplete, kDone, kError };
+
+  // Parses everything preceding the DC groups. Called again from scratch
+  // after each Feed until it succeeds, because the end of the variable-length
+  // fields is unknown until they are parsed.
+  Parse ReadDCInfo() {
+    // A partial signature would otherwise be reported as invalid.
+    constexpr size_t kSignatureBytes = 4;
+    if (bytes.size() < kSignatureBytes) return Parse::kIncomplete;
+    Decoder decoder(bytes.data(), bytes.size());
+    BitReader* reader = &decoder.GetReader();
+    const bool header_ok = decoder.ReadHeader();
+    if (reader->Position() > bytes.size()) return Parse::kIncomplete;
+    if (!header_ok) return Parse::kError;
+    header = decoder.GetHeader();
+    if (header.bitstream != Header::kBitstreamDefault) {
+      PIK_NOTIFY_ERROR("Incremental decoding requires the default bitstream");
+      return Parse::kError;
+    }
+    if (!ValidateHeaderFields(header, params)) return Parse::kError;
+    if (!decoder.ReadSections(1U << Sections::kIndexAlpha)) {
+      return Parse::kIncomplete;
+    }
+
+    const size_t xsize_blocks = DivCeil<size_t>(header.xsize, kBlockWidth);
+    const size_t ysize_blocks = DivCeil<size_t>(header.ysize, kBlockHeight);
+    const Alpha* alpha_section = decoder.GetSections().alpha.get();
+    if (alpha_section != nullptr && params.drop_opaque_alpha &&
+        IsOpaqueAlpha(*alpha_section)) {
+      alpha_section = nullptr;
+    }
+    alpha_bits = 0;
+    if (alpha_section != nullptr) {
+      alpha = ImageU(header.xsize, header.ysize);
+      if (!PikToAlpha(params, *alpha_section, pool, &alpha)) {
+        return Parse::kError;
+      }
+      alpha_bits = alpha_section->bytes_per_alpha * 8;
+    }
+
+    quantizer.reset(
+        new Quantizer(header.quant_template, xsize_blocks, ysize_blocks));
+    ctan.reset(new ColorTransform(header.xsize, header.ysize));
+    noise_params = NoiseParams();
+    dec_cache.eager_dequant = true;
+    dec_cache.dc_only = false;
+    dec_cache.flat_dc =
+        StageOverride(params, params.smooth_dc) == Override::kOff;
+    dec_cache.compact_ac = params.compact_coefficients;
+    dec_cache.cancel = params.cancel;
+    groups = GroupDecoder();
+    if (!groups.ReadDCInfo(header, bytes, reader, xsize_blocks, ysize_blocks,
+                           pool, ctan.get(), &noise_params, quantizer.get(),
+                           &dec_cache)) {
+      return Parse::kIncomplete;
+    }
+    return Parse::kDone;
+  }
+
+  // Returns the number of groups in [first, NumTasks()) that are complete.
+  template <class GroupEnd>
+  size_t NumCompleteGroups(const size_t first, const GroupEnd& group_end) {
+    size_t end = first;
+    while (end < groups.NumTasks() && group_end(end) <= bytes.size()) ++end;
+    return end - first;
+  }
+
+  // Decodes the groups [first, first + num) in parallel.
+  template <class DecodeGroup>
+  bool DecodeGroups(const size_t first, const size_t num,
+                    const DecodeGroup& decode_group) {
+    std::atomic<int> num_errors{0};
+    // As in DecodeFromBitstream, the remaining groups are skipped once one
+    // failed or the decode was cancelled.
+    const auto failed = [this, &num_errors]() {
+      return num_errors.load(std::memory_order_relaxed) != 0 ||
+             IsCancelled(params.cancel);
+    };
+    pool->Run(first, first + num, [&](const int task, const int thread) {
+      if (failed()) return;
+      if (!decode_group(task, thread)) num_errors.fetch_add(1);
+    });
+    return !failed();
+  }
+
+  // Reconstructs "image" from the decoded groups; requires FinishAC.
+  template <typename T>
+  void ToPixels(MetaImage<T>* image, PikInfo* aux_out) {
+    if (params.downscale != 1) {
+      DownscaledToPixels(ReconHeader(params, header), params.downscale,
+                         params.encoding, params.primaries, pool, &dec_cache,
+                         alpha, alpha_bits, image, aux_out);
+    } else {
+      Image3<T> srgb;
+      CoefficientsToPixels<T>(params, header, *quantizer, *ctan, noise_params,
+                              pool, &dec_cache,
+                              alpha_bits != 0 ? &alpha : nullptr, alpha_bits,
+                              nullptr, nullptr, nullptr, nullptr, &srgb,
+                              aux_out);
+      srgb.ShrinkTo(header.xsize, header.ysize);
+      image->SetColor(std::move(srgb));
+      // Must happen after SetColor.
+      if (alpha_bits != 0) {
+        image->SetAlpha(std::move(alpha), alpha_bits);
+      }
+    }
+    CompositeAlpha(params, pool, image);
+  }
+
+  DecompressParams params;
+  ThreadPool* pool = nullptr;
+  PaddedBytes bytes;
+
+  // Valid once ReadDCInfo is kDone.
+  bool have_dc_info = false;
+  Header header;
+  ImageU alpha;
+  int alpha_bits = 0;
+  std::unique_ptr<Quantizer> quantizer;
+  std::unique_ptr<ColorTransform> ctan;
+  NoiseParams noise_params;
+  DecCache dec_cache;
+  GroupDecoder groups;
+
+  size_t num_dc_groups = 0;  // Decoded so far.
+  bool have_ac_info = false;
+  size_t num_ac_groups = 0;
+};
+
+PikIncrementalDecoder::PikIncrementalDecoder() {}
+PikIncrementalDecoder::~PikIncrementalDecoder() {}
+
+bool PikIncrementalDecoder::Init(const DecompressParams& params,
+                                 ThreadPool* pool) {
+  if (params.dc_preview != 0) {
+    return PIK_FAILURE("Incremental decoding does not support previews");
+  }
+  if (params.downscale != 1 && params.downscale != 2 &&
+      params.downscale != 4) {
+    return PIK_FAILURE("Invalid downscale factor.");
+  }
+  // Retains dec_cache buffers of the previous stream.
+  if (state_ == nullptr) state_.reset(new IncrementalDecoderState);
+  IncrementalDecoderState& state = *state_;
+  state.params = params;
+  state.pool = pool;
+  state.bytes.resize(0);
+  state.have_dc_info = false;
+  state.num_dc_groups = 0;
+  state.have_ac_info = false;
+  state.num_ac_groups = 0;
+  return true;
+}
+
+bool PikIncrementalDecoder::Feed(const uint8_t* bytes, const size_t size) {
+  PIK_CHECK(state_ != nullptr);  // Call Init first.
+  PaddedBytes& buffer = state_->bytes;
+  const size_t old_size = buffer.size();
+  // Grows geometrically; shrinking the size keeps the capacity.
+  if (old_size + size > buffer.padded_size()) {
+    buffer.resize(std::max(2 * buffer.padded_size(), old_size + size));
+  }
+  buffer.resize(old_size + size);
+  memcpy(buffer.data() + old_size, bytes, size);
+  return DecodeAvailable(/*end_of_stream=*/false);
+}
+
+size_t PikIncrementalDecoder::NumDecodedGroups() const {
+  return state_ == nullptr ? 0 : state_->num_dc_groups + state_->num_ac_groups;
+}
+
+size_t PikIncrementalDecoder::NumGroups() const {
+  if (state_ == nullptr || !state_->have_dc_info) return 0;
+  return 2 * state_->groups.NumTasks();
+}
+
+bool PikIncrementalDecoder::DecodeAvailable(const bool end_of_stream) {
+  PROFILER_FUNC;
+  IncrementalDecoderState& state = *state_;
+  const PaddedBytes& bytes = state.bytes;
+  const SegmentedBytes stream(bytes);
+  GroupDecoder& groups = state.groups;
+
+  if (!state.have_dc_info) {
+    const IncrementalDecoderState::Parse parse = state.ReadDCInfo();
+    if (parse == IncrementalDecoderState::Parse::kError) return false;
+    if (parse == IncrementalDecoderState::Parse::kIncomplete) {
+      return !end_of_stream || PIK_FAILURE("Truncated header or DC info.");
+    }
+    state.have_dc_info = true;
+  }
+
+  const size_t num_dc = state.NumCompleteGroups(
+      state.num_dc_groups,
+      [&groups](const size_t task) { return groups.DCGroupEnd(task); });
+  if (!state.DecodeGroups(state.num_dc_groups, num_dc,
+                          [&](const int task, const int thread) {
+                            return groups.DecodeDCGroup(stream, task, thread);
+                          })) {
+    return PIK_FAILURE("Invalid DC group.");
+  }
+  state.num_dc_groups += num_dc;
+  if (state.num_dc_groups != groups.NumTasks()) {
+    return !end_of_stream || PIK_FAILURE("Truncated DC groups.");
+  }
+  // Once, as soon as the last DC group arrives.
+  if (num_dc != 0) groups.FinishDC();
+
+  if (!state.have_ac_info) {
+    // The only AC group of small images extends to the end of the stream.
+    const bool small_image = (state.header.flags & Header::kSmallImage) != 0;
+    if (small_image && !end_of_stream) return true;
+    BitReader reader(bytes.data(), bytes.size());
+    reader.SkipBits(groups.ACInfoBegin() * kBitsPerByte);
+    if (!groups.ReadACInfo(bytes, 0, bytes.size(), &reader)) {
+      return !end_of_stream || PIK_FAILURE("Truncated AC info.");
+    }
+    state.have_ac_info = true;
+  }
+
+  const size_t num_ac = state.NumCompleteGroups(
+      state.num_ac_groups,
+      [&groups](const size_t task) { return groups.ACGroupEnd(task); });
+  if (!state.DecodeGroups(state.num_ac_groups, num_ac,
+                          [&](const int task, const int thread) {
+                            return groups.DecodeACGroup(stream, task, thread);
+                          })) {
+    return PIK_FAILURE("Invalid AC group.");
+  }
+  state.num_ac_groups += num_ac;
+  if (state.num_ac_groups != groups.NumTasks()) {
+    return !end_of_stream || PIK_FAILURE("Truncated AC groups.");
+  }
+  return true;
+}
+
+template <typename T>
+bool PikIncrementalDecoder::FinishT(MetaImage<T>* image, PikInfo* aux_out) {
+  PIK_CHECK(state_ != nullptr);  // Call Init first.
+  IncrementalDecoderState& state = *state_;
+  const DecompressParams& params = state.params;
+  if (!IsSupportedOutput<T>(params)) return false;
+  // Already complete unless the stream is truncated or a small image.
+  if (!DecodeAvailable(/*end_of_stream=*/true)) return false;
+  GroupDecoder& groups = state.groups;
+  const size_t end = groups.ACGroupEnd(groups.NumTasks() - 1);
+  if (params.check_decompressed_size && end != state.bytes.size()) {
+    return PIK_FAILURE("Pik compressed data size mismatch.");
+  }
+  groups.FinishAC();
+  state.ToPixels(image, aux_out);
+  if (aux_out != nullptr) {
+    aux_out->decoded_size = end;
+  }
+  // Releases the stream (but not the dec_cache buffers).
+  state.bytes = PaddedBytes();
+  return true;
+}
+
+bool PikIncrementalDecoder::Finish(MetaImageB* image, PikInfo* aux_out) {
+  return FinishT(image, aux_out);
+}
+bool PikIncrementalDecoder::Finish(MetaImageU* image, PikInfo* aux_out) {
+  return FinishT(image, aux_out);
+}
+bool PikIncrementalDecoder::Finish(MetaImageF* image, PikInfo* aux_out) {
+  return FinishT(image, aux_out);
+}
+
+namespace {
+
+// The fields preceding the DC and AC groups are parsed from a copy whose size
+// doubles until it suffices, starting with this many bytes.
+constexpr size_t kInitialFieldsCopy = 4096;
+
+template <typename T>
+bool SegmentsToPixelsT(const DecompressParams& params,
+                       const std::vector<ByteSegment>& segments,
+                       ThreadPool* pool, MetaImage<T>* image,
+                       PikInfo* aux_out) {
+  PROFILER_ZONE("PikToPixels segments uninstrumented");
+  AllocationPool::Scope pool_scope;
+  if (params.dc_preview != 0) {
+    return PIK_FAILURE("Scatter-gather input does not support previews");
+  }
+  if (params.downscale != 1 && params.downscale != 2 &&
+      params.downscale != 4) {
+    return PIK_FAILURE("Invalid downscale factor.");
+  }
+  if (!IsSupportedOutput<T>(params)) return false;
+
+  const SegmentedBytes stream(segments);
+  // Same steps as PikIncrementalDecoder, but with the entire stream available.
+  IncrementalDecoderState state;
+  state.params = params;
+  state.pool = pool;
+  {
+    PROFILER_ZONE("dec_bitstr");
+    PikStageTimer timer(aux_out, kStageDecode);
+
+    for (size_t copy_size = kInitialFieldsCopy;; copy_size *= 2) {
+      stream.Copy(0, copy_size, &state.bytes);
+      const IncrementalDecoderState::Parse parse = state.ReadDCInfo();
+      if (parse == IncrementalDecoderState::Parse::kError) return false;
+      if (parse == IncrementalDecoderState::Parse::kDone) break;
+      if (state.bytes.size() == stream.size()) {
+        return PIK_FAILURE("Truncated header or DC info.");
+      }
+    }
+    GroupDecoder& groups = state.groups;
+    const size_t num_tasks = groups.NumTasks();
+    if (!state.DecodeGroups(0, num_tasks, [&](const int task, const int thread) {
+          return groups.DecodeDCGroup(stream, task, thread);
+        })) {
+      return PIK_FAILURE("Invalid DC group.");
+    }
+    groups.FinishDC();
+
+    const uint64_t info_begin = groups.ACInfoBegin();
+    if (info_begin > stream.size()) return PIK_FAILURE("Truncated DC groups.");
+    for (size_t copy_size = kInitialFieldsCopy;; copy_size *= 2) {
+      stream.Copy(info_begin, copy_size, &state.bytes);
+      BitReader reader(state.bytes.data(), state.bytes.size());
+      if (groups.ReadACInfo(state.bytes, info_begin, stream.size(), &reader)) {
+        break;
+      }
+      if (info_begin + state.bytes.size() == stream.size()) {
+        return PIK_FAILURE("Invalid AC info.");
+      }
+    }
+    state.bytes = PaddedBytes();
+    if (!state.DecodeGroups(0, num_tasks, [&](const int task, const int thread) {
+          return groups.DecodeACGroup(stream, task, thread);
+        })) {
+      return PIK_FAILURE("Invalid AC group.");
+    }
+    groups.FinishAC();
+  }
+
+  const uint64_t end = state.groups.ACGroupEnd(state.groups.NumTasks() - 1);
+  if (params.check_decompressed_size && end != stream.size()) {
+    return PIK_FAILURE("Pik compressed data size mismatch.");
+  }
+  state.ToPixels(image, aux_out);
+  if (aux_out != nullptr) {
+    aux_out->decoded_size = end;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool PikToPixels(const DecompressParams& params,
+                 const std::vector<ByteSegment>& segments, ThreadPool* pool,
+                 MetaImageB* image, PikInfo* aux_out) {
+  return SegmentsToPixelsT(params, segments, pool, image, aux_out);
+}
+bool PikToPixels(const DecompressParams& params,
+                 const std::vector<ByteSegment>& segments, ThreadPool* pool,
+                 MetaImageU* image, PikInfo* aux_out) {
+  return SegmentsToPixelsT(params, segments, pool, image, aux_out);
+}
+bool PikToPixels(const DecompressParams& params,
+                 const std::vector<ByteSegment>& segments, ThreadPool* pool,
+                 MetaImageF* image, PikInfo* aux_out) {
+  return SegmentsToPixelsT(params, segments, pool, image, aux_out);
+}
+
+struct AsyncCodecState {
+  // Job arguments are moved into the closure; it runs with the dispatcher's
+  // encoder and decoder.
+  using Job = std::function<void(PikEncoder*, PikDecoder*)>;
+
+  void Dispatch() {
+    PikEncoder encoder;
+    PikDecoder decoder;
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return exit || !jobs.empty(); });
+        // Exits only after draining the queue.
+        if (jobs.empty()) return;
+        job = std::move(jobs.front());
+        jobs.pop_front();
+      }
+      job(&encoder, &decoder);
+    }
+  }
+
+  void Push(Job&& job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+  }
+
+  ThreadPool* pool;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Job> jobs;
+  bool exit = false;
+  std::vector<std::thread> dispatchers;
+};
+
+PikAsyncCodec::PikAsyncCodec(ThreadPool* pool, const size_t num_dispatchers)
+    : state_(new AsyncCodecState) {
+  PIK_CHECK(num_dispatchers != 0);
+  state_->pool = pool;
+  for (size_t i = 0; i < num_dispatchers; ++i) {
+    state_->dispatchers.emplace_back(&AsyncCodecState::Dispatch, state_.get());
+  }
+}
+
+PikAsyncCodec::~PikAsyncCodec() {
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->exit = true;
+  }
+  state_->cv.notify_all();
+  for (std::thread& dispatcher : state_->dispatchers) {
+    dispatcher.join();
+  }
+}
+
+void PikAsyncCodec::Encode(const CompressParams& params, MetaImageB&& image,
+                           EncodeCallback callback) {
+  ThreadPool* pool = state_->pool;
+  // (C++11 lambdas cannot capture by move, hence shared_ptr.)
+  std::shared_ptr<MetaImageB> owned(new MetaImageB(std::move(image)));
+  state_->Push([params, owned, callback, pool](PikEncoder* encoder,
+                                               PikDecoder*) {
+    PaddedBytes compressed;
+    PikInfo info;
+    const bool ok = encoder->Encode(params, *owned, pool, &compressed, &info);
+    callback(ok, std::move(compressed), info);
+  });
+}
+
+void PikAsyncCodec::Decode(const DecompressParams& params,
+                           PaddedBytes&& compressed, DecodeCallback callback) {
+  ThreadPool* pool = state_->pool;
+  std::shared_ptr<PaddedBytes> owned(new PaddedBytes(std::move(compressed)));
+  state_->Push([params, owned, callback, pool](PikEncoder*,
+                                               PikDecoder* decoder) {
+    MetaImageB image;
+    PikInfo info;
+    const bool ok = decoder->Decode(params, *owned, pool, &image, &info);
+    callback(ok, std::move(image), info);
+  });
 }
 
 }  // namespace pik
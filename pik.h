@@ -15,19 +15,51 @@
 #ifndef PIK_H_
 #define PIK_H_
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "data_parallel.h"
 #include "guetzli/jpeg_data.h"
+#include "guetzli/jpeg_data_writer.h"
 #include "header.h"
 #include "image.h"
+#include "orientation.h"
 #include "padded_bytes.h"
 #include "pik_info.h"
 #include "pik_params.h"
 #include "status.h"
+#include "yuv_convert.h"
 
 namespace pik {
 
+struct DecCache;        // compressed_image.h
+struct EncoderBuffers;  // pik.cc
+struct StreamingEncoderState;  // pik.cc
+struct AsyncCodecState;        // pik.cc
+struct IncrementalDecoderState;  // pik.cc
+
+// Returns "params" with the stage settings implied by params.effort, or
+// unchanged if effort is 0. The encoder functions below call this, so
+// callers need not. Ladder (each level also keeps the gains of the previous):
+//  1: fast_mode (fixed quant field, no color correlation search, gradient map
+//     for smooth DC, fast histograms/orders), no noise estimation;
+//  2-3: as 1, plus noise estimation from every 4th/2nd patch;
+//  4-6: butteraugli quantization search with 2/3/5 iterations (the first
+//       1/2/2 at half resolution), noise from every 4th/2nd/every patch;
+//  7: the default search (7 full-resolution iterations);
+//  8: 12 iterations;
+//  9: guetzli_mode (up to max_butteraugli_iters_guetzli_mode iterations).
+CompressParams ParamsForEffort(const CompressParams& params);
+
+// Returns the group size [tiles] of the default bitstream for an xsize * ysize
+// image: params.group_size_in_tiles if nonzero, otherwise smaller than the
+// default if there would be fewer groups than threads in "pool" (if any), and
+// larger for images with enough groups for any decoder.
+uint32_t GroupSizeForParams(const CompressParams& params, size_t xsize,
+                            size_t ysize, ThreadPool* pool);
+
 // The input image is an 8-bit sRGB image.
 bool PixelsToPik(const CompressParams& params, const MetaImageB& image,
                  ThreadPool* pool, PaddedBytes* compressed,
@@ -36,25 +68,241 @@ bool PixelsToPik(const CompressParams& params, const Image3B& image,
                  ThreadPool* pool, PaddedBytes* compressed,
                  PikInfo* aux_out = nullptr);
 
+// The input image is an 8-bit sRGB image in the caller's interleaved buffer,
+// e.g. RGBA frames. Pixels are deinterleaved while converting them to opsin,
+// so no planar copy is made. RGBA/BGRA also encode the alpha channel.
+bool PixelsToPik(const CompressParams& params,
+                 const ConstInterleavedImageView& image, ThreadPool* pool,
+                 PaddedBytes* compressed, PikInfo* aux_out = nullptr);
+
 // The input image is a linear (gamma expanded) sRGB image.
 bool PixelsToPik(const CompressParams& params, const MetaImageF& linear,
                  ThreadPool* pool, PaddedBytes* compressed,
                  PikInfo* aux_out = nullptr);
+
+// As above, but writes the output to "sink" (e.g. a PositionedFile) instead of
+// returning it, and sets *size to its size. Each group's code is written at
+// its final offset by the thread pool once all group sizes are known, so the
+// concatenated stream is never held in memory.
+bool PixelsToPik(const CompressParams& params, const MetaImageB& image,
+                 ThreadPool* pool, PositionedByteSink* sink, uint64_t* size,
+                 PikInfo* aux_out = nullptr);
+bool PixelsToPik(const CompressParams& params, const MetaImageF& linear,
+                 ThreadPool* pool, PositionedByteSink* sink, uint64_t* size,
+                 PikInfo* aux_out = nullptr);
 bool PixelsToPik(const CompressParams& params, const Image3F& linear,
                  ThreadPool* pool, PaddedBytes* compressed,
                  PikInfo* aux_out = nullptr);
 
+// Encodes the same image once per entry of "distances" (butteraugli targets,
+// overriding params.butteraugli_distance), e.g. for a responsive image ladder.
+// The opsin conversion, butteraugli reference and DCTs are computed once; the
+// outputs are identical to separate PixelsToPik calls. If "warm_start", each
+// FindBestQuantization instead starts from the field found for the previous
+// distance and skips its coarse iterations: faster, but the outputs differ
+// (sizes vary by several percent in either direction). Requires a distance
+// target (not target_size/bitrate) and does not support use_brunsli_v2.
+// "aux_out" may be null, otherwise it receives one PikInfo per distance.
+bool PixelsToPikLadder(const CompressParams& params,
+                       const std::vector<float>& distances, bool warm_start,
+                       const MetaImageB& image, ThreadPool* pool,
+                       std::vector<PaddedBytes>* compressed,
+                       std::vector<PikInfo>* aux_out = nullptr);
+bool PixelsToPikLadder(const CompressParams& params,
+                       const std::vector<float>& distances, bool warm_start,
+                       const MetaImageF& linear, ThreadPool* pool,
+                       std::vector<PaddedBytes>* compressed,
+                       std::vector<PikInfo>* aux_out = nullptr);
+
+// Appends one frame of a multi-frame stream (e.g. a screen recording or UI
+// animation) to "compressed". Such streams are the concatenation of lossless
+// bitstreams (see lossless.h), one per 8-bit frame. If "previous" (the frame
+// passed to the preceding call) is non-null and has the same size and alpha
+// presence, groups (512x512 pixels) that equal its pixels are not coded and
+// the decoder keeps their pixels, so the size and coding time of a frame track
+// the changed area. Palettes and grayscale are chosen per frame as for
+// CompressParams::lossless; the other params are ignored. PikToPixels only
+// decodes the first frame.
+bool PixelsToPikFrame(const CompressParams& params, const MetaImageB& frame,
+                      const MetaImageB* previous, ThreadPool* pool,
+                      PaddedBytes* compressed, PikInfo* aux_out = nullptr);
+
 // The input image is an opsin dynamics image.
 bool OpsinToPik(const CompressParams& params, const Header& header,
                 const MetaImageF& opsin,
                 ThreadPool* pool, PaddedBytes* compressed,
                 PikInfo* aux_out = nullptr);
 
-// The input image is a (partially decoded) JPEG image.
+// Same as PixelsToPik, but reuses the encoder buffers (coefficients,
+// prediction residuals and the reconstruction used by the quantization search)
+// across calls, so that encoding a stream of similarly-sized images does not
+// reallocate them. Not thread-safe; use one instance per thread/worker.
+class PikEncoder {
+ public:
+  PikEncoder();
+  ~PikEncoder();
+
+  bool Encode(const CompressParams& params, const MetaImageB& image,
+              ThreadPool* pool, PaddedBytes* compressed,
+              PikInfo* aux_out = nullptr);
+  bool Encode(const CompressParams& params, const Image3B& image,
+              ThreadPool* pool, PaddedBytes* compressed,
+              PikInfo* aux_out = nullptr);
+  bool Encode(const CompressParams& params, const MetaImageF& linear,
+              ThreadPool* pool, PaddedBytes* compressed,
+              PikInfo* aux_out = nullptr);
+  bool Encode(const CompressParams& params, const Image3F& linear,
+              ThreadPool* pool, PaddedBytes* compressed,
+              PikInfo* aux_out = nullptr);
+
+  // Bytes currently held by the retained buffers. Excludes temporaries that
+  // are freed before Encode returns (e.g. the butteraugli comparator).
+  size_t RetainedBytes() const;
+  // Maximum of RetainedBytes() observed after any Encode call.
+  size_t PeakRetainedBytes() const { return peak_retained_bytes_; }
+
+  // If RetainedBytes() exceeds max_bytes after an Encode call, all buffers are
+  // released, which bounds the memory a worker keeps between images (e.g.
+  // after an unusually large one). Default: no limit.
+  void SetMaxRetainedBytes(size_t max_bytes) {
+    max_retained_bytes_ = max_bytes;
+  }
+
+  // Frees all retained buffers; the next Encode reallocates them.
+  void ReleaseMemory();
+
+ private:
+  template <class Image>
+  bool EncodeT(const CompressParams& params, const Image& image,
+               ThreadPool* pool, PaddedBytes* compressed, PikInfo* aux_out);
+
+  std::unique_ptr<EncoderBuffers> buffers_;
+  size_t peak_retained_bytes_ = 0;
+  size_t max_retained_bytes_ = ~size_t(0);
+};
+
+// Encodes an 8-bit sRGB image whose rows arrive in bands (e.g. read
+// incrementally from a file), producing the same bitstream as PixelsToPik,
+// except that neutral gray images are only coded as grayscale if
+// params.grayscale is Override::kOn (there is no detection by default).
+// Each group row is transformed and tokenized as soon as its pixels (plus a
+// few blocks of context) are available, so only about one group row of pixels
+// is held in memory. The format stores all DC and histograms before any AC
+// group, so the quantized DC, quant field and AC tokens (typically far smaller
+// than the pixels) are kept until Finish. Not thread-safe.
+class PikStreamingEncoder {
+ public:
+  PikStreamingEncoder();
+  ~PikStreamingEncoder();
+
+  // Returns false if "params" require stages that see the whole image. The
+  // supported subset: fast_mode, butteraugli_distance < kMaxButteraugliForHQ,
+  // noise disabled (apply_noise or distance <= 1.4), no target size/bitrate
+  // and no brunsli.
+  bool Init(const CompressParams& params, size_t xsize, size_t ysize,
+            ThreadPool* pool);
+
+  // Appends the next rows.ysize() rows; rows.xsize() must equal xsize.
+  bool AddRows(const Image3B& rows);
+
+  // Once all ysize rows were added, replaces "compressed" with the bitstream.
+  // Afterwards, Init must be called before encoding another image.
+  bool Finish(PaddedBytes* compressed, PikInfo* aux_out = nullptr);
+  // As above, but writes the bitstream to "sink" (see the PixelsToPik
+  // overload) and sets *size to its size.
+  bool Finish(PositionedByteSink* sink, uint64_t* size,
+              PikInfo* aux_out = nullptr);
+
+ private:
+  void EncodeGroupRow();
+  bool FinishImpl(PaddedBytes* compressed, PositionedByteSink* sink,
+                  uint64_t* size, PikInfo* aux_out);
+
+  std::unique_ptr<StreamingEncoderState> state_;
+};
+
+// The input image is a (partially decoded) JPEG image. If
+// params.butteraugli_distance <= 0, its coefficients are stored losslessly.
+// Otherwise, it is re-encoded with guetzli and stored losslessly, or if
+// params.jpeg_transcode, encoded as PIK from the decoded pixels with a short
+// quantization search starting from the precision of the JPEG (much faster
+// than PixelsToPik). The JPEG metadata is not retained in that case.
 bool JpegToPik(const CompressParams& params, const guetzli::JPEGData& jpeg,
                ThreadPool* pool, PaddedBytes* compressed,
                PikInfo* aux_out = nullptr);
 
+// The input is a JPEG file. In lossless mode, it is decoded in bands of MCU
+// rows, so memory use does not grow with the number of DCT coefficients.
+// Progressive files and the lossy mode decode the whole file first.
+bool JpegToPik(const CompressParams& params, const uint8_t* jpeg,
+               size_t jpeg_size, ThreadPool* pool, PaddedBytes* compressed,
+               PikInfo* aux_out = nullptr);
+
+// Image properties that can be determined without decoding pixels.
+struct PikBasicInfo {
+  uint32_t xsize = 0;
+  uint32_t ysize = 0;
+  uint32_t num_components = 0;  // Excluding alpha.
+  bool has_alpha = false;
+  uint32_t bitstream = Header::kBitstreamDefault;
+  // Width and height [pixels] of the DC/AC groups (128 to 1024) of the default
+  // bitstream, e.g. for choosing a PikCrop rect; 0 for other bitstreams.
+  uint32_t group_size = 0;
+};
+
+// Parses only the header (and, for Brunsli, its small header) of "compressed".
+// The section payloads and coefficients are not read, so this is cheap
+// regardless of the image size. Returns false if the header is invalid or
+// truncated.
+bool PikProbe(const uint8_t* compressed, size_t compressed_size,
+              PikBasicInfo* info);
+
+// Copies "compressed" to "out" with different metadata: EXIF and XMP are
+// removed if params.clear_metadata; the ICC profile is replaced by "icc"
+// unless it is null (an empty profile removes the section). Only the header
+// and sections are re-encoded; the pixel bitstream is copied verbatim, so the
+// cost is independent of the image size. Fails unless "compressed" is a
+// default (non-Brunsli) bitstream.
+bool PikRewriteMetadata(const CompressParams& params,
+                        const PaddedBytes& compressed,
+                        const std::vector<uint8_t>* icc, PaddedBytes* out);
+
+// Writes to "cropped" a stream of the pixels within "rect" of "compressed"
+// (e.g. a tile for serving) without decoding it: the DC/AC groups within
+// "rect" are copied as-is, which costs about as much as copying the bytes.
+// "rect" is clamped to the image; its origin must be a multiple of the group
+// size (PikBasicInfo::group_size), and so must its size unless it extends to
+// the right or bottom image border. The coefficients are unchanged, but
+// pixels near the cropped edges may differ slightly from the original because
+// the decoder predicts and filters across group borders, and synthesized
+// noise (if any) is a different random pattern. Fails unless "compressed" is
+// a default (non-Brunsli) bitstream.
+bool PikCrop(const PaddedBytes& compressed, const Rect& rect,
+             ThreadPool* pool, PaddedBytes* cropped);
+
+// Writes to "out" a stream of "compressed" rotated and/or flipped as
+// specified by "orientation" (e.g. the value of an EXIF orientation tag)
+// without a decode/encode cycle: the quantized coefficients are rearranged and
+// entropy-coded again (params.fast_mode selects the coding effort). Flips and
+// 180 degree rotation are lossless. Transposing orientations (90/270 degree
+// rotations) requantize the coefficients whose quantization weight differs
+// from that of their transposed position, which loses less precision than
+// decoding and re-encoding the pixels. The metadata sections are copied
+// unchanged, so callers should reset the EXIF orientation if they apply it
+// here. Fails unless every mirrored dimension of the result is a multiple of
+// 8 pixels, and for Brunsli or gradient-map streams.
+bool PikOrient(const CompressParams& params, const PaddedBytes& compressed,
+               Orientation orientation, ThreadPool* pool, PaddedBytes* out);
+
+// Writes a JPEG file with the same DCT coefficients, quantization tables and
+// subsampling as the input of JpegToPik (lossless mode) to "out", without
+// rendering any pixels. The bytes are passed to "out" in order as they are
+// produced. Fails unless "compressed" is a Brunsli bitstream. With
+// params.jpeg_restart_interval, the entropy-coded data is produced in parallel
+// and passed to "out" after the whole scan is encoded.
+bool PikToJpeg(const DecompressParams& params, const PaddedBytes& compressed,
+               ThreadPool* pool, const guetzli::JPEGOutput& out);
+
 // The output image is an 8-bit sRGB image.
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, MetaImageB* image,
@@ -62,20 +310,199 @@ bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, Image3B* image, PikInfo* aux_out = nullptr);
 
-// The output image is a 16-bit sRGB image.
+// The output image is a 16-bit sRGB image, unless DecompressParams::encoding
+// requests linear light or half-floats.
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, MetaImageU* image,
                  PikInfo* aux_out = nullptr);
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, Image3U* image, PikInfo* aux_out = nullptr);
 
-// The output image is a floating-point sRGB image.
+// The output image is a floating-point sRGB image, or linear light (see
+// DecompressParams::encoding).
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, MetaImageF* image,
                  PikInfo* aux_out = nullptr);
 bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
                  ThreadPool* pool, Image3F* image, PikInfo* aux_out = nullptr);
 
+// The output is 8-bit sRGB written to the caller's interleaved buffer (e.g. a
+// texture), whose size must match the image (see PikProbe). RGBA/BGRA also
+// receive the alpha channel, or 255 if the image has none; kRGB fails for
+// images with non-opaque alpha. Avoids allocating planar output images and
+// the caller's interleaving pass: pixels and alpha are written in the same
+// pass that converts them to sRGB. Previews are interleaved afterwards.
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 ThreadPool* pool, const InterleavedImageView& out,
+                 PikInfo* aux_out = nullptr);
+
+// The output is 4:2:0 YUV Rec 709 (8, 10 or 12 bit) written to the caller's
+// planes (see YUV420ImageView), whose size must match the image; alpha is not
+// decoded. Converts directly from the decoder's opsin image in one pass
+// instead of producing sRGB and then converting and subsampling it. Previews,
+// downscaled, lossless and Brunsli images are converted from 8-bit sRGB.
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 ThreadPool* pool, const YUV420ImageView& out,
+                 PikInfo* aux_out = nullptr);
+
+// As above, but only decodes the pixels within "rect" (clamped to the image),
+// so the cost depends on the number of groups it touches rather than the
+// image size. The result equals the same rect of a full decode, except for
+// the synthesized noise, whose pseudorandom pattern depends on the origin.
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, MetaImageB* image,
+                 PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, MetaImageU* image,
+                 PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, MetaImageF* image,
+                 PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, Image3B* image,
+                 PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, Image3U* image,
+                 PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const Rect& rect, ThreadPool* pool, Image3F* image,
+                 PikInfo* aux_out = nullptr);
+
+// As above, but also passes the color rows of "image" (final sRGB pixels
+// clamped to the image size, without alpha) to "sink", top to bottom. Unless
+// the image requires denoising or noise synthesis (which operate on the whole
+// image), each group row is passed as soon as it is reconstructed, so callers
+// can write or send it while later rows are still being decoded. Calls are
+// sequential, i.e. the sink need not be thread-safe.
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const ImageRowsSink<uint8_t>& sink, ThreadPool* pool,
+                 MetaImageB* image, PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const ImageRowsSink<uint16_t>& sink, ThreadPool* pool,
+                 MetaImageU* image, PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params, const PaddedBytes& compressed,
+                 const ImageRowsSink<float>& sink, ThreadPool* pool,
+                 MetaImageF* image, PikInfo* aux_out = nullptr);
+
+// As above, but the compressed stream is the concatenation of "segments"
+// (scatter-gather input, e.g. a chain of network buffers), which are not
+// copied except for the fields preceding the DC/AC groups and the rare group
+// that straddles a segment boundary. Not for Brunsli or DC previews.
+bool PikToPixels(const DecompressParams& params,
+                 const std::vector<ByteSegment>& segments, ThreadPool* pool,
+                 MetaImageB* image, PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params,
+                 const std::vector<ByteSegment>& segments, ThreadPool* pool,
+                 MetaImageU* image, PikInfo* aux_out = nullptr);
+bool PikToPixels(const DecompressParams& params,
+                 const std::vector<ByteSegment>& segments, ThreadPool* pool,
+                 MetaImageF* image, PikInfo* aux_out = nullptr);
+
+// Decodes the frame that begins at byte "*pos" (initially 0) of a multi-frame
+// stream (see PixelsToPikFrame) and advances "*pos" to the next frame; all
+// frames were decoded once it equals compressed.size(). "frame" must hold the
+// unmodified result of the preceding call because unchanged groups are not
+// written. Alpha is always retained.
+bool PikFrameToPixels(const DecompressParams& params,
+                      const PaddedBytes& compressed, size_t* pos,
+                      ThreadPool* pool, MetaImageB* frame,
+                      PikInfo* aux_out = nullptr);
+
+// Same as PikToPixels, but reuses the decoder buffers (coefficients, per-thread
+// group storage, entropy decoding tables) across calls. Useful for decoding
+// many (small) images, because buffers are only reallocated when a larger
+// image arrives. Not thread-safe; use one instance per thread.
+class PikDecoder {
+ public:
+  PikDecoder();
+  ~PikDecoder();
+
+  bool Decode(const DecompressParams& params, const PaddedBytes& compressed,
+              ThreadPool* pool, MetaImageB* image, PikInfo* aux_out = nullptr);
+  bool Decode(const DecompressParams& params, const PaddedBytes& compressed,
+              ThreadPool* pool, MetaImageU* image, PikInfo* aux_out = nullptr);
+  bool Decode(const DecompressParams& params, const PaddedBytes& compressed,
+              ThreadPool* pool, MetaImageF* image, PikInfo* aux_out = nullptr);
+  bool Decode(const DecompressParams& params, const PaddedBytes& compressed,
+              ThreadPool* pool, Image3B* image, PikInfo* aux_out = nullptr);
+  bool Decode(const DecompressParams& params, const PaddedBytes& compressed,
+              ThreadPool* pool, Image3U* image, PikInfo* aux_out = nullptr);
+  bool Decode(const DecompressParams& params, const PaddedBytes& compressed,
+              ThreadPool* pool, Image3F* image, PikInfo* aux_out = nullptr);
+
+ private:
+  std::unique_ptr<DecCache> cache_;
+};
+
+// Decodes a stream that arrives in chunks, e.g. over a slow network. Each DC
+// and AC group is decoded as soon as all of its bytes (whose range is given by
+// the group sizes preceding the DC resp. AC groups) have arrived, so that only
+// the groups of the last chunk and the reconstruction remain once the stream
+// is complete. Supports the default bitstream without dc_preview; there is no
+// region decoding. Not thread-safe.
+class PikIncrementalDecoder {
+ public:
+  PikIncrementalDecoder();
+  ~PikIncrementalDecoder();
+
+  // Starts a new stream. Returns false if "params" are not supported.
+  bool Init(const DecompressParams& params, ThreadPool* pool);
+
+  // Appends the next "size" bytes of the stream and decodes the groups that
+  // are now complete. Returns false if the stream is invalid. Fields that
+  // cannot be parsed yet are assumed to be incomplete rather than invalid, so
+  // some errors are only reported by Finish (and PIK_CRASH_ON_ERROR builds
+  // abort at the first such attempt).
+  bool Feed(const uint8_t* bytes, size_t size);
+
+  // Number of DC and AC groups decoded so far (e.g. for a progress bar), and
+  // their total, which is zero until the DC group sizes have arrived.
+  size_t NumDecodedGroups() const;
+  size_t NumGroups() const;
+
+  // Signals the end of the stream, decodes any remaining groups (for tiny
+  // images, the only AC group extends to the end of the stream) and
+  // reconstructs "image". Afterwards, Init must be called before decoding
+  // another stream.
+  bool Finish(MetaImageB* image, PikInfo* aux_out = nullptr);
+  bool Finish(MetaImageU* image, PikInfo* aux_out = nullptr);
+  bool Finish(MetaImageF* image, PikInfo* aux_out = nullptr);
+
+ private:
+  bool DecodeAvailable(bool end_of_stream);
+  template <typename T>
+  bool FinishT(MetaImage<T>* image, PikInfo* aux_out);
+
+  std::unique_ptr<IncrementalDecoderState> state_;
+};
+
+// Encodes/decodes without blocking the caller, e.g. an event loop: each call
+// only queues a job. "num_dispatchers" threads (each with its own PikEncoder
+// and PikDecoder) run the jobs and invoke their callbacks. All jobs share
+// "pool", whose workers interleave the group tasks of concurrent jobs (see
+// ThreadPool::Run), so at most num_dispatchers images are in flight and
+// requests do not each require a thread. Thread-safe.
+class PikAsyncCodec {
+ public:
+  // Called on a dispatcher thread; may queue further jobs.
+  using EncodeCallback = std::function<void(bool ok, PaddedBytes&& compressed,
+                                            const PikInfo& info)>;
+  using DecodeCallback =
+      std::function<void(bool ok, MetaImageB&& image, const PikInfo& info)>;
+
+  PikAsyncCodec(ThreadPool* pool, size_t num_dispatchers = 2);
+  // Finishes all queued jobs (including their callbacks).
+  ~PikAsyncCodec();
+
+  void Encode(const CompressParams& params, MetaImageB&& image,
+              EncodeCallback callback);
+  void Decode(const DecompressParams& params, PaddedBytes&& compressed,
+              DecodeCallback callback);
+
+ private:
+  std::unique_ptr<AsyncCodecState> state_;
+};
+
 }  // namespace pik
 
 #endif  // PIK_H_
@@ -14,21 +14,24 @@
 
 #include "pik_alpha.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
-
 #include <memory>
 #include <vector>
 
 #include "brotli/decode.h"
 #include "brotli/encode.h"
 #include "bit_reader.h"
+#include "common.h"
 #include "fast_log.h"
+#include "fields.h"
 #include "write_bits.h"
 
 namespace pik {
 namespace {
 
-bool BrotliDecompress(const std::vector<uint8_t>& in,
+bool BrotliDecompress(const uint8_t* in, const size_t insize,
                       size_t max_output_size,
                       size_t* bytes_read,
                       std::vector<uint8_t>* out) {
@@ -40,9 +43,8 @@ bool BrotliDecompress(const std::vector<uint8_t>& in,
   const size_t kBufferSize = 128 * 1024;
   std::vector<uint8_t> temp_buffer(kBufferSize);
 
-  size_t insize = in.size();
   size_t avail_in = insize;
-  const uint8_t* next_in = &in[0];
+  const uint8_t* next_in = in;
   BrotliDecoderResult code;
 
   while (1) {
@@ -102,43 +104,31 @@ bool BrotliCompress(int quality, const std::vector<uint8_t>& in,
   return true;
 }
 
-ImageU FilterAlpha(const ImageU& in, int bit_depth) {
-  ImageU out(in.xsize(), in.ysize());
-  const size_t mask = (1 << bit_depth) - 1;
-  for (size_t y = 0; y < in.ysize(); ++y) {
-    const uint16_t* PIK_RESTRICT row_in = in.Row(y);
-    uint16_t* PIK_RESTRICT row_out = out.Row(y);
-    row_out[0] = row_in[0];
-    for (size_t x = 1; x < in.xsize(); ++x) {
-      row_out[x] = (row_in[x] - row_in[x - 1]) & mask;
-    }
-  }
-  return out;
-}
+// Rows per independently coded group of kModeBrotliGroups.
+constexpr size_t kAlphaGroupHeight = kGroupHeightInBlocks * kBlockHeight;
 
-void UnfilterAlpha(int bit_depth, ImageU* img) {
-  const size_t mask = (1 << bit_depth) - 1;
-  for (size_t y = 0; y < img->ysize(); ++y) {
-    uint16_t* PIK_RESTRICT row = img->Row(y);
-    for (size_t x = 1; x < img->xsize(); ++x) {
-      row[x] = (row[x] + row[x - 1]) & mask;
-    }
-  }
-}
+// Distribution of the compressed group sizes; zero means the group is fully
+// opaque and has no Brotli stream.
+constexpr uint32_t kAlphaGroupSizeDistribution = 0x20140C80;
 
+// Filters (horizontal differences) rows [y_begin, y_end) of "plane",
+// interleaves the little-endian bytes of each value and Brotli-compresses
+// them.
 bool FilterAndBrotliEncode(const CompressParams& params,
                            const ImageU& plane, int bit_depth,
+                           const size_t y_begin, const size_t y_end,
                            std::vector<uint8_t>* out) {
   const size_t xsize = plane.xsize();
-  const size_t ysize = plane.ysize();
   const size_t stride = bit_depth / 8;
-  ImageU filtered = FilterAlpha(plane, bit_depth);
-  std::vector<uint8_t> data(xsize * ysize * stride);
-  for (size_t y = 0; y < ysize; ++y) {
-    uint16_t* PIK_RESTRICT row = filtered.Row(y);
+  const size_t mask = (1 << bit_depth) - 1;
+  std::vector<uint8_t> data(xsize * (y_end - y_begin) * stride);
+  size_t pos = 0;
+  for (size_t y = y_begin; y < y_end; ++y) {
+    const uint16_t* PIK_RESTRICT row = plane.ConstRow(y);
     for (size_t x = 0; x < xsize; ++x) {
+      const uint16_t filtered = x == 0 ? row[0] : (row[x] - row[x - 1]) & mask;
       for (int i = 0; i < stride; ++i) {
-        data[(y * xsize + x) * stride + i] = (row[x] >> (8 * i)) & 255;
+        data[pos++] = (filtered >> (8 * i)) & 255;
       }
     }
   }
@@ -146,31 +136,243 @@ bool FilterAndBrotliEncode(const CompressParams& params,
   return BrotliCompress(quality, data, out);
 }
 
-bool BrotliDecodeAndUnfilter(const std::vector<uint8_t>& brotli,
-                             const int bit_depth, ImageU* plane) {
-  const size_t num_pixels = plane->xsize() * plane->ysize();
+// Inverse of FilterAndBrotliEncode; writes rows [y_begin, y_end) of "plane".
+bool BrotliDecodeAndUnfilter(const uint8_t* brotli, const size_t brotli_size,
+                             const int bit_depth, const size_t y_begin,
+                             const size_t y_end, ImageU* plane) {
+  const size_t xsize = plane->xsize();
+  const size_t num_pixels = xsize * (y_end - y_begin);
   const size_t stride = bit_depth / 8;
+  const size_t mask = (1 << bit_depth) - 1;
   std::vector<uint8_t> data;
-  size_t bytes_read;
-  if (!BrotliDecompress(brotli, num_pixels * stride, &bytes_read, &data)) {
+  size_t bytes_read = 0;
+  if (!BrotliDecompress(brotli, brotli_size, num_pixels * stride, &bytes_read,
+                        &data)) {
     return false;
   }
   if (data.size() != num_pixels * stride) {
     return PIK_FAILURE("Incorrect size of the alpha stream");
   }
-  for (size_t y = 0; y < plane->ysize(); ++y) {
+  size_t pos = 0;
+  for (size_t y = y_begin; y < y_end; ++y) {
     uint16_t* const PIK_RESTRICT row = plane->Row(y);
-    for (size_t x = 0; x < plane->xsize(); ++x) {
-      row[x] = 0;
+    for (size_t x = 0; x < xsize; ++x) {
+      uint16_t value = 0;
       for (int i = 0; i < stride; ++i) {
-        row[x] += data[(y * plane->xsize() + x) * stride + i] << (8 * i);
+        value += data[pos++] << (8 * i);
       }
+      row[x] = x == 0 ? value : (value + row[x - 1]) & mask;
+    }
+  }
+  return true;
+}
+
+bool IsOpaque(const ImageU& plane, const int bit_depth, const size_t y_begin,
+              const size_t y_end) {
+  const uint16_t opaque = (1 << bit_depth) - 1;
+  for (size_t y = y_begin; y < y_end; ++y) {
+    const uint16_t* PIK_RESTRICT row = plane.ConstRow(y);
+    for (size_t x = 0; x < plane.xsize(); ++x) {
+      if (row[x] != opaque) return false;
+    }
+  }
+  return true;
+}
+
+// Compresses groups of kAlphaGroupHeight rows independently and in parallel.
+// Output: the compressed size of each group (TOC), then their Brotli streams.
+bool EncodeGroups(const CompressParams& params, const ImageU& plane,
+                  int bit_depth, ThreadPool* pool, std::vector<uint8_t>* out) {
+  const size_t ysize = plane.ysize();
+  const size_t num_groups = DivCeil(ysize, kAlphaGroupHeight);
+  std::vector<std::vector<uint8_t>> group_codes(num_groups);
+  std::atomic<bool> ok{true};
+  pool->Run(0, num_groups, [&](const int task, const int thread) {
+    const size_t y_begin = task * kAlphaGroupHeight;
+    const size_t y_end = std::min(ysize, y_begin + kAlphaGroupHeight);
+    if (IsOpaque(plane, bit_depth, y_begin, y_end)) return;
+    if (!FilterAndBrotliEncode(params, plane, bit_depth, y_begin, y_end,
+                               &group_codes[task])) {
+      ok.store(false);
     }
+  });
+  if (!ok.load()) return false;
+
+  const size_t max_toc_bits =
+      U32Coder::MaxEncodedBits(kAlphaGroupSizeDistribution) * num_groups;
+  std::vector<uint8_t> toc(DivCeil(max_toc_bits, kBitsPerByte) + 8);
+  size_t toc_pos = 0;
+  size_t total_size = 0;
+  for (const std::vector<uint8_t>& code : group_codes) {
+    PIK_CHECK(U32Coder::Store(kAlphaGroupSizeDistribution, code.size(),
+                              &toc_pos, toc.data()));
+    total_size += code.size();
+  }
+  WriteZeroesToByteBoundary(&toc_pos, toc.data());
+  toc.resize(toc_pos / kBitsPerByte);
+
+  out->clear();
+  out->reserve(toc.size() + total_size);
+  out->insert(out->end(), toc.begin(), toc.end());
+  for (const std::vector<uint8_t>& code : group_codes) {
+    out->insert(out->end(), code.begin(), code.end());
   }
-  UnfilterAlpha(bit_depth, plane);
   return true;
 }
 
+bool DecodeGroups(const std::vector<uint8_t>& encoded, const int bit_depth,
+                  ThreadPool* pool, ImageU* plane) {
+  const size_t ysize = plane->ysize();
+  const size_t num_groups = DivCeil(ysize, kAlphaGroupHeight);
+  std::vector<size_t> sizes(num_groups);
+  BitReader reader(encoded.data(), encoded.size());
+  for (size_t i = 0; i < num_groups; ++i) {
+    sizes[i] = U32Coder::Load(kAlphaGroupSizeDistribution, &reader);
+  }
+  reader.JumpToByteBoundary();
+  // Offset of each group's stream within "encoded".
+  std::vector<size_t> offsets(num_groups);
+  size_t pos = reader.Position();
+  for (size_t i = 0; i < num_groups; ++i) {
+    if (pos > encoded.size() || sizes[i] > encoded.size() - pos) {
+      return PIK_FAILURE("Alpha group out of bounds");
+    }
+    offsets[i] = pos;
+    pos += sizes[i];
+  }
+
+  const uint16_t opaque = (1 << bit_depth) - 1;
+  std::atomic<bool> ok{true};
+  pool->Run(0, num_groups, [&](const int task, const int thread) {
+    const size_t y_begin = task * kAlphaGroupHeight;
+    const size_t y_end = std::min(ysize, y_begin + kAlphaGroupHeight);
+    if (sizes[task] == 0) {
+      for (size_t y = y_begin; y < y_end; ++y) {
+        uint16_t* PIK_RESTRICT row = plane->Row(y);
+        std::fill(row, row + plane->xsize(), opaque);
+      }
+      return;
+    }
+    if (!BrotliDecodeAndUnfilter(encoded.data() + offsets[task], sizes[task],
+                                 bit_depth, y_begin, y_end, plane)) {
+      ok.store(false);
+    }
+  });
+  return ok.load();
+}
+
+enum class AlphaKind { kConstant, kBinary, kOther };
+
+// Single pass over "plane" to find the cheapest applicable mode.
+AlphaKind ClassifyAlpha(const ImageU& plane, const int bit_depth) {
+  const uint16_t opaque = (1 << bit_depth) - 1;
+  const uint16_t first = plane.ConstRow(0)[0];
+  bool is_constant = true;
+  for (size_t y = 0; y < plane.ysize(); ++y) {
+    const uint16_t* PIK_RESTRICT row = plane.ConstRow(y);
+    for (size_t x = 0; x < plane.xsize(); ++x) {
+      if (row[x] == first) continue;
+      is_constant = false;
+      if (row[x] != 0 && row[x] != opaque) return AlphaKind::kOther;
+    }
+  }
+  if (is_constant) return AlphaKind::kConstant;
+  return (first == 0 || first == opaque) ? AlphaKind::kBinary
+                                         : AlphaKind::kOther;
+}
+
+void AppendVarint(size_t value, std::vector<uint8_t>* out) {
+  while (value >= 0x80) {
+    out->push_back((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  out->push_back(value);
+}
+
+bool ReadVarint(const std::vector<uint8_t>& data, size_t* PIK_RESTRICT pos,
+                size_t* PIK_RESTRICT value) {
+  *value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (*pos >= data.size()) return false;
+    const uint8_t byte = data[(*pos)++];
+    *value |= static_cast<size_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+// Lengths of alternating transparent/opaque runs (starting with a possibly
+// empty transparent run) in raster order, as Brotli-compressed varints.
+bool EncodeBinaryAlpha(const CompressParams& params, const ImageU& plane,
+                       std::vector<uint8_t>* out) {
+  std::vector<uint8_t> runs;
+  uint16_t current = 0;
+  size_t run = 0;
+  for (size_t y = 0; y < plane.ysize(); ++y) {
+    const uint16_t* PIK_RESTRICT row = plane.ConstRow(y);
+    for (size_t x = 0; x < plane.xsize(); ++x) {
+      if ((row[x] != 0) != (current != 0)) {
+        AppendVarint(run, &runs);
+        current = row[x];
+        run = 0;
+      }
+      ++run;
+    }
+  }
+  AppendVarint(run, &runs);
+  int quality = params.fast_mode ? 9 : 11;
+  return BrotliCompress(quality, runs, out);
+}
+
+bool DecodeBinaryAlpha(const std::vector<uint8_t>& encoded, const int bit_depth,
+                       ImageU* plane) {
+  const size_t xsize = plane->xsize();
+  const size_t num_pixels = xsize * plane->ysize();
+  // At most one run per pixel plus the initial one, each <= 5 varint bytes.
+  std::vector<uint8_t> runs;
+  size_t bytes_read = 0;
+  if (!BrotliDecompress(encoded.data(), encoded.size(), (num_pixels + 1) * 5,
+                        &bytes_read, &runs)) {
+    return false;
+  }
+
+  const uint16_t opaque = (1 << bit_depth) - 1;
+  uint16_t value = 0;
+  size_t pos = 0;
+  size_t x = 0;
+  size_t y = 0;
+  size_t remaining = num_pixels;
+  while (pos < runs.size()) {
+    size_t run;
+    if (!ReadVarint(runs, &pos, &run) || run > remaining) {
+      return PIK_FAILURE("Invalid binary alpha run");
+    }
+    remaining -= run;
+    // Expand the run, which may span several rows.
+    while (run != 0) {
+      const size_t len = std::min(run, xsize - x);
+      uint16_t* PIK_RESTRICT row = plane->Row(y);
+      std::fill(row + x, row + x + len, value);
+      run -= len;
+      x += len;
+      if (x == xsize) {
+        x = 0;
+        ++y;
+      }
+    }
+    value ^= opaque;
+  }
+  if (remaining != 0) return PIK_FAILURE("Truncated binary alpha");
+  return true;
+}
+
+void FillAlpha(const uint16_t value, ImageU* plane) {
+  for (size_t y = 0; y < plane->ysize(); ++y) {
+    uint16_t* PIK_RESTRICT row = plane->Row(y);
+    std::fill(row, row + plane->xsize(), value);
+  }
+}
+
 struct AlphaRow {
   bool IsOpaque() const {
     return zeros_l == 0 && zeros_r == 0 && border_l.empty() && border_r.empty();
@@ -447,15 +649,49 @@ bool DecodeTransformedAlpha(const std::vector<uint8_t>& data, int bit_depth,
   return true;
 }
 
+// Little-endian value of a kModeConstant section.
+uint16_t ConstantAlphaValue(const Alpha& alpha) {
+  uint16_t value = 0;
+  for (size_t i = 0; i < alpha.encoded.size(); ++i) {
+    value += alpha.encoded[i] << (8 * i);
+  }
+  return value;
+}
+
 }  // namespace
 
 bool AlphaToPik(const CompressParams& params, const ImageU& plane,
-                int bit_depth, std::unique_ptr<Alpha>* out_alpha) {
+                int bit_depth, ThreadPool* pool,
+                std::unique_ptr<Alpha>* out_alpha) {
   std::unique_ptr<Alpha> alpha(new Alpha);
+  alpha->bytes_per_alpha = bit_depth / 8;
+
+  const AlphaKind kind = ClassifyAlpha(plane, bit_depth);
+  if (kind == AlphaKind::kConstant) {
+    const uint16_t value = plane.ConstRow(0)[0];
+    alpha->mode = Alpha::kModeConstant;
+    for (size_t i = 0; i < alpha->bytes_per_alpha; ++i) {
+      alpha->encoded.push_back((value >> (8 * i)) & 255);
+    }
+    out_alpha->swap(alpha);
+    return true;
+  }
 
-  alpha->mode = Alpha::kModeBrotli;
-  if (!FilterAndBrotliEncode(params, plane, bit_depth, &alpha->encoded)) {
-    return false;
+  if (kind == AlphaKind::kBinary) {
+    alpha->mode = Alpha::kModeBinary;
+    if (!EncodeBinaryAlpha(params, plane, &alpha->encoded)) return false;
+  } else if (plane.ysize() > kAlphaGroupHeight) {
+    // Images taller than one group are compressed in parallel.
+    alpha->mode = Alpha::kModeBrotliGroups;
+    if (!EncodeGroups(params, plane, bit_depth, pool, &alpha->encoded)) {
+      return false;
+    }
+  } else {
+    alpha->mode = Alpha::kModeBrotli;
+    if (!FilterAndBrotliEncode(params, plane, bit_depth, 0, plane.ysize(),
+                               &alpha->encoded)) {
+      return false;
+    }
   }
 
   // Try alternative encoding that assumes that the opaque pixels form a convex
@@ -474,8 +710,14 @@ bool AlphaToPik(const CompressParams& params, const ImageU& plane,
   return true;
 }
 
+bool IsOpaqueAlpha(const Alpha& alpha) {
+  if (alpha.mode != Alpha::kModeConstant) return false;
+  if (alpha.encoded.size() != alpha.bytes_per_alpha) return false;
+  return ConstantAlphaValue(alpha) == (1 << (alpha.bytes_per_alpha * 8)) - 1;
+}
+
 bool PikToAlpha(const DecompressParams& params, const Alpha& alpha,
-                ImageU* plane) {
+                ThreadPool* pool, ImageU* plane) {
   if (alpha.mode >= Alpha::kModeInvalid) {
     return PIK_FAILURE("Invalid alpha mode");
   }
@@ -485,7 +727,21 @@ bool PikToAlpha(const DecompressParams& params, const Alpha& alpha,
 
   const int bit_depth = alpha.bytes_per_alpha * 8;
   if (alpha.mode == Alpha::kModeBrotli) {
-    return BrotliDecodeAndUnfilter(alpha.encoded, bit_depth, plane);
+    return BrotliDecodeAndUnfilter(alpha.encoded.data(), alpha.encoded.size(),
+                                   bit_depth, 0, plane->ysize(), plane);
+  }
+  if (alpha.mode == Alpha::kModeBrotliGroups) {
+    return DecodeGroups(alpha.encoded, bit_depth, pool, plane);
+  }
+  if (alpha.mode == Alpha::kModeConstant) {
+    if (alpha.encoded.size() != alpha.bytes_per_alpha) {
+      return PIK_FAILURE("Invalid constant alpha");
+    }
+    FillAlpha(ConstantAlphaValue(alpha), plane);
+    return true;
+  }
+  if (alpha.mode == Alpha::kModeBinary) {
+    return DecodeBinaryAlpha(alpha.encoded, bit_depth, plane);
   }
 
   AlphaImage tr_alpha(plane->xsize(), plane->ysize());
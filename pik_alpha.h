@@ -16,18 +16,24 @@
 #define PIK_ALPHA_H_
 
 #include <memory>
+#include "data_parallel.h"
 #include "image.h"
 #include "pik_params.h"
 #include "sections.h"
 
 namespace pik {
 
+// Images taller than one group are split into bands of rows that are
+// compressed (and later decompressed) independently on "pool".
 bool AlphaToPik(const CompressParams& params, const ImageU& plane,
-                int bit_depth, std::unique_ptr<Alpha>* alpha);
+                int bit_depth, ThreadPool* pool, std::unique_ptr<Alpha>* alpha);
+
+// Returns whether all alpha values are known to be opaque without decoding.
+bool IsOpaqueAlpha(const Alpha& alpha);
 
 // "plane" must be pre-allocated (Header knows the size).
 bool PikToAlpha(const DecompressParams& params, const Alpha& alpha,
-                ImageU* plane);
+                ThreadPool* pool, ImageU* plane);
 
 }  // namespace pik
 
@@ -0,0 +1,227 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pik_archive.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "byte_order.h"
+#include "status.h"
+
+namespace pik {
+namespace {
+
+constexpr uint8_t kMagic[4] = {'P', 'I', 'K', 'A'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 24;
+
+// u64 key_offset, offset, size; u32 key_size, xsize, ysize, num_components,
+// bitstream, has_alpha.
+constexpr size_t kRecordSize = 48;
+
+void Store32(const uint32_t value, uint8_t* bytes) {
+  const uint32_t le = PIK_BYTE_ORDER_LITTLE ? value : PIK_BSWAP32(value);
+  memcpy(bytes, &le, 4);
+}
+
+void Store64(const uint64_t value, uint8_t* bytes) {
+  const uint64_t le = PIK_BYTE_ORDER_LITTLE ? value : PIK_BSWAP64(value);
+  memcpy(bytes, &le, 8);
+}
+
+uint32_t Load32(const uint8_t* bytes) {
+  uint32_t le;
+  memcpy(&le, bytes, 4);
+  return PIK_BYTE_ORDER_LITTLE ? le : PIK_BSWAP32(le);
+}
+
+uint64_t Load64(const uint8_t* bytes) {
+  uint64_t le;
+  memcpy(&le, bytes, 8);
+  return PIK_BYTE_ORDER_LITTLE ? le : PIK_BSWAP64(le);
+}
+
+// Returns <0, 0 or >0 like memcmp, ordering shorter prefixes first.
+int CompareKeys(const uint8_t* key1, size_t size1, const uint8_t* key2,
+                size_t size2) {
+  const int cmp = memcmp(key1, key2, std::min(size1, size2));
+  if (cmp != 0) return cmp;
+  return size1 < size2 ? -1 : (size1 > size2 ? 1 : 0);
+}
+
+}  // namespace
+
+PikArchiveWriter::PikArchiveWriter(PositionedByteSink* sink)
+    : sink_(sink), pos_(kHeaderSize) {}
+
+bool PikArchiveWriter::Add(const std::string& key, const uint8_t* compressed,
+                           const size_t size) {
+  Entry entry;
+  if (!PikProbe(compressed, size, &entry.info)) {
+    return PIK_FAILURE("Invalid stream for archive");
+  }
+  if (!sink_->WriteAt(pos_, compressed, size)) {
+    return PIK_FAILURE("Failed to write archive entry");
+  }
+  entry.key = key;
+  entry.offset = pos_;
+  entry.size = size;
+  entries_.push_back(std::move(entry));
+  pos_ += size;
+  return true;
+}
+
+bool PikArchiveWriter::Finish() {
+  std::sort(entries_.begin(), entries_.end(),
+            [](const Entry& a, const Entry& b) { return a.key < b.key; });
+  for (size_t i = 1; i < entries_.size(); ++i) {
+    if (entries_[i - 1].key == entries_[i].key) {
+      return PIK_FAILURE("Duplicate archive key");
+    }
+  }
+
+  const uint64_t index_offset = pos_;
+  size_t index_size = entries_.size() * kRecordSize;
+  for (const Entry& entry : entries_) index_size += entry.key.size();
+  std::vector<uint8_t> index(index_size);
+
+  uint64_t key_offset = index_offset + entries_.size() * kRecordSize;
+  uint8_t* record = index.data();
+  for (const Entry& entry : entries_) {
+    Store64(key_offset, record + 0);
+    Store64(entry.offset, record + 8);
+    Store64(entry.size, record + 16);
+    Store32(entry.key.size(), record + 24);
+    Store32(entry.info.xsize, record + 28);
+    Store32(entry.info.ysize, record + 32);
+    Store32(entry.info.num_components, record + 36);
+    Store32(entry.info.bitstream, record + 40);
+    Store32(entry.info.has_alpha, record + 44);
+    memcpy(index.data() + (key_offset - index_offset), entry.key.data(),
+           entry.key.size());
+    key_offset += entry.key.size();
+    record += kRecordSize;
+  }
+
+  uint8_t header[kHeaderSize];
+  memcpy(header, kMagic, 4);
+  Store32(kVersion, header + 4);
+  Store64(entries_.size(), header + 8);
+  Store64(index_offset, header + 16);
+
+  if (!sink_->WriteAt(index_offset, index.data(), index.size()) ||
+      !sink_->WriteAt(0, header, kHeaderSize)) {
+    return PIK_FAILURE("Failed to write archive index");
+  }
+  return true;
+}
+
+bool PikArchive::Open(const std::string& pathname) {
+  if (!file_.Open(pathname)) return PIK_FAILURE("Failed to open archive");
+  const uint8_t* data = file_.data();
+  const uint64_t size = file_.size();
+  if (size < kHeaderSize || memcmp(data, kMagic, 4) != 0) {
+    return PIK_FAILURE("Not an archive");
+  }
+  if (Load32(data + 4) != kVersion) {
+    return PIK_FAILURE("Unsupported archive version");
+  }
+  const uint64_t num_entries = Load64(data + 8);
+  const uint64_t index_offset = Load64(data + 16);
+  if (index_offset < kHeaderSize || index_offset > size ||
+      num_entries > (size - index_offset) / kRecordSize) {
+    return PIK_FAILURE("Invalid archive index");
+  }
+  num_entries_ = num_entries;
+  records_ = data + index_offset;
+
+  // Validate once so that Find and View need not check bounds.
+  for (size_t i = 0; i < num_entries_; ++i) {
+    const uint8_t* record = Record(i);
+    const uint64_t key_offset = Load64(record + 0);
+    const uint64_t offset = Load64(record + 8);
+    const uint64_t entry_size = Load64(record + 16);
+    const uint64_t key_size = Load32(record + 24);
+    if (key_offset > size || key_size > size - key_offset ||
+        offset < kHeaderSize || offset > index_offset ||
+        entry_size > index_offset - offset) {
+      num_entries_ = 0;
+      return PIK_FAILURE("Invalid archive record");
+    }
+    if (i != 0) {
+      const uint8_t* prev = Record(i - 1);
+      if (CompareKeys(data + Load64(prev + 0), Load32(prev + 24),
+                      data + key_offset, key_size) >= 0) {
+        num_entries_ = 0;
+        return PIK_FAILURE("Archive keys are not sorted");
+      }
+    }
+  }
+  return true;
+}
+
+const uint8_t* PikArchive::Record(const size_t i) const {
+  return records_ + i * kRecordSize;
+}
+
+void PikArchive::ParseRecord(const size_t i, PikArchiveEntry* entry) const {
+  const uint8_t* record = Record(i);
+  entry->offset = Load64(record + 8);
+  entry->size = Load64(record + 16);
+  entry->info.xsize = Load32(record + 28);
+  entry->info.ysize = Load32(record + 32);
+  entry->info.num_components = Load32(record + 36);
+  entry->info.bitstream = Load32(record + 40);
+  entry->info.has_alpha = Load32(record + 44) != 0;
+}
+
+std::string PikArchive::Key(const size_t i) const {
+  PIK_ASSERT(i < num_entries_);
+  const uint8_t* record = Record(i);
+  const char* key =
+      reinterpret_cast<const char*>(file_.data() + Load64(record + 0));
+  return std::string(key, Load32(record + 24));
+}
+
+bool PikArchive::Find(const std::string& key, PikArchiveEntry* entry) const {
+  const uint8_t* key_bytes = reinterpret_cast<const uint8_t*>(key.data());
+  // Binary search over [begin, end).
+  size_t begin = 0;
+  size_t end = num_entries_;
+  while (begin < end) {
+    const size_t mid = begin + (end - begin) / 2;
+    const uint8_t* record = Record(mid);
+    const int cmp = CompareKeys(file_.data() + Load64(record + 0),
+                                Load32(record + 24), key_bytes, key.size());
+    if (cmp == 0) {
+      ParseRecord(mid, entry);
+      return true;
+    }
+    if (cmp < 0) {
+      begin = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  return false;
+}
+
+PaddedBytes PikArchive::View(const PikArchiveEntry& entry) const {
+  // PaddedBytes::View may read up to 7 bytes past the stream; these are
+  // either within the archive or MappedFile::kPadding.
+  return PaddedBytes::View(file_.data() + entry.offset, entry.size);
+}
+
+}  // namespace pik
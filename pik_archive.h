@@ -0,0 +1,116 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PIK_ARCHIVE_H_
+#define PIK_ARCHIVE_H_
+
+// Container for many small images (e.g. sprites or thumbnails) in one file.
+// Opening a separate file per image is costly when there are thousands; an
+// archive is instead mapped once and its entries are decoded in place.
+//
+// Layout (integers are little-endian):
+//   header: magic "PIKA", u32 version, u64 num_entries, u64 index_offset;
+//   the compressed streams, concatenated;
+//   index: num_entries fixed-size records sorted by key, then the keys.
+// Each record holds the key's offset and size, the stream's offset and size,
+// and its PikBasicInfo, so lookups and dimension queries only touch the index.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "os_specific.h"
+#include "padded_bytes.h"
+#include "pik.h"
+
+namespace pik {
+
+// Appends streams to an archive; they are written as soon as they are added,
+// so only the (small) index is held in memory.
+class PikArchiveWriter {
+ public:
+  // "sink" must outlive the writer.
+  explicit PikArchiveWriter(PositionedByteSink* sink);
+
+  PikArchiveWriter(const PikArchiveWriter&) = delete;
+  PikArchiveWriter& operator=(const PikArchiveWriter&) = delete;
+
+  // Appends the stream "compressed" (e.g. from PixelsToPik) under "key".
+  // Returns false if the stream header is invalid (see PikProbe) or writing
+  // fails. Keys must be unique; this is checked by Finish.
+  bool Add(const std::string& key, const uint8_t* compressed, size_t size);
+
+  // Writes the index and header. Returns false if a key was added more than
+  // once or writing fails. No further calls are allowed.
+  bool Finish();
+
+ private:
+  struct Entry {
+    std::string key;
+    uint64_t offset;
+    uint64_t size;
+    PikBasicInfo info;
+  };
+
+  PositionedByteSink* sink_;  // Not owned.
+  uint64_t pos_;              // Where the next stream will be written.
+  std::vector<Entry> entries_;
+};
+
+// Location and properties of one stream within a PikArchive.
+struct PikArchiveEntry {
+  uint64_t offset = 0;  // [bytes] from the start of the archive.
+  uint64_t size = 0;    // [bytes]
+  PikBasicInfo info;
+};
+
+// Read-only access to an archive. Thread-safe after Open.
+class PikArchive {
+ public:
+  PikArchive() {}
+
+  PikArchive(const PikArchive&) = delete;
+  PikArchive& operator=(const PikArchive&) = delete;
+
+  // Maps the file and validates the header and index (but not the streams).
+  // Returns false if the file cannot be read or is not a valid archive.
+  bool Open(const std::string& pathname);
+
+  size_t NumEntries() const { return num_entries_; }
+
+  // Returns the key of the i-th entry (in sorted order), i < NumEntries().
+  std::string Key(size_t i) const;
+
+  // Returns false if "key" is not present, otherwise copies its location and
+  // properties from the index to "entry" without reading the stream.
+  bool Find(const std::string& key, PikArchiveEntry* entry) const;
+
+  // Returns a non-owning view of the stream described by "entry" (from Find),
+  // suitable for PikToPixels without copying. It remains valid as long as
+  // this archive.
+  PaddedBytes View(const PikArchiveEntry& entry) const;
+
+ private:
+  const uint8_t* Record(size_t i) const;
+  void ParseRecord(size_t i, PikArchiveEntry* entry) const;
+
+  MappedFile file_;
+  size_t num_entries_ = 0;
+  const uint8_t* records_ = nullptr;
+};
+
+}  // namespace pik
+
+#endif  // PIK_ARCHIVE_H_
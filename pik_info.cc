@@ -1,7 +1,36 @@
 #include "pik_info.h"
 
+#include "cache_aligned.h"
+#include "os_specific.h"
+#include "tsc_timer.h"
+
 namespace pik {
 
+PikStageTimer::PikStageTimer(PikInfo* info, const int stage)
+    : info_(info), stage_(stage) {
+  if (info_ == nullptr) return;
+  live0_ = AllocationStats::LiveBytes();
+  outer_peak_ = AllocationStats::PeakBytes();
+  AllocationStats::SetPeakBytes(live0_);
+  t0_ = Now();
+  c0_ = Start<uint64_t>();
+}
+
+PikStageTimer::~PikStageTimer() {
+  if (info_ == nullptr) return;
+  const uint64_t c1 = Stop<uint64_t>();
+  const double t1 = Now();
+  PikStageTiming& timing = info_->stages[stage_];
+  ++timing.num_calls;
+  timing.seconds += t1 - t0_;
+  timing.cycles += c1 - c0_;
+
+  const size_t peak = AllocationStats::PeakBytes();
+  AllocationStats::SetPeakBytes(std::max(outer_peak_, peak));
+  timing.peak_bytes = std::max(timing.peak_bytes, peak);
+  timing.added_bytes = std::max(timing.added_bytes, peak - live0_);
+}
+
 void PikInfo::DumpCoeffImage(const char* label,
                     const Image3S& coeff_image) const {
   PIK_ASSERT(coeff_image.xsize() % 64 == 0);
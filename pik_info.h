@@ -15,14 +15,20 @@
 #ifndef PIK_INFO_H_
 #define PIK_INFO_H_
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <new>
 #include <vector>
+#include "cache_aligned.h"
 #include "image.h"
 #include "image_io.h"
 
 namespace pik {
 
+struct Token;  // entropy_coder.h
+
 struct PikImageSizeInfo {
   PikImageSizeInfo() {}
 
@@ -53,6 +59,52 @@ struct PikImageSizeInfo {
   double clustered_entropy = 0.0f;
 };
 
+// Per-thread PikImageSizeInfo for parallel encoder stages. Each thread only
+// updates its own shard, and shards occupy separate cache lines, so gathering
+// statistics needs neither locks nor causes false sharing between threads.
+class PikImageSizeInfoShards {
+ public:
+  // Zero "num_shards" disables statistics: Get returns nullptr.
+  explicit PikImageSizeInfoShards(const size_t num_shards)
+      : num_shards_(num_shards),
+        shards_(num_shards == 0 ? CacheAlignedUniquePtr()
+                                : AllocateArray(num_shards * kStride)) {
+    for (size_t i = 0; i < num_shards_; ++i) {
+      new (shards_.get() + i * kStride) PikImageSizeInfo();
+    }
+  }
+
+  PikImageSizeInfoShards(const PikImageSizeInfoShards&) = delete;
+  PikImageSizeInfoShards& operator=(const PikImageSizeInfoShards&) = delete;
+
+  // Returns the shard of pool thread "thread" (< num_shards), or nullptr.
+  PikImageSizeInfo* Get(const int thread) const {
+    if (num_shards_ == 0) return nullptr;
+    PIK_ASSERT(static_cast<size_t>(thread) < num_shards_);
+    return reinterpret_cast<PikImageSizeInfo*>(shards_.get() +
+                                               thread * kStride);
+  }
+
+  // Adds all shards to "info" (if not null) and resets them, typically after
+  // each stage. Must not race with updates.
+  void MergeInto(PikImageSizeInfo* info) const {
+    for (size_t i = 0; i < num_shards_; ++i) {
+      PikImageSizeInfo* shard = Get(i);
+      if (info != nullptr) info->Assimilate(*shard);
+      *shard = PikImageSizeInfo();
+    }
+  }
+
+ private:
+  static constexpr size_t kStride =
+      (sizeof(PikImageSizeInfo) + CacheAligned::kCacheLineSize - 1) /
+      CacheAligned::kCacheLineSize * CacheAligned::kCacheLineSize;
+
+  const size_t num_shards_;
+  // PikImageSizeInfo is trivially destructible, so freeing suffices.
+  CacheAlignedUniquePtr shards_;
+};
+
 static const int kNumImageLayers = 7;
 static const int kLayerHeader = 0;
 static const int kLayerSections = 1;
@@ -64,18 +116,79 @@ static const int kLayerAC = 6;
 static const char* kImageLayers[kNumImageLayers] = {
     "header", "sections", "quant", "order", "ctan", "DC", "AC"};
 
+// Time spent in one encoder or decoder stage, see PikStageTimer.
+struct PikStageTiming {
+  void Assimilate(const PikStageTiming& victim) {
+    num_calls += victim.num_calls;
+    seconds += victim.seconds;
+    cycles += victim.cycles;
+    peak_bytes = std::max(peak_bytes, victim.peak_bytes);
+    added_bytes = std::max(added_bytes, victim.added_bytes);
+  }
+  void Print(size_t num_inputs) const {
+    printf("%8.2f x %10.3f ms %15.0f cycles %9.2f MiB peak (+%.2f)\n",
+           num_calls * 1.0 / num_inputs, seconds * 1E3 / num_inputs,
+           cycles * 1.0 / num_inputs, peak_bytes / (1024.0 * 1024),
+           added_bytes / (1024.0 * 1024));
+  }
+  size_t num_calls = 0;
+  double seconds = 0.0;  // Wall-clock.
+  uint64_t cycles = 0;   // Invariant TSC ticks.
+  // Maximum over all calls of AllocationStats::PeakBytes during the stage,
+  // and of its increase over LiveBytes at the start of the stage.
+  size_t peak_bytes = 0;
+  size_t added_bytes = 0;
+};
+
+static const int kNumStages = 9;
+static const int kStageOpsin = 0;
+static const int kStageQuantSearch = 1;  // One call per search iteration.
+static const int kStageCoefficients = 2;
+static const int kStageEncode = 3;  // Entropy coding.
+static const int kStageDecode = 4;  // Entropy decoding.
+static const int kStageRecon = 5;   // Including color conversion if fused.
+static const int kStageDenoise = 6;
+static const int kStageNoise = 7;
+static const int kStageColor = 8;
+static const char* kStages[kNumStages] = {
+    "opsin", "quant search", "coefficients", "encode", "decode",
+    "recon", "EPF",          "noise",        "color"};
+
 // Metadata and statistics gathered during compression or decompression.
 struct PikInfo {
-  PikInfo() : layers(kNumImageLayers), num_dict_matches(3) {}
+  PikInfo()
+      : layers(kNumImageLayers), num_dict_matches(3), stages(kNumStages) {}
   void Assimilate(const PikInfo& victim) {
     for (int i = 0; i < layers.size(); ++i) {
       layers[i].Assimilate(victim.layers[i]);
     }
+    for (int i = 0; i < stages.size(); ++i) {
+      stages[i].Assimilate(victim.stages[i]);
+    }
     for (int c = 0; c < 3; ++c) {
       num_dict_matches[c] += victim.num_dict_matches[c];
     }
     num_blocks += victim.num_blocks;
     num_butteraugli_iters += victim.num_butteraugli_iters;
+    num_pred_cache_hits += victim.num_pred_cache_hits;
+    num_pred_cache_misses += victim.num_pred_cache_misses;
+    num_search_timeouts += victim.num_search_timeouts;
+    for (size_t i = 0; i < victim.search_tiles.size(); ++i) {
+      AddSearchIteration(i, victim.search_active_tiles[i],
+                         victim.search_tiles[i]);
+    }
+    max_timeout_distance =
+        std::max(max_timeout_distance, victim.max_timeout_distance);
+  }
+  // Records the number of active (not yet converged) and all tiles of
+  // quantization search iteration "iter".
+  void AddSearchIteration(size_t iter, size_t num_active, size_t num_tiles) {
+    if (search_tiles.size() <= iter) {
+      search_tiles.resize(iter + 1);
+      search_active_tiles.resize(iter + 1);
+    }
+    search_active_tiles[iter] += num_active;
+    search_tiles[iter] += num_tiles;
   }
   PikImageSizeInfo TotalImageSize() const {
     PikImageSizeInfo total;
@@ -89,6 +202,22 @@ struct PikInfo {
     if (num_inputs == 0) return;
     printf("Average butteraugli iters: %10.2f\n",
            num_butteraugli_iters * 1.0 / num_inputs);
+    if (num_pred_cache_hits + num_pred_cache_misses != 0) {
+      printf("Prediction cache hits/misses: %zu/%zu\n", num_pred_cache_hits,
+             num_pred_cache_misses);
+    }
+    if (num_search_timeouts != 0) {
+      printf("Searches stopped by time budget: %zu (max distance %.4f)\n",
+             num_search_timeouts, max_timeout_distance);
+    }
+    if (!search_tiles.empty()) {
+      printf("Active search tiles per iter:");
+      for (size_t i = 0; i < search_tiles.size(); ++i) {
+        if (search_tiles[i] == 0) continue;
+        printf(" %.1f%%", search_active_tiles[i] * 100.0 / search_tiles[i]);
+      }
+      printf("\n");
+    }
     if (num_dict_matches[0] + num_dict_matches[1] + num_dict_matches[2] > 0) {
       printf("Average dictionary matches: %9.2f%% %9.2f%% %9.2f%%\n",
              num_dict_matches[0] * 100.0f / num_blocks,
@@ -103,6 +232,18 @@ struct PikInfo {
     }
     printf("Total image size           ");
     TotalImageSize().Print(num_inputs);
+    PrintStages(num_inputs);
+  }
+
+  // Prints the average time per input of all stages that ran.
+  void PrintStages(size_t num_inputs) const {
+    if (num_inputs == 0) return;
+    for (int i = 0; i < stages.size(); ++i) {
+      if (stages[i].num_calls != 0) {
+        printf("Stage %-21s", kStages[i]);
+        stages[i].Print(num_inputs);
+      }
+    }
   }
 
   template <typename Img>
@@ -122,14 +263,52 @@ struct PikInfo {
 
   std::vector<PikImageSizeInfo> layers;
   std::vector<int> num_dict_matches;
+  std::vector<PikStageTiming> stages;
   std::size_t num_blocks = 0;
   int num_butteraugli_iters = 0;
+  // ComputeCoefficients calls that reused/recomputed the DC prediction.
+  size_t num_pred_cache_hits = 0;
+  size_t num_pred_cache_misses = 0;
+  // Quantization searches stopped by CompressParams::time_budget_ms, and the
+  // largest butteraugli distance they had reached by then.
+  size_t num_search_timeouts = 0;
+  float max_timeout_distance = 0.0f;
+  // Per quantization search iteration: summed numbers of tiles whose
+  // quantization could still change (not converged), and of all tiles.
+  std::vector<size_t> search_active_tiles;
+  std::vector<size_t> search_tiles;
   size_t decoded_size = 0;
+  // If not null, the encoder adds the counts of its AC tokens to this (see
+  // AddStaticContextCounts); used by train_static_histograms.
+  std::vector<uint64_t>* static_context_counts = nullptr;
+  // If not null, receives the AC tokens of all groups, in group order; used by
+  // pik_kernels_benchmark.
+  std::vector<std::vector<Token> >* ac_tokens = nullptr;
   // If not empty, additional debugging information (e.g. debug images) is
   // saved in files with this prefix.
   std::string debug_prefix;
 };
 
+// Adds the time between its construction and destruction, and the peak memory
+// allocated meanwhile, to a stage of "info" (if not null). Cheap enough to
+// always use: two clock reads per stage. Must not be used inside pool tasks.
+class PikStageTimer {
+ public:
+  PikStageTimer(PikInfo* info, int stage);
+  ~PikStageTimer();
+
+  PikStageTimer(const PikStageTimer&) = delete;
+  PikStageTimer& operator=(const PikStageTimer&) = delete;
+
+ private:
+  PikInfo* info_;
+  int stage_;
+  double t0_ = 0.0;
+  uint64_t c0_ = 0;
+  size_t live0_ = 0;
+  size_t outer_peak_ = 0;  // Restored afterwards, see SetPeakBytes.
+};
+
 // Used to skip image creation if they won't be written to debug directory.
 static inline bool WantDebugOutput(const PikInfo* info) {
   // Need valid pointer and filename.
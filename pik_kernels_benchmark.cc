@@ -0,0 +1,693 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the timestamp ticks per block, pixel or symbol of the hot encoder
+// and decoder kernels on a synthetic image, for each SIMD target they are
+// compiled for, and reports robust statistics as CSV or JSON, e.g. for
+// tracking kernel speed across versions.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string>
+#include <thread>  //NOLINT
+#include <vector>
+
+#include "af_edge_preserving_filter.h"
+#include "ans_decode.h"
+#include "args.h"
+#include "bit_reader.h"
+#include "common.h"
+#include "compressed_image.h"
+#include "data_parallel.h"
+#include "dc_predictor.h"
+#include "dct.h"
+#include "entropy_coder.h"
+#include "huffman_decode.h"
+#include "huffman_encode.h"
+#include "image.h"
+#include "image_io.h"
+#include "noise.h"
+#include "opsin_image.h"
+#include "opsin_inverse.h"
+#include "padded_bytes.h"
+#include "pik.h"
+#include "pik_info.h"
+#include "pik_params.h"
+#include "prevent_elision.h"
+#include "quantizer.h"
+#include "robust_statistics.h"
+#include "simd/dispatch.h"
+#include "tile_flow.h"
+#include "tsc_timer.h"
+#include "write_bits.h"
+
+namespace pik {
+namespace {
+
+// Unmeasured repetitions before each measurement (page faults, caches).
+constexpr size_t kWarmupReps = 2;
+
+// Symbols of the entropy decoding benchmarks are in [0, kAlphabetSize).
+constexpr size_t kAlphabetSize = 16;
+constexpr size_t kNumSymbolContexts = 3;
+
+struct BenchmarkArgs {
+  bool Init(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      if (arg == "--xsize") {
+        if (!ParseUnsigned(argc, argv, &i, &xsize)) return false;
+      } else if (arg == "--ysize") {
+        if (!ParseUnsigned(argc, argv, &i, &ysize)) return false;
+      } else if (arg == "--num_reps") {
+        if (!ParseUnsigned(argc, argv, &i, &num_reps)) return false;
+      } else if (arg == "--num_threads") {
+        if (!ParseUnsigned(argc, argv, &i, &num_threads)) return false;
+      } else if (arg == "--filter" && i + 1 < argc) {
+        filter = argv[++i];
+      } else if (arg == "--input" && i + 1 < argc) {
+        input = argv[++i];
+      } else if (arg == "--json") {
+        json = true;
+      } else {
+        fprintf(stderr, "Unrecognized argument: %s.\n", argv[i]);
+        return false;
+      }
+    }
+    // All kernels operate on whole blocks.
+    xsize = std::max<size_t>(DivCeil(xsize, kBlockWidth), 1) * kBlockWidth;
+    ysize = std::max<size_t>(DivCeil(ysize, kBlockHeight), 1) * kBlockHeight;
+    if (num_reps == 0) num_reps = 1;
+    return true;
+  }
+
+  static const char* HelpFormatString() {
+    return "Usage: %s [--xsize N] [--ysize N] [--num_reps N] [--filter S]\n"
+           "  [--num_threads N] [--input FILE] [--json]\n"
+           "  Runs each kernel on an N x N synthetic image (rounded up to\n"
+           "  whole blocks, default 512 x 512) for all SIMD targets it is\n"
+           "  compiled for and supported by the CPU, and prints one CSV (or\n"
+           "  JSON) record per kernel and target with the median, median\n"
+           "  absolute deviation and mode of the ticks per unit over\n"
+           "  --num_reps (default 31) runs.\n"
+           "  --filter S: only kernels whose name contains S.\n"
+           "  --num_threads N: workers of the ThreadPool* cases, which\n"
+           "  measure the overhead per Run (default: number of CPUs).\n"
+           "  --input FILE: also measures ANSReadSymbolAC, which decodes the\n"
+           "  AC tokens of FILE encoded at distance 1.\n";
+  }
+
+  size_t xsize = 512;
+  size_t ysize = 512;
+  size_t num_reps = 31;
+  size_t num_threads = std::thread::hardware_concurrency();
+  std::string filter;
+  std::string input;
+  bool json = false;
+};
+
+const char* TargetName(const int target) {
+  switch (target) {
+    case SIMD_NONE:
+      return "none";
+    case SIMD_SSE4:
+      return "sse4";
+    case SIMD_AVX2:
+      return "avx2";
+    case SIMD_AVX512:
+      return "avx512";
+    case SIMD_ARM8:
+      return "arm8";
+    case SIMD_SVE256:
+      return "sve256";
+    case SIMD_WASM:
+      return "wasm";
+  }
+  return "unknown";
+}
+
+// Per-target code is only compiled for the targets in SIMD_ENABLE. Honors
+// PIK_SIMD_TARGETS, e.g. to measure only AVX2.
+int TargetsToMeasure() {
+  return dispatch::EnabledTargets() & SIMD_ENABLE;
+}
+
+struct Result {
+  std::string kernel;
+  std::string target;
+  const char* unit;  // "block", "pixel", "symbol" or "run"
+  size_t num_units;  // per run
+  // Ticks per unit over all runs.
+  double median;
+  double mad;
+  double mode;
+};
+
+// Inputs shared by all kernels, derived from a deterministic synthetic image
+// with smooth gradients, edges and noise.
+struct Inputs {
+  explicit Inputs(const BenchmarkArgs& args);
+
+  size_t xsize;
+  size_t ysize;
+  size_t xsize_blocks;
+  size_t ysize_blocks;
+  Image3B srgb;
+  Image3F opsin;   // CenteredOpsin
+  Image3F coeffs;  // TransposedScaledDCT of opsin
+  Image3S quantized_ac;
+  Image3S dc;
+  Quantizer quantizer;
+  ColorTransform ctan;
+
+  // Symbols in [0, kAlphabetSize) with a roughly geometric distribution, as
+  // for quantized coefficients.
+  std::vector<Token> tokens;
+  // Encoded "tokens" (ANS) and their symbols (Huffman, no contexts). The
+  // histograms are separate so that each run only decodes the data.
+  PaddedBytes ans_histograms;
+  PaddedBytes ans_data;
+  PaddedBytes huffman_histogram;
+  PaddedBytes huffman_data;
+
+  // Reads and encodes the image at "pathname" and encodes its AC tokens (with
+  // all kNumContexts contexts and extra bits) as one group into "ac_*".
+  bool EncodeAC(const std::string& pathname);
+
+  // Empty unless EncodeAC succeeded.
+  std::vector<Token> ac_tokens;
+  PaddedBytes ac_histograms;
+  PaddedBytes ac_data;
+};
+
+// Returns a magnitude in [0, kAlphabetSize) with P(k) ~ 2^-(k+1).
+int GeometricMagnitude(const uint32_t random) {
+  int magnitude = 0;
+  while (magnitude + 1 < kAlphabetSize && (random >> magnitude) & 1) {
+    ++magnitude;
+  }
+  return magnitude;
+}
+
+Inputs::Inputs(const BenchmarkArgs& args)
+    : xsize(args.xsize),
+      ysize(args.ysize),
+      xsize_blocks(xsize / kBlockWidth),
+      ysize_blocks(ysize / kBlockHeight),
+      srgb(xsize, ysize),
+      quantized_ac(xsize_blocks * kBlockSize, ysize_blocks),
+      dc(xsize_blocks, ysize_blocks),
+      quantizer(kQuantDefault, xsize_blocks, ysize_blocks),
+      ctan(xsize, ysize) {
+  // mt19937 (unlike the std distributions) is fully specified, so the inputs
+  // are the same for all toolchains.
+  std::mt19937 rng(12345);
+  for (int c = 0; c < 3; ++c) {
+    for (size_t y = 0; y < ysize; ++y) {
+      uint8_t* PIK_RESTRICT row = srgb.PlaneRow(c, y);
+      for (size_t x = 0; x < xsize; ++x) {
+        const int gradient = (x * (c + 1) * 255 / xsize + y * 128 / ysize) / 2;
+        const int edge = ((x / 37 + y / 53) % 3 == 0) ? 64 : 0;
+        const int noise = static_cast<int>(rng() % 17) - 8;
+        row[x] = static_cast<uint8_t>(
+            std::min(std::max(gradient + edge + noise, 0), 255));
+      }
+    }
+  }
+
+  ThreadPool serial(0);
+  opsin = CenteredOpsin(OpsinDynamicsImage(srgb, &serial),
+                        /*gaborish_inverse=*/false, &serial);
+  coeffs = TransposedScaledDCT(opsin, &serial);
+
+  quantizer.SetQuant(1.0f);
+  for (int c = 0; c < 3; ++c) {
+    for (size_t by = 0; by < ysize_blocks; ++by) {
+      int16_t* PIK_RESTRICT row_ac = quantized_ac.PlaneRow(c, by);
+      int16_t* PIK_RESTRICT row_dc = dc.PlaneRow(c, by);
+      const uint8_t* PIK_RESTRICT row_srgb =
+          srgb.ConstPlaneRow(c, by * kBlockHeight);
+      for (size_t i = 0; i < xsize_blocks * kBlockSize; ++i) {
+        const uint32_t random = rng();
+        const int magnitude = GeometricMagnitude(random >> 1);
+        row_ac[i] = (random & 1) ? -magnitude : magnitude;
+      }
+      for (size_t bx = 0; bx < xsize_blocks; ++bx) {
+        row_dc[bx] = row_srgb[bx * kBlockWidth] - 128;
+      }
+    }
+  }
+
+  std::vector<std::vector<Token>> all_tokens(1);
+  const size_t num_symbols = xsize_blocks * ysize_blocks * kBlockSize;
+  all_tokens[0].reserve(num_symbols);
+  std::vector<uint32_t> histogram(kAlphabetSize);
+  for (size_t i = 0; i < num_symbols; ++i) {
+    const int symbol = GeometricMagnitude(rng());
+    all_tokens[0].emplace_back(i % kNumSymbolContexts, symbol, 0, 0);
+    ++histogram[symbol];
+  }
+  tokens = all_tokens[0];
+
+  std::vector<ANSEncodingData> codes;
+  std::vector<uint8_t> context_map;
+  const std::string encoded_histograms = BuildAndEncodeHistograms(
+      kNumSymbolContexts, all_tokens, &codes, &context_map, nullptr);
+  ans_histograms.resize(encoded_histograms.size());
+  memcpy(ans_histograms.data(), encoded_histograms.data(),
+         encoded_histograms.size());
+  WriteTokens(tokens, codes, context_map, nullptr, &ans_data);
+
+  uint8_t depths[kAlphabetSize];
+  uint16_t bits[kAlphabetSize];
+  huffman_histogram.resize(4096);
+  memset(huffman_histogram.data(), 0, huffman_histogram.size());
+  size_t storage_ix = 0;
+  BuildAndStoreHuffmanTree(histogram.data(), kAlphabetSize, depths, bits,
+                           &storage_ix, huffman_histogram.data());
+  WriteZeroesToByteBoundary(&storage_ix, huffman_histogram.data());
+  huffman_histogram.resize(storage_ix / kBitsPerByte);
+
+  // Upper bound: kHuffmanMaxLength bits per symbol.
+  huffman_data.resize(num_symbols * 2 + 8);
+  memset(huffman_data.data(), 0, huffman_data.size());
+  storage_ix = 0;
+  for (const Token& token : tokens) {
+    WriteBits(depths[token.symbol], bits[token.symbol], &storage_ix,
+              huffman_data.data());
+  }
+  WriteZeroesToByteBoundary(&storage_ix, huffman_data.data());
+  huffman_data.resize(storage_ix / kBitsPerByte);
+}
+
+bool Inputs::EncodeAC(const std::string& pathname) {
+  MetaImageB image;
+  if (!ReadMetaImageSrgb8(pathname, &image)) {
+    fprintf(stderr, "Failed to read %s.\n", pathname.c_str());
+    return false;
+  }
+  CompressParams params;
+  std::vector<std::vector<Token>> all_tokens;
+  PikInfo info;
+  info.ac_tokens = &all_tokens;
+  ThreadPool serial(0);
+  PaddedBytes compressed;
+  if (!PixelsToPik(params, image, &serial, &compressed, &info)) {
+    fprintf(stderr, "Failed to compress %s.\n", pathname.c_str());
+    return false;
+  }
+
+  for (const std::vector<Token>& group_tokens : all_tokens) {
+    ac_tokens.insert(ac_tokens.end(), group_tokens.begin(),
+                     group_tokens.end());
+  }
+  all_tokens.assign(1, ac_tokens);
+  std::vector<ANSEncodingData> codes;
+  std::vector<uint8_t> context_map;
+  const std::string encoded_histograms = BuildAndEncodeHistograms(
+      kNumContexts, all_tokens, &codes, &context_map, nullptr);
+  ac_histograms.resize(encoded_histograms.size());
+  memcpy(ac_histograms.data(), encoded_histograms.data(),
+         encoded_histograms.size());
+  WriteTokens(ac_tokens, codes, context_map, nullptr, &ac_data);
+  return true;
+}
+
+// Calls the TFFunc of a TileFlow node with the whole (pre-allocated) "out" as
+// its single tile, so that only the kernel itself is measured.
+class WholeImageNode {
+ public:
+  WholeImageNode(const TFFunc func, const Image3F& in, Image3F* out)
+      : func_(func) {
+    for (int c = 0; c < 3; ++c) {
+      in_[c].Init(in.Plane(c));
+      out_[c].Init(reinterpret_cast<uint8_t*>(out->PlaneRow(c, 0)),
+                   out->Plane(c).bytes_per_row());
+    }
+    region_.x = region_.y = 0;
+    region_.xsize = region_.partial_xsize = out->xsize();
+    region_.ysize = region_.partial_ysize = out->ysize();
+  }
+
+  void operator()() const { func_(nullptr, in_, region_, out_); }
+
+ private:
+  const TFFunc func_;
+  ConstImageViewF in_[3];
+  MutableImageViewF out_[3];
+  OutputRegion region_;
+};
+
+class Benchmark {
+ public:
+  Benchmark(const BenchmarkArgs& args, const Inputs& inputs)
+      : args_(args), inputs_(inputs) {}
+
+  // Returns whether "kernel" was selected via --filter.
+  bool Enabled(const char* kernel) const {
+    return args_.filter.empty() ||
+           std::string(kernel).find(args_.filter) != std::string::npos;
+  }
+
+  // Runs "setup" (unmeasured) and then "func" args_.num_reps times, and
+  // appends the ticks per unit to results().
+  template <class Setup, class Func>
+  void Measure(const char* kernel, const int target, const char* unit,
+               const size_t num_units, const Setup& setup, const Func& func) {
+    if (!Enabled(kernel)) return;
+    std::vector<int64_t> ticks;
+    ticks.reserve(args_.num_reps);
+    for (size_t rep = 0; rep < kWarmupReps + args_.num_reps; ++rep) {
+      setup();
+      const uint64_t t0 = Start<uint64_t>();
+      func();
+      const uint64_t t1 = Stop<uint64_t>();
+      if (rep >= kWarmupReps) ticks.push_back(t1 - t0);
+    }
+    std::sort(ticks.begin(), ticks.end());
+    const int64_t mode = Mode(ticks.data(), ticks.size());
+    const int64_t median = Median(&ticks);
+    const int64_t mad = MedianAbsoluteDeviation(ticks, median);
+
+    Result result;
+    result.kernel = kernel;
+    result.target = TargetName(target);
+    result.unit = unit;
+    result.num_units = num_units;
+    result.median = static_cast<double>(median) / num_units;
+    result.mad = static_cast<double>(mad) / num_units;
+    result.mode = static_cast<double>(mode) / num_units;
+    results_.push_back(result);
+  }
+
+  template <class Func>
+  void Measure(const char* kernel, const int target, const char* unit,
+               const size_t num_units, const Func& func) {
+    Measure(kernel, target, unit, num_units, [] {}, func);
+  }
+
+  // Called via dispatch::ForeachTarget for kernels with per-target code.
+  template <class Target>
+  void operator()() {
+    const int target = Target::value;
+    const size_t num_blocks = inputs_.xsize_blocks * inputs_.ysize_blocks;
+    const size_t num_pixels = inputs_.xsize * inputs_.ysize;
+    ThreadPool serial(0);
+
+    {
+      Image3F coeffs(inputs_.coeffs.xsize(), inputs_.coeffs.ysize());
+      const WholeImageNode dct(
+          TransposedScaledDCTFuncImpl().operator()<Target>(), inputs_.opsin,
+          &coeffs);
+      Measure("DCT", target, "block", num_blocks, dct);
+      PreventElision(coeffs.PlaneRow(0, 0)[0]);
+    }
+
+    {
+      Image3F pixels(inputs_.xsize, inputs_.ysize);
+      const WholeImageNode idct(
+          TransposedScaledIDCTFuncImpl().operator()<Target>(false),
+          inputs_.coeffs, &pixels);
+      Measure("IDCT", target, "block", num_blocks, idct);
+      PreventElision(pixels.PlaneRow(0, 0)[0]);
+    }
+
+    {
+      // ShrinkDC and ExpandDC predict Y, then X and B (interleaved) from Y.
+      const size_t xsize = inputs_.xsize_blocks;
+      const size_t ysize = inputs_.ysize_blocks;
+      const Rect rect(0, 0, xsize, ysize);
+      ImageS xb(xsize * 2, ysize);
+      for (size_t y = 0; y < ysize; ++y) {
+        for (size_t x = 0; x < xsize; ++x) {
+          xb.Row(y)[2 * x + 0] = inputs_.dc.ConstPlaneRow(0, y)[x];
+          xb.Row(y)[2 * x + 1] = inputs_.dc.ConstPlaneRow(2, y)[x];
+        }
+      }
+      ImageS residuals_y(xsize, ysize);
+      ImageS residuals_xb(xsize * 2, ysize);
+      ImageS expanded_y(xsize, ysize);
+      ImageS expanded_xb(xsize * 2, ysize);
+      Measure("ShrinkDC_Y", target, "block", num_blocks, [&] {
+        ShrinkYImpl().operator()<Target>(rect, inputs_.dc.Plane(1), rect,
+                                         &residuals_y);
+      });
+      Measure("ShrinkDC_XB", target, "block", num_blocks, [&] {
+        ShrinkXBImpl().operator()<Target>(rect, inputs_.dc.Plane(1), xb,
+                                          &residuals_xb);
+      });
+      Measure("ExpandDC_Y", target, "block", num_blocks, [&] {
+        ExpandYImpl().operator()<Target>(rect, residuals_y, &expanded_y);
+      });
+      Measure("ExpandDC_XB", target, "block", num_blocks, [&] {
+        ExpandXBImpl().operator()<Target>(xsize, ysize, expanded_y,
+                                          residuals_xb, &expanded_xb);
+      });
+      PreventElision(expanded_xb.Row(0)[0]);
+    }
+
+    {
+      // The decoder's adaptive filter. sigma_mul is chosen such that all
+      // blocks (with the same quantization) are smoothed with kEpfSigma.
+      constexpr int kEpfSigma = 32 << epf::kSigmaShift;
+      std::array<float, 3> min3, max3;
+      Image3MinMax(inputs_.opsin, &min3, &max3);
+      const float min = *std::min_element(min3.begin(), min3.end());
+      const float max = *std::max_element(max3.begin(), max3.end());
+      epf::AdaptiveFilterParams params;
+      params.dc_quant = inputs_.quantizer.RawDC();
+      params.ac_quant = &inputs_.quantizer.RawQuantField();
+      params.sigma_add = 0.0f;
+      params.sigma_mul = 255.0f / (max - min) /
+                         (params.ac_quant->ConstRow(0)[0] * kEpfSigma);
+      // In-place, so each run starts from a fresh copy.
+      Image3F filtered(inputs_.xsize, inputs_.ysize);
+      Measure("EPF", target, "pixel", num_pixels,
+              [&] { CopyImageTo(inputs_.opsin, &filtered); },
+              [&] {
+                epf::EdgePreservingFilter().operator()<Target>(
+                    &filtered, params, &serial, min, max);
+              });
+      PreventElision(filtered.PlaneRow(0, 0)[0]);
+    }
+
+    {
+      Image3B srgb(inputs_.xsize, inputs_.ysize);
+      Measure("CenteredOpsinToSrgb", target, "pixel", num_pixels, [&] {
+        CenteredOpsinToSrgbImpl().operator()<Target>(
+            inputs_.opsin, false, &serial, &srgb, ColorPrimaries::kSRGB);
+      });
+      PreventElision(srgb.PlaneRow(0, 0)[0]);
+    }
+
+    {
+      NoiseParams noise_params;
+      noise_params.alpha = 0.0f;
+      noise_params.gamma = 0.01f;
+      noise_params.beta = 0.02f;
+      Image3F noisy = CopyImage(inputs_.opsin);
+      Measure("AddNoise", target, "pixel", num_pixels, [&] {
+        AddNoiseImpl().operator()<Target>(noise_params, &serial, &noisy);
+      });
+      PreventElision(noisy.PlaneRow(0, 0)[0]);
+    }
+  }
+
+  // Kernels without per-target code, compiled for the default target.
+  void RunDefaultTarget() {
+    const int target = SIMD_TARGET::value;
+    const size_t num_blocks = inputs_.xsize_blocks * inputs_.ysize_blocks;
+    const size_t num_pixels = inputs_.xsize * inputs_.ysize;
+    const size_t num_symbols = inputs_.tokens.size();
+    ThreadPool serial(0);
+
+    {
+      Image3F ac(inputs_.quantized_ac.xsize(), inputs_.quantized_ac.ysize());
+      Measure("DequantAC", target, "block", num_blocks, [&] {
+        DequantizeAC(inputs_.quantizer, inputs_.ctan, inputs_.quantized_ac,
+                     &ac);
+      });
+      PreventElision(ac.PlaneRow(0, 0)[0]);
+    }
+
+    {
+      BitReader histogram_reader(inputs_.ans_histograms.data(),
+                                 inputs_.ans_histograms.size());
+      ANSCode code;
+      std::vector<uint8_t> context_map;
+      PIK_CHECK(DecodeHistograms(&histogram_reader, kNumSymbolContexts,
+                                 kAlphabetSize, nullptr, 0, &code,
+                                 &context_map));
+      Measure("ANSReadSymbol", target, "symbol", num_symbols, [&] {
+        PaddedBitReader reader(inputs_.ans_data.data(),
+                               inputs_.ans_data.size(),
+                               inputs_.ans_data.size());
+        ANSSymbolReader decoder(&code);
+        int checksum = 0;
+        for (size_t i = 0; i < num_symbols; ++i) {
+          reader.FillBitBuffer();
+          checksum +=
+              decoder.ReadSymbol(context_map[i % kNumSymbolContexts], &reader);
+        }
+        PIK_CHECK(decoder.CheckANSFinalState());
+        PreventElision(checksum);
+      });
+    }
+
+    if (!inputs_.ac_tokens.empty()) {
+      // As in DecodeAC, but the number of extra bits to skip is taken from the
+      // tokens instead of being derived from the symbols.
+      const std::vector<Token>& tokens = inputs_.ac_tokens;
+      BitReader histogram_reader(inputs_.ac_histograms.data(),
+                                 inputs_.ac_histograms.size());
+      ANSCode code;
+      std::vector<uint8_t> context_map;
+      PIK_CHECK(DecodeHistograms(&histogram_reader, kNumContexts, 256, nullptr,
+                                 0, &code, &context_map));
+      Measure("ANSReadSymbolAC", target, "symbol", tokens.size(), [&] {
+        PaddedBitReader reader(inputs_.ac_data.data(), inputs_.ac_data.size(),
+                               inputs_.ac_data.size());
+        ANSSymbolReader decoder(&code);
+        int checksum = 0;
+        for (const Token& token : tokens) {
+          reader.FillBitBuffer();
+          checksum += decoder.ReadSymbol(context_map[token.context], &reader);
+          reader.Advance(token.nbits);
+        }
+        PIK_CHECK(decoder.CheckANSFinalState());
+        PreventElision(checksum);
+      });
+    }
+
+    {
+      BitReader histogram_reader(inputs_.huffman_histogram.data(),
+                                 inputs_.huffman_histogram.size());
+      HuffmanDecodingData entropy;
+      PIK_CHECK(entropy.ReadFromBitStream(&histogram_reader));
+      Measure("HuffmanReadSymbol", target, "symbol", num_symbols, [&] {
+        BitReader reader(inputs_.huffman_data.data(),
+                         inputs_.huffman_data.size());
+        HuffmanDecoder decoder;
+        int checksum = 0;
+        for (size_t i = 0; i < num_symbols; ++i) {
+          checksum += decoder.ReadSymbol(entropy, &reader);
+        }
+        PreventElision(checksum);
+      });
+    }
+
+    Measure("OpsinDynamicsImage", target, "pixel", num_pixels, [&] {
+      PreventElision(
+          OpsinDynamicsImage(inputs_.srgb, &serial).PlaneRow(0, 0)[0]);
+    });
+
+    {
+      Image3F blurred(inputs_.xsize, inputs_.ysize);
+      Measure("Gaborish", target, "pixel", num_pixels,
+              [&] { CopyImageTo(inputs_.opsin, &blurred); },
+              [&] { ConvolveGaborish(&serial, &blurred); });
+      PreventElision(blurred.PlaneRow(0, 0)[0]);
+    }
+
+    {
+      // Latency of Run itself (waking the workers, distributing the tasks and
+      // waiting for them): one empty task per worker, and many tiny tasks,
+      // which also reserve chunks and steal. With fewer than two workers,
+      // Run calls the tasks directly.
+      ThreadPool pool(static_cast<int>(args_.num_threads));
+      constexpr size_t kRuns = 100;
+      const int num_workers = std::max<int>(pool.NumThreads(), 1);
+      Measure("ThreadPoolRunEmpty", target, "run", kRuns, [&] {
+        for (size_t i = 0; i < kRuns; ++i) {
+          pool.Run(0, num_workers, [](const int task, const int thread) {});
+        }
+      });
+
+      constexpr int kSmallTasks = 256;
+      const size_t task_xsize = std::min<size_t>(inputs_.xsize, 64);
+      std::vector<float> sums(kSmallTasks);
+      Measure("ThreadPoolRunSmall", target, "run", kRuns, [&] {
+        for (size_t i = 0; i < kRuns; ++i) {
+          pool.Run(0, kSmallTasks, [&](const int task, const int thread) {
+            const float* PIK_RESTRICT row =
+                inputs_.opsin.ConstPlaneRow(0, task % inputs_.ysize);
+            float sum = 0.0f;
+            for (size_t x = 0; x < task_xsize; ++x) sum += row[x];
+            sums[task] = sum;
+          });
+        }
+      });
+      PreventElision(sums[0]);
+    }
+  }
+
+  const std::vector<Result>& results() const { return results_; }
+
+ private:
+  const BenchmarkArgs& args_;
+  const Inputs& inputs_;
+  std::vector<Result> results_;
+};
+
+void PrintCSV(const std::vector<Result>& results) {
+  printf("kernel,target,unit,units,median,mad,mode\n");
+  for (const Result& r : results) {
+    printf("%s,%s,%s,%zu,%.3f,%.3f,%.3f\n", r.kernel.c_str(),
+           r.target.c_str(), r.unit, r.num_units, r.median, r.mad, r.mode);
+  }
+}
+
+void PrintJSON(const std::vector<Result>& results) {
+  printf("[\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    printf("%s  {\"kernel\": \"%s\", \"target\": \"%s\", \"unit\": \"%s\", "
+           "\"units\": %zu, \"median\": %.3f, \"mad\": %.3f, "
+           "\"mode\": %.3f}",
+           i == 0 ? "" : ",\n", r.kernel.c_str(), r.target.c_str(), r.unit,
+           r.num_units, r.median, r.mad, r.mode);
+  }
+  printf("\n]\n");
+}
+
+int RunBenchmark(int argc, char** argv) {
+  BenchmarkArgs args;
+  if (!args.Init(argc, argv)) {
+    fprintf(stderr, BenchmarkArgs::HelpFormatString(), argv[0]);
+    return 1;
+  }
+
+  Inputs inputs(args);
+  if (!args.input.empty() && !inputs.EncodeAC(args.input)) return 1;
+  Benchmark benchmark(args, inputs);
+  dispatch::ForeachTarget(TargetsToMeasure(), benchmark);
+  benchmark.RunDefaultTarget();
+
+  if (args.json) {
+    PrintJSON(benchmark.results());
+  } else {
+    PrintCSV(benchmark.results());
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace pik
+
+int main(int argc, char** argv) { return pik::RunBenchmark(argc, argv); }
@@ -3,9 +3,13 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <atomic>
+#include <string>
 
 namespace pik {
 
+struct ReconHook;  // compressed_image.h
+
 // No effect if kDefault, otherwise forces a feature on or off.
 enum class Override : int {
   kOn = 1,
@@ -13,12 +17,74 @@ enum class Override : int {
   kDefault = -1
 };
 
+// Transfer function and sample format of decoded 16-bit and float pixels.
+// 8-bit outputs are always kSRGB.
+enum class SampleEncoding {
+  // sRGB in [0, 255] (float) or [0, 65535] (16-bit).
+  kSRGB,
+  // Linear light (e.g. for compositing) with the same ranges as kSRGB.
+  kLinear,
+  // Only for 16-bit outputs: IEEE binary16 bit patterns of linear light in
+  // [0, 1], e.g. for half-float textures.
+  kLinearHalf
+};
+
+// Color primaries (all with the D65 white point) of decoded pixels. The
+// transfer function is still selected by SampleEncoding; its kSRGB curve is
+// also that of Display P3.
+enum class ColorPrimaries {
+  kSRGB,
+  kDisplayP3,
+  // ITU-R BT.2020, e.g. with kLinear for HDR compositors.
+  kRec2020
+};
+
+// How 8-bit outputs with an alpha channel are composited during the decoder's
+// final color conversion. As with AlphaBlend, this happens in sRGB space:
+// color * alpha + background * (1 - alpha), with alpha in [0, 1].
+enum class AlphaOutput {
+  // Color and alpha are returned unmodified.
+  kSeparate,
+  // Color is premultiplied by alpha (i.e. blended over black); alpha is kept.
+  kPremultiplied,
+  // Color is blended over DecompressParams::background; alpha is dropped.
+  kBlend
+};
+
+// Allows another thread to stop the encoders and decoders to which it was
+// passed (CompressParams/DecompressParams::cancel), e.g. once the client
+// disconnected. They check it between search iterations resp. groups and then
+// return false.
+class CancellationToken {
+ public:
+  void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+  bool IsCancelled() const {
+    return cancelled_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<bool> cancelled_{false};
+};
+
+// Returns whether "cancel" (possibly null) was cancelled.
+static inline bool IsCancelled(const CancellationToken* cancel) {
+  return cancel != nullptr && cancel->IsCancelled();
+}
+
+// Fields that affect the bitstream must also be hashed by HashParams in
+// encode_cache.cc.
 struct CompressParams {
   // Only used for benchmarking (comparing vs libjpeg)
   int jpeg_quality = 100;
   bool jpeg_chroma_subsampling = false;
   bool clear_metadata = false;
 
+  // If nonzero (1 = fastest .. 9 = smallest files), overrides fast_mode,
+  // guetzli_mode, max_butteraugli_iters, butteraugli_proxy_iters,
+  // apply_noise and noise_patch_stride with a preset (see ParamsForEffort).
+  // 0 = use those fields as set.
+  size_t effort = 0;
+
   float butteraugli_distance = 1.0f;
   size_t target_size = 0;
   float target_bitrate = 0.0f;
@@ -33,20 +99,93 @@ struct CompressParams {
   // quality-adjusted-bits-per-pixel metric.
   bool fast_mode = false;
   int max_butteraugli_iters = 7;
+  // If nonzero, the quantization search (FindBestQuantization*) starts no
+  // further iterations once this many milliseconds have elapsed since
+  // OpsinToPik began, and uses the best quantization found so far. Bounds
+  // latency for interactive use; other stages are not interrupted.
+  size_t time_budget_ms = 0;
+  // If true, the encoder trades speed for a lower peak memory use: the
+  // centered opsin image and the search's DCT are recomputed (from tiles)
+  // instead of retained, the quantization search reconstructs directly to
+  // sRGB, and the search state is freed before the final coefficients. The
+  // target is at most 140 bytes per pixel (excluding the input) on top of the
+  // butteraugli comparator's own ~180; the fast mode stays below 60 in total.
+  // Does not change the bitstream.
+  bool low_memory = false;
+  // Number of initial (coarse) FindBestQuantization iterations that compare a
+  // 2x downsampled reconstruction against a downsampled original; faster but
+  // less precise. The last iteration always runs at full resolution.
+  size_t butteraugli_proxy_iters = 0;
 
   bool guetzli_mode = false;
   int max_butteraugli_iters_guetzli_mode = 100;
+  // Number of quantization fields evaluated per FindBestQuantizationHQ
+  // iteration (for butteraugli_distance <= 1.4): besides the default step,
+  // 2x, 3x.. larger adjustments of the same field, each with its own
+  // comparator. They run concurrently and the search continues with the
+  // smallest one that reaches the target, or else the closest. 1 = only the
+  // default step; ignored if low_memory. The result does not depend on the
+  // number of threads.
+  size_t hq_search_candidates = 1;
 
   Override denoise = Override::kDefault;
 
   Override apply_noise = Override::kDefault;
+  // kOn codes only luminance (discarding any color), kOff always codes all
+  // three planes. By default, only neutral gray inputs are coded as grayscale.
+  Override grayscale = Override::kDefault;
+  // Noise estimation only scores every n-th patch in each direction; 1 = all.
+  size_t noise_patch_stride = 1;
 
   bool use_brunsli_v2 = false;
 
+  // If true, 8-bit inputs are stored exactly in the lossless bitstream (see
+  // lossless.h); the distance and other lossy settings are ignored.
+  bool lossless = false;
+
+  // 8-bit images with few colors are coded as palette indices in the lossless
+  // bitstream: by default if they have at most 64 colors (or 256 if lossless),
+  // with kOn if at most 256, and never with kOff.
+  Override palette = Override::kDefault;
+
+  // If nonzero, the default bitstream also stores up to this many (at most
+  // Pyramid::kMaxLevels) successively 4x smaller copies of the image, which
+  // allows decoding with larger downscale factors at a fraction of the cost.
+  size_t pyramid_levels = 0;
+
+  // If true, the lossy mode of JpegToPik encodes the decoded JPEG as PIK
+  // (instead of re-encoding the JPEG with guetzli and storing it as Brunsli).
+  // The quantization search then starts from the precision of the JPEG
+  // quantization tables and only refines it for a few iterations.
+  bool jpeg_transcode = false;
+
+  // Number of interleaved ANS states for AC groups (1, 2 or 4). More states
+  // allow faster decoding at the cost of a few bytes per group.
+  size_t num_ans_states = 1;
+
+  // If true, AC tokens are coded with built-in histograms trained on photos
+  // (see static_histograms.h) unless image-specific ones are estimated to be
+  // smaller. Saves storing and decoding histograms at the cost of slightly
+  // larger files; intended for fast_mode.
+  bool static_histograms = false;
+
+  // Width and height of the groups of the default bitstream in tiles (2, 4,
+  // 8 or 16), or 0 to choose them by image size and number of threads.
+  uint32_t group_size_in_tiles = 0;
+
   // Prints extra information after encoding.
   bool verbose = false;
 
   float hf_asymmetry = 1.0;
+
+  // If non-empty, the butteraugli state of the original image is loaded from
+  // this file, or stored there if it is missing or was computed for another
+  // image. Saves time when re-encoding an image, e.g. at other distances.
+  std::string butteraugli_reference_cache;
+
+  // If non-null and cancelled during encoding, the encoder returns false after
+  // the current search iteration or stage.
+  const CancellationToken* cancel = nullptr;
 };
 
 struct DecompressParams {
@@ -57,10 +196,76 @@ struct DecompressParams {
 
   // kDefault := whatever the encoder decided (stored in header).
   Override denoise = Override::kDefault;
+  Override dither = Override::kDefault;
+  // The following stages only run if the encoder enabled them, so kOn has no
+  // effect. kOff skips noise synthesis and Gaborish, and replaces the smooth
+  // DC prediction with the blockier per-block DC.
+  Override noise = Override::kDefault;
+  Override gaborish = Override::kDefault;
+  Override smooth_dc = Override::kDefault;
+  // If true, all of the above that are kDefault are treated as kOff, which
+  // roughly halves decode latency at the cost of fidelity, e.g. for scrubbing
+  // through images.
+  bool fast_preview = false;
+
+  // If nonzero (2, 4 or 8), only the DC groups are decoded and the output is
+  // a preview downsampled by this factor, e.g. 8 = one pixel per block.
+  size_t dc_preview = 0;
+
+  // If 2 or 4, the output is downscaled by this factor. Cheaper than decoding
+  // at full resolution and resampling because only the low-frequency part of
+  // each block is inverse-transformed, but still decodes all coefficients.
+  // Not supported together with dc_preview or region decoding. If the image
+  // has a Pyramid section, any power of two >= 4 up to 4 times the factor of
+  // its smallest level is also allowed and only the nearest level is decoded;
+  // region decoding is then supported if the factor equals that of a level
+  // (with the rect in downscaled pixels).
+  size_t downscale = 1;
+
+  // If true, the dequantized AC coefficients (the largest decoder allocation)
+  // are stored as half-floats, which halves their memory and bandwidth at a
+  // negligible loss of precision.
+  bool compact_coefficients = false;
+
+  // If true, an alpha channel that is known to be fully opaque is neither
+  // decoded nor returned.
+  bool drop_opaque_alpha = false;
+
+  // Converts to linear light or half-floats during the decoder's final color
+  // conversion; only kSRGB is supported for 8-bit outputs and Brunsli.
+  SampleEncoding encoding = SampleEncoding::kSRGB;
+
+  // Wide-gamut outputs are converted from the decoder's opsin space with a
+  // single combined matrix, i.e. without a separate color management pass.
+  // Only sRGB is supported for Brunsli, lossless and YUV outputs.
+  ColorPrimaries primaries = ColorPrimaries::kSRGB;
+
+  // Only for 8-bit outputs; no effect on images without alpha. "background"
+  // is the gray level (sRGB) for kBlend.
+  AlphaOutput alpha_output = AlphaOutput::kSeparate;
+  uint8_t background = 255;
+
+  // Only used by PikToJpeg. If nonzero, the JPEG has a restart marker after
+  // every this many MCUs (at most 65535), which allows Huffman-coding the
+  // intervals in parallel at the cost of a few bytes per interval. Brunsli
+  // does not store the restart interval of the original JPEG.
+  size_t jpeg_restart_interval = 0;
+
+  // If non-null and cancelled during decoding, the remaining groups are
+  // skipped and the decoder returns false.
+  const CancellationToken* cancel = nullptr;
+
+  // If non-null, PikToPixels hands the decoded coefficients to this hook
+  // instead of reconstructing the pixels itself (see compressed_image.h).
+  const ReconHook* recon_hook = nullptr;
 };
 
 static constexpr float kMaxButteraugliForHQ = 2.0f;
 static constexpr float kMinButteraugliForDither = 1.0f;
+// Images up to this size [pixels] in both dimensions are encoded with
+// Header::kSmallImage.
+static constexpr size_t kMaxSmallImageSize = 64;
+static constexpr size_t kMaxEffort = 9;
 
 }  // namespace pik
 
@@ -0,0 +1,293 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Always enabled: other translation units may enable the profiler and then
+// require these definitions.
+#undef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#include "profiler.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+namespace pik {
+namespace {
+
+// Recent samples of one thread. Written only by the thread that claimed it,
+// read by GetZoneSampleTotals at any time, hence atomic.
+struct alignas(64) SampleRing {
+  // Power of two; the oldest samples are overwritten.
+  static constexpr size_t kCapacity = 128;
+
+  // Packet with the zone's biased offset and duration instead of timestamp.
+  std::atomic<uint64_t> samples[kCapacity];
+  std::atomic<uint64_t> num_written;
+  // Whether a thread owns the ring; cleared when it exits.
+  std::atomic<bool> in_use;
+};
+
+// Statically allocated (zero-initialized); threads claim one upon their first
+// sample. Threads beyond kMaxThreads concurrently sampling do not record.
+SampleRing g_sample_rings[kMaxThreads];
+// One past the highest index of any ring claimed so far.
+std::atomic<uint32_t> g_num_sample_rings;
+
+// Returns an unused ring, or nullptr if all are in use.
+SampleRing* ClaimSampleRing() {
+  for (uint32_t i = 0; i < kMaxThreads; ++i) {
+    std::atomic<bool>& in_use = g_sample_rings[i].in_use;
+    bool expected = false;
+    if (in_use.load(std::memory_order_relaxed) ||
+        !in_use.compare_exchange_strong(expected, true,
+                                        std::memory_order_acquire)) {
+      continue;
+    }
+    uint32_t num_rings = g_num_sample_rings.load(std::memory_order_relaxed);
+    while (num_rings <= i &&
+           !g_num_sample_rings.compare_exchange_weak(num_rings, i + 1)) {
+    }
+    return &g_sample_rings[i];
+  }
+  return nullptr;
+}
+
+// Per-thread state for sampling mode. Releases the ring when the thread
+// exits; its samples remain visible until the next owner overwrites them.
+struct SampleThread {
+  ~SampleThread() {
+    if (ring != nullptr) ring->in_use.store(false, std::memory_order_release);
+  }
+
+  uint32_t countdown = 0;  // Zone entries until the next sample.
+  uint32_t depth = 0;      // Number of active zones (entered while sampling).
+  SampleRing* ring = nullptr;
+};
+
+SampleThread& ThisSampleThread() {
+  static thread_local SampleThread thread;
+  return thread;
+}
+
+}  // namespace
+
+void SetZoneSampling(const uint32_t interval, const bool top_level_only) {
+  SamplingState& state = GlobalSamplingState();
+  state.top_level_only.store(top_level_only, std::memory_order_relaxed);
+  state.interval.store(interval);
+}
+
+size_t GetZoneSampleTotals(ZoneSampleTotal* totals) {
+  size_t num_totals = 0;
+  const char* string_origin = StringOrigin();
+  const uint32_t num_rings =
+      g_num_sample_rings.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < num_rings; ++i) {
+    const SampleRing& ring = g_sample_rings[i];
+    const uint64_t num_written =
+        ring.num_written.load(std::memory_order_acquire);
+    const uint64_t num_samples =
+        std::min<uint64_t>(num_written, SampleRing::kCapacity);
+    for (uint64_t j = num_written - num_samples; j < num_written; ++j) {
+      const uint64_t bits = ring.samples[j & (SampleRing::kCapacity - 1)].load(
+          std::memory_order_relaxed);
+      const uint64_t biased_offset = bits >> Packet::kTimestampBits;
+      const uint64_t duration = bits & Packet::kTimestampMask;
+      const char* name = string_origin + biased_offset;
+      // Skip hidden zones.
+      if (name[0] == '@') continue;
+      // Merge by name; each template instantiation has its own __func__.
+      size_t k = 0;
+      while (k < num_totals && strcmp(totals[k].name, name) != 0) ++k;
+      if (k == num_totals) {
+        if (num_totals == kMaxSampledZones) continue;
+        totals[num_totals++] = ZoneSampleTotal{name, 0, 0};
+      }
+      totals[k].num_samples += 1;
+      totals[k].total_duration += duration;
+    }
+  }
+  return num_totals;
+}
+
+void PrintZoneSamples() {
+  std::vector<ZoneSampleTotal> totals(kMaxSampledZones);
+  totals.resize(GetZoneSampleTotals(totals.data()));
+  std::sort(totals.begin(), totals.end(),
+            [](const ZoneSampleTotal& t1, const ZoneSampleTotal& t2) {
+              return t1.total_duration > t2.total_duration;
+            });
+  for (const ZoneSampleTotal& t : totals) {
+    printf("%-40s: %10" PRIu64 " x %15" PRIu64 "= %15" PRIu64 "\n", t.name,
+           t.num_samples, t.total_duration / t.num_samples, t.total_duration);
+  }
+}
+
+void ZoneSample::Enter(const char* name, const uint32_t interval) {
+  SampleThread& thread = ThisSampleThread();
+  const bool top_level_only =
+      GlobalSamplingState().top_level_only.load(std::memory_order_relaxed);
+  sampled_ = false;
+  const bool eligible = !top_level_only || thread.depth == 0;
+  ++thread.depth;
+  if (!eligible || thread.countdown-- != 0) return;
+  thread.countdown = interval - 1;
+
+  // Same range assumption as ThreadSpecific, but skip instead of aborting.
+  const size_t biased_offset = name - StringOrigin();
+  if (biased_offset >= (1ULL << Packet::kOffsetBits)) return;
+  if (PIK_UNLIKELY(thread.ring == nullptr)) {
+    thread.ring = ClaimSampleRing();
+    if (thread.ring == nullptr) return;
+  }
+  sampled_ = true;
+  biased_offset_ = biased_offset;
+  PIK_COMPILER_FENCE;
+  start_ = Start<uint64_t>();
+}
+
+void ZoneSample::Exit() {
+  const uint64_t timestamp = Stop<uint64_t>();
+  SampleThread& thread = ThisSampleThread();
+  --thread.depth;
+  if (!sampled_) return;
+  const uint64_t duration = (timestamp - start_) & Packet::kTimestampMask;
+  SampleRing& ring = *thread.ring;
+  const uint64_t num_written = ring.num_written.load(std::memory_order_relaxed);
+  ring.samples[num_written & (SampleRing::kCapacity - 1)].store(
+      (biased_offset_ << Packet::kTimestampBits) + duration,
+      std::memory_order_relaxed);
+  ring.num_written.store(num_written + 1, std::memory_order_release);
+}
+
+Zone::Zone(const char* name) {
+  PIK_COMPILER_FENCE;
+  const uint32_t interval =
+      GlobalSamplingState().interval.load(std::memory_order_relaxed);
+  if (PIK_UNLIKELY(interval != 0)) {
+    full_ = false;
+    sample_.Enter(name, interval);
+    return;
+  }
+  full_ = true;
+
+  ThreadSpecific* PIK_RESTRICT thread_specific = StaticThreadSpecific();
+  if (PIK_UNLIKELY(thread_specific == nullptr)) {
+    void* mem = CacheAligned::Allocate(sizeof(ThreadSpecific));
+    thread_specific = new (mem) ThreadSpecific(name);
+    // Must happen before ComputeOverhead, which re-enters this ctor.
+    Threads().Add(thread_specific);
+    StaticThreadSpecific() = thread_specific;
+    thread_specific->ComputeOverhead();
+  }
+
+  // (Capture timestamp ASAP, not inside WriteEntry.)
+  PIK_COMPILER_FENCE;
+  const uint64_t timestamp = Start<uint64_t>();
+  thread_specific->WriteEntry(name, timestamp);
+}
+
+Zone::~Zone() {
+  PIK_COMPILER_FENCE;
+  if (PIK_LIKELY(full_)) {
+    const uint64_t timestamp = Stop<uint64_t>();
+    StaticThreadSpecific()->WriteExit(timestamp);
+  } else {
+    sample_.Exit();
+  }
+  PIK_COMPILER_FENCE;
+}
+
+void ThreadSpecific::ComputeOverhead() {
+  // Delay after capturing timestamps before/after the actual zone runs. Even
+  // with frequency throttling disabled, this has a multimodal distribution,
+  // including 32, 34, 48, 52, 59, 62.
+  uint64_t self_overhead;
+  {
+    const size_t kNumSamples = 32;
+    uint32_t samples[kNumSamples];
+    for (size_t idx_sample = 0; idx_sample < kNumSamples; ++idx_sample) {
+      const size_t kNumDurations = 1024;
+      uint32_t durations[kNumDurations];
+
+      for (size_t idx_duration = 0; idx_duration < kNumDurations;
+           ++idx_duration) {
+        { PROFILER_ZONE("Dummy Zone (never shown)"); }
+#if PIK_ARCH_X64
+        const uint64_t duration = results_.ZoneDuration(buffer_);
+        buffer_size_ = 0;
+#else
+        const uint64_t duration = results_.ZoneDuration(packets_);
+        num_packets_ = 0;
+#endif
+        durations[idx_duration] = static_cast<uint32_t>(duration);
+        PIK_CHECK(num_packets_ == 0);
+      }
+      CountingSort(durations, durations + kNumDurations);
+      samples[idx_sample] = Mode(durations, kNumDurations);
+    }
+    // Median.
+    CountingSort(samples, samples + kNumSamples);
+    self_overhead = samples[kNumSamples / 2];
+#if PROFILER_PRINT_OVERHEAD
+    printf("Overhead: %zu\n", self_overhead);
+#endif
+    results_.SetSelfOverhead(self_overhead);
+  }
+
+  // Delay before capturing start timestamp / after end timestamp.
+  const size_t kNumSamples = 32;
+  uint32_t samples[kNumSamples];
+  for (size_t idx_sample = 0; idx_sample < kNumSamples; ++idx_sample) {
+    const size_t kNumDurations = 16;
+    uint32_t durations[kNumDurations];
+    for (size_t idx_duration = 0; idx_duration < kNumDurations;
+         ++idx_duration) {
+      const size_t kReps = 10000;
+      // Analysis time should not be included => must fit within buffer.
+      PIK_CHECK(kReps * 2 < max_packets_);
+#if PIK_ARCH_X64
+      _mm_mfence();
+#endif
+      const uint64_t t0 = Start<uint64_t>();
+      for (size_t i = 0; i < kReps; ++i) {
+        PROFILER_ZONE("Dummy");
+      }
+#if PIK_ARCH_X64
+      _mm_sfence();
+#endif
+      const uint64_t t1 = Stop<uint64_t>();
+#if PIK_ARCH_X64
+      PIK_CHECK(num_packets_ + buffer_size_ == kReps * 2);
+      buffer_size_ = 0;
+#else
+      PIK_CHECK(num_packets_ == kReps * 2);
+#endif
+      num_packets_ = 0;
+      const uint64_t avg_duration = (t1 - t0 + kReps / 2) / kReps;
+      durations[idx_duration] =
+          static_cast<uint32_t>(ClampedSubtract(avg_duration, self_overhead));
+    }
+    CountingSort(durations, durations + kNumDurations);
+    samples[idx_sample] = Mode(durations, kNumDurations);
+  }
+  CountingSort(samples, samples + kNumSamples);
+  const uint64_t child_overhead = samples[9 * kNumSamples / 10];
+#if PROFILER_PRINT_OVERHEAD
+  printf("Child overhead: %zu\n", child_overhead);
+#endif
+  results_.SetChildOverhead(child_overhead);
+}
+
+}  // namespace pik
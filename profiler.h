@@ -18,16 +18,30 @@
 // High precision, low overhead time measurements. Returns exact call counts and
 // total elapsed time for user-defined 'zones' (code regions, i.e. C++ scopes).
 //
-// Usage: add this header to BUILD srcs; instrument regions of interest:
+// Usage: add profiler.cc to the build; instrument regions of interest:
 // { PROFILER_ZONE("name"); /*code*/ } or
 // void FuncToMeasure() { PROFILER_FUNC; /*code*/ }.
 // After all threads have exited any zones, invoke PROFILER_PRINT_RESULTS() to
 // print call counts and average durations [CPU cycles] to stdout, sorted in
 // descending order of total duration.
+//
+// To see when zones ran on which thread, call PROFILER_ENABLE_TRACE() before
+// the code of interest and PROFILER_WRITE_TRACE("path.json") afterwards. The
+// output is in Chrome Trace Event format (chrome://tracing or Perfetto).
+// PROFILER_VISIT_TRACE(visitor) instead passes each span to "visitor".
+//
+// For lower overhead (e.g. in production), PROFILER_SET_SAMPLING(interval,
+// top_level_only) switches all threads to recording only every interval-th
+// zone entry (optionally only outermost zones) into fixed-size per-thread ring
+// buffers. PROFILER_VISIT_SAMPLES(visitor) aggregates the samples currently in
+// the rings and may be called at any time; PROFILER_PRINT_SAMPLES() prints
+// them. Only the latter allocates memory. Unlike
+// the rest, sampling also works if PROFILER_ENABLED is zero: zones then cost
+// one relaxed load and branch unless sampling is enabled at runtime.
 
 // Configuration settings:
 
-// If zero, this file has no effect and no measurements will be recorded.
+// If zero, zones are only recorded in sampling mode (see above).
 #ifndef PROFILER_ENABLED
 #define PROFILER_ENABLED 0
 #endif
@@ -40,6 +54,113 @@
 #define PROFILER_THREAD_STORAGE 16ULL
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "compiler_specific.h"
+
+namespace pik {
+
+// Shared by all threads; set by SetZoneSampling.
+struct SamplingState {
+  // Zero: record all zones (default). Otherwise, each thread only records
+  // every interval-th zone it enters.
+  std::atomic<uint32_t> interval{0};
+  // Whether to only consider zones entered while no other zone is active.
+  std::atomic<bool> top_level_only{false};
+};
+
+PIK_INLINE SamplingState& GlobalSamplingState() {
+  static SamplingState state;
+  return state;
+}
+
+// Switches to sampling mode: each thread records only every "interval"-th
+// zone it enters (if "top_level_only", only counting zones entered outside
+// any other), with its duration including any child zones. Zero restores
+// recording all zones (or none if !PROFILER_ENABLED). Call while no thread is
+// inside a zone.
+void SetZoneSampling(uint32_t interval, bool top_level_only);
+
+// Sampled durations of all zones with the same name.
+struct ZoneSampleTotal {
+  const char* name;
+  uint64_t num_samples;
+  uint64_t total_duration;  // [ticks]
+};
+
+// Zones beyond this number are not reported by VisitZoneSamples.
+static constexpr size_t kMaxSampledZones = 256;
+
+// Stores the totals of each zone sampled in the most recent samples of each
+// thread (including exited threads, until their ring is reused) into
+// "totals" (kMaxSampledZones entries) and returns their number.
+size_t GetZoneSampleTotals(ZoneSampleTotal* totals);
+
+// Thread-safe; may be called while other threads are sampling. Calls
+// visitor(name, num_samples, total_duration) for each zone returned by
+// GetZoneSampleTotals, in unspecified order. Durations are in ticks.
+// Concurrent writers may cause a few samples to be skipped or counted twice.
+template <class Visitor>
+void VisitZoneSamples(const Visitor& visitor) {
+  ZoneSampleTotal totals[kMaxSampledZones];
+  const size_t num_totals = GetZoneSampleTotals(totals);
+  for (size_t i = 0; i < num_totals; ++i) {
+    visitor(totals[i].name, totals[i].num_samples, totals[i].total_duration);
+  }
+}
+
+// Prints the number of samples, average and total duration [ticks] of each
+// zone returned by GetZoneSampleTotals to stdout, sorted in descending order
+// of total duration.
+void PrintZoneSamples();
+
+// Sampling state of one zone entry, shared by Zone and SampledZone.
+class ZoneSample {
+ public:
+  // Called upon entering a zone while the sampling interval is nonzero.
+  // "name" must be a string literal (see StringOrigin).
+  PIK_NOINLINE void Enter(const char* name, uint32_t interval);
+
+  // Called upon exiting the zone iff Enter was called.
+  PIK_NOINLINE void Exit();
+
+ private:
+  bool sampled_;
+  // Only initialized if sampled_.
+  uint64_t biased_offset_;
+  uint64_t start_;
+};
+
+// Used by PROFILER_ZONE if !PROFILER_ENABLED; only records in sampling mode.
+class SampledZone {
+ public:
+  PIK_INLINE explicit SampledZone(const char* name) {
+    const uint32_t interval =
+        GlobalSamplingState().interval.load(std::memory_order_relaxed);
+    sampling_ = interval != 0;
+    if (PIK_UNLIKELY(sampling_)) sample_.Enter(name, interval);
+  }
+
+  PIK_INLINE ~SampledZone() {
+    if (PIK_UNLIKELY(sampling_)) sample_.Exit();
+  }
+
+  SampledZone(const SampledZone&) = delete;
+  SampledZone& operator=(const SampledZone&) = delete;
+
+ private:
+  bool sampling_;
+  ZoneSample sample_;
+};
+
+#define PROFILER_SET_SAMPLING SetZoneSampling
+#define PROFILER_VISIT_SAMPLES VisitZoneSamples
+#define PROFILER_PRINT_SAMPLES PrintZoneSamples
+
+}  // namespace pik
+
 #if PROFILER_ENABLED
 
 #define PROFILER_PRINT_OVERHEAD 0
@@ -47,6 +168,7 @@
 #include <algorithm>  // min/max
 #include <atomic>
 #include <cassert>
+#include <chrono>  //NOLINT
 #include <cinttypes>  // PRIu64
 #include <cstddef>  // ptrdiff_t
 #include <cstdint>
@@ -54,6 +176,7 @@
 #include <cstdlib>
 #include <cstring>  // memcpy
 #include <new>
+#include <vector>
 
 #include "arch_specific.h"
 #include "cache_aligned.h"
@@ -168,6 +291,26 @@ inline T ClampedSubtract(const T minuend, const T subtrahend) {
   return minuend - subtrahend;
 }
 
+// One completed zone, recorded while tracing is enabled. POD.
+struct TraceSpan {
+  uint64_t biased_offset;
+  uint64_t start;  // Masked timestamp, see Packet::kTimestampMask.
+  uint64_t duration;
+};
+
+// Shared by all threads; set by Zone::EnableTrace.
+struct TraceState {
+  std::atomic<bool> enabled{false};
+  // Masked timestamp at EnableTrace; all spans are relative to it, hence
+  // traces are limited to 2^(kTimestampBits - 1) ticks (17 seconds at 4 GHz).
+  uint64_t origin = 0;
+};
+
+inline TraceState& GlobalTraceState() {
+  static TraceState state;
+  return state;
+}
+
 // Per-thread call graph (stack) and Accumulator for each zone.
 class Results {
  public:
@@ -181,7 +324,9 @@ class Results {
   uint64_t ZoneDuration(const Packet* packets) {
     PIK_CHECK(depth_ == 0);
     PIK_CHECK(num_zones_ == 0);
+    const size_t num_spans = spans_.size();
     AnalyzePackets(packets, 2);
+    spans_.resize(num_spans);  // Not an actual zone.
     const uint64_t duration = zones_[0].total_duration;
     zones_[0].num_calls = 0;
     zones_[0].total_duration = 0;
@@ -202,6 +347,8 @@ class Results {
   // afterwards. Called whenever this thread's storage is full.
   void AnalyzePackets(const Packet* packets, const size_t num_packets) {
     const uint64_t t0 = Start<uint64_t>();
+    const bool trace =
+        GlobalTraceState().enabled.load(std::memory_order_relaxed);
 
     for (size_t i = 0; i < num_packets; ++i) {
       const Packet p = packets[i];
@@ -223,6 +370,10 @@ class Results {
           duration, self_overhead_ + child_overhead_ + node.child_total);
 
       UpdateOrAdd(node.packet.BiasedOffset(), 1, self_duration);
+      if (trace) {
+        spans_.push_back(TraceSpan{node.packet.BiasedOffset(),
+                                   node.packet.Timestamp(), duration});
+      }
       --depth_;
 
       // Deduct this nested node's time from its parent's self_duration.
@@ -280,6 +431,24 @@ class Results {
     printf("Total clocks measured: %" PRIu64 "\n", total_visible_duration);
   }
 
+  // Single-threaded. Calls visitor(name, num_calls, total_duration) for each
+  // zone shown by Print, in unspecified order. Durations are in ticks.
+  template <class Visitor>
+  void ForEachZone(const Visitor& visitor) {
+    MergeDuplicates();
+    const char* string_origin = StringOrigin();
+    for (size_t i = 0; i < num_zones_; ++i) {
+      const Accumulator& r = zones_[i];
+      const char* name = string_origin + r.BiasedOffset();
+      if (name[0] != '@') {
+        visitor(name, r.NumCalls(), r.total_duration);
+      }
+    }
+  }
+
+  // Zones completed while tracing was enabled, in order of their exit.
+  std::vector<TraceSpan>& Spans() { return spans_; }
+
   // Single-threaded. Clears all results as if no zones had been recorded.
   void Reset() {
     analyze_elapsed_ = 0;
@@ -421,6 +590,8 @@ class Results {
 
   alignas(64) ProfilerNode nodes_[kMaxDepth];  // Stack
   alignas(64) Accumulator zones_[kMaxZones];  // Self-organizing list
+
+  std::vector<TraceSpan> spans_;
 };
 
 // Per-thread packet storage, allocated via CacheAligned.
@@ -447,7 +618,7 @@ class ThreadSpecific {
 
   ~ThreadSpecific() { CacheAligned::Free(packets_); }
 
-  // Depends on Zone => defined below.
+  // Depends on Zone => defined in profiler.cc.
   void ComputeOverhead();
 
   void WriteEntry(const char* name, const uint64_t timestamp) {
@@ -538,6 +709,87 @@ class ThreadList {
 
   // Single-threaded.
   void PrintResults() {
+    Results* results = CombineResults();
+    if (results != nullptr) {
+      results->Print();
+      ResetResults();
+    }
+  }
+
+  // Single-threaded. Calls visitor(name, thread, start, duration) for each
+  // TraceSpan and discards them. "thread" is an index in [0, num_threads),
+  // "start" is relative to EnableTrace; both times are in seconds.
+  template <class Visitor>
+  void VisitTrace(const Visitor& visitor) {
+    const uint64_t origin = GlobalTraceState().origin;
+    const double seconds_per_tick = 1.0 / TicksPerSecond();
+    const char* string_origin = StringOrigin();
+    const uint32_t num_threads = num_threads_.load();
+    for (uint32_t i = 0; i < num_threads; ++i) {
+      threads_[i]->AnalyzeRemainingPackets();
+      std::vector<TraceSpan>& spans = threads_[i]->GetResults().Spans();
+      for (const TraceSpan& span : spans) {
+        const char* name = string_origin + span.biased_offset;
+        const uint64_t start = (span.start - origin) & Packet::kTimestampMask;
+        // Skip hidden zones and those that began before EnableTrace (their
+        // start wraps around to a huge value).
+        if (name[0] == '@' || start > Packet::kTimestampMask / 2) continue;
+        visitor(name, i, start * seconds_per_tick,
+                span.duration * seconds_per_tick);
+      }
+      spans.clear();
+    }
+  }
+
+  // Single-threaded. Writes all TraceSpan as Chrome Trace Event JSON (one
+  // "tid" per thread) to "path" and discards them. Returns false on I/O error.
+  bool WriteTrace(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == nullptr) return false;
+    fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    bool first = true;
+    VisitTrace([f, &first](const char* name, const uint32_t thread,
+                           const double start, const double duration) {
+      fprintf(f,
+              "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+              "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+              first ? "" : ",", name, thread, start * 1E6, duration * 1E6);
+      first = false;
+    });
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+  }
+
+  // Single-threaded. Same as PrintResults, but passes the zones to
+  // Results::ForEachZone instead of printing them.
+  template <class Visitor>
+  void VisitResults(const Visitor& visitor) {
+    Results* results = CombineResults();
+    if (results != nullptr) {
+      results->ForEachZone(visitor);
+      ResetResults();
+    }
+  }
+
+ private:
+  // InvariantTicksPerSecond, or if the CPU brand string does not mention the
+  // frequency (e.g. in some VMs), an estimate from the wall clock.
+  static double TicksPerSecond() {
+    const double ticks_per_second = InvariantTicksPerSecond();
+    if (ticks_per_second > 0.0) return ticks_per_second;
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point c0 = Clock::now();
+    const uint64_t t0 = Start<uint64_t>();
+    while (Clock::now() - c0 < std::chrono::milliseconds(20)) {
+    }
+    const uint64_t t1 = Stop<uint64_t>();
+    const std::chrono::duration<double> elapsed = Clock::now() - c0;
+    return (t1 - t0) / elapsed.count();
+  }
+
+  // Returns the first thread's Results after merging all others into it, or
+  // null if no thread entered a zone.
+  Results* CombineResults() {
     const uint32_t num_threads = num_threads_.load();
     for (uint32_t i = 0; i < num_threads; ++i) {
       threads_[i]->AnalyzeRemainingPackets();
@@ -547,17 +799,16 @@ class ThreadList {
     for (uint32_t i = 1; i < num_threads; ++i) {
       threads_[0]->GetResults().Assimilate(threads_[i]->GetResults());
     }
+    return num_threads == 0 ? nullptr : &threads_[0]->GetResults();
+  }
 
-    if (num_threads != 0) {
-      threads_[0]->GetResults().Print();
-
-      for (uint32_t i = 0; i < num_threads; ++i) {
-        threads_[i]->GetResults().Reset();
-      }
+  void ResetResults() {
+    const uint32_t num_threads = num_threads_.load();
+    for (uint32_t i = 0; i < num_threads; ++i) {
+      threads_[i]->GetResults().Reset();
     }
   }
 
- private:
   // Owning pointers.
   alignas(64) ThreadSpecific* threads_[kMaxThreads];
   std::atomic<uint32_t> num_threads_{0};
@@ -568,33 +819,41 @@ class ThreadList {
 class Zone {
  public:
   // "name" must be a string literal (see StringOrigin).
-  PIK_NOINLINE explicit Zone(const char* name) {
-    PIK_COMPILER_FENCE;
-    ThreadSpecific* PIK_RESTRICT thread_specific = StaticThreadSpecific();
-    if (PIK_UNLIKELY(thread_specific == nullptr)) {
-      void* mem = CacheAligned::Allocate(sizeof(ThreadSpecific));
-      thread_specific = new (mem) ThreadSpecific(name);
-      // Must happen before ComputeOverhead, which re-enters this ctor.
-      Threads().Add(thread_specific);
-      StaticThreadSpecific() = thread_specific;
-      thread_specific->ComputeOverhead();
-    }
+  PIK_NOINLINE explicit Zone(const char* name);
+
+  PIK_NOINLINE ~Zone();
+
+  // Call exactly once after all threads have exited all zones.
+  static void PrintResults() { Threads().PrintResults(); }
 
-    // (Capture timestamp ASAP, not inside WriteEntry.)
-    PIK_COMPILER_FENCE;
-    const uint64_t timestamp = Start<uint64_t>();
-    thread_specific->WriteEntry(name, timestamp);
+  // Starts recording a TraceSpan for every zone exited from now on. Call
+  // before the threads of interest enter their zones.
+  static void EnableTrace() {
+    TraceState& state = GlobalTraceState();
+    state.origin = Start<uint64_t>() & Packet::kTimestampMask;
+    state.enabled.store(true);
   }
 
-  PIK_NOINLINE ~Zone() {
-    PIK_COMPILER_FENCE;
-    const uint64_t timestamp = Stop<uint64_t>();
-    StaticThreadSpecific()->WriteExit(timestamp);
-    PIK_COMPILER_FENCE;
+  // Call after all threads have exited all zones; see ThreadList::WriteTrace.
+  static bool WriteTrace(const char* path) {
+    // Still enabled while analyzing the remaining packets.
+    const bool ok = Threads().WriteTrace(path);
+    GlobalTraceState().enabled.store(false);
+    return ok;
   }
 
-  // Call exactly once after all threads have exited all zones.
-  static void PrintResults() { Threads().PrintResults(); }
+  // Alternative to WriteTrace, see ThreadList::VisitTrace.
+  template <class Visitor>
+  static void VisitTrace(const Visitor& visitor) {
+    Threads().VisitTrace(visitor);
+    GlobalTraceState().enabled.store(false);
+  }
+
+  // Alternative to PrintResults, see ThreadList::VisitResults.
+  template <class Visitor>
+  static void VisitResults(const Visitor& visitor) {
+    Threads().VisitResults(visitor);
+  }
 
  private:
   // Returns reference to the thread's ThreadSpecific pointer (initially null).
@@ -609,6 +868,9 @@ class Zone {
     static ThreadList threads_;
     return threads_;
   }
+
+  bool full_;  // Whether recording into ThreadSpecific, else sampling.
+  ZoneSample sample_;
 };
 
 // Creates a zone starting from here until the end of the current scope.
@@ -627,94 +889,21 @@ class Zone {
   PIK_COMPILER_FENCE
 
 #define PROFILER_PRINT_RESULTS Zone::PrintResults
-
-inline void ThreadSpecific::ComputeOverhead() {
-  // Delay after capturing timestamps before/after the actual zone runs. Even
-  // with frequency throttling disabled, this has a multimodal distribution,
-  // including 32, 34, 48, 52, 59, 62.
-  uint64_t self_overhead;
-  {
-    const size_t kNumSamples = 32;
-    uint32_t samples[kNumSamples];
-    for (size_t idx_sample = 0; idx_sample < kNumSamples; ++idx_sample) {
-      const size_t kNumDurations = 1024;
-      uint32_t durations[kNumDurations];
-
-      for (size_t idx_duration = 0; idx_duration < kNumDurations;
-           ++idx_duration) {
-        { PROFILER_ZONE("Dummy Zone (never shown)"); }
-#if PIK_ARCH_X64
-        const uint64_t duration = results_.ZoneDuration(buffer_);
-        buffer_size_ = 0;
-#else
-        const uint64_t duration = results_.ZoneDuration(packets_);
-        num_packets_ = 0;
-#endif
-        durations[idx_duration] = static_cast<uint32_t>(duration);
-        PIK_CHECK(num_packets_ == 0);
-      }
-      CountingSort(durations, durations + kNumDurations);
-      samples[idx_sample] = Mode(durations, kNumDurations);
-    }
-    // Median.
-    CountingSort(samples, samples + kNumSamples);
-    self_overhead = samples[kNumSamples / 2];
-#if PROFILER_PRINT_OVERHEAD
-    printf("Overhead: %zu\n", self_overhead);
-#endif
-    results_.SetSelfOverhead(self_overhead);
-  }
-
-  // Delay before capturing start timestamp / after end timestamp.
-  const size_t kNumSamples = 32;
-  uint32_t samples[kNumSamples];
-  for (size_t idx_sample = 0; idx_sample < kNumSamples; ++idx_sample) {
-    const size_t kNumDurations = 16;
-    uint32_t durations[kNumDurations];
-    for (size_t idx_duration = 0; idx_duration < kNumDurations;
-         ++idx_duration) {
-      const size_t kReps = 10000;
-      // Analysis time should not be included => must fit within buffer.
-      PIK_CHECK(kReps * 2 < max_packets_);
-#if PIK_ARCH_X64
-      _mm_mfence();
-#endif
-      const uint64_t t0 = Start<uint64_t>();
-      for (size_t i = 0; i < kReps; ++i) {
-        PROFILER_ZONE("Dummy");
-      }
-#if PIK_ARCH_X64
-      _mm_sfence();
-#endif
-      const uint64_t t1 = Stop<uint64_t>();
-#if PIK_ARCH_X64
-      PIK_CHECK(num_packets_ + buffer_size_ == kReps * 2);
-      buffer_size_ = 0;
-#else
-      PIK_CHECK(num_packets_ == kReps * 2);
-#endif
-      num_packets_ = 0;
-      const uint64_t avg_duration = (t1 - t0 + kReps / 2) / kReps;
-      durations[idx_duration] =
-          static_cast<uint32_t>(ClampedSubtract(avg_duration, self_overhead));
-    }
-    CountingSort(durations, durations + kNumDurations);
-    samples[idx_sample] = Mode(durations, kNumDurations);
-  }
-  CountingSort(samples, samples + kNumSamples);
-  const uint64_t child_overhead = samples[9 * kNumSamples / 10];
-#if PROFILER_PRINT_OVERHEAD
-  printf("Child overhead: %zu\n", child_overhead);
-#endif
-  results_.SetChildOverhead(child_overhead);
-}
+#define PROFILER_VISIT_RESULTS Zone::VisitResults
+#define PROFILER_ENABLE_TRACE Zone::EnableTrace
+#define PROFILER_WRITE_TRACE Zone::WriteTrace
+#define PROFILER_VISIT_TRACE Zone::VisitTrace
 
 }  // namespace pik
 
 #else  // !PROFILER_ENABLED
-#define PROFILER_ZONE(name)
-#define PROFILER_FUNC
+#define PROFILER_ZONE(name) const SampledZone zone("" name)
+#define PROFILER_FUNC const SampledZone zone(__func__)
 #define PROFILER_PRINT_RESULTS()
+#define PROFILER_VISIT_RESULTS(visitor)
+#define PROFILER_ENABLE_TRACE()
+#define PROFILER_WRITE_TRACE(path) false
+#define PROFILER_VISIT_TRACE(visitor)
 #endif
 
 #endif  // PROFILER_H_
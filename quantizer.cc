@@ -554,114 +554,200 @@ void Quantizer::DumpQuantizationMap() const {
   }
 }
 
+namespace {
+
+// Rounds half away from zero like std::round: trunc and frac are exact.
+template <class D, class V>
+PIK_INLINE V RoundHalfAway(const D d, const V val) {
+  using namespace SIMD_NAMESPACE;
+  const auto sign_mask = set1(d, -0.0f);
+  const auto half = set1(d, 0.5f);
+  const auto truncated = trunc(val);
+  const auto frac = andnot(sign_mask, val - truncated);
+  const auto away = (val & sign_mask) | set1(d, 1.0f);
+  return truncated + select(setzero(d), away, frac >= half);
+}
+
+}  // namespace
+
+size_t Quantizer::QuantizeBlockCountNZ(size_t quant_x, size_t quant_y, int c,
+                                       const float* PIK_RESTRICT block_in,
+                                       int16_t* PIK_RESTRICT block_out) const {
+  using namespace SIMD_NAMESPACE;
+  using D = Full<float>;
+  constexpr D d;
+  constexpr Full<int32_t> d32;
+  constexpr Part<int16_t, D::N> d16;
+  const BlockQuantizer& bq = bq_[c].Get(QuantizerKey(quant_x, quant_y));
+  const auto sign_mask = set1(d, -0.0f);
+  const auto one = set1(d, 1.0f);
+  const auto zero = setzero(d);
+  const auto thres = set1(d, zero_bias_[c]);
+  auto num_nzeros = zero;
+  for (size_t k = 0; k < 64; k += d.N) {
+    // (bq is not necessarily vector-aligned)
+    const auto val = load(d, block_in + k) * load_unaligned(d, bq.scales + k);
+    auto rounded = RoundHalfAway(d, val);
+    rounded = select(rounded, zero, andnot(sign_mask, val) < thres);
+    num_nzeros += andnot(rounded == zero, one);
+    store(convert_to(d16, convert_to(d32, rounded)), d16, block_out + k);
+  }
+  size_t count = get_part(Part<float, 1>(), ext::sum_of_lanes(num_nzeros));
+  // DC is not subject to the zero bias, and not counted.
+  count -= block_out[0] != 0;
+  block_out[0] = std::round(block_in[0] * bq.scales[0]);
+  return count;
+}
+
+void Quantizer::QuantizeRoundtripBlock(size_t quant_x, size_t quant_y, int c,
+                                       const float* PIK_RESTRICT block_in,
+                                       float* PIK_RESTRICT block_out) const {
+  using namespace SIMD_NAMESPACE;
+  using D = Full<float>;
+  constexpr D d;
+  const BlockQuantizer& bq = bq_[c].Get(QuantizerKey(quant_x, quant_y));
+  const float* PIK_RESTRICT dequant = &DequantMatrix()[c * 64];
+  const auto sign_mask = set1(d, -0.0f);
+  const auto zero = setzero(d);
+  const auto thres = set1(d, zero_bias_[c]);
+  const auto inv_quant = set1(d, inv_quant_ac(quant_x, quant_y));
+  for (size_t k = 0; k < 64; k += d.N) {
+    const auto val = load(d, block_in + k) * load_unaligned(d, bq.scales + k);
+    auto rounded = RoundHalfAway(d, val);
+    rounded = select(rounded, zero, andnot(sign_mask, val) < thres);
+    store(rounded * (load(d, dequant + k) * inv_quant), d, block_out + k);
+  }
+  // DC is not subject to the zero bias.
+  block_out[0] = std::round(block_in[0] * bq.scales[0]) *
+                 (dequant[0] * inv_quant_dc_);
+}
+
 Image3S QuantizeCoeffs(const Image3F& in, const Quantizer& quantizer) {
+  Image3S out(in.xsize() / 64 * 64, in.ysize());
+  QuantizeCoeffs(in, quantizer, &out);
+  return out;
+}
+
+void QuantizeCoeffs(const Image3F& in, const Quantizer& quantizer,
+                    Image3S* PIK_RESTRICT out) {
   PROFILER_FUNC;
   const size_t block_xsize = in.xsize() / 64;
   const size_t block_ysize = in.ysize();
-  Image3S out(block_xsize * 64, block_ysize);
+  PIK_CHECK(out->xsize() >= block_xsize * 64 && out->ysize() >= block_ysize);
   for (int c = 0; c < 3; ++c) {
     for (size_t block_y = 0; block_y < block_ysize; ++block_y) {
       const float* PIK_RESTRICT row_in = in.PlaneRow(c, block_y);
-      int16_t* PIK_RESTRICT row_out = out.PlaneRow(c, block_y);
+      int16_t* PIK_RESTRICT row_out = out->PlaneRow(c, block_y);
       for (size_t block_x = 0; block_x < block_xsize; ++block_x) {
         const float* PIK_RESTRICT block_in = &row_in[block_x * 64];
         int16_t* PIK_RESTRICT block_out = &row_out[block_x * 64];
-        quantizer.QuantizeBlock(block_x, block_y, c, block_in, block_out);
+        quantizer.QuantizeBlockCountNZ(block_x, block_y, c, block_in,
+                                       block_out);
       }
     }
   }
-  return out;
 }
 
 // Returns DC only; "in" is 1x64 blocks.
 Image3S QuantizeCoeffsDC(const Image3F& in, const Quantizer& quantizer) {
+  Image3S out(in.xsize() / 64, in.ysize());
+  QuantizeCoeffsDC(in, quantizer, &out);
+  return out;
+}
+
+void QuantizeCoeffsDC(const Image3F& in, const Quantizer& quantizer,
+                      Image3S* PIK_RESTRICT out) {
   const size_t block_xsize = in.xsize() / 64;
   const size_t block_ysize = in.ysize();
-  Image3S out(block_xsize, block_ysize);
+  PIK_CHECK(out->xsize() >= block_xsize && out->ysize() >= block_ysize);
   for (int c = 0; c < 3; ++c) {
+    // Same for all blocks.
+    const float scale = quantizer.DCScale(c);
     for (size_t block_y = 0; block_y < block_ysize; ++block_y) {
       const float* PIK_RESTRICT row_in = in.PlaneRow(c, block_y);
-      int16_t* PIK_RESTRICT row_out = out.PlaneRow(c, block_y);
+      int16_t* PIK_RESTRICT row_out = out->PlaneRow(c, block_y);
       for (size_t block_x = 0; block_x < block_xsize; ++block_x) {
-        const float* PIK_RESTRICT block_in = &row_in[block_x * 64];
-        row_out[block_x] =
-            quantizer.QuantizeBlockDC(block_x, block_y, c, block_in);
+        row_out[block_x] = std::round(row_in[block_x * 64] * scale);
       }
     }
   }
-  return out;
 }
 
 // Superceded by QuantizeRoundtrip and DequantizeCoeffsT.
 Image3F DequantizeCoeffs(const Image3S& in, const Quantizer& quantizer) {
+  Image3F out(in.xsize() / 64 * 64, in.ysize());
+  DequantizeCoeffs(in, quantizer, &out);
+  return out;
+}
+
+void DequantizeCoeffs(const Image3S& in, const Quantizer& quantizer,
+                      Image3F* PIK_RESTRICT out) {
   PROFILER_FUNC;
-  const int block_xsize = in.xsize() / 64;
-  const int block_ysize = in.ysize();
-  Image3F out(block_xsize * 64, block_ysize);
+  using namespace SIMD_NAMESPACE;
+  using D = Full<float>;
+  constexpr D d;
+  constexpr Full<int32_t> d32;
+  constexpr Part<int16_t, D::N> d16;
+  const size_t block_xsize = in.xsize() / 64;
+  const size_t block_ysize = in.ysize();
+  PIK_CHECK(out->xsize() >= block_xsize * 64 && out->ysize() >= block_ysize);
   const float inv_quant_dc = quantizer.inv_quant_dc();
   const float* PIK_RESTRICT kDequantMatrix = quantizer.DequantMatrix();
-  const int16_t* all_block_in[3];
-  float* all_block_out[3];
-  for (int by = 0; by < block_ysize; ++by) {
-    for (int c = 0; c < 3; ++c) {
-      all_block_in[c] = in.PlaneRow(c, by);
-      all_block_out[c] = out.PlaneRow(c, by);
-    }
-    for (int bx = 0; bx < block_xsize; ++bx) {
-      const float inv_quant_ac = quantizer.inv_quant_ac(bx, by);
-      const int offset = bx * 64;
+  for (size_t by = 0; by < block_ysize; ++by) {
+    for (size_t bx = 0; bx < block_xsize; ++bx) {
+      const auto inv_quant_ac = set1(d, quantizer.inv_quant_ac(bx, by));
       for (int c = 0; c < 3; ++c) {
-        const int16_t* PIK_RESTRICT block_in = all_block_in[c] + offset;
+        const int16_t* PIK_RESTRICT block_in = in.PlaneRow(c, by) + bx * 64;
         const float* PIK_RESTRICT muls = &kDequantMatrix[c * 64];
-        float* PIK_RESTRICT block_out = all_block_out[c] + offset;
-        for (int k = 0; k < 64; ++k) {
-          block_out[k] = block_in[k] * (muls[k] * inv_quant_ac);
+        float* PIK_RESTRICT block_out = out->PlaneRow(c, by) + bx * 64;
+        for (size_t k = 0; k < 64; k += d.N) {
+          const auto coeffs =
+              convert_to(d, convert_to(d32, load(d16, block_in + k)));
+          store(coeffs * (load(d, muls + k) * inv_quant_ac), d,
+                block_out + k);
         }
         block_out[0] = block_in[0] * (muls[0] * inv_quant_dc);
       }
     }
   }
-  return out;
 }
 
 ImageF QuantizeRoundtrip(const Quantizer& quantizer, int c,
                          const ImageF& coeffs) {
-  const size_t block_xsize = coeffs.xsize() / 64;
-  const size_t block_ysize = coeffs.ysize();
   ImageF out(coeffs.xsize(), coeffs.ysize());
+  QuantizeRoundtrip(quantizer, c, coeffs, &out);
+  return out;
+}
 
-  const float inv_quant_dc = quantizer.inv_quant_dc();
-  const float* PIK_RESTRICT kDequantMatrix = &quantizer.DequantMatrix()[c * 64];
+void QuantizeRoundtrip(const Quantizer& quantizer, int c, const ImageF& coeffs,
+                       ImageF* PIK_RESTRICT out) {
+  const size_t block_xsize = coeffs.xsize() / 64;
+  const size_t block_ysize = coeffs.ysize();
+  PIK_CHECK(SameSize(coeffs, *out));
 
   for (size_t block_y = 0; block_y < block_ysize; ++block_y) {
     const float* PIK_RESTRICT row_in = coeffs.ConstRow(block_y);
-    float* PIK_RESTRICT row_out = out.Row(block_y);
+    float* PIK_RESTRICT row_out = out->Row(block_y);
     for (size_t block_x = 0; block_x < block_xsize; ++block_x) {
-      const float inv_quant_ac = quantizer.inv_quant_ac(block_x, block_y);
-      const float* PIK_RESTRICT block_in = &row_in[block_x * 64];
-      float* PIK_RESTRICT block_out = &row_out[block_x * 64];
-      int16_t qblock[64];
-      quantizer.QuantizeBlock(block_x, block_y, c, block_in, qblock);
-      block_out[0] = qblock[0] * (kDequantMatrix[0] * inv_quant_dc);
-      for (int k = 1; k < 64; ++k) {
-        block_out[k] = qblock[k] * (kDequantMatrix[k] * inv_quant_ac);
-      }
+      quantizer.QuantizeRoundtripBlock(block_x, block_y, c,
+                                       &row_in[block_x * 64],
+                                       &row_out[block_x * 64]);
     }
   }
-  return out;
 }
 
-ImageF QuantizeRoundtripExtract189(const Quantizer& quantizer, int c,
-                                   const ImageF& coeffs) {
+static void QuantizeRoundtripExtract189(const Quantizer& quantizer, int c,
+                                        const ImageF& coeffs,
+                                        ImageF* PIK_RESTRICT out) {
   const size_t block_xsize = coeffs.xsize() / 64;
   const size_t block_ysize = coeffs.ysize();
-  ImageF out(4 * block_xsize, block_ysize);
+  PIK_CHECK(out->xsize() >= 4 * block_xsize && out->ysize() >= block_ysize);
 
   const float* PIK_RESTRICT kDequantMatrix = &quantizer.DequantMatrix()[c * 64];
 
   for (size_t block_y = 0; block_y < block_ysize; ++block_y) {
     const float* PIK_RESTRICT row_in = coeffs.ConstRow(block_y);
-    float* PIK_RESTRICT row_out = out.Row(block_y);
+    float* PIK_RESTRICT row_out = out->Row(block_y);
     for (size_t block_x = 0; block_x < block_xsize; ++block_x) {
       const float inv_quant_ac = quantizer.inv_quant_ac(block_x, block_y);
       const float* PIK_RESTRICT block_in = &row_in[block_x * 64];
@@ -673,75 +759,101 @@ ImageF QuantizeRoundtripExtract189(const Quantizer& quantizer, int c,
       block_out[3] = qblock[9] * (kDequantMatrix[9] * inv_quant_ac);
     }
   }
-  return out;
 }
 
-ImageF QuantizeRoundtripExtractDC(const Quantizer& quantizer, int c,
-                                  const ImageF& coeffs) {
+// "stride" is 64 if "in" has 64 coefficients per block, or 1 for DC images.
+static void QuantizeRoundtripDC(const Quantizer& quantizer, int c,
+                                const ImageF& in, const size_t stride,
+                                ImageF* PIK_RESTRICT out) {
   // All coordinates are blocks.
-  const int block_xsize = coeffs.xsize() / 64;
-  const int block_ysize = coeffs.ysize();
-  ImageF out(block_xsize, block_ysize);
+  const size_t block_xsize = in.xsize() / stride;
+  const size_t block_ysize = in.ysize();
+  PIK_CHECK(out->xsize() >= block_xsize && out->ysize() >= block_ysize);
 
+  // Same for all blocks.
+  const float scale = quantizer.DCScale(c);
   const float mul =
       quantizer.DequantMatrix()[c * 64] * quantizer.inv_quant_dc();
   for (size_t block_y = 0; block_y < block_ysize; ++block_y) {
-    const float* PIK_RESTRICT row_in = coeffs.ConstRow(block_y);
-    float* PIK_RESTRICT row_out = out.Row(block_y);
-    for (size_t block_x = 0; block_x < block_xsize; ++block_x) {
-      const float* PIK_RESTRICT block_in = &row_in[block_x * 64];
-      row_out[block_x] =
-          quantizer.QuantizeBlockDC(block_x, block_y, c, block_in) * mul;
+    const float* PIK_RESTRICT row_in = in.ConstRow(block_y);
+    float* PIK_RESTRICT row_out = out->Row(block_y);
+    if (stride == 1) {
+      using namespace SIMD_NAMESPACE;
+      const Full<float> d;
+      const auto v_scale = set1(d, scale);
+      const auto v_mul = set1(d, mul);
+      // Writing up to one vector past xsize is allowed (see BytesPerRow).
+      for (size_t block_x = 0; block_x < block_xsize; block_x += d.N) {
+        const auto dc = load(d, row_in + block_x) * v_scale;
+        store(RoundHalfAway(d, dc) * v_mul, d, row_out + block_x);
+      }
+    } else {
+      for (size_t block_x = 0; block_x < block_xsize; ++block_x) {
+        row_out[block_x] =
+            std::round(row_in[block_x * stride] * scale) * mul;
+      }
     }
   }
-  return out;
 }
 
-ImageF QuantizeRoundtripDC(const Quantizer& quantizer, int c,
-                           const ImageF& dc) {
-  // All coordinates are blocks.
-  const int block_xsize = dc.xsize();
-  const int block_ysize = dc.ysize();
-  ImageF out(block_xsize, block_ysize);
-
-  const float mul =
-      quantizer.DequantMatrix()[c * 64] * quantizer.inv_quant_dc();
-  for (size_t block_y = 0; block_y < block_ysize; ++block_y) {
-    const float* PIK_RESTRICT row_in = dc.ConstRow(block_y);
-    float* PIK_RESTRICT row_out = out.Row(block_y);
-    for (size_t block_x = 0; block_x < block_xsize; ++block_x) {
-      const float* PIK_RESTRICT block_in = row_in + block_x;
-      row_out[block_x] =
-          quantizer.QuantizeBlockDC(block_x, block_y, c, block_in) * mul;
-    }
-  }
+Image3F QuantizeRoundtrip(const Quantizer& quantizer, const Image3F& coeffs) {
+  Image3F out(coeffs.xsize(), coeffs.ysize());
+  QuantizeRoundtrip(quantizer, coeffs, &out);
   return out;
 }
 
-Image3F QuantizeRoundtrip(const Quantizer& quantizer, const Image3F& coeffs) {
-  return Image3F(QuantizeRoundtrip(quantizer, 0, coeffs.Plane(0)),
-                 QuantizeRoundtrip(quantizer, 1, coeffs.Plane(1)),
-                 QuantizeRoundtrip(quantizer, 2, coeffs.Plane(2)));
+void QuantizeRoundtrip(const Quantizer& quantizer, const Image3F& coeffs,
+                       Image3F* PIK_RESTRICT out) {
+  for (int c = 0; c < 3; ++c) {
+    QuantizeRoundtrip(quantizer, c, coeffs.Plane(c),
+                      out->MutablePlane(c));
+  }
 }
 
 Image3F QuantizeRoundtripExtract189(const Quantizer& quantizer,
                                     const Image3F& coeffs) {
-  return Image3F(QuantizeRoundtripExtract189(quantizer, 0, coeffs.Plane(0)),
-                 QuantizeRoundtripExtract189(quantizer, 1, coeffs.Plane(1)),
-                 QuantizeRoundtripExtract189(quantizer, 2, coeffs.Plane(2)));
+  Image3F out(4 * (coeffs.xsize() / 64), coeffs.ysize());
+  QuantizeRoundtripExtract189(quantizer, coeffs, &out);
+  return out;
+}
+
+void QuantizeRoundtripExtract189(const Quantizer& quantizer,
+                                 const Image3F& coeffs,
+                                 Image3F* PIK_RESTRICT out) {
+  for (int c = 0; c < 3; ++c) {
+    QuantizeRoundtripExtract189(quantizer, c, coeffs.Plane(c),
+                                out->MutablePlane(c));
+  }
 }
 
 Image3F QuantizeRoundtripExtractDC(const Quantizer& quantizer,
                                    const Image3F& coeffs) {
-  return Image3F(QuantizeRoundtripExtractDC(quantizer, 0, coeffs.Plane(0)),
-                 QuantizeRoundtripExtractDC(quantizer, 1, coeffs.Plane(1)),
-                 QuantizeRoundtripExtractDC(quantizer, 2, coeffs.Plane(2)));
+  Image3F out(coeffs.xsize() / 64, coeffs.ysize());
+  QuantizeRoundtripExtractDC(quantizer, coeffs, &out);
+  return out;
 }
 
-Image3F QuantizeRoundtripDC(const Quantizer& quantizer, const Image3F& coeffs) {
-  return Image3F(QuantizeRoundtripDC(quantizer, 0, coeffs.Plane(0)),
-                 QuantizeRoundtripDC(quantizer, 1, coeffs.Plane(1)),
-                 QuantizeRoundtripDC(quantizer, 2, coeffs.Plane(2)));
+void QuantizeRoundtripExtractDC(const Quantizer& quantizer,
+                                const Image3F& coeffs,
+                                Image3F* PIK_RESTRICT out) {
+  for (int c = 0; c < 3; ++c) {
+    QuantizeRoundtripDC(quantizer, c, coeffs.Plane(c), 64,
+                        out->MutablePlane(c));
+  }
+}
+
+Image3F QuantizeRoundtripDC(const Quantizer& quantizer, const Image3F& dc) {
+  Image3F out(dc.xsize(), dc.ysize());
+  QuantizeRoundtripDC(quantizer, dc, &out);
+  return out;
+}
+
+void QuantizeRoundtripDC(const Quantizer& quantizer, const Image3F& dc,
+                         Image3F* PIK_RESTRICT out) {
+  for (int c = 0; c < 3; ++c) {
+    QuantizeRoundtripDC(quantizer, c, dc.Plane(c), 1,
+                        out->MutablePlane(c));
+  }
 }
 
 }  // namespace pik
@@ -172,6 +172,12 @@ class Quantizer {
     }
   }
 
+  // Same result as QuantizeBlock, but vectorized. Returns the number of
+  // nonzero AC coefficients in "block_out". Both pointers must be aligned.
+  size_t QuantizeBlockCountNZ(size_t quant_x, size_t quant_y, int c,
+                              const float* PIK_RESTRICT block_in,
+                              int16_t* PIK_RESTRICT block_out) const;
+
   void QuantizeBlock2x2(size_t quant_x, size_t quant_y, int c,
                         const float* PIK_RESTRICT block_in,
                         int16_t* PIK_RESTRICT block_out) const {
@@ -185,6 +191,18 @@ class Quantizer {
     block_out[9] = std::abs(val9) < thres ? 0 : std::round(val9);
   }
 
+  // Same result as QuantizeBlock followed by dequantization, but vectorized.
+  // Both pointers must be aligned.
+  void QuantizeRoundtripBlock(size_t quant_x, size_t quant_y, int c,
+                              const float* PIK_RESTRICT block_in,
+                              float* PIK_RESTRICT block_out) const;
+
+  // Returns the factor by which QuantizeBlockDC multiplies DC. It is the
+  // same for all blocks.
+  float DCScale(int c) const {
+    return bq_[c].Get(QuantizerKey(0, 0)).scales[0];
+  }
+
   // Returns only DC.
   int16_t QuantizeBlockDC(size_t quant_x, size_t quant_y, int c,
                           const float* PIK_RESTRICT block_in) const {
@@ -277,25 +295,47 @@ class Quantizer {
 
 const float* DequantMatrix(int id);
 
+// The overloads with an "out" argument write to a preallocated image of at
+// least the size the other overload returns, which avoids reallocating it in
+// encoder search loops. "out" must not alias the input.
+
 Image3S QuantizeCoeffs(const Image3F& in, const Quantizer& quantizer);
+void QuantizeCoeffs(const Image3F& in, const Quantizer& quantizer,
+                    Image3S* PIK_RESTRICT out);
 Image3S QuantizeCoeffsDC(const Image3F& in, const Quantizer& quantizer);
+void QuantizeCoeffsDC(const Image3F& in, const Quantizer& quantizer,
+                      Image3S* PIK_RESTRICT out);
 Image3F DequantizeCoeffs(const Image3S& in, const Quantizer& quantizer);
+void DequantizeCoeffs(const Image3S& in, const Quantizer& quantizer,
+                      Image3F* PIK_RESTRICT out);
 
 // Returns 64 coefficients per block.
 ImageF QuantizeRoundtrip(const Quantizer& quantizer, int c,
                          const ImageF& coeffs);
+void QuantizeRoundtrip(const Quantizer& quantizer, int c, const ImageF& coeffs,
+                       ImageF* PIK_RESTRICT out);
 Image3F QuantizeRoundtrip(const Quantizer& quantizer, const Image3F& coeffs);
+void QuantizeRoundtrip(const Quantizer& quantizer, const Image3F& coeffs,
+                       Image3F* PIK_RESTRICT out);
 
 // Returns 1x4 [--, 1, 8, 9] per block.
 Image3F QuantizeRoundtripExtract189(const Quantizer& quantizer,
                                     const Image3F& coeffs);
+void QuantizeRoundtripExtract189(const Quantizer& quantizer,
+                                 const Image3F& coeffs,
+                                 Image3F* PIK_RESTRICT out);
 
 // Returns 1 DC per block.
 Image3F QuantizeRoundtripExtractDC(const Quantizer& quantizer,
                                    const Image3F& coeffs);
+void QuantizeRoundtripExtractDC(const Quantizer& quantizer,
+                                const Image3F& coeffs,
+                                Image3F* PIK_RESTRICT out);
 
 // Input is already 1 DC per block!
 Image3F QuantizeRoundtripDC(const Quantizer& quantizer, const Image3F& dc);
+void QuantizeRoundtripDC(const Quantizer& quantizer, const Image3F& dc,
+                         Image3F* PIK_RESTRICT out);
 
 // Returns the matrix of the quadratic function
 //
@@ -248,7 +248,6 @@ namespace slow {
 // (cache thrashing) due to separate X/Y passes through the entire image.
 class Upsampler {
  public:
-  // TODO(janwas): add ExecutorPool overload
   template <class Executor, class Kernel>
   static void Run(const Executor executor, const ImageF& in,
                   const Kernel& kernel, ImageF* PIK_RESTRICT out) {
@@ -259,20 +258,22 @@ class Upsampler {
     ImageF resampled_rows(out_xsize, in_ysize);
     PROFILER_ZONE("slow::Upsampler");
 
-    for (size_t y = 0; y < in_ysize; ++y) {
+    executor.Run(0, in_ysize, [&](const int task, const int thread) {
+      const size_t y = task;
       const float* PIK_RESTRICT in_row = in.ConstRow(y);
       float* PIK_RESTRICT out_row = resampled_rows.Row(y);
       Upsample1D(in_row, in_xsize, 1, kernel, out_row, out_xsize, 1);
-    }
+    });
 
     const size_t in_stride = resampled_rows.bytes_per_row() / sizeof(float);
     const size_t out_stride = out->bytes_per_row() / sizeof(float);
-    for (size_t out_x = 0; out_x < out_xsize; ++out_x) {
+    executor.Run(0, out_xsize, [&](const int task, const int thread) {
+      const size_t out_x = task;
       const float* PIK_RESTRICT in_col = resampled_rows.Row(0) + out_x;
       float* PIK_RESTRICT out_col = out->Row(0) + out_x;
       Upsample1D(in_col, in_ysize, in_stride, kernel, out_col, out_ysize,
                  out_stride);
-    }
+    });
   }
 
   template <class Executor, class Kernel>
@@ -313,7 +314,6 @@ class Upsampler {
 // and kernel size.
 class GeneralUpsamplerFromSeparable {
  public:
-  // TODO(janwas): add ExecutorPool overload
   template <class Executor, class Kernel>
   static void Run(const Executor executor, const ImageF& in,
                   const Kernel& kernel, ImageF* PIK_RESTRICT out) {
@@ -323,9 +323,10 @@ class GeneralUpsamplerFromSeparable {
     const size_t out_ysize = out->ysize();
     PROFILER_ZONE("slow::GeneralUpsamplerFromSeparable");
 
-    const int64_t kWidth = 2 * Kernel::kRadius;  // even
+    constexpr int64_t kWidth = 2 * Kernel::kRadius;  // even
 
-    for (size_t out_y = 0; out_y < out_ysize; ++out_y) {
+    executor.Run(0, out_ysize, [&](const int task, const int thread) {
+      const size_t out_y = task;
       float* PIK_RESTRICT out_row = out->Row(out_y);
       const float in_fy = ((out_y + 0.5f) / out_ysize) * in_ysize - 0.5f;
       const int64_t top = ceil(in_fy - Kernel::kRadius);
@@ -358,7 +359,7 @@ class GeneralUpsamplerFromSeparable {
 
         out_row[out_x] = sum;
       }
-    }
+    });
   }
 
   template <class Executor, class Kernel>
@@ -376,7 +377,6 @@ class GeneralUpsamplerFromSeparable {
 template<int64_t kScale>
 class GeneralUpsampler {
  public:
-  // TODO(janwas): add ExecutorPool overload
   template <class Executor, class Kernel>
   static void Run(const Executor executor, const ImageF& in,
                   const Kernel& kernel, ImageF* PIK_RESTRICT out) {
@@ -386,10 +386,11 @@ class GeneralUpsampler {
     const size_t out_ysize = out->ysize();
     PROFILER_ZONE("slow::GeneralUpsampler");
 
-    const int64_t kWidth = 2 * Kernel::kRadius;  // even
+    constexpr int64_t kWidth = 2 * Kernel::kRadius;  // even
     const float* PIK_RESTRICT weights = kernel.Weights2D();
 
-    for (size_t out_y = 0; out_y < out_ysize; ++out_y) {
+    executor.Run(0, out_ysize, [&](const int task, const int thread) {
+      const size_t out_y = task;
       float* PIK_RESTRICT out_row = out->Row(out_y);
       const float in_fy = ((out_y + 0.5f) / out_ysize) * in_ysize - 0.5f;
       const int64_t top = ceil(in_fy - Kernel::kRadius);
@@ -425,7 +426,7 @@ class GeneralUpsampler {
 
         out_row[out_x] = sum;
       }
-    }
+    });
   }
 
   template <class Executor, class Kernel>
@@ -441,6 +442,10 @@ class GeneralUpsampler {
 
 }  // namespace slow
 
+// The SIMD upsamplers differ per target, hence the namespace: see
+// Upsample8_6x6Impl for callers compiled without the target's flags.
+namespace SIMD_NAMESPACE {
+
 // Shared code factored out of *Upsample8. CRTP: Derived needs kScale etc. and
 // implements ProducePair.
 template <int64_t kRadiusArg, class Derived>
@@ -720,7 +725,7 @@ class Upsampler8 : public Upsampler8Base<2, Upsampler8> {
                                         const float* PIK_RESTRICT weights,
                                         const V wy, V* PIK_RESTRICT out0,
                                         V* PIK_RESTRICT out1) {
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     using namespace SIMD_NAMESPACE;
     const D d;
     const size_t mod_x = 0;  // because 2 * d.N == 2 * kScale
@@ -838,7 +843,7 @@ class GeneralUpsampler8 : public Upsampler8Base<2, GeneralUpsampler8> {
       const float* PIK_RESTRICT row_b2, const size_t in_xsize,
       const WrapX wrap_x, const float* PIK_RESTRICT weights,
       float* PIK_RESTRICT row_out) {
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     using namespace SIMD_NAMESPACE;
     const D d;
     const int64_t mod_x = 0;  // because 2 * d.N == 2 * kScale
@@ -1195,7 +1200,7 @@ class GeneralUpsampler8_6x6 : public Upsampler8Base<3, GeneralUpsampler8_6x6> {
       float* PIK_RESTRICT row_out) {
     using namespace SIMD_NAMESPACE;
     const D d;
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     const int64_t mod_x = 0;  // because 2 * d.N == 2 * kScale
 
     // We'll load 8 input values from each row at these (wrapped) coordinates.
@@ -1315,7 +1320,7 @@ class GeneralUpsampler8_6x6 : public Upsampler8Base<3, GeneralUpsampler8_6x6> {
   }
 
  private:
-#if SIMD_TARGET_VALUE != SIMD_AVX2
+#if SIMD_TARGET_VALUE != SIMD_AVX2 && SIMD_TARGET_VALUE != SIMD_SVE256
   // If less than 8 lanes, produce a single output vector at a time because
   // there is not much benefit from pairwise unrolling.
   template <class WrapX>
@@ -1395,6 +1400,19 @@ class GeneralUpsampler8_6x6 : public Upsampler8Base<3, GeneralUpsampler8_6x6> {
 #endif
 };
 
+}  // namespace SIMD_NAMESPACE
+
+// Per-target GeneralUpsampler8_6x6, defined in resample_target.cc; callers
+// select the best one via dispatch::Run. Rows are upsampled in parallel.
+struct Upsample8_6x6Impl {
+  template <class Target>
+  void operator()(const ImageF& in, const kernel::Custom<3>& kernel,
+                  ThreadPool* pool, ImageF* out) const;
+  template <class Target>
+  void operator()(const Image3F& in, const kernel::Custom<3>& kernel,
+                  ThreadPool* pool, Image3F* out) const;
+};
+
 }  // namespace pik
 
 #endif  // RESAMPLE_H_
@@ -0,0 +1,38 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compiled once per SIMD target (see CMakeLists.txt); compressed_image.cc
+// selects the best one via dispatch::Run.
+
+#include "resample.h"
+
+namespace pik {
+
+template <>
+void Upsample8_6x6Impl::operator()<SIMD_TARGET>(
+    const ImageF& in, const kernel::Custom<3>& kernel, ThreadPool* pool,
+    ImageF* out) const {
+  Upsample<SIMD_NAMESPACE::GeneralUpsampler8_6x6>(ExecutorPool(pool), in,
+                                                  kernel, out);
+}
+
+template <>
+void Upsample8_6x6Impl::operator()<SIMD_TARGET>(
+    const Image3F& in, const kernel::Custom<3>& kernel, ThreadPool* pool,
+    Image3F* out) const {
+  Upsample<SIMD_NAMESPACE::GeneralUpsampler8_6x6>(ExecutorPool(pool), in,
+                                                  kernel, out);
+}
+
+}  // namespace pik
@@ -204,6 +204,81 @@ class ReadSectionVisitor {
   BitReader* PIK_RESTRICT reader_;  // not owned
 };
 
+}  // namespace
+
+// Records section positions and skips their fields (see LazySections).
+class LazySectionVisitor {
+ public:
+  LazySectionVisitor(BitReader* reader, LazySections* PIK_RESTRICT lazy)
+      : reader_(reader), lazy_(lazy) {
+    section_bits_.Load(reader_);
+    section_sizes_.Load(section_bits_, reader_);
+  }
+
+  template <class T>
+  void operator()(std::unique_ptr<T>* PIK_RESTRICT unused) {
+    ++idx_section_;
+    if (!section_bits_.TestAndReset(idx_section_)) {
+      return;
+    }
+
+    lazy_->bits_ |= 1U << idx_section_;
+    lazy_->bit_pos_[idx_section_] = reader_->BitsRead();
+    // Only receives the integer fields; byte arrays remain empty.
+    T fields;
+    SkipFieldsVisitor field_skipper(reader_);
+    VisitFields(&field_skipper, &fields);
+    lazy_->payload_bit_pos_[idx_section_] = field_skipper.PayloadBitPos();
+    lazy_->payload_size_[idx_section_] = field_skipper.NumBytes();
+  }
+
+  void SkipUnknown() {
+    section_bits_.Foreach([this](const int idx) {
+      reader_->SkipBits(section_sizes_.Get(idx));
+    });
+  }
+
+ private:
+  int idx_section_ = -1;      // pre-incremented
+  SectionBits section_bits_;  // Cleared after visiting each known section.
+  SectionSizes section_sizes_;
+  BitReader* PIK_RESTRICT reader_;  // not owned
+  LazySections* PIK_RESTRICT lazy_;  // not owned
+};
+
+namespace {
+
+// Decodes the requested sections recorded by LazySections.
+class MaterializeSectionVisitor {
+ public:
+  MaterializeSectionVisitor(const uint8_t* data, const size_t size,
+                            const uint32_t which, const size_t* bit_pos)
+      : data_(data), size_(size), which_(which), bit_pos_(bit_pos) {}
+
+  template <class T>
+  void operator()(std::unique_ptr<T>* PIK_RESTRICT ptr) {
+    ++idx_section_;
+    if ((which_ & (1U << idx_section_)) == 0) return;
+
+    BitReader reader(data_, size_);
+    reader.SkipBits(bit_pos_[idx_section_]);
+    ptr->reset(new T);
+    ReadFieldsVisitor field_reader(&reader);
+    VisitFields(&field_reader, ptr->get());
+    ok_ &= reader.Position() <= size_;
+  }
+
+  bool OK() const { return ok_; }
+
+ private:
+  int idx_section_ = -1;  // pre-incremented
+  const uint8_t* data_;
+  const size_t size_;
+  const uint32_t which_;
+  const size_t* bit_pos_;
+  bool ok_ = true;
+};
+
 // Writes fields.
 class WriteSectionVisitor {
  public:
@@ -239,6 +314,49 @@ bool LoadSections(BitReader* reader, Sections* PIK_RESTRICT sections) {
   return true;
 }
 
+bool LazySections::Load(const uint8_t* data, const size_t size,
+                        BitReader* reader) {
+  data_ = data;
+  size_ = size;
+  bits_ = 0;
+  LazySectionVisitor section_visitor(reader, this);
+  Sections unused;
+  VisitSections(&section_visitor, &unused);
+  section_visitor.SkipUnknown();
+  if (reader->Position() > size) return PIK_FAILURE("Truncated sections.");
+  return true;
+}
+
+bool LazySections::Materialize(const uint32_t which,
+                               Sections* PIK_RESTRICT sections) const {
+  MaterializeSectionVisitor section_visitor(data_, size_, which & bits_,
+                                            bit_pos_.data());
+  VisitSections(&section_visitor, sections);
+  if (!section_visitor.OK()) return PIK_FAILURE("Truncated section.");
+  return true;
+}
+
+bool LazySections::GetBytes(const int idx, BytesSpan* PIK_RESTRICT span) const {
+  PIK_CHECK(idx == Sections::kIndexICC || idx == Sections::kIndexEXIF ||
+            idx == Sections::kIndexXMP);
+  if (!Has(idx)) return false;
+  const size_t bit_pos = payload_bit_pos_[idx];
+  if (bit_pos % 8 != 0) return false;
+  const size_t num_bytes = payload_size_[idx];
+  if (bit_pos / 8 + num_bytes > size_) return false;
+  span->data = data_ + bit_pos / 8;
+  span->size = num_bytes;
+  return true;
+}
+
+uint32_t LoadSectionBits(BitReader* reader) {
+  SectionBits section_bits;
+  section_bits.Load(reader);
+  uint32_t bits = 0;
+  section_bits.Foreach([&bits](const int idx) { bits |= 1U << idx; });
+  return bits;
+}
+
 bool StoreSections(const Sections& sections, size_t* PIK_RESTRICT pos,
                    uint8_t* storage) {
   CanEncodeSectionVisitor can_encode;
@@ -19,6 +19,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -42,7 +43,20 @@ namespace pik {
 
 // Alpha channel (lossless compression).
 struct Alpha {
-  enum { kModeBrotli, kModeTransform, kModeInvalid };
+  // kModeBrotliGroups: bands of kGroupHeightInBlocks * kBlockHeight rows,
+  // each with its own Brotli stream (empty if fully opaque), preceded by their
+  // sizes.
+  // kModeConstant: "encoded" is the single little-endian value.
+  // kModeBinary: Brotli-compressed varint lengths of alternating 0 and opaque
+  // runs in raster order, starting with 0.
+  enum {
+    kModeBrotli,
+    kModeTransform,
+    kModeBrotliGroups,
+    kModeConstant,
+    kModeBinary,
+    kModeInvalid
+  };
 
   uint32_t mode = kModeBrotli;
   uint32_t bytes_per_alpha = 1;
@@ -116,18 +130,54 @@ void VisitFields(Visitor* PIK_RESTRICT visitor, XMP* PIK_RESTRICT xmp) {
   (*visitor)(&xmp->metadata);
 }
 
+// Downscaled copies of the image for viewers that display it at a fraction of
+// its resolution. Level i (from 0) is a complete PIK stream (default bitstream
+// with its own TOC and alpha) of the image downscaled by 4^(i+1), i.e.
+// DivCeil(xsize, 4^(i+1)) x DivCeil(ysize, 4^(i+1)) pixels.
+struct Pyramid {
+  static constexpr size_t kMaxLevels = 4;
+
+  uint32_t num_levels = 0;  // 1 to kMaxLevels
+  std::vector<std::vector<uint8_t>> levels;
+};
+
+template <class Visitor>
+void VisitFields(Visitor* PIK_RESTRICT visitor, Pyramid* PIK_RESTRICT pyramid) {
+  (*visitor)(0x84838281, &pyramid->num_levels);
+  // No-op when writing (num_levels == levels.size()).
+  pyramid->levels.resize(pyramid->num_levels);
+  for (std::vector<uint8_t>& level : pyramid->levels) {
+    (*visitor)(&level);
+  }
+}
+
 struct Sections {
+  // Bit index of each section in the result of LoadSectionBits.
+  enum {
+    kIndexAlpha = 0,
+    kIndexPalette,
+    kIndexICC,
+    kIndexEXIF,
+    kIndexXMP,
+    kIndexPyramid
+  };
+
   // Number of known sections at the time the bitstream was frozen. No need to
   // encode size if idx_section < kNumKnown because the decoder already knows
   // how to to read them. Do not change this after freezing!
   static constexpr size_t kNumKnown = 5;
 
+  // Number of sections this code knows how to read (including those added
+  // after freezing, whose size is encoded).
+  static constexpr size_t kNumSections = 6;
+
   // Valid/present if non-null.
   std::unique_ptr<Alpha> alpha;
   std::unique_ptr<Palette> palette;
   std::unique_ptr<ICC> icc;
   std::unique_ptr<EXIF> exif;
   std::unique_ptr<XMP> xmp;
+  std::unique_ptr<Pyramid> pyramid;
   // Add new section member before this comment.
 };
 
@@ -140,6 +190,7 @@ void VisitSections(Visitor* PIK_RESTRICT visitor,
   (*visitor)(&sections->icc);
   (*visitor)(&sections->exif);
   (*visitor)(&sections->xmp);
+  (*visitor)(&sections->pyramid);
   // Add new section visitor before this comment.
 }
 
@@ -151,9 +202,55 @@ bool CanEncode(const Sections& sections, size_t* PIK_RESTRICT encoded_bits);
 
 bool LoadSections(BitReader* source, Sections* PIK_RESTRICT sections);
 
+// Returns the bit field indicating which sections are present (see
+// Sections::kIndex*), without reading their sizes or fields. Afterwards,
+// "source" is no longer positioned at a field boundary, so this is only useful
+// for inspecting files without decoding them.
+uint32_t LoadSectionBits(BitReader* source);
+
 bool StoreSections(const Sections& sections, size_t* PIK_RESTRICT pos,
                    uint8_t* storage);
 
+// Non-owning view of bytes within the compressed stream.
+struct BytesSpan {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// Alternative to LoadSections for decoders that only need some of the
+// sections: records where each present section begins instead of copying its
+// (possibly large, e.g. EXIF) payload. The stream passed to Load must outlive
+// this object.
+class LazySections {
+ public:
+  // Reads the section bits and sizes and skips past all sections. Afterwards,
+  // "reader" is positioned like after LoadSections.
+  bool Load(const uint8_t* data, size_t size, BitReader* reader);
+
+  // Returns whether the section Sections::kIndex* is present.
+  bool Has(const int idx) const { return (bits_ & (1U << idx)) != 0; }
+
+  // Decodes the present sections whose index bits are set in "which" (e.g.
+  // 1U << Sections::kIndexAlpha) into the corresponding members of "sections".
+  bool Materialize(uint32_t which, Sections* PIK_RESTRICT sections) const;
+
+  // For the single-field sections ICC, EXIF and XMP: points "span" at their
+  // payload within the stream. Returns false if the section is absent or its
+  // payload is not byte-aligned, in which case callers must Materialize it.
+  bool GetBytes(const int idx, BytesSpan* PIK_RESTRICT span) const;
+
+ private:
+  friend class LazySectionVisitor;
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  uint32_t bits_ = 0;  // known and present sections
+  // Per known section: start of its fields and of its last byte array [bits].
+  std::array<size_t, Sections::kNumSections> bit_pos_;
+  std::array<size_t, Sections::kNumSections> payload_bit_pos_;
+  std::array<uint32_t, Sections::kNumSections> payload_size_;
+};
+
 // For use by test - requires access to internal data structures.
 void TestUnsupportedSection();
 
@@ -159,6 +159,17 @@ struct raw_arm8<float, 1> {
   using type = float32x2_t;
 };
 
+// 16 (same as 64)
+template <>
+struct raw_arm8<uint16_t, 1> {
+  using type = uint16x4_t;
+};
+
+template <>
+struct raw_arm8<int16_t, 1> {
+  using type = int16x4_t;
+};
+
 // Returned by set_table_indices for use by table_lookup_lanes.
 template <typename T>
 struct permute_sse4 {
@@ -445,6 +456,15 @@ SIMD_INLINE vec_arm8<float, 1> set1(Desc<float, 1, ARM8>, const float t) {
   return vec_arm8<float, 1>(vdup_n_f32(t));
 }
 
+// 16
+SIMD_INLINE vec_arm8<uint16_t, 1> set1(Desc<uint16_t, 1, ARM8>,
+                                       const uint16_t t) {
+  return vec_arm8<uint16_t, 1>(vdup_n_u16(t));
+}
+SIMD_INLINE vec_arm8<int16_t, 1> set1(Desc<int16_t, 1, ARM8>, const int16_t t) {
+  return vec_arm8<int16_t, 1>(vdup_n_s16(t));
+}
+
 // Returns an all-zero vector.
 template <typename T, size_t N>
 SIMD_INLINE vec_arm8<T, N> setzero(Desc<T, N, ARM8> d) {
@@ -1775,6 +1795,21 @@ SIMD_INLINE vec_arm8<float, 1> load(Desc<float, 1, ARM8> d,
   return vec_arm8<float, 1>(b);
 }
 
+// ------------------------------ Load 16
+
+SIMD_INLINE vec_arm8<uint16_t, 1> load(Desc<uint16_t, 1, ARM8> d,
+                                       const uint16_t* SIMD_RESTRICT p) {
+  uint16x4_t a = undefined(d).raw;
+  uint16x4_t b = vld1_lane_u16(p, a, 0);
+  return vec_arm8<uint16_t, 1>(b);
+}
+SIMD_INLINE vec_arm8<int16_t, 1> load(Desc<int16_t, 1, ARM8> d,
+                                      const int16_t* SIMD_RESTRICT p) {
+  int16x4_t a = undefined(d).raw;
+  int16x4_t b = vld1_lane_s16(p, a, 0);
+  return vec_arm8<int16_t, 1>(b);
+}
+
 // ------------------------------ Store 128
 
 SIMD_INLINE void store_unaligned(const vec_arm8<uint8_t> v, Full<uint8_t, ARM8>,
@@ -1905,6 +1940,17 @@ SIMD_INLINE void store(const vec_arm8<float, 1> v, Desc<float, 1, ARM8>,
   vst1_lane_f32(p, v.raw, 0);
 }
 
+// ------------------------------ Store 16
+
+SIMD_INLINE void store(const vec_arm8<uint16_t, 1> v, Desc<uint16_t, 1, ARM8>,
+                       uint16_t* SIMD_RESTRICT p) {
+  vst1_lane_u16(p, v.raw, 0);
+}
+SIMD_INLINE void store(const vec_arm8<int16_t, 1> v, Desc<int16_t, 1, ARM8>,
+                       int16_t* SIMD_RESTRICT p) {
+  vst1_lane_s16(p, v.raw, 0);
+}
+
 // ------------------------------ Non-temporal stores
 
 // Same as aligned stores on non-x86.
@@ -2404,7 +2450,7 @@ template <typename T, size_t N>
 SIMD_INLINE T get_part(Desc<T, 1, ARM8> d, const vec_arm8<T, N> v) {
   // TODO(janwas): more efficient implementation?
   SIMD_ALIGN T ret[N];
-  store(v, Desc<T, N, ARM8>(), &ret);
+  store(v, Desc<T, N, ARM8>(), ret);
   return ret[0];
 }
 
@@ -2479,6 +2525,15 @@ SIMD_INLINE vec_arm8<float, 1> any_part(Desc<float, 1, ARM8>,
   return vec_arm8<float, 1>(vget_low_f32(v.raw));
 }
 
+SIMD_INLINE vec_arm8<uint16_t, 1> any_part(Desc<uint16_t, 1, ARM8>,
+                                           const vec_arm8<uint16_t> v) {
+  return vec_arm8<uint16_t, 1>(vget_low_u16(v.raw));
+}
+SIMD_INLINE vec_arm8<int16_t, 1> any_part(Desc<int16_t, 1, ARM8>,
+                                          const vec_arm8<int16_t> v) {
+  return vec_arm8<int16_t, 1>(vget_low_s16(v.raw));
+}
+
 // Returns full vector with the given part's lane broadcasted. Note that
 // callers cannot use broadcast directly because part lane order is undefined.
 template <int kLane, typename T, size_t N>
@@ -2487,6 +2542,44 @@ SIMD_INLINE vec_arm8<T> broadcast_part(Full<T, ARM8>, const vec_arm8<T, N> v) {
   return broadcast<kLane>(vec_arm8<T>(v.raw));
 }
 
+// Parts of at most 64 bits have a 64-bit raw type, hence the dup_lane.
+template <int kLane>
+SIMD_INLINE vec_arm8<uint16_t> broadcast_part(Full<uint16_t, ARM8>,
+                                              const vec_arm8<uint16_t, 1> v) {
+  static_assert(kLane == 0, "Invalid lane");
+  return vec_arm8<uint16_t>(vdupq_lane_u16(v.raw, kLane));
+}
+template <int kLane>
+SIMD_INLINE vec_arm8<uint16_t> broadcast_part(Full<uint16_t, ARM8>,
+                                              const vec_arm8<uint16_t, 2> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  return vec_arm8<uint16_t>(vdupq_lane_u16(v.raw, kLane));
+}
+template <int kLane>
+SIMD_INLINE vec_arm8<uint16_t> broadcast_part(Full<uint16_t, ARM8>,
+                                              const vec_arm8<uint16_t, 4> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  return vec_arm8<uint16_t>(vdupq_lane_u16(v.raw, kLane));
+}
+template <int kLane>
+SIMD_INLINE vec_arm8<int16_t> broadcast_part(Full<int16_t, ARM8>,
+                                             const vec_arm8<int16_t, 1> v) {
+  static_assert(kLane == 0, "Invalid lane");
+  return vec_arm8<int16_t>(vdupq_lane_s16(v.raw, kLane));
+}
+template <int kLane>
+SIMD_INLINE vec_arm8<int16_t> broadcast_part(Full<int16_t, ARM8>,
+                                             const vec_arm8<int16_t, 2> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  return vec_arm8<int16_t>(vdupq_lane_s16(v.raw, kLane));
+}
+template <int kLane>
+SIMD_INLINE vec_arm8<int16_t> broadcast_part(Full<int16_t, ARM8>,
+                                             const vec_arm8<int16_t, 4> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  return vec_arm8<int16_t>(vdupq_lane_s16(v.raw, kLane));
+}
+
 // ------------------------------ Blocks
 
 // hiH,hiL loH,loL |-> hiL,loL (= lower halves)
@@ -2613,6 +2706,22 @@ SIMD_INLINE bool all_zero(const vec_arm8<T> v) {
   return vreinterpret_u64_u32(a)[0] == 0;
 }
 
+// ------------------------------ minpos
+
+// Returns index and min value in lanes 1 and 0; other lanes are zero. Same
+// as x86 minpos: the lowest index wins if several lanes are minimal.
+SIMD_INLINE vec_arm8<uint16_t> minpos(const vec_arm8<uint16_t> v) {
+  static constexpr uint16x8_t kIndex = {0, 1, 2, 3, 4, 5, 6, 7};
+  const uint16_t min_value = vminvq_u16(v.raw);
+  const uint16x8_t is_min = vceqq_u16(v.raw, vdupq_n_u16(min_value));
+  // Lanes that are not minimal become 0xFFFF and thus lose.
+  const uint16_t index = vminvq_u16(vornq_u16(kIndex, is_min));
+  uint16x8_t ret = vdupq_n_u16(0);
+  ret = vsetq_lane_u16(min_value, ret, 0);
+  ret = vsetq_lane_u16(index, ret, 1);
+  return vec_arm8<uint16_t>(ret);
+}
+
 // ------------------------------ Horizontal sum (reduction)
 
 // Returns 64-bit sums of 8-byte groups.
@@ -0,0 +1,1619 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// 256-bit ARM SVE vectors and operations (requires -msve-vector-bits=256).
+// (No include guard nor namespace: this is included from the middle of simd.h.)
+
+// WARNING: for compatibility with AVX2, operations do not cross 128-bit block
+// boundaries unless AVX2 does. This allows sharing the AVX2 code paths.
+// Parts of at most 128 bits are NEON vectors from arm64_neon.h.
+
+// Avoid compile errors when generating deps.mk.
+#if SIMD_DEPS == 0
+
+// Sizeless ACLE types cannot be class members; these fixed-size variants can.
+typedef svuint8_t raw_sve256_u8 __attribute__((arm_sve_vector_bits(256)));
+typedef svuint16_t raw_sve256_u16 __attribute__((arm_sve_vector_bits(256)));
+typedef svuint32_t raw_sve256_u32 __attribute__((arm_sve_vector_bits(256)));
+typedef svuint64_t raw_sve256_u64 __attribute__((arm_sve_vector_bits(256)));
+typedef svint8_t raw_sve256_i8 __attribute__((arm_sve_vector_bits(256)));
+typedef svint16_t raw_sve256_i16 __attribute__((arm_sve_vector_bits(256)));
+typedef svint32_t raw_sve256_i32 __attribute__((arm_sve_vector_bits(256)));
+typedef svint64_t raw_sve256_i64 __attribute__((arm_sve_vector_bits(256)));
+typedef svfloat32_t raw_sve256_f32 __attribute__((arm_sve_vector_bits(256)));
+typedef svfloat64_t raw_sve256_f64 __attribute__((arm_sve_vector_bits(256)));
+
+template <typename T>
+struct raw_sve256;
+template <>
+struct raw_sve256<uint8_t> {
+  using type = raw_sve256_u8;
+};
+template <>
+struct raw_sve256<uint16_t> {
+  using type = raw_sve256_u16;
+};
+template <>
+struct raw_sve256<uint32_t> {
+  using type = raw_sve256_u32;
+};
+template <>
+struct raw_sve256<uint64_t> {
+  using type = raw_sve256_u64;
+};
+template <>
+struct raw_sve256<int8_t> {
+  using type = raw_sve256_i8;
+};
+template <>
+struct raw_sve256<int16_t> {
+  using type = raw_sve256_i16;
+};
+template <>
+struct raw_sve256<int32_t> {
+  using type = raw_sve256_i32;
+};
+template <>
+struct raw_sve256<int64_t> {
+  using type = raw_sve256_i64;
+};
+template <>
+struct raw_sve256<float> {
+  using type = raw_sve256_f32;
+};
+template <>
+struct raw_sve256<double> {
+  using type = raw_sve256_f64;
+};
+
+// Returned by set_table_indices for use by table_lookup_lanes.
+template <typename T>
+struct permute_sve256 {
+  raw_sve256_u32 raw;
+};
+
+// Returned by set_shift_*_count; do not use directly.
+struct sve256_shift_left_count {
+  int bits;
+};
+struct sve256_shift_right_count {
+  int bits;
+};
+
+template <typename T, size_t N = SVE256::NumLanes<T>()>
+class vec_sve256 {
+  using Raw = typename raw_sve256<T>::type;
+
+ public:
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256() {}
+  vec_sve256(const vec_sve256&) = default;
+  vec_sve256& operator=(const vec_sve256&) = default;
+  SIMD_ATTR_SVE256 SIMD_INLINE explicit vec_sve256(const Raw raw) : raw(raw) {}
+
+  // Compound assignment. Only usable if there is a corresponding non-member
+  // binary operator overload. For example, only f32 and f64 support division.
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256& operator*=(const vec_sve256 other) {
+    return *this = (*this * other);
+  }
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256& operator/=(const vec_sve256 other) {
+    return *this = (*this / other);
+  }
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256& operator+=(const vec_sve256 other) {
+    return *this = (*this + other);
+  }
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256& operator-=(const vec_sve256 other) {
+    return *this = (*this - other);
+  }
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256& operator&=(const vec_sve256 other) {
+    return *this = (*this & other);
+  }
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256& operator|=(const vec_sve256 other) {
+    return *this = (*this | other);
+  }
+  SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256& operator^=(const vec_sve256 other) {
+    return *this = (*this ^ other);
+  }
+
+  Raw raw;
+};
+
+template <typename T, size_t N>
+struct VecT<T, N, SVE256> {
+  using type = vec_sve256<T, N>;
+};
+
+using u8x32 = vec_sve256<uint8_t, 32>;
+using u16x16 = vec_sve256<uint16_t, 16>;
+using u32x8 = vec_sve256<uint32_t, 8>;
+using u64x4 = vec_sve256<uint64_t, 4>;
+using i8x32 = vec_sve256<int8_t, 32>;
+using i16x16 = vec_sve256<int16_t, 16>;
+using i32x8 = vec_sve256<int32_t, 8>;
+using i64x4 = vec_sve256<int64_t, 4>;
+using f32x8 = vec_sve256<float, 8>;
+using f64x4 = vec_sve256<double, 4>;
+
+// ------------------------------ Cast
+
+// cast_to_u8
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint8_t, N> cast_to_u8(
+    Desc<uint8_t, N, SVE256>, vec_sve256<T, N / sizeof(T)> v) {
+  return vec_sve256<uint8_t, N>(svreinterpret_u8(v.raw));
+}
+
+// Cannot rely on svreinterpret overloads because only the return types differ;
+// the first argument selects the lane type.
+SIMD_ATTR_SVE256 SIMD_INLINE svuint8_t BitCastFromU8(uint8_t, svuint8_t v) {
+  return v;
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svuint16_t BitCastFromU8(uint16_t, svuint8_t v) {
+  return svreinterpret_u16(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svuint32_t BitCastFromU8(uint32_t, svuint8_t v) {
+  return svreinterpret_u32(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svuint64_t BitCastFromU8(uint64_t, svuint8_t v) {
+  return svreinterpret_u64(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svint8_t BitCastFromU8(int8_t, svuint8_t v) {
+  return svreinterpret_s8(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svint16_t BitCastFromU8(int16_t, svuint8_t v) {
+  return svreinterpret_s16(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svint32_t BitCastFromU8(int32_t, svuint8_t v) {
+  return svreinterpret_s32(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svint64_t BitCastFromU8(int64_t, svuint8_t v) {
+  return svreinterpret_s64(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svfloat32_t BitCastFromU8(float, svuint8_t v) {
+  return svreinterpret_f32(v);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svfloat64_t BitCastFromU8(double, svuint8_t v) {
+  return svreinterpret_f64(v);
+}
+
+// cast_u8_to
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> cast_u8_to(
+    Desc<T, N, SVE256>, vec_sve256<uint8_t, N * sizeof(T)> v) {
+  return vec_sve256<T, N>(BitCastFromU8(T(), v.raw));
+}
+
+// cast_to
+template <typename T, size_t N, typename FromT>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> cast_to(
+    Desc<T, N, SVE256> d,
+    vec_sve256<FromT, N * sizeof(T) / sizeof(FromT)> v) {
+  const auto u8 = cast_to_u8(Desc<uint8_t, N * sizeof(T), SVE256>(), v);
+  return cast_u8_to(d, u8);
+}
+
+// ------------------------------ Set
+
+// Returns a vector with all lanes set to "t".
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint8_t, N> set1(
+    Desc<uint8_t, N, SVE256>, const uint8_t t) {
+  return vec_sve256<uint8_t, N>(svdup_n_u8(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint16_t, N> set1(
+    Desc<uint16_t, N, SVE256>, const uint16_t t) {
+  return vec_sve256<uint16_t, N>(svdup_n_u16(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t, N> set1(
+    Desc<uint32_t, N, SVE256>, const uint32_t t) {
+  return vec_sve256<uint32_t, N>(svdup_n_u32(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t, N> set1(
+    Desc<uint64_t, N, SVE256>, const uint64_t t) {
+  return vec_sve256<uint64_t, N>(svdup_n_u64(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int8_t, N> set1(
+    Desc<int8_t, N, SVE256>, const int8_t t) {
+  return vec_sve256<int8_t, N>(svdup_n_s8(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t, N> set1(
+    Desc<int16_t, N, SVE256>, const int16_t t) {
+  return vec_sve256<int16_t, N>(svdup_n_s16(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t, N> set1(
+    Desc<int32_t, N, SVE256>, const int32_t t) {
+  return vec_sve256<int32_t, N>(svdup_n_s32(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int64_t, N> set1(
+    Desc<int64_t, N, SVE256>, const int64_t t) {
+  return vec_sve256<int64_t, N>(svdup_n_s64(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> set1(Desc<float, N, SVE256>,
+                                                       const float t) {
+  return vec_sve256<float, N>(svdup_n_f32(t));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> set1(
+    Desc<double, N, SVE256>, const double t) {
+  return vec_sve256<double, N>(svdup_n_f64(t));
+}
+
+// Returns an all-zero vector.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> setzero(Desc<T, N, SVE256> d) {
+  return set1(d, T(0));
+}
+
+template <typename T, size_t N, typename T2>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> iota(Desc<T, N, SVE256> d,
+                                                   const T2 first) {
+  SIMD_ALIGN T lanes[N];
+  for (size_t i = 0; i < N; ++i) {
+    lanes[i] = first + i;
+  }
+  return load(d, lanes);
+}
+
+// Returns a vector with uninitialized elements.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> undefined(Desc<T, N, SVE256> d) {
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(svundef_u8()));
+}
+
+// ================================================== ARITHMETIC
+
+// Unlike x86, SVE provides most operations for all lane types, so these
+// templates are not restricted to the lane types supported by AVX2.
+
+// ------------------------------ Addition
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator+(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return vec_sve256<T, N>(svadd_x(svptrue_b8(), a.raw, b.raw));
+}
+
+// ------------------------------ Subtraction
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator-(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return vec_sve256<T, N>(svsub_x(svptrue_b8(), a.raw, b.raw));
+}
+
+// ------------------------------ Saturating addition
+
+// Returns a + b clamped to the destination range.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> saturated_add(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return vec_sve256<T, N>(svqadd(a.raw, b.raw));
+}
+
+// ------------------------------ Saturating subtraction
+
+// Returns a - b clamped to the destination range.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> saturated_subtract(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return vec_sve256<T, N>(svqsub(a.raw, b.raw));
+}
+
+// ------------------------------ Average
+
+// Returns (a + b + 1) / 2 without overflow (SVE2 would provide URHADD).
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> average_round(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  static_assert(T(-1) > T(0), "Only for unsigned lanes");
+  const svbool_t pg = svptrue_b8();
+  const auto half_diff = svlsr_x(pg, sveor_x(pg, a.raw, b.raw), 1);
+  return vec_sve256<T, N>(svsub_x(pg, svorr_x(pg, a.raw, b.raw), half_diff));
+}
+
+// ------------------------------ Absolute value
+
+// Returns absolute value, except that LimitsMin() maps to LimitsMax() + 1.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> abs(const vec_sve256<T, N> v) {
+  return vec_sve256<T, N>(svabs_x(svptrue_b8(), v.raw));
+}
+
+// ------------------------------ Shift lanes by constant #bits
+
+template <int kBits, typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> shift_left(
+    const vec_sve256<T, N> v) {
+  return vec_sve256<T, N>(svlsl_x(svptrue_b8(), v.raw, kBits));
+}
+
+// Unsigned: logical shift
+template <int kBits, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint16_t, N> shift_right(
+    const vec_sve256<uint16_t, N> v) {
+  return vec_sve256<uint16_t, N>(svlsr_x(svptrue_b8(), v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t, N> shift_right(
+    const vec_sve256<uint32_t, N> v) {
+  return vec_sve256<uint32_t, N>(svlsr_x(svptrue_b8(), v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t, N> shift_right(
+    const vec_sve256<uint64_t, N> v) {
+  return vec_sve256<uint64_t, N>(svlsr_x(svptrue_b8(), v.raw, kBits));
+}
+
+// Signed: arithmetic shift
+template <int kBits, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t, N> shift_right(
+    const vec_sve256<int16_t, N> v) {
+  return vec_sve256<int16_t, N>(svasr_x(svptrue_b8(), v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t, N> shift_right(
+    const vec_sve256<int32_t, N> v) {
+  return vec_sve256<int32_t, N>(svasr_x(svptrue_b8(), v.raw, kBits));
+}
+
+// ------------------------------ Shift lanes by same variable #bits
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE sve256_shift_left_count
+set_shift_left_count(Desc<T, N, SVE256>, const int bits) {
+  return sve256_shift_left_count{bits};
+}
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE sve256_shift_right_count
+set_shift_right_count(Desc<T, N, SVE256>, const int bits) {
+  return sve256_shift_right_count{bits};
+}
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> shift_left_same(
+    const vec_sve256<T, N> v, const sve256_shift_left_count bits) {
+  return vec_sve256<T, N>(svlsl_x(svptrue_b8(), v.raw, bits.bits));
+}
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint16_t, N> shift_right_same(
+    const vec_sve256<uint16_t, N> v, const sve256_shift_right_count bits) {
+  return vec_sve256<uint16_t, N>(svlsr_x(svptrue_b8(), v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t, N> shift_right_same(
+    const vec_sve256<uint32_t, N> v, const sve256_shift_right_count bits) {
+  return vec_sve256<uint32_t, N>(svlsr_x(svptrue_b8(), v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t, N> shift_right_same(
+    const vec_sve256<uint64_t, N> v, const sve256_shift_right_count bits) {
+  return vec_sve256<uint64_t, N>(svlsr_x(svptrue_b8(), v.raw, bits.bits));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t, N> shift_right_same(
+    const vec_sve256<int16_t, N> v, const sve256_shift_right_count bits) {
+  return vec_sve256<int16_t, N>(svasr_x(svptrue_b8(), v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t, N> shift_right_same(
+    const vec_sve256<int32_t, N> v, const sve256_shift_right_count bits) {
+  return vec_sve256<int32_t, N>(svasr_x(svptrue_b8(), v.raw, bits.bits));
+}
+
+// ------------------------------ Shift lanes by independent variable #bits
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t, N> operator<<(
+    const vec_sve256<uint32_t, N> v, const vec_sve256<uint32_t, N> bits) {
+  return vec_sve256<uint32_t, N>(svlsl_x(svptrue_b8(), v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t, N> operator>>(
+    const vec_sve256<uint32_t, N> v, const vec_sve256<uint32_t, N> bits) {
+  return vec_sve256<uint32_t, N>(svlsr_x(svptrue_b8(), v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t, N> operator<<(
+    const vec_sve256<uint64_t, N> v, const vec_sve256<uint64_t, N> bits) {
+  return vec_sve256<uint64_t, N>(svlsl_x(svptrue_b8(), v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t, N> operator>>(
+    const vec_sve256<uint64_t, N> v, const vec_sve256<uint64_t, N> bits) {
+  return vec_sve256<uint64_t, N>(svlsr_x(svptrue_b8(), v.raw, bits.raw));
+}
+
+// Signed (shift counts are unsigned)
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t, N> operator<<(
+    const vec_sve256<int32_t, N> v, const vec_sve256<int32_t, N> bits) {
+  return vec_sve256<int32_t, N>(
+      svlsl_x(svptrue_b8(), v.raw, svreinterpret_u32(bits.raw)));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t, N> operator>>(
+    const vec_sve256<int32_t, N> v, const vec_sve256<int32_t, N> bits) {
+  return vec_sve256<int32_t, N>(
+      svasr_x(svptrue_b8(), v.raw, svreinterpret_u32(bits.raw)));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int64_t, N> operator<<(
+    const vec_sve256<int64_t, N> v, const vec_sve256<int64_t, N> bits) {
+  return vec_sve256<int64_t, N>(
+      svlsl_x(svptrue_b8(), v.raw, svreinterpret_u64(bits.raw)));
+}
+
+// ------------------------------ Minimum
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> min(const vec_sve256<T, N> a,
+                                                  const vec_sve256<T, N> b) {
+  return vec_sve256<T, N>(svmin_x(svptrue_b8(), a.raw, b.raw));
+}
+
+// ------------------------------ Maximum
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> max(const vec_sve256<T, N> a,
+                                                  const vec_sve256<T, N> b) {
+  return vec_sve256<T, N>(svmax_x(svptrue_b8(), a.raw, b.raw));
+}
+
+// Returns the closest value to v within [lo, hi].
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> clamp(const vec_sve256<T, N> v,
+                                                    const vec_sve256<T, N> lo,
+                                                    const vec_sve256<T, N> hi) {
+  return min(max(lo, v), hi);
+}
+
+// ------------------------------ Integer multiplication
+
+// Also used for floating-point (see below).
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator*(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return vec_sve256<T, N>(svmul_x(svptrue_b8(), a.raw, b.raw));
+}
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+// Returns the upper 16 bits of a * b in each lane.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> mul_high(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  static_assert(sizeof(T) == 2, "Only for 16-bit lanes");
+  return vec_sve256<T, N>(svmulh_x(svptrue_b8(), a.raw, b.raw));
+}
+
+}  // namespace ext
+
+// Returns (((a * b) >> 14) + 1) >> 1.
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t, N> mul_high_round(
+    const vec_sve256<int16_t, N> a, const vec_sve256<int16_t, N> b) {
+  const svbool_t pg = svptrue_b8();
+  // (SVE2 would provide SQRDMULH.) Widen to 32-bit products; adding 2^14 and
+  // shifting by 15 is equivalent to the above.
+  const svint32_t lo =
+      svmul_x(pg, svunpklo(a.raw), svunpklo(b.raw));
+  const svint32_t hi =
+      svmul_x(pg, svunpkhi(a.raw), svunpkhi(b.raw));
+  const svint32_t rounded_lo = svasr_x(pg, svadd_x(pg, lo, 0x4000), 15);
+  const svint32_t rounded_hi = svasr_x(pg, svadd_x(pg, hi, 0x4000), 15);
+  // Lower halves of the 32-bit results (even 16-bit lanes), in order.
+  return vec_sve256<int16_t, N>(svuzp1(svreinterpret_s16(rounded_lo),
+                                       svreinterpret_s16(rounded_hi)));
+}
+
+// Multiplies even lanes (0, 2 ..) and places the double-wide result into
+// even and the upper half into its odd neighbor lane.
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int64_t> mul_even(
+    const vec_sve256<int32_t> a, const vec_sve256<int32_t> b) {
+  const svbool_t pg = svptrue_b8();
+  const svint64_t a_even = svextw_x(pg, svreinterpret_s64(a.raw));
+  const svint64_t b_even = svextw_x(pg, svreinterpret_s64(b.raw));
+  return vec_sve256<int64_t>(svmul_x(pg, a_even, b_even));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t> mul_even(
+    const vec_sve256<uint32_t> a, const vec_sve256<uint32_t> b) {
+  const svbool_t pg = svptrue_b8();
+  const svuint64_t a_even = svextw_x(pg, svreinterpret_u64(a.raw));
+  const svuint64_t b_even = svextw_x(pg, svreinterpret_u64(b.raw));
+  return vec_sve256<uint64_t>(svmul_x(pg, a_even, b_even));
+}
+
+// ------------------------------ Floating-point negate
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> neg(
+    const vec_sve256<float, N> v) {
+  return vec_sve256<float, N>(svneg_x(svptrue_b8(), v.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> neg(
+    const vec_sve256<double, N> v) {
+  return vec_sve256<double, N>(svneg_x(svptrue_b8(), v.raw));
+}
+
+// ------------------------------ Floating-point mul / div
+
+// operator* is defined above for all lane types.
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> operator/(
+    const vec_sve256<float, N> a, const vec_sve256<float, N> b) {
+  return vec_sve256<float, N>(svdiv_x(svptrue_b8(), a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> operator/(
+    const vec_sve256<double, N> a, const vec_sve256<double, N> b) {
+  return vec_sve256<double, N>(svdiv_x(svptrue_b8(), a.raw, b.raw));
+}
+
+// Approximate reciprocal. FRECPE only provides 8 bits, so refine once to
+// exceed the precision of x86 RCPPS.
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> approximate_reciprocal(
+    const vec_sve256<float, N> v) {
+  const svbool_t pg = svptrue_b8();
+  const svfloat32_t estimate = svrecpe(v.raw);
+  return vec_sve256<float, N>(
+      svmul_x(pg, estimate, svrecps(v.raw, estimate)));
+}
+
+// ------------------------------ Floating-point multiply-add variants
+
+// Returns mul * x + add
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> mul_add(
+    const vec_sve256<float, N> mul, const vec_sve256<float, N> x,
+    const vec_sve256<float, N> add) {
+  return vec_sve256<float, N>(svmad_x(svptrue_b8(), mul.raw, x.raw, add.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> mul_add(
+    const vec_sve256<double, N> mul, const vec_sve256<double, N> x,
+    const vec_sve256<double, N> add) {
+  return vec_sve256<double, N>(
+      svmad_x(svptrue_b8(), mul.raw, x.raw, add.raw));
+}
+
+// Returns add - mul * x
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> nmul_add(
+    const vec_sve256<float, N> mul, const vec_sve256<float, N> x,
+    const vec_sve256<float, N> add) {
+  return vec_sve256<float, N>(svmsb_x(svptrue_b8(), mul.raw, x.raw, add.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> nmul_add(
+    const vec_sve256<double, N> mul, const vec_sve256<double, N> x,
+    const vec_sve256<double, N> add) {
+  return vec_sve256<double, N>(
+      svmsb_x(svptrue_b8(), mul.raw, x.raw, add.raw));
+}
+
+// No extra negate required, unlike NEON.
+namespace ext {
+
+// Returns mul * x - sub
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> mul_subtract(
+    const vec_sve256<float, N> mul, const vec_sve256<float, N> x,
+    const vec_sve256<float, N> sub) {
+  return vec_sve256<float, N>(
+      svnmsb_x(svptrue_b8(), mul.raw, x.raw, sub.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> mul_subtract(
+    const vec_sve256<double, N> mul, const vec_sve256<double, N> x,
+    const vec_sve256<double, N> sub) {
+  return vec_sve256<double, N>(
+      svnmsb_x(svptrue_b8(), mul.raw, x.raw, sub.raw));
+}
+
+// Returns -mul * x - sub
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> nmul_subtract(
+    const vec_sve256<float, N> mul, const vec_sve256<float, N> x,
+    const vec_sve256<float, N> sub) {
+  return vec_sve256<float, N>(
+      svnmad_x(svptrue_b8(), mul.raw, x.raw, sub.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> nmul_subtract(
+    const vec_sve256<double, N> mul, const vec_sve256<double, N> x,
+    const vec_sve256<double, N> sub) {
+  return vec_sve256<double, N>(
+      svnmad_x(svptrue_b8(), mul.raw, x.raw, sub.raw));
+}
+
+}  // namespace ext
+
+// ------------------------------ Floating-point square root
+
+// Full precision square root
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> sqrt(
+    const vec_sve256<float, N> v) {
+  return vec_sve256<float, N>(svsqrt_x(svptrue_b8(), v.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> sqrt(
+    const vec_sve256<double, N> v) {
+  return vec_sve256<double, N>(svsqrt_x(svptrue_b8(), v.raw));
+}
+
+// Approximate reciprocal square root, refined once (see above).
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> approximate_reciprocal_sqrt(
+    const vec_sve256<float, N> v) {
+  const svbool_t pg = svptrue_b8();
+  const svfloat32_t estimate = svrsqrte(v.raw);
+  const svfloat32_t square = svmul_x(pg, estimate, estimate);
+  return vec_sve256<float, N>(
+      svmul_x(pg, estimate, svrsqrts(v.raw, square)));
+}
+
+// ------------------------------ Floating-point rounding
+
+// Toward nearest integer, tie to even
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> round(const vec_sve256<T, N> v) {
+  return vec_sve256<T, N>(svrintn_x(svptrue_b8(), v.raw));
+}
+
+// Toward zero, aka truncate
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> trunc(const vec_sve256<T, N> v) {
+  return vec_sve256<T, N>(svrintz_x(svptrue_b8(), v.raw));
+}
+
+// Toward +infinity, aka ceiling
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> ceil(const vec_sve256<T, N> v) {
+  return vec_sve256<T, N>(svrintp_x(svptrue_b8(), v.raw));
+}
+
+// Toward -infinity, aka floor
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> floor(const vec_sve256<T, N> v) {
+  return vec_sve256<T, N>(svrintm_x(svptrue_b8(), v.raw));
+}
+
+// ================================================== COMPARE
+
+// Comparisons fill a lane with 1-bits if the condition is true, else 0.
+
+// Returns bytes of a vector whose lanes of the given size are all-ones where
+// the predicate is true.
+SIMD_ATTR_SVE256 SIMD_INLINE svuint8_t MaskFromPredicate(char (&sizeof_t)[1],
+                                                         const svbool_t p) {
+  return svdup_n_u8_z(p, 0xFF);
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svuint8_t MaskFromPredicate(char (&sizeof_t)[2],
+                                                         const svbool_t p) {
+  return svreinterpret_u8(svdup_n_u16_z(p, 0xFFFF));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svuint8_t MaskFromPredicate(char (&sizeof_t)[4],
+                                                         const svbool_t p) {
+  return svreinterpret_u8(svdup_n_u32_z(p, ~0u));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svuint8_t MaskFromPredicate(char (&sizeof_t)[8],
+                                                         const svbool_t p) {
+  return svreinterpret_u8(svdup_n_u64_z(p, ~0ull));
+}
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> MaskFromPredicate(
+    Desc<T, N, SVE256> d, const svbool_t p) {
+  char sizeof_t[sizeof(T)];
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(
+                           MaskFromPredicate(sizeof_t, p)));
+}
+
+// ------------------------------ Equality
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator==(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return MaskFromPredicate(Desc<T, N, SVE256>(),
+                           svcmpeq(svptrue_b8(), a.raw, b.raw));
+}
+
+// ------------------------------ Strict inequality
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator<(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return MaskFromPredicate(Desc<T, N, SVE256>(),
+                           svcmplt(svptrue_b8(), a.raw, b.raw));
+}
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator>(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return MaskFromPredicate(Desc<T, N, SVE256>(),
+                           svcmpgt(svptrue_b8(), a.raw, b.raw));
+}
+
+// ------------------------------ Weak inequality
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator<=(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return MaskFromPredicate(Desc<T, N, SVE256>(),
+                           svcmple(svptrue_b8(), a.raw, b.raw));
+}
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator>=(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  return MaskFromPredicate(Desc<T, N, SVE256>(),
+                           svcmpge(svptrue_b8(), a.raw, b.raw));
+}
+
+// ================================================== LOGICAL
+
+// Bitwise operations are independent of the lane type, so they operate on
+// bytes (SVE only provides integer versions).
+
+// ------------------------------ Bitwise AND
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator&(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  const Desc<T, N, SVE256> d;
+  const Desc<uint8_t, N * sizeof(T), SVE256> d8;
+  const svuint8_t a8 = cast_to_u8(d8, a).raw;
+  const svuint8_t b8 = cast_to_u8(d8, b).raw;
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(
+                           svand_x(svptrue_b8(), a8, b8)));
+}
+
+// ------------------------------ Bitwise AND-NOT
+
+// Returns ~not_mask & mask.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> andnot(
+    const vec_sve256<T, N> not_mask, const vec_sve256<T, N> mask) {
+  const Desc<T, N, SVE256> d;
+  const Desc<uint8_t, N * sizeof(T), SVE256> d8;
+  const svuint8_t not_mask8 = cast_to_u8(d8, not_mask).raw;
+  const svuint8_t mask8 = cast_to_u8(d8, mask).raw;
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(
+                           svbic_x(svptrue_b8(), mask8, not_mask8)));
+}
+
+// ------------------------------ Bitwise OR
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator|(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  const Desc<T, N, SVE256> d;
+  const Desc<uint8_t, N * sizeof(T), SVE256> d8;
+  const svuint8_t a8 = cast_to_u8(d8, a).raw;
+  const svuint8_t b8 = cast_to_u8(d8, b).raw;
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(
+                           svorr_x(svptrue_b8(), a8, b8)));
+}
+
+// ------------------------------ Bitwise XOR
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> operator^(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b) {
+  const Desc<T, N, SVE256> d;
+  const Desc<uint8_t, N * sizeof(T), SVE256> d8;
+  const svuint8_t a8 = cast_to_u8(d8, a).raw;
+  const svuint8_t b8 = cast_to_u8(d8, b).raw;
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(
+                           sveor_x(svptrue_b8(), a8, b8)));
+}
+
+// ------------------------------ Select/blend
+
+// Returns a mask for use by select().
+// select() only checks the sign bit of float/double lanes, as on x86.
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> condition_from_sign(
+    const vec_sve256<float, N> v) {
+  return v;
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> condition_from_sign(
+    const vec_sve256<double, N> v) {
+  return v;
+}
+
+// Returns mask ? b : a. "mask" must either have been returned by
+// selector_from_mask, or callers must ensure its lanes are T(0) or ~T(0).
+// Integer lanes are selected bytewise, as with x86 BLENDVB.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> select(
+    const vec_sve256<T, N> a, const vec_sve256<T, N> b,
+    const vec_sve256<T, N> mask) {
+  const Desc<T, N, SVE256> d;
+  const Desc<uint8_t, N * sizeof(T), SVE256> d8;
+  const svbool_t is_b =
+      svcmplt(svptrue_b8(), svreinterpret_s8(mask.raw), int8_t(0));
+  const svuint8_t a8 = cast_to_u8(d8, a).raw;
+  const svuint8_t b8 = cast_to_u8(d8, b).raw;
+  return cast_u8_to(d,
+                    vec_sve256<uint8_t, N * sizeof(T)>(svsel(is_b, b8, a8)));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> select(
+    const vec_sve256<float, N> a, const vec_sve256<float, N> b,
+    const vec_sve256<float, N> mask) {
+  const svbool_t is_b =
+      svcmplt(svptrue_b8(), svreinterpret_s32(mask.raw), int32_t(0));
+  return vec_sve256<float, N>(svsel(is_b, b.raw, a.raw));
+}
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<double, N> select(
+    const vec_sve256<double, N> a, const vec_sve256<double, N> b,
+    const vec_sve256<double, N> mask) {
+  const svbool_t is_b =
+      svcmplt(svptrue_b8(), svreinterpret_s64(mask.raw), int64_t(0));
+  return vec_sve256<double, N>(svsel(is_b, b.raw, a.raw));
+}
+
+// ================================================== MEMORY
+
+// ------------------------------ Load
+
+// SVE loads have no alignment requirement.
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> load_unaligned(
+    Full<T, SVE256>, const T* SIMD_RESTRICT p) {
+  return vec_sve256<T>(svld1(svptrue_b8(), p));
+}
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> load(Full<T, SVE256> d,
+                                                const T* SIMD_RESTRICT aligned) {
+  return load_unaligned(d, aligned);
+}
+
+// Loads 128 bit and duplicates into both 128-bit halves.
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> load_dup128(
+    Full<T, SVE256>, const T* const SIMD_RESTRICT p) {
+  return vec_sve256<T>(svld1rq(svptrue_b8(), p));
+}
+
+// ------------------------------ Store
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE void store_unaligned(const vec_sve256<T> v,
+                                                  Full<T, SVE256>,
+                                                  T* SIMD_RESTRICT p) {
+  svst1(svptrue_b8(), p, v.raw);
+}
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE void store(const vec_sve256<T> v,
+                                        Full<T, SVE256> d,
+                                        T* SIMD_RESTRICT aligned) {
+  store_unaligned(v, d, aligned);
+}
+
+// ------------------------------ Non-temporal stores
+
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE void stream(const vec_sve256<T, N> v,
+                                         Full<T, SVE256>,
+                                         T* SIMD_RESTRICT aligned) {
+  svstnt1(svptrue_b8(), aligned, v.raw);
+}
+
+// ------------------------------ Gather
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+template <typename T, typename Offset>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> gather_offset(
+    Full<T, SVE256>, const T* SIMD_RESTRICT base,
+    const vec_sve256<Offset> offset) {
+  static_assert(sizeof(T) == sizeof(Offset), "SVE requires same size base/ofs");
+  return vec_sve256<T>(svld1_gather_offset(svptrue_b8(), base, offset.raw));
+}
+template <typename T, typename Index>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> gather_index(
+    Full<T, SVE256>, const T* SIMD_RESTRICT base,
+    const vec_sve256<Index> index) {
+  static_assert(sizeof(T) == sizeof(Index), "SVE requires same size base/idx");
+  return vec_sve256<T>(svld1_gather_index(svptrue_b8(), base, index.raw));
+}
+
+}  // namespace ext
+
+// ================================================== SWIZZLE
+
+// SVE permutations operate on the entire vector, so the AVX2-compatible
+// per-block operations below are table lookups with computed indices. Indices
+// outside the vector (e.g. 0xFF) return zero. Compilers hoist the index
+// computations out of loops.
+
+// Returns vector of bytes[idx[i]].
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> TableLookupBytesSVE256(
+    const vec_sve256<T, N> bytes, const svuint8_t idx) {
+  const Desc<T, N, SVE256> d;
+  const Desc<uint8_t, N * sizeof(T), SVE256> d8;
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(
+                           svtbl(cast_to_u8(d8, bytes).raw, idx)));
+}
+
+// Returns byte indices i + kOffset, or 0xFF if that would leave the 128-bit
+// block containing byte i.
+template <int kOffset>
+SIMD_ATTR_SVE256 SIMD_INLINE svuint8_t BlockOffsetIndices() {
+  const svbool_t pg = svptrue_b8();
+  const svuint8_t i = svindex_u8(0, 1);
+  // Wraps around for negative kOffset, hence a single comparison suffices.
+  const svuint8_t pos_in_block =
+      svadd_x(pg, svand_x(pg, i, uint8_t(15)), uint8_t(kOffset));
+  return svsel(svcmplt(pg, pos_in_block, uint8_t(16)),
+               svadd_x(pg, i, uint8_t(kOffset)), svdup_n_u8(0xFF));
+}
+
+// Predicate for the lanes of the lower 128-bit block.
+SIMD_ATTR_SVE256 SIMD_INLINE svbool_t LowerBlockSVE256() {
+  return svptrue_pat_b8(SV_VL16);
+}
+
+// ------------------------------ Extract half
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_arm8<T> get_half(Lower, vec_sve256<T> v) {
+  SIMD_ALIGN T lanes[SVE256::NumLanes<T>()];
+  store(v, Full<T, SVE256>(), lanes);
+  return load(Full<T, ARM8>(), lanes);
+}
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_arm8<T> lower_half(const vec_sve256<T> v) {
+  return get_half(Lower(), v);
+}
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_arm8<T> get_half(Upper, vec_sve256<T> v) {
+  SIMD_ALIGN T lanes[SVE256::NumLanes<T>()];
+  store(v, Full<T, SVE256>(), lanes);
+  return load(Full<T, ARM8>(), lanes + ARM8::NumLanes<T>());
+}
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_arm8<T> upper_half(const vec_sve256<T> v) {
+  return get_half(Upper(), v);
+}
+
+// ------------------------------ Shift vector by constant #bytes
+
+// 0x01..0F, kBytes = 1 => 0x02..0F00
+template <int kBytes, typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> shift_left_bytes(
+    const vec_sve256<T, N> v) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  return TableLookupBytesSVE256(v, BlockOffsetIndices<-kBytes>());
+}
+
+template <int kLanes, typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> shift_left_lanes(
+    const vec_sve256<T, N> v) {
+  return shift_left_bytes<kLanes * sizeof(T)>(v);
+}
+
+// 0x01..0F, kBytes = 1 => 0x0001..0E
+template <int kBytes, typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> shift_right_bytes(
+    const vec_sve256<T, N> v) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  return TableLookupBytesSVE256(v, BlockOffsetIndices<kBytes>());
+}
+
+template <int kLanes, typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> shift_right_lanes(
+    const vec_sve256<T, N> v) {
+  return shift_right_bytes<kLanes * sizeof(T)>(v);
+}
+
+// ------------------------------ Extract from 2x 128-bit at constant offset
+
+// Extracts 128 bits from <hi, lo> by skipping the least-significant kBytes.
+template <int kBytes, typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> combine_shift_right_bytes(
+    const vec_sve256<T, N> hi, const vec_sve256<T, N> lo) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  const Desc<T, N, SVE256> d;
+  const Desc<uint8_t, N * sizeof(T), SVE256> d8;
+  const svuint8_t from_lo =
+      svtbl(cast_to_u8(d8, lo).raw, BlockOffsetIndices<kBytes>());
+  const svuint8_t from_hi =
+      svtbl(cast_to_u8(d8, hi).raw, BlockOffsetIndices<kBytes - 16>());
+  return cast_u8_to(d, vec_sve256<uint8_t, N * sizeof(T)>(
+                           svorr_x(svptrue_b8(), from_lo, from_hi)));
+}
+
+// ------------------------------ Broadcast/splat any lane
+
+// Broadcasts lane kLane of each 128-bit block to all lanes of that block.
+template <int kLane, typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> broadcast(const vec_sve256<T> v) {
+  static_assert(0 <= kLane && kLane < ARM8::NumLanes<T>(), "Invalid lane");
+  const svbool_t pg = svptrue_b8();
+  // Block base and byte within lane, plus the offset of the desired lane.
+  const svuint8_t idx = svadd_x(
+      pg, svand_x(pg, svindex_u8(0, 1), uint8_t(0xF0 | (sizeof(T) - 1))),
+      uint8_t(kLane * sizeof(T)));
+  return TableLookupBytesSVE256(v, idx);
+}
+
+// ------------------------------ Hard-coded shuffles
+
+// Notation: let vec_sve256<int32_t> have lanes 7,6,5,4,3,2,1,0 (0 is
+// least-significant). shuffle_0321 rotates four-lane blocks one lane to the
+// right (the previous least-significant lane is now most-significant =>
+// 47650321). These could also be implemented via combine_shift_right_bytes but
+// the shuffle_abcd notation is more convenient.
+
+// Returns lanes kLane3..0 of each block of 32-bit lanes.
+template <int kLane3, int kLane2, int kLane1, int kLane0, typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> Shuffle32SVE256(
+    const vec_sve256<T> v) {
+  static_assert(sizeof(T) == 4, "Only for 32-bit lanes");
+  const svbool_t pg = svptrue_b8();
+  const svuint32_t block = svand_x(pg, svindex_u32(0, 1), ~3u);
+  const svuint32_t idx =
+      svadd_x(pg, block, svdupq_n_u32(kLane0, kLane1, kLane2, kLane3));
+  return vec_sve256<T>(svtbl(v.raw, idx));
+}
+
+// Swap 64-bit halves
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> shuffle_1032(const vec_sve256<T> v) {
+  return Shuffle32SVE256<1, 0, 3, 2>(v);
+}
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> shuffle_01(const vec_sve256<T> v) {
+  static_assert(sizeof(T) == 8, "Only for 64-bit lanes");
+  const svbool_t pg = svptrue_b8();
+  const svuint64_t block = svand_x(pg, svindex_u64(0, 1), ~1ull);
+  const svuint64_t idx = svadd_x(pg, block, svdupq_n_u64(1, 0));
+  return vec_sve256<T>(svtbl(v.raw, idx));
+}
+
+// Rotate right 32 bits
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> shuffle_0321(const vec_sve256<T> v) {
+  return Shuffle32SVE256<0, 3, 2, 1>(v);
+}
+// Rotate left 32 bits
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> shuffle_2103(const vec_sve256<T> v) {
+  return Shuffle32SVE256<2, 1, 0, 3>(v);
+}
+
+// Reverse
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> shuffle_0123(const vec_sve256<T> v) {
+  return Shuffle32SVE256<0, 1, 2, 3>(v);
+}
+
+// ------------------------------ Permute (runtime variable)
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE permute_sve256<T> set_table_indices(
+    const Full<T, SVE256>, const int32_t* idx) {
+  static_assert(sizeof(T) == 4, "Only for 32-bit lanes");
+  return permute_sve256<T>{svreinterpret_u32(svld1(svptrue_b8(), idx))};
+}
+
+// Unlike other swizzles, this crosses blocks (same as AVX2).
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> table_lookup_lanes(
+    const vec_sve256<T> v, const permute_sve256<T> idx) {
+  return vec_sve256<T>(svtbl(v.raw, idx.raw));
+}
+
+// ------------------------------ Interleave lanes
+
+// Interleaves lanes from halves of the 128-bit blocks of "a" (which provides
+// the least-significant lane) and "b". To concatenate two half-width integers
+// into one, use zip_lo/hi instead (also works with scalar).
+
+// Byte indices that move the lower (kHalf = 0) or upper halves of both blocks
+// into the lower half of the vector, where ZIP1 interleaves them.
+template <int kHalf>
+SIMD_ATTR_SVE256 SIMD_INLINE svuint8_t InterleaveIndicesSVE256() {
+  const svbool_t pg = svptrue_b8();
+  const svuint8_t i = svindex_u8(0, 1);
+  const svuint8_t lower = svadd_x(pg, i, svand_x(pg, i, uint8_t(8)));
+  return svadd_x(pg, lower, uint8_t(kHalf * 8));
+}
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> interleave_lo(
+    const vec_sve256<T> a, const vec_sve256<T> b) {
+  const svuint8_t idx = InterleaveIndicesSVE256<0>();
+  return vec_sve256<T>(svzip1(TableLookupBytesSVE256(a, idx).raw,
+                              TableLookupBytesSVE256(b, idx).raw));
+}
+
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> interleave_hi(
+    const vec_sve256<T> a, const vec_sve256<T> b) {
+  const svuint8_t idx = InterleaveIndicesSVE256<1>();
+  return vec_sve256<T>(svzip1(TableLookupBytesSVE256(a, idx).raw,
+                              TableLookupBytesSVE256(b, idx).raw));
+}
+
+// ------------------------------ Zip lanes
+
+// Same as interleave_*, except that the return lanes are double-width integers;
+// this is necessary because the single-lane scalar cannot return two values.
+
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint16_t> zip_lo(
+    const vec_sve256<uint8_t> a, const vec_sve256<uint8_t> b) {
+  return cast_to(Full<uint16_t, SVE256>(), interleave_lo(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t> zip_lo(
+    const vec_sve256<uint16_t> a, const vec_sve256<uint16_t> b) {
+  return cast_to(Full<uint32_t, SVE256>(), interleave_lo(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t> zip_lo(
+    const vec_sve256<uint32_t> a, const vec_sve256<uint32_t> b) {
+  return cast_to(Full<uint64_t, SVE256>(), interleave_lo(a, b));
+}
+
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t> zip_lo(
+    const vec_sve256<int8_t> a, const vec_sve256<int8_t> b) {
+  return cast_to(Full<int16_t, SVE256>(), interleave_lo(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t> zip_lo(
+    const vec_sve256<int16_t> a, const vec_sve256<int16_t> b) {
+  return cast_to(Full<int32_t, SVE256>(), interleave_lo(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int64_t> zip_lo(
+    const vec_sve256<int32_t> a, const vec_sve256<int32_t> b) {
+  return cast_to(Full<int64_t, SVE256>(), interleave_lo(a, b));
+}
+
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint16_t> zip_hi(
+    const vec_sve256<uint8_t> a, const vec_sve256<uint8_t> b) {
+  return cast_to(Full<uint16_t, SVE256>(), interleave_hi(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t> zip_hi(
+    const vec_sve256<uint16_t> a, const vec_sve256<uint16_t> b) {
+  return cast_to(Full<uint32_t, SVE256>(), interleave_hi(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t> zip_hi(
+    const vec_sve256<uint32_t> a, const vec_sve256<uint32_t> b) {
+  return cast_to(Full<uint64_t, SVE256>(), interleave_hi(a, b));
+}
+
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t> zip_hi(
+    const vec_sve256<int8_t> a, const vec_sve256<int8_t> b) {
+  return cast_to(Full<int16_t, SVE256>(), interleave_hi(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t> zip_hi(
+    const vec_sve256<int16_t> a, const vec_sve256<int16_t> b) {
+  return cast_to(Full<int32_t, SVE256>(), interleave_hi(a, b));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int64_t> zip_hi(
+    const vec_sve256<int32_t> a, const vec_sve256<int32_t> b) {
+  return cast_to(Full<int64_t, SVE256>(), interleave_hi(a, b));
+}
+
+// ------------------------------ Parts
+
+// Returns part of a vector (unspecified whether upper or lower).
+template <typename T, size_t N, size_t VN>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> any_part(
+    Desc<T, N, SVE256>, const vec_sve256<T, VN> v) {
+  return vec_sve256<T, N>(v.raw);
+}
+template <typename T, size_t N, size_t VN>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_arm8<T, N> any_part(
+    Desc<T, N, ARM8> d, const vec_sve256<T, VN> v) {
+  SIMD_ALIGN T lanes[VN];
+  store(v, Full<T, SVE256>(), lanes);
+  return load(d, lanes);
+}
+
+// Gets the single value stored in a vector/part.
+template <typename T, size_t N, class Target, size_t VN>
+SIMD_ATTR_SVE256 SIMD_INLINE T get_part(Desc<T, N, Target>,
+                                        const vec_sve256<T, VN> v) {
+  // LASTA returns the first lane if no lanes are active.
+  return svlasta(svpfalse_b(), v.raw);
+}
+
+// Returns full vector with the given part's lane broadcasted. Note that
+// callers cannot use broadcast directly because part lane order is undefined.
+template <int kLane, typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> broadcast_part(
+    Full<T, SVE256> d, const vec_arm8<T, N> v) {
+  static_assert(0 <= kLane && kLane < N, "Invalid lane");
+  SIMD_ALIGN T lanes[N];
+  store(v, Desc<T, N, ARM8>(), lanes);
+  return set1(d, lanes[kLane]);
+}
+
+// ------------------------------ Blocks
+
+// hiH,hiL loH,loL |-> hiL,loL (= lower halves)
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> concat_lo_lo(
+    const vec_sve256<T> hi, const vec_sve256<T> lo) {
+  return vec_sve256<T>(svsplice(LowerBlockSVE256(), lo.raw, hi.raw));
+}
+
+// hiH,hiL loH,loL |-> hiH,loH (= upper halves)
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> concat_hi_hi(
+    const vec_sve256<T> hi, const vec_sve256<T> lo) {
+  const auto loH_loH = svext(lo.raw, lo.raw, ARM8::NumLanes<T>());
+  return vec_sve256<T>(svsel(LowerBlockSVE256(), loH_loH, hi.raw));
+}
+
+// hiH,hiL loH,loL |-> hiL,loH (= inner halves / swap blocks)
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> concat_lo_hi(
+    const vec_sve256<T> hi, const vec_sve256<T> lo) {
+  return vec_sve256<T>(svext(lo.raw, hi.raw, ARM8::NumLanes<T>()));
+}
+
+// hiH,hiL loH,loL |-> hiH,loL (= outer halves)
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> concat_hi_lo(
+    const vec_sve256<T> hi, const vec_sve256<T> lo) {
+  return vec_sve256<T>(svsel(LowerBlockSVE256(), lo.raw, hi.raw));
+}
+
+// ------------------------------ Odd/even lanes
+
+// Predicates for the even lanes of the given size.
+SIMD_ATTR_SVE256 SIMD_INLINE svbool_t EvenLanesSVE256(char (&sizeof_t)[1]) {
+  return svtrn1_b8(svptrue_b8(), svpfalse_b());
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svbool_t EvenLanesSVE256(char (&sizeof_t)[2]) {
+  return svtrn1_b16(svptrue_b16(), svpfalse_b());
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svbool_t EvenLanesSVE256(char (&sizeof_t)[4]) {
+  return svtrn1_b32(svptrue_b32(), svpfalse_b());
+}
+SIMD_ATTR_SVE256 SIMD_INLINE svbool_t EvenLanesSVE256(char (&sizeof_t)[8]) {
+  return svtrn1_b64(svptrue_b64(), svpfalse_b());
+}
+
+// Returns even lanes of "b" and odd lanes of "a".
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T> odd_even(const vec_sve256<T> a,
+                                                    const vec_sve256<T> b) {
+  char sizeof_t[sizeof(T)];
+  return vec_sve256<T>(svsel(EvenLanesSVE256(sizeof_t), b.raw, a.raw));
+}
+
+// ================================================== CONVERT
+
+// ------------------------------ Shuffle bytes with variable indices
+
+// Returns vector of bytes[from[i]]. "from" is also interpreted as bytes:
+// either valid indices in [0, 16) or >= 0x80 to zero the i-th output byte.
+// As with x86 PSHUFB, indices are relative to the 128-bit block.
+template <typename T, typename TI, size_t N, size_t NI>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> table_lookup_bytes(
+    const vec_sve256<T, N> bytes, const vec_sve256<TI, NI> from) {
+  const svbool_t pg = svptrue_b8();
+  const svuint8_t from8 = svreinterpret_u8(from.raw);
+  // Keeping the upper bit ensures the index is out of bounds (=> zero).
+  const svuint8_t block = svand_x(pg, svindex_u8(0, 1), uint8_t(0x10));
+  const svuint8_t idx =
+      svorr_x(pg, svand_x(pg, from8, uint8_t(0x8F)), block);
+  return TableLookupBytesSVE256(bytes, idx);
+}
+
+// ------------------------------ Promotions (part w/ narrow lanes -> full)
+
+// NEON parts are passed via memory; SVE's extending loads then widen them.
+
+// Unsigned: zero-extend.
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint16_t> convert_to(
+    Full<uint16_t, SVE256>, const u8x16 v) {
+  SIMD_ALIGN uint8_t lanes[16];
+  store(v, Full<uint8_t, ARM8>(), lanes);
+  return vec_sve256<uint16_t>(svld1ub_u16(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t> convert_to(
+    Full<uint32_t, SVE256>, const u8x8 v) {
+  SIMD_ALIGN uint8_t lanes[8];
+  store(v, Desc<uint8_t, 8, ARM8>(), lanes);
+  return vec_sve256<uint32_t>(svld1ub_u32(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t> convert_to(
+    Full<int16_t, SVE256>, const u8x16 v) {
+  SIMD_ALIGN uint8_t lanes[16];
+  store(v, Full<uint8_t, ARM8>(), lanes);
+  return vec_sve256<int16_t>(svld1ub_s16(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t> convert_to(
+    Full<int32_t, SVE256>, const u8x8 v) {
+  SIMD_ALIGN uint8_t lanes[8];
+  store(v, Desc<uint8_t, 8, ARM8>(), lanes);
+  return vec_sve256<int32_t>(svld1ub_s32(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t> convert_to(
+    Full<uint32_t, SVE256>, const u16x8 v) {
+  SIMD_ALIGN uint16_t lanes[8];
+  store(v, Full<uint16_t, ARM8>(), lanes);
+  return vec_sve256<uint32_t>(svld1uh_u32(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t> convert_to(
+    Full<int32_t, SVE256>, const u16x8 v) {
+  SIMD_ALIGN uint16_t lanes[8];
+  store(v, Full<uint16_t, ARM8>(), lanes);
+  return vec_sve256<int32_t>(svld1uh_s32(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t> convert_to(
+    Full<uint64_t, SVE256>, const u32x4 v) {
+  SIMD_ALIGN uint32_t lanes[4];
+  store(v, Full<uint32_t, ARM8>(), lanes);
+  return vec_sve256<uint64_t>(svld1uw_u64(svptrue_b8(), lanes));
+}
+
+// Special case for "v" with all blocks equal (e.g. from broadcast_block or
+// load_dup128).
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint32_t> u32_from_u8(
+    const vec_sve256<uint8_t> v) {
+  const Full<uint32_t, SVE256> d32;
+  SIMD_ALIGN static constexpr uint32_t k32From8[8] = {
+      0xFFFFFF00UL, 0xFFFFFF01UL, 0xFFFFFF02UL, 0xFFFFFF03UL,
+      0xFFFFFF04UL, 0xFFFFFF05UL, 0xFFFFFF06UL, 0xFFFFFF07UL};
+  return table_lookup_bytes(cast_to(d32, v), load(d32, k32From8));
+}
+
+// Signed: replicate sign bit.
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t> convert_to(
+    Full<int16_t, SVE256>, const i8x16 v) {
+  SIMD_ALIGN int8_t lanes[16];
+  store(v, Full<int8_t, ARM8>(), lanes);
+  return vec_sve256<int16_t>(svld1sb_s16(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t> convert_to(
+    Full<int32_t, SVE256>, const i8x8 v) {
+  SIMD_ALIGN int8_t lanes[8];
+  store(v, Desc<int8_t, 8, ARM8>(), lanes);
+  return vec_sve256<int32_t>(svld1sb_s32(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t> convert_to(
+    Full<int32_t, SVE256>, const i16x8 v) {
+  SIMD_ALIGN int16_t lanes[8];
+  store(v, Full<int16_t, ARM8>(), lanes);
+  return vec_sve256<int32_t>(svld1sh_s32(svptrue_b8(), lanes));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int64_t> convert_to(
+    Full<int64_t, SVE256>, const i32x4 v) {
+  SIMD_ALIGN int32_t lanes[4];
+  store(v, Full<int32_t, ARM8>(), lanes);
+  return vec_sve256<int64_t>(svld1sw_s64(svptrue_b8(), lanes));
+}
+
+// ------------------------------ Demotions (full -> part w/ narrow lanes)
+
+// Saturates, then truncating stores narrow the lanes into NEON parts.
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE VT<uint16_t, N, SVE256> convert_to(
+    Part<uint16_t, N, SVE256> d, const vec_sve256<int32_t> v) {
+  const svbool_t pg = svptrue_b8();
+  const svint32_t clamped = svmin_x(pg, svmax_x(pg, v.raw, 0), 0xFFFF);
+  SIMD_ALIGN uint16_t lanes[SVE256::NumLanes<int32_t>()];
+  svst1h(pg, reinterpret_cast<int16_t*>(lanes), clamped);
+  return load(d, lanes);
+}
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE VT<uint8_t, N, SVE256> convert_to(
+    Part<uint8_t, N, SVE256> d, const vec_sve256<int32_t> v) {
+  const svbool_t pg = svptrue_b8();
+  const svint32_t clamped = svmin_x(pg, svmax_x(pg, v.raw, 0), 0xFF);
+  SIMD_ALIGN uint8_t lanes[SVE256::NumLanes<int32_t>()];
+  svst1b(pg, reinterpret_cast<int8_t*>(lanes), clamped);
+  return load(d, lanes);
+}
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE VT<int16_t, N, SVE256> convert_to(
+    Part<int16_t, N, SVE256> d, const vec_sve256<int32_t> v) {
+  const svbool_t pg = svptrue_b8();
+  const svint32_t clamped = svmin_x(pg, svmax_x(pg, v.raw, -0x8000), 0x7FFF);
+  SIMD_ALIGN int16_t lanes[SVE256::NumLanes<int32_t>()];
+  svst1h(pg, lanes, clamped);
+  return load(d, lanes);
+}
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE VT<int8_t, N, SVE256> convert_to(
+    Part<int8_t, N, SVE256> d, const vec_sve256<int32_t> v) {
+  const svbool_t pg = svptrue_b8();
+  const svint32_t clamped = svmin_x(pg, svmax_x(pg, v.raw, -0x80), 0x7F);
+  SIMD_ALIGN int8_t lanes[SVE256::NumLanes<int32_t>()];
+  svst1b(pg, lanes, clamped);
+  return load(d, lanes);
+}
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE VT<uint8_t, N, SVE256> convert_to(
+    Part<uint8_t, N, SVE256> d, const vec_sve256<int16_t> v) {
+  const svbool_t pg = svptrue_b8();
+  const svint16_t clamped = svmin_x(pg, svmax_x(pg, v.raw, 0), 0xFF);
+  SIMD_ALIGN uint8_t lanes[SVE256::NumLanes<int16_t>()];
+  svst1b(pg, reinterpret_cast<int8_t*>(lanes), clamped);
+  return load(d, lanes);
+}
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE VT<int8_t, N, SVE256> convert_to(
+    Part<int8_t, N, SVE256> d, const vec_sve256<int16_t> v) {
+  const svbool_t pg = svptrue_b8();
+  const svint16_t clamped = svmin_x(pg, svmax_x(pg, v.raw, -0x80), 0x7F);
+  SIMD_ALIGN int8_t lanes[SVE256::NumLanes<int16_t>()];
+  svst1b(pg, lanes, clamped);
+  return load(d, lanes);
+}
+
+// For already range-limited input [0, 255].
+SIMD_ATTR_SVE256 SIMD_INLINE vec_arm8<uint8_t, 8> u8_from_u32(
+    const vec_sve256<uint32_t> v) {
+  SIMD_ALIGN uint8_t lanes[8];
+  svst1b(svptrue_b8(), lanes, v.raw);
+  return load(Desc<uint8_t, 8, ARM8>(), lanes);
+}
+
+// ------------------------------ Convert i32 <=> f32
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<float, N> convert_to(
+    Part<float, N, SVE256>, const vec_sve256<int32_t, N> v) {
+  return vec_sve256<float, N>(svcvt_f32_x(svptrue_b8(), v.raw));
+}
+// Truncates (rounds toward zero).
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t, N> convert_to(
+    Part<int32_t, N, SVE256>, const vec_sve256<float, N> v) {
+  return vec_sve256<int32_t, N>(svcvt_s32_x(svptrue_b8(), v.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int32_t, N> nearest_int(
+    const vec_sve256<float, N> v) {
+  const svbool_t pg = svptrue_b8();
+  return vec_sve256<int32_t, N>(svcvt_s32_x(pg, svrintn_x(pg, v.raw)));
+}
+
+// ================================================== MISC
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+// ------------------------------ movemask
+
+// Returns a bit array of the most significant bit of each byte in "v", i.e.
+// sum_i=0..31 of (v[i] >> 7) << i; v[0] is the least-significant byte of "v".
+// This is useful for testing/branching based on comparison results.
+SIMD_ATTR_SVE256 SIMD_INLINE uint32_t movemask(const vec_sve256<uint8_t> v) {
+  const svbool_t pg = svptrue_b8();
+  // Move each byte's MSB to bit (i % 8). Multiplying then sums the (disjoint)
+  // bits of each u64 into its upper byte.
+  const svuint8_t bits = svlsl_x(pg, svlsr_x(pg, v.raw, 7),
+                                 svand_x(pg, svindex_u8(0, 1), uint8_t(7)));
+  const svuint64_t groups = svlsr_x(
+      pg, svmul_x(pg, svreinterpret_u64(bits), 0x0101010101010101ull), 56);
+  return static_cast<uint32_t>(
+      svorv(pg, svlsl_x(pg, groups, svindex_u64(0, 8))));
+}
+
+// Returns the most significant bit of each float/double lane (see above).
+SIMD_ATTR_SVE256 SIMD_INLINE uint32_t movemask(const vec_sve256<float> v) {
+  const svbool_t pg = svptrue_b8();
+  const svuint32_t sign = svlsr_x(pg, svreinterpret_u32(v.raw), 31);
+  return svorv(pg, svlsl_x(pg, sign, svindex_u32(0, 1)));
+}
+SIMD_ATTR_SVE256 SIMD_INLINE uint32_t movemask(const vec_sve256<double> v) {
+  const svbool_t pg = svptrue_b8();
+  const svuint64_t sign = svlsr_x(pg, svreinterpret_u64(v.raw), 63);
+  return static_cast<uint32_t>(
+      svorv(pg, svlsl_x(pg, sign, svindex_u64(0, 1))));
+}
+
+// ------------------------------ all_zero
+
+// Returns whether all lanes are equal to zero. Supported for all integer V.
+template <typename T>
+SIMD_ATTR_SVE256 SIMD_INLINE bool all_zero(const vec_sve256<T> v) {
+  const svbool_t pg = svptrue_b8();
+  return !svptest_any(pg, svcmpne(pg, svreinterpret_u8(v.raw), uint8_t(0)));
+}
+
+// ------------------------------ Horizontal sum (reduction)
+
+// Returns 64-bit sums of 8-byte groups.
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<uint64_t> sums_of_u8x8(
+    const vec_sve256<uint8_t> v) {
+  const svbool_t pg = svptrue_b8();
+  const svuint32_t sums_of_4 = svdot(svdup_n_u32(0), v.raw, svdup_n_u8(1));
+  const svuint64_t pairs = svreinterpret_u64(sums_of_4);
+  return vec_sve256<uint64_t>(svadd_x(pg, svand_x(pg, pairs, 0xFFFFFFFFull),
+                                      svlsr_x(pg, pairs, 32)));
+}
+
+// Returns N sums of differences of byte quadruplets, starting from byte offset
+// i = [0, N) in window (11 consecutive bytes) and idx_ref * 4 in ref.
+// This version computes two independent SAD with separate idx_ref.
+// SVE lacks MPSADBW, so this accumulates absolute differences of bytes
+// zero-extended into u16 lanes via table lookups (0xFF => zero upper byte).
+template <int idx_ref1, int idx_ref0>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<int16_t> mpsadbw2(
+    const vec_sve256<uint8_t> window, const vec_sve256<uint8_t> ref) {
+  const svbool_t pg = svptrue_b8();
+  SIMD_ALIGN static constexpr uint16_t kWindowIdx[16] = {
+      0xFF00, 0xFF01, 0xFF02, 0xFF03, 0xFF04, 0xFF05, 0xFF06, 0xFF07,
+      0xFF10, 0xFF11, 0xFF12, 0xFF13, 0xFF14, 0xFF15, 0xFF16, 0xFF17};
+  const svuint16_t window_idx = svld1(pg, kWindowIdx);
+  const svuint16_t ref_idx =
+      svsel(LowerBlockSVE256(), svdup_n_u16(0xFF00 + 4 * idx_ref0),
+            svdup_n_u16(0xFF10 + 4 * idx_ref1));
+  svuint16_t sad = svdup_n_u16(0);
+  for (int k = 0; k < 4; ++k) {
+    const svuint8_t window_k =
+        svreinterpret_u8(svadd_x(pg, window_idx, uint16_t(k)));
+    const svuint8_t ref_k = svreinterpret_u8(svadd_x(pg, ref_idx, uint16_t(k)));
+    const svuint16_t w = svreinterpret_u16(svtbl(window.raw, window_k));
+    const svuint16_t r = svreinterpret_u16(svtbl(ref.raw, ref_k));
+    sad = svadd_x(pg, sad, svabd_x(pg, w, r));
+  }
+  return vec_sve256<int16_t>(svreinterpret_s16(sad));
+}
+
+// Supported for {uif}32x8, {uif}64x4. Returns the sum in each lane.
+template <typename T, size_t N>
+SIMD_ATTR_SVE256 SIMD_INLINE vec_sve256<T, N> sum_of_lanes(
+    const vec_sve256<T, N> v) {
+  return set1(Desc<T, N, SVE256>(),
+              static_cast<T>(svaddv(svptrue_b8(), v.raw)));
+}
+
+}  // namespace ext
+
+#endif  // SIMD_DEPS
@@ -15,6 +15,8 @@
 #include "simd/dispatch.h"
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <atomic>
 
 #if SIMD_ARCH == SIMD_ARCH_X86
@@ -26,6 +28,11 @@
 #endif
 #endif
 
+#if SIMD_ARCH == SIMD_ARCH_ARM && defined(__linux__)
+#include <sys/auxv.h>
+#include <sys/prctl.h>
+#endif
+
 namespace pik {
 namespace dispatch {
 
@@ -74,8 +81,32 @@ uint32_t ReadXCR0() {
 
 #endif  // SIMD_ARCH_X86
 
+#if SIMD_ARCH == SIMD_ARCH_ARM && defined(__linux__)
+
+// Older kernel/libc headers lack these.
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1 << 22)
+#endif
+#ifndef PR_SVE_GET_VL
+#define PR_SVE_GET_VL 51
+#endif
+#ifndef PR_SVE_VL_LEN_MASK
+#define PR_SVE_VL_LEN_MASK 0xffff
+#endif
+
+// Returns whether the CPU (and OS) support SVE with exactly 256-bit vectors,
+// as required by code compiled with -msve-vector-bits=256.
+bool HasSVE256() {
+  if ((getauxval(AT_HWCAP) & HWCAP_SVE) == 0) return false;
+  const int vl = prctl(PR_SVE_GET_VL);
+  return vl >= 0 && (vl & PR_SVE_VL_LEN_MASK) == 32;
+}
+
+#endif  // SIMD_ARCH_ARM
+
 // Not function-local => no compiler-generated locking.
 std::atomic<int> supported_{-1};  // Not yet initialized
+std::atomic<int> enabled_{-1};
 
 // Bits indicating which instruction set extensions are supported.
 enum {
@@ -91,8 +122,13 @@ enum {
   kLZCNT = 1 << 9,
   kBMI = 1 << 10,
   kBMI2 = 1 << 11,
+  kAVX512F = 1 << 12,
+  kAVX512VL = 1 << 13,
+  kAVX512DQ = 1 << 14,
+  kAVX512BW = 1 << 15,
 
   kGroupAVX2 = kAVX | kAVX2 | kFMA | kLZCNT | kBMI | kBMI2,
+  kGroupAVX512 = kGroupAVX2 | kAVX512F | kAVX512VL | kAVX512DQ | kAVX512BW,
   kGroupSSE4 = kSSE | kSSE2 | kSSE3 | kSSSE3 | kSSE41 | kSSE42
 };
 
@@ -136,6 +172,10 @@ int SupportedTargets() {
     flags |= IsBitSet(abcd[1], 3) ? kBMI : 0;
     flags |= IsBitSet(abcd[1], 5) ? kAVX2 : 0;
     flags |= IsBitSet(abcd[1], 8) ? kBMI2 : 0;
+    flags |= IsBitSet(abcd[1], 16) ? kAVX512F : 0;
+    flags |= IsBitSet(abcd[1], 17) ? kAVX512DQ : 0;
+    flags |= IsBitSet(abcd[1], 30) ? kAVX512BW : 0;
+    flags |= IsBitSet(abcd[1], 31) ? kAVX512VL : 0;
   }
 
   // Verify OS support for XSAVE, without which XMM/YMM registers are not
@@ -151,9 +191,16 @@ int SupportedTargets() {
     if (!IsBitSet(xcr0, 2)) {
       flags &= ~(kAVX | kAVX2);
     }
+    // Opmask, ZMM lower and upper 256
+    if (!IsBitSet(xcr0, 5) || !IsBitSet(xcr0, 6) || !IsBitSet(xcr0, 7)) {
+      flags &= ~(kAVX512F | kAVX512VL | kAVX512DQ | kAVX512BW);
+    }
   }
 
   // Set target bit(s) if all their group's flags are all set.
+  if ((flags & kGroupAVX512) == kGroupAVX512) {
+    supported |= SIMD_AVX512;
+  }
   if ((flags & kGroupAVX2) == kGroupAVX2) {
     supported |= SIMD_AVX2;
   }
@@ -162,11 +209,77 @@ int SupportedTargets() {
   }
 #elif SIMD_ARCH == SIMD_ARCH_ARM
   supported |= SIMD_ARM8;
+#ifdef __linux__
+  if (HasSVE256()) {
+    supported |= SIMD_SVE256;
+  }
+#endif
+#elif SIMD_ARCH == SIMD_ARCH_WASM
+  // Engines refuse to instantiate modules containing unsupported SIMD128
+  // instructions, so there is nothing to detect at runtime.
+#if SIMD_HAVE_WASM
+  supported |= SIMD_WASM;
+#endif
 #endif
 
   supported_.store(supported, std::memory_order_release);
   return supported;
 }
 
+int EnabledTargets() {
+  int enabled = enabled_.load(std::memory_order_acquire);
+  if (SIMD_LIKELY(enabled != -1)) {
+    return enabled;
+  }
+
+  enabled = SupportedTargets();
+  const char* names = getenv("PIK_SIMD_TARGETS");
+  if (names != nullptr) {
+    const int targets = ParseTargets(names);
+    if (targets != -1) enabled &= targets;
+  }
+  // Concurrent first calls compute the same value; do not overwrite
+  // SetTargets.
+  int expected = -1;
+  if (!enabled_.compare_exchange_strong(expected, enabled)) {
+    return expected;
+  }
+  return enabled;
+}
+
+void SetTargets(const int targets) {
+  enabled_.store(targets & SupportedTargets(), std::memory_order_release);
+}
+
+int ParseTargets(const char* names) {
+  static const struct {
+    const char* name;
+    int bits;
+  } kTargets[] = {{"none", SIMD_NONE},
+                  {"sse4", SIMD_SSE4},
+                  {"avx2", SIMD_AVX2},
+                  {"avx512", SIMD_AVX512},
+                  {"arm8", SIMD_ARM8},
+                  {"sve256", SIMD_SVE256},
+                  {"wasm", SIMD_WASM}};
+  int targets = 0;
+  const char* begin = names;
+  for (;;) {
+    const char* end = strchr(begin, ',');
+    const size_t length = end == nullptr ? strlen(begin) : end - begin;
+    bool found = false;
+    for (const auto& target : kTargets) {
+      if (strlen(target.name) == length &&
+          strncmp(target.name, begin, length) == 0) {
+        targets |= target.bits;
+        found = true;
+      }
+    }
+    if (!found) return -1;
+    if (end == nullptr) return targets;
+    begin = end + 1;
+  }
+}
+
 }  // namespace dispatch
 }  // namespace pik
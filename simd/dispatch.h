@@ -20,6 +20,8 @@
 //
 // Usage: for each dispatch site, declare a Functor class, add a source file
 // that specializes its operator()<SIMD_TARGET>, dispatch::Run<Functor>(..).
+// For frequently called kernels, Dispatched<Functor, Signature> instead
+// resolves the specialization once into a function pointer.
 
 #include <utility>  // std::forward
 
@@ -29,12 +31,29 @@ namespace pik {
 namespace dispatch {
 
 // Returns bit array of instruction sets supported by the current CPU,
-// e.g. SIMD_SSE4 | SIMD_AVX2.
+// e.g. SIMD_SSE4 | SIMD_AVX2 | SIMD_AVX512.
 // WARNING: callers that wish to enumerate all targets via BestSupported should
 // take bitwise AND with the SIMD_ENABLE - it may differ from the SIMD_ENABLE
 // used to compile this function.
 int SupportedTargets();
 
+// Returns the subset of SupportedTargets() that dispatch sites should choose
+// from: all of them, unless restricted via SetTargets or the PIK_SIMD_TARGETS
+// environment variable (parsed by ParseTargets, e.g. PIK_SIMD_TARGETS=sse4).
+// This allows comparing the code paths of several targets on the same CPU.
+int EnabledTargets();
+
+// Restricts EnabledTargets to "targets" & SupportedTargets(), overriding
+// PIK_SIMD_TARGETS. Must be called before the first Dispatched<>::Get (e.g.
+// at the start of main) because it caches its choice.
+void SetTargets(int targets);
+
+// Returns the bits (e.g. SIMD_SSE4) of a comma-separated list of target
+// names: none, sse4, avx2, avx512, arm8, sve256, wasm. Returns -1 if any name
+// is unknown.
+// NONE has no bit of its own; "none" disables all SIMD targets.
+int ParseTargets(const char* names);
+
 // Returns true if the Target's bit is set in "targets" (from SupportedTargets).
 template <class Target>
 constexpr bool IsSupported(const int targets) {
@@ -66,6 +85,12 @@ SIMD_INLINE auto Run(const int supported, Func&& func, Args&&... args)
         std::forward<Args>(args)...)) {
   // NOTE: check SIMD_ENABLE rather than SIMD_ENABLE_* because the latter may
   // require additional build flags not specified for this translation unit.
+#if (SIMD_ENABLE & SIMD_AVX512) && (SIMD_ARCH == SIMD_ARCH_X86)
+  if (supported & SIMD_AVX512) {
+    return std::forward<Func>(func).template operator()<AVX512>(
+        std::forward<Args>(args)...);
+  }
+#endif
 #if (SIMD_ENABLE & SIMD_AVX2) && (SIMD_ARCH == SIMD_ARCH_X86)
   if (supported & SIMD_AVX2) {
     return std::forward<Func>(func).template operator()<AVX2>(
@@ -78,17 +103,61 @@ SIMD_INLINE auto Run(const int supported, Func&& func, Args&&... args)
         std::forward<Args>(args)...);
   }
 #endif
+#if (SIMD_ENABLE & SIMD_SVE256) && (SIMD_ARCH == SIMD_ARCH_ARM)
+  if (supported & SIMD_SVE256) {
+    return std::forward<Func>(func).template operator()<SVE256>(
+        std::forward<Args>(args)...);
+  }
+#endif
 #if (SIMD_ENABLE & SIMD_ARM8) && (SIMD_ARCH == SIMD_ARCH_ARM)
   if (supported & SIMD_ARM8) {
     return std::forward<Func>(func).template operator()<ARM8>(
         std::forward<Args>(args)...);
   }
 #endif
+#if (SIMD_ENABLE & SIMD_WASM) && (SIMD_ARCH == SIMD_ARCH_WASM)
+  if (supported & SIMD_WASM) {
+    return std::forward<Func>(func).template operator()<WASM>(
+        std::forward<Args>(args)...);
+  }
+#endif
 
   return std::forward<Func>(func).template operator()<NONE>(
       std::forward<Args>(args)...);
 }
 
+// Function pointer to Impl::operator()<Target>(Args...) for the best Target in
+// EnabledTargets(), chosen on the first call to Get. Unlike Run, later calls
+// only load the pointer. Impl must be default-constructible (stateless).
+// Usage: Dispatched<AddNoiseImpl, void(const NoiseParams&, ThreadPool*,
+//        Image3F*)>::Get()(noise_params, pool, opsin);
+template <class Impl, class Signature>
+class Dispatched;
+
+template <class Impl, typename Ret, typename... Args>
+class Dispatched<Impl, Ret(Args...)> {
+ public:
+  using Func = Ret (*)(Args...);
+
+  static Func Get() {
+    static const Func func = Run(EnabledTargets(), Resolve());
+    return func;
+  }
+
+ private:
+  template <class Target>
+  static Ret Call(Args... args) {
+    return Impl().template operator()<Target>(std::forward<Args>(args)...);
+  }
+
+  struct Resolve {
+    template <class Target>
+    Func operator()() const {
+      return &Call<Target>;
+    }
+  };
+};
+
 // Calls func.operator()<Target>(args) for all instruction sets in "targets"
 // (typically the return value of SupportedTargets).
 template <class Func, typename... Args>
@@ -107,12 +176,30 @@ SIMD_INLINE void ForeachTarget(const int targets, Func&& func, Args&&... args) {
         std::forward<Args>(args)...);
   }
 #endif
+#if (SIMD_ENABLE & SIMD_AVX512) && (SIMD_ARCH == SIMD_ARCH_X86)
+  if (targets & SIMD_AVX512) {
+    std::forward<Func>(func).template operator()<AVX512>(
+        std::forward<Args>(args)...);
+  }
+#endif
 #if (SIMD_ENABLE & SIMD_ARM8) && (SIMD_ARCH == SIMD_ARCH_ARM)
   if (targets & SIMD_ARM8) {
     std::forward<Func>(func).template operator()<ARM8>(
         std::forward<Args>(args)...);
   }
 #endif
+#if (SIMD_ENABLE & SIMD_SVE256) && (SIMD_ARCH == SIMD_ARCH_ARM)
+  if (targets & SIMD_SVE256) {
+    std::forward<Func>(func).template operator()<SVE256>(
+        std::forward<Args>(args)...);
+  }
+#endif
+#if (SIMD_ENABLE & SIMD_WASM) && (SIMD_ARCH == SIMD_ARCH_WASM)
+  if (targets & SIMD_WASM) {
+    std::forward<Func>(func).template operator()<WASM>(
+        std::forward<Args>(args)...);
+  }
+#endif
 
   std::forward<Func>(func).template operator()<NONE>(
       std::forward<Args>(args)...);
@@ -5,6 +5,12 @@
 #error "Must set SIMD_ATTR_IMPL to name of include file"
 #endif
 
+#if SIMD_ENABLE_AVX512
+#undef SIMD_TARGET
+#define SIMD_TARGET AVX512
+#include SIMD_ATTR_IMPL
+#endif
+
 #if SIMD_ENABLE_AVX2
 #undef SIMD_TARGET
 #define SIMD_TARGET AVX2
@@ -17,12 +23,24 @@
 #include SIMD_ATTR_IMPL
 #endif
 
+#if SIMD_ENABLE_SVE256
+#undef SIMD_TARGET
+#define SIMD_TARGET SVE256
+#include SIMD_ATTR_IMPL
+#endif
+
 #if SIMD_ENABLE_ARM8
 #undef SIMD_TARGET
 #define SIMD_TARGET ARM8
 #include SIMD_ATTR_IMPL
 #endif
 
+#if SIMD_ENABLE_WASM
+#undef SIMD_TARGET
+#define SIMD_TARGET WASM
+#include SIMD_ATTR_IMPL
+#endif
+
 #undef SIMD_TARGET
 #define SIMD_TARGET NONE
 #include SIMD_ATTR_IMPL
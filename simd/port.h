@@ -51,12 +51,15 @@
 #define SIMD_ARCH_X86 8
 #define SIMD_ARCH_PPC 9
 #define SIMD_ARCH_ARM 0xA
+#define SIMD_ARCH_WASM 0xB
 #if defined(__x86_64__) || defined(_M_X64)
 #define SIMD_ARCH SIMD_ARCH_X86
 #elif defined(__powerpc64__) || defined(_M_PPC)
 #define SIMD_ARCH SIMD_ARCH_PPC
 #elif defined(__aarch64__)
 #define SIMD_ARCH SIMD_ARCH_ARM
+#elif defined(__wasm__)
+#define SIMD_ARCH SIMD_ARCH_WASM
 #else
 #error "Unsupported platform"
 #endif
@@ -69,6 +72,8 @@
 #define SIMD_AVX512 16
 #define SIMD_PPC 1  // v2.07 or 3
 #define SIMD_ARM8 8
+#define SIMD_SVE256 32  // SVE with 256-bit vectors
+#define SIMD_WASM 64    // WebAssembly SIMD128
 
 // Default to portable mode (only scalar.h). This macro should only be set by
 // the build system and tested below.
@@ -87,6 +92,8 @@
 #define SIMD_HAVE_SSE4 (SIMD_ARCH == SIMD_ARCH_X86)
 #define SIMD_HAVE_AVX512 (SIMD_ARCH == SIMD_ARCH_X86)
 #define SIMD_HAVE_ARM8 (SIMD_ARCH == SIMD_ARCH_ARM)
+#define SIMD_HAVE_SVE256 (SIMD_ARCH == SIMD_ARCH_ARM)
+#define SIMD_HAVE_WASM (SIMD_ARCH == SIMD_ARCH_WASM)
 
 // .. otherwise, disallow intrinsics if -m flags are not specified.
 #if !defined(_MSC_VER) && !SIMD_USE_ATTR
@@ -101,6 +108,12 @@
 #define SIMD_HAVE_AVX2 0
 #endif  // AVX2
 
+#if !defined(__AVX512F__) || !defined(__AVX512VL__) || \
+    !defined(__AVX512DQ__) || !defined(__AVX512BW__)
+#undef SIMD_HAVE_AVX512
+#define SIMD_HAVE_AVX512 0
+#endif  // AVX512
+
 #if !defined(__ARM_NEON)
 #undef SIMD_HAVE_ARM8
 #define SIMD_HAVE_ARM8 0
@@ -108,11 +121,37 @@
 
 #endif
 
+// Fixed-size SVE types require -msve-vector-bits=256, even in attr mode.
+#if !defined(__ARM_FEATURE_SVE) || !defined(__ARM_FEATURE_SVE_BITS) || \
+    __ARM_FEATURE_SVE_BITS != 256
+#undef SIMD_HAVE_SVE256
+#define SIMD_HAVE_SVE256 0
+#endif  // SVE256
+
+// WebAssembly modules cannot contain SIMD128 unless built with -msimd128, and
+// there is no runtime dispatch, so this also applies in attr mode.
+#if !defined(__wasm_simd128__)
+#undef SIMD_HAVE_WASM
+#define SIMD_HAVE_WASM 0
+#endif  // WASM
+
 // Set ENABLE_XX shortcuts (for internal use).
 #define SIMD_ENABLE_SSE4 (SIMD_ENABLE & SIMD_SSE4) && SIMD_HAVE_SSE4
 #define SIMD_ENABLE_AVX2 (SIMD_ENABLE & SIMD_AVX2) && SIMD_HAVE_AVX2
 #define SIMD_ENABLE_AVX512 (SIMD_ENABLE & SIMD_AVX512) && SIMD_HAVE_AVX512
 #define SIMD_ENABLE_ARM8 (SIMD_ENABLE & SIMD_ARM8) && SIMD_HAVE_ARM8
+#define SIMD_ENABLE_SVE256 (SIMD_ENABLE & SIMD_SVE256) && SIMD_HAVE_SVE256
+#define SIMD_ENABLE_WASM (SIMD_ENABLE & SIMD_WASM) && SIMD_HAVE_WASM
+
+// Parts of AVX-512 vectors are AVX2/SSE4 vectors.
+#if (SIMD_ENABLE_AVX512) && !((SIMD_ENABLE_AVX2) && (SIMD_ENABLE_SSE4))
+#error "SIMD_AVX512 requires SIMD_AVX2 and SIMD_SSE4 to also be enabled"
+#endif
+
+// Parts of SVE256 vectors are NEON vectors.
+#if (SIMD_ENABLE_SVE256) && !(SIMD_ENABLE_ARM8)
+#error "SIMD_SVE256 requires SIMD_ARM8 to also be enabled"
+#endif
 
 // Detects "best available" instruction set and includes their headers. NOTE:
 // system headers cannot be included from within SIMD_NAMESPACE due to conflicts
@@ -123,7 +162,11 @@
 #include <intrin.h>
 #endif
 
-#if SIMD_ENABLE_AVX2
+#if SIMD_ENABLE_AVX512
+#include <immintrin.h>
+#define SIMD_TARGET AVX512
+
+#elif SIMD_ENABLE_AVX2
 #include <immintrin.h>
 #define SIMD_TARGET AVX2
 
@@ -137,11 +180,21 @@
 #include <emmintrin.h>
 #endif
 
-#if SIMD_ENABLE_ARM8
+#if SIMD_ENABLE_SVE256
+#include <arm_neon.h>
+#include <arm_sve.h>
+#define SIMD_TARGET SVE256
+
+#elif SIMD_ENABLE_ARM8
 #include <arm_neon.h>
 #define SIMD_TARGET ARM8
 #endif
 
+#if SIMD_ENABLE_WASM
+#include <wasm_simd128.h>
+#define SIMD_TARGET WASM
+#endif
+
 // Nothing enabled => portable mode, only use scalar.h.
 #ifndef SIMD_TARGET
 #define SIMD_TARGET NONE
@@ -152,8 +205,12 @@
 #define SIMD_CONCAT(a, b) SIMD_CONCAT_IMPL(a, b)
 
 #define SIMD_ATTR_ARM8 SIMD_TARGET_ATTR("armv8-a+crypto")
+#define SIMD_ATTR_SVE256 SIMD_TARGET_ATTR("+sve")
+#define SIMD_ATTR_WASM SIMD_TARGET_ATTR("simd128")
 #define SIMD_ATTR_SSE4 SIMD_TARGET_ATTR("sse4.2,aes,pclmul")
 #define SIMD_ATTR_AVX2 SIMD_TARGET_ATTR("avx,avx2,fma")
+#define SIMD_ATTR_AVX512 \
+  SIMD_TARGET_ATTR("avx,avx2,fma,avx512f,avx512vl,avx512dq,avx512bw")
 #define SIMD_ATTR_NONE
 #define SIMD_ATTR SIMD_CONCAT(SIMD_ATTR_, SIMD_TARGET)
 
@@ -214,6 +271,21 @@ struct ARM8 {
     return 16 / sizeof(T);
   }
 };
+struct SVE256 {
+  static constexpr int value = SIMD_SVE256;
+  template <typename T>
+  static constexpr size_t NumLanes() {
+    return 32 / sizeof(T);
+  }
+};
+#elif SIMD_ARCH == SIMD_ARCH_WASM
+struct WASM {
+  static constexpr int value = SIMD_WASM;
+  template <typename T>
+  static constexpr size_t NumLanes() {
+    return 16 / sizeof(T);
+  }
+};
 #endif
 
 struct NONE {
@@ -249,6 +321,13 @@ struct PartTargetT<2, Target> {
   using type = AVX2;
 };
 #endif
+// SVE256 vectors are split into NEON parts (as with AVX2 and SSE4).
+#if SIMD_ENABLE_SVE256
+template <class Target>
+struct PartTargetT<1, Target> {
+  using type = ARM8;
+};
+#endif
 
 template <typename T, size_t N, class Target>
 using PartTarget =
@@ -15,8 +15,8 @@
 #ifndef SIMD_SIMD_H_
 #define SIMD_SIMD_H_
 
-// Performance-portable SIMD API for SSE4/AVX2/ARMv8, later AVX-512 and PPC8.
-// Each operation is efficient on all platforms.
+// Performance-portable SIMD API for SSE4/AVX2/AVX-512/ARMv8/SVE/WebAssembly,
+// later PPC8. Each operation is efficient on all platforms.
 
 // WARNING: this header may be included from translation units compiled with
 // different flags. To prevent ODR violations, all functions defined here or
@@ -29,7 +29,8 @@
 
 // Ensures an array is aligned and suitable for load()/store() functions.
 // Example: SIMD_ALIGN T lanes[V::N];
-#define SIMD_ALIGN alignas(32)
+// Independent of SIMD_ENABLE so that all targets agree on the layout.
+#define SIMD_ALIGN alignas(64)
 
 namespace pik {
 #ifdef SIMD_NAMESPACE
@@ -141,18 +142,32 @@ inline const char* vec_name() {
 // This has no other effect because the headers are empty #if SIMD_DEPS.
 
 // Also used by x86_avx2.h => must be included first.
-#if SIMD_DEPS || (SIMD_ENABLE_SSE4 || SIMD_ENABLE_AVX2)
+#if SIMD_DEPS || (SIMD_ENABLE_SSE4 || SIMD_ENABLE_AVX2 || SIMD_ENABLE_AVX512)
 #include "simd/x86_sse4.h"
 #endif
 
-#if SIMD_DEPS || SIMD_ENABLE_AVX2
+// Also used by x86_avx512.h.
+#if SIMD_DEPS || (SIMD_ENABLE_AVX2 || SIMD_ENABLE_AVX512)
 #include "simd/x86_avx2.h"
 #endif
 
+#if SIMD_DEPS || SIMD_ENABLE_AVX512
+#include "simd/x86_avx512.h"
+#endif
+
+// Also used by arm64_sve.h.
 #if SIMD_DEPS || SIMD_ENABLE_ARM8
 #include "simd/arm64_neon.h"
 #endif
 
+#if SIMD_DEPS || SIMD_ENABLE_SVE256
+#include "simd/arm64_sve.h"
+#endif
+
+#if SIMD_DEPS || SIMD_ENABLE_WASM
+#include "simd/wasm_128.h"
+#endif
+
 // Always available
 #include "simd/scalar.h"
 
@@ -135,14 +135,14 @@ void TestFloorLog2() {
   const size_t kBytes = 32;
   static_assert(kBytes % kStep == 0, "Must be a multiple of kStep");
 
-  uint8_t in[kBytes];
+  SIMD_ALIGN uint8_t in[kBytes];
   uint8_t expected[kBytes];
   RandomState rng = {1234};
   for (size_t i = 0; i < kBytes; ++i) {
     expected[i] = Random32(&rng) & 7;
     in[i] = 1u << expected[i];
   }
-  uint8_t out[32];
+  SIMD_ALIGN uint8_t out[kBytes];
   for (size_t i = 0; i < kBytes; i += kStep) {
     FloorLog2(in + i, out + i);
   }
@@ -725,7 +725,7 @@ struct TestSignedShifts {
   }
 };
 
-#if SIMD_TARGET_VALUE != SIMD_SSE4
+#if SIMD_TARGET_VALUE != SIMD_SSE4 && SIMD_TARGET_VALUE != SIMD_WASM
 
 struct TestUnsignedVarShifts {
   template <typename T, class D>
@@ -840,7 +840,7 @@ void TestShifts() {
   Call<TestSignedShifts, int32_t>();
   // No i64/f32/f64.
 
-#if SIMD_TARGET_VALUE != SIMD_SSE4
+#if SIMD_TARGET_VALUE != SIMD_SSE4 && SIMD_TARGET_VALUE != SIMD_WASM
   Call<TestUnsignedVarShifts, uint32_t>();
   Call<TestUnsignedVarShifts, uint64_t>();
   Call<TestSignedVarLeftShifts, int32_t>();
@@ -1405,29 +1405,36 @@ struct TestFloatCompare {
 // Returns "bits" after zeroing any upper bits that wouldn't be returned by
 // movemask for the given vector "D".
 template <class D>
-uint32_t ValidBits(D d, const uint32_t bits) {
-  const uint64_t mask = (1ull << d.N) - 1;
+uint64_t ValidBits(D d, const uint64_t bits) {
+  const uint64_t mask = d.N >= 64 ? ~0ull : (1ull << (d.N & 63)) - 1;
   return bits & mask;
 }
 
 void TestMovemask() {
   const Full<uint8_t> d;
-  SIMD_ALIGN const uint8_t bytes[32] = {
+  SIMD_ALIGN const uint8_t bytes[64] = {
+      0x80, 0xFF, 0x7F, 0x00,  0x01, 0x10, 0x20, 0x40,
+      0x80, 0x02, 0x04, 0x08,  0xC0, 0xC1, 0xFE, 0x0F,
+      0x0F, 0xFE, 0xC1, 0xC0,  0x08, 0x04, 0x02, 0x80,
+      0x40, 0x20, 0x10, 0x01,  0x00, 0x7F, 0xFF, 0x80,
       0x80, 0xFF, 0x7F, 0x00,  0x01, 0x10, 0x20, 0x40,
       0x80, 0x02, 0x04, 0x08,  0xC0, 0xC1, 0xFE, 0x0F,
       0x0F, 0xFE, 0xC1, 0xC0,  0x08, 0x04, 0x02, 0x80,
       0x40, 0x20, 0x10, 0x01,  0x00, 0x7F, 0xFF, 0x80
   };
-  ASSERT_EQ(ValidBits(d, 0xC08E7103), ext::movemask(load(d, bytes)));
+  ASSERT_EQ(ValidBits(d, 0xC08E7103C08E7103ull),
+            uint64_t(ext::movemask(load(d, bytes))));
 
-  SIMD_ALIGN const float lanes[8] = {-1.0f,  1E30f, -0.0f, 1E-30f,
-                                     1E-30f, -0.0f, 1E30f, -1.0f};
+  SIMD_ALIGN const float lanes[16] = {
+      -1.0f,  1E30f, -0.0f, 1E-30f, 1E-30f, -0.0f, 1E30f, -1.0f,
+      -1.0f,  1E30f, -0.0f, 1E-30f, 1E-30f, -0.0f, 1E30f, -1.0f};
   const Full<float> df;
-  ASSERT_EQ(ValidBits(df, 0xa5), ext::movemask(load(df, lanes)));
+  ASSERT_EQ(ValidBits(df, 0xa5a5), uint64_t(ext::movemask(load(df, lanes))));
 
   const Full<double> dd;
-  SIMD_ALIGN const double lanes2[4] = {1E300, -1E-300, -0.0, 1E-10};
-  ASSERT_EQ(ValidBits(dd, 6), ext::movemask(load(dd, lanes2)));
+  SIMD_ALIGN const double lanes2[8] = {1E300, -1E-300, -0.0, 1E-10,
+                                       1E300, -1E-300, -0.0, 1E-10};
+  ASSERT_EQ(ValidBits(dd, 0x66), uint64_t(ext::movemask(load(dd, lanes2))));
 }
 
 struct TestAllZero {
@@ -1652,7 +1659,8 @@ struct TestStreamT {
   }
 };
 
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_AVX512 || \
+    SIMD_TARGET_VALUE == SIMD_SVE256
 
 template <typename Offset, int kShift>
 struct TestGatherT {
@@ -1726,7 +1734,7 @@ struct TestFloatGatherT {
   }
 };
 
-#endif  // SIMD_TARGET_VALUE == SIMD_AVX2
+#endif  // SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_AVX512 || SIMD_SVE256
 
 void TestStream() {
   // No u8,u16.
@@ -1740,7 +1748,8 @@ void TestStream() {
 }
 
 void TestGather() {
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_AVX512 || \
+    SIMD_TARGET_VALUE == SIMD_SVE256
   // No u8,u16.
   Call<TestGatherT<int32_t, 2>, uint32_t>();
   Call<TestGatherT<int64_t, 3>, uint64_t>();
@@ -2052,7 +2061,7 @@ void TestBroadcast() {
 struct TestPermuteT {
   template <typename T, class D>
   void operator()(T, D d) const {
-#if SIMD_TARGET_VALUE == SIMD_AVX2
+#if SIMD_TARGET_VALUE == SIMD_AVX2 || SIMD_TARGET_VALUE == SIMD_SVE256
     // Test one specific permutation with repeated and cross-block indices.
     SIMD_ALIGN int32_t idx[d.N] = {1, 7, 2, 2, 4, 1, 3, 6};
     const auto v = iota(d, 1);
@@ -2061,11 +2070,24 @@ struct TestPermuteT {
       expected_lanes[i] = idx[i] + 1;  // == v[idx[i]]
     }
 
+    const auto opaque = set_table_indices(d, idx);
+    const auto actual = table_lookup_lanes(v, opaque);
+    ASSERT_VEC_EQ(d, expected_lanes, actual);
+#elif SIMD_TARGET_VALUE == SIMD_AVX512
+    // Same, but with indices crossing all four blocks.
+    SIMD_ALIGN int32_t idx[d.N] = {1, 15, 2, 2, 4, 1, 3, 6,
+                                   9, 8, 14, 0, 12, 12, 11, 5};
+    const auto v = iota(d, 1);
+    SIMD_ALIGN T expected_lanes[d.N];
+    for (size_t i = 0; i < d.N; ++i) {
+      expected_lanes[i] = idx[i] + 1;  // == v[idx[i]]
+    }
+
     const auto opaque = set_table_indices(d, idx);
     const auto actual = table_lookup_lanes(v, opaque);
     ASSERT_VEC_EQ(d, expected_lanes, actual);
 #else
-    // Non-AVX2: test all possible permutations.
+    // Other targets: test all possible permutations.
     SIMD_ALIGN int32_t idx[d.N];
     const auto v = iota(d, 1);
     SIMD_ALIGN T expected_lanes[d.N];
@@ -2190,11 +2212,13 @@ struct TestShuffleT {
       in_bytes[i] = Random32(&rng) & 0xFF;
     }
     const auto in = load(d8, in_bytes);
-    SIMD_ALIGN const uint8_t index_bytes[32] = {
+    SIMD_ALIGN const uint8_t index_bytes[64] = {
         // Same index as source, multiple outputs from same input,
         // unused input (9), ascending/descending and nonconsecutive neighbors.
         0,  2,  1, 2, 15, 12, 13, 14, 6,  7,  8,  5,  4, 3, 10, 11,
-        11, 10, 3, 4, 5,  8,  7,  6,  14, 13, 12, 15, 2, 1, 2,  0};
+        11, 10, 3, 4, 5,  8,  7,  6,  14, 13, 12, 15, 2, 1, 2,  0,
+        4,  3,  2, 2, 5,  6,  7,  7,  15, 15, 15, 15, 15, 15, 0, 1,
+        1,  9,  2, 9, 3,  9,  4,  9,  15, 14, 13, 12, 11, 10, 9, 8};
     const auto indices = load(d8, index_bytes);
     SIMD_ALIGN T out_lanes[d.N];
     store(table_lookup_bytes(cast_to(d, in), indices), d, out_lanes);
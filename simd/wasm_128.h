@@ -0,0 +1,2029 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// 128-bit WebAssembly SIMD128 vectors and operations (requires -msimd128).
+// (No include guard nor namespace: this is included from the middle of simd.h.)
+
+// The API and semantics match x86_sse4.h, so the 128-bit code paths are shared.
+// Exceptions: approximate_reciprocal(_sqrt) are exact, shift counts are taken
+// modulo the lane width, out-of-range float to int conversions saturate, and
+// there is no aes_round.
+
+// Avoid compile errors when generating deps.mk.
+#if SIMD_DEPS == 0
+
+// Returned by set_shift_*_count; do not use directly.
+template <typename T, size_t N>
+struct shift_left_count {
+  int bits;
+};
+
+template <typename T, size_t N>
+struct shift_right_count {
+  int bits;
+};
+
+// Returned by set_table_indices for use by table_lookup_lanes.
+template <typename T>
+struct permute_wasm {
+  v128_t raw;
+};
+
+template <typename T, size_t N = WASM::NumLanes<T>()>
+class vec_wasm {
+ public:
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm() {}
+  vec_wasm(const vec_wasm&) = default;
+  vec_wasm& operator=(const vec_wasm&) = default;
+  SIMD_ATTR_WASM SIMD_INLINE explicit vec_wasm(const v128_t raw) : raw(raw) {}
+
+  // Compound assignment. Only usable if there is a corresponding non-member
+  // binary operator overload. For example, only f32 and f64 support division.
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm& operator*=(const vec_wasm other) {
+    return *this = (*this * other);
+  }
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm& operator/=(const vec_wasm other) {
+    return *this = (*this / other);
+  }
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm& operator+=(const vec_wasm other) {
+    return *this = (*this + other);
+  }
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm& operator-=(const vec_wasm other) {
+    return *this = (*this - other);
+  }
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm& operator&=(const vec_wasm other) {
+    return *this = (*this & other);
+  }
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm& operator|=(const vec_wasm other) {
+    return *this = (*this | other);
+  }
+  SIMD_ATTR_WASM SIMD_INLINE vec_wasm& operator^=(const vec_wasm other) {
+    return *this = (*this ^ other);
+  }
+
+  v128_t raw;
+};
+
+template <typename T, size_t N>
+struct VecT<T, N, WASM> {
+  using type = vec_wasm<T, N>;
+};
+
+using u8x16 = vec_wasm<uint8_t, 16>;
+using u16x8 = vec_wasm<uint16_t, 8>;
+using u32x4 = vec_wasm<uint32_t, 4>;
+using u64x2 = vec_wasm<uint64_t, 2>;
+using i8x16 = vec_wasm<int8_t, 16>;
+using i16x8 = vec_wasm<int16_t, 8>;
+using i32x4 = vec_wasm<int32_t, 4>;
+using i64x2 = vec_wasm<int64_t, 2>;
+using f32x4 = vec_wasm<float, 4>;
+using f64x2 = vec_wasm<double, 2>;
+
+using u8x8 = vec_wasm<uint8_t, 8>;
+using u16x4 = vec_wasm<uint16_t, 4>;
+using u32x2 = vec_wasm<uint32_t, 2>;
+using i8x8 = vec_wasm<int8_t, 8>;
+using i16x4 = vec_wasm<int16_t, 4>;
+using i32x2 = vec_wasm<int32_t, 2>;
+using f32x2 = vec_wasm<float, 2>;
+using f64x1 = vec_wasm<double, 1>;
+
+using u8x4 = vec_wasm<uint8_t, 4>;
+using i8x4 = vec_wasm<int8_t, 4>;
+using f32x1 = vec_wasm<float, 1>;
+
+// ------------------------------ Cast
+
+// All lane types share the same v128_t, so casts are free.
+
+// cast_to_u8
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> cast_to_u8(
+    Desc<uint8_t, N, WASM>, vec_wasm<T, N / sizeof(T)> v) {
+  return vec_wasm<uint8_t, N>(v.raw);
+}
+
+// cast_u8_to
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> cast_u8_to(
+    Desc<T, N, WASM>, vec_wasm<uint8_t, N * sizeof(T)> v) {
+  return vec_wasm<T, N>(v.raw);
+}
+
+// cast_to
+template <typename T, size_t N, typename FromT>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> cast_to(
+    Desc<T, N, WASM> d, vec_wasm<FromT, N * sizeof(T) / sizeof(FromT)> v) {
+  const auto u8 = cast_to_u8(Desc<uint8_t, N * sizeof(T), WASM>(), v);
+  return cast_u8_to(d, u8);
+}
+
+// ------------------------------ Set
+
+// Returns an all-zero vector/part.
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> setzero(Desc<T, N, WASM>) {
+  return vec_wasm<T, N>(wasm_i32x4_splat(0));
+}
+
+// Returns a vector/part with all lanes set to "t".
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> set1(Desc<uint8_t, N, WASM>,
+                                                     const uint8_t t) {
+  return vec_wasm<uint8_t, N>(wasm_i8x16_splat(static_cast<int8_t>(t)));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> set1(Desc<uint16_t, N, WASM>,
+                                                      const uint16_t t) {
+  return vec_wasm<uint16_t, N>(wasm_i16x8_splat(static_cast<int16_t>(t)));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> set1(Desc<uint32_t, N, WASM>,
+                                                      const uint32_t t) {
+  return vec_wasm<uint32_t, N>(wasm_i32x4_splat(static_cast<int32_t>(t)));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> set1(Desc<uint64_t, N, WASM>,
+                                                      const uint64_t t) {
+  return vec_wasm<uint64_t, N>(wasm_i64x2_splat(static_cast<int64_t>(t)));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> set1(Desc<int8_t, N, WASM>,
+                                                    const int8_t t) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_splat(t));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> set1(Desc<int16_t, N, WASM>,
+                                                     const int16_t t) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_splat(t));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> set1(Desc<int32_t, N, WASM>,
+                                                     const int32_t t) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_splat(t));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> set1(Desc<int64_t, N, WASM>,
+                                                     const int64_t t) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_splat(t));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> set1(Desc<float, N, WASM>,
+                                                   const float t) {
+  return vec_wasm<float, N>(wasm_f32x4_splat(t));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> set1(Desc<double, N, WASM>,
+                                                    const double t) {
+  return vec_wasm<double, N>(wasm_f64x2_splat(t));
+}
+
+// Returns a vector with lane i=[0, N) set to "first" + i. Unique per-lane
+// values are required to detect lane-crossing bugs.
+template <typename T, size_t N, typename T2>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> iota(Desc<T, N, WASM> d,
+                                               const T2 first) {
+  SIMD_ALIGN T lanes[N];
+  for (size_t i = 0; i < N; ++i) {
+    lanes[i] = first + i;
+  }
+  return load(d, lanes);
+}
+
+SIMD_DIAGNOSTICS(push)
+SIMD_DIAGNOSTICS_OFF(disable : 4700, ignored "-Wuninitialized")
+
+// Returns a vector with uninitialized elements.
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> undefined(Desc<T, N, WASM>) {
+  v128_t raw;
+  return vec_wasm<T, N>(raw);
+}
+
+SIMD_DIAGNOSTICS(pop)
+
+// ================================================== ARITHMETIC
+
+// ------------------------------ Addition
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> operator+(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_i8x16_add(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> operator+(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_i16x8_add(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> operator+(
+    const vec_wasm<uint32_t, N> a, const vec_wasm<uint32_t, N> b) {
+  return vec_wasm<uint32_t, N>(wasm_i32x4_add(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> operator+(
+    const vec_wasm<uint64_t, N> a, const vec_wasm<uint64_t, N> b) {
+  return vec_wasm<uint64_t, N>(wasm_i64x2_add(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> operator+(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_add(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> operator+(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_add(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> operator+(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_add(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> operator+(
+    const vec_wasm<int64_t, N> a, const vec_wasm<int64_t, N> b) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_add(a.raw, b.raw));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator+(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_add(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator+(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_add(a.raw, b.raw));
+}
+
+// ------------------------------ Subtraction
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> operator-(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_i8x16_sub(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> operator-(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_i16x8_sub(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> operator-(
+    const vec_wasm<uint32_t, N> a, const vec_wasm<uint32_t, N> b) {
+  return vec_wasm<uint32_t, N>(wasm_i32x4_sub(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> operator-(
+    const vec_wasm<uint64_t, N> a, const vec_wasm<uint64_t, N> b) {
+  return vec_wasm<uint64_t, N>(wasm_i64x2_sub(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> operator-(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_sub(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> operator-(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_sub(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> operator-(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_sub(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> operator-(
+    const vec_wasm<int64_t, N> a, const vec_wasm<int64_t, N> b) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_sub(a.raw, b.raw));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator-(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_sub(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator-(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_sub(a.raw, b.raw));
+}
+
+// ------------------------------ Saturating addition
+
+// Returns a + b clamped to the destination range.
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> saturated_add(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_u8x16_add_sat(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> saturated_add(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_add_sat(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> saturated_add(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_add_sat(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> saturated_add(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_add_sat(a.raw, b.raw));
+}
+
+// ------------------------------ Saturating subtraction
+
+// Returns a - b clamped to the destination range.
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> saturated_subtract(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_u8x16_sub_sat(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> saturated_subtract(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_sub_sat(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> saturated_subtract(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_sub_sat(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> saturated_subtract(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_sub_sat(a.raw, b.raw));
+}
+
+// ------------------------------ Average
+
+// Returns (a + b + 1) / 2
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> average_round(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_u8x16_avgr(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> average_round(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_avgr(a.raw, b.raw));
+}
+
+// ------------------------------ Absolute value
+
+// Returns absolute value, except that LimitsMin() maps to LimitsMax() + 1.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> abs(
+    const vec_wasm<int8_t, N> v) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_abs(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> abs(
+    const vec_wasm<int16_t, N> v) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_abs(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> abs(
+    const vec_wasm<int32_t, N> v) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_abs(v.raw));
+}
+
+// ------------------------------ Shift lanes by constant #bits
+
+// Unsigned
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> shift_left(
+    const vec_wasm<uint16_t, N> v) {
+  return vec_wasm<uint16_t, N>(wasm_i16x8_shl(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> shift_right(
+    const vec_wasm<uint16_t, N> v) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_shr(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> shift_left(
+    const vec_wasm<uint32_t, N> v) {
+  return vec_wasm<uint32_t, N>(wasm_i32x4_shl(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> shift_right(
+    const vec_wasm<uint32_t, N> v) {
+  return vec_wasm<uint32_t, N>(wasm_u32x4_shr(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> shift_left(
+    const vec_wasm<uint64_t, N> v) {
+  return vec_wasm<uint64_t, N>(wasm_i64x2_shl(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> shift_right(
+    const vec_wasm<uint64_t, N> v) {
+  return vec_wasm<uint64_t, N>(wasm_u64x2_shr(v.raw, kBits));
+}
+
+// Signed (no i64 shift_right)
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> shift_left(
+    const vec_wasm<int16_t, N> v) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_shl(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> shift_right(
+    const vec_wasm<int16_t, N> v) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_shr(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> shift_left(
+    const vec_wasm<int32_t, N> v) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_shl(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> shift_right(
+    const vec_wasm<int32_t, N> v) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_shr(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> shift_left(
+    const vec_wasm<int64_t, N> v) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_shl(v.raw, kBits));
+}
+
+// ------------------------------ Shift lanes by same variable #bits
+
+// Unlike x86, counts >= the lane width are taken modulo the lane width.
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE shift_left_count<T, N> set_shift_left_count(
+    Desc<T, N, WASM>, const int bits) {
+  return shift_left_count<T, N>{bits};
+}
+
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE shift_right_count<T, N> set_shift_right_count(
+    Desc<T, N, WASM>, const int bits) {
+  return shift_right_count<T, N>{bits};
+}
+
+// Unsigned (no u8)
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> shift_left_same(
+    const vec_wasm<uint16_t, N> v, const shift_left_count<uint16_t, N> bits) {
+  return vec_wasm<uint16_t, N>(wasm_i16x8_shl(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> shift_right_same(
+    const vec_wasm<uint16_t, N> v, const shift_right_count<uint16_t, N> bits) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_shr(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> shift_left_same(
+    const vec_wasm<uint32_t, N> v, const shift_left_count<uint32_t, N> bits) {
+  return vec_wasm<uint32_t, N>(wasm_i32x4_shl(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> shift_right_same(
+    const vec_wasm<uint32_t, N> v, const shift_right_count<uint32_t, N> bits) {
+  return vec_wasm<uint32_t, N>(wasm_u32x4_shr(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> shift_left_same(
+    const vec_wasm<uint64_t, N> v, const shift_left_count<uint64_t, N> bits) {
+  return vec_wasm<uint64_t, N>(wasm_i64x2_shl(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> shift_right_same(
+    const vec_wasm<uint64_t, N> v, const shift_right_count<uint64_t, N> bits) {
+  return vec_wasm<uint64_t, N>(wasm_u64x2_shr(v.raw, bits.bits));
+}
+
+// Signed (no i8,i64)
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> shift_left_same(
+    const vec_wasm<int16_t, N> v, const shift_left_count<int16_t, N> bits) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_shl(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> shift_right_same(
+    const vec_wasm<int16_t, N> v, const shift_right_count<int16_t, N> bits) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_shr(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> shift_left_same(
+    const vec_wasm<int32_t, N> v, const shift_left_count<int32_t, N> bits) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_shl(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> shift_right_same(
+    const vec_wasm<int32_t, N> v, const shift_right_count<int32_t, N> bits) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_shr(v.raw, bits.bits));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> shift_left_same(
+    const vec_wasm<int64_t, N> v, const shift_left_count<int64_t, N> bits) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_shl(v.raw, bits.bits));
+}
+
+// ------------------------------ Minimum
+
+// Unsigned (no u64)
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> min(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_u8x16_min(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> min(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_min(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> min(
+    const vec_wasm<uint32_t, N> a, const vec_wasm<uint32_t, N> b) {
+  return vec_wasm<uint32_t, N>(wasm_u32x4_min(a.raw, b.raw));
+}
+
+// Signed (no i64)
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> min(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_min(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> min(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_min(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> min(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_min(a.raw, b.raw));
+}
+
+// Float: pmin(b, a) is a < b ? a : b, same as MINPS and much cheaper than the
+// NaN-propagating wasm_f32x4_min on x86 hosts.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> min(const vec_wasm<float, N> a,
+                                                  const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_pmin(b.raw, a.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> min(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_pmin(b.raw, a.raw));
+}
+
+// ------------------------------ Maximum
+
+// Unsigned (no u64)
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> max(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_u8x16_max(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> max(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_max(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> max(
+    const vec_wasm<uint32_t, N> a, const vec_wasm<uint32_t, N> b) {
+  return vec_wasm<uint32_t, N>(wasm_u32x4_max(a.raw, b.raw));
+}
+
+// Signed (no i64)
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> max(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_max(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> max(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_max(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> max(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_max(a.raw, b.raw));
+}
+
+// Float: pmax(b, a) is a > b ? a : b, same as MAXPS.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> max(const vec_wasm<float, N> a,
+                                                  const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_pmax(b.raw, a.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> max(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_pmax(b.raw, a.raw));
+}
+
+// Returns the closest value to v within [lo, hi].
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> clamp(const vec_wasm<T, N> v,
+                                                const vec_wasm<T, N> lo,
+                                                const vec_wasm<T, N> hi) {
+  return min(max(lo, v), hi);
+}
+
+// ------------------------------ Integer multiplication
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> operator*(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_i16x8_mul(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> operator*(
+    const vec_wasm<uint32_t, N> a, const vec_wasm<uint32_t, N> b) {
+  return vec_wasm<uint32_t, N>(wasm_i32x4_mul(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> operator*(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_mul(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> operator*(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_mul(a.raw, b.raw));
+}
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+// Returns the upper 16 bits of a * b in each lane.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> mul_high(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  const v128_t lo = wasm_u32x4_extmul_low_u16x8(a.raw, b.raw);
+  const v128_t hi = wasm_u32x4_extmul_high_u16x8(a.raw, b.raw);
+  return vec_wasm<uint16_t, N>(
+      wasm_i16x8_shuffle(lo, hi, 1, 3, 5, 7, 9, 11, 13, 15));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> mul_high(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  const v128_t lo = wasm_i32x4_extmul_low_i16x8(a.raw, b.raw);
+  const v128_t hi = wasm_i32x4_extmul_high_i16x8(a.raw, b.raw);
+  return vec_wasm<int16_t, N>(
+      wasm_i16x8_shuffle(lo, hi, 1, 3, 5, 7, 9, 11, 13, 15));
+}
+
+}  // namespace ext
+
+// Returns (((a * b) >> 14) + 1) >> 1. Unlike x86, -32768 * -32768 saturates
+// to 32767.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> mul_high_round(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_q15mulr_sat(a.raw, b.raw));
+}
+
+// Multiplies even lanes (0, 2 ..) and places the double-wide result into
+// even and the upper half into its odd neighbor lane.
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> mul_even(
+    const vec_wasm<int32_t> a, const vec_wasm<int32_t> b) {
+  const v128_t a20 = wasm_i32x4_shuffle(a.raw, a.raw, 0, 2, 0, 2);
+  const v128_t b20 = wasm_i32x4_shuffle(b.raw, b.raw, 0, 2, 0, 2);
+  return vec_wasm<int64_t>(wasm_i64x2_extmul_low_i32x4(a20, b20));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> mul_even(
+    const vec_wasm<uint32_t> a, const vec_wasm<uint32_t> b) {
+  const v128_t a20 = wasm_i32x4_shuffle(a.raw, a.raw, 0, 2, 0, 2);
+  const v128_t b20 = wasm_i32x4_shuffle(b.raw, b.raw, 0, 2, 0, 2);
+  return vec_wasm<uint64_t>(wasm_u64x2_extmul_low_u32x4(a20, b20));
+}
+
+// ------------------------------ Floating-point negate
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> neg(const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_neg(v.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> neg(
+    const vec_wasm<double, N> v) {
+  return vec_wasm<double, N>(wasm_f64x2_neg(v.raw));
+}
+
+// ------------------------------ Floating-point mul / div
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator*(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_mul(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator*(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_mul(a.raw, b.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator/(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_div(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator/(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_div(a.raw, b.raw));
+}
+
+// Approximate reciprocal. SIMD128 has no estimate instruction, so this is a
+// (more precise) division.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> approximate_reciprocal(
+    const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_div(wasm_f32x4_splat(1.0f), v.raw));
+}
+
+// ------------------------------ Floating-point multiply-add variants
+
+// SIMD128 has no FMA; these are separate multiply and add.
+
+// Returns mul * x + add
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> mul_add(
+    const vec_wasm<float, N> mul, const vec_wasm<float, N> x,
+    const vec_wasm<float, N> add) {
+  return mul * x + add;
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> mul_add(
+    const vec_wasm<double, N> mul, const vec_wasm<double, N> x,
+    const vec_wasm<double, N> add) {
+  return mul * x + add;
+}
+
+// Returns add - mul * x
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> nmul_add(
+    const vec_wasm<float, N> mul, const vec_wasm<float, N> x,
+    const vec_wasm<float, N> add) {
+  return add - mul * x;
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> nmul_add(
+    const vec_wasm<double, N> mul, const vec_wasm<double, N> x,
+    const vec_wasm<double, N> add) {
+  return add - mul * x;
+}
+
+// Slightly more expensive on ARM (extra negate)
+namespace ext {
+
+// Returns mul * x - sub
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> mul_subtract(
+    const vec_wasm<float, N> mul, const vec_wasm<float, N> x,
+    const vec_wasm<float, N> sub) {
+  return mul * x - sub;
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> mul_subtract(
+    const vec_wasm<double, N> mul, const vec_wasm<double, N> x,
+    const vec_wasm<double, N> sub) {
+  return mul * x - sub;
+}
+
+// Returns -mul * x - sub
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> nmul_subtract(
+    const vec_wasm<float, N> mul, const vec_wasm<float, N> x,
+    const vec_wasm<float, N> sub) {
+  return neg(mul) * x - sub;
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> nmul_subtract(
+    const vec_wasm<double, N> mul, const vec_wasm<double, N> x,
+    const vec_wasm<double, N> sub) {
+  return neg(mul) * x - sub;
+}
+
+}  // namespace ext
+
+// ------------------------------ Floating-point square root
+
+// Full precision square root
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> sqrt(const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_sqrt(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> sqrt(
+    const vec_wasm<double, N> v) {
+  return vec_wasm<double, N>(wasm_f64x2_sqrt(v.raw));
+}
+
+// Approximate reciprocal square root (also computed at full precision).
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> approximate_reciprocal_sqrt(
+    const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(
+      wasm_f32x4_div(wasm_f32x4_splat(1.0f), wasm_f32x4_sqrt(v.raw)));
+}
+
+// ------------------------------ Floating-point rounding
+
+// Toward nearest integer, ties to even
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> round(
+    const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_nearest(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> round(
+    const vec_wasm<double, N> v) {
+  return vec_wasm<double, N>(wasm_f64x2_nearest(v.raw));
+}
+
+// Toward zero, aka truncate
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> trunc(
+    const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_trunc(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> trunc(
+    const vec_wasm<double, N> v) {
+  return vec_wasm<double, N>(wasm_f64x2_trunc(v.raw));
+}
+
+// Toward +infinity, aka ceiling
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> ceil(const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_ceil(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> ceil(
+    const vec_wasm<double, N> v) {
+  return vec_wasm<double, N>(wasm_f64x2_ceil(v.raw));
+}
+
+// Toward -infinity, aka floor
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> floor(
+    const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_floor(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> floor(
+    const vec_wasm<double, N> v) {
+  return vec_wasm<double, N>(wasm_f64x2_floor(v.raw));
+}
+
+// ================================================== COMPARE
+
+// Comparisons fill a lane with 1-bits if the condition is true, else 0.
+
+// ------------------------------ Equality
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> operator==(
+    const vec_wasm<uint8_t, N> a, const vec_wasm<uint8_t, N> b) {
+  return vec_wasm<uint8_t, N>(wasm_i8x16_eq(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> operator==(
+    const vec_wasm<uint16_t, N> a, const vec_wasm<uint16_t, N> b) {
+  return vec_wasm<uint16_t, N>(wasm_i16x8_eq(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t, N> operator==(
+    const vec_wasm<uint32_t, N> a, const vec_wasm<uint32_t, N> b) {
+  return vec_wasm<uint32_t, N>(wasm_i32x4_eq(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t, N> operator==(
+    const vec_wasm<uint64_t, N> a, const vec_wasm<uint64_t, N> b) {
+  return vec_wasm<uint64_t, N>(wasm_i64x2_eq(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> operator==(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_eq(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> operator==(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_eq(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> operator==(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_eq(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> operator==(
+    const vec_wasm<int64_t, N> a, const vec_wasm<int64_t, N> b) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_eq(a.raw, b.raw));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator==(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_eq(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator==(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_eq(a.raw, b.raw));
+}
+
+// ------------------------------ Strict inequality
+
+// Signed/float <
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> operator<(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_lt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> operator<(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_lt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> operator<(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_lt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> operator<(
+    const vec_wasm<int64_t, N> a, const vec_wasm<int64_t, N> b) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_lt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator<(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_lt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator<(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_lt(a.raw, b.raw));
+}
+
+// Signed/float >
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> operator>(
+    const vec_wasm<int8_t, N> a, const vec_wasm<int8_t, N> b) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_gt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> operator>(
+    const vec_wasm<int16_t, N> a, const vec_wasm<int16_t, N> b) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_gt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> operator>(
+    const vec_wasm<int32_t, N> a, const vec_wasm<int32_t, N> b) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_gt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t, N> operator>(
+    const vec_wasm<int64_t, N> a, const vec_wasm<int64_t, N> b) {
+  return vec_wasm<int64_t, N>(wasm_i64x2_gt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator>(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_gt(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator>(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_gt(a.raw, b.raw));
+}
+
+// ------------------------------ Weak inequality
+
+// Float <= >=
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator<=(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_le(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator<=(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_le(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> operator>=(
+    const vec_wasm<float, N> a, const vec_wasm<float, N> b) {
+  return vec_wasm<float, N>(wasm_f32x4_ge(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> operator>=(
+    const vec_wasm<double, N> a, const vec_wasm<double, N> b) {
+  return vec_wasm<double, N>(wasm_f64x2_ge(a.raw, b.raw));
+}
+
+// ================================================== LOGICAL
+
+// ------------------------------ Bitwise AND
+
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> operator&(const vec_wasm<T, N> a,
+                                                    const vec_wasm<T, N> b) {
+  return vec_wasm<T, N>(wasm_v128_and(a.raw, b.raw));
+}
+
+// ------------------------------ Bitwise AND-NOT
+
+// Returns ~not_mask & mask.
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> andnot(const vec_wasm<T, N> not_mask,
+                                                 const vec_wasm<T, N> mask) {
+  return vec_wasm<T, N>(wasm_v128_andnot(mask.raw, not_mask.raw));
+}
+
+// ------------------------------ Bitwise OR
+
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> operator|(const vec_wasm<T, N> a,
+                                                    const vec_wasm<T, N> b) {
+  return vec_wasm<T, N>(wasm_v128_or(a.raw, b.raw));
+}
+
+// ------------------------------ Bitwise XOR
+
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> operator^(const vec_wasm<T, N> a,
+                                                    const vec_wasm<T, N> b) {
+  return vec_wasm<T, N>(wasm_v128_xor(a.raw, b.raw));
+}
+
+// ------------------------------ Select/blend
+
+// Returns a mask for use by select(). Unlike BLENDVPS, bitselect uses all
+// bits, so the sign must be broadcast.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> condition_from_sign(
+    const vec_wasm<float, N> v) {
+  return vec_wasm<float, N>(wasm_i32x4_shr(v.raw, 31));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double, N> condition_from_sign(
+    const vec_wasm<double, N> v) {
+  return vec_wasm<double, N>(wasm_i64x2_shr(v.raw, 63));
+}
+
+// Returns mask ? b : a. "mask" must either have been returned by
+// selector_from_mask, or callers must ensure its lanes are T(0) or ~T(0).
+template <typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> select(const vec_wasm<T, N> a,
+                                                 const vec_wasm<T, N> b,
+                                                 const vec_wasm<T, N> mask) {
+  return vec_wasm<T, N>(wasm_v128_bitselect(b.raw, a.raw, mask.raw));
+}
+
+// ================================================== MEMORY
+
+// ------------------------------ Load
+
+// SIMD128 loads do not require alignment.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> load(Full<T, WASM>,
+                                            const T* SIMD_RESTRICT aligned) {
+  return vec_wasm<T>(wasm_v128_load(aligned));
+}
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> load_unaligned(
+    Full<T, WASM>, const T* SIMD_RESTRICT p) {
+  return vec_wasm<T>(wasm_v128_load(p));
+}
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, 8 / sizeof(T)> load(
+    Desc<T, 8 / sizeof(T), WASM>, const T* SIMD_RESTRICT p) {
+  return vec_wasm<T, 8 / sizeof(T)>(wasm_v128_load64_zero(p));
+}
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, 4 / sizeof(T)> load(
+    Desc<T, 4 / sizeof(T), WASM>, const T* SIMD_RESTRICT p) {
+  return vec_wasm<T, 4 / sizeof(T)>(wasm_v128_load32_zero(p));
+}
+
+// 128-bit SIMD => nothing to duplicate, same as an unaligned load.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> load_dup128(
+    Full<T, WASM> d, const T* const SIMD_RESTRICT p) {
+  return load_unaligned(d, p);
+}
+
+// ------------------------------ Store
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE void store(const vec_wasm<T> v, Full<T, WASM>,
+                                      T* SIMD_RESTRICT aligned) {
+  wasm_v128_store(aligned, v.raw);
+}
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE void store_unaligned(const vec_wasm<T> v,
+                                                Full<T, WASM>,
+                                                T* SIMD_RESTRICT p) {
+  wasm_v128_store(p, v.raw);
+}
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE void store(const vec_wasm<T, 8 / sizeof(T)> v,
+                                      Desc<T, 8 / sizeof(T), WASM>,
+                                      T* SIMD_RESTRICT p) {
+  wasm_v128_store64_lane(p, v.raw, 0);
+}
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE void store(const vec_wasm<T, 4 / sizeof(T)> v,
+                                      Desc<T, 4 / sizeof(T), WASM>,
+                                      T* SIMD_RESTRICT p) {
+  wasm_v128_store32_lane(p, v.raw, 0);
+}
+
+// ------------------------------ Non-temporal stores
+
+// Same as aligned stores on non-x86.
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE void stream(const vec_wasm<T> v, Full<T, WASM> d,
+                                       T* SIMD_RESTRICT aligned) {
+  store(v, d, aligned);
+}
+
+// ================================================== SWIZZLE
+
+// ------------------------------ Shift vector by constant #bytes
+
+// 0x01..0F, kBytes = 1 => 0x02..0F00
+template <int kBytes, typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> shift_left_bytes(const vec_wasm<T> v) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  // Indices below 16 select bytes of "zero".
+  const v128_t zero = wasm_i32x4_splat(0);
+  return vec_wasm<T>(wasm_i8x16_shuffle(
+      zero, v.raw, 16 - kBytes, 17 - kBytes, 18 - kBytes, 19 - kBytes,
+      20 - kBytes, 21 - kBytes, 22 - kBytes, 23 - kBytes, 24 - kBytes,
+      25 - kBytes, 26 - kBytes, 27 - kBytes, 28 - kBytes, 29 - kBytes,
+      30 - kBytes, 31 - kBytes));
+}
+
+template <int kLanes, typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> shift_left_lanes(const vec_wasm<T> v) {
+  return shift_left_bytes<kLanes * sizeof(T)>(v);
+}
+
+// 0x01..0F, kBytes = 1 => 0x0001..0E
+template <int kBytes, typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> shift_right_bytes(const vec_wasm<T> v) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  // Indices of 16 and above select bytes of "zero".
+  const v128_t zero = wasm_i32x4_splat(0);
+  return vec_wasm<T>(wasm_i8x16_shuffle(
+      v.raw, zero, kBytes + 0, kBytes + 1, kBytes + 2, kBytes + 3, kBytes + 4,
+      kBytes + 5, kBytes + 6, kBytes + 7, kBytes + 8, kBytes + 9, kBytes + 10,
+      kBytes + 11, kBytes + 12, kBytes + 13, kBytes + 14, kBytes + 15));
+}
+
+template <int kLanes, typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> shift_right_lanes(const vec_wasm<T> v) {
+  return shift_right_bytes<kLanes * sizeof(T)>(v);
+}
+
+// ------------------------------ Extract from 2x 128-bit at constant offset
+
+// Extracts 128 bits from <hi, lo> by skipping the least-significant kBytes.
+template <int kBytes, typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> combine_shift_right_bytes(
+    const vec_wasm<T> hi, const vec_wasm<T> lo) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  return vec_wasm<T>(wasm_i8x16_shuffle(
+      lo.raw, hi.raw, kBytes + 0, kBytes + 1, kBytes + 2, kBytes + 3,
+      kBytes + 4, kBytes + 5, kBytes + 6, kBytes + 7, kBytes + 8, kBytes + 9,
+      kBytes + 10, kBytes + 11, kBytes + 12, kBytes + 13, kBytes + 14,
+      kBytes + 15));
+}
+
+// ------------------------------ Broadcast/splat any lane
+
+// Unsigned
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t> broadcast(
+    const vec_wasm<uint16_t> v) {
+  static_assert(0 <= kLane && kLane < 8, "Invalid lane");
+  return vec_wasm<uint16_t>(wasm_i16x8_shuffle(
+      v.raw, v.raw, kLane, kLane, kLane, kLane, kLane, kLane, kLane, kLane));
+}
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> broadcast(
+    const vec_wasm<uint32_t> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  return vec_wasm<uint32_t>(
+      wasm_i32x4_shuffle(v.raw, v.raw, kLane, kLane, kLane, kLane));
+}
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> broadcast(
+    const vec_wasm<uint64_t> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  return vec_wasm<uint64_t>(wasm_i64x2_shuffle(v.raw, v.raw, kLane, kLane));
+}
+
+// Signed
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> broadcast(
+    const vec_wasm<int16_t> v) {
+  static_assert(0 <= kLane && kLane < 8, "Invalid lane");
+  return vec_wasm<int16_t>(wasm_i16x8_shuffle(
+      v.raw, v.raw, kLane, kLane, kLane, kLane, kLane, kLane, kLane, kLane));
+}
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> broadcast(
+    const vec_wasm<int32_t> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  return vec_wasm<int32_t>(
+      wasm_i32x4_shuffle(v.raw, v.raw, kLane, kLane, kLane, kLane));
+}
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> broadcast(
+    const vec_wasm<int64_t> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  return vec_wasm<int64_t>(wasm_i64x2_shuffle(v.raw, v.raw, kLane, kLane));
+}
+
+// Float
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> broadcast(const vec_wasm<float> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  return vec_wasm<float>(
+      wasm_i32x4_shuffle(v.raw, v.raw, kLane, kLane, kLane, kLane));
+}
+template <int kLane>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double> broadcast(
+    const vec_wasm<double> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  return vec_wasm<double>(wasm_i64x2_shuffle(v.raw, v.raw, kLane, kLane));
+}
+
+// ------------------------------ Shuffle bytes with variable indices
+
+// Returns vector of bytes[from[i]]. "from" is also interpreted as bytes:
+// either valid indices in [0, 16) or >= 0x80 to zero the i-th output byte.
+template <typename T, typename TI>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> table_lookup_bytes(
+    const vec_wasm<T> bytes, const vec_wasm<TI> from) {
+  return vec_wasm<T>(wasm_i8x16_swizzle(bytes.raw, from.raw));
+}
+
+// ------------------------------ Hard-coded shuffles
+
+// Notation: let vec_wasm<int32_t> have lanes 3,2,1,0 (0 is least-significant).
+// shuffle_0321 rotates one lane to the right (the previous least-significant
+// lane is now most-significant). These could also be implemented via
+// combine_shift_right_bytes but the shuffle_abcd notation is more convenient.
+
+// Swap 64-bit halves
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> shuffle_1032(
+    const vec_wasm<uint32_t> v) {
+  return vec_wasm<uint32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 2, 3, 0, 1));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> shuffle_1032(
+    const vec_wasm<int32_t> v) {
+  return vec_wasm<int32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 2, 3, 0, 1));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> shuffle_1032(
+    const vec_wasm<float> v) {
+  return vec_wasm<float>(wasm_i32x4_shuffle(v.raw, v.raw, 2, 3, 0, 1));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> shuffle_01(
+    const vec_wasm<uint64_t> v) {
+  return vec_wasm<uint64_t>(wasm_i64x2_shuffle(v.raw, v.raw, 1, 0));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> shuffle_01(
+    const vec_wasm<int64_t> v) {
+  return vec_wasm<int64_t>(wasm_i64x2_shuffle(v.raw, v.raw, 1, 0));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double> shuffle_01(
+    const vec_wasm<double> v) {
+  return vec_wasm<double>(wasm_i64x2_shuffle(v.raw, v.raw, 1, 0));
+}
+
+// Rotate right 32 bits
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> shuffle_0321(
+    const vec_wasm<uint32_t> v) {
+  return vec_wasm<uint32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 1, 2, 3, 0));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> shuffle_0321(
+    const vec_wasm<int32_t> v) {
+  return vec_wasm<int32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 1, 2, 3, 0));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> shuffle_0321(
+    const vec_wasm<float> v) {
+  return vec_wasm<float>(wasm_i32x4_shuffle(v.raw, v.raw, 1, 2, 3, 0));
+}
+// Rotate left 32 bits
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> shuffle_2103(
+    const vec_wasm<uint32_t> v) {
+  return vec_wasm<uint32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 3, 0, 1, 2));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> shuffle_2103(
+    const vec_wasm<int32_t> v) {
+  return vec_wasm<int32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 3, 0, 1, 2));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> shuffle_2103(
+    const vec_wasm<float> v) {
+  return vec_wasm<float>(wasm_i32x4_shuffle(v.raw, v.raw, 3, 0, 1, 2));
+}
+
+// Reverse
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> shuffle_0123(
+    const vec_wasm<uint32_t> v) {
+  return vec_wasm<uint32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 3, 2, 1, 0));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> shuffle_0123(
+    const vec_wasm<int32_t> v) {
+  return vec_wasm<int32_t>(wasm_i32x4_shuffle(v.raw, v.raw, 3, 2, 1, 0));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> shuffle_0123(
+    const vec_wasm<float> v) {
+  return vec_wasm<float>(wasm_i32x4_shuffle(v.raw, v.raw, 3, 2, 1, 0));
+}
+
+// ------------------------------ Permute (runtime variable)
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE permute_wasm<T> set_table_indices(
+    const Full<T, WASM> d, const int32_t* idx) {
+  const Full<uint8_t, WASM> d8;
+  SIMD_ALIGN uint8_t control[d8.N];
+  for (size_t idx_byte = 0; idx_byte < d8.N; ++idx_byte) {
+    const size_t idx_lane = idx_byte / sizeof(T);
+    const size_t mod = idx_byte % sizeof(T);
+    control[idx_byte] = idx[idx_lane] * sizeof(T) + mod;
+  }
+  return permute_wasm<T>{load(d8, control).raw};
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> table_lookup_lanes(
+    const vec_wasm<uint32_t> v, const permute_wasm<uint32_t> idx) {
+  return table_lookup_bytes(v, vec_wasm<uint8_t>(idx.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> table_lookup_lanes(
+    const vec_wasm<int32_t> v, const permute_wasm<int32_t> idx) {
+  return table_lookup_bytes(v, vec_wasm<uint8_t>(idx.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> table_lookup_lanes(
+    const vec_wasm<float> v, const permute_wasm<float> idx) {
+  return table_lookup_bytes(v, vec_wasm<uint8_t>(idx.raw));
+}
+
+// ------------------------------ Interleave lanes
+
+// Interleaves lanes from halves of the 128-bit blocks of "a" (which provides
+// the least-significant lane) and "b". To concatenate two half-width integers
+// into one, use zip_lo/hi instead (also works with scalar).
+
+// Raw helpers shared by interleave_* and zip_*.
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_lo8(const v128_t a,
+                                                 const v128_t b) {
+  return wasm_i8x16_shuffle(a, b, 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6,
+                            22, 7, 23);
+}
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_lo16(const v128_t a,
+                                                  const v128_t b) {
+  return wasm_i16x8_shuffle(a, b, 0, 8, 1, 9, 2, 10, 3, 11);
+}
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_lo32(const v128_t a,
+                                                  const v128_t b) {
+  return wasm_i32x4_shuffle(a, b, 0, 4, 1, 5);
+}
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_lo64(const v128_t a,
+                                                  const v128_t b) {
+  return wasm_i64x2_shuffle(a, b, 0, 2);
+}
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_hi8(const v128_t a,
+                                                 const v128_t b) {
+  return wasm_i8x16_shuffle(a, b, 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29,
+                            14, 30, 15, 31);
+}
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_hi16(const v128_t a,
+                                                  const v128_t b) {
+  return wasm_i16x8_shuffle(a, b, 4, 12, 5, 13, 6, 14, 7, 15);
+}
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_hi32(const v128_t a,
+                                                  const v128_t b) {
+  return wasm_i32x4_shuffle(a, b, 2, 6, 3, 7);
+}
+SIMD_ATTR_WASM SIMD_INLINE v128_t interleave_hi64(const v128_t a,
+                                                  const v128_t b) {
+  return wasm_i64x2_shuffle(a, b, 1, 3);
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t> interleave_lo(
+    const vec_wasm<uint8_t> a, const vec_wasm<uint8_t> b) {
+  return vec_wasm<uint8_t>(interleave_lo8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t> interleave_lo(
+    const vec_wasm<uint16_t> a, const vec_wasm<uint16_t> b) {
+  return vec_wasm<uint16_t>(interleave_lo16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> interleave_lo(
+    const vec_wasm<uint32_t> a, const vec_wasm<uint32_t> b) {
+  return vec_wasm<uint32_t>(interleave_lo32(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> interleave_lo(
+    const vec_wasm<uint64_t> a, const vec_wasm<uint64_t> b) {
+  return vec_wasm<uint64_t>(interleave_lo64(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t> interleave_lo(
+    const vec_wasm<int8_t> a, const vec_wasm<int8_t> b) {
+  return vec_wasm<int8_t>(interleave_lo8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> interleave_lo(
+    const vec_wasm<int16_t> a, const vec_wasm<int16_t> b) {
+  return vec_wasm<int16_t>(interleave_lo16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> interleave_lo(
+    const vec_wasm<int32_t> a, const vec_wasm<int32_t> b) {
+  return vec_wasm<int32_t>(interleave_lo32(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> interleave_lo(
+    const vec_wasm<int64_t> a, const vec_wasm<int64_t> b) {
+  return vec_wasm<int64_t>(interleave_lo64(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> interleave_lo(
+    const vec_wasm<float> a, const vec_wasm<float> b) {
+  return vec_wasm<float>(interleave_lo32(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double> interleave_lo(
+    const vec_wasm<double> a, const vec_wasm<double> b) {
+  return vec_wasm<double>(interleave_lo64(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t> interleave_hi(
+    const vec_wasm<uint8_t> a, const vec_wasm<uint8_t> b) {
+  return vec_wasm<uint8_t>(interleave_hi8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t> interleave_hi(
+    const vec_wasm<uint16_t> a, const vec_wasm<uint16_t> b) {
+  return vec_wasm<uint16_t>(interleave_hi16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> interleave_hi(
+    const vec_wasm<uint32_t> a, const vec_wasm<uint32_t> b) {
+  return vec_wasm<uint32_t>(interleave_hi32(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> interleave_hi(
+    const vec_wasm<uint64_t> a, const vec_wasm<uint64_t> b) {
+  return vec_wasm<uint64_t>(interleave_hi64(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t> interleave_hi(
+    const vec_wasm<int8_t> a, const vec_wasm<int8_t> b) {
+  return vec_wasm<int8_t>(interleave_hi8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> interleave_hi(
+    const vec_wasm<int16_t> a, const vec_wasm<int16_t> b) {
+  return vec_wasm<int16_t>(interleave_hi16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> interleave_hi(
+    const vec_wasm<int32_t> a, const vec_wasm<int32_t> b) {
+  return vec_wasm<int32_t>(interleave_hi32(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> interleave_hi(
+    const vec_wasm<int64_t> a, const vec_wasm<int64_t> b) {
+  return vec_wasm<int64_t>(interleave_hi64(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float> interleave_hi(
+    const vec_wasm<float> a, const vec_wasm<float> b) {
+  return vec_wasm<float>(interleave_hi32(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<double> interleave_hi(
+    const vec_wasm<double> a, const vec_wasm<double> b) {
+  return vec_wasm<double>(interleave_hi64(a.raw, b.raw));
+}
+
+// ------------------------------ Zip lanes
+
+// Same as interleave_*, except that the return lanes are double-width integers;
+// this is necessary because the single-lane scalar cannot return two values.
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t> zip_lo(
+    const vec_wasm<uint8_t> a, const vec_wasm<uint8_t> b) {
+  return vec_wasm<uint16_t>(interleave_lo8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> zip_lo(
+    const vec_wasm<uint16_t> a, const vec_wasm<uint16_t> b) {
+  return vec_wasm<uint32_t>(interleave_lo16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> zip_lo(
+    const vec_wasm<uint32_t> a, const vec_wasm<uint32_t> b) {
+  return vec_wasm<uint64_t>(interleave_lo32(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> zip_lo(const vec_wasm<int8_t> a,
+                                                    const vec_wasm<int8_t> b) {
+  return vec_wasm<int16_t>(interleave_lo8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> zip_lo(const vec_wasm<int16_t> a,
+                                                    const vec_wasm<int16_t> b) {
+  return vec_wasm<int32_t>(interleave_lo16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> zip_lo(const vec_wasm<int32_t> a,
+                                                    const vec_wasm<int32_t> b) {
+  return vec_wasm<int64_t>(interleave_lo32(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t> zip_hi(
+    const vec_wasm<uint8_t> a, const vec_wasm<uint8_t> b) {
+  return vec_wasm<uint16_t>(interleave_hi8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> zip_hi(
+    const vec_wasm<uint16_t> a, const vec_wasm<uint16_t> b) {
+  return vec_wasm<uint32_t>(interleave_hi16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> zip_hi(
+    const vec_wasm<uint32_t> a, const vec_wasm<uint32_t> b) {
+  return vec_wasm<uint64_t>(interleave_hi32(a.raw, b.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> zip_hi(const vec_wasm<int8_t> a,
+                                                    const vec_wasm<int8_t> b) {
+  return vec_wasm<int16_t>(interleave_hi8(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> zip_hi(const vec_wasm<int16_t> a,
+                                                    const vec_wasm<int16_t> b) {
+  return vec_wasm<int32_t>(interleave_hi16(a.raw, b.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> zip_hi(const vec_wasm<int32_t> a,
+                                                    const vec_wasm<int32_t> b) {
+  return vec_wasm<int64_t>(interleave_hi32(a.raw, b.raw));
+}
+
+// ------------------------------ Parts
+
+// Returns a part with value "t".
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, 1> set_part(Desc<T, 1, WASM> d,
+                                                   const T t) {
+  return set1(d, t);
+}
+
+// Gets the single value stored in a vector/part.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE uint16_t get_part(Desc<uint16_t, 1, WASM>,
+                                             const vec_wasm<uint16_t, N> v) {
+  return static_cast<uint16_t>(wasm_u16x8_extract_lane(v.raw, 0));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE int16_t get_part(Desc<int16_t, 1, WASM>,
+                                            const vec_wasm<int16_t, N> v) {
+  return static_cast<int16_t>(wasm_i16x8_extract_lane(v.raw, 0));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE uint32_t get_part(Desc<uint32_t, 1, WASM>,
+                                             const vec_wasm<uint32_t, N> v) {
+  return static_cast<uint32_t>(wasm_i32x4_extract_lane(v.raw, 0));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE int32_t get_part(Desc<int32_t, 1, WASM>,
+                                            const vec_wasm<int32_t, N> v) {
+  return wasm_i32x4_extract_lane(v.raw, 0);
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE float get_part(Desc<float, 1, WASM>,
+                                          const vec_wasm<float, N> v) {
+  return wasm_f32x4_extract_lane(v.raw, 0);
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE uint64_t get_part(Desc<uint64_t, 1, WASM>,
+                                             const vec_wasm<uint64_t, N> v) {
+  return static_cast<uint64_t>(wasm_i64x2_extract_lane(v.raw, 0));
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE int64_t get_part(Desc<int64_t, 1, WASM>,
+                                            const vec_wasm<int64_t, N> v) {
+  return wasm_i64x2_extract_lane(v.raw, 0);
+}
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE double get_part(Desc<double, 1, WASM>,
+                                           const vec_wasm<double, N> v) {
+  return wasm_f64x2_extract_lane(v.raw, 0);
+}
+
+// Returns part of a vector (unspecified whether upper or lower).
+template <typename T, size_t N, size_t VN>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, N> any_part(Desc<T, N, WASM>,
+                                                   const vec_wasm<T, VN> v) {
+  return vec_wasm<T, N>(v.raw);
+}
+
+// Returns full vector with the given part's lane broadcasted. Note that
+// callers cannot use broadcast directly because part lane order is undefined.
+template <int kLane, typename T, size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> broadcast_part(Full<T, WASM>,
+                                                      const vec_wasm<T, N> v) {
+  static_assert(0 <= kLane && kLane < N, "Invalid lane");
+  return broadcast<kLane>(vec_wasm<T>(v.raw));
+}
+
+// Returns upper/lower half of a vector.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, 8 / sizeof(T)> get_half(
+    Lower, const vec_wasm<T> v) {
+  return vec_wasm<T, 8 / sizeof(T)>(v.raw);
+}
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, 8 / sizeof(T)> lower_half(
+    const vec_wasm<T> v) {
+  return get_half(Lower(), v);
+}
+
+// These copy hi into lo.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, 8 / sizeof(T)> get_half(
+    Upper, const vec_wasm<T> v) {
+  return vec_wasm<T, 8 / sizeof(T)>(wasm_i64x2_shuffle(v.raw, v.raw, 1, 1));
+}
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T, 8 / sizeof(T)> upper_half(
+    const vec_wasm<T> v) {
+  return get_half(Upper(), v);
+}
+
+// ------------------------------ Blocks
+
+// hiH,hiL loH,loL |-> hiL,loL (= lower halves)
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> concat_lo_lo(const vec_wasm<T> hi,
+                                                    const vec_wasm<T> lo) {
+  return vec_wasm<T>(wasm_i64x2_shuffle(lo.raw, hi.raw, 0, 2));
+}
+
+// hiH,hiL loH,loL |-> hiH,loH (= upper halves)
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> concat_hi_hi(const vec_wasm<T> hi,
+                                                    const vec_wasm<T> lo) {
+  return vec_wasm<T>(wasm_i64x2_shuffle(lo.raw, hi.raw, 1, 3));
+}
+
+// hiH,hiL loH,loL |-> hiL,loH (= inner halves)
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> concat_lo_hi(const vec_wasm<T> hi,
+                                                    const vec_wasm<T> lo) {
+  return vec_wasm<T>(wasm_i64x2_shuffle(lo.raw, hi.raw, 1, 2));
+}
+
+// hiH,hiL loH,loL |-> hiH,loL (= outer halves)
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> concat_hi_lo(const vec_wasm<T> hi,
+                                                    const vec_wasm<T> lo) {
+  return vec_wasm<T>(wasm_i64x2_shuffle(lo.raw, hi.raw, 0, 3));
+}
+
+// ------------------------------ Odd/even lanes
+
+// Even lanes are taken from "b", odd lanes from "a".
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> odd_even_impl(char (&sizeof_t)[1],
+                                                     const vec_wasm<T> a,
+                                                     const vec_wasm<T> b) {
+  return vec_wasm<T>(wasm_i8x16_shuffle(a.raw, b.raw, 16, 1, 18, 3, 20, 5, 22,
+                                        7, 24, 9, 26, 11, 28, 13, 30, 15));
+}
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> odd_even_impl(char (&sizeof_t)[2],
+                                                     const vec_wasm<T> a,
+                                                     const vec_wasm<T> b) {
+  return vec_wasm<T>(
+      wasm_i16x8_shuffle(a.raw, b.raw, 8, 1, 10, 3, 12, 5, 14, 7));
+}
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> odd_even_impl(char (&sizeof_t)[4],
+                                                     const vec_wasm<T> a,
+                                                     const vec_wasm<T> b) {
+  return vec_wasm<T>(wasm_i32x4_shuffle(a.raw, b.raw, 4, 1, 6, 3));
+}
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> odd_even_impl(char (&sizeof_t)[8],
+                                                     const vec_wasm<T> a,
+                                                     const vec_wasm<T> b) {
+  return vec_wasm<T>(wasm_i64x2_shuffle(a.raw, b.raw, 2, 1));
+}
+
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> odd_even(const vec_wasm<T> a,
+                                                const vec_wasm<T> b) {
+  char sizeof_t[sizeof(T)];
+  return odd_even_impl(sizeof_t, a, b);
+}
+
+// ================================================== CONVERT
+
+// ------------------------------ Promotions (part w/ narrow lanes -> full)
+
+// Unsigned: zero-extend.
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t> convert_to(
+    Full<uint16_t, WASM>, const vec_wasm<uint8_t, 8> v) {
+  return vec_wasm<uint16_t>(wasm_u16x8_extend_low_u8x16(v.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> convert_to(
+    Full<uint32_t, WASM>, const vec_wasm<uint8_t, 4> v) {
+  return vec_wasm<uint32_t>(
+      wasm_u32x4_extend_low_u16x8(wasm_u16x8_extend_low_u8x16(v.raw)));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> convert_to(
+    Full<int16_t, WASM>, const vec_wasm<uint8_t, 8> v) {
+  return vec_wasm<int16_t>(wasm_u16x8_extend_low_u8x16(v.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> convert_to(
+    Full<int32_t, WASM>, const vec_wasm<uint8_t, 4> v) {
+  return vec_wasm<int32_t>(
+      wasm_u32x4_extend_low_u16x8(wasm_u16x8_extend_low_u8x16(v.raw)));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> convert_to(
+    Full<uint32_t, WASM>, const vec_wasm<uint16_t, 4> v) {
+  return vec_wasm<uint32_t>(wasm_u32x4_extend_low_u16x8(v.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> convert_to(
+    Full<int32_t, WASM>, const vec_wasm<uint16_t, 4> v) {
+  return vec_wasm<int32_t>(wasm_u32x4_extend_low_u16x8(v.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> convert_to(
+    Full<uint64_t, WASM>, const vec_wasm<uint32_t, 2> v) {
+  return vec_wasm<uint64_t>(wasm_u64x2_extend_low_u32x4(v.raw));
+}
+
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint32_t> u32_from_u8(
+    const vec_wasm<uint8_t> v) {
+  return vec_wasm<uint32_t>(
+      wasm_u32x4_extend_low_u16x8(wasm_u16x8_extend_low_u8x16(v.raw)));
+}
+
+// Signed: replicate sign bit.
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> convert_to(
+    Full<int16_t, WASM>, const vec_wasm<int8_t, 8> v) {
+  return vec_wasm<int16_t>(wasm_i16x8_extend_low_i8x16(v.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> convert_to(
+    Full<int32_t, WASM>, const vec_wasm<int8_t, 4> v) {
+  return vec_wasm<int32_t>(
+      wasm_i32x4_extend_low_i16x8(wasm_i16x8_extend_low_i8x16(v.raw)));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t> convert_to(
+    Full<int32_t, WASM>, const vec_wasm<int16_t, 4> v) {
+  return vec_wasm<int32_t>(wasm_i32x4_extend_low_i16x8(v.raw));
+}
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int64_t> convert_to(
+    Full<int64_t, WASM>, const vec_wasm<int32_t, 2> v) {
+  return vec_wasm<int64_t>(wasm_i64x2_extend_low_i32x4(v.raw));
+}
+
+// ------------------------------ Demotions (full -> part w/ narrow lanes)
+
+// As with PACKUS, the u8 narrowing treats its i16 input as signed.
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t, N> convert_to(
+    Part<uint16_t, N, WASM>, const vec_wasm<int32_t, N> v) {
+  return vec_wasm<uint16_t, N>(wasm_u16x8_narrow_i32x4(v.raw, v.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> convert_to(
+    Part<uint8_t, N, WASM>, const vec_wasm<int32_t> v) {
+  const v128_t u16 = wasm_u16x8_narrow_i32x4(v.raw, v.raw);
+  return vec_wasm<uint8_t, N>(wasm_u8x16_narrow_i16x8(u16, u16));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, N> convert_to(
+    Part<uint8_t, N, WASM>, const vec_wasm<int16_t> v) {
+  return vec_wasm<uint8_t, N>(wasm_u8x16_narrow_i16x8(v.raw, v.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t, N> convert_to(
+    Part<int16_t, N, WASM>, const vec_wasm<int32_t> v) {
+  return vec_wasm<int16_t, N>(wasm_i16x8_narrow_i32x4(v.raw, v.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> convert_to(
+    Part<int8_t, N, WASM>, const vec_wasm<int32_t> v) {
+  const v128_t i16 = wasm_i16x8_narrow_i32x4(v.raw, v.raw);
+  return vec_wasm<int8_t, N>(wasm_i8x16_narrow_i16x8(i16, i16));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int8_t, N> convert_to(
+    Part<int8_t, N, WASM>, const vec_wasm<int16_t> v) {
+  return vec_wasm<int8_t, N>(wasm_i8x16_narrow_i16x8(v.raw, v.raw));
+}
+
+// For already range-limited input [0, 255].
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint8_t, 4> u8_from_u32(
+    const vec_wasm<uint32_t> v) {
+  // Replicate bytes into all 32 bit lanes for any_part.
+  return vec_wasm<uint8_t, 4>(wasm_i8x16_shuffle(
+      v.raw, v.raw, 0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12));
+}
+
+// ------------------------------ Convert i32 <=> f32
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<float, N> convert_to(
+    Part<float, N, WASM>, const vec_wasm<int32_t, N> v) {
+  return vec_wasm<float, N>(wasm_f32x4_convert_i32x4(v.raw));
+}
+// Truncates (rounds toward zero). Out of range inputs saturate.
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> convert_to(
+    Part<int32_t, N, WASM>, const vec_wasm<float, N> v) {
+  return vec_wasm<int32_t, N>(wasm_i32x4_trunc_sat_f32x4(v.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int32_t, N> nearest_int(
+    const vec_wasm<float, N> v) {
+  return vec_wasm<int32_t, N>(
+      wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_nearest(v.raw)));
+}
+
+// ================================================== MISC
+
+// (No aes_round: SIMD128 lacks AES instructions.)
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+// ------------------------------ movemask
+
+// Returns a bit array of the most significant bit of each byte in "v", i.e.
+// sum_i=0..15 of (v[i] >> 7) << i; v[0] is the least-significant byte of "v".
+// This is useful for testing/branching based on comparison results.
+SIMD_ATTR_WASM SIMD_INLINE uint32_t movemask(const vec_wasm<uint8_t> v) {
+  return wasm_i8x16_bitmask(v.raw);
+}
+
+// Returns the most significant bit of each float/double lane (see above).
+SIMD_ATTR_WASM SIMD_INLINE uint32_t movemask(const vec_wasm<float> v) {
+  return wasm_i32x4_bitmask(v.raw);
+}
+SIMD_ATTR_WASM SIMD_INLINE uint32_t movemask(const vec_wasm<double> v) {
+  return wasm_i64x2_bitmask(v.raw);
+}
+
+// ------------------------------ all_zero
+
+// Returns whether all lanes are equal to zero. Supported for all integer V.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE bool all_zero(const vec_wasm<T> v) {
+  return !wasm_v128_any_true(v.raw);
+}
+
+// ------------------------------ minpos
+
+// Broadcasts the minimum u16 lane into all lanes.
+SIMD_ATTR_WASM SIMD_INLINE v128_t min_of_u16_lanes(const v128_t v) {
+  const v128_t m4 = wasm_u16x8_min(v, wasm_i64x2_shuffle(v, v, 1, 0));
+  const v128_t m2 = wasm_u16x8_min(m4, wasm_i32x4_shuffle(m4, m4, 1, 0, 3, 2));
+  return wasm_u16x8_min(m2,
+                        wasm_i16x8_shuffle(m2, m2, 1, 0, 3, 2, 5, 4, 7, 6));
+}
+
+// Returns index and min value in lanes 1 and 0; other lanes are zero. As with
+// PHMINPOSUW, the lowest index wins if several lanes are minimal.
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint16_t> minpos(
+    const vec_wasm<uint16_t> v) {
+  const v128_t min_value = min_of_u16_lanes(v.raw);
+  const v128_t is_min = wasm_i16x8_eq(v.raw, min_value);
+  // Indices of lanes that are not minimal become 0xFFFF and thus lose.
+  const v128_t index = min_of_u16_lanes(wasm_v128_or(
+      wasm_i16x8_make(0, 1, 2, 3, 4, 5, 6, 7), wasm_v128_not(is_min)));
+  const v128_t both = interleave_lo16(min_value, index);
+  return vec_wasm<uint16_t>(wasm_v128_and(both, wasm_i32x4_make(-1, 0, 0, 0)));
+}
+
+// ------------------------------ Horizontal sum (reduction)
+
+// Returns 64-bit sums of 8-byte groups.
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<uint64_t> sums_of_u8x8(
+    const vec_wasm<uint8_t> v) {
+  const v128_t sums16 = wasm_u16x8_extadd_pairwise_u8x16(v.raw);
+  const v128_t sums32 = wasm_u32x4_extadd_pairwise_u16x8(sums16);
+  // Adds the upper to the lower u32 of each u64.
+  const v128_t lo = wasm_v128_and(sums32, wasm_i64x2_splat(0xFFFFFFFF));
+  return vec_wasm<uint64_t>(wasm_i64x2_add(lo, wasm_u64x2_shr(sums32, 32)));
+}
+
+// Returns N sums of differences of byte quadruplets, starting from byte offset
+// i = [0, N) in window (11 consecutive bytes) and idx_ref * 4 in ref.
+template <int idx_ref>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<int16_t> mpsadbw(
+    const vec_wasm<uint8_t> window, const vec_wasm<uint8_t> ref) {
+  static_assert(0 <= idx_ref && idx_ref < 4, "Invalid idx_ref");
+  constexpr int kR = idx_ref * 4;
+  // Pairs of adjacent window bytes starting at i and i + 2, and the matching
+  // reference byte pairs, so that each u16 lane accumulates one offset i.
+  const v128_t w01 = wasm_i8x16_shuffle(window.raw, window.raw, 0, 1, 1, 2, 2,
+                                        3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8);
+  const v128_t w23 = wasm_i8x16_shuffle(window.raw, window.raw, 2, 3, 3, 4, 4,
+                                        5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10);
+  const v128_t r01 = wasm_i8x16_shuffle(
+      ref.raw, ref.raw, kR, kR + 1, kR, kR + 1, kR, kR + 1, kR, kR + 1, kR,
+      kR + 1, kR, kR + 1, kR, kR + 1, kR, kR + 1);
+  const v128_t r23 = wasm_i8x16_shuffle(
+      ref.raw, ref.raw, kR + 2, kR + 3, kR + 2, kR + 3, kR + 2, kR + 3, kR + 2,
+      kR + 3, kR + 2, kR + 3, kR + 2, kR + 3, kR + 2, kR + 3, kR + 2, kR + 3);
+  // |a - b| for u8 via two saturating subtractions.
+  const v128_t ad01 =
+      wasm_v128_or(wasm_u8x16_sub_sat(w01, r01), wasm_u8x16_sub_sat(r01, w01));
+  const v128_t ad23 =
+      wasm_v128_or(wasm_u8x16_sub_sat(w23, r23), wasm_u8x16_sub_sat(r23, w23));
+  return vec_wasm<int16_t>(
+      wasm_i16x8_add(wasm_u16x8_extadd_pairwise_u8x16(ad01),
+                     wasm_u16x8_extadd_pairwise_u8x16(ad23)));
+}
+
+// For u32/i32/f32.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> horz_sum_impl(char (&sizeof_t)[4],
+                                                     const vec_wasm<T> v3210) {
+  const vec_wasm<T> v1032 = shuffle_1032(v3210);
+  const vec_wasm<T> v31_20_31_20 = v3210 + v1032;
+  const vec_wasm<T> v20_31_20_31 = shuffle_0321(v31_20_31_20);
+  return v20_31_20_31 + v31_20_31_20;
+}
+
+// For u64/i64/f64.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> horz_sum_impl(char (&sizeof_t)[8],
+                                                     const vec_wasm<T> v10) {
+  const vec_wasm<T> v01 = shuffle_01(v10);
+  return v10 + v01;
+}
+
+// Supported for u/i/f 32/64. Returns the sum in each lane.
+template <typename T>
+SIMD_ATTR_WASM SIMD_INLINE vec_wasm<T> sum_of_lanes(const vec_wasm<T> v) {
+  char sizeof_t[sizeof(T)];
+  return horz_sum_impl(sizeof_t, v);
+}
+
+}  // namespace ext
+
+#endif  // SIMD_DEPS
@@ -0,0 +1,2308 @@
+// Copyright 2017 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// 512-bit AVX-512 (F, VL, DQ, BW, i.e. Skylake-SP) vectors and operations.
+// (No include guard nor namespace: this is included from the middle of simd.h.)
+
+// WARNING: as with AVX2, most operations do not cross 128-bit block
+// boundaries. In particular, "broadcast", pack and zip behavior may be
+// surprising. Comparisons return vectors rather than mask registers so that
+// callers can use the same code for all targets.
+
+// Avoid compile errors when generating deps.mk.
+#if SIMD_DEPS == 0
+
+// GCC 12 warns about the self-initialization in its own _mm512_undefined_*,
+// which many AVX-512 intrinsics use internally.
+SIMD_DIAGNOSTICS(push)
+SIMD_DIAGNOSTICS_OFF(disable : 4700, ignored "-Wuninitialized")
+
+template <typename T>
+struct raw_avx512 {
+  using type = __m512i;
+};
+template <>
+struct raw_avx512<float> {
+  using type = __m512;
+};
+template <>
+struct raw_avx512<double> {
+  using type = __m512d;
+};
+
+// Returned by set_table_indices for use by table_lookup_lanes.
+template <typename T>
+struct permute_avx512 {
+  __m512i raw;
+};
+
+template <typename T, size_t N = AVX512::NumLanes<T>()>
+class vec_avx512 {
+  using Raw = typename raw_avx512<T>::type;
+
+ public:
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512() {}
+  vec_avx512(const vec_avx512&) = default;
+  vec_avx512& operator=(const vec_avx512&) = default;
+  SIMD_ATTR_AVX512 SIMD_INLINE explicit vec_avx512(const Raw raw) : raw(raw) {}
+
+  // Compound assignment. Only usable if there is a corresponding non-member
+  // binary operator overload. For example, only f32 and f64 support division.
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512& operator*=(const vec_avx512 other) {
+    return *this = (*this * other);
+  }
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512& operator/=(const vec_avx512 other) {
+    return *this = (*this / other);
+  }
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512& operator+=(const vec_avx512 other) {
+    return *this = (*this + other);
+  }
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512& operator-=(const vec_avx512 other) {
+    return *this = (*this - other);
+  }
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512& operator&=(const vec_avx512 other) {
+    return *this = (*this & other);
+  }
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512& operator|=(const vec_avx512 other) {
+    return *this = (*this | other);
+  }
+  SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512& operator^=(const vec_avx512 other) {
+    return *this = (*this ^ other);
+  }
+
+  Raw raw;
+};
+
+template <typename T, size_t N>
+struct VecT<T, N, AVX512> {
+  using type = vec_avx512<T, N>;
+};
+
+using u8x64 = vec_avx512<uint8_t, 64>;
+using u16x32 = vec_avx512<uint16_t, 32>;
+using u32x16 = vec_avx512<uint32_t, 16>;
+using u64x8 = vec_avx512<uint64_t, 8>;
+using i8x64 = vec_avx512<int8_t, 64>;
+using i16x32 = vec_avx512<int16_t, 32>;
+using i32x16 = vec_avx512<int32_t, 16>;
+using i64x8 = vec_avx512<int64_t, 8>;
+using f32x16 = vec_avx512<float, 16>;
+using f64x8 = vec_avx512<double, 8>;
+
+// ------------------------------ Cast
+
+SIMD_ATTR_AVX512 SIMD_INLINE __m512i BitCastToInteger(__m512i v) { return v; }
+SIMD_ATTR_AVX512 SIMD_INLINE __m512i BitCastToInteger(__m512 v) {
+  return _mm512_castps_si512(v);
+}
+SIMD_ATTR_AVX512 SIMD_INLINE __m512i BitCastToInteger(__m512d v) {
+  return _mm512_castpd_si512(v);
+}
+
+// cast_to_u8
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> cast_to_u8(
+    Desc<uint8_t, N, AVX512>, vec_avx512<T, N / sizeof(T)> v) {
+  return vec_avx512<uint8_t, N>(BitCastToInteger(v.raw));
+}
+
+// Cannot rely on function overloading because return types differ.
+template <typename T>
+struct BitCastFromIntegerAVX512 {
+  SIMD_ATTR_AVX512 SIMD_INLINE __m512i operator()(__m512i v) { return v; }
+};
+template <>
+struct BitCastFromIntegerAVX512<float> {
+  SIMD_ATTR_AVX512 SIMD_INLINE __m512 operator()(__m512i v) {
+    return _mm512_castsi512_ps(v);
+  }
+};
+template <>
+struct BitCastFromIntegerAVX512<double> {
+  SIMD_ATTR_AVX512 SIMD_INLINE __m512d operator()(__m512i v) {
+    return _mm512_castsi512_pd(v);
+  }
+};
+
+// cast_u8_to
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> cast_u8_to(
+    Desc<T, N, AVX512>, vec_avx512<uint8_t, N * sizeof(T)> v) {
+  return vec_avx512<T, N>(BitCastFromIntegerAVX512<T>()(v.raw));
+}
+
+// cast_to
+template <typename T, size_t N, typename FromT>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> cast_to(
+    Desc<T, N, AVX512> d,
+    vec_avx512<FromT, N * sizeof(T) / sizeof(FromT)> v) {
+  const auto u8 = cast_to_u8(Desc<uint8_t, N * sizeof(T), AVX512>(), v);
+  return cast_u8_to(d, u8);
+}
+
+// ------------------------------ Set
+
+// Returns an all-zero vector.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> setzero(Desc<T, N, AVX512>) {
+  return vec_avx512<T, N>(_mm512_setzero_si512());
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> setzero(
+    Desc<float, N, AVX512>) {
+  return vec_avx512<float, N>(_mm512_setzero_ps());
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> setzero(
+    Desc<double, N, AVX512>) {
+  return vec_avx512<double, N>(_mm512_setzero_pd());
+}
+
+template <typename T, size_t N, typename T2>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> iota(Desc<T, N, AVX512> d,
+                                                   const T2 first) {
+  SIMD_ALIGN T lanes[N];
+  for (size_t i = 0; i < N; ++i) {
+    lanes[i] = first + i;
+  }
+  return load(d, lanes);
+}
+
+// Returns a vector with all lanes set to "t".
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> set1(
+    Desc<uint8_t, N, AVX512>, const uint8_t t) {
+  return vec_avx512<uint8_t, N>(_mm512_set1_epi8(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> set1(
+    Desc<uint16_t, N, AVX512>, const uint16_t t) {
+  return vec_avx512<uint16_t, N>(_mm512_set1_epi16(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> set1(
+    Desc<uint32_t, N, AVX512>, const uint32_t t) {
+  return vec_avx512<uint32_t, N>(_mm512_set1_epi32(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> set1(
+    Desc<uint64_t, N, AVX512>, const uint64_t t) {
+  return vec_avx512<uint64_t, N>(_mm512_set1_epi64(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> set1(
+    Desc<int8_t, N, AVX512>, const int8_t t) {
+  return vec_avx512<int8_t, N>(_mm512_set1_epi8(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> set1(
+    Desc<int16_t, N, AVX512>, const int16_t t) {
+  return vec_avx512<int16_t, N>(_mm512_set1_epi16(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> set1(
+    Desc<int32_t, N, AVX512>, const int32_t t) {
+  return vec_avx512<int32_t, N>(_mm512_set1_epi32(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> set1(
+    Desc<int64_t, N, AVX512>, const int64_t t) {
+  return vec_avx512<int64_t, N>(_mm512_set1_epi64(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> set1(Desc<float, N, AVX512>,
+                                                       const float t) {
+  return vec_avx512<float, N>(_mm512_set1_ps(t));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> set1(
+    Desc<double, N, AVX512>, const double t) {
+  return vec_avx512<double, N>(_mm512_set1_pd(t));
+}
+
+SIMD_DIAGNOSTICS(push)
+SIMD_DIAGNOSTICS_OFF(disable : 4700, ignored "-Wuninitialized")
+
+// Returns a vector with uninitialized elements.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> undefined(Desc<T, N, AVX512>) {
+#ifdef __clang__
+  return vec_avx512<T, N>(_mm512_undefined_epi32());
+#else
+  __m512i raw;
+  return vec_avx512<T, N>(raw);
+#endif
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> undefined(
+    Desc<float, N, AVX512>) {
+#ifdef __clang__
+  return vec_avx512<float, N>(_mm512_undefined_ps());
+#else
+  __m512 raw;
+  return vec_avx512<float, N>(raw);
+#endif
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> undefined(
+    Desc<double, N, AVX512>) {
+#ifdef __clang__
+  return vec_avx512<double, N>(_mm512_undefined_pd());
+#else
+  __m512d raw;
+  return vec_avx512<double, N>(raw);
+#endif
+}
+
+SIMD_DIAGNOSTICS(pop)
+
+// ================================================== ARITHMETIC
+
+// ------------------------------ Addition
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> operator+(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(_mm512_add_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> operator+(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_add_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> operator+(
+    const vec_avx512<uint32_t, N> a, const vec_avx512<uint32_t, N> b) {
+  return vec_avx512<uint32_t, N>(_mm512_add_epi32(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> operator+(
+    const vec_avx512<uint64_t, N> a, const vec_avx512<uint64_t, N> b) {
+  return vec_avx512<uint64_t, N>(_mm512_add_epi64(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> operator+(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(_mm512_add_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> operator+(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_add_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator+(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(_mm512_add_epi32(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> operator+(
+    const vec_avx512<int64_t, N> a, const vec_avx512<int64_t, N> b) {
+  return vec_avx512<int64_t, N>(_mm512_add_epi64(a.raw, b.raw));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator+(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_add_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator+(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_add_pd(a.raw, b.raw));
+}
+
+// ------------------------------ Subtraction
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> operator-(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(_mm512_sub_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> operator-(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_sub_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> operator-(
+    const vec_avx512<uint32_t, N> a, const vec_avx512<uint32_t, N> b) {
+  return vec_avx512<uint32_t, N>(_mm512_sub_epi32(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> operator-(
+    const vec_avx512<uint64_t, N> a, const vec_avx512<uint64_t, N> b) {
+  return vec_avx512<uint64_t, N>(_mm512_sub_epi64(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> operator-(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(_mm512_sub_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> operator-(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_sub_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator-(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(_mm512_sub_epi32(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> operator-(
+    const vec_avx512<int64_t, N> a, const vec_avx512<int64_t, N> b) {
+  return vec_avx512<int64_t, N>(_mm512_sub_epi64(a.raw, b.raw));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator-(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_sub_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator-(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_sub_pd(a.raw, b.raw));
+}
+
+// ------------------------------ Saturating addition
+
+// Returns a + b clamped to the destination range.
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> saturated_add(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(_mm512_adds_epu8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> saturated_add(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_adds_epu16(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> saturated_add(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(_mm512_adds_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> saturated_add(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_adds_epi16(a.raw, b.raw));
+}
+
+// ------------------------------ Saturating subtraction
+
+// Returns a - b clamped to the destination range.
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> saturated_subtract(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(_mm512_subs_epu8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> saturated_subtract(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_subs_epu16(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> saturated_subtract(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(_mm512_subs_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> saturated_subtract(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_subs_epi16(a.raw, b.raw));
+}
+
+// ------------------------------ Average
+
+// Returns (a + b + 1) / 2
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> average_round(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(_mm512_avg_epu8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> average_round(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_avg_epu16(a.raw, b.raw));
+}
+
+// ------------------------------ Absolute value
+
+// Returns absolute value, except that LimitsMin() maps to LimitsMax() + 1.
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> abs(
+    const vec_avx512<int8_t, N> v) {
+  return vec_avx512<int8_t, N>(_mm512_abs_epi8(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> abs(
+    const vec_avx512<int16_t, N> v) {
+  return vec_avx512<int16_t, N>(_mm512_abs_epi16(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> abs(
+    const vec_avx512<int32_t, N> v) {
+  return vec_avx512<int32_t, N>(_mm512_abs_epi32(v.raw));
+}
+
+// ------------------------------ Shift lanes by constant #bits
+
+// Unsigned
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> shift_left(
+    const vec_avx512<uint16_t, N> v) {
+  return vec_avx512<uint16_t, N>(_mm512_slli_epi16(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> shift_right(
+    const vec_avx512<uint16_t, N> v) {
+  return vec_avx512<uint16_t, N>(_mm512_srli_epi16(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> shift_left(
+    const vec_avx512<uint32_t, N> v) {
+  return vec_avx512<uint32_t, N>(_mm512_slli_epi32(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> shift_right(
+    const vec_avx512<uint32_t, N> v) {
+  return vec_avx512<uint32_t, N>(_mm512_srli_epi32(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> shift_left(
+    const vec_avx512<uint64_t, N> v) {
+  return vec_avx512<uint64_t, N>(_mm512_slli_epi64(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> shift_right(
+    const vec_avx512<uint64_t, N> v) {
+  return vec_avx512<uint64_t, N>(_mm512_srli_epi64(v.raw, kBits));
+}
+
+// Signed (no i64 shift_right, for consistency with AVX2)
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> shift_left(
+    const vec_avx512<int16_t, N> v) {
+  return vec_avx512<int16_t, N>(_mm512_slli_epi16(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> shift_right(
+    const vec_avx512<int16_t, N> v) {
+  return vec_avx512<int16_t, N>(_mm512_srai_epi16(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> shift_left(
+    const vec_avx512<int32_t, N> v) {
+  return vec_avx512<int32_t, N>(_mm512_slli_epi32(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> shift_right(
+    const vec_avx512<int32_t, N> v) {
+  return vec_avx512<int32_t, N>(_mm512_srai_epi32(v.raw, kBits));
+}
+template <int kBits, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> shift_left(
+    const vec_avx512<int64_t, N> v) {
+  return vec_avx512<int64_t, N>(_mm512_slli_epi64(v.raw, kBits));
+}
+
+// ------------------------------ Shift lanes by same variable #bits
+
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE shift_left_count<T, N> set_shift_left_count(
+    Desc<T, N, AVX512>, const int bits) {
+  return shift_left_count<T, N>{_mm_cvtsi32_si128(bits)};
+}
+
+// Same as shift_left_count on x86, but different on ARM.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE shift_right_count<T, N> set_shift_right_count(
+    Desc<T, N, AVX512>, const int bits) {
+  return shift_right_count<T, N>{_mm_cvtsi32_si128(bits)};
+}
+
+// Unsigned (no u8)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> shift_left_same(
+    const vec_avx512<uint16_t, N> v, const shift_left_count<uint16_t, N> bits) {
+  return vec_avx512<uint16_t, N>(_mm512_sll_epi16(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> shift_right_same(
+    const vec_avx512<uint16_t, N> v,
+    const shift_right_count<uint16_t, N> bits) {
+  return vec_avx512<uint16_t, N>(_mm512_srl_epi16(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> shift_left_same(
+    const vec_avx512<uint32_t, N> v, const shift_left_count<uint32_t, N> bits) {
+  return vec_avx512<uint32_t, N>(_mm512_sll_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> shift_right_same(
+    const vec_avx512<uint32_t, N> v,
+    const shift_right_count<uint32_t, N> bits) {
+  return vec_avx512<uint32_t, N>(_mm512_srl_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> shift_left_same(
+    const vec_avx512<uint64_t, N> v, const shift_left_count<uint64_t, N> bits) {
+  return vec_avx512<uint64_t, N>(_mm512_sll_epi64(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> shift_right_same(
+    const vec_avx512<uint64_t, N> v,
+    const shift_right_count<uint64_t, N> bits) {
+  return vec_avx512<uint64_t, N>(_mm512_srl_epi64(v.raw, bits.raw));
+}
+
+// Signed (no i8,i64)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> shift_left_same(
+    const vec_avx512<int16_t, N> v, const shift_left_count<int16_t, N> bits) {
+  return vec_avx512<int16_t, N>(_mm512_sll_epi16(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> shift_right_same(
+    const vec_avx512<int16_t, N> v, const shift_right_count<int16_t, N> bits) {
+  return vec_avx512<int16_t, N>(_mm512_sra_epi16(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> shift_left_same(
+    const vec_avx512<int32_t, N> v, const shift_left_count<int32_t, N> bits) {
+  return vec_avx512<int32_t, N>(_mm512_sll_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> shift_right_same(
+    const vec_avx512<int32_t, N> v, const shift_right_count<int32_t, N> bits) {
+  return vec_avx512<int32_t, N>(_mm512_sra_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> shift_left_same(
+    const vec_avx512<int64_t, N> v, const shift_left_count<int64_t, N> bits) {
+  return vec_avx512<int64_t, N>(_mm512_sll_epi64(v.raw, bits.raw));
+}
+
+// ------------------------------ Shift lanes by independent variable #bits
+
+// Unsigned (no u8,u16)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> operator<<(
+    const vec_avx512<uint32_t, N> v, const vec_avx512<uint32_t, N> bits) {
+  return vec_avx512<uint32_t, N>(_mm512_sllv_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> operator>>(
+    const vec_avx512<uint32_t, N> v, const vec_avx512<uint32_t, N> bits) {
+  return vec_avx512<uint32_t, N>(_mm512_srlv_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> operator<<(
+    const vec_avx512<uint64_t, N> v, const vec_avx512<uint64_t, N> bits) {
+  return vec_avx512<uint64_t, N>(_mm512_sllv_epi64(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> operator>>(
+    const vec_avx512<uint64_t, N> v, const vec_avx512<uint64_t, N> bits) {
+  return vec_avx512<uint64_t, N>(_mm512_srlv_epi64(v.raw, bits.raw));
+}
+
+// Signed (no i8,i16,i64)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator<<(
+    const vec_avx512<int32_t, N> v, const vec_avx512<int32_t, N> bits) {
+  return vec_avx512<int32_t, N>(_mm512_sllv_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator>>(
+    const vec_avx512<int32_t, N> v, const vec_avx512<int32_t, N> bits) {
+  return vec_avx512<int32_t, N>(_mm512_srav_epi32(v.raw, bits.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> operator<<(
+    const vec_avx512<int64_t, N> v, const vec_avx512<int64_t, N> bits) {
+  return vec_avx512<int64_t, N>(_mm512_sllv_epi64(v.raw, bits.raw));
+}
+
+// ------------------------------ Minimum
+
+// Unsigned (no u64)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> min(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(_mm512_min_epu8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> min(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_min_epu16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> min(
+    const vec_avx512<uint32_t, N> a, const vec_avx512<uint32_t, N> b) {
+  return vec_avx512<uint32_t, N>(_mm512_min_epu32(a.raw, b.raw));
+}
+
+// Signed (no i64)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> min(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(_mm512_min_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> min(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_min_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> min(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(_mm512_min_epi32(a.raw, b.raw));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> min(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_min_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> min(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_min_pd(a.raw, b.raw));
+}
+
+// ------------------------------ Maximum
+
+// Unsigned (no u64)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> max(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(_mm512_max_epu8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> max(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_max_epu16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> max(
+    const vec_avx512<uint32_t, N> a, const vec_avx512<uint32_t, N> b) {
+  return vec_avx512<uint32_t, N>(_mm512_max_epu32(a.raw, b.raw));
+}
+
+// Signed (no i64)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> max(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(_mm512_max_epi8(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> max(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_max_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> max(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(_mm512_max_epi32(a.raw, b.raw));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> max(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_max_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> max(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_max_pd(a.raw, b.raw));
+}
+
+// Returns the closest value to v within [lo, hi].
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> clamp(const vec_avx512<T, N> v,
+                                                    const vec_avx512<T, N> lo,
+                                                    const vec_avx512<T, N> hi) {
+  return min(max(lo, v), hi);
+}
+
+// ------------------------------ Integer multiplication
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> operator*(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_mullo_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> operator*(
+    const vec_avx512<uint32_t, N> a, const vec_avx512<uint32_t, N> b) {
+  return vec_avx512<uint32_t, N>(_mm512_mullo_epi32(a.raw, b.raw));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> operator*(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_mullo_epi16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator*(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(_mm512_mullo_epi32(a.raw, b.raw));
+}
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+// Returns the upper 16 bits of a * b in each lane.
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> mul_high(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(_mm512_mulhi_epu16(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> mul_high(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_mulhi_epi16(a.raw, b.raw));
+}
+
+}  // namespace ext
+
+// Returns (((a * b) >> 14) + 1) >> 1.
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> mul_high_round(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(_mm512_mulhrs_epi16(a.raw, b.raw));
+}
+
+// Multiplies even lanes (0, 2 ..) and places the double-wide result into
+// even and the upper half into its odd neighbor lane.
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> mul_even(
+    const vec_avx512<int32_t> a, const vec_avx512<int32_t> b) {
+  return vec_avx512<int64_t>(_mm512_mul_epi32(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> mul_even(
+    const vec_avx512<uint32_t> a, const vec_avx512<uint32_t> b) {
+  return vec_avx512<uint64_t>(_mm512_mul_epu32(a.raw, b.raw));
+}
+
+// ------------------------------ Floating-point negate
+
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> neg(
+    const vec_avx512<float, N> v) {
+  const Part<float, N, AVX512> df;
+  const Part<uint32_t, N, AVX512> du;
+  const auto sign = cast_to(df, set1(du, 0x80000000u));
+  return v ^ sign;
+}
+
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> neg(
+    const vec_avx512<double, N> v) {
+  const Part<double, N, AVX512> df;
+  const Part<uint64_t, N, AVX512> du;
+  const auto sign = cast_to(df, set1(du, 0x8000000000000000ull));
+  return v ^ sign;
+}
+
+// ------------------------------ Floating-point mul / div
+
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator*(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_mul_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator*(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_mul_pd(a.raw, b.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator/(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_div_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator/(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_div_pd(a.raw, b.raw));
+}
+
+// Approximate reciprocal (relative error < 2^-14, more precise than AVX2)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> approximate_reciprocal(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<float, N>(_mm512_rcp14_ps(v.raw));
+}
+
+// ------------------------------ Floating-point multiply-add variants
+
+// Returns mul * x + add
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> mul_add(
+    const vec_avx512<float, N> mul, const vec_avx512<float, N> x,
+    const vec_avx512<float, N> add) {
+  return vec_avx512<float, N>(_mm512_fmadd_ps(mul.raw, x.raw, add.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> mul_add(
+    const vec_avx512<double, N> mul, const vec_avx512<double, N> x,
+    const vec_avx512<double, N> add) {
+  return vec_avx512<double, N>(_mm512_fmadd_pd(mul.raw, x.raw, add.raw));
+}
+
+// Returns add - mul * x
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> nmul_add(
+    const vec_avx512<float, N> mul, const vec_avx512<float, N> x,
+    const vec_avx512<float, N> add) {
+  return vec_avx512<float, N>(_mm512_fnmadd_ps(mul.raw, x.raw, add.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> nmul_add(
+    const vec_avx512<double, N> mul, const vec_avx512<double, N> x,
+    const vec_avx512<double, N> add) {
+  return vec_avx512<double, N>(_mm512_fnmadd_pd(mul.raw, x.raw, add.raw));
+}
+
+// Slightly more expensive on ARM (extra negate)
+namespace ext {
+
+// Returns mul * x - sub
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> mul_subtract(
+    const vec_avx512<float, N> mul, const vec_avx512<float, N> x,
+    const vec_avx512<float, N> sub) {
+  return vec_avx512<float, N>(_mm512_fmsub_ps(mul.raw, x.raw, sub.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> mul_subtract(
+    const vec_avx512<double, N> mul, const vec_avx512<double, N> x,
+    const vec_avx512<double, N> sub) {
+  return vec_avx512<double, N>(_mm512_fmsub_pd(mul.raw, x.raw, sub.raw));
+}
+
+// Returns -mul * x - sub
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> nmul_subtract(
+    const vec_avx512<float, N> mul, const vec_avx512<float, N> x,
+    const vec_avx512<float, N> sub) {
+  return vec_avx512<float, N>(_mm512_fnmsub_ps(mul.raw, x.raw, sub.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> nmul_subtract(
+    const vec_avx512<double, N> mul, const vec_avx512<double, N> x,
+    const vec_avx512<double, N> sub) {
+  return vec_avx512<double, N>(_mm512_fnmsub_pd(mul.raw, x.raw, sub.raw));
+}
+
+}  // namespace ext
+
+// ------------------------------ Floating-point square root
+
+// Full precision square root
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> sqrt(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<float, N>(_mm512_sqrt_ps(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> sqrt(
+    const vec_avx512<double, N> v) {
+  return vec_avx512<double, N>(_mm512_sqrt_pd(v.raw));
+}
+
+// Approximate reciprocal square root (relative error < 2^-14)
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> approximate_reciprocal_sqrt(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<float, N>(_mm512_rsqrt14_ps(v.raw));
+}
+
+// ------------------------------ Floating-point rounding
+
+// Toward nearest integer, tie to even
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> round(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<float, N>(_mm512_roundscale_ps(
+      v.raw, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> round(
+    const vec_avx512<double, N> v) {
+  return vec_avx512<double, N>(_mm512_roundscale_pd(
+      v.raw, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+// Toward zero, aka truncate
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> trunc(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<float, N>(
+      _mm512_roundscale_ps(v.raw, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> trunc(
+    const vec_avx512<double, N> v) {
+  return vec_avx512<double, N>(
+      _mm512_roundscale_pd(v.raw, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+}
+
+// Toward +infinity, aka ceiling
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> ceil(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<float, N>(
+      _mm512_roundscale_ps(v.raw, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> ceil(
+    const vec_avx512<double, N> v) {
+  return vec_avx512<double, N>(
+      _mm512_roundscale_pd(v.raw, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+}
+
+// Toward -infinity, aka floor
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> floor(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<float, N>(
+      _mm512_roundscale_ps(v.raw, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> floor(
+    const vec_avx512<double, N> v) {
+  return vec_avx512<double, N>(
+      _mm512_roundscale_pd(v.raw, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+}
+
+// ================================================== COMPARE
+
+// Comparisons fill a lane with 1-bits if the condition is true, else 0.
+// AVX-512 compares into mask registers; VPMOVM2* expands them to vectors.
+
+// ------------------------------ Equality
+
+// Unsigned
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t, N> operator==(
+    const vec_avx512<uint8_t, N> a, const vec_avx512<uint8_t, N> b) {
+  return vec_avx512<uint8_t, N>(
+      _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t, N> operator==(
+    const vec_avx512<uint16_t, N> a, const vec_avx512<uint16_t, N> b) {
+  return vec_avx512<uint16_t, N>(
+      _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t, N> operator==(
+    const vec_avx512<uint32_t, N> a, const vec_avx512<uint32_t, N> b) {
+  return vec_avx512<uint32_t, N>(
+      _mm512_movm_epi32(_mm512_cmpeq_epi32_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t, N> operator==(
+    const vec_avx512<uint64_t, N> a, const vec_avx512<uint64_t, N> b) {
+  return vec_avx512<uint64_t, N>(
+      _mm512_movm_epi64(_mm512_cmpeq_epi64_mask(a.raw, b.raw)));
+}
+
+// Signed
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> operator==(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(
+      _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> operator==(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(
+      _mm512_movm_epi16(_mm512_cmpeq_epi16_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator==(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(
+      _mm512_movm_epi32(_mm512_cmpeq_epi32_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> operator==(
+    const vec_avx512<int64_t, N> a, const vec_avx512<int64_t, N> b) {
+  return vec_avx512<int64_t, N>(
+      _mm512_movm_epi64(_mm512_cmpeq_epi64_mask(a.raw, b.raw)));
+}
+
+// Float
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator==(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  const __mmask16 mask = _mm512_cmp_ps_mask(a.raw, b.raw, _CMP_EQ_OQ);
+  return vec_avx512<float, N>(_mm512_castsi512_ps(_mm512_movm_epi32(mask)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator==(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  const __mmask8 mask = _mm512_cmp_pd_mask(a.raw, b.raw, _CMP_EQ_OQ);
+  return vec_avx512<double, N>(_mm512_castsi512_pd(_mm512_movm_epi64(mask)));
+}
+
+// ------------------------------ Strict inequality
+
+// Signed/float <
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> operator<(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(
+      _mm512_movm_epi8(_mm512_cmpgt_epi8_mask(b.raw, a.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> operator<(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(
+      _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(b.raw, a.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator<(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(
+      _mm512_movm_epi32(_mm512_cmpgt_epi32_mask(b.raw, a.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> operator<(
+    const vec_avx512<int64_t, N> a, const vec_avx512<int64_t, N> b) {
+  return vec_avx512<int64_t, N>(
+      _mm512_movm_epi64(_mm512_cmpgt_epi64_mask(b.raw, a.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator<(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  const __mmask16 mask = _mm512_cmp_ps_mask(a.raw, b.raw, _CMP_LT_OQ);
+  return vec_avx512<float, N>(_mm512_castsi512_ps(_mm512_movm_epi32(mask)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator<(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  const __mmask8 mask = _mm512_cmp_pd_mask(a.raw, b.raw, _CMP_LT_OQ);
+  return vec_avx512<double, N>(_mm512_castsi512_pd(_mm512_movm_epi64(mask)));
+}
+
+// Signed/float >
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t, N> operator>(
+    const vec_avx512<int8_t, N> a, const vec_avx512<int8_t, N> b) {
+  return vec_avx512<int8_t, N>(
+      _mm512_movm_epi8(_mm512_cmpgt_epi8_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t, N> operator>(
+    const vec_avx512<int16_t, N> a, const vec_avx512<int16_t, N> b) {
+  return vec_avx512<int16_t, N>(
+      _mm512_movm_epi16(_mm512_cmpgt_epi16_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> operator>(
+    const vec_avx512<int32_t, N> a, const vec_avx512<int32_t, N> b) {
+  return vec_avx512<int32_t, N>(
+      _mm512_movm_epi32(_mm512_cmpgt_epi32_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t, N> operator>(
+    const vec_avx512<int64_t, N> a, const vec_avx512<int64_t, N> b) {
+  return vec_avx512<int64_t, N>(
+      _mm512_movm_epi64(_mm512_cmpgt_epi64_mask(a.raw, b.raw)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator>(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  const __mmask16 mask = _mm512_cmp_ps_mask(a.raw, b.raw, _CMP_GT_OQ);
+  return vec_avx512<float, N>(_mm512_castsi512_ps(_mm512_movm_epi32(mask)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator>(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  const __mmask8 mask = _mm512_cmp_pd_mask(a.raw, b.raw, _CMP_GT_OQ);
+  return vec_avx512<double, N>(_mm512_castsi512_pd(_mm512_movm_epi64(mask)));
+}
+
+// ------------------------------ Weak inequality
+
+// Float <= >=
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator<=(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  const __mmask16 mask = _mm512_cmp_ps_mask(a.raw, b.raw, _CMP_LE_OQ);
+  return vec_avx512<float, N>(_mm512_castsi512_ps(_mm512_movm_epi32(mask)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator<=(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  const __mmask8 mask = _mm512_cmp_pd_mask(a.raw, b.raw, _CMP_LE_OQ);
+  return vec_avx512<double, N>(_mm512_castsi512_pd(_mm512_movm_epi64(mask)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator>=(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  const __mmask16 mask = _mm512_cmp_ps_mask(a.raw, b.raw, _CMP_GE_OQ);
+  return vec_avx512<float, N>(_mm512_castsi512_ps(_mm512_movm_epi32(mask)));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator>=(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  const __mmask8 mask = _mm512_cmp_pd_mask(a.raw, b.raw, _CMP_GE_OQ);
+  return vec_avx512<double, N>(_mm512_castsi512_pd(_mm512_movm_epi64(mask)));
+}
+
+// ================================================== LOGICAL
+
+// ------------------------------ Bitwise AND
+
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> operator&(
+    const vec_avx512<T, N> a, const vec_avx512<T, N> b) {
+  return vec_avx512<T, N>(_mm512_and_si512(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator&(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_and_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator&(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_and_pd(a.raw, b.raw));
+}
+
+// ------------------------------ Bitwise AND-NOT
+
+// Returns ~not_mask & mask.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> andnot(
+    const vec_avx512<T, N> not_mask, const vec_avx512<T, N> mask) {
+  return vec_avx512<T, N>(_mm512_andnot_si512(not_mask.raw, mask.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> andnot(
+    const vec_avx512<float, N> not_mask, const vec_avx512<float, N> mask) {
+  return vec_avx512<float, N>(_mm512_andnot_ps(not_mask.raw, mask.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> andnot(
+    const vec_avx512<double, N> not_mask, const vec_avx512<double, N> mask) {
+  return vec_avx512<double, N>(_mm512_andnot_pd(not_mask.raw, mask.raw));
+}
+
+// ------------------------------ Bitwise OR
+
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> operator|(
+    const vec_avx512<T, N> a, const vec_avx512<T, N> b) {
+  return vec_avx512<T, N>(_mm512_or_si512(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator|(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_or_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator|(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_or_pd(a.raw, b.raw));
+}
+
+// ------------------------------ Bitwise XOR
+
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> operator^(
+    const vec_avx512<T, N> a, const vec_avx512<T, N> b) {
+  return vec_avx512<T, N>(_mm512_xor_si512(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> operator^(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b) {
+  return vec_avx512<float, N>(_mm512_xor_ps(a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> operator^(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b) {
+  return vec_avx512<double, N>(_mm512_xor_pd(a.raw, b.raw));
+}
+
+// ------------------------------ Select/blend
+
+// Returns a mask for use by select().
+// select only checks the sign bit, so this is a no-op on x86.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> condition_from_sign(
+    const vec_avx512<T, N> v) {
+  return v;
+}
+
+// Returns mask ? b : a. "mask" must either have been returned by
+// selector_from_mask, or callers must ensure its lanes are T(0) or ~T(0).
+// As with BLENDV, only the most significant bit of each byte/lane is used.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> select(
+    const vec_avx512<T, N> a, const vec_avx512<T, N> b,
+    const vec_avx512<T, N> mask) {
+  return vec_avx512<T, N>(
+      _mm512_mask_blend_epi8(_mm512_movepi8_mask(mask.raw), a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> select(
+    const vec_avx512<float, N> a, const vec_avx512<float, N> b,
+    const vec_avx512<float, N> mask) {
+  const __mmask16 m = _mm512_movepi32_mask(_mm512_castps_si512(mask.raw));
+  return vec_avx512<float, N>(_mm512_mask_blend_ps(m, a.raw, b.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double, N> select(
+    const vec_avx512<double, N> a, const vec_avx512<double, N> b,
+    const vec_avx512<double, N> mask) {
+  const __mmask8 m = _mm512_movepi64_mask(_mm512_castpd_si512(mask.raw));
+  return vec_avx512<double, N>(_mm512_mask_blend_pd(m, a.raw, b.raw));
+}
+
+// ================================================== MEMORY
+
+// ------------------------------ Load
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> load(
+    Full<T, AVX512>, const T* SIMD_RESTRICT aligned) {
+  return vec_avx512<T>(_mm512_load_si512(aligned));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> load(
+    Full<float, AVX512>, const float* SIMD_RESTRICT aligned) {
+  return vec_avx512<float>(_mm512_load_ps(aligned));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> load(
+    Full<double, AVX512>, const double* SIMD_RESTRICT aligned) {
+  return vec_avx512<double>(_mm512_load_pd(aligned));
+}
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> load_unaligned(
+    Full<T, AVX512>, const T* SIMD_RESTRICT p) {
+  return vec_avx512<T>(_mm512_loadu_si512(p));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> load_unaligned(
+    Full<float, AVX512>, const float* SIMD_RESTRICT p) {
+  return vec_avx512<float>(_mm512_loadu_ps(p));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> load_unaligned(
+    Full<double, AVX512>, const double* SIMD_RESTRICT p) {
+  return vec_avx512<double>(_mm512_loadu_pd(p));
+}
+
+// Loads 128 bit and duplicates into all four 128-bit blocks.
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> load_dup128(
+    Full<T, AVX512>, const T* const SIMD_RESTRICT p) {
+  const Full<T, SSE4> d128;
+  return vec_avx512<T>(_mm512_broadcast_i32x4(load_unaligned(d128, p).raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> load_dup128(
+    Full<float, AVX512>, const float* const SIMD_RESTRICT p) {
+  return vec_avx512<float>(_mm512_broadcast_f32x4(_mm_loadu_ps(p)));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> load_dup128(
+    Full<double, AVX512>, const double* const SIMD_RESTRICT p) {
+  return vec_avx512<double>(_mm512_broadcast_f64x2(_mm_loadu_pd(p)));
+}
+
+// ------------------------------ Store
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE void store(const vec_avx512<T> v,
+                                        Full<T, AVX512>,
+                                        T* SIMD_RESTRICT aligned) {
+  _mm512_store_si512(aligned, v.raw);
+}
+SIMD_ATTR_AVX512 SIMD_INLINE void store(const vec_avx512<float> v,
+                                        Full<float, AVX512>,
+                                        float* SIMD_RESTRICT aligned) {
+  _mm512_store_ps(aligned, v.raw);
+}
+SIMD_ATTR_AVX512 SIMD_INLINE void store(const vec_avx512<double> v,
+                                        Full<double, AVX512>,
+                                        double* SIMD_RESTRICT aligned) {
+  _mm512_store_pd(aligned, v.raw);
+}
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE void store_unaligned(const vec_avx512<T> v,
+                                                  Full<T, AVX512>,
+                                                  T* SIMD_RESTRICT p) {
+  _mm512_storeu_si512(p, v.raw);
+}
+SIMD_ATTR_AVX512 SIMD_INLINE void store_unaligned(const vec_avx512<float> v,
+                                                  Full<float, AVX512>,
+                                                  float* SIMD_RESTRICT p) {
+  _mm512_storeu_ps(p, v.raw);
+}
+SIMD_ATTR_AVX512 SIMD_INLINE void store_unaligned(const vec_avx512<double> v,
+                                                  Full<double, AVX512>,
+                                                  double* SIMD_RESTRICT p) {
+  _mm512_storeu_pd(p, v.raw);
+}
+
+// ------------------------------ Non-temporal stores
+
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE void stream(const vec_avx512<T, N> v,
+                                         Full<T, AVX512>,
+                                         T* SIMD_RESTRICT aligned) {
+  _mm512_stream_si512(reinterpret_cast<__m512i*>(aligned), v.raw);
+}
+SIMD_ATTR_AVX512 SIMD_INLINE void stream(const vec_avx512<float> v,
+                                         Full<float, AVX512>,
+                                         float* SIMD_RESTRICT aligned) {
+  _mm512_stream_ps(aligned, v.raw);
+}
+SIMD_ATTR_AVX512 SIMD_INLINE void stream(const vec_avx512<double> v,
+                                         Full<double, AVX512>,
+                                         double* SIMD_RESTRICT aligned) {
+  _mm512_stream_pd(aligned, v.raw);
+}
+
+// ------------------------------ Gather
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+// Note: unlike AVX2, the AVX-512 intrinsics take the index vector first.
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> gather_offset_impl(
+    char (&sizeof_t)[4], Full<T, AVX512>, const T* SIMD_RESTRICT base,
+    const vec_avx512<int32_t> offset) {
+  return vec_avx512<T>(_mm512_i32gather_epi32(offset.raw, base, 1));
+}
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> gather_index_impl(
+    char (&sizeof_t)[4], Full<T, AVX512>, const T* SIMD_RESTRICT base,
+    const vec_avx512<int32_t> index) {
+  return vec_avx512<T>(_mm512_i32gather_epi32(index.raw, base, 4));
+}
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> gather_offset_impl(
+    char (&sizeof_t)[8], Full<T, AVX512>, const T* SIMD_RESTRICT base,
+    const vec_avx512<int64_t> offset) {
+  return vec_avx512<T>(_mm512_i64gather_epi64(offset.raw, base, 1));
+}
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> gather_index_impl(
+    char (&sizeof_t)[8], Full<T, AVX512>, const T* SIMD_RESTRICT base,
+    const vec_avx512<int64_t> index) {
+  return vec_avx512<T>(_mm512_i64gather_epi64(index.raw, base, 8));
+}
+
+template <typename T, typename Offset>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> gather_offset(
+    Full<T, AVX512> d, const T* SIMD_RESTRICT base,
+    const vec_avx512<Offset> offset) {
+  static_assert(sizeof(T) == sizeof(Offset), "SVE requires same size base/ofs");
+  char sizeof_t[sizeof(T)];
+  return gather_offset_impl(sizeof_t, d, base, offset);
+}
+template <typename T, typename Index>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> gather_index(
+    Full<T, AVX512> d, const T* SIMD_RESTRICT base,
+    const vec_avx512<Index> index) {
+  static_assert(sizeof(T) == sizeof(Index), "SVE requires same size base/idx");
+  char sizeof_t[sizeof(T)];
+  return gather_index_impl(sizeof_t, d, base, index);
+}
+
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> gather_offset<float>(
+    Full<float, AVX512>, const float* SIMD_RESTRICT base,
+    const vec_avx512<int32_t> offset) {
+  return vec_avx512<float>(_mm512_i32gather_ps(offset.raw, base, 1));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> gather_index<float>(
+    Full<float, AVX512>, const float* SIMD_RESTRICT base,
+    const vec_avx512<int32_t> index) {
+  return vec_avx512<float>(_mm512_i32gather_ps(index.raw, base, 4));
+}
+
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> gather_offset<double>(
+    Full<double, AVX512>, const double* SIMD_RESTRICT base,
+    const vec_avx512<int64_t> offset) {
+  return vec_avx512<double>(_mm512_i64gather_pd(offset.raw, base, 1));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> gather_index<double>(
+    Full<double, AVX512>, const double* SIMD_RESTRICT base,
+    const vec_avx512<int64_t> index) {
+  return vec_avx512<double>(_mm512_i64gather_pd(index.raw, base, 8));
+}
+
+}  // namespace ext
+
+// ================================================== SWIZZLE
+
+// ------------------------------ Extract half
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<T> get_half(Lower, vec_avx512<T> v) {
+  return vec_avx2<T>(_mm512_castsi512_si256(v.raw));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<float> get_half(Lower,
+                                                      vec_avx512<float> v) {
+  return vec_avx2<float>(_mm512_castps512_ps256(v.raw));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<double> get_half(Lower,
+                                                       vec_avx512<double> v) {
+  return vec_avx2<double>(_mm512_castpd512_pd256(v.raw));
+}
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<T> lower_half(const vec_avx512<T> v) {
+  return get_half(Lower(), v);
+}
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<T> get_half(Upper,
+                                                  const vec_avx512<T> v) {
+  return vec_avx2<T>(_mm512_extracti64x4_epi64(v.raw, 1));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<float> get_half(
+    Upper, const vec_avx512<float> v) {
+  return vec_avx2<float>(_mm512_extractf32x8_ps(v.raw, 1));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<double> get_half(
+    Upper, const vec_avx512<double> v) {
+  return vec_avx2<double>(_mm512_extractf64x4_pd(v.raw, 1));
+}
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<T> upper_half(const vec_avx512<T> v) {
+  return get_half(Upper(), v);
+}
+
+// ------------------------------ Shift vector by constant #bytes
+
+// 0x01..0F, kBytes = 1 => 0x02..0F00 (independently for each 128-bit block)
+template <int kBytes, typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> shift_left_bytes(
+    const vec_avx512<T, N> v) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  return vec_avx512<T, N>(_mm512_bslli_epi128(v.raw, kBytes));
+}
+
+template <int kLanes, typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> shift_left_lanes(
+    const vec_avx512<T, N> v) {
+  return shift_left_bytes<kLanes * sizeof(T)>(v);
+}
+
+// 0x01..0F, kBytes = 1 => 0x0001..0E (independently for each 128-bit block)
+template <int kBytes, typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> shift_right_bytes(
+    const vec_avx512<T, N> v) {
+  static_assert(0 <= kBytes && kBytes <= 16, "Invalid kBytes");
+  return vec_avx512<T, N>(_mm512_bsrli_epi128(v.raw, kBytes));
+}
+
+template <int kLanes, typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> shift_right_lanes(
+    const vec_avx512<T, N> v) {
+  return shift_right_bytes<kLanes * sizeof(T)>(v);
+}
+
+// ------------------------------ Extract from 2x 128-bit at constant offset
+
+// Extracts 128 bits from <hi, lo> by skipping the least-significant kBytes.
+template <int kBytes, typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> combine_shift_right_bytes(
+    const vec_avx512<T, N> hi, const vec_avx512<T, N> lo) {
+  const Full<uint8_t, AVX512> d8;
+  const vec_avx512<uint8_t> extracted_bytes(
+      _mm512_alignr_epi8(cast_to(d8, hi).raw, cast_to(d8, lo).raw, kBytes));
+  return cast_to(Full<T, AVX512>(), extracted_bytes);
+}
+
+// ------------------------------ Broadcast/splat any lane
+
+// Unsigned
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t> broadcast(
+    const vec_avx512<uint16_t> v) {
+  static_assert(0 <= kLane && kLane < 8, "Invalid lane");
+  if (kLane < 4) {
+    const __m512i lo = _mm512_shufflelo_epi16(v.raw, 0x55 * kLane);
+    return vec_avx512<uint16_t>(_mm512_unpacklo_epi64(lo, lo));
+  } else {
+    const __m512i hi = _mm512_shufflehi_epi16(v.raw, 0x55 * (kLane - 4));
+    return vec_avx512<uint16_t>(_mm512_unpackhi_epi64(hi, hi));
+  }
+}
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> broadcast(
+    const vec_avx512<uint32_t> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  constexpr _MM_PERM_ENUM perm = static_cast<_MM_PERM_ENUM>(0x55 * kLane);
+  return vec_avx512<uint32_t>(_mm512_shuffle_epi32(v.raw, perm));
+}
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> broadcast(
+    const vec_avx512<uint64_t> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  constexpr _MM_PERM_ENUM perm = kLane ? _MM_PERM_DCDC : _MM_PERM_BABA;
+  return vec_avx512<uint64_t>(_mm512_shuffle_epi32(v.raw, perm));
+}
+
+// Signed
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> broadcast(
+    const vec_avx512<int16_t> v) {
+  static_assert(0 <= kLane && kLane < 8, "Invalid lane");
+  if (kLane < 4) {
+    const __m512i lo = _mm512_shufflelo_epi16(v.raw, 0x55 * kLane);
+    return vec_avx512<int16_t>(_mm512_unpacklo_epi64(lo, lo));
+  } else {
+    const __m512i hi = _mm512_shufflehi_epi16(v.raw, 0x55 * (kLane - 4));
+    return vec_avx512<int16_t>(_mm512_unpackhi_epi64(hi, hi));
+  }
+}
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> broadcast(
+    const vec_avx512<int32_t> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  constexpr _MM_PERM_ENUM perm = static_cast<_MM_PERM_ENUM>(0x55 * kLane);
+  return vec_avx512<int32_t>(_mm512_shuffle_epi32(v.raw, perm));
+}
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> broadcast(
+    const vec_avx512<int64_t> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  constexpr _MM_PERM_ENUM perm = kLane ? _MM_PERM_DCDC : _MM_PERM_BABA;
+  return vec_avx512<int64_t>(_mm512_shuffle_epi32(v.raw, perm));
+}
+
+// Float
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> broadcast(
+    const vec_avx512<float> v) {
+  static_assert(0 <= kLane && kLane < 4, "Invalid lane");
+  return vec_avx512<float>(_mm512_shuffle_ps(v.raw, v.raw, 0x55 * kLane));
+}
+template <int kLane>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> broadcast(
+    const vec_avx512<double> v) {
+  static_assert(0 <= kLane && kLane < 2, "Invalid lane");
+  return vec_avx512<double>(_mm512_shuffle_pd(v.raw, v.raw, 0xFF * kLane));
+}
+
+// ------------------------------ Hard-coded shuffles
+
+// Notation: as in x86_avx2.h, these operate independently on each 128-bit
+// block (i.e. four times per vector).
+
+// Swap 64-bit halves
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> shuffle_1032(
+    const vec_avx512<uint32_t> v) {
+  return vec_avx512<uint32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_BADC));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> shuffle_1032(
+    const vec_avx512<int32_t> v) {
+  return vec_avx512<int32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_BADC));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> shuffle_1032(
+    const vec_avx512<float> v) {
+  return vec_avx512<float>(_mm512_shuffle_ps(v.raw, v.raw, 0x4E));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> shuffle_01(
+    const vec_avx512<uint64_t> v) {
+  return vec_avx512<uint64_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_BADC));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> shuffle_01(
+    const vec_avx512<int64_t> v) {
+  return vec_avx512<int64_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_BADC));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> shuffle_01(
+    const vec_avx512<double> v) {
+  return vec_avx512<double>(_mm512_shuffle_pd(v.raw, v.raw, 0x55));
+}
+
+// Rotate right 32 bits
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> shuffle_0321(
+    const vec_avx512<uint32_t> v) {
+  return vec_avx512<uint32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_ADCB));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> shuffle_0321(
+    const vec_avx512<int32_t> v) {
+  return vec_avx512<int32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_ADCB));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> shuffle_0321(
+    const vec_avx512<float> v) {
+  return vec_avx512<float>(_mm512_shuffle_ps(v.raw, v.raw, 0x39));
+}
+// Rotate left 32 bits
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> shuffle_2103(
+    const vec_avx512<uint32_t> v) {
+  return vec_avx512<uint32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_CBAD));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> shuffle_2103(
+    const vec_avx512<int32_t> v) {
+  return vec_avx512<int32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_CBAD));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> shuffle_2103(
+    const vec_avx512<float> v) {
+  return vec_avx512<float>(_mm512_shuffle_ps(v.raw, v.raw, 0x93));
+}
+
+// Reverse
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> shuffle_0123(
+    const vec_avx512<uint32_t> v) {
+  return vec_avx512<uint32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_ABCD));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> shuffle_0123(
+    const vec_avx512<int32_t> v) {
+  return vec_avx512<int32_t>(_mm512_shuffle_epi32(v.raw, _MM_PERM_ABCD));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> shuffle_0123(
+    const vec_avx512<float> v) {
+  return vec_avx512<float>(_mm512_shuffle_ps(v.raw, v.raw, 0x1B));
+}
+
+// ------------------------------ Permute (runtime variable)
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE permute_avx512<T> set_table_indices(
+    const Full<T, AVX512>, const int32_t* idx) {
+  return permute_avx512<T>{load_unaligned(Full<int32_t, AVX512>(), idx).raw};
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> table_lookup_lanes(
+    const vec_avx512<uint32_t> v, const permute_avx512<uint32_t> idx) {
+  return vec_avx512<uint32_t>(_mm512_permutexvar_epi32(idx.raw, v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> table_lookup_lanes(
+    const vec_avx512<int32_t> v, const permute_avx512<int32_t> idx) {
+  return vec_avx512<int32_t>(_mm512_permutexvar_epi32(idx.raw, v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> table_lookup_lanes(
+    const vec_avx512<float> v, const permute_avx512<float> idx) {
+  return vec_avx512<float>(_mm512_permutexvar_ps(idx.raw, v.raw));
+}
+
+// ------------------------------ Interleave lanes
+
+// Interleaves lanes from halves of the 128-bit blocks of "a" (which provides
+// the least-significant lane) and "b". To concatenate two half-width integers
+// into one, use zip_lo/hi instead (also works with scalar).
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t> interleave_lo(
+    const vec_avx512<uint8_t> a, const vec_avx512<uint8_t> b) {
+  return vec_avx512<uint8_t>(_mm512_unpacklo_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t> interleave_lo(
+    const vec_avx512<uint16_t> a, const vec_avx512<uint16_t> b) {
+  return vec_avx512<uint16_t>(_mm512_unpacklo_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> interleave_lo(
+    const vec_avx512<uint32_t> a, const vec_avx512<uint32_t> b) {
+  return vec_avx512<uint32_t>(_mm512_unpacklo_epi32(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> interleave_lo(
+    const vec_avx512<uint64_t> a, const vec_avx512<uint64_t> b) {
+  return vec_avx512<uint64_t>(_mm512_unpacklo_epi64(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t> interleave_lo(
+    const vec_avx512<int8_t> a, const vec_avx512<int8_t> b) {
+  return vec_avx512<int8_t>(_mm512_unpacklo_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> interleave_lo(
+    const vec_avx512<int16_t> a, const vec_avx512<int16_t> b) {
+  return vec_avx512<int16_t>(_mm512_unpacklo_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> interleave_lo(
+    const vec_avx512<int32_t> a, const vec_avx512<int32_t> b) {
+  return vec_avx512<int32_t>(_mm512_unpacklo_epi32(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> interleave_lo(
+    const vec_avx512<int64_t> a, const vec_avx512<int64_t> b) {
+  return vec_avx512<int64_t>(_mm512_unpacklo_epi64(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> interleave_lo(
+    const vec_avx512<float> a, const vec_avx512<float> b) {
+  return vec_avx512<float>(_mm512_unpacklo_ps(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> interleave_lo(
+    const vec_avx512<double> a, const vec_avx512<double> b) {
+  return vec_avx512<double>(_mm512_unpacklo_pd(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint8_t> interleave_hi(
+    const vec_avx512<uint8_t> a, const vec_avx512<uint8_t> b) {
+  return vec_avx512<uint8_t>(_mm512_unpackhi_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t> interleave_hi(
+    const vec_avx512<uint16_t> a, const vec_avx512<uint16_t> b) {
+  return vec_avx512<uint16_t>(_mm512_unpackhi_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> interleave_hi(
+    const vec_avx512<uint32_t> a, const vec_avx512<uint32_t> b) {
+  return vec_avx512<uint32_t>(_mm512_unpackhi_epi32(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> interleave_hi(
+    const vec_avx512<uint64_t> a, const vec_avx512<uint64_t> b) {
+  return vec_avx512<uint64_t>(_mm512_unpackhi_epi64(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int8_t> interleave_hi(
+    const vec_avx512<int8_t> a, const vec_avx512<int8_t> b) {
+  return vec_avx512<int8_t>(_mm512_unpackhi_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> interleave_hi(
+    const vec_avx512<int16_t> a, const vec_avx512<int16_t> b) {
+  return vec_avx512<int16_t>(_mm512_unpackhi_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> interleave_hi(
+    const vec_avx512<int32_t> a, const vec_avx512<int32_t> b) {
+  return vec_avx512<int32_t>(_mm512_unpackhi_epi32(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> interleave_hi(
+    const vec_avx512<int64_t> a, const vec_avx512<int64_t> b) {
+  return vec_avx512<int64_t>(_mm512_unpackhi_epi64(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> interleave_hi(
+    const vec_avx512<float> a, const vec_avx512<float> b) {
+  return vec_avx512<float>(_mm512_unpackhi_ps(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> interleave_hi(
+    const vec_avx512<double> a, const vec_avx512<double> b) {
+  return vec_avx512<double>(_mm512_unpackhi_pd(a.raw, b.raw));
+}
+
+// ------------------------------ Zip lanes
+
+// Same as interleave_*, except that the return lanes are double-width integers;
+// this is necessary because the single-lane scalar cannot return two values.
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t> zip_lo(
+    const vec_avx512<uint8_t> a, const vec_avx512<uint8_t> b) {
+  return vec_avx512<uint16_t>(_mm512_unpacklo_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> zip_lo(
+    const vec_avx512<uint16_t> a, const vec_avx512<uint16_t> b) {
+  return vec_avx512<uint32_t>(_mm512_unpacklo_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> zip_lo(
+    const vec_avx512<uint32_t> a, const vec_avx512<uint32_t> b) {
+  return vec_avx512<uint64_t>(_mm512_unpacklo_epi32(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> zip_lo(
+    const vec_avx512<int8_t> a, const vec_avx512<int8_t> b) {
+  return vec_avx512<int16_t>(_mm512_unpacklo_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> zip_lo(
+    const vec_avx512<int16_t> a, const vec_avx512<int16_t> b) {
+  return vec_avx512<int32_t>(_mm512_unpacklo_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> zip_lo(
+    const vec_avx512<int32_t> a, const vec_avx512<int32_t> b) {
+  return vec_avx512<int64_t>(_mm512_unpacklo_epi32(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t> zip_hi(
+    const vec_avx512<uint8_t> a, const vec_avx512<uint8_t> b) {
+  return vec_avx512<uint16_t>(_mm512_unpackhi_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> zip_hi(
+    const vec_avx512<uint16_t> a, const vec_avx512<uint16_t> b) {
+  return vec_avx512<uint32_t>(_mm512_unpackhi_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> zip_hi(
+    const vec_avx512<uint32_t> a, const vec_avx512<uint32_t> b) {
+  return vec_avx512<uint64_t>(_mm512_unpackhi_epi32(a.raw, b.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> zip_hi(
+    const vec_avx512<int8_t> a, const vec_avx512<int8_t> b) {
+  return vec_avx512<int16_t>(_mm512_unpackhi_epi8(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> zip_hi(
+    const vec_avx512<int16_t> a, const vec_avx512<int16_t> b) {
+  return vec_avx512<int32_t>(_mm512_unpackhi_epi16(a.raw, b.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> zip_hi(
+    const vec_avx512<int32_t> a, const vec_avx512<int32_t> b) {
+  return vec_avx512<int64_t>(_mm512_unpackhi_epi32(a.raw, b.raw));
+}
+
+// ------------------------------ Parts
+
+// Returns part of a vector (unspecified whether upper or lower).
+template <typename T, size_t N, size_t VN>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> any_part(
+    Desc<T, N, AVX512>, const vec_avx512<T, VN> v) {
+  return vec_avx512<T, N>(v.raw);  // shrink AVX512
+}
+template <typename T, size_t N, size_t VN>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<T, N> any_part(
+    Desc<T, N, AVX2>, const vec_avx512<T, VN> v) {
+  return vec_avx2<T, N>(_mm512_castsi512_si256(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<float, N> any_part(
+    Desc<float, N, AVX2>, vec_avx512<float> v) {
+  return vec_avx2<float, N>(_mm512_castps512_ps256(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<double, N> any_part(
+    Desc<double, N, AVX2>, vec_avx512<double> v) {
+  return vec_avx2<double, N>(_mm512_castpd512_pd256(v.raw));
+}
+template <typename T, size_t N, size_t VN>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_sse4<T, N> any_part(
+    Desc<T, N, SSE4>, const vec_avx512<T, VN> v) {
+  return vec_sse4<T, N>(_mm512_castsi512_si128(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_sse4<float, N> any_part(
+    Desc<float, N, SSE4>, vec_avx512<float> v) {
+  return vec_sse4<float, N>(_mm512_castps512_ps128(v.raw));
+}
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_sse4<double, N> any_part(
+    Desc<double, N, SSE4>, vec_avx512<double> v) {
+  return vec_sse4<double, N>(_mm512_castpd512_pd128(v.raw));
+}
+
+// Gets the single value stored in a vector/part.
+template <typename T, size_t N, class Target, size_t VN>
+SIMD_ATTR_AVX512 SIMD_INLINE T get_part(Desc<T, N, Target>,
+                                        const vec_avx512<T, VN> v) {
+  const Part<T, 1, AVX512> d;
+  return get_part(d, any_part(d, v));
+}
+
+// Returns full vector with the given part's lane broadcasted. Note that
+// callers cannot use broadcast directly because part lane order is undefined.
+template <int kLane, typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> broadcast_part(
+    Full<T, AVX512>, const vec_sse4<T, N> v) {
+  static_assert(0 <= kLane && kLane < N, "Invalid lane");
+  const auto v128 = broadcast<kLane>(vec_sse4<T>(v.raw));
+  return vec_avx512<T>(_mm512_broadcast_i32x4(v128.raw));
+}
+template <int kLane, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> broadcast_part(
+    Full<float, AVX512>, const vec_sse4<float, N> v) {
+  static_assert(0 <= kLane && kLane < N, "Invalid lane");
+  const auto v128 = broadcast<kLane>(vec_sse4<float>(v.raw));
+  return vec_avx512<float>(_mm512_broadcast_f32x4(v128.raw));
+}
+template <int kLane, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> broadcast_part(
+    Full<double, AVX512>, const vec_sse4<double, N> v) {
+  static_assert(0 <= kLane && kLane < N, "Invalid lane");
+  const auto v128 = broadcast<kLane>(vec_sse4<double>(v.raw));
+  return vec_avx512<double>(_mm512_broadcast_f64x2(v128.raw));
+}
+
+// ------------------------------ Blocks
+
+// As in x86_avx2.h, "halves" are the upper/lower 256 bits.
+
+// hiH,hiL loH,loL |-> hiL,loL (= lower halves)
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> concat_lo_lo(
+    const vec_avx512<T> hi, const vec_avx512<T> lo) {
+  return vec_avx512<T>(_mm512_shuffle_i64x2(lo.raw, hi.raw, 0x44));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> concat_lo_lo(
+    const vec_avx512<float> hi, const vec_avx512<float> lo) {
+  return vec_avx512<float>(_mm512_shuffle_f32x4(lo.raw, hi.raw, 0x44));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> concat_lo_lo(
+    const vec_avx512<double> hi, const vec_avx512<double> lo) {
+  return vec_avx512<double>(_mm512_shuffle_f64x2(lo.raw, hi.raw, 0x44));
+}
+
+// hiH,hiL loH,loL |-> hiH,loH (= upper halves)
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> concat_hi_hi(
+    const vec_avx512<T> hi, const vec_avx512<T> lo) {
+  return vec_avx512<T>(_mm512_shuffle_i64x2(lo.raw, hi.raw, 0xEE));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> concat_hi_hi(
+    const vec_avx512<float> hi, const vec_avx512<float> lo) {
+  return vec_avx512<float>(_mm512_shuffle_f32x4(lo.raw, hi.raw, 0xEE));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> concat_hi_hi(
+    const vec_avx512<double> hi, const vec_avx512<double> lo) {
+  return vec_avx512<double>(_mm512_shuffle_f64x2(lo.raw, hi.raw, 0xEE));
+}
+
+// hiH,hiL loH,loL |-> hiL,loH (= inner halves / swap halves)
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> concat_lo_hi(
+    const vec_avx512<T> hi, const vec_avx512<T> lo) {
+  return vec_avx512<T>(_mm512_shuffle_i64x2(lo.raw, hi.raw, 0x4E));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> concat_lo_hi(
+    const vec_avx512<float> hi, const vec_avx512<float> lo) {
+  return vec_avx512<float>(_mm512_shuffle_f32x4(lo.raw, hi.raw, 0x4E));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> concat_lo_hi(
+    const vec_avx512<double> hi, const vec_avx512<double> lo) {
+  return vec_avx512<double>(_mm512_shuffle_f64x2(lo.raw, hi.raw, 0x4E));
+}
+
+// hiH,hiL loH,loL |-> hiH,loL (= outer halves)
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> concat_hi_lo(
+    const vec_avx512<T> hi, const vec_avx512<T> lo) {
+  return vec_avx512<T>(_mm512_mask_blend_epi64(0x0F, hi.raw, lo.raw));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> concat_hi_lo(
+    const vec_avx512<float> hi, const vec_avx512<float> lo) {
+  return vec_avx512<float>(_mm512_mask_blend_ps(0x00FF, hi.raw, lo.raw));
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> concat_hi_lo(
+    const vec_avx512<double> hi, const vec_avx512<double> lo) {
+  return vec_avx512<double>(_mm512_mask_blend_pd(0x0F, hi.raw, lo.raw));
+}
+
+// ------------------------------ Odd/even lanes
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> odd_even_impl(
+    char (&sizeof_t)[1], const vec_avx512<T> a, const vec_avx512<T> b) {
+  return vec_avx512<T>(
+      _mm512_mask_blend_epi8(0x5555555555555555ull, a.raw, b.raw));
+}
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> odd_even_impl(
+    char (&sizeof_t)[2], const vec_avx512<T> a, const vec_avx512<T> b) {
+  return vec_avx512<T>(_mm512_mask_blend_epi16(0x55555555u, a.raw, b.raw));
+}
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> odd_even_impl(
+    char (&sizeof_t)[4], const vec_avx512<T> a, const vec_avx512<T> b) {
+  return vec_avx512<T>(_mm512_mask_blend_epi32(0x5555, a.raw, b.raw));
+}
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> odd_even_impl(
+    char (&sizeof_t)[8], const vec_avx512<T> a, const vec_avx512<T> b) {
+  return vec_avx512<T>(_mm512_mask_blend_epi64(0x55, a.raw, b.raw));
+}
+
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T> odd_even(const vec_avx512<T> a,
+                                                    const vec_avx512<T> b) {
+  char sizeof_t[sizeof(T)];
+  return odd_even_impl(sizeof_t, a, b);
+}
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float> odd_even<float>(
+    const vec_avx512<float> a, const vec_avx512<float> b) {
+  return vec_avx512<float>(_mm512_mask_blend_ps(0x5555, a.raw, b.raw));
+}
+
+template <>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<double> odd_even<double>(
+    const vec_avx512<double> a, const vec_avx512<double> b) {
+  return vec_avx512<double>(_mm512_mask_blend_pd(0x55, a.raw, b.raw));
+}
+
+// ================================================== CONVERT
+
+// ------------------------------ Shuffle bytes with variable indices
+
+// Returns vector of bytes[from[i]]. "from" is also interpreted as bytes:
+// either valid indices in [0, 16) or >= 0x80 to zero the i-th output byte.
+template <typename T, typename TI, size_t N, size_t NI>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> table_lookup_bytes(
+    const vec_avx512<T, N> bytes, const vec_avx512<TI, NI> from) {
+  return vec_avx512<T, N>(_mm512_shuffle_epi8(bytes.raw, from.raw));
+}
+
+// ------------------------------ Promotions (part w/ narrow lanes -> full)
+
+// Unsigned: zero-extend.
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint16_t> convert_to(
+    Full<uint16_t, AVX512>, const u8x32 v) {
+  return vec_avx512<uint16_t>(_mm512_cvtepu8_epi16(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> convert_to(
+    Full<uint32_t, AVX512>, const u8x16 v) {
+  return vec_avx512<uint32_t>(_mm512_cvtepu8_epi32(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> convert_to(
+    Full<int16_t, AVX512>, const u8x32 v) {
+  return vec_avx512<int16_t>(_mm512_cvtepu8_epi16(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> convert_to(
+    Full<int32_t, AVX512>, const u8x16 v) {
+  return vec_avx512<int32_t>(_mm512_cvtepu8_epi32(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> convert_to(
+    Full<uint32_t, AVX512>, const u16x16 v) {
+  return vec_avx512<uint32_t>(_mm512_cvtepu16_epi32(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> convert_to(
+    Full<int32_t, AVX512>, const u16x16 v) {
+  return vec_avx512<int32_t>(_mm512_cvtepu16_epi32(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> convert_to(
+    Full<uint64_t, AVX512>, const u32x8 v) {
+  return vec_avx512<uint64_t>(_mm512_cvtepu32_epi64(v.raw));
+}
+
+// Special case for "v" with all blocks equal (e.g. from broadcast_block or
+// load_dup128): single-cycle latency instead of 3.
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint32_t> u32_from_u8(
+    const vec_avx512<uint8_t> v) {
+  const Full<uint32_t, AVX512> d32;
+  SIMD_ALIGN static constexpr uint32_t k32From8[16] = {
+      0xFFFFFF00UL, 0xFFFFFF01UL, 0xFFFFFF02UL, 0xFFFFFF03UL,
+      0xFFFFFF04UL, 0xFFFFFF05UL, 0xFFFFFF06UL, 0xFFFFFF07UL,
+      0xFFFFFF08UL, 0xFFFFFF09UL, 0xFFFFFF0AUL, 0xFFFFFF0BUL,
+      0xFFFFFF0CUL, 0xFFFFFF0DUL, 0xFFFFFF0EUL, 0xFFFFFF0FUL};
+  return table_lookup_bytes(cast_to(d32, v), load(d32, k32From8));
+}
+
+// Signed: replicate sign bit.
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> convert_to(
+    Full<int16_t, AVX512>, const i8x32 v) {
+  return vec_avx512<int16_t>(_mm512_cvtepi8_epi16(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> convert_to(
+    Full<int32_t, AVX512>, const i8x16 v) {
+  return vec_avx512<int32_t>(_mm512_cvtepi8_epi32(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t> convert_to(
+    Full<int32_t, AVX512>, const i16x16 v) {
+  return vec_avx512<int32_t>(_mm512_cvtepi16_epi32(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int64_t> convert_to(
+    Full<int64_t, AVX512>, const i32x8 v) {
+  return vec_avx512<int64_t>(_mm512_cvtepi32_epi64(v.raw));
+}
+
+// ------------------------------ Demotions (full -> part w/ narrow lanes)
+
+// Unlike AVX2, VPMOV[US]* narrow across blocks, so no permute is required.
+// The unsigned-saturating variants interpret their input as unsigned, hence
+// negative inputs are first clamped to zero.
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<uint16_t> convert_to(
+    Part<uint16_t, 16, AVX512>, const vec_avx512<int32_t> v) {
+  const __m512i non_negative = _mm512_max_epi32(v.raw, _mm512_setzero_si512());
+  return vec_avx2<uint16_t>(_mm512_cvtusepi32_epi16(non_negative));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_sse4<uint8_t> convert_to(
+    Part<uint8_t, 16, AVX512>, const vec_avx512<int32_t> v) {
+  const __m512i non_negative = _mm512_max_epi32(v.raw, _mm512_setzero_si512());
+  return vec_sse4<uint8_t>(_mm512_cvtusepi32_epi8(non_negative));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<int16_t> convert_to(
+    Part<int16_t, 16, AVX512>, const vec_avx512<int32_t> v) {
+  return vec_avx2<int16_t>(_mm512_cvtsepi32_epi16(v.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_sse4<int8_t> convert_to(
+    Part<int8_t, 16, AVX512>, const vec_avx512<int32_t> v) {
+  return vec_sse4<int8_t>(_mm512_cvtsepi32_epi8(v.raw));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<uint8_t> convert_to(
+    Part<uint8_t, 32, AVX512>, const vec_avx512<int16_t> v) {
+  const __m512i non_negative = _mm512_max_epi16(v.raw, _mm512_setzero_si512());
+  return vec_avx2<uint8_t>(_mm512_cvtusepi16_epi8(non_negative));
+}
+
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx2<int8_t> convert_to(
+    Part<int8_t, 32, AVX512>, const vec_avx512<int16_t> v) {
+  return vec_avx2<int8_t>(_mm512_cvtsepi16_epi8(v.raw));
+}
+
+// For already range-limited input [0, 255].
+SIMD_ATTR_AVX512 SIMD_INLINE vec_sse4<uint8_t> u8_from_u32(
+    const vec_avx512<uint32_t> v) {
+  return vec_sse4<uint8_t>(_mm512_cvtepi32_epi8(v.raw));
+}
+
+// ------------------------------ Convert i32 <=> f32
+
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<float, N> convert_to(
+    Part<float, N, AVX512>, const vec_avx512<int32_t, N> v) {
+  return vec_avx512<float, N>(_mm512_cvtepi32_ps(v.raw));
+}
+// Truncates (rounds toward zero).
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> convert_to(
+    Part<int32_t, N, AVX512>, const vec_avx512<float, N> v) {
+  return vec_avx512<int32_t, N>(_mm512_cvttps_epi32(v.raw));
+}
+
+template <size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int32_t, N> nearest_int(
+    const vec_avx512<float, N> v) {
+  return vec_avx512<int32_t, N>(_mm512_cvtps_epi32(v.raw));
+}
+
+// ================================================== MISC
+
+// aes_round already defined by x86_sse4.h.
+
+// "Extensions": useful but not quite performance-portable operations. We add
+// functions to this namespace in multiple places.
+namespace ext {
+
+// ------------------------------ movemask
+
+// Returns a bit array of the most significant bit of each byte in "v", i.e.
+// sum_i=0..63 of (v[i] >> 7) << i; v[0] is the least-significant byte of "v".
+// This is useful for testing/branching based on comparison results.
+SIMD_ATTR_AVX512 SIMD_INLINE uint64_t movemask(const vec_avx512<uint8_t> v) {
+  return _mm512_movepi8_mask(v.raw);
+}
+
+// Returns the most significant bit of each float/double lane (see above).
+SIMD_ATTR_AVX512 SIMD_INLINE uint32_t movemask(const vec_avx512<float> v) {
+  return _mm512_movepi32_mask(_mm512_castps_si512(v.raw));
+}
+SIMD_ATTR_AVX512 SIMD_INLINE uint32_t movemask(const vec_avx512<double> v) {
+  return _mm512_movepi64_mask(_mm512_castpd_si512(v.raw));
+}
+
+// ------------------------------ all_zero
+
+// Returns whether all lanes are equal to zero. Supported for all integer V.
+template <typename T>
+SIMD_ATTR_AVX512 SIMD_INLINE bool all_zero(const vec_avx512<T> v) {
+  return _mm512_test_epi64_mask(v.raw, v.raw) == 0;
+}
+
+// ------------------------------ Horizontal sum (reduction)
+
+// Returns 64-bit sums of 8-byte groups.
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<uint64_t> sums_of_u8x8(
+    const vec_avx512<uint8_t> v) {
+  return vec_avx512<uint64_t>(_mm512_sad_epu8(v.raw, _mm512_setzero_si512()));
+}
+
+// Returns N sums of differences of byte quadruplets, starting from byte offset
+// i = [0, N) in window (11 consecutive bytes) and idx_ref * 4 in ref.
+// This version computes two independent SAD with separate idx_ref. There is no
+// 512-bit MPSADBW, so each 256-bit half is computed as in x86_avx2.h.
+template <int idx_ref1, int idx_ref0>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<int16_t> mpsadbw2(
+    const vec_avx512<uint8_t> window, const vec_avx512<uint8_t> ref) {
+  const __m256i lo =
+      _mm256_mpsadbw_epu8(lower_half(window).raw, lower_half(ref).raw,
+                          (idx_ref1 << 3) + idx_ref0);
+  const __m256i hi =
+      _mm256_mpsadbw_epu8(upper_half(window).raw, upper_half(ref).raw,
+                          (idx_ref1 << 3) + idx_ref0);
+  return vec_avx512<int16_t>(
+      _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1));
+}
+
+// Returns sum{lane[i]} in each lane. "v3210" is a replicated 128-bit block.
+// Same logic as x86_sse4.h, but with vec_avx512 arguments.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> horz_sum_impl(
+    char (&sizeof_t)[4], const vec_avx512<T, N> v3210) {
+  const auto v1032 = shuffle_1032(v3210);
+  const auto v31_20_31_20 = v3210 + v1032;
+  const auto v20_31_20_31 = shuffle_0321(v31_20_31_20);
+  return v20_31_20_31 + v31_20_31_20;
+}
+
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> horz_sum_impl(
+    char (&sizeof_t)[8], const vec_avx512<T, N> v10) {
+  const auto v01 = shuffle_01(v10);
+  return v10 + v01;
+}
+
+// Supported for {uif}32x16, {uif}64x8. Returns the sum in each lane.
+template <typename T, size_t N>
+SIMD_ATTR_AVX512 SIMD_INLINE vec_avx512<T, N> sum_of_lanes(
+    const vec_avx512<T, N> v) {
+  // Reduce the four 128-bit blocks to one replicated block: first add the
+  // swapped 256-bit halves, then the swapped adjacent blocks.
+  const __m512i bits = BitCastToInteger(v.raw);
+  const vec_avx512<T, N> v_halves(
+      BitCastFromIntegerAVX512<T>()(_mm512_shuffle_i64x2(bits, bits, 0x4E)));
+  const vec_avx512<T, N> sum2 = v + v_halves;
+  const __m512i bits2 = BitCastToInteger(sum2.raw);
+  const vec_avx512<T, N> v_blocks(
+      BitCastFromIntegerAVX512<T>()(_mm512_shuffle_i64x2(bits2, bits2, 0xB1)));
+  char sizeof_t[sizeof(T)];
+  return horz_sum_impl(sizeof_t, sum2 + v_blocks);
+}
+
+}  // namespace ext
+
+SIMD_DIAGNOSTICS(pop)
+
+#endif  // SIMD_DEPS
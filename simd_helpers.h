@@ -77,6 +77,43 @@ struct FastDivision<float, V> {
   V operator()(const V n, const V d) const { return n * ReciprocalNR(d); }
 };
 
+// IEEE binary16 ("half") <-> float for compact storage of finite values,
+// using integer ops instead of F16C/fcvt so that all targets agree. Rescaling
+// by 2^+-112 rebiases the exponent, including for subnormal halves.
+
+// Returns D::N floats from the halves at "p".
+template <class D>
+static SIMD_INLINE typename D::V LoadF16(D d, const uint16_t* SIMD_RESTRICT p) {
+  const SIMD_NAMESPACE::Part<uint16_t, D::N> d16;
+  const SIMD_NAMESPACE::Part<int32_t, D::N> d32;
+  const auto bits = convert_to(d32, load(d16, p));
+  const auto abs_bits = bits & set1(d32, 0x7FFF);
+  const auto sign = SIMD_NAMESPACE::shift_left<16>(bits ^ abs_bits);
+  const auto abs = cast_to(d, SIMD_NAMESPACE::shift_left<13>(abs_bits)) *
+                   set1(d, 5.192296858534828e+33f);  // 2^112
+  return abs | cast_to(d, sign);
+}
+
+// Rounds "v" to the nearest (even) half, saturating to the largest finite one.
+// Subnormal halves may be one ulp off due to double rounding.
+template <class D>
+static SIMD_INLINE void StoreF16(const typename D::V v, D d,
+                                 uint16_t* SIMD_RESTRICT p) {
+  const SIMD_NAMESPACE::Part<uint16_t, D::N> d16;
+  const SIMD_NAMESPACE::Part<int32_t, D::N> d32;
+  const auto bits = cast_to(d32, v);
+  const auto sign =
+      SIMD_NAMESPACE::shift_right<16>(bits) & set1(d32, 0x8000);
+  const auto abs = cast_to(d, bits & set1(d32, 0x7FFFFFFF));
+  const auto scaled =
+      cast_to(d32, abs * set1(d, 1.925929944387236e-34f));  // 2^-112
+  const auto odd = SIMD_NAMESPACE::shift_right<13>(scaled) & set1(d32, 1);
+  const auto rounded =
+      SIMD_NAMESPACE::shift_right<13>(scaled + set1(d32, 0xFFF) + odd);
+  const auto half = min(rounded, set1(d32, 0x7BFF)) | sign;
+  store(convert_to(d16, half), d16, p);
+}
+
 }  // namespace pik
 
 #endif  // SIMD_HELPERS_H_
@@ -0,0 +1,1156 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STATIC_HISTOGRAMS_H_
+#define STATIC_HISTOGRAMS_H_
+
+// Built-in AC histograms for Header::kStaticHistograms, only included by
+// entropy_coder.cc. Generated by train_static_histograms (see there for the
+// corpus); do not edit. Each set is a histogram section as written by
+// BuildAndEncodeHistogramsFast for the tokens of one distance, blended as
+// described in TrainStaticHistograms.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace pik {
+
+// Distance 1.0.
+static const uint8_t kStaticHistograms1[4424] = {
+    0x7b, 0x16, 0x68, 0x41, 0x74, 0x6d, 0xfe, 0x87, 0x8d, 0x3b, 0x00, 0x00,
+    0x00, 0x00, 0x1b, 0xee, 0x8e, 0xd9, 0xeb, 0x65, 0xb3, 0x75, 0xf3, 0xfd,
+    0x9d, 0xe7, 0x60, 0xfb, 0x87, 0xdb, 0x3f, 0xda, 0xfe, 0xf1, 0xce, 0x77,
+    0x92, 0xd3, 0x3e, 0x83, 0x73, 0x30, 0xb6, 0x20, 0x5c, 0xb4, 0x11, 0x04,
+    0xdb, 0x08, 0xc2, 0x25, 0x0d, 0x0c, 0x5c, 0xb5, 0x11, 0x6c, 0xdb, 0x08,
+    0x96, 0x6d, 0x84, 0xeb, 0xdc, 0xf4, 0x2d, 0xdc, 0x81, 0xb1, 0x05, 0xe1,
+    0xbe, 0x8d, 0x20, 0xd8, 0x46, 0x10, 0x1e, 0x68, 0x60, 0xe0, 0xb1, 0x8d,
+    0x60, 0xdb, 0x46, 0xb0, 0x6c, 0x23, 0x3c, 0xe5, 0xb9, 0x5f, 0xe0, 0x15,
+    0x8c, 0x2d, 0x08, 0x6f, 0x6d, 0x04, 0xc1, 0x36, 0x82, 0xf0, 0x4e, 0x03,
+    0x03, 0x1f, 0x6d, 0x04, 0xdb, 0x36, 0x82, 0x65, 0x1b, 0xe1, 0x33, 0x5f,
+    0xfd, 0x0d, 0x3f, 0x60, 0x6c, 0x41, 0xf8, 0x6d, 0x23, 0x08, 0xb6, 0x11,
+    0x84, 0x3f, 0x1a, 0x18, 0xf8, 0x6f, 0x23, 0xd8, 0xb6, 0x11, 0x2c, 0xdb,
+    0x08, 0x6b, 0x96, 0x1e, 0x58, 0xc0, 0xd8, 0x82, 0xb0, 0xb6, 0x11, 0x04,
+    0xdb, 0x08, 0xc2, 0x42, 0x03, 0x03, 0x6b, 0x1b, 0xc1, 0xb6, 0x8d, 0x60,
+    0xd9, 0x46, 0x58, 0xb3, 0xf4, 0xc0, 0x02, 0xc6, 0x16, 0x84, 0xb5, 0x8d,
+    0x20, 0xd8, 0x46, 0x10, 0x16, 0x1a, 0x18, 0x58, 0xdb, 0x08, 0xb6, 0x6d,
+    0x04, 0xcb, 0x36, 0x42, 0x1a, 0xf1, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0x91, 0x6d, 0x03, 0x00, 0x00, 0xd8, 0xb6, 0x6d, 0xdb,
+    0xb2, 0xa4, 0x3b, 0x49, 0xba, 0x3b, 0x9f, 0xac, 0xdb, 0xd5, 0xcc, 0x8d,
+    0xb4, 0x96, 0x46, 0x2a, 0x52, 0xb0, 0x06, 0x65, 0x85, 0x0f, 0x1d, 0x46,
+    0x38, 0x34, 0xe2, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0x73, 0xba, 0x93, 0xc4, 0xf7, 0xc5, 0x96, 0x24, 0x49, 0xba, 0xbb, 0xd3,
+    0xdd, 0xed, 0xdd, 0xee, 0xee, 0xdd, 0xee, 0xde, 0xde, 0xdd, 0xce, 0xdc,
+    0xcc, 0xce, 0x62, 0x76, 0xa6, 0x59, 0x03, 0x78, 0x1a, 0x07, 0x0b, 0x69,
+    0xc4, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0x74,
+    0x27, 0x49, 0xb4, 0x0d, 0x96, 0xa4, 0xbb, 0xbb, 0xbb, 0xbb, 0xbd, 0xbd,
+    0xdb, 0xdd, 0xdd, 0xdb, 0xd9, 0xdb, 0xbd, 0xdd, 0x99, 0x9b, 0xd9, 0x59,
+    0x8c, 0x65, 0xa6, 0xd5, 0x8d, 0xf9, 0xc3, 0x41, 0x91, 0x46, 0xbc, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xf6, 0x76, 0xef, 0xee,
+    0x64, 0x92, 0x36, 0xc1, 0xd2, 0xdd, 0xdd, 0xed, 0xde, 0xee, 0xce, 0xee,
+    0xee, 0xce, 0xcc, 0xce, 0xee, 0xce, 0xcc, 0xce, 0xec, 0x2c, 0x7b, 0x9f,
+    0xc6, 0x47, 0xdd, 0x88, 0x61, 0x85, 0x46, 0xbc, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0x76, 0x77, 0xf7, 0xee, 0xee, 0x24, 0x43,
+    0x92, 0x24, 0x01, 0x6c, 0x49, 0x77, 0x7b, 0xbb, 0xbb, 0x33, 0xb3, 0xb3,
+    0xbb, 0x33, 0xb3, 0x33, 0x33, 0x23, 0x21, 0x01, 0xb7, 0xe5, 0xd0, 0x44,
+    0x04, 0x1a, 0x40, 0x23, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x37, 0xbb, 0xbb, 0x7b, 0x77, 0x77, 0x77, 0x77, 0x77, 0x27, 0xd9,
+    0xb6, 0x01, 0x00, 0x6c, 0xdb, 0xb6, 0x0d, 0x24, 0xe8, 0xb4, 0xbb, 0x77,
+    0x12, 0x00, 0x8a, 0x32, 0x44, 0x02, 0x00, 0xd7, 0x8a, 0xd2, 0x4d, 0xfd,
+    0xd0, 0x88, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd,
+    0xe9, 0x4e, 0x92, 0x24, 0x49, 0x92, 0xa4, 0xbb, 0xbb, 0xbb, 0xbb, 0xdb,
+    0xdb, 0xbb, 0xdd, 0xbb, 0xbb, 0xbd, 0xd3, 0x49, 0x5a, 0xa9, 0x52, 0xaf,
+    0x18, 0xcb, 0xb5, 0x0a, 0xce, 0x9f, 0x30, 0x0d, 0x76, 0x48, 0xa4, 0x11,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x1b, 0xd9, 0x36,
+    0x00, 0x00, 0x80, 0x6d, 0xdb, 0xb6, 0x2d, 0x4b, 0x3a, 0x49, 0xd2, 0xdd,
+    0xf9, 0x64, 0xdd, 0xae, 0x66, 0x6e, 0xa4, 0xb5, 0x22, 0x52, 0x91, 0x82,
+    0x55, 0x28, 0x2b, 0x3c, 0xd4, 0x61, 0x84, 0xc3, 0xea, 0x6d, 0x13, 0xac,
+    0xbb, 0xdb, 0xdd, 0xdd, 0xd9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x0b, 0x23, 0x90, 0x87, 0xd5, 0xb1, 0x6c, 0xdb,
+    0xd8, 0x06, 0x00, 0x00, 0xb0, 0x2d, 0xdd, 0xe9, 0xee, 0x6e, 0x77, 0x77,
+    0x77, 0x67, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x86,
+    0x65, 0xc7, 0x9f, 0x88, 0xdc, 0xef, 0x32, 0x8b, 0xcd, 0x4d, 0x58, 0x1d,
+    0xcb, 0x92, 0x24, 0x59, 0xb6, 0x6d, 0x1b, 0x00, 0x00, 0x83, 0xc1, 0xb6,
+    0x25, 0x9d, 0xf6, 0xee, 0x6e, 0xef, 0xee, 0x76, 0xe6, 0x76, 0x66, 0x76,
+    0xa6, 0x83, 0x72, 0x06, 0x28, 0x81, 0x48, 0x89, 0x70, 0x34, 0xb0, 0x72,
+    0x64, 0x06, 0x60, 0x75, 0xb0, 0x25, 0x49, 0x92, 0x24, 0xdd, 0x9d, 0x4e,
+    0x3a, 0x49, 0xb6, 0x01, 0x00, 0xb0, 0x6d, 0x4b, 0x92, 0x24, 0x49, 0x77,
+    0x77, 0xd2, 0x4a, 0xb7, 0x28, 0x01, 0x84, 0xc2, 0xad, 0x2a, 0x0e, 0x44,
+    0xd3, 0x22, 0x2b, 0x5c, 0x9d, 0xe0, 0x00, 0xc6, 0xcb, 0xbe, 0x96, 0x2e,
+    0x89, 0xe7, 0x3c, 0x3b, 0x33, 0xa3, 0x99, 0x99, 0x99, 0xd9, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc,
+    0x79, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b,
+    0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0x6f, 0xb2, 0x21, 0x48, 0x11, 0x5e, 0xf6, 0x95, 0xeb, 0xc6,
+    0x78, 0x3c, 0x3e, 0x6b, 0x76, 0x77, 0x67, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0xe6, 0xbd, 0x99, 0x79, 0x33, 0xf3, 0xe6,
+    0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xa1, 0x47, 0x13, 0x84, 0xe0, 0x65, 0x5f, 0x9b, 0x18, 0xe0,
+    0x90, 0x74, 0xb7, 0x92, 0x6e, 0x75, 0xb3, 0xb7, 0x3b, 0x33, 0xbb, 0x33,
+    0xb3, 0x33, 0xb3, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0xef, 0xcd, 0xcc, 0x9b, 0x99, 0x37, 0x6f, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xcd, 0x91, 0x7b, 0xd6, 0x8d, 0x0a, 0x4e, 0x01, 0x2f, 0xfb, 0xda, 0xc4,
+    0x80, 0xcf, 0x92, 0x75, 0x73, 0xba, 0xdd, 0xbd, 0x5d, 0xdd, 0xce, 0xcc,
+    0xcd, 0xce, 0xce, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd,
+    0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xa3, 0xaa, 0x2c, 0x5c, 0x47, 0x02, 0x58, 0xbc, 0xec, 0xfb,
+    0xbe, 0xe4, 0xcc, 0xcd, 0x8e, 0xe6, 0x66, 0x66, 0x6e, 0x66, 0x67, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xde, 0x9b, 0x99,
+    0x37, 0x33, 0x6f, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x1b, 0x21, 0xcf, 0x02, 0x2f, 0xfb, 0xda,
+    0xba, 0xe2, 0x96, 0xf5, 0xdc, 0x8c, 0x66, 0x67, 0x34, 0x33, 0x3b, 0x33,
+    0xb3, 0x3b, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3, 0xde, 0xcc, 0xbc, 0x99,
+    0x79, 0xf3, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0xfc, 0x2f, 0x84, 0x31, 0x0a, 0x2f, 0xfb, 0xd2,
+    0xaa, 0xe7, 0xdd, 0x8e, 0x66, 0x67, 0x98, 0x99, 0xd1, 0xcc, 0xcc, 0xcc,
+    0xcc, 0x69, 0x66, 0x66, 0x66, 0x66, 0x66, 0x67, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xf6, 0xbd, 0x99, 0x79, 0x33,
+    0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0x21, 0xdf, 0x28, 0x2e, 0x07, 0x2f, 0xfb, 0xda,
+    0x44, 0x21, 0x9a, 0xf3, 0x49, 0x3b, 0xa3, 0xd5, 0xde, 0xec, 0xed, 0xec,
+    0xcc, 0xcc, 0xce, 0xec, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66,
+    0xde, 0xbc, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef,
+    0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0x37, 0xcd, 0x94, 0xf1, 0xbd, 0x00, 0x81, 0x97, 0x7d,
+    0x6d, 0x02, 0xb1, 0x4f, 0x96, 0xb5, 0x33, 0x9a, 0xbd, 0x99, 0x39, 0x69,
+    0x66, 0xe6, 0xee, 0x76, 0x67, 0x67, 0x66, 0x66, 0xf6, 0x66, 0x66, 0x76,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xe6, 0xbd, 0x99, 0x79, 0x33,
+    0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xb1, 0x5a, 0x8c, 0xfa, 0x22, 0x02, 0x30, 0xbc,
+    0xec, 0xeb, 0x57, 0x70, 0x74, 0x77, 0x5e, 0xef, 0xce, 0x6a, 0xe6, 0x66,
+    0xe6, 0x74, 0x33, 0x33, 0xbb, 0x3b, 0xbb, 0x3b, 0xb3, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xef, 0xcd,
+    0xcc, 0x9b, 0x99, 0x37, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0xda, 0x65, 0xdc, 0x83, 0xe2,
+    0xca, 0xcb, 0xbe, 0x96, 0x1c, 0xc1, 0x6b, 0xc9, 0xba, 0x39, 0xdf, 0xce,
+    0xee, 0xae, 0x34, 0x33, 0xa3, 0xb9, 0xd9, 0x9d, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x79, 0x6f,
+    0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6,
+    0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0x98, 0xde, 0x44, 0xf5, 0x04,
+    0x71, 0x80, 0x97, 0x7d, 0xfd, 0x4a, 0x8c, 0xce, 0xcb, 0x6a, 0xe6, 0x46,
+    0x33, 0x9a, 0x99, 0xdb, 0x9d, 0xb9, 0x99, 0x9b, 0x99, 0x99, 0xb9, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0x78, 0x9e, 0x1e,
+    0xc5, 0xd1, 0xe0, 0x65, 0x5f, 0xfb, 0xb9, 0xc7, 0x0e, 0xe3, 0xb9, 0x99,
+    0x9b, 0x99, 0xd1, 0xcc, 0xec, 0xcc, 0xcc, 0xee, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x13, 0xdd,
+    0x81, 0xee, 0xe3, 0x65, 0x5f, 0xda, 0xfb, 0x46, 0x33, 0x1d, 0xcd, 0xce,
+    0x30, 0x33, 0xa3, 0x99, 0x99, 0x99, 0x19, 0xdd, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xce, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xec, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x13, 0xea,
+    0xd1, 0x22, 0xe0, 0x65, 0x5f, 0xeb, 0x0e, 0x09, 0x73, 0xde, 0x9b, 0x99,
+    0xd1, 0xcc, 0xcc, 0xcc, 0xdc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66, 0xde, 0xbc, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0x37, 0xa9,
+    0x82, 0x14, 0x2f, 0xfb, 0x9a, 0xeb, 0xc6, 0xf6, 0x68, 0x25, 0xdd, 0xec,
+    0xcd, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xc3, 0xab, 0x9e,
+    0x18, 0xf0, 0xb2, 0xaf, 0x4d, 0x00, 0x2c, 0xf9, 0x7c, 0xb7, 0xab, 0xbd,
+    0xdd, 0x9d, 0xbb, 0x9d, 0x99, 0xd9, 0xdd, 0xd9, 0x9d, 0x99, 0x9d, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x79,
+    0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xfa, 0x0b, 0x1b, 0xa8,
+    0x68, 0x8c, 0x00, 0x2f, 0xfb, 0xda, 0xc4, 0x80, 0xcf, 0x92, 0x75, 0x73,
+    0xba, 0xdd, 0xdd, 0x5d, 0xdd, 0xcc, 0xcc, 0xcd, 0xce, 0xce, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xb3, 0xaa, 0x2c,
+    0x5c, 0x47, 0x22, 0x28, 0x5e, 0xf6, 0x7d, 0x5f, 0x22, 0xa3, 0xb9, 0xd1,
+    0xdc, 0xcc, 0xcc, 0xce, 0xec, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0x53, 0x92, 0x15, 0x87, 0x97, 0x7d, 0x6d, 0x5d, 0x71, 0xcb, 0x7a, 0x6e,
+    0x46, 0xb3, 0x33, 0x9a, 0x99, 0x9d, 0x99, 0xd9, 0x9d, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xfe,
+    0x17, 0xc2, 0x18, 0x85, 0x97, 0x7d, 0x69, 0xd5, 0xf3, 0x6e, 0x47, 0xb3,
+    0x33, 0xcc, 0xcc, 0x68, 0x66, 0x66, 0x66, 0xe6, 0x34, 0x33, 0x33, 0x33,
+    0x33, 0xb3, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0xfb, 0xde, 0xcc, 0xbc, 0x99, 0x79, 0xf3, 0xe6, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x90,
+    0x6f, 0x14, 0x97, 0x83, 0x97, 0x7d, 0x6d, 0x62, 0x12, 0xee, 0xbc, 0x37,
+    0x33, 0xe3, 0x99, 0x9d, 0x99, 0xd9, 0x99, 0x99, 0x99, 0x9d, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0x78,
+    0x0a, 0x6b, 0x9c, 0xc3, 0xcb, 0xbe, 0x96, 0x10, 0xdb, 0xf2, 0x59, 0xd6,
+    0xdc, 0xed, 0x68, 0x66, 0x76, 0x6f, 0x66, 0x66, 0xf7, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0xf6, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0xe6, 0xbd, 0x99, 0x79, 0x33, 0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x11, 0x1f,
+    0xd8, 0x38, 0xaa, 0x22, 0xe1, 0x65, 0x5f, 0xbf, 0x12, 0xa3, 0xf3, 0x79,
+    0xb5, 0xbb, 0xab, 0xdd, 0xdb, 0x99, 0xbb, 0x9d, 0xd9, 0xd9, 0xdd, 0xd9,
+    0x9d, 0x99, 0x9d, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xf6, 0x2a, 0xe9, 0xf8, 0x86, 0x48, 0xe0, 0x65, 0x5f, 0x9b, 0x00, 0xb6,
+    0x24, 0xf9, 0x6e, 0x56, 0xbb, 0xbb, 0x3b, 0x7b, 0x37, 0x33, 0xb3, 0xb3,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0xf3, 0xde, 0xcc, 0xbc, 0x99, 0x79, 0xf3, 0xe6,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0xf4, 0xa7, 0xd5, 0xd8, 0x28, 0x65, 0xf1, 0xb2, 0xef, 0xfb, 0x92,
+    0x18, 0x2d, 0xeb, 0xd1, 0x8c, 0x46, 0x33, 0x9a, 0x99, 0xdd, 0x9d, 0xb9,
+    0x99, 0x9b, 0x9d, 0x99, 0x99, 0x99, 0x9d, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0xd9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc,
+    0x79, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b,
+    0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0x6f, 0xe0, 0x90, 0xad, 0x00, 0x84, 0xc0, 0xcb, 0xbe, 0xb4,
+    0xee, 0x79, 0x27, 0xe3, 0xb9, 0x19, 0xcf, 0xcc, 0x68, 0x66, 0x76, 0x66,
+    0xe6, 0x6e, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xe6, 0xbd, 0x99, 0x79, 0x33,
+    0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf9, 0xa3, 0xc4, 0x1c, 0x78, 0xd9, 0x47, 0x7a,
+    0x1d, 0xcd, 0x74, 0x34, 0x33, 0x93, 0x99, 0x19, 0xcd, 0xcc, 0xcc, 0xcc,
+    0x1c, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3b, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x73, 0xef, 0xcd, 0xcc, 0x9b, 0x99,
+    0x37, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b,
+    0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0x8d, 0xcf, 0xd9, 0x68, 0x0c,
+};
+
+// Distance 1.5.
+static const uint8_t kStaticHistograms2[4424] = {
+    0x7b, 0x16, 0x68, 0x41, 0x74, 0x6d, 0xfe, 0x87, 0x8d, 0x3b, 0x00, 0x00,
+    0x00, 0x00, 0x1b, 0xee, 0x8e, 0xd9, 0xeb, 0x65, 0xb3, 0x75, 0xf3, 0xfd,
+    0x9d, 0xe7, 0x60, 0xfb, 0x87, 0xdb, 0x3f, 0xda, 0xfe, 0xf1, 0xce, 0x77,
+    0x92, 0xd3, 0x3e, 0x83, 0x73, 0x30, 0xb6, 0x20, 0x5c, 0xb4, 0x11, 0x04,
+    0xdb, 0x08, 0xc2, 0x25, 0x0d, 0x0c, 0x5c, 0xb5, 0x11, 0x6c, 0xdb, 0x08,
+    0x96, 0x6d, 0x84, 0xeb, 0xdc, 0xf4, 0x2d, 0xdc, 0x81, 0xb1, 0x05, 0xe1,
+    0xbe, 0x8d, 0x20, 0xd8, 0x46, 0x10, 0x1e, 0x68, 0x60, 0xe0, 0xb1, 0x8d,
+    0x60, 0xdb, 0x46, 0xb0, 0x6c, 0x23, 0x3c, 0xe5, 0xb9, 0x5f, 0xe0, 0x15,
+    0x8c, 0x2d, 0x08, 0x6f, 0x6d, 0x04, 0xc1, 0x36, 0x82, 0xf0, 0x4e, 0x03,
+    0x03, 0x1f, 0x6d, 0x04, 0xdb, 0x36, 0x82, 0x65, 0x1b, 0xe1, 0x33, 0x5f,
+    0xfd, 0x0d, 0x3f, 0x60, 0x6c, 0x41, 0xf8, 0x6d, 0x23, 0x08, 0xb6, 0x11,
+    0x84, 0x3f, 0x1a, 0x18, 0xf8, 0x6f, 0x23, 0xd8, 0xb6, 0x11, 0x2c, 0xdb,
+    0x08, 0x6b, 0x96, 0x1e, 0x58, 0xc0, 0xd8, 0x82, 0xb0, 0xb6, 0x11, 0x04,
+    0xdb, 0x08, 0xc2, 0x42, 0x03, 0x03, 0x6b, 0x1b, 0xc1, 0xb6, 0x8d, 0x60,
+    0xd9, 0x46, 0x58, 0xb3, 0xf4, 0xc0, 0x02, 0xc6, 0x16, 0x84, 0xb5, 0x8d,
+    0x20, 0xd8, 0x46, 0x10, 0x16, 0x1a, 0x18, 0x58, 0xdb, 0x08, 0xb6, 0x6d,
+    0x04, 0xcb, 0x36, 0x42, 0x1a, 0xf1, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xd9, 0xbb, 0xe3, 0xfb, 0x1a, 0x2c, 0x49, 0x77, 0x77,
+    0x77, 0xb7, 0x77, 0x77, 0x7b, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0x33, 0xb7,
+    0xbb, 0x3b, 0x33, 0x3b, 0xb3, 0xb3, 0xd1, 0x10, 0x88, 0x80, 0x43, 0xc8,
+    0x20, 0x16, 0x1a, 0xf1, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x39, 0xdd, 0x89, 0xb4, 0x0d, 0xb6, 0x24, 0xdd, 0xdd, 0xdd, 0xdd,
+    0xdd, 0xde, 0xde, 0xed, 0xee, 0xee, 0xed, 0xec, 0xed, 0xde, 0xee, 0xcc,
+    0xcd, 0xec, 0x2c, 0x06, 0x3b, 0x22, 0xed, 0xe1, 0xf8, 0xe1, 0xa0, 0x48,
+    0x23, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0x7b,
+    0x77, 0x27, 0x43, 0xbf, 0x06, 0x5b, 0xba, 0xbb, 0xbb, 0xbb, 0xbb, 0xbd,
+    0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0x99, 0xdb, 0xbd, 0x9d, 0x99, 0x9d, 0xd9,
+    0xd9, 0x49, 0x38, 0xd5, 0x3a, 0x35, 0x20, 0xc3, 0x68, 0x68, 0xc4, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0x66, 0x6f, 0xf7, 0x4e,
+    0x32, 0x49, 0xdb, 0x80, 0x2d, 0xdd, 0xdd, 0xdd, 0xde, 0xee, 0xce, 0xee,
+    0xee, 0xce, 0xcc, 0xce, 0xee, 0xce, 0xcc, 0xce, 0xcc, 0x2c, 0x8b, 0x49,
+    0x16, 0xa0, 0x63, 0xb2, 0x32, 0xac, 0x68, 0xc4, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0x66, 0x6f, 0xf7, 0xee, 0x4e, 0x92, 0x0d,
+    0x49, 0x92, 0x00, 0xb6, 0x2d, 0x49, 0x77, 0xbb, 0xbb, 0x33, 0xb3, 0xb3,
+    0xbb, 0x33, 0xb3, 0x33, 0x33, 0xcb, 0x8e, 0x37, 0xaf, 0x45, 0xf9, 0xf4,
+    0x36, 0xc1, 0x17, 0x34, 0xe2, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xb3, 0xbb, 0xbb, 0x77, 0x77, 0x77, 0x77, 0x77, 0xd2, 0x49,
+    0xb6, 0x6c, 0xdb, 0xb6, 0x6d, 0x20, 0x41, 0xce, 0x91, 0x99, 0x99, 0x9d,
+    0x99, 0x19, 0x09, 0x20, 0x24, 0x38, 0x55, 0x33, 0x61, 0x3b, 0xf6, 0x15,
+    0x1a, 0xf1, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x91,
+    0x6d, 0x03, 0x00, 0x00, 0xd8, 0xb6, 0x6d, 0xdb, 0xb2, 0xa4, 0x93, 0x24,
+    0xdd, 0x9d, 0x4f, 0xd6, 0xed, 0x6a, 0xe6, 0x46, 0x5a, 0x2b, 0x22, 0x15,
+    0x29, 0x58, 0x85, 0xb2, 0xc2, 0x43, 0x1d, 0x46, 0x38, 0x34, 0xe2, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x23, 0xdb, 0x06, 0x00,
+    0x00, 0xb0, 0x6d, 0xdb, 0xb6, 0x65, 0x49, 0x27, 0x49, 0xba, 0x3b, 0x9f,
+    0xac, 0xdb, 0xd5, 0xcc, 0x8d, 0xb4, 0x56, 0x44, 0x2a, 0x52, 0xb0, 0x0a,
+    0x65, 0x85, 0x87, 0x3a, 0x8c, 0x70, 0x58, 0xbd, 0x4d, 0xd0, 0xdd, 0xdd,
+    0xdd, 0xee, 0xee, 0xee, 0xee, 0xce, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0x4c, 0x5e, 0x78, 0x18, 0xc0, 0xea, 0xd8, 0xb6, 0x6d, 0x1b,
+    0x00, 0x00, 0x00, 0x6c, 0x4b, 0x3a, 0xdd, 0xdd, 0xee, 0xce, 0xee, 0xec,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xce, 0xcc, 0xcc, 0xc0, 0xee,
+    0x0f, 0x44, 0x1a, 0xeb, 0xb6, 0xd2, 0xf6, 0x2d, 0x03, 0x56, 0xc7, 0xb6,
+    0x24, 0x49, 0x92, 0x24, 0xdb, 0x06, 0x00, 0x00, 0xc0, 0xb6, 0xee, 0xee,
+    0x6e, 0xef, 0xee, 0x76, 0x77, 0x77, 0x76, 0x76, 0x67, 0x76, 0x77, 0x67,
+    0x42, 0x50, 0xeb, 0x94, 0x1a, 0x19, 0x4b, 0xb6, 0x0b, 0x60, 0xb9, 0x57,
+    0x02, 0xb1, 0x3a, 0x80, 0x2d, 0x5b, 0x92, 0x25, 0x49, 0x3a, 0x9d, 0x24,
+    0xc9, 0xb6, 0x6c, 0xdb, 0xb6, 0x6d, 0x4b, 0x92, 0x24, 0xe9, 0x76, 0x24,
+    0x49, 0xf2, 0xcd, 0x3c, 0xa3, 0x41, 0x83, 0xce, 0x72, 0xe4, 0x40, 0x8c,
+    0x8c, 0xe8, 0x52, 0x08, 0x80, 0x19, 0xbc, 0xec, 0x6b, 0xdd, 0x71, 0xe2,
+    0xb9, 0x9b, 0x9d, 0x99, 0xd9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79,
+    0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0x6f, 0x4c, 0x19, 0x79, 0x79, 0xd9, 0xf7, 0xa1, 0x6f, 0x23, 0x34,
+    0x5a, 0xad, 0x34, 0xbb, 0xb3, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0xf3, 0xde, 0xcc, 0xbc, 0x99, 0x79, 0xf3, 0xe6,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x00, 0x59, 0x39, 0x98, 0xe0, 0x65, 0x5f, 0xdb, 0x00, 0xb6, 0xe4,
+    0xf3, 0xdd, 0xae, 0x76, 0x6f, 0x77, 0xee, 0x6e, 0x66, 0x66, 0x77, 0x67,
+    0x77, 0x66, 0x76, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0xe6, 0xbd, 0x99, 0x79, 0x33, 0xf3, 0xe6, 0xcd, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x79, 0x90, 0x62, 0xe1, 0x82, 0x21, 0x00, 0xbc, 0xec, 0x6b, 0x13, 0x03,
+    0x3e, 0x4b, 0xd6, 0xcd, 0xe9, 0x76, 0x77, 0x77, 0x75, 0x33, 0x33, 0x37,
+    0x3b, 0x3b, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0xef, 0xcd, 0xcc, 0x9b, 0x99, 0x37, 0x6f,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xcd,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xcd, 0xaa, 0xb2, 0x70, 0x1d, 0x89, 0xa0, 0x78, 0xd9, 0xf7, 0x7d,
+    0xc4, 0xe6, 0xf6, 0x46, 0x73, 0x33, 0x33, 0x3b, 0xb3, 0x33, 0xb3, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xef, 0xcd, 0xcc, 0x9b,
+    0x99, 0x37, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x78, 0x18, 0x22, 0xbc, 0xec, 0x6b, 0xeb,
+    0x8a, 0x5b, 0xd6, 0x73, 0x33, 0x9a, 0x9d, 0xd1, 0xcc, 0xec, 0xcc, 0xcc,
+    0xee, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6,
+    0xcd, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xf3, 0xbf, 0x10, 0xc6, 0x28, 0xbc, 0xec, 0x4b, 0xab,
+    0x9e, 0x77, 0x3b, 0x9a, 0x9d, 0x61, 0x66, 0x46, 0x33, 0x33, 0x33, 0x33,
+    0xa7, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9d, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0xd9, 0xf7, 0x66, 0xe6, 0xcd, 0xcc,
+    0x9b, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0x86, 0x7c, 0xa3, 0xb8, 0x1c, 0xbc, 0xec, 0x6b, 0x93,
+    0x23, 0x78, 0xce, 0xe7, 0xbb, 0x19, 0xcd, 0xce, 0xce, 0xdc, 0xce, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcd, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6,
+    0xcd, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xd3, 0x21, 0xe3, 0x88, 0x4a, 0x78, 0xd9, 0xd7, 0x26,
+    0x26, 0x78, 0x6d, 0x49, 0x37, 0xab, 0xdd, 0xdb, 0x99, 0xbb, 0x9b, 0x99,
+    0xb9, 0xd5, 0xec, 0xdc, 0xcc, 0xcc, 0xcc, 0xde, 0xcc, 0xec, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66, 0xde,
+    0xbc, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xa7, 0x6f, 0x60, 0xa6, 0x02, 0x38, 0x08, 0x2f, 0xfb,
+    0xbe, 0x2f, 0x11, 0xb1, 0x56, 0x3e, 0xdf, 0xce, 0x6a, 0x67, 0x77, 0xe6,
+    0x6e, 0x67, 0x66, 0x76, 0x77, 0x76, 0x67, 0x67, 0x67, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xde, 0x9b, 0x99,
+    0x37, 0x33, 0x6f, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0x20, 0x4f, 0x1a, 0xd0, 0xd2, 0x00,
+    0x5e, 0xf6, 0xb5, 0xee, 0x01, 0x8c, 0xcf, 0x96, 0xe6, 0x7c, 0x33, 0xbb,
+    0x3b, 0xd2, 0xcc, 0x8c, 0xe6, 0x66, 0x77, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xe6, 0xbd, 0x99,
+    0x79, 0x33, 0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x21, 0xc1, 0xaf, 0x3c, 0x45, 0x72,
+    0x88, 0x97, 0x7d, 0xfd, 0x1a, 0x1c, 0x9d, 0x8f, 0xf5, 0xcc, 0x8e, 0x66,
+    0x34, 0x33, 0xb7, 0x37, 0x73, 0x33, 0x37, 0x33, 0x33, 0xb3, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3,
+    0xde, 0xcc, 0xbc, 0x99, 0x79, 0xf3, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x3c, 0xe8, 0xa6, 0x81,
+    0x56, 0xc8, 0xcb, 0xbe, 0x7e, 0x9f, 0x23, 0x76, 0x3c, 0x8c, 0x66, 0x76,
+    0x76, 0x46, 0x33, 0xb3, 0x33, 0x33, 0xb3, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0xef, 0xcd, 0xcc, 0x9b, 0x99, 0x37, 0x6f, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0x4d, 0xc1, 0x67,
+    0x00, 0x14, 0x2f, 0xfb, 0xd2, 0x4f, 0x1d, 0xcf, 0x64, 0x3c, 0x3b, 0xa3,
+    0x99, 0x19, 0xcf, 0xcc, 0xcc, 0xcc, 0xdc, 0xce, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66, 0xde, 0xbc, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xcc, 0x9c,
+    0x21, 0xe4, 0x65, 0x5f, 0xab, 0x0e, 0x09, 0x73, 0x9a, 0x9d, 0x99, 0xb9,
+    0x99, 0x99, 0x99, 0xd9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0x24, 0x4d, 0x91,
+    0x90, 0x97, 0x7d, 0x45, 0xbd, 0xd8, 0x5e, 0xed, 0xdd, 0xed, 0xcc, 0xce,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xe3, 0x59, 0x39, 0xbc,
+    0xbc, 0xec, 0x6b, 0x1b, 0xc0, 0x92, 0x7c, 0xbe, 0xdb, 0xd5, 0xee, 0xed,
+    0xce, 0xdd, 0xcd, 0xcc, 0xec, 0xee, 0xec, 0xce, 0xcc, 0xce, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xbc, 0x37,
+    0x33, 0x6f, 0x66, 0xde, 0xbc, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3,
+    0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0x1f, 0x52, 0xec, 0x50, 0x30,
+    0x24, 0x80, 0x97, 0x7d, 0x6d, 0x62, 0xc0, 0x67, 0xc9, 0xba, 0x39, 0xdd,
+    0xee, 0xee, 0xae, 0x6e, 0x66, 0xe6, 0x66, 0x67, 0x67, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xe6,
+    0xbd, 0x99, 0x79, 0x33, 0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x59, 0x55, 0x16, 0xae,
+    0x23, 0x11, 0x14, 0x2f, 0xfb, 0xbe, 0x2f, 0xc1, 0xdc, 0x6a, 0x35, 0x9a,
+    0xd9, 0xb9, 0x99, 0x9b, 0x99, 0x9d, 0x99, 0xd9, 0x99, 0x9d, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0x66,
+    0x82, 0x3b, 0x07, 0xf0, 0xb2, 0xaf, 0xad, 0x2b, 0x6e, 0x59, 0xcf, 0xcd,
+    0x68, 0x76, 0x46, 0x33, 0xb3, 0x33, 0x33, 0xbb, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0xef, 0xcd, 0xcc, 0x9b, 0x99, 0x37, 0x6f, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0xff,
+    0x42, 0x18, 0xa3, 0xf0, 0xb2, 0x2f, 0xad, 0x7a, 0xde, 0xed, 0x68, 0x76,
+    0x86, 0x99, 0x19, 0xcd, 0xcc, 0xcc, 0xcc, 0x9c, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x76, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0xdf, 0x9b, 0x99, 0x37, 0x33, 0x6f, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x1b, 0xf2,
+    0x8d, 0xe2, 0x72, 0xf0, 0xb2, 0xaf, 0x25, 0x26, 0x61, 0xe4, 0xd9, 0x99,
+    0x19, 0xcd, 0xec, 0xcc, 0xcc, 0xce, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x93, 0x74,
+    0x50, 0x01, 0x81, 0x97, 0x7d, 0x6d, 0x0a, 0xb6, 0xcf, 0xd6, 0x59, 0xb3,
+    0x9a, 0xb9, 0x99, 0xd9, 0xbb, 0x99, 0x99, 0x5d, 0xcd, 0xce, 0xce, 0xcc,
+    0xcc, 0xec, 0xcd, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x13, 0x09, 0xfc,
+    0x23, 0x2f, 0xe4, 0x01, 0x2f, 0xfb, 0xbe, 0xaf, 0x01, 0x2c, 0x9d, 0xcf,
+    0xb7, 0x73, 0xda, 0xd9, 0x9d, 0xb9, 0xdb, 0x99, 0x99, 0xdd, 0x99, 0xdd,
+    0x9d, 0xd9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0xf7, 0x66, 0xe6, 0xcd, 0xcc, 0x9b, 0x37, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0x26,
+    0x24, 0x83, 0x89, 0x41, 0x99, 0x00, 0x2f, 0xfb, 0xda, 0xc4, 0x80, 0xd7,
+    0x92, 0x74, 0x73, 0xba, 0xd9, 0xdd, 0x59, 0xdd, 0xcc, 0xcc, 0xce, 0xce,
+    0xce, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xb3, 0x6c, 0x1c, 0x4c, 0x4e, 0x00, 0x84, 0x97, 0x7d, 0x6d, 0x13, 0xa3,
+    0x63, 0x3d, 0x9a, 0xb9, 0xd1, 0x8c, 0x66, 0x66, 0x77, 0x67, 0x6e, 0xe6,
+    0x66, 0x67, 0x66, 0x76, 0xe6, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0xde, 0x9b, 0x99, 0x37, 0x33, 0x6f, 0xde,
+    0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x9b,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0x8e, 0x4c, 0x81, 0x0c, 0x6e, 0xf2, 0xb2, 0xaf, 0xfd, 0xdc,
+    0x63, 0x97, 0xf1, 0xdc, 0x8c, 0x66, 0x67, 0x34, 0x33, 0x3b, 0x33, 0xb3,
+    0x3b, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3, 0xde, 0xcc, 0xbc, 0x99, 0x79,
+    0xf3, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x88, 0x57, 0x41, 0x2d, 0xc3, 0xcb, 0xbe, 0xb4, 0xf7,
+    0x8d, 0x66, 0x3a, 0x9e, 0x9d, 0x61, 0x66, 0x46, 0x33, 0x33, 0x33, 0x33,
+    0xa7, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9d, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0xf7, 0x66, 0xe6, 0xcd, 0xcc,
+    0x9b, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0x26, 0xb3, 0x25, 0xf4, 0x03,
+};
+
+// Distance 3.0.
+static const uint8_t kStaticHistograms3[4418] = {
+    0x7b, 0x16, 0x68, 0x41, 0x74, 0x6d, 0xfe, 0x87, 0x8d, 0x3b, 0x00, 0x00,
+    0x00, 0x00, 0x1b, 0xee, 0x8e, 0xd9, 0xeb, 0x65, 0xb3, 0x75, 0xf3, 0xfd,
+    0x9d, 0xe7, 0x60, 0xfb, 0x87, 0xdb, 0x3f, 0xda, 0xfe, 0xf1, 0xce, 0x77,
+    0x92, 0xd3, 0x3e, 0x83, 0x73, 0x30, 0xb6, 0x20, 0x5c, 0xb4, 0x11, 0x04,
+    0xdb, 0x08, 0xc2, 0x25, 0x0d, 0x0c, 0x5c, 0xb5, 0x11, 0x6c, 0xdb, 0x08,
+    0x96, 0x6d, 0x84, 0xeb, 0xdc, 0xf4, 0x2d, 0xdc, 0x81, 0xb1, 0x05, 0xe1,
+    0xbe, 0x8d, 0x20, 0xd8, 0x46, 0x10, 0x1e, 0x68, 0x60, 0xe0, 0xb1, 0x8d,
+    0x60, 0xdb, 0x46, 0xb0, 0x6c, 0x23, 0x3c, 0xe5, 0xb9, 0x5f, 0xe0, 0x15,
+    0x8c, 0x2d, 0x08, 0x6f, 0x6d, 0x04, 0xc1, 0x36, 0x82, 0xf0, 0x4e, 0x03,
+    0x03, 0x1f, 0x6d, 0x04, 0xdb, 0x36, 0x82, 0x65, 0x1b, 0xe1, 0x33, 0x5f,
+    0xfd, 0x0d, 0x3f, 0x60, 0x6c, 0x41, 0xf8, 0x6d, 0x23, 0x08, 0xb6, 0x11,
+    0x84, 0x3f, 0x1a, 0x18, 0xf8, 0x6f, 0x23, 0xd8, 0xb6, 0x11, 0x2c, 0xdb,
+    0x08, 0x6b, 0x96, 0x1e, 0x58, 0xc0, 0xd8, 0x82, 0xb0, 0xb6, 0x11, 0x04,
+    0xdb, 0x08, 0xc2, 0x42, 0x03, 0x03, 0x6b, 0x1b, 0xc1, 0xb6, 0x8d, 0x60,
+    0xd9, 0x46, 0x58, 0xb3, 0xf4, 0xc0, 0x02, 0xc6, 0x16, 0x84, 0xb5, 0x8d,
+    0x20, 0xd8, 0x46, 0x10, 0x16, 0x1a, 0x18, 0x58, 0xdb, 0x08, 0xb6, 0x6d,
+    0x04, 0xcb, 0x36, 0x42, 0x1a, 0xf1, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0x4d, 0x93, 0x36, 0xc1, 0xba, 0xbb, 0xdb, 0xdd, 0xdd,
+    0xdd, 0xdd, 0xdd, 0x9d, 0x9d, 0x99, 0x99, 0x99, 0x99, 0x99, 0xd9, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x91, 0x7b, 0x82, 0x08, 0xc6, 0x00, 0x40,
+    0x23, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0x7b,
+    0x67, 0x93, 0xb6, 0x01, 0xdb, 0x92, 0x74, 0x77, 0x77, 0x77, 0x7b, 0x7b,
+    0xb7, 0xbb, 0xbb, 0xb7, 0xb3, 0xb7, 0x7b, 0xbb, 0x33, 0x37, 0xb3, 0xb3,
+    0xc7, 0xd3, 0x42, 0x87, 0x65, 0x11, 0x1a, 0x1c, 0x14, 0x68, 0xc4, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0x74, 0x92, 0x49,
+    0xd2, 0x06, 0x6c, 0x4b, 0xba, 0xbb, 0xd3, 0xdd, 0xed, 0xdd, 0xee, 0xee,
+    0xdd, 0xee, 0xde, 0xde, 0xdd, 0xce, 0xdc, 0xcc, 0xce, 0x22, 0x4f, 0xd0,
+    0xb0, 0xc6, 0xba, 0x9e, 0xc6, 0xc1, 0x42, 0x1a, 0xf1, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xb9, 0xbb, 0x93, 0x0c, 0x90, 0x24,
+    0x01, 0x6c, 0xfb, 0x24, 0xed, 0xed, 0xdd, 0xee, 0xee, 0xde, 0xce, 0xde,
+    0xee, 0xed, 0xce, 0xdc, 0xcc, 0xce, 0x3a, 0x1b, 0xfa, 0xb5, 0x72, 0x42,
+    0x23, 0x30, 0x38, 0x28, 0xd0, 0x88, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xcd, 0xde, 0xdd, 0x49, 0xb2, 0x6d, 0x20, 0x00, 0x40,
+    0xc0, 0x96, 0xee, 0x76, 0x77, 0xf7, 0x76, 0xf6, 0x76, 0x6f, 0x77, 0xe6,
+    0x66, 0x76, 0x76, 0x06, 0x99, 0x19, 0xef, 0xdb, 0x3c, 0x37, 0x99, 0x39,
+    0x28, 0xd0, 0x88, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xcd, 0xde, 0xee, 0xdd, 0xdd, 0xe9, 0xee, 0xee, 0xee, 0x24, 0x49, 0x22,
+    0xad, 0xab, 0x64, 0x76, 0x77, 0x77, 0x66, 0x76, 0x76, 0x77, 0x66, 0x76,
+    0x66, 0x66, 0xd9, 0xf3, 0x07, 0x28, 0x0e, 0xca, 0x74, 0x58, 0xd1, 0x88,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0x8d, 0x6c, 0x1b,
+    0x00, 0x00, 0xc0, 0xb6, 0x6d, 0xdb, 0x96, 0x25, 0x9d, 0x24, 0xe9, 0xee,
+    0x7c, 0xb2, 0x6e, 0x57, 0x33, 0x37, 0xd2, 0x5a, 0x11, 0xa9, 0x48, 0xc1,
+    0x2a, 0x94, 0x15, 0x1e, 0xea, 0x30, 0xc2, 0xa1, 0x11, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x1b, 0xd9, 0x36, 0x00, 0x00, 0x80,
+    0x6d, 0xdb, 0xb6, 0x2d, 0x4b, 0x3a, 0x49, 0xd2, 0xdd, 0xf9, 0x64, 0xdd,
+    0xae, 0x66, 0x6e, 0xa4, 0xb5, 0x22, 0x52, 0x91, 0x82, 0x55, 0x28, 0x2b,
+    0x3c, 0xd4, 0x61, 0x84, 0xc3, 0xea, 0x6d, 0xb0, 0x6d, 0x5b, 0xba, 0xbb,
+    0xdd, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x41, 0x73, 0x2b, 0x6e, 0xb0, 0x3a, 0xb6, 0x01, 0x92, 0x24, 0x01, 0x6c,
+    0xe9, 0x74, 0xb7, 0xb7, 0xbb, 0x3b, 0xb3, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xb6, 0x21,
+    0x31, 0xda, 0x74, 0x6e, 0x36, 0x05, 0x58, 0x3d, 0x01, 0x00, 0x4b, 0x92,
+    0x24, 0xdd, 0x59, 0x92, 0x74, 0x77, 0x77, 0xb7, 0xb7, 0x7b, 0xbb, 0x77,
+    0x92, 0xe4, 0x93, 0xef, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x78,
+    0xfa, 0xd4, 0xe3, 0x08, 0xb6, 0xc6, 0x80, 0x30, 0xff, 0x33, 0xab, 0xb7,
+    0x01, 0x8c, 0x25, 0x49, 0x77, 0xd2, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd, 0xdd,
+    0xde, 0xed, 0xee, 0xee, 0xee, 0xde, 0x9d, 0x7c, 0x73, 0xb7, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x23, 0x73, 0x32, 0xc8, 0x66, 0xf8, 0x81, 0x0c,
+    0x1f, 0x98, 0x97, 0x7d, 0x2d, 0x59, 0x83, 0x67, 0x6f, 0x66, 0x66, 0x66,
+    0x67, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0xe6, 0xbd, 0x99, 0x79, 0x33, 0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0x9a, 0x2b,
+    0xe4, 0x65, 0x5f, 0xe3, 0x4f, 0xc5, 0x5a, 0xdd, 0xe9, 0x76, 0x66, 0x67,
+    0x76, 0x66, 0x66, 0x77, 0x66, 0x66, 0x67, 0x67, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xe6,
+    0xbd, 0x99, 0x79, 0x33, 0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0x49, 0x45, 0x4c,
+    0x07, 0xbc, 0xec, 0x6b, 0x1b, 0xc0, 0x92, 0x7c, 0xbe, 0xdb, 0xd5, 0xee,
+    0xed, 0xce, 0xdd, 0xcd, 0xcc, 0xec, 0xee, 0xec, 0xce, 0xcc, 0xce, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xbc,
+    0x37, 0x33, 0x6f, 0x66, 0xde, 0xbc, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xf3, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0x1f, 0x52, 0xec, 0x50,
+    0x30, 0x24, 0x80, 0x97, 0x7d, 0x6d, 0x62, 0xc0, 0x67, 0xc9, 0xba, 0x39,
+    0xdd, 0xee, 0xee, 0xae, 0x6e, 0x66, 0xe6, 0x66, 0x67, 0x67, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0xe6, 0xbd, 0x99, 0x79, 0x33, 0xf3, 0xe6, 0xcd, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x59, 0x55, 0x16,
+    0xae, 0x23, 0x11, 0x14, 0x2f, 0xfb, 0xbe, 0xaf, 0x60, 0x74, 0x5a, 0x8f,
+    0x66, 0x76, 0x6e, 0xe6, 0x66, 0x66, 0x77, 0x67, 0x76, 0x66, 0x67, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0xde, 0x9b, 0x99, 0x37, 0x33, 0x6f, 0xde, 0xbc, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x1b,
+    0x91, 0xaf, 0x61, 0xd5, 0xc8, 0xcb, 0xbe, 0xb6, 0xae, 0xb8, 0x65, 0x3d,
+    0x37, 0xa3, 0xd9, 0x19, 0xcd, 0xcc, 0xce, 0xcc, 0xec, 0xce, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66, 0xde, 0xbc, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37,
+    0xff, 0x0b, 0x61, 0x8c, 0xc2, 0xcb, 0xbe, 0xb4, 0xea, 0x79, 0xb7, 0xa3,
+    0xd9, 0x19, 0x66, 0x66, 0x34, 0x33, 0x33, 0x33, 0x73, 0x9a, 0x99, 0x99,
+    0x99, 0x99, 0xd9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x7d, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xc8, 0x37, 0x8a, 0xcb, 0xc1, 0xcb, 0xbe, 0x36, 0x71, 0x12, 0xcd, 0x7a,
+    0xbd, 0x33, 0xe3, 0xd9, 0x9b, 0xd9, 0xdd, 0x99, 0x99, 0x99, 0x9d, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0x52, 0x2d, 0x52, 0x94, 0x16, 0x5e, 0xf6, 0xb5, 0x74, 0xc1, 0x5e, 0x9f,
+    0x64, 0xcd, 0xde, 0xee, 0xcc, 0xcc, 0xec, 0xce, 0xcc, 0xec, 0xdc, 0xec,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66, 0xde, 0xbc, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37,
+    0xa9, 0x78, 0xaa, 0xac, 0xe5, 0xe1, 0x65, 0x5f, 0xe3, 0x6e, 0x1c, 0x86,
+    0xf5, 0x59, 0xa3, 0x93, 0x46, 0xba, 0xd9, 0xbd, 0x9d, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0x04, 0x5d, 0x59, 0x98, 0x4d, 0x60, 0x78, 0xd9, 0xd7, 0xb8, 0x07, 0xb0,
+    0x1c, 0x92, 0x46, 0x77, 0x9e, 0x3b, 0xcd, 0xee, 0xdd, 0xcc, 0xce, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0x7b, 0x33, 0xf3, 0x66, 0xe6, 0xcd, 0x9b, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0x73, 0xed, 0x95, 0x18, 0x64, 0xc8, 0x45, 0x5e, 0xf6, 0x7d, 0x5f, 0x83,
+    0xd1, 0xee, 0x7a, 0x34, 0xb3, 0x73, 0x33, 0x3b, 0x33, 0x37, 0x3b, 0x33,
+    0x33, 0x3b, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3, 0xde, 0xcc, 0xbc, 0x99, 0x79,
+    0xf3, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0xcc, 0x24, 0x9e, 0xb5, 0xc1, 0xcb, 0xbe, 0x7e, 0x75,
+    0x8e, 0x19, 0x8d, 0xe7, 0x66, 0x76, 0x66, 0xe6, 0x66, 0x66, 0x67, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xde, 0x9b, 0x99, 0x37, 0x33,
+    0x6f, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x1b, 0xee, 0x53, 0x35, 0xbc, 0xec, 0x4b, 0x3f, 0xf5,
+    0xbc, 0x93, 0xf1, 0xdc, 0x0c, 0x33, 0x33, 0x9a, 0x99, 0x99, 0x99, 0xb9,
+    0x9b, 0x99, 0x99, 0x99, 0x99, 0xd1, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66, 0xde,
+    0xbc, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xae, 0x55, 0xa8, 0x2c, 0xbc, 0xec, 0x6b, 0xdc, 0xab,
+    0xf1, 0xec, 0xcd, 0xcd, 0xcc, 0xec, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xbc, 0x37, 0x33, 0x6f, 0x66, 0xde,
+    0xbc, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef, 0xbd,
+    0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0x81, 0xa0, 0x9f, 0x79, 0xd9, 0xd7, 0x52, 0x83, 0x7d,
+    0x96, 0xa4, 0x9b, 0xbd, 0xd9, 0x9d, 0x99, 0xdd, 0x9b, 0x99, 0xd9, 0xbd,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0xd9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x79, 0x6f, 0x66, 0xde, 0xcc, 0xbc, 0x79, 0xf3,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0x6f, 0xc6, 0xc2, 0x65, 0xa8, 0xae, 0x0a, 0x5e, 0xf6, 0xb5, 0x0d, 0x60,
+    0x49, 0x3e, 0xdf, 0xed, 0x6a, 0xf7, 0x76, 0xe7, 0xee, 0x66, 0x66, 0x76,
+    0x77, 0x76, 0x67, 0x66, 0x67, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0xde, 0x9b, 0x99, 0x37, 0x33, 0x6f, 0xde,
+    0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x9b,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x9b, 0x0f, 0x29, 0x76, 0x28, 0x18, 0x12, 0xc0, 0xcb, 0xbe, 0x36,
+    0x31, 0xe0, 0xb3, 0x64, 0xdd, 0x9c, 0x6e, 0x77, 0x77, 0x57, 0x37, 0x33,
+    0x73, 0xb3, 0xb3, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3, 0xde, 0xcc, 0xbc, 0x99, 0x79,
+    0xf3, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0xac, 0x2a, 0x0b, 0xd7, 0x91, 0x08, 0x8a, 0x97, 0x7d,
+    0xdf, 0xd7, 0x60, 0x74, 0x5e, 0x8f, 0x66, 0x76, 0x6e, 0xe6, 0x66, 0xe6,
+    0x76, 0x67, 0x76, 0x66, 0x67, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xde, 0x9b, 0x99,
+    0x37, 0x33, 0x6f, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0x90, 0x54, 0x87, 0x7a, 0xcc, 0xcb,
+    0xbe, 0xb6, 0xae, 0xb8, 0x65, 0x3d, 0x37, 0xa3, 0xd9, 0x19, 0xcd, 0xcc,
+    0xce, 0xcc, 0xec, 0xce, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xbc, 0x37, 0x33,
+    0x6f, 0x66, 0xde, 0xbc, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde,
+    0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x37, 0xff, 0x0b, 0x61, 0x8c, 0xc2, 0xcb,
+    0xbe, 0xb4, 0xea, 0x79, 0xb7, 0xa3, 0xd9, 0x19, 0x66, 0x66, 0x34, 0x33,
+    0x33, 0x33, 0x73, 0x9a, 0x99, 0x99, 0x99, 0x99, 0xd9, 0x99, 0x99, 0x99,
+    0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x7d, 0x6f, 0x66,
+    0xde, 0xcc, 0xbc, 0x79, 0xf3, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd,
+    0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xc8, 0x37, 0x8a, 0xcb, 0xc1, 0xcb,
+    0xbe, 0xef, 0x4b, 0x0c, 0xf1, 0xae, 0xe7, 0x66, 0x66, 0x3c, 0x7b, 0x33,
+    0x33, 0x3b, 0x33, 0x33, 0x73, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xef, 0xcd,
+    0xcc, 0x9b, 0x99, 0x37, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0x4d, 0x28, 0x94, 0xf1, 0x12, 0xbc,
+    0xec, 0x6b, 0xd3, 0x03, 0x6b, 0x24, 0xd9, 0x37, 0x7b, 0x73, 0x33, 0x33,
+    0x7b, 0x37, 0x33, 0x73, 0x73, 0xb3, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xf3, 0xde, 0xcc,
+    0xbc, 0x99, 0x79, 0xf3, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x74, 0xa0, 0xeb, 0x13, 0x14, 0xc0,
+    0xcb, 0xbe, 0xd6, 0xbd, 0x00, 0xe3, 0xb5, 0xac, 0x91, 0xa4, 0x91, 0x6e,
+    0xee, 0x76, 0x67, 0x76, 0x76, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xde, 0x9b, 0x99,
+    0x37, 0x33, 0x6f, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef,
+    0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0x37, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x9b, 0x30, 0x24, 0xcf, 0x09, 0x09, 0x80,
+    0xc0, 0xcb, 0xbe, 0xd6, 0x59, 0x0c, 0xc3, 0x5a, 0xf6, 0x48, 0xf2, 0x9c,
+    0x34, 0xbb, 0xb7, 0x33, 0x3b, 0x33, 0x3b, 0x33, 0xbb, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xef, 0xcd,
+    0xcc, 0x9b, 0x99, 0x37, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc,
+    0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x9b, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0x4d, 0x4d, 0x57, 0xc1, 0x83, 0x88,
+    0xe1, 0xc0, 0xcb, 0xbe, 0x7e, 0x25, 0xe6, 0x56, 0xcb, 0x68, 0x66, 0x66,
+    0x67, 0x34, 0x33, 0x37, 0x33, 0xb3, 0x33, 0x3b, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0xf3, 0xde, 0xcc, 0xbc, 0x99, 0x79, 0xf3, 0xe6, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xb0, 0x32, 0xb5,
+    0xc1, 0x94, 0x97, 0x7d, 0xfd, 0x3e, 0x72, 0xec, 0x78, 0x3c, 0x37, 0xb3,
+    0x33, 0x33, 0x37, 0x33, 0x37, 0x33, 0x33, 0x33, 0x3b, 0x33, 0x33, 0x33,
+    0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+    0x33, 0xf3, 0xde, 0xcc, 0xbc, 0x99, 0x79, 0xf3, 0xe6, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0xbc, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0x6f, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0x79, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x24, 0x80,
+    0x03, 0x03, 0x2f, 0xfb, 0xd2, 0xaa, 0xab, 0x9d, 0x8c, 0x66, 0x67, 0x3c,
+    0x33, 0xa3, 0x99, 0x99, 0x99, 0x99, 0xdb, 0x99, 0xd9, 0x99, 0x99, 0x99,
+    0x9d, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99,
+    0x99, 0xf7, 0x66, 0xe6, 0xcd, 0xcc, 0x9b, 0x37, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0x6f, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xe6, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd,
+    0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xf3, 0xde, 0x7b, 0xef,
+    0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7,
+    0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b,
+    0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xcd, 0x7b, 0xef, 0xbd, 0xf7, 0xde,
+    0x7b, 0xef, 0xbd, 0xf7, 0xde, 0x7b, 0xef, 0xbd, 0xf7, 0xc6, 0x2e, 0xdb,
+    0x57, 0x08,
+};
+
+static const uint8_t* const kStaticHistograms[3] = {
+    kStaticHistograms1, kStaticHistograms2, kStaticHistograms3};
+static const size_t kStaticHistogramsSize[3] = {
+    sizeof(kStaticHistograms1), sizeof(kStaticHistograms2),
+    sizeof(kStaticHistograms3)};
+
+}  // namespace pik
+
+#endif  // STATIC_HISTOGRAMS_H_
@@ -24,8 +24,10 @@
 #define PROFILER_ENABLED 1
 #include "arch_specific.h"
 #include "cache_aligned.h"
+#include "os_specific.h"
 #include "profiler.h"
 #include "simd_helpers.h"
+#include "tsc_timer.h"
 
 // Prints graph summary.
 #define VERBOSE_GRAPH 1
@@ -423,10 +425,19 @@ class TFNode {
 
   // Graph finalization:
 
-  // Recursive init (from sink to source), called during TFBuilder::Finalize.
-  // The next* arguments are from the "user" node that specified this node as an
-  // input. Also called with user == this for each node.
-  void InitR(const uint32_t num_finalize, const TFNode* user,
+  // Clears the state computed by InitR, which depends on the tile size.
+  void ResetInitR() {
+    max_user_borders_ = Borders();
+    x_from_ix_ = CoordFromIndex();
+    y_from_iy_ = CoordFromIndex();
+    total_scale_x_ = total_scale_y_ = 0;
+  }
+
+  // Recursive init (from sink to source), called during TFBuilder::Finalize
+  // after ResetInitR. The next* arguments are from the "user" node that
+  // specified this node as an input. Also called with user == this for each
+  // node. "epoch" is unique per layout (see TFBuilderImpl::Layout).
+  void InitR(const uint32_t epoch, const TFNode* user,
              const Borders& next_in_borders,
              const CoordFromIndex& next_x_from_ix,
              const CoordFromIndex& next_y_from_iy, const uint32_t next_xsize,
@@ -434,10 +445,10 @@ class TFNode {
              const uint32_t next_sink_ysize) {
     // Non-recursive call but already reached this node through a user's
     // recursive call - skip, the initial next_* args won't change anything.
-    // Automatically resets to false after the next call to Finalize, which
-    // allows us to update our sink size etc.
-    if (user == this && init_epoch_.Test(num_finalize)) return;
-    init_epoch_.Set(num_finalize);
+    // Automatically resets to false after the next layout, which allows us to
+    // update our sink size etc.
+    if (user == this && init_epoch_.Test(epoch)) return;
+    init_epoch_.Set(epoch);
 
     max_user_borders_.UpdateToMax(next_in_borders);
 
@@ -456,7 +467,7 @@ class TFNode {
     out_ysizes_.SetPartialForOutSize(sink_ysize_);
 
     for (const TFPorts& input : inputs_) {
-      input.node->InitR(num_finalize, this, in_borders_, x_from_ix_, y_from_iy_,
+      input.node->InitR(epoch, this, in_borders_, x_from_ix_, y_from_iy_,
                         out_xsizes_.Full(), out_ysizes_.Full(), sink_xsize_,
                         sink_ysize_);
     }
@@ -517,6 +528,23 @@ class TFNode {
     return buf;
   }
 
+  // For TFGraph::Stats; valid after Finalize.
+  TFNodeStats Describe() const {
+    TFNodeStats stats;
+    stats.name = name_.Get();
+    stats.kind = IsSource() ? "source" : (IsSink() ? "sink" : "node");
+    for (const TFPorts& input : inputs_) {
+      stats.inputs.push_back(input.node->Index());
+    }
+    stats.num_ports = NumPorts();
+    stats.out_type = out_type_;
+    stats.in_borders = in_borders_;
+    stats.out_xsize = out_xsizes_.Full();
+    stats.out_ysize = out_ysizes_.Full();
+    stats.buffer_bytes = IsSink() ? 0 : TotalBufferSize();
+    return stats;
+  }
+
   // Copies the argument (typically closure) to arg.
   TFFunc GetFunc(uint8_t* func_arg) const {
     PIK_ASSERT(!IsSource());
@@ -759,6 +787,17 @@ class SourceTLS {
     return reinterpret_cast<const SourceTLS*>(ports_ + num_ports_);
   }
 
+  // Points our ports at the next images[*next] (see TFGraph::Rebind).
+  void Rebind(const std::vector<const ImageF*>& images, size_t* next) {
+    for (size_t idx_port = 0; idx_port < num_ports_; ++idx_port) {
+      PIK_CHECK(*next < images.size());
+      const ImageF* image = images[(*next)++];
+      PIK_CHECK(image->xsize() == source_size_.xsize);
+      PIK_CHECK(image->ysize() == source_size_.ysize);
+      ports_[idx_port].source_.Init(*image);
+    }
+  }
+
   PIK_INLINE void Run(const RunArg& arg) const {
     // Top left of the tile in the source image.
     const int32_t x = x_from_ix(arg.tile_ix);
@@ -1047,6 +1086,21 @@ class SinkTLS {
   PIK_INLINE SinkTLS* Next() { return end_; }
   PIK_INLINE const SinkTLS* Next() const { return end_; }
 
+  // Points our outputs at the next images[*next] (see TFGraph::Rebind).
+  void Rebind(const std::vector<const ImageF*>& images, const ImageSize size,
+              size_t* next) {
+    ConstImageViewF* inputs = reinterpret_cast<ConstImageViewF*>(this + 1);
+    MutableImageViewF* PIK_RESTRICT outputs =
+        reinterpret_cast<MutableImageViewF*>(inputs + num_inputs_);
+    for (size_t i = 0; i < num_sinks_; ++i) {
+      PIK_CHECK(*next < images.size());
+      const ImageF* image = images[(*next)++];
+      PIK_CHECK(image->xsize() == size.xsize && image->ysize() == size.ysize);
+      outputs[i].Init(const_cast<uint8_t*>(image->bytes()),
+                      image->bytes_per_row());
+    }
+  }
+
   PIK_INLINE void Run(const RunArg& arg) const {
     const int32_t x = x_from_ix(arg.tile_ix);
     const int32_t y = y_from_iy(arg.tile_iy);
@@ -1139,13 +1193,49 @@ PIK_INLINE const uint8_t* RunTLS(const uint8_t* storage, const RunArg& arg) {
   return Sentinels::Skip(tls);
 }
 
+// As RunTLS, but also adds the tile count and elapsed cycles of each node to
+// "counters" (see TFGraph::counters_). Returns "counters" for the next node.
+template <class TLS>
+const uint8_t* RunTLSTimed(const uint8_t* storage, const RunArg& arg,
+                           uint64_t** counters) {
+  const TLS* tls = reinterpret_cast<const TLS*>(storage);
+  while (!Sentinels::Check(tls)) {
+    const uint64_t t0 = Start<uint64_t>();
+    tls->Run(arg);
+    const uint64_t t1 = Stop<uint64_t>();
+    (*counters)[0] += 1;
+    (*counters)[1] += t1 - t0;
+    *counters += 2;
+    tls = tls->Next();
+  }
+  return Sentinels::Skip(tls);
+}
+
 // Runs the graph to produce output for one tile. "p" is per-thread storage.
-PIK_INLINE void RunGraph(const uint8_t* PIK_RESTRICT p, const RunArg& arg) {
+// "counters" is null unless profiling.
+PIK_INLINE void RunGraph(const uint8_t* PIK_RESTRICT p, const RunArg& arg,
+                         uint64_t* counters) {
+  if (PIK_UNLIKELY(counters != nullptr)) {
+    p = RunTLSTimed<SourceTLS>(p, arg, &counters);
+    p = RunTLSTimed<NodeTLS>(p, arg, &counters);
+    p = RunTLSTimed<SinkTLS>(p, arg, &counters);
+    return;
+  }
   p = RunTLS<SourceTLS>(p, arg);
   p = RunTLS<NodeTLS>(p, arg);
   p = RunTLS<SinkTLS>(p, arg);
 }
 
+// Returns "str" with quotes and backslashes escaped for JSON and DOT strings.
+std::string Escaped(const std::string& str) {
+  std::string escaped;
+  for (const char c : str) {
+    if (c == '"' || c == '\\') escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
 }  // namespace
 
 std::string Borders::ToString() const {
@@ -1214,43 +1304,44 @@ class TFBuilderImpl {
   // Freezes all nodes, which prevents any subsequent calls to Add*/Set*.
   TFGraphPtr Finalize(const ImageSize sink_size, const ImageSize tile_size,
                       ThreadPool* pool) {
-    const auto x_from_ix = CoordFromIndex::FromTileSize(tile_size.xsize);
-    const auto y_from_iy = CoordFromIndex::FromTileSize(tile_size.ysize);
-
-    // Now that all BindSink are done, update num_sinks_ - but only once for
-    // this graph, which can no longer change after this.
-    if (++num_finalize_ == 1) {
-      for (const TFNode& node : nodes_) {
-        num_sinks_ += node.IsSink();
-      }
-      num_nodes_ -= num_sinks_;
-      PIK_CHECK(num_sources_ + num_nodes_ + num_sinks_ == nodes_.size());
-    }
-
-    // Recursively compute node sizes from back to front.
-    for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it) {
-      it->InitR(num_finalize_, &*it, Borders(), x_from_ix, y_from_iy,
-                tile_size.xsize, tile_size.ysize, sink_size.xsize,
-                sink_size.ysize);
-    }
+    CountSinks();
+    Layout(sink_size, tile_size);
 
-    // Forward pass: decide buffering mode; must call before RecomputeSizes.
-    for (TFNode& node : nodes_) {
-      node.Finalize();
+    // Calls CreateInstance.
+    return TFGraphPtr(new TFGraph(sink_size, tile_size, pool, this));
+  }
 
-#if VERBOSE & VERBOSE_NODES
-      printf("  %s\n", node.ToString().c_str());
-#endif
+  // As above, but chooses the largest tile size whose per-thread instance
+  // (buffers plus TLS) fits in "max_bytes" and that still leaves at least one
+  // tile per thread. Tiles are square unless clamped to the (power of two
+  // rounded up) sink size.
+  TFGraphPtr Finalize(const ImageSize sink_size, const size_t max_bytes,
+                      ThreadPool* pool) {
+    CountSinks();
+    const uint32_t num_threads = std::max<uint32_t>(pool->NumThreads(), 1);
+
+    // Larger tiles are not helpful; the size must remain a power of two.
+    const uint32_t max_xsize = 1u << CeilLog2Nonzero(sink_size.xsize);
+    const uint32_t max_ysize = 1u << CeilLog2Nonzero(sink_size.ysize);
+
+    ImageSize tile_size{kMinTileSize, kMinTileSize};
+    for (uint32_t size = kMinTileSize * 2; size <= kMaxTileSize; size *= 2) {
+      const ImageSize candidate{std::min(size, max_xsize),
+                                std::min(size, max_ysize)};
+      if (candidate == tile_size) break;  // Both clamped.
+      const uint32_t num_tiles = CeilDiv(sink_size.xsize, candidate.xsize) *
+                                 CeilDiv(sink_size.ysize, candidate.ysize);
+      if (num_tiles < num_threads) break;
+      Layout(sink_size, candidate);
+      if (total_size_ > max_bytes) break;
+      tile_size = candidate;
     }
 
-    RecomputeSizes();
 #if VERBOSE & VERBOSE_GRAPH
-    printf("Sources: %u; Nodes: %u; Sinks: %u; Buffer: %zu; Storage: %zu\n",
-           num_sources_, num_nodes_, num_sinks_, buffers_size_,
-           total_size_ - buffers_size_);
+    printf("Chose tile size %u x %u for %zu bytes\n", tile_size.xsize,
+           tile_size.ysize, max_bytes);
 #endif
-
-    // Calls CreateInstance.
+    Layout(sink_size, tile_size);
     return TFGraphPtr(new TFGraph(sink_size, tile_size, pool, this));
   }
 
@@ -1312,6 +1403,17 @@ class TFBuilderImpl {
     return allocated;
   }
 
+  // Nodes are stored in execution order (see Foreach*).
+  std::vector<TFNodeStats> Describe() const {
+    PIK_CHECK(IsFinalized());
+    std::vector<TFNodeStats> stats;
+    stats.reserve(nodes_.size());
+    for (const TFNode& node : nodes_) {
+      stats.push_back(node.Describe());
+    }
+    return stats;
+  }
+
   static void DestroyInstance(uint8_t* tls) {
     // POD, no need to call dtors.
     CacheAligned::Free(tls);
@@ -1320,6 +1422,56 @@ class TFBuilderImpl {
  private:
   bool IsFinalized() const { return num_finalize_ != 0; }
 
+  static constexpr uint32_t kMinTileSize = 8;
+  static constexpr uint32_t kMaxTileSize = 512;
+
+  // Now that all BindSink are done, update num_sinks_ - but only once for
+  // this graph, which can no longer change after this.
+  void CountSinks() {
+    if (++num_finalize_ == 1) {
+      for (const TFNode& node : nodes_) {
+        num_sinks_ += node.IsSink();
+      }
+      num_nodes_ -= num_sinks_;
+      PIK_CHECK(num_sources_ + num_nodes_ + num_sinks_ == nodes_.size());
+    }
+  }
+
+  // Computes node and buffer sizes for "tile_size", including total_size_.
+  // Can be called repeatedly, e.g. to try several tile sizes.
+  void Layout(const ImageSize sink_size, const ImageSize tile_size) {
+    const auto x_from_ix = CoordFromIndex::FromTileSize(tile_size.xsize);
+    const auto y_from_iy = CoordFromIndex::FromTileSize(tile_size.ysize);
+
+    for (TFNode& node : nodes_) {
+      node.ResetInitR();
+    }
+
+    // Recursively compute node sizes from back to front.
+    ++num_layouts_;
+    for (auto it = nodes_.rbegin(); it != nodes_.rend(); ++it) {
+      it->InitR(num_layouts_, &*it, Borders(), x_from_ix, y_from_iy,
+                tile_size.xsize, tile_size.ysize, sink_size.xsize,
+                sink_size.ysize);
+    }
+
+    // Forward pass: decide buffering mode; must call before RecomputeSizes.
+    for (TFNode& node : nodes_) {
+      node.Finalize();
+
+#if VERBOSE & VERBOSE_NODES
+      printf("  %s\n", node.ToString().c_str());
+#endif
+    }
+
+    RecomputeSizes();
+#if VERBOSE & VERBOSE_GRAPH
+    printf("Sources: %u; Nodes: %u; Sinks: %u; Buffer: %zu; Storage: %zu\n",
+           num_sources_, num_nodes_, num_sinks_, buffers_size_,
+           total_size_ - buffers_size_);
+#endif
+  }
+
   template <class Visitor>
   void ForeachSource(const Visitor& visitor) const {
     for (size_t i = 0; i < num_sources_; ++i) {
@@ -1379,6 +1531,8 @@ class TFBuilderImpl {
 
   // Only allow Add/Set when zero; otherwise skip parts of subsequent Finalize.
   uint32_t num_finalize_ = 0;
+  // Epoch for TFNode::InitR; incremented by each Layout.
+  uint32_t num_layouts_ = 0;
 
   // Dynamic allocation due to size. Ctor calls reserve to prevent resizing.
   std::vector<TFNode> nodes_;
@@ -1393,11 +1547,14 @@ class TFBuilderImpl {
 
 TFGraph::TFGraph(const ImageSize sink_size, const ImageSize tile_size,
                  ThreadPool* pool, const TFBuilderImpl* builder)
-    : num_tiles_x_(CeilDiv(sink_size.xsize, tile_size.xsize)),
+    : sink_size_(sink_size),
+      tile_size_(tile_size),
+      num_tiles_x_(CeilDiv(sink_size.xsize, tile_size.xsize)),
       num_tiles_y_(CeilDiv(sink_size.ysize, tile_size.ysize)),
       num_tiles_(num_tiles_x_ * num_tiles_y_),
       pool_(pool),
-      num_instances_(std::max<size_t>(pool->NumThreads(), 1)) {
+      num_instances_(std::max<size_t>(pool->NumThreads(), 1)),
+      nodes_(builder->Describe()) {
   for (int i = 0; i < num_instances_; ++i) {
     instances_[i] = builder->CreateInstance(i);
   }
@@ -1413,50 +1570,180 @@ TFGraph::~TFGraph() {
   }
 }
 
-void TFGraph::Run() {
-  const TFGraph* self = this;  // For lambda captures.
-  const int mask = num_tiles_x_ - 1;
+void TFGraph::Rebind(const TFBindings& bindings) {
+  for (int i = 0; i < num_instances_; ++i) {
+    // Same traversal as RunGraph.
+    SourceTLS* source = reinterpret_cast<SourceTLS*>(instances_[i]);
+    size_t next_source = 0;
+    while (!Sentinels::Check(source)) {
+      source->Rebind(bindings.sources, &next_source);
+      source = source->Next();
+    }
+    PIK_CHECK(next_source == bindings.sources.size());
 
-  // Preferred: enough strips to keep threads busy (better locality).
-  if (num_tiles_y_ >= pool_->NumThreads() * 2) {
-    pool_->Run(0, num_tiles_y_, [self](const int task, const int thread) {
-      const TileIndex tile_iy = task;
-      RunArg arg(0, tile_iy, self->num_tiles_x_, self->num_tiles_y_);
-      for (TileIndex tile_ix = 0; tile_ix < self->num_tiles_x_ - 1; ++tile_ix) {
-        arg.tile_ix = tile_ix;
-        RunGraph(self->instances_[thread], arg);
-      }
+    uint8_t* storage = const_cast<uint8_t*>(Sentinels::Skip(source));
+    NodeTLS* node = reinterpret_cast<NodeTLS*>(storage);
+    while (!Sentinels::Check(node)) {
+      node = node->Next();
+    }
 
-      arg.tile_ix = self->num_tiles_x_ - 1;
-      arg.is_partial_x = 1;
-      RunGraph(self->instances_[thread], arg);
-    });
-    return;
+    storage = const_cast<uint8_t*>(Sentinels::Skip(node));
+    SinkTLS* sink = reinterpret_cast<SinkTLS*>(storage);
+    size_t next_sink = 0;
+    while (!Sentinels::Check(sink)) {
+      sink->Rebind(bindings.sinks, sink_size_, &next_sink);
+      sink = sink->Next();
+    }
+    PIK_CHECK(next_sink == bindings.sinks.size());
   }
+}
+
+void TFGraph::Run() { RunTileRows(0, num_tiles_y_); }
 
-  // Second-best: scatter tiles but avoid Divider.
-  if ((num_tiles_x_ & mask) == 0) {  // Power of two (including 1)
-    const int shift = FloorLog2Nonzero(num_tiles_x_);
-    pool_->Run(0, num_tiles_,
-               [mask, shift, self](const int task, const int thread) {
-                 const TileIndex tile_ix = task & mask;
-                 const TileIndex tile_iy = task >> shift;
-                 const RunArg arg(tile_ix, tile_iy, self->num_tiles_x_,
-                                  self->num_tiles_y_);
-                 RunGraph(self->instances_[thread], arg);
+void TFGraph::RunTileRows(const uint32_t tile_iy_begin,
+                          const uint32_t tile_iy_end) {
+  PIK_ASSERT(tile_iy_begin <= tile_iy_end && tile_iy_end <= num_tiles_y_);
+  const TFGraph* self = this;  // For lambda captures.
+  const uint32_t num_rows = tile_iy_end - tile_iy_begin;
+
+  // Preferred: enough strips to keep threads busy (better locality).
+  if (num_rows >= pool_->NumThreads() * 2) {
+    pool_->Run(tile_iy_begin, tile_iy_end,
+               [self](const int task, const int thread) {
+                 const TileIndex tile_iy = task;
+                 RunArg arg(0, tile_iy, self->num_tiles_x_,
+                            self->num_tiles_y_);
+                 for (TileIndex tile_ix = 0; tile_ix < self->num_tiles_x_ - 1;
+                      ++tile_ix) {
+                   arg.tile_ix = tile_ix;
+                   RunGraph(self->instances_[thread], arg,
+                            self->Counters(thread));
+                 }
+
+                 arg.tile_ix = self->num_tiles_x_ - 1;
+                 arg.is_partial_x = 1;
+                 RunGraph(self->instances_[thread], arg,
+                          self->Counters(thread));
                });
     return;
   }
 
-  // Fallback: expand task into x,y via 'division'.
-  const Divider divide(num_tiles_x_);
-  pool_->Run(0, num_tiles_, [&divide, self](const int task, const int thread) {
-    const TileIndex tile_iy = divide(task);
-    // Remainder - subtracting after mul is faster than modulo.
-    const TileIndex tile_ix = task - tile_iy * self->num_tiles_x_;
-    const RunArg arg(tile_ix, tile_iy, self->num_tiles_x_, self->num_tiles_y_);
-    RunGraph(self->instances_[thread], arg);
-  });
+  // Otherwise: split each row into bands of horizontally adjacent tiles, just
+  // enough to keep all threads busy. Consecutive tiles within a band re-read
+  // each other's source borders while they are still in cache.
+  const uint32_t num_threads = std::max<uint32_t>(pool_->NumThreads(), 1);
+  const uint32_t max_bands = std::min<uint32_t>(
+      num_tiles_x_, CeilDiv(2 * num_threads, std::max(num_rows, 1u)));
+  const uint32_t tiles_per_band = CeilDiv(num_tiles_x_, max_bands);
+  // Avoids empty bands.
+  const uint32_t bands_per_row = CeilDiv(num_tiles_x_, tiles_per_band);
+  pool_->Run(0, num_rows * bands_per_row,
+             [self, tile_iy_begin, bands_per_row, tiles_per_band](
+                 const int task, const int thread) {
+               // Only one division per band.
+               const uint32_t row = task / bands_per_row;
+               const uint32_t band = task - row * bands_per_row;
+               const TileIndex tile_ix_begin = band * tiles_per_band;
+               const TileIndex tile_ix_end = std::min(
+                   tile_ix_begin + tiles_per_band, self->num_tiles_x_);
+               RunArg arg(tile_ix_begin, tile_iy_begin + row,
+                          self->num_tiles_x_, self->num_tiles_y_);
+               for (TileIndex tile_ix = tile_ix_begin; tile_ix < tile_ix_end;
+                    ++tile_ix) {
+                 arg.tile_ix = tile_ix;
+                 arg.is_partial_x = tile_ix == self->num_tiles_x_ - 1;
+                 RunGraph(self->instances_[thread], arg,
+                          self->Counters(thread));
+               }
+             });
+}
+
+void TFGraph::SetProfiling(const bool enabled) {
+  profiling_ = enabled;
+  if (enabled && counters_[0] == nullptr) {
+    for (int i = 0; i < num_instances_; ++i) {
+      counters_[i] = AllocateArray(2 * nodes_.size() * sizeof(uint64_t));
+    }
+    ResetStats();
+  }
+}
+
+void TFGraph::ResetStats() {
+  if (counters_[0] == nullptr) return;
+  for (int i = 0; i < num_instances_; ++i) {
+    memset(counters_[i].get(), 0, 2 * nodes_.size() * sizeof(uint64_t));
+  }
+}
+
+std::vector<TFNodeStats> TFGraph::Stats() const {
+  std::vector<TFNodeStats> stats = nodes_;
+  if (counters_[0] == nullptr) return stats;
+  for (int i = 0; i < num_instances_; ++i) {
+    const uint64_t* counters =
+        reinterpret_cast<const uint64_t*>(counters_[i].get());
+    for (size_t idx_node = 0; idx_node < stats.size(); ++idx_node) {
+      stats[idx_node].num_tiles += counters[2 * idx_node + 0];
+      stats[idx_node].cycles += counters[2 * idx_node + 1];
+    }
+  }
+  return stats;
+}
+
+std::string TFGraph::ToDot() const {
+  const std::vector<TFNodeStats> stats = Stats();
+  std::string dot = "digraph TFGraph {\n  node [shape=box];\n";
+  char buf[300];
+  for (size_t idx_node = 0; idx_node < stats.size(); ++idx_node) {
+    const TFNodeStats& node = stats[idx_node];
+    const double cycles_per_tile =
+        node.num_tiles == 0 ? 0.0 : double(node.cycles) / node.num_tiles;
+    std::snprintf(buf, sizeof(buf),
+                  "\\n%u x %u %s x%u, %zu bytes\\n%.0f cycles/tile\"];\n",
+                  node.out_xsize, node.out_ysize,
+                  TFTypeUtils::String(node.out_type), node.num_ports,
+                  node.buffer_bytes, cycles_per_tile);
+    dot += "  n" + std::to_string(idx_node) + " [label=\"" + node.kind + " " +
+           Escaped(node.name) + buf;
+    for (const uint32_t input : node.inputs) {
+      dot += "  n" + std::to_string(input) + " -> n" +
+             std::to_string(idx_node) + ";\n";
+    }
+  }
+  dot += "}\n";
+  return dot;
+}
+
+std::string TFGraph::ToJSON() const {
+  const std::vector<TFNodeStats> stats = Stats();
+  char buf[300];
+  std::snprintf(buf, sizeof(buf),
+                "{\"tile_size\": [%u, %u], \"num_tiles\": %u, "
+                "\"num_instances\": %u, \"nodes\": [",
+                tile_size_.xsize, tile_size_.ysize, num_tiles_,
+                num_instances_);
+  std::string json = buf;
+  for (size_t idx_node = 0; idx_node < stats.size(); ++idx_node) {
+    const TFNodeStats& node = stats[idx_node];
+    json += idx_node == 0 ? "\n" : ",\n";
+    json += "  {\"name\": \"" + Escaped(node.name) + "\"";
+    std::snprintf(buf, sizeof(buf),
+                  ", \"kind\": \"%s\", \"type\": \"%s\", \"ports\": %u, "
+                  "\"borders\": \"%s\", \"out_size\": [%u, %u], "
+                  "\"buffer_bytes\": %zu, \"num_tiles\": %llu, "
+                  "\"cycles\": %llu, \"inputs\": [",
+                  node.kind, TFTypeUtils::String(node.out_type),
+                  node.num_ports, node.in_borders.ToString().c_str(),
+                  node.out_xsize, node.out_ysize, node.buffer_bytes,
+                  static_cast<unsigned long long>(node.num_tiles),
+                  static_cast<unsigned long long>(node.cycles));
+    json += buf;
+    for (size_t i = 0; i < node.inputs.size(); ++i) {
+      json += (i == 0 ? "" : ", ") + std::to_string(node.inputs[i]);
+    }
+    json += "]}";
+  }
+  json += "\n]}\n";
+  return json;
 }
 
 TFBuilder::TFBuilder() : impl_(new TFBuilderImpl) {}
@@ -1492,4 +1779,35 @@ TFGraphPtr TFBuilder::Finalize(const ImageSize sink_size,
   return impl_->Finalize(sink_size, tile_size, pool);
 }
 
+TFGraphPtr TFBuilder::Finalize(const ImageSize sink_size, ThreadPool* pool) {
+  static const size_t max_bytes = L2CacheBytes() / 2;
+  return impl_->Finalize(sink_size, max_bytes, pool);
+}
+
+TFGraph* TFGraphCache::Find(const uint64_t key, const ImageSize sink_size,
+                           const ImageSize tile_size,
+                           const ThreadPool* pool) const {
+  for (const Entry& entry : entries_) {
+    if (entry.key == key && entry.sink_size == sink_size &&
+        entry.tile_size == tile_size && entry.pool == pool &&
+        entry.num_threads == pool->NumThreads()) {
+      return entry.graph.get();
+    }
+  }
+  return nullptr;
+}
+
+TFGraph* TFGraphCache::Add(const uint64_t key, const ImageSize sink_size,
+                          const ImageSize tile_size, const ThreadPool* pool,
+                          TFGraphPtr graph) {
+  PIK_CHECK(Find(key, sink_size, tile_size, pool) == nullptr);
+  if (entries_.size() == kMaxGraphs) {
+    entries_.erase(entries_.begin());
+  }
+  Entry entry = {key,  sink_size,          tile_size,
+                 pool, pool->NumThreads(), std::move(graph)};
+  entries_.push_back(std::move(entry));
+  return entries_.back().graph.get();
+}
+
 }  // namespace pik
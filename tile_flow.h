@@ -33,6 +33,7 @@
 #include <vector>
 
 #include "bits.h"
+#include "cache_aligned.h"
 #include "compiler_specific.h"
 #include "data_parallel.h"
 #include "image.h"
@@ -240,6 +241,55 @@ struct TFPorts {
 // Breaks the circular dependency between TFGraph and TFBuilder.
 class TFBuilderImpl;
 
+// Replacement source/sink images for TFGraph::Rebind. Images must be added in
+// the order in which their nodes were added to the TFBuilder and, within a
+// node, in ascending port order (as with TFBuilder::SetSource/SetSink).
+struct TFBindings {
+  template <typename T>
+  void AddSource(const Image<T>* source) {
+    sources.push_back(reinterpret_cast<const ImageF*>(source));
+  }
+
+  template <typename T>
+  void AddSource(const Image3<T>* source) {
+    for (int c = 0; c < 3; ++c) AddSource(&source->Plane(c));
+  }
+
+  template <typename T>
+  void AddSink(const Image<T>* sink) {
+    sinks.push_back(reinterpret_cast<const ImageF*>(sink));
+  }
+
+  template <typename T>
+  void AddSink(Image3<T>* sink) {
+    for (int c = 0; c < 3; ++c) AddSink(&sink->Plane(c));
+  }
+
+  std::vector<const ImageF*> sources;
+  std::vector<const ImageF*> sinks;
+};
+
+// Description of a node in a finalized TFGraph, plus its cost if profiling
+// was enabled (see TFGraph::SetProfiling).
+struct TFNodeStats {
+  std::string name;
+  const char* kind;              // "source", "node" or "sink".
+  std::vector<uint32_t> inputs;  // Indices (in Stats order) of input nodes.
+  uint32_t num_ports;
+  TFType out_type;
+  Borders in_borders;
+  // Full (not partial) output size per tile, including borders.
+  uint32_t out_xsize;
+  uint32_t out_ysize;
+  // Per-thread tile buffers for all ports; zero for sinks, which write to
+  // their image.
+  size_t buffer_bytes;
+
+  // Sums over all threads since the last ResetStats.
+  uint64_t num_tiles = 0;
+  uint64_t cycles = 0;  // tsc_timer ticks.
+};
+
 // Compiled graph for a specific size/pool configuration. Thread-compatible.
 class TFGraph {
  public:
@@ -256,10 +306,51 @@ class TFGraph {
 
   // Runs the processing graph for every tile that overlaps sink_size - either
   // on the current thread or on worker threads. Can be called more than once,
-  // or even concurrently across multiple instances.
+  // or even concurrently across multiple instances. Each thread processes
+  // whole tile rows, or if there are too few, horizontally adjacent tiles
+  // (bands) so that their shared source borders are still in cache.
   void Run();
 
+  // Same as Run, but only for tiles in rows [tile_iy_begin, tile_iy_end).
+  // Each tile reads its own input borders, so running all rows in several
+  // calls (e.g. to consume the sink rows as soon as they are final) produces
+  // the same sink as a single Run.
+  void RunTileRows(uint32_t tile_iy_begin, uint32_t tile_iy_end);
+
+  uint32_t NumTileRows() const { return num_tiles_y_; }
+  ImageSize TileSize() const { return tile_size_; }
+
+  // Points all instances at other source/sink images, e.g. the next frame, so
+  // that Run can reuse the graph instead of building a new one. "bindings"
+  // must cover every source/sink port. The new images must have the same
+  // types and sizes as the ones bound before Finalize. Must not be called
+  // concurrently with Run.
+  void Rebind(const TFBindings& bindings);
+
+  // If enabled, subsequent Run* measure the cycles spent in each node for each
+  // tile. This adds two timer reads per node and tile, so it is disabled by
+  // default. Must not be called concurrently with Run.
+  void SetProfiling(bool enabled);
+  void ResetStats();
+
+  // Returns all nodes in execution order (sources, nodes, sinks) with the
+  // costs accumulated since the last ResetStats.
+  std::vector<TFNodeStats> Stats() const;
+
+  // Returns the graph and Stats in Graphviz DOT format, e.g. for
+  // `dot -Tsvg`, or as a JSON object with "tile_size" and "nodes".
+  std::string ToDot() const;
+  std::string ToJSON() const;
+
  private:
+  // Returns the given thread's counters if profiling, otherwise null.
+  uint64_t* Counters(const int thread) const {
+    return profiling_ ? reinterpret_cast<uint64_t*>(counters_[thread].get())
+                      : nullptr;
+  }
+
+  const ImageSize sink_size_;
+  const ImageSize tile_size_;
   const uint32_t num_tiles_x_;
   const uint32_t num_tiles_y_;
   const uint32_t num_tiles_;
@@ -267,6 +358,12 @@ class TFGraph {
   ThreadPool* const pool_;                       // not owned.
   uint32_t num_instances_;                       // = pool_->NumThreads() or 1.
   uint8_t* instances_[ThreadPool::kMaxThreads];  // owned.
+
+  std::vector<TFNodeStats> nodes_;  // Without costs, from the builder.
+  bool profiling_ = false;
+  // Per instance: num_tiles and cycles for each node (interleaved); separate
+  // allocations avoid false sharing.
+  CacheAlignedUniquePtr counters_[ThreadPool::kMaxThreads];
 };
 
 using TFGraphPtr = std::unique_ptr<TFGraph>;
@@ -420,6 +517,12 @@ class TFBuilder {
   TFGraphPtr Finalize(const ImageSize sink_size, const ImageSize tile_size,
                       ThreadPool* pool);
 
+  // As above, but chooses the largest tile size for which the graph's total
+  // per-thread footprint (all buffers plus bookkeeping) fits in half of the
+  // detected L2 cache, leaving room for source/sink rows, and there are still
+  // enough tiles for all threads. Use TFGraph::TileSize to query the result.
+  TFGraphPtr Finalize(const ImageSize sink_size, ThreadPool* pool);
+
  private:
   // Type-erased implementations avoid multiple overloads.
   void BindSource(TFNode* node, TFPortIndex port, const ImageF* source,
@@ -441,6 +544,40 @@ class TFBuilder {
   std::unique_ptr<TFBuilderImpl> impl_;
 };
 
+// Retains finalized graphs so that a stream of same-sized images can Rebind
+// and Run an existing graph instead of rebuilding it. Thread-compatible.
+class TFGraphCache {
+ public:
+  // Returns the graph previously added with the same arguments, or null.
+  // "key" identifies the graph topology and any node arguments (e.g. closure
+  // captures) other than the source/sink images; callers must ensure equal
+  // keys imply equal graphs.
+  TFGraph* Find(uint64_t key, const ImageSize sink_size,
+                const ImageSize tile_size, const ThreadPool* pool) const;
+
+  // Takes ownership of "graph" (from TFBuilder::Finalize with the same
+  // arguments) and returns it. Evicts the least recently added graph if full.
+  TFGraph* Add(uint64_t key, const ImageSize sink_size,
+               const ImageSize tile_size, const ThreadPool* pool,
+               TFGraphPtr graph);
+
+ private:
+  // Enough for the few configurations (e.g. with/without DC upsampling) a
+  // single decoder alternates between.
+  static constexpr size_t kMaxGraphs = 4;
+
+  struct Entry {
+    uint64_t key;
+    ImageSize sink_size;
+    ImageSize tile_size;
+    const ThreadPool* pool;
+    size_t num_threads;  // detects a different pool at the same address.
+    TFGraphPtr graph;
+  };
+
+  std::vector<Entry> entries_;  // oldest first
+};
+
 }  // namespace pik
 
 #endif  // TILE_FLOW_H_
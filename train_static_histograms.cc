@@ -0,0 +1,168 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Generates static_histograms.h, the built-in AC histograms selected by
+// Header::kStaticHistograms, from the AC tokens of fast-mode encodes of a
+// corpus of 8-bit sRGB images:
+//
+//   train_static_histograms static_histograms.h image...
+//
+// The checked-in sets were trained on these five photos and renderings, with
+// JPEGs first converted to PPM by libjpeg (the images are not part of pik):
+// - f3.jpg and verify.jpeg (720x477) from the assets of the Rust Embedded Book,
+// - teapot.ppm (256x256) from the Tk 8.6 demos,
+// - video-001.png (150x103) from the Go image/testdata,
+// - pridosaurus-512.png (512x512, RGBA) from the petgraph assets.
+// Changing the sets (or their order) changes the meaning of existing
+// bitstreams and requires a new Header flag.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "data_parallel.h"
+#include "entropy_coder.h"
+#include "image_io.h"
+#include "padded_bytes.h"
+#include "pik.h"
+#include "pik_info.h"
+#include "pik_params.h"
+
+namespace pik {
+namespace {
+
+// One set per distance, in order of increasing ID.
+const float kDistances[kNumStaticHistograms] = {1.0f, 1.5f, 3.0f};
+
+// Weight of the prior shared by similar histograms, in tokens (see
+// TrainStaticHistograms).
+const double kPriorCount = 500.0;
+
+const char* kPreamble =
+    "// Copyright 2018 Google Inc. All Rights Reserved.\n"
+    "//\n"
+    "// Licensed under the Apache License, Version 2.0 (the \"License\");\n"
+    "// you may not use this file except in compliance with the License.\n"
+    "// You may obtain a copy of the License at\n"
+    "//\n"
+    "//     http://www.apache.org/licenses/LICENSE-2.0\n"
+    "//\n"
+    "// Unless required by applicable law or agreed to in writing, software\n"
+    "// distributed under the License is distributed on an \"AS IS\" BASIS,\n"
+    "// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or "
+    "implied.\n"
+    "// See the License for the specific language governing permissions and\n"
+    "// limitations under the License.\n"
+    "\n"
+    "#ifndef STATIC_HISTOGRAMS_H_\n"
+    "#define STATIC_HISTOGRAMS_H_\n"
+    "\n"
+    "// Built-in AC histograms for Header::kStaticHistograms, only included "
+    "by\n"
+    "// entropy_coder.cc. Generated by train_static_histograms (see there for "
+    "the\n"
+    "// corpus); do not edit. Each set is a histogram section as written by\n"
+    "// BuildAndEncodeHistogramsFast for the tokens of one distance, blended "
+    "as\n"
+    "// described in TrainStaticHistograms.\n"
+    "\n"
+    "#include <stddef.h>\n"
+    "#include <stdint.h>\n"
+    "\n"
+    "namespace pik {\n"
+    "\n";
+
+bool WriteHeader(const std::vector<std::string>& sets, const char* pathname) {
+  FILE* f = fopen(pathname, "w");
+  if (f == nullptr) {
+    fprintf(stderr, "Failed to open %s.\n", pathname);
+    return false;
+  }
+  fputs(kPreamble, f);
+  for (size_t i = 0; i < sets.size(); ++i) {
+    fprintf(f, "// Distance %.1f.\n", kDistances[i]);
+    fprintf(f, "static const uint8_t kStaticHistograms%zu[%zu] = {\n", i + 1,
+            sets[i].size());
+    for (size_t j = 0; j < sets[i].size(); ++j) {
+      fprintf(f, "%s0x%02x,%s", j % 12 == 0 ? "    " : " ",
+              static_cast<uint8_t>(sets[i][j]),
+              (j % 12 == 11 || j + 1 == sets[i].size()) ? "\n" : "");
+    }
+    fprintf(f, "};\n\n");
+  }
+  fprintf(f, "static const uint8_t* const kStaticHistograms[%zu] = {\n   ",
+          sets.size());
+  for (size_t i = 0; i < sets.size(); ++i) {
+    fprintf(f, " kStaticHistograms%zu%s", i + 1,
+            i + 1 == sets.size() ? "};\n" : ",");
+  }
+  fprintf(f, "static const size_t kStaticHistogramsSize[%zu] = {\n   ",
+          sets.size());
+  for (size_t i = 0; i < sets.size(); ++i) {
+    fprintf(f, " sizeof(kStaticHistograms%zu)%s", i + 1,
+            i + 1 == sets.size() ? "};\n" : ",");
+    if (i % 2 == 1 && i + 1 != sets.size()) fprintf(f, "\n   ");
+  }
+  fprintf(f, "\n}  // namespace pik\n\n#endif  // STATIC_HISTOGRAMS_H_\n");
+  if (fclose(f) != 0) {
+    fprintf(stderr, "Failed to write %s.\n", pathname);
+    return false;
+  }
+  return true;
+}
+
+int Run(int argc, char* argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s static_histograms.h image...\n", argv[0]);
+    return 1;
+  }
+
+  ThreadPool pool;
+  std::vector<std::vector<uint64_t> > counts(kNumStaticHistograms);
+  for (int i = 2; i < argc; ++i) {
+    MetaImageB image;
+    if (!ReadMetaImageSrgb8(argv[i], &image)) {
+      fprintf(stderr, "Failed to read %s.\n", argv[i]);
+      return 1;
+    }
+    for (size_t d = 0; d < kNumStaticHistograms; ++d) {
+      CompressParams params;
+      params.fast_mode = true;
+      params.butteraugli_distance = kDistances[d];
+      PikInfo info;
+      info.static_context_counts = &counts[d];
+      PaddedBytes compressed;
+      if (!PixelsToPik(params, image, &pool, &compressed, &info)) {
+        fprintf(stderr, "Failed to compress %s.\n", argv[i]);
+        return 1;
+      }
+    }
+    fprintf(stderr, "%s: %zu x %zu\n", argv[i], image.xsize(), image.ysize());
+  }
+
+  const std::vector<std::string> sets =
+      TrainStaticHistograms(counts, kPriorCount);
+  for (size_t i = 0; i < sets.size(); ++i) {
+    fprintf(stderr, "Set %zu (distance %.1f): %zu bytes\n", i + 1,
+            kDistances[i], sets[i].size());
+  }
+  return WriteHeader(sets, argv[1]) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace pik
+
+int main(int argc, char* argv[]) { return pik::Run(argc, argv); }
@@ -13,7 +13,9 @@
 #include "gamma_correct.h"
 #include "image.h"
 #include "image_io.h"
+#include "profiler.h"
 #include "resample.h"
+#include "simd/simd.h"
 
 namespace pik {
 
@@ -316,22 +318,6 @@ Image3F SuperSample2x2(const Image3F& image) {
   return retval;
 }
 
-Image3F SuperSample4x4(const Image3F& image) {
-  size_t nxs = image.xsize() << 2;
-  size_t nys = image.ysize() << 2;
-  Image3F retval(nxs, nys);
-  for (int c = 0; c < 3; ++c) {
-    for (size_t ny = 0; ny < nys; ++ny) {
-      const float* PIK_RESTRICT row_in = image.PlaneRow(c, ny >> 2);
-      float* PIK_RESTRICT row_out = retval.PlaneRow(c, ny);
-
-      for (size_t nx = 0; nx < nxs; ++nx) {
-        row_out[nx] = row_in[nx >> 2];
-      }
-    }
-  }
-  return retval;
-}
 Image3F SuperSample8x8(const Image3F& image) {
   size_t nxs = image.xsize() << 3;
   size_t nys = image.ysize() << 3;
@@ -349,46 +335,6 @@ Image3F SuperSample8x8(const Image3F& image) {
   return retval;
 }
 
-void Smooth4x4Corners(Image3F& ima) {
-  static const float overshoot = 3.5;
-  static const float m = 1.0 / (4.0 - overshoot);
-  for (int y = 3; y + 3 < ima.ysize(); y += 4) {
-    for (int x = 3; x + 3 < ima.xsize(); x += 4) {
-      float ave[3] = {0};
-      for (int c = 0; c < 3; ++c) {
-        ave[c] += ima.PlaneRow(c, y)[x];
-        ave[c] += ima.PlaneRow(c, y)[x + 1];
-        ave[c] += ima.PlaneRow(c, y + 1)[x];
-        ave[c] += ima.PlaneRow(c, y + 1)[x + 1];
-      }
-      const int off = 2;
-      for (int c = 0; c < 3; ++c) {
-        float others = (ave[c] - overshoot * ima.PlaneRow(c, y)[x]) * m;
-        ima.PlaneRow(c, y - off)[x - off] -= (others - ima.PlaneRow(c, y)[x]);
-        ima.PlaneRow(c, y)[x] = others;
-      }
-      for (int c = 0; c < 3; ++c) {
-        float others = (ave[c] - overshoot * ima.PlaneRow(c, y)[x + 1]) * m;
-        ima.PlaneRow(c, y - off)[x + off + 1] -=
-            (others - ima.PlaneRow(c, y)[x + 1]);
-        ima.PlaneRow(c, y)[x + 1] = others;
-      }
-      for (int c = 0; c < 3; ++c) {
-        float others = (ave[c] - overshoot * ima.PlaneRow(c, y + 1)[x]) * m;
-        ima.PlaneRow(c, y + off + 1)[x - off] -=
-            (others - ima.PlaneRow(c, y + 1)[x]);
-        ima.PlaneRow(c, y + 1)[x] = others;
-      }
-      for (int c = 0; c < 3; ++c) {
-        float others = (ave[c] - overshoot * ima.PlaneRow(c, y + 1)[x + 1]) * m;
-        ima.PlaneRow(c, y + off + 1)[x + off + 1] -=
-            (others - ima.PlaneRow(c, y + 1)[x + 1]);
-        ima.PlaneRow(c, y + 1)[x + 1] = others;
-      }
-    }
-  }
-}
-
 void Subtract(Image3F& a, const Image3F& b) {
   for (int c = 0; c < 3; ++c) {
     for (size_t y = 0; y < a.ysize(); ++y) {
@@ -449,13 +395,13 @@ Image3F ToLinear(const Image3F& image) {
   return out;
 }
 
-Image3F EncodePseudoDC(const Image3F& in) {
+Image3F EncodePseudoDC(const Image3F& in, ThreadPool* pool) {
   Image3F goal = CopyImage(in);
   Image3F image8x8sub;
   static const int kIters = 2;
   for (int ii = 0; ii < kIters; ++ii) {
     if (ii != 0) {
-      Image3F normal = UpscalerReconstruct(image8x8sub);
+      Image3F normal = UpscalerReconstruct(image8x8sub, pool);
       // adjust the image by diff of normal and image.
       for (int c = 0; c < 3; ++c) {
         for (size_t y = 0; y < in.ysize(); ++y) {
@@ -475,14 +421,254 @@ Image3F EncodePseudoDC(const Image3F& in) {
   return image8x8sub;
 }
 
+// Writes row "y" of plane "c" of the 4x4 supersampled "dc" to row_out
+// (4 * dc.xsize() pixels), including the corner smoothing: each 2x2 group of
+// pixels straddling four cells is pulled towards their average (with
+// overshoot), and the pixel two steps diagonally outwards from each of them
+// compensates so that the cell averages are preserved. Computing rows directly
+// from the DC avoids materializing the supersampled image.
+void SuperSample4x4SmoothedRow(const Image3F& dc, const int c, const size_t y,
+                               float* PIK_RESTRICT row_out) {
+  static const float overshoot = 3.5;
+  static const float m = 1.0 / (4.0 - overshoot);
+  const size_t xsize = dc.xsize();
+  const size_t cell_y = y >> 2;
+  const size_t mod_y = y & 3;
+  const float* PIK_RESTRICT row_dc = dc.ConstPlaneRow(c, cell_y);
+  for (size_t x = 0; x < xsize; ++x) {
+    const float v = row_dc[x];
+    row_out[4 * x + 0] = v;
+    row_out[4 * x + 1] = v;
+    row_out[4 * x + 2] = v;
+    row_out[4 * x + 3] = v;
+  }
+
+  // Rows 4i+3 and 4i+4 contain the centers of the corners between cell rows i
+  // and i+1; rows 4i+1 and 4i+6 their diagonal neighbors.
+  const bool is_center = mod_y == 0 || mod_y == 3;
+  const bool in_top_cell = mod_y == 1 || mod_y == 3;
+  if (in_top_cell ? cell_y + 1 >= dc.ysize() : cell_y == 0) return;
+  const size_t top = in_top_cell ? cell_y : cell_y - 1;
+  const float* PIK_RESTRICT row_t = dc.ConstPlaneRow(c, top);
+  const float* PIK_RESTRICT row_b = dc.ConstPlaneRow(c, top + 1);
+  for (size_t x = 0; x + 1 < xsize; ++x) {
+    const float ave = row_t[x] + row_t[x + 1] + row_b[x] + row_b[x + 1];
+    const float v0 = row_dc[x];
+    const float v1 = row_dc[x + 1];
+    const float others0 = (ave - overshoot * v0) * m;
+    const float others1 = (ave - overshoot * v1) * m;
+    if (is_center) {
+      row_out[4 * x + 3] = others0;
+      row_out[4 * x + 4] = others1;
+    } else {
+      row_out[4 * x + 1] = v0 - (others0 - v0);
+      row_out[4 * x + 6] = v1 - (others1 - v1);
+    }
+  }
+}
+
+// Returns the reciprocal of the sum of kernel weights whose taps lie within
+// [0, size) for the output at "pos", i.e. the normalization of Blur with
+// border_ratio = 0.
+float BlurScale(const std::vector<float>& kernel, const int pos,
+                const int size) {
+  const int offset = kernel.size() / 2;
+  const int min = std::max(0, pos - offset);
+  const int max = std::min(size - 1, pos + offset);
+  float weight = 0.0f;
+  for (int j = min; j <= max; ++j) {
+    weight += kernel[j - pos + offset];
+  }
+  return 1.0f / weight;
+}
+
+// Horizontal pass of Blur(in, sigma, 0) for a single row.
+void BlurRow(const float* PIK_RESTRICT row_in, const int xsize,
+             const std::vector<float>& kernel, const float scale_no_border,
+             float* PIK_RESTRICT row_out) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  const int len = kernel.size();
+  const int offset = len / 2;
+
+  const auto border_pixel = [&](const int x) {
+    const int min = std::max(0, x - offset);
+    const int max = std::min(xsize - 1, x + offset);
+    float sum = 0.0f;
+    for (int j = min; j <= max; ++j) {
+      sum += row_in[j] * kernel[j - x + offset];
+    }
+    row_out[x] = sum * BlurScale(kernel, x, xsize);
+  };
+
+  const int begin = std::min(offset, xsize);
+  const int end = std::max(begin, xsize - offset);
+  int x = 0;
+  for (; x < begin; ++x) {
+    border_pixel(x);
+  }
+  const auto scale = set1(d, scale_no_border);
+  for (; x + static_cast<int>(d.N) <= end; x += d.N) {
+    const float* PIK_RESTRICT taps = row_in + x - offset;
+    auto sum = setzero(d);
+    for (int j = 0; j < len; ++j) {
+      sum = mul_add(load_unaligned(d, taps + j), set1(d, kernel[j]), sum);
+    }
+    store_unaligned(sum * scale, d, row_out + x);
+  }
+  for (; x < end; ++x) {
+    const float* PIK_RESTRICT taps = row_in + x - offset;
+    float sum = 0.0f;
+    for (int j = 0; j < len; ++j) {
+      sum += taps[j] * kernel[j];
+    }
+    row_out[x] = sum * scale_no_border;
+  }
+  for (; x < xsize; ++x) {
+    border_pixel(x);
+  }
+}
+
+// Vertical pass of Blur(in, sigma, 0) for output row "y".
+void BlurColumns(const ImageF& in, const std::vector<float>& kernel,
+                 const int y, float* PIK_RESTRICT row_out) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  const int ysize = in.ysize();
+  const int offset = kernel.size() / 2;
+  const int min = std::max(0, y - offset);
+  const int max = std::min(ysize - 1, y + offset);
+  const auto scale = set1(d, BlurScale(kernel, y, ysize));
+  for (size_t x = 0; x < in.xsize(); x += d.N) {
+    auto sum = setzero(d);
+    for (int j = min; j <= max; ++j) {
+      sum = mul_add(load(d, in.ConstRow(j) + x),
+                    set1(d, kernel[j - y + offset]), sum);
+    }
+    store(sum * scale, d, row_out + x);
+  }
+}
+
+// Catmull-Rom weights for 2x upsampling. Even outputs 2k lie at k - 0.25 in
+// input coordinates and use taps [k - 2, k + 1]; odd outputs lie at k + 0.25
+// and use taps [k - 1, k + 2].
+struct Upsample2xWeights {
+  Upsample2xWeights() {
+    const kernel::CatmullRom kernel;
+    for (int i = 0; i < 4; ++i) {
+      even[i] = kernel(1.75f - i);
+      odd[i] = kernel(1.25f - i);
+    }
+  }
+
+  float even[4];
+  float odd[4];
+};
+
+// Vertical pass of the 2x upsampling: output row "y" from rows of "in".
+void Upsample2xColumns(const ImageF& in, const Upsample2xWeights& weights,
+                       const int y, float* PIK_RESTRICT row_out) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  const int ysize = in.ysize();
+  const int first = (y >> 1) - ((y & 1) ? 1 : 2);
+  const float* w = (y & 1) ? weights.odd : weights.even;
+  const float* PIK_RESTRICT rows[4];
+  for (int i = 0; i < 4; ++i) {
+    rows[i] = in.ConstRow(Mirror(first + i, ysize));
+  }
+  const auto w0 = set1(d, w[0]);
+  const auto w1 = set1(d, w[1]);
+  const auto w2 = set1(d, w[2]);
+  const auto w3 = set1(d, w[3]);
+  for (size_t x = 0; x < in.xsize(); x += d.N) {
+    auto sum = load(d, rows[0] + x) * w0;
+    sum = mul_add(load(d, rows[1] + x), w1, sum);
+    sum = mul_add(load(d, rows[2] + x), w2, sum);
+    sum = mul_add(load(d, rows[3] + x), w3, sum);
+    store(sum, d, row_out + x);
+  }
+}
+
+// Horizontal pass of the 2x upsampling; row_out has 2 * xsize pixels.
+void Upsample2xRow(const float* PIK_RESTRICT row_in, const int xsize,
+                   const Upsample2xWeights& weights,
+                   float* PIK_RESTRICT row_out) {
+  const float* PIK_RESTRICT we = weights.even;
+  const float* PIK_RESTRICT wo = weights.odd;
+  const auto border_pair = [&](const int x) {
+    const float m2 = row_in[Mirror(x - 2, xsize)];
+    const float m1 = row_in[Mirror(x - 1, xsize)];
+    const float c0 = row_in[Mirror(x, xsize)];
+    const float p1 = row_in[Mirror(x + 1, xsize)];
+    const float p2 = row_in[Mirror(x + 2, xsize)];
+    row_out[2 * x] = m2 * we[0] + m1 * we[1] + c0 * we[2] + p1 * we[3];
+    row_out[2 * x + 1] = m1 * wo[0] + c0 * wo[1] + p1 * wo[2] + p2 * wo[3];
+  };
+
+  const int begin = std::min(2, xsize);
+  const int end = std::max(begin, xsize - 2);
+  int x = 0;
+  for (; x < begin; ++x) {
+    border_pair(x);
+  }
+  for (; x < end; ++x) {
+    const float m2 = row_in[x - 2];
+    const float m1 = row_in[x - 1];
+    const float c0 = row_in[x];
+    const float p1 = row_in[x + 1];
+    const float p2 = row_in[x + 2];
+    row_out[2 * x] = m2 * we[0] + m1 * we[1] + c0 * we[2] + p1 * we[3];
+    row_out[2 * x + 1] = m1 * wo[0] + c0 * wo[1] + p1 * wo[2] + p2 * wo[3];
+  }
+  for (; x < xsize; ++x) {
+    border_pair(x);
+  }
+}
+
 }  // namespace
 
-Image3F UpscalerReconstruct(const Image3F& in) {
-  Image3F out1 = SuperSample4x4(in);
-  Smooth4x4Corners(out1);
-  out1 = Blur(out1, 2.5);
-  Image3F out(out1.xsize() * 2, out1.ysize() * 2);
-  Upsample<slow::Upsampler>(ExecutorLoop(), out1, kernel::CatmullRom(), &out);
+Image3F UpscalerReconstruct(const Image3F& dc, ThreadPool* pool) {
+  PROFILER_FUNC;
+  const int xsize4 = dc.xsize() * 4;
+  const int ysize4 = dc.ysize() * 4;
+  const std::vector<float> kernel = ComputeKernel(2.5f);
+  const float scale_no_border = BlurScale(kernel, kernel.size() / 2,
+                                          kernel.size());
+  const Upsample2xWeights weights;
+
+  // Per-thread row of the supersampled image or of the vertically upsampled
+  // blurred image.
+  ImageF row_buffers(xsize4, std::max<size_t>(1, pool->NumThreads()));
+
+  // Supersampling (4x4) and horizontal blur.
+  Image3F blurred_rows(xsize4, ysize4);
+  pool->Run(0, 3 * ysize4, [&](const int task, const int thread) {
+    const int c = task / ysize4;
+    const int y = task % ysize4;
+    float* PIK_RESTRICT row = row_buffers.Row(thread);
+    SuperSample4x4SmoothedRow(dc, c, y, row);
+    BlurRow(row, xsize4, kernel, scale_no_border,
+            blurred_rows.PlaneRow(c, y));
+  });
+
+  // Vertical blur.
+  Image3F blurred(xsize4, ysize4);
+  pool->Run(0, 3 * ysize4, [&](const int task, const int thread) {
+    const int c = task / ysize4;
+    const int y = task % ysize4;
+    BlurColumns(blurred_rows.Plane(c), kernel, y, blurred.PlaneRow(c, y));
+  });
+
+  // Catmull-Rom 2x upsampling.
+  Image3F out(xsize4 * 2, ysize4 * 2);
+  pool->Run(0, 3 * out.ysize(), [&](const int task, const int thread) {
+    const int c = task / out.ysize();
+    const int y = task % out.ysize();
+    float* PIK_RESTRICT row = row_buffers.Row(thread);
+    Upsample2xColumns(blurred.Plane(c), weights, y, row);
+    Upsample2xRow(row, xsize4, weights, out.PlaneRow(c, y));
+  });
   return out;
 }
 
@@ -1,11 +1,15 @@
 #ifndef UPSCALER_H_
 #define UPSCALER_H_
 
+#include "data_parallel.h"
 #include "image.h"
 
 namespace pik {
 
-Image3F UpscalerReconstruct(const Image3F& dc);
+// Returns an 8x upsampled approximation of the image whose 8x8 block averages
+// are "dc" (e.g. for DC-only previews): corner-smoothed 4x4 supersampling,
+// blur and Catmull-Rom 2x upsampling. Computed row by row on "pool".
+Image3F UpscalerReconstruct(const Image3F& dc, ThreadPool* pool);
 
 }  // namespace pik
 
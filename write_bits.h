@@ -95,6 +95,57 @@ PIK_INLINE void RewindStorage(const size_t pos0, size_t* PIK_RESTRICT pos,
   array[pos0 >> 3] &= kRewindMasks[pos0 & 7];
 }
 
+// Faster alternative to a sequence of WriteBits for long runs of small
+// writes: bits are gathered in a 64-bit register and stored 32 at a time
+// instead of a read-modify-write of memory per call. Writes to "array" the
+// same bits as WriteBits (including zero-initializing bytes beyond *pos).
+// Callers must call Flush, which updates "*pos"; "array" must not be accessed
+// by other means until then.
+class BufferedBitWriter {
+ public:
+  BufferedBitWriter(size_t* PIK_RESTRICT pos, uint8_t* PIK_RESTRICT array)
+      : pos_(pos), array_(array), byte_pos_(*pos >> 3), num_bits_(*pos & 7) {
+    // Bits already written to the partial byte.
+    buffer_ = array[byte_pos_] & ((1u << num_bits_) - 1);
+  }
+
+  PIK_INLINE void Write(const size_t n_bits, const uint64_t bits) {
+    PIK_ASSERT((bits >> n_bits) == 0);
+    PIK_ASSERT(n_bits <= 32);
+#if PIK_BYTE_ORDER_LITTLE
+    buffer_ |= bits << num_bits_;
+    num_bits_ += n_bits;
+    if (num_bits_ >= 32) {
+      const uint32_t lower = static_cast<uint32_t>(buffer_);
+      memcpy(array_ + byte_pos_, &lower, sizeof(lower));
+      byte_pos_ += 4;
+      buffer_ >>= 32;
+      num_bits_ -= 32;
+    }
+#else
+    size_t pos = byte_pos_ * 8 + num_bits_;
+    WriteBits(n_bits, bits, &pos, array_);
+    byte_pos_ = pos >> 3;
+    num_bits_ = pos & 7;
+#endif
+  }
+
+  // Stores any buffered bits and updates "*pos". Idempotent.
+  void Flush() {
+#if PIK_BYTE_ORDER_LITTLE
+    memcpy(array_ + byte_pos_, &buffer_, sizeof(buffer_));
+#endif
+    *pos_ = byte_pos_ * 8 + num_bits_;
+  }
+
+ private:
+  size_t* PIK_RESTRICT pos_;
+  uint8_t* PIK_RESTRICT array_;
+  size_t byte_pos_;  // of the first byte not yet stored
+  uint64_t buffer_;  // lower num_bits_ are valid, all others zero
+  size_t num_bits_;  // < 32 between calls
+};
+
 class BitWriter {
  public:
   BitWriter(size_t* storage_ix, uint8_t* storage)
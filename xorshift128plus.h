@@ -39,6 +39,18 @@ class Xorshift128Plus {
     }
   }
 
+  // Seeds all lanes from SplitMix64 of "seed" instead of jumping, which is
+  // much cheaper and thus suitable for one generator per image row.
+  explicit Xorshift128Plus(uint64_t seed) {
+    for (size_t i = 0; i < 2 * N; ++i) {
+      seed += 0x9E3779B97F4A7C15ull;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      state_[i] = z ^ (z >> 31);
+    }
+  }
+
   // Returns 128 or 256 bit vector of random bits (u64 lane type).
   D::V operator()() {
     const D d;
@@ -19,8 +19,15 @@
 #include <array>
 #include <type_traits>
 
+#undef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#include "common.h"
 #include "compiler_specific.h"
 #include "gamma_correct.h"
+#include "opsin_image.h"
+#include "opsin_inverse.h"
+#include "profiler.h"
+#include "simd/simd.h"
 
 namespace pik {
 
@@ -61,175 +68,302 @@ constexpr double YUVtoRGBMatrix[9] = {
   0.0
 };
 
-#define clamp(V, M) (uint16_t)((V) < 0 ? 0 : ((V) > (M) ? (M) : V))
-
-// Input range:  [0 .. (1<<bits)-1]
-// Output range: [0.0 .. 1.0]
-void YUVPixelToRGB(uint16_t yv, uint16_t uv, uint16_t vv, int bits,
-                   double* r, double* g, double* b) {
-  const double norm = 1. / ((1 << bits) - 1);
-  const double y = yv * norm - RGBtoYUVMatrixAdd[0];
-  const double u = uv * norm - RGBtoYUVMatrixAdd[1];
-  const double v = vv * norm - RGBtoYUVMatrixAdd[2];
-  *r = YUVtoRGBMatrix[0] * y + YUVtoRGBMatrix[1] * u + YUVtoRGBMatrix[2] * v;
-  *g = YUVtoRGBMatrix[3] * y + YUVtoRGBMatrix[4] * u + YUVtoRGBMatrix[5] * v;
-  *b = YUVtoRGBMatrix[6] * y + YUVtoRGBMatrix[7] * u + YUVtoRGBMatrix[8] * v;
-}
+namespace {
 
-// Input range:  [0 .. (1<<bits)-1]
-template <typename T>
-void YUVPixelToRGB(uint16_t yv, uint16_t uv, uint16_t vv, int bits,
-                   T *r, T *g, T *b) {
-  const int maxv_out = (1 << (8 * sizeof(T))) - 1;
-  double rd, gd, bd;
-  YUVPixelToRGB(yv, uv, vv, bits, &rd, &gd, &bd);
-  *r = clamp(.5 + maxv_out * rd, maxv_out);
-  *g = clamp(.5 + maxv_out * gd, maxv_out);
-  *b = clamp(.5 + maxv_out * bd, maxv_out);
+// Pixels per stack buffer of converted rows.
+constexpr size_t kChunkSize = 256;
+
+// Input range:  [0 .. (1<<bits)-1], norm = 1 / ((1<<bits)-1).
+// Output range: [0.0 .. 1.0] * mul + add
+// Reads/writes whole vectors, i.e. past num up to the end of the buffers.
+void YUVRowToRGB(const float* PIK_RESTRICT row_y,
+                 const float* PIK_RESTRICT row_u,
+                 const float* PIK_RESTRICT row_v, const size_t num,
+                 const float norm, const float mul, const float add,
+                 float* PIK_RESTRICT row_r, float* PIK_RESTRICT row_g,
+                 float* PIK_RESTRICT row_b) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  using V = Full<float>::V;
+  const V vnorm = set1(d, norm);
+  const V vmul = set1(d, mul);
+  const V vadd = set1(d, add);
+  const V add_y = set1(d, static_cast<float>(RGBtoYUVMatrixAdd[0]));
+  const V add_uv = set1(d, static_cast<float>(RGBtoYUVMatrixAdd[1]));
+  const V mul_y = set1(d, static_cast<float>(YUVtoRGBMatrix[0]));
+  const V mul_rv = set1(d, static_cast<float>(YUVtoRGBMatrix[2]));
+  const V mul_gu = set1(d, static_cast<float>(YUVtoRGBMatrix[4]));
+  const V mul_gv = set1(d, static_cast<float>(YUVtoRGBMatrix[5]));
+  const V mul_bu = set1(d, static_cast<float>(YUVtoRGBMatrix[7]));
+  static_assert(YUVtoRGBMatrix[1] == 0.0 && YUVtoRGBMatrix[8] == 0.0,
+                "Skipped zero coefficients");
+  static_assert(YUVtoRGBMatrix[0] == YUVtoRGBMatrix[3] &&
+                    YUVtoRGBMatrix[0] == YUVtoRGBMatrix[6],
+                "Shared luma coefficient");
+
+  for (size_t x = 0; x < num; x += d.N) {
+    const V y = mul_y * (load(d, row_y + x) * vnorm - add_y);
+    const V u = load(d, row_u + x) * vnorm - add_uv;
+    const V v = load(d, row_v + x) * vnorm - add_uv;
+    const V r = mul_add(mul_rv, v, y);
+    const V g = mul_add(mul_gv, v, mul_add(mul_gu, u, y));
+    const V b = mul_add(mul_bu, u, y);
+    store(mul_add(r, vmul, vadd), d, row_r + x);
+    store(mul_add(g, vmul, vadd), d, row_g + x);
+    store(mul_add(b, vmul, vadd), d, row_b + x);
+  }
 }
 
 // Input range:  [0.0 .. 1.0]
-// Output range: [0 .. (1<<bits)-1]
-void RGBPixelToYUV(double r, double g, double b, int bits,
-                   uint16_t *y, uint16_t *u, uint16_t *v) {
-  const double maxv = (1 << bits) - 1;
-  const double Y = RGBtoYUVMatrixAdd[0] +
-                     RGBtoYUVMatrix[0] * r +
-                     RGBtoYUVMatrix[1] * g +
-                     RGBtoYUVMatrix[2] * b;
-  const double U = RGBtoYUVMatrixAdd[1] +
-                     RGBtoYUVMatrix[3] * r +
-                     RGBtoYUVMatrix[4] * g +
-                     RGBtoYUVMatrix[5] * b;
-  const double V = RGBtoYUVMatrixAdd[2] +
-                     RGBtoYUVMatrix[6] * r +
-                     RGBtoYUVMatrix[7] * g +
-                     RGBtoYUVMatrix[8] * b;
-  *y = clamp(.5 + maxv * Y, maxv);
-  *u = clamp(.5 + maxv * U, maxv);
-  *v = clamp(.5 + maxv * V, maxv);
+// Output range: [0.0 .. (1<<bits)-1] + 0.5, i.e. rounded by truncation.
+// Reads/writes whole vectors, i.e. past num up to the end of the buffers.
+void RGBRowToYUV(const float* PIK_RESTRICT row_r,
+                 const float* PIK_RESTRICT row_g,
+                 const float* PIK_RESTRICT row_b, const size_t num,
+                 const float maxv, float* PIK_RESTRICT row_y,
+                 float* PIK_RESTRICT row_u, float* PIK_RESTRICT row_v) {
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  using V = Full<float>::V;
+  V mul[9];
+  for (int i = 0; i < 9; ++i) {
+    mul[i] = set1(d, static_cast<float>(RGBtoYUVMatrix[i] * maxv));
+  }
+  V add[3];
+  for (int i = 0; i < 3; ++i) {
+    add[i] = set1(d, static_cast<float>(RGBtoYUVMatrixAdd[i] * maxv + 0.5));
+  }
+
+  for (size_t x = 0; x < num; x += d.N) {
+    const V r = load(d, row_r + x);
+    const V g = load(d, row_g + x);
+    const V b = load(d, row_b + x);
+    store(mul_add(mul[2], b, mul_add(mul[1], g, mul_add(mul[0], r, add[0]))),
+          d, row_y + x);
+    store(mul_add(mul[5], b, mul_add(mul[4], g, mul_add(mul[3], r, add[1]))),
+          d, row_u + x);
+    store(mul_add(mul[8], b, mul_add(mul[7], g, mul_add(mul[6], r, add[2]))),
+          d, row_v + x);
+  }
+}
+
+// Srgb8ToLinearDirect sampled at kStepsPerUnit points per unit on [0, 255],
+// for linearly interpolating the (non-integer) sRGB values computed from YUV.
+// The relative error is below 1E-5.
+constexpr int kSrgbStepsPerUnit = 16;
+constexpr int kSrgbTableSize = 255 * kSrgbStepsPerUnit + 2;
+
+const float* NewSrgbToLinearInterpolationTable() {
+  float* table = new float[kSrgbTableSize];
+  for (int i = 0; i < kSrgbTableSize; ++i) {
+    table[i] = Srgb8ToLinearDirect(static_cast<float>(i) / kSrgbStepsPerUnit);
+  }
+  return table;
+}
+
+const float* SrgbToLinearInterpolationTable() {
+  static const float* const kTable = NewSrgbToLinearInterpolationTable();
+  return kTable;
+}
+
+// Linearizes "num" sRGB values in place; same ranges as Srgb8ToLinearDirect.
+void LinearizeRow(const float* PIK_RESTRICT table, const size_t num,
+                  float* PIK_RESTRICT row) {
+  for (size_t x = 0; x < num; ++x) {
+    const float pos =
+        std::min(std::max(row[x], 0.0f), 255.0f) * kSrgbStepsPerUnit;
+    const int i = static_cast<int>(pos);
+    const float frac = pos - i;
+    row[x] = table[i] + frac * (table[i + 1] - table[i]);
+  }
+}
+
+// Writes "num" samples starting at out_x0 of row out_y of the 2x2 upsampled
+// chroma plane, interpolated with weights 9/16, 3/16, 3/16, 1/16 from the
+// nearest and its horizontal/vertical/diagonal neighbor samples.
+template <typename T>
+void SuperSampleRow(const ImageU& in, const size_t out_y, const size_t out_x0,
+                    const size_t num, T* PIK_RESTRICT row_out) {
+  const int c_xsize = in.xsize();
+  const int c_ysize = in.ysize();
+  const int y1 = out_y >> 1;
+  const int y0 = (out_y & 1) ? std::min(y1 + 1, c_ysize - 1)
+                             : std::max(y1 - 1, 0);
+  const uint16_t* const PIK_RESTRICT row1 = in.ConstRow(y1);
+  const uint16_t* const PIK_RESTRICT row0 = in.ConstRow(y0);
+  for (size_t i = 0; i < num; ++i) {
+    const size_t out_x = out_x0 + i;
+    const int x1 = out_x >> 1;
+    const int x0 = (out_x & 1) ? std::min(x1 + 1, c_xsize - 1)
+                               : std::max(x1 - 1, 0);
+    row_out[i] = (9 * row1[x1] + 3 * row1[x0] +
+                  3 * row0[x1] + 1 * row0[x0] + 8) / 16;
+  }
 }
 
-// Output range: [0 .. (1<<bits)-1]
+// Converts "num" values (already offset by 0.5) to integers in [0, maxv] by
+// truncation. (A separate function avoids reloading captured variables after
+// each store, which might alias them.)
 template <typename T>
-void RGBPixelToYUV(T r, T g, T b, int bits,
-                   uint16_t *y, uint16_t *u, uint16_t *v) {
-  const double norm = 1. / ((1 << (8 * sizeof(T))) - 1);
-  const double rd = r * norm;
-  const double gd = g * norm;
-  const double bd = b * norm;
-  RGBPixelToYUV(rd, gd, bd, bits, y, u, v);
+void RoundRow(const float* PIK_RESTRICT in, const size_t num, const float maxv,
+              T* PIK_RESTRICT out) {
+  for (size_t x = 0; x < num; ++x) {
+    out[x] = static_cast<int>(std::min(std::max(in[x], 0.0f), maxv));
+  }
 }
 
+// Zero-initializes the remainder of the last vector after "num" values.
+void ZeroTail(const size_t num, float* PIK_RESTRICT row) {
+  constexpr size_t N = SIMD_NAMESPACE::Full<float>::N;
+  std::fill(row + num, row + DivCeil(num, N) * N, 0.0f);
+}
+
+}  // namespace
+
 //
 // Wrapper functions to convert between 8-bit, 16-bit or linear sRGB images
-// and 8, 10 or 12 bit YUV Rec 709 images.
+// and 8, 10 or 12 bit YUV Rec 709 images. Rows are converted in parallel, in
+// chunks of kChunkSize pixels.
 //
 
 template <typename T>
-void YUVRec709ImageToRGB(const Image3U& yuv, int bit_depth, Image3<T>* rgb) {
-  for (size_t y = 0; y < yuv.ysize(); ++y) {
-    const uint16_t* PIK_RESTRICT row_yuv0 = yuv.PlaneRow(0, y);
-    const uint16_t* PIK_RESTRICT row_yuv1 = yuv.PlaneRow(1, y);
-    const uint16_t* PIK_RESTRICT row_yuv2 = yuv.PlaneRow(2, y);
-
-    T* PIK_RESTRICT row_rgb0 = rgb->PlaneRow(0, y);
-    T* PIK_RESTRICT row_rgb1 = rgb->PlaneRow(1, y);
-    T* PIK_RESTRICT row_rgb2 = rgb->PlaneRow(2, y);
-    for (size_t x = 0; x < yuv.xsize(); ++x) {
-      YUVPixelToRGB(row_yuv0[x], row_yuv1[x], row_yuv2[x], bit_depth,
-                    &row_rgb0[x], &row_rgb1[x], &row_rgb2[x]);
+void YUVRec709ImageToRGB(const Image3U& yuv, int bit_depth, ThreadPool* pool,
+                         Image3<T>* rgb) {
+  const size_t xsize = yuv.xsize();
+  const float norm = 1.0f / ((1 << bit_depth) - 1);
+  const float maxv_out = (1 << (8 * sizeof(T))) - 1;
+  pool->Run(0, yuv.ysize(), [&](const int task, const int thread) {
+    const size_t y = task;
+    SIMD_ALIGN float in[3][kChunkSize];
+    SIMD_ALIGN float out[3][kChunkSize];
+    for (size_t x0 = 0; x0 < xsize; x0 += kChunkSize) {
+      const size_t num = std::min(kChunkSize, xsize - x0);
+      for (int c = 0; c < 3; ++c) {
+        const uint16_t* PIK_RESTRICT row_yuv = yuv.ConstPlaneRow(c, y) + x0;
+        for (size_t x = 0; x < num; ++x) {
+          in[c][x] = row_yuv[x];
+        }
+        ZeroTail(num, in[c]);
+      }
+      YUVRowToRGB(in[0], in[1], in[2], num, norm, maxv_out, 0.5f, out[0],
+                  out[1], out[2]);
+      for (int c = 0; c < 3; ++c) {
+        RoundRow(out[c], num, maxv_out, rgb->PlaneRow(c, y) + x0);
+      }
     }
-  }
+  });
 }
 
-Image3B RGB8ImageFromYUVRec709(const Image3U& yuv, int bit_depth) {
+Image3B RGB8ImageFromYUVRec709(const Image3U& yuv, int bit_depth,
+                               ThreadPool* pool) {
+  PROFILER_FUNC;
   Image3B rgb(yuv.xsize(), yuv.ysize());
-  YUVRec709ImageToRGB(yuv, bit_depth, &rgb);
+  YUVRec709ImageToRGB(yuv, bit_depth, pool, &rgb);
   return rgb;
 }
 
-Image3U RGB16ImageFromYUVRec709(const Image3U& yuv, int bit_depth) {
+Image3U RGB16ImageFromYUVRec709(const Image3U& yuv, int bit_depth,
+                                ThreadPool* pool) {
+  PROFILER_FUNC;
   Image3U rgb(yuv.xsize(), yuv.ysize());
-  YUVRec709ImageToRGB(yuv, bit_depth, &rgb);
+  YUVRec709ImageToRGB(yuv, bit_depth, pool, &rgb);
   return rgb;
 }
 
-Image3F RGBLinearImageFromYUVRec709(const Image3U& yuv, int bit_depth) {
-  Image3F rgb(yuv.xsize(), yuv.ysize());
-  for (int y = 0; y < yuv.ysize(); ++y) {
-    const uint16_t* PIK_RESTRICT row_yuv0 = yuv.ConstPlaneRow(0, y);
-    const uint16_t* PIK_RESTRICT row_yuv1 = yuv.ConstPlaneRow(1, y);
-    const uint16_t* PIK_RESTRICT row_yuv2 = yuv.ConstPlaneRow(2, y);
-    float* PIK_RESTRICT row_linear0 = rgb.PlaneRow(0, y);
-    float* PIK_RESTRICT row_linear1 = rgb.PlaneRow(1, y);
-    float* PIK_RESTRICT row_linear2 = rgb.PlaneRow(2, y);
-    for (int x = 0; x < yuv.xsize(); ++x) {
-      double rd, gd, bd;
-      YUVPixelToRGB(row_yuv0[x], row_yuv1[x], row_yuv2[x], bit_depth, &rd, &gd,
-                    &bd);
-      row_linear0[x] = Srgb8ToLinearDirect(rd * 255.0);
-      row_linear1[x] = Srgb8ToLinearDirect(gd * 255.0);
-      row_linear2[x] = Srgb8ToLinearDirect(bd * 255.0);
+Image3F RGBLinearImageFromYUVRec709(const Image3U& yuv, int bit_depth,
+                                    ThreadPool* pool) {
+  PROFILER_FUNC;
+  const size_t xsize = yuv.xsize();
+  const float norm = 1.0f / ((1 << bit_depth) - 1);
+  const float* table = SrgbToLinearInterpolationTable();
+  Image3F rgb(xsize, yuv.ysize());
+  pool->Run(0, yuv.ysize(), [&](const int task, const int thread) {
+    const size_t y = task;
+    SIMD_ALIGN float in[3][kChunkSize];
+    for (size_t x0 = 0; x0 < xsize; x0 += kChunkSize) {
+      const size_t num = std::min(kChunkSize, xsize - x0);
+      for (int c = 0; c < 3; ++c) {
+        const uint16_t* PIK_RESTRICT row_yuv = yuv.ConstPlaneRow(c, y) + x0;
+        for (size_t x = 0; x < num; ++x) {
+          in[c][x] = row_yuv[x];
+        }
+        ZeroTail(num, in[c]);
+      }
+      // Output rows are aligned because kChunkSize is a multiple of N.
+      float* PIK_RESTRICT row_linear0 = rgb.PlaneRow(0, y) + x0;
+      float* PIK_RESTRICT row_linear1 = rgb.PlaneRow(1, y) + x0;
+      float* PIK_RESTRICT row_linear2 = rgb.PlaneRow(2, y) + x0;
+      YUVRowToRGB(in[0], in[1], in[2], num, norm, 255.0f, 0.0f, row_linear0,
+                  row_linear1, row_linear2);
+      LinearizeRow(table, num, row_linear0);
+      LinearizeRow(table, num, row_linear1);
+      LinearizeRow(table, num, row_linear2);
     }
-  }
+  });
   return rgb;
 }
 
-template <typename T>
-void RGBImageToYUVRec709(const Image3<T>& rgb, int bit_depth, Image3U* yuv) {
-  for (int y = 0; y < rgb.ysize(); ++y) {
-    const T* PIK_RESTRICT row_rgb0 = rgb.ConstPlaneRow(0, y);
-    const T* PIK_RESTRICT row_rgb1 = rgb.ConstPlaneRow(1, y);
-    const T* PIK_RESTRICT row_rgb2 = rgb.ConstPlaneRow(2, y);
-    uint16_t* PIK_RESTRICT row_yuv0 = yuv->PlaneRow(0, y);
-    uint16_t* PIK_RESTRICT row_yuv1 = yuv->PlaneRow(1, y);
-    uint16_t* PIK_RESTRICT row_yuv2 = yuv->PlaneRow(2, y);
-    for (int x = 0; x < rgb.xsize(); ++x) {
-      RGBPixelToYUV(row_rgb0[x], row_rgb1[x], row_rgb2[x], bit_depth,
-                    &row_yuv0[x], &row_yuv1[x], &row_yuv2[x]);
+// "to_srgb" converts T to sRGB in [0.0 .. 1.0].
+template <typename T, class ToSrgb>
+void RGBImageToYUVRec709(const Image3<T>& rgb, const ToSrgb& to_srgb,
+                         int bit_depth, ThreadPool* pool, Image3U* yuv) {
+  const size_t xsize = rgb.xsize();
+  const float maxv = (1 << bit_depth) - 1;
+  pool->Run(0, rgb.ysize(), [&](const int task, const int thread) {
+    const size_t y = task;
+    SIMD_ALIGN float in[3][kChunkSize];
+    SIMD_ALIGN float out[3][kChunkSize];
+    for (size_t x0 = 0; x0 < xsize; x0 += kChunkSize) {
+      const size_t num = std::min(kChunkSize, xsize - x0);
+      for (int c = 0; c < 3; ++c) {
+        const T* PIK_RESTRICT row_rgb = rgb.ConstPlaneRow(c, y) + x0;
+        for (size_t x = 0; x < num; ++x) {
+          in[c][x] = to_srgb(row_rgb[x]);
+        }
+        ZeroTail(num, in[c]);
+      }
+      RGBRowToYUV(in[0], in[1], in[2], num, maxv, out[0], out[1], out[2]);
+      for (int c = 0; c < 3; ++c) {
+        RoundRow(out[c], num, maxv, yuv->PlaneRow(c, y) + x0);
+      }
     }
-  }
+  });
 }
 
-Image3U YUVRec709ImageFromRGB8(const Image3B& rgb, int out_bit_depth) {
+Image3U YUVRec709ImageFromRGB8(const Image3B& rgb, int out_bit_depth,
+                               ThreadPool* pool) {
+  PROFILER_FUNC;
   Image3U yuv(rgb.xsize(), rgb.ysize());
-  RGBImageToYUVRec709(rgb, out_bit_depth, &yuv);
+  const float norm = 1.0f / 255;
+  RGBImageToYUVRec709(rgb, [norm](const uint8_t v) { return v * norm; },
+                      out_bit_depth, pool, &yuv);
   return yuv;
 }
 
-Image3U YUVRec709ImageFromRGB16(const Image3U& rgb, int out_bit_depth) {
+Image3U YUVRec709ImageFromRGB16(const Image3U& rgb, int out_bit_depth,
+                                ThreadPool* pool) {
+  PROFILER_FUNC;
   Image3U yuv(rgb.xsize(), rgb.ysize());
-  RGBImageToYUVRec709(rgb, out_bit_depth, &yuv);
+  const float norm = 1.0f / 65535;
+  RGBImageToYUVRec709(rgb, [norm](const uint16_t v) { return v * norm; },
+                      out_bit_depth, pool, &yuv);
   return yuv;
 }
 
-Image3U YUVRec709ImageFromRGBLinear(const Image3F& rgb, int out_bit_depth) {
+Image3U YUVRec709ImageFromRGBLinear(const Image3F& rgb, int out_bit_depth,
+                                    ThreadPool* pool) {
+  PROFILER_FUNC;
   Image3U yuv(rgb.xsize(), rgb.ysize());
   const double norm = 1. / 255.;
-  for (int y = 0; y < yuv.ysize(); ++y) {
-    const float* PIK_RESTRICT row_linear0 = rgb.ConstPlaneRow(0, y);
-    const float* PIK_RESTRICT row_linear1 = rgb.ConstPlaneRow(1, y);
-    const float* PIK_RESTRICT row_linear2 = rgb.ConstPlaneRow(2, y);
-    uint16_t* PIK_RESTRICT row_yuv0 = yuv.PlaneRow(0, y);
-    uint16_t* PIK_RESTRICT row_yuv1 = yuv.PlaneRow(1, y);
-    uint16_t* PIK_RESTRICT row_yuv2 = yuv.PlaneRow(2, y);
-    for (int x = 0; x < yuv.xsize(); ++x) {
-      double rd = LinearToSrgb8Direct(row_linear0[x]) * norm;
-      double gd = LinearToSrgb8Direct(row_linear1[x]) * norm;
-      double bd = LinearToSrgb8Direct(row_linear2[x]) * norm;
-      RGBPixelToYUV(rd, gd, bd, out_bit_depth, &row_yuv0[x], &row_yuv1[x],
-                    &row_yuv2[x]);
-    }
-  }
+  RGBImageToYUVRec709(
+      rgb, [norm](const float v) { return LinearToSrgb8Direct(v) * norm; },
+      out_bit_depth, pool, &yuv);
   return yuv;
 }
 
-void SubSampleChroma(const Image3U& yuv,
-                     int bit_depth,
-                     ImageU* yplane,
-                     ImageU* uplane,
-                     ImageU* vplane) {
+void SubSampleChroma(const Image3U& yuv, int bit_depth, ThreadPool* pool,
+                     ImageU* yplane, ImageU* uplane, ImageU* vplane) {
+  PROFILER_FUNC;
   const int xsize = yuv.xsize();
   const int ysize = yuv.ysize();
   const int c_xsize = (xsize + 1) / 2;
@@ -237,65 +371,229 @@ void SubSampleChroma(const Image3U& yuv,
   *yplane = CopyImage(yuv.Plane(0));
   *uplane = ImageU(c_xsize, c_ysize);
   *vplane = ImageU(c_xsize, c_ysize);
-  for (int y = 0; y < c_ysize; ++y) {
-    for (int x = 0; x < c_xsize; ++x) {
-      int sum_u = 0;
-      int sum_v = 0;
-      for (int iy = 0; iy < 2; ++iy) {
-        for (int ix = 0; ix < 2; ++ix) {
-          int yy = std::min(2 * y + iy, ysize - 1);
-          int xx = std::min(2 * x + ix, xsize - 1);
-          sum_u += yuv.PlaneRow(1, yy)[xx];
-          sum_v += yuv.PlaneRow(2, yy)[xx];
-        }
-      }
-      uplane->Row(y)[x] = (sum_u + 2) / 4;
-      vplane->Row(y)[x] = (sum_v + 2) / 4;
+  pool->Run(0, c_ysize, [&](const int task, const int thread) {
+    const int y = task;
+    const uint16_t* PIK_RESTRICT rows_u[2];
+    const uint16_t* PIK_RESTRICT rows_v[2];
+    for (int iy = 0; iy < 2; ++iy) {
+      const int yy = std::min(2 * y + iy, ysize - 1);
+      rows_u[iy] = yuv.ConstPlaneRow(1, yy);
+      rows_v[iy] = yuv.ConstPlaneRow(2, yy);
     }
-  }
+    uint16_t* PIK_RESTRICT row_u = uplane->Row(y);
+    uint16_t* PIK_RESTRICT row_v = vplane->Row(y);
+    // All but the last column have both horizontal samples.
+    for (int x = 0; x < xsize / 2; ++x) {
+      const int sum_u = rows_u[0][2 * x] + rows_u[0][2 * x + 1] +
+                        rows_u[1][2 * x] + rows_u[1][2 * x + 1];
+      const int sum_v = rows_v[0][2 * x] + rows_v[0][2 * x + 1] +
+                        rows_v[1][2 * x] + rows_v[1][2 * x + 1];
+      row_u[x] = (sum_u + 2) / 4;
+      row_v[x] = (sum_v + 2) / 4;
+    }
+    if (xsize & 1) {
+      const int x = c_xsize - 1;
+      const int sum_u = 2 * (rows_u[0][2 * x] + rows_u[1][2 * x]);
+      const int sum_v = 2 * (rows_v[0][2 * x] + rows_v[1][2 * x]);
+      row_u[x] = (sum_u + 2) / 4;
+      row_v[x] = (sum_v + 2) / 4;
+    }
+  });
 }
 
 ImageU SuperSamplePlane(const ImageU& in, int bit_depth,
-                        int out_xsize, int out_ysize) {
-  const int c_xsize = in.xsize();
-  const int c_ysize = in.ysize();
-  ImageU out(2 * c_xsize, 2 * c_ysize);
-  for (int y = 0; y < c_ysize; ++y) {
-    const int y0 = y > 0 ? y - 1 : y;
-    const int y1 = y;
-    const int y2 = y + 1 < c_ysize ? y + 1 : y;
-    const uint16_t* const PIK_RESTRICT row0 = in.Row(y0);
-    const uint16_t* const PIK_RESTRICT row1 = in.Row(y1);
-    const uint16_t* const PIK_RESTRICT row2 = in.Row(y2);
-    uint16_t* const PIK_RESTRICT row_out0 = out.Row(2 * y);
-    uint16_t* const PIK_RESTRICT row_out1 = out.Row(2 * y + 1);
-    for (int x = 0; x < c_xsize; ++x) {
-      const int x0 = x > 0 ? x - 1 : x;
-      const int x1 = x;
-      const int x2 = x + 1 < c_xsize ? x + 1 : x;
-      row_out0[2 * x + 0] = (9 * row1[x1] + 3 * row1[x0] +
-                             3 * row0[x1] + 1 * row0[x0] + 8) / 16;
-      row_out0[2 * x + 1] = (9 * row1[x1] + 3 * row1[x2] +
-                             3 * row0[x1] + 1 * row0[x2] + 8) / 16;
-      row_out1[2 * x + 0] = (9 * row1[x1] + 3 * row1[x0] +
-                             3 * row2[x1] + 1 * row2[x0] + 8) / 16;
-      row_out1[2 * x + 1] = (9 * row1[x1] + 3 * row1[x2] +
-                             3 * row2[x1] + 1 * row2[x2] + 8) / 16;
-    }
-  }
-  out.ShrinkTo(out_xsize, out_ysize);
+                        int out_xsize, int out_ysize, ThreadPool* pool) {
+  ImageU out(out_xsize, out_ysize);
+  pool->Run(0, out_ysize, [&](const int task, const int thread) {
+    SuperSampleRow(in, task, 0, out_xsize, out.Row(task));
+  });
   return out;
 }
 
 Image3U SuperSampleChroma(const ImageU& yplane,
                           const ImageU& uplane,
                           const ImageU& vplane,
-                          int bit_depth) {
+                          int bit_depth, ThreadPool* pool) {
+  PROFILER_FUNC;
   const int xsize = yplane.xsize();
   const int ysize = yplane.ysize();
   return Image3U(CopyImage(yplane),
-                 SuperSamplePlane(uplane, bit_depth, xsize, ysize),
-                 SuperSamplePlane(vplane, bit_depth, xsize, ysize));
+                 SuperSamplePlane(uplane, bit_depth, xsize, ysize, pool),
+                 SuperSamplePlane(vplane, bit_depth, xsize, ysize, pool));
+}
+
+namespace {
+
+// Writes the "num" (+ 0.5 offset) samples to row "y" of plane "c" of "out".
+void StoreYUV420Row(const float* PIK_RESTRICT in, const size_t num,
+                    const float maxv, const int c, const size_t y,
+                    const size_t x0, const YUV420ImageView& out) {
+  uint8_t* row = out.planes[c] + y * out.bytes_per_row[c];
+  if (out.bit_depth == 8) {
+    RoundRow(in, num, maxv, row + x0);
+  } else {
+    RoundRow(in, num, maxv, reinterpret_cast<uint16_t*>(row) + x0);
+  }
+}
+
+// "load_srgb(y, x0, num, rows)" writes "num" sRGB values in [0.0 .. 1.0] of
+// row y starting at x0 to rows[3], which are padded to whole vectors. Each
+// task converts one pair of rows (the last row is duplicated if ysize is
+// odd), so the chroma sums remain in L1.
+template <class LoadSrgb>
+void ToYUV420(const LoadSrgb& load_srgb, ThreadPool* pool,
+              const YUV420ImageView& out) {
+  PIK_CHECK(out.bit_depth == 8 || out.bit_depth == 10 || out.bit_depth == 12);
+  const size_t xsize = out.xsize;
+  const size_t ysize = out.ysize;
+  const float maxv = (1 << out.bit_depth) - 1;
+  const SIMD_NAMESPACE::Full<float> d;
+  pool->Run(0, (ysize + 1) / 2, [&](const int task, const int thread) {
+    const size_t c_y = task;
+    SIMD_ALIGN float in[3][kChunkSize];
+    SIMD_ALIGN float yuv[3][kChunkSize];
+    SIMD_ALIGN float sum[2][kChunkSize];
+    // kChunkSize is even, so chunks start at chroma sample boundaries.
+    for (size_t x0 = 0; x0 < xsize; x0 += kChunkSize) {
+      const size_t num = std::min(kChunkSize, xsize - x0);
+      for (size_t iy = 0; iy < 2; ++iy) {
+        const size_t y = std::min(2 * c_y + iy, ysize - 1);
+        load_srgb(y, x0, num, in);
+        RGBRowToYUV(in[0], in[1], in[2], num, maxv, yuv[0], yuv[1], yuv[2]);
+        if (y == 2 * c_y + iy) StoreYUV420Row(yuv[0], num, maxv, 0, y, x0, out);
+        for (int c = 0; c < 2; ++c) {
+          for (size_t x = 0; x < num; x += d.N) {
+            const auto chroma = load(d, yuv[1 + c] + x);
+            store(iy == 0 ? chroma : load(d, sum[c] + x) + chroma, d,
+                  sum[c] + x);
+          }
+        }
+      }
+      // Horizontal pairs; an odd last column counts twice. Each sample
+      // includes the 0.5 rounding offset, hence so does their average.
+      const size_t c_num = (num + 1) / 2;
+      for (int c = 0; c < 2; ++c) {
+        for (size_t x = 0; x < c_num; ++x) {
+          const float right = 2 * x + 1 < num ? sum[c][2 * x + 1]
+                                              : sum[c][2 * x];
+          yuv[1 + c][x] = (sum[c][2 * x] + right) * 0.25f;
+        }
+        StoreYUV420Row(yuv[1 + c], c_num, maxv, 1 + c, c_y, x0 / 2, out);
+      }
+    }
+  });
+}
+
+}  // namespace
+
+void YUV420FromRGB8(const Image3B& srgb, ThreadPool* pool,
+                    const YUV420ImageView& out) {
+  PROFILER_FUNC;
+  PIK_CHECK(srgb.xsize() == out.xsize && srgb.ysize() == out.ysize);
+  const float norm = 1.0f / 255;
+  ToYUV420(
+      [&](const size_t y, const size_t x0, const size_t num,
+          float (*rows)[kChunkSize]) {
+        for (int c = 0; c < 3; ++c) {
+          const uint8_t* PIK_RESTRICT row_srgb = srgb.ConstPlaneRow(c, y) + x0;
+          for (size_t x = 0; x < num; ++x) {
+            rows[c][x] = row_srgb[x] * norm;
+          }
+          ZeroTail(num, rows[c]);
+        }
+      },
+      pool, out);
+}
+
+void YUV420FromCenteredOpsin(const Image3F& opsin, ThreadPool* pool,
+                             const YUV420ImageView& out) {
+  PROFILER_FUNC;
+  PIK_CHECK(opsin.xsize() >= out.xsize && opsin.ysize() >= out.ysize);
+  using namespace SIMD_NAMESPACE;
+  const Full<float> d;
+  using V = Full<float>::V;
+  V inverse_matrix[9];
+  const float* PIK_RESTRICT inverse = GetOpsinAbsorbanceInverseMatrix();
+  for (size_t i = 0; i < 9; ++i) {
+    inverse_matrix[i] = set1(d, inverse[i]);
+  }
+  const V center_x = set1(d, kXybCenter[0]);
+  const V center_y = set1(d, kXybCenter[1]);
+  const V center_b = set1(d, kXybCenter[2]);
+  const V norm = set1(d, 1.0f / 255);
+  ToYUV420(
+      [&](const size_t y, const size_t x0, const size_t num,
+          float (*rows)[kChunkSize]) {
+        // Reading whole vectors is safe because opsin rows are padded.
+        const float* PIK_RESTRICT row_x = opsin.ConstPlaneRow(0, y) + x0;
+        const float* PIK_RESTRICT row_y = opsin.ConstPlaneRow(1, y) + x0;
+        const float* PIK_RESTRICT row_b = opsin.ConstPlaneRow(2, y) + x0;
+        for (size_t x = 0; x < num; x += d.N) {
+          V r, g, b;
+          XybToRgb(d, load(d, row_x + x) + center_x,
+                   load(d, row_y + x) + center_y,
+                   load(d, row_b + x) + center_b, inverse_matrix, &r, &g, &b);
+          V srgb_r, srgb_g, srgb_b;
+          LinearToSrgb8Poly(d, r, g, b, &srgb_r, &srgb_g, &srgb_b);
+          store(srgb_r * norm, d, rows[0] + x);
+          store(srgb_g * norm, d, rows[1] + x);
+          store(srgb_b * norm, d, rows[2] + x);
+        }
+      },
+      pool, out);
+}
+
+Image3F OpsinDynamicsImageFromYUVRec709(const ImageU& yplane,
+                                        const ImageU& uplane,
+                                        const ImageU& vplane, int bit_depth,
+                                        ThreadPool* pool) {
+  PROFILER_FUNC;
+  const size_t xsize = yplane.xsize();
+  const size_t ysize = yplane.ysize();
+  const bool subsampled = uplane.xsize() != xsize || uplane.ysize() != ysize;
+  if (subsampled) {
+    PIK_CHECK(uplane.xsize() == (xsize + 1) / 2);
+    PIK_CHECK(uplane.ysize() == (ysize + 1) / 2);
+  }
+  PIK_CHECK(SameSize(uplane, vplane));
+  const float norm = 1.0f / ((1 << bit_depth) - 1);
+  const float* table = SrgbToLinearInterpolationTable();
+  Image3F opsin(xsize, ysize);
+  pool->Run(0, ysize, [&](const int task, const int thread) {
+    const size_t y = task;
+    SIMD_ALIGN float in[3][kChunkSize];
+    SIMD_ALIGN float linear[3][kChunkSize];
+    for (size_t x0 = 0; x0 < xsize; x0 += kChunkSize) {
+      const size_t num = std::min(kChunkSize, xsize - x0);
+      const uint16_t* PIK_RESTRICT row_y = yplane.ConstRow(y) + x0;
+      for (size_t x = 0; x < num; ++x) {
+        in[0][x] = row_y[x];
+      }
+      if (subsampled) {
+        SuperSampleRow(uplane, y, x0, num, in[1]);
+        SuperSampleRow(vplane, y, x0, num, in[2]);
+      } else {
+        const uint16_t* PIK_RESTRICT row_u = uplane.ConstRow(y) + x0;
+        const uint16_t* PIK_RESTRICT row_v = vplane.ConstRow(y) + x0;
+        for (size_t x = 0; x < num; ++x) {
+          in[1][x] = row_u[x];
+          in[2][x] = row_v[x];
+        }
+      }
+      for (int c = 0; c < 3; ++c) {
+        ZeroTail(num, in[c]);
+      }
+      YUVRowToRGB(in[0], in[1], in[2], num, norm, 255.0f, 0.0f, linear[0],
+                  linear[1], linear[2]);
+      for (int c = 0; c < 3; ++c) {
+        LinearizeRow(table, num, linear[c]);
+      }
+      LinearRowToXyb(linear[0], linear[1], linear[2], num,
+                     opsin.PlaneRow(0, y) + x0, opsin.PlaneRow(1, y) + x0,
+                     opsin.PlaneRow(2, y) + x0);
+    }
+  });
+  return opsin;
 }
 
 }  // namespace pik
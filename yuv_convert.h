@@ -15,25 +15,70 @@
 #ifndef YUV_CONVERT_H_
 #define YUV_CONVERT_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "data_parallel.h"
 #include "image.h"
 
 namespace pik {
 
-Image3B RGB8ImageFromYUVRec709(const Image3U& yuv, int bit_depth);
-Image3U RGB16ImageFromYUVRec709(const Image3U& yuv, int bit_depth);
-Image3F RGBLinearImageFromYUVRec709(const Image3U& yuv, int bit_depth);
+// Caller-allocated 4:2:0 YUV Rec 709 planes, e.g. the input buffers of a
+// hardware video encoder: Y has xsize x ysize samples, U and V (planes[1] and
+// planes[2]) have (xsize + 1) / 2 x (ysize + 1) / 2. Samples are uint8_t if
+// bit_depth is 8, otherwise uint16_t (10 or 12 bit).
+struct YUV420ImageView {
+  uint8_t* planes[3];
+  size_t bytes_per_row[3];
+  size_t xsize;
+  size_t ysize;
+  int bit_depth;
+};
+
+// Conversions between 8 or 16 bit sRGB (or linear RGB) and 8, 10 or 12 bit
+// YUV Rec 709. Rows are converted in parallel.
+
+Image3B RGB8ImageFromYUVRec709(const Image3U& yuv, int bit_depth,
+                               ThreadPool* pool);
+Image3U RGB16ImageFromYUVRec709(const Image3U& yuv, int bit_depth,
+                                ThreadPool* pool);
+Image3F RGBLinearImageFromYUVRec709(const Image3U& yuv, int bit_depth,
+                                    ThreadPool* pool);
 
-Image3U YUVRec709ImageFromRGB8(const Image3B& rgb, int out_bit_depth);
-Image3U YUVRec709ImageFromRGB16(const Image3U& rgb, int out_bit_depth);
-Image3U YUVRec709ImageFromRGBLinear(const Image3F& rgb, int out_bit_depth);
+Image3U YUVRec709ImageFromRGB8(const Image3B& rgb, int out_bit_depth,
+                               ThreadPool* pool);
+Image3U YUVRec709ImageFromRGB16(const Image3U& rgb, int out_bit_depth,
+                                ThreadPool* pool);
+Image3U YUVRec709ImageFromRGBLinear(const Image3F& rgb, int out_bit_depth,
+                                    ThreadPool* pool);
 
-void SubSampleChroma(const Image3U& yuv, int bit_depth,
+void SubSampleChroma(const Image3U& yuv, int bit_depth, ThreadPool* pool,
                      ImageU* yplane, ImageU* uplane, ImageU* vplane);
 
 Image3U SuperSampleChroma(const ImageU& yplane,
                           const ImageU& uplane,
                           const ImageU& vplane,
-                          int bit_depth);
+                          int bit_depth, ThreadPool* pool);
+
+// Returns the opsin dynamics image of YUV Rec 709 planes, whose chroma is
+// either full resolution (4:4:4) or subsampled 2x2 (4:2:0, upsampled as in
+// SuperSampleChroma). Each row is upsampled, converted to linear RGB and then
+// XYB without allocating intermediate images.
+// Writes "out" (same size as "srgb") in a single pass: each pair of rows is
+// converted to YUV and its chroma averaged 2x2 as in SubSampleChroma, without
+// full-size intermediate images.
+void YUV420FromRGB8(const Image3B& srgb, ThreadPool* pool,
+                    const YUV420ImageView& out);
+
+// As above, but converts from the decoder's centered opsin image (see
+// CenteredOpsinToSrgb), whose size is at least that of "out".
+void YUV420FromCenteredOpsin(const Image3F& opsin, ThreadPool* pool,
+                             const YUV420ImageView& out);
+
+Image3F OpsinDynamicsImageFromYUVRec709(const ImageU& yplane,
+                                        const ImageU& uplane,
+                                        const ImageU& vplane, int bit_depth,
+                                        ThreadPool* pool);
 
 }  // namespace pik
 